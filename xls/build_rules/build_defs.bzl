@@ -14,11 +14,13 @@
 
 """Contains macros for DSLX targets."""
 
+load("//xls/build_rules:dslx_aot_library.bzl", _dslx_aot_library = "dslx_aot_library")
 load("//xls/build_rules:dslx_test.bzl", _dslx_test = "dslx_test")
 load("//xls/build_rules:dslx_codegen.bzl", _dslx_codegen = "dslx_codegen")
 load("//xls/build_rules:dslx_generated_rtl.bzl", _dslx_generated_rtl = "dslx_generated_rtl")
 load("//xls/build_rules:dslx_jit_wrapper.bzl", _dslx_jit_wrapper = "dslx_jit_wrapper")
 
+dslx_aot_library = _dslx_aot_library
 dslx_test = _dslx_test
 dslx_codegen = _dslx_codegen
 dslx_generated_rtl = _dslx_generated_rtl
@@ -0,0 +1,73 @@
+# Copyright 2021 The XLS Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""See dslx_aot_library()."""
+
+load("//xls/build_rules:genrule_wrapper.bzl", "genrule_wrapper")
+
+def dslx_aot_library(
+        name,
+        dslx_name = None,
+        entry_function = None,
+        deps = [],
+        **kwargs):
+    """Compiles an XLS function ahead of time into a cc_library.
+
+    The library holds the compiled object and a wrapper class with the same
+    packed-view and native-type Run() (and RunBatch()) interfaces as the class
+    generated by dslx_jit_wrapper, but it doesn't depend on the JIT or LLVM.
+    The object is compiled for the CPU of the machine running the build.
+
+    Args:
+      name: The name of the library.
+      dslx_name: Name of the generated class. If unspecified, the entry
+        function name will be used.
+      entry_function: The name of the function being compiled. If
+        unspecified, the package entry function is used.
+      deps: Dependencies of this library - likely only the source IR.
+      **kwargs: Extra arguments to pass to genrule.
+    """
+    entry_arg = ("--function=" + entry_function) if entry_function else ""
+    class_arg = ("-class_name " + dslx_name) if dslx_name else ""
+    genrule_wrapper(
+        name = "gen_" + name,
+        srcs = deps,
+        outs = [
+            name + ".h",
+            name + ".cc",
+            name + ".o",
+        ],
+        cmd = "$(location //xls/jit:aot_compiler_main) -ir_path $(SRCS) %s %s -output_name %s -output_dir $(@D) -genfiles_dir $(GENDIR)" % (entry_arg, class_arg, name),
+        exec_tools = [
+            "//xls/jit:aot_compiler_main",
+        ],
+        **kwargs
+    )
+
+    native.cc_library(
+        name = name,
+        srcs = [
+            name + ".cc",
+            name + ".o",
+        ],
+        hdrs = [name + ".h"],
+        deps = [
+            "@com_google_absl//absl/memory",
+            "@com_google_absl//absl/status",
+            "@com_google_absl//absl/status:statusor",
+            "@com_google_absl//absl/types:span",
+            "//xls/common/status:status_macros",
+            "//xls/ir:value_view",
+        ],
+    )
@@ -46,6 +46,7 @@ def dslx_jit_wrapper(
         outs = [
             name + ".h",
             name + ".cc",
+            name + "_benchmark.cc",
         ],
         cmd = "$(location //xls/jit:jit_wrapper_generator_main) -ir_path $(SRCS) %s -class_name %s -output_name %s -output_dir $(@D) -genfiles_dir $(GENDIR)" % (entry_arg, dslx_name, name),
         exec_tools = [
@@ -62,6 +63,7 @@ def dslx_jit_wrapper(
             "@com_google_absl//absl/status",
             "//xls/common/status:status_macros",
             "@com_google_absl//absl/status:statusor",
+            "@com_google_absl//absl/types:span",
             "//xls/ir",
             "//xls/ir:ir_parser",
             "//xls/ir:value",
@@ -69,3 +71,24 @@ def dslx_jit_wrapper(
             "//xls/jit:ir_jit",
         ],
     )
+
+    # Times calls of the wrapper; run with --min_time_seconds and (if the
+    # wrapper has a batched entry point) --batch_size.
+    native.cc_binary(
+        name = name + "_benchmark",
+        srcs = [name + "_benchmark.cc"],
+        tags = ["manual"],
+        deps = [
+            ":" + name,
+            "@com_google_absl//absl/flags:flag",
+            "@com_google_absl//absl/status",
+            "@com_google_absl//absl/strings:str_format",
+            "@com_google_absl//absl/time",
+            "//xls/common:init_xls",
+            "//xls/common/logging",
+            "//xls/common/status:status_macros",
+            "//xls/ir",
+            "//xls/ir:value",
+            "//xls/ir:value_helpers",
+        ],
+    )
@@ -0,0 +1,229 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/async_fifo.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "xls/codegen/vast.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+// A register of one clock domain of the FIFO, reset to zero.
+struct FifoRegister {
+  LogicRef* reg;
+  Expression* next;
+  int64_t width;
+};
+
+// Adds an always block clocked by 'clk' resetting the given registers on 'rst'
+// and loading them with their next values otherwise.
+void AddClockedBlock(LogicRef* clk, LogicRef* rst,
+                     absl::Span<const FifoRegister> registers, Module* module,
+                     VerilogFile* file) {
+  std::vector<SensitivityListElement> sensitivity_list = {
+      file->Make<PosEdge>(clk)};
+  AlwaysBase* always;
+  if (file->use_system_verilog()) {
+    always = module->Add<AlwaysFf>(sensitivity_list);
+  } else {
+    always = module->Add<Always>(sensitivity_list);
+  }
+  Conditional* conditional = always->statements()->Add<Conditional>(rst);
+  StatementBlock* else_block = conditional->AddAlternate();
+  for (const FifoRegister& reg : registers) {
+    conditional->consequent()->Add<NonblockingAssignment>(
+        reg.reg, file->Literal(0, reg.width));
+    else_block->Add<NonblockingAssignment>(reg.reg, reg.next);
+  }
+}
+
+// Adds the registers of the synchronizer of 'input' named '<name>_<stage>'.
+// Returns the registers; the last one is the synchronized value.
+std::vector<FifoRegister> AddSynchronizer(absl::string_view name,
+                                          LogicRef* input, int64_t width,
+                                          int64_t stages, Module* module,
+                                          VerilogFile* file) {
+  std::vector<FifoRegister> registers;
+  Expression* previous = input;
+  for (int64_t stage = 0; stage < stages; ++stage) {
+    LogicRef* reg = module->AddReg(absl::StrFormat("%s_%d", name, stage),
+                                   file->BitVectorType(width));
+    registers.push_back(FifoRegister{reg, previous, width});
+    previous = reg;
+  }
+  return registers;
+}
+
+// Returns the gray code of the given binary value.
+Expression* GrayCode(Expression* value, VerilogFile* file) {
+  return file->BitwiseXor(value, file->Shrl(value, file->PlainLiteral(1)));
+}
+
+}  // namespace
+
+absl::StatusOr<std::string> GenerateAsyncFifo(const AsyncFifoOptions& options) {
+  if (options.module_name.empty()) {
+    return absl::InvalidArgumentError("Asynchronous FIFO requires a name");
+  }
+  if (options.width < 1) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Asynchronous FIFO width must be positive, got %d", options.width));
+  }
+  if (options.depth < 2 ||
+      !IsPowerOfTwo(static_cast<uint64_t>(options.depth))) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Asynchronous FIFO depth must be a power of two of at least 2, got %d",
+        options.depth));
+  }
+  if (options.synchronizer_stages < 1) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Asynchronous FIFO synchronizer stages must be positive, got %d",
+        options.synchronizer_stages));
+  }
+
+  // The pointers have one bit more than the address to tell a full FIFO from
+  // an empty one.
+  const int64_t address_width = CeilOfLog2(options.depth);
+  const int64_t pointer_width = address_width + 1;
+
+  VerilogFile file(options.use_system_verilog);
+  Module* module = file.AddModule(options.module_name);
+  LogicRef* push_clk = module->AddInput("push_clk", file.ScalarType());
+  LogicRef* push_rst = module->AddInput("push_rst", file.ScalarType());
+  LogicRef* push_data =
+      module->AddInput("push_data", file.BitVectorType(options.width));
+  LogicRef* push_valid = module->AddInput("push_valid", file.ScalarType());
+  LogicRef* push_ready = module->AddOutput("push_ready", file.ScalarType());
+  LogicRef* pop_clk = module->AddInput("pop_clk", file.ScalarType());
+  LogicRef* pop_rst = module->AddInput("pop_rst", file.ScalarType());
+  LogicRef* pop_data =
+      module->AddOutput("pop_data", file.BitVectorType(options.width));
+  LogicRef* pop_valid = module->AddOutput("pop_valid", file.ScalarType());
+  LogicRef* pop_ready = module->AddInput("pop_ready", file.ScalarType());
+
+  LogicRef* mem = module->AddReg(
+      "mem", file.UnpackedArrayType(options.width, {options.depth}));
+  DataType* pointer_type = file.BitVectorType(pointer_width);
+  LogicRef* wr_ptr = module->AddReg("wr_ptr", pointer_type);
+  LogicRef* wr_ptr_gray = module->AddReg("wr_ptr_gray", pointer_type);
+  LogicRef* rd_ptr = module->AddReg("rd_ptr", pointer_type);
+  LogicRef* rd_ptr_gray = module->AddReg("rd_ptr_gray", pointer_type);
+  std::vector<FifoRegister> rd_ptr_sync =
+      AddSynchronizer("rd_ptr_gray_sync", rd_ptr_gray, pointer_width,
+                      options.synchronizer_stages, module, &file);
+  std::vector<FifoRegister> wr_ptr_sync =
+      AddSynchronizer("wr_ptr_gray_sync", wr_ptr_gray, pointer_width,
+                      options.synchronizer_stages, module, &file);
+
+  LogicRef* push_fire = module->AddWire("push_fire", file.ScalarType());
+  LogicRef* pop_fire = module->AddWire("pop_fire", file.ScalarType());
+  LogicRef* wr_ptr_next = module->AddWire("wr_ptr_next", pointer_type);
+  LogicRef* rd_ptr_next = module->AddWire("rd_ptr_next", pointer_type);
+
+  // The FIFO is full when the write pointer has wrapped once more than the
+  // read pointer: in gray code, the two most significant bits differ and the
+  // rest are equal. It is empty when the pointers are equal.
+  module->Add<ContinuousAssignment>(
+      push_ready,
+      file.NotEquals(
+          wr_ptr_gray,
+          file.BitwiseXor(rd_ptr_sync.back().reg,
+                          file.Literal(uint64_t{3} << (address_width - 1),
+                                       pointer_width))));
+  module->Add<ContinuousAssignment>(
+      pop_valid, file.NotEquals(rd_ptr_gray, wr_ptr_sync.back().reg));
+  module->Add<ContinuousAssignment>(push_fire,
+                                    file.BitwiseAnd(push_valid, push_ready));
+  module->Add<ContinuousAssignment>(pop_fire,
+                                    file.BitwiseAnd(pop_valid, pop_ready));
+  module->Add<ContinuousAssignment>(wr_ptr_next, file.Add(wr_ptr, push_fire));
+  module->Add<ContinuousAssignment>(rd_ptr_next, file.Add(rd_ptr, pop_fire));
+  module->Add<ContinuousAssignment>(
+      pop_data, file.Index(mem, file.Slice(rd_ptr, address_width - 1, 0)));
+
+  // Push domain: the write pointer and the synchronized read pointer.
+  std::vector<FifoRegister> push_registers = {
+      {wr_ptr, wr_ptr_next, pointer_width},
+      {wr_ptr_gray, GrayCode(wr_ptr_next, &file), pointer_width}};
+  push_registers.insert(push_registers.end(), rd_ptr_sync.begin(),
+                        rd_ptr_sync.end());
+  AddClockedBlock(push_clk, push_rst, push_registers, module, &file);
+
+  // The storage is written in the push domain and isn't reset.
+  std::vector<SensitivityListElement> sensitivity_list = {
+      file.Make<PosEdge>(push_clk)};
+  AlwaysBase* write_block;
+  if (options.use_system_verilog) {
+    write_block = module->Add<AlwaysFf>(sensitivity_list);
+  } else {
+    write_block = module->Add<Always>(sensitivity_list);
+  }
+  write_block->statements()
+      ->Add<Conditional>(push_fire)
+      ->consequent()
+      ->Add<NonblockingAssignment>(
+          file.Index(mem, file.Slice(wr_ptr, address_width - 1, 0)),
+          push_data);
+
+  // Pop domain: the read pointer and the synchronized write pointer.
+  std::vector<FifoRegister> pop_registers = {
+      {rd_ptr, rd_ptr_next, pointer_width},
+      {rd_ptr_gray, GrayCode(rd_ptr_next, &file), pointer_width}};
+  pop_registers.insert(pop_registers.end(), wr_ptr_sync.begin(),
+                       wr_ptr_sync.end());
+  AddClockedBlock(pop_clk, pop_rst, pop_registers, module, &file);
+
+  return file.Emit();
+}
+
+absl::StatusOr<std::vector<ClockDomainCrossingFifo>>
+GenerateClockDomainCrossingFifos(Package* package, const ClockDomains& domains,
+                                 bool use_system_verilog) {
+  XLS_ASSIGN_OR_RETURN(std::vector<ClockDomainCrossing> crossings,
+                       FindClockDomainCrossings(package, domains));
+  std::vector<ClockDomainCrossingFifo> fifos;
+  for (const ClockDomainCrossing& crossing : crossings) {
+    AsyncFifoOptions options;
+    options.module_name =
+        SanitizeIdentifier(absl::StrCat(crossing.channel->name(), "_cdc_fifo"));
+    options.width = crossing.channel->type()->GetFlatBitCount();
+    options.depth = domains.fifo_depth;
+    options.synchronizer_stages = domains.synchronizer_stages;
+    options.use_system_verilog = use_system_verilog;
+    if (options.width == 0) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Zero-width channel %s crossing clock domains %s and %s",
+          crossing.channel->name(), crossing.send_domain,
+          crossing.receive_domain));
+    }
+    XLS_ASSIGN_OR_RETURN(std::string verilog_text, GenerateAsyncFifo(options));
+    fifos.push_back(ClockDomainCrossingFifo{crossing, options.module_name,
+                                            std::move(verilog_text)});
+  }
+  return fifos;
+}
+
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,78 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_CODEGEN_ASYNC_FIFO_H_
+#define XLS_CODEGEN_ASYNC_FIFO_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "xls/ir/clock_domains.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace verilog {
+
+// Configuration of an asynchronous (dual-clock) FIFO.
+struct AsyncFifoOptions {
+  std::string module_name;
+
+  // Width of the data, in bits.
+  int64_t width = 1;
+
+  // Number of entries. Must be a power of two of at least 2.
+  int64_t depth = 4;
+
+  // Number of flops synchronizing each pointer into the other clock domain.
+  int64_t synchronizer_stages = 2;
+
+  bool use_system_verilog = true;
+};
+
+// Generates an asynchronous FIFO passing values from the push_clk domain to
+// the pop_clk domain with ready/valid handshakes on both sides:
+//
+//   push_clk, push_rst, push_data, push_valid, push_ready (output)
+//   pop_clk, pop_rst, pop_data (output), pop_valid (output), pop_ready
+//
+// The read and write pointers are gray-coded and passed into the other domain
+// through 'synchronizer_stages' flops, so a pushed value becomes visible to the
+// popping side (and a popped entry free for the pushing side) that many edges
+// of the destination clock later. The resets are active-high and synchronous
+// to their own clocks; both sides must be reset together.
+absl::StatusOr<std::string> GenerateAsyncFifo(const AsyncFifoOptions& options);
+
+// An asynchronous FIFO generated for a channel crossing clock domains.
+struct ClockDomainCrossingFifo {
+  ClockDomainCrossing crossing;
+  std::string module_name;
+  std::string verilog_text;
+};
+
+// Generates an asynchronous FIFO, named after the channel, for each channel of
+// the package crossing the given clock domains, using the FIFO depth and
+// synchronizer stages of the domains. The push side of each FIFO connects to
+// the sending proc's module and is clocked by its domain's clock, the pop side
+// to the receiving proc's module.
+absl::StatusOr<std::vector<ClockDomainCrossingFifo>>
+GenerateClockDomainCrossingFifos(Package* package, const ClockDomains& domains,
+                                 bool use_system_verilog = true);
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_ASYNC_FIFO_H_
@@ -0,0 +1,121 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/async_fifo.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+TEST(AsyncFifoTest, GeneratesGrayCodedPointers) {
+  AsyncFifoOptions options;
+  options.module_name = "my_fifo";
+  options.width = 8;
+  options.depth = 4;
+  options.synchronizer_stages = 3;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string verilog, GenerateAsyncFifo(options));
+  EXPECT_THAT(verilog, HasSubstr("module my_fifo("));
+  EXPECT_THAT(verilog, HasSubstr("input wire [7:0] push_data"));
+  EXPECT_THAT(verilog, HasSubstr("output wire [7:0] pop_data"));
+  EXPECT_THAT(verilog, HasSubstr("reg [7:0] mem[4];"));
+  EXPECT_THAT(verilog, HasSubstr("reg [2:0] wr_ptr_gray;"));
+  EXPECT_THAT(verilog, HasSubstr("rd_ptr_gray_sync_2"));
+  EXPECT_THAT(verilog, Not(HasSubstr("rd_ptr_gray_sync_3")));
+  EXPECT_THAT(verilog, HasSubstr("wr_ptr_next ^ wr_ptr_next >> 1"));
+  EXPECT_THAT(verilog, HasSubstr("always_ff @ (posedge push_clk)"));
+  EXPECT_THAT(verilog, HasSubstr("always_ff @ (posedge pop_clk)"));
+  EXPECT_THAT(verilog,
+              HasSubstr("assign push_ready = wr_ptr_gray != "
+                        "(rd_ptr_gray_sync_2 ^ 3'h6);"));
+  EXPECT_THAT(verilog, HasSubstr("assign pop_valid = rd_ptr_gray != "
+                                 "wr_ptr_gray_sync_2;"));
+
+  options.use_system_verilog = false;
+  XLS_ASSERT_OK_AND_ASSIGN(verilog, GenerateAsyncFifo(options));
+  EXPECT_THAT(verilog, Not(HasSubstr("always_ff")));
+  EXPECT_THAT(verilog, HasSubstr("always @ (posedge push_clk)"));
+}
+
+TEST(AsyncFifoTest, InvalidOptions) {
+  AsyncFifoOptions options;
+  options.module_name = "my_fifo";
+  options.width = 8;
+  options.depth = 6;
+  EXPECT_THAT(GenerateAsyncFifo(options).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("power of two")));
+  options.depth = 2;
+  options.synchronizer_stages = 0;
+  EXPECT_THAT(GenerateAsyncFifo(options).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("synchronizer stages")));
+}
+
+TEST(AsyncFifoTest, ClockDomainCrossingFifos) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(package test
+
+chan data(bits[16], id=0, kind=streaming, ops=send_receive, metadata="""""")
+
+proc producer(tok: token, state: bits[16], init=0) {
+  send.1: token = send(tok, state, channel_id=0, id=1)
+  next (send.1, state)
+}
+
+proc consumer(tok: token, state: bits[16], init=0) {
+  receive.2: (token, bits[16]) = receive(tok, channel_id=0, id=2)
+  tuple_index.3: token = tuple_index(receive.2, index=0, id=3)
+  tuple_index.4: bits[16] = tuple_index(receive.2, index=1, id=4)
+  next (tuple_index.3, tuple_index.4)
+}
+)"));
+  ClockDomains domains;
+  domains.periods = {{"core", 10}, {"io", 37}};
+  domains.proc_domains = {{"producer", "core"}, {"consumer", "io"}};
+  domains.fifo_depth = 8;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<ClockDomainCrossingFifo> fifos,
+      GenerateClockDomainCrossingFifos(package.get(), domains));
+  ASSERT_EQ(fifos.size(), 1);
+  EXPECT_EQ(fifos[0].crossing.channel->name(), "data");
+  EXPECT_EQ(fifos[0].crossing.send_domain, "core");
+  EXPECT_EQ(fifos[0].crossing.receive_domain, "io");
+  EXPECT_EQ(fifos[0].module_name, "data_cdc_fifo");
+  EXPECT_THAT(fifos[0].verilog_text, HasSubstr("module data_cdc_fifo("));
+  EXPECT_THAT(fifos[0].verilog_text, HasSubstr("reg [15:0] mem[8];"));
+
+  domains.proc_domains["consumer"] = "core";
+  XLS_ASSERT_OK_AND_ASSIGN(
+      fifos, GenerateClockDomainCrossingFifos(package.get(), domains));
+  EXPECT_TRUE(fifos.empty());
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,171 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/codegen_cache.h"
+
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "xls/codegen/module_signature.pb.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/stable_hash.h"
+#include "xls/ir/node.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+// Bump this whenever the entry format changes, to invalidate existing entries.
+constexpr int64_t kCodegenCacheFormatVersion = 1;
+
+constexpr char kEntryMagic[] = "xls_codegen_cache";
+
+// Appends "function" and the functions it (transitively) calls to
+// "functions", each once.
+void CollectFunctions(Function* function,
+                      absl::flat_hash_set<Function*>* visited,
+                      std::vector<Function*>* functions) {
+  if (!visited->insert(function).second) {
+    return;
+  }
+  functions->push_back(function);
+  for (Node* node : function->nodes()) {
+    switch (node->op()) {
+      case Op::kCountedFor:
+        CollectFunctions(node->As<CountedFor>()->body(), visited, functions);
+        break;
+      case Op::kDynamicCountedFor:
+        CollectFunctions(node->As<DynamicCountedFor>()->body(), visited,
+                         functions);
+        break;
+      case Op::kInvoke:
+        CollectFunctions(node->As<Invoke>()->to_apply(), visited, functions);
+        break;
+      case Op::kMap:
+        CollectFunctions(node->As<Map>()->to_apply(), visited, functions);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+std::string CodegenCache::GetKey(Function* function,
+                                 absl::string_view schedule,
+                                 absl::string_view options) {
+  // The function IR includes node names and ids, which show up in the
+  // generated text.
+  std::string key_text =
+      absl::StrFormat("%d\n%016x\n%016x\n", kCodegenCacheFormatVersion,
+                      StableHash64(schedule), StableHash64(options));
+  absl::flat_hash_set<Function*> visited;
+  std::vector<Function*> functions;
+  CollectFunctions(function, &visited, &functions);
+  for (Function* f : functions) {
+    absl::StrAppendFormat(&key_text, "%016x\n", StableHash64(f->DumpIr()));
+  }
+  return absl::StrFormat("%s-%016x", function->name(), StableHash64(key_text));
+}
+
+std::filesystem::path CodegenCache::GetPath(const std::string& key) const {
+  return cache_dir_ / absl::StrCat(key, ".v");
+}
+
+absl::optional<ModuleGeneratorResult> CodegenCache::Miss() {
+  absl::MutexLock lock(&mutex_);
+  ++misses_;
+  return absl::nullopt;
+}
+
+// An entry is a header of the form
+//
+//   xls_codegen_cache <version> <signature size>
+//
+// followed by a line break, the serialized signature proto and the module
+// text.
+absl::optional<ModuleGeneratorResult> CodegenCache::Load(
+    const std::string& key) {
+  std::filesystem::path path = GetPath(key);
+  if (!FileExists(path).ok()) {
+    return Miss();
+  }
+  absl::StatusOr<std::string> text = GetFileContents(path);
+  if (!text.ok()) {
+    XLS_LOG(WARNING) << "Unable to read codegen cache entry: "
+                     << text.status();
+    return Miss();
+  }
+  absl::string_view contents = *text;
+  size_t newline = contents.find('\n');
+  std::vector<absl::string_view> header;
+  if (newline != absl::string_view::npos) {
+    header = absl::StrSplit(contents.substr(0, newline), ' ');
+  }
+  int64_t version;
+  int64_t signature_size;
+  ModuleSignatureProto proto;
+  absl::string_view body = newline == absl::string_view::npos
+                               ? absl::string_view()
+                               : contents.substr(newline + 1);
+  if (header.size() != 3 || header[0] != kEntryMagic ||
+      !absl::SimpleAtoi(header[1], &version) ||
+      version != kCodegenCacheFormatVersion ||
+      !absl::SimpleAtoi(header[2], &signature_size) || signature_size < 0 ||
+      signature_size > body.size() ||
+      !proto.ParseFromString(std::string(body.substr(0, signature_size)))) {
+    XLS_LOG(WARNING) << "Ignoring malformed codegen cache entry " << path;
+    return Miss();
+  }
+  absl::StatusOr<ModuleSignature> signature = ModuleSignature::FromProto(proto);
+  if (!signature.ok()) {
+    XLS_LOG(WARNING) << "Ignoring codegen cache entry " << path
+                     << " with invalid signature: " << signature.status();
+    return Miss();
+  }
+
+  absl::MutexLock lock(&mutex_);
+  ++hits_;
+  return ModuleGeneratorResult{std::string(body.substr(signature_size)),
+                               *std::move(signature)};
+}
+
+void CodegenCache::Store(const std::string& key,
+                         const ModuleGeneratorResult& result) {
+  absl::Status status = RecursivelyCreateDir(cache_dir_);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to create codegen cache directory: " << status;
+    return;
+  }
+  std::string signature = result.signature.proto().SerializeAsString();
+  std::string text =
+      absl::StrFormat("%s %d %d\n%s%s", kEntryMagic, kCodegenCacheFormatVersion,
+                      signature.size(), signature, result.verilog_text);
+  status = AtomicSetFileContents(GetPath(key), text);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to write codegen cache entry: " << status;
+  }
+}
+
+}  // namespace verilog
+}  // namespace xls
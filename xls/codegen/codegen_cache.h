@@ -0,0 +1,85 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_CODEGEN_CODEGEN_CACHE_H_
+#define XLS_CODEGEN_CODEGEN_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/ir/function.h"
+
+namespace xls {
+namespace verilog {
+
+// A persistent on-disk cache of generated modules. Each entry is keyed by a
+// hash of the IR of the function the module was generated from (including the
+// functions it calls), of its schedule, and of the codegen options, and holds
+// the module text and signature. Regenerating a package in which only some
+// functions changed then emits byte-identical text for the unchanged ones, so
+// caches of downstream tools (synthesis, simulation) keyed on the text stay
+// warm. Entries are never invalidated, so the cache directory must be cleared
+// when the generators themselves change.
+class CodegenCache {
+ public:
+  explicit CodegenCache(std::filesystem::path cache_dir)
+      : cache_dir_(std::move(cache_dir)) {}
+
+  // Returns the key of the module generated from "function" with the given
+  // schedule (e.g., the text of its proto; empty for unscheduled generators)
+  // and codegen options, which must identify everything else the generated
+  // text depends on.
+  static std::string GetKey(Function* function, absl::string_view schedule,
+                            absl::string_view options);
+
+  // Returns the module stored for "key", or nullopt if there is no usable
+  // entry.
+  absl::optional<ModuleGeneratorResult> Load(const std::string& key);
+
+  // Stores "result" as the module generated for "key". Failures to write the
+  // entry are logged and otherwise ignored.
+  void Store(const std::string& key, const ModuleGeneratorResult& result);
+
+  int64_t hits() const {
+    absl::MutexLock lock(&mutex_);
+    return hits_;
+  }
+  int64_t misses() const {
+    absl::MutexLock lock(&mutex_);
+    return misses_;
+  }
+
+ private:
+  std::filesystem::path GetPath(const std::string& key) const;
+
+  absl::optional<ModuleGeneratorResult> Miss();
+
+  const std::filesystem::path cache_dir_;
+  mutable absl::Mutex mutex_;
+  int64_t hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t misses_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_CODEGEN_CACHE_H_
@@ -0,0 +1,121 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/codegen_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/codegen/combinational_generator.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+constexpr char kProgram[] = R"(
+package p
+
+fn callee(x: bits[32]) -> bits[32] {
+  ret neg.1: bits[32] = neg(x)
+}
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  invoke.2: bits[32] = invoke(x, to_apply=callee)
+  ret add.3: bits[32] = add(invoke.2, y)
+}
+)";
+
+TEST(CodegenCacheTest, StoreAndLoad) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kProgram));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result,
+                           GenerateCombinationalModule(main));
+
+  std::string key = CodegenCache::GetKey(main, "", "combinational");
+  EXPECT_EQ(key, CodegenCache::GetKey(main, "", "combinational"));
+  EXPECT_NE(key, CodegenCache::GetKey(main, "", "combinational verilog"));
+  EXPECT_NE(key, CodegenCache::GetKey(main, "stages: 2", "combinational"));
+
+  CodegenCache cache(temp_dir.path());
+  EXPECT_FALSE(cache.Load(key).has_value());
+  cache.Store(key, result);
+
+  // A fresh cache (as in a new process) finds the entry.
+  CodegenCache new_cache(temp_dir.path());
+  absl::optional<ModuleGeneratorResult> loaded = new_cache.Load(key);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->verilog_text, result.verilog_text);
+  EXPECT_EQ(loaded->signature.proto().module_name(),
+            result.signature.proto().module_name());
+  EXPECT_EQ(new_cache.hits(), 1);
+  EXPECT_EQ(new_cache.misses(), 0);
+  EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(CodegenCacheTest, KeyCoversCallees) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kProgram));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  std::string key = CodegenCache::GetKey(main, "", "");
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> changed,
+                           Parser::ParsePackage(R"(
+package p
+
+fn callee(x: bits[32]) -> bits[32] {
+  ret not.1: bits[32] = not(x)
+}
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  invoke.2: bits[32] = invoke(x, to_apply=callee)
+  ret add.3: bits[32] = add(invoke.2, y)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * changed_main,
+                           changed->GetFunction("main"));
+  EXPECT_NE(key, CodegenCache::GetKey(changed_main, "", ""));
+
+  // An identical package in another process gets the same key.
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> same,
+                           Parser::ParsePackage(kProgram));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * same_main, same->GetFunction("main"));
+  EXPECT_EQ(key, CodegenCache::GetKey(same_main, "", ""));
+}
+
+TEST(CodegenCacheTest, MalformedEntry) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kProgram));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  std::string key = CodegenCache::GetKey(main, "", "");
+  XLS_ASSERT_OK(SetFileContents(temp_dir.path() / absl::StrCat(key, ".v"),
+                                "xls_codegen_cache 1 100\nmodule"));
+  CodegenCache cache(temp_dir.path());
+  EXPECT_FALSE(cache.Load(key).has_value());
+  EXPECT_EQ(cache.misses(), 1);
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -31,6 +31,7 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/function.h"
@@ -181,7 +182,8 @@ absl::StatusOr<Channel*> GetChannelUsedByNode(Node* node) {
 }  // namespace
 
 absl::StatusOr<ModuleGeneratorResult> GenerateCombinationalModule(
-    Function* func, bool use_system_verilog) {
+    Function* func, bool use_system_verilog, VerilogSink* verilog_sink) {
+  XLS_TRACE_SPAN("GenerateCombinationalModule", func->name());
   XLS_ASSIGN_OR_RETURN(
       Proc * proc,
       FunctionToProc(func, absl::StrCat("__", func->name(), "_proc")));
@@ -190,7 +192,8 @@ absl::StatusOr<ModuleGeneratorResult> GenerateCombinationalModule(
       ModuleGeneratorResult result,
       GenerateModule(proc, GeneratorOptions()
                                .module_name(module_name)
-                               .use_system_verilog(use_system_verilog)));
+                               .use_system_verilog(use_system_verilog)
+                               .verilog_sink(verilog_sink)));
 
   // Generate a signature for the module. ProcGenerate currently generates a
   // signature with "Unknown" interface type.
@@ -215,6 +218,7 @@ absl::StatusOr<ModuleGeneratorResult> GenerateCombinationalModuleFromProc(
     const absl::flat_hash_map<const Channel*, ProcPortType>& channel_gen_types,
     bool use_system_verilog) {
   XLS_VLOG(2) << "Generating combinational module for proc:";
+  XLS_TRACE_SPAN("GenerateCombinationalModuleFromProc", proc->name());
   XLS_VLOG_LINES(2, proc->DumpIr());
 
   VerilogFile f(use_system_verilog);
@@ -22,6 +22,7 @@
 #include "xls/codegen/module_signature.h"
 #include "xls/codegen/name_to_bit_count.h"
 #include "xls/codegen/vast.h"
+#include "xls/codegen/verilog_sink.h"
 #include "xls/ir/function.h"
 #include "xls/ir/proc.h"
 
@@ -32,8 +33,11 @@ namespace verilog {
 // use_system_verilog is true the generated module will be SystemVerilog
 // otherwise it will be Verilog. This adds a proc to the package which
 // represents the combinational module. This proc is used for code generation.
+// If verilog_sink is given, the Verilog is written to it as it is emitted and
+// the verilog_text of the result is left empty.
 absl::StatusOr<ModuleGeneratorResult> GenerateCombinationalModule(
-    Function* func, bool use_system_verilog = true);
+    Function* func, bool use_system_verilog = true,
+    VerilogSink* verilog_sink = nullptr);
 
 enum class ProcPortType {
   kNull = 0,
@@ -18,21 +18,24 @@
 #include "absl/status/statusor.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
-#include "xls/ir/bits_ops.h"
+#include "xls/ir/bits.h"
 #include "xls/ir/package.h"
 
 namespace xls {
 
 // Gathers the Bits objects at the leaves of the Value.
-static void GatherValueLeaves(const Value& value, std::vector<Bits>* leaves) {
+// Pushes the leaves of "value" onto "rope" from least to most significant,
+// i.e., in reverse order of the elements.
+static void PushValueLeaves(const Value& value, BitsRope* rope) {
   switch (value.kind()) {
     case ValueKind::kBits:
-      leaves->push_back(value.bits());
+      rope->push_back(value.bits());
       break;
     case ValueKind::kTuple:
     case ValueKind::kArray:
-      for (const Value& e : value.elements()) {
-        GatherValueLeaves(e, leaves);
+      for (auto it = value.elements().rbegin(); it != value.elements().rend();
+           ++it) {
+        PushValueLeaves(*it, rope);
       }
       break;
     default:
@@ -41,9 +44,9 @@ static void GatherValueLeaves(const Value& value, std::vector<Bits>* leaves) {
 }
 
 Bits FlattenValueToBits(const Value& value) {
-  std::vector<Bits> leaves;
-  GatherValueLeaves(value, &leaves);
-  return bits_ops::Concat(leaves);
+  BitsRope rope(value.GetFlatBitCount());
+  PushValueLeaves(value, &rope);
+  return rope.Build();
 }
 
 absl::StatusOr<Value> UnflattenBitsToValue(const Bits& bits, const Type* type) {
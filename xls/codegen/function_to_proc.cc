@@ -14,9 +14,15 @@
 
 #include "xls/codegen/function_to_proc.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "xls/codegen/flattening.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/function_builder.h"
 #include "xls/ir/node.h"
@@ -25,6 +31,91 @@
 
 namespace xls {
 namespace verilog {
+namespace {
+
+// Returns the given value flattened to bits as by FlattenValueToBits.
+BValue FlattenToBits(BValue value, BuilderBase* b) {
+  Type* type = value.GetType();
+  if (type->IsBits()) {
+    return value;
+  }
+  std::vector<BValue> elements;
+  if (type->IsTuple()) {
+    for (int64_t i = 0; i < type->AsTupleOrDie()->size(); ++i) {
+      if (type->AsTupleOrDie()->element_type(i)->GetFlatBitCount() > 0) {
+        elements.push_back(FlattenToBits(b->TupleIndex(value, i), b));
+      }
+    }
+  } else {
+    ArrayType* array_type = type->AsArrayOrDie();
+    for (int64_t i = 0; i < array_type->size(); ++i) {
+      elements.push_back(FlattenToBits(
+          b->ArrayIndex(value, {b->Literal(UBits(i, 64))}), b));
+    }
+  }
+  return b->Concat(elements);
+}
+
+// Returns the value of the given type held in the flat bits 'bits', the
+// inverse of FlattenToBits.
+BValue UnflattenBits(BValue bits, Type* type, BuilderBase* b) {
+  if (type->IsBits()) {
+    return bits;
+  }
+  std::vector<BValue> elements;
+  if (type->IsTuple()) {
+    TupleType* tuple_type = type->AsTupleOrDie();
+    for (int64_t i = 0; i < tuple_type->size(); ++i) {
+      Type* element_type = tuple_type->element_type(i);
+      if (element_type->GetFlatBitCount() == 0) {
+        elements.push_back(b->Literal(ZeroOfType(element_type)));
+        continue;
+      }
+      elements.push_back(UnflattenBits(
+          b->BitSlice(bits, GetFlatBitIndexOfElement(tuple_type, i),
+                      element_type->GetFlatBitCount()),
+          element_type, b));
+    }
+    return b->Tuple(elements);
+  }
+  ArrayType* array_type = type->AsArrayOrDie();
+  for (int64_t i = 0; i < array_type->size(); ++i) {
+    elements.push_back(UnflattenBits(
+        b->BitSlice(bits, GetFlatBitIndexOfElement(array_type, i),
+                    array_type->element_type()->GetFlatBitCount()),
+        array_type->element_type(), b));
+  }
+  return b->Array(elements, array_type->element_type());
+}
+
+// A value transferred over a streaming channel in one or more beats.
+struct StreamedValue {
+  std::string name;
+  Type* type;
+  // The width of each beat if the value is transferred over several beats.
+  absl::optional<int64_t> beat_width;
+  int64_t beat_count;
+};
+
+absl::StatusOr<StreamedValue> GetStreamedValue(
+    absl::string_view name, Type* type, const StreamingProcOptions& options) {
+  StreamedValue value{std::string(name), type, absl::nullopt, 1};
+  auto it = options.beat_widths.find(name);
+  absl::optional<int64_t> beat_width = it == options.beat_widths.end()
+                                           ? options.default_beat_width
+                                           : it->second;
+  if (beat_width.has_value() && *beat_width <= 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Beat width of %s must be positive, is %d", name, *beat_width));
+  }
+  if (beat_width.has_value() && type->GetFlatBitCount() > *beat_width) {
+    value.beat_width = beat_width;
+    value.beat_count = CeilOfRatio(type->GetFlatBitCount(), *beat_width);
+  }
+  return value;
+}
+
+}  // namespace
 
 absl::StatusOr<Proc*> FunctionToProc(Function* f, absl::string_view proc_name) {
   TokenlessProcBuilder pb(proc_name, Value::Tuple({}), "tkn", "st",
@@ -94,5 +185,165 @@ absl::StatusOr<Proc*> FunctionToProc(Function* f, absl::string_view proc_name) {
   return proc;
 }
 
+absl::StatusOr<Proc*> FunctionToStreamingProc(
+    Function* f, absl::string_view proc_name,
+    const StreamingProcOptions& options) {
+  Package* package = f->package();
+  std::vector<StreamedValue> inputs;
+  for (Param* param : f->params()) {
+    if (param->GetType()->GetFlatBitCount() > 0) {
+      XLS_ASSIGN_OR_RETURN(
+          StreamedValue input,
+          GetStreamedValue(param->GetName(), param->GetType(), options));
+      inputs.push_back(input);
+    }
+  }
+  Type* return_type = f->return_value()->GetType();
+  absl::optional<StreamedValue> output;
+  if (return_type->GetFlatBitCount() > 0) {
+    XLS_ASSIGN_OR_RETURN(output,
+                         GetStreamedValue("out", return_type, options));
+  }
+  int64_t period = output.has_value() ? output->beat_count : 1;
+  for (const StreamedValue& input : inputs) {
+    period = std::max(period, input.beat_count);
+  }
+
+  // The state holds the iteration of the period, the arguments received so far
+  // and the return value of the previous period being sent over several beats
+  // along with whether there is such a return value.
+  const int64_t counter_width = std::max(int64_t{1}, CeilOfLog2(period));
+  auto buffer_type = [&](const StreamedValue& value) -> Type* {
+    return value.beat_width.has_value()
+               ? package->GetBitsType(value.beat_count * *value.beat_width)
+               : value.type;
+  };
+  std::vector<Value> init_elements = {Value(UBits(0, counter_width))};
+  for (const StreamedValue& input : inputs) {
+    init_elements.push_back(ZeroOfType(buffer_type(input)));
+  }
+  const bool multi_beat_output =
+      output.has_value() && output->beat_width.has_value();
+  if (multi_beat_output) {
+    init_elements.push_back(ZeroOfType(buffer_type(*output)));
+    init_elements.push_back(Value(UBits(0, 1)));
+  }
+
+  TokenlessProcBuilder pb(proc_name, Value::Tuple(init_elements), "tkn", "st",
+                          package);
+  BValue state = pb.GetStateParam();
+  BValue counter = pb.TupleIndex(state, 0);
+  BValue last_iteration =
+      pb.Eq(counter, pb.Literal(UBits(period - 1, counter_width)));
+  std::vector<BValue> next_state = {pb.Select(
+      last_iteration, pb.Literal(UBits(0, counter_width)),
+      pb.Add(counter, pb.Literal(UBits(1, counter_width))))};
+
+  // A map from the nodes in 'f' to their corresponding node in 'proc'.
+  absl::flat_hash_map<Node*, Node*> node_map;
+  int64_t input_index = 0;
+  for (Param* param : f->params()) {
+    if (param->GetType()->GetFlatBitCount() == 0) {
+      node_map[param] = pb.Literal(ZeroOfType(param->GetType())).node();
+      continue;
+    }
+    const StreamedValue& input = inputs[input_index];
+    BValue buffer = pb.TupleIndex(state, 1 + input_index);
+    ++input_index;
+    if (!input.beat_width.has_value()) {
+      XLS_ASSIGN_OR_RETURN(StreamingChannel * ch,
+                           package->CreateStreamingChannel(
+                               input.name, ChannelOps::kReceiveOnly,
+                               input.type));
+      BValue first_iteration =
+          pb.Eq(counter, pb.Literal(UBits(0, counter_width)));
+      BValue argument =
+          pb.Select(first_iteration,
+                    pb.ReceiveIf(ch, first_iteration, param->loc(), input.name),
+                    buffer);
+      next_state.push_back(argument);
+      node_map[param] = argument.node();
+      continue;
+    }
+    // Each beat is shifted into the buffer from the top, so the first beat
+    // ends up in the least significant bits.
+    const int64_t beat_width = *input.beat_width;
+    XLS_ASSIGN_OR_RETURN(StreamingChannel * ch,
+                         package->CreateStreamingChannel(
+                             input.name, ChannelOps::kReceiveOnly,
+                             package->GetBitsType(beat_width)));
+    BValue receiving =
+        input.beat_count == period
+            ? pb.Literal(UBits(1, 1))
+            : pb.ULt(counter,
+                     pb.Literal(UBits(input.beat_count, counter_width)));
+    BValue beat = pb.ReceiveIf(ch, receiving, param->loc(), input.name);
+    BValue shifted = pb.Concat(
+        {beat, pb.BitSlice(buffer, beat_width,
+                           (input.beat_count - 1) * beat_width)});
+    BValue new_buffer = pb.Select(receiving, shifted, buffer);
+    next_state.push_back(new_buffer);
+    node_map[param] =
+        UnflattenBits(
+            pb.BitSlice(new_buffer, 0, input.type->GetFlatBitCount()),
+            input.type, &pb)
+            .node();
+  }
+
+  // The return value is computed by the nodes of 'f' cloned in place of this
+  // placeholder once the proc is built.
+  BValue placeholder = pb.Literal(ZeroOfType(return_type));
+  if (output.has_value() && !multi_beat_output) {
+    XLS_ASSIGN_OR_RETURN(
+        StreamingChannel * out_ch,
+        package->CreateStreamingChannel("out", ChannelOps::kSendOnly,
+                                        return_type));
+    pb.SendIf(out_ch, last_iteration, placeholder);
+  } else if (multi_beat_output) {
+    const int64_t beat_width = *output->beat_width;
+    XLS_ASSIGN_OR_RETURN(StreamingChannel * out_ch,
+                         package->CreateStreamingChannel(
+                             "out", ChannelOps::kSendOnly,
+                             package->GetBitsType(beat_width)));
+    BValue buffer = pb.TupleIndex(state, 1 + inputs.size());
+    BValue valid = pb.TupleIndex(state, 2 + inputs.size());
+    BValue sending = valid;
+    if (output->beat_count < period) {
+      sending = pb.And(
+          valid, pb.ULt(counter, pb.Literal(UBits(output->beat_count,
+                                                  counter_width))));
+    }
+    pb.SendIf(out_ch, sending, pb.BitSlice(buffer, 0, beat_width));
+    BValue shifted = pb.Concat(
+        {pb.Literal(UBits(0, beat_width)),
+         pb.BitSlice(buffer, beat_width,
+                     (output->beat_count - 1) * beat_width)});
+    BValue result = pb.ZeroExtend(FlattenToBits(placeholder, &pb),
+                                  output->beat_count * beat_width);
+    next_state.push_back(pb.Select(last_iteration, result,
+                                   pb.Select(sending, shifted, buffer)));
+    next_state.push_back(pb.Or(valid, last_iteration));
+  }
+
+  XLS_ASSIGN_OR_RETURN(Proc * proc, pb.Build(pb.Tuple(next_state)));
+
+  for (Node* node : TopoSort(f)) {
+    if (node->Is<Param>()) {
+      continue;
+    }
+    std::vector<Node*> new_operands;
+    for (Node* operand : node->operands()) {
+      new_operands.push_back(node_map.at(operand));
+    }
+    XLS_ASSIGN_OR_RETURN(Node * proc_node,
+                         node->CloneInNewFunction(new_operands, proc));
+    node_map[node] = proc_node;
+  }
+  XLS_RETURN_IF_ERROR(
+      placeholder.node()->ReplaceUsesWith(node_map.at(f->return_value())));
+  XLS_RETURN_IF_ERROR(proc->RemoveNode(placeholder.node()));
+  return proc;
+}
+
 }  // namespace verilog
 }  // namespace xls
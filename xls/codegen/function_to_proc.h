@@ -15,7 +15,12 @@
 #ifndef XLS_CODEGEN_FUNCTION_TO_PROC_H_
 #define XLS_CODEGEN_FUNCTION_TO_PROC_H_
 
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "xls/ir/function.h"
 #include "xls/ir/proc.h"
 
@@ -28,6 +33,39 @@ namespace verilog {
 // over a port channel. Returns a pointer to the proc.
 absl::StatusOr<Proc*> FunctionToProc(Function* f, absl::string_view proc_name);
 
+// Options for converting a function into a proc with streaming channels.
+struct StreamingProcOptions {
+  // The width in bits of the beats of the channels of the parameters, by
+  // parameter name, and of the output channel, by the name "out". Values wider
+  // than the beat width of their channel are transferred over several beats.
+  absl::flat_hash_map<std::string, int64_t> beat_widths;
+
+  // The beat width of the channels of values not in 'beat_widths'. If not
+  // given, such values are transferred whole in a single beat.
+  absl::optional<int64_t> default_beat_width;
+};
+
+// Converts a function into a proc of the given name which communicates over
+// streaming (flow-controlled) channels so that wide values can be transferred
+// over narrow channels. Each function argument is received on a channel named
+// after its parameter and the return value is sent over the channel "out".
+//
+// A value which fits in one beat is transferred whole on a channel of its type.
+// A wider value is flattened (as by FlattenValueToBits), zero-padded to a
+// multiple of the beat width and transferred least significant beat first on
+// a channel of bits of the beat width.
+//
+// The proc runs in periods of P iterations, where P is the largest number of
+// beats of an argument or of the return value. Beat k of each argument is
+// received in iteration k of a period and the function is evaluated in the
+// last iteration of the period. A single-beat return value is sent in that
+// iteration. A wider return value is sent beat by beat in the first iterations
+// of the next period while the next arguments arrive, so a new set of
+// arguments is accepted every P iterations.
+absl::StatusOr<Proc*> FunctionToStreamingProc(
+    Function* f, absl::string_view proc_name,
+    const StreamingProcOptions& options);
+
 }  // namespace verilog
 }  // namespace xls
 
@@ -14,9 +14,15 @@
 
 #include "xls/codegen/function_to_proc.h"
 
+#include <memory>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
 #include "xls/common/status/matchers.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/interpreter/proc_network_interpreter.h"
 #include "xls/ir/function_builder.h"
 #include "xls/ir/ir_test_base.h"
 
@@ -24,6 +30,10 @@ namespace xls {
 namespace verilog {
 namespace {
 
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
 class FunctionToProcTest : public IrTestBase {};
 
 TEST_F(FunctionToProcTest, SimpleFunction) {
@@ -71,6 +81,81 @@ TEST_F(FunctionToProcTest, ZeroWidthInputsAndOutput) {
   EXPECT_EQ(out_ch->supported_ops(), ChannelOps::kReceiveOnly);
 }
 
+TEST_F(FunctionToProcTest, StreamingChannelWidths) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(20));
+  fb.Param("y", p->GetTupleType({p->GetBitsType(4), p->GetBitsType(12)}));
+  fb.Param("z", p->GetBitsType(0));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(x));
+  StreamingProcOptions options;
+  options.beat_widths["x"] = 8;
+  options.default_beat_width = 16;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Proc * proc, FunctionToStreamingProc(f, "StreamingProc", options));
+
+  // 'x' is transferred over three beats, 'y' in one and the output in two.
+  EXPECT_EQ(proc->name(), "StreamingProc");
+  EXPECT_EQ(p->channels().size(), 3);
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * x_ch, p->GetChannel("x"));
+  EXPECT_FALSE(x_ch->IsPort());
+  EXPECT_EQ(x_ch->supported_ops(), ChannelOps::kReceiveOnly);
+  EXPECT_EQ(x_ch->type(), p->GetBitsType(8));
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * y_ch, p->GetChannel("y"));
+  EXPECT_EQ(y_ch->type(),
+            p->GetTupleType({p->GetBitsType(4), p->GetBitsType(12)}));
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * out_ch, p->GetChannel("out"));
+  EXPECT_EQ(out_ch->supported_ops(), ChannelOps::kSendOnly);
+  EXPECT_EQ(out_ch->type(), p->GetBitsType(16));
+
+  options.beat_widths["y"] = 0;
+  EXPECT_THAT(FunctionToStreamingProc(f, "BadProc", options).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be positive")));
+}
+
+TEST_F(FunctionToProcTest, StreamingMultiBeatInputAndOutput) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Function * f, fb.BuildWithReturnValue(fb.Add(x, fb.ZeroExtend(y, 32))));
+  StreamingProcOptions options;
+  options.beat_widths["x"] = 8;
+  options.beat_widths["out"] = 16;
+  XLS_ASSERT_OK(FunctionToStreamingProc(f, "StreamingProc", options).status());
+
+  // Beats are transferred least significant first. Each result is sent during
+  // the period after its arguments are received, so feed a second set of
+  // arguments.
+  std::vector<Value> x_beats = {
+      Value(UBits(0x04, 8)), Value(UBits(0x03, 8)), Value(UBits(0x02, 8)),
+      Value(UBits(0x01, 8)), Value(UBits(0xff, 8)), Value(UBits(0xff, 8)),
+      Value(UBits(0xff, 8)), Value(UBits(0xff, 8))};
+  std::vector<Value> y_values = {Value(UBits(5, 8)), Value(UBits(1, 8))};
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * x_ch, p->GetChannel("x"));
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * y_ch, p->GetChannel("y"));
+  std::vector<std::unique_ptr<RxOnlyChannelQueue>> rx_only_queues;
+  rx_only_queues.push_back(
+      absl::make_unique<FixedRxOnlyChannelQueue>(x_ch, p.get(), x_beats));
+  rx_only_queues.push_back(
+      absl::make_unique<FixedRxOnlyChannelQueue>(y_ch, p.get(), y_values));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(p.get(), std::move(rx_only_queues)));
+  for (int64_t i = 0; i < 8; ++i) {
+    XLS_ASSERT_OK(interpreter->Tick());
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * out_ch, p->GetChannel("out"));
+  EXPECT_EQ(out_ch->type(), p->GetBitsType(16));
+  ChannelQueue& out_queue = interpreter->queue_manager().GetQueue(out_ch);
+  EXPECT_EQ(out_queue.size(), 2);
+  EXPECT_THAT(out_queue.Dequeue(), IsOkAndHolds(Value(UBits(0x0309, 16))));
+  EXPECT_THAT(out_queue.Dequeue(), IsOkAndHolds(Value(UBits(0x0102, 16))));
+}
+
 }  // namespace
 }  // namespace verilog
 }  // namespace xls
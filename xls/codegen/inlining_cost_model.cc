@@ -0,0 +1,82 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/inlining_cost_model.h"
+
+#include <algorithm>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/codegen/node_expressions.h"
+#include "xls/common/math_util.h"
+
+namespace xls {
+namespace verilog {
+
+/* static */ InliningOptions InliningOptions::Readability() {
+  InliningOptions options;
+  options.max_inline_depth = 4;
+  return options;
+}
+
+/* static */ InliningOptions InliningOptions::SimulationSpeed() {
+  InliningOptions options;
+  options.max_inline_depth = 16;
+  options.max_duplicated_cost = 8;
+  return options;
+}
+
+absl::StatusOr<InliningOptions> InliningOptionsFromString(
+    absl::string_view name) {
+  if (name == "default") {
+    return InliningOptions::Default();
+  }
+  if (name == "readability") {
+    return InliningOptions::Readability();
+  }
+  if (name == "simulation_speed") {
+    return InliningOptions::SimulationSpeed();
+  }
+  return absl::InvalidArgumentError(absl::StrFormat(
+      "Unknown inlining strategy '%s'; expected one of default, readability, "
+      "simulation_speed",
+      name));
+}
+
+bool InliningCostModel::ShouldEmitAsAssignment(Node* node, int64_t fanout,
+                                               bool must_name) {
+  InlineExpression expression{1, 1};
+  for (Node* operand : node->operands()) {
+    auto it = expressions_.find(operand);
+    if (it != expressions_.end()) {
+      expression.depth = std::max(expression.depth, it->second.depth + 1);
+      expression.operation_count += it->second.operation_count;
+    }
+  }
+
+  bool named = must_name || expression.depth > options_.max_inline_depth;
+  if (!named && fanout > 1 && !ShouldInlineExpressionIntoMultipleUses(node)) {
+    int64_t width_units = std::max(
+        int64_t{1}, CeilOfRatio(node->GetType()->GetFlatBitCount(),
+                                InliningOptions::kBitsPerCostUnit));
+    int64_t duplicated_cost =
+        (fanout - 1) * expression.operation_count * width_units;
+    named = duplicated_cost > options_.max_duplicated_cost;
+  }
+  expressions_[node] = named ? InlineExpression{0, 0} : expression;
+  return named;
+}
+
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,98 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost model deciding which nodes are emitted as inline Verilog expressions
+// and which as assignments to named temporaries.
+#ifndef XLS_CODEGEN_INLINING_COST_MODEL_H_
+#define XLS_CODEGEN_INLINING_COST_MODEL_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+namespace verilog {
+
+// Options of the inlining cost model. The presets trade off readability of the
+// emitted Verilog against the time simulators spend elaborating and
+// evaluating it.
+struct InliningOptions {
+  // Maximum depth of an inline expression. Deeper expressions are broken up by
+  // assigning intermediate values to named temporaries.
+  int64_t max_inline_depth = std::numeric_limits<int64_t>::max();
+
+  // Maximum cost of the operations duplicated by inlining an expression with
+  // multiple uses into each of its uses. The cost of an expression is its
+  // number of operations times its width in units of kBitsPerCostUnit bits.
+  // Terse unary expressions (see ShouldInlineExpressionIntoMultipleUses) are
+  // always inlined.
+  int64_t max_duplicated_cost = 0;
+
+  static constexpr int64_t kBitsPerCostUnit = 64;
+
+  // Names every value with multiple uses and never limits the depth of inline
+  // expressions. This is the default.
+  static InliningOptions Default() { return InliningOptions(); }
+
+  // Additionally keeps inline expressions shallow so each assignment is easy
+  // to read.
+  static InliningOptions Readability();
+
+  // Inlines small shared expressions and allows deeper expressions to reduce
+  // the number of named temporaries, each of which is a signal to schedule for
+  // event-driven simulators and elaborate for all. Depth is still bounded so no
+  // single expression gets pathologically deep.
+  static InliningOptions SimulationSpeed();
+};
+
+// Returns the options of the preset with the given name: "default",
+// "readability" or "simulation_speed".
+absl::StatusOr<InliningOptions> InliningOptionsFromString(
+    absl::string_view name);
+
+// Decides, for the nodes of a function or pipeline stage in topological order,
+// whether each is emitted as an assignment to a named temporary. Operands not
+// visited by the model (for example, values from earlier pipeline stages) are
+// assumed to be named.
+class InliningCostModel {
+ public:
+  explicit InliningCostModel(const InliningOptions& options)
+      : options_(options) {}
+
+  // Returns whether the given node should be emitted as an assignment.
+  // 'fanout' is the number of uses of the node in the emitted Verilog.
+  // 'must_name' indicates the node must be assigned to a named temporary
+  // regardless of cost (for example, it is live out of a pipeline stage or
+  // cannot be emitted inline).
+  bool ShouldEmitAsAssignment(Node* node, int64_t fanout, bool must_name);
+
+ private:
+  // The shape of the inline expression of a node: zero for named nodes.
+  struct InlineExpression {
+    int64_t depth;
+    int64_t operation_count;
+  };
+
+  InliningOptions options_;
+  absl::flat_hash_map<Node*, InlineExpression> expressions_;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_INLINING_COST_MODEL_H_
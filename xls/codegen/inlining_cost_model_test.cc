@@ -0,0 +1,117 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/inlining_cost_model.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::StatusIs;
+
+class InliningCostModelTest : public IrTestBase {};
+
+TEST_F(InliningCostModelTest, DepthLimit) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  std::vector<Node*> chain;
+  BValue value = x;
+  for (int64_t i = 0; i < 10; ++i) {
+    value = fb.And(value, x);
+    chain.push_back(value.node());
+  }
+  XLS_ASSERT_OK(fb.Build().status());
+
+  // By default inline expressions are arbitrarily deep.
+  InliningCostModel default_model(InliningOptions::Default());
+  for (Node* node : chain) {
+    EXPECT_FALSE(default_model.ShouldEmitAsAssignment(node, /*fanout=*/1,
+                                                      /*must_name=*/false));
+  }
+
+  // Every fifth node is named to keep expressions at most four deep.
+  InliningCostModel readable_model(InliningOptions::Readability());
+  for (int64_t i = 0; i < chain.size(); ++i) {
+    EXPECT_EQ(readable_model.ShouldEmitAsAssignment(chain[i], /*fanout=*/1,
+                                                    /*must_name=*/false),
+              i % 5 == 4)
+        << i;
+  }
+}
+
+TEST_F(InliningCostModelTest, MustNameResetsDepth) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue a = fb.Or(x, x);
+  BValue b = fb.Or(a, x);
+  BValue c = fb.Or(b, x);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  InliningOptions options;
+  options.max_inline_depth = 1;
+  InliningCostModel model(options);
+  EXPECT_FALSE(model.ShouldEmitAsAssignment(a.node(), 1, false));
+  EXPECT_TRUE(model.ShouldEmitAsAssignment(b.node(), 1, true));
+  EXPECT_FALSE(model.ShouldEmitAsAssignment(c.node(), 1, false));
+}
+
+TEST_F(InliningCostModelTest, MultipleUses) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue wide = fb.Param("wide", p->GetBitsType(1024));
+  BValue narrow_add = fb.Add(x, x);
+  BValue narrow_not = fb.Not(x);
+  BValue wide_add = fb.Add(wide, wide);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  // By default only terse expressions are inlined into multiple uses.
+  InliningCostModel default_model(InliningOptions::Default());
+  EXPECT_TRUE(
+      default_model.ShouldEmitAsAssignment(narrow_add.node(), 2, false));
+  EXPECT_FALSE(default_model.ShouldEmitAsAssignment(narrow_not.node(), 2,
+                                                    false));
+  EXPECT_TRUE(default_model.ShouldEmitAsAssignment(wide_add.node(), 2, false));
+
+  // Optimizing for simulation speed inlines small narrow expressions.
+  InliningCostModel fast_model(InliningOptions::SimulationSpeed());
+  EXPECT_FALSE(fast_model.ShouldEmitAsAssignment(narrow_add.node(), 2, false));
+  EXPECT_TRUE(fast_model.ShouldEmitAsAssignment(narrow_add.node(), 20, false));
+  EXPECT_TRUE(fast_model.ShouldEmitAsAssignment(wide_add.node(), 2, false));
+}
+
+TEST_F(InliningCostModelTest, FromString) {
+  XLS_ASSERT_OK_AND_ASSIGN(InliningOptions options,
+                           InliningOptionsFromString("simulation_speed"));
+  EXPECT_EQ(options.max_inline_depth,
+            InliningOptions::SimulationSpeed().max_inline_depth);
+  EXPECT_EQ(options.max_duplicated_cost,
+            InliningOptions::SimulationSpeed().max_duplicated_cost);
+  EXPECT_THAT(InliningOptionsFromString("fastest"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
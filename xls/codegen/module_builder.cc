@@ -14,6 +14,7 @@
 
 #include "xls/codegen/module_builder.h"
 
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
@@ -197,6 +198,41 @@ ModuleBuilder::ModuleBuilder(absl::string_view name, VerilogFile* file,
   }
 }
 
+ModuleBuilder::ModuleBuilder(ModuleBuilder* parent,
+                             ModuleSection* declarations,
+                             ModuleSection* assignments)
+    : module_name_(parent->module_name_),
+      file_(parent->file_),
+      package_("__ModuleBuilder_type_generator"),
+      use_system_verilog_(parent->use_system_verilog_),
+      clk_(parent->clk_),
+      rst_(parent->rst_),
+      module_(parent->module_),
+      functions_section_(parent->functions_section_),
+      constants_section_(parent->constants_section_),
+      input_section_(parent->input_section_),
+      declaration_and_assignment_section_(
+          parent->declaration_and_assignment_section_),
+      declaration_subsections_({declarations}),
+      assignment_subsections_({assignments}),
+      assert_section_(parent->assert_section_),
+      output_section_(parent->output_section_),
+      parent_(parent) {}
+
+std::unique_ptr<ModuleBuilder> ModuleBuilder::CreateSectionBuilder(
+    ModuleSection* declarations, ModuleSection* assignments) {
+  return absl::WrapUnique(new ModuleBuilder(this, declarations, assignments));
+}
+
+absl::Status ModuleBuilder::DefineFunctions(absl::Span<Node* const> nodes) {
+  for (Node* node : nodes) {
+    if (MustEmitAsFunction(node)) {
+      XLS_RETURN_IF_ERROR(DefineFunction(node).status());
+    }
+  }
+  return absl::OkStatus();
+}
+
 void ModuleBuilder::NewDeclarationAndAssignmentSections() {
   declaration_subsections_.push_back(
       declaration_and_assignment_section_->Add<ModuleSection>());
@@ -848,12 +884,14 @@ absl::StatusOr<ModuleBuilder::Register> ModuleBuilder::DeclareRegister(
 }
 
 absl::Status ModuleBuilder::AssignRegisters(
-    absl::Span<const Register> registers, Expression* load_enable) {
+    absl::Span<const Register> registers, Expression* load_enable,
+    LogicRef* clock) {
   XLS_RET_CHECK(clk_ != nullptr);
 
   // Construct an always_ff block.
   std::vector<SensitivityListElement> sensitivity_list;
-  sensitivity_list.push_back(file_->Make<PosEdge>(clk_));
+  sensitivity_list.push_back(
+      file_->Make<PosEdge>(clock == nullptr ? clk_ : clock));
   if (rst_.has_value()) {
     if (rst_->asynchronous) {
       if (rst_->active_low) {
@@ -1084,6 +1122,10 @@ VerilogFunction* DefineUmulFunction(Node* node, absl::string_view function_name,
 }  // namespace
 
 absl::StatusOr<VerilogFunction*> ModuleBuilder::DefineFunction(Node* node) {
+  if (parent_ != nullptr) {
+    absl::MutexLock lock(&parent_->functions_mutex_);
+    return parent_->DefineFunction(node);
+  }
   std::string function_name = VerilogFunctionName(node);
   if (node_functions_.contains(function_name)) {
     return node_functions_.at(function_name);
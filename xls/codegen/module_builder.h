@@ -15,12 +15,14 @@
 #ifndef XLS_CODEGEN_MODULE_BUILDER_H_
 #define XLS_CODEGEN_MODULE_BUILDER_H_
 
+#include <memory>
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "xls/codegen/vast.h"
 #include "xls/ir/node.h"
@@ -158,8 +160,11 @@ class ModuleBuilder {
   //   load_enable: Optional load enable signal. The register is loaded only if
   //     this signal is asserted.
   //   rst: Optional reset signal.
+  //   clock: Optional clock of the registers, e.g., a gated clock. If null,
+  //     the registers use the module clock.
   absl::Status AssignRegisters(absl::Span<const Register> registers,
-                               Expression* load_enable = nullptr);
+                               Expression* load_enable = nullptr,
+                               LogicRef* clock = nullptr);
 
   // For organization (not functionality) the module is divided into several
   // sections. The emitted module has the following structure:
@@ -206,6 +211,21 @@ class ModuleBuilder {
   ModuleSection* assert_section() const { return assert_section_; }
   ModuleSection* output_section() const { return output_section_; }
 
+  // Defines the Verilog functions required to emit the given nodes in order.
+  // Defining them up front keeps the order of the functions in the module
+  // deterministic when the nodes are later emitted concurrently through
+  // section builders.
+  absl::Status DefineFunctions(absl::Span<Node* const> nodes);
+
+  // Returns a builder which emits declarations and assignments into the given
+  // sections of this module rather than the current ones. The returned builder
+  // shares the ports, clock, reset and functions of this builder and must not
+  // add ports or sections. Section builders for distinct sections may be used
+  // concurrently from different threads as long as this builder is not used
+  // in the meantime.
+  std::unique_ptr<ModuleBuilder> CreateSectionBuilder(
+      ModuleSection* declarations, ModuleSection* assignments);
+
   // Return clock signal. Is null if the module does not have a clock.
   LogicRef* clock() const { return clk_; }
 
@@ -213,6 +233,10 @@ class ModuleBuilder {
   const absl::optional<Reset>& reset() const { return rst_; }
 
  private:
+  // Constructor for section builders (see CreateSectionBuilder).
+  ModuleBuilder(ModuleBuilder* parent, ModuleSection* declarations,
+                ModuleSection* assignments);
+
   // Assigns 'rhs' to 'lhs'. Depending upon the type this may require multiple
   // assignment statements (e.g., for array assignments in Verilog). The
   // function add_assignment should add a single assignment
@@ -328,6 +352,11 @@ class ModuleBuilder {
   // Verilog functions defined inside the module. Map is indexed by the function
   // name.
   absl::flat_hash_map<std::string, VerilogFunction*> node_functions_;
+
+  // The builder this section builder was created from, if any. Functions are
+  // defined by the parent under 'functions_mutex_' of the parent.
+  ModuleBuilder* parent_ = nullptr;
+  absl::Mutex functions_mutex_;
 };
 
 }  // namespace verilog
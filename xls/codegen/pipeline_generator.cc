@@ -15,6 +15,8 @@
 #include "xls/codegen/pipeline_generator.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 #include "absl/algorithm/container.h"
 #include "absl/status/statusor.h"
@@ -22,16 +24,21 @@
 #include "absl/strings/str_format.h"
 #include "xls/codegen/finite_state_machine.h"
 #include "xls/codegen/flattening.h"
+#include "xls/codegen/inlining_cost_model.h"
 #include "xls/codegen/module_builder.h"
 #include "xls/codegen/node_expressions.h"
 #include "xls/common/logging/log_lines.h"
 #include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/common/trace.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/node_iterator.h"
 #include "xls/ir/package.h"
+#include "xls/scheduling/modulo_scheduler.h"
 #include "xls/scheduling/pipeline_schedule.h"
 
 namespace xls {
@@ -83,6 +90,31 @@ absl::optional<ValidProto> PipelineOptions::valid_control() const {
   return pipeline_control_->valid();
 }
 
+PipelineOptions& PipelineOptions::ready_valid_control(
+    absl::string_view input_valid_name, absl::string_view input_ready_name,
+    absl::string_view output_valid_name, absl::string_view output_ready_name,
+    bool skid_buffers) {
+  if (!pipeline_control_.has_value()) {
+    pipeline_control_ = PipelineControl();
+  }
+  ReadyValidPipelineControl* ready_valid =
+      pipeline_control_->mutable_ready_valid();
+  ready_valid->set_input_valid_name(ToProtoString(input_valid_name));
+  ready_valid->set_input_ready_name(ToProtoString(input_ready_name));
+  ready_valid->set_output_valid_name(ToProtoString(output_valid_name));
+  ready_valid->set_output_ready_name(ToProtoString(output_ready_name));
+  ready_valid->set_skid_buffers(skid_buffers);
+  return *this;
+}
+
+absl::optional<ReadyValidPipelineControl>
+PipelineOptions::ready_valid_control() const {
+  if (!pipeline_control_.has_value() || !pipeline_control_->has_ready_valid()) {
+    return absl::nullopt;
+  }
+  return pipeline_control_->ready_valid();
+}
+
 PipelineOptions& PipelineOptions::use_system_verilog(bool value) {
   use_system_verilog_ = value;
   return *this;
@@ -123,6 +155,9 @@ class PipelineGenerator {
 
     LogicRef* valid_load_enable = nullptr;
     LogicRef* manual_load_enable = nullptr;
+    absl::optional<ReadyValidFlow> flow;
+    LogicRef* input_ready = nullptr;
+    bool skid_buffers = false;
     if (options_.control().has_value()) {
       if (options_.control()->has_valid()) {
         const ValidProto& valid_proto = options_.control()->valid();
@@ -155,12 +190,74 @@ class PipelineGenerator {
         }
         manual_load_enable = mb_->AddInputPort(manual.input_name(),
                                                /*bit_count=*/reg_count);
+      } else if (options_.control()->has_ready_valid()) {
+        const ReadyValidPipelineControl& ready_valid =
+            options_.control()->ready_valid();
+        if (ready_valid.input_valid_name().empty() ||
+            ready_valid.input_ready_name().empty() ||
+            ready_valid.output_valid_name().empty() ||
+            ready_valid.output_ready_name().empty()) {
+          return absl::InvalidArgumentError(
+              "Must specify all flow control signal names with ready/valid "
+              "pipeline register control");
+        }
+        if (!mb_->reset().has_value()) {
+          return absl::InvalidArgumentError(
+              "Ready/valid pipeline register control requires a reset signal");
+        }
+        if (schedule_.initiation_interval() > 1) {
+          return absl::UnimplementedError(
+              "Ready/valid pipeline register control is not supported with an "
+              "initiation interval greater than one");
+        }
+        input_ready = mb_->DeclareVariable("p0_ready", /*bit_count=*/1);
+        flow = ReadyValidFlow{
+            input_ready, mb_->AddInputPort(ready_valid.input_valid_name(),
+                                           /*bit_count=*/1)};
+        skid_buffers = ready_valid.skid_buffers();
       }
     }
 
+    // With an initiation interval greater than one, the stages of the pipeline
+    // are active in turn as tracked by a phase counter, and the registers of a
+    // stage are only loaded when it is active.
+    LogicRef* phase = nullptr;
+    if (schedule_.initiation_interval() > 1) {
+      if (!mb_->reset().has_value()) {
+        return absl::InvalidArgumentError(
+            "A pipeline with an initiation interval greater than one requires "
+            "a reset signal");
+      }
+      if (!options_.flop_outputs()) {
+        // Shared operators in the last stage only compute its outputs in the
+        // cycles in which it is active.
+        return absl::InvalidArgumentError(
+            "A pipeline with an initiation interval greater than one requires "
+            "flopped outputs");
+      }
+      if (manual_load_enable != nullptr) {
+        return absl::UnimplementedError(
+            "Manual pipeline control is not supported with an initiation "
+            "interval greater than one");
+      }
+      XLS_ASSIGN_OR_RETURN(phase, AddPhaseCounter());
+    }
+
+    if (options_.clock_gate_cell().has_value() &&
+        !options_.control().has_value()) {
+      return absl::InvalidArgumentError(
+          "Clock gating of pipeline registers requires pipeline register "
+          "control");
+    }
+
     // Returns the load enable signal for the pipeline registers at the end of
-    // the given stage.
-    auto get_load_enable = [&](int64_t stage) -> Expression* {
+    // the given stage, not accounting for the phase of the pipeline.
+    auto get_control_load_enable = [&](int64_t stage) -> Expression* {
+      if (flow.has_value()) {
+        // Valid data is loaded into a register stage of a ready/valid pipeline
+        // when the stage can accept it.
+        return file_->LogicalAnd(flow->valid, flow->ready);
+      }
       if (valid_load_enable != nullptr) {
         // 'valid_load_enable' is updated to the latest flopped value in each
         // iteration of the loop. If the pipeline has a reset signal, OR in the
@@ -182,6 +279,24 @@ class PipelineGenerator {
       return nullptr;
     };
 
+    // Returns the load enable signal for the pipeline registers at the end of
+    // the given stage.
+    auto get_load_enable = [&](int64_t stage) -> Expression* {
+      Expression* load_enable = get_control_load_enable(stage);
+      if (phase == nullptr) {
+        return load_enable;
+      }
+      Expression* active = StageIsActive(phase, stage);
+      return load_enable == nullptr ? active
+                                    : file_->LogicalAnd(load_enable, active);
+    };
+
+    // Returns the load enable signal for the valid register at the end of the
+    // given stage.
+    auto get_valid_load_enable = [&](int64_t stage) -> Expression* {
+      return phase == nullptr ? nullptr : StageIsActive(phase, stage);
+    };
+
     // Map containing the VAST expression for each node. Values may be updated
     // as the pipeline is emitted. For example, a nodes value may be held in a
     // combinational expression, or a pipeline register depending upon the point
@@ -213,6 +328,19 @@ class PipelineGenerator {
         module_constants.insert(node);
       }
     }
+
+    // Operations in stages which differ modulo the initiation interval are
+    // never active at the same time so they share operator instances.
+    std::vector<SharedOperator> shared_operators;
+    absl::flat_hash_map<Node*, SharedOperator*> node_shared_operator;
+    if (schedule_.initiation_interval() > 1) {
+      shared_operators = BindSharedOperators();
+      for (SharedOperator& shared_operator : shared_operators) {
+        for (Node* node : shared_operator.nodes) {
+          node_shared_operator[node] = &shared_operator;
+        }
+      }
+    }
     // The set of nodes which are live out of the previous stage.
     std::vector<Node*> live_out_last_stage;
 
@@ -229,20 +357,52 @@ class PipelineGenerator {
         mb_->declaration_section()->Add<BlankLine>();
         mb_->declaration_section()->Add<Comment>(
             absl::StrFormat("===== Pipe stage %d:", stage));
-        XLS_ASSIGN_OR_RETURN(
-            std::vector<Expression*> register_refs,
-            AddPipelineRegisters(assignments, stage, get_load_enable(stage)));
-        for (int64_t i = 0; i < assignments.size(); ++i) {
-          node_expressions[assignments[i].first] = register_refs[i];
+        if (skid_buffers) {
+          XLS_RETURN_IF_ERROR(AddSkidBufferStage(assignments, stage, &*flow,
+                                                 &node_expressions));
+        } else {
+          XLS_ASSIGN_OR_RETURN(
+              std::vector<Expression*> register_refs,
+              AddPipelineRegisters(assignments, stage, get_load_enable(stage)));
+          for (int64_t i = 0; i < assignments.size(); ++i) {
+            node_expressions[assignments[i].first] = register_refs[i];
+          }
         }
         if (valid_load_enable != nullptr) {
           XLS_ASSIGN_OR_RETURN(valid_load_enable,
-                               AddValidRegister(valid_load_enable, stage));
+                               AddValidRegister(valid_load_enable, stage,
+                                                get_valid_load_enable(stage)));
+        } else if (flow.has_value() && !skid_buffers) {
+          XLS_RETURN_IF_ERROR(AddReadyValidControl(stage, &*flow));
         }
         stage++;
       }
     }
 
+    // With parallel stage emission, the combinational logic of each stage and
+    // the assignment of the registers at its end are deferred until the
+    // structure of the pipeline is built, and then emitted concurrently into
+    // the sections reserved for them. The emitted module is identical to the
+    // one emitted sequentially. Skid buffers select among the stage outputs
+    // as they are declared so they are emitted sequentially.
+    const bool emit_stages_in_parallel =
+        options_.stage_emission_threads() > 1 && shared_operators.empty() &&
+        !skid_buffers;
+    std::vector<DeferredStage> deferred_stages;
+    if (emit_stages_in_parallel) {
+      std::vector<Node*> nodes_in_order;
+      for (int64_t schedule_cycle = 0; schedule_cycle < schedule_.length();
+           ++schedule_cycle) {
+        for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
+          if (!node->Is<Param>() && !module_constants.contains(node) &&
+              node->GetType()->GetFlatBitCount() > 0) {
+            nodes_in_order.push_back(node);
+          }
+        }
+      }
+      XLS_RETURN_IF_ERROR(mb_->DefineFunctions(nodes_in_order));
+    }
+
     // Construct the stages defined by the schedule.
     for (int64_t schedule_cycle = 0; schedule_cycle < schedule_.length();
          ++schedule_cycle) {
@@ -255,73 +415,35 @@ class PipelineGenerator {
       mb_->declaration_section()->Add<Comment>(
           absl::StrFormat("===== Pipe stage %d:", stage));
 
-      // Returns whether the given node is live out of this stage.
-      auto is_live_out_of_stage = [&](Node* node) {
-        if (module_constants.contains(node)) {
-          return false;
-        }
-        if (node == func_->return_value()) {
-          return true;
-        }
-        for (Node* user : node->users()) {
-          if (schedule_.cycle(user) > schedule_cycle) {
-            return true;
+      DeferredStage* deferred_stage = nullptr;
+      if (emit_stages_in_parallel) {
+        deferred_stages.push_back(DeferredStage());
+        deferred_stage = &deferred_stages.back();
+        deferred_stage->stage = stage;
+        deferred_stage->schedule_cycle = schedule_cycle;
+        deferred_stage->logic_builder = mb_->CreateSectionBuilder(
+            mb_->declaration_section(), mb_->assignment_section());
+        // Capture the expressions available to the stage: its live-in values,
+        // the parameters and the module constants.
+        auto capture = [&](Node* node) {
+          auto it = node_expressions.find(node);
+          if (it != node_expressions.end()) {
+            deferred_stage->node_expressions.insert(*it);
           }
+        };
+        for (Node* node : live_out_last_stage) {
+          capture(node);
         }
-        return false;
-      };
-
-      // Identify nodes in this stage which should be named temporaries.
-      // Conditions:
-      //
-      //   (0) Is not a module constant or parameter, AND one of the following
-      //       is true:
-      //
-      //   (1) Is array-shaped, OR
-      //
-      //   (2) Has multiple in-stage uses and is not trivially inlinable (e.g.,
-      //       unary negation), OR
-      //
-      //   (3) Has an in-stage use that needs a named reference, OR
-      //
-      //   (4) Is live out of the stage, OR
-      //
-      //   (5) Has an assigned name. This preserves names in the generated
-      //       Verilog.
-      absl::flat_hash_set<Node*> named_temps;
-      for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
-        if (node->Is<Param>() || module_constants.contains(node)) {
-          continue;
-        }
-        if (!mb_->CanEmitAsInlineExpression(node, UsersInStage(node)) ||
-            (FanoutInStage(node, schedule_cycle) > 1 &&
-             !ShouldInlineExpressionIntoMultipleUses(node)) ||
-            is_live_out_of_stage(node) || node->HasAssignedName()) {
-          named_temps.insert(node);
-        }
-      }
-
-      // Emit expressions/assignments for every node in this stage.
-      for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
-        if (node->Is<Param>() || module_constants.contains(node) ||
-            node->GetType()->GetFlatBitCount() == 0) {
-          continue;
-        }
-
-        std::vector<Expression*> inputs;
-        for (Node* operand : node->operands()) {
-          inputs.push_back(node_expressions.at(operand));
-        }
-
-        if (named_temps.contains(node)) {
-          XLS_ASSIGN_OR_RETURN(
-              node_expressions[node],
-              mb_->EmitAsAssignment(PipelineSignalName(node, stage) + "_comb",
-                                    node, inputs));
-        } else {
-          XLS_ASSIGN_OR_RETURN(node_expressions[node],
-                               mb_->EmitAsInlineExpression(node, inputs));
+        for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
+          capture(node);
+          for (Node* operand : node->operands()) {
+            capture(operand);
+          }
         }
+      } else {
+        XLS_RETURN_IF_ERROR(EmitStageLogic(
+            mb_.get(), stage, schedule_cycle, module_constants,
+            node_shared_operator, &node_expressions));
       }
 
       // Generate the set of pipeline registers at the end of this stage. These
@@ -329,12 +451,13 @@ class PipelineGenerator {
       // scheduled in earlier stages.
       std::vector<Node*> live_out_nodes;
       for (Node* node : live_out_last_stage) {
-        if (is_live_out_of_stage(node)) {
+        if (IsLiveOutOfStage(node, schedule_cycle, module_constants)) {
           live_out_nodes.push_back(node);
         }
       }
       for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
-        if (!module_constants.contains(node) && is_live_out_of_stage(node)) {
+        if (!module_constants.contains(node) &&
+            IsLiveOutOfStage(node, schedule_cycle, module_constants)) {
           live_out_nodes.push_back(node);
         }
       }
@@ -346,21 +469,51 @@ class PipelineGenerator {
         break;
       }
 
-      if (!live_out_nodes.empty() &&
-          (options_.flop_outputs() ||
-           schedule_cycle != schedule_.length() - 1)) {
+      if (skid_buffers) {
+        std::vector<std::pair<Node*, Expression*>> assignments;
+        for (Node* node : live_out_nodes) {
+          if (node->GetType()->GetFlatBitCount() > 0) {
+            assignments.push_back({node, node_expressions.at(node)});
+          }
+        }
+        XLS_RETURN_IF_ERROR(AddSkidBufferStage(assignments, stage, &*flow,
+                                               &node_expressions));
+      } else if (!live_out_nodes.empty() &&
+                 (options_.flop_outputs() ||
+                  schedule_cycle != schedule_.length() - 1)) {
         // Add always flop block for the registers.
         mb_->NewDeclarationAndAssignmentSections();
 
         std::vector<std::pair<Node*, Expression*>> assignments;
         for (Node* node : live_out_nodes) {
           if (node->GetType()->GetFlatBitCount() > 0) {
-            assignments.push_back({node, node_expressions.at(node)});
+            // The expressions of deferred stages are filled in once emitted.
+            assignments.push_back(
+                {node, deferred_stage == nullptr ? node_expressions.at(node)
+                                                 : nullptr});
+          }
+        }
+        std::vector<Expression*> register_refs;
+        if (deferred_stage == nullptr) {
+          XLS_ASSIGN_OR_RETURN(
+              register_refs,
+              AddPipelineRegisters(assignments, stage, get_load_enable(stage)));
+        } else {
+          XLS_ASSIGN_OR_RETURN(deferred_stage->registers,
+                               DeclarePipelineRegisters(assignments, stage));
+          deferred_stage->load_enable = get_load_enable(stage);
+          if (!deferred_stage->registers.empty()) {
+            XLS_ASSIGN_OR_RETURN(
+                deferred_stage->clock,
+                MaybeAddClockGate(stage, deferred_stage->load_enable));
+          }
+          deferred_stage->register_builder = mb_->CreateSectionBuilder(
+              mb_->declaration_section(), mb_->assignment_section());
+          for (int64_t i = 0; i < assignments.size(); ++i) {
+            deferred_stage->register_nodes.push_back(assignments[i].first);
+            register_refs.push_back(deferred_stage->registers[i].ref);
           }
         }
-        XLS_ASSIGN_OR_RETURN(
-            std::vector<Expression*> register_refs,
-            AddPipelineRegisters(assignments, stage, get_load_enable(stage)));
         for (int64_t i = 0; i < assignments.size(); ++i) {
           node_expressions[assignments[i].first] = register_refs[i];
         }
@@ -368,13 +521,37 @@ class PipelineGenerator {
 
       if (valid_load_enable != nullptr) {
         XLS_ASSIGN_OR_RETURN(valid_load_enable,
-                             AddValidRegister(valid_load_enable, stage));
+                             AddValidRegister(valid_load_enable, stage,
+                                              get_valid_load_enable(stage)));
+      } else if (flow.has_value() && !skid_buffers) {
+        XLS_RETURN_IF_ERROR(AddReadyValidControl(stage, &*flow));
       }
 
       live_out_last_stage = std::move(live_out_nodes);
       stage++;
     }
 
+    if (emit_stages_in_parallel) {
+      XLS_RETURN_IF_ERROR(EmitDeferredStages(absl::MakeSpan(deferred_stages),
+                                             module_constants));
+      // Without flopped outputs the output is computed by the last stage.
+      Node* return_value = func_->return_value();
+      auto it = deferred_stages.back().node_expressions.find(return_value);
+      if (!options_.flop_outputs() &&
+          it != deferred_stages.back().node_expressions.end()) {
+        node_expressions[return_value] = it->second;
+      }
+    }
+
+    if (!shared_operators.empty()) {
+      mb_->NewDeclarationAndAssignmentSections();
+      mb_->declaration_section()->Add<BlankLine>();
+      mb_->declaration_section()->Add<Comment>("===== Shared operators:");
+      for (const SharedOperator& shared_operator : shared_operators) {
+        XLS_RETURN_IF_ERROR(AssignSharedOperator(shared_operator, phase));
+      }
+    }
+
     if (valid_load_enable != nullptr) {
       XLS_CHECK(options_.control().has_value());
       if (!options_.control()->valid().output_name().empty()) {
@@ -384,6 +561,22 @@ class PipelineGenerator {
       }
     }
 
+    if (flow.has_value()) {
+      // The last register stage, or the inputs if there are no registers, feed
+      // the outputs, so they can move on when the consumer of the outputs is
+      // ready.
+      const ReadyValidPipelineControl& ready_valid =
+          options_.control()->ready_valid();
+      LogicRef* output_ready =
+          mb_->AddInputPort(ready_valid.output_ready_name(), /*bit_count=*/1);
+      XLS_RETURN_IF_ERROR(mb_->Assign(flow->ready, output_ready,
+                                      func_->package()->GetBitsType(1)));
+      XLS_RETURN_IF_ERROR(mb_->AddOutputPort(ready_valid.input_ready_name(),
+                                             /*bit_count=*/1, input_ready));
+      XLS_RETURN_IF_ERROR(mb_->AddOutputPort(ready_valid.output_valid_name(),
+                                             /*bit_count=*/1, flow->valid));
+    }
+
     // Assign the output wire to the pipeline-registered output value.
     if (func_->return_value()->GetType()->GetFlatBitCount() > 0) {
       if (options_.split_outputs() &&
@@ -407,7 +600,12 @@ class PipelineGenerator {
       }
     }
 
-    std::string text = file_->Emit();
+    std::string text;
+    if (options_.verilog_sink() != nullptr) {
+      file_->EmitTo(options_.verilog_sink());
+    } else {
+      text = file_->Emit();
+    }
     XLS_ASSIGN_OR_RETURN(ModuleSignature signature,
                          BuildSignature(/*latency=*/stage));
     return ModuleGeneratorResult{text, signature};
@@ -436,7 +634,8 @@ class PipelineGenerator {
     sig_builder.WithFunctionType(func_->GetType());
     sig_builder.WithPipelineInterface(
         /*latency=*/latency,
-        /*initiation_interval=*/1, options_.control());
+        /*initiation_interval=*/schedule_.initiation_interval(),
+        options_.control());
 
     if (options_.reset().has_value()) {
       sig_builder.WithReset(options_.reset()->name(),
@@ -446,6 +645,298 @@ class PipelineGenerator {
     return sig_builder.Build();
   }
 
+  // An operator instance which computes several nodes of the function, each in
+  // the cycles in which the stage of the node is active.
+  struct SharedOperator {
+    // The nodes computed by the operator, which have identical types.
+    std::vector<Node*> nodes;
+    // The wire holding the result of the operator.
+    LogicRef* result;
+    // The pipeline stage and operand expressions of each node, in the order
+    // they are emitted.
+    std::vector<int64_t> stages;
+    std::vector<std::vector<Expression*>> inputs;
+  };
+
+  // A pipeline stage whose combinational logic and register assignments are
+  // emitted after the structure of the pipeline is built.
+  struct DeferredStage {
+    int64_t stage;
+    int64_t schedule_cycle;
+    // Builder emitting into the sections of the stage logic.
+    std::unique_ptr<ModuleBuilder> logic_builder;
+    // The expressions for the nodes available to the stage. Filled in with the
+    // expressions of the nodes of the stage as they are emitted.
+    absl::flat_hash_map<Node*, Expression*> node_expressions;
+    // Builder emitting into the sections of the registers at the end of the
+    // stage, if any, and the declared registers holding 'register_nodes'.
+    std::unique_ptr<ModuleBuilder> register_builder;
+    std::vector<ModuleBuilder::Register> registers;
+    std::vector<Node*> register_nodes;
+    Expression* load_enable = nullptr;
+    // The gated clock of the registers, if any.
+    LogicRef* clock = nullptr;
+  };
+
+  // The flow control signals at the input of the register stage being built in
+  // a ready/valid pipeline.
+  struct ReadyValidFlow {
+    // Wire asserted when the register stage can accept data, assigned once the
+    // stage is built.
+    LogicRef* ready;
+    // Whether the data entering the register stage is valid.
+    LogicRef* valid;
+  };
+
+  // Returns whether the given node is live out of the given stage.
+  bool IsLiveOutOfStage(Node* node, int64_t schedule_cycle,
+                        const absl::flat_hash_set<Node*>& module_constants) {
+    if (module_constants.contains(node)) {
+      return false;
+    }
+    if (node == func_->return_value()) {
+      return true;
+    }
+    for (Node* user : node->users()) {
+      if (schedule_.cycle(user) > schedule_cycle) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Emits the expressions and assignments for the nodes of the given stage
+  // using the given module builder. 'node_expressions' holds the expressions
+  // of the values available to the stage and is updated with the expressions
+  // of the nodes of the stage.
+  absl::Status EmitStageLogic(
+      ModuleBuilder* mb, int64_t stage, int64_t schedule_cycle,
+      const absl::flat_hash_set<Node*>& module_constants,
+      const absl::flat_hash_map<Node*, SharedOperator*>& node_shared_operator,
+      absl::flat_hash_map<Node*, Expression*>* node_expressions) {
+    // Identify nodes in this stage which should be named temporaries.
+    // Conditions:
+    //
+    //   (0) Is not a module constant or parameter, AND one of the following
+    //       is true:
+    //
+    //   (1) Is array-shaped, OR
+    //
+    //   (2) Has an in-stage use that needs a named reference, OR
+    //
+    //   (3) Is live out of the stage, OR
+    //
+    //   (4) Has an assigned name. This preserves names in the generated
+    //       Verilog, OR
+    //
+    //   (5) Is chosen by the inlining cost model given its fanout and the
+    //       depth and size of its inline expression. By default these are
+    //       nodes with multiple in-stage uses which are not trivially
+    //       inlinable (e.g., unary negation).
+    absl::flat_hash_set<Node*> named_temps;
+    InliningCostModel cost_model(options_.inlining());
+    for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
+      if (node->Is<Param>() || module_constants.contains(node)) {
+        continue;
+      }
+      bool must_name =
+          !mb->CanEmitAsInlineExpression(node, UsersInStage(node)) ||
+          IsLiveOutOfStage(node, schedule_cycle, module_constants) ||
+          node->HasAssignedName();
+      if (cost_model.ShouldEmitAsAssignment(
+              node, FanoutInStage(node, schedule_cycle), must_name)) {
+        named_temps.insert(node);
+      }
+    }
+
+    // Emit expressions/assignments for every node in this stage.
+    for (Node* node : schedule_.nodes_in_cycle(schedule_cycle)) {
+      if (node->Is<Param>() || module_constants.contains(node) ||
+          node->GetType()->GetFlatBitCount() == 0) {
+        continue;
+      }
+
+      std::vector<Expression*> inputs;
+      for (Node* operand : node->operands()) {
+        inputs.push_back(node_expressions->at(operand));
+      }
+
+      auto shared_it = node_shared_operator.find(node);
+      if (shared_it != node_shared_operator.end()) {
+        // The node is computed by the shared operator from these inputs in
+        // the cycles in which this stage is active.
+        SharedOperator* shared_operator = shared_it->second;
+        shared_operator->inputs.push_back(inputs);
+        shared_operator->stages.push_back(stage);
+        (*node_expressions)[node] = shared_operator->result;
+        continue;
+      }
+
+      if (named_temps.contains(node)) {
+        XLS_ASSIGN_OR_RETURN(
+            (*node_expressions)[node],
+            mb->EmitAsAssignment(PipelineSignalName(node, stage) + "_comb",
+                                 node, inputs));
+      } else {
+        XLS_ASSIGN_OR_RETURN((*node_expressions)[node],
+                             mb->EmitAsInlineExpression(node, inputs));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Emits the logic and register assignments of the given deferred stages
+  // concurrently. Each stage only adds to its own sections of the module.
+  absl::Status EmitDeferredStages(
+      absl::Span<DeferredStage> deferred_stages,
+      const absl::flat_hash_set<Node*>& module_constants) {
+    const absl::flat_hash_map<Node*, SharedOperator*> no_shared_operators;
+    std::vector<absl::Status> statuses(deferred_stages.size());
+    auto emit_stage = [&](int64_t i) -> absl::Status {
+      DeferredStage& deferred_stage = deferred_stages[i];
+      XLS_RETURN_IF_ERROR(EmitStageLogic(
+          deferred_stage.logic_builder.get(), deferred_stage.stage,
+          deferred_stage.schedule_cycle, module_constants, no_shared_operators,
+          &deferred_stage.node_expressions));
+      if (deferred_stage.register_builder == nullptr) {
+        return absl::OkStatus();
+      }
+      for (int64_t j = 0; j < deferred_stage.registers.size(); ++j) {
+        deferred_stage.registers[j].next = deferred_stage.node_expressions.at(
+            deferred_stage.register_nodes[j]);
+      }
+      return deferred_stage.register_builder->AssignRegisters(
+          deferred_stage.registers, deferred_stage.load_enable,
+          deferred_stage.clock);
+    };
+
+    std::atomic<int64_t> next_stage(0);
+    std::vector<std::unique_ptr<Thread>> threads;
+    int64_t thread_count =
+        std::min(options_.stage_emission_threads(),
+                 static_cast<int64_t>(deferred_stages.size()));
+    for (int64_t t = 0; t < thread_count; ++t) {
+      threads.push_back(std::make_unique<Thread>([&]() {
+        for (int64_t i = next_stage++; i < deferred_stages.size();
+             i = next_stage++) {
+          statuses[i] = emit_stage(i);
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+    for (const absl::Status& status : statuses) {
+      XLS_RETURN_IF_ERROR(status);
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the operator instances shared among the shareable nodes of the
+  // function and declares their result wires. Nodes with the same operator
+  // key share an instance if their cycles differ modulo the initiation
+  // interval, so the number of instances for each key is the largest number of
+  // its nodes in cycles congruent modulo the initiation interval.
+  std::vector<SharedOperator> BindSharedOperators() {
+    const int64_t initiation_interval = schedule_.initiation_interval();
+    // For each operator key, the nodes in each slot of the modulo reservation
+    // table.
+    std::vector<std::string> keys;
+    absl::flat_hash_map<std::string, std::vector<std::vector<Node*>>> slots;
+    for (Node* node : TopoSort(func_)) {
+      if (!sched::IsShareableOp(node->op()) ||
+          node->GetType()->GetFlatBitCount() == 0) {
+        continue;
+      }
+      std::string key = sched::SharedOperatorKey(node);
+      auto [it, inserted] = slots.insert({key, {}});
+      if (inserted) {
+        keys.push_back(key);
+        it->second.resize(initiation_interval);
+      }
+      it->second[schedule_.cycle(node) % initiation_interval].push_back(node);
+    }
+
+    std::vector<SharedOperator> shared_operators;
+    for (const std::string& key : keys) {
+      const std::vector<std::vector<Node*>>& key_slots = slots.at(key);
+      int64_t instance_count = 0;
+      for (const std::vector<Node*>& slot_nodes : key_slots) {
+        instance_count =
+            std::max(instance_count, static_cast<int64_t>(slot_nodes.size()));
+      }
+      for (int64_t i = 0; i < instance_count; ++i) {
+        SharedOperator shared_operator;
+        for (const std::vector<Node*>& slot_nodes : key_slots) {
+          if (i < slot_nodes.size()) {
+            shared_operator.nodes.push_back(slot_nodes[i]);
+          }
+        }
+        if (shared_operator.nodes.size() < 2) {
+          continue;
+        }
+        Node* node = shared_operator.nodes.front();
+        shared_operator.result = mb_->DeclareVariable(
+            absl::StrFormat("shared_%s_%d", OpToString(node->op()),
+                            shared_operators.size()),
+            node->GetType());
+        shared_operators.push_back(std::move(shared_operator));
+      }
+    }
+    return shared_operators;
+  }
+
+  int64_t PhaseCounterWidth() const {
+    return std::max(int64_t{1}, CeilOfLog2(schedule_.initiation_interval()));
+  }
+
+  // Adds a register counting the cycles modulo the initiation interval since
+  // reset. Stage N of the pipeline is active when the counter equals N modulo
+  // the initiation interval, so inputs are sampled when it is zero. Returns a
+  // reference to the defined register.
+  absl::StatusOr<LogicRef*> AddPhaseCounter() {
+    const int64_t initiation_interval = schedule_.initiation_interval();
+    const int64_t width = PhaseCounterWidth();
+    XLS_ASSIGN_OR_RETURN(
+        ModuleBuilder::Register phase,
+        mb_->DeclareRegister("phase", width, /*next=*/nullptr,
+                             /*reset_value=*/file_->Literal(0, width)));
+    Expression* last_phase = file_->Literal(initiation_interval - 1, width);
+    Expression* next_phase = file_->Add(phase.ref, file_->Literal(1, width));
+    phase.next = file_->Ternary(file_->Equals(phase.ref, last_phase),
+                                file_->Literal(0, width), next_phase);
+    XLS_RETURN_IF_ERROR(mb_->AssignRegisters({phase}, /*load_enable=*/nullptr));
+    return phase.ref;
+  }
+
+  // Returns whether the given stage is active in the current cycle.
+  Expression* StageIsActive(LogicRef* phase, int64_t stage) {
+    return file_->Equals(
+        phase, file_->Literal(stage % schedule_.initiation_interval(),
+                              PhaseCounterWidth()));
+  }
+
+  // Assigns the result of the shared operator, selecting the operands of the
+  // node whose stage is active in the current phase.
+  absl::Status AssignSharedOperator(const SharedOperator& shared_operator,
+                                    LogicRef* phase) {
+    XLS_RET_CHECK_EQ(shared_operator.inputs.size(),
+                     shared_operator.nodes.size());
+    Node* node = shared_operator.nodes.front();
+    std::vector<Expression*> inputs;
+    for (int64_t i = 0; i < node->operand_count(); ++i) {
+      Expression* input = shared_operator.inputs.back()[i];
+      for (int64_t j = shared_operator.inputs.size() - 2; j >= 0; --j) {
+        input = file_->Ternary(StageIsActive(phase, shared_operator.stages[j]),
+                               shared_operator.inputs[j][i], input);
+      }
+      inputs.push_back(input);
+    }
+    XLS_ASSIGN_OR_RETURN(Expression * expr,
+                         mb_->EmitAsInlineExpression(node, inputs));
+    return mb_->Assign(shared_operator.result, expr, node->GetType());
+  }
+
   // Returns number of uses of the node's value in this stage. This includes the
   // pipeline register if the node's value is used in a later stage.
   int64_t FanoutInStage(Node* node, int64_t stage) {
@@ -476,14 +967,14 @@ class PipelineGenerator {
     return users;
   }
 
-  // Adds pipeline registers to the module for the given stage. The registers to
-  // define are given as pairs of Node* and the expression to assign to the
-  // value corresponding to the node. The registers use the supplied clock and
-  // optional load enable (can be null). Returns references corresponding to the
-  // defined registers.
-  absl::StatusOr<std::vector<Expression*>> AddPipelineRegisters(
+  // Declares pipeline registers in new sections of the module for the given
+  // stage. The registers to define are given as pairs of Node* and the
+  // expression to assign to the value corresponding to the node, which may be
+  // null if set before the registers are assigned. Returns the declared
+  // registers.
+  absl::StatusOr<std::vector<ModuleBuilder::Register>> DeclarePipelineRegisters(
       absl::Span<const std::pair<Node*, Expression*>> assignments,
-      int64_t stage, Expression* load_enable) {
+      int64_t stage) {
     // Add always flop block for the registers.
     mb_->NewDeclarationAndAssignmentSections();
 
@@ -492,7 +983,6 @@ class PipelineGenerator {
         absl::StrFormat("Registers for pipe stage %d:", stage));
 
     std::vector<ModuleBuilder::Register> registers;
-    std::vector<Expression*> register_refs;
     for (const auto& pair : assignments) {
       Node* node = pair.first;
       Expression* rhs = pair.second;
@@ -507,18 +997,65 @@ class PipelineGenerator {
             mb_->DeclareRegister(PipelineSignalName(node, stage),
                                  node->GetType(), rhs));
         registers.push_back(reg);
-        register_refs.push_back(registers.back().ref);
       }
     }
-    XLS_RETURN_IF_ERROR(mb_->AssignRegisters(registers, load_enable));
+    return registers;
+  }
+
+  // Instantiates the clock gate of the registers at the end of the given stage
+  // if clock gating is enabled and the registers have a load enable. Returns
+  // the gated clock, or null if the registers use the module clock.
+  absl::StatusOr<LogicRef*> MaybeAddClockGate(int64_t stage,
+                                              Expression* load_enable) {
+    if (!options_.clock_gate_cell().has_value() || load_enable == nullptr) {
+      return nullptr;
+    }
+    const ClockGateCell& cell = options_.clock_gate_cell().value();
+    if (cell.module_name.empty()) {
+      return absl::InvalidArgumentError(
+          "Must specify the module name of the clock gate cell");
+    }
+    LogicRef* gated_clock = mb_->DeclareVariable(
+        absl::StrFormat("p%d_gated_clk", stage), /*bit_count=*/1);
+    mb_->assignment_section()->Add<Instantiation>(
+        /*module_name=*/cell.module_name,
+        /*instance_name=*/absl::StrFormat("p%d_clock_gate", stage),
+        /*parameters=*/std::vector<Connection>(),
+        /*connections=*/
+        std::vector<Connection>{{cell.clock_port, mb_->clock()},
+                                {cell.enable_port, load_enable},
+                                {cell.gated_clock_port, gated_clock}});
+    return gated_clock;
+  }
 
+  // Adds pipeline registers to the module for the given stage. The registers to
+  // define are given as pairs of Node* and the expression to assign to the
+  // value corresponding to the node. The registers use the supplied clock and
+  // optional load enable (can be null), gated by a clock gate cell if one is
+  // given in the options. Returns references corresponding to the defined
+  // registers.
+  absl::StatusOr<std::vector<Expression*>> AddPipelineRegisters(
+      absl::Span<const std::pair<Node*, Expression*>> assignments,
+      int64_t stage, Expression* load_enable) {
+    XLS_ASSIGN_OR_RETURN(std::vector<ModuleBuilder::Register> registers,
+                         DeclarePipelineRegisters(assignments, stage));
+    XLS_ASSIGN_OR_RETURN(LogicRef * clock,
+                         MaybeAddClockGate(stage, load_enable));
+    XLS_RETURN_IF_ERROR(mb_->AssignRegisters(registers, load_enable, clock));
+
+    std::vector<Expression*> register_refs;
+    for (const ModuleBuilder::Register& reg : registers) {
+      register_refs.push_back(reg.ref);
+    }
     return register_refs;
   }
 
   // Adds a "valid" signal register for the given stage using the given clock
-  // signal. Returns a reference to the defined register.
+  // signal and optional load enable (can be null). Returns a reference to the
+  // defined register.
   absl::StatusOr<LogicRef*> AddValidRegister(LogicRef* valid_load_enable,
-                                             int64_t stage) {
+                                             int64_t stage,
+                                             Expression* load_enable) {
     // Add always flop block for the valid signal. Add it separately from the
     // other pipeline register because it does not use a load_enable signal
     // like the other pipeline registers.
@@ -533,11 +1070,114 @@ class PipelineGenerator {
         ModuleBuilder::Register valid_load_enable_register,
         mb_->DeclareRegister(absl::StrFormat("p%d_valid", stage),
                              /*bit_count=*/1, valid_load_enable, reset_value));
-    XLS_RETURN_IF_ERROR(mb_->AssignRegisters({valid_load_enable_register},
-                                             /*load_enable=*/nullptr));
+    XLS_RETURN_IF_ERROR(
+        mb_->AssignRegisters({valid_load_enable_register}, load_enable));
     return valid_load_enable_register.ref;
   }
 
+  // Adds the valid register of the given stage of a ready/valid pipeline and
+  // assigns the ready signal of the stage, which accepts data while it is
+  // empty or its data moves on to the next stage. The ready signal is thus
+  // combinational in the ready signals of all later stages. Advances "flow" to
+  // the next stage.
+  absl::Status AddReadyValidControl(int64_t stage, ReadyValidFlow* flow) {
+    mb_->NewDeclarationAndAssignmentSections();
+
+    mb_->declaration_section()->Add<BlankLine>();
+    LogicRef* next_ready = mb_->DeclareVariable(
+        absl::StrFormat("p%d_ready", stage + 1), /*bit_count=*/1);
+    XLS_ASSIGN_OR_RETURN(
+        ModuleBuilder::Register valid,
+        mb_->DeclareRegister(absl::StrFormat("p%d_valid", stage),
+                             /*bit_count=*/1, flow->valid,
+                             /*reset_value=*/file_->Literal(0, 1)));
+    XLS_RETURN_IF_ERROR(mb_->AssignRegisters({valid}, flow->ready));
+    XLS_RETURN_IF_ERROR(mb_->Assign(
+        flow->ready,
+        file_->LogicalOr(file_->LogicalNot(valid.ref), next_ready),
+        func_->package()->GetBitsType(1)));
+    *flow = ReadyValidFlow{next_ready, valid.ref};
+    return absl::OkStatus();
+  }
+
+  // Adds the registers of the given stage of a ready/valid pipeline as a
+  // two-entry skid buffer. The main registers hold the outputs of the stage.
+  // Data accepted while they are stalled is captured in a second set of skid
+  // registers, and the stage is ready only while the skid registers are empty
+  // so its ready signal is registered. The registers to define are given as
+  // pairs of Node* and the expression to assign to the value corresponding to
+  // the node. Updates "node_expressions" with the main registers and advances
+  // "flow" to the next stage.
+  absl::Status AddSkidBufferStage(
+      absl::Span<const std::pair<Node*, Expression*>> assignments,
+      int64_t stage, ReadyValidFlow* flow,
+      absl::flat_hash_map<Node*, Expression*>* node_expressions) {
+    for (const auto& pair : assignments) {
+      if (pair.first->GetType()->IsArray()) {
+        return absl::UnimplementedError(absl::StrFormat(
+            "Skid buffers are not supported for array-typed values: %s",
+            pair.first->GetName()));
+      }
+    }
+    mb_->NewDeclarationAndAssignmentSections();
+
+    mb_->declaration_section()->Add<BlankLine>();
+    Expression* zero = file_->Literal(0, 1);
+    LogicRef* next_ready = mb_->DeclareVariable(
+        absl::StrFormat("p%d_ready", stage + 1), /*bit_count=*/1);
+    XLS_ASSIGN_OR_RETURN(
+        ModuleBuilder::Register valid,
+        mb_->DeclareRegister(absl::StrFormat("p%d_valid", stage),
+                             /*bit_count=*/1, /*next=*/nullptr, zero));
+    XLS_ASSIGN_OR_RETURN(
+        ModuleBuilder::Register skid_valid,
+        mb_->DeclareRegister(absl::StrFormat("p%d_skid_valid", stage),
+                             /*bit_count=*/1, /*next=*/nullptr, zero));
+
+    std::vector<ModuleBuilder::Register> registers;
+    if (!assignments.empty()) {
+      XLS_ASSIGN_OR_RETURN(registers,
+                           DeclarePipelineRegisters(assignments, stage));
+    }
+    XLS_RET_CHECK_EQ(registers.size(), assignments.size());
+    std::vector<ModuleBuilder::Register> skid_registers;
+    for (int64_t i = 0; i < assignments.size(); ++i) {
+      Node* node = assignments[i].first;
+      XLS_ASSIGN_OR_RETURN(
+          ModuleBuilder::Register skid,
+          mb_->DeclareRegister(PipelineSignalName(node, stage) + "_skid",
+                               node->GetType(), assignments[i].second));
+      registers[i].next =
+          file_->Ternary(skid_valid.ref, skid.ref, assignments[i].second);
+      skid_registers.push_back(skid);
+      (*node_expressions)[node] = registers[i].ref;
+    }
+
+    // The main registers are loaded when they are empty or drained by the next
+    // stage, from the skid registers first. Otherwise accepted data goes to
+    // the skid registers.
+    Expression* load_main =
+        file_->LogicalOr(file_->LogicalNot(valid.ref), next_ready);
+    Expression* has_data = file_->LogicalOr(skid_valid.ref, flow->valid);
+    valid.next = has_data;
+    skid_valid.next = file_->LogicalAnd(file_->LogicalNot(load_main), has_data);
+    if (!registers.empty()) {
+      XLS_RETURN_IF_ERROR(mb_->AssignRegisters(
+          registers, file_->LogicalAnd(load_main, has_data)));
+      XLS_RETURN_IF_ERROR(mb_->AssignRegisters(
+          skid_registers,
+          file_->LogicalAnd(file_->LogicalAnd(flow->valid, flow->ready),
+                            file_->LogicalNot(load_main))));
+    }
+    XLS_RETURN_IF_ERROR(mb_->AssignRegisters({valid}, load_main));
+    XLS_RETURN_IF_ERROR(mb_->AssignRegisters({skid_valid}));
+    XLS_RETURN_IF_ERROR(mb_->Assign(flow->ready,
+                                    file_->LogicalNot(skid_valid.ref),
+                                    func_->package()->GetBitsType(1)));
+    *flow = ReadyValidFlow{next_ready, valid.ref};
+    return absl::OkStatus();
+  }
+
  private:
   Function* func_;
   const PipelineSchedule& schedule_;
@@ -553,6 +1193,7 @@ absl::StatusOr<ModuleGeneratorResult> ToPipelineModuleText(
     const PipelineSchedule& schedule, Function* func,
     const PipelineOptions& options) {
   XLS_VLOG(2) << "Generating pipelined module for function:";
+  XLS_TRACE_SPAN("ToPipelineModuleText", func->name());
   XLS_VLOG_LINES(2, func->DumpIr());
   XLS_VLOG_LINES(2, schedule.ToString());
 
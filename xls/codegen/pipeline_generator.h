@@ -19,16 +19,29 @@
 
 #include "absl/status/statusor.h"
 #include "absl/types/optional.h"
+#include "xls/codegen/inlining_cost_model.h"
 #include "xls/codegen/module_signature.h"
 #include "xls/codegen/module_signature.pb.h"
 #include "xls/codegen/name_to_bit_count.h"
 #include "xls/codegen/vast.h"
+#include "xls/codegen/verilog_sink.h"
 #include "xls/ir/function.h"
 #include "xls/scheduling/pipeline_schedule.h"
 
 namespace xls {
 namespace verilog {
 
+// Describes a clock-gating cell, e.g., an integrated clock gate from a standard
+// cell library, by the name of its module and ports. The cell outputs the
+// clock input gated by the enable input and is responsible for keeping the
+// gated clock free of glitches.
+struct ClockGateCell {
+  std::string module_name;
+  std::string clock_port = "clk";
+  std::string enable_port = "en";
+  std::string gated_clock_port = "gclk";
+};
+
 // Class describing the options passed to the pipeline generator.
 class PipelineOptions {
  public:
@@ -56,6 +69,15 @@ class PipelineOptions {
                                  absl::optional<absl::string_view> output_name);
   absl::optional<ValidProto> valid_control() const;
 
+  // Specifies pipeline registers under ready/valid flow control, optionally
+  // with skid buffers at the stage boundaries. See ReadyValidPipelineControl.
+  PipelineOptions& ready_valid_control(absl::string_view input_valid_name,
+                                       absl::string_view input_ready_name,
+                                       absl::string_view output_valid_name,
+                                       absl::string_view output_ready_name,
+                                       bool skid_buffers = false);
+  absl::optional<ReadyValidPipelineControl> ready_valid_control() const;
+
   // Returns the proto describing the pipeline control scheme.
   const absl::optional<PipelineControl>& control() const {
     return pipeline_control_;
@@ -81,6 +103,46 @@ class PipelineOptions {
   PipelineOptions& split_outputs(bool value);
   bool split_outputs() const { return split_outputs_; }
 
+  // Sink to which the generated Verilog is written as it is emitted. If set,
+  // the verilog_text of the result is left empty. The sink is not owned.
+  PipelineOptions& verilog_sink(VerilogSink* sink) {
+    verilog_sink_ = sink;
+    return *this;
+  }
+  VerilogSink* verilog_sink() const { return verilog_sink_; }
+
+  // Number of threads with which to emit the logic of the pipeline stages. If
+  // greater than one, the stages are emitted concurrently once the pipeline
+  // registers are declared. The emitted Verilog does not depend on the number
+  // of threads. Pipelines with an initiation interval greater than one are
+  // always emitted sequentially.
+  PipelineOptions& stage_emission_threads(int64_t value) {
+    stage_emission_threads_ = value;
+    return *this;
+  }
+  int64_t stage_emission_threads() const { return stage_emission_threads_; }
+
+  // Options of the cost model choosing which nodes are emitted as named
+  // temporaries rather than inline expressions.
+  PipelineOptions& inlining(const InliningOptions& value) {
+    inlining_ = value;
+    return *this;
+  }
+  const InliningOptions& inlining() const { return inlining_; }
+
+  // If set, the data registers at the end of each stage which have a load
+  // enable (i.e., with pipeline register control) are clocked by a clock gated
+  // by the load enable through an instance of the given cell, so the clock of
+  // idle stages does not toggle. The emitted Verilog instantiates but does not
+  // define the cell.
+  PipelineOptions& clock_gate_cell(const ClockGateCell& value) {
+    clock_gate_cell_ = value;
+    return *this;
+  }
+  const absl::optional<ClockGateCell>& clock_gate_cell() const {
+    return clock_gate_cell_;
+  }
+
  private:
   absl::optional<std::string> module_name_;
   absl::optional<ResetProto> reset_proto_;
@@ -89,11 +151,22 @@ class PipelineOptions {
   bool flop_inputs_ = true;
   bool flop_outputs_ = true;
   bool split_outputs_ = false;
+  VerilogSink* verilog_sink_ = nullptr;
+  int64_t stage_emission_threads_ = 1;
+  InliningOptions inlining_;
+  absl::optional<ClockGateCell> clock_gate_cell_;
 };
 
 // Emits the given function as a verilog module which follows the given
 // schedule. The module is pipelined with a latency and initiation interval
-// given in the signature.
+// given in the signature. If the initiation interval of the schedule is greater
+// than one, a phase counter cleared by the reset signal tracks which stages are
+// active: stage N only loads its registers in the cycles in which the counter
+// equals N modulo the initiation interval, so inputs are sampled once every
+// initiation interval and outputs are held for as long. Multiplies and
+// divides in stages which are never active in the same cycle share operator
+// instances. The timing of the operand multiplexers of shared operators is not
+// modeled by the schedule.
 absl::StatusOr<ModuleGeneratorResult> ToPipelineModuleText(
     const PipelineSchedule& schedule, Function* func,
     const PipelineOptions& options = PipelineOptions());
@@ -17,6 +17,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "xls/codegen/flattening.h"
 #include "xls/common/status/matchers.h"
 #include "xls/delay_model/delay_estimator.h"
@@ -32,6 +33,7 @@ namespace verilog {
 namespace {
 
 using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
 using ::testing::ContainsRegex;
 using ::testing::HasSubstr;
 using ::testing::Not;
@@ -1227,6 +1229,330 @@ TEST_P(PipelineGeneratorTest, ValidPipelineControlWithResetSimulation) {
   XLS_ASSERT_OK(tb.Run());
 }
 
+TEST_P(PipelineGeneratorTest, ReadyValidPipelineControlWithSimulation) {
+  // Fill the pipeline while the output is not ready, then drain it and verify
+  // that no value is lost or reordered.
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  Type* u32 = package.GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  fb.UMul(fb.Add(x, y), z);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(3)));
+
+  ResetProto reset_proto;
+  reset_proto.set_name("rst");
+  reset_proto.set_asynchronous(false);
+  reset_proto.set_active_low(false);
+
+  for (bool skid_buffers : {false, true}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        ModuleGeneratorResult result,
+        ToPipelineModuleText(
+            schedule, func,
+            PipelineOptions()
+                .ready_valid_control("in_valid", "in_ready", "out_valid",
+                                     "out_ready", skid_buffers)
+                .reset(reset_proto)
+                .use_system_verilog(UseSystemVerilog())));
+    EXPECT_EQ(result.verilog_text.find("_skid") != std::string::npos,
+              skid_buffers);
+    int64_t latency = result.signature.proto().pipeline().latency();
+    ASSERT_GT(latency, 0);
+    // Each register stage holds one value, or two with skid buffers.
+    const int64_t capacity = skid_buffers ? 2 * latency : latency;
+    auto expected = [](int64_t i) { return (i + 2 * i) * (i + 1); };
+
+    ModuleTestbench tb(result.verilog_text, result.signature, GetSimulator());
+    tb.Set("in_valid", 0).Set("out_ready", 0).Set("rst", 1).NextCycle();
+    tb.Set("rst", 0).NextCycle();
+    tb.ExpectEq("out_valid", 0).ExpectEq("in_ready", 1);
+
+    for (int64_t i = 0; i < capacity; ++i) {
+      tb.Set("in_valid", 1).Set("x", i).Set("y", 2 * i).Set("z", i + 1);
+      tb.WaitFor("in_ready").NextCycle();
+    }
+    tb.Set("in_valid", 0);
+
+    // The full pipeline holds its output and accepts no more inputs.
+    for (int64_t i = 0; i < 3; ++i) {
+      tb.ExpectEq("in_ready", 0)
+          .ExpectEq("out_valid", 1)
+          .ExpectEq("out", expected(0))
+          .NextCycle();
+    }
+
+    tb.Set("out_ready", 1);
+    for (int64_t i = 0; i < capacity; ++i) {
+      tb.WaitFor("out_valid").ExpectEq("out", expected(i)).NextCycle();
+    }
+    tb.ExpectEq("out_valid", 0).ExpectEq("in_ready", 1);
+    XLS_ASSERT_OK(tb.Run());
+
+    ModuleSimulator simulator(result.signature, result.verilog_text,
+                              GetSimulator());
+    std::vector<ModuleSimulator::BitsMap> inputs;
+    for (int64_t i = 0; i < 4; ++i) {
+      inputs.push_back({{"x", UBits(i, 32)},
+                        {"y", UBits(2 * i, 32)},
+                        {"z", UBits(i + 1, 32)}});
+    }
+    XLS_ASSERT_OK_AND_ASSIGN(auto outputs, simulator.RunBatched(inputs));
+    ASSERT_EQ(outputs.size(), inputs.size());
+    for (int64_t i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(outputs[i].at("out"), UBits(expected(i), 32));
+    }
+  }
+}
+
+TEST_P(PipelineGeneratorTest, ReadyValidPipelineControlRequiresReset) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  fb.Negate(fb.Param("x", package.GetBitsType(8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(2)));
+  EXPECT_THAT(
+      ToPipelineModuleText(
+          schedule, func,
+          PipelineOptions()
+              .ready_valid_control("in_valid", "in_ready", "out_valid",
+                                   "out_ready")
+              .use_system_verilog(UseSystemVerilog()))
+          .status(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("requires a reset signal")));
+}
+
+TEST_P(PipelineGeneratorTest, ClockGatedValidPipelineWithSimulation) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  auto x = fb.Param("x", package.GetBitsType(32));
+  auto y = fb.Param("y", package.GetBitsType(32));
+  fb.UMul(fb.Add(x, y), y);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(3)));
+
+  ResetProto reset_proto;
+  reset_proto.set_name("rst");
+  reset_proto.set_asynchronous(false);
+  reset_proto.set_active_low(false);
+  ClockGateCell cell;
+  cell.module_name = "test_clock_gate";
+
+  EXPECT_THAT(ToPipelineModuleText(schedule, func,
+                                   PipelineOptions()
+                                       .clock_gate_cell(cell)
+                                       .use_system_verilog(UseSystemVerilog()))
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires pipeline register control")));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      ModuleGeneratorResult result,
+      ToPipelineModuleText(schedule, func,
+                           PipelineOptions()
+                               .valid_control("in_valid", "out_valid")
+                               .reset(reset_proto)
+                               .clock_gate_cell(cell)
+                               .use_system_verilog(UseSystemVerilog())));
+  EXPECT_THAT(result.verilog_text,
+              HasSubstr("test_clock_gate p0_clock_gate"));
+  EXPECT_THAT(result.verilog_text, HasSubstr("p0_gated_clk"));
+
+  // A behavioral model of a latch-based clock gate.
+  std::string verilog = absl::StrCat(result.verilog_text, R"(
+module test_clock_gate(input wire clk, input wire en, output wire gclk);
+  reg en_latched;
+  always @ (clk or en) begin
+    if (!clk) en_latched = en;
+  end
+  assign gclk = clk & en_latched;
+endmodule
+)");
+  ModuleTestbench tb(verilog, result.signature, GetSimulator());
+  tb.Set("in_valid", 0).Set("rst", 1).NextCycle();
+  tb.Set("rst", 0).NextCycle();
+
+  tb.Set("in_valid", 1).Set("x", 2).Set("y", 3).NextCycle();
+  tb.Set("in_valid", 0);
+  const int kExpected = (2 + 3) * 3;
+  tb.WaitFor("out_valid").ExpectEq("out", kExpected);
+
+  // Inputs without valid never reach the gated registers.
+  tb.Set("x", 7);
+  int64_t latency = result.signature.proto().pipeline().latency();
+  for (int64_t i = 0; i < 2 * latency; ++i) {
+    tb.ExpectEq("out", kExpected).NextCycle();
+  }
+  XLS_ASSERT_OK(tb.Run());
+}
+
+TEST_P(PipelineGeneratorTest, ModuloScheduleSharesMultiplier) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  Type* u32 = package.GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  fb.Add(fb.UMul(x, y), fb.UMul(y, z));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  // With one multiplier and an initiation interval of two, the multiplies are
+  // placed in different stages and share a single multiplier.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .initiation_interval(2)
+                                .resource_limit(Op::kUMul, 1)));
+
+  ResetProto reset;
+  reset.set_name("rst");
+  reset.set_asynchronous(false);
+  reset.set_active_low(false);
+  reset.set_reset_data_path(false);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      ModuleGeneratorResult result,
+      ToPipelineModuleText(schedule, func,
+                           PipelineOptions()
+                               .use_system_verilog(UseSystemVerilog())
+                               .reset(reset)));
+  EXPECT_EQ(result.signature.proto().pipeline().initiation_interval(), 2);
+  EXPECT_THAT(result.verilog_text, HasSubstr("shared_umul_0"));
+  EXPECT_THAT(result.verilog_text, Not(HasSubstr("shared_umul_1")));
+
+  ModuleSimulator simulator(result.signature, result.verilog_text,
+                            GetSimulator());
+  std::vector<ModuleSimulator::BitsMap> inputs;
+  for (int64_t i = 0; i < 5; ++i) {
+    inputs.push_back({{"x", UBits(i + 2, 32)},
+                      {"y", UBits(3 * i + 1, 32)},
+                      {"z", UBits(7 - i, 32)}});
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<ModuleSimulator::BitsMap> outputs,
+                           simulator.RunBatched(inputs));
+  ASSERT_EQ(outputs.size(), inputs.size());
+  for (int64_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(outputs[i].at("out"),
+              UBits((i + 2) * (3 * i + 1) + (3 * i + 1) * (7 - i), 32));
+  }
+
+  // The phase of the pipeline is aligned with the inputs by the reset.
+  EXPECT_THAT(
+      ToPipelineModuleText(
+          schedule, func,
+          PipelineOptions().use_system_verilog(UseSystemVerilog())),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("requires a reset signal")));
+}
+
+TEST_P(PipelineGeneratorTest, ParallelStageEmission) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  Type* u32 = package.GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  auto a = fb.Array({x, y, z}, u32);
+  auto b = fb.UMul(fb.ArrayIndex(a, {fb.BitSlice(z, 0, 2)}), y);
+  auto c = fb.Add(fb.UMul(b, x), fb.Not(z));
+  auto d = fb.Subtract(fb.UMul(c, c), b);
+  fb.Tuple({fb.Xor(d, fb.Negate(c)),
+            fb.ArrayUpdate(a, d, {fb.BitSlice(x, 0, 2)})});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(6)));
+
+  for (bool flop_outputs : {false, true}) {
+    PipelineOptions options = PipelineOptions()
+                                  .valid_control("in_valid", "out_valid")
+                                  .flop_outputs(flop_outputs)
+                                  .use_system_verilog(UseSystemVerilog());
+    XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult sequential,
+                             ToPipelineModuleText(schedule, func, options));
+    for (int64_t threads : {2, 4, 16}) {
+      XLS_ASSERT_OK_AND_ASSIGN(
+          ModuleGeneratorResult parallel,
+          ToPipelineModuleText(schedule, func,
+                               PipelineOptions(options).stage_emission_threads(
+                                   threads)));
+      EXPECT_EQ(parallel.verilog_text, sequential.verilog_text);
+      EXPECT_EQ(parallel.signature.proto().pipeline().latency(),
+                sequential.signature.proto().pipeline().latency());
+    }
+  }
+}
+
+TEST_P(PipelineGeneratorTest, InliningStrategies) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  Type* u32 = package.GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto a = fb.And(x, y);
+  auto b = fb.Or(a, fb.Xor(a, y));
+  auto c = fb.And(b, fb.Or(b, x));
+  fb.Xor(fb.Or(c, a), fb.And(c, b));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(1)));
+
+  auto count_temporaries = [](absl::string_view text) {
+    int64_t count = 0;
+    for (size_t pos = text.find("_comb;"); pos != absl::string_view::npos;
+         pos = text.find("_comb;", pos + 1)) {
+      ++count;
+    }
+    return count;
+  };
+  std::vector<int64_t> temporaries;
+  for (const InliningOptions& inlining :
+       {InliningOptions::Default(), InliningOptions::SimulationSpeed()}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        ModuleGeneratorResult result,
+        ToPipelineModuleText(schedule, func,
+                             PipelineOptions()
+                                 .inlining(inlining)
+                                 .use_system_verilog(UseSystemVerilog())));
+    temporaries.push_back(count_temporaries(result.verilog_text));
+
+    ModuleSimulator simulator(result.signature, result.verilog_text,
+                              GetSimulator());
+    const uint64_t kX = 0x12345678;
+    const uint64_t kY = 0x0f0f00ff;
+    uint64_t expected_a = kX & kY;
+    uint64_t expected_b = expected_a | (expected_a ^ kY);
+    uint64_t expected_c = expected_b & (expected_b | kX);
+    EXPECT_THAT(simulator.RunAndReturnSingleOutput(
+                    {{"x", UBits(kX, 32)}, {"y", UBits(kY, 32)}}),
+                IsOkAndHolds(UBits((expected_c | expected_a) ^
+                                       (expected_c & expected_b),
+                                   32)));
+  }
+  EXPECT_LT(temporaries[1], temporaries[0]);
+}
+
 INSTANTIATE_TEST_SUITE_P(PipelineGeneratorTestInstantiation,
                          PipelineGeneratorTest,
                          testing::ValuesIn(kDefaultSimulationTargets),
@@ -0,0 +1,284 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/pipeline_model.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/value_helpers.h"
+
+namespace xls {
+namespace verilog {
+
+/* static */ absl::StatusOr<std::unique_ptr<PipelineModel>>
+PipelineModel::Create(Function* func, const PipelineSchedule& schedule,
+                      const PipelineOptions& options) {
+  auto model = absl::WrapUnique(new PipelineModel(func, schedule, options));
+  XLS_RETURN_IF_ERROR(model->Initialize());
+  return std::move(model);
+}
+
+/* static */ bool PipelineModel::IsModuleConstant(Node* node) {
+  return node->Is<xls::Literal>() && !node->GetType()->IsBits() &&
+         node->GetType()->GetFlatBitCount() > 0;
+}
+
+absl::Status PipelineModel::Initialize() {
+  XLS_RET_CHECK_GT(schedule_.length(), 0);
+  if (schedule_.initiation_interval() > 1) {
+    return absl::UnimplementedError(
+        "Pipeline model does not support an initiation interval greater than "
+        "one");
+  }
+  if (options_.reset().has_value() && options_.reset()->reset_data_path()) {
+    return absl::UnimplementedError(
+        "Reset of data path not supported for pipeline generator.");
+  }
+  if (options_.control().has_value() && options_.control()->has_ready_valid()) {
+    return absl::UnimplementedError(
+        "Pipeline model does not support ready/valid pipeline control");
+  }
+
+  // Lay out the register stages as the pipeline generator does: optionally
+  // one for the inputs (only if any input has bits), one at the end of each
+  // stage, except the last stage if the outputs are not flopped.
+  if (options_.flop_inputs()) {
+    RegisterStage input_registers;
+    for (Param* param : func_->params()) {
+      if (param->GetType()->GetFlatBitCount() > 0) {
+        input_registers.nodes.push_back(param);
+      }
+    }
+    if (!input_registers.nodes.empty()) {
+      registers_.push_back(std::move(input_registers));
+      has_input_registers_ = true;
+    }
+  }
+  std::vector<Node*> live_out_last_stage;
+  for (int64_t cycle = 0; cycle < schedule_.length(); ++cycle) {
+    if (!options_.flop_outputs() && cycle == schedule_.length() - 1) {
+      break;
+    }
+    auto is_live_out_of_stage = [&](Node* node) {
+      if (IsModuleConstant(node)) {
+        return false;
+      }
+      if (node == func_->return_value()) {
+        return true;
+      }
+      return std::any_of(
+          node->users().begin(), node->users().end(),
+          [&](Node* user) { return schedule_.cycle(user) > cycle; });
+    };
+    RegisterStage stage_registers;
+    for (Node* node : live_out_last_stage) {
+      if (is_live_out_of_stage(node)) {
+        stage_registers.nodes.push_back(node);
+      }
+    }
+    for (Node* node : schedule_.nodes_in_cycle(cycle)) {
+      if (is_live_out_of_stage(node)) {
+        stage_registers.nodes.push_back(node);
+      }
+    }
+    live_out_last_stage = stage_registers.nodes;
+    registers_.push_back(std::move(stage_registers));
+  }
+
+  // Registers which have not been loaded hold X in the Verilog.
+  for (RegisterStage& stage_registers : registers_) {
+    for (Node* node : stage_registers.nodes) {
+      stage_registers.values[node] = ZeroOfType(node->GetType());
+    }
+  }
+
+  // The width of the manual load enable input counts the input register stage
+  // even if no inputs have bits.
+  load_enable_width_ = schedule_.length() - 1;
+  if (options_.flop_inputs()) {
+    ++load_enable_width_;
+  }
+  if (options_.flop_outputs()) {
+    ++load_enable_width_;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status PipelineModel::EvaluateCycle(
+    int64_t cycle, absl::flat_hash_map<Node*, Value>* values) const {
+  std::vector<Value> constants;
+  for (Node* node : schedule_.nodes_in_cycle(cycle)) {
+    if (node->Is<Param>()) {
+      XLS_RET_CHECK(values->contains(node)) << node->GetName();
+      continue;
+    }
+    std::vector<const Value*> operand_values;
+    constants.clear();
+    constants.reserve(node->operand_count());
+    for (Node* operand : node->operands()) {
+      auto it = values->find(operand);
+      if (it != values->end()) {
+        operand_values.push_back(&it->second);
+      } else if (IsModuleConstant(operand)) {
+        constants.push_back(operand->As<xls::Literal>()->value());
+        operand_values.push_back(&constants.back());
+      } else {
+        return absl::InternalError(absl::StrFormat(
+            "Value of %s is not available in stage %d", operand->GetName(),
+            cycle));
+      }
+    }
+    XLS_ASSIGN_OR_RETURN((*values)[node],
+                         IrInterpreter::EvaluateNode(node, operand_values));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<PipelineModel::CycleOutputs> PipelineModel::Tick(
+    const CycleInputs& inputs) {
+  if (inputs.args.size() != func_->params().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Expected %d arguments, got %d", func_->params().size(),
+        inputs.args.size()));
+  }
+  const bool valid_control =
+      options_.control().has_value() && options_.control()->has_valid();
+  const bool manual_control =
+      options_.control().has_value() && options_.control()->has_manual();
+  const bool reset = options_.reset().has_value() && inputs.reset;
+  Bits load_enable = Bits::AllOnes(load_enable_width_);
+  if (manual_control && inputs.load_enable.has_value()) {
+    if (inputs.load_enable->bit_count() != load_enable_width_) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Expected load enable of width %d, got %d", load_enable_width_,
+          inputs.load_enable->bit_count()));
+    }
+    load_enable = inputs.load_enable.value();
+  }
+
+  // An asserted asynchronous reset clears the valid registers immediately.
+  if (reset && options_.reset()->asynchronous()) {
+    for (RegisterStage& stage_registers : registers_) {
+      stage_registers.valid = false;
+    }
+  }
+
+  // Values loaded into each register stage at the end of this cycle.
+  std::vector<absl::flat_hash_map<Node*, Value>> next_values(registers_.size());
+  int64_t register_index = 0;
+  if (has_input_registers_) {
+    for (int64_t i = 0; i < func_->params().size(); ++i) {
+      Param* param = func_->param(i);
+      if (param->GetType()->GetFlatBitCount() > 0) {
+        next_values[0][param] = inputs.args[i];
+      }
+    }
+    register_index = 1;
+  }
+  absl::flat_hash_map<Node*, Value> values;
+  for (int64_t cycle = 0; cycle < schedule_.length(); ++cycle) {
+    if (register_index == 0) {
+      for (int64_t i = 0; i < func_->params().size(); ++i) {
+        values[func_->param(i)] = inputs.args[i];
+      }
+    } else {
+      values = registers_[register_index - 1].values;
+      for (Param* param : func_->params()) {
+        if (param->GetType()->GetFlatBitCount() == 0) {
+          values[param] = ZeroOfType(param->GetType());
+        }
+      }
+    }
+    XLS_RETURN_IF_ERROR(EvaluateCycle(cycle, &values));
+    if (register_index == registers_.size()) {
+      break;
+    }
+    for (Node* node : registers_[register_index].nodes) {
+      next_values[register_index][node] = values.at(node);
+    }
+    ++register_index;
+  }
+
+  CycleOutputs outputs;
+  Node* return_value = func_->return_value();
+  if (IsModuleConstant(return_value)) {
+    outputs.out = return_value->As<xls::Literal>()->value();
+  } else if (options_.flop_outputs()) {
+    XLS_RET_CHECK(!registers_.empty());
+    outputs.out = registers_.back().values.at(return_value);
+  } else {
+    outputs.out = values.at(return_value);
+  }
+  if (valid_control) {
+    outputs.valid = registers_.empty() ? inputs.valid : registers_.back().valid;
+  }
+
+  // Clock edge: update the registers from their values before the edge.
+  for (int64_t i = registers_.size() - 1; i >= 0; --i) {
+    RegisterStage& stage_registers = registers_[i];
+    bool load;
+    if (valid_control) {
+      bool valid_in = i == 0 ? inputs.valid : registers_[i - 1].valid;
+      // The data registers are loaded during reset to flush the pipeline.
+      load = valid_in || reset;
+      stage_registers.valid = valid_in && !reset;
+    } else if (manual_control) {
+      load = load_enable.Get(i);
+    } else {
+      load = true;
+    }
+    if (load) {
+      for (auto& pair : next_values[i]) {
+        stage_registers.values[pair.first] = std::move(pair.second);
+      }
+    }
+  }
+  return outputs;
+}
+
+absl::StatusOr<std::vector<Value>> PipelineModel::RunBatched(
+    absl::Span<const std::vector<Value>> args) {
+  std::vector<Value> outputs;
+  if (args.empty()) {
+    return outputs;
+  }
+  CycleInputs inputs;
+  if (options_.reset().has_value()) {
+    inputs.args = args.front();
+    inputs.valid = false;
+    inputs.reset = true;
+    XLS_RETURN_IF_ERROR(Tick(inputs).status());
+    inputs.reset = false;
+  }
+  for (int64_t cycle = 0; cycle < args.size() + latency(); ++cycle) {
+    inputs.args = args[std::min<int64_t>(cycle, args.size() - 1)];
+    inputs.valid = cycle < args.size();
+    XLS_ASSIGN_OR_RETURN(CycleOutputs cycle_outputs, Tick(inputs));
+    if (cycle >= latency()) {
+      XLS_RET_CHECK(cycle_outputs.valid);
+      outputs.push_back(std::move(cycle_outputs.out));
+    }
+  }
+  return outputs;
+}
+
+}  // namespace verilog
+}  // namespace xls
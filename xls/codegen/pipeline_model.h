@@ -0,0 +1,132 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_CODEGEN_PIPELINE_MODEL_H_
+#define XLS_CODEGEN_PIPELINE_MODEL_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/ir/value.h"
+#include "xls/scheduling/pipeline_schedule.h"
+
+namespace xls {
+namespace verilog {
+
+// A cycle-accurate model of the module emitted by ToPipelineModuleText for a
+// given function, schedule and options. The model holds the same pipeline
+// registers as the generated Verilog (including the optional input and output
+// flops and the valid registers) and applies the same load enable and reset
+// behavior, but evaluates the combinational logic of each stage with the IR
+// interpreter. This enables checking the cycle-level behavior of pipeline
+// control without running a Verilog simulator.
+//
+// Pipeline registers which have not been loaded hold zero where the Verilog
+// holds X. Pipelines with an initiation interval greater than one are not
+// supported.
+class PipelineModel {
+ public:
+  // The values driven on the input ports of the module in a cycle.
+  struct CycleInputs {
+    // Values for the parameters of the function in order.
+    std::vector<Value> args;
+
+    // Value of the valid input. Only used with valid pipeline control.
+    bool valid = true;
+
+    // Whether the reset signal is asserted (independent of its polarity).
+    bool reset = false;
+
+    // Value of the load enable input with manual pipeline control. One bit per
+    // pipeline register; defaults to all ones if not given.
+    absl::optional<Bits> load_enable;
+  };
+
+  // The values of the output ports of the module in a cycle.
+  struct CycleOutputs {
+    Value out;
+
+    // Value of the valid output. Always true without valid pipeline control.
+    bool valid = true;
+  };
+
+  static absl::StatusOr<std::unique_ptr<PipelineModel>> Create(
+      Function* func, const PipelineSchedule& schedule,
+      const PipelineOptions& options = PipelineOptions());
+
+  // Returns the number of cycles from an input to the corresponding output.
+  // Matches the latency in the signature of the generated module.
+  int64_t latency() const { return registers_.size(); }
+
+  // Evaluates one clock cycle with the given inputs. Returns the outputs as
+  // seen just before the rising clock edge at the end of the cycle and then
+  // updates the pipeline registers.
+  absl::StatusOr<CycleOutputs> Tick(const CycleInputs& inputs);
+
+  // Runs the given argument sets through the pipeline, one per cycle as
+  // ModuleSimulator::RunBatched does, and returns the output for each. If the
+  // module has a reset signal it is asserted for a cycle beforehand.
+  absl::StatusOr<std::vector<Value>> RunBatched(
+      absl::Span<const std::vector<Value>> args);
+
+ private:
+  // The pipeline registers at the end of a stage: the nodes whose values are
+  // held by the registers, their current values and the valid register.
+  struct RegisterStage {
+    std::vector<Node*> nodes;
+    absl::flat_hash_map<Node*, Value> values;
+    bool valid = false;
+  };
+
+  PipelineModel(Function* func, const PipelineSchedule& schedule,
+                const PipelineOptions& options)
+      : func_(func), schedule_(schedule), options_(options) {}
+
+  absl::Status Initialize();
+
+  // Returns whether the node is emitted as a module-scoped constant rather
+  // than computed in a pipeline stage.
+  static bool IsModuleConstant(Node* node);
+
+  // Evaluates the nodes of the given schedule cycle and adds their values to
+  // 'values' which must hold the values of all operands from earlier cycles.
+  absl::Status EvaluateCycle(int64_t cycle,
+                             absl::flat_hash_map<Node*, Value>* values) const;
+
+  Function* func_;
+  PipelineSchedule schedule_;
+  PipelineOptions options_;
+
+  // Width of the load enable input with manual pipeline control.
+  int64_t load_enable_width_ = 0;
+
+  // The pipeline registers in pipeline order.
+  std::vector<RegisterStage> registers_;
+
+  // Whether the first register stage holds the flopped inputs.
+  bool has_input_registers_ = false;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_PIPELINE_MODEL_H_
@@ -0,0 +1,250 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/pipeline_model.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/scheduling/pipeline_schedule.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using ::testing::ElementsAre;
+
+class TestDelayEstimator : public DelayEstimator {
+ public:
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override {
+    switch (node->op()) {
+      case Op::kParam:
+      case Op::kLiteral:
+      case Op::kBitSlice:
+      case Op::kConcat:
+        return 0;
+      default:
+        return 1;
+    }
+  }
+};
+
+// Returns the inputs of a cycle for a function of 64-bit parameters.
+PipelineModel::CycleInputs MakeInputs(absl::Span<const int64_t> args,
+                                      bool valid = true, bool reset = false) {
+  PipelineModel::CycleInputs inputs;
+  for (int64_t arg : args) {
+    inputs.args.push_back(Value(UBits(arg, 64)));
+  }
+  inputs.valid = valid;
+  inputs.reset = reset;
+  return inputs;
+}
+
+TEST(PipelineModelTest, MatchesInterpreter) {
+  Package package("MatchesInterpreter");
+  FunctionBuilder fb("MatchesInterpreter", &package);
+  auto x = fb.Param("x", package.GetBitsType(64));
+  auto y = fb.Param("y", package.GetBitsType(64));
+  auto z = fb.Param("z", package.GetBitsType(64));
+  fb.Subtract(fb.Add(fb.UMul(x, y), z), x);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(3)));
+
+  std::vector<std::vector<Value>> args;
+  std::vector<Value> expected;
+  for (int64_t i = 0; i < 10; ++i) {
+    args.push_back(MakeInputs({i, 3 * i, 7}).args);
+    XLS_ASSERT_OK_AND_ASSIGN(Value result,
+                             IrInterpreter::Run(func, args.back()));
+    expected.push_back(result);
+  }
+
+  for (bool flop_inputs : {false, true}) {
+    for (bool flop_outputs : {false, true}) {
+      PipelineOptions options = PipelineOptions()
+                                    .flop_inputs(flop_inputs)
+                                    .flop_outputs(flop_outputs);
+      XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result,
+                               ToPipelineModuleText(schedule, func, options));
+      XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PipelineModel> model,
+                               PipelineModel::Create(func, schedule, options));
+      EXPECT_EQ(model->latency(),
+                result.signature.proto().pipeline().latency());
+      EXPECT_THAT(model->RunBatched(args), IsOkAndHolds(expected));
+    }
+  }
+}
+
+TEST(PipelineModelTest, ReturnTupleLiteral) {
+  Package package("ReturnTupleLiteral");
+  FunctionBuilder fb("ReturnTupleLiteral", &package);
+  fb.Literal(Value::Tuple({Value(UBits(0, 1)), Value(UBits(123, 32))}));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(5)));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PipelineModel> model,
+                           PipelineModel::Create(func, schedule));
+  EXPECT_EQ(model->latency(), 5);
+  std::vector<std::vector<Value>> args(1);
+  EXPECT_THAT(model->RunBatched(args),
+              IsOkAndHolds(ElementsAre(Value::Tuple(
+                  {Value(UBits(0, 1)), Value(UBits(123, 32))}))));
+}
+
+TEST(PipelineModelTest, ValidSignalWithReset) {
+  Package package("ValidSignalWithReset");
+  FunctionBuilder fb("ValidSignalWithReset", &package);
+  auto x = fb.Param("x", package.GetBitsType(64));
+  auto y = fb.Param("y", package.GetBitsType(64));
+  auto z = fb.Param("z", package.GetBitsType(64));
+  fb.UMul(fb.UMul(x, y), z);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(2)));
+
+  ResetProto reset;
+  reset.set_name("rst");
+  reset.set_asynchronous(false);
+  reset.set_active_low(false);
+  reset.set_reset_data_path(false);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<PipelineModel> model,
+      PipelineModel::Create(func, schedule,
+                            PipelineOptions()
+                                .valid_control("in_valid", "out_valid")
+                                .reset(reset)));
+  ASSERT_EQ(model->latency(), 3);
+
+  // Even with in_valid one, out_valid should never be one while reset is
+  // asserted.
+  XLS_ASSERT_OK(model->Tick(MakeInputs({1, 1, 1}, true, true)).status());
+  for (int64_t i = 0; i < 10; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(PipelineModel::CycleOutputs outputs,
+                             model->Tick(MakeInputs({1, 1, 1}, true, true)));
+    EXPECT_FALSE(outputs.valid);
+  }
+
+  // Deassert reset and wait for the output to go valid.
+  for (int64_t i = 0; i < model->latency(); ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(PipelineModel::CycleOutputs outputs,
+                             model->Tick(MakeInputs({2, 3, 4})));
+    EXPECT_FALSE(outputs.valid);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(PipelineModel::CycleOutputs outputs,
+                           model->Tick(MakeInputs({2, 3, 4})));
+  EXPECT_TRUE(outputs.valid);
+  EXPECT_EQ(outputs.out, Value(UBits(24, 64)));
+
+  // The reset is synchronous so out_valid drops after the clock edge.
+  XLS_ASSERT_OK_AND_ASSIGN(outputs,
+                           model->Tick(MakeInputs({2, 3, 4}, true, true)));
+  EXPECT_TRUE(outputs.valid);
+  XLS_ASSERT_OK_AND_ASSIGN(outputs,
+                           model->Tick(MakeInputs({2, 3, 4}, true, true)));
+  EXPECT_FALSE(outputs.valid);
+
+  // Deassert reset and in_valid and change the input; the output never
+  // changes.
+  for (int64_t i = 0; i < 2 * model->latency(); ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(outputs,
+                             model->Tick(MakeInputs({2, 3, 7}, false)));
+    EXPECT_FALSE(outputs.valid);
+    EXPECT_EQ(outputs.out, Value(UBits(24, 64)));
+  }
+
+  // An asynchronous reset clears out_valid immediately.
+  reset.set_asynchronous(true);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      model, PipelineModel::Create(func, schedule,
+                                   PipelineOptions()
+                                       .valid_control("in_valid", "out_valid")
+                                       .reset(reset)));
+  for (int64_t i = 0; i < model->latency(); ++i) {
+    XLS_ASSERT_OK(model->Tick(MakeInputs({2, 3, 4})).status());
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(outputs, model->Tick(MakeInputs({2, 3, 4})));
+  EXPECT_TRUE(outputs.valid);
+  XLS_ASSERT_OK_AND_ASSIGN(outputs,
+                           model->Tick(MakeInputs({2, 3, 4}, true, true)));
+  EXPECT_FALSE(outputs.valid);
+}
+
+TEST(PipelineModelTest, ManualPipelineControl) {
+  Package package("ManualPipelineControl");
+  FunctionBuilder fb("ManualPipelineControl", &package);
+  fb.Param("in", package.GetBitsType(64));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(3)));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<PipelineModel> model,
+      PipelineModel::Create(func, schedule,
+                            PipelineOptions().manual_control("pipeline_le")));
+  ASSERT_EQ(model->latency(), 4);
+
+  auto tick = [&](int64_t in, int64_t load_enable) {
+    PipelineModel::CycleInputs inputs = MakeInputs({in});
+    inputs.load_enable = UBits(load_enable, 4);
+    return model->Tick(inputs).value().out;
+  };
+
+  // Nothing is loaded while the load enables are disabled.
+  for (int64_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(tick(0xabcd, 0), Value(UBits(0, 64)));
+  }
+  for (int64_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(tick(0xabcd, 0xf), Value(UBits(0, 64)));
+  }
+  EXPECT_EQ(tick(0, 0xf), Value(UBits(0xabcd, 64)));
+  for (int64_t i = 1; i < 4; ++i) {
+    EXPECT_EQ(tick(i, 0xf), Value(UBits(0xabcd, 64)));
+  }
+
+  // Stall the first two register stages.
+  EXPECT_EQ(tick(4, 0xc), Value(UBits(0, 64)));
+  EXPECT_EQ(tick(4, 0xc), Value(UBits(1, 64)));
+  EXPECT_EQ(tick(4, 0xc), Value(UBits(2, 64)));
+  EXPECT_EQ(tick(4, 0xc), Value(UBits(2, 64)));
+
+  // Unstall; the 3 held in the first stage appears after the second stage
+  // drains its copy of the 2.
+  EXPECT_EQ(tick(9, 0xf), Value(UBits(2, 64)));
+  EXPECT_EQ(tick(9, 0xf), Value(UBits(2, 64)));
+  EXPECT_EQ(tick(9, 0xf), Value(UBits(2, 64)));
+  EXPECT_EQ(tick(9, 0xf), Value(UBits(3, 64)));
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -455,10 +455,14 @@ absl::StatusOr<ModuleGeneratorResult> GenerateModule(
   sig_builder.WithUnknownInterface();
   XLS_ASSIGN_OR_RETURN(ModuleSignature signature, sig_builder.Build());
 
-  std::string text = f.Emit();
-
-  XLS_VLOG(2) << "Verilog output:";
-  XLS_VLOG_LINES(2, text);
+  std::string text;
+  if (options.verilog_sink() != nullptr) {
+    f.EmitTo(options.verilog_sink());
+  } else {
+    text = f.Emit();
+    XLS_VLOG(2) << "Verilog output:";
+    XLS_VLOG_LINES(2, text);
+  }
   XLS_VLOG(2) << "Signature:";
   XLS_VLOG_LINES(2, signature.ToString());
 
@@ -17,6 +17,7 @@
 
 #include "absl/status/statusor.h"
 #include "xls/codegen/module_signature.h"
+#include "xls/codegen/verilog_sink.h"
 #include "xls/common/proto_adaptor_utils.h"
 #include "xls/ir/proc.h"
 
@@ -90,12 +91,21 @@ class GeneratorOptions {
     return assert_format_;
   }
 
+  // Sink to which the generated Verilog is written as it is emitted. If set,
+  // the verilog_text of the result is left empty. The sink is not owned.
+  GeneratorOptions& verilog_sink(VerilogSink* sink) {
+    verilog_sink_ = sink;
+    return *this;
+  }
+  VerilogSink* verilog_sink() const { return verilog_sink_; }
+
  private:
   absl::optional<ResetProto> reset_proto_;
   absl::optional<std::string> clock_name_;
   absl::optional<std::string> module_name_;
   bool use_system_verilog_ = true;
   absl::optional<std::string> assert_format_;
+  VerilogSink* verilog_sink_ = nullptr;
 };
 
 // Generates and returns a (System)Verilog module implementing the given proc
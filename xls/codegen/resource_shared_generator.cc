@@ -0,0 +1,412 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/resource_shared_generator.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/codegen/finite_state_machine.h"
+#include "xls/codegen/module_builder.h"
+#include "xls/codegen/vast.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/type.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+// Returns whether operations of the given op can be limited to a set of
+// shared functional units. The low bits of the result of these ops only depend
+// on the low bits of their operands, so an operation can run on a unit wider
+// than itself with extended operands and a truncated result.
+bool IsSharedUnitOp(Op op) {
+  switch (op) {
+    case Op::kAdd:
+    case Op::kSub:
+    case Op::kUMul:
+    case Op::kSMul:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the given operand of 'operand_width' bits resized to an operand of a
+// unit of 'unit_width' bits.
+Expression* ResizeOperand(IndexableExpression* operand, int64_t operand_width,
+                          int64_t unit_width, bool sign_extend,
+                          VerilogFile* file) {
+  if (operand_width == unit_width) {
+    return operand;
+  }
+  if (operand_width > unit_width) {
+    return file->Slice(operand, unit_width - 1, 0);
+  }
+  int64_t bits_added = unit_width - operand_width;
+  if (!sign_extend) {
+    return file->Concat({file->Literal(0, bits_added), operand});
+  }
+  if (operand_width == 1) {
+    return file->Concat(/*replication=*/unit_width, {operand});
+  }
+  return file->Concat(
+      {file->Concat(/*replication=*/bits_added,
+                    {file->Index(operand, operand_width - 1)}),
+       operand});
+}
+
+}  // namespace
+
+absl::StatusOr<ResourceSchedule> ScheduleWithResourceLimits(
+    Function* f, const absl::flat_hash_map<Op, int64_t>& resource_limits) {
+  for (const auto& op_limit : resource_limits) {
+    if (!IsSharedUnitOp(op_limit.first)) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Operation %s cannot be resource limited",
+                          OpToString(op_limit.first)));
+    }
+    if (op_limit.second < 1) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Resource limit of operation %s must be positive, is %d",
+          OpToString(op_limit.first), op_limit.second));
+    }
+  }
+  auto is_limited = [&](Node* node) {
+    return resource_limits.contains(node->op());
+  };
+
+  std::vector<Node*> topo_order;
+  for (Node* node : TopoSort(f)) {
+    topo_order.push_back(node);
+  }
+  // The priority of each node is the number of limited operations on the
+  // longest path from the node to a sink, including the node itself.
+  absl::flat_hash_map<Node*, int64_t> priority;
+  absl::flat_hash_map<Node*, int64_t> topo_index;
+  for (int64_t i = topo_order.size() - 1; i >= 0; --i) {
+    Node* node = topo_order[i];
+    int64_t longest_path = 0;
+    for (Node* user : node->users()) {
+      longest_path = std::max(longest_path, priority.at(user));
+    }
+    priority[node] = longest_path + (is_limited(node) ? 1 : 0);
+    topo_index[node] = i;
+  }
+
+  ResourceSchedule schedule;
+  // The first step in which the value of each node is available. A node is
+  // added once all the limited operations it depends on are scheduled.
+  absl::flat_hash_map<Node*, int64_t> available;
+  int64_t unscheduled =
+      std::count_if(topo_order.begin(), topo_order.end(), is_limited);
+  for (int64_t step = 0; unscheduled > 0; ++step) {
+    std::vector<Node*> candidates;
+    for (Node* node : topo_order) {
+      if (available.contains(node) ||
+          !std::all_of(node->operands().begin(), node->operands().end(),
+                       [&](Node* operand) {
+                         return available.contains(operand);
+                       })) {
+        continue;
+      }
+      if (is_limited(node)) {
+        candidates.push_back(node);
+        continue;
+      }
+      int64_t first_step = 0;
+      for (Node* operand : node->operands()) {
+        first_step = std::max(first_step, available.at(operand));
+      }
+      available[node] = first_step;
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](Node* a, Node* b) {
+      return std::make_pair(-priority.at(a), topo_index.at(a)) <
+             std::make_pair(-priority.at(b), topo_index.at(b));
+    });
+    absl::flat_hash_map<Op, int64_t> units_used;
+    for (Node* node : candidates) {
+      int64_t& unit = units_used[node->op()];
+      if (unit == resource_limits.at(node->op())) {
+        continue;
+      }
+      schedule.bindings[node] = UnitBinding{step, unit};
+      available[node] = step + 1;
+      ++unit;
+      --unscheduled;
+      int64_t& unit_count = schedule.unit_counts[node->op()];
+      unit_count = std::max(unit_count, unit);
+    }
+    schedule.step_count = step + 1;
+  }
+  return schedule;
+}
+
+absl::StatusOr<ModuleGeneratorResult> GenerateResourceSharedModule(
+    Function* func, const ResourceSharingOptions& options) {
+  if (!options.reset().has_value()) {
+    return absl::InvalidArgumentError(
+        "A resource-shared module requires a reset.");
+  }
+  for (Node* node : func->nodes()) {
+    if (node->GetType()->IsToken() || node->GetType()->GetFlatBitCount() == 0) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Unable to generate resource-shared module containing: %s",
+          node->ToString()));
+    }
+  }
+  XLS_ASSIGN_OR_RETURN(
+      ResourceSchedule schedule,
+      ScheduleWithResourceLimits(func, options.resource_limits()));
+
+  std::string module_name =
+      SanitizeIdentifier(options.module_name().value_or(func->name()));
+  VerilogFile file(options.use_system_verilog());
+  ModuleBuilder mb(module_name, &file, options.use_system_verilog(),
+                   /*clk_name=*/"clk", options.reset());
+
+  LogicRef* ready_in =
+      mb.module()->AddOutput("ready_in", file.BitVectorType(1));
+  LogicRef* valid_in = mb.AddInputPort("valid_in", 1);
+  LogicRef* ready_out = mb.AddInputPort("ready_out", 1);
+  LogicRef* valid_out =
+      mb.module()->AddOutput("valid_out", file.BitVectorType(1));
+
+  // The inputs are registered when accepted in the ready state.
+  absl::flat_hash_map<Node*, Expression*> node_exprs;
+  std::vector<ModuleBuilder::Register> input_registers;
+  for (Param* param : func->params()) {
+    XLS_ASSIGN_OR_RETURN(LogicRef * port,
+                         mb.AddInputPort(param->GetName(), param->GetType()));
+    XLS_ASSIGN_OR_RETURN(
+        ModuleBuilder::Register reg,
+        mb.DeclareRegister(absl::StrCat(param->GetName(), "_reg"),
+                           param->GetType(), port));
+    input_registers.push_back(reg);
+    node_exprs[param] = reg.ref;
+  }
+  if (!input_registers.empty()) {
+    XLS_RETURN_IF_ERROR(mb.AssignRegisters(
+        input_registers, file.BitwiseAnd(ready_in, valid_in)));
+  }
+
+  // Wires asserted by the FSM in the state of each control step.
+  std::vector<LogicRef*> step_active;
+  for (int64_t step = 0; step < schedule.step_count; ++step) {
+    step_active.push_back(
+        mb.DeclareVariable(absl::StrFormat("step_%d_active", step), 1));
+  }
+
+  // Operations bound to a unit are represented by the register holding their
+  // result. All other operations are combinational logic from the input and
+  // result registers. Operands of units are emitted as named variables so they
+  // can be sliced and extended.
+  auto has_bound_user = [&](Node* node) {
+    return std::any_of(node->users().begin(), node->users().end(),
+                       [&](Node* user) {
+                         return schedule.bindings.contains(user);
+                       });
+  };
+  absl::flat_hash_map<Node*, ModuleBuilder::Register> result_registers;
+  std::map<std::pair<Op, int64_t>, std::vector<Node*>> unit_nodes;
+  for (Node* node : TopoSort(func)) {
+    if (node->Is<Param>()) {
+      continue;
+    }
+    if (schedule.bindings.contains(node)) {
+      XLS_ASSIGN_OR_RETURN(
+          ModuleBuilder::Register reg,
+          mb.DeclareRegister(absl::StrCat(node->GetName(), "_reg"),
+                             node->GetType(), /*next=*/nullptr));
+      result_registers[node] = reg;
+      node_exprs[node] = reg.ref;
+      unit_nodes[{node->op(), schedule.bindings.at(node).unit}].push_back(
+          node);
+      continue;
+    }
+    if (node->Is<xls::Literal>() && !node->GetType()->IsBits()) {
+      XLS_ASSIGN_OR_RETURN(
+          node_exprs[node],
+          mb.DeclareModuleConstant(node->GetName(),
+                                   node->As<xls::Literal>()->value()));
+      continue;
+    }
+    std::vector<Expression*> inputs;
+    for (Node* operand : node->operands()) {
+      inputs.push_back(node_exprs.at(operand));
+    }
+    if (node->HasAssignedName() || node->users().size() > 1 ||
+        func->HasImplicitUse(node) || has_bound_user(node) ||
+        !mb.CanEmitAsInlineExpression(node)) {
+      XLS_ASSIGN_OR_RETURN(node_exprs[node],
+                           mb.EmitAsAssignment(node->GetName(), node, inputs));
+    } else {
+      XLS_ASSIGN_OR_RETURN(node_exprs[node],
+                           mb.EmitAsInlineExpression(node, inputs));
+    }
+  }
+
+  // Each unit computes the operation bound to it in the active step on
+  // operands resized to the width of the unit, and the result register of the
+  // operation takes the low bits of the unit's output. The low bits of a
+  // product are the same for signed and unsigned operands of the same width,
+  // so the signedness of a multiply only affects the extension of its
+  // operands.
+  for (auto& unit_and_nodes : unit_nodes) {
+    Op op = unit_and_nodes.first.first;
+    std::vector<Node*>& nodes = unit_and_nodes.second;
+    std::sort(nodes.begin(), nodes.end(), [&](Node* a, Node* b) {
+      return schedule.bindings.at(a).step < schedule.bindings.at(b).step;
+    });
+    int64_t width = 0;
+    for (Node* node : nodes) {
+      width = std::max(width, node->BitCountOrDie());
+    }
+    std::string unit_name = absl::StrFormat("%s_unit_%d", OpToString(op),
+                                            unit_and_nodes.first.second);
+    std::vector<LogicRef*> unit_operands;
+    for (int64_t operand_no = 0; operand_no < 2; ++operand_no) {
+      Expression* mux = nullptr;
+      for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        Node* operand = (*it)->operand(operand_no);
+        Expression* operand_expr = node_exprs.at(operand);
+        XLS_RET_CHECK(operand_expr->IsIndexableExpression());
+        Expression* resized = ResizeOperand(
+            operand_expr->AsIndexableExpressionOrDie(),
+            operand->BitCountOrDie(), width, op == Op::kSMul, &file);
+        mux = mux == nullptr
+                  ? resized
+                  : file.Ternary(
+                        step_active[schedule.bindings.at(*it).step], resized,
+                        mux);
+      }
+      LogicRef* unit_operand = mb.DeclareVariable(
+          absl::StrFormat("%s_operand_%d", unit_name, operand_no), width);
+      mb.assignment_section()->Add<ContinuousAssignment>(unit_operand, mux);
+      unit_operands.push_back(unit_operand);
+    }
+    Expression* result;
+    if (op == Op::kAdd) {
+      result = file.Add(unit_operands[0], unit_operands[1]);
+    } else if (op == Op::kSub) {
+      result = file.Sub(unit_operands[0], unit_operands[1]);
+    } else {
+      result = file.Mul(unit_operands[0], unit_operands[1]);
+    }
+    LogicRef* unit_out =
+        mb.DeclareVariable(absl::StrCat(unit_name, "_out"), width);
+    mb.assignment_section()->Add<ContinuousAssignment>(unit_out, result);
+    for (Node* node : nodes) {
+      result_registers.at(node).next =
+          node->BitCountOrDie() == width
+              ? static_cast<Expression*>(unit_out)
+              : file.Slice(unit_out, node->BitCountOrDie() - 1, 0);
+    }
+  }
+
+  // The result registers of the operations of each step are loaded at the end
+  // of the step.
+  std::vector<std::vector<ModuleBuilder::Register>> step_registers(
+      schedule.step_count);
+  for (Node* node : TopoSort(func)) {
+    if (schedule.bindings.contains(node)) {
+      step_registers[schedule.bindings.at(node).step].push_back(
+          result_registers.at(node));
+    }
+  }
+  for (int64_t step = 0; step < schedule.step_count; ++step) {
+    XLS_RETURN_IF_ERROR(
+        mb.AssignRegisters(step_registers[step], step_active[step]));
+  }
+
+  XLS_RETURN_IF_ERROR(mb.AddOutputPort("out", func->return_value()->GetType(),
+                                       node_exprs.at(func->return_value())));
+
+  // The FSM waits for inputs in the ready state, advances through one state
+  // per control step and holds the output valid in the done state. As in the
+  // sequential generator, the FSM is emitted at the end of the module so the
+  // wires and ports declared above are driven by its outputs afterwards, and
+  // the unreachable null state forces a transition to the ready state upon
+  // reset.
+  FsmBuilder fsm("resource_sharing_fsm", mb.module(), mb.clock(),
+                 options.use_system_verilog(), mb.reset());
+  fsm.AddState("Null");
+  FsmState* ready_state = fsm.AddState("Ready");
+  fsm.SetResetState(ready_state);
+  std::vector<FsmState*> step_states;
+  for (int64_t step = 0; step < schedule.step_count; ++step) {
+    step_states.push_back(fsm.AddState(absl::StrFormat("Step%d", step)));
+  }
+  FsmState* done_state = fsm.AddState("Done");
+
+  std::vector<std::pair<LogicRef*, LogicRef*>> driven_wires;
+  FsmOutput* fsm_ready_in = fsm.AddOutput1("fsm_ready_in", /*default=*/0);
+  driven_wires.push_back({ready_in, fsm_ready_in->logic_ref});
+  FsmOutput* fsm_valid_out = fsm.AddOutput1("fsm_valid_out", /*default=*/0);
+  driven_wires.push_back({valid_out, fsm_valid_out->logic_ref});
+
+  ready_state->SetOutput(fsm_ready_in, 1)
+      .OnCondition(valid_in)
+      .NextState(step_states.empty() ? done_state : step_states.front());
+  for (int64_t step = 0; step < schedule.step_count; ++step) {
+    FsmOutput* fsm_step_active = fsm.AddOutput1(
+        absl::StrFormat("fsm_step_%d_active", step), /*default=*/0);
+    driven_wires.push_back({step_active[step], fsm_step_active->logic_ref});
+    step_states[step]
+        ->SetOutput(fsm_step_active, 1)
+        .NextState(step + 1 < schedule.step_count ? step_states[step + 1]
+                                                  : done_state);
+  }
+  done_state->SetOutput(fsm_valid_out, 1)
+      .OnCondition(ready_out)
+      .NextState(ready_state);
+
+  XLS_RETURN_IF_ERROR(fsm.Build());
+  mb.module()->Add<BlankLine>();
+  mb.module()->Add<Comment>("FSM driven wires.");
+  for (const auto& wire_and_output : driven_wires) {
+    mb.module()->Add<ContinuousAssignment>(wire_and_output.first,
+                                           wire_and_output.second);
+  }
+
+  ModuleSignatureBuilder sig_builder(module_name);
+  sig_builder.WithClock("clk");
+  sig_builder.WithReset(options.reset()->name(),
+                        options.reset()->asynchronous(),
+                        options.reset()->active_low());
+  for (Param* param : func->params()) {
+    sig_builder.AddDataInput(param->GetName(),
+                             param->GetType()->GetFlatBitCount());
+  }
+  sig_builder.AddDataOutput("out",
+                            func->return_value()->GetType()->GetFlatBitCount());
+  sig_builder.WithFunctionType(func->GetType());
+  sig_builder.WithReadyValidInterface("ready_in", "valid_in", "ready_out",
+                                      "valid_out");
+  XLS_ASSIGN_OR_RETURN(ModuleSignature signature, sig_builder.Build());
+
+  return ModuleGeneratorResult{mb.module()->Emit(), signature};
+}
+
+}  // namespace verilog
+}  // namespace xls
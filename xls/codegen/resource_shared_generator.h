@@ -0,0 +1,122 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_CODEGEN_RESOURCE_SHARED_GENERATOR_H_
+#define XLS_CODEGEN_RESOURCE_SHARED_GENERATOR_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/codegen/module_signature.pb.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+
+namespace xls {
+namespace verilog {
+
+// Configuration options for a resource-shared module.
+class ResourceSharingOptions {
+ public:
+  // Sets the number of functional units available to operations with the
+  // given op. Only add, sub, umul and smul can be limited. Operations of other
+  // ops, or of ops without a limit, get dedicated combinational logic.
+  ResourceSharingOptions& resource_limit(Op op, int64_t count) {
+    resource_limits_[op] = count;
+    return *this;
+  }
+  const absl::flat_hash_map<Op, int64_t>& resource_limits() const {
+    return resource_limits_;
+  }
+
+  // Name to use for the generated module. If not given, the name of the
+  // function is used.
+  ResourceSharingOptions& module_name(absl::string_view name) {
+    module_name_ = std::string(name);
+    return *this;
+  }
+  const absl::optional<std::string>& module_name() const {
+    return module_name_;
+  }
+
+  // Reset logic to use. Required.
+  ResourceSharingOptions& reset(const ResetProto& reset_proto) {
+    reset_proto_ = reset_proto;
+    return *this;
+  }
+  const absl::optional<ResetProto>& reset() const { return reset_proto_; }
+
+  // Whether to use SystemVerilog in the generated code, otherwise Verilog is
+  // used. The default is to use SystemVerilog.
+  ResourceSharingOptions& use_system_verilog(bool value) {
+    use_system_verilog_ = value;
+    return *this;
+  }
+  bool use_system_verilog() const { return use_system_verilog_; }
+
+ private:
+  absl::flat_hash_map<Op, int64_t> resource_limits_;
+  absl::optional<std::string> module_name_;
+  absl::optional<ResetProto> reset_proto_;
+  bool use_system_verilog_ = true;
+};
+
+// The control step and functional unit an operation is bound to.
+struct UnitBinding {
+  int64_t step;
+  // Index of the unit among the units of the operation's op.
+  int64_t unit;
+};
+
+// The result of scheduling a function onto a limited set of functional units.
+struct ResourceSchedule {
+  // The number of control steps, i.e., cycles the datapath takes after
+  // accepting its inputs.
+  int64_t step_count = 0;
+  // The binding of each operation which executes on a shared functional unit.
+  absl::flat_hash_map<Node*, UnitBinding> bindings;
+  // The number of functional units used of each limited op.
+  absl::flat_hash_map<Op, int64_t> unit_counts;
+};
+
+// List-schedules the operations of the function which have a resource limit
+// onto their functional units. In each control step, the operations whose
+// operands are available are bound to the free units of their op in order of
+// decreasing number of limited operations on their longest path to the
+// output. The result of a shared unit is registered at the end of its step and
+// is available from the next step. Operations without a resource limit are
+// combinational and chained within a step.
+absl::StatusOr<ResourceSchedule> ScheduleWithResourceLimits(
+    Function* f, const absl::flat_hash_map<Op, int64_t>& resource_limits);
+
+// Emits the given function as a multi-cycle module which reuses a limited set
+// of functional units across the states of an FSM, trading latency for area.
+// The module has a ready/valid interface: it accepts inputs in its ready state,
+// runs one state per control step of ScheduleWithResourceLimits and then holds
+// the output valid until it is accepted. The operands of each unit are
+// multiplexed by control step, and units are as wide as the widest operation
+// bound to them.
+absl::StatusOr<ModuleGeneratorResult> GenerateResourceSharedModule(
+    Function* func, const ResourceSharingOptions& options);
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_RESOURCE_SHARED_GENERATOR_H_
@@ -0,0 +1,170 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/resource_shared_generator.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value.h"
+#include "xls/simulation/module_simulator.h"
+#include "xls/simulation/verilog_test_base.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+class ResourceSharedGeneratorTest : public VerilogTestBase {
+ protected:
+  ResourceSharingOptions DefaultOptions() {
+    ResetProto reset;
+    reset.set_name("rst");
+    reset.set_asynchronous(false);
+    reset.set_active_low(false);
+    ResourceSharingOptions options;
+    options.reset(reset).use_system_verilog(UseSystemVerilog());
+    return options;
+  }
+};
+
+// Builds a function computing smul(umul(a, b) + umul(c, d), e) where 'e' is
+// narrower than the other operands.
+absl::StatusOr<Function*> BuildMultiplyAccumulate(Package* package) {
+  FunctionBuilder fb("mac", package);
+  Type* u16 = package->GetBitsType(16);
+  BValue a = fb.Param("a", u16);
+  BValue b = fb.Param("b", u16);
+  BValue c = fb.Param("c", u16);
+  BValue d = fb.Param("d", u16);
+  BValue e = fb.Param("e", package->GetBitsType(8));
+  BValue sum = fb.Add(fb.UMul(a, b), fb.UMul(c, d));
+  return fb.BuildWithReturnValue(fb.SMul(sum, e, /*result_width=*/16));
+}
+
+TEST_P(ResourceSharedGeneratorTest, ScheduleWithOneMultiplierOfEachKind) {
+  Package package(TestBaseName());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, BuildMultiplyAccumulate(&package));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      ResourceSchedule schedule,
+      ScheduleWithResourceLimits(f, {{Op::kUMul, 1}, {Op::kSMul, 1}}));
+
+  // The two umuls take turns on the single unit, the add is chained before
+  // the smul in the last step.
+  EXPECT_EQ(schedule.step_count, 3);
+  EXPECT_EQ(schedule.bindings.size(), 3);
+  EXPECT_EQ(schedule.unit_counts.at(Op::kUMul), 1);
+  EXPECT_EQ(schedule.unit_counts.at(Op::kSMul), 1);
+  EXPECT_EQ(schedule.bindings.at(f->return_value()).step, 2);
+  Node* add = f->return_value()->operand(0);
+  EXPECT_FALSE(schedule.bindings.contains(add));
+  EXPECT_EQ(schedule.bindings.at(add->operand(0)).step, 0);
+  EXPECT_EQ(schedule.bindings.at(add->operand(1)).step, 1);
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      schedule,
+      ScheduleWithResourceLimits(f, {{Op::kUMul, 2}, {Op::kSMul, 1}}));
+  EXPECT_EQ(schedule.step_count, 2);
+  EXPECT_EQ(schedule.unit_counts.at(Op::kUMul), 2);
+  EXPECT_EQ(schedule.bindings.at(add->operand(0)).unit, 0);
+  EXPECT_EQ(schedule.bindings.at(add->operand(1)).unit, 1);
+}
+
+TEST_P(ResourceSharedGeneratorTest, MultiplyAccumulate) {
+  Package package(TestBaseName());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, BuildMultiplyAccumulate(&package));
+  for (int64_t umul_count : {1, 2}) {
+    ResourceSharingOptions options = DefaultOptions();
+    options.resource_limit(Op::kUMul, umul_count).resource_limit(Op::kSMul, 1);
+    XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result,
+                             GenerateResourceSharedModule(f, options));
+    EXPECT_TRUE(result.signature.proto().has_ready_valid());
+    EXPECT_THAT(result.verilog_text, HasSubstr("umul_unit_0"));
+    if (umul_count == 1) {
+      EXPECT_THAT(result.verilog_text, Not(HasSubstr("umul_unit_1")));
+    }
+
+    // (3 * 5 + 7 * 11) * -2 = -184.
+    ModuleSimulator simulator(result.signature, result.verilog_text,
+                              GetSimulator());
+    EXPECT_THAT(simulator.Run({{"a", Value(UBits(3, 16))},
+                               {"b", Value(UBits(5, 16))},
+                               {"c", Value(UBits(7, 16))},
+                               {"d", Value(UBits(11, 16))},
+                               {"e", Value(SBits(-2, 8))}}),
+                IsOkAndHolds(Value(SBits(-184, 16))));
+  }
+}
+
+TEST_P(ResourceSharedGeneratorTest, AddsOfDifferentWidthsShareUnit) {
+  Package package(TestBaseName());
+  FunctionBuilder fb(TestBaseName(), &package);
+  BValue x = fb.Param("x", package.GetBitsType(8));
+  BValue y = fb.Param("y", package.GetBitsType(8));
+  BValue z = fb.Param("z", package.GetBitsType(16));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Function * f,
+      fb.BuildWithReturnValue(fb.Add(fb.ZeroExtend(fb.Add(x, y), 16), z)));
+  ResourceSharingOptions options = DefaultOptions();
+  options.resource_limit(Op::kAdd, 1);
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result,
+                           GenerateResourceSharedModule(f, options));
+  EXPECT_THAT(result.verilog_text, HasSubstr("add_unit_0"));
+  EXPECT_THAT(result.verilog_text, Not(HasSubstr("add_unit_1")));
+
+  // The 8-bit add wraps around.
+  ModuleSimulator simulator(result.signature, result.verilog_text,
+                            GetSimulator());
+  EXPECT_THAT(simulator.Run({{"x", Value(UBits(200, 8))},
+                             {"y", Value(UBits(100, 8))},
+                             {"z", Value(UBits(1000, 16))}}),
+              IsOkAndHolds(Value(UBits(1044, 16))));
+}
+
+TEST_P(ResourceSharedGeneratorTest, InvalidOptions) {
+  Package package(TestBaseName());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, BuildMultiplyAccumulate(&package));
+  EXPECT_THAT(ScheduleWithResourceLimits(f, {{Op::kAnd, 1}}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("cannot be resource limited")));
+  EXPECT_THAT(ScheduleWithResourceLimits(f, {{Op::kUMul, 0}}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be positive")));
+
+  ResourceSharingOptions options;
+  options.resource_limit(Op::kUMul, 1);
+  EXPECT_THAT(GenerateResourceSharedModule(f, options).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires a reset")));
+}
+
+INSTANTIATE_TEST_SUITE_P(ResourceSharedGeneratorTestInstantiation,
+                         ResourceSharedGeneratorTest,
+                         testing::ValuesIn(kDefaultSimulationTargets),
+                         ParameterizedTestName<ResourceSharedGeneratorTest>);
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -21,9 +21,12 @@
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "xls/codegen/finite_state_machine.h"
@@ -38,6 +41,9 @@
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/function.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/package.h"
 #include "xls/ir/type.h"
 #include "xls/passes/passes.h"
 #include "xls/scheduling/pipeline_schedule.h"
@@ -49,7 +55,7 @@ using Register = ModuleBuilder::Register;
 
 absl::Status SequentialModuleBuilder::AddFsm(
     int64_t pipeline_latency, LogicRef* index_holds_max_inclusive_value,
-    LogicRef* last_pipeline_cycle_wire) {
+    LogicRef* last_pipeline_cycle_wire, LogicRef* running_done) {
   // Configure reset options.
   const absl::optional<ResetProto>* reset_options =
       &sequential_options_.reset();
@@ -127,8 +133,10 @@ absl::Status SequentialModuleBuilder::AddFsm(
       .OnCondition(port_references_.valid_in.value())
       .NextState(running_state);
   running_state
-      ->OnCondition(file_.BitwiseAnd(index_holds_max_inclusive_value,
-                                     fsm_last_pipeline_cycle->logic_ref))
+      ->OnCondition(running_done != nullptr
+                        ? static_cast<Expression*>(running_done)
+                        : file_.BitwiseAnd(index_holds_max_inclusive_value,
+                                           fsm_last_pipeline_cycle->logic_ref))
       .NextState(done_state);
   done_state->SetOutput(fsm_valid_out, 1)
       .OnCondition(port_references_.ready_out.value())
@@ -219,6 +227,127 @@ absl::Status SequentialModuleBuilder::AddSequentialLogic() {
   return absl::OkStatus();
 }
 
+absl::Status SequentialModuleBuilder::AddOverlappedSequentialLogic() {
+  // Iteration k is issued during cycles [k * II, (k + 1) * II) of the running
+  // state: the index register holds k and the issue pipeline starts on it.
+  // The issue pipeline's results for iteration k arrive issue_latency cycles
+  // later and are held for II cycles, during which the recurrence pipeline
+  // (latency < II) combines them with the accumulator. The accumulator is
+  // updated in the last of those cycles.
+  XLS_CHECK_EQ(port_references_.data_out.size(), 1);
+  LogicRef* iteration_end =
+      module_builder_->DeclareVariable("iteration_end", 1);
+  LogicRef* recurrence_output = module_builder_->DeclareVariable(
+      "recurrence_output", module_signature()->data_outputs().at(0).width());
+  LogicRef* ready_in = port_references_.ready_in.value();
+
+  // Whether iterations are still being issued. Cleared once the last
+  // iteration has been issued so that the index counter stays put while the
+  // issue pipeline drains.
+  LogicRef* issue_end = module_builder_->DeclareVariable("issue_end", 1);
+  LogicRef* index_holds_max =
+      module_builder_->DeclareVariable("index_holds_max", 1);
+  XLS_ASSIGN_OR_RETURN(
+      Register issuing_register,
+      module_builder_->DeclareRegister("issuing", 1, ready_in,
+                                       file_.PlainLiteral(0)));
+  XLS_RETURN_IF_ERROR(module_builder_->AssignRegisters(
+      {issuing_register},
+      file_.BitwiseOr(ready_in, file_.BitwiseAnd(issue_end, index_holds_max))));
+  AddContinuousAssignment(
+      issue_end, file_.BitwiseAnd(iteration_end, issuing_register.ref));
+
+  // Add index counter.
+  XLS_ASSIGN_OR_RETURN(
+      StridedCounterReferences index_references,
+      AddStaticStridedCounter("index_counter", loop_->stride(),
+                              loop_->stride() * loop_->trip_count(),
+                              port_references_.clk, ready_in, issue_end));
+  AddContinuousAssignment(index_holds_max,
+                          index_references.holds_max_inclusive_value);
+
+  // Delay the end of each issue interval by the issue pipeline latency to find
+  // the cycles in which the accumulator is updated.
+  int64_t issue_latency =
+      issue_pipeline_result_ == nullptr
+          ? 0
+          : issue_pipeline_result_->signature.proto().pipeline().latency();
+  Expression* accumulate = issue_end;
+  Expression* last_accumulate = file_.BitwiseAnd(issue_end, index_holds_max);
+  for (int64_t stage = 0; stage < issue_latency; ++stage) {
+    XLS_ASSIGN_OR_RETURN(
+        Register accumulate_register,
+        module_builder_->DeclareRegister(absl::StrCat("accumulate_", stage), 1,
+                                         accumulate, file_.PlainLiteral(0)));
+    XLS_ASSIGN_OR_RETURN(Register last_accumulate_register,
+                         module_builder_->DeclareRegister(
+                             absl::StrCat("last_accumulate_", stage), 1,
+                             last_accumulate, file_.PlainLiteral(0)));
+    XLS_RETURN_IF_ERROR(module_builder_->AssignRegisters(
+        {accumulate_register, last_accumulate_register}));
+    accumulate = accumulate_register.ref;
+    last_accumulate = last_accumulate_register.ref;
+  }
+  LogicRef* running_done =
+      DeclareVariableAndAssign("last_accumulate", last_accumulate, 1);
+
+  // Add FSM. Its pipeline counter marks the end of each issue interval.
+  XLS_RETURN_IF_ERROR(AddFsm(initiation_interval_ - 1, index_holds_max,
+                             iteration_end, running_done));
+
+  auto make_register = [&](Expression* next, const PortProto* port_proto) {
+    return module_builder_->DeclareRegister(port_proto->name() + "_register",
+                                            port_proto->width(), next);
+  };
+  // Add accumulator register.
+  XLS_ASSIGN_OR_RETURN(
+      Register accumulator_register,
+      make_register(file_.Ternary(ready_in, port_references_.data_in.at(0),
+                                  recurrence_output),
+                    &module_signature_->data_outputs().at(0)));
+  XLS_RETURN_IF_ERROR(module_builder_->AssignRegisters(
+      {accumulator_register}, file_.BitwiseOr(ready_in, accumulate)));
+
+  // Add registers for invariants.
+  int64_t num_inputs = port_references_.data_in.size();
+  std::vector<Register> invariant_registers;
+  invariant_registers.resize(num_inputs - 1);
+  for (int64_t input_idx = 1; input_idx < num_inputs; ++input_idx) {
+    XLS_ASSIGN_OR_RETURN(
+        invariant_registers.at(input_idx - 1),
+        make_register(port_references_.data_in.at(input_idx),
+                      &module_signature_->data_inputs().at(input_idx)));
+  }
+  XLS_RETURN_IF_ERROR(
+      module_builder_->AssignRegisters(invariant_registers, ready_in));
+
+  // Add the issue and recurrence pipelines.
+  std::vector<Expression*> recurrence_inputs = {accumulator_register.ref};
+  if (issue_pipeline_result_ != nullptr) {
+    LogicRef* issue_output = module_builder_->DeclareVariable(
+        "issue_output",
+        issue_function_->return_value()->GetType()->GetFlatBitCount());
+    std::vector<Expression*> issue_inputs = {index_references.value};
+    for (const Register& reg : invariant_registers) {
+      issue_inputs.push_back(reg.ref);
+    }
+    XLS_RETURN_IF_ERROR(InstantiatePipeline(
+        *issue_pipeline_result_, "loop_body_issue", issue_inputs,
+        issue_output));
+    recurrence_inputs.push_back(issue_output);
+  }
+  XLS_RETURN_IF_ERROR(InstantiatePipeline(*recurrence_pipeline_result_,
+                                          "loop_body_recurrence",
+                                          recurrence_inputs,
+                                          recurrence_output));
+
+  // Drive output.
+  AddContinuousAssignment(port_references_.data_out.at(0),
+                          accumulator_register.ref);
+
+  return absl::OkStatus();
+}
+
 absl::StatusOr<SequentialModuleBuilder::StridedCounterReferences>
 SequentialModuleBuilder::AddStaticStridedCounter(
     std::string name, int64_t stride, int64_t value_limit_exclusive,
@@ -286,16 +415,25 @@ SequentialModuleBuilder::AddStaticStridedCounter(
 }
 
 absl::StatusOr<ModuleGeneratorResult> SequentialModuleBuilder::Build() {
-  // Generate the loop body module.
-  absl::StatusOr<std::unique_ptr<ModuleGeneratorResult>> loop_body_status =
-      GenerateLoopBodyPipeline();
-  XLS_RETURN_IF_ERROR(loop_body_status.status());
-  loop_body_pipeline_result_ = std::move(loop_body_status.value());
-  XLS_RET_CHECK(loop_body_pipeline_result_->signature.proto().has_pipeline());
-  XLS_CHECK_EQ(loop_body_pipeline_result_->signature.proto()
-                   .pipeline()
-                   .initiation_interval(),
-               1);
+  // Generate the loop body module(s).
+  bool overlapped = sequential_options_.initiation_interval().has_value();
+  if (overlapped) {
+    XLS_RETURN_IF_ERROR(GenerateOverlappedPipelines());
+  } else {
+    absl::StatusOr<std::unique_ptr<ModuleGeneratorResult>> loop_body_status =
+        GenerateLoopBodyPipeline();
+    XLS_RETURN_IF_ERROR(loop_body_status.status());
+    loop_body_pipeline_result_ = std::move(loop_body_status.value());
+    XLS_RET_CHECK(
+        loop_body_pipeline_result_->signature.proto().has_pipeline());
+    XLS_CHECK_EQ(loop_body_pipeline_result_->signature.proto()
+                     .pipeline()
+                     .initiation_interval(),
+                 1);
+    initiation_interval_ =
+        loop_body_pipeline_result_->signature.proto().pipeline().latency() +
+        1;
+  }
 
   // Get the module signature.
   absl::StatusOr<std::unique_ptr<ModuleSignature>> signature_result =
@@ -307,13 +445,23 @@ absl::StatusOr<ModuleGeneratorResult> SequentialModuleBuilder::Build() {
   XLS_RETURN_IF_ERROR(InitializeModuleBuilder(*module_signature_.get()));
 
   // Add internal logic.
-  XLS_RETURN_IF_ERROR(AddSequentialLogic());
+  if (overlapped) {
+    XLS_RETURN_IF_ERROR(AddOverlappedSequentialLogic());
+  } else {
+    XLS_RETURN_IF_ERROR(AddSequentialLogic());
+  }
 
   // Create result.
   ModuleGeneratorResult result;
   result.signature = *module_signature();
-  result.verilog_text.append(loop_body_pipeline_result_->verilog_text);
-  result.verilog_text.append("\n");
+  for (const ModuleGeneratorResult* pipeline :
+       {loop_body_pipeline_result_.get(), issue_pipeline_result_.get(),
+        recurrence_pipeline_result_.get()}) {
+    if (pipeline != nullptr) {
+      result.verilog_text.append(pipeline->verilog_text);
+      result.verilog_text.append("\n");
+    }
+  }
   result.verilog_text.append(module_builder_->module()->Emit());
 
   return result;
@@ -370,6 +518,191 @@ SequentialModuleBuilder::GenerateModuleSignature() {
 
 absl::StatusOr<std::unique_ptr<ModuleGeneratorResult>>
 SequentialModuleBuilder::GenerateLoopBodyPipeline() {
+  return GeneratePipeline(loop_->body(),
+                          sequential_options_.pipeline_scheduling_options());
+}
+
+absl::Status SequentialModuleBuilder::GenerateOverlappedPipelines() {
+  int64_t requested_ii = sequential_options_.initiation_interval().value();
+  if (requested_ii < 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Initiation interval must be non-negative, got %d", requested_ii));
+  }
+  XLS_RETURN_IF_ERROR(SplitLoopBody());
+
+  if (issue_function_ != nullptr) {
+    XLS_ASSIGN_OR_RETURN(
+        issue_pipeline_result_,
+        GeneratePipeline(issue_function_,
+                         sequential_options_.pipeline_scheduling_options()));
+  }
+
+  // The recurrence is scheduled for the same clock period as the loop body.
+  // Without a clock period it is left combinational so the interval is one
+  // cycle.
+  const SchedulingOptions& body_options =
+      sequential_options_.pipeline_scheduling_options();
+  SchedulingOptions recurrence_options;
+  if (body_options.clock_period_ps().has_value()) {
+    recurrence_options.clock_period_ps(body_options.clock_period_ps().value());
+    if (body_options.clock_margin_percent().has_value()) {
+      recurrence_options.clock_margin_percent(
+          body_options.clock_margin_percent().value());
+    }
+  } else {
+    recurrence_options.pipeline_stages(1);
+  }
+  XLS_ASSIGN_OR_RETURN(
+      recurrence_pipeline_result_,
+      GeneratePipeline(recurrence_function_, recurrence_options));
+
+  // The accumulator for the next iteration must be available by the time the
+  // recurrence starts on it.
+  int64_t min_ii =
+      recurrence_pipeline_result_->signature.proto().pipeline().latency() + 1;
+  if (requested_ii != 0 && requested_ii < min_ii) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Initiation interval %d is less than the minimum of %d imposed by the "
+        "loop-carried dependence through the accumulator of %s",
+        requested_ii, min_ii, loop_->GetName()));
+  }
+  initiation_interval_ = requested_ii == 0 ? min_ii : requested_ii;
+  return absl::OkStatus();
+}
+
+absl::Status SequentialModuleBuilder::SplitLoopBody() {
+  Function* body = loop_->body();
+  XLS_RET_CHECK_GE(body->params().size(), 2);
+  Param* accumulator = body->param(1);
+
+  // The recurrence is every node which transitively depends on the
+  // accumulator. Everything else can be computed ahead of time.
+  absl::flat_hash_set<Node*> recurrence;
+  for (Node* node : TopoSort(body)) {
+    if (node->Is<CountedFor>() || node->Is<DynamicCountedFor>() ||
+        node->Is<Invoke>() || node->Is<Map>()) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Overlapped iterations do not support loop bodies which call other "
+          "functions: %s",
+          node->GetName()));
+    }
+    if (node == accumulator ||
+        std::any_of(node->operands().begin(), node->operands().end(),
+                    [&](Node* n) { return recurrence.contains(n); })) {
+      recurrence.insert(node);
+    }
+  }
+
+  // Values crossing from the issued part into the recurrence. Literals are
+  // duplicated rather than passed along.
+  std::vector<Node*> cut;
+  absl::flat_hash_map<Node*, int64_t> cut_index;
+  auto add_to_cut = [&](Node* node) {
+    if (!recurrence.contains(node) && !node->Is<xls::Literal>() &&
+        !cut_index.contains(node)) {
+      cut_index[node] = cut.size();
+      cut.push_back(node);
+    }
+  };
+  for (Node* node : recurrence) {
+    for (Node* operand : node->operands()) {
+      add_to_cut(operand);
+    }
+  }
+  add_to_cut(body->return_value());
+  // Order the cut deterministically.
+  std::vector<Node*> ordered_cut;
+  for (Node* node : TopoSort(body)) {
+    if (cut_index.contains(node)) {
+      cut_index[node] = ordered_cut.size();
+      ordered_cut.push_back(node);
+    }
+  }
+  cut = std::move(ordered_cut);
+
+  split_package_ = absl::make_unique<Package>(body->package()->name());
+  absl::optional<SourceLocation> loc = body->return_value()->loc();
+
+  // Issue function: (index, invariants...) -> (cut...).
+  absl::optional<Type*> cut_type;
+  if (!cut.empty()) {
+    issue_function_ = split_package_->AddFunction(absl::make_unique<Function>(
+        absl::StrCat(body->name(), "_issue"), split_package_.get()));
+    absl::flat_hash_map<Node*, Node*> issue_nodes;
+    for (Node* node : TopoSort(body)) {
+      if (recurrence.contains(node)) {
+        continue;
+      }
+      std::vector<Node*> operands;
+      for (Node* operand : node->operands()) {
+        operands.push_back(issue_nodes.at(operand));
+      }
+      XLS_ASSIGN_OR_RETURN(issue_nodes[node],
+                           node->CloneInNewFunction(operands, issue_function_));
+    }
+    std::vector<Node*> elements;
+    for (Node* node : cut) {
+      elements.push_back(issue_nodes.at(node));
+    }
+    XLS_ASSIGN_OR_RETURN(Node * issued,
+                         issue_function_->MakeNode<Tuple>(loc, elements));
+    XLS_RETURN_IF_ERROR(issue_function_->set_return_value(issued));
+    cut_type = issued->GetType();
+  }
+
+  // Recurrence function: (acc, issued) -> acc'.
+  recurrence_function_ =
+      split_package_->AddFunction(absl::make_unique<Function>(
+          absl::StrCat(body->name(), "_recurrence"), split_package_.get()));
+  absl::flat_hash_map<Node*, Node*> recurrence_nodes;
+  XLS_ASSIGN_OR_RETURN(
+      recurrence_nodes[accumulator],
+      accumulator->CloneInNewFunction({}, recurrence_function_));
+  Node* issued_param = nullptr;
+  if (cut_type.has_value()) {
+    XLS_ASSIGN_OR_RETURN(issued_param,
+                         recurrence_function_->MakeNodeWithName<Param>(
+                             loc, "issued", cut_type.value()));
+  }
+  auto get_recurrence_node = [&](Node* node) -> absl::StatusOr<Node*> {
+    auto it = recurrence_nodes.find(node);
+    if (it != recurrence_nodes.end()) {
+      return it->second;
+    }
+    Node* new_node;
+    if (node->Is<xls::Literal>()) {
+      XLS_ASSIGN_OR_RETURN(new_node,
+                           node->CloneInNewFunction({}, recurrence_function_));
+    } else {
+      XLS_RET_CHECK(issued_param != nullptr);
+      XLS_ASSIGN_OR_RETURN(new_node,
+                           recurrence_function_->MakeNode<TupleIndex>(
+                               node->loc(), issued_param, cut_index.at(node)));
+    }
+    recurrence_nodes[node] = new_node;
+    return new_node;
+  };
+  for (Node* node : TopoSort(body)) {
+    if (node == accumulator || !recurrence.contains(node)) {
+      continue;
+    }
+    std::vector<Node*> operands;
+    for (Node* operand : node->operands()) {
+      XLS_ASSIGN_OR_RETURN(Node * new_operand, get_recurrence_node(operand));
+      operands.push_back(new_operand);
+    }
+    XLS_ASSIGN_OR_RETURN(
+        recurrence_nodes[node],
+        node->CloneInNewFunction(operands, recurrence_function_));
+  }
+  XLS_ASSIGN_OR_RETURN(Node * return_value,
+                       get_recurrence_node(body->return_value()));
+  return recurrence_function_->set_return_value(return_value);
+}
+
+absl::StatusOr<std::unique_ptr<ModuleGeneratorResult>>
+SequentialModuleBuilder::GeneratePipeline(
+    Function* function, const SchedulingOptions& scheduling_options) {
   // Set pipeline options.
   PipelineOptions pipeline_options;
   pipeline_options.flop_inputs(false).flop_outputs(false).use_system_verilog(
@@ -379,19 +712,16 @@ SequentialModuleBuilder::GenerateLoopBodyPipeline() {
   }
 
   // Get schedule.
-  Function* loop_body_function = loop_->body();
   XLS_ASSIGN_OR_RETURN(
       PipelineSchedule schedule,
-      PipelineSchedule::Run(loop_body_function,
-                            *sequential_options_.delay_estimator(),
-                            sequential_options_.pipeline_scheduling_options()));
+      PipelineSchedule::Run(function, *sequential_options_.delay_estimator(),
+                            scheduling_options));
   XLS_RETURN_IF_ERROR(schedule.Verify());
 
   std::unique_ptr<ModuleGeneratorResult> result =
       absl::make_unique<ModuleGeneratorResult>();
   XLS_ASSIGN_OR_RETURN(
-      *result,
-      ToPipelineModuleText(schedule, loop_body_function, pipeline_options));
+      *result, ToPipelineModuleText(schedule, function, pipeline_options));
   return std::move(result);
 }
 
@@ -508,6 +838,29 @@ absl::Status SequentialModuleBuilder::InstantiateLoopBody(
   return absl::OkStatus();
 }
 
+absl::Status SequentialModuleBuilder::InstantiatePipeline(
+    const ModuleGeneratorResult& pipeline, absl::string_view instance_name,
+    absl::Span<Expression* const> inputs, LogicRef* output) {
+  const ModuleSignatureProto& proto = pipeline.signature.proto();
+  XLS_RET_CHECK_EQ(pipeline.signature.data_inputs().size(), inputs.size());
+  std::vector<Connection> connections;
+  for (int64_t i = 0; i < inputs.size(); ++i) {
+    connections.push_back(
+        {pipeline.signature.data_inputs().at(i).name(), inputs.at(i)});
+  }
+  XLS_RET_CHECK(proto.has_reset());
+  connections.push_back({proto.reset().name(), port_references_.reset.value()});
+  connections.push_back({proto.clock_name(), port_references_.clk});
+  connections.push_back({pipeline.signature.data_outputs().at(0).name(),
+                         output});
+  module_builder_->assignment_section()->Add<Instantiation>(
+      /*module_name=*/pipeline.signature.module_name(),
+      /*instance_name=*/instance_name,
+      /*parameters=*/std::vector<Connection>(),
+      /*connections=*/connections);
+  return absl::OkStatus();
+}
+
 absl::StatusOr<ModuleGeneratorResult> ToSequentialModuleText(Function* func) {
   return absl::UnimplementedError(
       "Sequential generator does not yet support arbitrary functions.");
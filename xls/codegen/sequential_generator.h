@@ -32,6 +32,7 @@
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/function.h"
+#include "xls/ir/package.h"
 #include "xls/scheduling/pipeline_schedule.h"
 
 namespace xls {
@@ -75,6 +76,21 @@ class SequentialOptions {
     return pipeline_scheduling_options_;
   }
 
+  // Number of cycles between the starts of consecutive loop iterations. If
+  // given, iterations overlap: the part of the loop body which does not depend
+  // on the accumulator is pipelined and issued every 'value' cycles, and only
+  // the loop-carried recurrence must complete within each interval. A value of
+  // 0 selects the smallest interval the recurrence allows. If not given, each
+  // iteration runs the whole loop body pipeline to completion before the next
+  // one starts.
+  SequentialOptions& initiation_interval(int64_t value) {
+    initiation_interval_ = value;
+    return *this;
+  }
+  absl::optional<int64_t> initiation_interval() const {
+    return initiation_interval_;
+  }
+
   // Whether to use SystemVerilog in the generated code, otherwise Verilog is
   // used. The default is to use SystemVerilog.
   SequentialOptions& use_system_verilog(bool value) {
@@ -88,6 +104,7 @@ class SequentialOptions {
   absl::optional<std::string> module_name_;
   absl::optional<ResetProto> reset_proto_;
   SchedulingOptions pipeline_scheduling_options_;
+  absl::optional<int64_t> initiation_interval_;
   bool use_system_verilog_ = true;
   // TODO(jbaileyhandle): Interface options.
 };
@@ -129,10 +146,13 @@ class SequentialModuleBuilder {
     LogicRef* holds_max_inclusive_value;
   };
 
-  // Adds the FSM that orchestrates the sequential module's execution.
+  // Adds the FSM that orchestrates the sequential module's execution. If
+  // 'running_done' is given, the FSM leaves the running state when it is high
+  // rather than at the last pipeline cycle of the last iteration.
   absl::Status AddFsm(int64_t pipeline_latency,
                       LogicRef* index_holds_max_inclusive_value,
-                      LogicRef* last_pipeline_cycle);
+                      LogicRef* last_pipeline_cycle,
+                      LogicRef* running_done = nullptr);
 
   // Adds a strided counter with statically determined value_limit_exclusive to
   // the module. Note that this is not a saturating counter.
@@ -158,11 +178,31 @@ class SequentialModuleBuilder {
   // Initializes the module builder according to the signature.
   absl::Status InitializeModuleBuilder(const ModuleSignature& signature);
 
+  // Splits the loop body into an issue function computing everything which does
+  // not depend on the accumulator, and a recurrence function computing the next
+  // accumulator value from the current one and the issue function's results.
+  absl::Status SplitLoopBody();
+
   // Accessor methods.
   const VerilogFile* file() const { return &file_; }
+  // The loop body pipeline. Null if iterations overlap.
   const ModuleGeneratorResult* loop_result() const {
     return loop_body_pipeline_result_.get();
   }
+  // The pipelines implementing the split loop body when iterations overlap.
+  // The issue pipeline is null if no part of the body is independent of the
+  // accumulator.
+  const ModuleGeneratorResult* issue_result() const {
+    return issue_pipeline_result_.get();
+  }
+  const ModuleGeneratorResult* recurrence_result() const {
+    return recurrence_pipeline_result_.get();
+  }
+  Function* issue_function() const { return issue_function_; }
+  Function* recurrence_function() const { return recurrence_function_; }
+  // Number of cycles between the starts of consecutive iterations. Valid after
+  // Build().
+  int64_t initiation_interval() const { return initiation_interval_; }
   Module* module() { return module_builder_->module(); }
   ModuleBuilder* module_builder() { return module_builder_.get(); }
   const ModuleSignature* module_signature() const {
@@ -174,6 +214,24 @@ class SequentialModuleBuilder {
   // Adds all interal logic to the sequential module.
   absl::Status AddSequentialLogic();
 
+  // Adds the internal logic of a sequential module whose iterations overlap.
+  absl::Status AddOverlappedSequentialLogic();
+
+  // Splits and pipelines the loop body for overlapped iterations and
+  // determines the initiation interval.
+  absl::Status GenerateOverlappedPipelines();
+
+  // Schedules the given function and generates a pipeline module for it.
+  absl::StatusOr<std::unique_ptr<ModuleGeneratorResult>> GeneratePipeline(
+      Function* function, const SchedulingOptions& scheduling_options);
+
+  // Instantiates the given pipeline with its data inputs driven by 'inputs'
+  // and its data output driving 'output'.
+  absl::Status InstantiatePipeline(const ModuleGeneratorResult& pipeline,
+                                   absl::string_view instance_name,
+                                   absl::Span<Expression* const> inputs,
+                                   LogicRef* output);
+
   // Declares and assigns a wire, returning a logical reference to the wire.
   LogicRef* DeclareVariableAndAssign(absl::string_view name, Expression* rhs,
                                      int64_t bit_count) {
@@ -191,6 +249,12 @@ class SequentialModuleBuilder {
   VerilogFile file_;
   const CountedFor* loop_;
   std::unique_ptr<ModuleGeneratorResult> loop_body_pipeline_result_;
+  std::unique_ptr<Package> split_package_;
+  Function* issue_function_ = nullptr;
+  Function* recurrence_function_ = nullptr;
+  std::unique_ptr<ModuleGeneratorResult> issue_pipeline_result_;
+  std::unique_ptr<ModuleGeneratorResult> recurrence_pipeline_result_;
+  int64_t initiation_interval_ = 0;
   std::unique_ptr<ModuleBuilder> module_builder_;
   std::unique_ptr<ModuleSignature> module_signature_;
   absl::flat_hash_map<LogicRef*, Expression*> output_reg_to_assignment_;
@@ -52,6 +52,8 @@ namespace verilog {
 namespace {
 
 using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
 
 constexpr char kTestName[] = "sequential_generator_test";
 constexpr char kTestdataPath[] = "xls/codegen/testdata";
@@ -64,6 +66,8 @@ class TestDelayEstimator : public DelayEstimator {
       case Op::kLiteral:
       case Op::kBitSlice:
       case Op::kConcat:
+      case Op::kTuple:
+      case Op::kTupleIndex:
         return 0;
       default:
         return 1;
@@ -1883,6 +1887,102 @@ fn __SequentialModuleSimple__main(init_acc: bits[32]) -> bits[32] {
   }
 }
 
+constexpr char kOverlappedIr[] = R"(
+package SequentialModuleOverlapped
+
+fn ____SequentialModuleOverlapped__main_counted_for_0_body(index: bits[32], acc: bits[32], invar: bits[32]) -> bits[32] {
+  umul.1: bits[32] = umul(index, invar, pos=0,2,8)
+  add.2: bits[32] = add(umul.1, invar, pos=0,2,16)
+  add.3: bits[32] = add(acc, add.2, pos=0,2,24)
+  ret add.4: bits[32] = add(add.3, index, pos=0,2,32)
+}
+
+fn __SequentialModuleOverlapped__main(init_acc: bits[32], invar: bits[32]) -> bits[32] {
+  ret counted_for.5: bits[32] = counted_for(init_acc, trip_count=4, stride=1, body=____SequentialModuleOverlapped__main_counted_for_0_body, invariant_args=[invar], pos=0,1,5)
+}
+)";
+
+TEST_P(SequentialGeneratorTest, SequentialModuleOverlappedIterations) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kOverlappedIr));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->EntryFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(Node * node_loop, main->GetNode("counted_for.5"));
+  CountedFor* loop = node_loop->As<CountedFor>();
+
+  for (int64_t latency = 0; latency < 3; ++latency) {
+    for (int64_t ii : {0, 1, 3}) {
+      ResetProto reset;
+      reset.set_name("reset");
+      reset.set_asynchronous(false);
+      reset.set_active_low(false);
+      SequentialOptions sequential_options;
+      sequential_options.use_system_verilog(UseSystemVerilog());
+      sequential_options.reset(reset);
+      sequential_options.pipeline_scheduling_options().pipeline_stages(
+          latency + 1);
+      sequential_options.initiation_interval(ii);
+      SequentialModuleBuilder builder(sequential_options, loop);
+      XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result, builder.Build());
+      EXPECT_EQ(builder.initiation_interval(), ii == 0 ? 1 : ii);
+      EXPECT_EQ(builder.loop_result(), nullptr);
+
+      // The accumulator-independent part gets the index and invariant, and
+      // the recurrence gets the accumulator and the issued values.
+      ASSERT_NE(builder.issue_function(), nullptr);
+      EXPECT_EQ(builder.issue_function()->params().size(), 2);
+      EXPECT_EQ(builder.recurrence_function()->params().size(), 2);
+      EXPECT_EQ(
+          builder.issue_result()->signature.proto().pipeline().latency(),
+          latency);
+
+      // Sum over i in [0, 4) of (3 * i + 3 + i).
+      ModuleSimulator simulator(result.signature, result.verilog_text,
+                                GetSimulator());
+      EXPECT_THAT(simulator.Run({{"init_acc_in", Value(UBits(100, 32))},
+                                 {"invar_in", Value(UBits(3, 32))}}),
+                  IsOkAndHolds(Value(UBits(136, 32))));
+    }
+  }
+}
+
+TEST_P(SequentialGeneratorTest, SequentialModuleOverlappedMinimumInterval) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kOverlappedIr));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->EntryFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(Node * node_loop, main->GetNode("counted_for.5"));
+  CountedFor* loop = node_loop->As<CountedFor>();
+
+  // With one operation per stage the recurrence (two adds) takes two cycles,
+  // so an iteration can start at most every other cycle.
+  TestDelayEstimator delay_estimator;
+  ResetProto reset;
+  reset.set_name("reset");
+  reset.set_asynchronous(false);
+  reset.set_active_low(false);
+  SequentialOptions sequential_options;
+  sequential_options.use_system_verilog(UseSystemVerilog());
+  sequential_options.reset(reset);
+  sequential_options.delay_estimator(&delay_estimator);
+  sequential_options.pipeline_scheduling_options().clock_period_ps(1);
+
+  sequential_options.initiation_interval(1);
+  EXPECT_THAT(ToSequentialModuleText(sequential_options, loop).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("less than the minimum of 2")));
+
+  sequential_options.initiation_interval(0);
+  SequentialModuleBuilder builder(sequential_options, loop);
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleGeneratorResult result, builder.Build());
+  EXPECT_EQ(builder.initiation_interval(), 2);
+  EXPECT_EQ(builder.issue_result()->signature.proto().pipeline().latency(),
+            1);
+  ModuleSimulator simulator(result.signature, result.verilog_text,
+                            GetSimulator());
+  EXPECT_THAT(simulator.Run({{"init_acc_in", Value(UBits(100, 32))},
+                             {"invar_in", Value(UBits(3, 32))}}),
+              IsOkAndHolds(Value(UBits(136, 32))));
+}
+
 // TODO(jbaileyhandle): Test module reset (active high and active low).
 
 INSTANTIATE_TEST_SUITE_P(SequentialGeneratorTestInstantiation,
@@ -22,7 +22,6 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/strip.h"
-#include "xls/common/indent.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/visitor.h"
@@ -33,6 +32,17 @@ namespace verilog {
 
 using absl::StrJoin;
 
+namespace {
+
+// Returns the text of the given node by emitting it to a string sink.
+std::string EmitToString(const VastNode& node) {
+  StringVerilogSink sink;
+  node.EmitTo(&sink);
+  return sink.Release();
+}
+
+}  // namespace
+
 std::string SanitizeIdentifier(absl::string_view name) {
   if (name.empty()) {
     return "_";
@@ -112,18 +122,16 @@ DataType* VerilogFile::UnpackedArrayType(int64_t element_bit_count,
 }
 
 std::string VerilogFile::Emit() const {
-  auto file_member_str = [](const FileMember& member) -> std::string {
-    return absl::visit(
-        Visitor{[](Include* m) -> std::string { return m->Emit(); },
-                [](Module* m) -> std::string { return m->Emit(); }},
-        member);
-  };
+  StringVerilogSink sink;
+  EmitTo(&sink);
+  return sink.Release();
+}
 
-  std::string out;
+void VerilogFile::EmitTo(VerilogSink* sink) const {
   for (const FileMember& member : members_) {
-    absl::StrAppend(&out, file_member_str(member), "\n");
+    absl::visit([sink](VastNode* m) { m->EmitTo(sink); }, member);
+    sink->Write("\n");
   }
-  return out;
 }
 
 LocalParamItemRef* LocalParam::AddItem(absl::string_view name,
@@ -144,19 +152,25 @@ std::string CaseArm::Emit() const {
       label_);
 }
 
-std::string StatementBlock::Emit() const {
+std::string StatementBlock::Emit() const { return EmitToString(*this); }
+
+void StatementBlock::EmitTo(VerilogSink* sink) const {
   // TODO(meheff): We can probably be smarter about optionally emitting the
   // begin/end.
   if (statements_.empty()) {
-    return "begin end";
-  }
-  std::string result = "begin\n";
-  std::vector<std::string> lines;
-  for (const auto& statement : statements_) {
-    lines.push_back(statement->Emit());
+    sink->Write("begin end");
+    return;
+  }
+  sink->Write("begin\n");
+  sink->IncreaseIndent();
+  for (int64_t i = 0; i < statements_.size(); ++i) {
+    if (i != 0) {
+      sink->Write("\n");
+    }
+    statements_[i]->EmitTo(sink);
   }
-  absl::StrAppend(&result, Indent(absl::StrJoin(lines, "\n")), "\nend");
-  return result;
+  sink->DecreaseIndent();
+  sink->Write("\nend");
 }
 
 Port Port::FromProto(const PortProto& proto, VerilogFile* f) {
@@ -220,21 +234,23 @@ LogicRef* VerilogFunction::return_value_ref() {
   return file()->Make<LogicRef>(return_value_def_);
 }
 
-std::string VerilogFunction::Emit() const {
-  std::vector<std::string> lines;
+std::string VerilogFunction::Emit() const { return EmitToString(*this); }
+
+void VerilogFunction::EmitTo(VerilogSink* sink) const {
+  sink->Write(absl::StrFormat(
+      "function automatic%s (%s);\n",
+      return_value_def_->data_type()->EmitWithIdentifier(name()),
+      absl::StrJoin(argument_defs_, ", ", [](std::string* out, RegDef* d) {
+        absl::StrAppend(out, "input ", d->EmitNoSemi());
+      })));
+  sink->IncreaseIndent();
   for (RegDef* reg_def : block_reg_defs_) {
-    lines.push_back(reg_def->Emit());
+    reg_def->EmitTo(sink);
+    sink->Write("\n");
   }
-  lines.push_back(statement_block_->Emit());
-  return absl::StrCat(
-      absl::StrFormat(
-          "function automatic%s (%s);\n",
-          return_value_def_->data_type()->EmitWithIdentifier(name()),
-          absl::StrJoin(argument_defs_, ", ",
-                        [](std::string* out, RegDef* d) {
-                          absl::StrAppend(out, "input ", d->EmitNoSemi());
-                        })),
-      Indent(absl::StrJoin(lines, "\n")), "\nendfunction");
+  statement_block_->EmitTo(sink);
+  sink->DecreaseIndent();
+  sink->Write("\nendfunction");
 }
 
 std::string VerilogFunctionCall::Emit() const {
@@ -400,29 +416,6 @@ std::string RegDef::Emit() const {
   return result;
 }
 
-namespace {
-
-// "Match" statement for emitting a ModuleMember.
-std::string EmitModuleMember(const ModuleMember& member) {
-  return absl::visit(Visitor{[](Def* d) { return d->Emit(); },
-                             [](LocalParam* p) { return p->Emit(); },
-                             [](Parameter* p) { return p->Emit(); },
-                             [](Instantiation* i) { return i->Emit(); },
-                             [](ContinuousAssignment* c) { return c->Emit(); },
-                             [](Comment* c) { return c->Emit(); },
-                             [](BlankLine* b) { return b->Emit(); },
-                             [](RawStatement* s) { return s->Emit(); },
-                             [](StructuredProcedure* sp) { return sp->Emit(); },
-                             [](AlwaysComb* ac) { return ac->Emit(); },
-                             [](AlwaysFf* af) { return af->Emit(); },
-                             [](AlwaysFlop* af) { return af->Emit(); },
-                             [](VerilogFunction* f) { return f->Emit(); },
-                             [](ModuleSection* s) { return s->Emit(); }},
-                     member);
-}
-
-}  // namespace
-
 std::vector<ModuleMember> ModuleSection::GatherMembers() const {
   std::vector<ModuleMember> all_members;
   for (const ModuleMember& member : members_) {
@@ -438,12 +431,17 @@ std::vector<ModuleMember> ModuleSection::GatherMembers() const {
   return all_members;
 }
 
-std::string ModuleSection::Emit() const {
-  std::vector<std::string> elements;
+std::string ModuleSection::Emit() const { return EmitToString(*this); }
+
+void ModuleSection::EmitTo(VerilogSink* sink) const {
+  bool first = true;
   for (const ModuleMember& member : GatherMembers()) {
-    elements.push_back(EmitModuleMember(member));
+    if (!first) {
+      sink->Write("\n");
+    }
+    first = false;
+    absl::visit([sink](VastNode* m) { m->EmitTo(sink); }, member);
   }
-  return absl::StrJoin(elements, "\n");
 }
 
 std::string ContinuousAssignment::Emit() const {
@@ -492,7 +490,9 @@ std::string SystemFunctionCall::Emit() const {
   }
 }
 
-std::string Module::Emit() const {
+std::string Module::Emit() const { return EmitToString(*this); }
+
+void Module::EmitTo(VerilogSink* sink) const {
   std::string result = absl::StrCat("module ", name_);
   if (ports_.empty()) {
     absl::StrAppend(&result, ";\n");
@@ -506,9 +506,11 @@ std::string Module::Emit() const {
         }));
     absl::StrAppend(&result, "\n);\n");
   }
-  absl::StrAppend(&result, Indent(top_.Emit()), "\n");
-  absl::StrAppend(&result, "endmodule");
-  return result;
+  sink->Write(result);
+  sink->IncreaseIndent();
+  top_.EmitTo(sink);
+  sink->DecreaseIndent();
+  sink->Write("\nendmodule");
 }
 
 std::string Literal::Emit() const {
@@ -671,16 +673,18 @@ StatementBlock* Case::AddCaseArm(CaseLabel label) {
   return arms_.back()->statements();
 }
 
-std::string Case::Emit() const {
-  std::string result = absl::StrFormat("case (%s)\n", subject_->Emit());
+std::string Case::Emit() const { return EmitToString(*this); }
+
+void Case::EmitTo(VerilogSink* sink) const {
+  sink->Write(absl::StrFormat("case (%s)\n", subject_->Emit()));
+  sink->IncreaseIndent();
   for (auto& arm : arms_) {
-    absl::StrAppend(&result,
-                    Indent(absl::StrFormat("%s: %s", arm->Emit(),
-                                           arm->statements()->Emit())),
-                    "\n");
+    sink->Write(absl::StrCat(arm->Emit(), ": "));
+    arm->statements()->EmitTo(sink);
+    sink->Write("\n");
   }
-  absl::StrAppend(&result, "endcase");
-  return result;
+  sink->DecreaseIndent();
+  sink->Write("endcase");
 }
 
 Conditional::Conditional(Expression* condition, VerilogFile* file)
@@ -696,18 +700,18 @@ StatementBlock* Conditional::AddAlternate(Expression* condition) {
   return alternates_.back().second;
 }
 
-std::string Conditional::Emit() const {
-  std::string result;
-  absl::StrAppendFormat(&result, "if (%s) %s", condition_->Emit(),
-                        consequent()->Emit());
+std::string Conditional::Emit() const { return EmitToString(*this); }
+
+void Conditional::EmitTo(VerilogSink* sink) const {
+  sink->Write(absl::StrFormat("if (%s) ", condition_->Emit()));
+  consequent()->EmitTo(sink);
   for (auto& alternate : alternates_) {
-    absl::StrAppend(&result, " else ");
+    sink->Write(" else ");
     if (alternate.first != nullptr) {
-      absl::StrAppendFormat(&result, "if (%s) ", alternate.first->Emit());
+      sink->Write(absl::StrFormat("if (%s) ", alternate.first->Emit()));
     }
-    absl::StrAppend(&result, alternate.second->Emit());
+    alternate.second->EmitTo(sink);
   }
-  return result;
 }
 
 WhileStatement::WhileStatement(Expression* condition, VerilogFile* file)
@@ -779,24 +783,30 @@ std::string EmitSensitivityListElement(const SensitivityListElement& element) {
 
 }  // namespace
 
-std::string AlwaysBase::Emit() const {
-  return absl::StrFormat(
-      "%s @ (%s) %s", name(),
+std::string AlwaysBase::Emit() const { return EmitToString(*this); }
+
+void AlwaysBase::EmitTo(VerilogSink* sink) const {
+  sink->Write(absl::StrFormat(
+      "%s @ (%s) ", name(),
       absl::StrJoin(sensitivity_list_, " or ",
                     [](std::string* out, const SensitivityListElement& e) {
                       absl::StrAppend(out, EmitSensitivityListElement(e));
-                    }),
-      statements_->Emit());
+                    })));
+  statements_->EmitTo(sink);
 }
 
-std::string AlwaysComb::Emit() const {
-  return absl::StrFormat("%s %s", name(), statements_->Emit());
+std::string AlwaysComb::Emit() const { return EmitToString(*this); }
+
+void AlwaysComb::EmitTo(VerilogSink* sink) const {
+  sink->Write(absl::StrCat(name(), " "));
+  statements_->EmitTo(sink);
 }
 
-std::string Initial::Emit() const {
-  std::string result = "initial ";
-  absl::StrAppend(&result, statements_->Emit());
-  return result;
+std::string Initial::Emit() const { return EmitToString(*this); }
+
+void Initial::EmitTo(VerilogSink* sink) const {
+  sink->Write("initial ");
+  statements_->EmitTo(sink);
 }
 
 AlwaysFlop::AlwaysFlop(LogicRef* clk, Reset rst, VerilogFile* file)
@@ -833,17 +843,17 @@ void AlwaysFlop::AddRegister(LogicRef* reg, Expression* reg_next,
   assignment_block_->Add<NonblockingAssignment>(reg, reg_next);
 }
 
-std::string AlwaysFlop::Emit() const {
-  std::string result;
+std::string AlwaysFlop::Emit() const { return EmitToString(*this); }
+
+void AlwaysFlop::EmitTo(VerilogSink* sink) const {
   std::string sensitivity_list = absl::StrCat("posedge ", clk_->Emit());
   if (rst_.has_value() && rst_->asynchronous) {
     absl::StrAppendFormat(&sensitivity_list, " or %s %s",
                           (rst_->active_low ? "negedge" : "posedge"),
                           rst_->signal->Emit());
   }
-  absl::StrAppendFormat(&result, "always @ (%s) %s", sensitivity_list,
-                        top_block_->Emit());
-  return result;
+  sink->Write(absl::StrFormat("always @ (%s) ", sensitivity_list));
+  top_block_->EmitTo(sink);
 }
 
 std::string Instantiation::Emit() const {
@@ -28,9 +28,11 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "xls/codegen/module_signature.pb.h"
+#include "xls/codegen/verilog_sink.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/bits.h"
 
@@ -60,6 +62,11 @@ class VastNode {
 
   virtual std::string Emit() const = 0;
 
+  // Writes the text of the node to the sink. By default this writes the string
+  // returned by Emit. Nodes containing blocks of statements or module members
+  // override this to write their contents directly to the sink.
+  virtual void EmitTo(VerilogSink* sink) const { sink->Write(Emit()); }
+
  private:
   VerilogFile* file_;
 };
@@ -325,6 +332,7 @@ class StatementBlock : public VastNode {
   inline T* Add(Args&&... args);
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   std::vector<Statement*> statements_;
@@ -358,6 +366,7 @@ class Case : public Statement {
   StatementBlock* AddCaseArm(CaseLabel label);
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   Expression* subject_;
@@ -378,6 +387,7 @@ class Conditional : public Statement {
   StatementBlock* AddAlternate(Expression* condition = nullptr);
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   Expression* condition_;
@@ -707,6 +717,7 @@ class AlwaysFlop : public VastNode {
                    Expression* reset_value = nullptr);
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   LogicRef* clk_;
@@ -748,6 +759,7 @@ class AlwaysBase : public StructuredProcedure {
       : StructuredProcedure(file),
         sensitivity_list_(sensitivity_list.begin(), sensitivity_list.end()) {}
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  protected:
   virtual std::string name() const = 0;
@@ -771,6 +783,7 @@ class AlwaysComb : public AlwaysBase {
  public:
   explicit AlwaysComb(VerilogFile* file) : AlwaysBase({}, file) {}
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  protected:
   std::string name() const override { return "always_comb"; }
@@ -791,6 +804,7 @@ class Initial : public StructuredProcedure {
   using StructuredProcedure::StructuredProcedure;
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 };
 
 class Concat : public Expression {
@@ -1146,6 +1160,7 @@ class VerilogFunction : public VastNode {
   std::string name() const { return name_; }
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   std::string name_;
@@ -1224,6 +1239,7 @@ class ModuleSection : public VastNode {
   std::vector<ModuleMember> GatherMembers() const;
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   std::vector<ModuleMember> members_;
@@ -1291,6 +1307,7 @@ class Module : public VastNode {
   const std::string& name() const { return name_; }
 
   std::string Emit() const override;
+  void EmitTo(VerilogSink* sink) const override;
 
  private:
   // Add the given Def as a port on the module.
@@ -1333,17 +1350,23 @@ class VerilogFile {
     return member;
   }
 
+  // Creates a node owned by this file. Thread-safe: nodes may be made
+  // concurrently, for example when emitting pipeline stages in parallel.
   template <typename T, typename... Args>
   T* Make(Args&&... args) {
     std::unique_ptr<T> value =
         absl::make_unique<T>(std::forward<Args>(args)..., this);
     T* ptr = value.get();
+    absl::MutexLock lock(&nodes_mutex_);
     nodes_.push_back(std::move(value));
     return ptr;
   }
 
   std::string Emit() const;
 
+  // Writes the text of the file to the sink.
+  void EmitTo(VerilogSink* sink) const;
+
   verilog::Slice* Slice(IndexableExpression* subject, Expression* hi,
                         Expression* lo) {
     return Make<verilog::Slice>(subject, hi, lo);
@@ -1550,7 +1573,8 @@ class VerilogFile {
 
   bool use_system_verilog_;
   std::vector<FileMember> members_;
-  std::vector<std::unique_ptr<VastNode>> nodes_;
+  absl::Mutex nodes_mutex_;
+  std::vector<std::unique_ptr<VastNode>> nodes_ ABSL_GUARDED_BY(nodes_mutex_);
 };
 
 template <typename T, typename... Args>
@@ -0,0 +1,85 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/verilog_sink.h"
+
+#include "absl/memory/memory.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace verilog {
+
+void VerilogSink::Write(absl::string_view text) {
+  while (!text.empty()) {
+    size_t line_end = text.find('\n');
+    absl::string_view line = text.substr(0, line_end);
+    // Don't indent empty lines to avoid creating trailing white space.
+    if (!line.empty()) {
+      if (at_line_start_ && indent_ > 0) {
+        Append(std::string(indent_, ' '));
+      }
+      Append(line);
+      at_line_start_ = false;
+    }
+    if (line_end == absl::string_view::npos) {
+      break;
+    }
+    Append("\n");
+    at_line_start_ = true;
+    text.remove_prefix(line_end + 1);
+  }
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<FileVerilogSink>>
+FileVerilogSink::Create(const std::filesystem::path& path,
+                        int64_t buffer_size) {
+  XLS_RETURN_IF_ERROR(SetFileContents(path, ""));
+  return absl::WrapUnique(new FileVerilogSink(path, buffer_size));
+}
+
+FileVerilogSink::~FileVerilogSink() {
+  if (closed_) {
+    return;
+  }
+  absl::Status status = Close();
+  if (!status.ok()) {
+    XLS_LOG(ERROR) << "Error writing " << path_ << ": " << status;
+  }
+}
+
+absl::Status FileVerilogSink::Close() {
+  Flush();
+  closed_ = true;
+  return status_;
+}
+
+void FileVerilogSink::Append(absl::string_view text) {
+  buffer_.append(text.data(), text.size());
+  if (buffer_.size() >= buffer_size_) {
+    Flush();
+  }
+}
+
+void FileVerilogSink::Flush() {
+  if (!buffer_.empty() && status_.ok()) {
+    status_ = AppendStringToFile(path_, buffer_);
+  }
+  buffer_.clear();
+}
+
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,110 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_CODEGEN_VERILOG_SINK_H_
+#define XLS_CODEGEN_VERILOG_SINK_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace xls {
+namespace verilog {
+
+// Destination of emitted Verilog text. VAST nodes write their text into a
+// sink piece by piece rather than building the text of the whole file as one
+// string. The sink tracks the indentation level: every non-empty line is
+// indented by the level in effect when its first character is written, which
+// matches the output of xls::Indent applied to the text of a nested block.
+class VerilogSink {
+ public:
+  virtual ~VerilogSink() = default;
+
+  // Writes the given text, indenting each of its non-empty lines.
+  void Write(absl::string_view text);
+
+  // Increases or decreases the indentation of subsequent lines by two spaces.
+  void IncreaseIndent() { indent_ += 2; }
+  void DecreaseIndent() { indent_ -= 2; }
+
+ protected:
+  // Appends the given text to the output verbatim.
+  virtual void Append(absl::string_view text) = 0;
+
+ private:
+  int64_t indent_ = 0;
+  bool at_line_start_ = true;
+};
+
+// A sink which accumulates the text in a string.
+class StringVerilogSink : public VerilogSink {
+ public:
+  const std::string& text() const { return text_; }
+  std::string Release() { return std::move(text_); }
+
+ protected:
+  void Append(absl::string_view text) override {
+    text_.append(text.data(), text.size());
+  }
+
+ private:
+  std::string text_;
+};
+
+// A sink which writes the text to a file, buffering at most buffer_size bytes
+// in memory.
+class FileVerilogSink : public VerilogSink {
+ public:
+  static constexpr int64_t kDefaultBufferSize = 1 << 20;
+
+  // Creates the file (truncating any existing contents) and returns a sink
+  // writing to it.
+  static absl::StatusOr<std::unique_ptr<FileVerilogSink>> Create(
+      const std::filesystem::path& path,
+      int64_t buffer_size = kDefaultBufferSize);
+
+  // Closes the sink if it has not been closed, logging any error.
+  ~FileVerilogSink() override;
+
+  // Flushes the buffered text and returns the first error encountered while
+  // writing the file, if any.
+  absl::Status Close();
+
+ protected:
+  void Append(absl::string_view text) override;
+
+ private:
+  FileVerilogSink(const std::filesystem::path& path, int64_t buffer_size)
+      : path_(path), buffer_size_(buffer_size) {}
+
+  void Flush();
+
+  std::filesystem::path path_;
+  int64_t buffer_size_;
+  std::string buffer_;
+  absl::Status status_;
+  bool closed_ = false;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_VERILOG_SINK_H_
@@ -0,0 +1,72 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/codegen/verilog_sink.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/indent.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+TEST(VerilogSinkTest, IndentationMatchesIndent) {
+  StringVerilogSink sink;
+  sink.Write("begin\n");
+  sink.IncreaseIndent();
+  sink.Write("foo;\n\nbar");
+  sink.Write(" = baz;\n");
+  sink.IncreaseIndent();
+  sink.Write("qux;");
+  sink.DecreaseIndent();
+  sink.DecreaseIndent();
+  sink.Write("\nend");
+  EXPECT_EQ(sink.text(),
+            absl::StrCat("begin\n",
+                         Indent(absl::StrCat("foo;\n\nbar = baz;\n",
+                                             Indent("qux;"))),
+                         "\nend"));
+}
+
+TEST(VerilogSinkTest, FileSink) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent("stale contents"));
+  // Use a small buffer so the text is flushed in several writes.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<FileVerilogSink> sink,
+      FileVerilogSink::Create(temp_file.path(), /*buffer_size=*/4));
+  std::string expected;
+  for (int64_t i = 0; i < 100; ++i) {
+    std::string line = absl::StrCat("assign x", i, " = y;\n");
+    sink->Write(line);
+    expected += line;
+  }
+  XLS_ASSERT_OK(sink->Close());
+  EXPECT_THAT(GetFileContents(temp_file.path()), IsOkAndHolds(expected));
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,57 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/atomic_write.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>  // NOLINT
+
+#include "absl/strings/str_cat.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/error_code_to_status.h"
+
+namespace xls {
+
+std::filesystem::path UniqueTempPath(const std::filesystem::path& path) {
+  static std::atomic<int64_t> temp_count(0);
+  return absl::StrCat(path.string(), ".tmp.", getpid(), ".",
+                      std::hash<std::thread::id>()(std::this_thread::get_id()),
+                      ".", temp_count.fetch_add(1));
+}
+
+absl::Status AtomicSetFileContents(const std::filesystem::path& path,
+                                   absl::string_view contents) {
+  std::filesystem::path temp_path = UniqueTempPath(path);
+  absl::Status status = SetFileContents(temp_path, contents);
+  std::error_code ec;
+  if (status.ok()) {
+    std::filesystem::rename(temp_path, path, ec);
+    if (!ec) {
+      return absl::OkStatus();
+    }
+    status = ErrorCodeToStatus(ec)
+             << "Unable to rename " << temp_path.string() << " to "
+             << path.string();
+  }
+  std::filesystem::remove(temp_path, ec);
+  return status;
+}
+
+}  // namespace xls
@@ -0,0 +1,39 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_COMMON_FILE_ATOMIC_WRITE_H_
+#define XLS_COMMON_FILE_ATOMIC_WRITE_H_
+
+#include <filesystem>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace xls {
+
+// Returns a path next to "path" whose name is unique to the process, thread
+// and call, for building a file which is then renamed onto "path".
+std::filesystem::path UniqueTempPath(const std::filesystem::path& path);
+
+// Writes "contents" to "path" so that concurrent readers observe either the
+// previous file or the complete new one, never a partially-written file: the
+// contents are written to a temporary next to "path" whose name is unique to
+// the process, thread and call, and then renamed into place. On failure the
+// temporary is removed and "path" is left unchanged.
+absl::Status AtomicSetFileContents(const std::filesystem::path& path,
+                                   absl::string_view contents);
+
+}  // namespace xls
+
+#endif  // XLS_COMMON_FILE_ATOMIC_WRITE_H_
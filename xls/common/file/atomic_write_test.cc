@@ -0,0 +1,85 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/atomic_write.h"
+
+#include <filesystem>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using ::testing::AnyOf;
+using ::testing::ElementsAre;
+
+std::vector<std::string> DirectoryEntries(const std::filesystem::path& dir) {
+  std::vector<std::string> entries;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    entries.push_back(entry.path().filename().string());
+  }
+  return entries;
+}
+
+TEST(AtomicWriteTest, WritesAndReplaces) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "file";
+  XLS_ASSERT_OK(AtomicSetFileContents(path, "first"));
+  EXPECT_THAT(GetFileContents(path), IsOkAndHolds("first"));
+  XLS_ASSERT_OK(AtomicSetFileContents(path, "second"));
+  EXPECT_THAT(GetFileContents(path), IsOkAndHolds("second"));
+  EXPECT_THAT(DirectoryEntries(temp_dir.path()), ElementsAre("file"));
+}
+
+TEST(AtomicWriteTest, FailureLeavesNoFile) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  EXPECT_FALSE(
+      AtomicSetFileContents(temp_dir.path() / "missing" / "file", "x").ok());
+  // A directory in the way of the rename fails after the temporary is written.
+  std::filesystem::create_directory(temp_dir.path() / "dir");
+  std::filesystem::create_directory(temp_dir.path() / "dir" / "child");
+  EXPECT_FALSE(AtomicSetFileContents(temp_dir.path() / "dir", "x").ok());
+  EXPECT_THAT(DirectoryEntries(temp_dir.path()), ElementsAre("dir"));
+}
+
+TEST(AtomicWriteTest, ConcurrentWritersOfOnePath) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "file";
+  const std::string a(1 << 20, 'a');
+  const std::string b(1 << 20, 'b');
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < 4; ++j) {
+        XLS_EXPECT_OK(AtomicSetFileContents(path, i % 2 == 0 ? a : b));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(GetFileContents(path), IsOkAndHolds(AnyOf(a, b)));
+  EXPECT_THAT(DirectoryEntries(temp_dir.path()), ElementsAre("file"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,101 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "xls/common/file/file_descriptor.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/error_code_to_status.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace {
+
+absl::Status ErrNoToStatusWithFilename(int errno_value,
+                                       const std::filesystem::path& path) {
+  xabsl::StatusBuilder builder = ErrnoToStatus(errno_value);
+  builder << path.string();
+  return std::move(builder);
+}
+
+}  // namespace
+
+/* static */ absl::StatusOr<MappedFile> MappedFile::Open(
+    const std::filesystem::path& path) {
+  FileDescriptor fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() == -1) {
+    return ErrNoToStatusWithFilename(errno, path);
+  }
+  struct stat st;
+  if (fstat(fd.get(), &st) != 0) {
+    return ErrNoToStatusWithFilename(errno, path);
+  }
+  if (!S_ISREG(st.st_mode)) {
+    fd.Close();
+    XLS_ASSIGN_OR_RETURN(std::string buffer, GetFileContents(path));
+    return MappedFile(std::move(buffer));
+  }
+  if (st.st_size == 0) {
+    return MappedFile(std::string());
+  }
+  void* data =
+      mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd.get(), /*offset=*/0);
+  if (data == MAP_FAILED) {
+    return ErrNoToStatusWithFilename(errno, path);
+  }
+  // Contents are scanned front to back.
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  return MappedFile(data, st.st_size);
+}
+
+MappedFile::~MappedFile() { Unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other)
+    : data_(other.data_),
+      size_(other.size_),
+      buffer_(std::move(other.buffer_)) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    Unmap();
+    data_ = other.data_;
+    size_ = other.size_;
+    buffer_ = std::move(other.buffer_);
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace xls
@@ -0,0 +1,74 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_COMMON_FILE_MAPPED_FILE_H_
+#define XLS_COMMON_FILE_MAPPED_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace xls {
+
+// A read-only memory mapping of an entire file. The contents are paged in by
+// the OS on demand rather than being copied into memory up front, which makes
+// this suitable for scanning very large inputs. The file is unmapped when the
+// object goes out of scope.
+class MappedFile {
+ public:
+  // Maps the file at the given path. An empty file yields empty contents. Files
+  // which cannot be mapped because they are not regular files (e.g., pipes such
+  // as /dev/stdin) are read into memory instead.
+  static absl::StatusOr<MappedFile> Open(const std::filesystem::path& path);
+
+  ~MappedFile();
+
+  // MappedFile is movable but not copyable.
+  MappedFile(MappedFile&& other);
+  MappedFile& operator=(MappedFile&& other);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns the contents of the file. The view is valid for the lifetime of
+  // this object.
+  absl::string_view contents() const {
+    if (data_ == nullptr) {
+      return buffer_;
+    }
+    return absl::string_view(static_cast<const char*>(data_), size_);
+  }
+
+  // Returns true if the contents are memory mapped rather than buffered.
+  bool is_mapped() const { return data_ != nullptr; }
+
+ private:
+  MappedFile(void* data, int64_t size) : data_(data), size_(size) {}
+  explicit MappedFile(std::string buffer) : buffer_(std::move(buffer)) {}
+
+  void Unmap();
+
+  void* data_ = nullptr;
+  int64_t size_ = 0;
+
+  // Contents of files which could not be mapped.
+  std::string buffer_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_COMMON_FILE_MAPPED_FILE_H_
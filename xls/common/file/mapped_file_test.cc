@@ -0,0 +1,61 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/mapped_file.h"
+
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+TEST(MappedFileTest, MapsFileContents) {
+  std::string content = "package foo\n\nfn f() -> bits[1] {}\n";
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(content, ".ir"));
+  XLS_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Open(temp_file.path()));
+  EXPECT_TRUE(file.is_mapped());
+  EXPECT_EQ(file.contents(), content);
+}
+
+TEST(MappedFileTest, EmptyFile) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file, TempFile::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Open(temp_file.path()));
+  EXPECT_TRUE(file.contents().empty());
+}
+
+TEST(MappedFileTest, MoveTransfersMapping) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent("abc"));
+  XLS_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Open(temp_file.path()));
+  MappedFile moved = std::move(file);
+  EXPECT_EQ(moved.contents(), "abc");
+  MappedFile assigned = std::move(moved);
+  EXPECT_EQ(assigned.contents(), "abc");
+}
+
+TEST(MappedFileTest, NonexistentFile) {
+  EXPECT_THAT(MappedFile::Open("/does/not/exist"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace xls
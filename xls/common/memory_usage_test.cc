@@ -0,0 +1,39 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/memory_usage.h"
+
+#include <cstring>
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace xls {
+namespace {
+
+TEST(MemoryUsageTest, PeakGrowsWithAllocation) {
+  int64_t before = GetPeakResidentSetBytes();
+  EXPECT_GT(before, 0);
+
+  // Touch every page of a large allocation so it becomes resident.
+  constexpr int64_t kSize = int64_t{256} << 20;
+  auto buffer = std::make_unique<char[]>(kSize);
+  memset(buffer.get(), 1, kSize);
+  EXPECT_GE(GetPeakResidentSetBytes(), before);
+  EXPECT_GE(GetPeakResidentSetBytes(), kSize);
+}
+
+}  // namespace
+}  // namespace xls
@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
@@ -60,7 +61,13 @@ struct Pipe {
 void PrepareAndExecInChildProcess(const std::vector<const char*>& argv_pointers,
                                   const std::filesystem::path& cwd,
                                   const Pipe& stdout_pipe,
-                                  const Pipe& stderr_pipe) {
+                                  const Pipe& stderr_pipe,
+                                  bool new_process_group) {
+  // Lets the parent kill the subprocess along with any children it spawns.
+  if (new_process_group && setpgid(0, 0) != 0) {
+    XLS_LOG(ERROR) << "setpgid failed: " << Strerror(errno);
+    _exit(127);
+  }
   if (!cwd.empty()) {
     if (chdir(cwd.c_str()) != 0) {
       XLS_LOG(ERROR) << "chdir failed: " << Strerror(errno);
@@ -80,10 +87,17 @@ void PrepareAndExecInChildProcess(const std::vector<const char*>& argv_pointers,
   _exit(127);
 }
 
+// How often a cancellable subprocess checks whether it was cancelled.
+constexpr int kCancelPollIntervalMs = 20;
+
 // Takes a list of file descriptor data streams and reads them into a list of
 // strings, one for each provided file descriptor. Uses poll.
+//
+// If 'cancel' is given, the process group 'pid' is killed once it becomes
+// true, and 'killed' is set.
 absl::StatusOr<std::vector<std::string>> ReadFileDescriptors(
-    absl::Span<FileDescriptor*> fds) {
+    absl::Span<FileDescriptor*> fds, pid_t pid,
+    const std::atomic<bool>* cancel, bool* killed) {
   absl::FixedArray<char> buffer(4096);
   std::vector<std::string> result;
   result.resize(fds.size());
@@ -102,7 +116,15 @@ absl::StatusOr<std::vector<std::string>> ReadFileDescriptors(
   };
 
   while (descriptors_left > 0) {
-    int data_count = poll(poll_list.data(), poll_list.size(), -1);
+    if (cancel != nullptr && !*killed && cancel->load()) {
+      kill(-pid, SIGKILL);
+      *killed = true;
+    }
+    int data_count = poll(poll_list.data(), poll_list.size(),
+                          cancel == nullptr ? -1 : kCancelPollIntervalMs);
+    if (data_count == 0 && cancel != nullptr) {
+      continue;
+    }
     if (data_count <= 0) {
       if (errno == EINTR) {
         continue;
@@ -156,7 +178,8 @@ absl::StatusOr<int> WaitForPid(pid_t pid) {
 }  // namespace
 
 absl::StatusOr<std::pair<std::string, std::string>> InvokeSubprocess(
-    absl::Span<const std::string> argv, const std::filesystem::path& cwd) {
+    absl::Span<const std::string> argv, const std::filesystem::path& cwd,
+    const std::atomic<bool>* cancel) {
   if (argv.empty()) {
     return absl::InvalidArgumentError("Cannot invoke empty argv list.");
   }
@@ -182,15 +205,22 @@ absl::StatusOr<std::pair<std::string, std::string>> InvokeSubprocess(
     return absl::InternalError(
         absl::StrCat("Failed to fork: ", Strerror(errno)));
   } else if (pid == 0) {
-    PrepareAndExecInChildProcess(argv_pointers, cwd, stdout_pipe, stderr_pipe);
+    PrepareAndExecInChildProcess(argv_pointers, cwd, stdout_pipe, stderr_pipe,
+                                 /*new_process_group=*/cancel != nullptr);
+  }
+  // This is the parent process. The process group is also set here so that a
+  // cancellation can't race with the child's own setpgid call.
+  if (cancel != nullptr) {
+    setpgid(pid, pid);
   }
-  // This is the parent process.
   stdout_pipe.entrance.Close();
   stderr_pipe.entrance.Close();
 
   // Read from the output streams of the subprocess.
   FileDescriptor* fds[] = {&stdout_pipe.exit, &stderr_pipe.exit};
-  XLS_ASSIGN_OR_RETURN(auto output_strings, ReadFileDescriptors(fds));
+  bool killed = false;
+  XLS_ASSIGN_OR_RETURN(auto output_strings,
+                       ReadFileDescriptors(fds, pid, cancel, &killed));
   const auto& stdout_output = output_strings[0];
   const auto& stderr_output = output_strings[1];
 
@@ -199,6 +229,10 @@ absl::StatusOr<std::pair<std::string, std::string>> InvokeSubprocess(
 
   // Wait for the subprocess to finish.
   XLS_ASSIGN_OR_RETURN(int exit_status, WaitForPid(pid));
+  if (killed) {
+    return absl::CancelledError(
+        absl::StrFormat("Subprocess %s was cancelled", bin_name));
+  }
   if (exit_status != 0) {
     return absl::InternalError(
         absl::StrFormat("Failed to execute %s; stdout: \"\"\"%s\"\"\"; "
@@ -15,6 +15,7 @@
 #ifndef XLS_COMMON_SUBPROCESS_H_
 #define XLS_COMMON_SUBPROCESS_H_
 
+#include <atomic>
 #include <filesystem>
 
 #include "absl/status/statusor.h"
@@ -26,8 +27,13 @@ namespace xls {
 // Invokes a subprocess with the given argv. If 'cwd' is not empty the
 // subprocess will be invoked in the given directory. Returns the
 // stdout/stderr as a string pair.
+//
+// If 'cancel' is given, the subprocess runs in its own process group, which is
+// killed once 'cancel' becomes true (it is polled every few milliseconds); a
+// Cancelled error is then returned.
 absl::StatusOr<std::pair<std::string, std::string>> InvokeSubprocess(
-    absl::Span<const std::string> argv, const std::filesystem::path& cwd = "");
+    absl::Span<const std::string> argv, const std::filesystem::path& cwd = "",
+    const std::atomic<bool>* cancel = nullptr);
 }
 
 #endif  // XLS_COMMON_SUBPROCESS_H_
@@ -14,6 +14,8 @@
 
 #include "xls/common/subprocess.h"
 
+#include <atomic>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
@@ -66,5 +68,20 @@ TEST(SubprocessTest, LargeOutputToStderrFirstWorks) {
   EXPECT_THAT(result->second, HasSubstr("\n10000\n"));
 }
 
+TEST(SubprocessTest, CancelledCommandIsKilled) {
+  std::atomic<bool> cancel(false);
+  auto result = InvokeSubprocess(
+      {"/bin/sh", "-c", "/bin/echo hey && /bin/sleep 1 && /bin/echo hello"},
+      "", &cancel);
+  XLS_ASSERT_OK(result);
+  EXPECT_EQ(result->first, "hey\nhello\n");
+
+  // The shell's sleep, which shares its output, must be killed too.
+  cancel = true;
+  EXPECT_THAT(InvokeSubprocess({"/bin/sh", "-c", "/bin/sleep 100; /bin/true"},
+                               "", &cancel),
+              StatusIs(absl::StatusCode::kCancelled));
+}
+
 }  // namespace
 }  // namespace xls
@@ -0,0 +1,219 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/thread_pool.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+
+ABSL_FLAG(int32_t, xls_threads, 0,
+          "Number of worker threads in the shared thread pool used to "
+          "parallelize work. If zero, the number of hardware threads is used.");
+
+namespace xls {
+namespace {
+
+// The pool and queue index of the worker running on this thread, if any.
+thread_local ThreadPool* current_pool = nullptr;
+thread_local int64_t current_queue = 0;
+
+// Number of chunks per worker ParallelFor splits its range into, so that
+// uneven iterations still balance across workers.
+constexpr int64_t kChunksPerThread = 4;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int64_t thread_count) {
+  XLS_CHECK_GT(thread_count, 0);
+  for (int64_t i = 0; i < thread_count; ++i) {
+    queues_.push_back(absl::make_unique<Queue>());
+  }
+  for (int64_t i = 0; i < thread_count; ++i) {
+    threads_.push_back(absl::make_unique<Thread>([this, i]() {
+      current_pool = this;
+      current_queue = i;
+      WorkerLoop(i);
+    }));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  for (std::unique_ptr<Thread>& thread : threads_) {
+    thread->Join();
+  }
+}
+
+ThreadPool* ThreadPool::Default() {
+  static ThreadPool* pool = []() {
+    int64_t thread_count = absl::GetFlag(FLAGS_xls_threads);
+    if (thread_count <= 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return new ThreadPool(thread_count);
+  }();
+  return pool;
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  if (current_pool == this) {
+    Queue& queue = *queues_[current_queue];
+    absl::MutexLock lock(&queue.mutex);
+    queue.tasks.push_front(std::move(task));
+  } else {
+    Queue& queue = *queues_[next_queue_++ % queues_.size()];
+    absl::MutexLock lock(&queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  absl::MutexLock lock(&mutex_);
+  ++pending_;
+}
+
+bool ThreadPool::TryRunOne() {
+  return TryRunOneFrom(current_pool == this ? current_queue : 0);
+}
+
+bool ThreadPool::TryRunOneFrom(int64_t index) {
+  std::function<void()> task;
+  for (int64_t i = 0; i < queues_.size() && !task; ++i) {
+    Queue& queue = *queues_[(index + i) % queues_.size()];
+    absl::MutexLock lock(&queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    // A worker takes its own most recent task, which is likely still in
+    // cache, and steals the oldest task of others'.
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+  if (!task) {
+    return false;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    --pending_;
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::WorkerLoop(int64_t index) {
+  while (true) {
+    if (TryRunOneFrom(index)) {
+      continue;
+    }
+    absl::MutexLock lock(&mutex_);
+    auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return pending_ > 0 || stopping_;
+    };
+    mutex_.Await(absl::Condition(&has_work));
+    if (stopping_ && pending_ == 0) {
+      return;
+    }
+  }
+}
+
+TaskGroup::~TaskGroup() { Wait().IgnoreError(); }
+
+void TaskGroup::Schedule(std::function<absl::Status()> task) {
+  {
+    absl::MutexLock lock(&state_->mutex);
+    ++state_->outstanding;
+  }
+  pool_->Schedule([state = state_, task = std::move(task)]() {
+    if (!state->cancelled.load(std::memory_order_relaxed)) {
+      absl::Status status = task();
+      if (!status.ok()) {
+        state->Fail(std::move(status));
+      }
+    }
+    absl::MutexLock lock(&state->mutex);
+    --state->outstanding;
+  });
+}
+
+void TaskGroup::Cancel() {
+  state_->Fail(absl::CancelledError("Task group was cancelled"));
+}
+
+void TaskGroup::State::Fail(absl::Status error) {
+  absl::MutexLock lock(&mutex);
+  if (status.ok()) {
+    status = std::move(error);
+  }
+  cancelled = true;
+}
+
+absl::Status TaskGroup::Wait() {
+  State& state = *state_;
+  auto done = [&state]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(state.mutex) {
+    return state.outstanding == 0;
+  };
+  while (true) {
+    {
+      absl::MutexLock lock(&state.mutex);
+      if (done()) {
+        return state.status;
+      }
+    }
+    // Help with the queued tasks, which may include this group's. If there are
+    // none, the group's remaining tasks are running elsewhere; those may
+    // schedule more work, so check back periodically.
+    if (!pool_->TryRunOne()) {
+      absl::MutexLock lock(&state.mutex);
+      state.mutex.AwaitWithTimeout(absl::Condition(&done),
+                                   absl::Milliseconds(1));
+    }
+  }
+}
+
+absl::Status ParallelFor(int64_t begin, int64_t end,
+                         const std::function<absl::Status(int64_t)>& fn,
+                         ThreadPool* pool) {
+  int64_t count = end - begin;
+  if (count <= 0) {
+    return absl::OkStatus();
+  }
+  int64_t chunk_count =
+      std::min(count, pool->thread_count() * kChunksPerThread);
+  int64_t chunk_size = (count + chunk_count - 1) / chunk_count;
+  TaskGroup group(pool);
+  for (int64_t chunk_begin = begin; chunk_begin < end;
+       chunk_begin += chunk_size) {
+    int64_t chunk_end = std::min(end, chunk_begin + chunk_size);
+    group.Schedule([&fn, &group, chunk_begin, chunk_end]() -> absl::Status {
+      for (int64_t i = chunk_begin; i < chunk_end && !group.cancelled(); ++i) {
+        XLS_RETURN_IF_ERROR(fn(i));
+      }
+      return absl::OkStatus();
+    });
+  }
+  return group.Wait();
+}
+
+}  // namespace xls
@@ -0,0 +1,145 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A process-wide pool of worker threads for parallelizing work within the
+// toolchain, e.g.:
+//
+//   XLS_RETURN_IF_ERROR(ParallelFor(0, functions.size(), [&](int64_t i) {
+//     return Analyze(functions[i]);
+//   }));
+//
+// Each worker has its own task queue; tasks scheduled from a worker go to the
+// front of its queue and idle workers steal from the back of other workers'
+// queues. A thread waiting on a TaskGroup runs queued tasks itself until the
+// group is done, so parallel loops may nest without deadlocking or spawning
+// extra threads.
+
+#ifndef XLS_COMMON_THREAD_POOL_H_
+#define XLS_COMMON_THREAD_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/flags/declare.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "xls/common/thread.h"
+
+ABSL_DECLARE_FLAG(int32_t, xls_threads);
+
+namespace xls {
+
+class ThreadPool {
+ public:
+  // Starts "thread_count" worker threads; "thread_count" must be positive.
+  explicit ThreadPool(int64_t thread_count);
+
+  // Runs all scheduled tasks to completion, then stops the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Returns the process-wide pool. It has --xls_threads workers, or one per
+  // hardware thread if the flag is zero, and is created on first use.
+  static ThreadPool* Default();
+
+  int64_t thread_count() const { return queues_.size(); }
+
+  // Queues "task" to run on some worker.
+  void Schedule(std::function<void()> task);
+
+  // Runs one queued task on the calling thread, if there is one. Returns
+  // whether a task was run.
+  bool TryRunOne();
+
+ private:
+  struct Queue {
+    absl::Mutex mutex;
+    std::deque<std::function<void()>> tasks ABSL_GUARDED_BY(mutex);
+  };
+
+  // Pops a task from queue "index", or steals one from another queue.
+  bool TryRunOneFrom(int64_t index);
+  void WorkerLoop(int64_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::unique_ptr<Thread>> threads_;
+  // Spreads tasks scheduled from outside the pool over the queues.
+  std::atomic<int64_t> next_queue_{0};
+
+  absl::Mutex mutex_;
+  // Number of tasks in the queues. May briefly count a task which was just
+  // popped.
+  int64_t pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// A set of tasks which can be waited on together. The first task to fail
+// cancels the group: tasks which haven't started yet are skipped, and running
+// tasks may poll cancelled() to stop early.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool* pool = ThreadPool::Default())
+      : pool_(pool), state_(std::make_shared<State>()) {}
+
+  // Waits for the group's tasks; their status is dropped.
+  ~TaskGroup();
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  void Schedule(std::function<absl::Status()> task);
+
+  // Skips the tasks which haven't started yet. Wait() then returns a Cancelled
+  // error unless a task failed first.
+  void Cancel();
+  bool cancelled() const {
+    return state_->cancelled.load(std::memory_order_relaxed);
+  }
+
+  // Runs queued tasks of the pool until all of the group's tasks are done, and
+  // returns the first error among them.
+  absl::Status Wait();
+
+ private:
+  // Shared with the scheduled tasks, since the last of them may still be
+  // releasing the mutex when Wait() returns.
+  struct State {
+    std::atomic<bool> cancelled{false};
+    absl::Mutex mutex;
+    int64_t outstanding ABSL_GUARDED_BY(mutex) = 0;
+    absl::Status status ABSL_GUARDED_BY(mutex);
+
+    void Fail(absl::Status error);
+  };
+
+  ThreadPool* pool_;
+  std::shared_ptr<State> state_;
+};
+
+// Calls "fn" on every index in [begin, end) on the pool, in chunks of
+// consecutive indices. Stops at the first error and returns it.
+absl::Status ParallelFor(int64_t begin, int64_t end,
+                         const std::function<absl::Status(int64_t)>& fn,
+                         ThreadPool* pool = ThreadPool::Default());
+
+}  // namespace xls
+
+#endif  // XLS_COMMON_THREAD_POOL_H_
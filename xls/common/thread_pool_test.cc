@@ -0,0 +1,112 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+TEST(ThreadPoolTest, RunsScheduledTasks) {
+  std::atomic<int64_t> count{0};
+  {
+    ThreadPool pool(4);
+    for (int64_t i = 0; i < 100; ++i) {
+      pool.Schedule([&count]() { ++count; });
+    }
+  }
+  EXPECT_EQ(count, 100);
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int64_t>> visits(1000);
+  auto visit = [&](int64_t i) {
+    ++visits[i];
+    return absl::OkStatus();
+  };
+  XLS_ASSERT_OK(ParallelFor(0, visits.size(), visit, &pool));
+  for (const std::atomic<int64_t>& v : visits) {
+    EXPECT_EQ(v, 1);
+  }
+
+  auto fail = [](int64_t i) { return absl::InternalError("not called"); };
+  XLS_EXPECT_OK(ParallelFor(5, 5, fail, &pool));
+}
+
+TEST(ThreadPoolTest, ParallelForStopsAtFirstError) {
+  ThreadPool pool(2);
+  std::atomic<int64_t> calls{0};
+  auto fail_at_ten = [&](int64_t i) {
+    ++calls;
+    return i == 10 ? absl::NotFoundError("ten") : absl::OkStatus();
+  };
+  EXPECT_THAT(ParallelFor(0, 100000, fail_at_ten, &pool),
+              StatusIs(absl::StatusCode::kNotFound, "ten"));
+  EXPECT_LT(calls, 100000);
+}
+
+TEST(ThreadPoolTest, NestedParallelForOnOneThread) {
+  ThreadPool pool(1);
+  std::atomic<int64_t> count{0};
+  auto inner = [&](int64_t j) {
+    ++count;
+    return absl::OkStatus();
+  };
+  auto outer = [&](int64_t i) { return ParallelFor(0, 8, inner, &pool); };
+  XLS_ASSERT_OK(ParallelFor(0, 8, outer, &pool));
+  EXPECT_EQ(count, 64);
+}
+
+TEST(ThreadPoolTest, CancelledGroupSkipsTasks) {
+  ThreadPool pool(1);
+  TaskGroup group(&pool);
+  group.Cancel();
+  EXPECT_TRUE(group.cancelled());
+  bool ran = false;
+  group.Schedule([&ran]() {
+    ran = true;
+    return absl::OkStatus();
+  });
+  EXPECT_THAT(group.Wait(), StatusIs(absl::StatusCode::kCancelled));
+  EXPECT_FALSE(ran);
+}
+
+TEST(ThreadPoolTest, DefaultPool) {
+  EXPECT_GE(ThreadPool::Default()->thread_count(), 1);
+  EXPECT_EQ(ThreadPool::Default(), ThreadPool::Default());
+  TaskGroup group;
+  std::atomic<int64_t> count{0};
+  for (int64_t i = 0; i < 10; ++i) {
+    group.Schedule([&count]() {
+      ++count;
+      return absl::OkStatus();
+    });
+  }
+  XLS_ASSERT_OK(group.Wait());
+  EXPECT_EQ(count, 10);
+}
+
+}  // namespace
+}  // namespace xls
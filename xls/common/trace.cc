@@ -0,0 +1,213 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/common/trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "xls/common/file/filesystem.h"
+
+namespace xls {
+namespace internal {
+
+std::atomic<bool> tracing_enabled{false};
+
+}  // namespace internal
+
+namespace {
+
+// The events recorded by one thread. The mutex is only contended while the
+// events are being read or cleared.
+struct ThreadBuffer {
+  absl::Mutex mutex;
+  int64_t thread_id;
+  int64_t capacity ABSL_GUARDED_BY(mutex);
+  // Ring buffer of the most recent events.
+  std::vector<TraceEvent> events ABSL_GUARDED_BY(mutex);
+  // Total number of events recorded since tracing started.
+  int64_t recorded ABSL_GUARDED_BY(mutex) = 0;
+};
+
+struct Registry {
+  absl::Mutex mutex;
+  int64_t capacity ABSL_GUARDED_BY(mutex) = kDefaultTraceBufferCapacity;
+  // Buffers are shared with their threads so that events outlive the threads
+  // which recorded them.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers ABSL_GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry() {
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    Registry& registry = GetRegistry();
+    absl::MutexLock lock(&registry.mutex);
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->thread_id = registry.buffers.size();
+    {
+      absl::MutexLock buffer_lock(&buffer->mutex);
+      buffer->capacity = registry.capacity;
+    }
+    registry.buffers.push_back(buffer);
+    return buffer;
+  }();
+  return *buffer;
+}
+
+thread_local int64_t open_span_count = 0;
+
+// Returns "text" as a quoted JSON string.
+std::string JsonString(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        absl::StrAppend(&result, "\\\"");
+        break;
+      case '\\':
+        absl::StrAppend(&result, "\\\\");
+        break;
+      case '\n':
+        absl::StrAppend(&result, "\\n");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", c);
+        } else {
+          result.push_back(c);
+        }
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+}  // namespace
+
+void StartTracing(int64_t buffer_capacity) {
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  registry.capacity = std::max<int64_t>(buffer_capacity, 1);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.buffers) {
+    absl::MutexLock buffer_lock(&buffer->mutex);
+    buffer->capacity = registry.capacity;
+    buffer->events.clear();
+    buffer->recorded = 0;
+  }
+  internal::tracing_enabled.store(true, std::memory_order_relaxed);
+}
+
+void StopTracing() {
+  internal::tracing_enabled.store(false, std::memory_order_relaxed);
+}
+
+std::vector<TraceEvent> GetTraceEvents() {
+  std::vector<TraceEvent> events;
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.buffers) {
+    absl::MutexLock buffer_lock(&buffer->mutex);
+    events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+  }
+  std::sort(events.begin(), events.end(),
+            [](const TraceEvent& a, const TraceEvent& b) {
+              return std::tie(a.start_ns, a.depth) <
+                     std::tie(b.start_ns, b.depth);
+            });
+  return events;
+}
+
+int64_t GetDroppedTraceEventCount() {
+  int64_t dropped = 0;
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.buffers) {
+    absl::MutexLock buffer_lock(&buffer->mutex);
+    dropped += std::max<int64_t>(0, buffer->recorded - buffer->capacity);
+  }
+  return dropped;
+}
+
+std::string TraceEventsToChromeJson(absl::Span<const TraceEvent> events) {
+  // Timestamps are given in microseconds relative to the first event.
+  int64_t origin_ns = events.empty() ? 0 : events.front().start_ns;
+  for (const TraceEvent& event : events) {
+    origin_ns = std::min(origin_ns, event.start_ns);
+  }
+  std::vector<std::string> json_events;
+  json_events.reserve(events.size());
+  for (const TraceEvent& event : events) {
+    std::string args;
+    if (!event.detail.empty()) {
+      args = absl::StrCat(", \"args\": {\"detail\": ",
+                          JsonString(event.detail), "}");
+    }
+    json_events.push_back(absl::StrFormat(
+        "{\"name\": %s, \"cat\": \"xls\", \"ph\": \"X\", \"pid\": 1, "
+        "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f%s}",
+        JsonString(event.name), event.thread_id,
+        (event.start_ns - origin_ns) / 1000.0, event.duration_ns / 1000.0,
+        args));
+  }
+  return absl::StrCat("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n",
+                      absl::StrJoin(json_events, ",\n"), "\n]}\n");
+}
+
+absl::Status WriteChromeTrace(const std::filesystem::path& path) {
+  return SetFileContents(path, TraceEventsToChromeJson(GetTraceEvents()));
+}
+
+void ScopedTraceSpan::Begin(absl::string_view name, absl::string_view detail) {
+  active_ = true;
+  depth_ = open_span_count++;
+  name_ = std::string(name);
+  detail_ = std::string(detail);
+  start_ns_ = absl::GetCurrentTimeNanos();
+}
+
+void ScopedTraceSpan::End() {
+  int64_t end_ns = absl::GetCurrentTimeNanos();
+  --open_span_count;
+  if (!IsTracingEnabled()) {
+    return;
+  }
+  ThreadBuffer& buffer = GetThreadBuffer();
+  absl::MutexLock lock(&buffer.mutex);
+  TraceEvent event{.name = std::move(name_),
+                   .detail = std::move(detail_),
+                   .thread_id = buffer.thread_id,
+                   .depth = depth_,
+                   .start_ns = start_ns_,
+                   .duration_ns = end_ns - start_ns_};
+  if (buffer.events.size() < buffer.capacity) {
+    buffer.events.push_back(std::move(event));
+  } else {
+    buffer.events[buffer.recorded % buffer.capacity] = std::move(event);
+  }
+  ++buffer.recorded;
+}
+
+}  // namespace xls
@@ -0,0 +1,139 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Lightweight hierarchical tracing across the toolchain.
+//
+// A region of code is marked with XLS_TRACE_SPAN, e.g.:
+//
+//   absl::Status RunPass(...) {
+//     XLS_TRACE_SPAN("RunPass", pass->short_name());
+//     ...
+//   }
+//
+// While tracing is enabled (between StartTracing() and StopTracing()) each
+// span records its name, start time, duration and nesting depth into a ring
+// buffer owned by the calling thread; otherwise a span costs a single relaxed
+// atomic load. The recorded events can be exported as Chrome trace JSON, which
+// chrome://tracing and Perfetto (ui.perfetto.dev) load directly. Defining
+// XLS_DISABLE_TRACING compiles the spans out entirely.
+
+#ifndef XLS_COMMON_TRACE_H_
+#define XLS_COMMON_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace xls {
+
+struct TraceEvent {
+  std::string name;
+  // Optional free-form detail, e.g., the name of the pass or function.
+  std::string detail;
+  // Small integer identifying the recording thread, assigned in order of the
+  // threads' first spans.
+  int64_t thread_id;
+  // Nesting depth of the span among the spans open on its thread.
+  int64_t depth;
+  // Start time in nanoseconds since the Unix epoch, and duration.
+  int64_t start_ns;
+  int64_t duration_ns;
+};
+
+// Number of events each thread retains by default. Once a thread's buffer is
+// full its oldest events are overwritten.
+constexpr int64_t kDefaultTraceBufferCapacity = 1 << 16;
+
+// Discards previously recorded events and starts recording, retaining up to
+// "buffer_capacity" events per thread.
+void StartTracing(int64_t buffer_capacity = kDefaultTraceBufferCapacity);
+
+// Stops recording. Spans open at this point are not recorded.
+void StopTracing();
+
+namespace internal {
+extern std::atomic<bool> tracing_enabled;
+}  // namespace internal
+
+inline bool IsTracingEnabled() {
+  return internal::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+// Returns the recorded events of all threads in order of start time.
+std::vector<TraceEvent> GetTraceEvents();
+
+// Returns the number of events overwritten because a buffer was full.
+int64_t GetDroppedTraceEventCount();
+
+// Returns the events in the Chrome trace event format (a JSON object holding
+// "complete" events).
+std::string TraceEventsToChromeJson(absl::Span<const TraceEvent> events);
+
+// Writes the recorded events to "path" in the Chrome trace event format.
+absl::Status WriteChromeTrace(const std::filesystem::path& path);
+
+// Records the region between its construction and destruction as a span. Use
+// through XLS_TRACE_SPAN.
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(absl::string_view name,
+                           absl::string_view detail = "") {
+    if (ABSL_PREDICT_FALSE(IsTracingEnabled())) {
+      Begin(name, detail);
+    }
+  }
+  ~ScopedTraceSpan() {
+    if (ABSL_PREDICT_FALSE(active_)) {
+      End();
+    }
+  }
+
+  ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+  ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+ private:
+  void Begin(absl::string_view name, absl::string_view detail);
+  void End();
+
+  bool active_ = false;
+  int64_t depth_ = 0;
+  std::string name_;
+  std::string detail_;
+  int64_t start_ns_ = 0;
+};
+
+}  // namespace xls
+
+#define XLS_TRACE_INTERNAL_CONCAT_IMPL(a, b) a##b
+#define XLS_TRACE_INTERNAL_CONCAT(a, b) XLS_TRACE_INTERNAL_CONCAT_IMPL(a, b)
+
+#ifdef XLS_DISABLE_TRACING
+#define XLS_TRACE_SPAN(...) static_cast<void>(0)
+#else
+// Records the rest of the enclosing scope as a span with the given name and
+// optional detail.
+#define XLS_TRACE_SPAN(...)                                         \
+  ::xls::ScopedTraceSpan XLS_TRACE_INTERNAL_CONCAT(xls_trace_span_, \
+                                                   __LINE__)(__VA_ARGS__)
+#endif
+
+#endif  // XLS_COMMON_TRACE_H_
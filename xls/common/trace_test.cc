@@ -0,0 +1,136 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/common/trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "xls/common/thread.h"
+
+namespace xls {
+namespace {
+
+using testing::Contains;
+using testing::ElementsAre;
+using testing::Field;
+using testing::Not;
+using testing::UnorderedElementsAre;
+
+TEST(TraceTest, NothingRecordedWhileDisabled) {
+  StartTracing();
+  StopTracing();
+  { XLS_TRACE_SPAN("ignored"); }
+  EXPECT_TRUE(GetTraceEvents().empty());
+}
+
+TEST(TraceTest, NestedSpans) {
+  StartTracing();
+  {
+    XLS_TRACE_SPAN("outer", "detail");
+    { XLS_TRACE_SPAN("inner"); }
+    { XLS_TRACE_SPAN("inner"); }
+  }
+  StopTracing();
+
+  std::vector<TraceEvent> events = GetTraceEvents();
+  ASSERT_THAT(events, ElementsAre(Field(&TraceEvent::name, "outer"),
+                                  Field(&TraceEvent::name, "inner"),
+                                  Field(&TraceEvent::name, "inner")));
+  EXPECT_EQ(events[0].detail, "detail");
+  EXPECT_EQ(events[0].depth, 0);
+  EXPECT_EQ(events[1].depth, 1);
+  EXPECT_EQ(events[2].depth, 1);
+  for (const TraceEvent& inner : {events[1], events[2]}) {
+    EXPECT_GE(inner.start_ns, events[0].start_ns);
+    EXPECT_LE(inner.start_ns + inner.duration_ns,
+              events[0].start_ns + events[0].duration_ns);
+  }
+  EXPECT_LE(events[1].start_ns + events[1].duration_ns, events[2].start_ns);
+}
+
+TEST(TraceTest, SpansOfSeveralThreads) {
+  StartTracing();
+  { XLS_TRACE_SPAN("main"); }
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 0; i < 4; ++i) {
+    threads.push_back(
+        absl::make_unique<Thread>([]() { XLS_TRACE_SPAN("worker"); }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  StopTracing();
+
+  std::vector<TraceEvent> events = GetTraceEvents();
+  ASSERT_EQ(events.size(), 5);
+  std::vector<int64_t> worker_thread_ids;
+  int64_t main_thread_id = -1;
+  for (const TraceEvent& event : events) {
+    if (event.name == "main") {
+      main_thread_id = event.thread_id;
+    } else {
+      worker_thread_ids.push_back(event.thread_id);
+    }
+  }
+  std::sort(worker_thread_ids.begin(), worker_thread_ids.end());
+  EXPECT_EQ(std::unique(worker_thread_ids.begin(), worker_thread_ids.end()),
+            worker_thread_ids.end());
+  EXPECT_THAT(worker_thread_ids, Not(Contains(main_thread_id)));
+}
+
+TEST(TraceTest, RingBufferKeepsNewestEvents) {
+  StartTracing(/*buffer_capacity=*/2);
+  for (const char* name : {"a", "b", "c"}) {
+    XLS_TRACE_SPAN(name);
+  }
+  StopTracing();
+  EXPECT_THAT(GetTraceEvents(),
+              UnorderedElementsAre(Field(&TraceEvent::name, "b"),
+                                   Field(&TraceEvent::name, "c")));
+  EXPECT_EQ(GetDroppedTraceEventCount(), 1);
+}
+
+TEST(TraceTest, ChromeJson) {
+  std::vector<TraceEvent> events = {
+      TraceEvent{.name = "opt",
+                 .detail = "",
+                 .thread_id = 0,
+                 .depth = 0,
+                 .start_ns = 1000000,
+                 .duration_ns = 5000},
+      TraceEvent{.name = "pass",
+                 .detail = "dce \"1\"",
+                 .thread_id = 1,
+                 .depth = 1,
+                 .start_ns = 1001500,
+                 .duration_ns = 250}};
+  EXPECT_EQ(TraceEventsToChromeJson(events),
+            "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+            "{\"name\": \"opt\", \"cat\": \"xls\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": 0, \"ts\": 0.000, \"dur\": 5.000},\n"
+            "{\"name\": \"pass\", \"cat\": \"xls\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": 1, \"ts\": 1.500, \"dur\": 0.250, "
+            "\"args\": {\"detail\": \"dce \\\"1\\\"\"}}\n"
+            "]}\n");
+}
+
+}  // namespace
+}  // namespace xls
@@ -14,22 +14,115 @@
 
 #include "xls/contrib/integrator/integration_algorithms/basic_integration_algorithm.h"
 
+#include <string>
+#include <tuple>
+
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "xls/common/thread.h"
 #include "xls/ir/node_iterator.h"
 
 namespace xls {
+namespace {
+
+// Returns a hash of the properties which must match for two nodes to be
+// merged.
+uint64_t MergeFingerprint(const Node* node) {
+  std::vector<std::string> operand_types;
+  operand_types.reserve(node->operand_count());
+  for (const Node* operand : node->operands()) {
+    operand_types.push_back(operand->GetType()->ToString());
+  }
+  return absl::Hash<std::tuple<Op, std::string, std::vector<std::string>>>()(
+      std::make_tuple(node->op(), node->GetType()->ToString(), operand_types));
+}
+
+}  // namespace
+
+bool BasicIntegrationAlgorithm::EnqueueNodeIfReady(Node* node) {
+  if (queued_nodes_.contains(node) ||
+      !integration_function_->AllOperandsHaveMapping(node)) {
+    return false;
+  }
+  ready_nodes_[MergeFingerprint(node)].insert(node);
+  int64_t order = queued_nodes_.size();
+  queued_nodes_[node] = order;
+  return true;
+}
+
+absl::Status BasicIntegrationAlgorithm::QueueMoves(Node* node) {
+  XLS_ASSIGN_OR_RETURN(int64_t insert_cost,
+                       integration_function_->GetInsertNodeCost(node));
+  move_queue_.push(MakeInsertMove(node, insert_cost));
+  auto targets = merge_targets_.find(MergeFingerprint(node));
+  if (targets != merge_targets_.end()) {
+    for (Node* target : targets->second) {
+      XLS_RETURN_IF_ERROR(QueueMergeMove(node, target));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BasicIntegrationAlgorithm::QueueMergeMove(Node* node,
+                                                       Node* merge_node) {
+  XLS_ASSIGN_OR_RETURN(
+      std::optional<int64_t> merge_cost,
+      integration_function_->GetMergeNodesCost(node, merge_node));
+  if (merge_cost.has_value()) {
+    move_queue_.push(MakeMergeMove(node, merge_node, merge_cost.value()));
+  }
+  return absl::OkStatus();
+}
 
-void BasicIntegrationAlgorithm::EnqueueNodeIfReady(Node* node) {
-  if (!queued_nodes_.contains(node) &&
-      integration_function_->AllOperandsHaveMapping(node)) {
-    ready_nodes_.push_back(node);
-    queued_nodes_.insert(node);
+absl::StatusOr<std::optional<int64_t>> BasicIntegrationAlgorithm::GetMoveCost(
+    const BasicIntegrationMove& move) {
+  if (move.move_type == IntegrationMoveType::kInsert) {
+    XLS_ASSIGN_OR_RETURN(int64_t insert_cost,
+                         integration_function_->GetInsertNodeCost(move.node));
+    return std::optional<int64_t>(insert_cost);
+  }
+  // The merge node may have been merged with another node and removed since
+  // the move was scored. Check the id in case its memory was reused.
+  auto targets = merge_targets_.find(MergeFingerprint(move.node));
+  if (targets == merge_targets_.end() ||
+      !targets->second.contains(move.merge_node) ||
+      move.merge_node->id() != move.merge_node_id) {
+    return std::optional<int64_t>();
   }
+  return integration_function_->GetMergeNodesCost(move.node,
+                                                  move.merge_node);
+}
+
+absl::StatusOr<std::vector<Node*>> BasicIntegrationAlgorithm::CommitMove(
+    const BasicIntegrationMove& move) {
+  uint64_t fingerprint = MergeFingerprint(move.node);
+  if (move.move_type == IntegrationMoveType::kMerge) {
+    // Merging replaces the merge node.
+    XLS_RET_CHECK(
+        integration_function_->IntegrationFunctionOwnsNode(move.merge_node));
+    merge_targets_[fingerprint].erase(move.merge_node);
+  }
+  XLS_ASSIGN_OR_RETURN(std::vector<Node*> new_targets,
+                       ExecuteMove(integration_function_.get(), move));
+  ready_nodes_[fingerprint].erase(move.node);
+  for (Node* target : new_targets) {
+    merge_targets_[MergeFingerprint(target)].insert(target);
+  }
+  return new_targets;
 }
 
 absl::Status BasicIntegrationAlgorithm::Initialize() {
   // Make integration function.
   XLS_ASSIGN_OR_RETURN(integration_function_, NewIntegrationFunction());
 
+  // The nodes which source function parameters map to.
+  for (Node* node : integration_function_->function()->nodes()) {
+    if (integration_function_->IsMappingTarget(node)) {
+      merge_targets_[MergeFingerprint(node)].insert(node);
+    }
+  }
+
   // ID initial nodes with all operands ready.
   for (const Function* func : source_functions_) {
     for (Node* node : func->nodes()) {
@@ -43,48 +136,187 @@ absl::Status BasicIntegrationAlgorithm::Initialize() {
 
 absl::StatusOr<std::unique_ptr<IntegrationFunction>>
 BasicIntegrationAlgorithm::Run() {
-  while (!ready_nodes_.empty()) {
-    std::optional<BasicIntegrationMove> move;
-    for (auto node_itr = ready_nodes_.begin(); node_itr != ready_nodes_.end();
-         ++node_itr) {
-      // Check insertion cost.
-      XLS_ASSIGN_OR_RETURN(int64_t insert_cost,
-                           integration_function_->GetInsertNodeCost(*node_itr));
-      if (!move.has_value() || insert_cost < move.value().cost) {
-        move = MakeInsertMove(node_itr, insert_cost);
+  if (integration_options_.scoring_threads() > 1) {
+    return RunParallel();
+  }
+
+  for (const auto& queued : queued_nodes_) {
+    XLS_RETURN_IF_ERROR(QueueMoves(queued.first));
+  }
+
+  while (!move_queue_.empty()) {
+    BasicIntegrationMove move = move_queue_.top();
+    move_queue_.pop();
+
+    // Skip moves for nodes which have already been added.
+    if (!ready_nodes_[MergeFingerprint(move.node)].contains(move.node)) {
+      continue;
+    }
+
+    // Previous moves may have changed the cost of this move. If so, requeue
+    // it so that it is compared against the other moves again.
+    XLS_ASSIGN_OR_RETURN(std::optional<int64_t> cost, GetMoveCost(move));
+    if (!cost.has_value()) {
+      continue;
+    }
+    if (cost.value() != move.cost) {
+      move.cost = cost.value();
+      move_queue_.push(move);
+      continue;
+    }
+
+    // Execute lowest-cost move.
+    XLS_ASSIGN_OR_RETURN(std::vector<Node*> new_targets, CommitMove(move));
+
+    // Score merging the new integration function nodes with the ready nodes.
+    for (Node* target : new_targets) {
+      for (Node* ready_node : ready_nodes_[MergeFingerprint(target)]) {
+        XLS_RETURN_IF_ERROR(QueueMergeMove(ready_node, target));
       }
+    }
 
-      // Check merge cost.
-      for (Node* internal_node : integration_function_->function()->nodes()) {
-        // TODO(jbaileyhandle): Relax this requirement so that
-        // it only applies to integration-generated muxes.
-        if (!integration_function_->IsMappingTarget(internal_node)) {
-          continue;
-        }
+    // Update ready_nodes_.
+    for (Node* user : move.node->users()) {
+      if (EnqueueNodeIfReady(user)) {
+        XLS_RETURN_IF_ERROR(QueueMoves(user));
+      }
+    }
+  }
+
+  // Finalize.
+  XLS_RETURN_IF_ERROR(integration_function_->MakeTupleReturnValue().status());
+  return std::move(integration_function_);
+}
+
+absl::StatusOr<BasicIntegrationAlgorithm::Replica>
+BasicIntegrationAlgorithm::MakeReplica() {
+  Replica replica;
+  XLS_ASSIGN_OR_RETURN(replica.function, NewIntegrationFunction());
+  for (const Function* func : source_functions_) {
+    for (Node* param : func->params()) {
+      XLS_ASSIGN_OR_RETURN(Node * target,
+                           integration_function_->GetNodeMapping(param));
+      XLS_ASSIGN_OR_RETURN(replica.targets[target],
+                           replica.function->GetNodeMapping(param));
+    }
+  }
+  int64_t num_targets = 0;
+  for (const auto& bucket : merge_targets_) {
+    num_targets += bucket.second.size();
+  }
+  XLS_RET_CHECK_EQ(replica.targets.size(), num_targets);
+  return replica;
+}
+
+absl::Status BasicIntegrationAlgorithm::ReplayMove(
+    const BasicIntegrationMove& move, absl::Span<Node* const> new_targets,
+    Replica* replica) {
+  BasicIntegrationMove replica_move = move;
+  if (move.move_type == IntegrationMoveType::kMerge) {
+    // The merge node has been removed from integration_function_, and its
+    // memory may be reused by one of 'new_targets', so forget it first.
+    auto target = replica->targets.find(move.merge_node);
+    XLS_RET_CHECK(target != replica->targets.end());
+    replica_move.merge_node = target->second;
+    replica->targets.erase(target);
+  }
+  XLS_ASSIGN_OR_RETURN(std::vector<Node*> replica_targets,
+                       ExecuteMove(replica->function.get(), replica_move));
+  XLS_RET_CHECK_EQ(replica_targets.size(), new_targets.size());
+  for (int64_t i = 0; i < new_targets.size(); ++i) {
+    replica->targets[new_targets[i]] = replica_targets[i];
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<IntegrationFunction>>
+BasicIntegrationAlgorithm::RunParallel() {
+  const int64_t num_threads = integration_options_.scoring_threads();
+  std::vector<Replica> replicas;
+  replicas.reserve(num_threads);
+  for (int64_t i = 0; i < num_threads; ++i) {
+    XLS_ASSIGN_OR_RETURN(Replica replica, MakeReplica());
+    replicas.push_back(std::move(replica));
+  }
 
-        // Check if mergeable
-        XLS_ASSIGN_OR_RETURN(
-            std::optional<int64_t> merge_cost,
-            integration_function_->GetMergeNodesCost(*node_itr, internal_node));
-        if (!merge_cost.has_value()) {
+  // The move committed in the previous round, which the replicas have yet to
+  // replay, and the integration function nodes it resulted in.
+  std::optional<BasicIntegrationMove> last_move;
+  std::vector<Node*> last_targets;
+  while (true) {
+    std::vector<BasicIntegrationMove> candidates;
+    for (const auto& bucket : ready_nodes_) {
+      auto targets = merge_targets_.find(bucket.first);
+      for (Node* node : bucket.second) {
+        candidates.push_back(MakeInsertMove(node, /*cost=*/0));
+        if (targets == merge_targets_.end()) {
           continue;
         }
+        for (Node* target : targets->second) {
+          candidates.push_back(MakeMergeMove(node, target, /*cost=*/0));
+        }
+      }
+    }
+    if (candidates.empty()) {
+      break;
+    }
 
-        // Check if lowest cost.
-        XLS_RET_CHECK(move.has_value());
-        if (merge_cost < move.value().cost) {
-          move = MakeMergeMove(node_itr, internal_node, merge_cost.value());
+    // Each thread catches its replica up and then scores every
+    // num_threads-th candidate on it.
+    std::vector<std::optional<int64_t>> costs(candidates.size());
+    std::vector<absl::Status> statuses(num_threads);
+    auto score_candidates = [&](int64_t thread) -> absl::Status {
+      Replica& replica = replicas[thread];
+      if (last_move.has_value()) {
+        XLS_RETURN_IF_ERROR(
+            ReplayMove(last_move.value(), last_targets, &replica));
+      }
+      for (int64_t i = thread; i < candidates.size(); i += num_threads) {
+        const BasicIntegrationMove& candidate = candidates[i];
+        if (candidate.move_type == IntegrationMoveType::kInsert) {
+          XLS_ASSIGN_OR_RETURN(
+              int64_t insert_cost,
+              replica.function->GetInsertNodeCost(candidate.node));
+          costs[i] = insert_cost;
+        } else {
+          XLS_ASSIGN_OR_RETURN(
+              costs[i], replica.function->GetMergeNodesCost(
+                            candidate.node,
+                            replica.targets.at(candidate.merge_node)));
         }
       }
+      return absl::OkStatus();
+    };
+    {
+      std::vector<std::unique_ptr<Thread>> threads;
+      for (int64_t i = 0; i < num_threads; ++i) {
+        threads.push_back(absl::make_unique<Thread>(
+            [&, i]() { statuses[i] = score_candidates(i); }));
+      }
+      for (std::unique_ptr<Thread>& thread : threads) {
+        thread->Join();
+      }
+    }
+    for (const absl::Status& status : statuses) {
+      XLS_RETURN_IF_ERROR(status);
     }
 
-    // Execute lowest-cost move.
+    // Commit the lowest-cost move.
+    std::optional<BasicIntegrationMove> move;
+    for (int64_t i = 0; i < candidates.size(); ++i) {
+      if (!costs[i].has_value()) {
+        continue;
+      }
+      candidates[i].cost = costs[i].value();
+      if (!move.has_value() || MoveQueueOrder()(move.value(), candidates[i])) {
+        move = candidates[i];
+      }
+    }
     XLS_RET_CHECK(move.has_value());
-    XLS_RETURN_IF_ERROR(
-        ExecuteMove(integration_function_.get(), move.value()).status());
+    XLS_ASSIGN_OR_RETURN(last_targets, CommitMove(move.value()));
+    last_move = move;
 
     // Update ready_nodes_.
-    ready_nodes_.erase(move.value().node_itr);
     for (Node* user : move.value().node->users()) {
       EnqueueNodeIfReady(user);
     }
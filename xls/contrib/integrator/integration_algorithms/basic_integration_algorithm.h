@@ -16,6 +16,14 @@
 #ifndef XLS_INTEGRATOR_BASIC_INTEGRATION_ALGORITHM_
 #define XLS_INTEGRATOR_BASIC_INTEGRATION_ALGORITHM_
 
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "xls/contrib/integrator/integration_algorithms/integration_algorithm.h"
 
 namespace xls {
@@ -25,6 +33,19 @@ namespace xls {
 // At each step, adds the eligible node for which the cost of adding it to
 // the function (either by inserting or merging with any integeration function
 // node) is the lowest.
+//
+// Nodes can only be merged if they have the same op, type, and operand types
+// (see Node::IsDefinitelyEqualTo), so eligible nodes and integration function
+// nodes are bucketed by a hash of these and only pairs in the same bucket are
+// scored. Scored moves are kept in a priority queue. Because executing a move
+// can change the cost of other moves, a move is rescored when it reaches the
+// front of the queue and is requeued if its cost changed.
+//
+// If IntegrationOptions::scoring_threads() is greater than 1, every candidate
+// move is instead rescored each round. Scoring tentatively modifies the
+// integration function, so each thread scores its share of the moves on its
+// own replica of the integration function. The replicas are kept identical to
+// the integration function by replaying each committed move.
 class BasicIntegrationAlgorithm
     : public IntegrationAlgorithm<BasicIntegrationAlgorithm> {
  public:
@@ -43,26 +64,42 @@ class BasicIntegrationAlgorithm
 
   // Represents a possible modification to the integration function.
   struct BasicIntegrationMove : IntegrationMove {
-    std::list<Node*>::iterator node_itr;
+    // Order in which 'node' became eligible. Breaks ties between moves of
+    // equal cost.
+    int64_t node_order;
+    // Id of 'merge_node' when the move was scored, or -1 for an insert. Used
+    // to detect moves whose merge node has since been removed.
+    int64_t merge_node_id;
+  };
+
+  // Orders the move queue so that the cheapest move is on top. Among moves of
+  // equal cost, prefers the earliest eligible node and inserts over merges.
+  struct MoveQueueOrder {
+    bool operator()(const BasicIntegrationMove& a,
+                    const BasicIntegrationMove& b) const {
+      return std::tie(a.cost, a.node_order, a.merge_node_id) >
+             std::tie(b.cost, b.node_order, b.merge_node_id);
+    }
   };
 
   // Make a BasicIntegrationMove for an insert.
-  inline BasicIntegrationMove MakeInsertMove(
-      std::list<Node*>::iterator node_itr, int64_t cost) {
-    return BasicIntegrationMove{{.node = *node_itr,
+  inline BasicIntegrationMove MakeInsertMove(Node* node, int64_t cost) {
+    return BasicIntegrationMove{{.node = node,
                                  .move_type = IntegrationMoveType::kInsert,
                                  .cost = cost},
-                                node_itr};
+                                queued_nodes_.at(node),
+                                /*merge_node_id=*/-1};
   }
 
   // Make a BasicIntegrationMove for a merge.
-  inline BasicIntegrationMove MakeMergeMove(std::list<Node*>::iterator node_itr,
-                                            Node* merge_node, int64_t cost) {
-    return BasicIntegrationMove{{.node = *node_itr,
+  inline BasicIntegrationMove MakeMergeMove(Node* node, Node* merge_node,
+                                            int64_t cost) {
+    return BasicIntegrationMove{{.node = node,
                                  .move_type = IntegrationMoveType::kMerge,
                                  .merge_node = merge_node,
                                  .cost = cost},
-                                node_itr};
+                                queued_nodes_.at(node),
+                                merge_node->id()};
   }
 
   // Initialize member fields.
@@ -78,16 +115,68 @@ class BasicIntegrationAlgorithm
     return IntegrationOptions::Algorithm::kBasicIntegrationAlgorithm;
   }
 
+  // Run() when scoring moves concurrently.
+  absl::StatusOr<std::unique_ptr<IntegrationFunction>> RunParallel();
+
   // Queue node for processing if all its operands are mapped
-  // and node has not already been queued for processing.
-  void EnqueueNodeIfReady(Node* node);
+  // and node has not already been queued for processing. Returns true if the
+  // node was queued.
+  bool EnqueueNodeIfReady(Node* node);
+
+  // Score the moves for ready node 'node' and add them to move_queue_.
+  absl::Status QueueMoves(Node* node);
+
+  // Score merging 'node' with 'merge_node' and queue the move if the nodes
+  // can be merged.
+  absl::Status QueueMergeMove(Node* node, Node* merge_node);
+
+  // Returns the current cost of 'move', or no value if it is no longer valid.
+  absl::StatusOr<std::optional<int64_t>> GetMoveCost(
+      const BasicIntegrationMove& move);
+
+  // Executes 'move' on integration_function_ and updates the ready nodes and
+  // merge targets. Returns the integration function nodes the move's node now
+  // maps to.
+  absl::StatusOr<std::vector<Node*>> CommitMove(
+      const BasicIntegrationMove& move);
+
+  // A copy of integration_function_ on which moves can be scored
+  // concurrently with other replicas.
+  struct Replica {
+    std::unique_ptr<IntegrationFunction> function;
+    // Maps merge targets in integration_function_ to the corresponding nodes
+    // of the replica.
+    absl::flat_hash_map<Node*, Node*> targets;
+  };
 
-  // Track nodes for which all operands are already mapped and
-  // are ready to be added to the integration_function_
-  std::list<Node*> ready_nodes_;
+  // Returns a replica of integration_function_. Must be called before any move
+  // is committed.
+  absl::StatusOr<Replica> MakeReplica();
 
-  // Track all nodes that have ever been inserted into 'ready_nodes_'.
-  absl::flat_hash_set<Node*> queued_nodes_;
+  // Replays 'move', which was committed to integration_function_ and resulted
+  // in 'new_targets', on 'replica'.
+  absl::Status ReplayMove(const BasicIntegrationMove& move,
+                          absl::Span<Node* const> new_targets,
+                          Replica* replica);
+
+  // Track nodes for which all operands are already mapped and
+  // are ready to be added to the integration_function_, bucketed by
+  // merge fingerprint.
+  absl::flat_hash_map<uint64_t, absl::flat_hash_set<Node*>> ready_nodes_;
+
+  // Integration function nodes which ready nodes may be merged with, bucketed
+  // by merge fingerprint.
+  absl::flat_hash_map<uint64_t, absl::flat_hash_set<Node*>> merge_targets_;
+
+  // Track all nodes that have ever been inserted into 'ready_nodes_', with the
+  // order in which they were inserted.
+  absl::flat_hash_map<Node*, int64_t> queued_nodes_;
+
+  // Candidate moves for ready nodes. Every ready node has an insert move in
+  // the queue.
+  std::priority_queue<BasicIntegrationMove, std::vector<BasicIntegrationMove>,
+                      MoveQueueOrder>
+      move_queue_;
 
   // Function combining the source functions.
   std::unique_ptr<IntegrationFunction> integration_function_;
@@ -434,5 +434,61 @@ TEST_F(BasicIntegrationAlgorithmTest, BasicIntegrationLiterals) {
                  m::Literal(UBits(2, 2)))));
 }
 
+TEST_F(BasicIntegrationAlgorithmTest, BasicIntegrationLongChain) {
+  auto p = CreatePackage();
+  FunctionBuilder fb("func_a", p.get());
+  auto in1 = fb.Param("in1", p->GetBitsType(8));
+  auto in2 = fb.Param("in2", p->GetBitsType(8));
+  BValue value = in1;
+  for (int64_t i = 0; i < 200; ++i) {
+    value = i % 2 == 0 ? fb.Add(value, in2) : fb.Xor(value, in1);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func_a, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func_b, func_a->Clone("func_b"));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<IntegrationBuilder> builder,
+      IntegrationBuilder::Build(
+          {func_a, func_b},
+          IntegrationOptions().algorithm(
+              IntegrationOptions::Algorithm::kBasicIntegrationAlgorithm)));
+
+  // Every node of the chain is merged with its copy.
+  Function* function = builder->integrated_function()->function();
+  Node* return_value = function->return_value();
+  ASSERT_EQ(return_value->operand_count(), 2);
+  EXPECT_EQ(return_value->operand(0), return_value->operand(1));
+  EXPECT_EQ(function->node_count(), 200 + 10);
+}
+
+TEST_F(BasicIntegrationAlgorithmTest, BasicIntegrationParallelScoring) {
+  auto p = CreatePackage();
+  FunctionBuilder fb("func_a", p.get());
+  auto in1 = fb.Param("in1", p->GetBitsType(4));
+  auto in2 = fb.Param("in2", p->GetBitsType(4));
+  BValue value = in1;
+  for (int64_t i = 0; i < 30; ++i) {
+    value = i % 3 == 0 ? fb.Add(value, in2) : fb.Xor(value, in1);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func_a, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func_b, func_a->Clone("func_b"));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<IntegrationBuilder> builder,
+      IntegrationBuilder::Build(
+          {func_a, func_b},
+          IntegrationOptions()
+              .algorithm(
+                  IntegrationOptions::Algorithm::kBasicIntegrationAlgorithm)
+              .scoring_threads(4)));
+
+  // Same result as scoring serially.
+  Function* function = builder->integrated_function()->function();
+  Node* return_value = function->return_value();
+  ASSERT_EQ(return_value->operand_count(), 2);
+  EXPECT_EQ(return_value->operand(0), return_value->operand(1));
+  EXPECT_EQ(function->node_count(), 30 + 10);
+}
+
 }  // namespace
 }  // namespace xls
@@ -16,10 +16,13 @@
 #ifndef XLS_INTEGRATOR_INTEGRATION_OPTIONS_
 #define XLS_INTEGRATOR_INTEGRATION_OPTIONS_
 
+#include <cstdint>
 #include <iostream>
 
 namespace xls {
 
+class AreaEstimator;
+
 class IntegrationOptions {
  public:
   // Used to specify different integration algorithms.
@@ -45,9 +48,30 @@ class IntegrationOptions {
     return unique_select_signal_per_mux_;
   }
 
+  // Area model used to estimate the cost of integration function nodes. If
+  // not set, a fixed per-op cost is used. The estimator is not owned and is
+  // shared by all threads scoring moves, so it must outlive integration.
+  IntegrationOptions& area_estimator(const AreaEstimator* value) {
+    area_estimator_ = value;
+    return *this;
+  }
+  const AreaEstimator* area_estimator() const { return area_estimator_; }
+
+  // Number of threads used to score candidate moves. If greater than 1, the
+  // basic integration algorithm scores every candidate move each round
+  // concurrently, each thread on its own replica of the integration function,
+  // and commits the lowest-cost move.
+  IntegrationOptions& scoring_threads(int64_t value) {
+    scoring_threads_ = value;
+    return *this;
+  }
+  int64_t scoring_threads() const { return scoring_threads_; }
+
  private:
   bool unique_select_signal_per_mux_ = false;
   Algorithm algorithm_ = Algorithm::kBasicIntegrationAlgorithm;
+  const AreaEstimator* area_estimator_ = nullptr;
+  int64_t scoring_threads_ = 1;
 };
 
 // Convert IntegrationOptions::Algorithm to human-readable text.
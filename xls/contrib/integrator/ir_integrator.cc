@@ -14,6 +14,8 @@
 
 #include "xls/contrib/integrator/ir_integrator.h"
 
+#include "xls/common/logging/logging.h"
+#include "xls/contrib/integrator/area_model/area_estimator.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/node_iterator.h"
 
@@ -693,7 +695,17 @@ absl::StatusOr<std::optional<int64_t>> IntegrationFunction::GetMergeNodesCost(
 }
 
 int64_t IntegrationFunction::GetNodeCost(const Node* node) const {
-  // TODO: Actual estimate.
+  if (integration_options_.area_estimator() != nullptr) {
+    absl::StatusOr<int64_t> area =
+        integration_options_.area_estimator()->GetOperationArea(
+            const_cast<Node*>(node));
+    if (area.ok()) {
+      return area.value();
+    }
+    XLS_VLOG(2) << "No area estimate for " << node->ToString()
+                << ", using default cost: " << area.status();
+  }
+
   switch (node->op()) {
     case Op::kArray:
     case Op::kConcat:
@@ -17,6 +17,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
+#include "xls/contrib/integrator/area_model/area_estimator.h"
 #include "xls/ir/ir_matcher.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/ir_test_base.h"
@@ -1476,6 +1477,30 @@ TEST_F(IntegratorTest, GetNodeCost) {
   EXPECT_EQ(cost, integration->GetNodeCost(add_node));
 }
 
+TEST_F(IntegratorTest, GetNodeCostWithAreaEstimator) {
+  auto p = CreatePackage();
+  FunctionBuilder fb_a("func_a", p.get());
+  auto a1 = fb_a.Param("a1", p->GetBitsType(2));
+  auto a2 = fb_a.Param("a2", p->GetBitsType(2));
+  fb_a.Add(a1, a2);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func_a, fb_a.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AreaEstimator> area_estimator,
+      GetAreaEstimatorByName("area_model_testing_2_point_5_mux_per_node"));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<IntegrationFunction> integration,
+      IntegrationFunction::MakeIntegrationFunctionWithParamTuples(
+          p.get(), {func_a},
+          IntegrationOptions().area_estimator(area_estimator.get())));
+
+  Node* add_node = func_a->return_value();
+  EXPECT_EQ(integration->GetNodeCost(add_node), 5);
+  XLS_ASSERT_OK_AND_ASSIGN(float cost,
+                           integration->GetInsertNodeCost(add_node));
+  EXPECT_EQ(cost, 5);
+}
+
 TEST_F(IntegratorTest, DeUnifyIntegrationNodesExternalNode) {
   auto p = CreatePackage();
   XLS_ASSERT_OK_AND_ASSIGN(
@@ -46,6 +46,9 @@ xlscc foo.cc
 Emit combinational Verilog module:
 xlscc foo.cc --block_pb block_info.pb
 
+Parse a large header included by foo.cc once, reusing it in later invocations:
+xlscc foo.cc --precompiled_header hls_lib.h --pch_cache_dir /tmp/xlscc_pch
+
 )";
 
 ABSL_FLAG(std::string, module_name, "",
@@ -62,6 +65,15 @@ ABSL_FLAG(std::string, package, "", "Package name to generate");
 ABSL_FLAG(std::string, clang_args_file, "",
           "File containing on each line one command line argument for clang");
 
+ABSL_FLAG(std::string, precompiled_header, "",
+          "Header to precompile and include ahead of the source file. It is "
+          "only parsed again when it, the files it includes or the clang "
+          "arguments change. Requires --pch_cache_dir.");
+
+ABSL_FLAG(std::string, pch_cache_dir, "",
+          "Directory in which precompiled headers are kept between "
+          "invocations");
+
 namespace xlscc {
 
 absl::Status Run(absl::string_view cpp_path) {
@@ -101,6 +113,28 @@ absl::Status Run(absl::string_view cpp_path) {
     clang_argv.push_back(clang_argvs[i]);
   }
 
+  const std::string precompiled_header =
+      absl::GetFlag(FLAGS_precompiled_header);
+  std::string pch_path;
+  if (!precompiled_header.empty()) {
+    const std::string pch_cache_dir = absl::GetFlag(FLAGS_pch_cache_dir);
+    if (pch_cache_dir.empty()) {
+      return absl::InvalidArgumentError(
+          "--precompiled_header requires --pch_cache_dir");
+    }
+    std::cerr << "Precompiling header '" << precompiled_header << "'..."
+              << std::endl;
+    XLS_ASSIGN_OR_RETURN(
+        pch_path,
+        xlscc::Translator::GetPrecompiledHeader(
+            precompiled_header, pch_cache_dir,
+            clang_argv.empty()
+                ? absl::Span<absl::string_view>()
+                : absl::MakeSpan(&clang_argv[0], clang_argv.size())));
+    clang_argv.push_back("-include-pch");
+    clang_argv.push_back(pch_path);
+  }
+
   std::cerr << "Parsing file '" << cpp_path << "' with clang..." << std::endl;
   XLS_RETURN_IF_ERROR(translator.ScanFile(
       cpp_path, clang_argv.empty()
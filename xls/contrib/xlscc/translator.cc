@@ -14,11 +14,14 @@
 
 #include "xls/contrib/xlscc/translator.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <regex>  // NOLINT
 #include <sstream>
+#include <system_error>
 #include <typeinfo>
 #include <vector>
 
@@ -27,9 +30,14 @@
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/blocking_counter.h"
 #include "absl/types/span.h"
@@ -54,14 +62,18 @@
 #include "clang/include/clang/Basic/SourceLocation.h"
 #include "clang/include/clang/Basic/SourceManager.h"
 #include "clang/include/clang/Basic/Specifiers.h"
+#include "clang/include/clang/Basic/Version.h"
 #include "clang/include/clang/Frontend/CompilerInstance.h"
 #include "clang/include/clang/Frontend/FrontendActions.h"
 #include "clang/include/clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/include/clang/Tooling/CommonOptionsParser.h"
 #include "clang/include/clang/Tooling/Tooling.h"
 #include "llvm/include/llvm/ADT/StringRef.h"
+#include "llvm/include/llvm/Support/MD5.h"
 #include "llvm/include/llvm/Support/VirtualFileSystem.h"
 #include "llvm/include/llvm/Support/raw_ostream.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/interpreter/ir_interpreter.h"
@@ -100,6 +112,90 @@ inline To clang_down_cast(From* f) {   // so we only accept pointers
   return static_cast<To>(f);
 }
 
+// Creates the file manager clang parses with: the real file system, overlaid
+// with the in-memory XLS builtin header.
+llvm::IntrusiveRefCntPtr<clang::FileManager> CreateLibToolFileManager() {
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> mem_fs(
+      new llvm::vfs::InMemoryFileSystem);
+  mem_fs->addFile("/xls_builtin.h", 0,
+                  llvm::MemoryBuffer::getMemBuffer(
+                      R"(
+#ifndef __XLS_BUILTIN_H
+#define __XLS_BUILTIN_H
+template<int N>
+struct __xls_bits { };
+
+template<typename T>
+class __xls_channel {
+ public:
+  T read() {
+    return T();
+  }
+  T write(T val) {
+    return val;
+  }
+};
+
+#endif//__XLS_BUILTIN_H
+          )"));
+
+  llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> overlay_fs(
+      new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem()));
+
+  overlay_fs->pushOverlay(mem_fs);
+
+  return new clang::FileManager(clang::FileSystemOptions(), overlay_fs);
+}
+
+// Language standard of every clang invocation, which must be the same for
+// precompiled headers and the sources using them.
+constexpr char kLibToolStd[] = "-std=c++17";
+
+std::string Md5Hex(absl::string_view data) {
+  llvm::MD5 hash;
+  hash.update(llvm::StringRef(data.data(), data.size()));
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return result.digest().str().str();
+}
+
+// Generates a precompiled header, recording the files it's built from.
+class DependencyRecordingPCHAction : public clang::GeneratePCHAction {
+ public:
+  explicit DependencyRecordingPCHAction(std::vector<std::string>* dependencies)
+      : dependencies_(dependencies) {}
+
+  void EndSourceFileAction() override {
+    const clang::SourceManager& sm = getCompilerInstance().getSourceManager();
+    for (auto it = sm.fileinfo_begin(); it != sm.fileinfo_end(); ++it) {
+      dependencies_->push_back(it->first->getName().str());
+    }
+    clang::GeneratePCHAction::EndSourceFileAction();
+  }
+
+ private:
+  std::vector<std::string>* dependencies_;
+};
+
+// Returns true if each line "<md5> <path>" of "manifest" matches the current
+// contents of the file.
+bool DependenciesUnchanged(absl::string_view manifest) {
+  for (absl::string_view line :
+       absl::StrSplit(manifest, '\n', absl::SkipEmpty())) {
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, absl::MaxSplits(' ', 1));
+    if (fields.size() != 2) {
+      return false;
+    }
+    absl::StatusOr<std::string> contents =
+        xls::GetFileContents(std::string(fields[1]));
+    if (!contents.ok() || Md5Hex(*contents) != fields[0]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 namespace xlscc {
@@ -393,44 +489,13 @@ void Translator::LibToolThread::Run() {
     argv.emplace_back(view);
   }
   argv.emplace_back("-fsyntax-only");
-  argv.emplace_back("-std=c++17");
-
-  llvm::IntrusiveRefCntPtr<clang::FileManager> libtool_files;
+  argv.emplace_back(kLibToolStd);
 
   std::unique_ptr<LibToolFrontendAction> libtool_action(
       new LibToolFrontendAction(translator_));
 
-  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> mem_fs(
-      new llvm::vfs::InMemoryFileSystem);
-  mem_fs->addFile("/xls_builtin.h", 0,
-                  llvm::MemoryBuffer::getMemBuffer(
-                      R"(
-#ifndef __XLS_BUILTIN_H
-#define __XLS_BUILTIN_H
-template<int N>
-struct __xls_bits { };
-
-template<typename T>
-class __xls_channel {
- public:
-  T read() {
-    return T();
-  }
-  T write(T val) {
-    return val;
-  }
-};
-
-#endif//__XLS_BUILTIN_H
-          )"));
-
-  llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> overlay_fs(
-      new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem()));
-
-  overlay_fs->pushOverlay(mem_fs);
-
-  libtool_files =
-      new clang::FileManager(clang::FileSystemOptions(), overlay_fs);
+  llvm::IntrusiveRefCntPtr<clang::FileManager> libtool_files =
+      CreateLibToolFileManager();
 
   std::unique_ptr<clang::tooling::ToolInvocation> libtool_inv(
       new clang::tooling::ToolInvocation(argv, std::move(libtool_action),
@@ -478,6 +543,84 @@ absl::Status Translator::ScanFile(
   return libtool_visit_status_;
 }
 
+absl::StatusOr<std::string> Translator::GetPrecompiledHeader(
+    absl::string_view header_filename, absl::string_view cache_dir,
+    absl::Span<absl::string_view> command_line_args) {
+  std::vector<std::string> argv;
+  argv.emplace_back("binary");
+  argv.emplace_back("-xc++-header");
+  argv.emplace_back(header_filename);
+  for (const auto& view : command_line_args) {
+    argv.emplace_back(view);
+  }
+  argv.emplace_back(kLibToolStd);
+
+  // The key covers everything which affects the header's AST except the
+  // contents of its files, which are checked against the manifest.
+  XLS_ASSIGN_OR_RETURN(std::filesystem::path cwd, xls::GetCurrentDirectory());
+  const std::string key =
+      Md5Hex(absl::StrCat(absl::StrJoin(argv, "\n"), "\n", cwd.string(), "\n",
+                          clang::getClangFullVersion()));
+  const std::string pch_filename =
+      absl::StrCat(cache_dir, "/xlscc_", key, ".pch");
+  const std::string manifest_filename = absl::StrCat(pch_filename, ".deps");
+
+  absl::StatusOr<std::string> manifest =
+      xls::GetFileContents(manifest_filename);
+  if (manifest.ok() && xls::FileExists(pch_filename).ok() &&
+      DependenciesUnchanged(*manifest)) {
+    return pch_filename;
+  }
+
+  // Drop the stale manifest first so that, until the rebuild completes, no
+  // reader pairs it with a header that doesn't match.
+  std::error_code ec;
+  std::filesystem::remove(manifest_filename, ec);
+  XLS_RETURN_IF_ERROR(xls::RecursivelyCreateDir(std::string(cache_dir)));
+  // The header is built under a temporary name and renamed into place, so
+  // concurrent translations never load a partially-written header.
+  const std::string temp_pch_filename =
+      xls::UniqueTempPath(pch_filename).string();
+  argv.emplace_back("-o");
+  argv.emplace_back(temp_pch_filename);
+
+  std::vector<std::string> dependencies;
+  llvm::IntrusiveRefCntPtr<clang::FileManager> libtool_files =
+      CreateLibToolFileManager();
+  clang::tooling::ToolInvocation libtool_inv(
+      argv, absl::make_unique<DependencyRecordingPCHAction>(&dependencies),
+      libtool_files.get());
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> diag_opts =
+      new clang::DiagnosticOptions();
+  clang::TextDiagnosticPrinter diag_print(llvm::errs(), &*diag_opts);
+  libtool_inv.setDiagnosticConsumer(&diag_print);
+  if (!libtool_inv.run()) {
+    std::filesystem::remove(temp_pch_filename, ec);
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Unable to precompile header %s with clang (libtooling)",
+        header_filename));
+  }
+  std::filesystem::rename(temp_pch_filename, pch_filename, ec);
+  if (ec) {
+    std::filesystem::remove(temp_pch_filename, ec);
+    return absl::InternalError(absl::StrFormat(
+        "Unable to move precompiled header into place at %s", pch_filename));
+  }
+
+  // The manifest is written last, so an interrupted build is redone. Files
+  //  which aren't on disk (the builtin header) are left out.
+  std::string new_manifest;
+  for (const std::string& dependency : dependencies) {
+    absl::StatusOr<std::string> contents = xls::GetFileContents(dependency);
+    if (contents.ok()) {
+      absl::StrAppend(&new_manifest, Md5Hex(*contents), " ", dependency, "\n");
+    }
+  }
+  XLS_RETURN_IF_ERROR(
+      xls::AtomicSetFileContents(manifest_filename, new_manifest));
+  return pch_filename;
+}
+
 absl::StatusOr<std::string> Translator::GetEntryFunctionName() const {
   if (!top_function_) {
     return absl::NotFoundError("No top function found");
@@ -499,6 +642,25 @@ static size_t match_pragma(std::string pragma_string, std::string name) {
   return at;
 }
 
+// Parses the positive integer following a pragma's name, ending at whitespace
+//  or a comment.
+static absl::StatusOr<int64_t> ParsePragmaArgument(const std::string& line,
+                                                   size_t at,
+                                                   const std::string& name,
+                                                   const std::string& filename,
+                                                   int lineno) {
+  absl::string_view rest = absl::string_view(line).substr(at + name.length());
+  rest = rest.substr(0, std::min(rest.find("//"), rest.find("/*")));
+  rest = absl::StripAsciiWhitespace(rest);
+  int64_t argument;
+  if (!absl::SimpleAtoi(rest, &argument) || argument <= 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Pragma %s expects a positive integer argument, got '%s' at %s:%i",
+        name, rest, filename, lineno));
+  }
+  return argument;
+}
+
 absl::Status Translator::ScanFileForPragmas(std::string filename) {
   std::ifstream fin(filename);
   if (!fin.good()) {
@@ -519,6 +681,21 @@ absl::Status Translator::ScanFileForPragmas(std::string filename) {
       } else if ((at = match_pragma(line, "#pragma hls_unroll yes")) !=
                  std::string::npos) {
         hls_pragmas_[location] = Pragma_Unroll;
+      } else if ((at = match_pragma(line, "#pragma hls_unroll")) !=
+                 std::string::npos) {
+        XLS_ASSIGN_OR_RETURN(
+            hls_pragma_arguments_[location],
+            ParsePragmaArgument(line, at, "#pragma hls_unroll", filename,
+                                lineno));
+        hls_pragmas_[location] = Pragma_UnrollFactor;
+      } else if ((at = match_pragma(line,
+                                    "#pragma hls_pipeline_init_interval")) !=
+                 std::string::npos) {
+        XLS_ASSIGN_OR_RETURN(
+            hls_pragma_arguments_[location],
+            ParsePragmaArgument(line, at, "#pragma hls_pipeline_init_interval",
+                                filename, lineno));
+        hls_pragmas_[location] = Pragma_InitInterval;
       } else if ((at = match_pragma(line, "#pragma hls_top")) !=
                  std::string::npos) {
         hls_pragmas_[location] = Pragma_Top;
@@ -531,14 +708,20 @@ absl::Status Translator::ScanFileForPragmas(std::string filename) {
 }
 
 absl::StatusOr<Translator::Pragma> Translator::FindPragmaForLoc(
-    const clang::PresumedLoc& ploc) {
+    const clang::PresumedLoc& ploc, int64_t* argument) {
   if (!files_scanned_for_pragmas_.contains(ploc.getFilename())) {
     XLS_RETURN_IF_ERROR(ScanFileForPragmas(ploc.getFilename()));
   }
   // Look on the line before
-  auto found =
-      hls_pragmas_.find(PragmaLoc(ploc.getFilename(), ploc.getLine() - 1));
+  PragmaLoc location(ploc.getFilename(), ploc.getLine() - 1);
+  auto found = hls_pragmas_.find(location);
   if (found == hls_pragmas_.end()) return Pragma_Null;
+  if (argument != nullptr) {
+    auto found_argument = hls_pragma_arguments_.find(location);
+    if (found_argument != hls_pragma_arguments_.end()) {
+      *argument = found_argument->second;
+    }
+  }
   return found->second;
 }
 
@@ -1036,13 +1219,29 @@ absl::Status Translator::DeepScanForIO(const clang::Stmt* body,
     if (body->getStmtClass() == clang::Stmt::ForStmtClass) {
       auto forst = clang_down_cast<const clang::ForStmt*>(body);
 
+      XLS_ASSIGN_OR_RETURN(
+          Pragma pragma,
+          FindPragmaForLoc(GetPresumedLoc(ctx.getSourceManager(), *forst)));
+
       // Don't generate double declared error when actually generating IR
       auto saved_sanity_ids = sanity_check_unique_ids_;
 
       PushContextGuard context_guard(*this, body_loc);
       context_guard.propagate_up = false;
 
-      XLS_RETURN_IF_ERROR(GenerateIR_UnrolledFor(forst, ctx, body_loc, true));
+      if (pragma == Pragma_UnrollFactor || pragma == Pragma_InitInterval) {
+        // Pipelined loop bodies become separate functions without channels
+        const size_t io_ops_before = context().sf->io_ops.size();
+        XLS_RETURN_IF_ERROR(DeepScanForIO(forst->getBody(), ctx));
+        if (context().sf->io_ops.size() != io_ops_before) {
+          return absl::UnimplementedError(absl::StrFormat(
+              "IO ops in pipelined for loops are not supported at %s",
+              LocString(body_loc)));
+        }
+      } else {
+        XLS_RETURN_IF_ERROR(
+            GenerateIR_UnrolledFor(forst, ctx, body_loc, true));
+      }
 
       sanity_check_unique_ids_ = saved_sanity_ids;
     } else {
@@ -2931,15 +3130,27 @@ absl::Status Translator::GenerateIR_Stmt(const clang::Stmt* stmt,
     case clang::Stmt::ForStmtClass: {
       auto forst = clang_down_cast<const clang::ForStmt*>(stmt);
 
-      XLS_ASSIGN_OR_RETURN(Pragma pragma,
-                           FindPragmaForLoc(GetPresumedLoc(sm, *forst)));
-      if (pragma != Pragma_Unroll) {
-        return absl::UnimplementedError(
-            absl::StrFormat("Only unrolled for loops currently supported at %s",
-                            LocString(loc)));
+      int64_t pragma_argument = 0;
+      XLS_ASSIGN_OR_RETURN(
+          Pragma pragma,
+          FindPragmaForLoc(GetPresumedLoc(sm, *forst), &pragma_argument));
+      if (pragma == Pragma_Unroll) {
+        XLS_RETURN_IF_ERROR(GenerateIR_UnrolledFor(forst, ctx, loc, false));
+      } else if (pragma == Pragma_UnrollFactor) {
+        XLS_RETURN_IF_ERROR(
+            GenerateIR_PipelinedFor(forst, ctx, loc, pragma_argument));
+      } else if (pragma == Pragma_InitInterval) {
+        if (pragma_argument != 1) {
+          return absl::UnimplementedError(absl::StrFormat(
+              "Only an initiation interval of 1 is supported, got %i at %s",
+              pragma_argument, LocString(loc)));
+        }
+        XLS_RETURN_IF_ERROR(GenerateIR_PipelinedFor(forst, ctx, loc, 1));
+      } else {
+        return absl::UnimplementedError(absl::StrFormat(
+            "Only unrolled or pipelined for loops currently supported at %s",
+            LocString(loc)));
       }
-
-      XLS_RETURN_IF_ERROR(GenerateIR_UnrolledFor(forst, ctx, loc, false));
       break;
     }
     case clang::Stmt::SwitchStmtClass: {
@@ -3099,6 +3310,322 @@ absl::Status Translator::GenerateIR_UnrolledFor(const clang::ForStmt* stmt,
   return absl::OkStatus();
 }
 
+// Returns true if expr refers to decl, ignoring implicit casts
+static bool IsDeclRefTo(const clang::Expr* expr, const clang::NamedDecl* decl) {
+  expr = expr->IgnoreParenImpCasts();
+  if (expr->getStmtClass() != clang::Stmt::DeclRefExprClass) {
+    return false;
+  }
+  return clang_down_cast<const clang::DeclRefExpr*>(expr)->getDecl() == decl;
+}
+
+absl::StatusOr<Translator::CountedForInfo> Translator::AnalyzeCountedFor(
+    const clang::ForStmt* stmt, clang::ASTContext& ctx,
+    const xls::SourceLocation& loc) {
+  if (stmt->getInit() == nullptr || stmt->getCond() == nullptr ||
+      stmt->getInc() == nullptr) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for must have an initializer, condition, and increment at "
+        "%s",
+        LocString(loc)));
+  }
+  if (stmt->getInit()->getStmtClass() != clang::Stmt::DeclStmtClass) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for initializer must be a DeclStmt, but is a %s at %s",
+        stmt->getInit()->getStmtClassName(), LocString(loc)));
+  }
+  auto declstmt = clang_down_cast<const clang::DeclStmt*>(stmt->getInit());
+  if (!declstmt->isSingleDecl() ||
+      declstmt->getSingleDecl()->getKind() != clang::Decl::Var) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for must declare a single variable at %s", LocString(loc)));
+  }
+  auto vardecl =
+      clang_down_cast<const clang::VarDecl*>(declstmt->getSingleDecl());
+
+  CountedForInfo info;
+  info.counter = vardecl;
+  XLS_ASSIGN_OR_RETURN(std::shared_ptr<CType> counter_type,
+                       TranslateTypeFromClang(vardecl->getType(), loc));
+  info.counter_type = std::dynamic_pointer_cast<CIntType>(counter_type);
+  if (info.counter_type == nullptr || info.counter_type->width() > 64) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for counter must be an integer of at most 64 bits at %s",
+        LocString(loc)));
+  }
+  if (!vardecl->hasInit()) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for counter must be initialized at %s", LocString(loc)));
+  }
+  XLS_ASSIGN_OR_RETURN(info.init,
+                       EvaluateInt64(*vardecl->getInit(), ctx, loc));
+
+  // Increment: ++i, i++, --i, i--, i += C, or i -= C
+  const clang::Expr* inc = stmt->getInc();
+  info.step = 0;
+  if (inc->getStmtClass() == clang::Stmt::UnaryOperatorClass) {
+    auto uop = clang_down_cast<const clang::UnaryOperator*>(inc);
+    if (IsDeclRefTo(uop->getSubExpr(), info.counter)) {
+      if (uop->isIncrementOp()) {
+        info.step = 1;
+      } else if (uop->isDecrementOp()) {
+        info.step = -1;
+      }
+    }
+  } else if (inc->getStmtClass() == clang::Stmt::CompoundAssignOperatorClass) {
+    auto bop = clang_down_cast<const clang::CompoundAssignOperator*>(inc);
+    if (IsDeclRefTo(bop->getLHS(), info.counter) &&
+        (bop->getOpcode() == clang::BO_AddAssign ||
+         bop->getOpcode() == clang::BO_SubAssign)) {
+      XLS_ASSIGN_OR_RETURN(int64_t step,
+                           EvaluateInt64(*bop->getRHS(), ctx, loc));
+      info.step = (bop->getOpcode() == clang::BO_AddAssign) ? step : -step;
+    }
+  }
+  if (info.step == 0) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for increment must add a nonzero constant to the counter "
+        "at %s",
+        LocString(loc)));
+  }
+
+  // Condition: i <op> B
+  const clang::Expr* cond = stmt->getCond()->IgnoreParenImpCasts();
+  if (cond->getStmtClass() != clang::Stmt::BinaryOperatorClass ||
+      !IsDeclRefTo(
+          clang_down_cast<const clang::BinaryOperator*>(cond)->getLHS(),
+          info.counter)) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for condition must compare the counter to a constant at "
+        "%s",
+        LocString(loc)));
+  }
+  auto cond_op = clang_down_cast<const clang::BinaryOperator*>(cond);
+  XLS_ASSIGN_OR_RETURN(int64_t bound,
+                       EvaluateInt64(*cond_op->getRHS(), ctx, loc));
+
+  const int64_t init = info.init;
+  const int64_t step = info.step;
+  absl::optional<int64_t> trip_count;
+  switch (cond_op->getOpcode()) {
+    case clang::BO_LT:
+      if (init >= bound) {
+        trip_count = 0;
+      } else if (step > 0) {
+        trip_count = (bound - init + step - 1) / step;
+      }
+      break;
+    case clang::BO_LE:
+      if (init > bound) {
+        trip_count = 0;
+      } else if (step > 0) {
+        trip_count = (bound - init) / step + 1;
+      }
+      break;
+    case clang::BO_GT:
+      if (init <= bound) {
+        trip_count = 0;
+      } else if (step < 0) {
+        trip_count = (init - bound - step - 1) / -step;
+      }
+      break;
+    case clang::BO_GE:
+      if (init < bound) {
+        trip_count = 0;
+      } else if (step < 0) {
+        trip_count = (init - bound) / -step + 1;
+      }
+      break;
+    case clang::BO_NE:
+      if ((bound - init) % step == 0 && (bound - init) / step >= 0) {
+        trip_count = (bound - init) / step;
+      }
+      break;
+    default:
+      return absl::UnimplementedError(absl::StrFormat(
+          "Unsupported comparison in pipelined for condition at %s",
+          LocString(loc)));
+  }
+  if (!trip_count.has_value()) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Pipelined for loop doesn't terminate at %s", LocString(loc)));
+  }
+  info.trip_count = trip_count.value();
+  return info;
+}
+
+absl::Status Translator::GenerateIR_PipelinedFor(
+    const clang::ForStmt* stmt, clang::ASTContext& ctx,
+    const xls::SourceLocation& loc, int64_t unroll_factor) {
+  XLS_ASSIGN_OR_RETURN(CountedForInfo info, AnalyzeCountedFor(stmt, ctx, loc));
+
+  // Variables in scope, and "this", are carried through the loop in a tuple.
+  // Sort them so that the generated IR is deterministic.
+  std::vector<const clang::NamedDecl*> state_decls;
+  for (const auto& var : context().variables) {
+    if (var.second.value().valid()) {
+      state_decls.push_back(var.first);
+    }
+  }
+  std::sort(state_decls.begin(), state_decls.end(),
+            [](const clang::NamedDecl* a, const clang::NamedDecl* b) {
+              return a->getBeginLoc().getRawEncoding() <
+                     b->getBeginLoc().getRawEncoding();
+            });
+  const bool has_this = context().this_val.value().valid();
+
+  std::vector<xls::BValue> init_elements;
+  for (const clang::NamedDecl* decl : state_decls) {
+    init_elements.push_back(context().variables.at(decl).value());
+  }
+  if (has_this) {
+    init_elements.push_back(context().this_val.value());
+  }
+  xls::BValue init_tuple = context().fb->Tuple(init_elements, loc);
+
+  // Which state elements are assigned in the loop body
+  std::vector<bool> state_assigned(init_elements.size(), false);
+
+  xls::FunctionBuilder body_builder(
+      absl::StrFormat("for_body_%i", next_for_number_++), context().package);
+  xls::Function* body_function;
+  {
+    TranslationContext& prev_context = context();
+    PushContextGuard body_guard(*this, loc);
+    body_guard.propagate_up = false;
+
+    // The body is in a separate function, so it needs a clean context
+    context() = TranslationContext();
+    context().package = prev_context.package;
+    context().fb = absl::implicit_cast<xls::BuilderBase*>(&body_builder);
+    context().sf = prev_context.sf;
+    context().return_type = prev_context.return_type;
+    context().in_for_body = true;
+
+    xls::BValue index = body_builder.Param(
+        "i", context().package->GetBitsType(64), loc);
+    xls::BValue state =
+        body_builder.Param("state", init_tuple.GetType(), loc);
+
+    std::vector<xls::BValue> state_in;
+    context().variables = prev_context.variables;
+    for (size_t i = 0; i < state_decls.size(); ++i) {
+      const clang::NamedDecl* decl = state_decls[i];
+      state_in.push_back(body_builder.TupleIndex(state, i, loc));
+      context().variables[decl] =
+          CValue(state_in.back(), prev_context.variables.at(decl).type());
+    }
+    if (has_this) {
+      state_in.push_back(
+          body_builder.TupleIndex(state, state_decls.size(), loc));
+      context().this_val =
+          CValue(state_in.back(), prev_context.this_val.type());
+    }
+
+    // Loop unrolling causes duplicate NamedDecls which fail the sanity check.
+    // Reset the known set before each iteration.
+    auto saved_sanity_ids = sanity_check_unique_ids_;
+
+    for (int64_t j = 0; j < unroll_factor; ++j) {
+      sanity_check_unique_ids_ = saved_sanity_ids;
+
+      // Iteration number in the original loop
+      xls::BValue iteration = body_builder.Add(
+          body_builder.UMul(index,
+                            body_builder.Literal(
+                                xls::UBits(unroll_factor, 64), loc),
+                            64, loc),
+          body_builder.Literal(xls::UBits(j, 64), loc), loc);
+      xls::BValue counter = body_builder.Add(
+          body_builder.Literal(xls::SBits(info.init, 64), loc),
+          body_builder.UMul(iteration,
+                            body_builder.Literal(xls::SBits(info.step, 64),
+                                                 loc),
+                            64, loc),
+          loc);
+      counter =
+          body_builder.BitSlice(counter, 0, info.counter_type->width(), loc);
+
+      // The last trip runs fewer iterations if the unroll factor doesn't
+      // divide the trip count
+      xls::BValue in_range = body_builder.ULt(
+          iteration, body_builder.Literal(xls::UBits(info.trip_count, 64), loc),
+          loc);
+      const bool partial = (info.trip_count % unroll_factor) != 0;
+
+      PushContextGuard iter_guard(*this, loc);
+      iter_guard.propagate_break_up = true;
+      iter_guard.propagate_continue_up = false;
+      if (partial) {
+        context().and_condition(in_range, loc);
+      }
+
+      XLS_RETURN_IF_ERROR(DeclareVariable(
+          info.counter, CValue(counter, info.counter_type), loc));
+
+      // Don't allow assignment to the loop var in the body
+      DisallowAssignmentGuard assign_guard(*this);
+      context().forbidden_lvalues.insert(info.counter);
+
+      XLS_RETURN_IF_ERROR(GenerateIR_Compound(stmt->getBody(), ctx));
+    }
+
+    sanity_check_unique_ids_ = saved_sanity_ids;
+
+    if (context().break_condition.valid()) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Break in pipelined for loops is not supported at %s",
+          LocString(loc)));
+    }
+    if (context().have_returned_condition.valid() ||
+        context().return_val.valid()) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Return in pipelined for loops is not supported at %s",
+          LocString(loc)));
+    }
+
+    std::vector<xls::BValue> state_out;
+    for (const clang::NamedDecl* decl : state_decls) {
+      state_out.push_back(context().variables.at(decl).value());
+    }
+    if (has_this) {
+      state_out.push_back(context().this_val.value());
+    }
+    for (size_t i = 0; i < state_out.size(); ++i) {
+      state_assigned[i] = state_out[i].node() != state_in[i].node();
+    }
+    XLS_ASSIGN_OR_RETURN(
+        body_function,
+        body_builder.BuildWithReturnValue(body_builder.Tuple(state_out, loc)));
+  }
+
+  xls::BValue result = context().fb->CountedFor(
+      init_tuple,
+      /*trip_count=*/(info.trip_count + unroll_factor - 1) / unroll_factor,
+      /*stride=*/1, body_function, /*invariant_args=*/{}, loc);
+
+  // Only assign variables modified in the loop, as others may be forbidden
+  // lvalues, such as the counters of enclosing loops
+  for (size_t i = 0; i < state_decls.size(); ++i) {
+    if (!state_assigned[i]) continue;
+    const clang::NamedDecl* decl = state_decls[i];
+    XLS_RETURN_IF_ERROR(
+        Assign(decl,
+               CValue(context().fb->TupleIndex(result, i, loc),
+                      context().variables.at(decl).type()),
+               loc));
+  }
+  if (has_this && state_assigned.back()) {
+    XLS_RETURN_IF_ERROR(
+        AssignThis(CValue(context().fb->TupleIndex(result, state_decls.size(),
+                                                   loc),
+                          context().this_val.type()),
+                   loc));
+  }
+
+  return absl::OkStatus();
+}
+
 // First, flatten the statements in the switch
 // It follows a strange pattern where
 // case X: foo(); bar(); break;
@@ -428,6 +428,16 @@ class Translator {
   absl::Status ScanFile(absl::string_view source_filename,
                         absl::Span<absl::string_view> command_line_args);
 
+  // Returns the path of a precompiled header of header_filename, which
+  //  ScanFile() can use instead of parsing the header via
+  //  "-include-pch <path>" with the same command_line_args.
+  //
+  // The header is precompiled into cache_dir, and the result reused as long
+  //  as the arguments, the header and the files it includes are unchanged.
+  static absl::StatusOr<std::string> GetPrecompiledHeader(
+      absl::string_view header_filename, absl::string_view cache_dir,
+      absl::Span<absl::string_view> command_line_args);
+
   // Call after ScanFile, as the top function may be specified by #pragma
   // If none was found, an error is returned
   absl::StatusOr<std::string> GetEntryFunctionName() const;
@@ -680,11 +690,25 @@ class Translator {
   absl::flat_hash_set<const clang::NamedDecl*> sanity_check_unique_ids_;
 
   using PragmaLoc = std::tuple<std::string, int>;
-  enum Pragma { Pragma_Null = 0, Pragma_NoTuples, Pragma_Unroll, Pragma_Top };
+  enum Pragma {
+    Pragma_Null = 0,
+    Pragma_NoTuples,
+    Pragma_Unroll,
+    Pragma_Top,
+    // hls_unroll with a numeric factor: partially unroll into a counted_for
+    Pragma_UnrollFactor,
+    // hls_pipeline_init_interval: translate into a counted_for
+    Pragma_InitInterval,
+  };
   absl::flat_hash_map<PragmaLoc, Pragma> hls_pragmas_;
+  // Numeric arguments of pragmas which take them
+  absl::flat_hash_map<PragmaLoc, int64_t> hls_pragma_arguments_;
   absl::flat_hash_set<std::string> files_scanned_for_pragmas_;
 
-  absl::StatusOr<Pragma> FindPragmaForLoc(const clang::PresumedLoc& ploc);
+  // If argument is not null, it is set to the pragma's numeric argument,
+  //  if any.
+  absl::StatusOr<Pragma> FindPragmaForLoc(const clang::PresumedLoc& ploc,
+                                          int64_t* argument = nullptr);
 
   // Scans for top-level function candidates
   absl::Status VisitFunction(const clang::FunctionDecl* funcdecl);
@@ -698,6 +722,7 @@ class Translator {
   int next_file_number_ = 1;
 
   int next_asm_number_ = 1;
+  int next_for_number_ = 1;
 
   mutable std::unique_ptr<clang::MangleContext> mangler_;
 
@@ -797,6 +822,25 @@ class Translator {
                                       clang::ASTContext& ctx,
                                       const xls::SourceLocation& loc,
                                       bool deep_scan);
+
+  // A loop of the form for(T i = A; i <op> B; <step>) with constant A, B, and
+  //  step, which can be translated into a counted_for.
+  struct CountedForInfo {
+    const clang::NamedDecl* counter;
+    std::shared_ptr<CIntType> counter_type;
+    int64_t init;
+    int64_t step;
+    int64_t trip_count;
+  };
+  absl::StatusOr<CountedForInfo> AnalyzeCountedFor(
+      const clang::ForStmt* stmt, clang::ASTContext& ctx,
+      const xls::SourceLocation& loc);
+  // Translates the loop into a counted_for whose body contains unroll_factor
+  //  copies of the loop body. Variables in scope are passed as loop state.
+  absl::Status GenerateIR_PipelinedFor(const clang::ForStmt* stmt,
+                                       clang::ASTContext& ctx,
+                                       const xls::SourceLocation& loc,
+                                       int64_t unroll_factor);
   absl::Status GenerateIR_Switch(const clang::SwitchStmt* switchst,
                                  clang::ASTContext& ctx,
                                  const xls::SourceLocation& loc);
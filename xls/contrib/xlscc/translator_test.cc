@@ -22,6 +22,8 @@
 #include "gtest/gtest.h"
 #include "absl/strings/str_format.h"
 #include "xls/codegen/combinational_generator.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
 #include "xls/common/file/temp_file.h"
 #include "xls/common/status/matchers.h"
 #include "xls/common/status/ret_check.h"
@@ -1245,6 +1247,115 @@ TEST_F(TranslatorTest, ForUnrollContinue5) {
        })";
   Run({{"a", 11}, {"b", 20}}, 11, content);
 }
+
+TEST_F(TranslatorTest, ForPipelined) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_pipeline_init_interval 1
+         for(int i=0;i<1000;++i) {
+           a += b + i;
+         }
+         return a;
+       })";
+  Run({{"a", 11}, {"b", 20}}, 11 + 20 * 1000 + 999 * 1000 / 2, content);
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::string ir, SourceToIr(content));
+  EXPECT_THAT(ir, testing::HasSubstr("counted_for"));
+}
+
+TEST_F(TranslatorTest, ForPartialUnroll) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_unroll 4
+         for(int i=10;i>0;i-=1) {
+           if(i == 5) continue;
+           a += b * i;
+         }
+         return a;
+       })";
+  // 10 iterations don't divide evenly into trips of 4
+  Run({{"a", 11}, {"b", 2}}, 11 + 2 * (55 - 5), content);
+}
+
+TEST_F(TranslatorTest, ForPipelinedNested) {
+  const std::string content = R"(
+       long long my_package(long long a) {
+         #pragma hls_pipeline_init_interval 1
+         for(int i=0;i<100;i+=10) {
+           #pragma hls_unroll yes
+           for(int j=0;j<2;++j) {
+             a += j;
+           }
+           #pragma hls_unroll 3
+           for(unsigned k=0;k!=6;++k) {
+             a += i;
+           }
+         }
+         return a;
+       })";
+  Run({{"a", 3}}, 3 + 10 + 6 * 450, content);
+}
+
+TEST_F(TranslatorTest, ForPipelinedBreak) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_pipeline_init_interval 1
+         for(int i=0;i<50;++i) {
+           a += b;
+           if(a > 100) break;
+         }
+         return a;
+       })";
+  ASSERT_THAT(SourceToIr(content).status(),
+              xls::status_testing::StatusIs(absl::StatusCode::kUnimplemented,
+                                            testing::HasSubstr("Break")));
+}
+
+TEST_F(TranslatorTest, ForPipelinedInitInterval) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_pipeline_init_interval 2
+         for(int i=0;i<50;++i) {
+           a += b;
+         }
+         return a;
+       })";
+  ASSERT_THAT(
+      SourceToIr(content).status(),
+      xls::status_testing::StatusIs(absl::StatusCode::kUnimplemented,
+                                    testing::HasSubstr("initiation interval")));
+}
+
+TEST_F(TranslatorTest, ForPipelinedNotCounted) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_pipeline_init_interval 1
+         for(int i=0;i<b;++i) {
+           a += b;
+         }
+         return a;
+       })";
+  ASSERT_THAT(SourceToIr(content).status(),
+              xls::status_testing::StatusIs(
+                  absl::StatusCode::kInvalidArgument,
+                  testing::HasSubstr("Failed to evaluate")));
+}
+
+TEST_F(TranslatorTest, ForUnrollBadFactor) {
+  const std::string content = R"(
+       long long my_package(long long a, long long b) {
+         #pragma hls_unroll sometimes
+         for(int i=0;i<50;++i) {
+           a += b;
+         }
+         return a;
+       })";
+  ASSERT_THAT(SourceToIr(content).status(),
+              xls::status_testing::StatusIs(
+                  absl::StatusCode::kInvalidArgument,
+                  testing::HasSubstr("positive integer")));
+}
+
 TEST_F(TranslatorTest, ReturnFromFor) {
   const std::string content = R"(
        long long my_package(long long a, long long b) {
@@ -3366,6 +3477,52 @@ TEST_F(TranslatorTest, NativeOperatorLNot) {
   Run({{"a", -11}}, 0, content);
 }
 
+TEST_F(TranslatorTest, PrecompiledHeader) {
+  XLS_ASSERT_OK_AND_ASSIGN(xls::TempDirectory temp_dir,
+                           xls::TempDirectory::Create());
+  const std::string header = temp_dir.path() / "lib.h";
+  const std::string cache_dir = temp_dir.path() / "cache";
+  XLS_ASSERT_OK(xls::SetFileContents(header, R"(
+      #ifndef LIB_H
+      #define LIB_H
+      int Twice(int x) { return 2 * x; }
+      #endif)"));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::string pch,
+      Translator::GetPrecompiledHeader(header, cache_dir, {}));
+
+  // An unchanged header is not precompiled again.
+  XLS_ASSERT_OK(xls::SetFileContents(pch, "stale"));
+  EXPECT_THAT(Translator::GetPrecompiledHeader(header, cache_dir, {}),
+              IsOkAndHolds(pch));
+  EXPECT_THAT(xls::GetFileContents(pch), IsOkAndHolds("stale"));
+
+  XLS_ASSERT_OK(xls::SetFileContents(header, R"(
+      #ifndef LIB_H
+      #define LIB_H
+      int Twice(int x) { return x + x; }
+      #endif)"));
+  EXPECT_THAT(Translator::GetPrecompiledHeader(header, cache_dir, {}),
+              IsOkAndHolds(pch));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string pch_contents, xls::GetFileContents(pch));
+  EXPECT_NE(pch_contents, "stale");
+
+  const std::string source = temp_dir.path() / "top.cc";
+  XLS_ASSERT_OK(xls::SetFileContents(source, R"(
+      #include "lib.h"
+      #pragma hls_top
+      int my_package(int a) {
+        return Twice(a);
+      })"));
+  translator_ = absl::make_unique<xlscc::Translator>();
+  std::vector<absl::string_view> argv = {"-include-pch", pch};
+  XLS_ASSERT_OK(translator_->ScanFile(source, absl::MakeSpan(argv)));
+  xls::Package package("my_package");
+  XLS_ASSERT_OK(translator_->GenerateIR_Top_Function(&package).status());
+  RunAndExpectEq({{"a", 3}}, 6, package.DumpIr(), false, false);
+}
+
 }  // namespace
 
 }  // namespace xlscc
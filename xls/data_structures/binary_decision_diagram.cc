@@ -14,6 +14,7 @@
 
 #include "xls/data_structures/binary_decision_diagram.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "absl/status/status.h"
@@ -26,53 +27,101 @@
 #include "xls/common/logging/vlog_is_on.h"
 
 namespace xls {
+namespace {
 
-BinaryDecisionDiagram::BinaryDecisionDiagram() {
-  // Leaf node 0.
-  nodes_.push_back(BddNode(BddVariable(-1), BddNodeIndex(-1), BddNodeIndex(-1),
-                           /*m=*/0));
-  // Leaf node 1.
+// Sifting moves a variable no further in a direction once the BDD has grown
+// by this factor over its size when the variable started moving.
+constexpr double kMaxSiftGrowth = 1.2;
+
+// Bounds on the work done by one reordering. Only the variables with the most
+// nodes are sifted, and sifting stops after the given number of swaps.
+constexpr int64_t kMaxSiftedVariables = 1000;
+constexpr int64_t kMaxSiftSwaps = 1 << 21;
+
+// Returns the sum of the given minterm counts, saturating at INT32_MAX.
+int32_t SaturatingSum(int64_t a, int64_t b) {
+  return static_cast<int32_t>(std::min(
+      a + b, static_cast<int64_t>(std::numeric_limits<int32_t>::max())));
+}
+
+}  // namespace
+
+BinaryDecisionDiagram::BinaryDecisionDiagram()
+    : unique_table_(/*bucket_count=*/0, UniqueTableHash{&nodes_},
+                    UniqueTableEq{&nodes_}),
+      computed_table_(kMinComputedTableSize) {
+  // Leaf node 1. Leaf node 0 is its complement.
   nodes_.push_back(BddNode(BddVariable(-1), BddNodeIndex(-1), BddNodeIndex(-1),
-                           /*m=*/1));
+                           /*m=*/1, /*cm=*/0));
 }
 
 BddNodeIndex BinaryDecisionDiagram::GetOrCreateNode(BddVariable var,
                                                     BddNodeIndex high,
                                                     BddNodeIndex low) {
-  NodeKey key = std::make_tuple(var, high, low);
-  auto it = node_map_.find(key);
-  if (it != node_map_.end()) {
-    return it->second;
-  }
   if (low == high) {
     return low;
   }
-  // Compute the number of minterms that the new node will have. Use int64s to
-  // avoid overflowing and saturate at INT32_MAX.
-  int32_t minterms =
-      std::min(static_cast<int64_t>(GetNode(low).minterm_count) +
-                   GetNode(high).minterm_count,
-               static_cast<int64_t>(std::numeric_limits<int32_t>::max()));
-  nodes_.emplace_back(var, high, low, minterms);
-  BddNodeIndex node_index = BddNodeIndex(nodes_.size() - 1);
-  node_map_[key] = node_index;
-  return node_index;
+  // Only the low child may be complemented: f = !(var ? !high : !low).
+  bool complement = IsComplemented(high);
+  if (complement) {
+    high = Not(high);
+    low = Not(low);
+  }
+  auto it = unique_table_.lazy_emplace(
+      NodeKey(var, high, low), [&](const auto& ctor) {
+        // Compute the number of minterms that the new node will have.
+        BddNode node(
+            var, high, low,
+            SaturatingSum(minterm_count(high), minterm_count(low)),
+            SaturatingSum(minterm_count(Not(high)), minterm_count(Not(low))));
+        int32_t index;
+        if (free_nodes_.empty()) {
+          index = nodes_.size();
+          nodes_.push_back(node);
+        } else {
+          index = free_nodes_.back();
+          free_nodes_.pop_back();
+          nodes_[index] = node;
+        }
+        if (!ref_counts_.empty()) {
+          // Reordering is in progress.
+          if (index >= ref_counts_.size()) {
+            ref_counts_.resize(index + 1);
+          }
+          ref_counts_[index] = 0;
+          ++ref_counts_[high.value() >> 1];
+          ++ref_counts_[low.value() >> 1];
+          variable_nodes_[var.value()].push_back(index);
+        }
+        ctor(index);
+      });
+  BddNodeIndex node_index = BddNodeIndex(*it << 1);
+  return complement ? Not(node_index) : node_index;
 }
 
 BddNodeIndex BinaryDecisionDiagram::Restrict(BddNodeIndex expr, BddVariable var,
                                              bool value) {
-  if (expr == zero() || expr == one()) {
+  if (IsLeaf(expr)) {
     return expr;
   }
 
   const BddNode& node = GetNode(expr);
-  XLS_CHECK_LE(var, node.variable);
+  XLS_CHECK_LE(variable_levels_[var.value()], Level(expr));
   if (node.variable == var) {
-    return value ? node.high : node.low;
+    return Cofactor(expr, value);
   }
   return expr;
 }
 
+int64_t BinaryDecisionDiagram::ComputedTableIndex(
+    BddNodeIndex cond, BddNodeIndex if_true, BddNodeIndex if_false) const {
+  uint64_t hash = static_cast<uint32_t>(cond.value());
+  hash = hash * 0x9e3779b97f4a7c15ULL + static_cast<uint32_t>(if_true.value());
+  hash = hash * 0x9e3779b97f4a7c15ULL + static_cast<uint32_t>(if_false.value());
+  hash ^= hash >> 29;
+  return hash & (computed_table_.size() - 1);
+}
+
 BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
                                                BddNodeIndex if_true,
                                                BddNodeIndex if_false) {
@@ -82,32 +131,64 @@ BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
   if (cond == zero()) {
     return if_false;
   }
-  if (if_true == one() && if_false == zero()) {
-    return cond;
+  // Within the branches the value of the condition is known.
+  if (if_true == cond) {
+    if_true = one();
+  } else if (if_true == Not(cond)) {
+    if_true = zero();
+  }
+  if (if_false == cond) {
+    if_false = zero();
+  } else if (if_false == Not(cond)) {
+    if_false = one();
   }
   if (if_true == if_false) {
     return if_true;
   }
-  auto key = std::make_tuple(cond, if_true, if_false);
-  auto it = ite_map_.find(key);
-  if (it != ite_map_.end()) {
-    return it->second;
+  if (if_true == one() && if_false == zero()) {
+    return cond;
+  }
+  if (if_true == zero() && if_false == one()) {
+    return Not(cond);
+  }
+
+  // Normalize the expression so equivalent expressions share a computed table
+  // entry, using the identities:
+  //
+  //   ite(!c, t, f) = ite(c, f, t)
+  //   ite(c, !t, !f) = !ite(c, t, f)
+  //
+  if (IsComplemented(cond)) {
+    cond = Not(cond);
+    std::swap(if_true, if_false);
+  }
+  bool complement_result = IsComplemented(if_true);
+  if (complement_result) {
+    if_true = Not(if_true);
+    if_false = Not(if_false);
   }
+  auto complement_if_needed = [&](BddNodeIndex expr) {
+    return complement_result ? Not(expr) : expr;
+  };
 
-  // The expression is non-trivial and has not been computed before. Recursively
+  {
+    const ComputedTableEntry& entry =
+        computed_table_[ComputedTableIndex(cond, if_true, if_false)];
+    if (entry.cond == cond && entry.if_true == if_true &&
+        entry.if_false == if_false) {
+      return complement_if_needed(entry.result);
+    }
+  }
+
+  // The expression is non-trivial and is not in the computed table. Recursively
   // decompose the expression by peeling away the first variable and performing
   // a Shannon decomposition.
 
-  // First, find the lowest-index variable amongst all expressions. In all paths
-  // through the BDD the variable indices are strictly increasing.
-  BddVariable min_var = GetNode(cond).variable;
-  // Only non-leaf nodes (not zero or one) have associated variables.
-  if (if_true != zero() && if_true != one()) {
-    min_var = std::min(min_var, GetNode(if_true).variable);
-  }
-  if (if_false != zero() && if_false != one()) {
-    min_var = std::min(min_var, GetNode(if_false).variable);
-  }
+  // First, find the lowest-level variable amongst all expressions. In all
+  // paths through the BDD the variable levels are strictly increasing.
+  int64_t min_level =
+      std::min({Level(cond), Level(if_true), Level(if_false)});
+  BddVariable min_var = level_variables_[min_level];
 
   // Perform a Shannon expansion about the variable where Shannon expansion is
   // the identity:
@@ -120,24 +201,27 @@ BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
   BddNodeIndex false_cofactor = IfThenElse(Restrict(cond, min_var, false),
                                            Restrict(if_true, min_var, false),
                                            Restrict(if_false, min_var, false));
+  BddNodeIndex expr = GetOrCreateNode(min_var, true_cofactor, false_cofactor);
 
-  if (true_cofactor == false_cofactor) {
-    ite_map_[key] = true_cofactor;
-    return true_cofactor;
+  // Grow the computed table along with the BDD. Growing discards the cached
+  // results, which only costs recomputation.
+  if (nodes_.size() > computed_table_.size() &&
+      computed_table_.size() < kMaxComputedTableSize) {
+    computed_table_.assign(computed_table_.size() * 2, ComputedTableEntry());
   }
-  BddNodeIndex expr = GetOrCreateNode(min_var, true_cofactor, false_cofactor);
-  ite_map_[key] = expr;
-  return expr;
+  computed_table_[ComputedTableIndex(cond, if_true, if_false)] =
+      ComputedTableEntry{cond, if_true, if_false, expr};
+  return complement_if_needed(expr);
 }
 
 BddNodeIndex BinaryDecisionDiagram::NewVariable() {
   BddVariable var = next_var_;
   ++next_var_;
-  return GetOrCreateNode(var, one(), zero());
-}
-
-BddNodeIndex BinaryDecisionDiagram::Not(BddNodeIndex expr) {
-  return IfThenElse(expr, zero(), one());
+  BddNodeIndex base_node = GetOrCreateNode(var, one(), zero());
+  variable_base_nodes_.push_back(base_node);
+  variable_levels_.push_back(level_variables_.size());
+  level_variables_.push_back(var);
+  return base_node;
 }
 
 BddNodeIndex BinaryDecisionDiagram::Or(BddNodeIndex a, BddNodeIndex b) {
@@ -148,6 +232,249 @@ BddNodeIndex BinaryDecisionDiagram::And(BddNodeIndex a, BddNodeIndex b) {
   return IfThenElse(a, b, zero());
 }
 
+int64_t BinaryDecisionDiagram::GarbageCollect(
+    absl::Span<const BddNodeIndex> roots) {
+  // Mark the nodes reachable from the roots.
+  std::vector<bool> live(nodes_.size(), false);
+  live[0] = true;
+  std::vector<int32_t> worklist;
+  auto mark = [&](BddNodeIndex expr) {
+    int32_t node = expr.value() >> 1;
+    if (!live[node]) {
+      live[node] = true;
+      worklist.push_back(node);
+    }
+  };
+  for (BddNodeIndex root : roots) {
+    mark(root);
+  }
+  for (BddNodeIndex base_node : variable_base_nodes_) {
+    mark(base_node);
+  }
+  while (!worklist.empty()) {
+    const BddNode& node = nodes_[worklist.back()];
+    worklist.pop_back();
+    mark(node.high);
+    mark(node.low);
+  }
+
+  // Sweep the remaining nodes onto the free list.
+  int64_t freed_count = 0;
+  for (int32_t i = 1; i < nodes_.size(); ++i) {
+    if (live[i] || nodes_[i].variable == kFreedVariable) {
+      continue;
+    }
+    // The node must still hold its contents while it is erased.
+    unique_table_.erase(i);
+    nodes_[i] = BddNode(kFreedVariable, BddNodeIndex(-1), BddNodeIndex(-1),
+                        /*m=*/0, /*cm=*/0);
+    free_nodes_.push_back(i);
+    ++freed_count;
+  }
+
+  // Drop the cached results which refer to freed nodes.
+  auto is_live = [&](BddNodeIndex expr) { return live[expr.value() >> 1]; };
+  for (ComputedTableEntry& entry : computed_table_) {
+    if (entry.cond != BddNodeIndex(-1) &&
+        !(is_live(entry.cond) && is_live(entry.if_true) &&
+          is_live(entry.if_false) && is_live(entry.result))) {
+      entry = ComputedTableEntry();
+    }
+  }
+  XLS_VLOG(2) << absl::StreamFormat(
+      "BDD garbage collection freed %d nodes, %d remain", freed_count, size());
+  return freed_count;
+}
+
+void BinaryDecisionDiagram::Dereference(BddNodeIndex expr) {
+  std::vector<int32_t> worklist = {expr.value() >> 1};
+  while (!worklist.empty()) {
+    int32_t node = worklist.back();
+    worklist.pop_back();
+    // The leaf is never freed.
+    if (node == 0 || --ref_counts_[node] > 0) {
+      continue;
+    }
+    unique_table_.erase(node);
+    worklist.push_back(nodes_[node].high.value() >> 1);
+    worklist.push_back(nodes_[node].low.value() >> 1);
+    nodes_[node] = BddNode(kFreedVariable, BddNodeIndex(-1), BddNodeIndex(-1),
+                           /*m=*/0, /*cm=*/0);
+    reorder_freed_nodes_.push_back(node);
+  }
+}
+
+std::vector<int32_t>& BinaryDecisionDiagram::LiveVariableNodes(
+    BddVariable variable) {
+  std::vector<int32_t>& var_nodes = variable_nodes_[variable.value()];
+  var_nodes.erase(std::remove_if(var_nodes.begin(), var_nodes.end(),
+                                 [&](int32_t node) {
+                                   return nodes_[node].variable != variable;
+                                 }),
+                  var_nodes.end());
+  return var_nodes;
+}
+
+void BinaryDecisionDiagram::SwapLevels(int64_t level) {
+  BddVariable x = level_variables_[level];
+  BddVariable y = level_variables_[level + 1];
+  std::swap(level_variables_[level], level_variables_[level + 1]);
+  variable_levels_[x.value()] = level + 1;
+  variable_levels_[y.value()] = level;
+  ++reorder_stats_.swap_count;
+
+  // Nodes of x which do not depend on y are unaffected: they simply move down
+  // a level. The others are removed from the unique table before any node is
+  // created, as their contents are about to change.
+  auto depends_on_y = [&](BddNodeIndex expr) {
+    return !IsLeaf(expr) && GetNode(expr).variable == y;
+  };
+  std::vector<int32_t> x_nodes = std::move(LiveVariableNodes(x));
+  variable_nodes_[x.value()].clear();
+  std::vector<int32_t> rewritten;
+  for (int32_t node : x_nodes) {
+    if (depends_on_y(nodes_[node].high) || depends_on_y(nodes_[node].low)) {
+      unique_table_.erase(node);
+      rewritten.push_back(node);
+    } else {
+      variable_nodes_[x.value()].push_back(node);
+    }
+  }
+  LiveVariableNodes(y);
+
+  // Rewrite each remaining node f = x ? (y ? f11 : f10) : (y ? f01 : f00) as
+  // y ? (x ? f11 : f01) : (x ? f10 : f00), which is the same function.
+  for (int32_t node : rewritten) {
+    BddNodeIndex f1 = nodes_[node].high;
+    BddNodeIndex f0 = nodes_[node].low;
+    auto cofactor = [&](BddNodeIndex expr, bool value) {
+      return depends_on_y(expr) ? Cofactor(expr, value) : expr;
+    };
+    BddNodeIndex high =
+        GetOrCreateNode(x, cofactor(f1, true), cofactor(f0, true));
+    BddNodeIndex low =
+        GetOrCreateNode(x, cofactor(f1, false), cofactor(f0, false));
+    XLS_DCHECK(!IsComplemented(high));
+    ++ref_counts_[high.value() >> 1];
+    ++ref_counts_[low.value() >> 1];
+    Dereference(f1);
+    Dereference(f0);
+    // The minterm counts are recomputed once reordering completes.
+    nodes_[node].variable = y;
+    nodes_[node].high = high;
+    nodes_[node].low = low;
+    XLS_CHECK(unique_table_.insert(node).second);
+    variable_nodes_[y.value()].push_back(node);
+  }
+}
+
+void BinaryDecisionDiagram::SiftVariable(BddVariable variable,
+                                         int64_t max_swap_count) {
+  const int64_t last_level = variable_count() - 1;
+  const int64_t size_limit = static_cast<int64_t>(size() * kMaxSiftGrowth);
+  int64_t best_size = size();
+  int64_t best_level = GetVariableLevel(variable);
+
+  // Moves the variable one level down (or up) at a time until it reaches the
+  // bottom (or top), the BDD grows too much, or the swap budget is exhausted.
+  auto move = [&](bool down) {
+    while (reorder_stats_.swap_count < max_swap_count) {
+      int64_t level = GetVariableLevel(variable);
+      if (down ? level == last_level : level == 0) {
+        return;
+      }
+      SwapLevels(down ? level : level - 1);
+      if (size() < best_size) {
+        best_size = size();
+        best_level = GetVariableLevel(variable);
+      }
+      if (size() > size_limit) {
+        return;
+      }
+    }
+  };
+  // Move towards the nearer end first.
+  bool down_first = GetVariableLevel(variable) > last_level / 2;
+  move(down_first);
+  move(!down_first);
+
+  // Return to the best level found.
+  while (GetVariableLevel(variable) < best_level) {
+    SwapLevels(GetVariableLevel(variable));
+  }
+  while (GetVariableLevel(variable) > best_level) {
+    SwapLevels(GetVariableLevel(variable) - 1);
+  }
+}
+
+void BinaryDecisionDiagram::Reorder(absl::Span<const BddNodeIndex> roots) {
+  GarbageCollect(roots);
+  int64_t size_before = size();
+  int64_t swaps_before = reorder_stats_.swap_count;
+
+  // Count the references to each node and gather the nodes of each variable.
+  ref_counts_.assign(nodes_.size(), 0);
+  variable_nodes_.assign(variable_count(), {});
+  for (int32_t i = 1; i < nodes_.size(); ++i) {
+    const BddNode& node = nodes_[i];
+    if (node.variable == kFreedVariable) {
+      continue;
+    }
+    ++ref_counts_[node.high.value() >> 1];
+    ++ref_counts_[node.low.value() >> 1];
+    variable_nodes_[node.variable.value()].push_back(i);
+  }
+  for (BddNodeIndex root : roots) {
+    ++ref_counts_[root.value() >> 1];
+  }
+  for (BddNodeIndex base_node : variable_base_nodes_) {
+    ++ref_counts_[base_node.value() >> 1];
+  }
+
+  // Sift the variables with the most nodes first.
+  std::vector<BddVariable> variables;
+  for (int64_t i = 0; i < variable_count(); ++i) {
+    variables.push_back(BddVariable(i));
+  }
+  std::stable_sort(variables.begin(), variables.end(),
+                   [&](BddVariable a, BddVariable b) {
+                     return variable_nodes_[a.value()].size() >
+                            variable_nodes_[b.value()].size();
+                   });
+  if (variables.size() > kMaxSiftedVariables) {
+    variables.resize(kMaxSiftedVariables);
+  }
+  for (BddVariable variable : variables) {
+    SiftVariable(variable, swaps_before + kMaxSiftSwaps);
+  }
+
+  // Recompute the minterm counts bottom-up, as they depend on the order.
+  for (int64_t level = variable_count() - 1; level >= 0; --level) {
+    for (int32_t i : LiveVariableNodes(level_variables_[level])) {
+      BddNode& node = nodes_[i];
+      node.minterm_count =
+          SaturatingSum(minterm_count(node.high), minterm_count(node.low));
+      node.complement_minterm_count = SaturatingSum(
+          minterm_count(Not(node.high)), minterm_count(Not(node.low)));
+    }
+  }
+
+  // Cached results may refer to the freed nodes, which become reusable.
+  computed_table_.assign(computed_table_.size(), ComputedTableEntry());
+  free_nodes_.insert(free_nodes_.end(), reorder_freed_nodes_.begin(),
+                     reorder_freed_nodes_.end());
+  reorder_freed_nodes_.clear();
+  ref_counts_.clear();
+  variable_nodes_.clear();
+
+  ++reorder_stats_.reorder_count;
+  reorder_stats_.nodes_before += size_before;
+  reorder_stats_.nodes_after += size();
+  XLS_VLOG(2) << absl::StreamFormat(
+      "BDD reordering reduced the BDD from %d to %d nodes with %d swaps",
+      size_before, size(), reorder_stats_.swap_count - swaps_before);
+}
+
 absl::StatusOr<bool> BinaryDecisionDiagram::Evaluate(
     BddNodeIndex expr,
     const absl::flat_hash_map<BddNodeIndex, bool>& variable_values) const {
@@ -166,15 +493,14 @@ absl::StatusOr<bool> BinaryDecisionDiagram::Evaluate(
                   << variable_values.at(node);
     }
   }
-  while (result != zero() && result != one()) {
+  while (!IsLeaf(result)) {
     BddNodeIndex var_node = GetVariableBaseNode(GetNode(result).variable);
     if (!variable_values.contains(var_node)) {
       return absl::InvalidArgumentError(
           absl::StrFormat("Missing value for BDD variable %d (node index %d)",
                           GetNode(result).variable.value(), var_node.value()));
     }
-    result = variable_values.at(var_node) ? GetNode(result).high
-                                          : GetNode(result).low;
+    result = Cofactor(result, variable_values.at(var_node));
   }
   XLS_VLOG(2) << "  result = " << (result == one() ? true : false);
   return result == one();
@@ -207,9 +533,9 @@ void BinaryDecisionDiagram::ToStringDnfHelper(BddNodeIndex expr,
 
   const BddNode& node = GetNode(expr);
   terms->push_back(absl::StrCat("x", node.variable.value()));
-  ToStringDnfHelper(node.high, minterms_to_emit, terms, str);
+  ToStringDnfHelper(Cofactor(expr, true), minterms_to_emit, terms, str);
   terms->back() = absl::StrCat("!x", node.variable.value());
-  ToStringDnfHelper(node.low, minterms_to_emit, terms, str);
+  ToStringDnfHelper(Cofactor(expr, false), minterms_to_emit, terms, str);
   terms->pop_back();
 }
 
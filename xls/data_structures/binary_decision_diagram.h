@@ -16,9 +16,16 @@
 #define XLS_DATA_STRUCTURES_BINARY_DECISION_DIAGRAM_H_
 
 #include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/common/strong_int.h"
 
 namespace xls {
@@ -33,48 +40,81 @@ namespace xls {
 //   https://ieeexplore.ieee.org/document/114826
 
 // For efficiency variables and nodes are referred to by indices into vector
-// data members in the BDD.
+// data members in the BDD. An expression (BddNodeIndex) refers to a node and
+// has an additional bit indicating whether the expression is the complement of
+// the function represented by the node ("complement edges"). A function and
+// its complement therefore share all nodes, and negation is constant time.
 DEFINE_STRONG_INT_TYPE(BddVariable, int32_t);
 DEFINE_STRONG_INT_TYPE(BddNodeIndex, int32_t);
 
 // A node in the BDD. The node is associated with a single variable and has
 // children corresponding to when the variable is true (high) and when it is
-// false (low).
+// false (low). The high child is never a complemented expression, which keeps
+// the representation of each function unique.
 struct BddNode {
-  BddNode() : variable(0), high(0), low(0), minterm_count(0) {}
-  BddNode(BddVariable v, BddNodeIndex h, BddNodeIndex l, int32_t m)
-      : variable(v), high(h), low(l), minterm_count(m) {}
+  BddNode()
+      : variable(0),
+        high(0),
+        low(0),
+        minterm_count(0),
+        complement_minterm_count(0) {}
+  BddNode(BddVariable v, BddNodeIndex h, BddNodeIndex l, int32_t m,
+          int32_t cm)
+      : variable(v),
+        high(h),
+        low(l),
+        minterm_count(m),
+        complement_minterm_count(cm) {}
 
   BddVariable variable;
   BddNodeIndex high;
   BddNodeIndex low;
 
-  // Number of minterms in the expression. A minterm is a term in a
-  // sum-of-products form of the boolean function, or equivalently a path to the
-  // leaf node '1' from the BDD node. Saturates at INT32_MAX.
+  // Number of minterms in the expression of the node and of its complement. A
+  // minterm is a term in a sum-of-products form of the boolean function, or
+  // equivalently a path to the leaf node '1' from the BDD node. Saturates at
+  // INT32_MAX.
   int32_t minterm_count;
+  int32_t complement_minterm_count;
+};
+
+// Statistics about the variable reorderings performed by a BDD.
+struct BddReorderStats {
+  // The number of calls to Reorder.
+  int64_t reorder_count = 0;
+  // The number of swaps of adjacent variables, over all reorderings.
+  int64_t swap_count = 0;
+  // The sum of the BDD sizes before and after each reordering.
+  int64_t nodes_before = 0;
+  int64_t nodes_after = 0;
 };
 
 class BinaryDecisionDiagram {
  public:
-  // Creates an empty BDD. Initialize the BDD contains only the nodes
-  // corresponding to zero and one.
+  // Creates an empty BDD. Initialize the BDD contains only the leaf node
+  // corresponding to one (zero is its complement).
   BinaryDecisionDiagram();
 
+  // The unique table refers to the node vector, so the BDD cannot be moved.
+  BinaryDecisionDiagram(const BinaryDecisionDiagram&) = delete;
+  BinaryDecisionDiagram& operator=(const BinaryDecisionDiagram&) = delete;
+
   // Adds a new variable to the BDD and returns the node corresponding the
   // variable's value.
   BddNodeIndex NewVariable();
 
   // Returns the inverse of the given expression.
-  BddNodeIndex Not(BddNodeIndex expr);
+  BddNodeIndex Not(BddNodeIndex expr) const {
+    return BddNodeIndex(expr.value() ^ 1);
+  }
 
   // Returns the OR/AND of the given expressions.
   BddNodeIndex And(BddNodeIndex a, BddNodeIndex b);
   BddNodeIndex Or(BddNodeIndex a, BddNodeIndex b);
 
   // Returns the leaf node corresponding to zero or one.
-  BddNodeIndex zero() const { return BddNodeIndex(0); }
-  BddNodeIndex one() const { return BddNodeIndex(1); }
+  BddNodeIndex zero() const { return BddNodeIndex(1); }
+  BddNodeIndex one() const { return BddNodeIndex(0); }
 
   // Evaluates the given expression with the given variable values. The keys in
   // the map are the *node* indices of the respective variable (value returned
@@ -84,20 +124,58 @@ class BinaryDecisionDiagram {
       BddNodeIndex expr,
       const absl::flat_hash_map<BddNodeIndex, bool>& variable_values) const;
 
-  // Returns the BDD node with the given index.
-  const BddNode& GetNode(BddNodeIndex node_index) const {
-    return nodes_.at(node_index.value());
+  // Returns the BDD node referred to by the given expression. If the
+  // expression is complemented, the expression is the complement of the
+  // function of the node.
+  const BddNode& GetNode(BddNodeIndex expr) const {
+    return nodes_.at(expr.value() >> 1);
   }
 
+  // Returns whether the given expression is the complement of its node.
+  static bool IsComplemented(BddNodeIndex expr) { return expr.value() & 1; }
+
   // Returns the number of nodes in the graph.
-  int64_t size() const { return nodes_.size(); }
+  int64_t size() const {
+    return nodes_.size() - free_nodes_.size() - reorder_freed_nodes_.size();
+  }
+
+  // Frees the nodes which are not reachable from the given expressions or
+  // from the base nodes of the variables. Freed nodes are reused by later
+  // operations, so expressions referring to them must no longer be used. The
+  // indices of the remaining nodes are unchanged. Returns the number of nodes
+  // freed.
+  int64_t GarbageCollect(absl::Span<const BddNodeIndex> roots);
 
   // Returns the number of variables in the graph.
   int64_t variable_count() const { return next_var_.value(); }
 
+  // Returns the position of the given variable in the variable order. Paths
+  // through the BDD visit variables in increasing order of level. Variables
+  // are initially ordered by creation.
+  int64_t GetVariableLevel(BddVariable variable) const {
+    return variable_levels_.at(variable.value());
+  }
+
+  // Reorders the variables to reduce the size of the BDD using Rudell's
+  // sifting algorithm: each variable in turn is moved through all levels by
+  // swapping adjacent variables, and left at the level where the BDD is
+  // smallest. Nodes not reachable from the given expressions (or from the
+  // base nodes of the variables) are freed first, as by GarbageCollect. The
+  // nodes reachable from them keep their indices and functions, so the
+  // expressions remain valid. Minterm counts, which depend on the variable
+  // order, are updated.
+  //
+  // Based on:
+  //   R. Rudell, "Dynamic variable ordering for ordered binary decision
+  //   diagrams", https://ieeexplore.ieee.org/document/580029
+  void Reorder(absl::Span<const BddNodeIndex> roots);
+
+  const BddReorderStats& reorder_stats() const { return reorder_stats_; }
+
   // Returns the number of minterms in the given expression.
   int64_t minterm_count(BddNodeIndex expr) const {
-    return GetNode(expr).minterm_count;
+    return IsComplemented(expr) ? GetNode(expr).complement_minterm_count
+                                : GetNode(expr).minterm_count;
   }
 
   // Returns the given expression in disjunctive normal form (sum of products).
@@ -109,7 +187,8 @@ class BinaryDecisionDiagram {
   // variable. The expression of a base node is exactly equal to the value of
   // the variable.
   bool IsVariableBaseNode(BddNodeIndex expr) const {
-    return GetNode(expr).high == one() && GetNode(expr).low == zero();
+    return !IsComplemented(expr) && GetNode(expr).high == one() &&
+           GetNode(expr).low == zero();
   }
 
  private:
@@ -118,11 +197,28 @@ class BinaryDecisionDiagram {
                          std::vector<std::string>* terms,
                          std::string* str) const;
 
+  static bool IsLeaf(BddNodeIndex expr) { return (expr.value() >> 1) == 0; }
+
   // Get the node corresponding to the given variable with the given low/high
   // children. Creates it if it does not exist.
   BddNodeIndex GetOrCreateNode(BddVariable var, BddNodeIndex high,
                                BddNodeIndex low);
 
+  // Returns the level of the variable of the given expression's node. Leaves
+  // are below every variable.
+  int64_t Level(BddNodeIndex expr) const {
+    return IsLeaf(expr) ? std::numeric_limits<int64_t>::max()
+                        : variable_levels_[GetNode(expr).variable.value()];
+  }
+
+  // Returns the expression of the high or low child of the node of the given
+  // non-leaf expression, complemented if the expression is.
+  BddNodeIndex Cofactor(BddNodeIndex expr, bool value) const {
+    const BddNode& node = GetNode(expr);
+    BddNodeIndex child = value ? node.high : node.low;
+    return IsComplemented(expr) ? Not(child) : child;
+  }
+
   // Returns the node equal to given expression with the given variable
   // set to the given value.
   BddNodeIndex Restrict(BddNodeIndex expr, BddVariable var, bool value);
@@ -131,29 +227,100 @@ class BinaryDecisionDiagram {
   BddNodeIndex IfThenElse(BddNodeIndex cond, BddNodeIndex if_true,
                           BddNodeIndex if_false);
 
+  // Sifting helpers. SwapLevels exchanges the variables at the given level and
+  // the level below it, rewriting in place the nodes of the upper variable
+  // which depend on the lower one. SiftVariable moves the given variable to
+  // the level where the BDD is smallest, stopping early once the total swap
+  // count reaches 'max_swap_count'.
+  void SwapLevels(int64_t level);
+  void SiftVariable(BddVariable variable, int64_t max_swap_count);
+  // Drops a reference to the node of the given expression, freeing it (and
+  // recursively its children) if no references remain.
+  void Dereference(BddNodeIndex expr);
+  // Returns the live nodes of the given variable, removing freed ones from
+  // variable_nodes_.
+  std::vector<int32_t>& LiveVariableNodes(BddVariable variable);
+
   // Returns the node corresponding to the value of the given variable.
   BddNodeIndex GetVariableBaseNode(BddVariable variable) const {
-    return node_map_.at({variable, one(), zero()});
+    return variable_base_nodes_.at(variable.value());
   }
 
   // The numeric id to use for the next created variable. Increments with each
   // call to NewVariable which
   BddVariable next_var_ = BddVariable(0);
 
-  // The vector of all the nodes in the BDD.
+  // The vector of all the nodes in the BDD, including freed ones.
   std::vector<BddNode> nodes_;
 
-  // A map from BDD node content (variable id, high child, low child) to the
-  // index of the respective node. This map is used to ensure that no duplicate
-  // nodes are created.
+  // The indices of the freed nodes in nodes_. The variable of a freed node is
+  // kFreedVariable.
+  std::vector<int32_t> free_nodes_;
+  static constexpr BddVariable kFreedVariable = BddVariable(-2);
+
+  // The base node of each variable, indexed by variable.
+  std::vector<BddNodeIndex> variable_base_nodes_;
+
+  // The level of each variable, indexed by variable, and the variable at each
+  // level.
+  std::vector<int32_t> variable_levels_;
+  std::vector<BddVariable> level_variables_;
+
+  // State used only while reordering, empty otherwise: the number of
+  // references to each node from other nodes and from the roots, the nodes of
+  // each variable, and the nodes freed during reordering. Freed nodes are not
+  // reused until reordering completes, so the indices in variable_nodes_ stay
+  // unambiguous.
+  std::vector<int32_t> ref_counts_;
+  std::vector<std::vector<int32_t>> variable_nodes_;
+  std::vector<int32_t> reorder_freed_nodes_;
+  BddReorderStats reorder_stats_;
+
+  // The set of the indices of all nodes in nodes_, hashed by node content
+  // (variable id, high child, low child). It is used to ensure that no
+  // duplicate nodes are created, and can be searched by node content without
+  // storing the content a second time.
   using NodeKey = std::tuple<BddVariable, BddNodeIndex, BddNodeIndex>;
-  absl::flat_hash_map<NodeKey, BddNodeIndex> node_map_;
-
-  // A map from if-then-else expression to the node corresponding to that
-  // expression. The key elements are (condition, if-true, if-false). This map
-  // enables fast lookup for expressions.
-  using IteKey = std::tuple<BddNodeIndex, BddNodeIndex, BddNodeIndex>;
-  absl::flat_hash_map<IteKey, BddNodeIndex> ite_map_;
+  struct UniqueTableHash {
+    using is_transparent = void;
+    size_t operator()(const NodeKey& key) const {
+      return absl::Hash<NodeKey>()(key);
+    }
+    size_t operator()(int32_t node) const {
+      const BddNode& n = (*nodes)[node];
+      return (*this)(NodeKey(n.variable, n.high, n.low));
+    }
+    const std::vector<BddNode>* nodes;
+  };
+  struct UniqueTableEq {
+    using is_transparent = void;
+    bool operator()(int32_t a, int32_t b) const { return a == b; }
+    bool operator()(const NodeKey& key, int32_t node) const {
+      const BddNode& n = (*nodes)[node];
+      return key == NodeKey(n.variable, n.high, n.low);
+    }
+    bool operator()(int32_t node, const NodeKey& key) const {
+      return (*this)(key, node);
+    }
+    const std::vector<BddNode>* nodes;
+  };
+  absl::flat_hash_set<int32_t, UniqueTableHash, UniqueTableEq> unique_table_;
+
+  // A cache of if-then-else results, indexed by a hash of the operands
+  // (condition, if-true, if-false). Colliding entries overwrite each other, so
+  // the cache bounds the memory spent on memoization, unlike the unique
+  // table. It grows with the number of nodes up to kMaxComputedTableSize.
+  struct ComputedTableEntry {
+    BddNodeIndex cond = BddNodeIndex(-1);
+    BddNodeIndex if_true;
+    BddNodeIndex if_false;
+    BddNodeIndex result;
+  };
+  static constexpr int64_t kMinComputedTableSize = 1 << 10;
+  static constexpr int64_t kMaxComputedTableSize = 1 << 22;
+  int64_t ComputedTableIndex(BddNodeIndex cond, BddNodeIndex if_true,
+                             BddNodeIndex if_false) const;
+  std::vector<ComputedTableEntry> computed_table_;
 };
 
 }  // namespace xls
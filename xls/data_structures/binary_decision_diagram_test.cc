@@ -14,6 +14,8 @@
 
 #include "xls/data_structures/binary_decision_diagram.h"
 
+#include <functional>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/container/inlined_vector.h"
@@ -85,6 +87,139 @@ TEST(BinaryDecisionDiagramTest, BddSize) {
   }
 }
 
+TEST(BinaryDecisionDiagramTest, ComplementEdges) {
+  BinaryDecisionDiagram bdd;
+  BddNodeIndex x0 = bdd.NewVariable();
+  BddNodeIndex x1 = bdd.NewVariable();
+  EXPECT_EQ(bdd.Not(bdd.zero()), bdd.one());
+  EXPECT_EQ(bdd.Not(bdd.Not(x0)), x0);
+
+  // A function and its complement share their nodes.
+  BddNodeIndex x0_and_x1 = bdd.And(x0, x1);
+  int64_t before_size = bdd.size();
+  BddNodeIndex nand = bdd.Not(x0_and_x1);
+  EXPECT_EQ(bdd.Or(bdd.Not(x0), bdd.Not(x1)), nand);
+  EXPECT_EQ(bdd.size(), before_size);
+
+  EXPECT_EQ(bdd.minterm_count(x0_and_x1), 1);
+  EXPECT_EQ(bdd.minterm_count(nand), 2);
+  EXPECT_EQ(bdd.ToStringDnf(nand), "x0.!x1 + !x0");
+  EXPECT_TRUE(bdd.IsVariableBaseNode(x0));
+  EXPECT_FALSE(bdd.IsVariableBaseNode(bdd.Not(x0)));
+  EXPECT_THAT(bdd.Evaluate(nand, {{x0, true}, {x1, true}}),
+              IsOkAndHolds(false));
+  EXPECT_THAT(bdd.Evaluate(nand, {{x0, true}, {x1, false}}),
+              IsOkAndHolds(true));
+}
+
+TEST(BinaryDecisionDiagramTest, GarbageCollection) {
+  BinaryDecisionDiagram bdd;
+  BddNodeIndex x0 = bdd.NewVariable();
+  BddNodeIndex x1 = bdd.NewVariable();
+  BddNodeIndex x2 = bdd.NewVariable();
+  BddNodeIndex x3 = bdd.NewVariable();
+  BddNodeIndex kept = bdd.And(x0, bdd.Or(x1, x2));
+  std::string kept_string = bdd.ToStringDnf(kept);
+  int64_t kept_size = bdd.size();
+
+  auto make_garbage = [&]() {
+    return bdd.Or(bdd.And(x0, x3), bdd.And(bdd.Not(x1), x2));
+  };
+  make_garbage();
+  int64_t garbage_size = bdd.size();
+  EXPECT_GT(garbage_size, kept_size);
+
+  EXPECT_EQ(bdd.GarbageCollect({kept}), garbage_size - kept_size);
+  EXPECT_EQ(bdd.size(), kept_size);
+  EXPECT_EQ(bdd.GarbageCollect({kept}), 0);
+
+  // The kept expression and the variables are intact, and expressions can
+  // be rebuilt from the freed nodes.
+  EXPECT_EQ(bdd.ToStringDnf(kept), kept_string);
+  EXPECT_EQ(bdd.And(x0, bdd.Or(x1, x2)), kept);
+  BddNodeIndex rebuilt = make_garbage();
+  EXPECT_EQ(bdd.size(), garbage_size);
+  EXPECT_THAT(bdd.Evaluate(rebuilt, {{x0, false}, {x1, false}, {x2, true}}),
+              IsOkAndHolds(true));
+  EXPECT_THAT(bdd.Evaluate(rebuilt, {{x0, false}, {x1, true}, {x2, true}}),
+              IsOkAndHolds(false));
+
+  // Only the leaf and the base nodes of the variables remain.
+  EXPECT_EQ(bdd.GarbageCollect({}), garbage_size - 5);
+  EXPECT_EQ(bdd.size(), 5);
+}
+
+TEST(BinaryDecisionDiagramTest, Reorder) {
+  // Equality of two words is exponential in the word size when one word's
+  // variables all precede the other's, and linear when they are interleaved.
+  constexpr int64_t kWidth = 6;
+  BinaryDecisionDiagram bdd;
+  std::vector<BddNodeIndex> variables;
+  for (int64_t i = 0; i < 2 * kWidth; ++i) {
+    variables.push_back(bdd.NewVariable());
+  }
+  auto build_eq = [&]() {
+    BddNodeIndex eq = bdd.one();
+    for (int64_t i = 0; i < kWidth; ++i) {
+      BddNodeIndex x = variables[i];
+      BddNodeIndex y = variables[kWidth + i];
+      eq = bdd.And(eq, bdd.Or(bdd.And(x, y), bdd.And(bdd.Not(x), bdd.Not(y))));
+    }
+    return eq;
+  };
+  BddNodeIndex eq = build_eq();
+  BddNodeIndex x0_or_y1 = bdd.Or(variables[0], variables[kWidth + 1]);
+  bdd.GarbageCollect({eq, x0_or_y1});
+  int64_t size_before = bdd.size();
+
+  // Returns the number of paths to one from the given expression.
+  std::function<int64_t(BddNodeIndex)> count_paths = [&](BddNodeIndex expr) {
+    if (expr == bdd.one() || expr == bdd.zero()) {
+      return int64_t{expr == bdd.one()};
+    }
+    const BddNode& node = bdd.GetNode(expr);
+    BddNodeIndex high = node.high;
+    BddNodeIndex low = node.low;
+    if (BinaryDecisionDiagram::IsComplemented(expr)) {
+      high = bdd.Not(high);
+      low = bdd.Not(low);
+    }
+    return count_paths(high) + count_paths(low);
+  };
+
+  // With interleaved variables the BDD holds the leaf, the base nodes of the
+  // variables, three nodes per bit of the equality and one for the OR.
+  bdd.Reorder({eq, x0_or_y1});
+  EXPECT_LE(bdd.size(), 1 + 2 * kWidth + 3 * kWidth + 1);
+  EXPECT_LT(bdd.size(), size_before);
+  EXPECT_EQ(bdd.reorder_stats().reorder_count, 1);
+  EXPECT_GT(bdd.reorder_stats().swap_count, 0);
+  EXPECT_EQ(bdd.reorder_stats().nodes_before, size_before);
+  EXPECT_EQ(bdd.reorder_stats().nodes_after, bdd.size());
+
+  // The expressions and variables are intact, and new expressions are built
+  // in the new order.
+  for (int64_t i = 0; i < 2 * kWidth; ++i) {
+    EXPECT_TRUE(bdd.IsVariableBaseNode(variables[i]));
+    EXPECT_EQ(bdd.GetNode(variables[i]).variable, BddVariable(i));
+  }
+  EXPECT_EQ(build_eq(), eq);
+  EXPECT_EQ(bdd.Or(variables[kWidth + 1], variables[0]), x0_or_y1);
+  EXPECT_EQ(bdd.minterm_count(eq), count_paths(eq));
+  EXPECT_EQ(bdd.minterm_count(bdd.Not(eq)), count_paths(bdd.Not(eq)));
+  EXPECT_EQ(bdd.minterm_count(x0_or_y1), count_paths(x0_or_y1));
+  for (int64_t value = 0; value < (1 << (2 * kWidth)); ++value) {
+    absl::flat_hash_map<BddNodeIndex, bool> values;
+    for (int64_t i = 0; i < 2 * kWidth; ++i) {
+      values[variables[i]] = (value >> i) & 1;
+    }
+    bool x_eq_y = (value & ((1 << kWidth) - 1)) == (value >> kWidth);
+    EXPECT_THAT(bdd.Evaluate(eq, values), IsOkAndHolds(x_eq_y));
+    EXPECT_THAT(bdd.Evaluate(x0_or_y1, values),
+                IsOkAndHolds((value & 1) || ((value >> (kWidth + 1)) & 1)));
+  }
+}
+
 TEST(BinaryDecisionDiagramTest, ToString) {
   BinaryDecisionDiagram bdd;
   BddNodeIndex x0 = bdd.NewVariable();
@@ -0,0 +1,289 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/data_structures/difference_constraints.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace {
+
+constexpr int64_t kInfinity = std::numeric_limits<int64_t>::max();
+
+// The residual network of a minimum cost flow problem. Each arc is stored
+// alongside its reverse residual arc: arc i and arc i ^ 1 are a pair.
+class FlowNetwork {
+ public:
+  struct Arc {
+    int64_t to;
+    int64_t capacity;
+    int64_t cost;
+  };
+
+  explicit FlowNetwork(int64_t node_count) : node_arcs_(node_count) {}
+
+  // Adds an arc and its (initially empty) reverse arc. Returns the index of
+  // the arc.
+  int64_t AddArc(int64_t from, int64_t to, int64_t capacity, int64_t cost) {
+    int64_t index = arcs_.size();
+    arcs_.push_back({to, capacity, cost});
+    node_arcs_[from].push_back(index);
+    arcs_.push_back({from, 0, -cost});
+    node_arcs_[to].push_back(index + 1);
+    return index;
+  }
+
+  // Pushes flow along the arc, reducing its residual capacity and increasing
+  // that of its reverse.
+  void PushFlow(int64_t index, int64_t amount) {
+    if (arcs_[index].capacity != kInfinity) {
+      arcs_[index].capacity -= amount;
+    }
+    arcs_[index ^ 1].capacity += amount;
+  }
+
+  // Returns the flow along the arc, which is the residual capacity of its
+  // reverse.
+  int64_t Flow(int64_t index) const { return arcs_[index ^ 1].capacity; }
+
+  int64_t node_count() const { return node_arcs_.size(); }
+  const Arc& arc(int64_t index) const { return arcs_[index]; }
+  absl::Span<const int64_t> node_arcs(int64_t node) const {
+    return node_arcs_[node];
+  }
+
+ private:
+  std::vector<Arc> arcs_;
+  std::vector<std::vector<int64_t>> node_arcs_;
+};
+
+// Returns the shortest path distance from the source to each node over arcs
+// with residual capacity, or kInfinity for unreachable nodes. Uses the
+// queue-based Bellman-Ford algorithm as arc costs may be negative. Returns an
+// error if a negative cost cycle is reachable from the source.
+absl::StatusOr<std::vector<int64_t>> ShortestDistances(
+    const FlowNetwork& network, int64_t source) {
+  std::vector<int64_t> distance(network.node_count(), kInfinity);
+  std::vector<int64_t> visit_count(network.node_count(), 0);
+  std::vector<bool> queued(network.node_count(), false);
+  std::deque<int64_t> queue = {source};
+  distance[source] = 0;
+  queued[source] = true;
+  while (!queue.empty()) {
+    int64_t node = queue.front();
+    queue.pop_front();
+    queued[node] = false;
+    if (++visit_count[node] > network.node_count()) {
+      return absl::InvalidArgumentError(
+          "Difference constraints are infeasible");
+    }
+    for (int64_t index : network.node_arcs(node)) {
+      const FlowNetwork::Arc& arc = network.arc(index);
+      if (arc.capacity > 0 && distance[node] + arc.cost < distance[arc.to]) {
+        distance[arc.to] = distance[node] + arc.cost;
+        if (!queued[arc.to]) {
+          queued[arc.to] = true;
+          queue.push_back(arc.to);
+        }
+      }
+    }
+  }
+  return distance;
+}
+
+// Routes 'amount' units of flow from source to sink at minimum cost by
+// successively augmenting along shortest paths. Dijkstra's algorithm is used
+// on costs made non-negative by node potentials, which are initialized with
+// Bellman-Ford. Returns an error if the flow cannot be routed.
+absl::Status RouteMinCostFlow(int64_t source, int64_t sink, int64_t amount,
+                              FlowNetwork* network) {
+  XLS_ASSIGN_OR_RETURN(std::vector<int64_t> potential,
+                       ShortestDistances(*network, source));
+  // Nodes unreachable from the source remain unreachable as flow is routed,
+  // as new residual arcs only appear between nodes on augmenting paths.
+  for (int64_t& p : potential) {
+    if (p == kInfinity) {
+      p = 0;
+    }
+  }
+
+  std::vector<int64_t> distance(network->node_count());
+  std::vector<int64_t> parent_arc(network->node_count());
+  using QueueEntry = std::pair<int64_t, int64_t>;
+  while (amount > 0) {
+    std::fill(distance.begin(), distance.end(), kInfinity);
+    std::fill(parent_arc.begin(), parent_arc.end(), -1);
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        queue;
+    distance[source] = 0;
+    queue.push({0, source});
+    while (!queue.empty()) {
+      auto [node_distance, node] = queue.top();
+      queue.pop();
+      if (node_distance > distance[node]) {
+        continue;
+      }
+      for (int64_t index : network->node_arcs(node)) {
+        const FlowNetwork::Arc& arc = network->arc(index);
+        if (arc.capacity == 0) {
+          continue;
+        }
+        int64_t reduced_cost = arc.cost + potential[node] - potential[arc.to];
+        XLS_RET_CHECK_GE(reduced_cost, 0);
+        if (node_distance + reduced_cost < distance[arc.to]) {
+          distance[arc.to] = node_distance + reduced_cost;
+          parent_arc[arc.to] = index;
+          queue.push({distance[arc.to], arc.to});
+        }
+      }
+    }
+    if (distance[sink] == kInfinity) {
+      return absl::InvalidArgumentError(
+          "Difference constraint objective is unbounded");
+    }
+    for (int64_t node = 0; node < network->node_count(); ++node) {
+      if (distance[node] != kInfinity) {
+        potential[node] += distance[node];
+      }
+    }
+
+    // Augment along the path by its bottleneck capacity.
+    int64_t path_capacity = amount;
+    for (int64_t node = sink; node != source;
+         node = network->arc(parent_arc[node] ^ 1).to) {
+      path_capacity =
+          std::min(path_capacity, network->arc(parent_arc[node]).capacity);
+    }
+    for (int64_t node = sink; node != source;
+         node = network->arc(parent_arc[node] ^ 1).to) {
+      network->PushFlow(parent_arc[node], path_capacity);
+    }
+    amount -= path_capacity;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+int64_t DifferenceConstraintSystem::AddVariable() { return variable_count_++; }
+
+void DifferenceConstraintSystem::AddConstraint(int64_t from, int64_t to,
+                                               int64_t min_difference) {
+  XLS_CHECK_LT(from, variable_count_);
+  XLS_CHECK_LT(to, variable_count_);
+  constraints_.push_back({from, to, min_difference});
+}
+
+absl::StatusOr<std::vector<int64_t>> DifferenceConstraintSystem::Minimize(
+    absl::Span<const int64_t> costs) const {
+  XLS_RET_CHECK_EQ(costs.size(), variable_count_);
+  int64_t cost_sum = 0;
+  for (int64_t cost : costs) {
+    cost_sum += cost;
+  }
+  if (cost_sum != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Difference constraint objective is unbounded: costs sum to %d",
+        cost_sum));
+  }
+
+  // The dual of minimizing sum(cost[i] * x[i]) subject to
+  // x[to] - x[from] >= d is maximizing sum(d * f) over flows f >= 0 along an
+  // arc from->to for each constraint, where the net inflow of each node i is
+  // cost[i]. This is a minimum cost flow with arc costs -d, supplied from an
+  // artificial source to the nodes with negative cost and drained to an
+  // artificial sink from the nodes with positive cost. Constraint arcs are
+  // added first so constraint k is arc 2 * k.
+  const int64_t source = variable_count_;
+  const int64_t sink = variable_count_ + 1;
+  FlowNetwork network(variable_count_ + 2);
+  for (const Constraint& constraint : constraints_) {
+    network.AddArc(constraint.from, constraint.to, kInfinity,
+                   -constraint.min_difference);
+  }
+  int64_t supply = 0;
+  for (int64_t i = 0; i < variable_count_; ++i) {
+    if (costs[i] < 0) {
+      network.AddArc(source, i, -costs[i], 0);
+      supply += -costs[i];
+    } else if (costs[i] > 0) {
+      network.AddArc(i, sink, costs[i], 0);
+    }
+  }
+  XLS_RETURN_IF_ERROR(RouteMinCostFlow(source, sink, supply, &network));
+
+  // By complementary slackness, an optimal assignment satisfies every
+  // constraint and satisfies the constraints with flow along their arcs with
+  // equality. Find one by computing longest paths over the constraints (and
+  // their reverses where tight) with the queue-based Bellman-Ford algorithm.
+  // A positive cycle means the constraints are infeasible.
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> successors(
+      variable_count_);
+  for (int64_t k = 0; k < constraints_.size(); ++k) {
+    const Constraint& constraint = constraints_[k];
+    successors[constraint.from].push_back(
+        {constraint.to, constraint.min_difference});
+    if (network.Flow(2 * k) > 0) {
+      successors[constraint.to].push_back(
+          {constraint.from, -constraint.min_difference});
+    }
+  }
+  std::vector<int64_t> values(variable_count_, 0);
+  std::vector<int64_t> visit_count(variable_count_, 0);
+  std::vector<bool> queued(variable_count_, true);
+  std::deque<int64_t> queue;
+  for (int64_t i = 0; i < variable_count_; ++i) {
+    queue.push_back(i);
+  }
+  while (!queue.empty()) {
+    int64_t variable = queue.front();
+    queue.pop_front();
+    queued[variable] = false;
+    if (++visit_count[variable] > variable_count_ + 1) {
+      return absl::InvalidArgumentError(
+          "Difference constraints are infeasible");
+    }
+    for (auto [successor, min_difference] : successors[variable]) {
+      if (values[variable] + min_difference > values[successor]) {
+        values[successor] = values[variable] + min_difference;
+        if (!queued[successor]) {
+          queued[successor] = true;
+          queue.push_back(successor);
+        }
+      }
+    }
+  }
+
+  if (!values.empty()) {
+    int64_t min_value = *std::min_element(values.begin(), values.end());
+    for (int64_t& value : values) {
+      value -= min_value;
+    }
+  }
+  return values;
+}
+
+}  // namespace xls
@@ -0,0 +1,64 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DATA_STRUCTURES_DIFFERENCE_CONSTRAINTS_H_
+#define XLS_DATA_STRUCTURES_DIFFERENCE_CONSTRAINTS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+namespace xls {
+
+// A system of difference constraints: integer variables x[0], x[1], ... and
+// constraints of the form x[to] - x[from] >= min_difference. Linear objectives
+// over such systems can be minimized exactly in polynomial time because the
+// dual of the linear program is a minimum cost flow problem, and the
+// constraint matrix is totally unimodular so the optimum is integral.
+class DifferenceConstraintSystem {
+ public:
+  // Adds a variable and returns its index. Variables are numbered sequentially
+  // from zero.
+  int64_t AddVariable();
+
+  // Adds the constraint x[to] - x[from] >= min_difference.
+  void AddConstraint(int64_t from, int64_t to, int64_t min_difference);
+
+  int64_t variable_count() const { return variable_count_; }
+  int64_t constraint_count() const { return constraints_.size(); }
+
+  // Returns an assignment of the variables which satisfies all constraints and
+  // minimizes sum(costs[i] * x[i]). Because the constraints only bound
+  // differences, the costs must sum to zero for the objective to be bounded;
+  // the returned assignment is shifted so its smallest value is zero. Returns
+  // an error if the constraints are infeasible or the objective is unbounded.
+  absl::StatusOr<std::vector<int64_t>> Minimize(
+      absl::Span<const int64_t> costs) const;
+
+ private:
+  struct Constraint {
+    int64_t from;
+    int64_t to;
+    int64_t min_difference;
+  };
+
+  int64_t variable_count_ = 0;
+  std::vector<Constraint> constraints_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_DATA_STRUCTURES_DIFFERENCE_CONSTRAINTS_H_
@@ -0,0 +1,198 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/data_structures/difference_constraints.h"
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+TEST(DifferenceConstraintsTest, NoConstraints) {
+  DifferenceConstraintSystem system;
+  system.AddVariable();
+  system.AddVariable();
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> values,
+                           system.Minimize({0, 0}));
+  EXPECT_THAT(values, ElementsAre(0, 0));
+}
+
+TEST(DifferenceConstraintsTest, Chain) {
+  // Minimize c - a subject to b - a >= 2 and c - b >= 3.
+  DifferenceConstraintSystem system;
+  int64_t a = system.AddVariable();
+  int64_t b = system.AddVariable();
+  int64_t c = system.AddVariable();
+  system.AddConstraint(a, b, 2);
+  system.AddConstraint(b, c, 3);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> values,
+                           system.Minimize({-1, 0, 1}));
+  EXPECT_THAT(values, ElementsAre(0, 2, 5));
+}
+
+TEST(DifferenceConstraintsTest, LifetimeOfValueWithTwoUses) {
+  // A value produced at time p is used at times u0 and u1 which must be at
+  // least 1 and 3 after the source s. The lifetime l (the latest use) is
+  // minimized, weighted against keeping p late, which has cost 2 per unit.
+  DifferenceConstraintSystem system;
+  int64_t s = system.AddVariable();
+  int64_t p = system.AddVariable();
+  int64_t u0 = system.AddVariable();
+  int64_t u1 = system.AddVariable();
+  int64_t l = system.AddVariable();
+  system.AddConstraint(s, p, 0);
+  system.AddConstraint(p, u0, 0);
+  system.AddConstraint(p, u1, 0);
+  system.AddConstraint(s, u0, 1);
+  system.AddConstraint(s, u1, 3);
+  system.AddConstraint(u0, l, 0);
+  system.AddConstraint(u1, l, 0);
+  // Objective: 2 * (l - p).
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> values,
+                           system.Minimize({0, -2, 0, 0, 2}));
+  // The optimum defers p to the latest use.
+  EXPECT_EQ(values[l] - values[p], 0);
+  EXPECT_EQ(values[u1] - values[s], 3);
+  EXPECT_GE(values[u0] - values[s], 1);
+}
+
+TEST(DifferenceConstraintsTest, Infeasible) {
+  DifferenceConstraintSystem system;
+  int64_t a = system.AddVariable();
+  int64_t b = system.AddVariable();
+  system.AddConstraint(a, b, 1);
+  system.AddConstraint(b, a, 0);
+  EXPECT_THAT(system.Minimize({-1, 1}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("infeasible")));
+  // Also detected when no flow passes through the cycle.
+  EXPECT_THAT(system.Minimize({0, 0}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("infeasible")));
+}
+
+TEST(DifferenceConstraintsTest, Unbounded) {
+  DifferenceConstraintSystem system;
+  int64_t a = system.AddVariable();
+  int64_t b = system.AddVariable();
+  system.AddConstraint(a, b, 1);
+  // Minimizing a - b is unbounded as b may be arbitrarily larger than a.
+  EXPECT_THAT(system.Minimize({1, -1}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unbounded")));
+  EXPECT_THAT(system.Minimize({1, 0}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unbounded")));
+}
+
+// Returns the objective value of the given assignment, or nullopt if it
+// violates a constraint.
+absl::optional<int64_t> Evaluate(
+    const std::vector<std::tuple<int64_t, int64_t, int64_t>>& constraints,
+    const std::vector<int64_t>& costs, const std::vector<int64_t>& values) {
+  for (auto [from, to, min_difference] : constraints) {
+    if (values[to] - values[from] < min_difference) {
+      return absl::nullopt;
+    }
+  }
+  int64_t objective = 0;
+  for (int64_t i = 0; i < costs.size(); ++i) {
+    objective += costs[i] * values[i];
+  }
+  return objective;
+}
+
+TEST(DifferenceConstraintsTest, RandomSystemsMatchExhaustiveSearch) {
+  // Random systems whose variables are all within kRange of variable zero,
+  // compared against an exhaustive search over that range.
+  constexpr int64_t kVariables = 5;
+  constexpr int64_t kRange = 4;
+  std::mt19937 gen;
+  std::uniform_int_distribution<int64_t> variable_dis(1, kVariables - 1);
+  std::uniform_int_distribution<int64_t> difference_dis(-2, 2);
+  std::uniform_int_distribution<int64_t> cost_dis(-3, 3);
+  int64_t feasible_count = 0;
+  for (int64_t trial = 0; trial < 500; ++trial) {
+    std::vector<std::tuple<int64_t, int64_t, int64_t>> constraints;
+    for (int64_t i = 1; i < kVariables; ++i) {
+      constraints.push_back({0, i, 0});
+      constraints.push_back({i, 0, -kRange});
+    }
+    for (int64_t i = 0; i < 4; ++i) {
+      constraints.push_back(
+          {variable_dis(gen), variable_dis(gen), difference_dis(gen)});
+    }
+    std::vector<int64_t> costs(kVariables, 0);
+    for (int64_t i = 1; i < kVariables; ++i) {
+      costs[i] = cost_dis(gen);
+      costs[0] -= costs[i];
+    }
+
+    DifferenceConstraintSystem system;
+    for (int64_t i = 0; i < kVariables; ++i) {
+      system.AddVariable();
+    }
+    for (auto [from, to, min_difference] : constraints) {
+      system.AddConstraint(from, to, min_difference);
+    }
+    absl::StatusOr<std::vector<int64_t>> values = system.Minimize(costs);
+
+    absl::optional<int64_t> best;
+    std::vector<int64_t> candidate(kVariables, 0);
+    int64_t candidate_count = 1;
+    for (int64_t i = 1; i < kVariables; ++i) {
+      candidate_count *= kRange + 1;
+    }
+    for (int64_t code = 0; code < candidate_count; ++code) {
+      int64_t c = code;
+      for (int64_t i = 1; i < kVariables; ++i) {
+        candidate[i] = c % (kRange + 1);
+        c /= kRange + 1;
+      }
+      absl::optional<int64_t> objective =
+          Evaluate(constraints, costs, candidate);
+      if (objective.has_value() && (!best.has_value() || *objective < *best)) {
+        best = objective;
+      }
+    }
+
+    if (!best.has_value()) {
+      EXPECT_THAT(values.status(),
+                  StatusIs(absl::StatusCode::kInvalidArgument,
+                           HasSubstr("infeasible")));
+      continue;
+    }
+    ++feasible_count;
+    XLS_ASSERT_OK(values.status());
+    absl::optional<int64_t> objective = Evaluate(constraints, costs, *values);
+    ASSERT_TRUE(objective.has_value());
+    EXPECT_EQ(*objective, *best);
+  }
+  EXPECT_GT(feasible_count, 100);
+}
+
+}  // namespace
+}  // namespace xls
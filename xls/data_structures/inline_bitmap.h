@@ -15,7 +15,9 @@
 #ifndef XLS_DATA_STRUCTURES_INLINE_BITMAP_H_
 #define XLS_DATA_STRUCTURES_INLINE_BITMAP_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <utility>
 
 #include "absl/base/casts.h"
 #include "absl/container/inlined_vector.h"
@@ -25,7 +27,8 @@
 
 namespace xls {
 
-// A bitmap that has 64-bits of inline storage by default.
+// A bitmap that has 128-bits of inline storage by default, so values up to
+// that width (the common case for IR values) never touch the heap.
 class InlineBitmap {
  public:
   static InlineBitmap FromWord(uint64_t word, int64_t bit_count, bool fill) {
@@ -40,6 +43,9 @@ class InlineBitmap {
       : bit_count_(bit_count),
         data_(CeilOfRatio(bit_count, kWordBits), fill ? -1ULL : 0ULL) {
     XLS_DCHECK_GE(bit_count, 0);
+    if (fill && bit_count != 0) {
+      MaskLastWord();
+    }
   }
 
   bool operator==(const InlineBitmap& other) const {
@@ -106,6 +112,76 @@ class InlineBitmap {
     return data_[wordno];
   }
 
+  // Sets the 64-bit word that backs a group of 64 bits. Bits of 'value' beyond
+  // bit_count() are ignored.
+  void SetWord(int64_t wordno, uint64_t value) {
+    XLS_DCHECK_LT(wordno, word_count());
+    data_[wordno] = value & MaskForWord(wordno);
+  }
+
+  int64_t word_count() const { return data_.size(); }
+
+  // Returns the "width" (at most 64) bits starting at bit "offset" as the least
+  // significant bits of a word. The bits may straddle two backing words.
+  uint64_t GetBits(int64_t offset, int64_t width) const {
+    XLS_DCHECK_GE(offset, 0);
+    XLS_DCHECK_GE(width, 0);
+    XLS_DCHECK_LE(width, kWordBits);
+    XLS_DCHECK_LE(offset + width, bit_count());
+    if (width == 0) {
+      return 0;
+    }
+    int64_t wordno = offset / kWordBits;
+    int64_t shift = offset % kWordBits;
+    uint64_t result = data_[wordno] >> shift;
+    if (shift + width > kWordBits) {
+      result |= data_[wordno + 1] << (kWordBits - shift);
+    }
+    return result & Mask(width);
+  }
+
+  // Sets the "width" (at most 64) bits starting at bit "offset" to the least
+  // significant bits of "value", leaving the surrounding bits unchanged.
+  void SetBits(int64_t offset, int64_t width, uint64_t value) {
+    XLS_DCHECK_GE(offset, 0);
+    XLS_DCHECK_GE(width, 0);
+    XLS_DCHECK_LE(width, kWordBits);
+    XLS_DCHECK_LE(offset + width, bit_count());
+    if (width == 0) {
+      return;
+    }
+    value &= Mask(width);
+    int64_t wordno = offset / kWordBits;
+    int64_t shift = offset % kWordBits;
+    uint64_t low_mask = Mask(width) << shift;
+    data_[wordno] = (data_[wordno] & ~low_mask) | (value << shift);
+    if (shift + width > kWordBits) {
+      uint64_t high_mask = Mask(shift + width - kWordBits);
+      data_[wordno + 1] =
+          (data_[wordno + 1] & ~high_mask) | (value >> (kWordBits - shift));
+    }
+  }
+
+  // Copies the "count" bits of "src" starting at "src_offset" into this bitmap
+  // starting at "dest_offset". Works a word at a time rather than a bit at a
+  // time; "src" must not be this bitmap.
+  void Copy(int64_t dest_offset, const InlineBitmap& src, int64_t src_offset,
+            int64_t count) {
+    XLS_DCHECK_NE(&src, this);
+    XLS_DCHECK_GE(count, 0);
+    XLS_DCHECK_LE(dest_offset + count, bit_count());
+    XLS_DCHECK_LE(src_offset + count, src.bit_count());
+    while (count > 0) {
+      // Fill up to the end of the current destination word so all writes after
+      // the first are word-aligned.
+      int64_t chunk = std::min(count, kWordBits - dest_offset % kWordBits);
+      SetBits(dest_offset, chunk, src.GetBits(src_offset, chunk));
+      dest_offset += chunk;
+      src_offset += chunk;
+      count -= chunk;
+    }
+  }
+
   // Sets a byte in the data underlying the bitmap.
   //
   // Setting byte i as {b_7, b_6, b_5, ..., b_0} sets the bit at i*8 to b_0, the
@@ -133,10 +209,18 @@ class InlineBitmap {
 
   int64_t byte_count() const { return CeilOfRatio(bit_count_, int64_t{8}); }
 
+  // The bits of the last word beyond bit_count() are always zero, so the
+  // words are hashed as one contiguous block.
+  template <typename H>
+  friend H AbslHashValue(H h, const InlineBitmap& bitmap) {
+    return H::combine_contiguous(
+        H::combine(std::move(h), bitmap.bit_count_), bitmap.data_.data(),
+        bitmap.data_.size());
+  }
+
  private:
   static constexpr int64_t kWordBits = 64;
   static constexpr int64_t kWordBytes = 8;
-  int64_t word_count() const { return data_.size(); }
 
   void MaskLastWord() {
     int64_t last_wordno = word_count() - 1;
@@ -151,7 +235,7 @@ class InlineBitmap {
   }
 
   int64_t bit_count_;
-  absl::InlinedVector<uint64_t, 1> data_;
+  absl::InlinedVector<uint64_t, 2> data_;
 };
 
 }  // namespace xls
@@ -14,10 +14,12 @@
 
 #include "xls/data_structures/inline_bitmap.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/hash/hash_testing.h"
 #include "absl/memory/memory.h"
 
 namespace xls {
@@ -107,6 +109,26 @@ TEST(InlineBitmapTest, SixtyFiveBitBitmap) {
   EXPECT_NE(b, empty);
 }
 
+TEST(InlineBitmapTest, Hash) {
+  // Bitmaps built differently hash equally if they are equal.
+  for (int64_t bit_count : {0, 1, 63, 64, 65, 130}) {
+    InlineBitmap filled(bit_count, /*fill=*/true);
+    InlineBitmap set(bit_count);
+    for (int64_t i = 0; i < bit_count; ++i) {
+      set.Set(i, true);
+    }
+    EXPECT_EQ(filled, set);
+    EXPECT_EQ(absl::Hash<InlineBitmap>()(filled),
+              absl::Hash<InlineBitmap>()(set))
+        << bit_count;
+  }
+  EXPECT_TRUE(absl::VerifyTypeImplementsAbslHashCorrectly({
+      InlineBitmap(0), InlineBitmap(1), InlineBitmap(1, /*fill=*/true),
+      InlineBitmap(64, /*fill=*/true), InlineBitmap(65),
+      InlineBitmap(65, /*fill=*/true), InlineBitmap::FromWord(5, 65, false),
+  }));
+}
+
 TEST(InlineBitmapTest, BytesAndBits) {
   InlineBitmap b(/*bit_count=*/16);
   b.SetByte(0, 0x80);  // Bit 7
@@ -162,5 +184,59 @@ TEST(InlineBitmapTest, BytesAndWords) {
   }
 }
 
+TEST(InlineBitmapTest, SetWord) {
+  InlineBitmap b(/*bit_count=*/100);
+  EXPECT_EQ(b.word_count(), 2);
+  b.SetWord(0, 0x123456789abcdef0);
+  b.SetWord(1, 0xffffffffffffffff);
+  EXPECT_EQ(b.GetWord(0), 0x123456789abcdef0) << std::hex << b.GetWord(0);
+  // Bits beyond the bit count are masked off.
+  EXPECT_EQ(b.GetWord(1), 0xfffffffff) << std::hex << b.GetWord(1);
+  EXPECT_TRUE(b.Get(99));
+  EXPECT_FALSE(b.Get(0));
+}
+
+TEST(InlineBitmapTest, GetAndSetBits) {
+  InlineBitmap b(/*bit_count=*/130);
+  // Straddles the boundary between words 0 and 1.
+  b.SetBits(60, 8, 0xa5);
+  EXPECT_EQ(b.GetBits(60, 8), 0xa5);
+  EXPECT_EQ(b.GetWord(0), 0x5000000000000000) << std::hex << b.GetWord(0);
+  EXPECT_EQ(b.GetWord(1), 0xa) << std::hex << b.GetWord(1);
+
+  // Surrounding bits are unchanged and excess bits of the value are ignored.
+  b.SetBits(62, 2, 0xff);
+  EXPECT_EQ(b.GetBits(60, 8), 0xad);
+  EXPECT_EQ(b.GetBits(0, 60), 0);
+
+  b.SetBits(66, 64, -1ULL);
+  EXPECT_EQ(b.GetBits(66, 64), -1ULL);
+  EXPECT_EQ(b.GetBits(64, 2), 0x2);
+  EXPECT_EQ(b.GetBits(0, 0), 0);
+}
+
+TEST(InlineBitmapTest, Copy) {
+  InlineBitmap src(/*bit_count=*/200);
+  for (int64_t i = 0; i < src.bit_count(); ++i) {
+    src.Set(i, i % 3 == 0 || i % 7 == 0);
+  }
+  for (int64_t src_offset : {0, 1, 63, 64, 70}) {
+    for (int64_t dest_offset : {0, 5, 64, 100}) {
+      InlineBitmap dest(/*bit_count=*/250, /*fill=*/true);
+      int64_t count = src.bit_count() - src_offset;
+      count = std::min(count, dest.bit_count() - dest_offset);
+      dest.Copy(dest_offset, src, src_offset, count);
+      for (int64_t i = 0; i < dest.bit_count(); ++i) {
+        bool expected = (i >= dest_offset && i < dest_offset + count)
+                            ? src.Get(src_offset + i - dest_offset)
+                            : true;
+        ASSERT_EQ(dest.Get(i), expected)
+            << "src_offset: " << src_offset << " dest_offset: " << dest_offset
+            << " i: " << i;
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace xls
@@ -14,7 +14,9 @@
 
 #include "xls/data_structures/min_cut.h"
 
+#include <algorithm>
 #include <deque>
+#include <limits>
 #include <set>
 
 #include "absl/container/flat_hash_set.h"
@@ -107,7 +109,11 @@ struct ResidualEdge {
 // flow along the edge.
 class ResidualGraph {
  public:
-  ResidualGraph(const Graph& graph) {
+  // Edge capacities are the original edge weights limited to
+  // 'capacity_limit'. If 'initial_flow' is non-empty it gives the flow along
+  // each edge, which is clamped to the edge capacity.
+  ResidualGraph(const Graph& graph, int64_t capacity_limit,
+                absl::Span<const int64_t> initial_flow) {
     // There are exactly twice as many edges in the residual graph because each
     // edge in the original graph maps to a forward and backward edge in the
     // residual graph. The forward edge in the original graph has the same
@@ -118,17 +124,23 @@ class ResidualGraph {
          edge_id += EdgeId{1}) {
       const Edge& edge = graph.edge(edge_id);
       EdgeId backward_edge_id{int64_t{edge_id} + graph.edge_count()};
+      int64_t capacity = std::min(edge.weight, capacity_limit);
+      int64_t flow =
+          initial_flow.empty()
+              ? 0
+              : std::clamp(initial_flow[int64_t{edge_id}], int64_t{0},
+                           capacity);
 
       // Add the forward edge to the residual graph. It has an inital capacity
-      // equal to the weight of the edge in the original graph.
+      // equal to the capacity of the edge less the flow along it.
       edges_[int64_t{edge_id}] =
-          ResidualEdge{edge.from, edge.to, edge.weight, backward_edge_id};
+          ResidualEdge{edge.from, edge.to, capacity - flow, backward_edge_id};
       successors_[int64_t{edge.from}].push_back(edge_id);
 
       // Add the backward edge to the residual graph. It has an inital capacity
-      // of zero.
+      // equal to the flow along the edge.
       edges_[int64_t{backward_edge_id}] =
-          ResidualEdge{edge.to, edge.from, 0, edge_id};
+          ResidualEdge{edge.to, edge.from, flow, edge_id};
       successors_[int64_t{edge.to}].push_back(backward_edge_id);
     }
   }
@@ -168,116 +180,261 @@ std::string GraphWithFlowToString(const Graph& graph,
         absl::StrJoin(
             graph.successors(n), ", ", [&](std::string* out, EdgeId e_id) {
               const Edge& e = graph.edge(e_id);
-              absl::StrAppendFormat(
-                  out, "%s[%d/%d]", graph.name(e.to),
-                  e.weight - residual_graph.edge(e_id).capacity, e.weight);
+              const ResidualEdge& backward_edge = residual_graph.edge(
+                  residual_graph.edge(e_id).dual_edge);
+              absl::StrAppendFormat(out, "%s[%d/%d]", graph.name(e.to),
+                                    backward_edge.capacity, e.weight);
             }));
   }
   return out;
 }
 
-// Finds an augmenting path from source to sink in the graph (path of edges with
-// non-zero residual capacity) and increases the flow along each edge in the
-// path. The amount of flow increase is equal to the minimum residual capacity
-// of any edge in the path. The augmenting path is found via Dinic's algorithm
-// which finds a shortest augmenting path via BFS search. Returns the amount of
-// augmented flow. If no augmenting path is found then zero is returned.
-int64_t AugmentFlow(const Graph& graph, NodeId source, NodeId sink,
-                    ResidualGraph* residual_graph) {
-  XLS_VLOG_LINES(4, GraphWithFlowToString(graph, *residual_graph));
-
-  // Perform a BFS search from flow to find the shortest augmenting path (by
-  // edge count) from source to sink. For each edge traversed in the BFS search,
-  // 'path_back' holds the previous edge in the path from the source along with
-  // the residual capacity of that path..
-  absl::flat_hash_map<NodeId, std::pair<ResidualEdge*, int64_t>> path_back;
-  std::vector<NodeId> frontier = {source};
-  while (!frontier.empty()) {
-    std::vector<NodeId> next_frontier;
-    // Try to add extend the BFS-constructed paths from the source with the
-    // given edge.
-    auto maybe_extend_frontier = [&](ResidualEdge* e) {
-      if (path_back.contains(e->to)) {
-        return;
+// Returns the sum of the weights of the edges in the graph which do not have
+// maximum weight, saturating at the maximum int64_t value.
+int64_t FiniteWeightSum(const Graph& graph) {
+  const int64_t kMaxWeight = std::numeric_limits<int64_t>::max();
+  int64_t sum = 0;
+  for (EdgeId edge_id = EdgeId{0}; edge_id <= graph.max_edge_id();
+       edge_id += EdgeId{1}) {
+    int64_t weight = graph.edge(edge_id).weight;
+    if (weight == kMaxWeight) {
+      continue;
+    }
+    sum = weight > kMaxWeight - sum ? kMaxWeight : sum + weight;
+  }
+  return sum;
+}
+
+// Computes a maximum flow from source to sink with the push-relabel method.
+// Nodes with excess flow are discharged in FIFO order and heights are
+// periodically recomputed exactly with a backwards BFS ("global relabeling").
+// Discharging continues until no node other than the source and sink has
+// excess, so the result is a flow rather than just a preflow.
+class PushRelabel {
+ public:
+  PushRelabel(const Graph& graph, NodeId source, NodeId sink,
+              ResidualGraph* residual_graph)
+      : graph_(graph),
+        source_(source),
+        sink_(sink),
+        residual_graph_(residual_graph),
+        node_count_(graph.node_count()),
+        excess_(node_count_, 0),
+        height_(node_count_, 0),
+        current_edge_(node_count_, 0),
+        active_(node_count_, false) {}
+
+  // Sets the excess of each node from the flow already in the residual graph.
+  // Nodes which have more outgoing than incoming flow (which can happen when
+  // an initial flow does not fit the current edge weights) have flow on their
+  // outgoing edges cancelled, moving the deficit downstream until it reaches
+  // the source.
+  void InitializeFromFlow() {
+    for (EdgeId edge_id = EdgeId{0}; edge_id <= graph_.max_edge_id();
+         edge_id += EdgeId{1}) {
+      const Edge& edge = graph_.edge(edge_id);
+      int64_t flow = Flow(edge_id);
+      excess_[int64_t{edge.to}] += flow;
+      excess_[int64_t{edge.from}] -= flow;
+    }
+    for (NodeId node = NodeId(0); node <= graph_.max_node_id(); ++node) {
+      std::vector<NodeId> worklist = {node};
+      while (!worklist.empty()) {
+        NodeId n = worklist.back();
+        if (n == source_ || excess_[int64_t{n}] >= 0) {
+          worklist.pop_back();
+          continue;
+        }
+        // A node with a deficit necessarily has an outgoing edge with flow.
+        for (EdgeId edge_id : graph_.successors(n)) {
+          int64_t flow = Flow(edge_id);
+          if (flow == 0) {
+            continue;
+          }
+          int64_t amount = std::min(flow, -excess_[int64_t{n}]);
+          ResidualEdge& backward_edge =
+              residual_graph_->edge(residual_graph_->edge(edge_id).dual_edge);
+          residual_graph_->PushFlow(amount, &backward_edge);
+          excess_[int64_t{n}] += amount;
+          excess_[int64_t{backward_edge.from}] -= amount;
+          worklist.push_back(backward_edge.from);
+          break;
+        }
       }
-      int64_t path_capacity = path_back.contains(e->from)
-                                  ? path_back.at(e->from).second
-                                  : std::numeric_limits<int64_t>::max();
-      // The residual capacity of a path is the minimum residual capacity of any
-      // edge in the path.
-      path_capacity = std::min(path_capacity, e->capacity);
-      path_back[e->to] = {e, path_capacity};
-      next_frontier.push_back(e->to);
-      XLS_VLOG(5) << "  Added " << graph.name(e->to) << " to the frontier";
-    };
+    }
+  }
+
+  void Run() {
+    // Saturate every edge out of the source.
+    for (EdgeId edge_id : residual_graph_->successors(source_)) {
+      ResidualEdge& edge = residual_graph_->edge(edge_id);
+      if (edge.capacity > 0) {
+        int64_t amount = edge.capacity;
+        residual_graph_->PushFlow(amount, &edge);
+        excess_[int64_t{source_}] -= amount;
+        excess_[int64_t{edge.to}] += amount;
+      }
+    }
+    GlobalRelabel();
+    for (NodeId node = NodeId(0); node <= graph_.max_node_id(); ++node) {
+      Activate(node);
+    }
+    int64_t relabels_since_global_relabel = 0;
+    while (!active_nodes_.empty()) {
+      NodeId node = active_nodes_.front();
+      active_nodes_.pop_front();
+      active_[int64_t{node}] = false;
+      relabels_since_global_relabel += Discharge(node);
+      if (relabels_since_global_relabel > node_count_) {
+        GlobalRelabel();
+        relabels_since_global_relabel = 0;
+      }
+    }
+  }
+
+ private:
+  // Adds the node to the queue of nodes to discharge if it has excess flow.
+  void Activate(NodeId node) {
+    if (node != source_ && node != sink_ && excess_[int64_t{node}] > 0 &&
+        !active_[int64_t{node}]) {
+      active_[int64_t{node}] = true;
+      active_nodes_.push_back(node);
+    }
+  }
+
+  // Pushes the excess of the node to its neighbors, relabeling the node as
+  // necessary. Returns the number of relabels.
+  int64_t Discharge(NodeId node) {
+    int64_t relabel_count = 0;
+    int64_t& excess = excess_[int64_t{node}];
+    absl::Span<const EdgeId> successors = residual_graph_->successors(node);
+    while (excess > 0) {
+      int64_t& current_edge = current_edge_[int64_t{node}];
+      if (current_edge == successors.size()) {
+        Relabel(node);
+        ++relabel_count;
+        current_edge = 0;
+        continue;
+      }
+      ResidualEdge& edge = residual_graph_->edge(successors[current_edge]);
+      if (edge.capacity > 0 &&
+          height_[int64_t{node}] == height_[int64_t{edge.to}] + 1) {
+        int64_t amount = std::min(excess, edge.capacity);
+        residual_graph_->PushFlow(amount, &edge);
+        excess -= amount;
+        excess_[int64_t{edge.to}] += amount;
+        Activate(edge.to);
+      } else {
+        ++current_edge;
+      }
+    }
+    return relabel_count;
+  }
 
-    for (NodeId node : frontier) {
-      XLS_VLOG(5) << "Visiting " << graph.name(node);
-      for (EdgeId edge_id : residual_graph->successors(node)) {
-        ResidualEdge& edge = residual_graph->edge(edge_id);
-        XLS_VLOG(5) << absl::StreamFormat(
-            "  Traversing %s->%s", graph.name(edge.from), graph.name(edge.to));
-        XLS_CHECK_GE(edge.capacity, 0);
-        if (edge.capacity > 0) {
-          maybe_extend_frontier(&edge);
-          if (edge.to == sink) {
-            // Found augmenting path. As this is the first path we've found in a
-            // BFS search it is necessarily a shortest path. Walk back along
-            // path and augment the flow.
-            int64_t augmented_flow_amount = path_back.at(sink).second;
-            XLS_CHECK_GT(augmented_flow_amount, 0);
-            NodeId n = sink;
-            while (n != source) {
-              ResidualEdge* e = path_back.at(n).first;
-              residual_graph->PushFlow(augmented_flow_amount, e);
-              XLS_CHECK_GE(e->capacity, 0);
-              n = e->from;
-            }
-            if (XLS_VLOG_IS_ON(4)) {
-              XLS_VLOG(4) << "Augmented flow: " << augmented_flow_amount;
-              std::vector<const ResidualEdge*> augmented_path;
-              NodeId n = sink;
-              while (n != source) {
-                const ResidualEdge* e = path_back.at(n).first;
-                augmented_path.push_back(e);
-                n = e->from;
-              }
-              std::reverse(augmented_path.begin(), augmented_path.end());
-              XLS_VLOG(4) << "Augmented path: "
-                          << absl::StrJoin(
-                                 augmented_path, ", ",
-                                 [&](std::string* out, const ResidualEdge* e) {
-                                   absl::StrAppendFormat(
-                                       out, "%s->%s [new capacity %d]",
-                                       graph.name(e->from), graph.name(e->to),
-                                       e->capacity);
-                                 });
-            }
-            return augmented_flow_amount;
+  // Sets the height of the node to one more than the lowest neighbor it can
+  // push flow to.
+  void Relabel(NodeId node) {
+    int64_t min_height = std::numeric_limits<int64_t>::max();
+    for (EdgeId edge_id : residual_graph_->successors(node)) {
+      const ResidualEdge& edge = residual_graph_->edge(edge_id);
+      if (edge.capacity > 0) {
+        min_height = std::min(min_height, height_[int64_t{edge.to}]);
+      }
+    }
+    // A node with excess can always push flow back the way it came.
+    XLS_CHECK_NE(min_height, std::numeric_limits<int64_t>::max());
+    height_[int64_t{node}] = min_height + 1;
+  }
+
+  // Sets the height of each node to its distance to the sink in the residual
+  // graph or, if the sink is unreachable, to the node count plus its distance
+  // to the source. Nodes which can reach neither are given a height which
+  // makes them unreachable by pushes.
+  void GlobalRelabel() {
+    const int64_t kUnreached = -1;
+    std::fill(height_.begin(), height_.end(), kUnreached);
+    auto bfs = [&](NodeId root, int64_t root_height) {
+      std::deque<NodeId> frontier = {root};
+      height_[int64_t{root}] = root_height;
+      while (!frontier.empty()) {
+        NodeId node = frontier.front();
+        frontier.pop_front();
+        for (EdgeId edge_id : residual_graph_->successors(node)) {
+          // The dual edge extends from the neighbor to this node.
+          const ResidualEdge& edge = residual_graph_->edge(
+              residual_graph_->edge(edge_id).dual_edge);
+          if (edge.capacity > 0 && height_[int64_t{edge.from}] == kUnreached) {
+            height_[int64_t{edge.from}] = height_[int64_t{node}] + 1;
+            frontier.push_back(edge.from);
           }
         }
       }
+    };
+    // Paths to the sink may not pass through the source.
+    height_[int64_t{source_}] = node_count_;
+    bfs(sink_, 0);
+    bfs(source_, node_count_);
+    for (int64_t& height : height_) {
+      if (height == kUnreached) {
+        height = 2 * node_count_;
+      }
     }
+    std::fill(current_edge_.begin(), current_edge_.end(), 0);
+  }
 
-    frontier = std::move(next_frontier);
-    next_frontier.clear();
+  // Returns the flow along the given edge of the original graph, which is the
+  // capacity of its backward edge in the residual graph.
+  int64_t Flow(EdgeId edge_id) const {
+    return residual_graph_->edge(residual_graph_->edge(edge_id).dual_edge)
+        .capacity;
   }
 
-  XLS_VLOG(4) << "No augmenting path found";
-  return 0;
-}
+  const Graph& graph_;
+  NodeId source_;
+  NodeId sink_;
+  ResidualGraph* residual_graph_;
+  int64_t node_count_;
+
+  // The excess flow (inflow minus outflow) of each node, indexed by NodeId.
+  std::vector<int64_t> excess_;
+
+  // The height (distance label) of each node, indexed by NodeId.
+  std::vector<int64_t> height_;
+
+  // The index in the node's residual successors of the next edge to try to
+  // push flow along, indexed by NodeId.
+  std::vector<int64_t> current_edge_;
+
+  // The nodes with excess flow waiting to be discharged, and whether each node
+  // is in the queue.
+  std::deque<NodeId> active_nodes_;
+  std::vector<bool> active_;
+};
 
 }  // namespace
 
 GraphCut MinCutBetweenNodes(const Graph& graph, NodeId source, NodeId sink) {
-  // This loop is the core of the Ford-Fulkerson method. Starting with zero flow
-  // on all edges, flow is increased along a path from source to sink with
-  // residual capacity (called an augmenting path). When no further augmenting
-  // paths exist, flow has been maximized. 'flow' is the flow of each edge in
-  // the graph indexed by EdgeId.
-  ResidualGraph residual_graph(graph);
-  while (AugmentFlow(graph, source, sink, &residual_graph) > 0) {
-  }
+  return MinCutBetweenNodes(graph, source, sink, /*initial_flow=*/{});
+}
+
+GraphCut MinCutBetweenNodes(const Graph& graph, NodeId source, NodeId sink,
+                            absl::Span<const int64_t> initial_flow) {
+  XLS_CHECK(initial_flow.empty() || initial_flow.size() == graph.edge_count());
+  // Any cut which does not include a maximum weight edge weighs less than the
+  // sum of the other edges' weights, so limiting the edge capacities to just
+  // above this sum leaves the minimum cut unchanged (as long as one exists
+  // without maximum weight edges). This keeps the excess flow accumulated at
+  // nodes from overflowing.
+  int64_t finite_weight_sum = FiniteWeightSum(graph);
+  int64_t capacity_limit =
+      finite_weight_sum == std::numeric_limits<int64_t>::max()
+          ? finite_weight_sum
+          : finite_weight_sum + 1;
+  ResidualGraph residual_graph(graph, capacity_limit, initial_flow);
+  PushRelabel push_relabel(graph, source, sink, &residual_graph);
+  push_relabel.InitializeFromFlow();
+  push_relabel.Run();
+  XLS_VLOG_LINES(4, GraphWithFlowToString(graph, residual_graph));
 
   // Once a maximum flow is found, walk the residual graph from the source. All
   // reachable nodes form one partition.
@@ -314,6 +471,13 @@ GraphCut MinCutBetweenNodes(const Graph& graph, NodeId source, NodeId sink) {
     }
   }
 
+  min_cut.flow.resize(graph.edge_count());
+  for (EdgeId edge_id = EdgeId{0}; edge_id <= graph.max_edge_id();
+       edge_id += EdgeId{1}) {
+    min_cut.flow[int64_t{edge_id}] =
+        residual_graph.edge(residual_graph.edge(edge_id).dual_edge).capacity;
+  }
+
   XLS_VLOG_LINES(4, min_cut.ToString(graph));
 
   return min_cut;
@@ -91,16 +91,30 @@ struct GraphCut {
   // The set of nodes in the partition containing the 'sink' node of the cut.
   std::vector<NodeId> sink_partition;
 
+  // The maximum flow along each edge from which the cut was derived, indexed
+  // by EdgeId. May be passed as the initial flow of a later cut computation.
+  std::vector<int64_t> flow;
+
   std::string ToString(const Graph& graph) const;
 };
 
 // Computes a minimum cut of the given graph where source and sink are in
 // different partitions. The cut is returned as a partitioning of the nodes of
-// the graph into two sets of nodes on either side of the cut. The min cut is
-// found via the Ford-Fulkerson method using Dinic's algorithm. This results in
-// a worst case run time of O(V^2 * E).
+// the graph into two sets of nodes on either side of the cut. The source
+// partition is the set of nodes reachable from the source in the residual graph
+// of a maximum flow, which is the same for every maximum flow. The maximum flow
+// is found via the push-relabel method in O(V^3) worst case time.
 GraphCut MinCutBetweenNodes(const Graph& graph, NodeId source, NodeId sink);
 
+// As above, but warm-starts the maximum flow computation from the given flow
+// along each edge (indexed by EdgeId), typically the flow of a cut previously
+// computed on a graph with the same edges but different weights. The initial
+// flow need not be feasible: flows are clamped to the edge weights and
+// conservation violations are repaired. The closer the initial flow is to a
+// maximum flow, the less work is done. An empty span starts from zero flow.
+GraphCut MinCutBetweenNodes(const Graph& graph, NodeId source, NodeId sink,
+                            absl::Span<const int64_t> initial_flow);
+
 }  // namespace min_cut
 }  // namespace xls
 
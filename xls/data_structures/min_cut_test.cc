@@ -355,6 +355,90 @@ TEST(MinCutTest, ResidualGraphTraversalTest) {
   EXPECT_EQ(min_cut.weight, 2);
 }
 
+TEST(MinCutTest, WarmStartFromPreviousFlow) {
+  // Compute the cut of a random graph, then change some of the weights and
+  // recompute the cut both from scratch and starting from the previous flow.
+  // The cuts must be identical, as the source partition is the same for every
+  // maximum flow.
+  for (bool acyclic : {false, true}) {
+    NodeId source;
+    NodeId sink;
+    Graph graph = MakeLargeGraph(acyclic, &source, &sink, /*layer_count=*/9,
+                                 /*nodes_in_layer=*/11);
+    GraphCut min_cut = MinCutBetweenNodes(graph, source, sink);
+    ASSERT_EQ(min_cut.flow.size(), graph.edge_count());
+
+    // Warm-starting from a maximum flow of the same graph gives the same cut.
+    GraphCut same_cut = MinCutBetweenNodes(graph, source, sink, min_cut.flow);
+    EXPECT_EQ(same_cut.weight, min_cut.weight);
+    EXPECT_EQ(same_cut.source_partition, min_cut.source_partition);
+
+    // Rebuild the graph with the weight of every third edge changed. Some
+    // edges now carry more flow than their weight.
+    Graph modified;
+    for (int64_t i = 0; i < graph.node_count(); ++i) {
+      modified.AddNode(graph.name(NodeId(i)));
+    }
+    for (EdgeId edge_id = EdgeId(0); edge_id <= graph.max_edge_id();
+         ++edge_id) {
+      const Edge& edge = graph.edge(edge_id);
+      int64_t weight = edge.weight;
+      if (int64_t{edge_id} % 3 == 0 &&
+          weight != std::numeric_limits<int64_t>::max()) {
+        weight = (weight * 7) % 11;
+      }
+      modified.AddEdge(edge.from, edge.to, weight);
+    }
+    GraphCut cold_cut = MinCutBetweenNodes(modified, source, sink);
+    GraphCut warm_cut =
+        MinCutBetweenNodes(modified, source, sink, min_cut.flow);
+    EXPECT_EQ(warm_cut.weight, cold_cut.weight);
+    EXPECT_EQ(warm_cut.source_partition, cold_cut.source_partition);
+    EXPECT_EQ(warm_cut.sink_partition, cold_cut.sink_partition);
+  }
+}
+
+TEST(MinCutTest, SmallGraphsMatchExhaustiveSearch) {
+  // Compare the cut weight against an exhaustive search over all partitions of
+  // small random graphs.
+  std::mt19937 gen;
+  for (int64_t trial = 0; trial < 200; ++trial) {
+    const int64_t kNodeCount = 8;
+    Graph graph;
+    for (int64_t i = 0; i < kNodeCount; ++i) {
+      graph.AddNode();
+    }
+    std::uniform_int_distribution<int64_t> node_dis(0, kNodeCount - 1);
+    std::uniform_int_distribution<int64_t> weight_dis(0, 20);
+    for (int64_t i = 0; i < 20; ++i) {
+      graph.AddEdge(NodeId(node_dis(gen)), NodeId(node_dis(gen)),
+                    weight_dis(gen));
+    }
+    NodeId source(0);
+    NodeId sink(kNodeCount - 1);
+    GraphCut min_cut = MinCutBetweenNodes(graph, source, sink);
+
+    int64_t best = std::numeric_limits<int64_t>::max();
+    for (int64_t mask = 0; mask < (1 << kNodeCount); ++mask) {
+      // Bit i of the mask indicates that node i is in the source partition.
+      if ((mask & 1) == 0 || (mask >> (kNodeCount - 1)) & 1) {
+        continue;
+      }
+      absl::flat_hash_set<NodeId> source_set;
+      absl::flat_hash_set<NodeId> sink_set;
+      for (int64_t i = 0; i < kNodeCount; ++i) {
+        if ((mask >> i) & 1) {
+          source_set.insert(NodeId(i));
+        } else {
+          sink_set.insert(NodeId(i));
+        }
+      }
+      best = std::min(best, CutCost(graph, source_set, sink_set));
+    }
+    EXPECT_EQ(min_cut.weight, best) << graph.ToString();
+  }
+}
+
 }  // namespace
 }  // namespace min_cut
 }  // namespace xls
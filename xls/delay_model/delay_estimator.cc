@@ -14,6 +14,8 @@
 
 #include "xls/delay_model/delay_estimator.h"
 
+#include <algorithm>
+
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -80,6 +82,50 @@ absl::Status DelayEstimatorManager::RegisterDelayEstimator(
   return absl::OkStatus();
 }
 
+/* static */ CachingDelayEstimator::NodeSignature
+CachingDelayEstimator::GetSignature(Node* node) {
+  NodeSignature signature;
+  signature.push_back(static_cast<int64_t>(node->op()));
+  signature.push_back(
+      std::all_of(node->operands().begin(), node->operands().end(),
+                  [&](Node* n) { return n == node->operand(0); }));
+  signature.push_back(
+      std::any_of(node->operands().begin(), node->operands().end(),
+                  [](Node* n) { return n->Is<Literal>(); }));
+  auto add_shape = [&](Type* type) {
+    signature.push_back(type->GetFlatBitCount());
+    signature.push_back(type->IsArray() ? type->AsArrayOrDie()->size() : -1);
+  };
+  add_shape(node->GetType());
+  for (Node* operand : node->operands()) {
+    add_shape(operand->GetType());
+  }
+  return signature;
+}
+
+absl::StatusOr<int64_t> CachingDelayEstimator::GetOperationDelayInPs(
+    Node* node) const {
+  NodeSignature signature = GetSignature(node);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = cache_.find(signature);
+    if (it != cache_.end()) {
+      return it->second;
+    }
+  }
+  // Estimate outside the lock; concurrent misses on the same signature
+  // compute the same delay.
+  absl::StatusOr<int64_t> delay = estimator_->GetOperationDelayInPs(node);
+  absl::MutexLock lock(&mutex_);
+  cache_.emplace(std::move(signature), delay);
+  return delay;
+}
+
+int64_t CachingDelayEstimator::cache_size() const {
+  absl::MutexLock lock(&mutex_);
+  return cache_.size();
+}
+
 namespace {
 
 // TODO(leary): 2019-08-19 Read all of the curve-fit values from a
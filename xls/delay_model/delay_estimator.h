@@ -16,9 +16,12 @@
 #define XLS_DELAY_MODEL_DELAY_ESTIMATOR_H_
 
 #include <cstdint>
+#include <memory>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/node.h"
@@ -40,6 +43,33 @@ class DelayEstimator {
                                                            int64_t tau_in_ps);
 };
 
+// A delay estimator which memoizes the delays computed by another estimator.
+// Delays are cached by node signature: the op, the result and operand shapes
+// (bit counts and array sizes), and whether the operands are identical or
+// include a literal. These are the properties used by the generated delay
+// models (see delay_model.proto), so the wrapped estimator must not depend on
+// anything else. The cache is not tied to a function or package, so a shared
+// instance reuses estimates across scheduling runs. Thread-safe.
+class CachingDelayEstimator : public DelayEstimator {
+ public:
+  explicit CachingDelayEstimator(std::unique_ptr<DelayEstimator> estimator)
+      : estimator_(std::move(estimator)) {}
+
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override;
+
+  // Returns the number of distinct node signatures in the cache.
+  int64_t cache_size() const;
+
+ private:
+  using NodeSignature = absl::InlinedVector<int64_t, 8>;
+  static NodeSignature GetSignature(Node* node);
+
+  std::unique_ptr<DelayEstimator> estimator_;
+  mutable absl::Mutex mutex_;
+  mutable absl::flat_hash_map<NodeSignature, absl::StatusOr<int64_t>> cache_
+      ABSL_GUARDED_BY(mutex_);
+};
+
 enum class DelayEstimatorPrecedence {
   kLow = 1,
   kMedium = 2,
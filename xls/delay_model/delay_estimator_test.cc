@@ -14,6 +14,8 @@
 
 #include "xls/delay_model/delay_estimator.h"
 
+#include <algorithm>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
@@ -43,6 +45,27 @@ class TestDelayEstimator : public DelayEstimator {
   int64_t delay_;
 };
 
+// A test delay estimator which returns the bit count of the node, plus one if
+// the node has a literal operand, and counts its invocations.
+class CountingDelayEstimator : public DelayEstimator {
+ public:
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override {
+    ++call_count_;
+    if (node->Is<Param>()) {
+      return absl::UnimplementedError("No delay for params");
+    }
+    bool has_literal =
+        std::any_of(node->operands().begin(), node->operands().end(),
+                    [](Node* n) { return n->Is<Literal>(); });
+    return node->GetType()->GetFlatBitCount() + (has_literal ? 1 : 0);
+  }
+
+  int64_t call_count() const { return call_count_; }
+
+ private:
+  mutable int64_t call_count_ = 0;
+};
+
 class DelayEstimatorTest : public IrTestBase {};
 
 TEST_F(DelayEstimatorTest, DelayEstimatorManager) {
@@ -76,5 +99,45 @@ TEST_F(DelayEstimatorTest, DelayEstimatorManager) {
               StatusIs(absl::StatusCode::kNotFound));
 }
 
+TEST_F(DelayEstimatorTest, CachingDelayEstimator) {
+  auto counting = absl::make_unique<CountingDelayEstimator>();
+  CountingDelayEstimator* counting_ptr = counting.get();
+  CachingDelayEstimator caching(std::move(counting));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  BValue z = fb.Param("z", p->GetBitsType(16));
+  BValue add1 = fb.Add(x, y);
+  BValue add2 = fb.Add(y, x);
+  BValue add3 = fb.Add(z, z);
+  BValue add4 = fb.Add(x, fb.Literal(UBits(1, 8)));
+  BValue sub = fb.Subtract(x, y);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  EXPECT_THAT(caching.GetOperationDelayInPs(add1.node()), IsOkAndHolds(8));
+  EXPECT_EQ(counting_ptr->call_count(), 1);
+  // Nodes with the same signature share the cached delay.
+  EXPECT_THAT(caching.GetOperationDelayInPs(add2.node()), IsOkAndHolds(8));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add1.node()), IsOkAndHolds(8));
+  EXPECT_EQ(counting_ptr->call_count(), 1);
+
+  // Different widths, a literal operand, or a different op give different
+  // signatures.
+  EXPECT_THAT(caching.GetOperationDelayInPs(add3.node()), IsOkAndHolds(16));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add4.node()), IsOkAndHolds(9));
+  EXPECT_THAT(caching.GetOperationDelayInPs(sub.node()), IsOkAndHolds(8));
+  EXPECT_EQ(counting_ptr->call_count(), 4);
+  EXPECT_EQ(caching.cache_size(), 4);
+
+  // Errors are cached as well.
+  EXPECT_THAT(caching.GetOperationDelayInPs(x.node()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+  EXPECT_THAT(caching.GetOperationDelayInPs(y.node()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+  EXPECT_EQ(counting_ptr->call_count(), 5);
+}
+
 }  // namespace
 }  // namespace xls
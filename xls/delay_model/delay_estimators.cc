@@ -14,12 +14,24 @@
 
 #include "xls/delay_model/delay_estimators.h"
 
+#include <filesystem>
+#include <string>
+
 #include "absl/flags/flag.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "xls/delay_model/learned_delay_estimator.h"
+#include "xls/delay_model/table_delay_estimator.h"
 
 namespace xls {
 
 absl::StatusOr<DelayEstimator*> GetDelayEstimator(absl::string_view name) {
+  if (absl::EndsWith(name, ".learned.textproto")) {
+    return LoadLearnedDelayModelFile(std::filesystem::path(std::string(name)));
+  }
+  if (absl::EndsWith(name, ".textproto")) {
+    return LoadDelayModelFile(std::filesystem::path(std::string(name)));
+  }
   return GetDelayEstimatorManagerSingleton().GetDelayEstimator(name);
 }
 
@@ -25,7 +25,11 @@
 
 namespace xls {
 
-// Returns the registered delay estimator with the given name.
+// Returns the registered delay estimator with the given name. A name ending in
+// ".textproto" is the path of a DelayModel text proto, which is loaded as a
+// TableDelayEstimator (see table_delay_estimator.h) on first use; one ending in
+// ".learned.textproto" is the path of a LearnedDelayModel text proto, which is
+// loaded as a LearnedDelayEstimator (see learned_delay_estimator.h).
 absl::StatusOr<DelayEstimator*> GetDelayEstimator(absl::string_view name);
 
 // Returns a reference to a singleton object which uses the "standard" delay
@@ -540,6 +540,9 @@ def _estimator_from_proto(op: Text, proto: delay_model_pb2.Estimator,
   if proto.HasField('bounding_box'):
     assert data_points
     return BoundingBoxEstimator(op, proto.bounding_box.factors, data_points)
+  if proto.HasField('table'):
+    raise Error('{}: Table estimators are evaluated at runtime by '
+                'TableDelayEstimator and cannot be generated'.format(op))
   assert proto.HasField('logical_effort')
   assert not data_points
   return LogicalEffortEstimator(op, proto.logical_effort.tau_in_ps)
@@ -0,0 +1,383 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/delay_model/learned_delay_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "absl/container/btree_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/table_delay_estimator.h"
+#include "xls/ir/type.h"
+
+namespace xls {
+namespace {
+
+double Log2p1(double x) { return std::log2(1.0 + x); }
+
+// Solves the linear system "a" x = "b", where "a" is a row-major n x n matrix,
+// by Gaussian elimination with partial pivoting.
+absl::StatusOr<std::vector<double>> Solve(std::vector<double> a,
+                                          std::vector<double> b) {
+  int64_t n = b.size();
+  XLS_RET_CHECK_EQ(a.size(), n * n);
+  for (int64_t col = 0; col < n; ++col) {
+    int64_t pivot = col;
+    for (int64_t row = col + 1; row < n; ++row) {
+      if (std::abs(a[row * n + col]) > std::abs(a[pivot * n + col])) {
+        pivot = row;
+      }
+    }
+    if (std::abs(a[pivot * n + col]) < 1e-12) {
+      return absl::InvalidArgumentError("Delay model regression is singular");
+    }
+    if (pivot != col) {
+      for (int64_t i = 0; i < n; ++i) {
+        std::swap(a[pivot * n + i], a[col * n + i]);
+      }
+      std::swap(b[pivot], b[col]);
+    }
+    for (int64_t row = col + 1; row < n; ++row) {
+      double factor = a[row * n + col] / a[col * n + col];
+      for (int64_t i = col; i < n; ++i) {
+        a[row * n + i] -= factor * a[col * n + i];
+      }
+      b[row] -= factor * b[col];
+    }
+  }
+  std::vector<double> x(n);
+  for (int64_t row = n - 1; row >= 0; --row) {
+    double sum = b[row];
+    for (int64_t i = row + 1; i < n; ++i) {
+      sum -= a[row * n + i] * x[i];
+    }
+    x[row] = sum / a[row * n + row];
+  }
+  return x;
+}
+
+// Fits the weights of "op" to the data points by ridge regression. The
+// features are standardized so that the regularization treats them alike, and
+// the weights are converted back to apply to the raw features.
+absl::StatusOr<delay_model::LearnedDelayModel::OpWeights> FitWeights(
+    const std::string& op,
+    absl::Span<const delay_model::DataPoint* const> data_points,
+    double l2_regularization) {
+  constexpr int64_t kCount = kLearnedDelayFeatureCount;
+  const double n = data_points.size();
+  std::vector<DelayFeatures> features;
+  std::vector<double> delays;
+  for (const delay_model::DataPoint* data_point : data_points) {
+    features.push_back(ComputeDelayFeatures(
+        DelayFeatureInputs::FromOperation(data_point->operation())));
+    delays.push_back(data_point->delay() - data_point->delay_offset());
+  }
+
+  DelayFeatures mean{};
+  DelayFeatures scale{};
+  for (const DelayFeatures& f : features) {
+    for (int64_t i = 0; i < kCount; ++i) {
+      mean[i] += f[i] / n;
+    }
+  }
+  for (const DelayFeatures& f : features) {
+    for (int64_t i = 0; i < kCount; ++i) {
+      scale[i] += (f[i] - mean[i]) * (f[i] - mean[i]) / n;
+    }
+  }
+  for (int64_t i = 0; i < kCount; ++i) {
+    // A constant feature standardizes to zero, and its weight to zero.
+    scale[i] = scale[i] > 1e-12 ? std::sqrt(scale[i]) : 1.0;
+  }
+  double mean_delay = 0.0;
+  for (double delay : delays) {
+    mean_delay += delay / n;
+  }
+
+  // The standardized features have zero mean, so the bias is the mean delay
+  // and the weights solve (Z^T Z + lambda n I) w = Z^T (y - mean(y)).
+  std::vector<double> a(kCount * kCount, 0.0);
+  std::vector<double> b(kCount, 0.0);
+  for (int64_t p = 0; p < features.size(); ++p) {
+    DelayFeatures z;
+    for (int64_t i = 0; i < kCount; ++i) {
+      z[i] = (features[p][i] - mean[i]) / scale[i];
+    }
+    for (int64_t i = 0; i < kCount; ++i) {
+      for (int64_t j = 0; j < kCount; ++j) {
+        a[i * kCount + j] += z[i] * z[j];
+      }
+      b[i] += z[i] * (delays[p] - mean_delay);
+    }
+  }
+  for (int64_t i = 0; i < kCount; ++i) {
+    a[i * kCount + i] += l2_regularization * n;
+  }
+  XLS_ASSIGN_OR_RETURN(std::vector<double> w, Solve(a, b));
+
+  delay_model::LearnedDelayModel::OpWeights weights;
+  weights.set_op(op);
+  double bias = mean_delay;
+  for (int64_t i = 0; i < kCount; ++i) {
+    double raw = w[i] / scale[i];
+    weights.add_weights(raw);
+    bias -= raw * mean[i];
+  }
+  weights.set_bias(bias);
+  weights.set_data_point_count(data_points.size());
+  return weights;
+}
+
+}  // namespace
+
+/* static */ DelayFeatureInputs DelayFeatureInputs::FromOperation(
+    const delay_model::Operation& operation) {
+  DelayFeatureInputs inputs;
+  inputs.result_bit_count = operation.bit_count();
+  for (const delay_model::Operation::Operand& operand : operation.operands()) {
+    inputs.operand_bit_counts.push_back(
+        operand.bit_count() * std::max<int64_t>(1, operand.element_count()));
+  }
+  inputs.fanout = std::max<int64_t>(1, operation.fanout());
+  inputs.known_operand_bits = operation.known_operand_bits();
+  return inputs;
+}
+
+DelayFeatures ComputeDelayFeatures(const DelayFeatureInputs& inputs) {
+  int64_t max_operand_bits = 0;
+  int64_t total_operand_bits = 0;
+  for (int64_t bit_count : inputs.operand_bit_counts) {
+    max_operand_bits = std::max(max_operand_bits, bit_count);
+    total_operand_bits += bit_count;
+  }
+  double operand_count = inputs.operand_bit_counts.size();
+  double known_fraction =
+      total_operand_bits == 0
+          ? 0.0
+          : static_cast<double>(std::min(inputs.known_operand_bits,
+                                         total_operand_bits)) /
+                total_operand_bits;
+  return DelayFeatures{
+      static_cast<double>(inputs.result_bit_count),
+      Log2p1(inputs.result_bit_count),
+      static_cast<double>(max_operand_bits),
+      Log2p1(max_operand_bits),
+      operand_count,
+      Log2p1(operand_count),
+      static_cast<double>(total_operand_bits),
+      Log2p1(total_operand_bits),
+      Log2p1(inputs.fanout),
+      known_fraction,
+  };
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<LearnedDelayEstimator>>
+LearnedDelayEstimator::Create(const delay_model::LearnedDelayModel& model) {
+  if (model.feature_version() != kLearnedDelayFeatureVersion) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Learned delay model was trained for feature version %d, expected %d",
+        model.feature_version(), kLearnedDelayFeatureVersion));
+  }
+  auto estimator = absl::WrapUnique(new LearnedDelayEstimator());
+  for (const delay_model::LearnedDelayModel::OpWeights& op_weights :
+       model.op_weights()) {
+    if (op_weights.weights_size() != kLearnedDelayFeatureCount) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Learned delay model of %s has %d weights, expected %d",
+          op_weights.op().empty() ? "the fallback" : op_weights.op(),
+          op_weights.weights_size(), kLearnedDelayFeatureCount));
+    }
+    Weights weights;
+    weights.bias = op_weights.bias();
+    std::copy(op_weights.weights().begin(), op_weights.weights().end(),
+              weights.weights.begin());
+    if (op_weights.op().empty()) {
+      if (estimator->fallback_weights_.has_value()) {
+        return absl::InvalidArgumentError(
+            "Learned delay model has more than one fallback model");
+      }
+      estimator->fallback_weights_ = weights;
+      continue;
+    }
+    XLS_ASSIGN_OR_RETURN(Op op, DelayModelOpToOp(op_weights.op()));
+    if (!estimator->op_weights_.insert({op, weights}).second) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Learned delay model has more than one model of %s",
+          op_weights.op()));
+    }
+  }
+  return std::move(estimator);
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<LearnedDelayEstimator>>
+LearnedDelayEstimator::CreateFromFile(const std::filesystem::path& path) {
+  delay_model::LearnedDelayModel model;
+  XLS_RETURN_IF_ERROR(ParseTextProtoFile(path, &model));
+  return Create(model);
+}
+
+absl::StatusOr<DelayFeatureInputs> LearnedDelayEstimator::GetFeatureInputs(
+    Node* node) const {
+  DelayFeatureInputs inputs;
+  inputs.result_bit_count = node->GetType()->GetFlatBitCount();
+  inputs.fanout = std::max<int64_t>(1, node->users().size());
+  bool has_bits_operand = false;
+  for (Node* operand : node->operands()) {
+    inputs.operand_bit_counts.push_back(operand->GetType()->GetFlatBitCount());
+    has_bits_operand |= operand->GetType()->IsBits();
+  }
+  if (!has_bits_operand) {
+    return inputs;
+  }
+
+  FunctionBase* f = node->function_base();
+  absl::MutexLock lock(&mutex_);
+  auto it = query_engine_states_.find(f->uid());
+  if (it == query_engine_states_.end() ||
+      it->second.change_count != f->change_count()) {
+    XLS_ASSIGN_OR_RETURN(TernaryQueryEngine * engine,
+                         query_engines_.GetTernaryQueryEngine(f));
+    it = query_engine_states_
+             .insert_or_assign(f->uid(),
+                               QueryEngineState{engine, f->change_count()})
+             .first;
+  }
+  const TernaryQueryEngine& engine = *it->second.engine;
+  for (Node* operand : node->operands()) {
+    if (engine.IsTracked(operand)) {
+      inputs.known_operand_bits += engine.GetKnownBits(operand).PopCount();
+    }
+  }
+  return inputs;
+}
+
+absl::StatusOr<int64_t> LearnedDelayEstimator::GetOperationDelayInPs(
+    Node* node) const {
+  const Weights* weights;
+  auto it = op_weights_.find(node->op());
+  if (it != op_weights_.end()) {
+    weights = &it->second;
+  } else if (fallback_weights_.has_value()) {
+    weights = &*fallback_weights_;
+  } else {
+    return absl::UnimplementedError("Unhandled node for delay estimation: " +
+                                    node->ToStringWithOperandTypes());
+  }
+  XLS_ASSIGN_OR_RETURN(DelayFeatureInputs inputs, GetFeatureInputs(node));
+  DelayFeatures features = ComputeDelayFeatures(inputs);
+  double delay = weights->bias;
+  for (int64_t i = 0; i < kLearnedDelayFeatureCount; ++i) {
+    delay += weights->weights[i] * features[i];
+  }
+  return std::max<int64_t>(0, std::llround(delay));
+}
+
+absl::StatusOr<delay_model::LearnedDelayModel> TrainLearnedDelayModel(
+    const delay_model::DelayModel& characterization,
+    const LearnedDelayTrainingOptions& options) {
+  if (options.l2_regularization <= 0.0) {
+    return absl::InvalidArgumentError(
+        "L2 regularization of a learned delay model must be positive");
+  }
+  // Sorted by op so that the trained model is deterministic.
+  absl::btree_map<std::string, std::vector<const delay_model::DataPoint*>>
+      op_data_points;
+  std::vector<const delay_model::DataPoint*> all_data_points;
+  for (const delay_model::DataPoint& data_point :
+       characterization.data_points()) {
+    XLS_RETURN_IF_ERROR(
+        DelayModelOpToOp(data_point.operation().op()).status());
+    op_data_points[data_point.operation().op()].push_back(&data_point);
+    all_data_points.push_back(&data_point);
+  }
+  if (all_data_points.empty()) {
+    return absl::InvalidArgumentError(
+        "Characterization has no data points to train a delay model with");
+  }
+
+  absl::btree_map<std::string, delay_model::LearnedDelayModel::OpWeights>
+      op_weights;
+  for (const auto& [op, data_points] : op_data_points) {
+    if (data_points.size() >= options.min_data_points_per_op) {
+      XLS_ASSIGN_OR_RETURN(
+          op_weights[op],
+          FitWeights(op, data_points, options.l2_regularization));
+    }
+  }
+  for (const delay_model::OpModel& op_model : characterization.op_models()) {
+    if (op_model.estimator().has_fixed()) {
+      delay_model::LearnedDelayModel::OpWeights& weights =
+          op_weights[op_model.op()];
+      weights.Clear();
+      weights.set_op(op_model.op());
+      weights.set_bias(op_model.estimator().fixed());
+      for (int64_t i = 0; i < kLearnedDelayFeatureCount; ++i) {
+        weights.add_weights(0.0);
+      }
+    }
+  }
+  // Resolve aliases, which may alias other aliases.
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (const delay_model::OpModel& op_model : characterization.op_models()) {
+      const std::string& aliased = op_model.estimator().alias_op();
+      if (op_model.estimator().has_alias_op() &&
+          !op_weights.contains(op_model.op()) && op_weights.contains(aliased)) {
+        delay_model::LearnedDelayModel::OpWeights weights =
+            op_weights.at(aliased);
+        weights.set_op(op_model.op());
+        op_weights[op_model.op()] = std::move(weights);
+        progress = true;
+      }
+    }
+  }
+
+  delay_model::LearnedDelayModel model;
+  model.set_feature_version(kLearnedDelayFeatureVersion);
+  XLS_ASSIGN_OR_RETURN(
+      *model.add_op_weights(),
+      FitWeights("", all_data_points, options.l2_regularization));
+  for (auto& [op, weights] : op_weights) {
+    *model.add_op_weights() = std::move(weights);
+  }
+  return model;
+}
+
+absl::StatusOr<DelayEstimator*> LoadLearnedDelayModelFile(
+    const std::filesystem::path& path) {
+  DelayEstimatorManager& manager = GetDelayEstimatorManagerSingleton();
+  absl::StatusOr<DelayEstimator*> existing =
+      manager.GetDelayEstimator(path.string());
+  if (existing.ok()) {
+    return existing;
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<LearnedDelayEstimator> estimator,
+                       LearnedDelayEstimator::CreateFromFile(path));
+  XLS_RETURN_IF_ERROR(manager.RegisterDelayEstimator(
+      path.string(), std::move(estimator), DelayEstimatorPrecedence::kLow));
+  return manager.GetDelayEstimator(path.string());
+}
+
+}  // namespace xls
@@ -0,0 +1,150 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_DELAY_MODEL_LEARNED_DELAY_ESTIMATOR_H_
+#define XLS_DELAY_MODEL_LEARNED_DELAY_ESTIMATOR_H_
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+#include "xls/passes/query_engine_cache.h"
+
+namespace xls {
+
+// The number of features of a LearnedDelayModel and the version of their
+// definition. Bump the version when changing ComputeDelayFeatures so that
+// models trained for other features are rejected.
+inline constexpr int64_t kLearnedDelayFeatureCount = 10;
+inline constexpr int64_t kLearnedDelayFeatureVersion = 1;
+
+using DelayFeatures = std::array<double, kLearnedDelayFeatureCount>;
+
+// The properties of an operation which its delay features are computed from,
+// taken from a characterized data point or from a node in its function.
+struct DelayFeatureInputs {
+  int64_t result_bit_count = 0;
+
+  // The flat bit count of each operand.
+  std::vector<int64_t> operand_bit_counts;
+
+  // The number of users of the result; at least one.
+  int64_t fanout = 1;
+
+  // The number of operand bits with statically known values.
+  int64_t known_operand_bits = 0;
+
+  static DelayFeatureInputs FromOperation(
+      const delay_model::Operation& operation);
+};
+
+// Returns the features of an operation, in order: the result bit count, the
+// widest operand's bit count, the operand count, the total operand bit count,
+// each followed by its log2(1 + x); then log2(1 + fanout), and the fraction of
+// operand bits which are known.
+DelayFeatures ComputeDelayFeatures(const DelayFeatureInputs& inputs);
+
+// A delay estimator which evaluates a LearnedDelayModel (see
+// delay_model.proto): for each op, a linear function of the features above,
+// trained from characterization data by TrainLearnedDelayModel. Estimating a
+// node costs a few dozen floating point operations once its known bits are
+// available.
+//
+// The known operand bits come from a ternary query engine of the node's
+// function, which the estimator keeps for its lifetime and updates
+// incrementally when the function has changed since its last query. Since
+// estimates depend on more than a node's signature, the estimator must not be
+// wrapped in a CachingDelayEstimator. Thread-safe.
+class LearnedDelayEstimator : public DelayEstimator {
+ public:
+  // Creates an estimator from the given model. Returns an error if the model
+  // is malformed or was trained for different features.
+  static absl::StatusOr<std::unique_ptr<LearnedDelayEstimator>> Create(
+      const delay_model::LearnedDelayModel& model);
+
+  // Creates an estimator from a file containing a LearnedDelayModel text
+  // proto.
+  static absl::StatusOr<std::unique_ptr<LearnedDelayEstimator>>
+  CreateFromFile(const std::filesystem::path& path);
+
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override;
+
+  // Returns the inputs of the features of the node in its function.
+  absl::StatusOr<DelayFeatureInputs> GetFeatureInputs(Node* node) const;
+
+ private:
+  struct Weights {
+    double bias;
+    DelayFeatures weights;
+  };
+
+  LearnedDelayEstimator() = default;
+
+  absl::flat_hash_map<Op, Weights> op_weights_;
+  absl::optional<Weights> fallback_weights_;
+
+  // The query engine of a function (by FunctionBase::uid) and the change count
+  // of the function it is up to date with.
+  struct QueryEngineState {
+    TernaryQueryEngine* engine;
+    int64_t change_count;
+  };
+
+  mutable absl::Mutex mutex_;
+  mutable QueryEngineCache query_engines_ ABSL_GUARDED_BY(mutex_);
+  mutable absl::flat_hash_map<int64_t, QueryEngineState> query_engine_states_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+struct LearnedDelayTrainingOptions {
+  // The strength of the L2 regularization of the weights, which are fit to
+  // standardized features.
+  double l2_regularization = 1e-3;
+
+  // Ops with fewer data points than this get no weights of their own and are
+  // estimated by the fallback model, which is fit to all data points.
+  int64_t min_data_points_per_op = 4;
+};
+
+// Fits a LearnedDelayModel to the data points of the given characterization by
+// (ridge) least squares. Ops whose model in the characterization is a fixed
+// delay (e.g. kParam) keep it, as a bias with zero weights, and aliases get the
+// weights of the op they alias; other estimators and specializations are
+// ignored, since the features subsume them.
+absl::StatusOr<delay_model::LearnedDelayModel> TrainLearnedDelayModel(
+    const delay_model::DelayModel& characterization,
+    const LearnedDelayTrainingOptions& options = {});
+
+// Loads the learned delay model in the given text proto file and registers it
+// with the delay estimator manager under the name of the file. Returns the
+// registered estimator. Loading the same file again returns the existing
+// estimator.
+absl::StatusOr<DelayEstimator*> LoadLearnedDelayModelFile(
+    const std::filesystem::path& path);
+
+}  // namespace xls
+
+#endif  // XLS_DELAY_MODEL_LEARNED_DELAY_ESTIMATOR_H_
@@ -0,0 +1,167 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/learned_delay_estimator.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+void AddDataPoint(delay_model::DelayModel* model, const std::string& op,
+                  int64_t bit_count, int64_t known_operand_bits,
+                  int64_t delay) {
+  delay_model::DataPoint* data_point = model->add_data_points();
+  delay_model::Operation* operation = data_point->mutable_operation();
+  operation->set_op(op);
+  operation->set_bit_count(bit_count);
+  operation->add_operands()->set_bit_count(bit_count);
+  operation->add_operands()->set_bit_count(bit_count);
+  operation->set_known_operand_bits(known_operand_bits);
+  data_point->set_delay(delay + 20);
+  data_point->set_delay_offset(20);
+}
+
+class LearnedDelayEstimatorTest : public IrTestBase {
+ protected:
+  absl::StatusOr<std::unique_ptr<LearnedDelayEstimator>> Train(
+      const delay_model::DelayModel& characterization) {
+    LearnedDelayTrainingOptions options;
+    options.l2_regularization = 1e-6;
+    XLS_ASSIGN_OR_RETURN(delay_model::LearnedDelayModel model,
+                         TrainLearnedDelayModel(characterization, options));
+    return LearnedDelayEstimator::Create(model);
+  }
+};
+
+TEST_F(LearnedDelayEstimatorTest, LearnsLinearDelays) {
+  delay_model::DelayModel characterization;
+  for (int64_t bit_count : {1, 2, 4, 8, 16, 32, 64}) {
+    AddDataPoint(&characterization, "kAdd", bit_count, 0, 10 * bit_count + 5);
+  }
+  delay_model::OpModel* sub_model = characterization.add_op_models();
+  sub_model->set_op("kSub");
+  sub_model->mutable_estimator()->set_alias_op("kAdd");
+  delay_model::OpModel* param_model = characterization.add_op_models();
+  param_model->set_op("kParam");
+  param_model->mutable_estimator()->set_fixed(0);
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<LearnedDelayEstimator> estimator,
+                           Train(characterization));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(24));
+  BValue add = fb.Add(x, x);
+  BValue sub = fb.Subtract(x, x);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  XLS_ASSERT_OK_AND_ASSIGN(int64_t add_delay,
+                           estimator->GetOperationDelayInPs(add.node()));
+  EXPECT_NEAR(add_delay, 245, 3);
+  EXPECT_THAT(estimator->GetOperationDelayInPs(sub.node()),
+              IsOkAndHolds(add_delay));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(x.node()), IsOkAndHolds(0));
+}
+
+TEST_F(LearnedDelayEstimatorTest, KnownBitsReduceDelay) {
+  delay_model::DelayModel characterization;
+  for (int64_t known_bits : {0, 4, 8, 12, 16}) {
+    AddDataPoint(&characterization, "kAnd", 8, known_bits,
+                 100 - 5 * known_bits);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<LearnedDelayEstimator> estimator,
+                           Train(characterization));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  BValue and_param = fb.And(x, y);
+  BValue and_literal = fb.And(x, fb.Literal(UBits(0x0f, 8)));
+  XLS_ASSERT_OK(fb.Build().status());
+
+  XLS_ASSERT_OK_AND_ASSIGN(DelayFeatureInputs inputs,
+                           estimator->GetFeatureInputs(and_literal.node()));
+  EXPECT_EQ(inputs.known_operand_bits, 8);
+  XLS_ASSERT_OK_AND_ASSIGN(int64_t param_delay,
+                           estimator->GetOperationDelayInPs(and_param.node()));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      int64_t literal_delay,
+      estimator->GetOperationDelayInPs(and_literal.node()));
+  EXPECT_NEAR(param_delay, 100, 3);
+  EXPECT_NEAR(literal_delay, 60, 3);
+}
+
+TEST_F(LearnedDelayEstimatorTest, FallsBackForUncharacterizedOps) {
+  delay_model::DelayModel characterization;
+  for (int64_t bit_count : {1, 2, 4, 8}) {
+    AddDataPoint(&characterization, "kAdd", bit_count, 0, 10 * bit_count);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(delay_model::LearnedDelayModel model,
+                           TrainLearnedDelayModel(characterization));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<LearnedDelayEstimator> estimator,
+                           LearnedDelayEstimator::Create(model));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(4));
+  BValue neg = fb.Negate(x);
+  XLS_ASSERT_OK(fb.Build().status());
+  XLS_EXPECT_OK(estimator->GetOperationDelayInPs(neg.node()).status());
+
+  // Without the fallback model there is no estimate for the node.
+  model.mutable_op_weights()->erase(model.op_weights().begin());
+  XLS_ASSERT_OK_AND_ASSIGN(estimator, LearnedDelayEstimator::Create(model));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(neg.node()),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("Unhandled node for delay estimation")));
+}
+
+TEST_F(LearnedDelayEstimatorTest, RejectsMalformedModels) {
+  delay_model::DelayModel characterization;
+  EXPECT_THAT(TrainLearnedDelayModel(characterization),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("no data points")));
+  AddDataPoint(&characterization, "kFrob", 8, 0, 10);
+  EXPECT_THAT(TrainLearnedDelayModel(characterization),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown op in delay model: kFrob")));
+
+  delay_model::LearnedDelayModel model;
+  model.set_feature_version(kLearnedDelayFeatureVersion + 1);
+  EXPECT_THAT(LearnedDelayEstimator::Create(model),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("feature version")));
+  model.set_feature_version(kLearnedDelayFeatureVersion);
+  model.add_op_weights()->set_op("kAdd");
+  EXPECT_THAT(LearnedDelayEstimator::Create(model),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("has 0 weights")));
+}
+
+}  // namespace
+}  // namespace xls
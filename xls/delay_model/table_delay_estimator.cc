@@ -0,0 +1,543 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/table_delay_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_replace.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/type.h"
+
+namespace xls {
+namespace {
+
+// Axes spanning more values than this are searched with a binary search
+// instead of a dense index.
+constexpr int64_t kMaxDenseAxisSpan = 1 << 16;
+
+}  // namespace
+
+absl::StatusOr<Op> DelayModelOpToOp(absl::string_view name) {
+  static const auto* ops = [] {
+    auto* ops = new absl::flat_hash_map<std::string, Op>();
+    for (int64_t i = 0; i < kOpLimit; ++i) {
+      Op op = static_cast<Op>(i);
+      (*ops)[absl::StrReplaceAll(OpToString(op), {{"_", ""}})] = op;
+    }
+    return ops;
+  }();
+  if (name.empty() || name[0] != 'k' ||
+      !ops->contains(absl::AsciiStrToLower(name.substr(1)))) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown op in delay model: %s", name));
+  }
+  return ops->at(absl::AsciiStrToLower(name.substr(1)));
+}
+
+namespace {
+
+// Returns the value of the delay factor for the given node.
+absl::StatusOr<int64_t> NodeDelayFactor(const delay_model::DelayFactor& factor,
+                                        Node* node) {
+  if (factor.source() == delay_model::DelayFactor::RESULT_BIT_COUNT) {
+    return node->GetType()->GetFlatBitCount();
+  }
+  if (factor.source() == delay_model::DelayFactor::OPERAND_COUNT) {
+    return node->operand_count();
+  }
+  if (factor.operand_number() >= node->operand_count()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Delay factor refers to operand %d of %s which has %d operands",
+        factor.operand_number(), node->GetName(), node->operand_count()));
+  }
+  Type* operand_type = node->operand(factor.operand_number())->GetType();
+  switch (factor.source()) {
+    case delay_model::DelayFactor::OPERAND_BIT_COUNT:
+      return operand_type->GetFlatBitCount();
+    case delay_model::DelayFactor::OPERAND_ELEMENT_COUNT:
+    case delay_model::DelayFactor::OPERAND_ELEMENT_BIT_COUNT:
+      if (!operand_type->IsArray()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Delay factor requires operand %d of %s to be an "
+                            "array, is %s",
+                            factor.operand_number(), node->GetName(),
+                            operand_type->ToString()));
+      }
+      if (factor.source() == delay_model::DelayFactor::OPERAND_ELEMENT_COUNT) {
+        return operand_type->AsArrayOrDie()->size();
+      }
+      return operand_type->AsArrayOrDie()->element_type()->GetFlatBitCount();
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid delay factor source: %d", factor.source()));
+  }
+}
+
+// Returns the value of the delay factor for the given characterized operation.
+absl::StatusOr<int64_t> OperationDelayFactor(
+    const delay_model::DelayFactor& factor,
+    const delay_model::Operation& operation) {
+  switch (factor.source()) {
+    case delay_model::DelayFactor::RESULT_BIT_COUNT:
+      return operation.bit_count();
+    case delay_model::DelayFactor::OPERAND_COUNT:
+      return operation.operands_size();
+    case delay_model::DelayFactor::OPERAND_BIT_COUNT:
+    case delay_model::DelayFactor::OPERAND_ELEMENT_COUNT:
+    case delay_model::DelayFactor::OPERAND_ELEMENT_BIT_COUNT:
+      if (factor.operand_number() >= operation.operands_size()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Delay factor refers to operand %d of a data point of %s which has "
+            "%d operands",
+            factor.operand_number(), operation.op(),
+            operation.operands_size()));
+      }
+      if (factor.source() == delay_model::DelayFactor::OPERAND_ELEMENT_COUNT) {
+        return operation.operands(factor.operand_number()).element_count();
+      }
+      return operation.operands(factor.operand_number()).bit_count();
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid delay factor source: %d", factor.source()));
+  }
+}
+
+// The sample values of one factor of a table.
+class TableAxis {
+ public:
+  static absl::StatusOr<TableAxis> Create(absl::Span<const int64_t> values) {
+    if (values.empty()) {
+      return absl::InvalidArgumentError("Delay table axis has no values");
+    }
+    for (int64_t i = 1; i < values.size(); ++i) {
+      if (values[i] <= values[i - 1]) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Delay table axis values must be strictly increasing: %d follows "
+            "%d",
+            values[i], values[i - 1]));
+      }
+    }
+    TableAxis axis;
+    axis.values_.assign(values.begin(), values.end());
+    if (values.size() > 2 &&
+        values.back() - values.front() < kMaxDenseAxisSpan) {
+      axis.segments_.resize(values.back() - values.front());
+      int64_t segment = 0;
+      for (int64_t v = values.front(); v < values.back(); ++v) {
+        if (v >= values[segment + 1]) {
+          ++segment;
+        }
+        axis.segments_[v - values.front()] = segment;
+      }
+    }
+    return axis;
+  }
+
+  int64_t size() const { return values_.size(); }
+
+  // Returns the index i of the segment [values[i], values[i + 1]] used to
+  // interpolate at the given value: the segment containing it, or the first or
+  // last segment if it lies outside the axis. Must have at least two values.
+  int64_t Segment(int64_t value) const {
+    if (value <= values_.front()) {
+      return 0;
+    }
+    if (value >= values_.back()) {
+      return values_.size() - 2;
+    }
+    if (!segments_.empty()) {
+      return segments_[value - values_.front()];
+    }
+    return std::upper_bound(values_.begin(), values_.end(), value) -
+           values_.begin() - 1;
+  }
+
+  // Returns the position of the value along the segment with the given index,
+  // zero at its start and one at its end.
+  double Fraction(int64_t segment, int64_t value) const {
+    return static_cast<double>(value - values_[segment]) /
+           static_cast<double>(values_[segment + 1] - values_[segment]);
+  }
+
+  // Returns the index of the value in the axis, or -1 if it is not a sample.
+  int64_t IndexOf(int64_t value) const {
+    auto it = std::lower_bound(values_.begin(), values_.end(), value);
+    return (it == values_.end() || *it != value) ? -1 : it - values_.begin();
+  }
+
+ private:
+  std::vector<int64_t> values_;
+  // Dense index from value - values_.front() to segment, if the axis spans
+  // few enough values and has more than one segment.
+  std::vector<int32_t> segments_;
+};
+
+// An interpolated delay table over one or two factors.
+struct Table {
+  std::vector<delay_model::DelayFactor> factors;
+  std::vector<TableAxis> axes;
+  // Delays in row-major order.
+  std::vector<int64_t> delays;
+
+  // Returns the delay at the given factor values.
+  double Interpolate(absl::Span<const int64_t> x) const {
+    if (axes.size() == 1) {
+      return Interpolate1D(axes[0], x[0], delays, 0, 1);
+    }
+    // Interpolate along the second axis in the two rows surrounding the value
+    // of the first, then between the rows.
+    int64_t columns = axes[1].size();
+    if (axes[0].size() == 1) {
+      return Interpolate1D(axes[1], x[1], delays, 0, 1);
+    }
+    int64_t row = axes[0].Segment(x[0]);
+    double low = Interpolate1D(axes[1], x[1], delays, row * columns, 1);
+    double high = Interpolate1D(axes[1], x[1], delays, (row + 1) * columns, 1);
+    double t = axes[0].Fraction(row, x[0]);
+    return low + t * (high - low);
+  }
+
+  // Interpolates along the axis in the delays starting at 'offset' and
+  // separated by 'stride'.
+  static double Interpolate1D(const TableAxis& axis, int64_t x,
+                              absl::Span<const int64_t> delays, int64_t offset,
+                              int64_t stride) {
+    if (axis.size() == 1) {
+      return delays[offset];
+    }
+    int64_t segment = axis.Segment(x);
+    double low = delays[offset + segment * stride];
+    double high = delays[offset + (segment + 1) * stride];
+    return low + axis.Fraction(segment, x) * (high - low);
+  }
+};
+
+// A bounding box model: the delay of the first data point whose factor values
+// are all at least those of the operation.
+struct BoundingBox {
+  std::vector<delay_model::DelayFactor> factors;
+  std::vector<std::pair<std::vector<int64_t>, int64_t>> boxes;
+};
+
+// Returns the delay of the data point excluding its offset.
+int64_t DataPointDelay(const delay_model::DataPoint& data_point) {
+  return data_point.delay() - data_point.delay_offset();
+}
+
+absl::StatusOr<Table> CreateTable(
+    const delay_model::TableEstimator& proto,
+    absl::Span<const delay_model::DataPoint* const> data_points) {
+  if (proto.factors_size() < 1 || proto.factors_size() > 2) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Delay table must have one or two factors, has %d",
+        proto.factors_size()));
+  }
+  if (proto.axes_size() != proto.factors_size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Delay table has %d factors but %d axes",
+                        proto.factors_size(), proto.axes_size()));
+  }
+  Table table;
+  int64_t grid_size = 1;
+  for (int64_t i = 0; i < proto.factors_size(); ++i) {
+    table.factors.push_back(proto.factors(i));
+    XLS_ASSIGN_OR_RETURN(TableAxis axis,
+                         TableAxis::Create(proto.axes(i).values()));
+    grid_size *= axis.size();
+    table.axes.push_back(std::move(axis));
+  }
+  if (!proto.delays().empty()) {
+    if (proto.delays_size() != grid_size) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Delay table has %d delays for %d grid points",
+                          proto.delays_size(), grid_size));
+    }
+    table.delays.assign(proto.delays().begin(), proto.delays().end());
+    return table;
+  }
+
+  // Fill the table from the data points on the grid, keeping the largest delay
+  // if a grid point is characterized more than once.
+  table.delays.resize(grid_size, -1);
+  for (const delay_model::DataPoint* data_point : data_points) {
+    int64_t index = 0;
+    for (int64_t i = 0; i < table.axes.size(); ++i) {
+      XLS_ASSIGN_OR_RETURN(
+          int64_t x, OperationDelayFactor(table.factors[i],
+                                          data_point->operation()));
+      int64_t axis_index = table.axes[i].IndexOf(x);
+      if (axis_index < 0) {
+        index = -1;
+        break;
+      }
+      index = index * table.axes[i].size() + axis_index;
+    }
+    if (index >= 0) {
+      table.delays[index] =
+          std::max(table.delays[index], DataPointDelay(*data_point));
+    }
+  }
+  for (int64_t index = 0; index < grid_size; ++index) {
+    if (table.delays[index] < 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Delay table has no delays and no data point for grid point %d",
+          index));
+    }
+  }
+  return table;
+}
+
+}  // namespace
+
+// The model of one op: a general estimator and zero or more estimators used
+// under specialized conditions, tried in order.
+struct TableDelayEstimator::OpModel {
+  // Exactly one of the fields is set.
+  struct Estimator {
+    absl::optional<int64_t> fixed;
+    absl::optional<Op> alias_op;
+    absl::optional<int64_t> logical_effort_tau_in_ps;
+    absl::optional<Table> table;
+    absl::optional<BoundingBox> bounding_box;
+  };
+
+  static absl::StatusOr<Estimator> CreateEstimator(
+      const delay_model::Estimator& proto,
+      absl::Span<const delay_model::DataPoint* const> data_points) {
+    Estimator estimator;
+    switch (proto.estimator_case()) {
+      case delay_model::Estimator::kFixed:
+        estimator.fixed = proto.fixed();
+        break;
+      case delay_model::Estimator::kAliasOp: {
+        XLS_ASSIGN_OR_RETURN(Op op, DelayModelOpToOp(proto.alias_op()));
+        estimator.alias_op = op;
+        break;
+      }
+      case delay_model::Estimator::kLogicalEffort:
+        estimator.logical_effort_tau_in_ps = proto.logical_effort().tau_in_ps();
+        break;
+      case delay_model::Estimator::kTable: {
+        XLS_ASSIGN_OR_RETURN(estimator.table,
+                             CreateTable(proto.table(), data_points));
+        break;
+      }
+      case delay_model::Estimator::kBoundingBox: {
+        BoundingBox box;
+        box.factors.assign(proto.bounding_box().factors().begin(),
+                           proto.bounding_box().factors().end());
+        for (const delay_model::DataPoint* data_point : data_points) {
+          std::vector<int64_t> x;
+          for (const delay_model::DelayFactor& factor : box.factors) {
+            XLS_ASSIGN_OR_RETURN(
+                int64_t value,
+                OperationDelayFactor(factor, data_point->operation()));
+            x.push_back(value);
+          }
+          box.boxes.push_back({std::move(x), DataPointDelay(*data_point)});
+        }
+        estimator.bounding_box = std::move(box);
+        break;
+      }
+      case delay_model::Estimator::kRegression:
+        return absl::UnimplementedError(
+            "Regression estimators require curve fitting and are only "
+            "supported in generated delay models");
+      default:
+        return absl::InvalidArgumentError("Delay model estimator is not set");
+    }
+    return estimator;
+  }
+
+  Estimator estimator;
+  std::vector<std::pair<delay_model::SpecializationKind, Estimator>>
+      specializations;
+};
+
+TableDelayEstimator::~TableDelayEstimator() = default;
+
+/* static */ absl::StatusOr<std::unique_ptr<TableDelayEstimator>>
+TableDelayEstimator::Create(const delay_model::DelayModel& model) {
+  // As in the generated models, data points are split between the
+  // specializations of their op and the general estimator.
+  absl::flat_hash_map<std::string, std::vector<const delay_model::DataPoint*>>
+      op_data_points;
+  for (const delay_model::DataPoint& data_point : model.data_points()) {
+    op_data_points[data_point.operation().op()].push_back(&data_point);
+  }
+
+  auto estimator = absl::WrapUnique(new TableDelayEstimator());
+  for (const delay_model::OpModel& op_model_proto : model.op_models()) {
+    XLS_ASSIGN_OR_RETURN(Op op, DelayModelOpToOp(op_model_proto.op()));
+    if (estimator->op_models_.contains(op)) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Delay model has more than one model of %s", op_model_proto.op()));
+    }
+    std::vector<const delay_model::DataPoint*> data_points =
+        op_data_points[op_model_proto.op()];
+    auto op_model = std::make_unique<OpModel>();
+    for (const delay_model::OpModel::Specialization& specialization :
+         op_model_proto.specializations()) {
+      if (specialization.kind() != delay_model::OPERANDS_IDENTICAL &&
+          specialization.kind() != delay_model::HAS_LITERAL_OPERAND) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Unsupported specialization kind %d of %s",
+                            specialization.kind(), op_model_proto.op()));
+      }
+      std::vector<const delay_model::DataPoint*> special_data_points;
+      auto is_special = [&](const delay_model::DataPoint* data_point) {
+        return data_point->operation().specialization() ==
+               specialization.kind();
+      };
+      std::copy_if(data_points.begin(), data_points.end(),
+                   std::back_inserter(special_data_points), is_special);
+      data_points.erase(
+          std::remove_if(data_points.begin(), data_points.end(), is_special),
+          data_points.end());
+      XLS_ASSIGN_OR_RETURN(OpModel::Estimator special_estimator,
+                           OpModel::CreateEstimator(specialization.estimator(),
+                                                    special_data_points));
+      op_model->specializations.push_back(
+          {specialization.kind(), std::move(special_estimator)});
+    }
+    XLS_ASSIGN_OR_RETURN(
+        op_model->estimator,
+        OpModel::CreateEstimator(op_model_proto.estimator(), data_points));
+    estimator->op_models_[op] = std::move(op_model);
+  }
+
+  // Reject aliases of ops without a model and cycles of aliases.
+  for (const auto& [op, op_model] : estimator->op_models_) {
+    Op aliased = op;
+    for (int64_t i = 0; estimator->op_models_.at(aliased)->estimator.alias_op;
+         ++i) {
+      aliased = *estimator->op_models_.at(aliased)->estimator.alias_op;
+      if (!estimator->op_models_.contains(aliased)) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Model of %s aliases %s which has no model",
+                            OpToString(op), OpToString(aliased)));
+      }
+      if (i > estimator->op_models_.size()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Model of %s is part of a cycle of aliases", OpToString(op)));
+      }
+    }
+  }
+  return std::move(estimator);
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<TableDelayEstimator>>
+TableDelayEstimator::CreateFromFile(const std::filesystem::path& path) {
+  delay_model::DelayModel model;
+  XLS_RETURN_IF_ERROR(ParseTextProtoFile(path, &model));
+  return Create(model);
+}
+
+absl::StatusOr<int64_t> TableDelayEstimator::GetOperationDelayInPs(
+    Node* node) const {
+  XLS_ASSIGN_OR_RETURN(int64_t delay, GetDelayWithModel(node->op(), node));
+  return std::max<int64_t>(0, delay);
+}
+
+absl::StatusOr<int64_t> TableDelayEstimator::GetDelayWithModel(
+    Op op, Node* node) const {
+  auto it = op_models_.find(op);
+  if (it == op_models_.end()) {
+    return absl::UnimplementedError("Unhandled node for delay estimation: " +
+                                    node->ToStringWithOperandTypes());
+  }
+  const OpModel& op_model = *it->second;
+  const OpModel::Estimator* estimator = &op_model.estimator;
+  for (const auto& [kind, special_estimator] : op_model.specializations) {
+    bool applies =
+        kind == delay_model::OPERANDS_IDENTICAL
+            ? std::all_of(node->operands().begin(), node->operands().end(),
+                          [&](Node* n) { return n == node->operand(0); })
+            : std::any_of(node->operands().begin(), node->operands().end(),
+                          [](Node* n) { return n->Is<Literal>(); });
+    if (applies) {
+      estimator = &special_estimator;
+      break;
+    }
+  }
+
+  if (estimator->fixed.has_value()) {
+    return *estimator->fixed;
+  }
+  if (estimator->alias_op.has_value()) {
+    return GetDelayWithModel(*estimator->alias_op, node);
+  }
+  if (estimator->logical_effort_tau_in_ps.has_value()) {
+    return GetLogicalEffortDelayInPs(node,
+                                     *estimator->logical_effort_tau_in_ps);
+  }
+  if (estimator->table.has_value()) {
+    const Table& table = *estimator->table;
+    int64_t x[2];
+    for (int64_t i = 0; i < table.factors.size(); ++i) {
+      XLS_ASSIGN_OR_RETURN(x[i], NodeDelayFactor(table.factors[i], node));
+    }
+    return static_cast<int64_t>(
+        std::round(table.Interpolate(absl::MakeSpan(x, table.factors.size()))));
+  }
+  XLS_RET_CHECK(estimator->bounding_box.has_value());
+  const BoundingBox& box = *estimator->bounding_box;
+  std::vector<int64_t> x;
+  for (const delay_model::DelayFactor& factor : box.factors) {
+    XLS_ASSIGN_OR_RETURN(int64_t value, NodeDelayFactor(factor, node));
+    x.push_back(value);
+  }
+  for (const auto& [corner, delay] : box.boxes) {
+    if (std::equal(x.begin(), x.end(), corner.begin(),
+                   [](int64_t a, int64_t b) { return a <= b; })) {
+      return delay;
+    }
+  }
+  return absl::UnimplementedError("Unhandled node for delay estimation: " +
+                                  node->ToStringWithOperandTypes());
+}
+
+absl::StatusOr<DelayEstimator*> LoadDelayModelFile(
+    const std::filesystem::path& path) {
+  DelayEstimatorManager& manager = GetDelayEstimatorManagerSingleton();
+  absl::StatusOr<DelayEstimator*> existing =
+      manager.GetDelayEstimator(path.string());
+  if (existing.ok()) {
+    return existing;
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TableDelayEstimator> estimator,
+                       TableDelayEstimator::CreateFromFile(path));
+  XLS_RETURN_IF_ERROR(manager.RegisterDelayEstimator(
+      path.string(),
+      std::make_unique<CachingDelayEstimator>(std::move(estimator)),
+      DelayEstimatorPrecedence::kLow));
+  return manager.GetDelayEstimator(path.string());
+}
+
+}  // namespace xls
@@ -0,0 +1,79 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DELAY_MODEL_TABLE_DELAY_ESTIMATOR_H_
+#define XLS_DELAY_MODEL_TABLE_DELAY_ESTIMATOR_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+
+namespace xls {
+
+// A delay estimator which evaluates a DelayModel proto at runtime, so a delay
+// model can be swapped without recompiling. Supports the fixed, alias,
+// bounding box, logical effort and table estimators (see delay_model.proto).
+// Regression estimators require curve fitting and are only supported in
+// generated delay models.
+//
+// Table lookups take constant time: the grid segment containing a factor value
+// is found with a dense index over the range of each axis, built on creation.
+class TableDelayEstimator : public DelayEstimator {
+ public:
+  // Creates an estimator from the given model. Returns an error if the model
+  // is malformed or uses an unsupported estimator.
+  static absl::StatusOr<std::unique_ptr<TableDelayEstimator>> Create(
+      const delay_model::DelayModel& model);
+
+  // Creates an estimator from a file containing a DelayModel text proto.
+  static absl::StatusOr<std::unique_ptr<TableDelayEstimator>> CreateFromFile(
+      const std::filesystem::path& path);
+
+  ~TableDelayEstimator() override;
+
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override;
+
+ private:
+  struct OpModel;
+
+  TableDelayEstimator() = default;
+
+  // Returns the delay of the node under the model of the given op, which
+  // differs from the node's op if the model of the node's op is an alias.
+  absl::StatusOr<int64_t> GetDelayWithModel(Op op, Node* node) const;
+
+  absl::flat_hash_map<Op, std::unique_ptr<OpModel>> op_models_;
+};
+
+// Returns the op named as in a delay model (e.g., "kAdd" or "kSMul").
+absl::StatusOr<Op> DelayModelOpToOp(absl::string_view name);
+
+// Loads the delay model in the given text proto file and registers it with
+// the delay estimator manager under the name of the file, wrapped in a
+// CachingDelayEstimator. Returns the registered estimator. Loading the same
+// file again returns the existing estimator.
+absl::StatusOr<DelayEstimator*> LoadDelayModelFile(
+    const std::filesystem::path& path);
+
+}  // namespace xls
+
+#endif  // XLS_DELAY_MODEL_TABLE_DELAY_ESTIMATOR_H_
@@ -0,0 +1,248 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/table_delay_estimator.h"
+
+#include <memory>
+#include <string>
+
+#include "google/protobuf/text_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+class TableDelayEstimatorTest : public IrTestBase {
+ protected:
+  absl::StatusOr<std::unique_ptr<TableDelayEstimator>> CreateEstimator(
+      const std::string& model_text) {
+    delay_model::DelayModel model;
+    XLS_RET_CHECK(
+        google::protobuf::TextFormat::ParseFromString(model_text, &model));
+    return TableDelayEstimator::Create(model);
+  }
+};
+
+TEST_F(TableDelayEstimatorTest, InterpolatesTable) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TableDelayEstimator> estimator,
+                           CreateEstimator(R"(
+op_models {
+  op: "kAdd"
+  estimator {
+    table {
+      factors { source: RESULT_BIT_COUNT }
+      factors { source: OPERAND_COUNT }
+      axes { values: [8, 16, 32] }
+      axes { values: [2, 4] }
+      delays: [100, 120, 150, 180, 200, 240]
+    }
+  }
+}
+op_models {
+  op: "kSub"
+  estimator { alias_op: "kAdd" }
+}
+op_models {
+  op: "kParam"
+  estimator { fixed: 0 }
+}
+)"));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  auto x8 = fb.Param("x8", p->GetBitsType(8));
+  auto x24 = fb.Param("x24", p->GetBitsType(24));
+  auto x64 = fb.Param("x64", p->GetBitsType(64));
+  auto x4 = fb.Param("x4", p->GetBitsType(4));
+  auto add8 = fb.Add(x8, x8);
+  auto add24 = fb.Add(x24, x24);
+  auto sub24 = fb.Subtract(x24, x24);
+  auto add64 = fb.Add(x64, x64);
+  auto add4 = fb.Add(x4, x4);
+  auto neg = fb.Negate(x8);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  EXPECT_THAT(estimator->GetOperationDelayInPs(x8.node()), IsOkAndHolds(0));
+  // Grid point.
+  EXPECT_THAT(estimator->GetOperationDelayInPs(add8.node()),
+              IsOkAndHolds(100));
+  // Between grid points along the first axis.
+  EXPECT_THAT(estimator->GetOperationDelayInPs(add24.node()),
+              IsOkAndHolds(175));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(sub24.node()),
+              IsOkAndHolds(175));
+  // Extrapolated beyond either end of the axis.
+  EXPECT_THAT(estimator->GetOperationDelayInPs(add64.node()),
+              IsOkAndHolds(300));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(add4.node()), IsOkAndHolds(75));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(neg.node()),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("Unhandled node")));
+}
+
+TEST_F(TableDelayEstimatorTest, BilinearInterpolation) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TableDelayEstimator> estimator,
+                           CreateEstimator(R"(
+op_models {
+  op: "kConcat"
+  estimator {
+    table {
+      factors { source: RESULT_BIT_COUNT }
+      factors { source: OPERAND_COUNT }
+      axes { values: [8, 16, 32] }
+      axes { values: [2, 4] }
+      delays: [100, 120, 150, 180, 200, 240]
+    }
+  }
+}
+)"));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  auto x = fb.Param("x", p->GetBitsType(8));
+  auto concat = fb.Concat({x, x, x});
+  XLS_ASSERT_OK(fb.Build().status());
+
+  // Midway between (16, 2), (16, 4), (32, 2) and (32, 4).
+  EXPECT_THAT(estimator->GetOperationDelayInPs(concat.node()),
+              IsOkAndHolds(193));
+}
+
+TEST_F(TableDelayEstimatorTest, TableFromDataPoints) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TableDelayEstimator> estimator,
+                           CreateEstimator(R"(
+op_models {
+  op: "kUMul"
+  estimator {
+    table {
+      factors { source: RESULT_BIT_COUNT }
+      axes { values: [8, 16] }
+    }
+  }
+  specializations {
+    kind: OPERANDS_IDENTICAL
+    estimator { fixed: 42 }
+  }
+}
+data_points {
+  operation {
+    op: "kUMul"
+    bit_count: 8
+    operands { bit_count: 8 }
+    operands { bit_count: 8 }
+  }
+  delay: 220
+  delay_offset: 20
+}
+data_points {
+  operation {
+    op: "kUMul"
+    bit_count: 12
+    operands { bit_count: 12 }
+    operands { bit_count: 12 }
+  }
+  delay: 1000
+}
+data_points {
+  operation {
+    op: "kUMul"
+    bit_count: 16
+    operands { bit_count: 16 }
+    operands { bit_count: 16 }
+  }
+  delay: 400
+}
+)"));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  auto x = fb.Param("x", p->GetBitsType(12));
+  auto y = fb.Param("y", p->GetBitsType(12));
+  auto mul = fb.UMul(x, y);
+  auto square = fb.UMul(x, x);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  // The off-grid data point for 12 bits is ignored.
+  EXPECT_THAT(estimator->GetOperationDelayInPs(mul.node()), IsOkAndHolds(300));
+  EXPECT_THAT(estimator->GetOperationDelayInPs(square.node()),
+              IsOkAndHolds(42));
+}
+
+TEST_F(TableDelayEstimatorTest, MalformedModels) {
+  EXPECT_THAT(CreateEstimator(R"(
+op_models {
+  op: "kAdd"
+  estimator {
+    table {
+      factors { source: RESULT_BIT_COUNT }
+      axes { values: [8, 4] }
+      delays: [1, 2]
+    }
+  }
+}
+)")
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("strictly increasing")));
+  EXPECT_THAT(CreateEstimator(R"(
+op_models {
+  op: "kAdd"
+  estimator {
+    table {
+      factors { source: RESULT_BIT_COUNT }
+      axes { values: [8, 16] }
+    }
+  }
+}
+)")
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("no data point")));
+  EXPECT_THAT(CreateEstimator(R"(
+op_models {
+  op: "kAdd"
+  estimator { alias_op: "kSub" }
+}
+op_models {
+  op: "kSub"
+  estimator { alias_op: "kAdd" }
+}
+)")
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("cycle of aliases")));
+  EXPECT_THAT(CreateEstimator(R"(
+op_models {
+  op: "kFrobnicate"
+  estimator { fixed: 1 }
+}
+)")
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown op")));
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,296 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/timing_analysis.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+
+/* static */ absl::StatusOr<std::unique_ptr<TimingAnalysis>>
+TimingAnalysis::Create(FunctionBase* f, int64_t clock_period_ps,
+                       const DelayEstimator& delay_estimator,
+                       const absl::flat_hash_map<Node*, int64_t>& cycles) {
+  XLS_RET_CHECK_GT(clock_period_ps, 0);
+  auto analysis = absl::WrapUnique(
+      new TimingAnalysis(f, clock_period_ps, delay_estimator));
+  for (Node* node : f->nodes()) {
+    NodeTiming timing;
+    auto it = cycles.find(node);
+    if (it != cycles.end()) {
+      timing.cycle = it->second;
+    }
+    XLS_ASSIGN_OR_RETURN(timing.delay_ps,
+                         delay_estimator.GetOperationDelayInPs(node));
+    timing.required_ps = clock_period_ps;
+    analysis->SetTiming(node, timing);
+  }
+  for (Node* node : TopoSort(f)) {
+    analysis->RecomputeArrival(node);
+  }
+  for (Node* node : ReverseTopoSort(f)) {
+    analysis->RecomputeRequired(node);
+  }
+  return std::move(analysis);
+}
+
+void TimingAnalysis::SetCycle(Node* node, int64_t cycle) {
+  auto it = timing_.find(node);
+  if (it == timing_.end()) {
+    cycle_changes_[node] = cycle;
+  } else {
+    it->second.cycle = cycle;
+  }
+  changed_nodes_.insert(node);
+}
+
+void TimingAnalysis::NodeChanged(Node* node) { changed_nodes_.insert(node); }
+
+void TimingAnalysis::NodeRemoved(Node* node) {
+  changed_nodes_.erase(node);
+  cycle_changes_.erase(node);
+  removed_operands_.erase(node);
+  for (Node* operand : node->operands()) {
+    removed_operands_.insert(operand);
+  }
+  auto it = timing_.find(node);
+  if (it != timing_.end()) {
+    const NodeTiming& timing = it->second;
+    arrivals_.erase(arrivals_.find(timing.arrival_ps));
+    slacks_.erase(slacks_.find(timing.required_ps - timing.arrival_ps));
+    timing_.erase(it);
+  }
+}
+
+absl::Status TimingAnalysis::Update() {
+  // Add the new nodes, operands first, as a new node is placed in the latest
+  // cycle of its operands by default. Delays are estimated below.
+  std::vector<Node*> stack;
+  for (Node* node : changed_nodes_) {
+    stack.push_back(node);
+    while (!stack.empty()) {
+      Node* current = stack.back();
+      if (timing_.contains(current)) {
+        stack.pop_back();
+        continue;
+      }
+      bool operands_known = true;
+      for (Node* operand : current->operands()) {
+        if (!timing_.contains(operand)) {
+          XLS_RET_CHECK(changed_nodes_.contains(operand))
+              << "Operand " << operand->GetName() << " of "
+              << current->GetName() << " is unknown to the timing analysis";
+          stack.push_back(operand);
+          operands_known = false;
+        }
+      }
+      if (!operands_known) {
+        continue;
+      }
+      NodeTiming timing;
+      auto it = cycle_changes_.find(current);
+      if (it != cycle_changes_.end()) {
+        timing.cycle = it->second;
+      } else {
+        for (Node* operand : current->operands()) {
+          timing.cycle = std::max(timing.cycle, timing_.at(operand).cycle);
+        }
+      }
+      timing.required_ps = clock_period_ps_;
+      SetTiming(current, timing);
+      stack.pop_back();
+    }
+  }
+  for (Node* node : changed_nodes_) {
+    NodeTiming timing = timing_.at(node);
+    XLS_ASSIGN_OR_RETURN(timing.delay_ps,
+                         delay_estimator_->GetOperationDelayInPs(node));
+    SetTiming(node, timing);
+  }
+
+  // Recompute arrival times in topological order. A changed node invalidates
+  // all of its users as its cycle or delay may have changed; other nodes only
+  // invalidate their users in the same cycle, and only if their own arrival
+  // time changed.
+  absl::flat_hash_set<Node*> stale;
+  for (Node* node : Cone(changed_nodes_, /*toward_users=*/true)) {
+    bool changed_node = changed_nodes_.contains(node);
+    if (!changed_node && !stale.contains(node)) {
+      continue;
+    }
+    bool changed_arrival = RecomputeArrival(node);
+    for (Node* user : node->users()) {
+      if (changed_node || (changed_arrival && cycle(user) == cycle(node))) {
+        stale.insert(user);
+      }
+    }
+  }
+
+  // Likewise recompute required times, users first. The operands of removed
+  // nodes have lost a user.
+  absl::flat_hash_set<Node*> seeds = changed_nodes_;
+  seeds.insert(removed_operands_.begin(), removed_operands_.end());
+  stale.clear();
+  for (Node* node : Cone(seeds, /*toward_users=*/false)) {
+    bool seed = seeds.contains(node);
+    if (!seed && !stale.contains(node)) {
+      continue;
+    }
+    bool changed_required = RecomputeRequired(node);
+    for (Node* operand : node->operands()) {
+      if (seed || (changed_required && cycle(operand) == cycle(node))) {
+        stale.insert(operand);
+      }
+    }
+  }
+
+  XLS_VLOG(3) << "Updated timing analysis of " << changed_nodes_.size()
+              << " changed nodes; critical path delay "
+              << critical_path_delay_ps() << "ps";
+  changed_nodes_.clear();
+  cycle_changes_.clear();
+  removed_operands_.clear();
+  return absl::OkStatus();
+}
+
+int64_t TimingAnalysis::critical_path_delay_ps() const {
+  return arrivals_.empty() ? 0 : *arrivals_.rbegin();
+}
+
+int64_t TimingAnalysis::worst_slack_ps() const {
+  return slacks_.empty() ? clock_period_ps_ : *slacks_.begin();
+}
+
+std::vector<CriticalPathEntry> TimingAnalysis::CriticalPath() const {
+  // Iterate over the function's nodes rather than the map for a deterministic
+  // choice among paths of equal delay.
+  Node* node = nullptr;
+  for (Node* candidate : f_->nodes()) {
+    if (node == nullptr || arrival_ps(candidate) > arrival_ps(node)) {
+      node = candidate;
+    }
+  }
+  std::vector<CriticalPathEntry> path;
+  while (node != nullptr) {
+    Node* predecessor = nullptr;
+    bool delayed_by_cycle_boundary = false;
+    for (Node* operand : node->operands()) {
+      if (cycle(operand) == cycle(node)) {
+        if (predecessor == nullptr ||
+            arrival_ps(operand) > arrival_ps(predecessor)) {
+          predecessor = operand;
+        }
+      } else if (cycle(operand) < cycle(node)) {
+        delayed_by_cycle_boundary = true;
+      }
+    }
+    path.push_back(
+        CriticalPathEntry{node, delay_ps(node), arrival_ps(node),
+                          predecessor == nullptr && delayed_by_cycle_boundary});
+    node = predecessor;
+  }
+  return path;
+}
+
+std::vector<Node*> TimingAnalysis::Cone(const absl::flat_hash_set<Node*>& nodes,
+                                        bool toward_users) const {
+  auto successors = [&](Node* node) {
+    return toward_users ? node->users() : node->operands();
+  };
+  // Iterative depth-first search; the reverse postorder is a topological order
+  // of the edges followed, which include every same-cycle edge in the cone.
+  std::vector<Node*> postorder;
+  absl::flat_hash_set<Node*> visited;
+  std::vector<std::pair<Node*, int64_t>> stack;
+  for (Node* root : nodes) {
+    if (!visited.insert(root).second) {
+      continue;
+    }
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+      Node* node = stack.back().first;
+      absl::Span<Node* const> next_nodes = successors(node);
+      int64_t& next_index = stack.back().second;
+      if (next_index == next_nodes.size()) {
+        postorder.push_back(node);
+        stack.pop_back();
+        continue;
+      }
+      Node* next = next_nodes[next_index++];
+      if ((nodes.contains(node) || cycle(next) == cycle(node)) &&
+          visited.insert(next).second) {
+        stack.push_back({next, 0});
+      }
+    }
+  }
+  std::reverse(postorder.begin(), postorder.end());
+  return postorder;
+}
+
+bool TimingAnalysis::RecomputeArrival(Node* node) {
+  NodeTiming timing = timing_.at(node);
+  int64_t start_ps = 0;
+  for (Node* operand : node->operands()) {
+    const NodeTiming& operand_timing = timing_.at(operand);
+    if (operand_timing.cycle == timing.cycle) {
+      start_ps = std::max(start_ps, operand_timing.arrival_ps);
+    }
+  }
+  if (start_ps + timing.delay_ps == timing.arrival_ps) {
+    return false;
+  }
+  timing.arrival_ps = start_ps + timing.delay_ps;
+  SetTiming(node, timing);
+  return true;
+}
+
+bool TimingAnalysis::RecomputeRequired(Node* node) {
+  NodeTiming timing = timing_.at(node);
+  int64_t required_ps = clock_period_ps_;
+  for (Node* user : node->users()) {
+    const NodeTiming& user_timing = timing_.at(user);
+    if (user_timing.cycle == timing.cycle) {
+      required_ps =
+          std::min(required_ps, user_timing.required_ps - user_timing.delay_ps);
+    }
+  }
+  if (required_ps == timing.required_ps) {
+    return false;
+  }
+  timing.required_ps = required_ps;
+  SetTiming(node, timing);
+  return true;
+}
+
+void TimingAnalysis::SetTiming(Node* node, const NodeTiming& timing) {
+  auto it = timing_.find(node);
+  if (it != timing_.end()) {
+    arrivals_.erase(arrivals_.find(it->second.arrival_ps));
+    slacks_.erase(
+        slacks_.find(it->second.required_ps - it->second.arrival_ps));
+  }
+  arrivals_.insert(timing.arrival_ps);
+  slacks_.insert(timing.required_ps - timing.arrival_ps);
+  timing_[node] = timing;
+}
+
+}  // namespace xls
@@ -0,0 +1,155 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DELAY_MODEL_TIMING_ANALYSIS_H_
+#define XLS_DELAY_MODEL_TIMING_ANALYSIS_H_
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/delay_model/analyze_critical_path.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+
+// Static timing analysis of a function whose nodes are assigned to cycles (for
+// example, by a pipeline schedule), which is updated incrementally as nodes are
+// moved between cycles, added, replaced or removed.
+//
+// Values cross cycle boundaries through registers, so a path only extends
+// through nodes in the same cycle:
+//
+//   arrival(n)  = delay(n) + max(0, arrival(o) for operands o in n's cycle)
+//   required(n) = min(clock period,
+//                     required(u) - delay(u) for users u in n's cycle)
+//
+// The slack of a node, required minus arrival, is negative if some path through
+// the node exceeds the clock period.
+//
+// Changes are recorded with SetCycle, NodeChanged and NodeRemoved and applied
+// by Update, which only revisits the nodes reachable from the changed nodes
+// without crossing a cycle boundary. Queries reflect the last call to Update.
+class TimingAnalysis {
+ public:
+  // Creates an analysis of the given function. Nodes are in the cycles given
+  // by 'cycles', or cycle zero if they are not present in the map. The
+  // estimator must outlive the analysis.
+  static absl::StatusOr<std::unique_ptr<TimingAnalysis>> Create(
+      FunctionBase* f, int64_t clock_period_ps,
+      const DelayEstimator& delay_estimator,
+      const absl::flat_hash_map<Node*, int64_t>& cycles = {});
+
+  // Moves the node to the given cycle.
+  void SetCycle(Node* node, int64_t cycle);
+
+  // Records that the node was added to the function or that its operands, its
+  // users or its delay may have changed. Nodes added to the function are placed
+  // in the latest cycle of their operands unless SetCycle is called. For
+  // example, after 'a->ReplaceUsesWith(b)', call NodeChanged for 'a' and 'b'.
+  void NodeChanged(Node* node);
+
+  // Records that the node is about to be removed from the function. Must be
+  // called before the node is removed and Update after.
+  void NodeRemoved(Node* node);
+
+  // Applies the recorded changes.
+  absl::Status Update();
+
+  int64_t cycle(Node* node) const { return timing_.at(node).cycle; }
+  int64_t delay_ps(Node* node) const { return timing_.at(node).delay_ps; }
+
+  // Returns the delay from the start of the node's cycle through the node.
+  int64_t arrival_ps(Node* node) const { return timing_.at(node).arrival_ps; }
+
+  // Returns the latest time relative to the start of the node's cycle at which
+  // the node may produce its value without a path exceeding the clock period.
+  int64_t required_ps(Node* node) const {
+    return timing_.at(node).required_ps;
+  }
+
+  int64_t slack_ps(Node* node) const {
+    return required_ps(node) - arrival_ps(node);
+  }
+
+  // Returns the longest path delay in any cycle.
+  int64_t critical_path_delay_ps() const;
+
+  // Returns the least slack of any node, or the clock period if the function
+  // is empty.
+  int64_t worst_slack_ps() const;
+
+  // Returns the longest path, with the node producing its end at the front.
+  // 'delayed_by_cycle_boundary' is set for the node starting the path if it
+  // has an operand in an earlier cycle.
+  std::vector<CriticalPathEntry> CriticalPath() const;
+
+ private:
+  struct NodeTiming {
+    int64_t cycle = 0;
+    int64_t delay_ps = 0;
+    int64_t arrival_ps = 0;
+    int64_t required_ps = 0;
+  };
+
+  TimingAnalysis(FunctionBase* f, int64_t clock_period_ps,
+                 const DelayEstimator& delay_estimator)
+      : f_(f),
+        clock_period_ps_(clock_period_ps),
+        delay_estimator_(&delay_estimator) {}
+
+  // Returns the nodes reachable from the given nodes in topological order
+  // (successors first if 'toward_users' is false). The first step from each of
+  // the given nodes follows all edges, and later steps only follow edges within
+  // a cycle.
+  std::vector<Node*> Cone(const absl::flat_hash_set<Node*>& nodes,
+                          bool toward_users) const;
+
+  // Recomputes the arrival and required time of the node from its operands and
+  // users respectively. Returns whether the value changed.
+  bool RecomputeArrival(Node* node);
+  bool RecomputeRequired(Node* node);
+
+  // Sets the timing of the node, maintaining the sets of arrival and slack
+  // values.
+  void SetTiming(Node* node, const NodeTiming& timing);
+
+  FunctionBase* f_;
+  int64_t clock_period_ps_;
+  const DelayEstimator* delay_estimator_;
+
+  absl::flat_hash_map<Node*, NodeTiming> timing_;
+
+  // The arrival and slack of every node, for finding the extreme values.
+  std::multiset<int64_t> arrivals_;
+  std::multiset<int64_t> slacks_;
+
+  // The changes recorded since the last update. 'cycle_changes_' holds the
+  // nodes moved by SetCycle which are not in 'timing_', and 'removed_operands_'
+  // the operands of removed nodes, whose required times may have changed.
+  absl::flat_hash_set<Node*> changed_nodes_;
+  absl::flat_hash_map<Node*, int64_t> cycle_changes_;
+  absl::flat_hash_set<Node*> removed_operands_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_DELAY_MODEL_TIMING_ANALYSIS_H_
@@ -0,0 +1,221 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/timing_analysis.h"
+
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/node.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/op.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+class TestDelayEstimator : public DelayEstimator {
+ public:
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override {
+    switch (node->op()) {
+      case Op::kParam:
+      case Op::kLiteral:
+        return 0;
+      case Op::kAdd:
+        return 3;
+      default:
+        return 1;
+    }
+  }
+};
+
+class TimingAnalysisTest : public IrTestBase {
+ protected:
+  // Verifies the incrementally updated analysis matches one created from
+  // scratch with the same cycles.
+  void ExpectMatchesNewAnalysis(const TimingAnalysis& analysis, Function* f,
+                                int64_t clock_period_ps) {
+    absl::flat_hash_map<Node*, int64_t> cycles;
+    for (Node* node : f->nodes()) {
+      cycles[node] = analysis.cycle(node);
+    }
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<TimingAnalysis> expected,
+        TimingAnalysis::Create(f, clock_period_ps, delay_estimator_, cycles));
+    for (Node* node : f->nodes()) {
+      EXPECT_EQ(analysis.delay_ps(node), expected->delay_ps(node)) << node;
+      EXPECT_EQ(analysis.arrival_ps(node), expected->arrival_ps(node)) << node;
+      EXPECT_EQ(analysis.required_ps(node), expected->required_ps(node))
+          << node;
+    }
+    EXPECT_EQ(analysis.critical_path_delay_ps(),
+              expected->critical_path_delay_ps());
+    EXPECT_EQ(analysis.worst_slack_ps(), expected->worst_slack_ps());
+  }
+
+  TestDelayEstimator delay_estimator_;
+};
+
+TEST_F(TimingAnalysisTest, SingleCycle) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(32));
+  BValue sum = fb.Add(x, y);
+  BValue neg = fb.Negate(sum);
+  BValue result = fb.And(neg, fb.Not(x));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TimingAnalysis> analysis,
+                           TimingAnalysis::Create(f, 6, delay_estimator_));
+  EXPECT_EQ(analysis->arrival_ps(sum.node()), 3);
+  EXPECT_EQ(analysis->arrival_ps(neg.node()), 4);
+  EXPECT_EQ(analysis->arrival_ps(result.node()), 5);
+  EXPECT_EQ(analysis->required_ps(result.node()), 6);
+  EXPECT_EQ(analysis->required_ps(neg.node()), 5);
+  EXPECT_EQ(analysis->required_ps(x.node()), 1);
+  EXPECT_EQ(analysis->slack_ps(sum.node()), 1);
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 5);
+  EXPECT_EQ(analysis->worst_slack_ps(), 1);
+
+  std::vector<CriticalPathEntry> path = analysis->CriticalPath();
+  ASSERT_EQ(path.size(), 4);
+  EXPECT_EQ(path[0].node, result.node());
+  EXPECT_EQ(path[0].path_delay_ps, 5);
+  EXPECT_EQ(path[1].node, neg.node());
+  EXPECT_EQ(path[2].node, sum.node());
+  EXPECT_EQ(path[2].node_delay_ps, 3);
+  EXPECT_EQ(path[3].node->op(), Op::kParam);
+  EXPECT_FALSE(path[3].delayed_by_cycle_boundary);
+}
+
+TEST_F(TimingAnalysisTest, MoveNodeToLaterCycle) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue sum = fb.Add(x, x);
+  BValue neg = fb.Negate(sum);
+  BValue result = fb.Add(neg, sum);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TimingAnalysis> analysis,
+                           TimingAnalysis::Create(f, 5, delay_estimator_));
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 7);
+  EXPECT_EQ(analysis->worst_slack_ps(), -2);
+
+  // Registering the negation splits the path.
+  analysis->SetCycle(neg.node(), 1);
+  analysis->SetCycle(result.node(), 1);
+  XLS_ASSERT_OK(analysis->Update());
+  EXPECT_EQ(analysis->arrival_ps(neg.node()), 1);
+  EXPECT_EQ(analysis->arrival_ps(result.node()), 4);
+  EXPECT_EQ(analysis->required_ps(sum.node()), 5);
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 4);
+  EXPECT_EQ(analysis->worst_slack_ps(), 1);
+  ExpectMatchesNewAnalysis(*analysis, f, 5);
+
+  std::vector<CriticalPathEntry> path = analysis->CriticalPath();
+  ASSERT_EQ(path.size(), 2);
+  EXPECT_EQ(path[0].node, result.node());
+  EXPECT_EQ(path[1].node, neg.node());
+  EXPECT_TRUE(path[1].delayed_by_cycle_boundary);
+
+  analysis->SetCycle(neg.node(), 0);
+  XLS_ASSERT_OK(analysis->Update());
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 4);
+  EXPECT_EQ(analysis->arrival_ps(result.node()), 3);
+  ExpectMatchesNewAnalysis(*analysis, f, 5);
+}
+
+TEST_F(TimingAnalysisTest, ReplaceNode) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue sum = fb.Add(x, x);
+  BValue neg = fb.Negate(sum);
+  fb.Not(neg);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TimingAnalysis> analysis,
+                           TimingAnalysis::Create(f, 10, delay_estimator_));
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 5);
+
+  // Replace the add with a cheaper not, then remove the add.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * not_x, f->MakeNode<UnOp>(absl::nullopt, x.node(), Op::kNot));
+  XLS_ASSERT_OK(sum.node()->ReplaceUsesWith(not_x));
+  analysis->NodeChanged(not_x);
+  analysis->NodeChanged(sum.node());
+  analysis->NodeRemoved(sum.node());
+  XLS_ASSERT_OK(f->RemoveNode(sum.node()));
+  XLS_ASSERT_OK(analysis->Update());
+  EXPECT_EQ(analysis->cycle(not_x), 0);
+  EXPECT_EQ(analysis->arrival_ps(not_x), 1);
+  EXPECT_EQ(analysis->required_ps(x.node()), 7);
+  EXPECT_EQ(analysis->critical_path_delay_ps(), 3);
+  ExpectMatchesNewAnalysis(*analysis, f, 10);
+}
+
+TEST_F(TimingAnalysisTest, RandomMovesMatchNewAnalysis) {
+  constexpr int64_t kClockPeriodPs = 6;
+  constexpr int64_t kCycles = 4;
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  std::mt19937 gen;
+  std::vector<BValue> values = {fb.Param("x", p->GetBitsType(8)),
+                                fb.Param("y", p->GetBitsType(8))};
+  for (int64_t i = 0; i < 60; ++i) {
+    std::uniform_int_distribution<int64_t> value_dis(0, values.size() - 1);
+    BValue a = values[value_dis(gen)];
+    BValue b = values[value_dis(gen)];
+    switch (i % 3) {
+      case 0:
+        values.push_back(fb.Add(a, b));
+        break;
+      case 1:
+        values.push_back(fb.And(a, b));
+        break;
+      default:
+        values.push_back(fb.Not(a));
+        break;
+    }
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f,
+                           fb.BuildWithReturnValue(values.back()));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TimingAnalysis> analysis,
+      TimingAnalysis::Create(f, kClockPeriodPs, delay_estimator_));
+  std::vector<Node*> nodes(f->nodes().begin(), f->nodes().end());
+  std::uniform_int_distribution<int64_t> node_dis(0, nodes.size() - 1);
+  std::uniform_int_distribution<int64_t> cycle_dis(0, kCycles - 1);
+  for (int64_t trial = 0; trial < 50; ++trial) {
+    for (int64_t i = 0; i < 1 + trial % 4; ++i) {
+      analysis->SetCycle(nodes[node_dis(gen)], cycle_dis(gen));
+    }
+    XLS_ASSERT_OK(analysis->Update());
+    ExpectMatchesNewAnalysis(*analysis, f, kClockPeriodPs);
+  }
+}
+
+}  // namespace
+}  // namespace xls
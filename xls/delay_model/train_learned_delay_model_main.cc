@@ -0,0 +1,67 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Trains a learned delay model (see learned_delay_estimator.h) from the data
+// points of a characterized DelayModel text proto, and writes the model as a
+// text proto. Give the output a ".learned.textproto" suffix to select it with
+// --delay_model in the scheduling tools.
+
+#include <filesystem>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/delay_model/learned_delay_estimator.h"
+
+ABSL_FLAG(std::string, characterization, "",
+          "Path of the DelayModel text proto whose data points to train on.");
+ABSL_FLAG(std::string, output_path, "",
+          "Path to write the LearnedDelayModel text proto to.");
+ABSL_FLAG(double, l2_regularization, 1e-3,
+          "Strength of the ridge regularization of the model weights.");
+ABSL_FLAG(int64_t, min_data_points_per_op, 4,
+          "Ops with fewer data points than this use the fallback model.");
+
+namespace xls {
+
+absl::Status RealMain(const std::filesystem::path& characterization_path,
+                      const std::filesystem::path& output_path) {
+  delay_model::DelayModel characterization;
+  XLS_RETURN_IF_ERROR(
+      ParseTextProtoFile(characterization_path, &characterization));
+  LearnedDelayTrainingOptions options;
+  options.l2_regularization = absl::GetFlag(FLAGS_l2_regularization);
+  options.min_data_points_per_op = absl::GetFlag(FLAGS_min_data_points_per_op);
+  XLS_ASSIGN_OR_RETURN(delay_model::LearnedDelayModel model,
+                       TrainLearnedDelayModel(characterization, options));
+  return SetTextProtoFile(output_path, model);
+}
+
+}  // namespace xls
+
+int main(int argc, char* argv[]) {
+  xls::InitXls(argv[0], argc, argv);
+  XLS_QCHECK(!absl::GetFlag(FLAGS_characterization).empty())
+      << "--characterization is required";
+  XLS_QCHECK(!absl::GetFlag(FLAGS_output_path).empty())
+      << "--output_path is required";
+  XLS_QCHECK_OK(xls::RealMain(absl::GetFlag(FLAGS_characterization),
+                              absl::GetFlag(FLAGS_output_path)));
+  return 0;
+}
@@ -14,6 +14,10 @@
 
 #include "xls/dslx/ast.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 #include "absl/status/statusor.h"
 #include "absl/strings/strip.h"
 #include "xls/common/indent.h"
@@ -427,6 +431,41 @@ Param::Param(Module* owner, NameDef* name_def, TypeAnnotation* type)
 
 // -- class Module
 
+// Size of the blocks a module's AST nodes are allocated from; larger nodes get
+// a block of their own.
+constexpr size_t kArenaBlockSize = 64 * 1024;
+
+Module::~Module() {
+  XLS_VLOG(3) << "Destroying module \"" << name_ << "\" @ " << this;
+  // Nodes may refer to the nodes made before them, so destroy them in reverse;
+  // their storage is released along with the arena blocks.
+  absl::MutexLock lock(&nodes_mutex_);
+  for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
+    (*it)->~AstNode();
+  }
+}
+
+void* Module::AllocateNode(size_t size, size_t alignment) {
+  XLS_CHECK_LE(alignment, alignof(std::max_align_t));
+  size_t padding =
+      (alignment - reinterpret_cast<uintptr_t>(arena_next_) % alignment) %
+      alignment;
+  if (arena_next_ == nullptr || padding + size > arena_remaining_) {
+    if (size > kArenaBlockSize / 4) {
+      arena_blocks_.push_back(std::unique_ptr<char[]>(new char[size]));
+      return arena_blocks_.back().get();
+    }
+    arena_blocks_.push_back(std::unique_ptr<char[]>(new char[kArenaBlockSize]));
+    arena_next_ = arena_blocks_.back().get();
+    arena_remaining_ = kArenaBlockSize;
+    padding = 0;
+  }
+  void* storage = arena_next_ + padding;
+  arena_next_ += padding + size;
+  arena_remaining_ -= padding + size;
+  return storage;
+}
+
 absl::optional<Function*> Module::GetFunction(absl::string_view target_name) {
   for (ModuleMember& member : top_) {
     if (absl::holds_alternative<Function*>(member)) {
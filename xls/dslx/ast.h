@@ -15,6 +15,7 @@
 #ifndef XLS_DSLX_AST_H_
 #define XLS_DSLX_AST_H_
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -22,6 +23,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "xls/common/casts.h"
@@ -2076,9 +2078,10 @@ class Module : public AstNode {
     XLS_VLOG(3) << "Created module \"" << name_ << "\" @ " << this;
   }
 
-  ~Module() {
-    XLS_VLOG(3) << "Destroying module \"" << name_ << "\" @ " << this;
-  }
+  ~Module();
+
+  Module(const Module&) = delete;
+  Module& operator=(const Module&) = delete;
 
   absl::Status Accept(AstNodeVisitor* v) override {
     return v->HandleModule(this);
@@ -2099,17 +2102,28 @@ class Module : public AstNode {
     return absl::StrFormat("Module(name='%s', id=%p)", name(), this);
   }
 
+  // Makes a node owned by this module; nodes are allocated in the module's
+  // arena and live until the module is destroyed.
   template <typename T, typename... Args>
   T* Make(Args&&... args) {
-    std::unique_ptr<T> node =
-        absl::make_unique<T>(this, std::forward<Args>(args)...);
-    T* ptr = node.get();
-    nodes_.push_back(std::move(node));
-    return ptr;
+    absl::MutexLock lock(&nodes_mutex_);
+    void* storage = AllocateNode(sizeof(T), alignof(T));
+    T* node = new (storage) T(this, std::forward<Args>(args)...);
+    nodes_.push_back(node);
+    return node;
   }
 
   void AddTop(ModuleMember member) { top_.push_back(member); }
 
+  // Returns the nodes owned by this module in the order they were made; parsing
+  // the same text always makes the same nodes in the same order.
+  //
+  // Note: not synchronized with Make().
+  absl::Span<AstNode* const> nodes() const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    return nodes_;
+  }
+
   // Gets a function in this module with the given "target_name", or returns a
   // NotFoundError.
   absl::optional<Function*> GetFunction(absl::string_view target_name);
@@ -2206,9 +2220,24 @@ class Module : public AstNode {
     return result;
   }
 
+  // Returns storage for a node of the given size and alignment from the arena.
+  void* AllocateNode(size_t size, size_t alignment)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(nodes_mutex_);
+
   std::string name_;               // Name of this module.
   std::vector<ModuleMember> top_;  // Top-level members of this module.
-  std::vector<std::unique_ptr<AstNode>> nodes_;  // Lifetime-owned AST nodes.
+  // Lifetime-owned AST nodes. Typechecking may make nodes in a module from
+  // several threads (e.g. when instantiating a parametric function imported by
+  // modules that are typechecked in parallel).
+  absl::Mutex nodes_mutex_;
+  std::vector<AstNode*> nodes_ ABSL_GUARDED_BY(nodes_mutex_);
+  // Arena the nodes are allocated in: they are carved out of large blocks
+  // rather than individually heap-allocated, and are all released together
+  // with the module.
+  std::vector<std::unique_ptr<char[]>> arena_blocks_
+      ABSL_GUARDED_BY(nodes_mutex_);
+  char* arena_next_ ABSL_GUARDED_BY(nodes_mutex_) = nullptr;
+  size_t arena_remaining_ ABSL_GUARDED_BY(nodes_mutex_) = 0;
 };
 
 // Helper for determining whether an AST node is constant (e.g. can be
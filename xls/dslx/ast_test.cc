@@ -14,6 +14,9 @@
 
 #include "xls/dslx/ast.h"
 
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
@@ -74,5 +77,25 @@ TEST(CppAst, GetNumberAsInt64) {
                        HasSubstr("Could not convert 0b to a number")));
 }
 
+TEST(CppAst, ModuleOwnsNodesInOrder) {
+  Module m("test");
+  const Span fake_span;
+  std::vector<AstNode*> made;
+  // Enough nodes to fill several arena blocks.
+  for (int64_t i = 0; i < 10000; ++i) {
+    NameDef* name_def =
+        m.Make<NameDef>(fake_span, absl::StrCat("x", i), nullptr);
+    made.push_back(name_def);
+    made.push_back(m.Make<NameRef>(fake_span, name_def->identifier(),
+                                   name_def));
+  }
+  ASSERT_EQ(m.nodes().size(), made.size());
+  for (int64_t i = 0; i < made.size(); ++i) {
+    EXPECT_EQ(m.nodes()[i], made[i]);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(made[i]) % alignof(AstNode), 0);
+  }
+  EXPECT_EQ(made.back()->ToString(), "x9999");
+}
+
 }  // namespace
 }  // namespace xls::dslx
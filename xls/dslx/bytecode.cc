@@ -0,0 +1,580 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/bytecode.h"
+
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/dslx/concrete_type.h"
+#include "xls/dslx/evaluate.h"
+#include "xls/dslx/interp_bindings.h"
+#include "xls/dslx/type_info.h"
+
+namespace xls::dslx {
+namespace {
+
+using Op = Bytecode::Op;
+
+absl::string_view OpToString(Op op) {
+  switch (op) {
+    case Op::kLiteral:
+      return "literal";
+    case Op::kLoad:
+      return "load";
+    case Op::kStore:
+      return "store";
+    case Op::kPop:
+      return "pop";
+    case Op::kBinop:
+      return "binop";
+    case Op::kUnop:
+      return "unop";
+    case Op::kEq:
+      return "eq";
+    case Op::kCast:
+      return "cast";
+    case Op::kCreateTuple:
+      return "create_tuple";
+    case Op::kCreateArray:
+      return "create_array";
+    case Op::kTupleElement:
+      return "tuple_element";
+    case Op::kIndex:
+      return "index";
+    case Op::kJump:
+      return "jump";
+    case Op::kJumpIfFalse:
+      return "jump_if_false";
+    case Op::kForNext:
+      return "for_next";
+    case Op::kCall:
+      return "call";
+    case Op::kMatchFailure:
+      return "match_failure";
+  }
+  return "<invalid>";
+}
+
+}  // namespace
+
+std::string Bytecode::ToString() const {
+  return absl::StrFormat("%s %d", OpToString(op), operand);
+}
+
+std::string BytecodeFunction::ToString() const {
+  return absl::StrJoin(bytecodes_, "\n",
+                       [](std::string* out, const Bytecode& bytecode) {
+                         absl::StrAppend(out, bytecode.ToString());
+                       });
+}
+
+// Compiles the body of a function into a BytecodeFunction.
+//
+// Every name definition of the function gets its own slot, so a slot is never
+// shared by two names (even when their scopes don't overlap); temporaries
+// (e.g. the value being matched or the iterable of a loop) get slots as well,
+// so that failing to match a pattern leaves nothing on the stack.
+class BytecodeCompiler : public ExprVisitor {
+ public:
+  BytecodeCompiler(BytecodeFunction* f, TypeInfo* type_info,
+                   const InterpBindings* top_level_bindings,
+                   AbstractInterpreter* interp)
+      : f_(f),
+        type_info_(type_info),
+        module_bindings_(top_level_bindings),
+        interp_(interp) {
+    module_bindings_.set_fn_ctx(FnCtx{f->source()->owner()->name(),
+                                      f->source()->identifier(),
+                                      SymbolicBindings()});
+  }
+
+  absl::Status CompileFunction() {
+    for (Param* param : f_->source()->params()) {
+      GetSlot(param->name_def());
+    }
+    return Compile(f_->source()->body());
+  }
+
+ private:
+#define HANDLE(__expr_type)                             \
+  void Handle##__expr_type(__expr_type* expr) override { \
+    status_ = Compile##__expr_type(expr);               \
+  }
+
+  HANDLE(Array)
+  HANDLE(Attr)
+  HANDLE(Binop)
+  HANDLE(Cast)
+  HANDLE(ColonRef)
+  HANDLE(ConstRef)
+  HANDLE(For)
+  HANDLE(Index)
+  HANDLE(Invocation)
+  HANDLE(Let)
+  HANDLE(Match)
+  HANDLE(NameRef)
+  HANDLE(Number)
+  HANDLE(Ternary)
+  HANDLE(Unop)
+  HANDLE(XlsTuple)
+
+#undef HANDLE
+
+#define UNSUPPORTED(__expr_type)                        \
+  void Handle##__expr_type(__expr_type* expr) override { \
+    status_ = Unsupported(expr);                        \
+  }
+
+  UNSUPPORTED(Carry)
+  UNSUPPORTED(Next)
+  UNSUPPORTED(SplatStructInstance)
+  UNSUPPORTED(StructInstance)
+  UNSUPPORTED(While)
+
+#undef UNSUPPORTED
+
+  absl::Status Unsupported(Expr* expr) {
+    return absl::UnimplementedError(
+        absl::StrFormat("%s is not supported in bytecode @ %s",
+                        expr->GetNodeTypeName(), expr->span().ToString()));
+  }
+
+  absl::Status Compile(Expr* expr) {
+    expr->AcceptExpr(this);
+    return std::exchange(status_, absl::OkStatus());
+  }
+
+  int64_t Emit(Op op, Expr* source, int64_t operand = 0) {
+    f_->bytecodes_.push_back(Bytecode{op, source, operand});
+    return f_->bytecodes_.size() - 1;
+  }
+
+  // Makes the jump at "index" continue at the next instruction to be emitted.
+  void PatchJump(int64_t index) {
+    f_->bytecodes_[index].operand = f_->bytecodes_.size();
+  }
+
+  int64_t AddConstant(InterpValue value) {
+    f_->constants_.push_back(std::move(value));
+    return f_->constants_.size() - 1;
+  }
+
+  int64_t NewSlot() { return f_->slot_count_++; }
+
+  int64_t GetSlot(NameDef* name_def) {
+    auto [it, inserted] = slots_.emplace(name_def, f_->slot_count_);
+    if (inserted) {
+      ++f_->slot_count_;
+    }
+    return it->second;
+  }
+
+  // Compiles "expr", which doesn't depend on the function's locals (e.g. a
+  // reference to a module-level constant or function, or a number), to the
+  // literal of its value.
+  absl::Status CompileConstant(Expr* expr) {
+    std::unique_ptr<ConcreteType> type_context;
+    if (absl::optional<ConcreteType*> type = type_info_->GetItem(expr)) {
+      type_context = (*type)->CloneToUnique();
+    }
+    XLS_ASSIGN_OR_RETURN(
+        InterpValue value,
+        interp_->Eval(expr, &module_bindings_, std::move(type_context)));
+    Emit(Op::kLiteral, expr, AddConstant(std::move(value)));
+    return absl::OkStatus();
+  }
+
+  // Compiles the binding of the value on top of the stack to the names of
+  // "tree", for "source". If "fail_jumps" is given, the tree is a match
+  // pattern, whose (refutable) leaves emit jumps that are taken when they
+  // don't match; these are added to "fail_jumps".
+  absl::Status CompileNameDefTree(NameDefTree* tree, Expr* source,
+                                  std::vector<int64_t>* fail_jumps) {
+    if (!tree->is_leaf()) {
+      int64_t slot = NewSlot();
+      Emit(Op::kStore, source, slot);
+      for (int64_t i = 0; i < tree->nodes().size(); ++i) {
+        Emit(Op::kLoad, source, slot);
+        Emit(Op::kTupleElement, source, i);
+        XLS_RETURN_IF_ERROR(
+            CompileNameDefTree(tree->nodes()[i], source, fail_jumps));
+      }
+      return absl::OkStatus();
+    }
+
+    NameDefTree::Leaf leaf = tree->leaf();
+    if (absl::holds_alternative<NameDef*>(leaf)) {
+      Emit(Op::kStore, source, GetSlot(absl::get<NameDef*>(leaf)));
+      return absl::OkStatus();
+    }
+    if (absl::holds_alternative<WildcardPattern*>(leaf)) {
+      Emit(Op::kPop, source);
+      return absl::OkStatus();
+    }
+    XLS_RET_CHECK(fail_jumps != nullptr) << tree->ToString();
+    XLS_RETURN_IF_ERROR(Compile(ToExprNode(leaf)));
+    Emit(Op::kEq, source);
+    fail_jumps->push_back(Emit(Op::kJumpIfFalse, source));
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileArray(Array* expr) {
+    if (expr->has_ellipsis()) {
+      return Unsupported(expr);
+    }
+    for (Expr* member : expr->members()) {
+      XLS_RETURN_IF_ERROR(Compile(member));
+    }
+    Emit(Op::kCreateArray, expr, expr->members().size());
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileAttr(Attr* expr) {
+    absl::optional<ConcreteType*> type = type_info_->GetItem(expr->lhs());
+    XLS_RET_CHECK(type.has_value()) << expr->ToString();
+    auto* tuple_type = dynamic_cast<const TupleType*>(*type);
+    XLS_RET_CHECK(tuple_type != nullptr) << (*type)->ToString();
+    absl::optional<int64_t> index;
+    for (int64_t i = 0; i < tuple_type->size(); ++i) {
+      if (tuple_type->GetMemberName(i) == expr->attr()->identifier()) {
+        index = i;
+        break;
+      }
+    }
+    XLS_RET_CHECK(index.has_value()) << expr->ToString();
+    XLS_RETURN_IF_ERROR(Compile(expr->lhs()));
+    Emit(Op::kTupleElement, expr, *index);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileBinop(Binop* expr) {
+    XLS_RETURN_IF_ERROR(Compile(expr->lhs()));
+    XLS_RETURN_IF_ERROR(Compile(expr->rhs()));
+    Emit(Op::kBinop, expr);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileCast(Cast* expr) {
+    absl::optional<ConcreteType*> type = type_info_->GetItem(expr);
+    XLS_RET_CHECK(type.has_value()) << expr->ToString();
+    // Converting to an enum needs the values of its members, which is left to
+    // the AST interpreter.
+    if (dynamic_cast<const EnumType*>(*type) != nullptr) {
+      return Unsupported(expr);
+    }
+    XLS_RETURN_IF_ERROR(Compile(expr->expr()));
+    f_->types_.push_back((*type)->CloneToUnique());
+    Emit(Op::kCast, expr, f_->types_.size() - 1);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileColonRef(ColonRef* expr) { return CompileConstant(expr); }
+
+  absl::Status CompileConstRef(ConstRef* expr) { return CompileNameRef(expr); }
+
+  absl::Status CompileFor(For* expr) {
+    // The iterable, then the number of iterations done so far.
+    int64_t slot = NewSlot();
+    NewSlot();
+    XLS_RETURN_IF_ERROR(Compile(expr->iterable()));
+    Emit(Op::kStore, expr, slot);
+    Emit(Op::kLiteral, expr, AddConstant(InterpValue::MakeU64(0)));
+    Emit(Op::kStore, expr, slot + 1);
+    XLS_RETURN_IF_ERROR(Compile(expr->init()));
+
+    int64_t loop_start = Emit(Op::kForNext, expr, slot);
+    int64_t exit_jump = Emit(Op::kJumpIfFalse, expr);
+    XLS_RETURN_IF_ERROR(CompileNameDefTree(expr->names(), expr,
+                                           /*fail_jumps=*/nullptr));
+    XLS_RETURN_IF_ERROR(Compile(expr->body()));
+    Emit(Op::kJump, expr, loop_start);
+    PatchJump(exit_jump);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileIndex(Index* expr) {
+    if (!absl::holds_alternative<Expr*>(expr->rhs())) {
+      return Unsupported(expr);
+    }
+    XLS_RETURN_IF_ERROR(Compile(expr->lhs()));
+    XLS_RETURN_IF_ERROR(Compile(absl::get<Expr*>(expr->rhs())));
+    Emit(Op::kIndex, expr);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileInvocation(Invocation* expr) {
+    for (Expr* arg : expr->args()) {
+      XLS_RETURN_IF_ERROR(Compile(arg));
+    }
+    // Callees are module-level functions (or builtins), never locals.
+    XLS_ASSIGN_OR_RETURN(InterpValue callee,
+                         interp_->Eval(expr->callee(), &module_bindings_));
+    if (!callee.IsFunction()) {
+      return absl::InternalError(absl::StrFormat(
+          "EvaluateError: %s Callee value is not a function; should have been "
+          "determined during type inference; got %s",
+          expr->callee()->span().ToString(), callee.ToString()));
+    }
+    Emit(Op::kCall, expr, AddConstant(std::move(callee)));
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileLet(Let* expr) {
+    XLS_RETURN_IF_ERROR(Compile(expr->rhs()));
+    XLS_RETURN_IF_ERROR(CompileNameDefTree(expr->name_def_tree(), expr,
+                                           /*fail_jumps=*/nullptr));
+    return Compile(expr->body());
+  }
+
+  absl::Status CompileMatch(Match* expr) {
+    int64_t slot = NewSlot();
+    XLS_RETURN_IF_ERROR(Compile(expr->matched()));
+    Emit(Op::kStore, expr, slot);
+    std::vector<int64_t> end_jumps;
+    for (MatchArm* arm : expr->arms()) {
+      for (NameDefTree* pattern : arm->patterns()) {
+        std::vector<int64_t> fail_jumps;
+        Emit(Op::kLoad, expr, slot);
+        XLS_RETURN_IF_ERROR(CompileNameDefTree(pattern, expr, &fail_jumps));
+        XLS_RETURN_IF_ERROR(Compile(arm->expr()));
+        end_jumps.push_back(Emit(Op::kJump, expr));
+        for (int64_t fail_jump : fail_jumps) {
+          PatchJump(fail_jump);
+        }
+      }
+    }
+    Emit(Op::kLoad, expr, slot);
+    Emit(Op::kMatchFailure, expr);
+    for (int64_t end_jump : end_jumps) {
+      PatchJump(end_jump);
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileNameRef(NameRef* expr) {
+    AnyNameDef any_name_def = expr->name_def();
+    if (NameDef* const* name_def = absl::get_if<NameDef*>(&any_name_def)) {
+      if (auto it = slots_.find(*name_def); it != slots_.end()) {
+        Emit(Op::kLoad, expr, it->second);
+        return absl::OkStatus();
+      }
+    }
+    return CompileConstant(expr);
+  }
+
+  absl::Status CompileNumber(Number* expr) { return CompileConstant(expr); }
+
+  absl::Status CompileTernary(Ternary* expr) {
+    XLS_RETURN_IF_ERROR(Compile(expr->test()));
+    int64_t else_jump = Emit(Op::kJumpIfFalse, expr);
+    XLS_RETURN_IF_ERROR(Compile(expr->consequent()));
+    int64_t end_jump = Emit(Op::kJump, expr);
+    PatchJump(else_jump);
+    XLS_RETURN_IF_ERROR(Compile(expr->alternate()));
+    PatchJump(end_jump);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileUnop(Unop* expr) {
+    XLS_RETURN_IF_ERROR(Compile(expr->operand()));
+    Emit(Op::kUnop, expr);
+    return absl::OkStatus();
+  }
+
+  absl::Status CompileXlsTuple(XlsTuple* expr) {
+    for (Expr* member : expr->members()) {
+      XLS_RETURN_IF_ERROR(Compile(member));
+    }
+    Emit(Op::kCreateTuple, expr, expr->members().size());
+    return absl::OkStatus();
+  }
+
+  BytecodeFunction* f_;
+  TypeInfo* type_info_;
+  // Bindings for evaluating module-level names at compile time.
+  InterpBindings module_bindings_;
+  AbstractInterpreter* interp_;
+  absl::flat_hash_map<NameDef*, int64_t> slots_;
+  absl::Status status_;
+};
+
+/* static */ absl::StatusOr<std::unique_ptr<BytecodeFunction>>
+BytecodeFunction::Create(Function* f, AbstractInterpreter* interp) {
+  XLS_RET_CHECK(!f->IsParametric()) << f->identifier();
+  TypeInfo* type_info = interp->GetCurrentTypeInfo();
+  XLS_RET_CHECK_EQ(type_info->module(), f->owner());
+  XLS_ASSIGN_OR_RETURN(const InterpBindings* top_level_bindings,
+                       GetOrCreateTopLevelBindings(f->owner(), interp));
+  auto bytecode_function = absl::WrapUnique(new BytecodeFunction(f));
+  BytecodeCompiler compiler(bytecode_function.get(), type_info,
+                            top_level_bindings, interp);
+  XLS_RETURN_IF_ERROR(compiler.CompileFunction());
+  return bytecode_function;
+}
+
+absl::StatusOr<InterpValue> RunBytecode(const BytecodeFunction& f,
+                                        absl::Span<const InterpValue> args,
+                                        const BytecodeCallFn& call) {
+  XLS_RET_CHECK_EQ(args.size(), f.source()->params().size());
+  std::vector<InterpValue> slots(args.begin(), args.end());
+  while (slots.size() < f.slot_count()) {
+    slots.push_back(InterpValue::MakeNil());
+  }
+  std::vector<InterpValue> stack;
+  auto pop = [&stack]() {
+    InterpValue value = std::move(stack.back());
+    stack.pop_back();
+    return value;
+  };
+  // Pops the top "count" values, the first of them having been pushed first.
+  auto pop_n = [&stack](int64_t count) {
+    std::vector<InterpValue> values(
+        std::make_move_iterator(stack.end() - count),
+        std::make_move_iterator(stack.end()));
+    stack.erase(stack.end() - count, stack.end());
+    return values;
+  };
+
+  absl::Span<const Bytecode> bytecodes = f.bytecodes();
+  int64_t pc = 0;
+  while (pc < bytecodes.size()) {
+    const Bytecode& bytecode = bytecodes[pc++];
+    switch (bytecode.op) {
+      case Op::kLiteral:
+        stack.push_back(f.constants()[bytecode.operand]);
+        break;
+      case Op::kLoad:
+        stack.push_back(slots[bytecode.operand]);
+        break;
+      case Op::kStore:
+        slots[bytecode.operand] = pop();
+        break;
+      case Op::kPop:
+        stack.pop_back();
+        break;
+      case Op::kBinop: {
+        InterpValue rhs = pop();
+        InterpValue lhs = pop();
+        XLS_ASSIGN_OR_RETURN(
+            InterpValue result,
+            ApplyBinop(static_cast<Binop*>(bytecode.source)->kind(), lhs, rhs));
+        stack.push_back(std::move(result));
+        break;
+      }
+      case Op::kUnop: {
+        InterpValue arg = pop();
+        XLS_ASSIGN_OR_RETURN(
+            InterpValue result,
+            ApplyUnop(static_cast<Unop*>(bytecode.source)->kind(), arg));
+        stack.push_back(std::move(result));
+        break;
+      }
+      case Op::kEq: {
+        InterpValue target = pop();
+        InterpValue value = pop();
+        stack.push_back(InterpValue::MakeBool(target.Eq(value)));
+        break;
+      }
+      case Op::kCast: {
+        InterpValue value = pop();
+        XLS_ASSIGN_OR_RETURN(
+            InterpValue result,
+            ConcreteTypeConvertValue(
+                *f.types()[bytecode.operand], value, bytecode.source->span(),
+                /*enum_values=*/absl::nullopt,
+                value.type() == nullptr
+                    ? absl::nullopt
+                    : absl::make_optional(value.type()->signedness().value())));
+        stack.push_back(std::move(result));
+        break;
+      }
+      case Op::kCreateTuple:
+        stack.push_back(InterpValue::MakeTuple(pop_n(bytecode.operand)));
+        break;
+      case Op::kCreateArray: {
+        XLS_ASSIGN_OR_RETURN(InterpValue array,
+                             InterpValue::MakeArray(pop_n(bytecode.operand)));
+        stack.push_back(std::move(array));
+        break;
+      }
+      case Op::kTupleElement: {
+        InterpValue tuple = pop();
+        stack.push_back(tuple.GetValuesOrDie().at(bytecode.operand));
+        break;
+      }
+      case Op::kIndex: {
+        InterpValue index = pop();
+        InterpValue lhs = pop();
+        XLS_ASSIGN_OR_RETURN(uint64_t index_int, index.GetBitValueUint64());
+        XLS_ASSIGN_OR_RETURN(int64_t length, lhs.GetLength());
+        if (index_int >= length) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "FailureError: %s Indexing out of bounds: %d vs size %d",
+              bytecode.source->span().ToString(), index_int, length));
+        }
+        stack.push_back(lhs.GetValuesOrDie().at(index_int));
+        break;
+      }
+      case Op::kJump:
+        pc = bytecode.operand;
+        break;
+      case Op::kJumpIfFalse:
+        if (!pop().IsTrue()) {
+          pc = bytecode.operand;
+        }
+        break;
+      case Op::kForNext: {
+        const InterpValue& iterable = slots[bytecode.operand];
+        XLS_ASSIGN_OR_RETURN(uint64_t i,
+                             slots[bytecode.operand + 1].GetBitValueUint64());
+        XLS_ASSIGN_OR_RETURN(int64_t length, iterable.GetLength());
+        if (i >= length) {
+          stack.push_back(InterpValue::MakeBool(false));
+          break;
+        }
+        InterpValue carry = pop();
+        stack.push_back(InterpValue::MakeTuple(
+            {iterable.GetValuesOrDie()[i], std::move(carry)}));
+        slots[bytecode.operand + 1] = InterpValue::MakeU64(i + 1);
+        stack.push_back(InterpValue::MakeBool(true));
+        break;
+      }
+      case Op::kCall: {
+        auto* invocation = static_cast<Invocation*>(bytecode.source);
+        std::vector<InterpValue> call_args = pop_n(invocation->args().size());
+        XLS_ASSIGN_OR_RETURN(
+            InterpValue result,
+            call(invocation, f.constants()[bytecode.operand], call_args));
+        stack.push_back(std::move(result));
+        break;
+      }
+      case Op::kMatchFailure: {
+        InterpValue to_match = pop();
+        return absl::InternalError(absl::StrFormat(
+            "FailureError: %s The program being interpreted failed with an "
+            "incomplete match; value: %s",
+            bytecode.source->span().ToString(), to_match.ToString()));
+      }
+    }
+  }
+  XLS_RET_CHECK_EQ(stack.size(), 1) << f.source()->identifier();
+  return stack.back();
+}
+
+}  // namespace xls::dslx
@@ -0,0 +1,147 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Bytecode for DSLX functions, and the (stack-based) virtual machine that runs
+// it.
+//
+// Evaluating a function from its AST (see evaluate.h) looks up every name
+// reference in a chain of InterpBindings and creates a new InterpBindings for
+// every let, loop iteration and match arm. The bytecode instead refers to the
+// function's locals by slot, resolved at compile time, and expresses control
+// flow (ternaries, matches, for loops) as jumps, which makes loop-heavy code
+// much cheaper to interpret.
+
+#ifndef XLS_DSLX_BYTECODE_H_
+#define XLS_DSLX_BYTECODE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/dslx/abstract_interpreter.h"
+#include "xls/dslx/ast.h"
+#include "xls/dslx/concrete_type.h"
+#include "xls/dslx/interp_value.h"
+
+namespace xls::dslx {
+
+// A single bytecode instruction.
+struct Bytecode {
+  enum class Op {
+    // Pushes constants()[operand].
+    kLiteral,
+    // Pushes the value of slot "operand".
+    kLoad,
+    // Pops a value into slot "operand".
+    kStore,
+    // Pops (and discards) a value.
+    kPop,
+    // Pops the rhs and lhs operands of the Binop "source" and pushes its
+    // result.
+    kBinop,
+    // Pops the operand of the Unop "source" and pushes its result.
+    kUnop,
+    // Pops two values and pushes whether they are equal (as a u1).
+    kEq,
+    // Pops a value and pushes its conversion to types()[operand], for the Cast
+    // "source".
+    kCast,
+    // Pops "operand" values and pushes the tuple of them (the first element
+    // having been pushed first).
+    kCreateTuple,
+    // As kCreateTuple, but creates an array.
+    kCreateArray,
+    // Pops a tuple and pushes its element "operand".
+    kTupleElement,
+    // Pops an index and an array and pushes the element of the array at the
+    // index; fails if it's out of bounds, as the Index "source".
+    kIndex,
+    // Continues at instruction "operand".
+    kJump,
+    // Pops a u1 and continues at instruction "operand" if it's false.
+    kJumpIfFalse,
+    // Starts the next iteration of the For "source", whose iterable is in slot
+    // "operand" and iteration count in slot "operand" + 1: if there is one,
+    // pops the carry value and pushes the tuple of the next element and the
+    // carry, then true; pushes false otherwise.
+    kForNext,
+    // Pops the arguments of the Invocation "source" and pushes the result of
+    // calling constants()[operand] on them.
+    kCall,
+    // Pops the matched value of the Match "source" and fails, as no arm
+    // matched it.
+    kMatchFailure,
+  };
+
+  Op op;
+  Expr* source;
+  int64_t operand;
+
+  std::string ToString() const;
+};
+
+// A DSLX function compiled to bytecode.
+class BytecodeFunction {
+ public:
+  // Compiles "f", which must not be parametric, using the type information
+  // current in "interp" (which must be the root type information of its
+  // module), and evaluating the module-level names (constants, functions,
+  // enum members, etc.) it refers to with "interp".
+  //
+  // Returns an Unimplemented error if "f" uses a construct that the bytecode
+  // doesn't support (e.g. struct instances, slices or casts to enums); it must
+  // then be evaluated from its AST.
+  static absl::StatusOr<std::unique_ptr<BytecodeFunction>> Create(
+      Function* f, AbstractInterpreter* interp);
+
+  Function* source() const { return source_; }
+  absl::Span<const Bytecode> bytecodes() const { return bytecodes_; }
+  absl::Span<const InterpValue> constants() const { return constants_; }
+  absl::Span<const std::unique_ptr<ConcreteType>> types() const {
+    return types_;
+  }
+  // The number of slots for the function's parameters (which come first) and
+  // locals.
+  int64_t slot_count() const { return slot_count_; }
+
+  std::string ToString() const;
+
+ private:
+  friend class BytecodeCompiler;
+
+  explicit BytecodeFunction(Function* source) : source_(source) {}
+
+  Function* source_;
+  std::vector<Bytecode> bytecodes_;
+  std::vector<InterpValue> constants_;
+  std::vector<std::unique_ptr<ConcreteType>> types_;
+  int64_t slot_count_ = 0;
+};
+
+// Calls "callee" on "args" for the bytecode of "invocation".
+using BytecodeCallFn = std::function<absl::StatusOr<InterpValue>(
+    Invocation* invocation, const InterpValue& callee,
+    absl::Span<const InterpValue> args)>;
+
+// Runs "f" on "args", with "call" making the invocations.
+absl::StatusOr<InterpValue> RunBytecode(const BytecodeFunction& f,
+                                        absl::Span<const InterpValue> args,
+                                        const BytecodeCallFn& call);
+
+}  // namespace xls::dslx
+
+#endif  // XLS_DSLX_BYTECODE_H_
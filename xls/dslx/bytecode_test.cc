@@ -0,0 +1,148 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/bytecode.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/dslx/interpreter.h"
+#include "xls/dslx/parse_and_typecheck.h"
+
+namespace xls::dslx {
+namespace {
+
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+constexpr char kProgram[] = R"(
+const FOUR = u32:4;
+
+enum Color : u2 {
+  RED = 0,
+  GREEN = 1,
+}
+
+struct Point {
+  x: u32,
+  y: u32,
+}
+
+fn dot(p: Point, q: Point) -> u32 { p.x * q.x + p.y * q.y }
+
+fn sum_to(n: u32) -> u32 {
+  for (i, acc): (u32, u32) in range(u32:0, n) {
+    acc + i
+  }(u32:0)
+}
+
+fn classify(x: u32, c: Color) -> u8 {
+  let (a, _, b) = (x, u1:0, x + FOUR);
+  match (c, a) {
+    (Color::RED, u32:0) => u8:1,
+    (Color::RED, y) => (y as u8) + u8:2,
+    (Color::GREEN, _) => if b > u32:10 { u8:3 } else { u8:4 },
+  }
+}
+
+fn index(a: u8[3], i: u32) -> u8 { a[i] ^ !a[u32:0] }
+
+fn calls(x: u32) -> u32 {
+  let p = Point { x: x, y: u32:2 };
+  dot(p, p) + sum_to(x) + clz(x)
+}
+
+fn incomplete(x: u32) -> u32 {
+  match x {
+    u32:0 => u32:1,
+  }
+}
+)";
+
+class BytecodeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        TypecheckedModule tm,
+        ParseAndTypecheck(kProgram, "test.x", "test", &import_data_,
+                          /*additional_search_paths=*/{}));
+    module_ = tm.module;
+  }
+
+  // Runs function "name" on "args" with and without bytecode, and checks that
+  // the results match.
+  absl::StatusOr<InterpValue> Run(absl::string_view name,
+                                  std::vector<InterpValue> args) {
+    Interpreter ast_interpreter(module_, /*typecheck=*/nullptr,
+                               /*additional_search_paths=*/{}, &import_data_);
+    Interpreter bytecode_interpreter(
+        module_, /*typecheck=*/nullptr, /*additional_search_paths=*/{},
+        &import_data_, /*trace_all=*/false, /*ir_package=*/nullptr,
+        /*use_bytecode=*/true);
+    absl::StatusOr<InterpValue> want = ast_interpreter.RunFunction(name, args);
+    absl::StatusOr<InterpValue> got =
+        bytecode_interpreter.RunFunction(name, args);
+    EXPECT_EQ(got.status(), want.status()) << name;
+    if (got.ok() && want.ok()) {
+      EXPECT_TRUE(got->Eq(*want))
+          << name << ": " << got->ToString() << " vs " << want->ToString();
+    }
+    return got;
+  }
+
+  ImportData import_data_;
+  Module* module_;
+};
+
+TEST_F(BytecodeTest, MatchesAstInterpreter) {
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue sum,
+                           Run("sum_to", {InterpValue::MakeU32(100)}));
+  EXPECT_TRUE(sum.Eq(InterpValue::MakeU32(4950)));
+
+  XLS_ASSERT_OK_AND_ASSIGN(TypeDefinition color_def,
+                           module_->GetTypeDefinition("Color"));
+  auto* color = absl::get<EnumDef*>(color_def);
+  InterpValue red = InterpValue::MakeEnum(UBits(0, 2), color);
+  InterpValue green = InterpValue::MakeEnum(UBits(1, 2), color);
+  for (uint32_t x : {0, 5, 7}) {
+    XLS_EXPECT_OK(Run("classify", {InterpValue::MakeU32(x), red}).status());
+    XLS_EXPECT_OK(Run("classify", {InterpValue::MakeU32(x), green}).status());
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      InterpValue array,
+      InterpValue::MakeArray({InterpValue::MakeUBits(8, 1),
+                              InterpValue::MakeUBits(8, 2),
+                              InterpValue::MakeUBits(8, 3)}));
+  XLS_EXPECT_OK(Run("index", {array, InterpValue::MakeU32(2)}).status());
+  EXPECT_THAT(Run("index", {array, InterpValue::MakeU32(3)}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Indexing out of bounds")));
+
+  // Calls functions that are and that aren't (due to the struct instance)
+  // compiled to bytecode.
+  XLS_EXPECT_OK(Run("calls", {InterpValue::MakeU32(3)}).status());
+}
+
+TEST_F(BytecodeTest, IncompleteMatch) {
+  XLS_EXPECT_OK(Run("incomplete", {InterpValue::MakeU32(0)}).status());
+  EXPECT_THAT(Run("incomplete", {InterpValue::MakeU32(1)}),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("incomplete match; value: u32:1")));
+}
+
+}  // namespace
+}  // namespace xls::dslx
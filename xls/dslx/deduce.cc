@@ -1654,6 +1654,13 @@ static absl::Status CheckParametricInvocation(
     if (ctx->type_info()->HasInstantiation(invocation, symbolic_bindings)) {
       return absl::OkStatus();
     }
+    if (absl::optional<TypeInfo*> instantiated =
+            ctx->GetInstantiation(parametric_fn, symbolic_bindings)) {
+      // Another invocation already instantiated the function this way.
+      ctx->type_info()->AddInstantiation(invocation, symbolic_bindings,
+                                         *instantiated);
+      return absl::OkStatus();
+    }
 
     ColonRef::Subject subject = colon_ref->subject();
     // TODO(leary): 2020-12-14 Seems possible to violate this assertion? Attempt
@@ -1690,6 +1697,8 @@ static absl::Status CheckParametricInvocation(
                 << " symbolic_bindings: " << symbolic_bindings;
     ctx->type_info()->AddInstantiation(invocation, symbolic_bindings,
                                        invocation_imported_type_info);
+    ctx->AddInstantiation(parametric_fn, symbolic_bindings,
+                          invocation_imported_type_info);
     return absl::OkStatus();
   }
 
@@ -1699,6 +1708,13 @@ static absl::Status CheckParametricInvocation(
     // symbolic bindings, no need to do it again.
     return absl::OkStatus();
   }
+  if (absl::optional<TypeInfo*> instantiated =
+          ctx->GetInstantiation(parametric_fn, symbolic_bindings)) {
+    // Same if another invocation instantiated the function this way.
+    ctx->type_info()->AddInstantiation(invocation, symbolic_bindings,
+                                       *instantiated);
+    return absl::OkStatus();
+  }
 
   if (!ctx->type_info()->Contains(parametric_fn->body())) {
     // Typecheck this parametric function using the symbolic bindings we just
@@ -1723,6 +1739,7 @@ static absl::Status CheckParametricInvocation(
               << "; instantiated: " << ctx->type_info();
   ctx->type_info()->parent()->AddInstantiation(invocation, symbolic_bindings,
                                                ctx->type_info());
+  ctx->AddInstantiation(parametric_fn, symbolic_bindings, ctx->type_info());
   XLS_RETURN_IF_ERROR(ctx->PopDerivedTypeInfo());
   return absl::OkStatus();
 }
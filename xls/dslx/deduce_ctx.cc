@@ -41,7 +41,24 @@ DeduceCtx::DeduceCtx(TypeInfo* type_info, Module* module,
       typecheck_module_(std::move(typecheck_module)),
       additional_search_paths_(additional_search_paths.begin(),
                                additional_search_paths.end()),
-      import_data_(import_data) {}
+      import_data_(import_data),
+      instantiations_(std::make_shared<InstantiationMap>()) {}
+
+absl::optional<TypeInfo*> DeduceCtx::GetInstantiation(
+    Function* f, const SymbolicBindings& symbolic_bindings) const {
+  auto it = instantiations_->find(std::make_pair(f, symbolic_bindings));
+  if (it == instantiations_->end()) {
+    return absl::nullopt;
+  }
+  return it->second;
+}
+
+void DeduceCtx::AddInstantiation(Function* f,
+                                 SymbolicBindings symbolic_bindings,
+                                 TypeInfo* type_info) {
+  instantiations_->emplace(std::make_pair(f, std::move(symbolic_bindings)),
+                           type_info);
+}
 
 // Helper that converts the symbolic bindings to a parametric expression
 // environment (for parametric evaluation).
@@ -15,6 +15,10 @@
 #ifndef XLS_DSLX_DEDUCE_CTX_H_
 #define XLS_DSLX_DEDUCE_CTX_H_
 
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/dslx/concrete_type.h"
 #include "xls/dslx/import_routines.h"
@@ -89,9 +93,11 @@ class DeduceCtx {
   // Note that the resulting DeduceCtx has an empty fn_stack.
   std::unique_ptr<DeduceCtx> MakeCtx(TypeInfo* new_type_info,
                                      Module* new_module) const {
-    return absl::make_unique<DeduceCtx>(
+    auto ctx = absl::make_unique<DeduceCtx>(
         new_type_info, new_module, deduce_function_, typecheck_function_,
         typecheck_module_, additional_search_paths_, import_data_);
+    ctx->instantiations_ = instantiations_;
+    return ctx;
   }
 
   // Helper that calls back to the top-level deduce procedure for the given
@@ -149,6 +155,21 @@ class DeduceCtx {
     return import_data_->type_info_owner();
   }
 
+  // Returns the type information of the instantiation of parametric function
+  // "f" with (callee) "symbolic_bindings", if its body was already typechecked
+  // with them for another invocation. The body's types only depend on the
+  // function and the bindings, so the type information can be reused by every
+  // invocation that instantiates the function the same way.
+  //
+  // Note: instantiations are shared by contexts made from one another (see
+  // MakeCtx()), i.e., within the typechecking of one module -- so the type
+  // information of a module never refers to instantiations made while
+  // typechecking another one.
+  absl::optional<TypeInfo*> GetInstantiation(
+      Function* f, const SymbolicBindings& symbolic_bindings) const;
+  void AddInstantiation(Function* f, SymbolicBindings symbolic_bindings,
+                        TypeInfo* type_info);
+
  private:
   // Maps AST nodes to their deduced types.
   TypeInfo* type_info_ = nullptr;
@@ -178,6 +199,11 @@ class DeduceCtx {
   // Keeps track of the function we're currently typechecking and the symbolic
   // bindings that deduction is running on.
   std::vector<FnStackEntry> fn_stack_;
+
+  // Parametric function instantiations, see GetInstantiation().
+  using InstantiationMap =
+      absl::flat_hash_map<std::pair<Function*, SymbolicBindings>, TypeInfo*>;
+  std::shared_ptr<InstantiationMap> instantiations_;
 };
 
 // Helper that converts the symbolic bindings to a parametric expression
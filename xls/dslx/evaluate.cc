@@ -16,6 +16,7 @@
 
 #include "xls/common/status/ret_check.h"
 #include "xls/dslx/type_info.h"
+#include "xls/dslx/typecheck_cache.h"
 #include "xls/ir/bits_ops.h"
 
 namespace xls::dslx {
@@ -831,14 +832,18 @@ absl::StatusOr<InterpValue> EvaluateUnop(Unop* expr, InterpBindings* bindings,
                                          AbstractInterpreter* interp) {
   XLS_ASSIGN_OR_RETURN(InterpValue arg,
                        interp->Eval(expr->operand(), bindings));
-  switch (expr->kind()) {
+  return ApplyUnop(expr->kind(), arg);
+}
+
+absl::StatusOr<InterpValue> ApplyUnop(UnopKind kind, const InterpValue& arg) {
+  switch (kind) {
     case UnopKind::kInvert:
       return arg.BitwiseNegate();
     case UnopKind::kNegate:
       return arg.ArithmeticNegate();
   }
   return absl::InternalError(absl::StrCat("Invalid unary operation kind: ",
-                                          static_cast<int64_t>(expr->kind())));
+                                          static_cast<int64_t>(kind)));
 }
 
 absl::StatusOr<InterpValue> EvaluateShift(Binop* expr, InterpBindings* bindings,
@@ -856,20 +861,7 @@ absl::StatusOr<InterpValue> EvaluateShift(Binop* expr, InterpBindings* bindings,
   }
   XLS_ASSIGN_OR_RETURN(InterpValue rhs, interp->Eval(expr->rhs(), bindings,
                                                      std::move(rhs_type)));
-
-  switch (expr->kind()) {
-    case BinopKind::kShll:
-      return lhs.Shll(rhs);
-    case BinopKind::kShrl:
-      return lhs.Shrl(rhs);
-    case BinopKind::kShra:
-      return lhs.Shra(rhs);
-    default:
-      // Not an exhaustive list: this function only handles the shift operators.
-      break;
-  }
-  return absl::InternalError(absl::StrCat("Invalid shift operation kind: ",
-                                          static_cast<int64_t>(expr->kind())));
+  return ApplyBinop(expr->kind(), lhs, rhs);
 }
 
 absl::StatusOr<InterpValue> EvaluateBinop(Binop* expr, InterpBindings* bindings,
@@ -882,11 +874,15 @@ absl::StatusOr<InterpValue> EvaluateBinop(Binop* expr, InterpBindings* bindings,
   XLS_VLOG(6) << "EvaluateBinop: " << expr->ToString() << " @ " << expr->span();
   XLS_ASSIGN_OR_RETURN(InterpValue lhs, interp->Eval(expr->lhs(), bindings));
   XLS_ASSIGN_OR_RETURN(InterpValue rhs, interp->Eval(expr->rhs(), bindings));
+  return ApplyBinop(expr->kind(), lhs, rhs);
+}
 
+absl::StatusOr<InterpValue> ApplyBinop(BinopKind kind, const InterpValue& lhs,
+                                       const InterpValue& rhs) {
   // Check some preconditions; e.g. all logical operands are guaranteed to have
   // single-bit inputs by type checking so we can share the implementation with
   // bitwise or/and.
-  switch (expr->kind()) {
+  switch (kind) {
     case BinopKind::kLogicalOr:
     case BinopKind::kLogicalAnd:
       XLS_RET_CHECK_EQ(lhs.GetBitCount().value(), 1);
@@ -896,7 +892,13 @@ absl::StatusOr<InterpValue> EvaluateBinop(Binop* expr, InterpBindings* bindings,
       break;
   }
 
-  switch (expr->kind()) {
+  switch (kind) {
+    case BinopKind::kShll:
+      return lhs.Shll(rhs);
+    case BinopKind::kShrl:
+      return lhs.Shrl(rhs);
+    case BinopKind::kShra:
+      return lhs.Shra(rhs);
     case BinopKind::kAdd:
       return lhs.Add(rhs);
     case BinopKind::kSub:
@@ -928,12 +930,10 @@ absl::StatusOr<InterpValue> EvaluateBinop(Binop* expr, InterpBindings* bindings,
     case BinopKind::kGe:
       return lhs.Ge(rhs);
     default:
-      // Not an exhaustive list as the shift cases are handled in
-      // EvaluateShift().
       break;
   }
   return absl::InternalError(absl::StrCat("Invalid binary operation kind: ",
-                                          static_cast<int64_t>(expr->kind())));
+                                          static_cast<int64_t>(kind)));
 }
 
 absl::StatusOr<InterpValue> EvaluateTernary(Ternary* expr,
@@ -1190,6 +1190,7 @@ absl::StatusOr<const InterpBindings*> GetOrCreateTopLevelBindings(
   }
 
   bool saw_wip = false;
+  TypecheckCache* cache = import_data->typecheck_cache();
 
   // Add constants/imports present at the top level to the bindings.
   for (ModuleMember member : module->top()) {
@@ -1206,12 +1207,24 @@ absl::StatusOr<const InterpBindings*> GetOrCreateTopLevelBindings(
                   << constant_def->ToString();
       absl::optional<InterpValue> precomputed =
           interp->NoteWip(constant_def, absl::nullopt);
+      if (!precomputed.has_value() && cache != nullptr) {
+        // A previous process may have computed it for this version of the
+        // module.
+        precomputed =
+            cache->LoadConstant(module, constant_def->identifier());
+        if (precomputed.has_value()) {
+          interp->NoteWip(constant_def, *precomputed);
+        }
+      }
       absl::optional<InterpValue> result;
       if (precomputed.has_value()) {  // If we already computed it, use that.
         result = precomputed.value();
       } else {  // Otherwise, evaluate it and make a note.
         XLS_ASSIGN_OR_RETURN(result, interp->Eval(constant_def->value(), &b));
         interp->NoteWip(constant_def, *result);
+        if (cache != nullptr) {
+          cache->NoteConstant(module, constant_def->identifier(), *result);
+        }
       }
       XLS_CHECK(result.has_value());
       b.AddValue(constant_def->identifier(), *result);
@@ -1247,6 +1260,9 @@ absl::StatusOr<const InterpBindings*> GetOrCreateTopLevelBindings(
     // Marking the top level bindings as done avoids needless re-evaluation in
     // the future.
     import_data->MarkTopLevelBindingsDone(module);
+    if (cache != nullptr) {
+      cache->StoreConstants(module);
+    }
   }
   return &b;
 }
@@ -162,6 +162,14 @@ absl::StatusOr<InterpValue> EvaluateBinop(Binop* expr, InterpBindings* bindings,
                                           ConcreteType* type_context,
                                           AbstractInterpreter* interp);
 
+// Applies the unary operation "kind" to the (evaluated) operand "arg".
+absl::StatusOr<InterpValue> ApplyUnop(UnopKind kind, const InterpValue& arg);
+
+// Applies the binary operation "kind" to the (evaluated) operands "lhs" and
+// "rhs".
+absl::StatusOr<InterpValue> ApplyBinop(BinopKind kind, const InterpValue& lhs,
+                                       const InterpValue& rhs);
+
 // Evaluates a ternary expression; e.g. `foo if bar else baz`.
 absl::StatusOr<InterpValue> EvaluateTernary(Ternary* expr,
                                             InterpBindings* bindings,
@@ -14,7 +14,13 @@
 
 #include "xls/dslx/import_data.h"
 
+#include <algorithm>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 
 namespace xls::dslx {
@@ -26,6 +32,7 @@ namespace xls::dslx {
 
 absl::StatusOr<const ModuleInfo*> ImportData::Get(
     const ImportTokens& subject) const {
+  absl::MutexLock lock(&mutex_);
   auto it = cache_.find(subject);
   if (it == cache_.end()) {
     return absl::NotFoundError("Module information was not found for import " +
@@ -36,6 +43,7 @@ absl::StatusOr<const ModuleInfo*> ImportData::Get(
 
 absl::StatusOr<const ModuleInfo*> ImportData::Put(const ImportTokens& subject,
                                                   ModuleInfo module_info) {
+  absl::MutexLock lock(&mutex_);
   auto it = cache_.insert({subject, std::move(module_info)});
   if (!it.second) {
     return absl::InvalidArgumentError(
@@ -44,6 +52,182 @@ absl::StatusOr<const ModuleInfo*> ImportData::Put(const ImportTokens& subject,
   return &it.first->second;
 }
 
+int64_t ImportData::EvictStaleModules() {
+  absl::MutexLock lock(&mutex_);
+  XLS_CHECK(importing_.empty());
+  absl::flat_hash_set<Module*> stale;
+  for (const auto& [subject, info] : cache_) {
+    if (info.path.empty()) {
+      continue;
+    }
+    absl::StatusOr<std::string> contents = GetFileContents(info.path);
+    if (!contents.ok() || *contents != info.contents) {
+      XLS_VLOG(3) << "Evicting changed module " << subject.ToString();
+      stale.insert(info.module.get());
+    }
+  }
+  if (stale.empty()) {
+    return 0;
+  }
+
+  // Importers of stale modules are stale too.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto& [subject, info] : cache_) {
+      if (stale.contains(info.module.get())) {
+        continue;
+      }
+      for (const auto& [import, imported] : info.type_info->imports()) {
+        if (stale.contains(imported.module)) {
+          XLS_VLOG(3) << "Evicting importer " << subject.ToString();
+          stale.insert(info.module.get());
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  for (auto it = cache_.begin(); it != cache_.end();) {
+    if (stale.contains(it->second.module.get())) {
+      evicted_modules_.push_back(std::move(it->second.module));
+      cache_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return stale.size();
+}
+
+absl::Status ImportData::Remove(const ImportTokens& subject) {
+  absl::MutexLock lock(&mutex_);
+  XLS_RET_CHECK(importing_.empty());
+  auto it = cache_.find(subject);
+  if (it == cache_.end()) {
+    return absl::NotFoundError("Module information was not found for import " +
+                               subject.ToString());
+  }
+  Module* module = it->second.module.get();
+  for (const auto& [other_subject, info] : cache_) {
+    for (const auto& [import, imported] : info.type_info->imports()) {
+      if (imported.module == module) {
+        return absl::FailedPreconditionError(
+            absl::StrFormat("Module %s is imported by %s", subject.ToString(),
+                            other_subject.ToString()));
+      }
+    }
+  }
+  RemoveModuleStateLocked(module);
+  cache_.erase(it);
+  return absl::OkStatus();
+}
+
+void ImportData::RemoveModuleState(Module* module) {
+  absl::MutexLock lock(&mutex_);
+  RemoveModuleStateLocked(module);
+}
+
+void ImportData::RemoveModuleStateLocked(Module* module) {
+  top_level_bindings_.erase(module);
+  top_level_bindings_done_.erase(module);
+  typecheck_wip_.erase(module);
+  type_info_owner_.Remove(module);
+}
+
+absl::StatusOr<bool> ImportData::StartImport(const ImportTokens& importer,
+                                              const ImportTokens& subject) {
+  absl::MutexLock lock(&mutex_);
+  if (cache_.contains(subject)) {
+    return false;
+  }
+  if (importing_.contains(subject) && IsImporting(subject, importer)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Cyclic import of module %s by module %s",
+                        subject.ToString(), importer.ToString()));
+  }
+  import_edges_[importer].push_back(subject);
+  while (importing_.contains(subject)) {
+    // The thread importing the subject can't end up waiting for this one, as
+    // that would make this a cyclic import (which it reports).
+    import_finished_.Wait(&mutex_);
+  }
+  if (cache_.contains(subject)) {
+    RemoveImportEdge(importer, subject);
+    return false;
+  }
+  // Not imported yet, or the other import failed: import it here.
+  importing_.insert(subject);
+  return true;
+}
+
+void ImportData::FinishImport(const ImportTokens& importer,
+                              const ImportTokens& subject) {
+  absl::MutexLock lock(&mutex_);
+  RemoveImportEdge(importer, subject);
+  importing_.erase(subject);
+  import_finished_.SignalAll();
+}
+
+void ImportData::RemoveImportEdge(const ImportTokens& importer,
+                                  const ImportTokens& subject) {
+  std::vector<ImportTokens>& subjects = import_edges_.at(importer);
+  subjects.erase(std::find(subjects.begin(), subjects.end(), subject));
+  if (subjects.empty()) {
+    import_edges_.erase(importer);
+  }
+}
+
+bool ImportData::IsImporting(const ImportTokens& from,
+                             const ImportTokens& to) const {
+  std::vector<const ImportTokens*> worklist = {&from};
+  absl::flat_hash_set<const ImportTokens*> seen;
+  while (!worklist.empty()) {
+    const ImportTokens* tokens = worklist.back();
+    worklist.pop_back();
+    if (*tokens == to) {
+      return true;
+    }
+    auto it = import_edges_.find(*tokens);
+    if (it == import_edges_.end()) {
+      continue;
+    }
+    for (const ImportTokens& next : it->second) {
+      if (seen.insert(&next).second) {
+        worklist.push_back(&next);
+      }
+    }
+  }
+  return false;
+}
+
+void ImportData::EnableParallelTypecheck(int64_t thread_count) {
+  absl::MutexLock lock(&mutex_);
+  parallel_typecheck_ = true;
+  available_typecheck_threads_ = thread_count;
+}
+
+bool ImportData::TryReserveTypecheckThread() {
+  absl::MutexLock lock(&mutex_);
+  if (available_typecheck_threads_ == 0) {
+    return false;
+  }
+  --available_typecheck_threads_;
+  return true;
+}
+
+void ImportData::ReleaseTypecheckThread() {
+  absl::MutexLock lock(&mutex_);
+  ++available_typecheck_threads_;
+}
+
+void ImportData::EnableTypecheckCache(std::filesystem::path cache_dir) {
+  absl::MutexLock lock(&mutex_);
+  XLS_CHECK(cache_.empty()) << "Modules were imported before enabling the "
+                               "typecheck cache.";
+  typecheck_cache_ = std::make_unique<TypecheckCache>(std::move(cache_dir));
+}
+
 absl::StatusOr<TypeInfo*> ImportData::GetRootTypeInfoForNode(AstNode* node) {
   XLS_RET_CHECK(node != nullptr);
   return type_info_owner().GetRootTypeInfo(node->owner());
@@ -54,6 +238,7 @@ absl::StatusOr<TypeInfo*> ImportData::GetRootTypeInfo(Module* module) {
 }
 
 InterpBindings& ImportData::GetOrCreateTopLevelBindings(Module* module) {
+  absl::MutexLock lock(&mutex_);
   auto it = top_level_bindings_.find(module);
   if (it == top_level_bindings_.end()) {
     it = top_level_bindings_
@@ -66,6 +251,7 @@ InterpBindings& ImportData::GetOrCreateTopLevelBindings(Module* module) {
 
 void ImportData::SetTopLevelBindings(Module* module,
                                      std::unique_ptr<InterpBindings> tlb) {
+  absl::MutexLock lock(&mutex_);
   auto it = top_level_bindings_.emplace(module, std::move(tlb));
   XLS_CHECK(it.second) << "Module already had top level bindings: "
                        << module->name();
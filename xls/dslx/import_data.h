@@ -15,11 +15,19 @@
 #ifndef XLS_DSLX_IMPORT_DATA_H_
 #define XLS_DSLX_IMPORT_DATA_H_
 
+#include <filesystem>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/dslx/ast.h"
 #include "xls/dslx/interp_bindings.h"
 #include "xls/dslx/type_info.h"
+#include "xls/dslx/typecheck_cache.h"
 
 namespace xls::dslx {
 
@@ -27,6 +35,10 @@ namespace xls::dslx {
 struct ModuleInfo {
   std::unique_ptr<Module> module;
   TypeInfo* type_info;
+  // The file the module was imported from and its contents at the time (see
+  // ImportData::EvictStaleModules()), or empty if not imported from a file.
+  std::filesystem::path path;
+  std::string contents;
 };
 
 // Immutable "tuple" of tokens that name an absolute import location.
@@ -74,21 +86,82 @@ class ImportTokens {
 
 // Wrapper around a {subject: module_info} mapping that modules can be imported
 // into.
+//
+// ImportData is thread-safe, so that modules can be imported in parallel (see
+// EnableParallelTypecheck()).
 class ImportData {
  public:
   bool Contains(const ImportTokens& target) const {
+    absl::MutexLock lock(&mutex_);
     return cache_.find(target) != cache_.end();
   }
 
-  // Note: returned pointer is not stable across mutations.
   absl::StatusOr<const ModuleInfo*> Get(const ImportTokens& subject) const;
 
-  // Note: returned pointer is not stable across mutations.
   absl::StatusOr<const ModuleInfo*> Put(const ImportTokens& subject,
                                         ModuleInfo module_info);
 
+  // Removes the modules whose file no longer has the contents they were
+  // imported from, and the modules that (transitively) import them, so that
+  // they're imported afresh the next time they're imported. Returns the number
+  // of modules removed. For long-lived sessions (e.g. a REPL) that reload a
+  // module as files change, while reusing the modules that didn't.
+  //
+  // The removed modules are kept alive, as their AST nodes may still be
+  // referred to, e.g. by type information. Must not be called while modules
+  // are being imported.
+  int64_t EvictStaleModules();
+
+  // Removes "subject" and destroys its module and type information, e.g., for
+  // long-lived sessions that typecheck many unrelated top level modules against
+  // the same imports. Returns an error if another module imports the subject.
+  // Must not be called while modules are being imported.
+  absl::Status Remove(const ImportTokens& subject);
+
+  // Drops the state kept for "module" (its type information and top level
+  // bindings), e.g. for a module that failed to typecheck and is about to be
+  // destroyed.
+  void RemoveModuleState(Module* module);
+
+  // Called by DoImport() before "importer" imports "subject" (the importer is
+  // empty for the top level). Returns true if the caller must import the
+  // subject and then call FinishImport() -- or false once the subject is in
+  // the cache, which may mean waiting for another thread that is importing it.
+  // Returns an error if the subject is (transitively) importing the importer,
+  // i.e., for cyclic imports.
+  absl::StatusOr<bool> StartImport(const ImportTokens& importer,
+                                   const ImportTokens& subject);
+  void FinishImport(const ImportTokens& importer, const ImportTokens& subject);
+
+  // Makes DoModuleImports() import the modules a module imports in parallel,
+  // using up to "thread_count" threads (in addition to the importing ones)
+  // overall.
+  void EnableParallelTypecheck(int64_t thread_count);
+  bool parallel_typecheck() const {
+    absl::MutexLock lock(&mutex_);
+    return parallel_typecheck_;
+  }
+
+  // Reserves one of the threads for parallel typechecking, or returns false if
+  // all of them are in use.
+  bool TryReserveTypecheckThread();
+  void ReleaseTypecheckThread();
+
+  // Held while typechecking evaluates constexprs, which may evaluate (and
+  // update) the top level bindings of other modules. It is recursive as
+  // evaluation may typecheck, which evaluates other constexprs.
+  std::recursive_mutex& interpreter_mutex() { return interpreter_mutex_; }
+
   TypeInfoOwner& type_info_owner() { return type_info_owner_; }
 
+  // Makes DoImport() consult (and fill) an on-disk cache of typechecked modules
+  // in "cache_dir"; see TypecheckCache. Must be called before any module is
+  // imported.
+  void EnableTypecheckCache(std::filesystem::path cache_dir);
+
+  // Returns the typecheck cache, or nullptr if it is not enabled.
+  TypecheckCache* typecheck_cache() { return typecheck_cache_.get(); }
+
   // Helper that gets the "root" type information for the module of the given
   // node. (Note that type information lives in a tree configuration where
   // parametric specializations live under the root, see TypeInfo.)
@@ -110,12 +183,14 @@ class ImportData {
   // work-in-progress. "node" may be set as nullptr when done with the entire
   // module.
   void SetTypecheckWorkInProgress(Module* module, AstNode* node) {
+    absl::MutexLock lock(&mutex_);
     typecheck_wip_[module] = node;
   }
 
   // Retrieves which node was noted as currently work-in-progress, getter for
   // SetTypecheckWorkInProgress() above.
   AstNode* GetTypecheckWorkInProgress(Module* module) {
+    absl::MutexLock lock(&mutex_);
     return typecheck_wip_[module];
   }
 
@@ -125,19 +200,45 @@ class ImportData {
   // hitting a work-in-progress indicator) those completed bindings can be
   // re-used after that without any need for re-evaluation.
   bool IsTopLevelBindingsDone(Module* module) const {
+    absl::MutexLock lock(&mutex_);
     return top_level_bindings_done_.contains(module);
   }
   void MarkTopLevelBindingsDone(Module* module) {
+    absl::MutexLock lock(&mutex_);
     top_level_bindings_done_.insert(module);
   }
 
  private:
-  absl::flat_hash_map<ImportTokens, ModuleInfo> cache_;
+  // Returns whether "to" is reachable from "from" through import_edges_.
+  bool IsImporting(const ImportTokens& from, const ImportTokens& to) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RemoveModuleStateLocked(Module* module)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RemoveImportEdge(const ImportTokens& importer,
+                        const ImportTokens& subject)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  // Signaled when an import finishes.
+  absl::CondVar import_finished_;
+  // Note: node-based, as pointers to the module information are handed out.
+  absl::node_hash_map<ImportTokens, ModuleInfo> cache_ ABSL_GUARDED_BY(mutex_);
+  // The modules removed by EvictStaleModules().
+  std::vector<std::unique_ptr<Module>> evicted_modules_ ABSL_GUARDED_BY(mutex_);
+  // The subjects currently being imported, and for each importer the subjects
+  // it is importing (or waiting for).
+  absl::flat_hash_set<ImportTokens> importing_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<ImportTokens, std::vector<ImportTokens>> import_edges_
+      ABSL_GUARDED_BY(mutex_);
+  bool parallel_typecheck_ ABSL_GUARDED_BY(mutex_) = false;
+  int64_t available_typecheck_threads_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::recursive_mutex interpreter_mutex_;
   absl::flat_hash_map<Module*, std::unique_ptr<InterpBindings>>
-      top_level_bindings_;
-  absl::flat_hash_set<Module*> top_level_bindings_done_;
-  absl::flat_hash_map<Module*, AstNode*> typecheck_wip_;
+      top_level_bindings_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_set<Module*> top_level_bindings_done_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Module*, AstNode*> typecheck_wip_ ABSL_GUARDED_BY(mutex_);
   TypeInfoOwner type_info_owner_;
+  std::unique_ptr<TypecheckCache> typecheck_cache_;
 };
 
 }  // namespace xls::dslx
@@ -14,10 +14,13 @@
 
 #include "xls/dslx/import_routines.h"
 
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
+#include "xls/common/cleanup.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/get_runfile_path.h"
 #include "xls/common/status/ret_check.h"
+#include "xls/common/thread.h"
 #include "xls/dslx/parser.h"
 #include "xls/dslx/scanner.h"
 
@@ -117,14 +120,113 @@ static absl::StatusOr<std::filesystem::path> FindExistingPath(
                       GetCurrentDirectory().value()));
 }
 
+// Returns the subjects being imported by the current thread, innermost last.
+static std::vector<ImportTokens>& ImportStack() {
+  thread_local std::vector<ImportTokens> import_stack;
+  return import_stack;
+}
+
+// Returns the importer of the modules the current thread imports (empty at the
+// top level).
+static ImportTokens CurrentImporter() {
+  const std::vector<ImportTokens>& import_stack = ImportStack();
+  if (import_stack.empty()) {
+    return ImportTokens({});
+  }
+  return import_stack.back();
+}
+
+// Typechecks "module", which imports "imports", using the typecheck cache of
+// "import_data".
+static absl::StatusOr<TypeInfo*> TypecheckWithCache(
+    const TypecheckFn& ftypecheck, Module* module, absl::string_view contents,
+    absl::Span<const ModuleInfo* const> imports, ImportData* import_data) {
+  std::vector<Module*> import_modules;
+  for (const ModuleInfo* imported : imports) {
+    import_modules.push_back(imported->module.get());
+  }
+
+  TypecheckCache* cache = import_data->typecheck_cache();
+  cache->NoteModule(module, contents, import_modules);
+  if (absl::optional<TypeInfo*> type_info =
+          cache->Load(module, &import_data->type_info_owner())) {
+    return *type_info;
+  }
+  TypeInfoChangeRecorder recorder;
+  XLS_ASSIGN_OR_RETURN(TypeInfo * type_info, ftypecheck(module));
+  cache->Store(module, recorder.changes());
+  return type_info;
+}
+
+absl::StatusOr<std::vector<const ModuleInfo*>> DoModuleImports(
+    const TypecheckFn& ftypecheck, Module* module,
+    absl::Span<const std::string> additional_search_paths,
+    ImportData* import_data) {
+  std::vector<Import*> imports;
+  for (const ModuleMember& member : module->top()) {
+    if (absl::holds_alternative<Import*>(member)) {
+      imports.push_back(absl::get<Import*>(member));
+    }
+  }
+
+  std::vector<absl::StatusOr<const ModuleInfo*>> results(imports.size());
+  auto do_import = [&](int64_t i) {
+    results[i] = DoImport(ftypecheck, ImportTokens(imports[i]->subject()),
+                          additional_search_paths, import_data,
+                          imports[i]->span());
+  };
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < imports.size(); ++i) {
+      // Hand the import to another thread if there is one available and this
+      // thread has other imports to do in the meantime.
+      ImportTokens subject(imports[i]->subject());
+      bool spawn = import_data->parallel_typecheck() &&
+                   i + 1 < imports.size() && !import_data->Contains(subject) &&
+                   import_data->TryReserveTypecheckThread();
+      if (!spawn) {
+        do_import(i);
+        continue;
+      }
+      threads.push_back(
+          std::make_unique<Thread>([&, i, import_stack = ImportStack()]() {
+            // Imports made by the new thread are made on behalf of the same
+            // importer.
+            ImportStack() = import_stack;
+            do_import(i);
+            import_data->ReleaseTypecheckThread();
+          }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+
+  std::vector<const ModuleInfo*> imported;
+  for (absl::StatusOr<const ModuleInfo*>& result : results) {
+    XLS_RETURN_IF_ERROR(result.status());
+    imported.push_back(*result);
+  }
+  return imported;
+}
+
 absl::StatusOr<const ModuleInfo*> DoImport(
     const TypecheckFn& ftypecheck, const ImportTokens& subject,
     absl::Span<const std::string> additional_search_paths,
     ImportData* import_data, const Span& import_span) {
   XLS_RET_CHECK(import_data != nullptr);
-  if (import_data->Contains(subject)) {
+  ImportTokens importer = CurrentImporter();
+  absl::StatusOr<bool> start = import_data->StartImport(importer, subject);
+  if (!start.ok()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("ImportError: %s %s", import_span.ToString(),
+                        start.status().message()));
+  }
+  if (!*start) {
     return import_data->Get(subject);
   }
+  auto finish_import = xabsl::MakeCleanup(
+      [&]() { import_data->FinishImport(importer, subject); });
 
   XLS_VLOG(3) << "DoImport (uncached) subject: " << subject.ToString();
 
@@ -141,8 +243,25 @@ absl::StatusOr<const ModuleInfo*> DoImport(
   Scanner scanner(found_path, contents);
   Parser parser(/*module_name=*/fully_qualified_name, &scanner);
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Module> module, parser.ParseModule());
-  XLS_ASSIGN_OR_RETURN(TypeInfo * type_info, ftypecheck(module.get()));
-  return import_data->Put(subject, ModuleInfo{std::move(module), type_info});
+
+  ImportStack().push_back(subject);
+  auto pop_import = xabsl::MakeCleanup([]() { ImportStack().pop_back(); });
+  TypeInfo* type_info;
+  if (import_data->typecheck_cache() != nullptr) {
+    // The entry for a module depends on the entries of its imports, so they
+    // are imported up front.
+    XLS_ASSIGN_OR_RETURN(std::vector<const ModuleInfo*> imports,
+                         DoModuleImports(ftypecheck, module.get(),
+                                         additional_search_paths, import_data));
+    XLS_ASSIGN_OR_RETURN(
+        type_info, TypecheckWithCache(ftypecheck, module.get(), contents,
+                                      imports, import_data));
+  } else {
+    XLS_ASSIGN_OR_RETURN(type_info, ftypecheck(module.get()));
+  }
+  return import_data->Put(
+      subject, ModuleInfo{std::move(module), type_info, found_path,
+                          std::move(contents)});
 }
 
 }  // namespace xls::dslx
@@ -16,6 +16,7 @@
 #define XLS_DSLX_IMPORT_ROUTINES_H_
 
 #include <string>
+#include <vector>
 
 #include "xls/dslx/ast.h"
 #include "xls/dslx/import_data.h"
@@ -32,6 +33,13 @@ using TypecheckFn = std::function<absl::StatusOr<TypeInfo*>(Module*)>;
 // cache.
 //
 // Resolves against an existing import in 'cache' if it is present.
+// If the typecheck cache of 'import_data' is enabled, the modules imported by
+// the subject are imported first (see DoModuleImports()) so that the subject's
+// typecheck results can be loaded from (or stored in) the cache.
+//
+// Modules may be imported from several threads at once: a module that is
+// being imported by another thread is waited for, and cyclic imports are
+// reported as errors.
 //
 // Args:
 //  ftypecheck: Function that can be used to get type information for a module.
@@ -49,6 +57,16 @@ absl::StatusOr<const ModuleInfo*> DoImport(
     absl::Span<std::string const> additional_search_paths,
     ImportData* import_data, const Span& import_span);
 
+// Imports the modules imported by "module", in the order of its import
+// statements. If parallel typechecking is enabled on "import_data", uses the
+// typechecking threads available to import independent modules concurrently.
+//
+// Returns the imported module information for each import statement.
+absl::StatusOr<std::vector<const ModuleInfo*>> DoModuleImports(
+    const TypecheckFn& ftypecheck, Module* module,
+    absl::Span<std::string const> additional_search_paths,
+    ImportData* import_data);
+
 }  // namespace xls::dslx
 
 #endif  // XLS_DSLX_IMPORT_ROUTINES_H_
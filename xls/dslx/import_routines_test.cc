@@ -0,0 +1,195 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/import_routines.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/dslx/parse_and_typecheck.h"
+
+namespace xls::dslx {
+namespace {
+
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+// A diamond of imports: both libraries use the parametric function of the
+// utility module, with different parametrics.
+constexpr char kUtil[] = R"(
+pub fn double<N: u32>(x: uN[N]) -> uN[N] { x + x }
+)";
+
+constexpr char kLibA[] = R"(
+import par_util
+
+pub fn f(x: u32) -> u32 { par_util::double(x) }
+)";
+
+constexpr char kLibB[] = R"(
+import par_util
+
+pub fn g(x: u16) -> u16 { par_util::double(x) }
+)";
+
+constexpr char kMain[] = R"(
+import par_lib_a
+import par_lib_b
+import par_util
+
+fn main(x: u32) -> (u32, u16, u8) {
+  (par_lib_a::f(x), par_lib_b::g(x as u16), par_util::double(x as u8))
+}
+)";
+
+class ImportRoutinesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+    temp_dir_ = std::make_unique<TempDirectory>(std::move(temp_dir));
+    XLS_ASSERT_OK(SetFileContents(path() / "par_util.x", kUtil));
+    XLS_ASSERT_OK(SetFileContents(path() / "par_lib_a.x", kLibA));
+    XLS_ASSERT_OK(SetFileContents(path() / "par_lib_b.x", kLibB));
+  }
+
+  const std::filesystem::path& path() const { return temp_dir_->path(); }
+
+  // Typechecks "program" with a fresh ImportData using "threads" typechecking
+  // threads (serially if zero) and returns its IR conversion.
+  absl::StatusOr<std::string> TypecheckAndConvert(absl::string_view program,
+                                                  int64_t threads) {
+    ImportData import_data;
+    if (threads > 0) {
+      import_data.EnableParallelTypecheck(threads);
+    }
+    std::vector<std::string> search_paths = {path().string()};
+    XLS_ASSIGN_OR_RETURN(TypecheckedModule tm,
+                         ParseAndTypecheck(program, "main.x", "main",
+                                           &import_data, search_paths));
+    return ConvertModule(tm.module, &import_data);
+  }
+
+  std::unique_ptr<TempDirectory> temp_dir_;
+};
+
+TEST_F(ImportRoutinesTest, ParallelTypecheckMatchesSerial) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::string serial_ir,
+                           TypecheckAndConvert(kMain, /*threads=*/0));
+  for (int64_t threads : {1, 2, 8}) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::string parallel_ir,
+                             TypecheckAndConvert(kMain, threads));
+    EXPECT_EQ(parallel_ir, serial_ir) << threads;
+  }
+}
+
+TEST_F(ImportRoutinesTest, CyclicImportIsAnError) {
+  XLS_ASSERT_OK(SetFileContents(path() / "par_cycle_a.x", R"(
+import par_cycle_b
+
+pub fn f() -> u32 { par_cycle_b::g() }
+)"));
+  XLS_ASSERT_OK(SetFileContents(path() / "par_cycle_b.x", R"(
+import par_cycle_a
+
+pub fn g() -> u32 { u32:42 }
+)"));
+  constexpr char kProgram[] = R"(
+import par_util
+import par_cycle_b
+import par_cycle_a
+
+fn main() -> u32 { par_cycle_a::f() }
+)";
+  for (int64_t threads : {0, 2}) {
+    EXPECT_THAT(TypecheckAndConvert(kProgram, threads),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("Cyclic import of module par_cycle_")))
+        << threads;
+  }
+}
+
+TEST_F(ImportRoutinesTest, EvictStaleModules) {
+  ImportData import_data;
+  std::vector<std::string> search_paths = {path().string()};
+  XLS_ASSERT_OK(ParseAndTypecheck(kMain, "main.x", "main", &import_data,
+                                  search_paths)
+                    .status());
+  XLS_ASSERT_OK_AND_ASSIGN(const ModuleInfo* lib_a,
+                           import_data.Get(ImportTokens({"par_lib_a"})));
+  EXPECT_EQ(import_data.EvictStaleModules(), 0);
+
+  // Changing a library evicts it and its importer (main), but not the
+  // modules that don't depend on it.
+  XLS_ASSERT_OK(
+      SetFileContents(path() / "par_lib_b.x",
+                      absl::StrCat(kLibB, "\npub fn h() -> u32 { u32:0 }\n")));
+  EXPECT_EQ(import_data.EvictStaleModules(), 2);
+  EXPECT_FALSE(import_data.Contains(ImportTokens({"par_lib_b"})));
+  EXPECT_FALSE(import_data.Contains(ImportTokens({"main"})));
+
+  XLS_ASSERT_OK_AND_ASSIGN(TypecheckedModule tm,
+                           ParseAndTypecheck(kMain, "main.x", "main",
+                                             &import_data, search_paths));
+  EXPECT_THAT(import_data.Get(ImportTokens({"par_lib_a"})),
+              status_testing::IsOkAndHolds(lib_a));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string ir,
+                           ConvertModule(tm.module, &import_data));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string fresh_ir,
+                           TypecheckAndConvert(kMain, /*threads=*/0));
+  EXPECT_EQ(ir, fresh_ir);
+}
+
+TEST_F(ImportRoutinesTest, RemoveModule) {
+  ImportData import_data;
+  std::vector<std::string> search_paths = {path().string()};
+  XLS_ASSERT_OK_AND_ASSIGN(std::string fresh_ir,
+                           TypecheckAndConvert(kMain, /*threads=*/0));
+  const ModuleInfo* lib_a = nullptr;
+  for (int64_t i = 0; i < 3; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(TypecheckedModule tm,
+                             ParseAndTypecheck(kMain, "main.x", "main",
+                                               &import_data, search_paths));
+    XLS_ASSERT_OK_AND_ASSIGN(std::string ir,
+                             ConvertModule(tm.module, &import_data));
+    EXPECT_EQ(ir, fresh_ir);
+
+    // The imported modules are reused.
+    XLS_ASSERT_OK_AND_ASSIGN(const ModuleInfo* info,
+                             import_data.Get(ImportTokens({"par_lib_a"})));
+    if (lib_a != nullptr) {
+      EXPECT_EQ(info, lib_a);
+    }
+    lib_a = info;
+
+    EXPECT_THAT(import_data.Remove(ImportTokens({"par_util"})),
+                StatusIs(absl::StatusCode::kFailedPrecondition,
+                         HasSubstr("is imported by")));
+    XLS_ASSERT_OK(import_data.Remove(ImportTokens({"main"})));
+    EXPECT_FALSE(import_data.Contains(ImportTokens({"main"})));
+  }
+  EXPECT_THAT(import_data.Remove(ImportTokens({"main"})),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace xls::dslx
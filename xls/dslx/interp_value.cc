@@ -129,6 +129,9 @@ bool InterpValue::Eq(const InterpValue& other) const {
   auto values_equal = [&] {
     const std::vector<InterpValue>& lhs = GetValuesOrDie();
     const std::vector<InterpValue>& rhs = other.GetValuesOrDie();
+    if (&lhs == &rhs) {
+      return true;  // Copies of the same value share their elements.
+    }
     if (lhs.size() != rhs.size()) {
       return false;
     }
@@ -246,13 +246,13 @@ class InterpValue {
   InterpValueTag tag() const { return tag_; }
 
   absl::StatusOr<const std::vector<InterpValue>*> GetValues() const {
-    if (!absl::holds_alternative<std::vector<InterpValue>>(payload_)) {
+    if (!HasValues()) {
       return absl::InvalidArgumentError("Value does not hold element values");
     }
-    return &absl::get<std::vector<InterpValue>>(payload_);
+    return absl::get<ValuesPtr>(payload_).get();
   }
   const std::vector<InterpValue>& GetValuesOrDie() const {
-    return absl::get<std::vector<InterpValue>>(payload_);
+    return *absl::get<ValuesPtr>(payload_);
   }
   absl::StatusOr<const FnData*> GetFunction() const {
     if (!absl::holds_alternative<FnData>(payload_)) {
@@ -273,7 +273,7 @@ class InterpValue {
   // apply to enum values as well.
   bool HasBits() const { return absl::holds_alternative<Bits>(payload_); }
   bool HasValues() const {
-    return absl::holds_alternative<std::vector<InterpValue>>(payload_);
+    return absl::holds_alternative<ValuesPtr>(payload_);
   }
 
   bool IsToken() const { return tag_ == InterpValueTag::kToken; }
@@ -289,11 +289,20 @@ class InterpValue {
   //
   // TODO(leary): 2020-02-10 When all Python bindings are eliminated we can more
   // easily make an interpreter scoped lifetime that InterpValues can live in.
-  using Payload = absl::variant<Bits, std::vector<InterpValue>, FnData,
-                                std::shared_ptr<TokenData>>;
+  //
+  // The elements of aggregates (tuples and arrays) are immutable and shared by
+  // all copies of the value, so copying an aggregate, as the interpreter does
+  // when binding names, passing arguments or indexing into an enclosing
+  // aggregate, doesn't copy (or allocate) its elements.
+  using ValuesPtr = std::shared_ptr<const std::vector<InterpValue>>;
+  using Payload =
+      absl::variant<Bits, ValuesPtr, FnData, std::shared_ptr<TokenData>>;
 
   InterpValue(InterpValueTag tag, Payload payload, EnumDef* type = nullptr)
       : tag_(tag), payload_(std::move(payload)), type_(type) {}
+  InterpValue(InterpValueTag tag, std::vector<InterpValue> values)
+      : InterpValue(tag, std::make_shared<const std::vector<InterpValue>>(
+                             std::move(values))) {}
 
   using CompareF = bool (*)(const Bits& lhs, const Bits& rhs);
 
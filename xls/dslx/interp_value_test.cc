@@ -0,0 +1,52 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/interp_value.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls::dslx {
+namespace {
+
+TEST(InterpValueTest, CopiesShareElements) {
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue array,
+                           InterpValue::MakeArray({InterpValue::MakeU32(1),
+                                                   InterpValue::MakeU32(2)}));
+  InterpValue tuple = InterpValue::MakeTuple({array, InterpValue::MakeU32(3)});
+
+  InterpValue copy = tuple;
+  EXPECT_EQ(&copy.GetValuesOrDie(), &tuple.GetValuesOrDie());
+  EXPECT_EQ(&copy.GetValuesOrDie()[0].GetValuesOrDie(),
+            &array.GetValuesOrDie());
+  EXPECT_TRUE(copy.Eq(tuple));
+}
+
+TEST(InterpValueTest, UpdateDoesNotModifyOriginal) {
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue array,
+                           InterpValue::MakeArray({InterpValue::MakeU32(1),
+                                                   InterpValue::MakeU32(2)}));
+  InterpValue copy = array;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      InterpValue updated,
+      copy.Update(InterpValue::MakeU32(1), InterpValue::MakeU32(42)));
+  EXPECT_TRUE(array.GetValuesOrDie()[1].Eq(InterpValue::MakeU32(2)));
+  EXPECT_TRUE(copy.GetValuesOrDie()[1].Eq(InterpValue::MakeU32(2)));
+  EXPECT_TRUE(updated.GetValuesOrDie()[1].Eq(InterpValue::MakeU32(42)));
+  EXPECT_FALSE(updated.Eq(array));
+}
+
+}  // namespace
+}  // namespace xls::dslx
@@ -14,8 +14,11 @@
 
 #include "xls/dslx/interpreter.h"
 
+#include <mutex>  // NOLINT
+
 #include "xls/common/status/ret_check.h"
 #include "xls/dslx/builtins.h"
+#include "xls/dslx/bytecode.h"
 #include "xls/dslx/evaluate.h"
 
 namespace xls::dslx {
@@ -118,7 +121,7 @@ class AbstractInterpreterAdapter : public AbstractInterpreter {
 Interpreter::Interpreter(Module* entry_module, TypecheckFn typecheck,
                          absl::Span<std::string const> additional_search_paths,
                          ImportData* import_data, bool trace_all,
-                         Package* ir_package)
+                         Package* ir_package, bool use_bytecode)
     : entry_module_(entry_module),
       current_type_info_(import_data->GetRootTypeInfo(entry_module).value()),
       typecheck_(std::move(typecheck)),
@@ -127,6 +130,7 @@ Interpreter::Interpreter(Module* entry_module, TypecheckFn typecheck,
       import_data_(import_data),
       trace_all_(trace_all),
       ir_package_(ir_package),
+      use_bytecode_(use_bytecode && !trace_all),
       abstract_adapter_(absl::make_unique<AbstractInterpreterAdapter>(this)) {}
 
 absl::StatusOr<InterpValue> Interpreter::RunFunction(
@@ -150,8 +154,14 @@ absl::Status Interpreter::RunTest(absl::string_view name) {
   InterpBindings bindings(/*parent=*/top_level_bindings);
   bindings.set_fn_ctx(
       FnCtx{entry_module_->name(), absl::StrFormat("%s__test", name)});
-  XLS_ASSIGN_OR_RETURN(InterpValue result, Evaluate(test->body(), &bindings,
-                                                    /*type_context=*/nullptr));
+  absl::StatusOr<InterpValue> result_or;
+  if (const BytecodeFunction* bytecode =
+          use_bytecode_ ? GetBytecode(test->fn()) : nullptr) {
+    result_or = RunBytecodeFunction(*bytecode, /*args=*/{}, *bindings.fn_ctx());
+  } else {
+    result_or = Evaluate(test->body(), &bindings, /*type_context=*/nullptr);
+  }
+  XLS_ASSIGN_OR_RETURN(InterpValue result, result_or);
   if (!result.IsNilTuple()) {
     return absl::InternalError(absl::StrFormat(
         "EvaluateError: Want test %s to return nil tuple; got: %s",
@@ -198,6 +208,7 @@ absl::StatusOr<InterpValue> Interpreter::Evaluate(Expr* expr,
   XLS_VLOG(3) << "InterpretExpr: " << expr->ToString() << " env: {"
               << absl::StrJoin(env, ", ", absl::PairFormatter(":")) << "}";
 
+  std::lock_guard<std::recursive_mutex> lock(import_data->interpreter_mutex());
   Interpreter interp(entry_module, typecheck, additional_search_paths,
                      import_data);
   XLS_ASSIGN_OR_RETURN(const InterpBindings* top_level_bindings,
@@ -342,15 +353,56 @@ absl::Status Interpreter::RunJitComparison(
   return absl::OkStatus();
 }
 
+const BytecodeFunction* Interpreter::GetBytecode(Function* f) {
+  auto it = bytecode_.find(f);
+  if (it == bytecode_.end()) {
+    absl::StatusOr<std::unique_ptr<BytecodeFunction>> bytecode =
+        BytecodeFunction::Create(f, abstract_adapter_.get());
+    if (!bytecode.ok()) {
+      XLS_VLOG(2) << "Evaluating the AST of " << f->identifier()
+                  << ", as it can't be compiled to bytecode: "
+                  << bytecode.status();
+    }
+    it = bytecode_
+             .emplace(f, bytecode.ok() ? std::move(bytecode).value() : nullptr)
+             .first;
+  }
+  return it->second.get();
+}
+
+absl::StatusOr<InterpValue> Interpreter::RunBytecodeFunction(
+    const BytecodeFunction& f, absl::Span<const InterpValue> args,
+    const FnCtx& fn_ctx) {
+  return RunBytecode(
+      f, args,
+      [this, &fn_ctx](Invocation* invocation, const InterpValue& callee,
+                      absl::Span<const InterpValue> args) {
+        return CallInvocation(invocation, callee, args, fn_ctx);
+      });
+}
+
 absl::StatusOr<InterpValue> Interpreter::EvaluateAndCompareInternal(
     Function* f, absl::Span<const InterpValue> args, const Span& span,
     Invocation* invocation, const SymbolicBindings* symbolic_bindings) {
-  XLS_ASSIGN_OR_RETURN(
-      InterpValue interpreter_value,
-      EvaluateFunction(f, args, span,
-                       symbolic_bindings == nullptr ? SymbolicBindings()
-                                                    : *symbolic_bindings,
-                       abstract_adapter_.get()));
+  // Bytecode is compiled with the root type information of the function's
+  // module, so it can't run a parametric instantiation.
+  const BytecodeFunction* bytecode = nullptr;
+  if (use_bytecode_ && !f->IsParametric() &&
+      current_type_info_ == import_data_->GetRootTypeInfo(f->owner()).value()) {
+    bytecode = GetBytecode(f);
+  }
+  absl::StatusOr<InterpValue> interpreter_value_or;
+  if (bytecode != nullptr) {
+    interpreter_value_or = RunBytecodeFunction(
+        *bytecode, args,
+        FnCtx{f->owner()->name(), f->identifier(), SymbolicBindings()});
+  } else {
+    interpreter_value_or = EvaluateFunction(
+        f, args, span,
+        symbolic_bindings == nullptr ? SymbolicBindings() : *symbolic_bindings,
+        abstract_adapter_.get());
+  }
+  XLS_ASSIGN_OR_RETURN(InterpValue interpreter_value, interpreter_value_or);
 
   XLS_RETURN_IF_ERROR(RunJitComparison(f, args, symbolic_bindings));
 
@@ -388,18 +440,25 @@ absl::StatusOr<InterpValue> Interpreter::EvaluateInvocation(
     return InterpValue::MakeNil();
   }
 
+  return CallInvocation(expr, callee_value, arg_values, bindings->fn_ctx());
+}
+
+absl::StatusOr<InterpValue> Interpreter::CallInvocation(
+    Invocation* expr, const InterpValue& callee_value,
+    absl::Span<const InterpValue> arg_values,
+    const absl::optional<FnCtx>& fn_ctx) {
   const SymbolicBindings* fn_symbolic_bindings = nullptr;
-  if (bindings->fn_ctx().has_value()) {
+  if (fn_ctx.has_value()) {
     // The symbolic bindings of this invocation were already computed during
     // typechecking.
     absl::optional<const SymbolicBindings*> callee_bindings =
-        current_type_info_->GetInvocationSymbolicBindings(
-            expr, bindings->fn_ctx()->sym_bindings);
+        current_type_info_->GetInvocationSymbolicBindings(expr,
+                                                          fn_ctx->sym_bindings);
     if (!callee_bindings.has_value()) {
       return absl::NotFoundError(
           absl::StrFormat("Could not find callee bindings in type info for "
                           "FnCtx: %s expr: %s @ %s",
-                          bindings->fn_ctx()->ToString(), expr->ToString(),
+                          fn_ctx->ToString(), expr->ToString(),
                           expr->span().ToString()));
     }
     XLS_RET_CHECK(callee_bindings.value() != nullptr);
@@ -17,6 +17,7 @@
 
 #include "xls/dslx/abstract_interpreter.h"
 #include "xls/dslx/ast.h"
+#include "xls/dslx/bytecode.h"
 #include "xls/dslx/import_routines.h"
 #include "xls/dslx/interp_bindings.h"
 #include "xls/dslx/interp_value.h"
@@ -75,10 +76,13 @@ class Interpreter {
   //    the interpreter evaluation.
   //  ir_package: IR-converted form of the given module, used for JIT execution
   //    engine comparison purposes when provided.
+  //  use_bytecode: Whether to run the (non-parametric) functions and tests
+  //    that can be compiled to bytecode (see bytecode.h) on its virtual
+  //    machine rather than evaluating their AST; ignored with trace_all.
   Interpreter(Module* entry_module, TypecheckFn typecheck,
               absl::Span<std::string const> additional_search_paths,
               ImportData* import_data, bool trace_all = false,
-              Package* ir_package = nullptr);
+              Package* ir_package = nullptr, bool use_bytecode = false);
 
   // Since we capture pointers to "this" in lambdas, we don't want this object
   // to move/copy/assign.
@@ -147,6 +151,25 @@ class Interpreter {
                                                  InterpBindings* bindings,
                                                  ConcreteType* type_context);
 
+  // Returns the bytecode of "f" (compiling it on first use), or nullptr if it
+  // can't be compiled and must be evaluated from its AST.
+  const BytecodeFunction* GetBytecode(Function* f);
+
+  // Runs the bytecode "f" on "args", where "fn_ctx" is the context of its
+  // function.
+  absl::StatusOr<InterpValue> RunBytecodeFunction(
+      const BytecodeFunction& f, absl::Span<const InterpValue> args,
+      const FnCtx& fn_ctx);
+
+  // Calls "callee_value", the value of the callee of "expr", on "arg_values"
+  // with the symbolic bindings and type information of the invocation, where
+  // "fn_ctx" is the context of the function the invocation is in (nullopt when
+  // it's not in a function, e.g. in a module-level constant).
+  absl::StatusOr<InterpValue> CallInvocation(
+      Invocation* expr, const InterpValue& callee_value,
+      absl::Span<const InterpValue> arg_values,
+      const absl::optional<FnCtx>& fn_ctx);
+
   // Wraps function evaluation to compare with JIT execution.
   //
   // If this interpreter was not created with an IR package, this simply
@@ -231,6 +254,11 @@ class Interpreter {
   ImportData* import_data_;
   bool trace_all_;
   Package* ir_package_;
+  bool use_bytecode_;
+
+  // Bytecode of the functions run so far; null for those that can't be
+  // compiled.
+  absl::flat_hash_map<Function*, std::unique_ptr<BytecodeFunction>> bytecode_;
 
   std::unique_ptr<AbstractInterpreter> abstract_adapter_;
 
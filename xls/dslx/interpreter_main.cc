@@ -15,17 +15,25 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/time/time.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
+#include "xls/common/thread.h"
 #include "xls/dslx/builtins.h"
 #include "xls/dslx/command_line_utils.h"
 #include "xls/dslx/error_printer.h"
 #include "xls/dslx/interpreter.h"
 #include "xls/dslx/ir_converter.h"
+#include "xls/dslx/jit_test_runner.h"
 #include "xls/dslx/parse_and_typecheck.h"
 #include "xls/dslx/parser.h"
 #include "xls/dslx/scanner.h"
@@ -37,12 +45,33 @@ ABSL_FLAG(std::string, dslx_path, "",
 ABSL_FLAG(bool, trace_all, false, "Trace every expression.");
 ABSL_FLAG(bool, compare_jit, true,
           "Compare interpreted and JIT execution of each function.");
+ABSL_FLAG(bool, run_tests_on_jit, true,
+          "Run unit tests by converting them to IR and running them on the JIT "
+          "where possible, rather than interpreting them. Tests that may fail "
+          "dynamically, e.g. by indexing an array out of bounds, are always "
+          "interpreted.");
+ABSL_FLAG(bool, use_bytecode, true,
+          "Interpret the functions that can be compiled to bytecode on its "
+          "virtual machine rather than by walking their AST.");
+ABSL_FLAG(int64_t, quickcheck_threads, 0,
+          "Number of threads to run quickcheck samples on; 0 for one per "
+          "core. Results don't depend on the number of threads.");
 ABSL_FLAG(
     int64_t, seed, 0,
     "Seed for quickcheck random stimulus; 0 for an nondetermistic value.");
 // TODO(leary): 2021-01-19 allow filters with wildcards.
 ABSL_FLAG(std::string, test_filter, "",
           "Target (currently *single*) test name to run.");
+ABSL_FLAG(std::string, typecheck_cache_dir, "",
+          "Directory of an on-disk cache of typechecked imported modules "
+          "and the values of their constants; the cache is not used if "
+          "empty.");
+ABSL_FLAG(int64_t, typecheck_threads, 0,
+          "Number of additional threads used to typecheck independent "
+          "imported modules in parallel; 0 typechecks them serially.");
+ABSL_FLAG(int64_t, jobs, 1,
+          "Number of unit tests to run on the JIT concurrently; 0 for one per "
+          "core. Tests which must be interpreted are run one at a time.");
 
 namespace xls::dslx {
 namespace {
@@ -60,8 +89,69 @@ bool TestMatchesFilter(absl::string_view test_name,
   return test_name == *test_filter;
 }
 
+// The result of a unit test and how long it took to run.
+struct TestResult {
+  absl::Status status;
+  absl::Duration duration;
+};
+
+// Runs the unit tests "test_names" of "module" which can run on the JIT (see
+// RunTestOnJit()) on "jobs" threads. Returns the results by test, with nullopt
+// for the tests which must be interpreted.
+//
+// As converting a test to IR modifies "package" (and the type information of
+// the module), the tests are all converted up front on this thread; only
+// jitting and running them is concurrent.
+absl::StatusOr<std::vector<absl::optional<TestResult>>> RunTestsOnJitInParallel(
+    Module* module, absl::Span<const std::string> test_names,
+    ImportData* import_data, Package* package, int64_t jobs) {
+  std::vector<absl::optional<TestResult>> results(test_names.size());
+  std::vector<std::pair<int64_t, JitTest>> jit_tests;
+  for (int64_t i = 0; i < test_names.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(TestFunction * test, module->GetTest(test_names[i]));
+    absl::Time start = absl::Now();
+    absl::StatusOr<absl::optional<JitTest>> jit_test =
+        PrepareTestForJit(test, import_data, package);
+    if (!jit_test.ok()) {
+      results[i] = TestResult{jit_test.status(), absl::Now() - start};
+    } else if (jit_test->has_value()) {
+      jit_tests.push_back({i, std::move(**jit_test)});
+    }
+  }
+
+  if (jobs <= 0) {
+    jobs = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  }
+  // Each thread writes the results of the tests it claims.
+  std::atomic<int64_t> next_test(0);
+  auto run_tests = [&]() {
+    for (int64_t j = next_test++; j < jit_tests.size(); j = next_test++) {
+      const auto& [i, jit_test] = jit_tests[j];
+      absl::Time start = absl::Now();
+      absl::StatusOr<std::unique_ptr<IrJit>> jit =
+          IrJit::Create(jit_test.converted.function);
+      if (!jit.ok()) {
+        XLS_VLOG(1) << "Interpreting test " << test_names[i]
+                    << ": it can't be jitted: " << jit.status();
+        continue;
+      }
+      absl::Status status = RunJitTest(jit_test, jit.value().get());
+      results[i] = TestResult{status, absl::Now() - start};
+    }
+  };
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 0; t < std::min<int64_t>(jobs, jit_tests.size()); ++t) {
+    threads.push_back(absl::make_unique<Thread>(run_tests));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  return results;
+}
+
 absl::Status RunQuickCheck(Interpreter* interp, Package* ir_package,
-                           QuickCheck* quickcheck, int64_t seed) {
+                           QuickCheck* quickcheck, int64_t seed,
+                           int64_t num_threads) {
   Function* fn = quickcheck->f();
   XLS_ASSIGN_OR_RETURN(
       std::string ir_name,
@@ -70,21 +160,25 @@ absl::Status RunQuickCheck(Interpreter* interp, Package* ir_package,
   XLS_ASSIGN_OR_RETURN(xls::Function * ir_function,
                        ir_package->GetFunction(ir_name));
 
-  using ResultT =
-      std::pair<std::vector<std::vector<Value>>, std::vector<Value>>;
-  XLS_ASSIGN_OR_RETURN(
-      ResultT result,
-      CreateAndQuickCheck(ir_function, seed, quickcheck->test_count()));
-  const auto& [argsets, results] = result;
-  XLS_ASSIGN_OR_RETURN(Bits last_result, results.back().GetBitsWithStatus());
-  if (!last_result.IsZero()) {
+  XLS_ASSIGN_OR_RETURN(QuickCheckResult result,
+                       ParallelQuickCheck(ir_function, seed,
+                                          quickcheck->test_count(),
+                                          num_threads));
+  double seconds = absl::ToDoubleSeconds(result.elapsed);
+  std::cerr << absl::StreamFormat(
+                   "[ QUICKCHECK RATE       ] %d samples in %s; %.0f "
+                   "samples/sec",
+                   result.samples, absl::FormatDuration(result.elapsed),
+                   seconds > 0 ? result.samples / seconds : 0.0)
+            << std::endl;
+  if (!result.counterexample.has_value()) {
     // Did not find a falsifying example.
     return absl::OkStatus();
   }
 
   XLS_RET_CHECK_EQ(interp->current_type_info()->module(),
                    interp->entry_module());
-  const std::vector<Value>& last_argset = argsets.back();
+  const std::vector<Value>& last_argset = *result.counterexample;
   XLS_ASSIGN_OR_RETURN(
       FunctionType * fn_type,
       interp->current_type_info()->GetItemAs<FunctionType>(fn));
@@ -105,7 +199,7 @@ absl::Status RunQuickCheck(Interpreter* interp, Package* ir_package,
   return FailureErrorStatus(
       fn->span(),
       absl::StrFormat("Found falsifying example after %d tests: [%s]",
-                      results.size(), dslx_argset_str));
+                      result.counterexample_index + 1, dslx_argset_str));
 }
 
 // Parses program and run all tests contained inside.
@@ -120,7 +214,19 @@ absl::Status RunQuickCheck(Interpreter* interp, Package* ir_package,
 //   trace_all: Whether or not to trace all expressions.
 //   compare_jit: Whether or not to assert equality between interpreted and
 //     JIT'd function return values.
+//   run_tests_on_jit: Whether to run unit tests on the JIT where possible (see
+//     RunTestOnJit()); tests are interpreted when tracing all expressions.
+//   use_bytecode: Whether the interpreter runs functions as bytecode where
+//     possible.
 //   seed: Seed for QuickCheck random input stimulus.
+//   quickcheck_threads: Number of threads to run QuickCheck samples on (one
+//     per core if zero).
+//   typecheck_cache_dir: Directory of the typecheck cache for imported
+//     modules, or empty to not use one.
+//   typecheck_threads: Number of additional threads to typecheck imported
+//     modules with.
+//   jobs: Number of unit tests to run on the JIT concurrently (one per core if
+//     zero).
 //
 // Returns:
 //   Whether any test failed (as a boolean).
@@ -129,7 +235,10 @@ absl::StatusOr<bool> ParseAndTest(
     absl::string_view filename, absl::Span<const std::string> dslx_paths,
     absl::optional<absl::string_view> test_filter = absl::nullopt,
     bool trace_all = false, bool compare_jit = true,
-    absl::optional<int64_t> seed = absl::nullopt) {
+    bool run_tests_on_jit = true, bool use_bytecode = true,
+    absl::optional<int64_t> seed = absl::nullopt,
+    int64_t quickcheck_threads = 0, absl::string_view typecheck_cache_dir = "",
+    int64_t typecheck_threads = 0, int64_t jobs = 1) {
   int64_t ran = 0;
   int64_t failed = 0;
   int64_t skipped = 0;
@@ -137,7 +246,9 @@ absl::StatusOr<bool> ParseAndTest(
   constexpr int kUnitSpaces = 7;
   constexpr int kQuickcheckSpaces = 15;
   auto handle_error = [&](const absl::Status& status,
-                          absl::string_view test_name, bool is_quickcheck) {
+                          absl::string_view test_name, bool is_quickcheck,
+                          absl::optional<absl::Duration> duration =
+                              absl::nullopt) {
     XLS_VLOG(1) << "Handling error; status: " << status
                 << " test_name: " << test_name;
     absl::StatusOr<PositionalErrorData> data_or =
@@ -153,6 +264,9 @@ absl::StatusOr<bool> ParseAndTest(
       XLS_LOG(ERROR) << "Internal error: " << status;
       suffix = absl::StrCat(": internal error: ", status.ToString());
     }
+    if (duration.has_value()) {
+      absl::StrAppend(&suffix, " (", absl::FormatDuration(*duration), ")");
+    }
     std::string spaces((is_quickcheck ? kQuickcheckSpaces : kUnitSpaces), ' ');
     std::cerr << absl::StreamFormat("[ %sFAILED ] %s%s", spaces, test_name,
                                     suffix)
@@ -161,6 +275,12 @@ absl::StatusOr<bool> ParseAndTest(
   };
 
   ImportData import_data;
+  if (!typecheck_cache_dir.empty()) {
+    import_data.EnableTypecheckCache(std::string(typecheck_cache_dir));
+  }
+  if (typecheck_threads > 0) {
+    import_data.EnableParallelTypecheck(typecheck_threads);
+  }
   absl::StatusOr<TypecheckedModule> tm_or = ParseAndTypecheck(
       program, filename, module_name, &import_data, dslx_paths);
   if (!tm_or.ok()) {
@@ -171,12 +291,27 @@ absl::StatusOr<bool> ParseAndTest(
   }
   Module* entry_module = tm_or.value().module;
 
+  run_tests_on_jit = run_tests_on_jit && !trace_all;
   std::unique_ptr<Package> ir_package;
   if (compare_jit) {
     XLS_ASSIGN_OR_RETURN(ir_package,
                          ConvertModuleToPackage(entry_module, &import_data,
                                                 /*emit_positions=*/true,
                                                 /*traverse_tests=*/true));
+  } else if (run_tests_on_jit) {
+    // Running tests on the JIT is only an optimization: if the module can't be
+    // converted, the tests are interpreted.
+    absl::StatusOr<std::unique_ptr<Package>> ir_package_or =
+        ConvertModuleToPackage(entry_module, &import_data,
+                               /*emit_positions=*/true,
+                               /*traverse_tests=*/true);
+    if (ir_package_or.ok()) {
+      ir_package = std::move(ir_package_or).value();
+    } else {
+      XLS_VLOG(1) << "Interpreting tests, module can't be converted to IR: "
+                  << ir_package_or.status();
+      run_tests_on_jit = false;
+    }
   }
 
   auto typecheck_callback = [&import_data, &dslx_paths](Module* module) {
@@ -185,22 +320,58 @@ absl::StatusOr<bool> ParseAndTest(
 
   Interpreter interpreter(entry_module, typecheck_callback, dslx_paths,
                           &import_data, /*trace_all=*/trace_all,
-                          /*ir_package=*/ir_package.get());
+                          /*ir_package=*/compare_jit ? ir_package.get()
+                                                     : nullptr,
+                          /*use_bytecode=*/use_bytecode);
 
   // Run unit tests.
+  std::vector<std::string> test_names;
   for (const std::string& test_name : entry_module->GetTestNames()) {
     if (!TestMatchesFilter(test_name, test_filter)) {
       skipped += 1;
       continue;
     }
+    test_names.push_back(test_name);
+  }
+
+  // With several jobs, the tests which can run on the JIT all run before any
+  // are reported, and the interpreted ones run as they're reported.
+  std::vector<absl::optional<TestResult>> parallel_results;
+  if (run_tests_on_jit && jobs != 1) {
+    XLS_ASSIGN_OR_RETURN(parallel_results,
+                         RunTestsOnJitInParallel(entry_module, test_names,
+                                                 &import_data,
+                                                 ir_package.get(), jobs));
+  }
 
+  for (int64_t i = 0; i < test_names.size(); ++i) {
+    const std::string& test_name = test_names[i];
     ran += 1;
     std::cerr << "[ RUN UNITTEST  ] " << test_name << std::endl;
-    absl::Status status = interpreter.RunTest(test_name);
-    if (status.ok()) {
-      std::cerr << "[            OK ]" << std::endl;
+    absl::Time start = absl::Now();
+    absl::optional<TestResult> result;
+    if (!parallel_results.empty()) {
+      result = parallel_results[i];
+    } else if (run_tests_on_jit) {
+      XLS_ASSIGN_OR_RETURN(TestFunction * test,
+                           entry_module->GetTest(test_name));
+      if (absl::optional<absl::Status> jit_status =
+              RunTestOnJit(test, &import_data, ir_package.get())) {
+        result = TestResult{*jit_status, absl::Now() - start};
+      }
+    }
+    if (!result.has_value()) {
+      start = absl::Now();
+      absl::Status status = interpreter.RunTest(test_name);
+      result = TestResult{status, absl::Now() - start};
+    }
+    if (result->status.ok()) {
+      std::cerr << absl::StreamFormat("[            OK ] %s (%s)", test_name,
+                                      absl::FormatDuration(result->duration))
+                << std::endl;
     } else {
-      handle_error(status, test_name, /*is_quickcheck=*/false);
+      handle_error(result->status, test_name, /*is_quickcheck=*/false,
+                   result->duration);
     }
   }
 
@@ -225,8 +396,9 @@ absl::StatusOr<bool> ParseAndTest(
       const std::string& test_name = quickcheck->identifier();
       std::cerr << "[ RUN QUICKCHECK        ] " << test_name
                 << " count: " << quickcheck->test_count() << std::endl;
-      absl::Status status =
-          RunQuickCheck(&interpreter, ir_package.get(), quickcheck, *seed);
+      absl::Status status = RunQuickCheck(&interpreter, ir_package.get(),
+                                          quickcheck, *seed,
+                                          quickcheck_threads);
       if (!status.ok()) {
         handle_error(status, test_name, /*is_quickcheck=*/true);
       } else {
@@ -245,14 +417,20 @@ absl::StatusOr<bool> ParseAndTest(
 absl::Status RealMain(absl::string_view entry_module_path,
                       absl::Span<const std::string> dslx_paths,
                       absl::optional<std::string> test_filter, bool trace_all,
-                      bool compare_jit, absl::optional<int64_t> seed,
+                      bool compare_jit, bool run_tests_on_jit,
+                      bool use_bytecode, absl::optional<int64_t> seed,
+                      int64_t quickcheck_threads,
+                      absl::string_view typecheck_cache_dir,
+                      int64_t typecheck_threads, int64_t jobs,
                       bool* printed_error) {
   XLS_ASSIGN_OR_RETURN(std::string program, GetFileContents(entry_module_path));
   XLS_ASSIGN_OR_RETURN(std::string module_name, PathToName(entry_module_path));
   XLS_ASSIGN_OR_RETURN(
       *printed_error,
       ParseAndTest(program, module_name, entry_module_path, dslx_paths,
-                   test_filter, trace_all, compare_jit, seed));
+                   test_filter, trace_all, compare_jit, run_tests_on_jit,
+                   use_bytecode, seed, quickcheck_threads, typecheck_cache_dir,
+                   typecheck_threads, jobs));
   return absl::OkStatus();
 }
 
@@ -289,7 +467,12 @@ int main(int argc, char* argv[]) {
   bool printed_error = false;
   absl::Status status =
       xls::dslx::RealMain(args[0], dslx_paths, test_filter, trace_all,
-                          compare_jit, seed, &printed_error);
+                          compare_jit, absl::GetFlag(FLAGS_run_tests_on_jit),
+                          absl::GetFlag(FLAGS_use_bytecode), seed,
+                          absl::GetFlag(FLAGS_quickcheck_threads),
+                          absl::GetFlag(FLAGS_typecheck_cache_dir),
+                          absl::GetFlag(FLAGS_typecheck_threads),
+                          absl::GetFlag(FLAGS_jobs), &printed_error);
   if (printed_error) {
     return EXIT_FAILURE;
   }
@@ -14,15 +14,22 @@
 
 #include "xls/dslx/ir_converter.h"
 
+#include <deque>
+
 #include "absl/status/status.h"
 #include "absl/strings/str_replace.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/variant.h"
+#include "xls/common/thread.h"
 #include "xls/dslx/ast.h"
 #include "xls/dslx/deduce_ctx.h"
 #include "xls/dslx/dslx_builtins.h"
 #include "xls/dslx/extract_conversion_order.h"
 #include "xls/dslx/interpreter.h"
+#include "xls/dslx/typecheck_cache.h"
+#include "xls/ir/ir_parser.h"
 #include "xls/ir/lsb_or_msb.h"
+#include "xls/ir/value_helpers.h"
 
 namespace xls::dslx {
 namespace {
@@ -63,6 +70,18 @@ class FunctionConverter {
   // participate in the IR conversion).
   void AddConstantDep(ConstantDef* constant_def);
 
+  // Puts the converter in test mode, for converting the function of a test:
+  // the assertions (invocations of assert_eq, assert_lt and fail!) that are
+  // statements of its body are recorded rather than converted, and the built
+  // function returns a tuple holding a tuple of the arguments of each, see
+  // ConvertTestToFunction().
+  void EnableTestMode() { test_mode_ = true; }
+
+  // The assertions recorded in test mode, in evaluation order.
+  const std::vector<Invocation*>& test_assertions() const {
+    return test_assertions_;
+  }
+
  private:
   // Helper class used for dispatching to IR conversion methods.
   friend class FunctionConverterVisitor;
@@ -214,6 +233,11 @@ class FunctionConverter {
   absl::Status HandleStructInstance(StructInstance* node);
   absl::Status HandleColonRef(ColonRef* node);
   absl::Status HandleConstantDef(ConstantDef* node);
+
+  // Returns the value of the module-level constant "node" if it has already
+  // been computed, by the interpreter in this process or (via the typecheck
+  // cache) by a previous one, so that its expression needn't be converted.
+  absl::optional<Value> GetEvaluatedConstant(ConstantDef* node);
   absl::Status HandleLet(Let* node);
   absl::Status HandleCast(Cast* node);
   absl::Status HandleMatch(Match* node);
@@ -396,6 +420,14 @@ class FunctionConverter {
   // The last expression emitted as part of IR conversion, used to help
   // determine which expression produces the return value.
   Expr* last_expression_ = nullptr;
+
+  // Test mode state (see EnableTestMode()): the statements of the test body,
+  // i.e. the right hand sides of its chain of lets and the final expression,
+  // and the recorded assertions with the tuples of their arguments.
+  bool test_mode_ = false;
+  absl::flat_hash_set<Expr*> test_statements_;
+  std::vector<Invocation*> test_assertions_;
+  std::vector<BValue> test_assertion_args_;
 };
 
 // For all free variables of "node", adds them transitively for any required
@@ -791,9 +823,46 @@ absl::Status FunctionConverter::HandleNameRef(NameRef* node) {
   return DefAlias(ToAstNode(node->name_def()), /*to=*/node).status();
 }
 
+absl::optional<Value> FunctionConverter::GetEvaluatedConstant(
+    ConstantDef* node) {
+  Module* module = node->owner();
+  absl::StatusOr<ConstantDef*> top_level =
+      module->GetConstantDef(node->identifier());
+  if (!top_level.ok() || *top_level != node) {
+    // A "let const", which may depend on the function's parameters.
+    return absl::nullopt;
+  }
+  absl::optional<InterpValue> value;
+  if (import_data_->IsTopLevelBindingsDone(module)) {
+    absl::StatusOr<InterpValue> bound =
+        import_data_->GetOrCreateTopLevelBindings(module)
+            .ResolveValueFromIdentifier(node->identifier());
+    if (bound.ok()) {
+      value = std::move(bound).value();
+    }
+  }
+  if (!value.has_value() && import_data_->typecheck_cache() != nullptr) {
+    value = import_data_->typecheck_cache()->LoadConstant(module,
+                                                          node->identifier());
+  }
+  if (!value.has_value()) {
+    return absl::nullopt;
+  }
+  absl::StatusOr<Value> ir_value = InterpValueToValue(*value);
+  if (!ir_value.ok()) {
+    return absl::nullopt;
+  }
+  return std::move(ir_value).value();
+}
+
 absl::Status FunctionConverter::HandleConstantDef(ConstantDef* node) {
-  XLS_VLOG(5) << "Visiting ConstantDef expr: " << node->value()->ToString();
-  XLS_RETURN_IF_ERROR(Visit(node->value()));
+  if (absl::optional<Value> value = GetEvaluatedConstant(node)) {
+    XLS_VLOG(5) << "Using evaluated value of constant: " << node->identifier();
+    DefConst(node->value(), *std::move(value));
+  } else {
+    XLS_VLOG(5) << "Visiting ConstantDef expr: " << node->value()->ToString();
+    XLS_RETURN_IF_ERROR(Visit(node->value()));
+  }
   XLS_VLOG(5) << "Aliasing NameDef for constant: "
               << node->name_def()->ToString();
   return DefAlias(node->value(), /*to=*/node->name_def()).status();
@@ -1377,6 +1446,30 @@ absl::Status FunctionConverter::HandleInvocation(Invocation* node) {
     return absl::OkStatus();
   }
 
+  // In test mode, assertions are left for the caller to check. They must be
+  // statements of the test body to be unconditionally evaluated, in order.
+  // trace! is rejected as its output couldn't be ordered with the assertions.
+  if (test_mode_ && (called_name == "assert_eq" || called_name == "assert_lt" ||
+                     called_name == "fail!" || called_name == "trace!")) {
+    if (called_name == "trace!" || !test_statements_.contains(node)) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "ConversionError: %s Cannot convert %s in a test unless it is a "
+          "statement of the test body",
+          node->span().ToString(), called_name));
+    }
+    XLS_ASSIGN_OR_RETURN(std::vector<BValue> args, accept_args());
+    test_assertions_.push_back(node);
+    test_assertion_args_.push_back(function_builder_->Tuple(args));
+    Def(node, [&](absl::optional<SourceLocation> loc) {
+      // fail! has the type of its argument, the assertions produce nil.
+      if (called_name == "fail!") {
+        return function_builder_->Identity(args[0], loc);
+      }
+      return function_builder_->Tuple({}, loc);
+    });
+    return absl::OkStatus();
+  }
+
   // A few builtins are handled specially.
   if (called_name == "fail!" || called_name == "trace!") {
     XLS_ASSIGN_OR_RETURN(std::vector<BValue> args, accept_args());
@@ -1473,6 +1566,15 @@ absl::StatusOr<xls::Function*> FunctionConverter::HandleFunction(
     XLS_RETURN_IF_ERROR(Visit(dep));
   }
 
+  if (test_mode_) {
+    Expr* statement = node->body();
+    while (auto* let = dynamic_cast<Let*>(statement)) {
+      test_statements_.insert(let->rhs());
+      statement = let->body();
+    }
+    test_statements_.insert(statement);
+  }
+
   XLS_VLOG(5) << "body: " << node->body()->ToString();
   XLS_RETURN_IF_ERROR(Visit(node->body()));
   auto* last_expression =
@@ -1487,7 +1589,13 @@ absl::StatusOr<xls::Function*> FunctionConverter::HandleFunction(
       return function_builder_->Identity(last_value, loc);
     });
   }
-  XLS_ASSIGN_OR_RETURN(xls::Function * f, function_builder_->Build());
+  xls::Function* f;
+  if (test_mode_) {
+    BValue args = function_builder_->Tuple(test_assertion_args_);
+    XLS_ASSIGN_OR_RETURN(f, function_builder_->BuildWithReturnValue(args));
+  } else {
+    XLS_ASSIGN_OR_RETURN(f, function_builder_->Build());
+  }
   XLS_VLOG(5) << "Built function: " << f->name();
   XLS_RETURN_IF_ERROR(VerifyFunction(f));
   return f;
@@ -2196,8 +2304,362 @@ absl::Status ConvertOneFunctionInternal(
   return absl::OkStatus();
 }
 
+// Returns the text of the definitions, other than functions and tests, of
+// "module" and of the modules it transitively imports, which the IR conversion
+// of its functions may depend on. Results are memoized in "environments".
+absl::StatusOr<std::string> GetModuleEnvironment(
+    Module* module, ImportData* import_data,
+    absl::flat_hash_map<Module*, std::string>* environments) {
+  if (auto it = environments->find(module); it != environments->end()) {
+    return it->second;
+  }
+  XLS_ASSIGN_OR_RETURN(TypeInfo * type_info,
+                       import_data->GetRootTypeInfo(module));
+  std::string environment = absl::StrCat("module ", module->name(), "\n");
+  for (const ModuleMember& member : module->top()) {
+    if (absl::holds_alternative<Function*>(member) ||
+        absl::holds_alternative<TestFunction*>(member) ||
+        absl::holds_alternative<QuickCheck*>(member)) {
+      continue;
+    }
+    absl::StrAppend(&environment, ToAstNode(member)->ToString(), "\n");
+    if (Import* const* import = absl::get_if<Import*>(&member)) {
+      absl::optional<const ImportedInfo*> imported =
+          type_info->GetImported(*import);
+      XLS_RET_CHECK(imported.has_value()) << (*import)->ToString();
+      XLS_ASSIGN_OR_RETURN(std::string imported_environment,
+                           GetModuleEnvironment((*imported)->module,
+                                                import_data, environments));
+      absl::StrAppend(&environment, imported_environment);
+    }
+  }
+  environments->emplace(module, environment);
+  return environment;
+}
+
+// Appends to "key" the spans of "node" and the nodes under it, which the
+// positions in its IR are taken from.
+void AppendSpans(AstNode* node, std::string* key) {
+  if (absl::optional<Span> span = node->GetSpan()) {
+    absl::StrAppend(key, " ", span->ToString());
+  }
+  for (AstNode* child : node->GetChildren(/*want_types=*/false)) {
+    AppendSpans(child, key);
+  }
+}
+
+// Returns the key of "record" in a ConversionCache (see its description);
+// "record_ids" holds the cache entry ids of the (previously converted)
+// callees, by function and bindings.
+absl::StatusOr<std::string> GetConversionCacheKey(
+    const ConversionRecord& record, ImportData* import_data,
+    bool emit_positions,
+    absl::flat_hash_map<Module*, std::string>* environments,
+    const absl::flat_hash_map<std::pair<Function*, std::string>, int64_t>&
+        record_ids) {
+  XLS_ASSIGN_OR_RETURN(std::string environment,
+                       GetModuleEnvironment(record.m, import_data,
+                                            environments));
+  std::string key =
+      absl::StrCat(environment, "fn ", record.bindings.ToString(), "\n",
+                   record.f->ToString(), "\n");
+  if (emit_positions) {
+    // The text of the function doesn't change when it's moved, but its
+    // positions do.
+    absl::StrAppend(&key, "positions");
+    AppendSpans(record.f, &key);
+    absl::StrAppend(&key, "\n");
+  }
+  absl::StrAppend(&key, "callees");
+  for (const Callee& callee : record.callees) {
+    auto it = record_ids.find({callee.f(), callee.sym_bindings().ToString()});
+    XLS_RET_CHECK(it != record_ids.end()) << callee.ToString();
+    absl::StrAppend(&key, " ", it->second);
+  }
+  return key;
+}
+
+// Adds the functions of the conversion cache entry "entry" to "package".
+absl::Status AddFunctionsFromCache(const ConversionCache::Entry& entry,
+                                   Package* package) {
+  for (const std::string& text : entry.functions) {
+    XLS_ASSIGN_OR_RETURN(xls::Function * f,
+                         Parser::ParseFunction(text, package));
+    // The parsed nodes keep their ids, which later nodes must not reuse.
+    for (Node* node : f->nodes()) {
+      package->set_next_node_id(
+          std::max(package->next_node_id(), node->id() + 1));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Returns the IR text of the functions of "package" from index "first" on.
+std::vector<std::string> DumpFunctions(Package* package, int64_t first) {
+  std::vector<std::string> functions;
+  for (int64_t i = first; i < package->functions().size(); ++i) {
+    functions.push_back(package->functions()[i]->DumpIr());
+  }
+  return functions;
+}
+
+// Returns the function of "package" which "callee" was converted to.
+absl::StatusOr<xls::Function*> GetConvertedCallee(const Callee& callee,
+                                                  Package* package) {
+  XLS_ASSIGN_OR_RETURN(
+      std::string name,
+      MangleDslxName(callee.f()->identifier(),
+                     callee.f()->GetFreeParametricKeySet(), callee.m(),
+                     &callee.sym_bindings()));
+  return package->GetFunction(name);
+}
+
+// Adds to "scratch" a function with the name and type of "callee", a function
+// of another package, for invocations converted into "scratch" to refer to.
+absl::Status AddCalleeStub(xls::Function* callee, Package* scratch) {
+  FunctionBuilder fb(callee->name(), scratch);
+  for (xls::Param* param : callee->params()) {
+    XLS_ASSIGN_OR_RETURN(xls::Type * type,
+                         scratch->MapTypeFromOtherPackage(param->GetType()));
+    fb.Param(param->GetName(), type);
+  }
+  XLS_ASSIGN_OR_RETURN(
+      xls::Type * return_type,
+      scratch->MapTypeFromOtherPackage(callee->return_value()->GetType()));
+  return fb.BuildWithReturnValue(fb.Literal(ZeroOfType(return_type))).status();
+}
+
+// Converts the function instances of "order" into "package" on "threads"
+// threads. Each instance is converted into a scratch package of its own, with
+// stubs standing for the functions it calls, once those have been converted.
+// The scratch packages are then merged into "package" in the conversion order
+// (with the invocations of the stubs redirected to the functions they stand
+// for), so the package is the same whatever the timing of the conversions,
+// though its node ids differ from those of a serial conversion.
+absl::Status ConvertInParallel(absl::Span<const ConversionRecord> order,
+                               Package* package, ImportData* import_data,
+                               bool emit_positions, ConversionCache* cache,
+                               int64_t threads) {
+  struct Conversion {
+    // The functions of "package" which the instance calls, for which the
+    // scratch package starts with stubs.
+    std::vector<xls::Function*> callees;
+    // The instance is taken from this entry of the cache if non-null.
+    const ConversionCache::Entry* cache_entry = nullptr;
+    std::string cache_key;
+    // Whether the instance is converted directly into "package" when merged,
+    // rather than on a thread.
+    bool serial = false;
+    // The scratch package, once converted.
+    absl::optional<absl::StatusOr<std::unique_ptr<Package>>> result;
+  };
+  std::vector<Conversion> conversions(order.size());
+
+  // An instance can be converted once the last of its callees in the
+  // conversion order has been merged.
+  std::vector<std::vector<int64_t>> ready_after_merge(order.size());
+  std::vector<int64_t> ready;
+  absl::flat_hash_map<std::pair<Function*, std::string>, int64_t> indices;
+  for (int64_t i = 0; i < order.size(); ++i) {
+    int64_t last_callee = -1;
+    for (const Callee& callee : order[i].callees) {
+      auto it = indices.find({callee.f(), callee.sym_bindings().ToString()});
+      if (it != indices.end()) {
+        last_callee = std::max(last_callee, it->second);
+      }
+    }
+    if (last_callee == -1) {
+      ready.push_back(i);
+    } else {
+      ready_after_merge[last_callee].push_back(i);
+    }
+    indices[{order[i].f, order[i].bindings.ToString()}] = i;
+  }
+
+  // The instances ready to be converted, and the results of the conversions,
+  // are passed between the threads under "mutex".
+  struct WorkQueue {
+    absl::Mutex mutex;
+    std::deque<int64_t> queue ABSL_GUARDED_BY(mutex);
+    bool done ABSL_GUARDED_BY(mutex) = false;
+  };
+  WorkQueue work_queue;
+  absl::Mutex& mutex = work_queue.mutex;
+  auto convert = [&](int64_t i) -> absl::StatusOr<std::unique_ptr<Package>> {
+    const ConversionRecord& record = order[i];
+    auto scratch = absl::make_unique<Package>(package->name());
+    for (xls::Function* callee : conversions[i].callees) {
+      XLS_RETURN_IF_ERROR(AddCalleeStub(callee, scratch.get()));
+    }
+    XLS_RETURN_IF_ERROR(ConvertOneFunctionInternal(
+        scratch.get(), record.m, record.f, record.type_info, import_data,
+        &record.bindings, emit_positions));
+    return std::move(scratch);
+  };
+  auto work = [&]() {
+    while (true) {
+      int64_t i;
+      {
+        absl::MutexLock lock(&mutex);
+        mutex.Await(absl::Condition(
+            +[](WorkQueue* q) ABSL_EXCLUSIVE_LOCKS_REQUIRED(q->mutex) {
+              return q->done || !q->queue.empty();
+            },
+            &work_queue));
+        if (work_queue.queue.empty()) {
+          return;
+        }
+        i = work_queue.queue.front();
+        work_queue.queue.pop_front();
+      }
+      XLS_VLOG(3) << "Converting to IR: " << order[i].ToString();
+      absl::StatusOr<std::unique_ptr<Package>> result = convert(i);
+      absl::MutexLock lock(&mutex);
+      conversions[i].result = std::move(result);
+    }
+  };
+  std::vector<std::unique_ptr<Thread>> workers;
+  for (int64_t t = 0; t < std::min<int64_t>(threads, order.size()); ++t) {
+    workers.push_back(absl::make_unique<Thread>(work));
+  }
+  auto join_workers = [&]() {
+    {
+      absl::MutexLock lock(&mutex);
+      work_queue.done = true;
+    }
+    for (std::unique_ptr<Thread>& worker : workers) {
+      worker->Join();
+    }
+  };
+
+  // Called for an instance whose callees have all been merged.
+  absl::flat_hash_map<Module*, std::string> environments;
+  absl::flat_hash_map<std::pair<Function*, std::string>, int64_t> record_ids;
+  auto schedule = [&](int64_t i) -> absl::Status {
+    const ConversionRecord& record = order[i];
+    Conversion& conversion = conversions[i];
+    if (cache != nullptr) {
+      XLS_ASSIGN_OR_RETURN(
+          conversion.cache_key,
+          GetConversionCacheKey(record, import_data, emit_positions,
+                                &environments, record_ids));
+      conversion.cache_entry = cache->Lookup(conversion.cache_key);
+      if (conversion.cache_entry != nullptr) {
+        return absl::OkStatus();
+      }
+    }
+    for (const Callee& callee : record.callees) {
+      absl::StatusOr<xls::Function*> f = GetConvertedCallee(callee, package);
+      if (!f.ok()) {
+        // Leave the error to the serial conversion.
+        conversion.serial = true;
+        return absl::OkStatus();
+      }
+      conversion.callees.push_back(f.value());
+    }
+    absl::MutexLock lock(&mutex);
+    work_queue.queue.push_back(i);
+    return absl::OkStatus();
+  };
+
+  // Called for the instances in order, once converted.
+  auto merge = [&](int64_t i) -> absl::Status {
+    const ConversionRecord& record = order[i];
+    Conversion& conversion = conversions[i];
+    if (conversion.cache_entry != nullptr) {
+      XLS_VLOG(3) << "Taking IR from the conversion cache: "
+                  << record.ToString();
+      XLS_RETURN_IF_ERROR(
+          AddFunctionsFromCache(*conversion.cache_entry, package));
+      record_ids[{record.f, record.bindings.ToString()}] =
+          conversion.cache_entry->id;
+      return absl::OkStatus();
+    }
+    int64_t function_count = package->functions().size();
+    if (!conversion.serial && !conversion.result->ok()) {
+      // An instance may fail to convert on its own (e.g. when it calls a
+      // function which isn't among its callees), so any error is that of a
+      // serial conversion.
+      XLS_VLOG(3) << "Converting serially after error: "
+                  << conversion.result->status();
+      conversion.serial = true;
+    }
+    if (conversion.serial) {
+      XLS_RETURN_IF_ERROR(ConvertOneFunctionInternal(
+          package, record.m, record.f, record.type_info, import_data,
+          &record.bindings, emit_positions));
+    } else {
+      Package* scratch = conversion.result->value().get();
+      absl::flat_hash_map<const xls::Function*, xls::Function*> remapping;
+      for (int64_t j = 0; j < scratch->functions().size(); ++j) {
+        xls::Function* f = scratch->functions()[j].get();
+        xls::Function* merged;
+        if (j < conversion.callees.size()) {
+          merged = conversion.callees[j];
+        } else if (package->HasFunctionWithName(f->name())) {
+          // Functions implementing a mapped builtin are made by every
+          // conversion which needs them.
+          XLS_ASSIGN_OR_RETURN(merged, package->GetFunction(f->name()));
+        } else {
+          XLS_ASSIGN_OR_RETURN(merged, f->Clone(f->name(), package, remapping));
+        }
+        remapping[f] = merged;
+      }
+      conversion.result.reset();
+    }
+    if (cache != nullptr) {
+      record_ids[{record.f, record.bindings.ToString()}] =
+          cache
+              ->Insert(std::move(conversion.cache_key),
+                       DumpFunctions(package, function_count))
+              ->id;
+    }
+    return absl::OkStatus();
+  };
+
+  absl::Status status;
+  for (int64_t i : ready) {
+    status.Update(schedule(i));
+  }
+  for (int64_t i = 0; i < order.size() && status.ok(); ++i) {
+    Conversion& conversion = conversions[i];
+    if (conversion.cache_entry == nullptr && !conversion.serial) {
+      absl::MutexLock lock(&mutex);
+      mutex.Await(absl::Condition(
+          +[](Conversion* c) { return c->result.has_value(); }, &conversion));
+    }
+    status.Update(merge(i));
+    for (int64_t j : ready_after_merge[i]) {
+      if (status.ok()) {
+        status.Update(schedule(j));
+      }
+    }
+  }
+  join_workers();
+  return status;
+}
+
 }  // namespace
 
+const ConversionCache::Entry* ConversionCache::Lookup(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  return &it->second;
+}
+
+const ConversionCache::Entry* ConversionCache::Insert(
+    std::string key, std::vector<std::string> functions) {
+  int64_t id = entries_.size();
+  auto [it, inserted] = entries_.emplace(
+      std::move(key), Entry{id, std::move(functions)});
+  XLS_CHECK(inserted);
+  return &it->second;
+}
+
 absl::StatusOr<std::string> MangleDslxName(
     absl::string_view function_name,
     const absl::btree_set<std::string>& free_keys, Module* module,
@@ -2231,7 +2693,7 @@ absl::StatusOr<std::string> MangleDslxName(
 
 absl::StatusOr<std::unique_ptr<Package>> ConvertModuleToPackage(
     Module* module, ImportData* import_data, bool emit_positions,
-    bool traverse_tests) {
+    bool traverse_tests, ConversionCache* cache, int64_t threads) {
   XLS_ASSIGN_OR_RETURN(TypeInfo * root_type_info,
                        import_data->GetRootTypeInfo(module));
   XLS_ASSIGN_OR_RETURN(std::vector<ConversionRecord> order,
@@ -2244,11 +2706,47 @@ absl::StatusOr<std::unique_ptr<Package>> ConvertModuleToPackage(
                      })
               << "]";
   auto package = absl::make_unique<Package>(module->name());
+  // The positions of the functions converted into scratch packages, or taken
+  // from the cache, refer to the file by the number it has in every package.
+  if (emit_positions) {
+    package->GetOrCreateFileno("fake_file.x");
+  }
+  if (threads > 0) {
+    XLS_RETURN_IF_ERROR(ConvertInParallel(order, package.get(), import_data,
+                                          emit_positions, cache, threads));
+    XLS_VLOG(3) << "Verifying converted package";
+    XLS_RETURN_IF_ERROR(VerifyPackage(package.get()));
+    return std::move(package);
+  }
+
+  absl::flat_hash_map<Module*, std::string> environments;
+  absl::flat_hash_map<std::pair<Function*, std::string>, int64_t> record_ids;
   for (const ConversionRecord& record : order) {
+    std::string key;
+    if (cache != nullptr) {
+      XLS_ASSIGN_OR_RETURN(
+          key, GetConversionCacheKey(record, import_data, emit_positions,
+                                     &environments, record_ids));
+      if (const ConversionCache::Entry* entry = cache->Lookup(key)) {
+        XLS_VLOG(3) << "Taking IR from the conversion cache: "
+                    << record.ToString();
+        XLS_RETURN_IF_ERROR(AddFunctionsFromCache(*entry, package.get()));
+        record_ids[{record.f, record.bindings.ToString()}] = entry->id;
+        continue;
+      }
+    }
+
     XLS_VLOG(3) << "Converting to IR: " << record.ToString();
+    int64_t function_count = package->functions().size();
     XLS_RETURN_IF_ERROR(ConvertOneFunctionInternal(
         package.get(), record.m, record.f, record.type_info, import_data,
         &record.bindings, emit_positions));
+    if (cache != nullptr) {
+      record_ids[{record.f, record.bindings.ToString()}] =
+          cache->Insert(std::move(key), DumpFunctions(package.get(),
+                                                      function_count))
+              ->id;
+    }
   }
 
   XLS_VLOG(3) << "Verifying converted package";
@@ -2258,13 +2756,36 @@ absl::StatusOr<std::unique_ptr<Package>> ConvertModuleToPackage(
 
 absl::StatusOr<std::string> ConvertModule(Module* module,
                                           ImportData* import_data,
-                                          bool emit_positions) {
+                                          bool emit_positions,
+                                          int64_t threads) {
   XLS_ASSIGN_OR_RETURN(
       std::unique_ptr<Package> package,
-      ConvertModuleToPackage(module, import_data, emit_positions));
+      ConvertModuleToPackage(module, import_data, emit_positions,
+                             /*traverse_tests=*/false, /*cache=*/nullptr,
+                             threads));
   return package->DumpIr();
 }
 
+absl::StatusOr<ConvertedTest> ConvertTestToFunction(Package* package,
+                                                    TestFunction* test,
+                                                    ImportData* import_data,
+                                                    bool emit_positions) {
+  Module* module = test->owner();
+  XLS_ASSIGN_OR_RETURN(TypeInfo * type_info,
+                       import_data->GetRootTypeInfo(module));
+  FunctionConverter converter(package, module, import_data, emit_positions);
+  XLS_ASSIGN_OR_RETURN(auto constant_deps,
+                       GetConstantDepFreevars(test->body()));
+  for (const auto& dep : constant_deps) {
+    converter.AddConstantDep(dep);
+  }
+  converter.EnableTestMode();
+  XLS_ASSIGN_OR_RETURN(xls::Function * f,
+                       converter.HandleFunction(test->fn(), type_info,
+                                                /*symbolic_bindings=*/nullptr));
+  return ConvertedTest{f, converter.test_assertions()};
+}
+
 absl::StatusOr<std::string> ConvertOneFunction(
     Module* module, absl::string_view entry_function_name, TypeInfo* type_info,
     ImportData* import_data, const SymbolicBindings* symbolic_bindings,
@@ -16,8 +16,11 @@
 #define XLS_DSLX_IR_CONVERTER_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "xls/dslx/ast.h"
 #include "xls/dslx/builtins.h"
 #include "xls/dslx/import_routines.h"
@@ -34,6 +37,41 @@ absl::StatusOr<std::string> MangleDslxName(
     const absl::btree_set<std::string>& free_keys, Module* module,
     const SymbolicBindings* symbolic_bindings = nullptr);
 
+// Caches the IR conversion of function instances between calls of
+// ConvertModuleToPackage(), so that converting a module again after some of
+// its functions changed only converts those functions (and their callers).
+//
+// A function instance is keyed by its text, its parametric bindings, the other
+// (non-function) definitions of its module and of the modules it transitively
+// imports, and the keys of its callees; and, when positions are emitted, by
+// the spans of its nodes, so a function that moved is reconverted. Its IR is
+// kept as text, so it can be added to any package.
+class ConversionCache {
+ public:
+  struct Entry {
+    // Unique within the cache; stands for the entry in the keys of callers.
+    int64_t id;
+    // The IR text of the functions the instance converted to, in order (e.g.
+    // the bodies of its counted-for loops come before the function itself).
+    std::vector<std::string> functions;
+  };
+
+  // Returns the entry for "key", or nullptr if there is none.
+  const Entry* Lookup(const std::string& key);
+
+  // Adds an entry for "key", which must not have one yet.
+  const Entry* Insert(std::string key, std::vector<std::string> functions);
+
+  // Number of Lookup() calls that found (resp. did not find) an entry.
+  int64_t hits() const { return hits_; }
+  int64_t misses() const { return misses_; }
+
+ private:
+  absl::flat_hash_map<std::string, Entry> entries_;
+  int64_t hits_ = 0;
+  int64_t misses_ = 0;
+};
+
 // Converts the contents of a module to IR form.
 //
 // Args:
@@ -43,17 +81,25 @@ absl::StatusOr<std::string> MangleDslxName(
 //   traverse_tests: Whether to convert functions called in DSLX test
 //   constructs.
 //     Note that this does NOT convert the test constructs themselves.
+//   cache: If given, function instances are taken from the cache when
+//     unchanged since a previous conversion, and added to it otherwise.
+//   threads: If positive, independent function instances are converted
+//     concurrently on this many threads. The resulting package is the same
+//     on every run, but its node ids differ from those of a serial
+//     conversion.
 //
 // Returns:
 //   The IR package that corresponds to this module.
 absl::StatusOr<std::unique_ptr<Package>> ConvertModuleToPackage(
     Module* module, ImportData* import_data, bool emit_positions = true,
-    bool traverse_tests = false);
+    bool traverse_tests = false, ConversionCache* cache = nullptr,
+    int64_t threads = 0);
 
 // Wrapper around ConvertModuleToPackage that converts to IR text.
 absl::StatusOr<std::string> ConvertModule(Module* module,
                                           ImportData* import_data,
-                                          bool emit_positions = true);
+                                          bool emit_positions = true,
+                                          int64_t threads = 0);
 
 // Converts a single function into its emitted text form.
 //
@@ -78,6 +124,29 @@ absl::StatusOr<std::string> ConvertOneFunction(
     ImportData* import_data, const SymbolicBindings* symbolic_bindings,
     bool emit_positions);
 
+// The IR conversion of a DSLX test, see ConvertTestToFunction().
+struct ConvertedTest {
+  xls::Function* function;
+  // The assertions (invocations of assert_eq, assert_lt and fail!) of the test,
+  // in evaluation order.
+  std::vector<Invocation*> assertions;
+};
+
+// Converts the function of "test" into "package", which must hold the IR
+// conversion of its module with traverse_tests (see ConvertModuleToPackage()).
+//
+// The IR has no way to report a failing assertion, so the assertions are not
+// converted; instead, the converted function returns a tuple holding, for each
+// assertion, the tuple of its arguments, for the caller to check. Returns an
+// Unimplemented error if the test can't be converted this way, i.e. when it
+// uses trace! or an assertion is nested in an expression rather than being a
+// statement of the test body (one of its lets or its final expression), as it
+// might not be evaluated.
+absl::StatusOr<ConvertedTest> ConvertTestToFunction(Package* package,
+                                                    TestFunction* test,
+                                                    ImportData* import_data,
+                                                    bool emit_positions = true);
+
 // Converts an interpreter value to an IR value.
 absl::StatusOr<Value> InterpValueToValue(const InterpValue& v);
 
@@ -31,6 +31,16 @@ ABSL_FLAG(std::string, entry, "",
           "are converted.");
 ABSL_FLAG(std::string, dslx_path, "",
           "Additional paths to search for modules (colon delimited).");
+ABSL_FLAG(std::string, typecheck_cache_dir, "",
+          "Directory of an on-disk cache of typechecked imported modules "
+          "and the values of their constants; the cache is not used if "
+          "empty.");
+ABSL_FLAG(int64_t, typecheck_threads, 0,
+          "Number of additional threads used to typecheck independent "
+          "imported modules in parallel; 0 typechecks them serially.");
+ABSL_FLAG(int64_t, conversion_threads, 0,
+          "Number of threads used to convert independent functions to IR "
+          "concurrently; 0 converts them serially.");
 
 namespace xls::dslx {
 namespace {
@@ -77,6 +87,8 @@ absl::StatusOr<std::string> PathToName(absl::string_view path) {
 absl::Status RealMain(absl::string_view path,
                       absl::optional<absl::string_view> entry,
                       absl::Span<const std::string> dslx_paths,
+                      absl::string_view typecheck_cache_dir,
+                      int64_t typecheck_threads, int64_t conversion_threads,
                       bool* printed_error) {
   XLS_ASSIGN_OR_RETURN(std::string text, GetFileContents(path));
 
@@ -86,6 +98,12 @@ absl::Status RealMain(absl::string_view path,
                                  /*filename=*/path, printed_error));
 
   ImportData import_data;
+  if (!typecheck_cache_dir.empty()) {
+    import_data.EnableTypecheckCache(std::string(typecheck_cache_dir));
+  }
+  if (typecheck_threads > 0) {
+    import_data.EnableParallelTypecheck(typecheck_threads);
+  }
   absl::StatusOr<TypeInfo*> type_info_or =
       CheckModule(module.get(), &import_data, dslx_paths);
   if (!type_info_or.ok()) {
@@ -102,7 +120,10 @@ absl::Status RealMain(absl::string_view path,
                                       /*symbolic_bindings=*/nullptr,
                                       /*emit_positions=*/true));
   } else {
-    XLS_ASSIGN_OR_RETURN(converted, ConvertModule(module.get(), &import_data));
+    XLS_ASSIGN_OR_RETURN(converted,
+                         ConvertModule(module.get(), &import_data,
+                                       /*emit_positions=*/true,
+                                       conversion_threads));
   }
   std::cout << converted;
 
@@ -128,7 +149,11 @@ int main(int argc, char* argv[]) {
   }
   bool printed_error = false;
   absl::Status status =
-      xls::dslx::RealMain(args[0], entry, dslx_paths, &printed_error);
+      xls::dslx::RealMain(args[0], entry, dslx_paths,
+                          absl::GetFlag(FLAGS_typecheck_cache_dir),
+                          absl::GetFlag(FLAGS_typecheck_threads),
+                          absl::GetFlag(FLAGS_conversion_threads),
+                          &printed_error);
   if (printed_error) {
     return EXIT_FAILURE;
   }
@@ -23,12 +23,16 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/get_runfile_path.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/status/matchers.h"
 #include "xls/common/update_golden_files.inc"
 #include "xls/dslx/parse_and_typecheck.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/verifier.h"
 
 ABSL_FLAG(std::string, xls_source_dir, "",
           "Absolute path to root of XLS source directory to modify when "
@@ -1502,6 +1506,160 @@ fn main(x: u32) -> u32 {
   ExpectIr(converted, TestName());
 }
 
+TEST(IrConverterTest, ConversionCacheReconvertsChangedFunctions) {
+  constexpr char kProgram[] = R"(
+fn double(x: u32) -> u32 { x + x }
+
+fn triple(x: u32) -> u32 { x + x + x }
+
+fn sum(x: u32) -> u32 {
+  for (i, acc): (u32, u32) in range(u32:0, u32:4) {
+    acc + i
+  }(x)
+}
+
+fn main(x: u32) -> u32 { double(x) + sum(x) }
+)";
+  auto convert = [](absl::string_view program,
+                    ConversionCache* cache) -> absl::StatusOr<std::string> {
+    ImportData import_data;
+    XLS_ASSIGN_OR_RETURN(
+        TypecheckedModule tm,
+        ParseAndTypecheck(program, "test_module.x", "test_module",
+                          &import_data, /*additional_search_paths=*/{}));
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<Package> package,
+        ConvertModuleToPackage(tm.module, &import_data,
+                               /*emit_positions=*/true,
+                               /*traverse_tests=*/false, cache));
+    return package->DumpIr();
+  };
+
+  ConversionCache cache;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string uncached, convert(kProgram, nullptr));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string first, convert(kProgram, &cache));
+  EXPECT_EQ(first, uncached);
+  EXPECT_EQ(cache.hits(), 0);
+  EXPECT_EQ(cache.misses(), 4);
+
+  // Converting the same program again takes every function from the cache.
+  XLS_ASSERT_OK_AND_ASSIGN(std::string second, convert(kProgram, &cache));
+  EXPECT_EQ(second, uncached);
+  EXPECT_EQ(cache.hits(), 4);
+  EXPECT_EQ(cache.misses(), 4);
+
+  // Changing a function reconverts it and its callers only.
+  std::string changed = absl::StrReplaceAll(
+      kProgram, {{"fn double(x: u32) -> u32 { x + x }",
+                  "fn double(x: u32) -> u32 { x * u32:2 }"}});
+  XLS_ASSERT_OK_AND_ASSIGN(std::string third, convert(changed, &cache));
+  EXPECT_EQ(cache.hits(), 6);
+  EXPECT_EQ(cache.misses(), 6);
+  EXPECT_THAT(third, testing::HasSubstr("umul"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(third));
+  XLS_EXPECT_OK(VerifyPackage(package.get()));
+}
+
+TEST(IrConverterTest, ConversionCacheReconvertsMovedFunctions) {
+  constexpr char kProgram[] = R"(
+fn double(x: u32) -> u32 { x + x }
+)";
+  auto convert = [](absl::string_view program, ConversionCache* cache)
+      -> absl::StatusOr<std::unique_ptr<Package>> {
+    ImportData import_data;
+    XLS_ASSIGN_OR_RETURN(
+        TypecheckedModule tm,
+        ParseAndTypecheck(program, "test_module.x", "test_module",
+                          &import_data, /*additional_search_paths=*/{}));
+    return ConvertModuleToPackage(tm.module, &import_data,
+                                  /*emit_positions=*/true,
+                                  /*traverse_tests=*/false, cache);
+  };
+
+  ConversionCache cache;
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> first,
+                           convert(kProgram, &cache));
+  EXPECT_THAT(first->DumpIr(), testing::HasSubstr("pos=0,1,"));
+
+  // Inserting a line above the (unchanged) function shifts its positions.
+  std::string moved = absl::StrCat("\n", kProgram);
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> uncached,
+                           convert(moved, nullptr));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> second,
+                           convert(moved, &cache));
+  EXPECT_EQ(cache.misses(), 2);
+  std::string second_ir = second->DumpIr();
+  EXPECT_EQ(second_ir, uncached->DumpIr());
+  EXPECT_THAT(second_ir, testing::HasSubstr("pos=0,2,"));
+  EXPECT_THAT(second_ir, testing::Not(testing::HasSubstr("pos=0,1,")));
+
+  // Converting the moved program again takes the function from the cache,
+  // and registers the file its positions refer to.
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> third,
+                           convert(moved, &cache));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(third->DumpIr(), uncached->DumpIr());
+  EXPECT_THAT(third->GetFilenames(), testing::ElementsAre("fake_file.x"));
+}
+
+TEST(IrConverterTest, ParallelConversionMatchesSerial) {
+  constexpr char kProgram[] = R"(
+fn double(x: u32) -> u32 { x + x }
+
+fn id<N: u32>(x: bits[N]) -> bits[N] { x }
+
+fn sum(x: u32) -> u32 {
+  for (i, acc): (u32, u32) in range(u32:0, u32:4) {
+    acc + double(i)
+  }(x)
+}
+
+fn lz(x: u8[2]) -> u8[2] { map(x, clz) }
+
+fn lz_again(x: u8[2]) -> u8[2] { map(x, clz) }
+
+fn main(x: u32) -> u32 {
+  let y = id(double(x)) + sum(x);
+  let _ = lz([u8:1, u8:2]);
+  let _ = lz_again([u8:3, u8:4]);
+  y + id(u32:1) + (id(u16:2) as u32)
+}
+)";
+  auto convert = [&](int64_t threads) -> absl::StatusOr<std::string> {
+    ImportData import_data;
+    XLS_ASSIGN_OR_RETURN(
+        TypecheckedModule tm,
+        ParseAndTypecheck(kProgram, "test_module.x", "test_module",
+                          &import_data, /*additional_search_paths=*/{}));
+    return ConvertModule(tm.module, &import_data, /*emit_positions=*/true,
+                         threads);
+  };
+  // The node ids of a parallel conversion differ, so compare the packages by
+  // the values of their functions.
+  XLS_ASSERT_OK_AND_ASSIGN(std::string serial, convert(0));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> serial_package,
+                           Parser::ParsePackage(serial));
+  for (int64_t threads : {1, 4}) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::string parallel, convert(threads));
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> parallel_package,
+                             Parser::ParsePackage(parallel));
+    XLS_EXPECT_OK(VerifyPackage(parallel_package.get()));
+    ASSERT_EQ(parallel_package->functions().size(),
+              serial_package->functions().size());
+    for (int64_t i = 0; i < serial_package->functions().size(); ++i) {
+      xls::Function* want = serial_package->functions()[i].get();
+      xls::Function* got = parallel_package->functions()[i].get();
+      EXPECT_EQ(got->name(), want->name());
+      EXPECT_EQ(got->GetType()->ToString(), want->GetType()->ToString());
+      EXPECT_EQ(got->node_count(), want->node_count()) << want->name();
+    }
+    // The output doesn't depend on the timing of the conversions.
+    XLS_ASSERT_OK_AND_ASSIGN(std::string again, convert(threads));
+    EXPECT_EQ(again, parallel);
+  }
+}
+
 }  // namespace
 }  // namespace xls::dslx
 
@@ -0,0 +1,266 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/jit_test_runner.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/dslx/builtins.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/function.h"
+#include "xls/ir/nodes.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls::dslx {
+namespace {
+
+bool IsEffectfulBuiltin(absl::string_view name) {
+  return name == "assert_eq" || name == "assert_lt" || name == "fail!" ||
+         name == "trace!";
+}
+
+// Returns whether a function referred to from "node" (of the module with type
+// information "type_info") transitively refers to a builtin with an effect. If
+// "in_callee" is set, "node" itself is in such a function, so also checks
+// whether it refers to one.
+bool CallsEffectfulBuiltin(AstNode* node, TypeInfo* type_info, bool in_callee,
+                           absl::flat_hash_set<Function*>* visited) {
+  auto visit_function = [&](Function* f, TypeInfo* f_type_info) {
+    if (!visited->insert(f).second) {
+      return false;
+    }
+    return CallsEffectfulBuiltin(f->body(), f_type_info, /*in_callee=*/true,
+                                 visited);
+  };
+
+  if (auto* name_ref = dynamic_cast<NameRef*>(node)) {
+    AnyNameDef any_name_def = name_ref->name_def();
+    if (absl::holds_alternative<BuiltinNameDef*>(any_name_def)) {
+      return in_callee && IsEffectfulBuiltin(name_ref->identifier());
+    }
+    absl::optional<Function*> f =
+        node->owner()->GetFunction(name_ref->identifier());
+    if (f.has_value() &&
+        (*f)->name_def() == absl::get<NameDef*>(any_name_def)) {
+      return visit_function(*f, type_info);
+    }
+    return false;
+  }
+  if (auto* colon_ref = dynamic_cast<ColonRef*>(node)) {
+    if (absl::optional<Import*> import = colon_ref->ResolveImportSubject()) {
+      absl::optional<const ImportedInfo*> imported =
+          type_info->GetImported(*import);
+      if (!imported.has_value()) {
+        return true;  // Conservatively, as the callee can't be checked.
+      }
+      if (absl::optional<Function*> f =
+              (*imported)->module->GetFunction(colon_ref->attr())) {
+        return visit_function(*f, (*imported)->type_info);
+      }
+    }
+    return false;
+  }
+  for (AstNode* child : node->GetChildren(/*want_types=*/false)) {
+    if (CallsEffectfulBuiltin(child, type_info, in_callee, visited)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns whether "indices" may be out of bounds for an array of type
+// "type", i.e. whether one of them is not a literal within its dimension.
+bool MayBeOutOfBounds(xls::Type* type, absl::Span<Node* const> indices) {
+  for (Node* index : indices) {
+    if (!index->Is<Literal>() || !type->IsArray()) {
+      return true;
+    }
+    const Bits& bits = index->As<Literal>()->value().bits();
+    xls::ArrayType* array_type = type->AsArrayOrDie();
+    if (bits_ops::UGreaterThanOrEqual(bits, array_type->size())) {
+      return true;
+    }
+    type = array_type->element_type();
+  }
+  return false;
+}
+
+// Returns whether "f" or a function it (transitively) calls may fail when it
+// runs, i.e. whether an array is indexed or updated out of bounds. The
+// interpreter reports these as errors, while in IR the index is clamped or
+// the update dropped, so on the JIT the test would silently pass.
+bool MayFailDynamically(xls::Function* f,
+                        absl::flat_hash_set<xls::Function*>* visited) {
+  if (!visited->insert(f).second) {
+    return false;
+  }
+  for (Node* node : f->nodes()) {
+    xls::Function* callee = nullptr;
+    switch (node->op()) {
+      case Op::kArrayIndex: {
+        ArrayIndex* array_index = node->As<ArrayIndex>();
+        if (MayBeOutOfBounds(array_index->array()->GetType(),
+                             array_index->indices())) {
+          return true;
+        }
+        break;
+      }
+      case Op::kArrayUpdate: {
+        ArrayUpdate* array_update = node->As<ArrayUpdate>();
+        if (MayBeOutOfBounds(array_update->array_to_update()->GetType(),
+                             array_update->indices())) {
+          return true;
+        }
+        break;
+      }
+      case Op::kInvoke:
+        callee = node->As<Invoke>()->to_apply();
+        break;
+      case Op::kMap:
+        callee = node->As<Map>()->to_apply();
+        break;
+      case Op::kCountedFor:
+        callee = node->As<CountedFor>()->body();
+        break;
+      case Op::kDynamicCountedFor:
+        callee = node->As<DynamicCountedFor>()->body();
+        break;
+      default:
+        break;
+    }
+    if (callee != nullptr && MayFailDynamically(callee, visited)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Checks the assertion "invocation", whose arguments evaluated to "args", with
+// the builtin that implements it in the interpreter.
+absl::Status CheckAssertion(Invocation* invocation,
+                            absl::Span<const InterpValue> args) {
+  auto* callee = dynamic_cast<NameRef*>(invocation->callee());
+  XLS_RET_CHECK(callee != nullptr);
+  const std::string& name = callee->identifier();
+  absl::StatusOr<InterpValue> result;
+  if (name == "assert_eq") {
+    result = BuiltinAssertEq(args, invocation->span(), invocation,
+                             /*symbolic_bindings=*/nullptr);
+  } else if (name == "assert_lt") {
+    result = BuiltinAssertLt(args, invocation->span(), invocation,
+                             /*symbolic_bindings=*/nullptr);
+  } else {
+    XLS_RET_CHECK_EQ(name, "fail!");
+    result = BuiltinFail(args, invocation->span(), invocation,
+                         /*symbolic_bindings=*/nullptr);
+  }
+  return result.status();
+}
+
+}  // namespace
+
+absl::StatusOr<absl::optional<JitTest>> PrepareTestForJit(
+    TestFunction* test, ImportData* import_data, Package* package) {
+  XLS_ASSIGN_OR_RETURN(TypeInfo * type_info,
+                       import_data->GetRootTypeInfo(test->owner()));
+
+  absl::flat_hash_set<Function*> visited;
+  if (CallsEffectfulBuiltin(test->body(), type_info, /*in_callee=*/false,
+                            &visited)) {
+    XLS_VLOG(1) << "Interpreting test " << test->identifier()
+                << ": it calls a function with an assertion, fail! or trace!";
+    return absl::nullopt;
+  }
+
+  absl::StatusOr<ConvertedTest> converted_or =
+      ConvertTestToFunction(package, test, import_data);
+  if (!converted_or.ok()) {
+    XLS_VLOG(1) << "Interpreting test " << test->identifier()
+                << ": it can't be converted to IR: " << converted_or.status();
+    return absl::nullopt;
+  }
+  ConvertedTest& converted = converted_or.value();
+  absl::flat_hash_set<xls::Function*> visited_functions;
+  if (MayFailDynamically(converted.function, &visited_functions)) {
+    XLS_VLOG(1) << "Interpreting test " << test->identifier()
+                << ": it may index an array out of bounds";
+    return absl::nullopt;
+  }
+  for (Invocation* assertion : converted.assertions) {
+    for (Expr* arg : assertion->args()) {
+      absl::optional<ConcreteType*> type = type_info->GetItem(arg);
+      if (!type.has_value() || (*type)->HasEnum()) {
+        XLS_VLOG(1) << "Interpreting test " << test->identifier()
+                    << ": assertion operand has an enum type @ "
+                    << arg->span();
+        return absl::nullopt;
+      }
+    }
+  }
+
+  return JitTest{test, type_info, std::move(converted)};
+}
+
+absl::Status RunJitTest(const JitTest& test, IrJit* jit) {
+  XLS_ASSIGN_OR_RETURN(Value result, jit->Run(absl::Span<const Value>()));
+
+  // The result holds the arguments of each assertion, in evaluation order; the
+  // interpreter stops at the first failing one.
+  const std::vector<Invocation*>& assertions = test.converted.assertions;
+  XLS_CHECK_EQ(result.elements().size(), assertions.size());
+  for (int64_t i = 0; i < assertions.size(); ++i) {
+    Invocation* assertion = assertions[i];
+    const Value& arg_values = result.elements()[i];
+    std::vector<InterpValue> args;
+    for (int64_t j = 0; j < assertion->args().size(); ++j) {
+      ConcreteType* type = *test.type_info->GetItem(assertion->args()[j]);
+      XLS_ASSIGN_OR_RETURN(InterpValue arg,
+                           ValueToInterpValue(arg_values.elements()[j], type));
+      args.push_back(std::move(arg));
+    }
+    XLS_RETURN_IF_ERROR(CheckAssertion(assertion, args));
+  }
+  return absl::OkStatus();
+}
+
+absl::optional<absl::Status> RunTestOnJit(TestFunction* test,
+                                          ImportData* import_data,
+                                          Package* package) {
+  absl::StatusOr<absl::optional<JitTest>> prepared =
+      PrepareTestForJit(test, import_data, package);
+  if (!prepared.ok()) {
+    return prepared.status();
+  }
+  if (!prepared->has_value()) {
+    return absl::nullopt;
+  }
+  const JitTest& jit_test = **prepared;
+  absl::StatusOr<std::unique_ptr<IrJit>> jit_or =
+      IrJit::Create(jit_test.converted.function);
+  if (!jit_or.ok()) {
+    XLS_VLOG(1) << "Interpreting test " << test->identifier()
+                << ": it can't be jitted: " << jit_or.status();
+    return absl::nullopt;
+  }
+  return RunJitTest(jit_test, jit_or.value().get());
+}
+
+}  // namespace xls::dslx
@@ -0,0 +1,70 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DSLX_JIT_TEST_RUNNER_H_
+#define XLS_DSLX_JIT_TEST_RUNNER_H_
+
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "xls/dslx/ast.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/ir/package.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls::dslx {
+
+// Runs the DSLX test "test" by converting it to IR (see
+// ConvertTestToFunction()) and running it on the JIT, which is much faster
+// than interpreting it. "package" must hold the IR conversion of the test's
+// module with traverse_tests, into which the test is converted.
+//
+// The assertions of the test are checked with the interpreter's builtins, so a
+// failing test gives the same error, with the same position, as when it's
+// interpreted.
+//
+// Returns nullopt if the test can't be run on the JIT and must be interpreted
+// instead, i.e. when it can't be converted, or a function it (transitively)
+// calls has an assertion, fail! or trace! (which have no effect in IR), or
+// may index or update an array out of bounds (which the interpreter reports
+// as an error, but the IR clamps or drops), or an assertion operand has an
+// enum type (whose values the IR doesn't distinguish from bits).
+absl::optional<absl::Status> RunTestOnJit(TestFunction* test,
+                                          ImportData* import_data,
+                                          Package* package);
+
+// A test converted to IR to be run on the JIT (see PrepareTestForJit()).
+struct JitTest {
+  TestFunction* test;
+  TypeInfo* type_info;
+  ConvertedTest converted;
+};
+
+// The two halves of RunTestOnJit(), through which tests can be converted
+// one at a time and then jitted and run concurrently.
+//
+// PrepareTestForJit() converts "test" into "package". Returns nullopt if the
+// test must be interpreted, or an error which is the result of the test. Must
+// not be called concurrently with itself, or while a JIT is being created for
+// a function of "package".
+absl::StatusOr<absl::optional<JitTest>> PrepareTestForJit(
+    TestFunction* test, ImportData* import_data, Package* package);
+
+// RunJitTest() runs "test" with "jit", a JIT of its converted function, and
+// checks its assertions. May be called concurrently for different tests.
+absl::Status RunJitTest(const JitTest& test, IrJit* jit);
+
+}  // namespace xls::dslx
+
+#endif  // XLS_DSLX_JIT_TEST_RUNNER_H_
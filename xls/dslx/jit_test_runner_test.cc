@@ -0,0 +1,181 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/jit_test_runner.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/dslx/interpreter.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/dslx/parse_and_typecheck.h"
+
+namespace xls::dslx {
+namespace {
+
+constexpr char kProgram[] = R"(
+fn double(x: u32) -> u32 { x + x }
+
+fn checked(x: u32) -> u32 {
+  match x > u32:10 {
+    true => fail!(x),
+    _ => x,
+  }
+}
+
+#![test]
+fn passes() {
+  let x = double(u32:2);
+  let _ = assert_eq(x, u32:4);
+  assert_lt(x, u32:5)
+}
+
+#![test]
+fn fails_array() {
+  let a = [u8:1, u8:2];
+  let _ = assert_eq(a, [u8:1, u8:2]);
+  let _ = assert_eq(a, [u8:1, u8:3]);
+  assert_eq(s8:-1, s8:0)
+}
+
+#![test]
+fn fails_signed() {
+  let _ = assert_eq(double(u32:1), u32:2);
+  assert_lt(s8:0, s8:-1)
+}
+
+#![test]
+fn fails_fail() {
+  let _ = fail!(double(u32:3));
+  ()
+}
+
+#![test]
+fn nested_assertion() {
+  match double(u32:1) == u32:2 {
+    true => (),
+    _ => assert_eq(u32:0, u32:1),
+  }
+}
+
+#![test]
+fn calls_fail() {
+  assert_eq(checked(u32:3), u32:3)
+}
+
+fn get(a: u8[2], i: u32) -> u8 { a[i] }
+
+#![test]
+fn index_out_of_bounds() {
+  assert_eq(get([u8:1, u8:2], u32:2), u8:2)
+}
+
+#![test]
+fn literal_index() {
+  let a = [u8:1, u8:2];
+  assert_eq(a[u32:1], u8:2)
+}
+)";
+
+class JitTestRunnerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        TypecheckedModule tm,
+        ParseAndTypecheck(kProgram, "test.x", "test", &import_data_,
+                          /*additional_search_paths=*/{}));
+    module_ = tm.module;
+    XLS_ASSERT_OK_AND_ASSIGN(
+        package_, ConvertModuleToPackage(module_, &import_data_,
+                                         /*emit_positions=*/true,
+                                         /*traverse_tests=*/true));
+  }
+
+  absl::optional<absl::Status> RunOnJit(absl::string_view test_name) {
+    absl::StatusOr<TestFunction*> test = module_->GetTest(test_name);
+    XLS_CHECK_OK(test.status());
+    return RunTestOnJit(test.value(), &import_data_, package_.get());
+  }
+
+  absl::Status Interpret(absl::string_view test_name) {
+    Interpreter interpreter(module_, /*typecheck=*/nullptr,
+                            /*additional_search_paths=*/{}, &import_data_);
+    return interpreter.RunTest(test_name);
+  }
+
+  ImportData import_data_;
+  Module* module_;
+  std::unique_ptr<Package> package_;
+};
+
+TEST_F(JitTestRunnerTest, MatchesInterpreter) {
+  for (const char* test_name :
+       {"passes", "fails_array", "fails_signed", "fails_fail"}) {
+    absl::optional<absl::Status> jit_status = RunOnJit(test_name);
+    ASSERT_TRUE(jit_status.has_value()) << test_name;
+    EXPECT_EQ(*jit_status, Interpret(test_name)) << test_name;
+  }
+  EXPECT_THAT(*RunOnJit("passes"), status_testing::IsOk());
+  EXPECT_THAT(*RunOnJit("fails_array"),
+              status_testing::StatusIs(
+                  absl::StatusCode::kInternal,
+                  testing::HasSubstr("first differing index: 1")));
+}
+
+TEST_F(JitTestRunnerTest, FallsBackToInterpreter) {
+  EXPECT_FALSE(RunOnJit("nested_assertion").has_value());
+  EXPECT_FALSE(RunOnJit("calls_fail").has_value());
+}
+
+TEST_F(JitTestRunnerTest, InterpretsTestThatMayIndexOutOfBounds) {
+  // The JIT clamps the index, so only the interpreter reports the error.
+  EXPECT_FALSE(RunOnJit("index_out_of_bounds").has_value());
+  EXPECT_THAT(Interpret("index_out_of_bounds"),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument,
+                                       testing::HasSubstr("out of bounds")));
+
+  absl::optional<absl::Status> jit_status = RunOnJit("literal_index");
+  ASSERT_TRUE(jit_status.has_value());
+  EXPECT_THAT(*jit_status, status_testing::IsOk());
+}
+
+TEST_F(JitTestRunnerTest, PrepareThenRun) {
+  // Converts all the tests before jitting any of them, as a parallel runner
+  // does.
+  std::vector<JitTest> jit_tests;
+  for (const char* test_name : {"passes", "fails_signed", "calls_fail"}) {
+    XLS_ASSERT_OK_AND_ASSIGN(TestFunction * test, module_->GetTest(test_name));
+    XLS_ASSERT_OK_AND_ASSIGN(
+        absl::optional<JitTest> jit_test,
+        PrepareTestForJit(test, &import_data_, package_.get()));
+    if (jit_test.has_value()) {
+      jit_tests.push_back(std::move(*jit_test));
+    }
+  }
+  ASSERT_EQ(jit_tests.size(), 2);
+  for (const JitTest& jit_test : jit_tests) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit,
+                             IrJit::Create(jit_test.converted.function));
+    EXPECT_EQ(RunJitTest(jit_test, jit.get()),
+              Interpret(jit_test.test->identifier()))
+        << jit_test.test->identifier();
+  }
+}
+
+}  // namespace
+}  // namespace xls::dslx
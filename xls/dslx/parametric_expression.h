@@ -164,6 +164,9 @@ class ParametricAdd : public ParametricExpression {
     return absl::make_unique<ParametricAdd>(lhs_->Clone(), rhs_->Clone());
   }
 
+  const ParametricExpression& lhs() const { return *lhs_; }
+  const ParametricExpression& rhs() const { return *rhs_; }
+
  private:
   std::unique_ptr<ParametricExpression> lhs_;
   std::unique_ptr<ParametricExpression> rhs_;
@@ -210,6 +213,9 @@ class ParametricMul : public ParametricExpression {
                            rhs_->ToRepr());
   }
 
+  const ParametricExpression& lhs() const { return *lhs_; }
+  const ParametricExpression& rhs() const { return *rhs_; }
+
  private:
   std::unique_ptr<ParametricExpression> lhs_;
   std::unique_ptr<ParametricExpression> rhs_;
@@ -255,6 +261,7 @@ class ParametricSymbol : public ParametricExpression {
   }
 
   const std::string& identifier() const { return identifier_; }
+  const Span& span() const { return span_; }
 
  private:
   std::string identifier_;  // Text identifier for the parametric symbol.
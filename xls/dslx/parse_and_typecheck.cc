@@ -27,9 +27,13 @@ absl::StatusOr<TypecheckedModule> ParseAndTypecheck(
   Scanner scanner{std::string{path}, std::string{text}};
   Parser parser(std::string{module_name}, &scanner);
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Module> module, parser.ParseModule());
-  XLS_ASSIGN_OR_RETURN(
-      TypeInfo * type_info,
-      CheckModule(module.get(), import_data, additional_search_paths));
+  absl::StatusOr<TypeInfo*> type_info_or =
+      CheckModule(module.get(), import_data, additional_search_paths);
+  if (!type_info_or.ok()) {
+    import_data->RemoveModuleState(module.get());
+    return type_info_or.status();
+  }
+  TypeInfo* type_info = type_info_or.value();
   TypecheckedModule result{module.get(), type_info};
   XLS_ASSIGN_OR_RETURN(ImportTokens subject,
                        ImportTokens::FromString(module_name));
@@ -48,16 +48,13 @@ struct InterpValuePickler {
     return std::make_tuple(tag, bits, values);
   }
   static InterpValue Unpickle(const State& state) {
-    InterpValue::Payload payload;
     const absl::optional<Bits>& bits = std::get<1>(state);
     if (bits.has_value()) {
-      payload = bits.value();
-    } else {
-      const auto& values = std::get<2>(state);
-      XLS_CHECK(values.has_value());
-      payload = values.value();
+      return InterpValue(std::get<0>(state), bits.value());
     }
-    return InterpValue(std::get<0>(state), payload);
+    const auto& values = std::get<2>(state);
+    XLS_CHECK(values.has_value());
+    return InterpValue(std::get<0>(state), values.value());
   }
 };
 
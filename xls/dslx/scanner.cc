@@ -91,20 +91,19 @@ bool Scanner::TryDropChar(char target) {
 }
 
 absl::StatusOr<Token> Scanner::PopComment(const Pos& start_pos) {
-  std::string chars;
-  while (!AtCharEof() && !TryDropChar('\n')) {
-    chars.append(1, PopChar());
-  }
-  return Token(TokenKind::kComment, Span(start_pos, GetPos()), chars);
+  absl::string_view chars =
+      ScanWhile(index_, [](char c) { return c != '\n'; });
+  TryDropChar('\n');
+  return Token(TokenKind::kComment, Span(start_pos, GetPos()),
+               std::string(chars));
 }
 
 absl::StatusOr<Token> Scanner::PopWhitespace(const Pos& start_pos) {
   XLS_CHECK(AtWhitespace());
-  std::string chars;
-  while (!AtCharEof() && AtWhitespace()) {
-    chars.append(1, PopChar());
-  }
-  return Token(TokenKind::kWhitespace, Span(start_pos, GetPos()), chars);
+  absl::string_view chars =
+      ScanWhile(index_, [this](char) { return AtWhitespace(); });
+  return Token(TokenKind::kWhitespace, Span(start_pos, GetPos()),
+               std::string(chars));
 }
 
 /* static */ absl::optional<Keyword> Scanner::GetKeyword(absl::string_view s) {
@@ -127,12 +126,12 @@ absl::StatusOr<Token> Scanner::ScanIdentifierOrKeyword(char startc,
     return std::isalpha(c) || std::isdigit(c) || c == '_' || c == '!' ||
            c == '\'';
   };
-  std::string s = ScanWhile(startc, is_trailing_identifier_char);
+  absl::string_view s = ScanWhile(index_ - 1, is_trailing_identifier_char);
   Span span(start_pos, GetPos());
   if (absl::optional<Keyword> keyword = GetKeyword(s)) {
     return Token(span, *keyword);
   }
-  return Token(TokenKind::kIdentifier, span, std::move(s));
+  return Token(TokenKind::kIdentifier, span, std::string(s));
 }
 
 absl::StatusOr<absl::optional<Token>> Scanner::TryPopWhitespaceOrComment() {
@@ -158,9 +157,11 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, const Pos& start_pos) {
     startc = PopChar();
   }
 
-  std::string s;
+  // The (already popped) first digit; a minus sign precedes it directly.
+  const int64_t start = index_ - 1;
+  absl::string_view s;
   if (startc == '0' && TryDropChar('x')) {  // Hex radix.
-    s = ScanWhile("0x", [](char c) {
+    s = ScanWhile(start, [](char c) {
       return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') ||
              ('A' <= c && c <= 'F') || c == '_';
     });
@@ -169,7 +170,7 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, const Pos& start_pos) {
                        "Expected hex characters following 0x prefix.");
     }
   } else if (startc == '0' && TryDropChar('b')) {  // Bin prefix.
-    s = ScanWhile("0b",
+    s = ScanWhile(start,
                   [](char c) { return ('0' <= c && c <= '1') || c == '_'; });
     if (s == "0b") {
       return ScanError(Span(GetPos(), GetPos()),
@@ -181,7 +182,7 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, const Pos& start_pos) {
           absl::StrFormat("Invalid digit for binary number: '%c'", PeekChar()));
     }
   } else {
-    s = ScanWhile(startc, [](char c) { return std::isdigit(c); });
+    s = ScanWhile(start, [](char c) { return std::isdigit(c); });
     if (absl::StartsWith(s, "0") && s.size() != 1) {
       return ScanError(
           Span(GetPos(), GetPos()),
@@ -191,9 +192,9 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, const Pos& start_pos) {
         << "Must have seen numerical digits to attempt to scan a number.";
   }
   if (negative) {
-    s = "-" + s;
+    s = absl::string_view(text_).substr(start - 1, s.size() + 1);
   }
-  return Token(TokenKind::kNumber, Span(start_pos, GetPos()), s);
+  return Token(TokenKind::kNumber, Span(start_pos, GetPos()), std::string(s));
 }
 
 std::string KeywordToString(Keyword keyword) {
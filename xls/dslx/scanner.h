@@ -21,6 +21,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/variant.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
@@ -262,19 +263,14 @@ class Scanner {
   absl::StatusOr<Token> ScanChar(const Pos& start_pos);
 
   // Scans from the current position until ftake returns false or EOF is
-  // reached.
-  std::string ScanWhile(std::string s, const std::function<bool(char)>& ftake) {
-    while (!AtCharEof()) {
-      char peek = PeekChar();
-      if (!ftake(peek)) {
-        break;
-      }
-      s.append(1, PopChar());
+  // reached, and returns the text from (the already scanned) offset "start" to
+  // the new position as a view of the text.
+  absl::string_view ScanWhile(int64_t start,
+                              const std::function<bool(char)>& ftake) {
+    while (!AtCharEof() && ftake(PeekChar())) {
+      DropChar();
     }
-    return s;
-  }
-  std::string ScanWhile(char c, const std::function<bool(char)>& ftake) {
-    return ScanWhile(std::string(1, c), ftake);
+    return absl::string_view(text_).substr(start, index_ - start);
   }
 
   // Scans the identifier-looping entity beginning with startc.
@@ -46,6 +46,32 @@ TEST(ScannerTest, HexNumbers) {
   EXPECT_TRUE(tokens[2].IsNumber("0xA"));
 }
 
+TEST(ScannerTest, NegativeNumbers) {
+  std::string text = "-0x1f -0b10 -42 - 7";
+  Scanner s("fake_file.x", text);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Token> tokens, s.PopAll());
+  ASSERT_EQ(5, tokens.size());
+  EXPECT_TRUE(tokens[0].IsNumber("-0x1f"));
+  EXPECT_TRUE(tokens[1].IsNumber("-0b10"));
+  EXPECT_TRUE(tokens[2].IsNumber("-42"));
+  EXPECT_EQ(tokens[3].kind(), TokenKind::kMinus);
+  EXPECT_TRUE(tokens[4].IsNumber("7"));
+}
+
+TEST(ScannerTest, WhitespaceAndComments) {
+  std::string text = "x // a comment\n  \ty";
+  Scanner s("fake_file.x", text, /*include_whitespace_and_comments=*/true);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Token> tokens, s.PopAll());
+  ASSERT_EQ(5, tokens.size());
+  EXPECT_TRUE(tokens[0].IsIdentifier("x"));
+  EXPECT_EQ(tokens[1].kind(), TokenKind::kWhitespace);
+  EXPECT_EQ(tokens[1].GetStringValue(), " ");
+  EXPECT_EQ(tokens[2].kind(), TokenKind::kComment);
+  EXPECT_EQ(tokens[2].GetStringValue(), " a comment");
+  EXPECT_EQ(tokens[3].GetStringValue(), "  \t");
+  EXPECT_TRUE(tokens[4].IsIdentifier("y"));
+}
+
 TEST(ScannerTest, BoolKeywords) {
   std::string text = "true false bool";
   Scanner s("fake_file.x", text);
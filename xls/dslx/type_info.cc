@@ -14,6 +14,8 @@
 
 #include "xls/dslx/type_info.h"
 
+#include <algorithm>
+
 #include "xls/common/status/ret_check.h"
 
 namespace xls::dslx {
@@ -29,12 +31,43 @@ std::string InvocationData::ToString() const {
                       "]");
 }
 
+// -- class TypeInfoChangeRecorder
+
+namespace {
+
+thread_local TypeInfoChangeRecorder* current_recorder = nullptr;
+
+}  // namespace
+
+TypeInfoChangeRecorder::TypeInfoChangeRecorder()
+    : previous_(current_recorder) {
+  current_recorder = this;
+}
+
+TypeInfoChangeRecorder::~TypeInfoChangeRecorder() {
+  XLS_CHECK_EQ(current_recorder, this);
+  current_recorder = previous_;
+}
+
+/* static */ void TypeInfoChangeRecorder::Record(TypeInfoChange::Kind kind,
+                                                 TypeInfo* type_info,
+                                                 AstNode* node,
+                                                 SymbolicBindings caller) {
+  if (current_recorder != nullptr) {
+    current_recorder->changes_.push_back(
+        TypeInfoChange{kind, type_info, node, std::move(caller)});
+  }
+}
+
 // -- class TypeInfoOwner
 
 absl::StatusOr<TypeInfo*> TypeInfoOwner::New(Module* module, TypeInfo* parent) {
+  absl::MutexLock lock(&mutex_);
   // Note: private constructor so not using make_unique.
   type_infos_.push_back(absl::WrapUnique(new TypeInfo(this, module, parent)));
   TypeInfo* result = type_infos_.back().get();
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kNew, result,
+                                 /*node=*/nullptr);
   if (parent == nullptr) {
     // Check we only have a single nullptr-parent TypeInfo for a given module.
     XLS_RET_CHECK(!module_to_root_.contains(module))
@@ -47,7 +80,19 @@ absl::StatusOr<TypeInfo*> TypeInfoOwner::New(Module* module, TypeInfo* parent) {
   return result;
 }
 
+void TypeInfoOwner::Remove(Module* module) {
+  absl::MutexLock lock(&mutex_);
+  module_to_root_.erase(module);
+  type_infos_.erase(
+      std::remove_if(type_infos_.begin(), type_infos_.end(),
+                     [&](const std::unique_ptr<TypeInfo>& type_info) {
+                       return type_info->module() == module;
+                     }),
+      type_infos_.end());
+}
+
 absl::StatusOr<TypeInfo*> TypeInfoOwner::GetRootTypeInfo(Module* module) {
+  absl::MutexLock lock(&mutex_);
   auto it = module_to_root_.find(module);
   if (it == module_to_root_.end()) {
     return absl::NotFoundError(absl::StrCat(
@@ -59,9 +104,15 @@ absl::StatusOr<TypeInfo*> TypeInfoOwner::GetRootTypeInfo(Module* module) {
 // -- class TypeInfo
 
 void TypeInfo::NoteConstExpr(Expr* const_expr, int64_t value) {
-  const_exprs_[const_expr] = value;
+  {
+    absl::MutexLock lock(&mutex_);
+    const_exprs_[const_expr] = value;
+  }
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kConstExpr, this,
+                                 const_expr);
 }
 absl::optional<int64_t> TypeInfo::GetConstExpr(Expr* const_expr) {
+  absl::MutexLock lock(&mutex_);
   if (auto it = const_exprs_.find(const_expr); it != const_exprs_.end()) {
     return it->second;
   }
@@ -70,10 +121,30 @@ absl::optional<int64_t> TypeInfo::GetConstExpr(Expr* const_expr) {
 
 bool TypeInfo::Contains(AstNode* key) const {
   XLS_CHECK_EQ(key->owner(), module_);
-  return dict_.contains(key) || (parent_ != nullptr && parent_->Contains(key));
+  {
+    absl::MutexLock lock(&mutex_);
+    if (dict_.contains(key)) {
+      return true;
+    }
+  }
+  return parent_ != nullptr && parent_->Contains(key);
+}
+
+void TypeInfo::SetItem(AstNode* key, const ConcreteType& value) {
+  XLS_CHECK_EQ(key->owner(), module_);
+  {
+    absl::MutexLock lock(&mutex_);
+    std::unique_ptr<ConcreteType>& item = dict_[key];
+    if (item != nullptr) {
+      replaced_types_.push_back(std::move(item));
+    }
+    item = value.CloneToUnique();
+  }
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kItem, this, key);
 }
 
 std::string TypeInfo::GetImportsDebugString() const {
+  absl::MutexLock lock(&mutex_);
   return absl::StrFormat(
       "module %s imports:\n  %s", module()->name(),
       absl::StrJoin(imports_, "\n  ", [](std::string* out, const auto& item) {
@@ -85,9 +156,12 @@ absl::optional<ConcreteType*> TypeInfo::GetItem(AstNode* key) const {
   XLS_CHECK_EQ(key->owner(), module_)
       << key->owner()->name() << " vs " << module_->name()
       << " key: " << key->ToString();
-  auto it = dict_.find(key);
-  if (it != dict_.end()) {
-    return it->second.get();
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = dict_.find(key);
+    if (it != dict_.end()) {
+      return it->second.get();
+    }
   }
   if (parent_ != nullptr) {
     return parent_->GetItem(key);
@@ -105,9 +179,12 @@ void TypeInfo::AddInvocationSymbolicBindings(Invocation* invocation,
               << " " << invocation->ToString() << " @ " << invocation->span()
               << " caller: " << caller.ToString()
               << " callee: " << callee.ToString();
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kInvocationBindings,
+                                 top, invocation, caller);
+  absl::MutexLock lock(&top->mutex_);
   auto it = top->invocations_.find(invocation);
   if (it == top->invocations_.end()) {
-    absl::flat_hash_map<SymbolicBindings, SymbolicBindings> symbind_map;
+    absl::node_hash_map<SymbolicBindings, SymbolicBindings> symbind_map;
     symbind_map.emplace(std::move(caller), std::move(callee));
     top->invocations_[invocation] =
         InvocationData{invocation, std::move(symbind_map)};
@@ -130,6 +207,7 @@ absl::optional<TypeInfo*> TypeInfo::GetInstantiation(
     Invocation* invocation, const SymbolicBindings& caller) const {
   XLS_CHECK_EQ(invocation->owner(), module_);
   const TypeInfo* top = GetRoot();
+  absl::MutexLock lock(&top->mutex_);
   auto it = top->invocations_.find(invocation);
   if (it == top->invocations_.end()) {
     XLS_VLOG(5) << "Could not find instantiation for invocation: "
@@ -151,8 +229,13 @@ void TypeInfo::AddInstantiation(Invocation* invocation, SymbolicBindings caller,
                                 TypeInfo* type_info) {
   XLS_CHECK_EQ(invocation->owner(), module_);
   TypeInfo* top = GetRoot();
-  InvocationData& data = top->invocations_[invocation];
-  data.instantiations[caller] = type_info;
+  {
+    absl::MutexLock lock(&top->mutex_);
+    InvocationData& data = top->invocations_[invocation];
+    data.instantiations[caller] = type_info;
+  }
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kInstantiation, top,
+                                 invocation, std::move(caller));
 }
 
 absl::optional<const SymbolicBindings*> TypeInfo::GetInvocationSymbolicBindings(
@@ -164,6 +247,7 @@ absl::optional<const SymbolicBindings*> TypeInfo::GetInvocationSymbolicBindings(
       "TypeInfo %p getting invocation symbolic bindings: %p %s @ %s %s", top,
       invocation, invocation->ToString(), invocation->span().ToString(),
       caller.ToString());
+  absl::MutexLock lock(&top->mutex_);
   auto it = top->invocations_.find(invocation);
   if (it == top->invocations_.end()) {
     XLS_VLOG(3) << "Could not find invocation " << invocation
@@ -190,6 +274,9 @@ void TypeInfo::AddSliceStartAndWidth(Slice* node,
                                      StartAndWidth start_width) {
   XLS_CHECK_EQ(node->owner(), module_);
   TypeInfo* top = GetRoot();
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kSliceStartAndWidth,
+                                 top, node, symbolic_bindings);
+  absl::MutexLock lock(&top->mutex_);
   auto it = top->slices_.find(node);
   if (it == top->slices_.end()) {
     top->slices_[node] =
@@ -204,6 +291,7 @@ absl::optional<StartAndWidth> TypeInfo::GetSliceStartAndWidth(
     Slice* node, const SymbolicBindings& symbolic_bindings) const {
   XLS_CHECK_EQ(node->owner(), module_);
   const TypeInfo* top = GetRoot();
+  absl::MutexLock lock(&top->mutex_);
   auto it = top->slices_.find(node);
   if (it == top->slices_.end()) {
     return absl::nullopt;
@@ -218,7 +306,12 @@ absl::optional<StartAndWidth> TypeInfo::GetSliceStartAndWidth(
 
 void TypeInfo::AddImport(Import* import, Module* module, TypeInfo* type_info) {
   XLS_CHECK_EQ(import->owner(), module_);
-  GetRoot()->imports_[import] = ImportedInfo{module, type_info};
+  TypeInfo* top = GetRoot();
+  {
+    absl::MutexLock lock(&top->mutex_);
+    top->imports_[import] = ImportedInfo{module, type_info};
+  }
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kImport, top, import);
 }
 
 absl::optional<const ImportedInfo*> TypeInfo::GetImported(
@@ -227,6 +320,7 @@ absl::optional<const ImportedInfo*> TypeInfo::GetImported(
       << "Import node from: " << import->owner()->name() << " vs TypeInfo for "
       << module_->name();
   auto* self = GetRoot();
+  absl::MutexLock lock(&self->mutex_);
   auto it = self->imports_.find(import);
   if (it == self->imports_.end()) {
     return absl::nullopt;
@@ -242,6 +336,7 @@ absl::optional<TypeInfo*> TypeInfo::GetImportedTypeInfo(Module* m) {
   if (m == module()) {
     return this;
   }
+  absl::MutexLock lock(&mutex_);
   for (auto& [import, info] : imports_) {
     if (info.module == m) {
       return info.type_info;
@@ -250,16 +345,37 @@ absl::optional<TypeInfo*> TypeInfo::GetImportedTypeInfo(Module* m) {
   return absl::nullopt;
 }
 
-absl::optional<Expr*> TypeInfo::GetConstant(NameDef* name_def) const {
+absl::optional<ConstantDef*> TypeInfo::GetConstantDef(
+    NameDef* name_def) const {
   XLS_CHECK_EQ(name_def->owner(), module_);
-  auto it = name_to_const_.find(name_def);
-  if (it == name_to_const_.end()) {
-    if (parent_ != nullptr) {
-      return parent_->GetConstant(name_def);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = name_to_const_.find(name_def);
+    if (it != name_to_const_.end()) {
+      return it->second;
     }
+  }
+  if (parent_ != nullptr) {
+    return parent_->GetConstantDef(name_def);
+  }
+  return absl::nullopt;
+}
+
+void TypeInfo::NoteConstant(NameDef* name_def, ConstantDef* constant_def) {
+  {
+    absl::MutexLock lock(&mutex_);
+    name_to_const_[name_def] = constant_def;
+  }
+  TypeInfoChangeRecorder::Record(TypeInfoChange::Kind::kConstant, this,
+                                 name_def);
+}
+
+absl::optional<Expr*> TypeInfo::GetConstant(NameDef* name_def) const {
+  absl::optional<ConstantDef*> constant_def = GetConstantDef(name_def);
+  if (!constant_def.has_value()) {
     return absl::nullopt;
   }
-  return it->second->value();
+  return (*constant_def)->value();
 }
 
 }  // namespace xls::dslx
@@ -17,6 +17,9 @@
 #ifndef XLS_DSLX_TYPE_INFO_H_
 #define XLS_DSLX_TYPE_INFO_H_
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/dslx/ast.h"
 #include "xls/dslx/concrete_type.h"
 #include "xls/dslx/symbolic_bindings.h"
@@ -50,8 +53,9 @@ struct InvocationData {
   // Invocation AST node.
   Invocation* node;
   // Map from symbolic bindings in the caller to the corresponding symbolic
-  // bindings in the callee for this invocation.
-  absl::flat_hash_map<SymbolicBindings, SymbolicBindings> symbolic_bindings_map;
+  // bindings in the callee for this invocation. (Node-based, as references to
+  // the callee bindings are handed out while other threads may add entries.)
+  absl::node_hash_map<SymbolicBindings, SymbolicBindings> symbolic_bindings_map;
   // Type information that is specialized for a particular parametric
   // instantiation of an invocation.
   absl::flat_hash_map<SymbolicBindings, TypeInfo*> instantiations;
@@ -59,6 +63,59 @@ struct InvocationData {
   std::string ToString() const;
 };
 
+// A change made to a TypeInfo, as seen by a TypeInfoChangeRecorder. Only the
+// key of the change is recorded; the value can be retrieved from the TypeInfo.
+struct TypeInfoChange {
+  enum class Kind {
+    // The TypeInfo was created; "node" is nullptr.
+    kNew,
+    // SetItem() of "node".
+    kItem,
+    // AddImport() of "node".
+    kImport,
+    // NoteConstant() of "node" (the NameDef).
+    kConstant,
+    // AddInvocationSymbolicBindings() at "node" with "caller" bindings.
+    kInvocationBindings,
+    // AddInstantiation() at "node" with "caller" bindings.
+    kInstantiation,
+    // AddSliceStartAndWidth() of "node" with "caller" bindings.
+    kSliceStartAndWidth,
+    // NoteConstExpr() of "node".
+    kConstExpr,
+  };
+
+  Kind kind;
+  // The TypeInfo that holds the change; for changes that are stashed in the
+  // root TypeInfo (e.g. invocation data) this is the root.
+  TypeInfo* type_info;
+  AstNode* node;
+  SymbolicBindings caller;
+};
+
+// Records the changes made to type information by the current thread while it
+// is alive, e.g. to capture the result of typechecking a module (which can add
+// type information to the modules it imports). Only the innermost recorder of
+// a thread sees a change.
+class TypeInfoChangeRecorder {
+ public:
+  TypeInfoChangeRecorder();
+  ~TypeInfoChangeRecorder();
+
+  TypeInfoChangeRecorder(const TypeInfoChangeRecorder&) = delete;
+  TypeInfoChangeRecorder& operator=(const TypeInfoChangeRecorder&) = delete;
+
+  absl::Span<const TypeInfoChange> changes() const { return changes_; }
+
+  // Records a change with the current recorder of the thread, if any.
+  static void Record(TypeInfoChange::Kind kind, TypeInfo* type_info,
+                     AstNode* node, SymbolicBindings caller = {});
+
+ private:
+  TypeInfoChangeRecorder* previous_;
+  std::vector<TypeInfoChange> changes_;
+};
+
 // Owns "type information" objects created during the type checking process.
 //
 // In the process of type checking we may instantiate "sub type-infos" for
@@ -69,6 +126,9 @@ struct InvocationData {
 // the program at type checking time, we place all type info objects into this
 // owned pool (arena style ownership to avoid circular references or leaks or
 // any other sort of lifetime issues).
+//
+// TypeInfoOwner and TypeInfo are thread-safe, so that independent modules can
+// be typechecked concurrently (see ImportData::EnableParallelTypecheck()).
 class TypeInfoOwner {
  public:
   // Returns an error status iff parent is nullptr and "module" already has a
@@ -79,15 +139,22 @@ class TypeInfoOwner {
   // status error if it is not present.
   absl::StatusOr<TypeInfo*> GetRootTypeInfo(Module* module);
 
+  // Destroys all of the type information for "module", which must not be
+  // referred to afterwards.
+  void Remove(Module* module);
+
  private:
+  absl::Mutex mutex_;
+
   // Mapping from module to the "root" (or "parentmost") type info -- these have
   // nullptr as their parent. There should only be one of these for any given
   // module.
-  absl::flat_hash_map<Module*, TypeInfo*> module_to_root_;
+  absl::flat_hash_map<Module*, TypeInfo*> module_to_root_
+      ABSL_GUARDED_BY(mutex_);
 
   // Owned type information objects -- TypeInfoOwner is the lifetime owner for
   // these.
-  std::vector<std::unique_ptr<TypeInfo>> type_infos_;
+  std::vector<std::unique_ptr<TypeInfo>> type_infos_ ABSL_GUARDED_BY(mutex_);
 };
 
 class TypeInfo {
@@ -144,10 +211,7 @@ class TypeInfo {
                         TypeInfo* type_info);
 
   // Sets the type associated with the given AST node.
-  void SetItem(AstNode* key, const ConcreteType& value) {
-    XLS_CHECK_EQ(key->owner(), module_);
-    dict_[key] = value.CloneToUnique();
-  }
+  void SetItem(AstNode* key, const ConcreteType& value);
 
   // Attempts to resolve AST node 'key' in the node-to-type dictionary.
   absl::optional<ConcreteType*> GetItem(AstNode* key) const;
@@ -170,7 +234,10 @@ class TypeInfo {
   // import cache.
   void AddImport(Import* import, Module* module, TypeInfo* type_info);
   absl::optional<const ImportedInfo*> GetImported(Import* import) const;
-  const absl::flat_hash_map<Import*, ImportedInfo>& imports() const {
+
+  // Note: not synchronized, only for use once typechecking is done.
+  const absl::node_hash_map<Import*, ImportedInfo>& imports() const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
     return imports_;
   }
 
@@ -187,9 +254,10 @@ class TypeInfo {
   Module* module() const { return module_; }
 
   // Notes a constant definition associated with a given NameDef AST node.
-  void NoteConstant(NameDef* name_def, ConstantDef* constant_def) {
-    name_to_const_[name_def] = constant_def;
-  }
+  void NoteConstant(NameDef* name_def, ConstantDef* constant_def);
+
+  // Returns the ConstantDef that has the given name_def.
+  absl::optional<ConstantDef*> GetConstantDef(NameDef* name_def) const;
 
   // Returns the expression for a ConstantDef that has the given name_def.
   absl::optional<Expr*> GetConstant(NameDef* name_def) const;
@@ -245,12 +313,21 @@ class TypeInfo {
 
   TypeInfoOwner* owner_;
   Module* module_;
-  absl::flat_hash_map<AstNode*, std::unique_ptr<ConcreteType>> dict_;
-  absl::flat_hash_map<Import*, ImportedInfo> imports_;
-  absl::flat_hash_map<NameDef*, ConstantDef*> name_to_const_;
-  absl::flat_hash_map<Invocation*, InvocationData> invocations_;
-  absl::flat_hash_map<Slice*, SliceData> slices_;
-  absl::flat_hash_map<Expr*, int64_t> const_exprs_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<AstNode*, std::unique_ptr<ConcreteType>> dict_
+      ABSL_GUARDED_BY(mutex_);
+  // Types replaced in dict_, which are kept alive as other threads may still
+  // refer to them.
+  std::vector<std::unique_ptr<ConcreteType>> replaced_types_
+      ABSL_GUARDED_BY(mutex_);
+  // Note: node-based maps hold the values that references are handed out to.
+  absl::node_hash_map<Import*, ImportedInfo> imports_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<NameDef*, ConstantDef*> name_to_const_
+      ABSL_GUARDED_BY(mutex_);
+  absl::node_hash_map<Invocation*, InvocationData> invocations_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Slice*, SliceData> slices_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Expr*, int64_t> const_exprs_ ABSL_GUARDED_BY(mutex_);
   TypeInfo* parent_;  // Note: may be nullptr.
 };
 
@@ -599,6 +599,13 @@ absl::StatusOr<TypeInfo*> CheckModule(
                         Module* module) -> absl::StatusOr<TypeInfo*> {
     return CheckModule(module, import_data, additional_search_paths_copy);
   };
+  if (import_data->parallel_typecheck()) {
+    // Import everything up front, so that independent imports are typechecked
+    // concurrently (the loop below then finds them in the import cache).
+    XLS_RETURN_IF_ERROR(DoModuleImports(ftypecheck, module,
+                                        additional_search_paths, import_data)
+                            .status());
+  }
   auto ctx_owned = absl::make_unique<DeduceCtx>(
       type_info, module,
       /*deduce_function=*/&Deduce,
@@ -0,0 +1,1211 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/typecheck_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
+#include "xls/common/stable_hash.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/dslx/concrete_type.h"
+#include "xls/dslx/parametric_expression.h"
+#include "xls/dslx/symbolic_bindings.h"
+#include "xls/ir/bits.h"
+
+namespace xls::dslx {
+namespace {
+
+// Bump this whenever the entry format or the information typechecking records
+// changes, to invalidate existing entries.
+constexpr int64_t kTypecheckCacheFormatVersion = 1;
+
+// Likewise for constant entries, e.g. when the interpreter's semantics change.
+constexpr int64_t kConstantCacheFormatVersion = 1;
+
+constexpr char kEntryMagic[] = "xls_dslx_typecheck_cache";
+constexpr char kConstantsMagic[] = "xls_dslx_constant_cache";
+constexpr char kNone[] = "-";
+
+// Entries are a sequence of space-terminated tokens: words, integers, and
+// length-prefixed strings ("<length>:<bytes>").
+class EntryWriter {
+ public:
+  void Word(absl::string_view word) { absl::StrAppend(&text_, word, " "); }
+  void Int(int64_t value) { absl::StrAppend(&text_, value, " "); }
+  void String(absl::string_view s) {
+    absl::StrAppend(&text_, s.size(), ":", s, " ");
+  }
+  void Append(const EntryWriter& other) {
+    absl::StrAppend(&text_, other.text_);
+  }
+
+  const std::string& text() const { return text_; }
+
+ private:
+  std::string text_;
+};
+
+class EntryReader {
+ public:
+  explicit EntryReader(absl::string_view text) : text_(text) {}
+
+  absl::StatusOr<absl::string_view> Word() {
+    size_t end = text_.find(' ');
+    if (end == absl::string_view::npos) {
+      return absl::InvalidArgumentError("Truncated typecheck cache entry.");
+    }
+    absl::string_view word = text_.substr(0, end);
+    text_.remove_prefix(end + 1);
+    return word;
+  }
+
+  absl::StatusOr<int64_t> Int() {
+    XLS_ASSIGN_OR_RETURN(absl::string_view word, Word());
+    int64_t value;
+    if (!absl::SimpleAtoi(word, &value)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected an integer in typecheck cache entry: ", word));
+    }
+    return value;
+  }
+
+  absl::StatusOr<std::string> String() {
+    size_t colon = text_.find(':');
+    int64_t size;
+    if (colon == absl::string_view::npos ||
+        !absl::SimpleAtoi(text_.substr(0, colon), &size) || size < 0 ||
+        text_.size() < colon + size + 2 || text_[colon + size + 1] != ' ') {
+      return absl::InvalidArgumentError(
+          "Malformed string in typecheck cache entry.");
+    }
+    std::string s(text_.substr(colon + 1, size));
+    text_.remove_prefix(colon + size + 2);
+    return s;
+  }
+
+  bool AtEnd() const { return text_.empty(); }
+
+ private:
+  absl::string_view text_;
+};
+
+absl::Status EntryError(absl::string_view message) {
+  return absl::InvalidArgumentError(
+      absl::StrCat("Invalid typecheck cache entry: ", message));
+}
+
+// Returns whether "value" can be written to a constants entry: bits and
+// aggregates of them.
+bool IsCacheableValue(const InterpValue& value) {
+  if (value.IsBits()) {
+    return true;
+  }
+  if (!value.IsTuple() && !value.IsArray()) {
+    return false;
+  }
+  return std::all_of(value.GetValuesOrDie().begin(),
+                     value.GetValuesOrDie().end(), IsCacheableValue);
+}
+
+// Values are "u"/"s" <bit count> <hex bytes> for bits, and "tuple"/"array"
+// <size> followed by the elements for aggregates.
+void WriteValue(const InterpValue& value, EntryWriter* writer) {
+  if (value.IsBits()) {
+    const Bits& bits = value.GetBitsOrDie();
+    std::vector<uint8_t> bytes = bits.ToBytes();
+    writer->Word(value.IsSBits() ? "s" : "u");
+    writer->Int(bits.bit_count());
+    writer->String(absl::BytesToHexString(absl::string_view(
+        reinterpret_cast<const char*>(bytes.data()), bytes.size())));
+    return;
+  }
+  XLS_CHECK(value.IsTuple() || value.IsArray()) << value.ToString();
+  writer->Word(value.IsTuple() ? "tuple" : "array");
+  writer->Int(value.GetValuesOrDie().size());
+  for (const InterpValue& element : value.GetValuesOrDie()) {
+    WriteValue(element, writer);
+  }
+}
+
+absl::StatusOr<InterpValue> ReadValue(EntryReader* reader) {
+  XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader->Word());
+  if (tag == "u" || tag == "s") {
+    XLS_ASSIGN_OR_RETURN(int64_t bit_count, reader->Int());
+    XLS_ASSIGN_OR_RETURN(std::string hex, reader->String());
+    std::string bytes = absl::HexStringToBytes(hex);
+    if (bit_count < 0 || hex.size() != 2 * bytes.size() ||
+        static_cast<int64_t>(bytes.size()) !=
+            CeilOfRatio(bit_count, int64_t{8})) {
+      return EntryError("malformed bits value");
+    }
+    Bits bits = Bits::FromBytes(
+        absl::MakeConstSpan(reinterpret_cast<const uint8_t*>(bytes.data()),
+                            bytes.size()),
+        bit_count);
+    return InterpValue::MakeBits(
+        tag == "s" ? InterpValueTag::kSBits : InterpValueTag::kUBits,
+        std::move(bits));
+  }
+  if (tag == "tuple" || tag == "array") {
+    XLS_ASSIGN_OR_RETURN(int64_t size, reader->Int());
+    if (size < 0) {
+      return EntryError("negative aggregate size");
+    }
+    std::vector<InterpValue> elements;
+    for (int64_t i = 0; i < size; ++i) {
+      XLS_ASSIGN_OR_RETURN(InterpValue element, ReadValue(reader));
+      elements.push_back(std::move(element));
+    }
+    if (tag == "tuple") {
+      return InterpValue::MakeTuple(std::move(elements));
+    }
+    return InterpValue::MakeArray(std::move(elements));
+  }
+  return EntryError(absl::StrCat("unknown value tag ", tag));
+}
+
+absl::string_view KindName(TypeInfoChange::Kind kind) {
+  switch (kind) {
+    case TypeInfoChange::Kind::kNew:
+      return "new";
+    case TypeInfoChange::Kind::kItem:
+      return "item";
+    case TypeInfoChange::Kind::kImport:
+      return "import";
+    case TypeInfoChange::Kind::kConstant:
+      return "constant";
+    case TypeInfoChange::Kind::kInvocationBindings:
+      return "bindings";
+    case TypeInfoChange::Kind::kInstantiation:
+      return "instantiation";
+    case TypeInfoChange::Kind::kSliceStartAndWidth:
+      return "slice";
+    case TypeInfoChange::Kind::kConstExpr:
+      return "constexpr";
+  }
+  XLS_LOG(FATAL) << "Invalid TypeInfoChange kind: " << static_cast<int>(kind);
+}
+
+absl::StatusOr<TypeInfoChange::Kind> KindFromName(absl::string_view name) {
+  for (TypeInfoChange::Kind kind :
+       {TypeInfoChange::Kind::kNew, TypeInfoChange::Kind::kItem,
+        TypeInfoChange::Kind::kImport, TypeInfoChange::Kind::kConstant,
+        TypeInfoChange::Kind::kInvocationBindings,
+        TypeInfoChange::Kind::kInstantiation,
+        TypeInfoChange::Kind::kSliceStartAndWidth,
+        TypeInfoChange::Kind::kConstExpr}) {
+    if (KindName(kind) == name) {
+      return kind;
+    }
+  }
+  return EntryError(absl::StrCat("unknown change kind: ", name));
+}
+
+// Looks up the noted modules an entry refers to, by name.
+using ModuleLookup = std::function<absl::optional<Module*>(absl::string_view)>;
+
+// Serializes the changes made by typechecking a module. References to modules
+// go through a table of the modules involved (with their keys), references to
+// AST nodes are (module, position in Module::nodes()) pairs, and references to
+// type information are either the root type information of a module or the
+// k-th TypeInfo created by the changes themselves.
+class EntrySerializer {
+ public:
+  EntrySerializer(std::function<absl::optional<int64_t>(Module*)> node_count,
+                  std::function<absl::optional<std::string>(Module*)> key)
+      : node_count_(std::move(node_count)), key_(std::move(key)) {}
+
+  absl::Status Change(const TypeInfoChange& change) {
+    TypeInfo* type_info = change.type_info;
+    body_.Word(KindName(change.kind));
+    if (change.kind == TypeInfoChange::Kind::kNew) {
+      XLS_RETURN_IF_ERROR(ModuleRef(type_info->module()));
+      if (type_info->parent() == nullptr) {
+        body_.Word(kNone);
+      } else {
+        XLS_RETURN_IF_ERROR(TypeInfoRef(type_info->parent()));
+      }
+      int64_t index = locals_.size();
+      locals_[type_info] = index;
+      return absl::OkStatus();
+    }
+    XLS_RETURN_IF_ERROR(TypeInfoRef(type_info));
+    XLS_RETURN_IF_ERROR(NodeRef(change.node));
+    switch (change.kind) {
+      case TypeInfoChange::Kind::kNew:
+        break;
+      case TypeInfoChange::Kind::kItem: {
+        absl::optional<ConcreteType*> type = type_info->GetItem(change.node);
+        XLS_RET_CHECK(type.has_value());
+        return Type(**type);
+      }
+      case TypeInfoChange::Kind::kImport: {
+        absl::optional<const ImportedInfo*> imported =
+            type_info->GetImported(dynamic_cast<Import*>(change.node));
+        XLS_RET_CHECK(imported.has_value());
+        XLS_RETURN_IF_ERROR(ModuleRef((*imported)->module));
+        return TypeInfoRef((*imported)->type_info);
+      }
+      case TypeInfoChange::Kind::kConstant: {
+        absl::optional<ConstantDef*> constant_def =
+            type_info->GetConstantDef(dynamic_cast<NameDef*>(change.node));
+        XLS_RET_CHECK(constant_def.has_value());
+        return NodeRef(*constant_def);
+      }
+      case TypeInfoChange::Kind::kInvocationBindings: {
+        absl::optional<const SymbolicBindings*> callee =
+            type_info->GetInvocationSymbolicBindings(
+                dynamic_cast<Invocation*>(change.node), change.caller);
+        XLS_RET_CHECK(callee.has_value());
+        Bindings(change.caller);
+        Bindings(**callee);
+        return absl::OkStatus();
+      }
+      case TypeInfoChange::Kind::kInstantiation: {
+        absl::optional<TypeInfo*> instantiation = type_info->GetInstantiation(
+            dynamic_cast<Invocation*>(change.node), change.caller);
+        XLS_RET_CHECK(instantiation.has_value());
+        Bindings(change.caller);
+        return TypeInfoRef(*instantiation);
+      }
+      case TypeInfoChange::Kind::kSliceStartAndWidth: {
+        absl::optional<StartAndWidth> start_width =
+            type_info->GetSliceStartAndWidth(dynamic_cast<Slice*>(change.node),
+                                             change.caller);
+        XLS_RET_CHECK(start_width.has_value());
+        Bindings(change.caller);
+        body_.Int(start_width->start);
+        body_.Int(start_width->width);
+        return absl::OkStatus();
+      }
+      case TypeInfoChange::Kind::kConstExpr: {
+        absl::optional<int64_t> value =
+            type_info->GetConstExpr(dynamic_cast<Expr*>(change.node));
+        XLS_RET_CHECK(value.has_value());
+        body_.Int(*value);
+        return absl::OkStatus();
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the module table followed by the changes.
+  EntryWriter Finish(int64_t change_count) const {
+    EntryWriter result;
+    result.Int(modules_.size());
+    for (const auto& [name, key] : modules_) {
+      result.String(name);
+      result.String(key);
+    }
+    result.Int(change_count);
+    result.Append(body_);
+    return result;
+  }
+
+ private:
+  absl::Status ModuleRef(Module* module) {
+    auto it = module_indices_.find(module);
+    if (it == module_indices_.end()) {
+      absl::optional<std::string> key = key_(module);
+      if (!key.has_value()) {
+        return absl::UnimplementedError(
+            absl::StrCat("refers to uncached module ", module->name()));
+      }
+      it = module_indices_.emplace(module, modules_.size()).first;
+      modules_.push_back({module->name(), *key});
+    }
+    body_.Int(it->second);
+    return absl::OkStatus();
+  }
+
+  absl::Status TypeInfoRef(TypeInfo* type_info) {
+    if (auto it = locals_.find(type_info); it != locals_.end()) {
+      body_.Word("l");
+      body_.Int(it->second);
+      return absl::OkStatus();
+    }
+    if (type_info->parent() != nullptr) {
+      return absl::UnimplementedError(absl::StrCat(
+          "refers to a parametric instantiation in module ",
+          type_info->module()->name(), " made by another module"));
+    }
+    body_.Word("r");
+    return ModuleRef(type_info->module());
+  }
+
+  absl::Status NodeRef(AstNode* node) {
+    Module* module = node->owner();
+    auto it = node_indices_.find(module);
+    if (it == node_indices_.end()) {
+      absl::flat_hash_map<const AstNode*, int64_t> indices;
+      for (int64_t i = 0; i < module->nodes().size(); ++i) {
+        indices[module->nodes()[i]] = i;
+      }
+      it = node_indices_.emplace(module, std::move(indices)).first;
+    }
+    auto index = it->second.find(node);
+    absl::optional<int64_t> node_count = node_count_(module);
+    if (index == it->second.end() || !node_count.has_value() ||
+        index->second >= *node_count) {
+      return absl::UnimplementedError(
+          absl::StrCat("refers to an AST node made during typechecking: ",
+                       node->ToString()));
+    }
+    XLS_RETURN_IF_ERROR(ModuleRef(module));
+    body_.Int(index->second);
+    return absl::OkStatus();
+  }
+
+  absl::Status Type(const ConcreteType& type) {
+    if (dynamic_cast<const TokenType*>(&type) != nullptr) {
+      body_.Word("token");
+      return absl::OkStatus();
+    }
+    if (auto* bits = dynamic_cast<const BitsType*>(&type)) {
+      body_.Word("bits");
+      body_.Int(bits->is_signed());
+      return Dim(bits->size());
+    }
+    if (auto* array = dynamic_cast<const ArrayType*>(&type)) {
+      body_.Word("array");
+      XLS_RETURN_IF_ERROR(Type(array->element_type()));
+      return Dim(array->size());
+    }
+    if (auto* enum_type = dynamic_cast<const EnumType*>(&type)) {
+      body_.Word("enum");
+      XLS_RETURN_IF_ERROR(NodeRef(enum_type->nominal_type()));
+      return Dim(enum_type->size());
+    }
+    if (auto* tuple = dynamic_cast<const TupleType*>(&type)) {
+      body_.Word("tuple");
+      if (tuple->nominal_type() == nullptr) {
+        body_.Word(kNone);
+      } else {
+        body_.Word("struct");
+        XLS_RETURN_IF_ERROR(NodeRef(tuple->nominal_type()));
+      }
+      if (tuple->is_named()) {
+        const auto& members = absl::get<TupleType::NamedMembers>(
+            tuple->members());
+        body_.Word("named");
+        body_.Int(members.size());
+        for (const TupleType::NamedMember& member : members) {
+          body_.String(member.name);
+          XLS_RETURN_IF_ERROR(Type(*member.type));
+        }
+      } else {
+        const auto& members = absl::get<TupleType::UnnamedMembers>(
+            tuple->members());
+        body_.Word("unnamed");
+        body_.Int(members.size());
+        for (const std::unique_ptr<ConcreteType>& member : members) {
+          XLS_RETURN_IF_ERROR(Type(*member));
+        }
+      }
+      return absl::OkStatus();
+    }
+    if (auto* function = dynamic_cast<const FunctionType*>(&type)) {
+      body_.Word("function");
+      body_.Int(function->params().size());
+      for (const std::unique_ptr<ConcreteType>& param : function->params()) {
+        XLS_RETURN_IF_ERROR(Type(*param));
+      }
+      return Type(function->return_type());
+    }
+    return absl::UnimplementedError(
+        absl::StrCat("unsupported type: ", type.ToString()));
+  }
+
+  absl::Status Dim(const ConcreteTypeDim& dim) {
+    if (!dim.IsParametric()) {
+      body_.Word("i");
+      body_.Int(absl::get<int64_t>(dim.value()));
+      return absl::OkStatus();
+    }
+    body_.Word("p");
+    return Parametric(dim.parametric());
+  }
+
+  absl::Status Parametric(const ParametricExpression& e) {
+    if (auto* constant = dynamic_cast<const ParametricConstant*>(&e)) {
+      body_.Word("c");
+      body_.Int(constant->value());
+      return absl::OkStatus();
+    }
+    if (auto* add = dynamic_cast<const ParametricAdd*>(&e)) {
+      body_.Word("+");
+      XLS_RETURN_IF_ERROR(Parametric(add->lhs()));
+      return Parametric(add->rhs());
+    }
+    if (auto* mul = dynamic_cast<const ParametricMul*>(&e)) {
+      body_.Word("*");
+      XLS_RETURN_IF_ERROR(Parametric(mul->lhs()));
+      return Parametric(mul->rhs());
+    }
+    if (auto* symbol = dynamic_cast<const ParametricSymbol*>(&e)) {
+      body_.Word("s");
+      body_.String(symbol->identifier());
+      const Span& span = symbol->span();
+      body_.String(span.filename());
+      body_.Int(span.start().lineno());
+      body_.Int(span.start().colno());
+      body_.Int(span.limit().lineno());
+      body_.Int(span.limit().colno());
+      return absl::OkStatus();
+    }
+    return absl::UnimplementedError(
+        absl::StrCat("unsupported parametric expression: ", e.ToString()));
+  }
+
+  void Bindings(const SymbolicBindings& bindings) {
+    body_.Int(bindings.bindings().size());
+    for (const SymbolicBinding& binding : bindings.bindings()) {
+      body_.String(binding.identifier);
+      body_.Int(binding.value);
+    }
+  }
+
+  std::function<absl::optional<int64_t>(Module*)> node_count_;
+  std::function<absl::optional<std::string>(Module*)> key_;
+  EntryWriter body_;
+  std::vector<std::pair<std::string, std::string>> modules_;
+  absl::flat_hash_map<Module*, int64_t> module_indices_;
+  absl::flat_hash_map<Module*, absl::flat_hash_map<const AstNode*, int64_t>>
+      node_indices_;
+  absl::flat_hash_map<TypeInfo*, int64_t> locals_;
+};
+
+// A reference to type information in a decoded entry: either the k-th TypeInfo
+// the entry creates, or an existing root.
+struct DecodedTypeInfoRef {
+  int64_t local = -1;
+  TypeInfo* root = nullptr;
+  Module* module = nullptr;
+};
+
+// A decoded change, with every reference resolved and checked, so that
+// applying it cannot fail.
+struct DecodedChange {
+  TypeInfoChange::Kind kind;
+  DecodedTypeInfoRef type_info;
+  AstNode* node = nullptr;
+
+  // kNew.
+  Module* module = nullptr;
+  absl::optional<DecodedTypeInfoRef> parent;
+
+  // kItem.
+  std::unique_ptr<ConcreteType> type;
+
+  // kImport (module and type_info) and kInstantiation (type_info).
+  Module* imported_module = nullptr;
+  DecodedTypeInfoRef value_type_info;
+
+  // kConstant.
+  ConstantDef* constant_def = nullptr;
+
+  // kInvocationBindings, kInstantiation and kSliceStartAndWidth.
+  SymbolicBindings caller;
+  SymbolicBindings callee;
+  StartAndWidth start_width;
+
+  // kConstExpr.
+  int64_t value = 0;
+};
+
+class EntryDecoder {
+ public:
+  EntryDecoder(EntryReader* reader, TypeInfoOwner* owner,
+               std::function<absl::optional<int64_t>(Module*)> node_count)
+      : reader_(reader), owner_(owner), node_count_(std::move(node_count)) {}
+
+  // Decodes the module table, checking that each module is present with the
+  // expected key.
+  absl::Status ModuleTable(const ModuleLookup& lookup,
+                           const std::function<absl::optional<std::string>(
+                               Module*)>& key) {
+    XLS_ASSIGN_OR_RETURN(int64_t count, reader_->Int());
+    for (int64_t i = 0; i < count; ++i) {
+      XLS_ASSIGN_OR_RETURN(std::string name, reader_->String());
+      XLS_ASSIGN_OR_RETURN(std::string expected_key, reader_->String());
+      absl::optional<Module*> module = lookup(name);
+      if (!module.has_value() || key(*module) != expected_key) {
+        return EntryError(
+            absl::StrCat("module ", name, " is missing or has changed"));
+      }
+      modules_.push_back(*module);
+    }
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<DecodedChange> Change() {
+    DecodedChange change;
+    XLS_ASSIGN_OR_RETURN(absl::string_view kind_name, reader_->Word());
+    XLS_ASSIGN_OR_RETURN(change.kind, KindFromName(kind_name));
+    if (change.kind == TypeInfoChange::Kind::kNew) {
+      XLS_ASSIGN_OR_RETURN(change.module, ModuleRef());
+      XLS_ASSIGN_OR_RETURN(absl::string_view parent, reader_->Word());
+      if (parent == kNone) {
+        if (owner_->GetRootTypeInfo(change.module).ok() ||
+            created_roots_.contains(change.module)) {
+          return EntryError(absl::StrCat("module ", change.module->name(),
+                                         " already has type information"));
+        }
+        created_roots_.insert(change.module);
+      } else {
+        XLS_ASSIGN_OR_RETURN(change.parent, TypeInfoRef(parent));
+        if (change.parent->module != change.module) {
+          return EntryError("parent type information is for another module");
+        }
+      }
+      local_modules_.push_back(change.module);
+      return change;
+    }
+
+    XLS_ASSIGN_OR_RETURN(absl::string_view type_info_tag, reader_->Word());
+    XLS_ASSIGN_OR_RETURN(change.type_info, TypeInfoRef(type_info_tag));
+    switch (change.kind) {
+      case TypeInfoChange::Kind::kNew:
+        break;
+      case TypeInfoChange::Kind::kItem: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<AstNode>());
+        XLS_ASSIGN_OR_RETURN(change.type, Type());
+        break;
+      }
+      case TypeInfoChange::Kind::kImport: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<Import>());
+        XLS_ASSIGN_OR_RETURN(change.imported_module, ModuleRef());
+        XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader_->Word());
+        XLS_ASSIGN_OR_RETURN(change.value_type_info, TypeInfoRef(tag));
+        break;
+      }
+      case TypeInfoChange::Kind::kConstant: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<NameDef>());
+        XLS_ASSIGN_OR_RETURN(change.constant_def, NodeRef<ConstantDef>());
+        break;
+      }
+      case TypeInfoChange::Kind::kInvocationBindings: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<Invocation>());
+        XLS_ASSIGN_OR_RETURN(change.caller, Bindings());
+        XLS_ASSIGN_OR_RETURN(change.callee, Bindings());
+        break;
+      }
+      case TypeInfoChange::Kind::kInstantiation: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<Invocation>());
+        XLS_ASSIGN_OR_RETURN(change.caller, Bindings());
+        XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader_->Word());
+        XLS_ASSIGN_OR_RETURN(change.value_type_info, TypeInfoRef(tag));
+        break;
+      }
+      case TypeInfoChange::Kind::kSliceStartAndWidth: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<Slice>());
+        XLS_ASSIGN_OR_RETURN(change.caller, Bindings());
+        XLS_ASSIGN_OR_RETURN(change.start_width.start, reader_->Int());
+        XLS_ASSIGN_OR_RETURN(change.start_width.width, reader_->Int());
+        break;
+      }
+      case TypeInfoChange::Kind::kConstExpr: {
+        XLS_ASSIGN_OR_RETURN(change.node, NodeRef<Expr>());
+        XLS_ASSIGN_OR_RETURN(change.value, reader_->Int());
+        break;
+      }
+    }
+    if (change.node->owner() != change.type_info.module) {
+      return EntryError("change keyed on an AST node of another module");
+    }
+    return change;
+  }
+
+  // Returns whether the decoded changes create the root type information of
+  // "module".
+  bool CreatesRoot(Module* module) const {
+    return created_roots_.contains(module);
+  }
+
+ private:
+  absl::StatusOr<Module*> ModuleRef() {
+    XLS_ASSIGN_OR_RETURN(int64_t index, reader_->Int());
+    if (index < 0 || index >= modules_.size()) {
+      return EntryError(absl::StrCat("invalid module index ", index));
+    }
+    return modules_[index];
+  }
+
+  absl::StatusOr<DecodedTypeInfoRef> TypeInfoRef(absl::string_view tag) {
+    DecodedTypeInfoRef ref;
+    if (tag == "l") {
+      XLS_ASSIGN_OR_RETURN(ref.local, reader_->Int());
+      if (ref.local < 0 || ref.local >= local_modules_.size()) {
+        return EntryError(
+            absl::StrCat("invalid type information index ", ref.local));
+      }
+      ref.module = local_modules_[ref.local];
+      return ref;
+    }
+    if (tag != "r") {
+      return EntryError(absl::StrCat("invalid type information tag ", tag));
+    }
+    XLS_ASSIGN_OR_RETURN(ref.module, ModuleRef());
+    absl::StatusOr<TypeInfo*> root = owner_->GetRootTypeInfo(ref.module);
+    if (!root.ok()) {
+      return EntryError(absl::StrCat("module ", ref.module->name(),
+                                     " has no type information"));
+    }
+    ref.root = *root;
+    return ref;
+  }
+
+  template <typename T>
+  absl::StatusOr<T*> NodeRef() {
+    XLS_ASSIGN_OR_RETURN(Module * module, ModuleRef());
+    XLS_ASSIGN_OR_RETURN(int64_t index, reader_->Int());
+    absl::optional<int64_t> node_count = node_count_(module);
+    if (index < 0 || !node_count.has_value() || index >= *node_count ||
+        index >= module->nodes().size()) {
+      return EntryError(absl::StrCat("invalid AST node index ", index));
+    }
+    auto* node = dynamic_cast<T*>(module->nodes()[index]);
+    if (node == nullptr) {
+      return EntryError(
+          absl::StrCat("AST node ", index, " has an unexpected kind"));
+    }
+    return node;
+  }
+
+  absl::StatusOr<std::unique_ptr<ConcreteType>> Type() {
+    XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader_->Word());
+    if (tag == "token") {
+      return std::make_unique<TokenType>();
+    }
+    if (tag == "bits") {
+      XLS_ASSIGN_OR_RETURN(int64_t is_signed, reader_->Int());
+      XLS_ASSIGN_OR_RETURN(ConcreteTypeDim size, Dim());
+      return std::make_unique<BitsType>(is_signed != 0, std::move(size));
+    }
+    if (tag == "array") {
+      XLS_ASSIGN_OR_RETURN(std::unique_ptr<ConcreteType> element, Type());
+      XLS_ASSIGN_OR_RETURN(ConcreteTypeDim size, Dim());
+      return std::make_unique<ArrayType>(std::move(element), std::move(size));
+    }
+    if (tag == "enum") {
+      XLS_ASSIGN_OR_RETURN(EnumDef * enum_def, NodeRef<EnumDef>());
+      XLS_ASSIGN_OR_RETURN(ConcreteTypeDim size, Dim());
+      return std::make_unique<EnumType>(enum_def, std::move(size));
+    }
+    if (tag == "tuple") {
+      StructDef* struct_def = nullptr;
+      XLS_ASSIGN_OR_RETURN(absl::string_view nominal, reader_->Word());
+      if (nominal == "struct") {
+        XLS_ASSIGN_OR_RETURN(struct_def, NodeRef<StructDef>());
+      } else if (nominal != kNone) {
+        return EntryError(absl::StrCat("invalid tuple tag ", nominal));
+      }
+      XLS_ASSIGN_OR_RETURN(absl::string_view kind, reader_->Word());
+      XLS_ASSIGN_OR_RETURN(int64_t count, reader_->Int());
+      if (kind == "named") {
+        TupleType::NamedMembers members;
+        for (int64_t i = 0; i < count; ++i) {
+          XLS_ASSIGN_OR_RETURN(std::string name, reader_->String());
+          XLS_ASSIGN_OR_RETURN(std::unique_ptr<ConcreteType> type, Type());
+          members.push_back(TupleType::NamedMember{name, std::move(type)});
+        }
+        return std::make_unique<TupleType>(std::move(members), struct_def);
+      }
+      if (kind != "unnamed") {
+        return EntryError(absl::StrCat("invalid tuple kind ", kind));
+      }
+      TupleType::UnnamedMembers members;
+      for (int64_t i = 0; i < count; ++i) {
+        XLS_ASSIGN_OR_RETURN(std::unique_ptr<ConcreteType> type, Type());
+        members.push_back(std::move(type));
+      }
+      return std::make_unique<TupleType>(std::move(members), struct_def);
+    }
+    if (tag == "function") {
+      XLS_ASSIGN_OR_RETURN(int64_t count, reader_->Int());
+      std::vector<std::unique_ptr<ConcreteType>> params;
+      for (int64_t i = 0; i < count; ++i) {
+        XLS_ASSIGN_OR_RETURN(std::unique_ptr<ConcreteType> param, Type());
+        params.push_back(std::move(param));
+      }
+      XLS_ASSIGN_OR_RETURN(std::unique_ptr<ConcreteType> return_type, Type());
+      return std::make_unique<FunctionType>(std::move(params),
+                                            std::move(return_type));
+    }
+    return EntryError(absl::StrCat("invalid type tag ", tag));
+  }
+
+  absl::StatusOr<ConcreteTypeDim> Dim() {
+    XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader_->Word());
+    if (tag == "i") {
+      XLS_ASSIGN_OR_RETURN(int64_t value, reader_->Int());
+      return ConcreteTypeDim(value);
+    }
+    if (tag != "p") {
+      return EntryError(absl::StrCat("invalid dimension tag ", tag));
+    }
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<ParametricExpression> e,
+                         Parametric());
+    return ConcreteTypeDim(ConcreteTypeDim::Variant(std::move(e)));
+  }
+
+  absl::StatusOr<std::unique_ptr<ParametricExpression>> Parametric() {
+    XLS_ASSIGN_OR_RETURN(absl::string_view tag, reader_->Word());
+    if (tag == "c") {
+      XLS_ASSIGN_OR_RETURN(int64_t value, reader_->Int());
+      return std::make_unique<ParametricConstant>(value);
+    }
+    if (tag == "+" || tag == "*") {
+      bool is_add = tag == "+";
+      XLS_ASSIGN_OR_RETURN(std::unique_ptr<ParametricExpression> lhs,
+                           Parametric());
+      XLS_ASSIGN_OR_RETURN(std::unique_ptr<ParametricExpression> rhs,
+                           Parametric());
+      if (is_add) {
+        return std::make_unique<ParametricAdd>(std::move(lhs), std::move(rhs));
+      }
+      return std::make_unique<ParametricMul>(std::move(lhs), std::move(rhs));
+    }
+    if (tag != "s") {
+      return EntryError(absl::StrCat("invalid parametric tag ", tag));
+    }
+    XLS_ASSIGN_OR_RETURN(std::string identifier, reader_->String());
+    XLS_ASSIGN_OR_RETURN(std::string filename, reader_->String());
+    XLS_ASSIGN_OR_RETURN(int64_t start_lineno, reader_->Int());
+    XLS_ASSIGN_OR_RETURN(int64_t start_colno, reader_->Int());
+    XLS_ASSIGN_OR_RETURN(int64_t limit_lineno, reader_->Int());
+    XLS_ASSIGN_OR_RETURN(int64_t limit_colno, reader_->Int());
+    return std::make_unique<ParametricSymbol>(
+        identifier, Span(Pos(filename, start_lineno, start_colno),
+                         Pos(filename, limit_lineno, limit_colno)));
+  }
+
+  absl::StatusOr<SymbolicBindings> Bindings() {
+    XLS_ASSIGN_OR_RETURN(int64_t count, reader_->Int());
+    std::vector<std::pair<std::string, int64_t>> items;
+    for (int64_t i = 0; i < count; ++i) {
+      XLS_ASSIGN_OR_RETURN(std::string identifier, reader_->String());
+      XLS_ASSIGN_OR_RETURN(int64_t value, reader_->Int());
+      items.push_back({identifier, value});
+    }
+    return SymbolicBindings(items);
+  }
+
+  EntryReader* reader_;
+  TypeInfoOwner* owner_;
+  std::function<absl::optional<int64_t>(Module*)> node_count_;
+  std::vector<Module*> modules_;
+  std::vector<Module*> local_modules_;
+  absl::flat_hash_set<Module*> created_roots_;
+};
+
+// Replays decoded changes; see DecodedChange.
+absl::Status ApplyChanges(absl::Span<const DecodedChange> changes,
+                          TypeInfoOwner* owner) {
+  std::vector<TypeInfo*> locals;
+  auto resolve = [&locals](const DecodedTypeInfoRef& ref) {
+    return ref.local >= 0 ? locals[ref.local] : ref.root;
+  };
+  for (const DecodedChange& change : changes) {
+    if (change.kind == TypeInfoChange::Kind::kNew) {
+      XLS_ASSIGN_OR_RETURN(
+          TypeInfo * type_info,
+          owner->New(change.module, change.parent.has_value()
+                                        ? resolve(*change.parent)
+                                        : nullptr));
+      locals.push_back(type_info);
+      continue;
+    }
+    TypeInfo* type_info = resolve(change.type_info);
+    switch (change.kind) {
+      case TypeInfoChange::Kind::kNew:
+        break;
+      case TypeInfoChange::Kind::kItem:
+        type_info->SetItem(change.node, *change.type);
+        break;
+      case TypeInfoChange::Kind::kImport:
+        type_info->AddImport(static_cast<Import*>(change.node),
+                             change.imported_module,
+                             resolve(change.value_type_info));
+        break;
+      case TypeInfoChange::Kind::kConstant:
+        type_info->NoteConstant(static_cast<NameDef*>(change.node),
+                                change.constant_def);
+        break;
+      case TypeInfoChange::Kind::kInvocationBindings:
+        type_info->AddInvocationSymbolicBindings(
+            static_cast<Invocation*>(change.node), change.caller,
+            change.callee);
+        break;
+      case TypeInfoChange::Kind::kInstantiation:
+        type_info->AddInstantiation(static_cast<Invocation*>(change.node),
+                                    change.caller,
+                                    resolve(change.value_type_info));
+        break;
+      case TypeInfoChange::Kind::kSliceStartAndWidth:
+        type_info->AddSliceStartAndWidth(static_cast<Slice*>(change.node),
+                                         change.caller, change.start_width);
+        break;
+      case TypeInfoChange::Kind::kConstExpr:
+        type_info->NoteConstExpr(static_cast<Expr*>(change.node),
+                                 change.value);
+        break;
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::optional<std::string> TypecheckCache::NoteModule(
+    Module* module, absl::string_view contents,
+    absl::Span<Module* const> imports) {
+  absl::MutexLock lock(&mutex_);
+  EntryWriter writer;
+  writer.Int(kTypecheckCacheFormatVersion);
+  writer.String(module->name());
+  writer.String(contents);
+  bool cacheable = true;
+  for (Module* import : imports) {
+    auto it = noted_.find(import);
+    if (it == noted_.end() || !it->second.key.has_value()) {
+      cacheable = false;
+      break;
+    }
+    writer.String(*it->second.key);
+  }
+  absl::optional<std::string> key;
+  if (cacheable) {
+    key = absl::StrFormat("%s-%016x", module->name(), StableHash64(writer.text()));
+  }
+  noted_[module] = NotedModule{key, std::string(contents),
+                               static_cast<int64_t>(module->nodes().size())};
+  modules_by_name_[module->name()] = module;
+  return key;
+}
+
+std::filesystem::path TypecheckCache::GetPath(
+    const std::string& key, absl::string_view extension) const {
+  return cache_dir_ / absl::StrCat(key, ".", extension);
+}
+
+absl::optional<TypeInfo*> TypecheckCache::Load(Module* module,
+                                               TypeInfoOwner* owner) {
+  NotedModule noted;
+  {
+    absl::MutexLock lock(&mutex_);
+    noted = noted_.at(module);
+  }
+  if (!noted.key.has_value()) {
+    return absl::nullopt;
+  }
+  auto miss = [this]() -> absl::optional<TypeInfo*> {
+    absl::MutexLock lock(&mutex_);
+    ++misses_;
+    return absl::nullopt;
+  };
+  std::filesystem::path path = GetPath(*noted.key, "typecheck");
+  if (!FileExists(path).ok()) {
+    return miss();
+  }
+  absl::StatusOr<std::string> text = GetFileContents(path);
+  if (!text.ok()) {
+    XLS_LOG(WARNING) << "Unable to read typecheck cache entry: "
+                     << text.status();
+    return miss();
+  }
+
+  auto node_count = [this](Module* m) -> absl::optional<int64_t> {
+    mutex_.AssertHeld();
+    auto it = noted_.find(m);
+    if (it == noted_.end()) {
+      return absl::nullopt;
+    }
+    return it->second.node_count;
+  };
+  auto key = [this](Module* m) -> absl::optional<std::string> {
+    mutex_.AssertHeld();
+    auto it = noted_.find(m);
+    if (it == noted_.end()) {
+      return absl::nullopt;
+    }
+    return it->second.key;
+  };
+  ModuleLookup lookup = [this](absl::string_view name)
+      -> absl::optional<Module*> {
+    mutex_.AssertHeld();
+    auto it = modules_by_name_.find(name);
+    if (it == modules_by_name_.end()) {
+      return absl::nullopt;
+    }
+    return it->second;
+  };
+  auto decode = [&]() -> absl::StatusOr<std::vector<DecodedChange>> {
+    absl::MutexLock lock(&mutex_);
+    EntryReader reader(*text);
+    XLS_ASSIGN_OR_RETURN(absl::string_view magic, reader.Word());
+    XLS_ASSIGN_OR_RETURN(int64_t version, reader.Int());
+    if (magic != kEntryMagic || version != kTypecheckCacheFormatVersion) {
+      return EntryError("unknown format");
+    }
+    XLS_ASSIGN_OR_RETURN(std::string contents, reader.String());
+    XLS_ASSIGN_OR_RETURN(int64_t module_node_count, reader.Int());
+    if (contents != noted.contents || module_node_count != noted.node_count) {
+      return EntryError("the module has changed");
+    }
+    EntryDecoder decoder(&reader, owner, node_count);
+    XLS_RETURN_IF_ERROR(decoder.ModuleTable(lookup, key));
+    XLS_ASSIGN_OR_RETURN(int64_t change_count, reader.Int());
+    std::vector<DecodedChange> changes;
+    for (int64_t i = 0; i < change_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(DecodedChange change, decoder.Change());
+      changes.push_back(std::move(change));
+    }
+    if (!reader.AtEnd()) {
+      return EntryError("trailing data");
+    }
+    if (!decoder.CreatesRoot(module)) {
+      return EntryError("no type information for the module");
+    }
+    return changes;
+  };
+  absl::StatusOr<std::vector<DecodedChange>> changes = decode();
+  if (!changes.ok()) {
+    XLS_LOG(WARNING) << "Ignoring typecheck cache entry " << path.string()
+                     << ": " << changes.status();
+    return miss();
+  }
+
+  // Decoding checked every reference, so applying the changes can't fail. The
+  // changes belong to this entry, so keep them from any enclosing recorder.
+  {
+    TypeInfoChangeRecorder recorder;
+    XLS_CHECK_OK(ApplyChanges(*changes, owner));
+  }
+  absl::StatusOr<TypeInfo*> type_info = owner->GetRootTypeInfo(module);
+  XLS_CHECK_OK(type_info.status());
+  XLS_VLOG(1) << "Loaded typecheck cache entry: " << path.string();
+  absl::MutexLock lock(&mutex_);
+  ++hits_;
+  return *type_info;
+}
+
+void TypecheckCache::Store(Module* module,
+                           absl::Span<const TypeInfoChange> changes) {
+  std::string key;
+  EntryWriter entry;
+  {
+    absl::MutexLock lock(&mutex_);
+    const NotedModule& noted = noted_.at(module);
+    if (!noted.key.has_value()) {
+      return;
+    }
+    key = *noted.key;
+
+    EntrySerializer serializer(
+        [this](Module* m) -> absl::optional<int64_t> {
+          mutex_.AssertHeld();
+          auto it = noted_.find(m);
+          if (it == noted_.end()) {
+            return absl::nullopt;
+          }
+          return it->second.node_count;
+        },
+        [this](Module* m) -> absl::optional<std::string> {
+          mutex_.AssertHeld();
+          // Modules are referred to by name, so the name must be unambiguous.
+          auto it = noted_.find(m);
+          auto by_name = modules_by_name_.find(m->name());
+          if (it == noted_.end() || by_name == modules_by_name_.end() ||
+              by_name->second != m) {
+            return absl::nullopt;
+          }
+          return it->second.key;
+        });
+    // Only the last value for each key matters, and it is read from the type
+    // information itself, so each key is only written once.
+    absl::flat_hash_set<
+        std::tuple<TypeInfoChange::Kind, TypeInfo*, AstNode*, SymbolicBindings>>
+        seen;
+    int64_t change_count = 0;
+    for (const TypeInfoChange& change : changes) {
+      if (!seen.insert({change.kind, change.type_info, change.node,
+                        change.caller})
+               .second) {
+        continue;
+      }
+      absl::Status status = serializer.Change(change);
+      if (!status.ok()) {
+        XLS_VLOG(1) << "Not caching typecheck results of module "
+                    << module->name() << ": " << status;
+        return;
+      }
+      ++change_count;
+    }
+
+    entry.Word(kEntryMagic);
+    entry.Int(kTypecheckCacheFormatVersion);
+    entry.String(noted.contents);
+    entry.Int(noted.node_count);
+    entry.Append(serializer.Finish(change_count));
+  }
+  WriteEntry(key, "typecheck", entry.text());
+}
+
+TypecheckCache::ModuleConstants& TypecheckCache::GetConstants(Module* module) {
+  auto it = constants_.find(module);
+  if (it != constants_.end()) {
+    return it->second;
+  }
+  ModuleConstants& constants = constants_[module];
+  auto noted = noted_.find(module);
+  if (noted == noted_.end() || !noted->second.key.has_value()) {
+    return constants;
+  }
+  // This happens once per module, so the entry is simply read under the lock.
+  std::filesystem::path path = GetPath(*noted->second.key, "constants");
+  if (!FileExists(path).ok()) {
+    return constants;
+  }
+  absl::StatusOr<std::string> text = GetFileContents(path);
+  if (!text.ok()) {
+    XLS_LOG(WARNING) << "Unable to read constant cache entry: "
+                     << text.status();
+    return constants;
+  }
+  auto decode =
+      [&]() -> absl::StatusOr<absl::flat_hash_map<std::string, InterpValue>> {
+    EntryReader reader(*text);
+    XLS_ASSIGN_OR_RETURN(absl::string_view magic, reader.Word());
+    XLS_ASSIGN_OR_RETURN(int64_t version, reader.Int());
+    if (magic != kConstantsMagic || version != kConstantCacheFormatVersion) {
+      return EntryError("unknown format");
+    }
+    XLS_ASSIGN_OR_RETURN(std::string contents, reader.String());
+    if (contents != noted->second.contents) {
+      return EntryError("the module has changed");
+    }
+    XLS_ASSIGN_OR_RETURN(int64_t count, reader.Int());
+    absl::flat_hash_map<std::string, InterpValue> values;
+    for (int64_t i = 0; i < count; ++i) {
+      XLS_ASSIGN_OR_RETURN(std::string name, reader.String());
+      XLS_ASSIGN_OR_RETURN(InterpValue value, ReadValue(&reader));
+      values.insert({std::move(name), std::move(value)});
+    }
+    if (!reader.AtEnd()) {
+      return EntryError("trailing data");
+    }
+    return values;
+  };
+  absl::StatusOr<absl::flat_hash_map<std::string, InterpValue>> values =
+      decode();
+  if (!values.ok()) {
+    XLS_LOG(WARNING) << "Ignoring constant cache entry " << path.string()
+                     << ": " << values.status();
+    return constants;
+  }
+  XLS_VLOG(1) << "Loaded constant cache entry: " << path.string();
+  constants.values = std::move(values).value();
+  return constants;
+}
+
+absl::optional<InterpValue> TypecheckCache::LoadConstant(
+    Module* module, absl::string_view name) {
+  absl::MutexLock lock(&mutex_);
+  const ModuleConstants& constants = GetConstants(module);
+  auto it = constants.values.find(name);
+  if (it == constants.values.end()) {
+    return absl::nullopt;
+  }
+  ++constant_hits_;
+  return it->second;
+}
+
+void TypecheckCache::NoteConstant(Module* module, absl::string_view name,
+                                  const InterpValue& value) {
+  if (!IsCacheableValue(value)) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  ModuleConstants& constants = GetConstants(module);
+  if (constants.values.insert({std::string(name), value}).second) {
+    constants.dirty = true;
+  }
+}
+
+void TypecheckCache::StoreConstants(Module* module) {
+  std::string key;
+  EntryWriter entry;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto noted = noted_.find(module);
+    auto it = constants_.find(module);
+    if (noted == noted_.end() || !noted->second.key.has_value() ||
+        it == constants_.end() || !it->second.dirty) {
+      return;
+    }
+    key = *noted->second.key;
+    ModuleConstants& constants = it->second;
+    // Write the constants in a stable order so entries are reproducible.
+    std::vector<const std::string*> names;
+    for (const auto& [name, value] : constants.values) {
+      names.push_back(&name);
+    }
+    std::sort(names.begin(), names.end(),
+              [](const std::string* a, const std::string* b) {
+                return *a < *b;
+              });
+    entry.Word(kConstantsMagic);
+    entry.Int(kConstantCacheFormatVersion);
+    entry.String(noted->second.contents);
+    entry.Int(names.size());
+    for (const std::string* name : names) {
+      entry.String(*name);
+      WriteValue(constants.values.at(*name), &entry);
+    }
+    constants.dirty = false;
+  }
+  WriteEntry(key, "constants", entry.text());
+}
+
+void TypecheckCache::WriteEntry(const std::string& key,
+                                absl::string_view extension,
+                                const std::string& text) {
+  absl::Status status = RecursivelyCreateDir(cache_dir_);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to create typecheck cache directory: "
+                     << status;
+    return;
+  }
+  status = AtomicSetFileContents(GetPath(key, extension), text);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to write typecheck cache entry: " << status;
+  }
+}
+
+}  // namespace xls::dslx
@@ -0,0 +1,150 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DSLX_TYPECHECK_CACHE_H_
+#define XLS_DSLX_TYPECHECK_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/dslx/ast.h"
+#include "xls/dslx/interp_value.h"
+#include "xls/dslx/type_info.h"
+
+namespace xls::dslx {
+
+// A content-addressed, on-disk cache of the results of typechecking imported
+// modules, one file per module in the cache directory.
+//
+// Typechecking a module creates its root TypeInfo (and children for parametric
+// instantiations), but it can also add type information to the modules it
+// imports, e.g. for instantiations of their parametric functions. An entry
+// holds all of these changes, as recorded by a TypeInfoChangeRecorder, and its
+// key covers the module text and the keys of its imports, so it is
+// only used when the whole import closure is unchanged. Loading an entry
+// replays the changes for the freshly parsed module: parsing is cheap and
+// always makes the same AST nodes in the same order, so entries refer to AST
+// nodes by their position in Module::nodes().
+//
+// Modules whose typechecking can't be captured this way (e.g. because it made
+// new AST nodes) are not cached. Entries are only meaningful to the
+// typechecker that wrote them: bump kTypecheckCacheFormatVersion when changing
+// what typechecking records. The cache is thread-safe and may be shared by
+// concurrent processes; I/O failures are logged and otherwise ignored, i.e.,
+// they only cost a typecheck.
+//
+// Evaluating the module-level constants of a module (e.g. large lookup tables)
+// can cost more than typechecking it, so the cache also holds their values, in
+// a second file per module ("<key>.constants") under the same key.
+class TypecheckCache {
+ public:
+  explicit TypecheckCache(std::filesystem::path cache_dir)
+      : cache_dir_(std::move(cache_dir)) {}
+
+  // Notes that "module" was parsed from "contents" and that "imports" are the
+  // modules it imports, which must have been noted before. Returns the key of
+  // the entry for the module, or nullopt if the module can't be cached.
+  absl::optional<std::string> NoteModule(Module* module,
+                                         absl::string_view contents,
+                                         absl::Span<Module* const> imports);
+
+  // Attempts to load the entry for the (noted) "module", replaying its changes
+  // into "owner". Returns the root type information of the module, or nullopt
+  // if there is no usable entry and the module must be typechecked.
+  absl::optional<TypeInfo*> Load(Module* module, TypeInfoOwner* owner);
+
+  // Stores the entry for the (noted) "module", which has just been
+  // typechecked making "changes" (which must not include the changes made
+  // while importing other modules).
+  void Store(Module* module, absl::Span<const TypeInfoChange> changes);
+
+  // Returns the value of the constant "name" of the (noted) "module" recorded
+  // by a previous process, or nullopt if there is none.
+  absl::optional<InterpValue> LoadConstant(Module* module,
+                                           absl::string_view name);
+
+  // Notes that the constant "name" of the (noted) "module" evaluated to
+  // "value". Values that don't stand on their own (e.g. enums and functions,
+  // which refer to AST nodes) are not cached.
+  void NoteConstant(Module* module, absl::string_view name,
+                    const InterpValue& value);
+
+  // Stores the constants noted for "module", if any were added since its
+  // entry was loaded.
+  void StoreConstants(Module* module);
+
+  int64_t hits() const {
+    absl::MutexLock lock(&mutex_);
+    return hits_;
+  }
+  int64_t misses() const {
+    absl::MutexLock lock(&mutex_);
+    return misses_;
+  }
+  int64_t constant_hits() const {
+    absl::MutexLock lock(&mutex_);
+    return constant_hits_;
+  }
+
+ private:
+  struct NotedModule {
+    absl::optional<std::string> key;
+    std::string contents;
+    // The number of AST nodes the module had when it was parsed.
+    int64_t node_count;
+  };
+
+  // The constant values of a module, keyed by identifier.
+  struct ModuleConstants {
+    absl::flat_hash_map<std::string, InterpValue> values;
+    // Whether values were added since the entry was loaded.
+    bool dirty = false;
+  };
+
+  // Returns the path of the entry for "key" with the given extension
+  // ("typecheck" or "constants").
+  std::filesystem::path GetPath(const std::string& key,
+                                absl::string_view extension) const;
+
+  // Writes "text" as the entry for "key" with the given extension.
+  void WriteEntry(const std::string& key, absl::string_view extension,
+                  const std::string& text);
+
+  // Returns the constants of "module", reading its entry the first time.
+  ModuleConstants& GetConstants(Module* module)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::filesystem::path cache_dir_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<Module*, NotedModule> noted_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, Module*> modules_by_name_
+      ABSL_GUARDED_BY(mutex_);
+  int64_t hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t misses_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<Module*, ModuleConstants> constants_
+      ABSL_GUARDED_BY(mutex_);
+  int64_t constant_hits_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace xls::dslx
+
+#endif  // XLS_DSLX_TYPECHECK_CACHE_H_
@@ -0,0 +1,257 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/typecheck_cache.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/interp_value.h"
+#include "xls/dslx/interpreter.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/dslx/parse_and_typecheck.h"
+
+namespace xls::dslx {
+namespace {
+
+using testing::HasSubstr;
+
+constexpr char kUtil[] = R"(
+pub const WIDTH = u32:8;
+
+pub enum Color : u2 {
+  RED = 0,
+  BLUE = 1,
+}
+
+pub fn double<N: u32>(x: uN[N]) -> uN[N] { x + x }
+)";
+
+constexpr char kLib[] = R"(
+import cached_util
+
+pub struct Point {
+  x: u32,
+  y: u32,
+}
+
+pub fn make_point(x: u32) -> Point {
+  Point { x: x, y: cached_util::double(x) }
+}
+
+pub fn low_bits(x: u32) -> u8 { x[0:8] }
+
+pub fn is_red(c: cached_util::Color) -> bool { c == cached_util::Color::RED }
+)";
+
+constexpr char kMain[] = R"(
+import cached_lib
+import cached_util
+
+fn main(x: u32) -> (cached_lib::Point, u8, u16) {
+  (cached_lib::make_point(x), cached_lib::low_bits(x),
+   cached_util::double(x as u16))
+}
+)";
+
+constexpr char kTables[] = R"(
+fn square(x: u32) -> u32 { x * x }
+
+pub const SQUARES = [
+  square(u32:0), square(u32:1), square(u32:2), square(u32:3)
+];
+pub const PAIR = (u8:7, s4:-2);
+
+pub fn lookup(i: u2) -> u32 { SQUARES[i] }
+)";
+
+constexpr char kTablesMain[] = R"(
+import cached_tables
+
+fn main(i: u2) -> (u32, (u8, s4)) {
+  (cached_tables::lookup(i), cached_tables::PAIR)
+}
+)";
+
+class TypecheckCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+    temp_dir_ = std::make_unique<TempDirectory>(std::move(temp_dir));
+    XLS_ASSERT_OK(SetFileContents(path() / "cached_util.x", kUtil));
+    XLS_ASSERT_OK(SetFileContents(path() / "cached_lib.x", kLib));
+    XLS_ASSERT_OK(SetFileContents(path() / "cached_tables.x", kTables));
+  }
+
+  const std::filesystem::path& path() const { return temp_dir_->path(); }
+  std::filesystem::path cache_dir() const { return path() / "cache"; }
+
+  // Typechecks the main module with a fresh ImportData using the cache and
+  // returns its IR conversion.
+  absl::StatusOr<std::string> TypecheckAndConvert(ImportData* import_data) {
+    import_data->EnableTypecheckCache(cache_dir());
+    std::vector<std::string> search_paths = {path().string()};
+    XLS_ASSIGN_OR_RETURN(TypecheckedModule tm,
+                         ParseAndTypecheck(kMain, "main.x", "main",
+                                           import_data, search_paths));
+    return ConvertModule(tm.module, import_data);
+  }
+
+  // Typechecks the tables module's user with a fresh ImportData using the
+  // cache.
+  absl::StatusOr<TypecheckedModule> TypecheckTables(ImportData* import_data) {
+    import_data->EnableTypecheckCache(cache_dir());
+    std::vector<std::string> search_paths = {path().string()};
+    return ParseAndTypecheck(kTablesMain, "tables_main.x", "tables_main",
+                             import_data, search_paths);
+  }
+
+  // Interprets main(i) of the tables module's user.
+  absl::StatusOr<InterpValue> RunTables(ImportData* import_data, int64_t i) {
+    XLS_ASSIGN_OR_RETURN(TypecheckedModule tm, TypecheckTables(import_data));
+    Interpreter interp(tm.module, /*typecheck=*/nullptr,
+                       /*additional_search_paths=*/{path().string()},
+                       import_data);
+    return interp.RunFunction("main", {InterpValue::MakeUBits(2, i)});
+  }
+
+  std::unique_ptr<TempDirectory> temp_dir_;
+};
+
+TEST_F(TypecheckCacheTest, LoadsTypecheckedModules) {
+  ImportData cold;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string cold_ir, TypecheckAndConvert(&cold));
+  EXPECT_EQ(cold.typecheck_cache()->hits(), 0);
+  EXPECT_EQ(cold.typecheck_cache()->misses(), 2);
+
+  ImportData warm;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string warm_ir, TypecheckAndConvert(&warm));
+  EXPECT_EQ(warm.typecheck_cache()->hits(), 2);
+  EXPECT_EQ(warm.typecheck_cache()->misses(), 0);
+  EXPECT_EQ(warm_ir, cold_ir);
+
+  // Every AST node of the cached modules has the same type as when it was
+  // typechecked.
+  for (const char* name : {"cached_util", "cached_lib"}) {
+    XLS_ASSERT_OK_AND_ASSIGN(const ModuleInfo* cold_info,
+                             cold.Get(ImportTokens({name})));
+    XLS_ASSERT_OK_AND_ASSIGN(const ModuleInfo* warm_info,
+                             warm.Get(ImportTokens({name})));
+    absl::Span<AstNode* const> cold_nodes =
+        cold_info->module->nodes();
+    absl::Span<AstNode* const> warm_nodes =
+        warm_info->module->nodes();
+    ASSERT_EQ(cold_nodes.size(), warm_nodes.size());
+    for (int64_t i = 0; i < cold_nodes.size(); ++i) {
+      absl::optional<ConcreteType*> cold_type =
+          cold_info->type_info->GetItem(cold_nodes[i]);
+      absl::optional<ConcreteType*> warm_type =
+          warm_info->type_info->GetItem(warm_nodes[i]);
+      ASSERT_EQ(cold_type.has_value(), warm_type.has_value())
+          << name << " " << cold_nodes[i]->ToString();
+      if (cold_type.has_value()) {
+        EXPECT_EQ((*cold_type)->ToString(), (*warm_type)->ToString())
+            << name << " " << cold_nodes[i]->ToString();
+      }
+    }
+  }
+}
+
+TEST_F(TypecheckCacheTest, ChangedImportInvalidatesEntries) {
+  ImportData cold;
+  XLS_ASSERT_OK(TypecheckAndConvert(&cold).status());
+
+  XLS_ASSERT_OK(SetFileContents(
+      path() / "cached_util.x",
+      absl::StrCat(kUtil, "\npub fn triple(x: u32) -> u32 { x * u32:3 }\n")));
+  ImportData warm;
+  XLS_ASSERT_OK(TypecheckAndConvert(&warm).status());
+  EXPECT_EQ(warm.typecheck_cache()->hits(), 0);
+  EXPECT_EQ(warm.typecheck_cache()->misses(), 2);
+}
+
+TEST_F(TypecheckCacheTest, IgnoresCorruptEntries) {
+  ImportData cold;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string cold_ir, TypecheckAndConvert(&cold));
+
+  int64_t entry_count = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(cache_dir())) {
+    if (entry.path().extension() != ".typecheck") {
+      continue;
+    }
+    XLS_ASSERT_OK(SetFileContents(entry.path(), "xls_dslx_typecheck_cache 1 "));
+    ++entry_count;
+  }
+  EXPECT_EQ(entry_count, 2);
+
+  ImportData warm;
+  XLS_ASSERT_OK_AND_ASSIGN(std::string warm_ir, TypecheckAndConvert(&warm));
+  EXPECT_EQ(warm.typecheck_cache()->hits(), 0);
+  EXPECT_EQ(warm_ir, cold_ir);
+}
+
+TEST_F(TypecheckCacheTest, LoadsConstantValues) {
+  InterpValue expected = InterpValue::MakeTuple(
+      {InterpValue::MakeU32(4),
+       InterpValue::MakeTuple(
+           {InterpValue::MakeUBits(8, 7), InterpValue::MakeSBits(4, -2)})});
+  ImportData cold;
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue cold_result, RunTables(&cold, 2));
+  EXPECT_TRUE(cold_result.Eq(expected)) << cold_result.ToString();
+  EXPECT_EQ(cold.typecheck_cache()->constant_hits(), 0);
+
+  int64_t entry_count = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(cache_dir())) {
+    entry_count += entry.path().extension() == ".constants";
+  }
+  EXPECT_EQ(entry_count, 1);
+
+  ImportData warm;
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue warm_result, RunTables(&warm, 2));
+  EXPECT_TRUE(warm_result.Eq(expected)) << warm_result.ToString();
+  EXPECT_EQ(warm.typecheck_cache()->constant_hits(), 2);
+
+  // IR conversion uses the cached values in place of the constants'
+  // expressions.
+  ImportData convert;
+  XLS_ASSERT_OK_AND_ASSIGN(TypecheckedModule tm, TypecheckTables(&convert));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string ir, ConvertModule(tm.module, &convert));
+  EXPECT_GT(convert.typecheck_cache()->constant_hits(), 0);
+  EXPECT_THAT(ir, HasSubstr("value=[0, 1, 4, 9]"));
+}
+
+TEST_F(TypecheckCacheTest, ChangedModuleInvalidatesConstants) {
+  ImportData cold;
+  XLS_ASSERT_OK(RunTables(&cold, 3).status());
+
+  XLS_ASSERT_OK(SetFileContents(
+      path() / "cached_tables.x",
+      absl::StrCat(kTables, "\npub const EXTRA = u32:42;\n")));
+  ImportData warm;
+  XLS_ASSERT_OK_AND_ASSIGN(InterpValue result, RunTables(&warm, 3));
+  EXPECT_EQ(warm.typecheck_cache()->constant_hits(), 0);
+  EXPECT_TRUE(result.GetValuesOrDie()[0].Eq(InterpValue::MakeU32(9)))
+      << result.ToString();
+}
+
+}  // namespace
+}  // namespace xls::dslx
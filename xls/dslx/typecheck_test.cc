@@ -54,6 +54,41 @@ fn main() -> u32 { id<u32:32, u32:64>(u32:5) }
           HasSubstr("Too many parametric values supplied; limit: 1 given: 2")));
 }
 
+TEST(TypecheckTest, ParametricInstantiationsAreShared) {
+  absl::string_view text = R"(
+fn double<N: u32>(x: bits[N]) -> bits[N] { x + x }
+fn f(a: u8, b: u8, c: u16) -> u8 {
+  let _ = double(c);
+  double(a) + double(b)
+}
+)";
+  ImportData import_data;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      TypecheckedModule tm,
+      ParseAndTypecheck(text, "fake.x", "fake", &import_data,
+                        /*additional_search_paths=*/{}));
+  std::vector<TypeInfo*> instantiations;
+  for (const std::unique_ptr<AstNode>& node : tm.module->nodes()) {
+    auto* invocation = dynamic_cast<Invocation*>(node.get());
+    if (invocation == nullptr) {
+      continue;
+    }
+    absl::optional<const SymbolicBindings*> callee_bindings =
+        tm.type_info->GetInvocationSymbolicBindings(invocation,
+                                                    SymbolicBindings());
+    ASSERT_TRUE(callee_bindings.has_value());
+    absl::optional<TypeInfo*> instantiation =
+        tm.type_info->GetInstantiation(invocation, **callee_bindings);
+    ASSERT_TRUE(instantiation.has_value());
+    instantiations.push_back(*instantiation);
+  }
+  // The two invocations with the same bindings share the type information of
+  // the instantiation.
+  ASSERT_EQ(instantiations.size(), 3);
+  EXPECT_NE(instantiations[0], instantiations[1]);
+  EXPECT_EQ(instantiations[1], instantiations[2]);
+}
+
 TEST(TypecheckTest, Identity) {
   XLS_EXPECT_OK(Typecheck("fn f(x: u32) -> u32 { x }"));
   XLS_EXPECT_OK(Typecheck("fn f(x: bits[3], y: bits[4]) -> bits[3] { x }"));
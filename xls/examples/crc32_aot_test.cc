@@ -0,0 +1,51 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks the ahead-of-time compiled CRC32 against the JIT-compiled one.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/types/span.h"
+#include "xls/common/status/matchers.h"
+#include "xls/examples/crc32_aot.h"
+#include "xls/examples/crc32_jit_wrapper.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+TEST(Crc32AotTest, MatchesJit) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Crc32Aot> aot, Crc32Aot::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Crc32> jit, Crc32::Create());
+  std::vector<uint8_t> messages;
+  for (int i = 0; i < 256; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(uint32_t expected, jit->Run(i));
+    EXPECT_THAT(aot->Run(i), IsOkAndHolds(expected)) << "message " << i;
+    messages.push_back(i);
+  }
+
+  std::vector<uint32_t> results(messages.size());
+  XLS_ASSERT_OK(aot->RunBatch(messages, absl::MakeSpan(results)));
+  for (int i = 0; i < 256; ++i) {
+    EXPECT_THAT(jit->Run(i), IsOkAndHolds(results[i])) << "message " << i;
+  }
+}
+
+}  // namespace
+}  // namespace xls
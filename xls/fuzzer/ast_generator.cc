@@ -14,7 +14,9 @@
 
 #include "xls/fuzzer/ast_generator.h"
 
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "xls/common/casts.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/ir/bits_ops.h"
@@ -169,7 +171,7 @@ absl::StatusOr<TypedExpr> AstGenerator::GenerateBinop(Env* env) {
   XLS_ASSIGN_OR_RETURN(auto pair, ChooseEnvValueBitsPair(env));
   TypedExpr lhs = pair.first;
   TypedExpr rhs = pair.second;
-  BinopKind op = RandomSetChoice(binops_);
+  BinopKind op = ChooseBinopKind();
   if (GetBinopShifts().contains(op)) {
     return GenerateShift(env);
   }
@@ -967,20 +969,90 @@ int OpProbability(OpChoice op) {
   }
 }
 
-std::discrete_distribution<int>& GetOpDistribution() {
-  static std::discrete_distribution<int> dist = []() {
-    std::vector<int> tmp;
-    tmp.reserve(int{kEndSentinel});
-    for (int i = 0; i < int{kEndSentinel}; ++i) {
-      tmp.push_back(OpProbability(static_cast<OpChoice>(i)));
-    }
-    return std::discrete_distribution<int>(tmp.begin(), tmp.end());
-  }();
-  return dist;
+std::string OpChoiceToString(OpChoice op) {
+  switch (op) {
+    case kArray:
+      return "array";
+    case kArrayIndex:
+      return "array_index";
+    case kArrayUpdate:
+      return "array_update";
+    case kBinop:
+      return "binop";
+    case kBitSlice:
+      return "bit_slice";
+    case kBitSliceUpdate:
+      return "bit_slice_update";
+    case kBitwiseReduction:
+      return "bitwise_reduction";
+    case kCastToBitsArray:
+      return "cast_to_bits_array";
+    case kCompareOp:
+      return "compare";
+    case kConcat:
+      return "concat";
+    case kCountedFor:
+      return "counted_for";
+    case kLogical:
+      return "logical";
+    case kMap:
+      return "map";
+    case kNumber:
+      return "number";
+    case kOneHotSelectBuiltin:
+      return "one_hot_select";
+    case kShiftOp:
+      return "shift";
+    case kTupleOrIndex:
+      return "tuple_or_index";
+    case kUnop:
+      return "unop";
+    case kUnopBuiltin:
+      return "unop_builtin";
+    case kEndSentinel:
+      break;
+  }
+  XLS_LOG(FATAL) << "Invalid op choice: " << static_cast<int>(op);
+}
+
+std::string BinopKindToOpName(BinopKind kind) {
+  return absl::StrCat("binop:", absl::AsciiStrToLower(BinopKindToString(kind)));
+}
+
+double GetOpWeight(const AstGeneratorOptions& options,
+                   const std::string& name) {
+  auto it = options.op_weights.find(name);
+  return it == options.op_weights.end() ? 1.0 : it->second;
 }
 
 }  // namespace
 
+/* static */ std::vector<std::string> AstGenerator::GetOpNames() {
+  std::vector<std::string> names;
+  for (int i = 0; i < int{kEndSentinel}; ++i) {
+    names.push_back(OpChoiceToString(static_cast<OpChoice>(i)));
+  }
+  for (BinopKind kind : GetBinopSameTypeKinds()) {
+    if (kind != BinopKind::kDiv) {
+      names.push_back(BinopKindToOpName(kind));
+    }
+  }
+  return names;
+}
+
+BinopKind AstGenerator::ChooseBinopKind() {
+  BinopKind kind;
+  if (binop_distribution_.has_value()) {
+    auto it = binops_.begin();
+    std::advance(it, (*binop_distribution_)(rng_));
+    kind = *it;
+  } else {
+    kind = RandomSetChoice(binops_);
+  }
+  ++generated_op_counts_[BinopKindToOpName(kind)];
+  return kind;
+}
+
 absl::StatusOr<TypedExpr> AstGenerator::GenerateExpr(int64_t expr_size,
                                                      int64_t call_depth,
                                                      Env* env) {
@@ -996,7 +1068,7 @@ absl::StatusOr<TypedExpr> AstGenerator::GenerateExpr(int64_t expr_size,
     // With particularly low probability we generate a map -- if maps recurse
     // with equal probability then the output will grow exponentially with
     // level, so we need to scale inversely.
-    int choice = GetOpDistribution()(rng_);
+    int choice = op_distribution_(rng_);
     switch (static_cast<OpChoice>(choice)) {
       case kArray:
         generated = GenerateArray(env);
@@ -1060,6 +1132,7 @@ absl::StatusOr<TypedExpr> AstGenerator::GenerateExpr(int64_t expr_size,
     }
 
     if (generated.ok()) {
+      ++generated_op_counts_[OpChoiceToString(static_cast<OpChoice>(choice))];
       rhs = generated.value();
       break;
     }
@@ -1185,6 +1258,7 @@ absl::StatusOr<std::pair<Function*, std::unique_ptr<Module>>>
 AstGenerator::GenerateFunctionInModule(std::string fn_name,
                                        std::string module_name) {
   module_ = absl::make_unique<Module>(module_name);
+  generated_op_counts_.clear();
   XLS_ASSIGN_OR_RETURN(Function * f, GenerateFunction(fn_name));
   for (auto& item : constants_) {
     module_->AddTop(item.second);
@@ -1208,6 +1282,28 @@ AstGenerator::AstGenerator(AstGeneratorOptions options, std::mt19937* rng)
                   ? options.binop_allowlist.value()
                   : GetBinopSameTypeKinds()) {
   binops_.erase(BinopKind::kDiv);
+
+  std::vector<double> op_weights;
+  for (int i = 0; i < int{kEndSentinel}; ++i) {
+    auto op = static_cast<OpChoice>(i);
+    op_weights.push_back(OpProbability(op) *
+                         GetOpWeight(options_, OpChoiceToString(op)));
+  }
+  op_distribution_ =
+      std::discrete_distribution<int>(op_weights.begin(), op_weights.end());
+
+  // Unweighted binary operations are chosen uniformly, as they always were,
+  // so that the samples generated for a seed don't change.
+  std::vector<double> binop_weights;
+  bool binops_weighted = false;
+  for (BinopKind kind : binops_) {
+    std::string name = BinopKindToOpName(kind);
+    binops_weighted |= options_.op_weights.contains(name);
+    binop_weights.push_back(GetOpWeight(options_, name));
+  }
+  if (binops_weighted) {
+    binop_distribution_.emplace(binop_weights.begin(), binop_weights.end());
+  }
 }
 
 }  // namespace xls::dslx
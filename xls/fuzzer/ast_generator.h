@@ -61,6 +61,12 @@ struct AstGeneratorOptions {
 
   // If true, then generated samples that have fewer operations.
   bool short_samples = false;
+
+  // Multipliers of the relative probabilities of generating each kind of
+  // expression and binary operation, by name (see AstGenerator::GetOpNames());
+  // those absent are 1.0. Typically derived from the coverage reached by
+  // earlier samples, see CoverageTracker.
+  absl::flat_hash_map<std::string, double> op_weights;
 };
 
 // Type that generates a random module for use in fuzz testing; i.e.
@@ -87,6 +93,17 @@ class AstGenerator {
   // Chooses a random "interesting" bit pattern with the given bit count.
   Bits ChooseBitPattern(int64_t bit_count);
 
+  // Returns the names of the kinds of expressions the generator chooses from
+  // (e.g. "binop", "map"), then those of the binary operations it chooses
+  // from for "binop" expressions (e.g. "binop:add").
+  static std::vector<std::string> GetOpNames();
+
+  // The number of expressions of each kind (by name, as above) generated by
+  // the last call to GenerateFunctionInModule().
+  const absl::btree_map<std::string, int64_t>& generated_op_counts() const {
+    return generated_op_counts_;
+  }
+
  private:
   static bool IsBits(TypeAnnotation* t);
   static bool IsUBits(TypeAnnotation* t);
@@ -409,6 +426,9 @@ class AstGenerator {
     return distribution(rng_);
   }
 
+  // Chooses the kind of a binary operation, according to the op weights.
+  BinopKind ChooseBinopKind();
+
   template <typename T>
   T RandomSetChoice(const absl::btree_set<T>& choices) {
     int64_t index = RandRange(choices.size());
@@ -432,6 +452,13 @@ class AstGenerator {
 
   absl::btree_set<BinopKind> binops_;
 
+  // Distribution of the kinds of expressions generated, and of the binary
+  // operations in binops_ (if they are weighted).
+  std::discrete_distribution<int> op_distribution_;
+  absl::optional<std::discrete_distribution<int>> binop_distribution_;
+
+  absl::btree_map<std::string, int64_t> generated_op_counts_;
+
   std::unique_ptr<Module> module_;
 
   int64_t next_name_index_ = 0;
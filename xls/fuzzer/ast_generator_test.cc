@@ -67,6 +67,27 @@ TEST(AstGeneratorTest, GeneratesValidFunctions) {
   }
 }
 
+TEST(AstGeneratorTest, OpWeights) {
+  std::mt19937 rng(0);
+  AstGeneratorOptions options;
+  options.short_samples = true;
+  // Only generate additions, in binops.
+  for (const std::string& op : AstGenerator::GetOpNames()) {
+    if (op != "binop" && op != "binop:add") {
+      options.op_weights[op] = 0.0;
+    }
+  }
+  for (int64_t i = 0; i < 8; ++i) {
+    AstGenerator g(options, &rng);
+    XLS_ASSERT_OK_AND_ASSIGN(auto generated,
+                             g.GenerateFunctionInModule("main", "test"));
+    XLS_ASSERT_OK(ParseAndTypecheck(generated.second->ToString(), "test"));
+    for (const auto& [op, count] : g.generated_op_counts()) {
+      EXPECT_TRUE(op == "binop" || op == "binop:add") << op;
+    }
+  }
+}
+
 // Helper function that is used in a TEST_P so we can shard the work.
 static void TestRepeatable(int64_t seed) {
   AstGeneratorOptions options;
@@ -0,0 +1,513 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/cpp_sample_runner.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/strip.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/codegen/combinational_generator.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/common/cleanup.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/interpreter.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/dslx/parse_and_typecheck.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/passes/pass_base.h"
+#include "xls/passes/standard_pipeline.h"
+#include "xls/scheduling/pipeline_schedule.h"
+#include "xls/scheduling/scheduling_pass.h"
+#include "xls/simulation/module_simulator.h"
+#include "xls/simulation/verilog_simulators.h"
+
+namespace xls {
+namespace {
+
+using dslx::InterpValue;
+using ArgsSpan = absl::Span<const std::vector<InterpValue>>;
+
+// The name of the function run by DSLX samples, and of their module.
+constexpr char kEntryFunction[] = "main";
+constexpr char kModuleName[] = "sample";
+
+// Returns the nanoseconds elapsed since "start".
+int64_t ElapsedNs(absl::Time start) {
+  return absl::ToInt64Nanoseconds(absl::Now() - start);
+}
+
+// The subset of codegen_main's flags used by the fuzzer.
+struct CodegenFlags {
+  std::string generator = "pipeline";
+  int64_t pipeline_stages = 0;
+  int64_t clock_period_ps = 0;
+  bool use_system_verilog = true;
+  std::string module_name;
+  std::string input_valid_signal;
+  std::string output_valid_signal;
+  std::string manual_load_enable_signal;
+  bool flop_inputs = true;
+  bool flop_outputs = true;
+  std::string reset;
+  bool reset_active_low = false;
+  bool reset_asynchronous = false;
+};
+
+// Parses "args", as passed to codegen_main.
+absl::StatusOr<CodegenFlags> ParseCodegenArgs(
+    absl::Span<const std::string> args, bool use_system_verilog) {
+  CodegenFlags flags;
+  flags.use_system_verilog = use_system_verilog;
+  for (absl::string_view arg : args) {
+    absl::string_view flag = arg;
+    if (!absl::ConsumePrefix(&flag, "--")) {
+      absl::ConsumePrefix(&flag, "-");
+    }
+    absl::string_view value;
+    bool has_value = false;
+    if (size_t eq = flag.find('='); eq != absl::string_view::npos) {
+      value = flag.substr(eq + 1);
+      flag = flag.substr(0, eq);
+      has_value = true;
+    }
+
+    struct BoolFlag {
+      absl::string_view name;
+      bool* value;
+    };
+    struct StringFlag {
+      absl::string_view name;
+      std::string* value;
+    };
+    struct IntFlag {
+      absl::string_view name;
+      int64_t* value;
+    };
+    BoolFlag bool_flags[] = {
+        {"use_system_verilog", &flags.use_system_verilog},
+        {"flop_inputs", &flags.flop_inputs},
+        {"flop_outputs", &flags.flop_outputs},
+        {"reset_active_low", &flags.reset_active_low},
+        {"reset_asynchronous", &flags.reset_asynchronous},
+    };
+    StringFlag string_flags[] = {
+        {"generator", &flags.generator},
+        {"module_name", &flags.module_name},
+        {"input_valid_signal", &flags.input_valid_signal},
+        {"output_valid_signal", &flags.output_valid_signal},
+        {"manual_load_enable_signal", &flags.manual_load_enable_signal},
+        {"reset", &flags.reset},
+        // The fuzzer always schedules with the unit delay model.
+        {"delay_model", nullptr},
+    };
+    IntFlag int_flags[] = {
+        {"pipeline_stages", &flags.pipeline_stages},
+        {"clock_period_ps", &flags.clock_period_ps},
+    };
+
+    bool parsed = false;
+    for (const BoolFlag& bool_flag : bool_flags) {
+      absl::string_view name = flag;
+      bool negated = !has_value && absl::ConsumePrefix(&name, "no");
+      if (name != bool_flag.name) {
+        continue;
+      }
+      if (!has_value) {
+        *bool_flag.value = !negated;
+      } else if (!absl::SimpleAtob(value, bool_flag.value)) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Invalid codegen argument: \"%s\"", arg));
+      }
+      parsed = true;
+    }
+    for (const StringFlag& string_flag : string_flags) {
+      if (has_value && flag == string_flag.name) {
+        if (string_flag.value != nullptr) {
+          *string_flag.value = std::string(value);
+        }
+        parsed = true;
+      }
+    }
+    for (const IntFlag& int_flag : int_flags) {
+      if (has_value && flag == int_flag.name) {
+        if (!absl::SimpleAtoi(value, int_flag.value)) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Invalid codegen argument: \"%s\"", arg));
+        }
+        parsed = true;
+      }
+    }
+    if (!parsed) {
+      return absl::UnimplementedError(
+          absl::StrFormat("Unsupported codegen argument: \"%s\"", arg));
+    }
+  }
+  return flags;
+}
+
+// Generates Verilog for "f", as codegen_main does with "codegen_args" and
+// the unit delay model.
+absl::StatusOr<verilog::ModuleGeneratorResult> Codegen(
+    Package* package, Function* f, const SampleOptions& options) {
+  XLS_ASSIGN_OR_RETURN(
+      CodegenFlags flags,
+      ParseCodegenArgs(options.codegen_args, options.use_system_verilog));
+  if (flags.generator == "combinational") {
+    return verilog::GenerateCombinationalModule(f, flags.use_system_verilog);
+  }
+  if (flags.generator != "pipeline") {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid value for --generator: %s. Expected 'pipeline' or "
+        "'combinational'",
+        flags.generator));
+  }
+  if (flags.pipeline_stages == 0 && flags.clock_period_ps == 0) {
+    return absl::InvalidArgumentError(
+        "Must specify --pipeline_stages or --clock_period_ps (or both).");
+  }
+
+  SchedulingPassOptions sched_options;
+  if (flags.pipeline_stages != 0) {
+    sched_options.scheduling_options.pipeline_stages(flags.pipeline_stages);
+  }
+  if (flags.clock_period_ps != 0) {
+    sched_options.scheduling_options.clock_period_ps(flags.clock_period_ps);
+  }
+  XLS_ASSIGN_OR_RETURN(sched_options.delay_estimator,
+                       GetDelayEstimator("unit"));
+  std::unique_ptr<SchedulingCompoundPass> scheduling_pipeline =
+      CreateStandardSchedulingPassPipeline();
+  SchedulingPassResults results;
+  SchedulingUnit scheduling_unit = {package, /*schedule=*/absl::nullopt};
+  XLS_RETURN_IF_ERROR(
+      scheduling_pipeline->Run(&scheduling_unit, sched_options, &results)
+          .status());
+  XLS_RET_CHECK(scheduling_unit.schedule.has_value());
+
+  verilog::PipelineOptions pipeline_options;
+  if (!flags.module_name.empty()) {
+    pipeline_options.module_name(flags.module_name);
+  }
+  pipeline_options.use_system_verilog(flags.use_system_verilog);
+  if (!flags.input_valid_signal.empty()) {
+    pipeline_options.valid_control(flags.input_valid_signal,
+                                   flags.output_valid_signal);
+  } else if (!flags.manual_load_enable_signal.empty()) {
+    pipeline_options.manual_control(flags.manual_load_enable_signal);
+  }
+  pipeline_options.flop_inputs(flags.flop_inputs);
+  pipeline_options.flop_outputs(flags.flop_outputs);
+  if (!flags.reset.empty()) {
+    verilog::ResetProto reset_proto;
+    reset_proto.set_name(flags.reset);
+    reset_proto.set_asynchronous(flags.reset_asynchronous);
+    reset_proto.set_active_low(flags.reset_active_low);
+    pipeline_options.reset(reset_proto);
+  }
+  return verilog::ToPipelineModuleText(*scheduling_unit.schedule, f,
+                                       pipeline_options);
+}
+
+// Evaluates "f" on each of "args_batch" with the IR interpreter or the JIT.
+absl::StatusOr<std::vector<InterpValue>> EvaluateIr(
+    Function* f, absl::Span<const std::vector<Value>> args_batch, bool use_jit,
+    const absl::optional<std::filesystem::path>& jit_object_cache_dir) {
+  std::unique_ptr<IrJit> jit;
+  if (use_jit) {
+    XLS_ASSIGN_OR_RETURN(
+        jit, IrJit::Create(f, /*opt_level=*/3, jit_object_cache_dir));
+  }
+  std::vector<InterpValue> results;
+  results.reserve(args_batch.size());
+  for (const std::vector<Value>& args : args_batch) {
+    Value result;
+    if (use_jit) {
+      XLS_ASSIGN_OR_RETURN(result, jit->Run(args));
+    } else {
+      XLS_ASSIGN_OR_RETURN(result, IrInterpreter::Run(f, args));
+    }
+    XLS_ASSIGN_OR_RETURN(InterpValue interp_result,
+                         dslx::ValueToInterpValue(result));
+    results.push_back(std::move(interp_result));
+  }
+  return results;
+}
+
+// Simulates the Verilog of "module" on each of "args_batch".
+absl::StatusOr<std::vector<InterpValue>> Simulate(
+    const verilog::ModuleGeneratorResult& module,
+    absl::Span<const std::vector<Value>> args_batch,
+    absl::string_view simulator_name) {
+  const verilog::VerilogSimulator* simulator;
+  if (simulator_name.empty()) {
+    simulator = &verilog::GetDefaultVerilogSimulator();
+  } else {
+    XLS_ASSIGN_OR_RETURN(simulator,
+                         verilog::GetVerilogSimulator(simulator_name));
+  }
+  using KwargsT = absl::flat_hash_map<std::string, Value>;
+  std::vector<KwargsT> kwargs_batch;
+  for (const std::vector<Value>& args : args_batch) {
+    XLS_ASSIGN_OR_RETURN(KwargsT kwargs, module.signature.ToKwargs(args));
+    kwargs_batch.push_back(std::move(kwargs));
+  }
+  verilog::ModuleSimulator module_simulator(module.signature,
+                                            module.verilog_text, simulator);
+  XLS_ASSIGN_OR_RETURN(std::vector<Value> outputs,
+                       module_simulator.RunBatched(kwargs_batch));
+  std::vector<InterpValue> results;
+  for (const Value& output : outputs) {
+    XLS_ASSIGN_OR_RETURN(InterpValue result, dslx::ValueToInterpValue(output));
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+std::string ArgsToString(absl::Span<const InterpValue> args) {
+  return absl::StrJoin(args, "; ", [](std::string* out, const InterpValue& v) {
+    absl::StrAppend(out, v.ToString());
+  });
+}
+
+}  // namespace
+
+absl::Status CompareSampleResults(
+    const std::map<std::string, std::vector<InterpValue>>& results,
+    absl::optional<ArgsSpan> args_batch) {
+  if (results.empty()) {
+    return absl::OkStatus();
+  }
+  // The first result (by name) is used as the reference.
+  const std::string& reference = results.begin()->first;
+  const std::vector<InterpValue>& reference_values = results.begin()->second;
+  if (args_batch.has_value()) {
+    XLS_RET_CHECK_EQ(reference_values.size(), args_batch->size());
+  }
+
+  for (const auto& [name, values] : results) {
+    if (values.size() != reference_values.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Results for %s has %d values, %s has %d", reference,
+                          reference_values.size(), name, values.size()));
+    }
+    for (int64_t i = 0; i < values.size(); ++i) {
+      if (values[i].Eq(reference_values[i])) {
+        continue;
+      }
+      // Bin all of the sources by whether they match the reference or
+      // "values". This helps identify which of the two is likely correct.
+      std::vector<std::string> reference_matches;
+      std::vector<std::string> values_matches;
+      for (const auto& [other_name, other_values] : results) {
+        if (other_values[i].Eq(reference_values[i])) {
+          reference_matches.push_back(other_name);
+        }
+        if (other_values[i].Eq(values[i])) {
+          values_matches.push_back(other_name);
+        }
+      }
+      std::string args = "(args unknown)";
+      if (args_batch.has_value()) {
+        args = ArgsToString((*args_batch)[i]);
+      }
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Result miscompare for sample %d:\nargs: %s\n%s =\n   %s\n%s =\n"
+          "   %s",
+          i, args, absl::StrJoin(reference_matches, ", "),
+          reference_values[i].ToString(), absl::StrJoin(values_matches, ", "),
+          values[i].ToString()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SampleRunner::Run(absl::string_view input_text,
+                               const SampleOptions& options,
+                               absl::optional<ArgsSpan> args_batch) {
+  timing_.Clear();
+  results_.clear();
+  verilog_text_.clear();
+  coverage_.clear();
+  deduplicated_ = false;
+  absl::Time start = absl::Now();
+  absl::Status status = RunInternal(input_text, options, args_batch);
+  timing_.set_total_ns(ElapsedNs(start));
+  return status;
+}
+
+absl::Status SampleRunner::RunInternal(absl::string_view input_text,
+                                       const SampleOptions& options,
+                                       absl::optional<ArgsSpan> args_batch) {
+  std::unique_ptr<Package> package;
+  if (options.input_is_dslx) {
+    // The parsed module is shared by the interpreter and the IR conversion.
+    std::unique_ptr<dslx::ImportData> owned_import_data;
+    dslx::ImportData* import_data = import_data_;
+    if (import_data == nullptr) {
+      owned_import_data = absl::make_unique<dslx::ImportData>();
+      import_data = owned_import_data.get();
+    }
+    absl::Time start = absl::Now();
+    XLS_ASSIGN_OR_RETURN(
+        dslx::TypecheckedModule tm,
+        dslx::ParseAndTypecheck(input_text, "sample.x", kModuleName,
+                                import_data,
+                                /*additional_search_paths=*/{}));
+    // Drop the sample from the shared import data once done with it, keeping
+    // the modules it imports for the next run.
+    auto remove_sample = xabsl::MakeCleanup([&] {
+      if (owned_import_data == nullptr) {
+        XLS_CHECK_OK(import_data->Remove(dslx::ImportTokens({kModuleName})));
+      }
+    });
+    if (args_batch.has_value()) {
+      XLS_ASSIGN_OR_RETURN(dslx::Function * f,
+                           tm.module->GetFunctionOrError(kEntryFunction));
+      XLS_ASSIGN_OR_RETURN(dslx::FunctionType * fn_type,
+                           tm.type_info->GetItemAs<dslx::FunctionType>(f));
+      dslx::Interpreter interpreter(tm.module, /*typecheck=*/nullptr,
+                                    /*additional_search_paths=*/{},
+                                    import_data);
+      std::vector<InterpValue>& results = results_["interpreted DSLX"];
+      for (const std::vector<InterpValue>& unsigned_args : *args_batch) {
+        XLS_ASSIGN_OR_RETURN(std::vector<InterpValue> args,
+                             dslx::SignConvertArgs(*fn_type, unsigned_args));
+        XLS_ASSIGN_OR_RETURN(InterpValue result,
+                             interpreter.RunFunction(kEntryFunction, args));
+        results.push_back(std::move(result));
+      }
+      timing_.set_interpret_dslx_ns(ElapsedNs(start));
+    }
+
+    if (!options.convert_to_ir) {
+      return absl::OkStatus();
+    }
+
+    start = absl::Now();
+    XLS_ASSIGN_OR_RETURN(package,
+                         dslx::ConvertModuleToPackage(tm.module, import_data));
+    timing_.set_convert_ir_ns(ElapsedNs(start));
+  } else {
+    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(input_text));
+  }
+
+  std::vector<std::vector<Value>> ir_args_batch;
+  if (args_batch.has_value()) {
+    for (const std::vector<InterpValue>& args : *args_batch) {
+      std::vector<Value>& ir_args = ir_args_batch.emplace_back();
+      for (const InterpValue& arg : args) {
+        XLS_ASSIGN_OR_RETURN(Value ir_arg, dslx::InterpValueToValue(arg));
+        ir_args.push_back(std::move(ir_arg));
+      }
+    }
+  }
+
+  AddIrCoverage(*package, &coverage_);
+  XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+  if (args_batch.has_value()) {
+    // Unconditionally evaluate with the interpreter even if using the JIT.
+    // This exercises the interpreter and serves as a reference.
+    absl::Time start = absl::Now();
+    XLS_ASSIGN_OR_RETURN(results_["evaluated unopt IR (interpreter)"],
+                         EvaluateIr(f, ir_args_batch, /*use_jit=*/false,
+                                    jit_object_cache_dir_));
+    timing_.set_unoptimized_interpret_ir_ns(ElapsedNs(start));
+
+    if (options.use_jit) {
+      start = absl::Now();
+      XLS_ASSIGN_OR_RETURN(results_["evaluated unopt IR (JIT)"],
+                           EvaluateIr(f, ir_args_batch, /*use_jit=*/true,
+                                      jit_object_cache_dir_));
+      timing_.set_unoptimized_jit_ns(ElapsedNs(start));
+    }
+  }
+
+  if (options.optimize_ir) {
+    absl::Time start = absl::Now();
+    PassResults pass_results;
+    XLS_RETURN_IF_ERROR(RunStandardPassPipeline(package.get(), kMaxOptLevel,
+                                                &pass_results)
+                            .status());
+    XLS_ASSIGN_OR_RETURN(f, package->EntryFunction());
+    timing_.set_optimize_ns(ElapsedNs(start));
+    AddIrCoverage(*package, &coverage_);
+    AddPassCoverage(pass_results, &coverage_);
+
+    if (args_batch.has_value()) {
+      start = absl::Now();
+      if (options.use_jit) {
+        XLS_ASSIGN_OR_RETURN(results_["evaluated opt IR (JIT)"],
+                             EvaluateIr(f, ir_args_batch, /*use_jit=*/true,
+                                        jit_object_cache_dir_));
+        timing_.set_optimized_jit_ns(ElapsedNs(start));
+      } else {
+        XLS_ASSIGN_OR_RETURN(results_["evaluated opt IR (interpreter)"],
+                             EvaluateIr(f, ir_args_batch, /*use_jit=*/false,
+                                        jit_object_cache_dir_));
+        timing_.set_optimized_interpret_ir_ns(ElapsedNs(start));
+      }
+    }
+
+    if (options.codegen && seen_samples_ != nullptr) {
+      // The backend's results only depend on the optimized IR and the
+      // backend options.
+      std::string key = absl::StrFormat(
+          "ir=%016x codegen_args=%s use_system_verilog=%d simulate=%d "
+          "simulator=%s",
+          CanonicalIrHash(f), absl::StrJoin(options.codegen_args, " "),
+          options.use_system_verilog, options.simulate, options.simulator);
+      deduplicated_ = !seen_samples_->Insert(key);
+    }
+    if (options.codegen && !deduplicated_) {
+      start = absl::Now();
+      XLS_ASSIGN_OR_RETURN(verilog::ModuleGeneratorResult module,
+                           Codegen(package.get(), f, options));
+      timing_.set_codegen_ns(ElapsedNs(start));
+      verilog_text_ = module.verilog_text;
+
+      if (options.simulate) {
+        XLS_RET_CHECK(args_batch.has_value());
+        start = absl::Now();
+        XLS_ASSIGN_OR_RETURN(
+            results_["simulated"],
+            Simulate(module, ir_args_batch, options.simulator));
+        timing_.set_simulate_ns(ElapsedNs(start));
+      }
+    }
+  }
+
+  return CompareSampleResults(results_, args_batch);
+}
+
+}  // namespace xls
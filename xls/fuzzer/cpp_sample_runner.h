@@ -0,0 +1,147 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_FUZZER_CPP_SAMPLE_RUNNER_H_
+#define XLS_FUZZER_CPP_SAMPLE_RUNNER_H_
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/interp_value.h"
+#include "xls/fuzzer/sample_coverage.h"
+#include "xls/fuzzer/sample_dedup.h"
+#include "xls/fuzzer/sample_summary.pb.h"
+
+namespace xls {
+
+// Options describing how to run a code sample; see SampleOptions in
+// sample.py.
+struct SampleOptions {
+  // Whether the code sample is DSLX. Otherwise assumed to be XLS IR.
+  bool input_is_dslx = true;
+  // Convert the input code sample to XLS IR. Only meaningful if
+  // input_is_dslx is true.
+  bool convert_to_ir = true;
+  // Optimize the XLS IR.
+  bool optimize_ir = true;
+  // Use LLVM jit when evaluating the XLS IR.
+  bool use_jit = true;
+  // Generate Verilog from the optimized IR. Requires optimize_ir to be true.
+  bool codegen = false;
+  // Arguments as they would be passed to codegen_main, e.g.
+  // {"--generator=pipeline", "--pipeline_stages=3"}. Requires codegen to be
+  // true.
+  std::vector<std::string> codegen_args;
+  // Run the Verilog simulator on the generated Verilog. Requires codegen to
+  // be true.
+  bool simulate = false;
+  // The Verilog simulator to use, e.g. "iverilog"; the default one if empty.
+  std::string simulator;
+  // Whether to use SystemVerilog or Verilog in codegen.
+  bool use_system_verilog = true;
+};
+
+using ArgsBatch = std::vector<std::vector<dslx::InterpValue>>;
+
+// Runs code samples in-process: performs the same steps as the SampleRunner
+// of sample_runner.py (interpreting the DSLX, converting it to IR,
+// evaluating, optimizing, generating Verilog and simulating it, then
+// comparing the results of each step), but without launching a process or
+// writing a file for each step, and sharing the parsed module between the
+// DSLX interpreter and the IR conversion.
+//
+// The function run by a DSLX sample is "main".
+class SampleRunner {
+ public:
+  SampleRunner() = default;
+
+  // Typechecks the DSLX samples against "import_data", which must outlive
+  // this object, so that the modules they import are only typechecked once
+  // across runs. If "jit_object_cache_dir" is given, JIT-compiled code is
+  // cached in it and reused across runs (see IrJit::Create). If
+  // "seen_samples" is given (it must outlive this object), codegen and
+  // simulation are skipped for samples whose optimized IR and backend options
+  // were seen before (see CanonicalIrHash).
+  explicit SampleRunner(
+      dslx::ImportData* import_data,
+      absl::optional<std::filesystem::path> jit_object_cache_dir =
+          absl::nullopt,
+      SeenSampleSet* seen_samples = nullptr)
+      : import_data_(import_data),
+        jit_object_cache_dir_(std::move(jit_object_cache_dir)),
+        seen_samples_(seen_samples) {}
+
+  // Runs the sample "input_text" (DSLX or IR, as given by "options") on each
+  // of the "args_batch" argument sets, if any.
+  //
+  // Returns an error if any step fails or the results miscompare.
+  absl::Status Run(absl::string_view input_text, const SampleOptions& options,
+                   absl::optional<absl::Span<const std::vector<
+                       dslx::InterpValue>>> args_batch = absl::nullopt);
+
+  // The time taken by each step of the last run.
+  const fuzzer::SampleTimingProto& timing() const { return timing_; }
+
+  // The results of each step of the last run, by step name ("interpreted
+  // DSLX", "evaluated unopt IR (JIT)", etc.).
+  const std::map<std::string, std::vector<dslx::InterpValue>>& results()
+      const {
+    return results_;
+  }
+
+  // The Verilog generated by the last run, if any.
+  const std::string& verilog_text() const { return verilog_text_; }
+
+  // The coverage reached by the last run: the ops of the unoptimized and
+  // optimized IR, and the passes which changed it.
+  const SampleCoverage& coverage() const { return coverage_; }
+
+  // Whether the last run skipped codegen and simulation because it was a
+  // duplicate.
+  bool deduplicated() const { return deduplicated_; }
+
+ private:
+  absl::Status RunInternal(
+      absl::string_view input_text, const SampleOptions& options,
+      absl::optional<absl::Span<const std::vector<dslx::InterpValue>>>
+          args_batch);
+
+  dslx::ImportData* import_data_ = nullptr;
+  absl::optional<std::filesystem::path> jit_object_cache_dir_;
+  SeenSampleSet* seen_samples_ = nullptr;
+  fuzzer::SampleTimingProto timing_;
+  std::map<std::string, std::vector<dslx::InterpValue>> results_;
+  std::string verilog_text_;
+  SampleCoverage coverage_;
+  bool deduplicated_ = false;
+};
+
+// Compares each of "results" (as the result sets of each step of a sample)
+// for equality, ignoring signedness; returns an error describing the first
+// miscompare.
+absl::Status CompareSampleResults(
+    const std::map<std::string, std::vector<dslx::InterpValue>>& results,
+    absl::optional<absl::Span<const std::vector<dslx::InterpValue>>>
+        args_batch);
+
+}  // namespace xls
+
+#endif  // XLS_FUZZER_CPP_SAMPLE_RUNNER_H_
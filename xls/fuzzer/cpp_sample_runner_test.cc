@@ -0,0 +1,174 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/cpp_sample_runner.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/fuzzer/sample_dedup.h"
+
+namespace xls {
+namespace {
+
+using dslx::InterpValue;
+using status_testing::IsOk;
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::IsEmpty;
+using testing::Key;
+using testing::Not;
+
+constexpr char kAddSample[] = R"(
+fn main(x: u8, y: u8) -> u8 {
+  x + y
+}
+)";
+
+constexpr char kAddIrSample[] = R"(
+package sample
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  ret add.1: bits[8] = add(x, y)
+}
+)";
+
+ArgsBatch AddArgs() {
+  return {{InterpValue::MakeUBits(8, 1), InterpValue::MakeUBits(8, 2)},
+          {InterpValue::MakeUBits(8, 200), InterpValue::MakeUBits(8, 100)}};
+}
+
+TEST(CppSampleRunnerTest, DslxSample) {
+  SampleRunner runner;
+  SampleOptions options;
+  ArgsBatch args = AddArgs();
+  XLS_ASSERT_OK(runner.Run(kAddSample, options, args));
+  EXPECT_THAT(runner.results(),
+              ElementsAre(Key("evaluated opt IR (JIT)"),
+                          Key("evaluated unopt IR (JIT)"),
+                          Key("evaluated unopt IR (interpreter)"),
+                          Key("interpreted DSLX")));
+  const std::vector<InterpValue>& interpreted =
+      runner.results().at("interpreted DSLX");
+  ASSERT_EQ(interpreted.size(), 2);
+  EXPECT_TRUE(interpreted[0].Eq(InterpValue::MakeUBits(8, 3)));
+  EXPECT_TRUE(interpreted[1].Eq(InterpValue::MakeUBits(8, 44)));
+  EXPECT_GT(runner.timing().interpret_dslx_ns(), 0);
+  EXPECT_GT(runner.timing().total_ns(), 0);
+  EXPECT_THAT(runner.verilog_text(), IsEmpty());
+}
+
+TEST(CppSampleRunnerTest, DslxSampleWithoutIrConversion) {
+  SampleRunner runner;
+  SampleOptions options;
+  options.convert_to_ir = false;
+  ArgsBatch args = AddArgs();
+  XLS_ASSERT_OK(runner.Run(kAddSample, options, args));
+  EXPECT_THAT(runner.results(), ElementsAre(Key("interpreted DSLX")));
+}
+
+TEST(CppSampleRunnerTest, IrSample) {
+  SampleRunner runner;
+  SampleOptions options;
+  options.input_is_dslx = false;
+  options.use_jit = false;
+  ArgsBatch args = AddArgs();
+  XLS_ASSERT_OK(runner.Run(kAddIrSample, options, args));
+  EXPECT_THAT(runner.results(),
+              ElementsAre(Key("evaluated opt IR (interpreter)"),
+                          Key("evaluated unopt IR (interpreter)")));
+}
+
+TEST(CppSampleRunnerTest, Codegen) {
+  SampleRunner runner;
+  SampleOptions options;
+  options.codegen = true;
+  options.codegen_args = {"--generator=combinational"};
+  XLS_ASSERT_OK(runner.Run(kAddSample, options));
+  EXPECT_THAT(runner.verilog_text(), HasSubstr("module"));
+
+  options.codegen_args = {"--generator=pipeline", "--pipeline_stages=2",
+                          "--nouse_system_verilog", "--reset=rst"};
+  XLS_ASSERT_OK(runner.Run(kAddSample, options));
+  EXPECT_THAT(runner.verilog_text(), HasSubstr("rst"));
+  EXPECT_GT(runner.timing().codegen_ns(), 0);
+
+  options.codegen_args = {"--output_block_ir_path=/tmp/foo"};
+  EXPECT_THAT(runner.Run(kAddSample, options),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("Unsupported codegen argument")));
+}
+
+TEST(CppSampleRunnerTest, DeduplicatedCodegen) {
+  SeenSampleSet seen_samples;
+  SampleRunner runner(/*import_data=*/nullptr,
+                      /*jit_object_cache_dir=*/absl::nullopt, &seen_samples);
+  SampleOptions options;
+  options.codegen = true;
+  options.codegen_args = {"--generator=combinational"};
+  XLS_ASSERT_OK(runner.Run(kAddSample, options));
+  EXPECT_FALSE(runner.deduplicated());
+  EXPECT_THAT(runner.verilog_text(), HasSubstr("module"));
+
+  // The same computation with the operands swapped is a duplicate.
+  XLS_ASSERT_OK(runner.Run("fn main(a: u8, b: u8) -> u8 { b + a }", options));
+  EXPECT_TRUE(runner.deduplicated());
+  EXPECT_THAT(runner.verilog_text(), IsEmpty());
+
+  // Different backend options are not.
+  options.codegen_args = {"--generator=pipeline", "--pipeline_stages=2"};
+  XLS_ASSERT_OK(runner.Run(kAddSample, options));
+  EXPECT_FALSE(runner.deduplicated());
+}
+
+TEST(CppSampleRunnerTest, FailingSample) {
+  SampleRunner runner;
+  EXPECT_THAT(runner.Run("fn main(x: u8) -> u8 { y }", SampleOptions(),
+                         AddArgs()),
+              Not(IsOk()));
+}
+
+TEST(CppSampleRunnerTest, Miscompare) {
+  ArgsBatch args = {{InterpValue::MakeUBits(8, 1)},
+                    {InterpValue::MakeUBits(8, 2)}};
+  std::map<std::string, std::vector<InterpValue>> results = {
+      {"a", {InterpValue::MakeUBits(8, 1), InterpValue::MakeUBits(8, 2)}},
+      {"b", {InterpValue::MakeUBits(8, 1), InterpValue::MakeUBits(8, 2)}},
+  };
+  XLS_EXPECT_OK(CompareSampleResults(results, args));
+
+  // Signedness is ignored.
+  results["c"] = {InterpValue::MakeSBits(8, 1), InterpValue::MakeSBits(8, 2)};
+  XLS_EXPECT_OK(CompareSampleResults(results, args));
+
+  results["d"] = {InterpValue::MakeUBits(8, 1), InterpValue::MakeUBits(8, 3)};
+  EXPECT_THAT(CompareSampleResults(results, args),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Result miscompare for sample 1:\n"
+                                 "args: bits[8]:0x2\n"
+                                 "a, b, c =\n   bits[8]:0x2\n"
+                                 "d =\n   bits[8]:0x3")));
+
+  results["d"] = {InterpValue::MakeUBits(8, 1)};
+  EXPECT_THAT(CompareSampleResults(results, args),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Results for a has 2 values, d has 1")));
+}
+
+}  // namespace
+}  // namespace xls
@@ -12,21 +12,31 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/types/optional.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
 #include "xls/interpreter/ir_interpreter.h"
 #include "xls/ir/function.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
+#include "xls/ir/random_value.h"
 #include "xls/ir/value.h"
 #include "xls/jit/ir_jit.h"
 
@@ -36,12 +46,26 @@ interpreter. Prints the first input which results in a mismatch between the JIT
 and the interpreter. Returns a non-zer error code otherwise. Usage:
 
     find_failing_input_main --input-file=INPUT_FILE IR_FILE
+
+The inputs of --input_file are followed by --random_inputs randomly generated
+ones. They are evaluated in batches by --threads threads, each with its own JIT
+instance, which all stop once the first failing input is known.
 )";
 
 ABSL_FLAG(std::string, input_file, "",
           "Inputs to JIT and interpreter, one set per line. Each line should "
           "contain a semicolon-separated set of typed values. Cannot be "
           "specified with --input.");
+ABSL_FLAG(int64_t, random_inputs, 0,
+          "Number of randomly generated sets of inputs to try after those of "
+          "--input_file.");
+ABSL_FLAG(int64_t, random_seed, 0,
+          "Seed of the random inputs. The generated inputs only depend on the "
+          "seed and --batch_size, not on the number of threads.");
+ABSL_FLAG(int64_t, threads, 0,
+          "Number of threads evaluating inputs. If zero, one per core.");
+ABSL_FLAG(int64_t, batch_size, 64,
+          "Number of inputs each thread evaluates in one call into the JIT.");
 ABSL_FLAG(
     std::string, test_only_inject_jit_result, "",
     "Test-only flag for injecting the result produced by the JIT. Used to "
@@ -50,43 +74,187 @@ ABSL_FLAG(
 namespace xls {
 namespace {
 
+// An input on which the JIT and interpreter disagree, and its index among all
+// inputs.
+struct Failure {
+  int64_t index;
+  std::vector<Value> args;
+};
+
+// Searches for failing inputs with a pool of threads. The inputs are split into
+// batches of consecutive indices, handed out to the threads in increasing
+// order. A thread stops as soon as its next batch starts after the earliest
+// failure found so far, so all inputs before the earliest failure are
+// evaluated and the result doesn't depend on the number of threads.
+class InputSearch {
+ public:
+  InputSearch(absl::string_view ir_text,
+              std::vector<std::vector<Value>> file_inputs,
+              int64_t random_input_count, int64_t random_seed,
+              int64_t batch_size, absl::optional<Value> injected_jit_result)
+      : ir_text_(ir_text),
+        file_inputs_(std::move(file_inputs)),
+        input_count_(file_inputs_.size() + random_input_count),
+        random_seed_(random_seed),
+        batch_size_(batch_size),
+        injected_jit_result_(std::move(injected_jit_result)),
+        first_failure_(input_count_) {}
+
+  // Returns the failing input with the lowest index, if any.
+  absl::StatusOr<absl::optional<Failure>> Run(int64_t thread_count) {
+    std::vector<absl::Status> statuses(thread_count);
+    std::vector<absl::optional<Failure>> failures(thread_count);
+    {
+      std::vector<std::unique_ptr<Thread>> threads;
+      for (int64_t i = 0; i < thread_count; ++i) {
+        threads.push_back(absl::make_unique<Thread>([this, i, &statuses,
+                                                     &failures]() {
+          statuses[i] = RunThread(&failures[i]);
+          if (!statuses[i].ok()) {
+            error_ = true;
+          }
+        }));
+      }
+      for (std::unique_ptr<Thread>& thread : threads) {
+        thread->Join();
+      }
+    }
+    for (const absl::Status& status : statuses) {
+      XLS_RETURN_IF_ERROR(status);
+    }
+    absl::optional<Failure> first;
+    for (absl::optional<Failure>& failure : failures) {
+      if (failure.has_value() &&
+          (!first.has_value() || failure->index < first->index)) {
+        first = std::move(failure);
+      }
+    }
+    return first;
+  }
+
+ private:
+  // Evaluates batches until there are none left before the earliest failure,
+  // recording the thread's earliest failure in "failure".
+  absl::Status RunThread(absl::optional<Failure>* failure) {
+    // Each thread uses its own copy of the function and JIT.
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(ir_text_));
+    XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit, IrJit::Create(f));
+
+    while (!error_) {
+      int64_t start = next_batch_.fetch_add(1) * batch_size_;
+      int64_t end = std::min(start + batch_size_, input_count_);
+      if (start >= first_failure_.load()) {
+        return absl::OkStatus();
+      }
+
+      std::vector<std::vector<Value>> arg_sets = GetInputs(f, start, end);
+      std::vector<Value> jit_results;
+      if (injected_jit_result_.has_value()) {
+        jit_results.assign(arg_sets.size(), *injected_jit_result_);
+      } else {
+        XLS_ASSIGN_OR_RETURN(jit_results, jit->RunBatch(arg_sets));
+      }
+      for (int64_t i = 0; i < arg_sets.size(); ++i) {
+        XLS_ASSIGN_OR_RETURN(Value interpreter_result,
+                             IrInterpreter::Run(f, arg_sets[i]));
+        if (jit_results[i] != interpreter_result) {
+          int64_t index = start + i;
+          // Lower the earliest failure to this one, unless another thread
+          // found an earlier one.
+          int64_t first = first_failure_.load();
+          while (index < first &&
+                 !first_failure_.compare_exchange_weak(first, index)) {
+          }
+          *failure = Failure{index, std::move(arg_sets[i])};
+          return absl::OkStatus();
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the inputs with indices in [start, end). Random inputs are
+  // generated with an engine seeded by the seed and their batch.
+  std::vector<std::vector<Value>> GetInputs(Function* f, int64_t start,
+                                            int64_t end) {
+    std::vector<std::vector<Value>> arg_sets;
+    absl::optional<std::minstd_rand> engine;
+    for (int64_t index = start; index < end; ++index) {
+      if (index < file_inputs_.size()) {
+        arg_sets.push_back(file_inputs_[index]);
+        continue;
+      }
+      if (!engine.has_value()) {
+        std::seed_seq seed{random_seed_, start / batch_size_};
+        engine.emplace(seed);
+      }
+      arg_sets.push_back(RandomFunctionArguments(f, &*engine));
+    }
+    return arg_sets;
+  }
+
+  std::string ir_text_;
+  std::vector<std::vector<Value>> file_inputs_;
+  int64_t input_count_;
+  int64_t random_seed_;
+  int64_t batch_size_;
+  absl::optional<Value> injected_jit_result_;
+
+  std::atomic<int64_t> next_batch_{0};
+  std::atomic<int64_t> first_failure_;
+  std::atomic<bool> error_{false};
+};
+
 absl::Status RealMain(absl::string_view ir_path,
                       absl::string_view inputs_path) {
   XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
-  XLS_ASSIGN_OR_RETURN(std::string inputs_text, GetFileContents(inputs_path));
+  // Check the IR parses before starting any threads.
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
                        Parser::ParsePackage(ir_text, ir_path));
-  XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+  XLS_RETURN_IF_ERROR(package->EntryFunction().status());
 
   std::vector<std::vector<Value>> inputs;
-  for (const auto& args_line :
-       absl::StrSplit(inputs_text, '\n', absl::SkipWhitespace())) {
-    std::vector<Value> args;
-    for (const absl::string_view& value_string :
-         absl::StrSplit(args_line, ';')) {
-      XLS_ASSIGN_OR_RETURN(Value arg, Parser::ParseTypedValue(value_string));
-      args.push_back(arg);
+  if (!inputs_path.empty()) {
+    XLS_ASSIGN_OR_RETURN(std::string inputs_text,
+                         GetFileContents(inputs_path));
+    for (const auto& args_line :
+         absl::StrSplit(inputs_text, '\n', absl::SkipWhitespace())) {
+      std::vector<Value> args;
+      for (const absl::string_view& value_string :
+           absl::StrSplit(args_line, ';')) {
+        XLS_ASSIGN_OR_RETURN(Value arg, Parser::ParseTypedValue(value_string));
+        args.push_back(arg);
+      }
+      inputs.push_back(args);
     }
-    inputs.push_back(args);
   }
 
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit, IrJit::Create(f));
-  for (const std::vector<Value>& args : inputs) {
-    Value jit_result;
-    if (absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
-      XLS_ASSIGN_OR_RETURN(jit_result, jit->Run(args));
-    } else {
-      XLS_ASSIGN_OR_RETURN(jit_result, Parser::ParseTypedValue(absl::GetFlag(
-                                           FLAGS_test_only_inject_jit_result)));
-    }
-    XLS_ASSIGN_OR_RETURN(Value interpreter_result, IrInterpreter::Run(f, args));
-    if (jit_result != interpreter_result) {
-      std::cout << absl::StrJoin(
-          args, "; ", [](std::string* s, const Value& v) {
-            absl::StrAppend(s, v.ToString(FormatPreference::kHex));
-          });
-      return absl::OkStatus();
-    }
+  absl::optional<Value> injected_jit_result;
+  if (!absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
+    XLS_ASSIGN_OR_RETURN(injected_jit_result,
+                         Parser::ParseTypedValue(absl::GetFlag(
+                             FLAGS_test_only_inject_jit_result)));
+  }
+
+  int64_t thread_count = absl::GetFlag(FLAGS_threads);
+  if (thread_count == 0) {
+    thread_count = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  }
+  InputSearch search(ir_text, std::move(inputs),
+                     absl::GetFlag(FLAGS_random_inputs),
+                     absl::GetFlag(FLAGS_random_seed),
+                     absl::GetFlag(FLAGS_batch_size),
+                     std::move(injected_jit_result));
+  XLS_ASSIGN_OR_RETURN(absl::optional<Failure> failure,
+                       search.Run(thread_count));
+  if (failure.has_value()) {
+    std::cout << absl::StrJoin(
+        failure->args, "; ", [](std::string* s, const Value& v) {
+          absl::StrAppend(s, v.ToString(FormatPreference::kHex));
+        });
+    return absl::OkStatus();
   }
   return absl::InvalidArgumentError(
       "No input found which results in a mismatch between the JIT and "
@@ -103,7 +271,11 @@ int main(int argc, char** argv) {
     XLS_LOG(QFATAL) << absl::StreamFormat("Expected invocation: %s <ir-path>",
                                           argv[0]);
   }
-  XLS_QCHECK(!absl::GetFlag(FLAGS_input_file).empty());
+  XLS_QCHECK(!absl::GetFlag(FLAGS_input_file).empty() ||
+             absl::GetFlag(FLAGS_random_inputs) > 0)
+      << "Must specify --input_file or --random_inputs";
+  XLS_QCHECK_GE(absl::GetFlag(FLAGS_threads), 0);
+  XLS_QCHECK_GT(absl::GetFlag(FLAGS_batch_size), 0);
   XLS_QCHECK_OK(
       xls::RealMain(positional_arguments[0], absl::GetFlag(FLAGS_input_file)));
   return 0;
@@ -75,5 +75,41 @@ class EvalMainTest(test_base.TestCase):
     self.assertEqual(result.decode('utf-8'), 'bits[32]:0x42; bits[32]:0x123')
 
 
+  def test_input_file_with_failure_multithreaded(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    input_file = self.create_tempfile(content='\n'.join(
+        ['bits[32]:0x0; bits[32]:0x0'] * 100 +
+        ['bits[32]:0x42; bits[32]:0x123', 'bits[32]:0x1; bits[32]:0x2']))
+    result = subprocess.check_output([
+        FIND_FAILING_INPUT_MAIN, '--input_file=' + input_file.full_path,
+        '--threads=4', '--batch_size=3',
+        '--test_only_inject_jit_result=bits[32]:0x0', ir_file.full_path
+    ],
+                                     stderr=subprocess.PIPE)
+    self.assertEqual(result.decode('utf-8'), 'bits[32]:0x42; bits[32]:0x123')
+
+  def test_random_inputs(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    comp = subprocess.run([
+        FIND_FAILING_INPUT_MAIN, '--random_inputs=1000', '--threads=4',
+        ir_file.full_path
+    ],
+                          stderr=subprocess.PIPE, check=False)
+    self.assertNotEqual(comp.returncode, 0)
+    self.assertIn('No input found which results in a mismatch',
+                  comp.stderr.decode('utf-8'))
+
+    # The failing random input doesn't depend on the number of threads.
+    results = set()
+    for threads in (1, 4):
+      results.add(
+          subprocess.check_output([
+              FIND_FAILING_INPUT_MAIN, '--random_inputs=1000',
+              '--random_seed=7', '--threads=%d' % threads,
+              '--test_only_inject_jit_result=bits[32]:0x0', ir_file.full_path
+          ],
+                                  stderr=subprocess.PIPE))
+    self.assertLen(results, 1)
+
 if __name__ == '__main__':
   test_base.main()
@@ -0,0 +1,321 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/fuzz_worker.h"
+
+#include <istream>
+#include <ostream>
+
+#include "google/protobuf/text_format.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/dslx/ir_converter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+namespace {
+
+// Parses the flat JSON object produced by SampleOptions.to_json(): its
+// values are booleans, strings, lists of strings or null.
+class OptionsJsonParser {
+ public:
+  explicit OptionsJsonParser(absl::string_view text) : text_(text) {}
+
+  absl::StatusOr<SampleOptions> Parse() {
+    SampleOptions options;
+    XLS_RETURN_IF_ERROR(Expect('{'));
+    if (!TryConsume('}')) {
+      do {
+        XLS_ASSIGN_OR_RETURN(std::string key, ParseString());
+        XLS_RETURN_IF_ERROR(Expect(':'));
+        XLS_RETURN_IF_ERROR(ParseValue(key, &options));
+      } while (TryConsume(','));
+      XLS_RETURN_IF_ERROR(Expect('}'));
+    }
+    SkipWhitespace();
+    if (!text_.empty()) {
+      return Error("trailing characters");
+    }
+    return options;
+  }
+
+ private:
+  absl::Status ParseValue(absl::string_view key, SampleOptions* options) {
+    std::pair<absl::string_view, bool*> bool_options[] = {
+        {"input_is_dslx", &options->input_is_dslx},
+        {"convert_to_ir", &options->convert_to_ir},
+        {"optimize_ir", &options->optimize_ir},
+        {"use_jit", &options->use_jit},
+        {"codegen", &options->codegen},
+        {"simulate", &options->simulate},
+        {"use_system_verilog", &options->use_system_verilog},
+    };
+    for (const auto& [name, value] : bool_options) {
+      if (key == name) {
+        XLS_ASSIGN_OR_RETURN(*value, ParseBool());
+        return absl::OkStatus();
+      }
+    }
+    if (key == "simulator") {
+      if (TryConsumeWord("null")) {
+        options->simulator.clear();
+        return absl::OkStatus();
+      }
+      XLS_ASSIGN_OR_RETURN(options->simulator, ParseString());
+      return absl::OkStatus();
+    }
+    if (key == "codegen_args") {
+      options->codegen_args.clear();
+      if (TryConsumeWord("null")) {
+        return absl::OkStatus();
+      }
+      XLS_RETURN_IF_ERROR(Expect('['));
+      if (TryConsume(']')) {
+        return absl::OkStatus();
+      }
+      do {
+        XLS_ASSIGN_OR_RETURN(std::string arg, ParseString());
+        options->codegen_args.push_back(std::move(arg));
+      } while (TryConsume(','));
+      return Expect(']');
+    }
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown sample option: \"%s\"", key));
+  }
+
+  absl::StatusOr<bool> ParseBool() {
+    if (TryConsumeWord("true")) {
+      return true;
+    }
+    if (TryConsumeWord("false")) {
+      return false;
+    }
+    return Error("expected a boolean");
+  }
+
+  absl::StatusOr<std::string> ParseString() {
+    XLS_RETURN_IF_ERROR(Expect('"'));
+    std::string result;
+    while (!text_.empty() && text_.front() != '"') {
+      char c = text_.front();
+      text_.remove_prefix(1);
+      if (c != '\\') {
+        result.push_back(c);
+        continue;
+      }
+      if (text_.empty()) {
+        break;
+      }
+      char escaped = text_.front();
+      text_.remove_prefix(1);
+      switch (escaped) {
+        case 'n':
+          result.push_back('\n');
+          break;
+        case 't':
+          result.push_back('\t');
+          break;
+        case 'u': {
+          // Only ASCII characters are expected in the options.
+          int32_t code;
+          if (text_.size() < 4 ||
+              !absl::SimpleHexAtoi(text_.substr(0, 4), &code) || code > 0x7f) {
+            return Error("unsupported escape sequence");
+          }
+          text_.remove_prefix(4);
+          result.push_back(static_cast<char>(code));
+          break;
+        }
+        default:
+          result.push_back(escaped);
+          break;
+      }
+    }
+    XLS_RETURN_IF_ERROR(Expect('"'));
+    return result;
+  }
+
+  void SkipWhitespace() {
+    text_ = absl::StripLeadingAsciiWhitespace(text_);
+  }
+
+  bool TryConsume(char c) {
+    SkipWhitespace();
+    if (text_.empty() || text_.front() != c) {
+      return false;
+    }
+    text_.remove_prefix(1);
+    return true;
+  }
+
+  bool TryConsumeWord(absl::string_view word) {
+    SkipWhitespace();
+    return absl::ConsumePrefix(&text_, word);
+  }
+
+  absl::Status Expect(char c) {
+    if (!TryConsume(c)) {
+      return Error(absl::StrFormat("expected '%c'", c));
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Error(absl::string_view message) const {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid sample options JSON (%s) at: \"%s\"", message, text_));
+  }
+
+  absl::string_view text_;
+};
+
+// If "line" is a comment starting with "tag", returns the rest of it.
+absl::optional<absl::string_view> GetCommentWithTag(absl::string_view line,
+                                                    absl::string_view tag) {
+  line = absl::StripLeadingAsciiWhitespace(line);
+  if (!absl::ConsumePrefix(&line, "//")) {
+    return absl::nullopt;
+  }
+  line = absl::StripLeadingAsciiWhitespace(line);
+  if (!absl::ConsumePrefix(&line, tag)) {
+    return absl::nullopt;
+  }
+  return line;
+}
+
+}  // namespace
+
+absl::StatusOr<SampleOptions> SampleOptionsFromJson(absl::string_view json) {
+  return OptionsJsonParser(json).Parse();
+}
+
+absl::StatusOr<std::vector<dslx::InterpValue>> ParseSampleArgs(
+    absl::string_view args_text) {
+  std::vector<dslx::InterpValue> args;
+  for (absl::string_view arg_text :
+       absl::StrSplit(args_text, ';', absl::SkipWhitespace())) {
+    XLS_ASSIGN_OR_RETURN(Value value, Parser::ParseTypedValue(arg_text));
+    XLS_ASSIGN_OR_RETURN(dslx::InterpValue arg,
+                         dslx::ValueToInterpValue(value));
+    args.push_back(std::move(arg));
+  }
+  return args;
+}
+
+absl::StatusOr<Sample> SampleFromCrasher(absl::string_view crasher) {
+  Sample sample;
+  bool has_options = false;
+  std::vector<absl::string_view> input_lines;
+  for (absl::string_view line : absl::StrSplit(crasher, '\n')) {
+    if (absl::optional<absl::string_view> options_json =
+            GetCommentWithTag(line, "options:")) {
+      if (has_options) {
+        return absl::InvalidArgumentError("Crasher has multiple options");
+      }
+      XLS_ASSIGN_OR_RETURN(sample.options,
+                           SampleOptionsFromJson(*options_json));
+      has_options = true;
+      continue;
+    }
+    if (absl::optional<absl::string_view> args_text =
+            GetCommentWithTag(line, "args:")) {
+      XLS_ASSIGN_OR_RETURN(std::vector<dslx::InterpValue> args,
+                           ParseSampleArgs(*args_text));
+      sample.args_batch.push_back(std::move(args));
+      continue;
+    }
+    input_lines.push_back(line);
+  }
+  if (!has_options) {
+    return absl::InvalidArgumentError("Crasher has no options");
+  }
+  sample.input_text = absl::StrJoin(input_lines, "\n");
+  return sample;
+}
+
+absl::StatusOr<absl::optional<std::string>> ReadWorkerFrame(std::istream& in) {
+  std::string size_line;
+  if (!std::getline(in, size_line)) {
+    if (in.eof() && size_line.empty()) {
+      return absl::nullopt;
+    }
+    return absl::DataLossError("Could not read the size of a frame");
+  }
+  int64_t size;
+  if (!absl::SimpleAtoi(size_line, &size) || size < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid frame size: \"%s\"", size_line));
+  }
+  std::string payload(size, '\0');
+  in.read(payload.data(), size);
+  if (in.gcount() != size) {
+    return absl::DataLossError(absl::StrFormat(
+        "Truncated frame: expected %d bytes, got %d", size, in.gcount()));
+  }
+  return payload;
+}
+
+void WriteWorkerFrame(absl::string_view payload, std::ostream& out) {
+  out << payload.size() << '\n' << payload;
+}
+
+absl::Status FuzzWorker::RunSample(absl::string_view crasher) {
+  XLS_ASSIGN_OR_RETURN(Sample sample, SampleFromCrasher(crasher));
+  ++samples_run_;
+  absl::optional<absl::Span<const std::vector<dslx::InterpValue>>> args_batch;
+  if (!sample.args_batch.empty()) {
+    args_batch = sample.args_batch;
+  }
+  absl::Status status =
+      runner_.Run(sample.input_text, sample.options, args_batch);
+  if (runner_.deduplicated()) {
+    ++samples_deduplicated_;
+  }
+  return status;
+}
+
+absl::Status FuzzWorker::Serve(std::istream& in, std::ostream& out) {
+  while (true) {
+    XLS_ASSIGN_OR_RETURN(absl::optional<std::string> request,
+                         ReadWorkerFrame(in));
+    if (!request.has_value()) {
+      return absl::OkStatus();
+    }
+    absl::Status status = RunSample(*request);
+    std::string response =
+        absl::StrCat(absl::StatusCodeToString(status.code()), "\n");
+    if (status.ok()) {
+      std::string timing;
+      XLS_RET_CHECK(google::protobuf::TextFormat::PrintToString(
+          runner_.timing(), &timing));
+      absl::StrAppend(&response, timing);
+    } else {
+      absl::StrAppend(&response, status.message());
+    }
+    WriteWorkerFrame(response, out);
+    out.flush();
+    if (!out) {
+      return absl::DataLossError("Could not write the response");
+    }
+  }
+}
+
+}  // namespace xls
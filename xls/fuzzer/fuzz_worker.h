@@ -0,0 +1,105 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_FUZZER_FUZZ_WORKER_H_
+#define XLS_FUZZER_FUZZ_WORKER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/dslx/import_data.h"
+#include "xls/dslx/interp_value.h"
+#include "xls/fuzzer/cpp_sample_runner.h"
+#include "xls/fuzzer/sample_dedup.h"
+
+namespace xls {
+
+// A code sample and how to run it; see Sample in sample.py.
+struct Sample {
+  std::string input_text;
+  SampleOptions options;
+  // The argument sets to run the sample on; none if empty.
+  ArgsBatch args_batch;
+};
+
+// Parses the JSON-encoded SampleOptions produced by SampleOptions.to_json()
+// in sample.py.
+absl::StatusOr<SampleOptions> SampleOptionsFromJson(absl::string_view json);
+
+// Parses a semicolon-delimited list of typed values, e.g.
+// "bits[32]:6; (bits[8]:2, bits[16]:4)"; bits values are unsigned.
+absl::StatusOr<std::vector<dslx::InterpValue>> ParseSampleArgs(
+    absl::string_view args_text);
+
+// Parses a "crasher", the text serialization of a sample produced by
+// Sample.to_crasher() in sample.py.
+absl::StatusOr<Sample> SampleFromCrasher(absl::string_view crasher);
+
+// Reads a frame of the worker protocol from "in": its size in bytes as a
+// decimal number on a line of its own, followed by its payload. Returns
+// nullopt at the end of the input.
+absl::StatusOr<absl::optional<std::string>> ReadWorkerFrame(std::istream& in);
+void WriteWorkerFrame(absl::string_view payload, std::ostream& out);
+
+// A long-lived worker which runs many samples in the same process, so that
+// the cost of starting up (e.g. initializing LLVM) is paid once, the modules
+// imported by the DSLX samples (e.g. the standard library) are typechecked
+// once, and optionally the JIT-compiled code is reused across samples.
+//
+// Serve() reads requests from a pipe until its end: each request is a frame
+// holding a crasher (see SampleFromCrasher), and is answered by a frame whose
+// first line is the name of the status code of the run (e.g. "OK" or
+// "INVALID_ARGUMENT"), followed by the SampleTimingProto of the run in text
+// format if it succeeded, or the error message otherwise. A sample which
+// crashes the worker takes it down, so the client must be prepared to start a
+// new one.
+//
+// If given "seen_samples" (which must outlive the worker), the backend stages
+// of duplicate samples are skipped; see SampleRunner.
+class FuzzWorker {
+ public:
+  explicit FuzzWorker(
+      absl::optional<std::filesystem::path> jit_object_cache_dir =
+          absl::nullopt,
+      SeenSampleSet* seen_samples = nullptr)
+      : runner_(&import_data_, std::move(jit_object_cache_dir),
+                seen_samples) {}
+
+  // Runs the sample serialized as "crasher".
+  absl::Status RunSample(absl::string_view crasher);
+
+  // Answers the requests read from "in" on "out".
+  absl::Status Serve(std::istream& in, std::ostream& out);
+
+  const SampleRunner& runner() const { return runner_; }
+  int64_t samples_run() const { return samples_run_; }
+  int64_t samples_deduplicated() const { return samples_deduplicated_; }
+
+ private:
+  dslx::ImportData import_data_;
+  SampleRunner runner_;
+  int64_t samples_run_ = 0;
+  int64_t samples_deduplicated_ = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_FUZZER_FUZZ_WORKER_H_
@@ -0,0 +1,73 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/fuzzer/fuzz_worker.h"
+
+const char kUsage[] = R"(
+Long-lived fuzzer worker: runs the code samples it receives on stdin in-process
+and answers with their results on stdout, until the end of its input. See
+FuzzWorker in fuzz_worker.h for the protocol. Usage:
+  fuzz_worker_main [--jit_object_cache_dir=DIR] [--deduplicate_samples]
+      [--seen_samples_dir=DIR]
+)";
+
+ABSL_FLAG(std::string, jit_object_cache_dir, "",
+          "If given, the JIT-compiled code is cached in this directory and "
+          "reused across samples (and workers).");
+ABSL_FLAG(bool, deduplicate_samples, false,
+          "If true, codegen and simulation are skipped for samples whose "
+          "optimized IR is structurally identical to an earlier sample's.");
+ABSL_FLAG(std::string, seen_samples_dir, "",
+          "If given with --deduplicate_samples, the set of samples seen is "
+          "shared through this directory with the other workers using it.");
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+
+  if (!positional_arguments.empty()) {
+    XLS_LOG(QFATAL) << "Usage:\n" << kUsage;
+  }
+
+  absl::optional<std::filesystem::path> jit_object_cache_dir;
+  if (!absl::GetFlag(FLAGS_jit_object_cache_dir).empty()) {
+    jit_object_cache_dir = absl::GetFlag(FLAGS_jit_object_cache_dir);
+  }
+  std::unique_ptr<xls::SeenSampleSet> seen_samples;
+  if (absl::GetFlag(FLAGS_deduplicate_samples)) {
+    absl::optional<std::filesystem::path> seen_samples_dir;
+    if (!absl::GetFlag(FLAGS_seen_samples_dir).empty()) {
+      seen_samples_dir = absl::GetFlag(FLAGS_seen_samples_dir);
+    }
+    seen_samples = absl::make_unique<xls::SeenSampleSet>(seen_samples_dir);
+  }
+  std::ios::sync_with_stdio(false);
+  xls::FuzzWorker worker(jit_object_cache_dir, seen_samples.get());
+  XLS_QCHECK_OK(worker.Serve(std::cin, std::cout));
+  XLS_LOG(INFO) << "Ran " << worker.samples_run() << " samples ("
+                << worker.samples_deduplicated() << " duplicates).";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/fuzz_worker.h"
+
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::Optional;
+using testing::StartsWith;
+
+// A crasher as produced by Sample.to_crasher().
+constexpr char kCrasher[] =
+    "// Exception:\n"
+    "// Result miscompare for sample 0:\n"
+    "//\n"
+    "// options: {\"input_is_dslx\": true, \"convert_to_ir\": true, "
+    "\"optimize_ir\": true, \"use_jit\": true, \"codegen\": false, "
+    "\"codegen_args\": [\"--generator=pipeline\", \"--pipeline_stages=2\"], "
+    "\"simulate\": false, \"simulator\": null, \"use_system_verilog\": true}\n"
+    "// args: bits[8]:0x1; bits[8]:0x2\n"
+    "// args: bits[8]:0xc8; bits[8]:0x64\n"
+    "fn main(x: u8, y: u8) -> u8 {\n"
+    "  x + y\n"
+    "}";
+
+// Returns a crasher adding "value" to its argument.
+std::string AddCrasher(int64_t value) {
+  return absl::StrCat(
+      "// options: {\"input_is_dslx\": true, \"use_jit\": false}\n"
+      "// args: bits[8]:0x1\n"
+      "fn main(x: u8) -> u8 { x + u8:",
+      value, " }\n");
+}
+
+TEST(FuzzWorkerTest, SampleFromCrasher) {
+  XLS_ASSERT_OK_AND_ASSIGN(Sample sample, SampleFromCrasher(kCrasher));
+  EXPECT_TRUE(sample.options.input_is_dslx);
+  EXPECT_FALSE(sample.options.codegen);
+  EXPECT_TRUE(sample.options.simulator.empty());
+  EXPECT_THAT(sample.options.codegen_args,
+              ElementsAre("--generator=pipeline", "--pipeline_stages=2"));
+  ASSERT_EQ(sample.args_batch.size(), 2);
+  ASSERT_EQ(sample.args_batch[1].size(), 2);
+  EXPECT_TRUE(sample.args_batch[1][0].Eq(dslx::InterpValue::MakeUBits(8, 200)));
+  EXPECT_THAT(sample.input_text, HasSubstr("fn main(x: u8, y: u8) -> u8 {"));
+
+  EXPECT_THAT(SampleOptionsFromJson("{\"optimize_ir\": 1}"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("expected a boolean")));
+  EXPECT_THAT(SampleOptionsFromJson("{\"frobnicate\": true}"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown sample option")));
+  EXPECT_THAT(SampleFromCrasher("fn main() {}"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("no options")));
+}
+
+TEST(FuzzWorkerTest, Frames) {
+  std::stringstream stream;
+  WriteWorkerFrame("hello\nworld", stream);
+  WriteWorkerFrame("", stream);
+  EXPECT_THAT(ReadWorkerFrame(stream),
+              IsOkAndHolds(Optional(std::string("hello\nworld"))));
+  EXPECT_THAT(ReadWorkerFrame(stream), IsOkAndHolds(Optional(std::string())));
+  EXPECT_THAT(ReadWorkerFrame(stream), IsOkAndHolds(absl::nullopt));
+
+  std::stringstream truncated("10\nabc");
+  EXPECT_THAT(ReadWorkerFrame(truncated),
+              StatusIs(absl::StatusCode::kDataLoss, HasSubstr("Truncated")));
+}
+
+TEST(FuzzWorkerTest, RunsManySamples) {
+  FuzzWorker worker;
+  XLS_ASSERT_OK(worker.RunSample(kCrasher));
+  // Each sample has the same module name; the previous one must have been
+  // dropped.
+  for (int64_t i = 0; i < 4; ++i) {
+    XLS_ASSERT_OK(worker.RunSample(AddCrasher(i)));
+    EXPECT_TRUE(worker.runner()
+                    .results()
+                    .at("interpreted DSLX")[0]
+                    .Eq(dslx::InterpValue::MakeUBits(8, i + 1)));
+  }
+  // A sample which fails to typecheck doesn't affect the next ones.
+  EXPECT_THAT(worker.RunSample("// options: {}\nfn main() -> u8 { u16:1 }"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  XLS_EXPECT_OK(worker.RunSample(kCrasher));
+  EXPECT_EQ(worker.samples_run(), 7);
+}
+
+TEST(FuzzWorkerTest, Serve) {
+  std::stringstream in;
+  WriteWorkerFrame(kCrasher, in);
+  WriteWorkerFrame("not a crasher", in);
+  WriteWorkerFrame(AddCrasher(3), in);
+  std::stringstream out;
+  FuzzWorker worker;
+  XLS_ASSERT_OK(worker.Serve(in, out));
+
+  std::vector<std::string> responses;
+  while (true) {
+    XLS_ASSERT_OK_AND_ASSIGN(absl::optional<std::string> response,
+                             ReadWorkerFrame(out));
+    if (!response.has_value()) {
+      break;
+    }
+    responses.push_back(*response);
+  }
+  ASSERT_EQ(responses.size(), 3);
+  EXPECT_THAT(responses[0], StartsWith("OK\n"));
+  EXPECT_THAT(responses[0], HasSubstr("total_ns:"));
+  EXPECT_THAT(responses[1], StartsWith("INVALID_ARGUMENT\n"));
+  EXPECT_THAT(responses[2], StartsWith("OK\n"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -15,6 +15,8 @@
 // Exposes AST generation capability (as is needed for fuzzing) to Python code
 // (which currently drives the sampling / running process).
 
+#include <map>
+
 #include "absl/base/casts.h"
 #include "absl/status/statusor.h"
 #include "pybind11/functional.h"
@@ -71,7 +73,9 @@ PYBIND11_MODULE(cpp_ast_generator, m) {
                        absl::optional<bool> short_samples,
                        absl::optional<int64_t> max_width_bits_types,
                        absl::optional<int64_t> max_width_aggregate_types,
-                       absl::optional<std::vector<BinopKind>> binop_allowlist) {
+                       absl::optional<std::vector<BinopKind>> binop_allowlist,
+                       absl::optional<std::map<std::string, double>>
+                           op_weights) {
              AstGeneratorOptions options;
              if (disallow_divide.has_value()) {
                options.disallow_divide = disallow_divide.value();
@@ -90,6 +94,10 @@ PYBIND11_MODULE(cpp_ast_generator, m) {
                options.binop_allowlist = absl::btree_set<BinopKind>(
                    binop_allowlist->begin(), binop_allowlist->end());
              }
+             if (op_weights.has_value()) {
+               options.op_weights.insert(op_weights->begin(),
+                                         op_weights->end());
+             }
              return options;
            }),
            py::arg("disallow_divide") = absl::nullopt,
@@ -97,7 +105,8 @@ PYBIND11_MODULE(cpp_ast_generator, m) {
            py::arg("short_samples") = absl::nullopt,
            py::arg("max_width_bits_types") = absl::nullopt,
            py::arg("max_width_aggregate_types") = absl::nullopt,
-           py::arg("binop_allowlist") = absl::nullopt);
+           py::arg("binop_allowlist") = absl::nullopt,
+           py::arg("op_weights") = absl::nullopt);
 
   m.def("generate",
         [](const AstGeneratorOptions& options,
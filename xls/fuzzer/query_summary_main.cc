@@ -0,0 +1,178 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/types/span.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/fuzzer/sample_summary.pb.h"
+#include "xls/fuzzer/summary_store.h"
+
+const char kUsage[] = R"(
+Converts Protobuf summary files emitted by the fuzzer into a columnar summary
+file, and runs aggregate queries over columnar summary files. Queries only read
+the columns they need and skip the blocks which the index shows have no
+matching rows, so they remain interactive over millions of samples.
+
+Append the samples of a set of summary files to a columnar file:
+
+  query_summary_main --columnar_file=/tmp/summary.xlsc --convert \
+    /tmp/summaries/summary_*.binarypb
+
+Count the optimized nodes wider than 64 bits by op and type:
+
+  query_summary_main --columnar_file=/tmp/summary.xlsc --group_by=op,type \
+    --optimized=true --min_width=65
+
+Show the timing of the samples:
+
+  query_summary_main --columnar_file=/tmp/summary.xlsc --timing
+)";
+
+ABSL_FLAG(std::string, columnar_file, "", "Columnar summary file.");
+ABSL_FLAG(bool, convert, false,
+          "Append the samples of the summary files given as positional "
+          "arguments to --columnar_file, creating it if needed.");
+ABSL_FLAG(bool, timing, false,
+          "Show the total, mean and maximum time of the fuzzer operations.");
+ABSL_FLAG(std::string, group_by, "op",
+          "Comma-separated columns of the nodes table to count the nodes by. "
+          "Available: sample, optimized, op, type, width, operand_count, "
+          "mixed_width.");
+ABSL_FLAG(std::string, op, "", "If non-empty, only count nodes of this op.");
+ABSL_FLAG(std::string, optimized, "",
+          "If 'true' or 'false', only count nodes after or before "
+          "optimizations, respectively.");
+ABSL_FLAG(int64_t, min_width, 0, "Only count nodes at least this wide.");
+ABSL_FLAG(int64_t, max_width, -1,
+          "If non-negative, only count nodes at most this wide.");
+
+namespace xls::fuzzer {
+namespace {
+
+absl::Status Convert(absl::Span<const absl::string_view> input_paths,
+                     const std::string& columnar_path) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<ColumnarSummaryWriter> writer,
+                       ColumnarSummaryWriter::Open(columnar_path));
+  for (const absl::string_view input_path : input_paths) {
+    XLS_ASSIGN_OR_RETURN(std::string summary_data, GetFileContents(input_path));
+    SampleSummariesProto summaries;
+    if (!summaries.ParseFromString(summary_data)) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Failed to parse summary protobuf file %s", input_path));
+    }
+    for (const SampleSummaryProto& summary : summaries.samples()) {
+      XLS_RETURN_IF_ERROR(writer->Add(summary));
+    }
+  }
+  return writer->Close();
+}
+
+absl::Status DumpTiming(ColumnarSummaryReader* reader) {
+  XLS_ASSIGN_OR_RETURN(TimingAggregate timing, AggregateTiming(reader));
+  int64_t samples = reader->index().sample_count();
+  auto sec = [](double nanoseconds) { return nanoseconds / 1e9; };
+  std::cout << absl::StreamFormat("Samples: %d\n", samples);
+  const google::protobuf::Descriptor* descriptor =
+      SampleTimingProto::descriptor();
+  const google::protobuf::Reflection* reflection =
+      timing.total.GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const google::protobuf::FieldDescriptor* field = descriptor->field(i);
+    int64_t total = reflection->GetInt64(timing.total, field);
+    std::cout << absl::StreamFormat(
+        "%-30s %10.3fs, mean %5.3fs, max %6.3fs\n", field->name(), sec(total),
+        samples == 0 ? 0.0 : sec(static_cast<double>(total) / samples),
+        sec(reflection->GetInt64(timing.max, field)));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DumpNodeQuery(ColumnarSummaryReader* reader) {
+  NodeQuery query;
+  query.group_by = absl::StrSplit(absl::GetFlag(FLAGS_group_by), ',',
+                                  absl::SkipEmpty());
+  if (!absl::GetFlag(FLAGS_op).empty()) {
+    query.op = absl::GetFlag(FLAGS_op);
+  }
+  std::string optimized = absl::GetFlag(FLAGS_optimized);
+  if (optimized == "true" || optimized == "false") {
+    query.optimized = optimized == "true";
+  } else if (!optimized.empty()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid value of --optimized: %s", optimized));
+  }
+  query.min_width = absl::GetFlag(FLAGS_min_width);
+  if (absl::GetFlag(FLAGS_max_width) >= 0) {
+    query.max_width = absl::GetFlag(FLAGS_max_width);
+  }
+  XLS_ASSIGN_OR_RETURN(NodeQueryResult result, RunNodeQuery(reader, query));
+
+  for (const std::string& column : query.group_by) {
+    std::cout << absl::StreamFormat("%-20s", column);
+  }
+  std::cout << absl::StreamFormat("%13s\n", "count");
+  std::cout << std::string(20 * query.group_by.size() + 13, '-') << "\n";
+  for (const NodeQueryResult::Row& row : result.rows) {
+    for (const std::string& value : row.key) {
+      std::cout << absl::StreamFormat("%-20s", value);
+    }
+    std::cout << absl::StreamFormat("%13d\n", row.count);
+  }
+  std::cerr << absl::StreamFormat("Read %d blocks, skipped %d, %d bytes\n",
+                                  result.blocks_read, result.blocks_skipped,
+                                  reader->bytes_read());
+  return absl::OkStatus();
+}
+
+absl::Status RealMain(absl::Span<const absl::string_view> input_paths) {
+  std::string columnar_path = absl::GetFlag(FLAGS_columnar_file);
+  if (columnar_path.empty()) {
+    return absl::InvalidArgumentError("Must specify --columnar_file.");
+  }
+  if (absl::GetFlag(FLAGS_convert)) {
+    return Convert(input_paths, columnar_path);
+  }
+  if (!input_paths.empty()) {
+    return absl::InvalidArgumentError(
+        "Summary files can only be given with --convert.");
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<ColumnarSummaryReader> reader,
+                       ColumnarSummaryReader::Open(columnar_path));
+  if (absl::GetFlag(FLAGS_timing)) {
+    return DumpTiming(reader.get());
+  }
+  return DumpNodeQuery(reader.get());
+}
+
+}  // namespace
+}  // namespace xls::fuzzer
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK_OK(xls::fuzzer::RealMain(positional_arguments));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/sample_coverage.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+#include "xls/ir/type.h"
+
+namespace xls {
+namespace {
+
+// The number of least-covered features listed by CoverageTracker::ToString().
+constexpr int64_t kLeastCoveredCount = 10;
+
+// Returns the largest power of two not greater than "width" (or 0).
+int64_t WidthBucket(int64_t width) {
+  int64_t bucket = 1;
+  if (width <= 0) {
+    return 0;
+  }
+  while (bucket <= width / 2) {
+    bucket *= 2;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+void AddIrCoverage(const Package& package, SampleCoverage* coverage) {
+  for (const std::unique_ptr<Function>& function : package.functions()) {
+    for (Node* node : function->nodes()) {
+      std::string op = absl::StrCat("op:", OpToString(node->op()));
+      ++(*coverage)[absl::StrCat(
+          op, ":", WidthBucket(node->GetType()->GetFlatBitCount()))];
+      ++(*coverage)[std::move(op)];
+    }
+  }
+}
+
+void AddPassCoverage(const PassResults& results, SampleCoverage* coverage) {
+  for (const PassInvocation& invocation : results.invocations) {
+    if (invocation.ir_changed) {
+      ++(*coverage)[absl::StrCat("pass:", invocation.pass_name)];
+    }
+  }
+}
+
+double CoverageTracker::AddSample(
+    const absl::btree_map<std::string, int64_t>& generated_op_counts,
+    const SampleCoverage& coverage) {
+  double novelty = 0.0;
+  for (const auto& [feature, count] : coverage) {
+    int64_t& sample_count = feature_sample_counts_[feature];
+    novelty += 1.0 / (1.0 + sample_count);
+    ++sample_count;
+  }
+  ++sample_count_;
+
+  for (auto& [op, op_credit] : op_credits_) {
+    op_credit.credit *= options_.decay;
+    op_credit.share *= options_.decay;
+  }
+  int64_t total_op_count = 0;
+  for (const auto& [op, count] : generated_op_counts) {
+    total_op_count += count;
+  }
+  for (const auto& [op, count] : generated_op_counts) {
+    double share = static_cast<double>(count) / total_op_count;
+    OpCredit& op_credit = op_credits_[op];
+    op_credit.credit += novelty * share;
+    op_credit.share += share;
+  }
+  return novelty;
+}
+
+absl::flat_hash_map<std::string, double> CoverageTracker::GetOpWeights()
+    const {
+  std::vector<std::pair<std::string, double>> average_credits;
+  double sum = 0.0;
+  for (const auto& [op, op_credit] : op_credits_) {
+    if (op_credit.share > 0.0) {
+      double average = op_credit.credit / op_credit.share;
+      average_credits.push_back({op, average});
+      sum += average;
+    }
+  }
+  absl::flat_hash_map<std::string, double> weights;
+  if (sum <= 0.0) {
+    return weights;
+  }
+  double mean = sum / average_credits.size();
+  for (const auto& [op, average] : average_credits) {
+    weights[op] =
+        std::clamp(average / mean, options_.min_weight, options_.max_weight);
+  }
+  return weights;
+}
+
+std::string CoverageTracker::ToString() const {
+  std::string result =
+      absl::StrFormat("%d samples reached %d features\n", sample_count_,
+                      feature_sample_counts_.size());
+  std::vector<std::pair<int64_t, std::string>> features;
+  for (const auto& [feature, count] : feature_sample_counts_) {
+    features.push_back({count, feature});
+  }
+  std::sort(features.begin(), features.end());
+  features.resize(std::min<int64_t>(features.size(), kLeastCoveredCount));
+  absl::StrAppend(&result, "least covered:\n");
+  for (const auto& [count, feature] : features) {
+    absl::StrAppendFormat(&result, "  %s: %d\n", feature, count);
+  }
+  absl::flat_hash_map<std::string, double> weights = GetOpWeights();
+  absl::StrAppend(&result, "weights:\n");
+  for (const auto& [op, op_credit] : op_credits_) {
+    auto it = weights.find(op);
+    absl::StrAppendFormat(&result, "  %s: %.2f\n", op,
+                          it == weights.end() ? 1.0 : it->second);
+  }
+  return result;
+}
+
+absl::StatusOr<std::string> CoverageGuidedGenerator::GenerateSample() {
+  dslx::AstGeneratorOptions options = options_;
+  for (const auto& [op, weight] : tracker_.GetOpWeights()) {
+    auto [it, inserted] = options.op_weights.insert({op, weight});
+    if (!inserted) {
+      it->second *= weight;
+    }
+  }
+  dslx::AstGenerator generator(options, &rng_);
+  XLS_ASSIGN_OR_RETURN(auto generated,
+                       generator.GenerateFunctionInModule("main", "sample"));
+  last_generated_op_counts_ = generator.generated_op_counts();
+  return generated.second->ToString();
+}
+
+double CoverageGuidedGenerator::ReportCoverage(
+    const SampleCoverage& coverage) {
+  return tracker_.AddSample(last_generated_op_counts_, coverage);
+}
+
+}  // namespace xls
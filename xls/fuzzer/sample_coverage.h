@@ -0,0 +1,144 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_FUZZER_SAMPLE_COVERAGE_H_
+#define XLS_FUZZER_SAMPLE_COVERAGE_H_
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "xls/fuzzer/ast_generator.h"
+#include "xls/ir/package.h"
+#include "xls/passes/pass_base.h"
+
+namespace xls {
+
+// The coverage features reached by a sample, with the number of times each
+// was reached:
+//
+//  "op:<op>": IR nodes with the given op, e.g. "op:add".
+//  "op:<op>:<width>": IR nodes with the given op whose type has a flat bit
+//    count in [width, 2 * width), e.g. "op:add:8" for 8 to 15 bit adds.
+//  "pass:<pass>": invocations of the given pass which changed the IR, e.g.
+//    "pass:cse".
+using SampleCoverage = absl::btree_map<std::string, int64_t>;
+
+// Adds the ops (and their widths) of the functions of "package" to
+// "coverage".
+void AddIrCoverage(const Package& package, SampleCoverage* coverage);
+
+// Adds the passes which changed the IR in "results" to "coverage".
+void AddPassCoverage(const PassResults& results, SampleCoverage* coverage);
+
+// Accumulates the coverage reached by samples, and derives from it weights
+// for the AstGenerator (AstGeneratorOptions::op_weights) that bias generation
+// towards the kinds of expressions whose samples reach rarely-covered
+// features.
+//
+// Each sample is scored by its novelty: the sum over the features it reached
+// of 1 / (1 + the number of earlier samples which reached the feature), so a
+// feature never reached before counts for 1, and a feature reached by every
+// sample barely counts. The novelty is credited to the kinds of expressions
+// the sample was generated with, in proportion of their share of its
+// expressions. The weight of a kind of expression is its average credit
+// relative to the average over all kinds, clamped to [min_weight, max_weight].
+// Older samples are progressively forgotten, so that the weights follow the
+// coverage as it saturates.
+class CoverageTracker {
+ public:
+  struct Options {
+    double min_weight = 0.25;
+    double max_weight = 4.0;
+    // The factor by which the credits of each kind are decayed after each
+    // sample.
+    double decay = 0.99;
+  };
+
+  CoverageTracker() : CoverageTracker(Options()) {}
+  explicit CoverageTracker(Options options) : options_(options) {}
+
+  // Records a sample generated with "generated_op_counts" (see
+  // AstGenerator::generated_op_counts()) which reached "coverage", and returns
+  // its novelty.
+  double AddSample(const absl::btree_map<std::string, int64_t>&
+                       generated_op_counts,
+                   const SampleCoverage& coverage);
+
+  // Returns the current weights, for AstGeneratorOptions::op_weights.
+  absl::flat_hash_map<std::string, double> GetOpWeights() const;
+
+  int64_t sample_count() const { return sample_count_; }
+
+  // The number of samples which reached each feature.
+  const absl::btree_map<std::string, int64_t>& feature_sample_counts() const {
+    return feature_sample_counts_;
+  }
+
+  // Returns a summary of the coverage: the number of features reached, the
+  // least-covered features and the current weights.
+  std::string ToString() const;
+
+ private:
+  struct OpCredit {
+    // The decayed sums of the novelty credited to the op, and of its shares
+    // of the samples' expressions.
+    double credit = 0.0;
+    double share = 0.0;
+  };
+
+  Options options_;
+  int64_t sample_count_ = 0;
+  absl::btree_map<std::string, int64_t> feature_sample_counts_;
+  absl::btree_map<std::string, OpCredit> op_credits_;
+};
+
+// Generates DSLX samples with an AstGenerator whose op weights are updated
+// from the coverage the earlier samples reached:
+//
+//    CoverageGuidedGenerator generator(options, /*seed=*/0);
+//    while (...) {
+//      XLS_ASSIGN_OR_RETURN(std::string dslx, generator.GenerateSample());
+//      ... run the sample, collecting its coverage ...
+//      generator.ReportCoverage(coverage);
+//    }
+class CoverageGuidedGenerator {
+ public:
+  CoverageGuidedGenerator(dslx::AstGeneratorOptions options, int64_t seed,
+                          CoverageTracker::Options tracker_options =
+                              CoverageTracker::Options())
+      : options_(std::move(options)), rng_(seed), tracker_(tracker_options) {}
+
+  // Generates the text of a module "sample" with a function "main".
+  absl::StatusOr<std::string> GenerateSample();
+
+  // Records the coverage reached by the sample last returned by
+  // GenerateSample(), and returns its novelty.
+  double ReportCoverage(const SampleCoverage& coverage);
+
+  const CoverageTracker& tracker() const { return tracker_; }
+
+ private:
+  dslx::AstGeneratorOptions options_;
+  std::mt19937 rng_;
+  CoverageTracker tracker_;
+  absl::btree_map<std::string, int64_t> last_generated_op_counts_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_FUZZER_SAMPLE_COVERAGE_H_
@@ -0,0 +1,103 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/sample_coverage.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/status/matchers.h"
+#include "xls/fuzzer/cpp_sample_runner.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace {
+
+using testing::Contains;
+using testing::Gt;
+using testing::HasSubstr;
+using testing::Key;
+using testing::Not;
+using testing::Pair;
+
+TEST(SampleCoverageTest, IrAndPassCoverage) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(
+package sample
+
+fn main(x: bits[8], y: bits[17]) -> bits[8] {
+  bit_slice.1: bits[8] = bit_slice(y, start=0, width=8)
+  ret add.2: bits[8] = add(x, bit_slice.1)
+}
+)"));
+  SampleCoverage coverage;
+  AddIrCoverage(*package, &coverage);
+  EXPECT_THAT(coverage, Contains(Pair("op:add", 1)));
+  EXPECT_THAT(coverage, Contains(Pair("op:add:8", 1)));
+  EXPECT_THAT(coverage, Contains(Pair("op:param", 2)));
+  EXPECT_THAT(coverage, Contains(Pair("op:param:16", 1)));
+
+  PassResults results;
+  results.invocations.push_back({"cse", /*ir_changed=*/true});
+  results.invocations.push_back({"dce", /*ir_changed=*/false});
+  results.invocations.push_back({"cse", /*ir_changed=*/true});
+  AddPassCoverage(results, &coverage);
+  EXPECT_THAT(coverage, Contains(Pair("pass:cse", 2)));
+  EXPECT_THAT(coverage, Not(Contains(Key("pass:dce"))));
+}
+
+TEST(SampleCoverageTest, WeightsFavorNovelOps) {
+  CoverageTracker tracker;
+  EXPECT_TRUE(tracker.GetOpWeights().empty());
+  for (int64_t i = 0; i < 20; ++i) {
+    // Samples generated with "common" always reach the same feature; those
+    // also generated with "rare" reach a new one.
+    EXPECT_LE(tracker.AddSample({{"common", 1}}, {{"op:add", 1}}), 1.0);
+    EXPECT_DOUBLE_EQ(tracker.AddSample({{"common", 1}, {"rare", 1}},
+                                       {{absl::StrCat("op:new", i), 1}}),
+                     1.0);
+  }
+  EXPECT_EQ(tracker.sample_count(), 40);
+  EXPECT_EQ(tracker.feature_sample_counts().at("op:add"), 20);
+
+  absl::flat_hash_map<std::string, double> weights = tracker.GetOpWeights();
+  EXPECT_GT(weights.at("rare"), 1.0);
+  EXPECT_LT(weights.at("common"), 1.0);
+  EXPECT_GE(weights.at("common"), CoverageTracker::Options().min_weight);
+  EXPECT_THAT(tracker.ToString(), HasSubstr("40 samples reached 21 features"));
+}
+
+TEST(SampleCoverageTest, CoverageGuidedGeneration) {
+  dslx::AstGeneratorOptions options;
+  options.short_samples = true;
+  CoverageGuidedGenerator generator(options, /*seed=*/0);
+  SampleRunner runner;
+  SampleOptions sample_options;
+  for (int64_t i = 0; i < 8; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::string sample, generator.GenerateSample());
+    XLS_ASSERT_OK(runner.Run(sample, sample_options)) << sample;
+    EXPECT_THAT(runner.coverage(), Contains(Key("op:param")));
+    EXPECT_THAT(generator.ReportCoverage(runner.coverage()), Gt(0.0));
+  }
+  EXPECT_EQ(generator.tracker().sample_count(), 8);
+  for (const auto& [op, weight] : generator.tracker().GetOpWeights()) {
+    EXPECT_GE(weight, CoverageTracker::Options().min_weight) << op;
+    EXPECT_LE(weight, CoverageTracker::Options().max_weight) << op;
+  }
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,167 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/sample_dedup.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/stable_hash.h"
+#include "xls/common/strerror.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/op.h"
+
+namespace xls {
+namespace {
+
+class CanonicalHasher {
+ public:
+  uint64_t HashFunction(Function* f) {
+    auto it = function_hashes_.find(f);
+    if (it != function_hashes_.end()) {
+      return it->second;
+    }
+    absl::flat_hash_map<Node*, uint64_t> node_hashes;
+    std::vector<uint64_t> all_hashes;
+    for (Node* node : TopoSort(f)) {
+      std::vector<uint64_t> operand_hashes;
+      for (Node* operand : node->operands()) {
+        operand_hashes.push_back(node_hashes.at(operand));
+      }
+      if (OpIsCommutative(node->op())) {
+        std::sort(operand_hashes.begin(), operand_hashes.end());
+      }
+      uint64_t hash = StableHash64(absl::StrCat(
+          OpToString(node->op()), ":", node->GetType()->ToString(), ":",
+          Attributes(node), ":", absl::StrJoin(operand_hashes, ",")));
+      node_hashes[node] = hash;
+      all_hashes.push_back(hash);
+    }
+    // Dead nodes are part of the structure too, unordered.
+    std::sort(all_hashes.begin(), all_hashes.end());
+    uint64_t hash = StableHash64(absl::StrCat(
+        "ret=", node_hashes.at(f->return_value()),
+        " nodes=", absl::StrJoin(all_hashes, ",")));
+    function_hashes_[f] = hash;
+    return hash;
+  }
+
+ private:
+  // Returns the data of "node" besides its op, type and operands.
+  std::string Attributes(Node* node) {
+    switch (node->op()) {
+      case Op::kParam: {
+        FunctionBase* f = node->function_base();
+        auto it = std::find(f->params().begin(), f->params().end(), node);
+        return absl::StrCat("index=", it - f->params().begin());
+      }
+      case Op::kLiteral:
+        return node->As<Literal>()->value().ToString();
+      case Op::kCountedFor: {
+        CountedFor* loop = node->As<CountedFor>();
+        return absl::StrFormat("trip_count=%d stride=%d invariants=%d body=%x",
+                               loop->trip_count(), loop->stride(),
+                               loop->invariant_args().size(),
+                               HashFunction(loop->body()));
+      }
+      case Op::kDynamicCountedFor: {
+        DynamicCountedFor* loop = node->As<DynamicCountedFor>();
+        return absl::StrFormat("invariants=%d body=%x",
+                               loop->invariant_args().size(),
+                               HashFunction(loop->body()));
+      }
+      case Op::kMap:
+        return absl::StrFormat("to_apply=%x",
+                               HashFunction(node->As<Map>()->to_apply()));
+      case Op::kInvoke:
+        return absl::StrFormat("to_apply=%x",
+                               HashFunction(node->As<Invoke>()->to_apply()));
+      case Op::kTupleIndex:
+        return absl::StrCat("index=", node->As<TupleIndex>()->index());
+      case Op::kOneHot:
+        return node->As<OneHot>()->priority() == LsbOrMsb::kLsb ? "lsb"
+                                                                : "msb";
+      case Op::kSel:
+        return node->As<Select>()->default_value().has_value() ? "default"
+                                                               : "";
+      case Op::kSend:
+        return absl::StrCat("channel=", node->As<Send>()->channel_id());
+      case Op::kSendIf:
+        return absl::StrCat("channel=", node->As<SendIf>()->channel_id());
+      case Op::kReceive:
+        return absl::StrCat("channel=", node->As<Receive>()->channel_id());
+      case Op::kReceiveIf:
+        return absl::StrCat("channel=", node->As<ReceiveIf>()->channel_id());
+      case Op::kBitSlice:
+        return absl::StrCat("start=", node->As<BitSlice>()->start());
+      case Op::kAssert:
+        return absl::StrFormat("message=\"%s\" label=\"%s\"",
+                               node->As<Assert>()->message(),
+                               node->As<Assert>()->label().value_or(""));
+      default:
+        // The remaining data (e.g., the width of an extension) is implied by
+        // the type.
+        return "";
+    }
+  }
+
+  absl::flat_hash_map<Function*, uint64_t> function_hashes_;
+};
+
+}  // namespace
+
+uint64_t CanonicalIrHash(Function* f) {
+  return CanonicalHasher().HashFunction(f);
+}
+
+bool SeenSampleSet::Insert(absl::string_view key) {
+  std::string digest = absl::StrFormat("%016x", StableHash64(key));
+  if (!seen_.insert(digest).second) {
+    return false;
+  }
+  if (!dir_.has_value()) {
+    return true;
+  }
+  absl::Status status = RecursivelyCreateDir(*dir_);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to create seen samples directory: " << status;
+    return true;
+  }
+  std::filesystem::path path = *dir_ / digest;
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd >= 0) {
+    close(fd);
+    return true;
+  }
+  if (errno != EEXIST) {
+    XLS_LOG(WARNING) << "Unable to record seen sample " << path.string()
+                     << ": " << Strerror(errno);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace xls
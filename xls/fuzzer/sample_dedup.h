@@ -0,0 +1,58 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_FUZZER_SAMPLE_DEDUP_H_
+#define XLS_FUZZER_SAMPLE_DEDUP_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/ir/function.h"
+
+namespace xls {
+
+// Returns a hash of the structure of "f" and of the functions it calls which
+// is independent of the names, ids and positions of the nodes and of their
+// order in the function, so that samples which optimize down to the same IR
+// hash the same. The operands of commutative ops are unordered. The hash is
+// stable across processes.
+uint64_t CanonicalIrHash(Function* f);
+
+// The set of samples seen by a fuzz worker. If given a directory, the set is
+// shared with the other workers (and processes) using the same directory:
+// each sample is recorded by atomically creating a file named by the hash of
+// its key. I/O failures are logged and otherwise ignored, i.e., they only cost
+// running a duplicate sample.
+class SeenSampleSet {
+ public:
+  explicit SeenSampleSet(
+      absl::optional<std::filesystem::path> dir = absl::nullopt)
+      : dir_(std::move(dir)) {}
+
+  // Records the sample identified by "key"; returns true if it was not seen
+  // before.
+  bool Insert(absl::string_view key);
+
+ private:
+  absl::optional<std::filesystem::path> dir_;
+  absl::flat_hash_set<std::string> seen_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_FUZZER_SAMPLE_DEDUP_H_
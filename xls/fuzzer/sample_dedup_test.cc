@@ -0,0 +1,147 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/sample_dedup.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+// Returns the canonical hash of the entry function of the package "ir_text".
+uint64_t HashOf(absl::string_view ir_text) {
+  std::unique_ptr<Package> package = Parser::ParsePackage(ir_text).value();
+  return CanonicalIrHash(package->EntryFunction().value());
+}
+
+TEST(SampleDedupTest, IgnoresNamesAndOrder) {
+  uint64_t hash = HashOf(R"(
+package a
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  literal.1: bits[8] = literal(value=3)
+  add.2: bits[8] = add(x, y)
+  ret sub.3: bits[8] = sub(add.2, literal.1)
+}
+)");
+  EXPECT_EQ(HashOf(R"(
+package b
+
+fn f(p: bits[8], q: bits[8]) -> bits[8] {
+  add.7: bits[8] = add(q, p)
+  three: bits[8] = literal(value=3, pos=0,1,2)
+  ret result: bits[8] = sub(add.7, three)
+}
+)"),
+            hash);
+  EXPECT_NE(HashOf(R"(
+package a
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  literal.1: bits[8] = literal(value=3)
+  add.2: bits[8] = add(x, y)
+  ret sub.3: bits[8] = sub(literal.1, add.2)
+}
+)"),
+            hash);
+  EXPECT_NE(HashOf(R"(
+package a
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  literal.1: bits[8] = literal(value=4)
+  add.2: bits[8] = add(x, y)
+  ret sub.3: bits[8] = sub(add.2, literal.1)
+}
+)"),
+            hash);
+}
+
+TEST(SampleDedupTest, DistinguishesParamsAndAttributes) {
+  EXPECT_NE(HashOf(R"(
+package a
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  ret identity.1: bits[8] = identity(x)
+}
+)"),
+            HashOf(R"(
+package a
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  ret identity.1: bits[8] = identity(y)
+}
+)"));
+  EXPECT_NE(HashOf(R"(
+package a
+
+fn main(x: bits[8]) -> bits[4] {
+  ret bit_slice.1: bits[4] = bit_slice(x, start=0, width=4)
+}
+)"),
+            HashOf(R"(
+package a
+
+fn main(x: bits[8]) -> bits[4] {
+  ret bit_slice.1: bits[4] = bit_slice(x, start=4, width=4)
+}
+)"));
+}
+
+TEST(SampleDedupTest, HashesInvokedFunctions) {
+  constexpr char kInvokeTemplate[] = R"(
+package a
+
+fn callee(x: bits[8]) -> bits[8] {
+  ret %s.1: bits[8] = %s(x)
+}
+
+fn main(x: bits[8]) -> bits[8] {
+  ret invoke.2: bits[8] = invoke(x, to_apply=callee)
+}
+)";
+  auto invoke = [&](absl::string_view op) {
+    return HashOf(absl::StrFormat(kInvokeTemplate, op, op));
+  };
+  EXPECT_EQ(invoke("neg"), invoke("neg"));
+  EXPECT_NE(invoke("neg"), invoke("not"));
+}
+
+TEST(SampleDedupTest, SeenSampleSet) {
+  SeenSampleSet local;
+  EXPECT_TRUE(local.Insert("a"));
+  EXPECT_FALSE(local.Insert("a"));
+  EXPECT_TRUE(local.Insert("b"));
+
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path dir = temp_dir.path() / "seen";
+  SeenSampleSet first(dir);
+  SeenSampleSet second(dir);
+  EXPECT_TRUE(first.Insert("a"));
+  EXPECT_FALSE(second.Insert("a"));
+  EXPECT_TRUE(second.Insert("b"));
+  EXPECT_FALSE(first.Insert("b"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,580 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/summary_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include "google/protobuf/descriptor.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/strerror.h"
+#include "zlib.h"
+
+namespace xls::fuzzer {
+namespace {
+
+// The file starts with the magic number and ends with the offset of the index
+// (eight bytes, little-endian) followed by the magic number.
+constexpr absl::string_view kMagic = "XLSSUMC1";
+constexpr int64_t kTrailerSize = 8 + kMagic.size();
+
+const std::vector<std::string>& NodeColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "sample", "optimized",     "op",         "type",
+      "width",  "operand_count", "mixed_width"};
+  return *columns;
+}
+
+bool IsDictionaryColumn(absl::string_view column) {
+  return column == "op" || column == "type";
+}
+
+// The timing fields, which are the columns of the "samples" table after
+// "sample".
+std::vector<const google::protobuf::FieldDescriptor*> TimingFields() {
+  const google::protobuf::Descriptor* descriptor =
+      SampleTimingProto::descriptor();
+  std::vector<const google::protobuf::FieldDescriptor*> fields;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    fields.push_back(descriptor->field(i));
+  }
+  return fields;
+}
+
+std::vector<std::string> SampleColumns() {
+  std::vector<std::string> columns = {"sample"};
+  for (const google::protobuf::FieldDescriptor* field : TimingFields()) {
+    columns.push_back(field->name());
+  }
+  return columns;
+}
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool GetVarint(absl::string_view* in, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !in->empty(); shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(in->front());
+    in->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void PutFixed64(uint64_t value, std::string* out) {
+  for (int i = 0; i < 8; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+uint64_t GetFixed64(absl::string_view in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+absl::Status IoError(const std::filesystem::path& path,
+                     absl::string_view action) {
+  return absl::InternalError(absl::StrFormat(
+      "Failed to %s %s: %s", action, path.string(), Strerror(errno)));
+}
+
+}  // namespace
+
+/* static */ absl::StatusOr<std::unique_ptr<ColumnarSummaryWriter>>
+ColumnarSummaryWriter::Open(const std::filesystem::path& path,
+                            int64_t block_rows) {
+  XLS_RET_CHECK_GT(block_rows, 0);
+  ColumnarSummaryIndexProto index;
+  int64_t data_end = kMagic.size();
+  std::fstream file;
+  if (std::filesystem::exists(path)) {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<ColumnarSummaryReader> reader,
+                         ColumnarSummaryReader::Open(path));
+    index = reader->index();
+    for (const ColumnBlockProto& block : index.blocks()) {
+      for (const ColumnChunkProto& chunk : block.chunks()) {
+        data_end = std::max(data_end, chunk.offset() + chunk.size());
+      }
+    }
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+  } else {
+    file.open(path, std::ios::out | std::ios::binary);
+    file.write(kMagic.data(), kMagic.size());
+  }
+  if (!file) {
+    return IoError(path, "open");
+  }
+  return absl::WrapUnique(new ColumnarSummaryWriter(
+      path, block_rows, std::move(file), data_end, std::move(index)));
+}
+
+ColumnarSummaryWriter::ColumnarSummaryWriter(std::filesystem::path path,
+                                             int64_t block_rows,
+                                             std::fstream file,
+                                             int64_t data_end,
+                                             ColumnarSummaryIndexProto index)
+    : path_(std::move(path)),
+      block_rows_(block_rows),
+      file_(std::move(file)),
+      data_end_(data_end),
+      index_(std::move(index)) {
+  for (const ColumnDictionaryProto& dictionary : index_.dictionaries()) {
+    auto& codes = codes_[dictionary.column()];
+    for (int64_t i = 0; i < dictionary.values_size(); ++i) {
+      codes[dictionary.values(i)] = i;
+    }
+  }
+  nodes_.name = kNodesTable;
+  nodes_.columns = NodeColumns();
+  samples_.name = kSamplesTable;
+  samples_.columns = SampleColumns();
+  for (Table* table : {&nodes_, &samples_}) {
+    table->values.resize(table->columns.size());
+  }
+}
+
+ColumnarSummaryWriter::~ColumnarSummaryWriter() {
+  if (!closed_) {
+    absl::Status status = Close();
+    if (!status.ok()) {
+      XLS_LOG(ERROR) << "Failed to close columnar summary: " << status;
+    }
+  }
+}
+
+int64_t ColumnarSummaryWriter::Encode(absl::string_view column,
+                                      absl::string_view value) {
+  auto& codes = codes_[column];
+  auto [it, inserted] = codes.insert({std::string(value), codes.size()});
+  if (inserted) {
+    ColumnDictionaryProto* dictionary = nullptr;
+    for (ColumnDictionaryProto& d : *index_.mutable_dictionaries()) {
+      if (d.column() == column) {
+        dictionary = &d;
+      }
+    }
+    if (dictionary == nullptr) {
+      dictionary = index_.add_dictionaries();
+      dictionary->set_column(std::string(column));
+    }
+    dictionary->add_values(std::string(value));
+  }
+  return it->second;
+}
+
+absl::Status ColumnarSummaryWriter::Add(const SampleSummaryProto& summary) {
+  XLS_RET_CHECK(!closed_);
+  int64_t sample = index_.sample_count();
+  index_.set_sample_count(sample + 1);
+  for (bool optimized : {false, true}) {
+    const auto& nodes =
+        optimized ? summary.optimized_nodes() : summary.unoptimized_nodes();
+    for (const NodeProto& node : nodes) {
+      bool mixed_width = std::any_of(
+          node.operands().begin(), node.operands().end(),
+          [&](const NodeProto& operand) {
+            return operand.width() != node.operands(0).width();
+          });
+      std::vector<int64_t> row = {sample,
+                                  optimized,
+                                  Encode("op", node.op()),
+                                  Encode("type", node.type()),
+                                  node.width(),
+                                  node.operands_size(),
+                                  mixed_width};
+      for (int64_t i = 0; i < row.size(); ++i) {
+        nodes_.values[i].push_back(row[i]);
+      }
+      if (nodes_.values.front().size() >= block_rows_) {
+        XLS_RETURN_IF_ERROR(Flush(&nodes_));
+      }
+    }
+  }
+
+  samples_.values[0].push_back(sample);
+  std::vector<const google::protobuf::FieldDescriptor*> fields = TimingFields();
+  for (int64_t i = 0; i < fields.size(); ++i) {
+    samples_.values[i + 1].push_back(
+        summary.timing().GetReflection()->GetInt64(summary.timing(),
+                                                   fields[i]));
+  }
+  if (samples_.values.front().size() >= block_rows_) {
+    XLS_RETURN_IF_ERROR(Flush(&samples_));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarSummaryWriter::Flush(Table* table) {
+  int64_t row_count = table->values.front().size();
+  if (row_count == 0) {
+    return absl::OkStatus();
+  }
+  ColumnBlockProto* block = index_.add_blocks();
+  block->set_table(table->name);
+  block->set_row_count(row_count);
+  file_.seekp(data_end_);
+  for (int64_t i = 0; i < table->columns.size(); ++i) {
+    std::vector<int64_t>& values = table->values[i];
+    std::string encoded;
+    uint64_t previous = 0;
+    for (int64_t value : values) {
+      PutVarint(ZigZag(static_cast<int64_t>(value - previous)), &encoded);
+      previous = value;
+    }
+    uLongf compressed_size = compressBound(encoded.size());
+    std::string compressed(compressed_size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(compressed.data()),
+                  &compressed_size,
+                  reinterpret_cast<const Bytef*>(encoded.data()),
+                  encoded.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+      return absl::InternalError("Failed to compress summary column");
+    }
+    compressed.resize(compressed_size);
+    file_.write(compressed.data(), compressed.size());
+
+    ColumnChunkProto* chunk = block->add_chunks();
+    chunk->set_column(table->columns[i]);
+    chunk->set_offset(data_end_);
+    chunk->set_size(compressed.size());
+    chunk->set_uncompressed_size(encoded.size());
+    chunk->set_min(*std::min_element(values.begin(), values.end()));
+    chunk->set_max(*std::max_element(values.begin(), values.end()));
+    if (IsDictionaryColumn(table->columns[i])) {
+      std::sort(values.begin(), values.end());
+      values.erase(std::unique(values.begin(), values.end()), values.end());
+      for (int64_t code : values) {
+        chunk->add_codes(code);
+      }
+    }
+    data_end_ += compressed.size();
+    values.clear();
+  }
+  if (!file_) {
+    return IoError(path_, "write");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarSummaryWriter::Close() {
+  XLS_RET_CHECK(!closed_);
+  closed_ = true;
+  XLS_RETURN_IF_ERROR(Flush(&nodes_));
+  XLS_RETURN_IF_ERROR(Flush(&samples_));
+  std::string trailer = index_.SerializeAsString();
+  PutFixed64(data_end_, &trailer);
+  absl::StrAppend(&trailer, kMagic);
+  file_.seekp(data_end_);
+  file_.write(trailer.data(), trailer.size());
+  file_.close();
+  if (!file_) {
+    return IoError(path_, "write");
+  }
+  // When appending, the previous index may extend past the new end.
+  std::error_code error;
+  std::filesystem::resize_file(path_, data_end_ + trailer.size(), error);
+  if (error) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to resize %s: %s", path_.string(), error.message()));
+  }
+  return absl::OkStatus();
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<ColumnarSummaryReader>>
+ColumnarSummaryReader::Open(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return IoError(path, "open");
+  }
+  file.seekg(0, std::ios::end);
+  int64_t file_size = file.tellg();
+  auto not_a_summary = [&]() {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("%s is not a columnar summary file", path.string()));
+  };
+  if (file_size < kMagic.size() + kTrailerSize) {
+    return not_a_summary();
+  }
+  std::string header(kMagic.size(), '\0');
+  file.seekg(0);
+  file.read(header.data(), header.size());
+  std::string trailer(kTrailerSize, '\0');
+  file.seekg(file_size - kTrailerSize);
+  file.read(trailer.data(), trailer.size());
+  if (!file) {
+    return IoError(path, "read");
+  }
+  if (header != kMagic || absl::string_view(trailer).substr(8) != kMagic) {
+    return not_a_summary();
+  }
+  int64_t index_offset = GetFixed64(trailer);
+  if (index_offset < kMagic.size() ||
+      index_offset > file_size - kTrailerSize) {
+    return not_a_summary();
+  }
+  std::string serialized_index(file_size - kTrailerSize - index_offset, '\0');
+  file.seekg(index_offset);
+  file.read(serialized_index.data(), serialized_index.size());
+  ColumnarSummaryIndexProto index;
+  if (!file || !index.ParseFromString(serialized_index)) {
+    return not_a_summary();
+  }
+  return absl::WrapUnique(
+      new ColumnarSummaryReader(path, std::move(file), std::move(index)));
+}
+
+ColumnarSummaryReader::ColumnarSummaryReader(std::filesystem::path path,
+                                             std::ifstream file,
+                                             ColumnarSummaryIndexProto index)
+    : path_(std::move(path)), file_(std::move(file)), index_(std::move(index)) {
+  for (const ColumnDictionaryProto& dictionary : index_.dictionaries()) {
+    dictionaries_[dictionary.column()] = std::vector<std::string>(
+        dictionary.values().begin(), dictionary.values().end());
+  }
+}
+
+const std::vector<std::string>& ColumnarSummaryReader::Dictionary(
+    absl::string_view column) const {
+  static const auto* kEmpty = new std::vector<std::string>();
+  auto it = dictionaries_.find(column);
+  return it == dictionaries_.end() ? *kEmpty : it->second;
+}
+
+/* static */ const ColumnChunkProto* ColumnarSummaryReader::FindChunk(
+    const ColumnBlockProto& block, absl::string_view column) {
+  for (const ColumnChunkProto& chunk : block.chunks()) {
+    if (chunk.column() == column) {
+      return &chunk;
+    }
+  }
+  return nullptr;
+}
+
+absl::StatusOr<std::vector<int64_t>> ColumnarSummaryReader::ReadColumn(
+    const ColumnBlockProto& block, absl::string_view column) {
+  const ColumnChunkProto* chunk = FindChunk(block, column);
+  if (chunk == nullptr) {
+    return absl::NotFoundError(absl::StrFormat(
+        "No column %s in %s block of %s", column, block.table(),
+        path_.string()));
+  }
+  std::string compressed(chunk->size(), '\0');
+  file_.seekg(chunk->offset());
+  file_.read(compressed.data(), compressed.size());
+  if (!file_) {
+    return IoError(path_, "read");
+  }
+  bytes_read_ += compressed.size();
+
+  uLongf encoded_size = chunk->uncompressed_size();
+  std::string encoded(encoded_size, '\0');
+  auto corrupt = [&]() {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Corrupt column %s in %s", column, path_.string()));
+  };
+  if (uncompress(reinterpret_cast<Bytef*>(encoded.data()), &encoded_size,
+                 reinterpret_cast<const Bytef*>(compressed.data()),
+                 compressed.size()) != Z_OK ||
+      encoded_size != chunk->uncompressed_size()) {
+    return corrupt();
+  }
+  std::vector<int64_t> values;
+  values.reserve(block.row_count());
+  absl::string_view remaining = encoded;
+  uint64_t value = 0;
+  for (int64_t i = 0; i < block.row_count(); ++i) {
+    uint64_t delta;
+    if (!GetVarint(&remaining, &delta)) {
+      return corrupt();
+    }
+    value += UnZigZag(delta);
+    values.push_back(static_cast<int64_t>(value));
+  }
+  if (!remaining.empty()) {
+    return corrupt();
+  }
+  return values;
+}
+
+absl::StatusOr<NodeQueryResult> RunNodeQuery(ColumnarSummaryReader* reader,
+                                             const NodeQuery& query) {
+  const std::vector<std::string>& node_columns = NodeColumns();
+  for (const std::string& column : query.group_by) {
+    if (std::find(node_columns.begin(), node_columns.end(), column) ==
+        node_columns.end()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unknown column of the nodes table: %s", column));
+    }
+  }
+  absl::optional<int64_t> op_code;
+  if (query.op.has_value()) {
+    const std::vector<std::string>& ops = reader->Dictionary("op");
+    auto it = std::find(ops.begin(), ops.end(), *query.op);
+    // An op which never occurs matches no rows.
+    op_code = it == ops.end() ? -1 : it - ops.begin();
+  }
+  bool filter_width =
+      query.min_width > 0 ||
+      query.max_width < std::numeric_limits<int64_t>::max();
+
+  // The columns to read from each block: the filtered ones, then the grouped
+  // ones.
+  std::vector<std::string> columns;
+  auto add_column = [&](absl::string_view column) {
+    if (std::find(columns.begin(), columns.end(), column) == columns.end()) {
+      columns.push_back(std::string(column));
+    }
+  };
+  if (op_code.has_value()) {
+    add_column("op");
+  }
+  if (query.optimized.has_value()) {
+    add_column("optimized");
+  }
+  if (filter_width) {
+    add_column("width");
+  }
+  for (const std::string& column : query.group_by) {
+    add_column(column);
+  }
+
+  NodeQueryResult result;
+  absl::flat_hash_map<std::vector<int64_t>, int64_t> counts;
+  for (const ColumnBlockProto& block : reader->index().blocks()) {
+    if (block.table() != kNodesTable) {
+      continue;
+    }
+    // Skip the blocks the index shows have no matching rows.
+    auto chunk = [&](absl::string_view column) -> const ColumnChunkProto& {
+      const ColumnChunkProto* chunk =
+          ColumnarSummaryReader::FindChunk(block, column);
+      static const auto* kEmpty = new ColumnChunkProto();
+      return chunk == nullptr ? *kEmpty : *chunk;
+    };
+    bool skip = false;
+    if (op_code.has_value()) {
+      const auto& codes = chunk("op").codes();
+      skip |= std::find(codes.begin(), codes.end(), *op_code) == codes.end();
+    }
+    if (query.optimized.has_value()) {
+      const ColumnChunkProto& optimized = chunk("optimized");
+      skip |= optimized.max() < *query.optimized ||
+              optimized.min() > *query.optimized;
+    }
+    if (filter_width) {
+      const ColumnChunkProto& width = chunk("width");
+      skip |= width.max() < query.min_width || width.min() > query.max_width;
+    }
+    if (skip) {
+      ++result.blocks_skipped;
+      continue;
+    }
+    ++result.blocks_read;
+
+    absl::flat_hash_map<std::string, std::vector<int64_t>> values;
+    for (const std::string& column : columns) {
+      XLS_ASSIGN_OR_RETURN(values[column], reader->ReadColumn(block, column));
+    }
+    std::vector<int64_t> key(query.group_by.size());
+    for (int64_t row = 0; row < block.row_count(); ++row) {
+      if ((op_code.has_value() && values.at("op")[row] != *op_code) ||
+          (query.optimized.has_value() &&
+           values.at("optimized")[row] != *query.optimized) ||
+          (filter_width && (values.at("width")[row] < query.min_width ||
+                            values.at("width")[row] > query.max_width))) {
+        continue;
+      }
+      for (int64_t i = 0; i < key.size(); ++i) {
+        key[i] = values.at(query.group_by[i])[row];
+      }
+      ++counts[key];
+    }
+  }
+
+  for (const auto& [key, count] : counts) {
+    NodeQueryResult::Row row;
+    for (int64_t i = 0; i < key.size(); ++i) {
+      const std::vector<std::string>& dictionary =
+          reader->Dictionary(query.group_by[i]);
+      if (IsDictionaryColumn(query.group_by[i])) {
+        XLS_RET_CHECK_LT(key[i], dictionary.size());
+        row.key.push_back(dictionary[key[i]]);
+      } else {
+        row.key.push_back(absl::StrCat(key[i]));
+      }
+    }
+    row.count = count;
+    result.rows.push_back(std::move(row));
+  }
+  std::sort(result.rows.begin(), result.rows.end(),
+            [](const NodeQueryResult::Row& a, const NodeQueryResult::Row& b) {
+              return a.count != b.count ? a.count > b.count : a.key < b.key;
+            });
+  return result;
+}
+
+absl::StatusOr<TimingAggregate> AggregateTiming(
+    ColumnarSummaryReader* reader) {
+  TimingAggregate aggregate;
+  const google::protobuf::Reflection* reflection =
+      aggregate.total.GetReflection();
+  for (const ColumnBlockProto& block : reader->index().blocks()) {
+    if (block.table() != kSamplesTable) {
+      continue;
+    }
+    for (const google::protobuf::FieldDescriptor* field : TimingFields()) {
+      XLS_ASSIGN_OR_RETURN(std::vector<int64_t> values,
+                           reader->ReadColumn(block, field->name()));
+      int64_t total = reflection->GetInt64(aggregate.total, field);
+      int64_t max = reflection->GetInt64(aggregate.max, field);
+      for (int64_t value : values) {
+        total += value;
+        max = std::max(max, value);
+      }
+      reflection->SetInt64(&aggregate.total, field, total);
+      reflection->SetInt64(&aggregate.max, field, max);
+    }
+  }
+  return aggregate;
+}
+
+}  // namespace xls::fuzzer
@@ -0,0 +1,168 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_FUZZER_SUMMARY_STORE_H_
+#define XLS_FUZZER_SUMMARY_STORE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/fuzzer/sample_summary.pb.h"
+
+namespace xls::fuzzer {
+
+// A columnar store of fuzzer sample summaries, for aggregate queries over
+// millions of samples which only read the columns they need.
+//
+// The file holds blocks of rows of two tables, "nodes" (one row per node of
+// the unoptimized and optimized IR of each sample) and "samples" (one row per
+// sample with its timing), followed by an index (ColumnarSummaryIndexProto)
+// with the location and value range of every column chunk of every block.
+// Queries skip the blocks whose ranges exclude their filters.
+//
+// Columns of the "nodes" table: "sample", "optimized", "op" and "type"
+// (dictionary-encoded), "width", "operand_count" and "mixed_width". Columns
+// of the "samples" table: "sample" and each field of SampleTimingProto.
+inline constexpr char kNodesTable[] = "nodes";
+inline constexpr char kSamplesTable[] = "samples";
+
+// Appends summaries to a columnar summary file.
+class ColumnarSummaryWriter {
+ public:
+  static constexpr int64_t kDefaultBlockRows = 1 << 16;
+
+  // Opens "path" for appending, creating it if it does not exist.
+  static absl::StatusOr<std::unique_ptr<ColumnarSummaryWriter>> Open(
+      const std::filesystem::path& path,
+      int64_t block_rows = kDefaultBlockRows);
+
+  ~ColumnarSummaryWriter();
+
+  absl::Status Add(const SampleSummaryProto& summary);
+
+  // Writes the buffered rows and the index. Must be called for the added
+  // summaries to be persisted.
+  absl::Status Close();
+
+ private:
+  struct Table {
+    std::string name;
+    std::vector<std::string> columns;
+    std::vector<std::vector<int64_t>> values;
+  };
+
+  ColumnarSummaryWriter(std::filesystem::path path, int64_t block_rows,
+                        std::fstream file, int64_t data_end,
+                        ColumnarSummaryIndexProto index);
+
+  int64_t Encode(absl::string_view column, absl::string_view value);
+  absl::Status Flush(Table* table);
+
+  std::filesystem::path path_;
+  int64_t block_rows_;
+  std::fstream file_;
+  // Offset at which the next block is written.
+  int64_t data_end_;
+  ColumnarSummaryIndexProto index_;
+  absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, int64_t>>
+      codes_;
+  Table nodes_;
+  Table samples_;
+  bool closed_ = false;
+};
+
+// Reads the columns of a columnar summary file on demand.
+class ColumnarSummaryReader {
+ public:
+  static absl::StatusOr<std::unique_ptr<ColumnarSummaryReader>> Open(
+      const std::filesystem::path& path);
+
+  const ColumnarSummaryIndexProto& index() const { return index_; }
+
+  // Returns the values of the dictionary-encoded column, indexed by code. The
+  // dictionary is empty if the column is not dictionary-encoded.
+  const std::vector<std::string>& Dictionary(absl::string_view column) const;
+
+  // Returns the chunk of "column" in "block", or nullptr if it has none.
+  static const ColumnChunkProto* FindChunk(const ColumnBlockProto& block,
+                                           absl::string_view column);
+
+  // Reads and decodes the given column of a block.
+  absl::StatusOr<std::vector<int64_t>> ReadColumn(const ColumnBlockProto& block,
+                                                  absl::string_view column);
+
+  // Number of compressed bytes read by ReadColumn so far.
+  int64_t bytes_read() const { return bytes_read_; }
+
+ private:
+  ColumnarSummaryReader(std::filesystem::path path, std::ifstream file,
+                        ColumnarSummaryIndexProto index);
+
+  std::filesystem::path path_;
+  std::ifstream file_;
+  ColumnarSummaryIndexProto index_;
+  absl::flat_hash_map<std::string, std::vector<std::string>> dictionaries_;
+  int64_t bytes_read_ = 0;
+};
+
+// Counts the rows of the "nodes" table matching the filters, grouped by the
+// values of the "group_by" columns.
+struct NodeQuery {
+  std::vector<std::string> group_by;
+
+  absl::optional<std::string> op;
+  absl::optional<bool> optimized;
+  int64_t min_width = 0;
+  int64_t max_width = std::numeric_limits<int64_t>::max();
+};
+
+struct NodeQueryResult {
+  struct Row {
+    // The values of the "group_by" columns, as strings.
+    std::vector<std::string> key;
+    int64_t count;
+  };
+
+  // In decreasing order of count.
+  std::vector<Row> rows;
+
+  int64_t blocks_read = 0;
+  int64_t blocks_skipped = 0;
+};
+
+absl::StatusOr<NodeQueryResult> RunNodeQuery(ColumnarSummaryReader* reader,
+                                             const NodeQuery& query);
+
+// Totals and maxima of the timing of all samples.
+struct TimingAggregate {
+  SampleTimingProto total;
+  SampleTimingProto max;
+};
+
+absl::StatusOr<TimingAggregate> AggregateTiming(
+    ColumnarSummaryReader* reader);
+
+}  // namespace xls::fuzzer
+
+#endif  // XLS_FUZZER_SUMMARY_STORE_H_
@@ -0,0 +1,201 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/fuzzer/summary_store.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls::fuzzer {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::AllOf;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::HasSubstr;
+
+template <typename KeyMatcher>
+auto RowIs(KeyMatcher key, int64_t count) {
+  return AllOf(Field(&NodeQueryResult::Row::key, key),
+               Field(&NodeQueryResult::Row::count, count));
+}
+
+NodeProto MakeNode(absl::string_view op, absl::string_view type, int64_t width,
+                   std::vector<int64_t> operand_widths = {}) {
+  NodeProto node;
+  node.set_op(std::string(op));
+  node.set_type(std::string(type));
+  node.set_width(width);
+  for (int64_t operand_width : operand_widths) {
+    NodeProto* operand = node.add_operands();
+    operand->set_op("param");
+    operand->set_type("bits");
+    operand->set_width(operand_width);
+  }
+  return node;
+}
+
+SampleSummaryProto MakeSummary(std::vector<NodeProto> unoptimized,
+                               std::vector<NodeProto> optimized,
+                               int64_t total_ns) {
+  SampleSummaryProto summary;
+  for (NodeProto& node : unoptimized) {
+    *summary.add_unoptimized_nodes() = std::move(node);
+  }
+  for (NodeProto& node : optimized) {
+    *summary.add_optimized_nodes() = std::move(node);
+  }
+  summary.mutable_timing()->set_total_ns(total_ns);
+  summary.mutable_timing()->set_optimize_ns(total_ns / 2);
+  return summary;
+}
+
+class SummaryStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(temp_dir_, TempDirectory::Create());
+    path_ = temp_dir_->path() / "summary.xlsc";
+
+    // Blocks of three rows so the samples span several blocks.
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryWriter> writer,
+                             ColumnarSummaryWriter::Open(path_, 3));
+    XLS_ASSERT_OK(writer->Add(MakeSummary(
+        {MakeNode("param", "bits", 8), MakeNode("param", "bits", 8),
+         MakeNode("add", "bits", 8, {8, 8})},
+        {MakeNode("param", "bits", 8), MakeNode("param", "bits", 8),
+         MakeNode("add", "bits", 8, {8, 8})},
+        100)));
+    XLS_ASSERT_OK(writer->Add(MakeSummary(
+        {MakeNode("param", "bits", 64), MakeNode("param", "bits", 32),
+         MakeNode("umul", "bits", 128, {64, 32})},
+        {}, 300)));
+    XLS_ASSERT_OK(writer->Close());
+  }
+
+  absl::optional<TempDirectory> temp_dir_;
+  std::filesystem::path path_;
+};
+
+TEST_F(SummaryStoreTest, GroupByOp) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryReader> reader,
+                           ColumnarSummaryReader::Open(path_));
+  EXPECT_EQ(reader->index().sample_count(), 2);
+  NodeQuery query;
+  query.group_by = {"op"};
+  XLS_ASSERT_OK_AND_ASSIGN(NodeQueryResult result,
+                           RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows,
+              ElementsAre(RowIs(ElementsAre("param"), 6),
+                          RowIs(ElementsAre("add"), 2),
+                          RowIs(ElementsAre("umul"), 1)));
+}
+
+TEST_F(SummaryStoreTest, FiltersSkipBlocks) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryReader> reader,
+                           ColumnarSummaryReader::Open(path_));
+  NodeQuery query;
+  query.group_by = {"type", "mixed_width"};
+  query.min_width = 65;
+  XLS_ASSERT_OK_AND_ASSIGN(NodeQueryResult result,
+                           RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows, ElementsAre(RowIs(ElementsAre("bits", "1"), 1)));
+  // Only the last of the three blocks of nodes has a node wider than 64 bits.
+  EXPECT_EQ(result.blocks_read, 1);
+  EXPECT_EQ(result.blocks_skipped, 2);
+
+  query = NodeQuery();
+  query.op = "add";
+  query.optimized = true;
+  XLS_ASSERT_OK_AND_ASSIGN(result, RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows, ElementsAre(RowIs(ElementsAre(), 1)));
+
+  query.op = "sel";
+  XLS_ASSERT_OK_AND_ASSIGN(result, RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows, ElementsAre());
+  EXPECT_EQ(result.blocks_read, 0);
+}
+
+TEST_F(SummaryStoreTest, ReadsOnlyQueriedColumns) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryReader> reader,
+                           ColumnarSummaryReader::Open(path_));
+  NodeQuery query;
+  XLS_ASSERT_OK_AND_ASSIGN(NodeQueryResult result,
+                           RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows, ElementsAre(RowIs(ElementsAre(), 9)));
+  EXPECT_EQ(reader->bytes_read(), 0);
+
+  query.group_by = {"width"};
+  XLS_ASSERT_OK(RunNodeQuery(reader.get(), query).status());
+  int64_t width_bytes = 0;
+  for (const ColumnBlockProto& block : reader->index().blocks()) {
+    if (block.table() == kNodesTable) {
+      width_bytes += ColumnarSummaryReader::FindChunk(block, "width")->size();
+    }
+  }
+  EXPECT_EQ(reader->bytes_read(), width_bytes);
+}
+
+TEST_F(SummaryStoreTest, Append) {
+  {
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryWriter> writer,
+                             ColumnarSummaryWriter::Open(path_));
+    XLS_ASSERT_OK(writer->Add(MakeSummary(
+        {MakeNode("array_index", "array", 16, {16, 4})}, {}, 600)));
+    XLS_ASSERT_OK(writer->Close());
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryReader> reader,
+                           ColumnarSummaryReader::Open(path_));
+  EXPECT_EQ(reader->index().sample_count(), 3);
+  NodeQuery query;
+  query.group_by = {"op", "sample", "optimized", "operand_count"};
+  query.op = "array_index";
+  XLS_ASSERT_OK_AND_ASSIGN(NodeQueryResult result,
+                           RunNodeQuery(reader.get(), query));
+  EXPECT_THAT(result.rows, ElementsAre(RowIs(
+                               ElementsAre("array_index", "2", "0", "2"), 1)));
+
+  XLS_ASSERT_OK_AND_ASSIGN(TimingAggregate timing,
+                           AggregateTiming(reader.get()));
+  EXPECT_EQ(timing.total.total_ns(), 1000);
+  EXPECT_EQ(timing.max.total_ns(), 600);
+  EXPECT_EQ(timing.total.optimize_ns(), 500);
+}
+
+TEST_F(SummaryStoreTest, Errors) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ColumnarSummaryReader> reader,
+                           ColumnarSummaryReader::Open(path_));
+  NodeQuery query;
+  query.group_by = {"opcode"};
+  EXPECT_THAT(RunNodeQuery(reader.get(), query).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown column")));
+
+  std::filesystem::path text_path = temp_dir_->path() / "summary.txt";
+  XLS_ASSERT_OK(SetFileContents(text_path, "not a columnar summary file"));
+  EXPECT_THAT(ColumnarSummaryReader::Open(text_path).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace xls::fuzzer
@@ -0,0 +1,190 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/bits_evaluator.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+Bits ResizeProduct(const Bits& product, int64_t width, bool is_signed) {
+  if (product.bit_count() > width) {
+    return product.Slice(0, width);
+  }
+  if (product.bit_count() < width) {
+    return is_signed ? bits_ops::SignExtend(product, width)
+                     : bits_ops::ZeroExtend(product, width);
+  }
+  return product;
+}
+
+}  // namespace
+
+uint64_t BitsToBoundedUint64(const Bits& bits, uint64_t upper_limit) {
+  if (Bits::MinBitCountUnsigned(upper_limit) <= bits.bit_count() &&
+      bits_ops::UGreaterThan(bits, UBits(upper_limit, bits.bit_count()))) {
+    return upper_limit;
+  }
+  return bits.ToUint64().value();
+}
+
+absl::StatusOr<Bits> EvaluateBitsNode(Node* node,
+                                      absl::Span<const Bits> operands) {
+  switch (node->op()) {
+    case Op::kAdd:
+      return bits_ops::Add(operands[0], operands[1]);
+    case Op::kSub:
+      return bits_ops::Sub(operands[0], operands[1]);
+    case Op::kAnd:
+      return bits_ops::NaryAnd(operands);
+    case Op::kNand:
+      return bits_ops::NaryNand(operands);
+    case Op::kNor:
+      return bits_ops::NaryNor(operands);
+    case Op::kOr:
+      return bits_ops::NaryOr(operands);
+    case Op::kXor:
+      return bits_ops::NaryXor(operands);
+    case Op::kAndReduce:
+      return bits_ops::AndReduce(operands[0]);
+    case Op::kOrReduce:
+      return bits_ops::OrReduce(operands[0]);
+    case Op::kXorReduce:
+      return bits_ops::XorReduce(operands[0]);
+    case Op::kNeg:
+      return bits_ops::Negate(operands[0]);
+    case Op::kNot:
+      return bits_ops::Not(operands[0]);
+    case Op::kReverse:
+      return bits_ops::Reverse(operands[0]);
+    case Op::kBitSlice: {
+      BitSlice* bit_slice = node->As<BitSlice>();
+      return operands[0].Slice(bit_slice->start(), bit_slice->width());
+    }
+    case Op::kBitSliceUpdate: {
+      const Bits& to_update = operands[0];
+      const Bits& start = operands[1];
+      if (bits_ops::UGreaterThanOrEqual(start, to_update.bit_count())) {
+        return to_update;
+      }
+      return bits_ops::BitSliceUpdate(to_update, start.ToUint64().value(),
+                                      operands[2]);
+    }
+    case Op::kDynamicBitSlice: {
+      int64_t width = node->As<DynamicBitSlice>()->width();
+      if (bits_ops::UGreaterThanOrEqual(operands[1],
+                                        operands[0].bit_count())) {
+        return Bits(width);
+      }
+      return bits_ops::ShiftRightLogical(operands[0],
+                                         operands[1].ToUint64().value())
+          .Slice(0, width);
+    }
+    case Op::kConcat:
+      return bits_ops::Concat(operands);
+    case Op::kDecode: {
+      int64_t width = node->BitCountOrDie();
+      uint64_t index = BitsToBoundedUint64(operands[0], width);
+      if (index < width) {
+        return Bits::PowerOfTwo(/*set_bit_index=*/index, width);
+      }
+      return Bits(width);
+    }
+    case Op::kEncode: {
+      int64_t width = node->BitCountOrDie();
+      Bits result(width);
+      for (int64_t i = 0; i < operands[0].bit_count(); ++i) {
+        if (operands[0].Get(i)) {
+          result = bits_ops::Or(result, UBits(i, width));
+        }
+      }
+      return result;
+    }
+    case Op::kOneHot: {
+      OneHot* one_hot = node->As<OneHot>();
+      int64_t width = one_hot->BitCountOrDie();
+      const Bits& input = operands[0];
+      for (int64_t i = 0; i < input.bit_count(); ++i) {
+        int64_t index = one_hot->priority() == LsbOrMsb::kLsb
+                            ? i
+                            : input.bit_count() - i - 1;
+        if (input.Get(index)) {
+          return Bits::PowerOfTwo(index, width);
+        }
+      }
+      return Bits::PowerOfTwo(width - 1, width);
+    }
+    case Op::kEq:
+      return UBits(operands[0] == operands[1], 1);
+    case Op::kNe:
+      return UBits(operands[0] != operands[1], 1);
+    case Op::kSGe:
+      return UBits(bits_ops::SGreaterThanOrEqual(operands[0], operands[1]), 1);
+    case Op::kSGt:
+      return UBits(bits_ops::SGreaterThan(operands[0], operands[1]), 1);
+    case Op::kSLe:
+      return UBits(bits_ops::SLessThanOrEqual(operands[0], operands[1]), 1);
+    case Op::kSLt:
+      return UBits(bits_ops::SLessThan(operands[0], operands[1]), 1);
+    case Op::kUGe:
+      return UBits(bits_ops::UGreaterThanOrEqual(operands[0], operands[1]), 1);
+    case Op::kUGt:
+      return UBits(bits_ops::UGreaterThan(operands[0], operands[1]), 1);
+    case Op::kULe:
+      return UBits(bits_ops::ULessThanOrEqual(operands[0], operands[1]), 1);
+    case Op::kULt:
+      return UBits(bits_ops::ULessThan(operands[0], operands[1]), 1);
+    case Op::kSDiv:
+      return bits_ops::SDiv(operands[0], operands[1]);
+    case Op::kSMod:
+      return bits_ops::SMod(operands[0], operands[1]);
+    case Op::kUDiv:
+      return bits_ops::UDiv(operands[0], operands[1]);
+    case Op::kUMod:
+      return bits_ops::UMod(operands[0], operands[1]);
+    case Op::kSMul:
+      return ResizeProduct(bits_ops::SMul(operands[0], operands[1]),
+                           node->BitCountOrDie(), /*is_signed=*/true);
+    case Op::kUMul:
+      return ResizeProduct(bits_ops::UMul(operands[0], operands[1]),
+                           node->BitCountOrDie(), /*is_signed=*/false);
+    case Op::kShll:
+      return bits_ops::ShiftLeftLogical(
+          operands[0],
+          BitsToBoundedUint64(operands[1], operands[0].bit_count()));
+    case Op::kShra:
+      return bits_ops::ShiftRightArith(
+          operands[0],
+          BitsToBoundedUint64(operands[1], operands[0].bit_count()));
+    case Op::kShrl:
+      return bits_ops::ShiftRightLogical(
+          operands[0],
+          BitsToBoundedUint64(operands[1], operands[0].bit_count()));
+    case Op::kSignExt:
+      return bits_ops::SignExtend(operands[0],
+                                  node->As<ExtendOp>()->new_bit_count());
+    case Op::kZeroExt:
+      return bits_ops::ZeroExtend(operands[0],
+                                  node->As<ExtendOp>()->new_bit_count());
+    default:
+      return absl::InternalError(absl::StrFormat(
+          "Not a bits operation: %s", OpToString(node->op())));
+  }
+}
+
+}  // namespace xls
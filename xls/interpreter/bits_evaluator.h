@@ -0,0 +1,41 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_BITS_EVALUATOR_H_
+#define XLS_INTERPRETER_BITS_EVALUATOR_H_
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+
+// Evaluates a node whose result and operands are all bits-typed, given the
+// values of its operands. The semantics match those of IrInterpreter. This is
+// shared by the interpreters which don't go through IrInterpreter's visitor.
+// Returns an error if the node's op isn't a bits operation (e.g., tuple or
+// invoke).
+absl::StatusOr<Bits> EvaluateBitsNode(Node* node,
+                                      absl::Span<const Bits> operands);
+
+// Returns the given bits value as a uint64_t value. If the value exceeds
+// upper_limit, then upper_limit is returned.
+uint64_t BitsToBoundedUint64(const Bits& bits, uint64_t upper_limit);
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_BITS_EVALUATOR_H_
@@ -0,0 +1,441 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/bytecode_interpreter.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/bits_evaluator.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/keyword_args.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+// Returns a copy of 'array' with the element at the given multidimensional
+// index replaced by 'update'. Out-of-bounds indices leave the array unchanged.
+Value UpdateArrayElement(const Value& array,
+                         absl::Span<const Bits* const> indices,
+                         const Value& update) {
+  if (indices.empty()) {
+    return update;
+  }
+  uint64_t index = BitsToBoundedUint64(*indices.front(), array.size());
+  if (index >= array.size()) {
+    return array;
+  }
+  std::vector<Value> elements(array.elements().begin(),
+                              array.elements().end());
+  elements[index] =
+      UpdateArrayElement(elements[index], indices.subspan(1), update);
+  return Value::ArrayOwned(std::move(elements));
+}
+
+// Returns the OR of the given values, which must all be of the given type.
+Value DeepOr(Type* type, absl::Span<const Value* const> inputs) {
+  if (type->IsBits()) {
+    Bits result(type->AsBitsOrDie()->bit_count());
+    for (const Value* input : inputs) {
+      result = bits_ops::Or(result, input->bits());
+    }
+    return Value(std::move(result));
+  }
+  if (type->IsToken()) {
+    return Value::Token();
+  }
+  auto element_or = [&](Type* element_type, int64_t i) {
+    absl::InlinedVector<const Value*, 4> elements;
+    for (const Value* input : inputs) {
+      elements.push_back(&input->element(i));
+    }
+    return DeepOr(element_type, elements);
+  };
+  std::vector<Value> elements;
+  if (type->IsArray()) {
+    ArrayType* array_type = type->AsArrayOrDie();
+    for (int64_t i = 0; i < array_type->size(); ++i) {
+      elements.push_back(element_or(array_type->element_type(), i));
+    }
+    return Value::ArrayOwned(std::move(elements));
+  }
+  TupleType* tuple_type = type->AsTupleOrDie();
+  for (int64_t i = 0; i < tuple_type->size(); ++i) {
+    elements.push_back(element_or(tuple_type->element_type(i), i));
+  }
+  return Value::TupleOwned(std::move(elements));
+}
+
+}  // namespace
+
+/* static */ absl::StatusOr<std::unique_ptr<BytecodeInterpreter>>
+BytecodeInterpreter::Create(Function* function) {
+  auto interpreter = absl::WrapUnique(new BytecodeInterpreter(function));
+  XLS_RETURN_IF_ERROR(interpreter->Compile());
+  return interpreter;
+}
+
+absl::StatusOr<BytecodeInterpreter*> BytecodeInterpreter::GetCallee(
+    Function* callee) {
+  auto it = callees_.find(callee);
+  if (it == callees_.end()) {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<BytecodeInterpreter> interpreter,
+                         Create(callee));
+    it = callees_.insert({callee, std::move(interpreter)}).first;
+  }
+  return it->second.get();
+}
+
+absl::Status BytecodeInterpreter::Compile() {
+  // Only nodes the return value depends on are evaluated, as in IrInterpreter.
+  absl::flat_hash_set<Node*> live;
+  std::vector<Node*> worklist = {function_->return_value()};
+  while (!worklist.empty()) {
+    Node* node = worklist.back();
+    worklist.pop_back();
+    if (live.insert(node).second) {
+      worklist.insert(worklist.end(), node->operands().begin(),
+                      node->operands().end());
+    }
+  }
+
+  absl::flat_hash_map<Node*, int64_t> slots;
+  std::vector<Node*> literals;
+  std::vector<int64_t> token_slots;
+  for (Node* node : TopoSort(function_)) {
+    if (!live.contains(node)) {
+      continue;
+    }
+    int64_t slot = slots.size();
+    slots[node] = slot;
+
+    // Literals and after_alls need no evaluation; their slots are bound below.
+    if (node->Is<Literal>()) {
+      literals.push_back(node);
+      continue;
+    }
+    if (node->Is<AfterAll>() || node->Is<Assert>()) {
+      token_slots.push_back(slot);
+      if (node->Is<AfterAll>()) {
+        continue;
+      }
+    }
+
+    Instruction instruction;
+    instruction.op = node->op();
+    instruction.node = node;
+    instruction.result = slot;
+    for (Node* operand : node->operands()) {
+      instruction.operands.push_back(slots.at(operand));
+    }
+    auto set_callee = [&](Function* callee) -> absl::Status {
+      XLS_ASSIGN_OR_RETURN(instruction.callee, GetCallee(callee));
+      instruction.callee_args.resize(callee->params().size());
+      return absl::OkStatus();
+    };
+
+    switch (node->op()) {
+      case Op::kParam: {
+        XLS_ASSIGN_OR_RETURN(instruction.immediate,
+                             function_->GetParamIndex(node->As<Param>()));
+        break;
+      }
+      case Op::kTupleIndex:
+        instruction.immediate = node->As<TupleIndex>()->index();
+        break;
+      case Op::kInvoke:
+        XLS_RETURN_IF_ERROR(set_callee(node->As<Invoke>()->to_apply()));
+        break;
+      case Op::kMap:
+        XLS_RETURN_IF_ERROR(set_callee(node->As<Map>()->to_apply()));
+        break;
+      case Op::kCountedFor:
+        XLS_RETURN_IF_ERROR(set_callee(node->As<CountedFor>()->body()));
+        break;
+      case Op::kDynamicCountedFor:
+        XLS_RETURN_IF_ERROR(
+            set_callee(node->As<DynamicCountedFor>()->body()));
+        break;
+      case Op::kIdentity:
+      case Op::kSel:
+      case Op::kOneHotSel:
+      case Op::kTuple:
+      case Op::kArray:
+      case Op::kArrayIndex:
+      case Op::kArrayUpdate:
+      case Op::kArrayConcat:
+      case Op::kAssert:
+        break;
+      case Op::kReceive:
+      case Op::kReceiveIf:
+      case Op::kSend:
+      case Op::kSendIf:
+        return absl::UnimplementedError(
+            absl::StrFormat("Channel operations are not supported by "
+                            "BytecodeInterpreter: %s",
+                            node->ToString()));
+      default: {
+        bool all_bits = node->GetType()->IsBits();
+        for (Node* operand : node->operands()) {
+          all_bits = all_bits && operand->GetType()->IsBits();
+        }
+        if (!all_bits) {
+          return absl::UnimplementedError(absl::StrFormat(
+              "Interpreter does not support operation '%s' with "
+              "non-bits type operand",
+              OpToString(node->op())));
+        }
+        break;
+      }
+    }
+    instructions_.push_back(std::move(instruction));
+  }
+  return_slot_ = slots.at(function_->return_value());
+
+  // results_ is never resized after this, so pointers into it are stable.
+  results_.resize(slots.size());
+  values_.resize(slots.size());
+  for (int64_t i = 0; i < slots.size(); ++i) {
+    values_[i] = &results_[i];
+  }
+  for (Node* literal : literals) {
+    values_[slots.at(literal)] = &literal->As<Literal>()->value();
+  }
+  for (int64_t slot : token_slots) {
+    results_[slot] = Value::Token();
+  }
+  return absl::OkStatus();
+}
+
+std::string BytecodeInterpreter::ToString() const {
+  std::string result;
+  for (const Instruction& instruction : instructions_) {
+    absl::StrAppendFormat(
+        &result, "%%%d = %s(%s)  // %s\n", instruction.result,
+        OpToString(instruction.op),
+        absl::StrJoin(instruction.operands, ", ",
+                      [](std::string* out, int64_t slot) {
+                        absl::StrAppendFormat(out, "%%%d", slot);
+                      }),
+        instruction.node->GetName());
+  }
+  absl::StrAppendFormat(&result, "ret %%%d\n", return_slot_);
+  return result;
+}
+
+absl::StatusOr<Value> BytecodeInterpreter::Run(absl::Span<const Value> args) {
+  if (args.size() != function_->params().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Function %s wants %d arguments, got %d.", function_->name(),
+        function_->params().size(), args.size()));
+  }
+  for (int64_t argno = 0; argno < args.size(); ++argno) {
+    Type* param_type = function_->param(argno)->GetType();
+    if (function_->package()->GetTypeForValue(args[argno]) != param_type) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Got argument %s for parameter %d which is not of type %s",
+          args[argno].ToString(), argno, param_type->ToString()));
+    }
+  }
+  for (Instruction& instruction : instructions_) {
+    XLS_RETURN_IF_ERROR(Execute(instruction, args));
+  }
+  return *values_[return_slot_];
+}
+
+absl::StatusOr<Value> BytecodeInterpreter::RunKwargs(
+    const absl::flat_hash_map<std::string, Value>& args) {
+  XLS_ASSIGN_OR_RETURN(std::vector<Value> positional_args,
+                       KeywordArgsToPositional(*function_, args));
+  return Run(positional_args);
+}
+
+absl::Status BytecodeInterpreter::Execute(Instruction& instruction,
+                                          absl::Span<const Value> args) {
+  int64_t result = instruction.result;
+  switch (instruction.op) {
+    case Op::kParam:
+      values_[result] = &args[instruction.immediate];
+      return absl::OkStatus();
+    case Op::kIdentity:
+      values_[result] = &Operand(instruction, 0);
+      return absl::OkStatus();
+    case Op::kTupleIndex:
+      values_[result] = &Operand(instruction, 0).element(instruction.immediate);
+      return absl::OkStatus();
+    case Op::kArrayIndex: {
+      // Out-of-bounds indices are clamped to the last element.
+      const Value* element = &Operand(instruction, 0);
+      for (int64_t i = 1; i < instruction.operands.size(); ++i) {
+        element = &element->element(BitsToBoundedUint64(
+            Operand(instruction, i).bits(), element->size() - 1));
+      }
+      values_[result] = element;
+      return absl::OkStatus();
+    }
+    case Op::kSel: {
+      Select* sel = instruction.node->As<Select>();
+      uint64_t index = BitsToBoundedUint64(Operand(instruction, 0).bits(),
+                                           sel->cases().size());
+      if (index >= sel->cases().size()) {
+        XLS_RET_CHECK(sel->default_value().has_value());
+        values_[result] = values_[instruction.operands.back()];
+      } else {
+        values_[result] = values_[instruction.operands[index + 1]];
+      }
+      return absl::OkStatus();
+    }
+    case Op::kAssert:
+      if (!Operand(instruction, 1).bits().IsAllOnes()) {
+        return absl::AbortedError(instruction.node->As<Assert>()->message());
+      }
+      return absl::OkStatus();
+    case Op::kTuple: {
+      std::vector<Value> elements;
+      elements.reserve(instruction.operands.size());
+      for (int64_t slot : instruction.operands) {
+        elements.push_back(*values_[slot]);
+      }
+      results_[result] = Value::TupleOwned(std::move(elements));
+      return absl::OkStatus();
+    }
+    case Op::kArray: {
+      std::vector<Value> elements;
+      elements.reserve(instruction.operands.size());
+      for (int64_t slot : instruction.operands) {
+        elements.push_back(*values_[slot]);
+      }
+      results_[result] = Value::ArrayOwned(std::move(elements));
+      return absl::OkStatus();
+    }
+    case Op::kArrayConcat: {
+      std::vector<Value> elements;
+      for (int64_t slot : instruction.operands) {
+        elements.insert(elements.end(), values_[slot]->elements().begin(),
+                        values_[slot]->elements().end());
+      }
+      results_[result] = Value::ArrayOwned(std::move(elements));
+      return absl::OkStatus();
+    }
+    case Op::kArrayUpdate: {
+      absl::InlinedVector<const Bits*, 2> indices;
+      for (int64_t i = 2; i < instruction.operands.size(); ++i) {
+        indices.push_back(&Operand(instruction, i).bits());
+      }
+      results_[result] = UpdateArrayElement(Operand(instruction, 0), indices,
+                                            Operand(instruction, 1));
+      return absl::OkStatus();
+    }
+    case Op::kOneHotSel: {
+      const Bits& selector = Operand(instruction, 0).bits();
+      absl::InlinedVector<const Value*, 4> selected;
+      for (int64_t i = 0; i < selector.bit_count(); ++i) {
+        if (selector.Get(i)) {
+          selected.push_back(&Operand(instruction, i + 1));
+        }
+      }
+      results_[result] = DeepOr(instruction.node->GetType(), selected);
+      return absl::OkStatus();
+    }
+    case Op::kInvoke: {
+      for (int64_t i = 0; i < instruction.operands.size(); ++i) {
+        instruction.callee_args[i] = Operand(instruction, i);
+      }
+      XLS_ASSIGN_OR_RETURN(results_[result],
+                           instruction.callee->Run(instruction.callee_args));
+      return absl::OkStatus();
+    }
+    case Op::kMap: {
+      const Value& input = Operand(instruction, 0);
+      std::vector<Value> elements;
+      elements.reserve(input.size());
+      for (const Value& element : input.elements()) {
+        instruction.callee_args[0] = element;
+        XLS_ASSIGN_OR_RETURN(Value mapped,
+                             instruction.callee->Run(instruction.callee_args));
+        elements.push_back(std::move(mapped));
+      }
+      results_[result] = Value::ArrayOwned(std::move(elements));
+      return absl::OkStatus();
+    }
+    case Op::kCountedFor:
+      return ExecuteCountedFor(instruction);
+    case Op::kDynamicCountedFor:
+      return ExecuteDynamicCountedFor(instruction);
+    default: {
+      absl::InlinedVector<Bits, 3> operands;
+      for (int64_t slot : instruction.operands) {
+        operands.push_back(values_[slot]->bits());
+      }
+      XLS_ASSIGN_OR_RETURN(Bits bits,
+                           EvaluateBitsNode(instruction.node, operands));
+      results_[result] = Value(std::move(bits));
+      return absl::OkStatus();
+    }
+  }
+}
+
+absl::Status BytecodeInterpreter::ExecuteCountedFor(Instruction& instruction) {
+  CountedFor* counted_for = instruction.node->As<CountedFor>();
+  std::vector<Value>& body_args = instruction.callee_args;
+  // The first two parameters of the body are the induction variable and the
+  // loop state; the invariant operands feed the rest.
+  body_args[1] = Operand(instruction, 0);
+  for (int64_t i = 1; i < instruction.operands.size(); ++i) {
+    body_args[i + 1] = Operand(instruction, i);
+  }
+  int64_t index_width = counted_for->body()->param(0)->BitCountOrDie();
+  for (int64_t i = 0, iv = 0; i < counted_for->trip_count();
+       ++i, iv += counted_for->stride()) {
+    body_args[0] = Value(UBits(iv, index_width));
+    XLS_ASSIGN_OR_RETURN(body_args[1], instruction.callee->Run(body_args));
+  }
+  results_[instruction.result] = body_args[1];
+  return absl::OkStatus();
+}
+
+absl::Status BytecodeInterpreter::ExecuteDynamicCountedFor(
+    Instruction& instruction) {
+  DynamicCountedFor* loop = instruction.node->As<DynamicCountedFor>();
+  std::vector<Value>& body_args = instruction.callee_args;
+  body_args[1] = Operand(instruction, 0);
+  for (int64_t i = 3; i < instruction.operands.size(); ++i) {
+    body_args[i - 1] = Operand(instruction, i);
+  }
+
+  const Bits& trip_count_unsigned = Operand(instruction, 1).bits();
+  Bits trip_count = bits_ops::ZeroExtend(trip_count_unsigned,
+                                         trip_count_unsigned.bit_count() + 1);
+  const Bits& stride = Operand(instruction, 2).bits();
+  Bits index_limit = bits_ops::SMul(trip_count, stride);
+  Bits index(loop->body()->param(0)->BitCountOrDie());
+  Bits extended_stride = bits_ops::SignExtend(stride, index.bit_count());
+  while (!bits_ops::SEqual(index, index_limit)) {
+    body_args[0] = Value(index);
+    XLS_ASSIGN_OR_RETURN(body_args[1], instruction.callee->Run(body_args));
+    index = bits_ops::Add(index, extended_stride);
+  }
+  results_[instruction.result] = body_args[1];
+  return absl::OkStatus();
+}
+
+}  // namespace xls
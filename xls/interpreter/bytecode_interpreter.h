@@ -0,0 +1,109 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
+#define XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+// An interpreter for functions which are evaluated many times. On creation,
+// the function is compiled into a flat, topologically ordered sequence of
+// instructions whose operands and results are indices into an array of value
+// slots; Run() is then a single loop over that sequence. Compared with
+// IrInterpreter, which walks the node graph with a visitor and stores results
+// in a hash map on every evaluation, there is no graph traversal, no virtual
+// dispatch, and no hashing per node.
+//
+// Literals are bound to their slots at compile time, and nodes whose value is
+// (part of) another value - params, identities, selects, tuple and array
+// indices - refer to that value rather than copying it.
+//
+// Results are identical to those of IrInterpreter. Channel operations are not
+// supported.
+class BytecodeInterpreter {
+ public:
+  static absl::StatusOr<std::unique_ptr<BytecodeInterpreter>> Create(
+      Function* function);
+
+  // Evaluates the function with the given positional arguments. Not
+  // thread-safe: concurrent callers need separate interpreters.
+  absl::StatusOr<Value> Run(absl::Span<const Value> args);
+
+  // Evaluates the function with arguments given by name.
+  absl::StatusOr<Value> RunKwargs(
+      const absl::flat_hash_map<std::string, Value>& args);
+
+  Function* function() const { return function_; }
+
+  // Returns a listing of the compiled instructions, one per line.
+  std::string ToString() const;
+
+ private:
+  struct Instruction {
+    Op op;
+    Node* node;
+    // The slot receiving the result.
+    int64_t result;
+    // The slots holding the operands.
+    absl::InlinedVector<int64_t, 3> operands;
+    // The parameter number of a param or the element index of a tuple_index.
+    int64_t immediate = 0;
+    // The interpreter for the function applied by this instruction, if any,
+    // along with space for the arguments passed to it.
+    BytecodeInterpreter* callee = nullptr;
+    std::vector<Value> callee_args;
+  };
+
+  explicit BytecodeInterpreter(Function* function) : function_(function) {}
+
+  absl::Status Compile();
+  absl::StatusOr<BytecodeInterpreter*> GetCallee(Function* callee);
+
+  absl::Status Execute(Instruction& instruction, absl::Span<const Value> args);
+  absl::Status ExecuteCountedFor(Instruction& instruction);
+  absl::Status ExecuteDynamicCountedFor(Instruction& instruction);
+
+  const Value& Operand(const Instruction& instruction, int64_t i) const {
+    return *values_[instruction.operands[i]];
+  }
+
+  Function* function_;
+  std::vector<Instruction> instructions_;
+  int64_t return_slot_;
+
+  // The value of each slot. Points into results_, at an argument, at a
+  // literal, or into another slot's value.
+  std::vector<const Value*> values_;
+  // Storage for values computed by instructions, indexed by slot.
+  std::vector<Value> results_;
+
+  absl::flat_hash_map<Function*, std::unique_ptr<BytecodeInterpreter>>
+      callees_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
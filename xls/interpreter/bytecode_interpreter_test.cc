@@ -0,0 +1,111 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/bytecode_interpreter.h"
+
+#include <algorithm>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_evaluator_test.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+INSTANTIATE_TEST_SUITE_P(
+    BytecodeInterpreterTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function,
+           const std::vector<Value>& args) -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(auto interpreter,
+                               BytecodeInterpreter::Create(function));
+          return interpreter->Run(args);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs)
+            -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(auto interpreter,
+                               BytecodeInterpreter::Create(function));
+          return interpreter->RunKwargs(kwargs);
+        })));
+
+// A compiled function can be run repeatedly, and matches IrInterpreter on
+// every run.
+TEST(BytecodeInterpreterTest, ReuseMatchesIrInterpreter) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn body(i: bits[8], acc: (bits[8], bits[8][2]), k: bits[8])
+      -> (bits[8], bits[8][2]) {
+    acc0: bits[8] = tuple_index(acc, index=0)
+    acc1: bits[8][2] = tuple_index(acc, index=1)
+    prod: bits[8] = umul(acc0, k)
+    sum: bits[8] = add(prod, i)
+    one: bits[1] = literal(value=1)
+    new_acc1: bits[8][2] = array_update(acc1, sum, indices=[one])
+    ret result: (bits[8], bits[8][2]) = tuple(sum, new_acc1)
+  }
+
+  fn f(x: bits[8], k: bits[8]) -> (bits[8], bits[8][2]) {
+    zero: bits[8] = literal(value=0)
+    arr: bits[8][2] = array(x, zero)
+    init: (bits[8], bits[8][2]) = tuple(x, arr)
+    ret loop: (bits[8], bits[8][2]) = counted_for(init, trip_count=5,
+        stride=2, body=body, invariant_args=[k])
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, p->GetFunction("f"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           BytecodeInterpreter::Create(function));
+  for (int64_t x = 0; x < 256; x += 17) {
+    std::vector<Value> args = {Value(UBits(x, 8)), Value(UBits(x / 3, 8))};
+    XLS_ASSERT_OK_AND_ASSIGN(Value expected,
+                             IrInterpreter::Run(function, args));
+    EXPECT_THAT(interpreter->Run(args), IsOkAndHolds(expected));
+  }
+}
+
+TEST(BytecodeInterpreterTest, ToString) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: bits[8], y: bits[8]) -> bits[8] {
+    one: bits[8] = literal(value=1)
+    unused: bits[8] = sub(x, y)
+    sum: bits[8] = add(x, y)
+    ret result: bits[8] = add(sum, one)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           BytecodeInterpreter::Create(function));
+  // Dead nodes are dropped and literals need no instruction, leaving the two
+  // params, the two adds and the return.
+  std::string listing = interpreter->ToString();
+  EXPECT_THAT(listing, Not(HasSubstr("unused")));
+  EXPECT_THAT(listing, HasSubstr("= add(%"));
+  EXPECT_EQ(std::count(listing.begin(), listing.end(), '\n'), 5);
+}
+
+}  // namespace
+}  // namespace xls
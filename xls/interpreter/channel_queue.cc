@@ -14,6 +14,8 @@
 
 #include "xls/interpreter/channel_queue.h"
 
+#include <algorithm>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
@@ -33,9 +35,22 @@ absl::Status ChannelQueue::Enqueue(const Value& value) {
         channel_->type()->ToString(), value.ToString()));
   }
 
-  absl::MutexLock lock(&mutex_);
-  queue_.push_back(value);
-  XLS_VLOG(4) << absl::StreamFormat("Channel now has %d elements", size());
+  {
+    absl::MutexLock lock(&mutex_);
+    if (queue_.size() >= capacity_) {
+      return absl::ResourceExhaustedError(absl::StrFormat(
+          "Attempting to enqueue data on full channel %s (%d) of capacity %d",
+          channel_->name(), channel_->id(), capacity_));
+    }
+    queue_.push_back(value);
+    high_water_mark_ =
+        std::max(high_water_mark_, static_cast<int64_t>(queue_.size()));
+    XLS_VLOG(4) << absl::StreamFormat("Channel now has %d elements",
+                                      queue_.size());
+  }
+  if (enqueue_callback_) {
+    enqueue_callback_();
+  }
   return absl::OkStatus();
 }
 
@@ -45,15 +60,46 @@ absl::StatusOr<Value> ChannelQueue::Dequeue() {
         absl::StrFormat("Attempting to dequeue data from empty channel %s (%d)",
                         channel_->name(), channel_->id()));
   }
-  absl::MutexLock lock(&mutex_);
-  Value value = queue_.front();
-  queue_.pop_front();
+  Value value;
+  {
+    absl::MutexLock lock(&mutex_);
+    value = queue_.front();
+    queue_.pop_front();
+  }
+  if (dequeue_callback_) {
+    dequeue_callback_();
+  }
   XLS_VLOG(4) << absl::StreamFormat("Dequeuing data on channel %s: %s",
                                     channel_->name(), value.ToString());
   XLS_VLOG(4) << absl::StreamFormat("Channel now has %d elements", size());
   return std::move(value);
 }
 
+std::vector<Value> ChannelQueue::GetContents() const {
+  absl::MutexLock lock(&mutex_);
+  return std::vector<Value>(queue_.begin(), queue_.end());
+}
+
+absl::Status ChannelQueue::SetContents(absl::Span<const Value> values) {
+  for (const Value& value : values) {
+    if (!ValueConformsToType(value, channel_->type())) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Channel %s expects values to have type %s, got: %s",
+          channel_->name(), channel_->type()->ToString(), value.ToString()));
+    }
+  }
+  absl::MutexLock lock(&mutex_);
+  if (values.size() > capacity_) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Cannot hold %d values in channel %s (%d) of capacity %d",
+        values.size(), channel_->name(), channel_->id(), capacity_));
+  }
+  queue_.assign(values.begin(), values.end());
+  high_water_mark_ =
+      std::max(high_water_mark_, static_cast<int64_t>(queue_.size()));
+  return absl::OkStatus();
+}
+
 absl::Status RxOnlyChannelQueue::Enqueue(const Value& value) {
   return absl::UnimplementedError(
       absl::StrFormat("Cannot enqueue to RxOnlyChannelQueue on channel %s.",
@@ -78,6 +124,49 @@ absl::StatusOr<Value> FixedRxOnlyChannelQueue::GenerateValue() {
   return std::move(value);
 }
 
+absl::Status CdcChannelQueue::Enqueue(const Value& value) {
+  if (!ValueConformsToType(value, channel()->type())) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Channel %s expects values to have type %s, got: %s", channel()->name(),
+        channel()->type()->ToString(), value.ToString()));
+  }
+  if (full()) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Attempting to enqueue data on full clock domain crossing channel %s "
+        "(%d) of depth %d",
+        channel()->name(), channel()->id(), depth_));
+  }
+  XLS_VLOG(4) << absl::StreamFormat(
+      "Enqueuing value on clock domain crossing channel %s at time %d: { %s }",
+      channel()->name(), now_, value.ToString());
+  pending_values_.push_back({SynchronizedTime(now_, receive_period_), value});
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> CdcChannelQueue::Dequeue() {
+  XLS_ASSIGN_OR_RETURN(Value value, ChannelQueue::Dequeue());
+  pending_frees_.push_back(SynchronizedTime(now_, send_period_));
+  return std::move(value);
+}
+
+bool CdcChannelQueue::full() const {
+  return size() + pending_values_.size() + pending_frees_.size() >= depth_;
+}
+
+absl::Status CdcChannelQueue::AdvanceTime(int64_t now) {
+  XLS_RET_CHECK_GE(now, now_);
+  now_ = now;
+  while (!pending_values_.empty() && pending_values_.front().first <= now_) {
+    XLS_RETURN_IF_ERROR(
+        ChannelQueue::Enqueue(std::move(pending_values_.front().second)));
+    pending_values_.pop_front();
+  }
+  while (!pending_frees_.empty() && pending_frees_.front() <= now_) {
+    pending_frees_.pop_front();
+  }
+  return absl::OkStatus();
+}
+
 /* static */
 absl::StatusOr<std::unique_ptr<ChannelQueueManager>>
 ChannelQueueManager::Create(
@@ -133,6 +222,12 @@ ChannelQueueManager::Create(
   return std::move(manager);
 }
 
+void ChannelQueueManager::ReplaceQueue(std::unique_ptr<ChannelQueue> queue) {
+  std::unique_ptr<ChannelQueue>& entry = queues_.at(queue->channel());
+  std::replace(queue_vec_.begin(), queue_vec_.end(), entry.get(), queue.get());
+  entry = std::move(queue);
+}
+
 absl::StatusOr<ChannelQueue*> ChannelQueueManager::GetQueueById(
     int64_t channel_id) {
   XLS_ASSIGN_OR_RETURN(Channel * channel, package_->GetChannel(channel_id));
@@ -17,22 +17,29 @@
 
 #include <deque>
 #include <functional>
+#include <limits>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/common/logging/logging.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/package.h"
 #include "xls/ir/value.h"
 
 namespace xls {
 
-// A queue (arbitrary depth-FIFO) backing a particular channel during
-// interpretation. During interpretation of a network of procs each channel is
-// backed by exactly one ChannelQueue. ChannelQueues are thread-compatible, but
-// not thread-safe.
+// A queue (FIFO of configurable, by default unbounded, depth) backing a
+// particular channel during interpretation. During interpretation of a network
+// of procs each channel is backed by exactly one ChannelQueue. ChannelQueues
+// are thread-compatible, but not thread-safe.
 class ChannelQueue {
  public:
+  // Capacity of a queue which may grow without bound.
+  static constexpr int64_t kUnboundedCapacity =
+      std::numeric_limits<int64_t>::max();
+
   ChannelQueue(Channel* channel, Package* package)
       : channel_(channel), package_(package) {}
 
@@ -60,13 +67,80 @@ class ChannelQueue {
     return queue_.empty();
   }
 
-  // Enqueues the given value on to the channel.
+  // Returns whether the channel queue holds as many elements as its capacity.
+  // A proc sending on a full queue blocks until the receiver dequeues.
+  virtual bool full() const {
+    absl::MutexLock lock(&mutex_);
+    return queue_.size() >= capacity_;
+  }
+
+  // Sets the maximum number of elements the queue may hold, e.g., the depth of
+  // the FIFO generated for the channel.
+  void set_capacity(int64_t capacity) {
+    XLS_CHECK_GE(capacity, 1);
+    absl::MutexLock lock(&mutex_);
+    capacity_ = capacity;
+  }
+  int64_t capacity() const {
+    absl::MutexLock lock(&mutex_);
+    return capacity_;
+  }
+
+  // Enqueues the given value on to the channel. Returns an error if the queue
+  // is full.
   virtual absl::Status Enqueue(const Value& value);
 
+  // Sets a function which is called after each value is enqueued on to the
+  // channel, e.g., to wake up procs blocked receiving on it. Replaces any
+  // previously set callback.
+  void SetEnqueueCallback(std::function<void()> callback) {
+    enqueue_callback_ = std::move(callback);
+  }
+
+  // As SetEnqueueCallback, but called after each value is dequeued, e.g., to
+  // wake up procs blocked sending on a full queue.
+  void SetDequeueCallback(std::function<void()> callback) {
+    dequeue_callback_ = std::move(callback);
+  }
+
+  // Occupancy statistics for sizing FIFOs. The high-water mark is the largest
+  // number of elements the queue has held. The stall counts are the number of
+  // times a proc found the queue full when sending or empty when receiving and
+  // had to block.
+  int64_t high_water_mark() const {
+    absl::MutexLock lock(&mutex_);
+    return high_water_mark_;
+  }
+  int64_t send_stall_count() const {
+    absl::MutexLock lock(&mutex_);
+    return send_stall_count_;
+  }
+  int64_t receive_stall_count() const {
+    absl::MutexLock lock(&mutex_);
+    return receive_stall_count_;
+  }
+  void RecordSendStall() {
+    absl::MutexLock lock(&mutex_);
+    ++send_stall_count_;
+  }
+  void RecordReceiveStall() {
+    absl::MutexLock lock(&mutex_);
+    ++receive_stall_count_;
+  }
+
   // Dequeues and returns a value from the channel. Returns an error if the
   // channel is empty.
   virtual absl::StatusOr<Value> Dequeue();
 
+  // Returns the values in the queue from front to back, e.g., to checkpoint a
+  // simulation.
+  std::vector<Value> GetContents() const;
+
+  // Replaces the contents of the queue with the given values, front to back,
+  // e.g., to restore a checkpointed simulation. Neither the enqueue nor the
+  // dequeue callback is called.
+  absl::Status SetContents(absl::Span<const Value> values);
+
  private:
   Channel* channel_;
   Package* package_;
@@ -74,7 +148,15 @@ class ChannelQueue {
   // Values are enqueued to the back, and dequeued from the front.
   std::deque<Value> queue_ ABSL_GUARDED_BY(mutex_);
 
+  int64_t capacity_ ABSL_GUARDED_BY(mutex_) = kUnboundedCapacity;
+  int64_t high_water_mark_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t send_stall_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t receive_stall_count_ ABSL_GUARDED_BY(mutex_) = 0;
+
   mutable absl::Mutex mutex_;
+
+  std::function<void()> enqueue_callback_;
+  std::function<void()> dequeue_callback_;
 };
 
 // A queue backing a receive-only channel. Receive-only channels provide inputs
@@ -102,6 +184,7 @@ class RxOnlyChannelQueue : public ChannelQueue {
   // be called an arbitrary number of times.
   int64_t size() const override { return std::numeric_limits<int64_t>::max(); }
   bool empty() const override { return false; }
+  bool full() const override { return false; }
 
  private:
   std::function<absl::StatusOr<Value>()> generator_func_;
@@ -129,6 +212,59 @@ class FixedRxOnlyChannelQueue : public RxOnlyChannelQueue {
   std::deque<Value> values_;
 };
 
+// A queue backing a channel between procs of different clock domains, modeling
+// the asynchronous FIFO implementing the channel in hardware. A value enqueued
+// at time t only becomes visible to the receiver at the
+// 'synchronizer_stages'-th edge of the receiving clock after t, and the entry
+// of a dequeued value only becomes free for the sender at the
+// 'synchronizer_stages'-th edge of the sending clock after the dequeue. The
+// queue is full when values in flight, visible values and entries not yet
+// freed add up to the depth.
+class CdcChannelQueue : public ChannelQueue {
+ public:
+  CdcChannelQueue(Channel* channel, Package* package, int64_t depth,
+                  int64_t send_period, int64_t receive_period,
+                  int64_t synchronizer_stages)
+      : ChannelQueue(channel, package),
+        depth_(depth),
+        send_period_(send_period),
+        receive_period_(receive_period),
+        synchronizer_stages_(synchronizer_stages) {}
+  virtual ~CdcChannelQueue() = default;
+
+  absl::Status Enqueue(const Value& value) override;
+  absl::StatusOr<Value> Dequeue() override;
+  bool full() const override;
+
+  // Advances the current time to 'now', making visible the values and freeing
+  // the entries whose synchronization has completed by then.
+  absl::Status AdvanceTime(int64_t now);
+
+  // Returns whether any value or freed entry is still being synchronized.
+  bool in_flight() const {
+    return !pending_values_.empty() || !pending_frees_.empty();
+  }
+
+ private:
+  // Returns the time of the 'synchronizer_stages_'-th edge after 'time' of a
+  // clock with the given period.
+  int64_t SynchronizedTime(int64_t time, int64_t period) const {
+    return (time / period + synchronizer_stages_) * period;
+  }
+
+  int64_t depth_;
+  int64_t send_period_;
+  int64_t receive_period_;
+  int64_t synchronizer_stages_;
+  int64_t now_ = 0;
+
+  // Values enqueued by the sender, with the times they become visible.
+  std::deque<std::pair<int64_t, Value>> pending_values_;
+
+  // The times the entries of values dequeued by the receiver become free.
+  std::deque<int64_t> pending_frees_;
+};
+
 // An abstraction holding a collection of channel queues for interpreting the
 // procs within a single package. Essentially a map of channel queues with some
 // convenience methods.
@@ -152,6 +288,11 @@ class ChannelQueueManager {
   absl::StatusOr<ChannelQueue*> GetQueueById(int64_t channel_id);
   absl::StatusOr<ChannelQueue*> GetQueueByName(absl::string_view name);
 
+  // Replaces the queue of the channel of the given queue, e.g., with a queue
+  // modeling the hardware implementing the channel. Any values of the replaced
+  // queue are dropped.
+  void ReplaceQueue(std::unique_ptr<ChannelQueue> queue);
+
  private:
   explicit ChannelQueueManager(Package* package) : package_(package) {}
 
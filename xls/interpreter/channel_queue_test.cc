@@ -28,6 +28,7 @@ namespace {
 
 using status_testing::IsOkAndHolds;
 using status_testing::StatusIs;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 
 class ChannelQueueTest : public IrTestBase {};
@@ -60,6 +61,91 @@ TEST_F(ChannelQueueTest, SingleDataElementEnqueueDequeue) {
   EXPECT_TRUE(queue.empty());
 }
 
+TEST_F(ChannelQueueTest, EnqueueCallback) {
+  Package package(TestName());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package.CreateStreamingChannel("my_channel", ChannelOps::kSendReceive,
+                                     package.GetBitsType(32)));
+  ChannelQueue queue(channel, &package);
+  int64_t callback_count = 0;
+  queue.SetEnqueueCallback([&]() {
+    ++callback_count;
+    EXPECT_FALSE(queue.empty());
+  });
+
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(42, 32))));
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(123, 32))));
+  EXPECT_EQ(callback_count, 2);
+
+  XLS_ASSERT_OK(queue.Dequeue().status());
+  EXPECT_EQ(callback_count, 2);
+
+  // Values which fail to enqueue do not invoke the callback.
+  EXPECT_FALSE(queue.Enqueue(Value(UBits(1, 8))).ok());
+  EXPECT_EQ(callback_count, 2);
+}
+
+TEST_F(ChannelQueueTest, BoundedCapacity) {
+  Package package(TestName());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package.CreateStreamingChannel("my_channel", ChannelOps::kSendReceive,
+                                     package.GetBitsType(32)));
+  ChannelQueue queue(channel, &package);
+  EXPECT_EQ(queue.capacity(), ChannelQueue::kUnboundedCapacity);
+  queue.set_capacity(2);
+  EXPECT_EQ(queue.capacity(), 2);
+
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(1, 32))));
+  EXPECT_FALSE(queue.full());
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(2, 32))));
+  EXPECT_TRUE(queue.full());
+  EXPECT_THAT(queue.Enqueue(Value(UBits(3, 32))),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("full channel my_channel")));
+  EXPECT_EQ(queue.size(), 2);
+
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(1, 32))));
+  EXPECT_FALSE(queue.full());
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(3, 32))));
+  EXPECT_EQ(queue.high_water_mark(), 2);
+
+  EXPECT_EQ(queue.send_stall_count(), 0);
+  queue.RecordSendStall();
+  queue.RecordReceiveStall();
+  queue.RecordReceiveStall();
+  EXPECT_EQ(queue.send_stall_count(), 1);
+  EXPECT_EQ(queue.receive_stall_count(), 2);
+}
+
+TEST_F(ChannelQueueTest, GetAndSetContents) {
+  Package package(TestName());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package.CreateStreamingChannel("my_channel", ChannelOps::kSendReceive,
+                                     package.GetBitsType(32)));
+  ChannelQueue queue(channel, &package);
+  int64_t callback_count = 0;
+  queue.SetEnqueueCallback([&]() { ++callback_count; });
+  XLS_ASSERT_OK(queue.Enqueue(Value(UBits(1, 32))));
+  EXPECT_THAT(queue.GetContents(), ElementsAre(Value(UBits(1, 32))));
+
+  XLS_ASSERT_OK(queue.SetContents({Value(UBits(2, 32)), Value(UBits(3, 32))}));
+  EXPECT_EQ(callback_count, 1);
+  EXPECT_THAT(queue.GetContents(),
+              ElementsAre(Value(UBits(2, 32)), Value(UBits(3, 32))));
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(2, 32))));
+
+  EXPECT_THAT(queue.SetContents({Value(UBits(2, 8))}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("expects values to have type bits[32]")));
+  queue.set_capacity(1);
+  EXPECT_THAT(queue.SetContents({Value(UBits(2, 32)), Value(UBits(3, 32))}),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_THAT(queue.GetContents(), ElementsAre(Value(UBits(3, 32))));
+}
+
 TEST_F(ChannelQueueTest, ErrorConditions) {
   Package package(TestName());
   XLS_ASSERT_OK_AND_ASSIGN(
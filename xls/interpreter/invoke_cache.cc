@@ -0,0 +1,89 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/invoke_cache.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+
+InvokeCache::InvokeCache(int64_t max_entries_per_function)
+    : max_entries_per_function_(max_entries_per_function) {
+  XLS_CHECK_GE(max_entries_per_function, 1);
+}
+
+absl::optional<Value> InvokeCache::Lookup(Function* function,
+                                          const std::vector<Value>& args) {
+  absl::MutexLock lock(&mutex_);
+  FunctionCache& cache = caches_[function];
+  auto it = cache.results.find(args);
+  if (it == cache.results.end()) {
+    ++cache.misses;
+    return absl::nullopt;
+  }
+  ++cache.hits;
+  return it->second;
+}
+
+void InvokeCache::Insert(Function* function, std::vector<Value> args,
+                         Value result) {
+  absl::MutexLock lock(&mutex_);
+  FunctionCache& cache = caches_[function];
+  if (cache.results.size() >= max_entries_per_function_) {
+    cache.results.clear();
+  }
+  cache.results.insert_or_assign(std::move(args), std::move(result));
+}
+
+int64_t InvokeCache::hits() const {
+  absl::MutexLock lock(&mutex_);
+  int64_t hits = 0;
+  for (const auto& [function, cache] : caches_) {
+    hits += cache.hits;
+  }
+  return hits;
+}
+
+int64_t InvokeCache::misses() const {
+  absl::MutexLock lock(&mutex_);
+  int64_t misses = 0;
+  for (const auto& [function, cache] : caches_) {
+    misses += cache.misses;
+  }
+  return misses;
+}
+
+std::string InvokeCache::ToReport() const {
+  absl::MutexLock lock(&mutex_);
+  std::vector<std::pair<std::string, const FunctionCache*>> sorted;
+  for (const auto& [function, cache] : caches_) {
+    sorted.push_back({function->name(), &cache});
+  }
+  std::sort(sorted.begin(), sorted.end());
+  std::string report = "Invoke cache:\n";
+  for (const auto& [name, cache] : sorted) {
+    int64_t lookups = cache->hits + cache->misses;
+    absl::StrAppendFormat(
+        &report, "  %s: %d hits, %d misses (%.1f%% hit rate)\n", name,
+        cache->hits, cache->misses,
+        lookups == 0 ? 0.0 : 100.0 * cache->hits / lookups);
+  }
+  return report;
+}
+
+}  // namespace xls
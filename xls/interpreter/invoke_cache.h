@@ -0,0 +1,78 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_INVOKE_CACHE_H_
+#define XLS_INTERPRETER_INVOKE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+// Memoizes the results of functions invoked by the IR interpreter, keyed by
+// callee and argument values. Functions are pure, so an invoke whose callee
+// has already been evaluated with the same arguments is served from the cache
+// rather than re-interpreted. Evaluations which return an error are not
+// cached.
+//
+// Each callee holds at most "max_entries_per_function" results; inserting
+// into a full table clears it first, so the cache adapts to the arguments
+// seen recently at no bookkeeping cost per hit. May be shared by concurrent
+// interpreters, but must not outlive the functions it holds results of.
+class InvokeCache {
+ public:
+  static constexpr int64_t kDefaultMaxEntriesPerFunction = 4096;
+
+  explicit InvokeCache(
+      int64_t max_entries_per_function = kDefaultMaxEntriesPerFunction);
+
+  // Returns the cached result of "function" applied to "args", and records a
+  // hit or a miss.
+  absl::optional<Value> Lookup(Function* function,
+                               const std::vector<Value>& args);
+
+  // Records the result of applying "function" to "args".
+  void Insert(Function* function, std::vector<Value> args, Value result);
+
+  // Totals over all callees.
+  int64_t hits() const;
+  int64_t misses() const;
+
+  // Returns a report of the hits, misses and hit rate of each callee, e.g.,
+  // for XLS_LOG_LINES'ing.
+  std::string ToReport() const;
+
+ private:
+  struct FunctionCache {
+    absl::flat_hash_map<std::vector<Value>, Value> results;
+    int64_t hits = 0;
+    int64_t misses = 0;
+  };
+
+  int64_t max_entries_per_function_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<Function*, FunctionCache> caches_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_INVOKE_CACHE_H_
@@ -14,6 +14,8 @@
 
 #include "xls/interpreter/ir_evaluator_test.h"
 
+#include <algorithm>
+
 #include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
 #include "xls/common/logging/logging.h"
@@ -1444,6 +1446,70 @@ TEST_P(IrEvaluatorTest, InterpretManyWaySelWithDefault) {
               IsOkAndHolds(u32(0xdefa17)));
 }
 
+// Selects with many arms are lowered differently by the JIT: to a table lookup
+// if the arms are literals, and to a switch otherwise.
+TEST_P(IrEvaluatorTest, InterpretManyWaySelOfLiterals) {
+  Package package("my_package");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           ParseAndGetFunction(&package, R"(
+  fn select(p: bits[8]) -> bits[32] {
+    literal.0: bits[32] = literal(value=100)
+    literal.1: bits[32] = literal(value=101)
+    literal.2: bits[32] = literal(value=102)
+    literal.3: bits[32] = literal(value=103)
+    literal.4: bits[32] = literal(value=104)
+    literal.5: bits[32] = literal(value=105)
+    literal.6: bits[32] = literal(value=106)
+    literal.7: bits[32] = literal(value=107)
+    literal.8: bits[32] = literal(value=108)
+    literal.9: bits[32] = literal(value=109)
+    ret sel.20: bits[32] = sel(p, cases=[literal.0, literal.1, literal.2,
+        literal.3, literal.4, literal.5, literal.6, literal.7, literal.8],
+        default=literal.9)
+  }
+  )"));
+
+  for (int64_t p = 0; p < 256; ++p) {
+    EXPECT_THAT(GetParam().evaluator(function, {Value(UBits(p, 8))}),
+                IsOkAndHolds(Value(UBits(100 + std::min<int64_t>(p, 9), 32))))
+        << p;
+  }
+}
+
+TEST_P(IrEvaluatorTest, InterpretManyWaySelOfComputedValues) {
+  Package package("my_package");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           ParseAndGetFunction(&package, R"(
+  fn select(p: bits[3], x: bits[32]) -> bits[32] {
+    literal.0: bits[32] = literal(value=0)
+    add.10: bits[32] = add(x, literal.0)
+    literal.1: bits[32] = literal(value=1)
+    add.11: bits[32] = add(x, literal.1)
+    literal.2: bits[32] = literal(value=4)
+    add.12: bits[32] = add(x, literal.2)
+    literal.3: bits[32] = literal(value=9)
+    add.13: bits[32] = add(x, literal.3)
+    literal.4: bits[32] = literal(value=16)
+    add.14: bits[32] = add(x, literal.4)
+    literal.5: bits[32] = literal(value=25)
+    add.15: bits[32] = add(x, literal.5)
+    literal.6: bits[32] = literal(value=36)
+    add.16: bits[32] = add(x, literal.6)
+    literal.7: bits[32] = literal(value=49)
+    add.17: bits[32] = add(x, literal.7)
+    ret sel.20: bits[32] = sel(p, cases=[add.10, add.11, add.12, add.13,
+        add.14, add.15, add.16, add.17])
+  }
+  )"));
+
+  for (int64_t p = 0; p < 8; ++p) {
+    EXPECT_THAT(GetParam().evaluator(
+                    function, {Value(UBits(p, 3)), Value(UBits(1000, 32))}),
+                IsOkAndHolds(Value(UBits(1000 + p * p, 32))))
+        << p;
+  }
+}
+
 TEST_P(IrEvaluatorTest, InterpretMap) {
   XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
                            Parser::ParsePackage(R"(
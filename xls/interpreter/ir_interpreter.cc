@@ -14,6 +14,8 @@
 
 #include "xls/interpreter/ir_interpreter.h"
 
+#include <algorithm>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -21,6 +23,7 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread_pool.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/dfs_visitor.h"
@@ -47,7 +50,18 @@ uint64_t BitsToBoundedUint64(const Bits& bits, uint64_t upper_limit) {
 }  // namespace
 
 /* static */ absl::StatusOr<Value> IrInterpreter::Run(
-    Function* function, absl::Span<const Value> args, InterpreterStats* stats) {
+    Function* function, absl::Span<const Value> args, InterpreterStats* stats,
+    InvokeCache* invoke_cache, ThreadPool* pool) {
+  XLS_RETURN_IF_ERROR(CheckArgs(function, args));
+  IrInterpreter visitor(args, stats, invoke_cache, pool);
+  XLS_RETURN_IF_ERROR(function->return_value()->Accept(&visitor));
+  Value result = visitor.ResolveAsValue(function->return_value());
+  XLS_VLOG(2) << "Result = " << result;
+  return std::move(result);
+}
+
+/* static */ absl::Status IrInterpreter::CheckArgs(
+    Function* function, absl::Span<const Value> args) {
   XLS_VLOG(3) << "Interpreting function " << function->name();
   if (args.size() != function->params().size()) {
     return absl::InvalidArgumentError(absl::StrFormat(
@@ -65,11 +79,16 @@ uint64_t BitsToBoundedUint64(const Bits& bits, uint64_t upper_limit) {
           value.ToString(), argno, param_type->ToString()));
     }
   }
-  IrInterpreter visitor(args, stats);
-  XLS_RETURN_IF_ERROR(function->return_value()->Accept(&visitor));
-  Value result = visitor.ResolveAsValue(function->return_value());
-  XLS_VLOG(2) << "Result = " << result;
-  return std::move(result);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> IrInterpreter::Evaluate(Function* function,
+                                              absl::Span<const Value> args) {
+  ResetVisitedState();
+  node_values_.clear();
+  args_.assign(args.begin(), args.end());
+  XLS_RETURN_IF_ERROR(function->return_value()->Accept(this));
+  return ResolveAsValue(function->return_value());
 }
 
 /* static */
@@ -246,17 +265,24 @@ absl::Status IrInterpreter::HandleCountedFor(CountedFor* counted_for) {
   Value loop_state = ResolveAsValue(counted_for->operand(0));
   BitsType* arg0_type = body->param(0)->GetType()->AsBitsOrDie();
   // For each iteration of counted_for, update the induction variable and loop
-  // state arguments (params 0 and 1) and recursively call the interpreter
-  // Run() on the body function -- the new accumulator value is the return
-  // value of interpreting body.
+  // state arguments (params 0 and 1) and evaluate the body function -- the new
+  // accumulator value is the return value of interpreting body. One
+  // interpreter evaluates every iteration, and the arguments are checked
+  // against the body's parameters only on the first.
+  IrInterpreter body_interpreter({}, stats_, invoke_cache_, pool_);
+  std::vector<Value> args_for_body = {Value(), Value()};
+  for (const auto& value : invariant_args) {
+    args_for_body.push_back(value);
+  }
   for (int64_t i = 0, iv = 0; i < counted_for->trip_count();
        ++i, iv += counted_for->stride()) {
-    std::vector<Value> args_for_body = {
-        Value(UBits(iv, arg0_type->bit_count())), loop_state};
-    for (const auto& value : invariant_args) {
-      args_for_body.push_back(value);
+    args_for_body[0] = Value(UBits(iv, arg0_type->bit_count()));
+    args_for_body[1] = std::move(loop_state);
+    if (i == 0) {
+      XLS_RETURN_IF_ERROR(CheckArgs(body, args_for_body));
     }
-    XLS_ASSIGN_OR_RETURN(loop_state, Run(body, args_for_body, stats_));
+    XLS_ASSIGN_OR_RETURN(loop_state,
+                         body_interpreter.Evaluate(body, args_for_body));
   }
   return SetValueResult(counted_for, loop_state);
 }
@@ -298,15 +324,24 @@ absl::Status IrInterpreter::HandleDynamicCountedFor(
   const Bits& extended_stride = bits_ops::SignExtend(stride, index.bit_count());
 
   // For each iteration of dynamic_counted_for, update the induction variable
-  // and loop state arguments (params 0 and 1) and recursively call the
-  // interpreter Run() on the body function -- the new accumulator value is the
-  // return value of interpreting body.
+  // and loop state arguments (params 0 and 1) and evaluate the body function
+  // with one reused interpreter, as for counted_for -- the new accumulator
+  // value is the return value of interpreting body.
+  IrInterpreter body_interpreter({}, stats_, invoke_cache_, pool_);
+  std::vector<Value> args_for_body = {Value(), Value()};
+  for (const auto& value : invariant_args) {
+    args_for_body.push_back(value);
+  }
+  bool first_iteration = true;
   while (!bits_ops::SEqual(index, index_limit)) {
-    std::vector<Value> args_for_body = {Value(index), loop_state};
-    for (const auto& value : invariant_args) {
-      args_for_body.push_back(value);
+    args_for_body[0] = Value(index);
+    args_for_body[1] = std::move(loop_state);
+    if (first_iteration) {
+      XLS_RETURN_IF_ERROR(CheckArgs(body, args_for_body));
+      first_iteration = false;
     }
-    XLS_ASSIGN_OR_RETURN(loop_state, Run(body, args_for_body, stats_));
+    XLS_ASSIGN_OR_RETURN(loop_state,
+                         body_interpreter.Evaluate(body, args_for_body));
 
     index = bits_ops::Add(index, extended_stride);
   }
@@ -416,6 +451,11 @@ absl::Status IrInterpreter::HandleArrayIndex(ArrayIndex* index) {
   for (Node* index_operand : index->indices()) {
     uint64_t idx =
         BitsToBoundedUint64(ResolveAsBits(index_operand), array->size() - 1);
+    if (array->IsPackedArray()) {
+      // The elements of a packed array are bits so this must be the last
+      // index. Slice out the element rather than boxing the whole array.
+      return SetValueResult(index, Value(array->element_bits(idx)));
+    }
     array = &array->element(idx);
   }
   return SetValueResult(index, *array);
@@ -470,7 +510,17 @@ absl::Status IrInterpreter::HandleInvoke(Invoke* invoke) {
   for (int64_t i = 0; i < to_apply->params().size(); ++i) {
     args.push_back(ResolveAsValue(invoke->operand(i)));
   }
-  XLS_ASSIGN_OR_RETURN(Value result, Run(to_apply, args, stats_));
+  if (invoke_cache_ == nullptr) {
+    XLS_ASSIGN_OR_RETURN(Value result, Run(to_apply, args, stats_));
+    return SetValueResult(invoke, result);
+  }
+  absl::optional<Value> cached = invoke_cache_->Lookup(to_apply, args);
+  if (cached.has_value()) {
+    return SetValueResult(invoke, *std::move(cached));
+  }
+  XLS_ASSIGN_OR_RETURN(Value result,
+                       Run(to_apply, args, stats_, invoke_cache_));
+  invoke_cache_->Insert(to_apply, std::move(args), result);
   return SetValueResult(invoke, result);
 }
 
@@ -504,12 +554,33 @@ absl::Status IrInterpreter::HandleULt(CompareOp* lt) {
 
 absl::Status IrInterpreter::HandleMap(Map* map) {
   Function* to_apply = map->to_apply();
-  std::vector<Value> results;
-  for (const Value& operand_element :
-       ResolveAsValue(map->operand(0)).elements()) {
-    XLS_ASSIGN_OR_RETURN(Value result,
-                         Run(to_apply, {operand_element}, stats_));
-    results.push_back(result);
+  absl::Span<const Value> elements =
+      ResolveAsValue(map->operand(0)).elements();
+  std::vector<Value> results(elements.size());
+  if (!elements.empty()) {
+    XLS_RETURN_IF_ERROR(CheckArgs(to_apply, {elements.front()}));
+  }
+  // Elements are independent, so consecutive chunks of them can be evaluated
+  // concurrently, each by one reused interpreter.
+  int64_t chunk_count = 1;
+  if (pool_ != nullptr &&
+      elements.size() * to_apply->node_count() >= kMinParallelMapNodes) {
+    chunk_count =
+        std::min<int64_t>(elements.size(), 4 * pool_->thread_count());
+  }
+  auto evaluate_chunk = [&](int64_t chunk) -> absl::Status {
+    IrInterpreter interpreter({}, stats_, invoke_cache_, pool_);
+    for (int64_t i = chunk * elements.size() / chunk_count;
+         i < (chunk + 1) * elements.size() / chunk_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(results[i],
+                           interpreter.Evaluate(to_apply, {elements[i]}));
+    }
+    return absl::OkStatus();
+  };
+  if (chunk_count == 1) {
+    XLS_RETURN_IF_ERROR(evaluate_chunk(0));
+  } else {
+    XLS_RETURN_IF_ERROR(ParallelFor(0, chunk_count, evaluate_chunk, pool_));
   }
   XLS_ASSIGN_OR_RETURN(Value result_array, Value::Array(results));
   return SetValueResult(map, result_array);
@@ -715,7 +786,7 @@ absl::Status IrInterpreter::SetBitsResult(Node* node, const Bits& result) {
   XLS_RET_CHECK(node->GetType()->IsBits());
   XLS_RET_CHECK_EQ(node->BitCountOrDie(), result.bit_count());
   if (stats_ != nullptr) {
-    stats_->NoteNodeBits(node->ToString(), result);
+    stats_->NoteNodeBits(node, result);
   }
   return SetValueResult(node, Value(result));
 }
@@ -17,24 +17,40 @@
 
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
+#include "xls/interpreter/invoke_cache.h"
 #include "xls/interpreter/ir_interpreter_stats.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/function.h"
 #include "xls/ir/function_builder.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 
+class ThreadPool;
+
 // A visitor for traversing and evaluating a Function.
 class IrInterpreter : public DfsVisitor {
  public:
-  IrInterpreter(absl::Span<const Value> args, InterpreterStats* stats)
-      : stats_(stats), args_(args.begin(), args.end()) {}
+  IrInterpreter(absl::Span<const Value> args, InterpreterStats* stats,
+                InvokeCache* invoke_cache = nullptr,
+                ThreadPool* pool = nullptr)
+      : stats_(stats),
+        invoke_cache_(invoke_cache),
+        pool_(pool),
+        args_(args.begin(), args.end()) {}
 
   // Runs the interpreter on the given function. 'args' are the argument values
-  // indexed by parameter name.
+  // indexed by parameter name. If 'invoke_cache' is given, the results of
+  // invokes (including those in the bodies of loops and maps) are memoized in
+  // it; the nodes of callees served from the cache are not noted in 'stats'.
+  // If 'pool' is given, the elements of large maps are evaluated on it in
+  // parallel; an error is then reported for some failing element rather than
+  // necessarily the first.
   static absl::StatusOr<Value> Run(Function* function,
                                    absl::Span<const Value> args,
-                                   InterpreterStats* stats = nullptr);
+                                   InterpreterStats* stats = nullptr,
+                                   InvokeCache* invoke_cache = nullptr,
+                                   ThreadPool* pool = nullptr);
 
   // Runs the interpreter on the function where the arguments are given by name.
   static absl::StatusOr<Value> RunKwargs(
@@ -119,6 +135,21 @@ class IrInterpreter : public DfsVisitor {
   const Value& ResolveAsValue(Node* node) { return node_values_.at(node); }
 
  protected:
+  // Maps of at least this many elements times callee nodes are evaluated in
+  // parallel when a pool is given; smaller ones aren't worth the scheduling.
+  static constexpr int64_t kMinParallelMapNodes = 4096;
+
+  // Returns an error if 'args' don't match the parameters of 'function'.
+  static absl::Status CheckArgs(Function* function,
+                                absl::Span<const Value> args);
+
+  // Evaluates 'function' on 'args', which must match its parameters, in place
+  // of whatever this interpreter evaluated before. The node storage of the
+  // previous evaluation is reused, so a loop body or map callee evaluated
+  // with one interpreter per loop doesn't reallocate it every iteration.
+  absl::StatusOr<Value> Evaluate(Function* function,
+                                 absl::Span<const Value> args);
+
   // Returns an error if the given node or any of its operands are not Bits
   // types.
   absl::Status VerifyAllBitsTypes(Node* node);
@@ -149,7 +180,7 @@ class IrInterpreter : public DfsVisitor {
 
   // Sets the evaluated value for 'node' to the given Value. 'value' must be
   // passed in by value (ha!) because a use case is passing in a previously
-  // evaluated value and inserting a into flat_hash_map (done below) invalidates
+  // evaluated value and inserting into the NodeMap (done below) may invalidate
   // all references to Values in the map.
   absl::Status SetValueResult(Node* node, Value result);
 
@@ -162,11 +193,17 @@ class IrInterpreter : public DfsVisitor {
   // Statistics on interpreter execution. May be nullptr.
   InterpreterStats* stats_;
 
+  // Memoized results of invokes. May be nullptr.
+  InvokeCache* invoke_cache_;
+
+  // Pool on which map elements are evaluated. May be nullptr.
+  ThreadPool* pool_;
+
   // The arguments to the Function being evaluated indexed by parameter name.
   std::vector<Value> args_;
 
   // The evaluated values for the nodes in the Function.
-  absl::flat_hash_map<Node*, Value> node_values_;
+  NodeMap<Value> node_values_;
 };
 
 }  // namespace xls
@@ -14,22 +14,107 @@
 
 #include "xls/interpreter/ir_interpreter_stats.h"
 
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "absl/memory/memory.h"
+
 namespace xls {
+namespace {
+
+std::atomic<int64_t> next_instance_id{0};
+
+// The shard most recently used by this thread.
+struct CachedShard {
+  int64_t instance_id = -1;
+  void* shard = nullptr;
+};
+thread_local CachedShard cached_shard;
+
+}  // namespace
+
+InterpreterStats::InterpreterStats()
+    : instance_id_(next_instance_id.fetch_add(1, std::memory_order_relaxed)) {}
 
-std::string InterpreterStats::ToNodeReport() const {
+InterpreterStats::Shard* InterpreterStats::GetShard() {
+  if (cached_shard.instance_id == instance_id_) {
+    return static_cast<Shard*>(cached_shard.shard);
+  }
+  absl::MutexLock lock(&mutex_);
+  std::unique_ptr<Shard>& shard = shards_[std::this_thread::get_id()];
+  if (shard == nullptr) {
+    shard = absl::make_unique<Shard>();
+  }
+  cached_shard.instance_id = instance_id_;
+  cached_shard.shard = shard.get();
+  return shard.get();
+}
+
+std::string InterpreterStats::ToNodeReport(
+    const absl::flat_hash_map<int64_t, NodeProfile>& value_profile) {
+  std::vector<int64_t> node_ids;
+  for (const auto& item : value_profile) {
+    node_ids.push_back(item.first);
+  }
+  std::sort(node_ids.begin(), node_ids.end());
   std::string result;
-  for (const auto& item : value_profile_) {
-    if (ternary_ops::AllUnknown(item.second.value())) {
+  for (int64_t node_id : node_ids) {
+    const NodeProfile& profile = value_profile.at(node_id);
+    if (ternary_ops::AllUnknown(profile.observed->known_bits)) {
       continue;
     }
-    absl::StrAppendFormat(&result, " %s: %s\n", item.first,
-                          ToString(item.second.value()));
+    absl::StrAppendFormat(&result, " %s: %s\n", profile.node_string,
+                          ToString(profile.observed->known_bits));
   }
   return result;
 }
 
-std::string InterpreterStats::ToReport() const {
+absl::flat_hash_map<int64_t, InterpreterStats::NodeProfile>
+InterpreterStats::MergeValueProfiles() const {
+  absl::flat_hash_map<int64_t, NodeProfile> merged;
+  for (const auto& item : shards_) {
+    Shard* shard = item.second.get();
+    absl::MutexLock shard_lock(&shard->mutex);
+    for (const auto& node_item : shard->value_profile) {
+      auto it = merged.find(node_item.first);
+      if (it == merged.end()) {
+        merged.emplace(node_item.first, node_item.second);
+      } else {
+        it->second.observed->Merge(*node_item.second.observed);
+      }
+    }
+  }
+  return merged;
+}
+
+ValueProfile InterpreterStats::ToValueProfile() const {
   absl::MutexLock lock(&mutex_);
+  ValueProfile result;
+  for (const auto& item : MergeValueProfiles()) {
+    result.Note(item.second.function_name, item.second.node_name,
+                *item.second.observed);
+  }
+  return result;
+}
+
+std::string InterpreterStats::ToReport() const {
+  int64_t all_shlls = 0;
+  int64_t zero_shlls = 0;
+  int64_t overlarge_shlls = 0;
+  absl::flat_hash_map<int64_t, NodeProfile> value_profile;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const auto& item : shards_) {
+      Shard* shard = item.second.get();
+      absl::MutexLock shard_lock(&shard->mutex);
+      all_shlls += shard->all_shlls;
+      zero_shlls += shard->zero_shlls;
+      overlarge_shlls += shard->overlarge_shlls;
+    }
+    value_profile = MergeValueProfiles();
+  }
+  int64_t in_range_shlls = all_shlls - overlarge_shlls - zero_shlls;
   auto percent = [](int64_t value, int64_t all) -> double {
     if (all == 0) {
       return 100.0;
@@ -43,10 +128,10 @@ shll:       %d
  overlarge: %d (%.2f%%)
  in-range:  %d (%.2f%%)
 )",
-             all_shlls_, zero_shlls_, percent(zero_shlls_, all_shlls_),
-             overlarge_shlls_, percent(overlarge_shlls_, all_shlls_),
-             in_range_shlls(), percent(in_range_shlls(), all_shlls_)) +
-         ToNodeReport();
+             all_shlls, zero_shlls, percent(zero_shlls, all_shlls),
+             overlarge_shlls, percent(overlarge_shlls, all_shlls),
+             in_range_shlls, percent(in_range_shlls, all_shlls)) +
+         ToNodeReport(value_profile);
 }
 
 }  // namespace xls
@@ -16,12 +16,17 @@
 #define XLS_IR_IR_INTERPRETER_STATS_H_
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "xls/interpreter/value_profile.h"
+#include "xls/ir/function_base.h"
 #include "xls/ir/node.h"
 #include "xls/ir/ternary.h"
 
@@ -30,63 +35,90 @@ namespace xls {
 // Note: as of now this is more of a "performance counter" dumb-struct sort of
 // class, where the determination of when/where to note things is inline in the
 // IR interpreter itself.
+//
+// Each thread noting stats records them into its own shard, so concurrent
+// interpreters do not contend with each other; the shards are merged when the
+// report is generated. Nodes are identified by id, so a single stats object
+// should only be used to profile the nodes of a single package.
 class InterpreterStats {
  public:
+  InterpreterStats();
+
   void NoteShllAmountForBitCount(int64_t amount, int64_t bit_count) {
-    absl::MutexLock lock(&mutex_);
-    all_shlls_ += 1;
-    overlarge_shlls_ += amount >= bit_count;
-    zero_shlls_ += amount == 0;
+    Shard* shard = GetShard();
+    absl::MutexLock lock(&shard->mutex);
+    shard->all_shlls += 1;
+    shard->overlarge_shlls += amount >= bit_count;
+    shard->zero_shlls += amount == 0;
   }
 
   // Notes the bits result for a given node (as determined by the interpreter)
   // -- the values that have consistent bits are recorded via the "Meet"
   // operator.
-  void NoteNodeBits(std::string node_string, const Bits& bits) {
-    absl::MutexLock lock(&mutex_);
-    auto& lattice = value_profile_[node_string];
-    Meet(bits, &lattice);
+  void NoteNodeBits(Node* node, const Bits& bits) {
+    Shard* shard = GetShard();
+    absl::MutexLock lock(&shard->mutex);
+    NodeProfile& profile = shard->value_profile[node->id()];
+    if (profile.observed.has_value()) {
+      profile.observed->Note(bits);
+    } else {
+      profile.node_string = node->ToString();
+      profile.function_name = node->function_base()->name();
+      profile.node_name = node->GetName();
+      profile.observed = NodeValueProfile::FromBits(bits);
+    }
   }
 
   // Returns a multi-line report string suitable for, e.g. XLS_LOG_LINES'ing.
   std::string ToReport() const;
 
+  // Returns the values noted for each node, e.g., to be written out and
+  // consumed by the ProfileGuidedNarrowingPass.
+  ValueProfile ToValueProfile() const;
+
  private:
-  int64_t in_range_shlls() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
-    return all_shlls_ - overlarge_shlls_ - zero_shlls_;
-  }
+  struct NodeProfile {
+    std::string node_string;
+    std::string function_name;
+    std::string node_name;
 
-  // Meets the observed "bits" value against the seen-so-far "lattice" of values
-  // -- e.g. if the seen-so-far value is 0 and "bits" contains a 1 in that bit
-  // position, the value will go to "bottom" (unknown = X).
-  //
-  // A nullopt in the lattice means no value has yet been observed for the given
-  // node.
-  void Meet(const Bits& bits, absl::optional<TernaryVector>* lattice) {
-    if (lattice->has_value()) {
-      XLS_CHECK_EQ(bits.bit_count(), lattice->value().size());
-      *lattice = ternary_ops::Equals(ternary_ops::BitsToTernary(bits),
-                                     lattice->value());
-    } else {
-      *lattice = ternary_ops::BitsToTernary(bits);
-    }
-  }
+    // When absl::nullopt, the value is "top" in the lattice (i.e. no info is
+    // available).
+    //
+    // When the known bits are present, kUnknown is "bottom" in the lattice
+    // (conflicting info).
+    absl::optional<NodeValueProfile> observed;
+  };
+
+  // The stats noted by one thread. The mutex is only contended while a report
+  // is being generated.
+  struct Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<int64_t, NodeProfile> value_profile
+        ABSL_GUARDED_BY(mutex);
+    int64_t overlarge_shlls ABSL_GUARDED_BY(mutex) = 0;
+    int64_t zero_shlls ABSL_GUARDED_BY(mutex) = 0;
+    int64_t all_shlls ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  // Returns the shard of the calling thread, creating it if necessary.
+  Shard* GetShard();
+
+  // Returns the profiles of all shards merged by node id.
+  absl::flat_hash_map<int64_t, NodeProfile> MergeValueProfiles() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   // Returns a string that represents the nodes with consistent bit values.
-  std::string ToNodeReport() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static std::string ToNodeReport(
+      const absl::flat_hash_map<int64_t, NodeProfile>& value_profile);
 
-  mutable absl::Mutex mutex_;
+  // Distinguishes this object from the others in the threads' shard caches,
+  // even if it is allocated at the address of a destroyed object.
+  const int64_t instance_id_;
 
-  // When absl::nullopt, the value is "top" in the lattice (i.e. no info is
-  // available).
-  //
-  // When the ternary value is present, kUnknown is "bottom" in the lattice
-  // (conflicting info).
-  absl::flat_hash_map<std::string, absl::optional<TernaryVector>> value_profile_
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::thread::id, std::unique_ptr<Shard>> shards_
       ABSL_GUARDED_BY(mutex_);
-  int64_t overlarge_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
-  int64_t zero_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
-  int64_t all_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
 }  // namespace xls
@@ -0,0 +1,78 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/interpreter/ir_interpreter_stats.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/matchers.h"
+#include "xls/common/thread.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/ternary.h"
+
+namespace xls {
+namespace {
+
+using ::testing::HasSubstr;
+
+constexpr char kPackage[] = R"(
+package p
+
+fn f(x: bits[4]) -> bits[4] {
+  literal.1: bits[4] = literal(value=3)
+  ret and.2: bits[4] = and(x, literal.1)
+}
+)";
+
+TEST(InterpreterStatsTest, MergesStatsOfAllThreads) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, package->GetFunction("f"));
+  InterpreterStats stats;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t x : {1, 3, 5}) {
+    threads.push_back(absl::make_unique<Thread>([&stats, f, x]() {
+      for (int64_t i = 0; i < 100; ++i) {
+        XLS_ASSERT_OK(
+            IrInterpreter::Run(f, {Value(UBits(x, 4))}, &stats).status());
+      }
+    }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  // Bit 1 of the and differs between threads, bit 0 is always set and the
+  // upper bits are always clear.
+  std::string report = stats.ToReport();
+  TernaryVector and_bits =
+      ternary_ops::Equals(ternary_ops::BitsToTernary(UBits(1, 4)),
+                          ternary_ops::BitsToTernary(UBits(3, 4)));
+  EXPECT_THAT(report, HasSubstr(absl::StrFormat(
+                          "%s: %s", f->return_value()->ToString(),
+                          ToString(and_bits))));
+  EXPECT_THAT(report, HasSubstr("Interpreter stats report:"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -17,12 +17,15 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread_pool.h"
 #include "xls/interpreter/ir_evaluator_test.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/function_builder.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/ir_test_base.h"
+#include "xls/ir/keyword_args.h"
 #include "xls/ir/package.h"
 #include "xls/ir/verifier.h"
 
@@ -44,6 +47,23 @@ INSTANTIATE_TEST_SUITE_P(
           return IrInterpreter::RunKwargs(function, kwargs);
         })));
 
+// Memoizing invokes must not change any results.
+INSTANTIATE_TEST_SUITE_P(
+    IrInterpreterInvokeCacheTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function, const std::vector<Value>& args) {
+          InvokeCache cache;
+          return IrInterpreter::Run(function, args, /*stats=*/nullptr, &cache);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs)
+            -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(std::vector<Value> args,
+                               KeywordArgsToPositional(*function, kwargs));
+          InvokeCache cache;
+          return IrInterpreter::Run(function, args, /*stats=*/nullptr, &cache);
+        })));
+
 // Fixture for IrInterpreter-only tests (i.e., those that aren't common to all
 // IR evaluators).
 class IrInterpreterOnlyTest : public IrTestBase {};
@@ -88,5 +108,122 @@ TEST_F(IrInterpreterOnlyTest, AssertTest) {
                        HasSubstr("the assertion error message")));
 }
 
+TEST_F(IrInterpreterOnlyTest, InvokeCache) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p, ParsePackage(R"(
+package p
+
+fn square(x: bits[8]) -> bits[8] {
+  ret umul.1: bits[8] = umul(x, x)
+}
+
+fn checked(tkn: token, x: bits[8]) -> token {
+  zero: bits[8] = literal(value=0)
+  nonzero: bits[1] = ne(x, zero)
+  ret assert.2: token = assert(tkn, nonzero, message="zero")
+}
+
+fn main(x: bits[8]) -> bits[8] {
+  a: bits[8] = invoke(x, to_apply=square)
+  b: bits[8] = invoke(x, to_apply=square)
+  one: bits[8] = literal(value=1)
+  y: bits[8] = add(x, one)
+  c: bits[8] = invoke(y, to_apply=square)
+  sum: bits[8] = add(a, b)
+  ret result: bits[8] = add(sum, c)
+}
+
+fn main_checked(tkn: token, x: bits[8]) -> token {
+  ret invoke.3: token = invoke(tkn, x, to_apply=checked)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, p->GetFunction("main"));
+  InvokeCache cache;
+  EXPECT_THAT(IrInterpreter::Run(main, {Value(UBits(2, 8))},
+                                 /*stats=*/nullptr, &cache),
+              IsOkAndHolds(Value(UBits(17, 8))));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 2);
+  EXPECT_THAT(IrInterpreter::Run(main, {Value(UBits(2, 8))},
+                                 /*stats=*/nullptr, &cache),
+              IsOkAndHolds(Value(UBits(17, 8))));
+  EXPECT_EQ(cache.hits(), 4);
+  EXPECT_EQ(cache.misses(), 2);
+  EXPECT_THAT(cache.ToReport(),
+              HasSubstr("square: 4 hits, 2 misses (66.7% hit rate)"));
+
+  // Failed evaluations are not cached.
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main_checked,
+                           p->GetFunction("main_checked"));
+  for (int64_t i = 0; i < 2; ++i) {
+    EXPECT_THAT(
+        IrInterpreter::Run(main_checked, {Value::Token(), Value(UBits(0, 8))},
+                           /*stats=*/nullptr, &cache),
+        StatusIs(absl::StatusCode::kAborted, HasSubstr("zero")));
+  }
+  EXPECT_THAT(cache.ToReport(),
+              HasSubstr("checked: 0 hits, 2 misses (0.0% hit rate)"));
+
+  // A full table is cleared before inserting.
+  InvokeCache small_cache(/*max_entries_per_function=*/1);
+  for (int64_t x : {2, 3, 2}) {
+    XLS_ASSERT_OK(IrInterpreter::Run(main, {Value(UBits(x, 8))},
+                                     /*stats=*/nullptr, &small_cache)
+                      .status());
+  }
+  // Only the last argument squared is kept: x = 3 finds 3 from the previous
+  // run, but x = 2 finds 4.
+  EXPECT_EQ(small_cache.hits(), 4);
+  EXPECT_EQ(small_cache.misses(), 5);
+}
+
+TEST_F(IrInterpreterOnlyTest, ParallelMap) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p, ParsePackage(R"(
+package p
+
+fn body(i: bits[8], acc: bits[32], x: bits[32]) -> bits[32] {
+  zero_ext.1: bits[32] = zero_ext(i, new_bit_count=32)
+  umul.2: bits[32] = umul(zero_ext.1, x)
+  ret add.3: bits[32] = add(acc, umul.2)
+}
+
+fn element(tkn: token, x: bits[32]) -> bits[32] {
+  zero: bits[32] = literal(value=0)
+  nonzero: bits[1] = ne(x, zero)
+  assert.4: token = assert(tkn, nonzero, message="zero element")
+  ret counted_for.5: bits[32] = counted_for(zero, trip_count=8, stride=1, body=body, invariant_args=[x])
+}
+
+fn wrapper(x: bits[32]) -> bits[32] {
+  tkn: token = after_all()
+  ret invoke.6: bits[32] = invoke(tkn, x, to_apply=element)
+}
+
+fn main(xs: bits[32][2048]) -> bits[32][2048] {
+  ret map.7: bits[32][2048] = map(xs, to_apply=wrapper)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, p->GetFunction("main"));
+  std::vector<Value> xs;
+  std::vector<Value> expected;
+  for (int64_t i = 0; i < 2048; ++i) {
+    xs.push_back(Value(UBits(i + 1, 32)));
+    // The loop sums x * i for i in [0, 8).
+    expected.push_back(Value(UBits(28 * (i + 1), 32)));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Value xs_array, Value::Array(xs));
+  XLS_ASSERT_OK_AND_ASSIGN(Value expected_array, Value::Array(expected));
+
+  ThreadPool pool(4);
+  EXPECT_THAT(IrInterpreter::Run(main, {xs_array}, /*stats=*/nullptr,
+                                 /*invoke_cache=*/nullptr, &pool),
+              IsOkAndHolds(expected_array));
+
+  xs[1500] = Value(UBits(0, 32));
+  XLS_ASSERT_OK_AND_ASSIGN(xs_array, Value::Array(xs));
+  EXPECT_THAT(IrInterpreter::Run(main, {xs_array}, /*stats=*/nullptr,
+                                 /*invoke_cache=*/nullptr, &pool),
+              StatusIs(absl::StatusCode::kAborted, HasSubstr("zero element")));
+}
+
 }  // namespace
 }  // namespace xls
@@ -16,6 +16,7 @@
 
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/optional.h"
 #include "xls/common/logging/log_lines.h"
 #include "xls/ir/value_helpers.h"
 
@@ -95,6 +96,7 @@ bool ProcInterpreter::RunResult::operator!=(
 
 ProcInterpreter::ProcInterpreter(Proc* proc, ChannelQueueManager* queue_manager)
     : proc_(proc),
+      state_(proc->InitValue()),
       queue_manager_(queue_manager),
       topo_sort_(TopoSort(proc)),
       current_iteration_(0) {}
@@ -104,6 +106,34 @@ bool ProcInterpreter::IsIterationComplete() const {
                                  visitor_->IsVisited(proc_->NextToken()));
 }
 
+absl::StatusOr<Value> ProcInterpreter::GetState() const {
+  if (!IsIterationComplete()) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Iteration %d of proc %s is incomplete", current_iteration_,
+        proc_->name()));
+  }
+  if (visitor_ == nullptr) {
+    return state_;
+  }
+  return visitor_->ResolveAsValue(proc_->NextState());
+}
+
+absl::Status ProcInterpreter::SetState(const Value& state) {
+  if (!IsIterationComplete()) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Iteration %d of proc %s is incomplete", current_iteration_,
+        proc_->name()));
+  }
+  if (!ValueConformsToType(state, proc_->StateType())) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "State of proc %s must have type %s, got: %s", proc_->name(),
+        proc_->StateType()->ToString(), state.ToString()));
+  }
+  state_ = state;
+  visitor_ = nullptr;
+  return absl::OkStatus();
+}
+
 absl::StatusOr<ProcInterpreter::RunResult>
 ProcInterpreter::RunIterationUntilCompleteOrBlocked() {
   XLS_VLOG(3) << absl::StreamFormat(
@@ -117,15 +147,15 @@ ProcInterpreter::RunIterationUntilCompleteOrBlocked() {
     // been called. Create a new visitor for evaluating the nodes this
     // iteration.
     if (visitor_ == nullptr) {
-      // This is the first time the proc has run. Proc state is the init value.
-      visitor_ = absl::make_unique<ProcIrInterpreter>(proc_->InitValue(),
-                                                      queue_manager_);
+      // This is the first time the proc has run, or its state has been set.
+      visitor_ = absl::make_unique<ProcIrInterpreter>(state_, queue_manager_);
     } else {
       const Value& next_state = visitor_->ResolveAsValue(proc_->NextState());
       visitor_ =
           absl::make_unique<ProcIrInterpreter>(next_state, queue_manager_);
       ++current_iteration_;
     }
+    pending_nodes_.assign(topo_sort_.begin(), topo_sort_.end());
   }
 
   RunResult result{.iteration_complete = true,
@@ -134,13 +164,25 @@ ProcInterpreter::RunIterationUntilCompleteOrBlocked() {
   auto executed_this_iteration = [&](Node* node) {
     return visitor_->IsVisited(node);
   };
-
-  // TODO(meheff): Iterating through all the nodes every time is
-  // inefficient. It'd be better to continue from some checkpointed state.
-  for (Node* node : topo_sort_) {
-    if (executed_this_iteration(node)) {
-      continue;
+  // Returns the ID of the channel on which executing "node" would enqueue a
+  // value, if any. The operands of "node" must have been executed.
+  auto sending_channel_id = [&](Node* node) -> absl::optional<int64_t> {
+    if (node->Is<Send>()) {
+      return node->As<Send>()->channel_id();
+    }
+    if (node->Is<SendIf>() &&
+        visitor_->ResolveAsValue(node->As<SendIf>()->predicate())
+            .bits()
+            .IsOne()) {
+      return node->As<SendIf>()->channel_id();
     }
+    return absl::nullopt;
+  };
+
+  // The pending nodes are visited in topological order so a node whose
+  // operands execute in this call executes in it too.
+  std::vector<Node*> still_pending;
+  for (Node* node : pending_nodes_) {
     if (std::all_of(node->operands().begin(), node->operands().end(),
                     executed_this_iteration)) {
       // Check to see if this is a receive node which is blocked.
@@ -153,8 +195,28 @@ ProcInterpreter::RunIterationUntilCompleteOrBlocked() {
           XLS_VLOG(4) << absl::StreamFormat(
               "Receive node %s blocked on channel with ID %d", node->GetName(),
               node->As<Receive>()->channel_id());
+          queue->RecordReceiveStall();
+          result.blocked_channels.push_back(queue->channel());
+          result.iteration_complete = false;
+          still_pending.push_back(node);
+          continue;
+        }
+      }
+
+      // Check to see if this is a send node which is blocked.
+      absl::optional<int64_t> send_channel_id = sending_channel_id(node);
+      if (send_channel_id.has_value()) {
+        XLS_ASSIGN_OR_RETURN(ChannelQueue * queue,
+                             queue_manager_->GetQueueById(*send_channel_id));
+        if (queue->full()) {
+          // Queue is at capacity, send is blocked.
+          XLS_VLOG(4) << absl::StreamFormat(
+              "Send node %s blocked on channel with ID %d", node->GetName(),
+              *send_channel_id);
+          queue->RecordSendStall();
           result.blocked_channels.push_back(queue->channel());
           result.iteration_complete = false;
+          still_pending.push_back(node);
           continue;
         }
       }
@@ -168,8 +230,10 @@ ProcInterpreter::RunIterationUntilCompleteOrBlocked() {
     } else {
       XLS_VLOG(4) << absl::StreamFormat("Node %s not ready to execute",
                                         node->GetName());
+      still_pending.push_back(node);
     }
   }
+  pending_nodes_ = std::move(still_pending);
   // Sort blocked_channels vector by channel id.
   std::sort(result.blocked_channels.begin(), result.blocked_channels.end(),
             [](Channel* a, Channel* b) { return a->id() < b->id(); });
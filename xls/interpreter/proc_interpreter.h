@@ -80,14 +80,31 @@ class ProcInterpreter {
   // was true).
   bool IsIterationComplete() const;
 
+  // Returns the state the next iteration starts from, e.g., to checkpoint a
+  // simulation. Returns an error if the current iteration is incomplete.
+  absl::StatusOr<Value> GetState() const;
+
+  // Sets the state the next iteration starts from, e.g., to restore a
+  // checkpointed simulation. Returns an error if the current iteration is
+  // incomplete.
+  absl::Status SetState(const Value& state);
+
  private:
   Proc* proc_;
+
+  // The state the next iteration starts from if no iteration has run since
+  // construction or the last SetState().
   Value state_;
   ChannelQueueManager* queue_manager_;
 
   // A topological sort of the nodes of the proc.
   NodeIterator topo_sort_;
 
+  // The nodes not yet executed in the current iteration, in topological
+  // order. A resumed iteration only considers these rather than rescanning the
+  // whole proc.
+  std::vector<Node*> pending_nodes_;
+
   // A monotonically increasing value holding the number of complete iterations
   // that the proc has executed.
   int64_t current_iteration_;
@@ -0,0 +1,48 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/proc_network_checkpoint.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+
+absl::Status WriteProcNetworkCheckpoint(
+    const ProcNetworkCheckpointProto& checkpoint,
+    const std::filesystem::path& path) {
+  std::string bytes;
+  if (!checkpoint.SerializeToString(&bytes)) {
+    return absl::InternalError("Unable to serialize proc network checkpoint");
+  }
+  return AtomicSetFileContents(path, bytes);
+}
+
+absl::StatusOr<ProcNetworkCheckpointProto> ReadProcNetworkCheckpoint(
+    const std::filesystem::path& path) {
+  XLS_ASSIGN_OR_RETURN(std::string bytes, GetFileContents(path));
+  ProcNetworkCheckpointProto checkpoint;
+  if (!checkpoint.ParseFromString(bytes)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Malformed proc network checkpoint: ", path.string()));
+  }
+  return checkpoint;
+}
+
+}  // namespace xls
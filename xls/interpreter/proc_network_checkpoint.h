@@ -0,0 +1,39 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_PROC_NETWORK_CHECKPOINT_H_
+#define XLS_INTERPRETER_PROC_NETWORK_CHECKPOINT_H_
+
+#include <filesystem>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/interpreter/proc_network_checkpoint.pb.h"
+
+namespace xls {
+
+// Writes the checkpoint to "path" in binary proto form. The file is written
+// to a temporary and renamed into place, so an interrupted write never
+// clobbers the previous checkpoint.
+absl::Status WriteProcNetworkCheckpoint(
+    const ProcNetworkCheckpointProto& checkpoint,
+    const std::filesystem::path& path);
+
+// Reads a checkpoint written by WriteProcNetworkCheckpoint.
+absl::StatusOr<ProcNetworkCheckpointProto> ReadProcNetworkCheckpoint(
+    const std::filesystem::path& path);
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_PROC_NETWORK_CHECKPOINT_H_
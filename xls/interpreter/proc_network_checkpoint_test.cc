@@ -0,0 +1,70 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/proc_network_checkpoint.h"
+
+#include <filesystem>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+TEST(ProcNetworkCheckpointTest, RoundTrip) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint";
+
+  ProcNetworkCheckpointProto checkpoint;
+  checkpoint.set_package("p");
+  checkpoint.set_tick(42);
+  checkpoint.set_state_layout(ProcNetworkCheckpointProto::JIT_NATIVE);
+  ProcStateCheckpointProto* proc = checkpoint.add_procs();
+  proc->set_proc("counter");
+  proc->set_buffer(std::string("\x01\x00\x00\x00", 4));
+  XLS_ASSERT_OK(WriteProcNetworkCheckpoint(checkpoint, path));
+
+  // Overwriting an existing checkpoint replaces it.
+  checkpoint.set_tick(43);
+  XLS_ASSERT_OK(WriteProcNetworkCheckpoint(checkpoint, path));
+
+  XLS_ASSERT_OK_AND_ASSIGN(ProcNetworkCheckpointProto read,
+                           ReadProcNetworkCheckpoint(path));
+  EXPECT_EQ(read.package(), "p");
+  EXPECT_EQ(read.tick(), 43);
+  EXPECT_EQ(read.state_layout(), ProcNetworkCheckpointProto::JIT_NATIVE);
+  ASSERT_EQ(read.procs_size(), 1);
+  EXPECT_EQ(read.procs(0).proc(), "counter");
+  EXPECT_EQ(read.procs(0).buffer(), std::string("\x01\x00\x00\x00", 4));
+}
+
+TEST(ProcNetworkCheckpointTest, Errors) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  EXPECT_THAT(ReadProcNetworkCheckpoint(temp_dir.path() / "missing").status(),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  std::filesystem::path path = temp_dir.path() / "garbage";
+  XLS_ASSERT_OK(SetFileContents(path, "\xff\xff\xff"));
+  EXPECT_THAT(ReadProcNetworkCheckpoint(path).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace xls
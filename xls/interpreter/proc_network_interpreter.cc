@@ -14,8 +14,16 @@
 
 #include "xls/interpreter/proc_network_interpreter.h"
 
+#include <algorithm>
+
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
+#include "xls/interpreter/proc_network_checkpoint.h"
+#include "xls/ir/package_serializer.h"
 
 namespace xls {
 
@@ -24,6 +32,26 @@ absl::StatusOr<std::unique_ptr<ProcNetworkInterpreter>>
 ProcNetworkInterpreter::Create(
     Package* package,
     std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues) {
+  return CreateInternal(package, std::move(rx_only_queues),
+                        absl::optional<ClockDomains>());
+}
+
+/* static */
+absl::StatusOr<std::unique_ptr<ProcNetworkInterpreter>>
+ProcNetworkInterpreter::Create(
+    Package* package,
+    std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+    const ClockDomains& clock_domains) {
+  return CreateInternal(package, std::move(rx_only_queues),
+                        absl::optional<ClockDomains>(clock_domains));
+}
+
+/* static */
+absl::StatusOr<std::unique_ptr<ProcNetworkInterpreter>>
+ProcNetworkInterpreter::CreateInternal(
+    Package* package,
+    std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+    absl::optional<ClockDomains> clock_domains) {
   // Create a queue manager for the queues. This factory verifies that there an
   // receive only queue for every receive only channel.
   XLS_ASSIGN_OR_RETURN(
@@ -40,6 +68,36 @@ ProcNetworkInterpreter::Create(
                                            &interpreter->queue_manager()));
   }
 
+  if (clock_domains.has_value()) {
+    XLS_ASSIGN_OR_RETURN(std::vector<ClockDomainCrossing> crossings,
+                         FindClockDomainCrossings(package, *clock_domains));
+    interpreter->has_clock_domains_ = true;
+    for (auto& proc : package->procs()) {
+      int64_t period = clock_domains->periods.at(
+          clock_domains->proc_domains.at(proc->name()));
+      interpreter->periods_.push_back(period);
+      interpreter->next_edges_.push_back(0);
+    }
+    for (const ClockDomainCrossing& crossing : crossings) {
+      auto queue = absl::make_unique<CdcChannelQueue>(
+          crossing.channel, package, clock_domains->fifo_depth,
+          clock_domains->periods.at(crossing.send_domain),
+          clock_domains->periods.at(crossing.receive_domain),
+          clock_domains->synchronizer_stages);
+      interpreter->cdc_queues_.push_back(queue.get());
+      interpreter->queue_manager().ReplaceQueue(std::move(queue));
+    }
+  }
+
+  // Wake procs blocked on a channel when data arrives on it (for receivers) or
+  // leaves it (for senders blocked on a full queue).
+  for (Channel* channel : package->channels()) {
+    ProcNetworkInterpreter* raw = interpreter.get();
+    ChannelQueue& queue = interpreter->queue_manager().GetQueue(channel);
+    queue.SetEnqueueCallback([raw, channel]() { raw->WakeWaiters(channel); });
+    queue.SetDequeueCallback([raw, channel]() { raw->WakeWaiters(channel); });
+  }
+
   // Inject initial values into channels.
   for (Channel* channel : package->channels()) {
     ChannelQueue& queue = interpreter->queue_manager().GetQueue(channel);
@@ -52,29 +110,229 @@ ProcNetworkInterpreter::Create(
   return std::move(interpreter);
 }
 
+void ProcNetworkInterpreter::MakeReady(ProcInterpreter* interpreter) {
+  if (ready_set_.insert(interpreter).second) {
+    ready_procs_.push_back(interpreter);
+  }
+}
+
+void ProcNetworkInterpreter::WakeWaiters(Channel* channel) {
+  touched_channels_.insert(channel);
+  auto it = waiters_.find(channel);
+  if (it == waiters_.end()) {
+    return;
+  }
+  std::vector<ProcInterpreter*> waiters = std::move(it->second);
+  waiters_.erase(it);
+  for (ProcInterpreter* interpreter : waiters) {
+    MakeReady(interpreter);
+  }
+}
+
+absl::StatusOr<std::vector<ProcInterpreter*>>
+ProcNetworkInterpreter::AdvanceToNextEdge() {
+  now_ = *std::min_element(next_edges_.begin(), next_edges_.end());
+  for (CdcChannelQueue* queue : cdc_queues_) {
+    XLS_RETURN_IF_ERROR(queue->AdvanceTime(now_));
+  }
+  std::vector<ProcInterpreter*> active;
+  for (int64_t i = 0; i < proc_interpreters_.size(); ++i) {
+    if (next_edges_[i] == now_) {
+      active.push_back(proc_interpreters_[i].get());
+      next_edges_[i] += periods_[i];
+    }
+  }
+  return active;
+}
+
 absl::Status ProcNetworkInterpreter::Tick() {
+  XLS_TRACE_SPAN("ProcNetworkInterpreter::Tick");
+  XLS_RETURN_IF_ERROR(RunTick());
+  ++tick_count_;
+  if (checkpoint_interval_ == 0 || tick_count_ < next_checkpoint_tick_) {
+    return absl::OkStatus();
+  }
+  absl::StatusOr<ProcNetworkCheckpointProto> checkpoint = Checkpoint();
+  if (absl::IsFailedPrecondition(checkpoint.status())) {
+    XLS_VLOG(1) << "Deferring checkpoint at tick " << tick_count_ << ": "
+                << checkpoint.status();
+    return absl::OkStatus();
+  }
+  XLS_RETURN_IF_ERROR(checkpoint.status());
+  XLS_RETURN_IF_ERROR(
+      WriteProcNetworkCheckpoint(checkpoint.value(), checkpoint_path_));
+  ScheduleNextCheckpoint();
+  return absl::OkStatus();
+}
+
+absl::StatusOr<ProcNetworkCheckpointProto> ProcNetworkInterpreter::Checkpoint()
+    const {
+  if (has_clock_domains_) {
+    return absl::UnimplementedError(
+        "Checkpointing proc networks with clock domains is not supported");
+  }
+  ProcNetworkCheckpointProto checkpoint;
+  checkpoint.set_package(package_->name());
+  checkpoint.set_tick(tick_count_);
+  checkpoint.set_state_layout(ProcNetworkCheckpointProto::VALUE);
+  for (int64_t i = 0; i < proc_interpreters_.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(Value state, proc_interpreters_[i]->GetState());
+    ProcStateCheckpointProto* proc = checkpoint.add_procs();
+    proc->set_proc(package_->procs()[i]->name());
+    *proc->mutable_value() = ValueToProto(state);
+  }
+  for (Channel* channel : package_->channels()) {
+    if (channel->supported_ops() == ChannelOps::kReceiveOnly) {
+      continue;
+    }
+    ChannelCheckpointProto* channel_proto = checkpoint.add_channels();
+    channel_proto->set_channel_id(channel->id());
+    for (const Value& value :
+         queue_manager_->GetQueue(channel).GetContents()) {
+      *channel_proto->add_values() = ValueToProto(value);
+    }
+  }
+  return checkpoint;
+}
+
+absl::Status ProcNetworkInterpreter::Restore(
+    const ProcNetworkCheckpointProto& checkpoint) {
+  if (checkpoint.package() != package_->name()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Checkpoint is of package %s, expected %s", checkpoint.package(),
+        package_->name()));
+  }
+  if (checkpoint.state_layout() != ProcNetworkCheckpointProto::VALUE) {
+    return absl::InvalidArgumentError(
+        "The interpreter can only restore checkpoints in the VALUE layout");
+  }
+  if (has_clock_domains_) {
+    return absl::UnimplementedError(
+        "Restoring proc networks with clock domains is not supported");
+  }
+  XLS_RET_CHECK_EQ(checkpoint.procs_size(), proc_interpreters_.size())
+      << "Checkpoint has the wrong number of procs";
+  for (const ProcStateCheckpointProto& proc : checkpoint.procs()) {
+    auto it = std::find_if(package_->procs().begin(), package_->procs().end(),
+                           [&](const std::unique_ptr<Proc>& p) {
+                             return p->name() == proc.proc();
+                           });
+    if (it == package_->procs().end()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Checkpoint has unknown proc %s", proc.proc()));
+    }
+    XLS_ASSIGN_OR_RETURN(Value state, ValueFromProto(proc.value()));
+    XLS_RETURN_IF_ERROR(
+        proc_interpreters_[std::distance(package_->procs().begin(), it)]
+            ->SetState(state));
+  }
+  for (Channel* channel : package_->channels()) {
+    if (channel->supported_ops() != ChannelOps::kReceiveOnly) {
+      XLS_RETURN_IF_ERROR(queue_manager_->GetQueue(channel).SetContents({}));
+    }
+  }
+  for (const ChannelCheckpointProto& channel_proto : checkpoint.channels()) {
+    XLS_ASSIGN_OR_RETURN(Channel * channel,
+                         package_->GetChannel(channel_proto.channel_id()));
+    std::vector<Value> values;
+    for (const ValueProto& value_proto : channel_proto.values()) {
+      XLS_ASSIGN_OR_RETURN(Value value, ValueFromProto(value_proto));
+      values.push_back(std::move(value));
+    }
+    XLS_RETURN_IF_ERROR(queue_manager_->GetQueue(channel).SetContents(values));
+  }
+  tick_count_ = checkpoint.tick();
+  if (checkpoint_interval_ != 0) {
+    ScheduleNextCheckpoint();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ProcNetworkInterpreter::EnableAutomaticCheckpoints(
+    std::filesystem::path path, int64_t interval_ticks) {
+  XLS_RET_CHECK_GT(interval_ticks, 0);
+  if (has_clock_domains_) {
+    return absl::UnimplementedError(
+        "Checkpointing proc networks with clock domains is not supported");
+  }
+  checkpoint_path_ = std::move(path);
+  checkpoint_interval_ = interval_ticks;
+  ScheduleNextCheckpoint();
+  return absl::OkStatus();
+}
+
+void ProcNetworkInterpreter::ScheduleNextCheckpoint() {
+  next_checkpoint_tick_ =
+      (tick_count_ / checkpoint_interval_ + 1) * checkpoint_interval_;
+}
+
+absl::Status ProcNetworkInterpreter::RunTick() {
+  waiters_.clear();
+  ready_procs_.clear();
+  ready_set_.clear();
+  std::vector<ProcInterpreter*> active;
+  if (has_clock_domains_) {
+    XLS_ASSIGN_OR_RETURN(active, AdvanceToNextEdge());
+  } else {
+    for (auto& interpreter : proc_interpreters_) {
+      active.push_back(interpreter.get());
+    }
+  }
+  // Every active proc is run at least once; after that a proc blocked on a
+  // receive is only run again once one of the channels it is blocked on gets
+  // data.
+  for (ProcInterpreter* interpreter : active) {
+    MakeReady(interpreter);
+  }
+
   absl::flat_hash_set<ProcInterpreter*> completed_procs;
-  absl::flat_hash_set<Channel*> blocked_channels;
+  absl::flat_hash_map<ProcInterpreter*, std::vector<Channel*>> blocked_on;
   bool global_progress_made = false;
-  bool progress_made_this_loop = true;
-  while (progress_made_this_loop) {
-    progress_made_this_loop = false;
-    blocked_channels.clear();
-    for (auto& interpreter : proc_interpreters_) {
-      if (completed_procs.contains(interpreter.get())) {
-        continue;
+  while (!ready_procs_.empty()) {
+    ProcInterpreter* interpreter = ready_procs_.front();
+    ready_procs_.pop_front();
+    ready_set_.erase(interpreter);
+    if (completed_procs.contains(interpreter)) {
+      continue;
+    }
+    touched_channels_.clear();
+    XLS_ASSIGN_OR_RETURN(ProcInterpreter::RunResult result,
+                         interpreter->RunIterationUntilCompleteOrBlocked());
+    global_progress_made |= result.progress_made;
+    if (result.iteration_complete) {
+      completed_procs.insert(interpreter);
+      blocked_on.erase(interpreter);
+      continue;
+    }
+    blocked_on[interpreter] = result.blocked_channels;
+    for (Channel* channel : result.blocked_channels) {
+      if (touched_channels_.contains(channel)) {
+        // The proc itself used the channel after blocking on it, which may
+        // have unblocked it.
+        MakeReady(interpreter);
+      } else {
+        waiters_[channel].push_back(interpreter);
       }
-      XLS_ASSIGN_OR_RETURN(ProcInterpreter::RunResult result,
-                           interpreter->RunIterationUntilCompleteOrBlocked());
+    }
+  }
+  waiters_.clear();
 
-      progress_made_this_loop |= result.progress_made;
-      if (result.iteration_complete) {
-        completed_procs.insert(interpreter.get());
-      }
-      blocked_channels.insert(result.blocked_channels.begin(),
-                              result.blocked_channels.end());
+  absl::flat_hash_set<Channel*> blocked_channels;
+  for (const auto& [interpreter, channels] : blocked_on) {
+    blocked_channels.insert(channels.begin(), channels.end());
+  }
+  if (has_clock_domains_) {
+    bool in_flight = std::any_of(
+        cdc_queues_.begin(), cdc_queues_.end(),
+        [](CdcChannelQueue* queue) { return queue->in_flight(); });
+    if (global_progress_made || in_flight) {
+      stalled_procs_.clear();
+      return absl::OkStatus();
+    }
+    stalled_procs_.insert(active.begin(), active.end());
+    if (stalled_procs_.size() < proc_interpreters_.size()) {
+      return absl::OkStatus();
     }
-    global_progress_made |= progress_made_this_loop;
   }
   if (!global_progress_made) {
     // Not a single instruction executed on any proc. This is necessarily a
@@ -15,12 +15,19 @@
 #ifndef XLS_INTERPRETER_PROC_NETWORK_INTERPRETER_H_
 #define XLS_INTERPRETER_PROC_NETWORK_INTERPRETER_H_
 
+#include <deque>
+#include <filesystem>
 #include <memory>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "xls/interpreter/channel_queue.h"
 #include "xls/interpreter/proc_interpreter.h"
+#include "xls/interpreter/proc_network_checkpoint.pb.h"
+#include "xls/ir/clock_domains.h"
 #include "xls/ir/package.h"
 
 namespace xls {
@@ -37,30 +44,130 @@ class ProcNetworkInterpreter {
       Package* package,
       std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues);
 
-  // Execute (up to) a single iteration of every proc in the package. In a
-  // round-robin fashion each proc is executed until no further progress can be
-  // made. If no conditional send/receive nodes (send_if or receive_if) exist in
-  // the package then calling Tick will execute exactly one iteration for all
-  // procs in the package. If conditional send/receive nodes do exist, then some
+  // As above, but simulates the procs in the given clock domains: each Tick
+  // advances time to the next clock edge of any domain and only runs the procs
+  // of the domains with an edge at that time. Channels crossing domains are
+  // backed by CdcChannelQueues modeling their asynchronous FIFOs.
+  static absl::StatusOr<std::unique_ptr<ProcNetworkInterpreter>> Create(
+      Package* package,
+      std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+      const ClockDomains& clock_domains);
+
+  // Execute (up to) a single iteration of every proc in the package. Each proc
+  // is executed until no further progress can be made. A proc blocked on a
+  // receive is only resumed after a value is enqueued on a channel it is
+  // blocked on, rather than polling every proc until none makes progress. If
+  // no conditional send/receive nodes (send_if or receive_if) exist in the
+  // package then calling Tick will execute exactly one iteration for all procs
+  // in the package. If conditional send/receive nodes do exist, then some
   // procs may be blocked in a state where the iteration is partially
   // complete. In this case, the call to Tick() will not execute a complete
   // iteration of the proc. Calling Tick() again will resume these procs from
   // their partially executed state. Returns an error if no progress can be made
-  // due to a deadlock.
+  // due to a deadlock. With clock domains, procs may make no progress during a
+  // Tick while values cross domains; a deadlock is only reported once no proc
+  // of any domain made progress since nothing was in flight.
   absl::Status Tick();
 
   ChannelQueueManager& queue_manager() { return *queue_manager_; }
 
+  // Returns the number of successful calls to Tick(), counting from the tick
+  // of a restored checkpoint.
+  int64_t tick_count() const { return tick_count_; }
+
+  // Returns a checkpoint of the state of every proc and the contents of every
+  // channel queue, in the VALUE layout. Receive-only channels are not
+  // included: their contents come from outside the network, and the caller
+  // is responsible for resuming their generators. Returns a FailedPrecondition
+  // error if a proc is partway through an iteration, and an Unimplemented
+  // error with clock domains.
+  absl::StatusOr<ProcNetworkCheckpointProto> Checkpoint() const;
+
+  // Restores a checkpoint taken by Checkpoint() from a network of the same
+  // package. Queues of channels absent from the checkpoint are emptied.
+  absl::Status Restore(const ProcNetworkCheckpointProto& checkpoint);
+
+  // Writes a checkpoint to "path" after every "interval_ticks" ticks,
+  // replacing the previous one. If procs are partway through an iteration at
+  // that tick, the checkpoint is taken after the first following tick at which
+  // they are not.
+  absl::Status EnableAutomaticCheckpoints(std::filesystem::path path,
+                                          int64_t interval_ticks);
+
+  // Returns the time of the clock edge simulated by the last Tick, or zero
+  // without clock domains.
+  int64_t current_time() const { return now_; }
+
  private:
   ProcNetworkInterpreter(Package* package,
                          std::unique_ptr<ChannelQueueManager>&& queue_manager)
       : package_(package), queue_manager_(std::move(queue_manager)) {}
 
+  static absl::StatusOr<std::unique_ptr<ProcNetworkInterpreter>>
+  CreateInternal(
+      Package* package,
+      std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+      absl::optional<ClockDomains> clock_domains);
+
+  // Runs a tick; Tick() additionally counts it and writes any automatic
+  // checkpoint which is due.
+  absl::Status RunTick();
+
+  // Sets the next automatic checkpoint to be taken at the next multiple of the
+  // interval after the current tick.
+  void ScheduleNextCheckpoint();
+
+  // Advances the time to the next clock edge of any domain and returns the
+  // procs to run at it.
+  absl::StatusOr<std::vector<ProcInterpreter*>> AdvanceToNextEdge();
+
+  // Called when a value is enqueued on or dequeued from "channel". Moves the
+  // procs waiting on the channel to the ready queue.
+  void WakeWaiters(Channel* channel);
+
+  // Adds "interpreter" to the back of the ready queue if it is not already in
+  // it.
+  void MakeReady(ProcInterpreter* interpreter);
+
   Package* package_;
   std::unique_ptr<ChannelQueueManager> queue_manager_;
 
   // The vector of interpreters for each proc in the package.
   std::vector<std::unique_ptr<ProcInterpreter>> proc_interpreters_;
+
+  // With clock domains, the clock period of each proc and the time of its next
+  // edge, parallel to proc_interpreters_, and the queues of the channels
+  // crossing domains.
+  bool has_clock_domains_ = false;
+  std::vector<int64_t> periods_;
+  std::vector<int64_t> next_edges_;
+  std::vector<CdcChannelQueue*> cdc_queues_;
+  int64_t now_ = 0;
+
+  // With clock domains, the procs run without progress being made by any proc
+  // since the last progress or since values were last in flight.
+  absl::flat_hash_set<ProcInterpreter*> stalled_procs_;
+
+  // The procs to run next during a Tick, and the set of them for
+  // de-duplication.
+  std::deque<ProcInterpreter*> ready_procs_;
+  absl::flat_hash_set<ProcInterpreter*> ready_set_;
+
+  // Procs blocked on each channel during a Tick. A proc blocked on several
+  // channels is listed under each of them; entries made stale by waking the
+  // proc through another channel only cause a spurious (harmless) resumption.
+  absl::flat_hash_map<Channel*, std::vector<ProcInterpreter*>> waiters_;
+
+  // Channels enqueued on or dequeued from while running the current proc.
+  absl::flat_hash_set<Channel*> touched_channels_;
+
+  int64_t tick_count_ = 0;
+
+  // Where and how often automatic checkpoints are written, if enabled, and
+  // the tick count at (or after) which the next one is due.
+  std::filesystem::path checkpoint_path_;
+  int64_t checkpoint_interval_ = 0;
+  int64_t next_checkpoint_tick_ = 0;
 };
 
 }  // namespace xls
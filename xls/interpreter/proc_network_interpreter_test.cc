@@ -14,11 +14,16 @@
 
 #include "xls/interpreter/proc_network_interpreter.h"
 
+#include <filesystem>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "xls/common/file/temp_directory.h"
 #include "xls/common/status/matchers.h"
+#include "xls/interpreter/proc_network_checkpoint.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/function_builder.h"
 #include "xls/ir/ir_test_base.h"
@@ -187,6 +192,163 @@ TEST_F(ProcNetworkInterpreterTest, IotaFeedingAccumulator) {
   EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(6, 32))));
 }
 
+TEST_F(ProcNetworkInterpreterTest, CheckpointAndRestore) {
+  auto package = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * iota_accum_channel,
+      package->CreateStreamingChannel("iota_accum", ChannelOps::kSendReceive,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * out_channel,
+      package->CreateStreamingChannel("out", ChannelOps::kSendOnly,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK(CreateIotaProc("iota", /*starting_value=*/0, /*step=*/1,
+                               iota_accum_channel, package.get())
+                    .status());
+  XLS_ASSERT_OK(
+      CreateAccumProc("accum", iota_accum_channel, out_channel, package.get())
+          .status());
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint";
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {}));
+  XLS_ASSERT_OK(interpreter->EnableAutomaticCheckpoints(path, 2));
+  ChannelQueue& queue = interpreter->queue_manager().GetQueue(out_channel);
+  for (int64_t i = 0; i < 3; ++i) {
+    XLS_ASSERT_OK(interpreter->Tick());
+  }
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(0, 32))));
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(1, 32))));
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(3, 32))));
+  XLS_ASSERT_OK_AND_ASSIGN(ProcNetworkCheckpointProto checkpoint,
+                           interpreter->Checkpoint());
+  EXPECT_EQ(checkpoint.tick(), 3);
+  XLS_ASSERT_OK(interpreter->Tick());
+  XLS_ASSERT_OK(interpreter->Tick());
+  EXPECT_EQ(interpreter->tick_count(), 5);
+  EXPECT_THAT(queue.GetContents(),
+              ElementsAre(Value(UBits(6, 32)), Value(UBits(10, 32))));
+
+  // Resuming from the in-memory checkpoint reproduces the last two ticks.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> restored,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {}));
+  XLS_ASSERT_OK(restored->Restore(checkpoint));
+  XLS_ASSERT_OK(restored->Tick());
+  XLS_ASSERT_OK(restored->Tick());
+  EXPECT_EQ(restored->tick_count(), 5);
+  EXPECT_THAT(restored->queue_manager().GetQueue(out_channel).GetContents(),
+              ElementsAre(Value(UBits(6, 32)), Value(UBits(10, 32))));
+
+  // The automatic checkpoint was written after the fourth tick, with the
+  // output of that tick still queued.
+  XLS_ASSERT_OK_AND_ASSIGN(checkpoint, ReadProcNetworkCheckpoint(path));
+  EXPECT_EQ(checkpoint.tick(), 4);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      restored,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {}));
+  XLS_ASSERT_OK(restored->Restore(checkpoint));
+  XLS_ASSERT_OK(restored->Tick());
+  EXPECT_THAT(restored->queue_manager().GetQueue(out_channel).GetContents(),
+              ElementsAre(Value(UBits(6, 32)), Value(UBits(10, 32))));
+
+  checkpoint.set_package("other");
+  EXPECT_THAT(restored->Restore(checkpoint),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Checkpoint is of package other")));
+}
+
+TEST_F(ProcNetworkInterpreterTest, PassThroughChainCreatedInReverse) {
+  // The procs are created downstream-first so each is blocked when first run
+  // and must be resumed when its upstream proc sends to it.
+  auto package = CreatePackage();
+  constexpr int64_t kChainLength = 5;
+  std::vector<Channel*> channels;
+  for (int64_t i = 0; i <= kChainLength; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        Channel * channel,
+        package->CreateStreamingChannel(
+            absl::StrCat("ch", i),
+            i == kChainLength ? ChannelOps::kSendOnly
+                              : ChannelOps::kSendReceive,
+            package->GetBitsType(32)));
+    channels.push_back(channel);
+  }
+  for (int64_t i = kChainLength - 1; i >= 0; --i) {
+    XLS_ASSERT_OK(CreatePassThroughProc(absl::StrCat("pass", i), channels[i],
+                                        channels[i + 1], package.get())
+                      .status());
+  }
+  XLS_ASSERT_OK(CreateIotaProc("iota", /*starting_value=*/5, /*step=*/5,
+                               channels[0], package.get())
+                    .status());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {}));
+  ChannelQueue& queue =
+      interpreter->queue_manager().GetQueue(channels[kChainLength]);
+
+  XLS_ASSERT_OK(interpreter->Tick());
+  EXPECT_EQ(queue.size(), 1);
+  XLS_ASSERT_OK(interpreter->Tick());
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(5, 32))));
+  EXPECT_THAT(queue.Dequeue(), IsOkAndHolds(Value(UBits(10, 32))));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(ProcNetworkInterpreterTest, BoundedChannelBackpressure) {
+  // The producer sends two values per iteration through a channel of capacity
+  // one, so its second send blocks until the consumer receives the first.
+  auto package = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package->CreateStreamingChannel("pair", ChannelOps::kSendReceive,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * out_channel,
+      package->CreateStreamingChannel("out", ChannelOps::kSendOnly,
+                                      package->GetBitsType(32)));
+  {
+    ProcBuilder pb("producer", /*init_value=*/Value(UBits(0, 32)),
+                   /*token_name=*/"tok", /*state_name=*/"prev", package.get());
+    BValue first = pb.Send(channel, pb.GetTokenParam(), pb.GetStateParam());
+    BValue second = pb.Send(
+        channel, first, pb.Add(pb.GetStateParam(), pb.Literal(UBits(1, 32))));
+    XLS_ASSERT_OK(
+        pb.Build(second, pb.Add(pb.GetStateParam(), pb.Literal(UBits(2, 32))))
+            .status());
+  }
+  {
+    ProcBuilder pb("consumer", /*init_value=*/Value::Tuple({}),
+                   /*token_name=*/"tok", /*state_name=*/"state", package.get());
+    BValue first = pb.Receive(channel, pb.GetTokenParam());
+    BValue second = pb.Receive(channel, pb.TupleIndex(first, 0));
+    BValue sum = pb.Add(pb.TupleIndex(first, 1), pb.TupleIndex(second, 1));
+    XLS_ASSERT_OK(
+        pb.Build(pb.Send(out_channel, pb.TupleIndex(second, 0), sum),
+                 pb.GetStateParam())
+            .status());
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {}));
+  ChannelQueue& queue = interpreter->queue_manager().GetQueue(channel);
+  queue.set_capacity(1);
+
+  XLS_ASSERT_OK(interpreter->Tick());
+  XLS_ASSERT_OK(interpreter->Tick());
+
+  ChannelQueue& out_queue = interpreter->queue_manager().GetQueue(out_channel);
+  EXPECT_THAT(out_queue.Dequeue(), IsOkAndHolds(Value(UBits(1, 32))));
+  EXPECT_THAT(out_queue.Dequeue(), IsOkAndHolds(Value(UBits(5, 32))));
+  EXPECT_EQ(queue.high_water_mark(), 1);
+  EXPECT_GT(queue.send_stall_count(), 0);
+}
+
 TEST_F(ProcNetworkInterpreterTest, DegenerateProc) {
   // Tests interpreting a proc with no send of receive nodes.
   auto package = CreatePackage();
@@ -482,5 +644,77 @@ TEST_F(ProcNetworkInterpreterTest, IotaWithChannelBackedgeAndTwoInitialValues) {
   EXPECT_THAT(output_queue.Dequeue(), IsOkAndHolds(Value(UBits(102, 32))));
 }
 
+TEST_F(ProcNetworkInterpreterTest, ClockDomainCrossing) {
+  // A producer in a fast domain feeds a pass-through proc in a domain clocked
+  // at half the rate through an asynchronous FIFO with two-flop synchronizers.
+  auto package = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package->CreateStreamingChannel("cross", ChannelOps::kSendReceive,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * out_channel,
+      package->CreateStreamingChannel("out", ChannelOps::kSendOnly,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK(CreateIotaProc("iota", /*starting_value=*/0, /*step=*/1,
+                               channel, package.get())
+                    .status());
+  XLS_ASSERT_OK(
+      CreatePassThroughProc("pass", channel, out_channel, package.get())
+          .status());
+
+  ClockDomains domains;
+  domains.periods = {{"fast", 1}, {"slow", 2}};
+  domains.proc_domains = {{"iota", "fast"}, {"pass", "slow"}};
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(package.get(), /*rx_only_queues*/ {},
+                                     domains));
+  ChannelQueue& queue = interpreter->queue_manager().GetQueue(channel);
+  ChannelQueue& out_queue = interpreter->queue_manager().GetQueue(out_channel);
+
+  // The first value is sent at time 0 and becomes visible at the second edge
+  // of the slow clock after it.
+  while (out_queue.empty()) {
+    XLS_ASSERT_OK(interpreter->Tick());
+    ASSERT_LE(interpreter->current_time(), 4);
+  }
+  EXPECT_EQ(interpreter->current_time(), 4);
+
+  // From then on the slow proc receives a value at each of its edges while the
+  // producer is throttled by the depth of the FIFO.
+  while (interpreter->current_time() < 12) {
+    XLS_ASSERT_OK(interpreter->Tick());
+  }
+  std::vector<Value> outputs;
+  while (!out_queue.empty()) {
+    XLS_ASSERT_OK_AND_ASSIGN(Value value, out_queue.Dequeue());
+    outputs.push_back(value);
+  }
+  EXPECT_THAT(outputs,
+              ElementsAre(Value(UBits(0, 32)), Value(UBits(1, 32)),
+                          Value(UBits(2, 32)), Value(UBits(3, 32)),
+                          Value(UBits(4, 32))));
+  EXPECT_GT(queue.send_stall_count(), 0);
+}
+
+TEST_F(ProcNetworkInterpreterTest, ProcWithoutClockDomain) {
+  auto package = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Channel * channel,
+      package->CreateStreamingChannel("iota_out", ChannelOps::kSendOnly,
+                                      package->GetBitsType(32)));
+  XLS_ASSERT_OK(CreateIotaProc("iota", /*starting_value=*/0, /*step=*/1,
+                               channel, package.get())
+                    .status());
+  ClockDomains domains;
+  domains.periods = {{"fast", 1}};
+  EXPECT_THAT(ProcNetworkInterpreter::Create(package.get(),
+                                             /*rx_only_queues*/ {}, domains)
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not assigned to a clock domain")));
+}
+
 }  // namespace
 }  // namespace xls
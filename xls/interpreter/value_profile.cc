@@ -0,0 +1,146 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/interpreter/value_profile.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "xls/common/logging/logging.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/number_parser.h"
+
+namespace xls {
+
+/* static */ NodeValueProfile NodeValueProfile::FromBits(const Bits& value) {
+  return NodeValueProfile{ternary_ops::BitsToTernary(value), value, value};
+}
+
+void NodeValueProfile::Note(const Bits& value) {
+  XLS_CHECK_EQ(value.bit_count(), known_bits.size());
+  known_bits =
+      ternary_ops::Equals(ternary_ops::BitsToTernary(value), known_bits);
+  if (bits_ops::ULessThan(value, min)) {
+    min = value;
+  }
+  if (bits_ops::UGreaterThan(value, max)) {
+    max = value;
+  }
+}
+
+void NodeValueProfile::Merge(const NodeValueProfile& other) {
+  XLS_CHECK_EQ(other.known_bits.size(), known_bits.size());
+  known_bits = ternary_ops::Equals(other.known_bits, known_bits);
+  if (bits_ops::ULessThan(other.min, min)) {
+    min = other.min;
+  }
+  if (bits_ops::UGreaterThan(other.max, max)) {
+    max = other.max;
+  }
+}
+
+int64_t NodeValueProfile::ObservedBitCount() const {
+  return max.bit_count() - max.CountLeadingZeros();
+}
+
+/* static */ absl::StatusOr<ValueProfile> ValueProfile::Parse(
+    absl::string_view text) {
+  ValueProfile profile;
+  int64_t line_number = 0;
+  for (absl::string_view line : absl::StrSplit(text, '\n')) {
+    ++line_number;
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    if (fields.empty() || fields[0][0] == '#') {
+      continue;
+    }
+    auto error = [&](absl::string_view message) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Invalid value profile line %d (%s): %s", line_number, message,
+          line));
+    };
+    if (fields.size() != 5) {
+      return error("expected 5 fields");
+    }
+    absl::StatusOr<TernaryVector> known_bits = StringToTernaryVector(fields[2]);
+    if (!known_bits.ok()) {
+      return error(known_bits.status().message());
+    }
+    int64_t bit_count = known_bits->size();
+    absl::StatusOr<Bits> min = ParseUnsignedNumberWithoutPrefix(
+        absl::StripPrefix(fields[3], "0x"), FormatPreference::kHex, bit_count);
+    absl::StatusOr<Bits> max = ParseUnsignedNumberWithoutPrefix(
+        absl::StripPrefix(fields[4], "0x"), FormatPreference::kHex, bit_count);
+    if (!min.ok() || !max.ok()) {
+      return error("invalid bounds");
+    }
+    profile.Note(fields[0], fields[1],
+                 NodeValueProfile{*std::move(known_bits), *std::move(min),
+                                  *std::move(max)});
+  }
+  return profile;
+}
+
+void ValueProfile::Note(absl::string_view function_name,
+                        absl::string_view node_name,
+                        const NodeValueProfile& profile) {
+  auto key = std::make_pair(std::string(function_name), std::string(node_name));
+  auto it = nodes_.find(key);
+  if (it == nodes_.end()) {
+    nodes_.emplace(std::move(key), profile);
+  } else {
+    it->second.Merge(profile);
+  }
+}
+
+void ValueProfile::Merge(const ValueProfile& other) {
+  for (const auto& item : other.nodes_) {
+    Note(item.first.first, item.first.second, item.second);
+  }
+}
+
+const NodeValueProfile* ValueProfile::Get(const Node* node) const {
+  auto it = nodes_.find(
+      std::make_pair(node->function_base()->name(), node->GetName()));
+  if (it == nodes_.end() || !node->GetType()->IsBits() ||
+      it->second.known_bits.size() != node->BitCountOrDie()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+std::string ValueProfile::ToString() const {
+  std::vector<std::pair<std::string, std::string>> keys;
+  keys.reserve(nodes_.size());
+  for (const auto& item : nodes_) {
+    keys.push_back(item.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::string result;
+  for (const auto& key : keys) {
+    const NodeValueProfile& profile = nodes_.at(key);
+    absl::StrAppendFormat(&result, "%s %s %s 0x%s 0x%s\n", key.first,
+                          key.second, xls::ToString(profile.known_bits),
+                          profile.min.ToRawDigits(FormatPreference::kHex),
+                          profile.max.ToRawDigits(FormatPreference::kHex));
+  }
+  return result;
+}
+
+}  // namespace xls
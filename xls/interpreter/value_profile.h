@@ -0,0 +1,95 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_INTERPRETER_VALUE_PROFILE_H_
+#define XLS_INTERPRETER_VALUE_PROFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/node.h"
+#include "xls/ir/ternary.h"
+
+namespace xls {
+
+// The values observed for a bits-typed node over a set of evaluations.
+struct NodeValueProfile {
+  // The bits which had the same value in every evaluation; the others are
+  // unknown.
+  TernaryVector known_bits;
+
+  // The smallest and largest observed values, as unsigned numbers.
+  Bits min;
+  Bits max;
+
+  static NodeValueProfile FromBits(const Bits& value);
+
+  // Adds another observed value, or the observations of another profile, to
+  // this one. The bit counts must match.
+  void Note(const Bits& value);
+  void Merge(const NodeValueProfile& other);
+
+  // Returns the number of bits needed to hold the largest observed value.
+  int64_t ObservedBitCount() const;
+};
+
+// The observed values of the nodes of a package, e.g., as collected by an
+// InterpreterStats over the evaluation of a real workload. Nodes are
+// identified by the name of their function and their own name, so a profile
+// remains applicable to the IR text it was collected from after reparsing.
+//
+// Profiles are stored as text with one line per node:
+//
+//   <function> <node> <known bits> <min> <max>
+//
+// where the known bits are formatted as by ToString(TernaryVector) and the
+// bounds are unsigned hexadecimal numbers; for example:
+//
+//   main add.3 0b000000XX 0x0 0x3
+//
+// Empty lines and lines starting with '#' are ignored.
+class ValueProfile {
+ public:
+  static absl::StatusOr<ValueProfile> Parse(absl::string_view text);
+
+  // Merges the observations of a node into the profile.
+  void Note(absl::string_view function_name, absl::string_view node_name,
+            const NodeValueProfile& profile);
+
+  // Merges all observations of "other" into this profile.
+  void Merge(const ValueProfile& other);
+
+  // Returns the observations of the given node, or nullptr if the profile has
+  // none.
+  const NodeValueProfile* Get(const Node* node) const;
+
+  int64_t size() const { return nodes_.size(); }
+
+  // Returns the profile in the text format, sorted by function and node name.
+  std::string ToString() const;
+
+ private:
+  absl::flat_hash_map<std::pair<std::string, std::string>, NodeValueProfile>
+      nodes_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_VALUE_PROFILE_H_
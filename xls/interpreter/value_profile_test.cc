@@ -0,0 +1,105 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/interpreter/value_profile.h"
+
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/ternary.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(ValueProfileTest, NoteValues) {
+  NodeValueProfile profile = NodeValueProfile::FromBits(UBits(0b0101, 8));
+  profile.Note(UBits(0b0011, 8));
+  EXPECT_EQ(ToString(profile.known_bits), "0b00000XX1");
+  EXPECT_EQ(profile.min, UBits(3, 8));
+  EXPECT_EQ(profile.max, UBits(5, 8));
+  EXPECT_EQ(profile.ObservedBitCount(), 3);
+
+  NodeValueProfile other = NodeValueProfile::FromBits(UBits(0x80, 8));
+  profile.Merge(other);
+  EXPECT_EQ(ToString(profile.known_bits), "0bX0000XXX");
+  EXPECT_EQ(profile.min, UBits(3, 8));
+  EXPECT_EQ(profile.max, UBits(0x80, 8));
+  EXPECT_EQ(profile.ObservedBitCount(), 8);
+}
+
+TEST(ValueProfileTest, RoundTrip) {
+  ValueProfile profile;
+  profile.Note("main", "add.3", NodeValueProfile::FromBits(UBits(2, 4)));
+  profile.Note("main", "add.3", NodeValueProfile::FromBits(UBits(1, 4)));
+  profile.Note("f", "x", NodeValueProfile::FromBits(UBits(0xabcdef, 100)));
+  EXPECT_EQ(profile.size(), 2);
+  std::string text = profile.ToString();
+  EXPECT_EQ(text, absl::StrCat("f x 0b", std::string(76, '0'),
+                               "101010111100110111101111 0xab_cdef "
+                               "0xab_cdef\n"
+                               "main add.3 0b00XX 0x1 0x2\n"));
+  XLS_ASSERT_OK_AND_ASSIGN(ValueProfile parsed,
+                           ValueProfile::Parse(absl::StrCat(
+                               "# Comment.\n\n", text)));
+  EXPECT_EQ(parsed.ToString(), text);
+}
+
+TEST(ValueProfileTest, GetNode) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(
+package p
+
+fn main(x: bits[4], y: bits[4]) -> bits[4] {
+  ret add.3: bits[4] = add(x, y)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(ValueProfile profile, ValueProfile::Parse(R"(
+main add.3 0b00XX 0x1 0x2
+main x 0b0XX 0x0 0x3
+)"));
+  const NodeValueProfile* add_profile = profile.Get(f->return_value());
+  ASSERT_NE(add_profile, nullptr);
+  EXPECT_EQ(add_profile->max, UBits(2, 4));
+  // The width of the profiled "x" doesn't match.
+  XLS_ASSERT_OK_AND_ASSIGN(Node * x, f->GetNode("x"));
+  EXPECT_EQ(profile.Get(x), nullptr);
+  XLS_ASSERT_OK_AND_ASSIGN(Node * y, f->GetNode("y"));
+  EXPECT_EQ(profile.Get(y), nullptr);
+}
+
+TEST(ValueProfileTest, ParseErrors) {
+  EXPECT_THAT(ValueProfile::Parse("main add.3 0b00XX 0x1"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("line 1 (expected 5 fields)")));
+  EXPECT_THAT(ValueProfile::Parse("\nmain add.3 0b00Z 0x1 0x2"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("line 2 (Invalid ternary string")));
+  EXPECT_THAT(ValueProfile::Parse("main add.3 0b00XX 0x1 0xq"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("invalid bounds")));
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,454 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/view_interpreter.h"
+
+#include <cstring>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/bits_evaluator.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+// All storage in the arena is aligned to this many bytes.
+constexpr int64_t kArenaAlignment = 8;
+
+}  // namespace
+
+/* static */ absl::StatusOr<std::unique_ptr<ViewInterpreter>>
+ViewInterpreter::Create(Function* function, const TypeLayout* layout) {
+  auto interpreter = absl::WrapUnique(new ViewInterpreter(function, layout));
+  XLS_RETURN_IF_ERROR(interpreter->Init());
+  return interpreter;
+}
+
+absl::Status ViewInterpreter::Init() {
+  // Only nodes the return value depends on are evaluated, as in IrInterpreter.
+  absl::flat_hash_set<Node*> live;
+  std::vector<Node*> worklist = {function_->return_value()};
+  while (!worklist.empty()) {
+    Node* node = worklist.back();
+    worklist.pop_back();
+    if (live.insert(node).second) {
+      worklist.insert(worklist.end(), node->operands().begin(),
+                      node->operands().end());
+    }
+  }
+
+  absl::flat_hash_map<Node*, int64_t> slots;
+  for (Node* node : TopoSort(function_)) {
+    if (!live.contains(node)) {
+      continue;
+    }
+    XLS_RETURN_IF_ERROR(AddStep(node, slots));
+    slots[node] = steps_.size() - 1;
+  }
+  return_slot_ = slots.at(function_->return_value());
+  return_type_size_ =
+      layout_->GetTypeByteSize(function_->return_value()->GetType());
+
+  // Zero-filled so that padding never holds uninitialized data.
+  arena_ = std::make_unique<uint8_t[]>(std::max(arena_size_, int64_t{1}));
+  values_.resize(steps_.size(), arena_.get());
+  for (int64_t i = 0; i < steps_.size(); ++i) {
+    Step& step = steps_[i];
+    if (step.offset >= 0) {
+      values_[i] = Storage(step);
+    }
+    if (step.node->Is<Literal>()) {
+      MutableValueView(Storage(step), step.node->GetType(), layout_)
+          .SetValue(step.node->As<Literal>()->value());
+    }
+  }
+  return absl::OkStatus();
+}
+
+int64_t ViewInterpreter::Allocate(int64_t size) {
+  int64_t offset = arena_size_;
+  arena_size_ += RoundUpToNearest(size, kArenaAlignment);
+  return offset;
+}
+
+absl::StatusOr<ViewInterpreter*> ViewInterpreter::GetCallee(Function* callee) {
+  auto it = callees_.find(callee);
+  if (it == callees_.end()) {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<ViewInterpreter> interpreter,
+                         Create(callee, layout_));
+    it = callees_.insert({callee, std::move(interpreter)}).first;
+  }
+  return it->second.get();
+}
+
+absl::Status ViewInterpreter::AddStep(
+    Node* node, const absl::flat_hash_map<Node*, int64_t>& slots) {
+  Step step;
+  step.node = node;
+  for (Node* operand : node->operands()) {
+    step.operands.push_back(slots.at(operand));
+  }
+  step.size = layout_->GetTypeByteSize(node->GetType());
+
+  auto add_dimensions = [&](Type* type, int64_t index_count) {
+    for (int64_t i = 0; i < index_count; ++i) {
+      ArrayType* array_type = type->AsArrayOrDie();
+      type = array_type->element_type();
+      step.dimensions.push_back(
+          {array_type->size(), layout_->GetTypeByteSize(type)});
+    }
+  };
+  auto set_callee = [&](Function* callee) -> absl::Status {
+    XLS_ASSIGN_OR_RETURN(step.callee, GetCallee(callee));
+    step.callee_args.resize(callee->params().size());
+    return absl::OkStatus();
+  };
+
+  switch (node->op()) {
+    case Op::kParam: {
+      XLS_ASSIGN_OR_RETURN(int64_t index,
+                           function_->GetParamIndex(node->As<Param>()));
+      step.offsets.push_back(index);
+      break;
+    }
+    case Op::kIdentity:
+    case Op::kSel:
+      break;
+    case Op::kTupleIndex:
+      step.offsets.push_back(layout_->GetTupleElementOffset(
+          node->operand(0)->GetType()->AsTupleOrDie(),
+          node->As<TupleIndex>()->index()));
+      break;
+    case Op::kArrayIndex: {
+      ArrayIndex* index = node->As<ArrayIndex>();
+      add_dimensions(index->array()->GetType(), index->indices().size());
+      break;
+    }
+    case Op::kArrayUpdate: {
+      ArrayUpdate* update = node->As<ArrayUpdate>();
+      add_dimensions(update->GetType(), update->indices().size());
+      step.offset = Allocate(step.size);
+      break;
+    }
+    case Op::kTuple: {
+      TupleType* tuple_type = node->GetType()->AsTupleOrDie();
+      for (int64_t i = 0; i < tuple_type->size(); ++i) {
+        step.offsets.push_back(
+            layout_->GetTupleElementOffset(tuple_type, i));
+      }
+      step.offset = Allocate(step.size);
+      break;
+    }
+    case Op::kInvoke:
+      XLS_RETURN_IF_ERROR(set_callee(node->As<Invoke>()->to_apply()));
+      step.offset = Allocate(step.size);
+      break;
+    case Op::kMap:
+      XLS_RETURN_IF_ERROR(set_callee(node->As<Map>()->to_apply()));
+      step.offsets.push_back(layout_->GetTypeByteSize(
+          node->operand(0)->GetType()->AsArrayOrDie()->element_type()));
+      step.offsets.push_back(layout_->GetTypeByteSize(
+          node->GetType()->AsArrayOrDie()->element_type()));
+      step.offset = Allocate(step.size);
+      break;
+    case Op::kCountedFor:
+    case Op::kDynamicCountedFor: {
+      Function* body = node->Is<CountedFor>()
+                           ? node->As<CountedFor>()->body()
+                           : node->As<DynamicCountedFor>()->body();
+      XLS_RETURN_IF_ERROR(set_callee(body));
+      step.scratch_offset =
+          Allocate(layout_->GetTypeByteSize(body->param(0)->GetType()));
+      step.offset = Allocate(step.size);
+      break;
+    }
+    case Op::kAfterAll:
+    case Op::kAssert:
+    case Op::kArray:
+    case Op::kArrayConcat:
+    case Op::kLiteral:
+    case Op::kOneHotSel:
+      step.offset = Allocate(step.size);
+      break;
+    case Op::kReceive:
+    case Op::kReceiveIf:
+    case Op::kSend:
+    case Op::kSendIf:
+      return absl::UnimplementedError(
+          absl::StrFormat("Channel operations are not supported by "
+                          "ViewInterpreter: %s",
+                          node->ToString()));
+    default: {
+      bool all_bits = node->GetType()->IsBits();
+      for (Node* operand : node->operands()) {
+        all_bits = all_bits && operand->GetType()->IsBits();
+      }
+      if (!all_bits) {
+        return absl::UnimplementedError(
+            absl::StrFormat("Interpreter does not support operation '%s' with "
+                            "non-bits type operand",
+                            OpToString(node->op())));
+      }
+      step.offset = Allocate(step.size);
+      break;
+    }
+  }
+  steps_.push_back(std::move(step));
+  return absl::OkStatus();
+}
+
+absl::Status ViewInterpreter::Run(absl::Span<const uint8_t* const> args,
+                                  absl::Span<uint8_t> result) {
+  XLS_RET_CHECK_EQ(args.size(), function_->params().size());
+  XLS_RET_CHECK_GE(result.size(), return_type_size_);
+  for (Step& step : steps_) {
+    XLS_RETURN_IF_ERROR(Evaluate(step, args));
+  }
+  // The return value may be (part of) an argument, which may in turn be the
+  // result buffer.
+  std::memmove(result.data(), values_[return_slot_], return_type_size_);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> ViewInterpreter::Run(absl::Span<const Value> args) {
+  if (args.size() != function_->params().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Function %s wants %d arguments, got %d.", function_->name(),
+        function_->params().size(), args.size()));
+  }
+  std::vector<std::unique_ptr<uint8_t[]>> arg_storage;
+  std::vector<const uint8_t*> arg_buffers;
+  for (int64_t i = 0; i < args.size(); ++i) {
+    Type* param_type = function_->param(i)->GetType();
+    if (function_->package()->GetTypeForValue(args[i]) != param_type) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Got argument %s for parameter %d which is not of type %s",
+          args[i].ToString(), i, param_type->ToString()));
+    }
+    arg_storage.push_back(
+        std::make_unique<uint8_t[]>(layout_->GetTypeByteSize(param_type)));
+    MutableValueView(arg_storage.back().get(), param_type, layout_)
+        .SetValue(args[i]);
+    arg_buffers.push_back(arg_storage.back().get());
+  }
+  auto result = std::make_unique<uint8_t[]>(return_type_size_);
+  XLS_RETURN_IF_ERROR(
+      Run(arg_buffers, absl::MakeSpan(result.get(), return_type_size_)));
+  return ValueView(result.get(), function_->return_value()->GetType(), layout_)
+      .ToValue();
+}
+
+absl::Status ViewInterpreter::Evaluate(Step& step,
+                                       absl::Span<const uint8_t* const> args) {
+  Node* node = step.node;
+  int64_t slot = &step - steps_.data();
+  switch (node->op()) {
+    case Op::kParam:
+      values_[slot] = args[step.offsets[0]];
+      return absl::OkStatus();
+    case Op::kIdentity:
+      values_[slot] = values_[step.operands[0]];
+      return absl::OkStatus();
+    case Op::kLiteral:
+    case Op::kAfterAll:
+      return absl::OkStatus();
+    case Op::kAssert:
+      if (!Operand(step, 1).GetBits().IsAllOnes()) {
+        return absl::AbortedError(node->As<Assert>()->message());
+      }
+      return absl::OkStatus();
+    case Op::kTupleIndex:
+      values_[slot] = values_[step.operands[0]] + step.offsets[0];
+      return absl::OkStatus();
+    case Op::kTuple: {
+      uint8_t* storage = Storage(step);
+      for (int64_t i = 0; i < step.operands.size(); ++i) {
+        std::memcpy(storage + step.offsets[i], values_[step.operands[i]],
+                    steps_[step.operands[i]].size);
+      }
+      return absl::OkStatus();
+    }
+    case Op::kArray:
+    case Op::kArrayConcat: {
+      uint8_t* storage = Storage(step);
+      for (int64_t operand : step.operands) {
+        std::memcpy(storage, values_[operand], steps_[operand].size);
+        storage += steps_[operand].size;
+      }
+      return absl::OkStatus();
+    }
+    case Op::kArrayIndex: {
+      // Out-of-bounds indices are clamped to the last element.
+      const uint8_t* element = values_[step.operands[0]];
+      for (int64_t i = 0; i < step.dimensions.size(); ++i) {
+        auto [size, element_size] = step.dimensions[i];
+        uint64_t index = BitsToBoundedUint64(Operand(step, i + 1).GetBits(),
+                                             size - 1);
+        element += index * element_size;
+      }
+      values_[slot] = element;
+      return absl::OkStatus();
+    }
+    case Op::kArrayUpdate: {
+      uint8_t* storage = Storage(step);
+      const Step& update_value = steps_[step.operands[1]];
+      if (step.dimensions.empty()) {
+        std::memcpy(storage, values_[step.operands[1]], update_value.size);
+        return absl::OkStatus();
+      }
+      std::memcpy(storage, values_[step.operands[0]], step.size);
+      // An out-of-bounds index in any dimension makes the update a no-op.
+      uint8_t* element = storage;
+      for (int64_t i = 0; i < step.dimensions.size(); ++i) {
+        auto [size, element_size] = step.dimensions[i];
+        uint64_t index =
+            BitsToBoundedUint64(Operand(step, i + 2).GetBits(), size);
+        if (index >= size) {
+          return absl::OkStatus();
+        }
+        element += index * element_size;
+      }
+      std::memcpy(element, values_[step.operands[1]], update_value.size);
+      return absl::OkStatus();
+    }
+    case Op::kSel: {
+      Select* sel = node->As<Select>();
+      uint64_t index =
+          BitsToBoundedUint64(Operand(step, 0).GetBits(), sel->cases().size());
+      if (index >= sel->cases().size()) {
+        XLS_RET_CHECK(sel->default_value().has_value());
+        values_[slot] = values_[step.operands.back()];
+      } else {
+        values_[slot] = values_[step.operands[index + 1]];
+      }
+      return absl::OkStatus();
+    }
+    case Op::kOneHotSel: {
+      // Unused bits of a bits value are zero and padding is unspecified, so
+      // the selected cases can be OR-ed together one byte at a time.
+      uint8_t* storage = Storage(step);
+      std::memset(storage, 0, step.size);
+      Bits selector = Operand(step, 0).GetBits();
+      for (int64_t i = 0; i < selector.bit_count(); ++i) {
+        if (selector.Get(i)) {
+          const uint8_t* input = values_[step.operands[i + 1]];
+          for (int64_t j = 0; j < step.size; ++j) {
+            storage[j] |= input[j];
+          }
+        }
+      }
+      return absl::OkStatus();
+    }
+    case Op::kInvoke:
+      for (int64_t i = 0; i < step.operands.size(); ++i) {
+        step.callee_args[i] = values_[step.operands[i]];
+      }
+      return step.callee->Run(step.callee_args,
+                              absl::MakeSpan(Storage(step), step.size));
+    case Op::kMap: {
+      int64_t input_size = step.offsets[0];
+      int64_t output_size = step.offsets[1];
+      int64_t count = node->GetType()->AsArrayOrDie()->size();
+      for (int64_t i = 0; i < count; ++i) {
+        step.callee_args[0] = values_[step.operands[0]] + i * input_size;
+        XLS_RETURN_IF_ERROR(step.callee->Run(
+            step.callee_args,
+            absl::MakeSpan(Storage(step) + i * output_size, output_size)));
+      }
+      return absl::OkStatus();
+    }
+    case Op::kCountedFor:
+      return EvaluateCountedFor(step);
+    case Op::kDynamicCountedFor:
+      return EvaluateDynamicCountedFor(step);
+    default:
+      return EvaluateBits(step);
+  }
+}
+
+absl::Status ViewInterpreter::EvaluateBits(const Step& step) {
+  absl::InlinedVector<Bits, 3> operands;
+  operands.reserve(step.operands.size());
+  for (int64_t i = 0; i < step.operands.size(); ++i) {
+    operands.push_back(Operand(step, i).GetBits());
+  }
+  XLS_ASSIGN_OR_RETURN(Bits result, EvaluateBitsNode(step.node, operands));
+  XLS_RET_CHECK_EQ(result.bit_count(), step.node->BitCountOrDie());
+  MutableValueView(Storage(step), step.node->GetType(), layout_)
+      .SetBits(result);
+  return absl::OkStatus();
+}
+
+// The loop state lives in the node's own storage; each iteration of the body
+// reads it as an argument and overwrites it with the result.
+absl::Status ViewInterpreter::EvaluateCountedFor(Step& step) {
+  CountedFor* counted_for = step.node->As<CountedFor>();
+  uint8_t* state = Storage(step);
+  uint8_t* index = arena_.get() + step.scratch_offset;
+  std::memcpy(state, values_[step.operands[0]], step.size);
+  step.callee_args[0] = index;
+  step.callee_args[1] = state;
+  for (int64_t i = 1; i < step.operands.size(); ++i) {
+    step.callee_args[i + 1] = values_[step.operands[i]];
+  }
+  Type* index_type = counted_for->body()->param(0)->GetType();
+  MutableValueView index_view(index, index_type, layout_);
+  for (int64_t i = 0, iv = 0; i < counted_for->trip_count();
+       ++i, iv += counted_for->stride()) {
+    index_view.SetBits(UBits(iv, index_type->AsBitsOrDie()->bit_count()));
+    XLS_RETURN_IF_ERROR(
+        step.callee->Run(step.callee_args, absl::MakeSpan(state, step.size)));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ViewInterpreter::EvaluateDynamicCountedFor(Step& step) {
+  DynamicCountedFor* loop = step.node->As<DynamicCountedFor>();
+  uint8_t* state = Storage(step);
+  uint8_t* index_storage = arena_.get() + step.scratch_offset;
+  std::memcpy(state, values_[step.operands[0]], step.size);
+  step.callee_args[0] = index_storage;
+  step.callee_args[1] = state;
+  for (int64_t i = 3; i < step.operands.size(); ++i) {
+    step.callee_args[i - 1] = values_[step.operands[i]];
+  }
+
+  Bits trip_count_unsigned = Operand(step, 1).GetBits();
+  Bits trip_count = bits_ops::ZeroExtend(trip_count_unsigned,
+                                         trip_count_unsigned.bit_count() + 1);
+  Bits stride = Operand(step, 2).GetBits();
+  Bits index_limit = bits_ops::SMul(trip_count, stride);
+  Type* index_type = loop->body()->param(0)->GetType();
+  Bits index(index_type->AsBitsOrDie()->bit_count());
+  Bits extended_stride = bits_ops::SignExtend(stride, index.bit_count());
+  MutableValueView index_view(index_storage, index_type, layout_);
+  while (!bits_ops::SEqual(index, index_limit)) {
+    index_view.SetBits(index);
+    XLS_RETURN_IF_ERROR(
+        step.callee->Run(step.callee_args, absl::MakeSpan(state, step.size)));
+    index = bits_ops::Add(index, extended_stride);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace xls
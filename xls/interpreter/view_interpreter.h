@@ -0,0 +1,140 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_VIEW_INTERPRETER_H_
+#define XLS_INTERPRETER_VIEW_INTERPRETER_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+#include "xls/ir/value_view.h"
+
+namespace xls {
+
+// An interpreter which evaluates a function directly on flat buffers:
+// arguments are read from, and the result written to, buffers laid out as
+// described by a TypeLayout. With the JIT's layout (JitRuntime is a
+// TypeLayout), the same buffers can be passed to IrJit::RunWithViews or to the
+// interpreter without converting to and from Values.
+//
+// Storage for every node is allocated in a single arena when the interpreter
+// is created and is reused by each Run(), so evaluation doesn't allocate per
+// node. Nodes whose value is part of another value (params, identities,
+// selects, tuple and array indices) aren't copied at all; they refer to the
+// storage they were taken from.
+//
+// Results are identical to those of IrInterpreter. Channel operations are not
+// supported.
+class ViewInterpreter {
+ public:
+  // 'layout' must outlive the interpreter.
+  static absl::StatusOr<std::unique_ptr<ViewInterpreter>> Create(
+      Function* function, const TypeLayout* layout);
+
+  // Evaluates the function. 'args' holds a buffer for each parameter and
+  // 'result' must be large enough to hold the return value; it may alias an
+  // argument. Not thread-safe: concurrent callers need separate interpreters.
+  absl::Status Run(absl::Span<const uint8_t* const> args,
+                   absl::Span<uint8_t> result);
+
+  // Convenience wrapper which packs 'args' into and unpacks the result from
+  // buffers in the interpreter's layout.
+  absl::StatusOr<Value> Run(absl::Span<const Value> args);
+
+  Function* function() const { return function_; }
+  const TypeLayout* layout() const { return layout_; }
+
+  // Returns the number of bytes of storage needed for the return value.
+  int64_t GetReturnTypeSize() const { return return_type_size_; }
+
+ private:
+  // The precomputed evaluation of a single node.
+  struct Step {
+    Node* node;
+    // Indices in values_ of the node's operands.
+    std::vector<int64_t> operands;
+    // Number of bytes of storage for the node's value.
+    int64_t size;
+    // Offset of the node's storage in the arena, or -1 if the node's value
+    // refers to other storage.
+    int64_t offset = -1;
+    // Op-specific byte offsets or sizes: the element offsets of a tuple, the
+    // element offset selected by a tuple_index, the operand and result element
+    // sizes of a map, the index of a param.
+    std::vector<int64_t> offsets;
+    // For array_index and array_update, the size and element byte size of each
+    // indexed dimension.
+    std::vector<std::pair<int64_t, int64_t>> dimensions;
+    // The interpreter for the function applied by this node, if any, along
+    // with space for its argument pointers and loop index.
+    ViewInterpreter* callee = nullptr;
+    std::vector<const uint8_t*> callee_args;
+    int64_t scratch_offset = -1;
+  };
+
+  ViewInterpreter(Function* function, const TypeLayout* layout)
+      : function_(function), layout_(layout) {}
+
+  absl::Status Init();
+
+  // Builds the step for the given node, allocating any storage it needs.
+  absl::Status AddStep(Node* node,
+                       const absl::flat_hash_map<Node*, int64_t>& slots);
+
+  // Returns the interpreter for the given callee, creating it if necessary.
+  absl::StatusOr<ViewInterpreter*> GetCallee(Function* callee);
+
+  // Reserves 'size' bytes of the arena, returning the offset.
+  int64_t Allocate(int64_t size);
+
+  absl::Status Evaluate(Step& step, absl::Span<const uint8_t* const> args);
+  absl::Status EvaluateBits(const Step& step);
+  absl::Status EvaluateCountedFor(Step& step);
+  absl::Status EvaluateDynamicCountedFor(Step& step);
+
+  // Returns a view of the value of the operand_no'th operand of 'step'.
+  ValueView Operand(const Step& step, int64_t operand_no) const {
+    return ValueView(values_[step.operands[operand_no]],
+                     step.node->operand(operand_no)->GetType(), layout_);
+  }
+
+  uint8_t* Storage(const Step& step) { return arena_.get() + step.offset; }
+
+  Function* function_;
+  const TypeLayout* layout_;
+
+  std::vector<Step> steps_;
+  int64_t return_slot_;
+  int64_t return_type_size_;
+
+  std::unique_ptr<uint8_t[]> arena_;
+  int64_t arena_size_ = 0;
+
+  // The storage holding the value of each step.
+  std::vector<const uint8_t*> values_;
+
+  absl::flat_hash_map<Function*, std::unique_ptr<ViewInterpreter>> callees_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_VIEW_INTERPRETER_H_
@@ -0,0 +1,183 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/view_interpreter.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_evaluator_test.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/keyword_args.h"
+#include "xls/ir/package.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls {
+namespace {
+
+// A layout with no padding at all: tuple elements are stored back-to-back.
+class PackedLayout : public TypeLayout {
+ public:
+  int64_t GetTypeByteSize(const Type* type) const override {
+    switch (type->kind()) {
+      case TypeKind::kBits:
+        return CeilOfRatio(type->AsBitsOrDie()->bit_count(), int64_t{8});
+      case TypeKind::kTuple:
+        return GetTupleElementOffset(type->AsTupleOrDie(),
+                                     type->AsTupleOrDie()->size());
+      case TypeKind::kArray:
+        return type->AsArrayOrDie()->size() *
+               GetTypeByteSize(type->AsArrayOrDie()->element_type());
+      case TypeKind::kToken:
+        return 0;
+    }
+    return 0;
+  }
+
+  int64_t GetTupleElementOffset(const TupleType* type,
+                                int64_t index) const override {
+    int64_t offset = 0;
+    for (int64_t i = 0; i < index; ++i) {
+      offset += GetTypeByteSize(type->element_type(i));
+    }
+    return offset;
+  }
+};
+
+absl::StatusOr<Value> RunWithJitLayout(Function* function,
+                                       absl::Span<const Value> args) {
+  XLS_ASSIGN_OR_RETURN(auto jit, IrJit::Create(function));
+  XLS_ASSIGN_OR_RETURN(auto interpreter,
+                       ViewInterpreter::Create(function, jit->runtime()));
+  return interpreter->Run(args);
+}
+
+absl::StatusOr<Value> RunWithPackedLayout(Function* function,
+                                          absl::Span<const Value> args) {
+  PackedLayout layout;
+  XLS_ASSIGN_OR_RETURN(auto interpreter,
+                       ViewInterpreter::Create(function, &layout));
+  return interpreter->Run(args);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ViewInterpreterJitLayoutTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function, const std::vector<Value>& args) {
+          return RunWithJitLayout(function, args);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs)
+            -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(std::vector<Value> args,
+                               KeywordArgsToPositional(*function, kwargs));
+          return RunWithJitLayout(function, args);
+        })));
+
+INSTANTIATE_TEST_SUITE_P(
+    ViewInterpreterPackedLayoutTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function, const std::vector<Value>& args) {
+          return RunWithPackedLayout(function, args);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs)
+            -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(std::vector<Value> args,
+                               KeywordArgsToPositional(*function, kwargs));
+          return RunWithPackedLayout(function, args);
+        })));
+
+// The interpreter and the JIT can be run on the same buffers.
+TEST(ViewInterpreterTest, SharesBuffersWithJit) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: (bits[3], bits[64]), y: bits[17][4]) -> (bits[17][4], bits[64]) {
+    x0: bits[3] = tuple_index(x, index=0)
+    x1: bits[64] = tuple_index(x, index=1)
+    y_elem: bits[17] = array_index(y, indices=[x0])
+    ext: bits[64] = zero_ext(y_elem, new_bit_count=64)
+    sum: bits[64] = add(x1, ext)
+    truncated: bits[17] = bit_slice(sum, start=0, width=17)
+    new_y: bits[17][4] = array_update(y, truncated, indices=[x0])
+    ret result: (bits[17][4], bits[64]) = tuple(new_y, sum)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           ViewInterpreter::Create(function, jit->runtime()));
+  EXPECT_EQ(interpreter->GetReturnTypeSize(), jit->GetReturnTypeSize());
+
+  Value x = Value::Tuple({Value(UBits(2, 3)), Value(UBits(1000, 64))});
+  Value y = Value::UBitsArray({1, 2, 3, 4}, 17).value();
+  std::vector<std::unique_ptr<uint8_t[]>> storage;
+  std::vector<uint8_t*> args;
+  for (int64_t i = 0; i < 2; ++i) {
+    storage.push_back(std::make_unique<uint8_t[]>(jit->GetArgTypeSize(i)));
+    args.push_back(storage.back().get());
+  }
+  XLS_ASSERT_OK(jit->runtime()->PackArgs(
+      {x, y}, {function->param(0)->GetType(), function->param(1)->GetType()},
+      absl::MakeSpan(args)));
+
+  std::vector<uint8_t> jit_result(jit->GetReturnTypeSize());
+  std::vector<uint8_t> interpreter_result(jit->GetReturnTypeSize());
+  XLS_ASSERT_OK(jit->RunWithViews(absl::MakeSpan(args),
+                                  absl::MakeSpan(jit_result)));
+  XLS_ASSERT_OK(interpreter->Run(std::vector<const uint8_t*>(args.begin(),
+                                                             args.end()),
+                                 absl::MakeSpan(interpreter_result)));
+
+  Type* return_type = function->return_value()->GetType();
+  Value expected = Value::Tuple(
+      {Value::UBitsArray({1, 2, 1003, 4}, 17).value(), Value(UBits(1003, 64))});
+  EXPECT_EQ(jit->runtime()->UnpackBuffer(jit_result.data(), return_type),
+            expected);
+  EXPECT_EQ(
+      jit->runtime()->UnpackBuffer(interpreter_result.data(), return_type),
+      expected);
+}
+
+// The arena is reused across runs, and the result may be written over an
+// argument.
+TEST(ViewInterpreterTest, ReuseAndAliasedResult) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: (bits[8], bits[8])) -> (bits[8], bits[8]) {
+    a: bits[8] = tuple_index(x, index=0)
+    b: bits[8] = tuple_index(x, index=1)
+    sum: bits[8] = add(a, b)
+    ret result: (bits[8], bits[8]) = tuple(b, sum)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  PackedLayout layout;
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           ViewInterpreter::Create(function, &layout));
+
+  // Repeatedly feeding the result back in computes Fibonacci numbers.
+  uint8_t state[2] = {0, 1};
+  for (int64_t i = 0; i < 10; ++i) {
+    XLS_ASSERT_OK(interpreter->Run({state}, absl::MakeSpan(state)));
+  }
+  EXPECT_EQ(state[0], 55);
+  EXPECT_EQ(state[1], 89);
+}
+
+}  // namespace
+}  // namespace xls
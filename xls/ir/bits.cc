@@ -245,11 +245,7 @@ Bits Bits::Slice(int64_t start, int64_t width) const {
   XLS_CHECK_LE(start + width, bit_count())
       << "start: " << start << " width: " << width;
   Bits result(width);
-  for (int64_t i = 0; i < width; ++i) {
-    if (Get(start + i)) {
-      result.bitmap_.Set(i, true);
-    }
-  }
+  result.bitmap_.Copy(/*dest_offset=*/0, bitmap_, start, width);
   return result;
 }
 
@@ -299,22 +295,23 @@ std::string Bits::ToRawDigits(FormatPreference preference,
   const int64_t digit_width = preference == FormatPreference::kBinary ? 1 : 4;
   const int64_t digit_count = CeilOfRatio(bit_count(), digit_width);
   std::string result;
+  result.reserve(digit_count + digit_count / kSeparatorPeriod);
   bool eliding_leading_zeros = !emit_leading_zeros;
   for (int64_t digit_no = digit_count - 1; digit_no >= 0; --digit_no) {
     // Add a '_' every kSeparatorPeriod digits.
     if (((digit_no + 1) % kSeparatorPeriod == 0) && !result.empty()) {
-      absl::StrAppend(&result, "_");
+      result.push_back('_');
     }
-    // Slice out a Bits which contains 1 digit.
+    // Read the digit straight out of the bitmap; this is the hot loop when
+    // dumping large literals.
     int64_t start = digit_no * digit_width;
     int64_t width = std::min(digit_width, bit_count() - start);
-    // As single digit necessarily fits in a uint64_t, so the value() is safe.
-    uint64_t digit_value = Slice(start, width).ToUint64().value();
+    uint64_t digit_value = bitmap_.GetBits(start, width);
     if (digit_value == 0 && eliding_leading_zeros && digit_no != 0) {
       continue;
     }
     eliding_leading_zeros = false;
-    absl::StrAppend(&result, absl::StrFormat("%x", digit_value));
+    result.push_back("0123456789abcdef"[digit_value]);
   }
   return result;
 }
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <numeric>
 #include <string>
+#include <utility>
 
 #include "absl/base/casts.h"
 #include "absl/status/statusor.h"
@@ -228,11 +229,19 @@ class Bits {
   // (Zero-bit values get 0 by convention.)
   absl::StatusOr<uint64_t> WordToUint64(int64_t word_number) const;
 
+  // Returns the bitmap backing this value, for word-at-a-time operations.
+  const InlineBitmap& bitmap() const { return bitmap_; }
+
   // Returns whether this "bits" object is identical to the other in both
   // bit_count() and held value.
   bool operator==(const Bits& other) const { return bitmap_ == other.bitmap_; }
   bool operator!=(const Bits& other) const { return !(*this == other); }
 
+  template <typename H>
+  friend H AbslHashValue(H h, const Bits& bits) {
+    return H::combine(std::move(h), bits.bitmap_);
+  }
+
   // Slices a range of bits from the Bits object. 'start' is the first index in
   // the slice. 'start' is zero-indexed with zero being the LSb (same indexing
   // as Get/Set). 'width' is the number of bits to slice out and is the
@@ -279,9 +288,7 @@ class BitsRope {
   //
   // So b.Get(0) is now at result.Get(2).
   void push_back(const Bits& bits) {
-    for (int64_t i = 0; i < bits.bit_count(); ++i) {
-      bitmap_.Set(index_ + i, bits.Get(i));
-    }
+    bitmap_.Copy(index_, bits.bitmap_, /*src_offset=*/0, bits.bit_count());
     index_ += bits.bit_count();
   }
 
@@ -14,25 +14,266 @@
 
 #include "xls/ir/bits_ops.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "absl/base/casts.h"
+#include "absl/numeric/int128.h"
 #include "xls/common/logging/logging.h"
-#include "xls/ir/big_int.h"
+#include "xls/common/math_util.h"
+#include "xls/data_structures/inline_bitmap.h"
 
 namespace xls {
 namespace bits_ops {
 namespace {
 
-// Converts the given bits value to signed value of the given bit count. Uses
-// truncation or sign-extension to narrow/widen the value.
-Bits TruncateOrSignExtend(const Bits& bits, int64_t bit_count) {
-  if (bits.bit_count() == bit_count) {
-    return bits;
-  } else if (bits.bit_count() < bit_count) {
-    return SignExtend(bits, bit_count);
-  } else {
-    return bits.Slice(0, bit_count);
+// Arithmetic on values of at most this many bits is performed on native
+// 128-bit integers. Wider values are operated on a 64-bit word at a time.
+constexpr int64_t kMaxNativeBitCount = 128;
+constexpr int64_t kWordBits = 64;
+
+// Returns the 'wordno'-th 64-bit word of the given value. Words beyond the end
+// of the value are zero.
+uint64_t GetWord(const Bits& bits, int64_t wordno) {
+  int64_t valid_bits = bits.bit_count() - wordno * kWordBits;
+  if (valid_bits <= 0) {
+    return 0;
+  }
+  uint64_t word = bits.bitmap().GetWord(wordno);
+  return valid_bits >= kWordBits ? word : word & Mask(valid_bits);
+}
+
+// As above, but the value is sign-extended to fill words beyond its end.
+uint64_t GetSignExtendedWord(const Bits& bits, int64_t wordno) {
+  uint64_t fill = bits.msb() ? Mask(kWordBits) : 0;
+  int64_t valid_bits = bits.bit_count() - wordno * kWordBits;
+  if (valid_bits <= 0) {
+    return fill;
+  }
+  uint64_t word = bits.bitmap().GetWord(wordno);
+  return valid_bits >= kWordBits
+             ? word
+             : (word & Mask(valid_bits)) | (fill & ~Mask(valid_bits));
+}
+
+absl::uint128 ToUint128(const Bits& bits) {
+  XLS_DCHECK_LE(bits.bit_count(), kMaxNativeBitCount);
+  return absl::MakeUint128(GetWord(bits, 1), GetWord(bits, 0));
+}
+
+absl::int128 ToInt128(const Bits& bits) {
+  XLS_DCHECK_LE(bits.bit_count(), kMaxNativeBitCount);
+  return absl::MakeInt128(absl::bit_cast<int64_t>(GetSignExtendedWord(bits, 1)),
+                          GetSignExtendedWord(bits, 0));
+}
+
+// Returns the given value truncated to 'bit_count' bits, which must be at most
+// kMaxNativeBitCount.
+Bits FromUint128(absl::uint128 value, int64_t bit_count) {
+  XLS_DCHECK_LE(bit_count, kMaxNativeBitCount);
+  InlineBitmap bitmap(bit_count);
+  if (bit_count > 0) {
+    bitmap.SetWord(0, absl::Uint128Low64(value));
+  }
+  if (bit_count > kWordBits) {
+    bitmap.SetWord(1, absl::Uint128High64(value));
+  }
+  return Bits::FromBitmap(std::move(bitmap));
+}
+
+// Returns the value held in the given little-endian words truncated to
+// 'bit_count' bits. Missing words are zero.
+Bits FromWords(absl::Span<const uint64_t> words, int64_t bit_count) {
+  InlineBitmap bitmap(bit_count);
+  for (int64_t i = 0; i < bitmap.word_count() && i < words.size(); ++i) {
+    bitmap.SetWord(i, words[i]);
+  }
+  return Bits::FromBitmap(std::move(bitmap));
+}
+
+// Returns lhs + rhs + carry (or lhs + ~rhs + carry if 'invert_rhs' is true)
+// truncated to the width of the operands.
+Bits AddWords(const Bits& lhs, const Bits& rhs, bool invert_rhs,
+              uint64_t carry) {
+  XLS_CHECK_EQ(lhs.bit_count(), rhs.bit_count());
+  InlineBitmap bitmap(lhs.bit_count());
+  for (int64_t i = 0; i < bitmap.word_count(); ++i) {
+    uint64_t rhs_word = invert_rhs ? ~GetWord(rhs, i) : GetWord(rhs, i);
+    absl::uint128 sum = absl::uint128(GetWord(lhs, i)) + rhs_word + carry;
+    bitmap.SetWord(i, absl::Uint128Low64(sum));
+    carry = absl::Uint128High64(sum);
+  }
+  return Bits::FromBitmap(std::move(bitmap));
+}
+
+// Returns the product of the unsigned values 'lhs' and 'rhs' truncated to
+// 'bit_count' bits. This is schoolbook multiplication on 64-bit words; partial
+// products which only contribute to bits beyond 'bit_count' are skipped.
+Bits MulWords(const Bits& lhs, const Bits& rhs, int64_t bit_count) {
+  const int64_t word_count = CeilOfRatio(bit_count, kWordBits);
+  const int64_t lhs_word_count =
+      std::min(CeilOfRatio(lhs.bit_count(), kWordBits), word_count);
+  const int64_t rhs_word_count =
+      std::min(CeilOfRatio(rhs.bit_count(), kWordBits), word_count);
+  std::vector<uint64_t> product(word_count, 0);
+  for (int64_t i = 0; i < lhs_word_count; ++i) {
+    const uint64_t lhs_word = GetWord(lhs, i);
+    uint64_t carry = 0;
+    int64_t j = 0;
+    for (; j < rhs_word_count && i + j < word_count; ++j) {
+      absl::uint128 partial = absl::uint128(lhs_word) * GetWord(rhs, j) +
+                              product[i + j] + carry;
+      product[i + j] = absl::Uint128Low64(partial);
+      carry = absl::Uint128High64(partial);
+    }
+    if (i + j < word_count) {
+      product[i + j] = carry;
+    }
+  }
+  return FromWords(product, bit_count);
+}
+
+// Divides the unsigned value 'lhs' by the unsigned value 'rhs' of the same
+// width, setting 'quotient' and 'remainder' to values of that width. This is
+// long division on 64-bit words (Knuth, TAOCP vol. 2, 4.3.1, algorithm D).
+// Division by zero gives an all-ones quotient and a zero remainder, as in
+// UDiv and UMod.
+void DivModWords(const Bits& lhs, const Bits& rhs, Bits* quotient,
+                 Bits* remainder) {
+  XLS_CHECK_EQ(lhs.bit_count(), rhs.bit_count());
+  const int64_t bit_count = lhs.bit_count();
+  if (rhs.IsZero()) {
+    *quotient = Bits::AllOnes(bit_count);
+    *remainder = Bits(bit_count);
+    return;
+  }
+  const int64_t m = CeilOfRatio(bit_count, kWordBits);
+  int64_t n = m;
+  while (GetWord(rhs, n - 1) == 0) {
+    --n;
+  }
+
+  std::vector<uint64_t> q(m, 0);
+  if (n == 1) {
+    // Single-word divisor: each step divides a two-word value by one word.
+    const uint64_t divisor = GetWord(rhs, 0);
+    uint64_t r = 0;
+    for (int64_t j = m - 1; j >= 0; --j) {
+      absl::uint128 dividend = absl::MakeUint128(r, GetWord(lhs, j));
+      q[j] = absl::Uint128Low64(dividend / divisor);
+      r = absl::Uint128Low64(dividend % divisor);
+    }
+    *quotient = FromWords(q, bit_count);
+    *remainder = FromWords({r}, bit_count);
+    return;
+  }
+
+  // Normalize the operands so the most significant word of the divisor has its
+  // top bit set; this bounds the error of each quotient word estimate.
+  const int64_t shift = kWordBits - 1 - FloorOfLog2(GetWord(rhs, n - 1));
+  auto shifted = [&](const Bits& bits, int64_t wordno) -> uint64_t {
+    uint64_t word = wordno < m ? GetWord(bits, wordno) : 0;
+    if (shift == 0) {
+      return word;
+    }
+    uint64_t lower = wordno > 0 ? GetWord(bits, wordno - 1) : 0;
+    return (word << shift) | (lower >> (kWordBits - shift));
+  };
+  std::vector<uint64_t> vn(n);
+  for (int64_t i = 0; i < n; ++i) {
+    vn[i] = shifted(rhs, i);
+  }
+  std::vector<uint64_t> un(m + 1);
+  for (int64_t i = 0; i <= m; ++i) {
+    un[i] = shifted(lhs, i);
+  }
+
+  const absl::uint128 kBase = absl::MakeUint128(1, 0);
+  for (int64_t j = m - n; j >= 0; --j) {
+    // Estimate the quotient word from the leading words of the partial
+    // remainder and divisor. After the correction loop the estimate is at
+    // most one too large.
+    absl::uint128 dividend = absl::MakeUint128(un[j + n], un[j + n - 1]);
+    absl::uint128 qhat = dividend / vn[n - 1];
+    absl::uint128 rhat = dividend - qhat * vn[n - 1];
+    while (qhat >= kBase ||
+           qhat * vn[n - 2] >
+               absl::MakeUint128(absl::Uint128Low64(rhat), un[j + n - 2])) {
+      --qhat;
+      rhat += vn[n - 1];
+      if (rhat >= kBase) {
+        break;
+      }
+    }
+
+    // Subtract qhat times the divisor from the partial remainder.
+    absl::int128 borrow = 0;
+    absl::int128 diff;
+    for (int64_t i = 0; i < n; ++i) {
+      absl::uint128 product = qhat * vn[i];
+      diff = absl::int128(un[i + j]) - borrow -
+             absl::int128(absl::Uint128Low64(product));
+      un[i + j] = absl::Int128Low64(diff);
+      borrow = absl::int128(absl::Uint128High64(product)) - (diff >> 64);
+    }
+    diff = absl::int128(un[j + n]) - borrow;
+    un[j + n] = absl::Int128Low64(diff);
+
+    q[j] = absl::Uint128Low64(qhat);
+    if (diff < 0) {
+      // The estimate was one too large; add the divisor back.
+      --q[j];
+      uint64_t carry = 0;
+      for (int64_t i = 0; i < n; ++i) {
+        absl::uint128 sum = absl::uint128(un[i + j]) + vn[i] + carry;
+        un[i + j] = absl::Uint128Low64(sum);
+        carry = absl::Uint128High64(sum);
+      }
+      un[j + n] += carry;
+    }
+  }
+
+  // Undo the normalization of the remainder.
+  std::vector<uint64_t> r(n);
+  for (int64_t i = 0; i < n; ++i) {
+    r[i] = shift == 0 ? un[i]
+                      : (un[i] >> shift) | (un[i + 1] << (kWordBits - shift));
+  }
+  *quotient = FromWords(q, bit_count);
+  *remainder = FromWords(r, bit_count);
+}
+
+// Returns -1, 0, or 1 if the unsigned value 'lhs' is less than, equal to, or
+// greater than the unsigned value 'rhs'. The operands may differ in width.
+int64_t UCompare(const Bits& lhs, const Bits& rhs) {
+  int64_t word_count =
+      CeilOfRatio(std::max(lhs.bit_count(), rhs.bit_count()), kWordBits);
+  for (int64_t i = word_count - 1; i >= 0; --i) {
+    uint64_t lhs_word = GetWord(lhs, i);
+    uint64_t rhs_word = GetWord(rhs, i);
+    if (lhs_word != rhs_word) {
+      return lhs_word < rhs_word ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// As above, for twos-complement values.
+int64_t SCompare(const Bits& lhs, const Bits& rhs) {
+  if (lhs.msb() != rhs.msb()) {
+    return lhs.msb() ? -1 : 1;
+  }
+  // With equal signs, the sign-extended words compare as unsigned numbers.
+  int64_t word_count =
+      CeilOfRatio(std::max(lhs.bit_count(), rhs.bit_count()), kWordBits);
+  for (int64_t i = word_count - 1; i >= 0; --i) {
+    uint64_t lhs_word = GetSignExtendedWord(lhs, i);
+    uint64_t rhs_word = GetSignExtendedWord(rhs, i);
+    if (lhs_word != rhs_word) {
+      return lhs_word < rhs_word ? -1 : 1;
+    }
   }
+  return 0;
 }
 
 }  // namespace
@@ -188,10 +429,10 @@ Bits Add(const Bits& lhs, const Bits& rhs) {
     uint64_t result = (lhs_int + rhs_int) & Mask(lhs.bit_count());
     return UBits(result, lhs.bit_count());
   }
-
-  Bits sum = BigInt::Add(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs))
-                 .ToSignedBits();
-  return TruncateOrSignExtend(sum, lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) + ToUint128(rhs), lhs.bit_count());
+  }
+  return AddWords(lhs, rhs, /*invert_rhs=*/false, /*carry=*/0);
 }
 
 Bits Sub(const Bits& lhs, const Bits& rhs) {
@@ -202,9 +443,10 @@ Bits Sub(const Bits& lhs, const Bits& rhs) {
     uint64_t result = (lhs_int - rhs_int) & Mask(lhs.bit_count());
     return UBits(result, lhs.bit_count());
   }
-  Bits diff = BigInt::Sub(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs))
-                  .ToSignedBits();
-  return TruncateOrSignExtend(diff, lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) - ToUint128(rhs), lhs.bit_count());
+  }
+  return AddWords(lhs, rhs, /*invert_rhs=*/true, /*carry=*/1);
 }
 
 Bits Mul(const Bits& lhs, const Bits& rhs) {
@@ -215,13 +457,12 @@ Bits Mul(const Bits& lhs, const Bits& rhs) {
     uint64_t result = (lhs_int * rhs_int) & Mask(lhs.bit_count());
     return UBits(result, lhs.bit_count());
   }
-
-  BigInt product =
-      BigInt::Mul(BigInt::MakeSigned(SignExtend(lhs, lhs.bit_count())),
-                  BigInt::MakeSigned(SignExtend(rhs, lhs.bit_count())));
-  return product.ToSignedBitsWithBitCount(lhs.bit_count() * 2)
-      .value()
-      .Slice(0, lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) * ToUint128(rhs), lhs.bit_count());
+  }
+  // The low bits of a product are the same whether the operands are
+  // interpreted as signed or unsigned.
+  return MulWords(lhs, rhs, lhs.bit_count());
 }
 
 Bits SMul(const Bits& lhs, const Bits& rhs) {
@@ -232,10 +473,12 @@ Bits SMul(const Bits& lhs, const Bits& rhs) {
     int64_t result = lhs_int * rhs_int;
     return SBits(result, result_width);
   }
-
-  BigInt product =
-      BigInt::Mul(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return product.ToSignedBitsWithBitCount(result_width).value();
+  if (result_width <= kMaxNativeBitCount) {
+    return FromUint128(absl::uint128(ToInt128(lhs) * ToInt128(rhs)),
+                       result_width);
+  }
+  return MulWords(SignExtend(lhs, result_width), SignExtend(rhs, result_width),
+                  result_width);
 }
 
 Bits UMul(const Bits& lhs, const Bits& rhs) {
@@ -246,30 +489,36 @@ Bits UMul(const Bits& lhs, const Bits& rhs) {
     uint64_t result = lhs_int * rhs_int;
     return UBits(result, result_width);
   }
-
-  BigInt product =
-      BigInt::Mul(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return product.ToUnsignedBitsWithBitCount(result_width).value();
+  if (result_width <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) * ToUint128(rhs), result_width);
+  }
+  return MulWords(lhs, rhs, result_width);
 }
 
 Bits UDiv(const Bits& lhs, const Bits& rhs) {
   XLS_CHECK_EQ(lhs.bit_count(), rhs.bit_count());
-  if (rhs.IsZero()) {
-    return Bits::AllOnes(lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    if (rhs.IsZero()) {
+      return Bits::AllOnes(lhs.bit_count());
+    }
+    return FromUint128(ToUint128(lhs) / ToUint128(rhs), lhs.bit_count());
   }
-  BigInt quotient =
-      BigInt::Div(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return ZeroExtend(quotient.ToUnsignedBits(), lhs.bit_count());
+  Bits quotient, remainder;
+  DivModWords(lhs, rhs, &quotient, &remainder);
+  return quotient;
 }
 
 Bits UMod(const Bits& lhs, const Bits& rhs) {
   XLS_CHECK_EQ(lhs.bit_count(), rhs.bit_count());
-  if (rhs.IsZero()) {
-    return Bits(lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    if (rhs.IsZero()) {
+      return Bits(lhs.bit_count());
+    }
+    return FromUint128(ToUint128(lhs) % ToUint128(rhs), lhs.bit_count());
   }
-  BigInt modulo =
-      BigInt::Mod(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return ZeroExtend(modulo.ToUnsignedBits(), lhs.bit_count());
+  Bits quotient, remainder;
+  DivModWords(lhs, rhs, &quotient, &remainder);
+  return remainder;
 }
 
 Bits SDiv(const Bits& lhs, const Bits& rhs) {
@@ -288,9 +537,11 @@ Bits SDiv(const Bits& lhs, const Bits& rhs) {
       return ZeroExtend(Bits::AllOnes(lhs.bit_count() - 1), lhs.bit_count());
     }
   }
-  BigInt quotient =
-      BigInt::Div(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return TruncateOrSignExtend(quotient.ToSignedBits(), lhs.bit_count());
+  // Divide the magnitudes; the quotient is rounded toward zero. The magnitude
+  // of the most negative value is representable as an unsigned number, and
+  // the overflowing quotient of that value and -1 wraps back to it.
+  Bits quotient = UDiv(Abs(lhs), Abs(rhs));
+  return lhs.msb() != rhs.msb() ? Negate(quotient) : quotient;
 }
 
 Bits SMod(const Bits& lhs, const Bits& rhs) {
@@ -298,12 +549,13 @@ Bits SMod(const Bits& lhs, const Bits& rhs) {
   if (rhs.IsZero()) {
     return Bits(lhs.bit_count());
   }
-  BigInt modulo = BigInt::Mod(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return TruncateOrSignExtend(modulo.ToSignedBits(), lhs.bit_count());
+  // The remainder takes the sign of the dividend.
+  Bits remainder = UMod(Abs(lhs), Abs(rhs));
+  return lhs.msb() ? Negate(remainder) : remainder;
 }
 
 bool UEqual(const Bits& lhs, const Bits& rhs) {
-  return BigInt::MakeUnsigned(lhs) == BigInt::MakeUnsigned(rhs);
+  return UCompare(lhs, rhs) == 0;
 }
 
 bool UEqual(const Bits& lhs, int64_t rhs) {
@@ -320,12 +572,11 @@ bool UGreaterThan(const Bits& lhs, const Bits& rhs) {
 }
 
 bool ULessThanOrEqual(const Bits& lhs, const Bits& rhs) {
-  return UEqual(lhs, rhs) ||
-         BigInt::LessThan(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
+  return UCompare(lhs, rhs) <= 0;
 }
 
 bool ULessThan(const Bits& lhs, const Bits& rhs) {
-  return BigInt::LessThan(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
+  return UCompare(lhs, rhs) < 0;
 }
 
 bool UGreaterThanOrEqual(const Bits& lhs, int64_t rhs) {
@@ -349,7 +600,7 @@ bool ULessThan(const Bits& lhs, int64_t rhs) {
 }
 
 bool SEqual(const Bits& lhs, const Bits& rhs) {
-  return BigInt::MakeSigned(lhs) == BigInt::MakeSigned(rhs);
+  return SCompare(lhs, rhs) == 0;
 }
 
 bool SEqual(const Bits& lhs, int64_t rhs) {
@@ -365,14 +616,14 @@ bool SGreaterThan(const Bits& lhs, const Bits& rhs) {
 }
 
 bool SLessThanOrEqual(const Bits& lhs, const Bits& rhs) {
-  return SEqual(lhs, rhs) || SLessThan(lhs, rhs);
+  return SCompare(lhs, rhs) <= 0;
 }
 
 bool SLessThan(const Bits& lhs, const Bits& rhs) {
   if (lhs.bit_count() <= 64 && rhs.bit_count() <= 64) {
     return lhs.ToInt64().value() < rhs.ToInt64().value();
   }
-  return BigInt::LessThan(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
+  return SCompare(lhs, rhs) < 0;
 }
 
 bool SGreaterThanOrEqual(const Bits& lhs, int64_t rhs) {
@@ -424,8 +675,11 @@ Bits Negate(const Bits& bits) {
     return UBits((-bits.ToInt64().value()) & Mask(bits.bit_count()),
                  bits.bit_count());
   }
-  Bits negated = BigInt::Negate(BigInt::MakeSigned(bits)).ToSignedBits();
-  return TruncateOrSignExtend(negated, bits.bit_count());
+  if (bits.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(-ToUint128(bits), bits.bit_count());
+  }
+  return AddWords(Bits(bits.bit_count()), bits, /*invert_rhs=*/true,
+                  /*carry=*/1);
 }
 
 Bits Abs(const Bits& bits) {
@@ -14,10 +14,14 @@
 
 #include "xls/ir/bits_ops.h"
 
+#include <random>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
 #include "xls/common/math_util.h"
 #include "xls/common/status/matchers.h"
+#include "xls/ir/big_int.h"
 #include "xls/ir/number_parser.h"
 #include "xls/ir/value.h"
 
@@ -212,6 +216,8 @@ TEST(BitsOpsTest, UDiv) {
   EXPECT_EQ(bits_ops::UDiv(Bits(), Bits()), Bits());
   EXPECT_EQ(bits_ops::UDiv(UBits(10, 4), UBits(0, 4)), UBits(15, 4));
   EXPECT_EQ(bits_ops::UDiv(UBits(123456, 64), UBits(0, 64)), Bits::AllOnes(64));
+  EXPECT_EQ(bits_ops::UDiv(Bits::AllOnes(129), Bits(129)), Bits::AllOnes(129));
+  EXPECT_EQ(bits_ops::UDiv(UBits(123456, 300), Bits(300)), Bits::AllOnes(300));
 
   // Test wide values.
   XLS_ASSERT_OK_AND_ASSIGN(
@@ -233,6 +239,8 @@ TEST(BitsOpsTest, UMod) {
   EXPECT_EQ(bits_ops::UMod(Bits(), Bits()), Bits());
   EXPECT_EQ(bits_ops::UMod(UBits(10, 4), UBits(0, 4)), Bits(4));
   EXPECT_EQ(bits_ops::UMod(UBits(123456, 64), UBits(0, 64)), Bits(64));
+  EXPECT_EQ(bits_ops::UMod(Bits::AllOnes(129), Bits(129)), Bits(129));
+  EXPECT_EQ(bits_ops::UMod(UBits(123456, 300), Bits(300)), Bits(300));
 
   // Test wide values.
   XLS_ASSERT_OK_AND_ASSIGN(
@@ -537,6 +545,93 @@ TEST(BitsOpsTest, Int64SignedComparisons) {
   EXPECT_TRUE(bits_ops::SLessThanOrEqual(wide_minus2, 33));
 }
 
+// Checks the word-level and 128-bit arithmetic against BigInt for widths
+// around the 64- and 128-bit boundaries.
+TEST(BitsOpsTest, WideArithmeticMatchesBigInt) {
+  std::mt19937_64 rng(42);
+  // Returns a random value of the given width whose magnitude is also random,
+  // so there are both large and small (e.g., single-word) operands.
+  auto random_bits = [&](int64_t bit_count) {
+    int64_t magnitude = std::uniform_int_distribution<int64_t>(
+        1, bit_count)(rng);
+    std::vector<uint8_t> bytes(CeilOfRatio(magnitude, int64_t{8}));
+    for (uint8_t& byte : bytes) {
+      byte = rng();
+    }
+    Bits value = bits_ops::ZeroExtend(Bits::FromBytes(bytes, magnitude),
+                                      bit_count);
+    return rng() % 4 == 0 ? bits_ops::Negate(value) : value;
+  };
+  auto truncate = [](const BigInt& value, int64_t bit_count) {
+    return value.ToSignedBitsWithBitCount(bit_count + 1).value().Slice(
+        0, bit_count);
+  };
+
+  for (int64_t bit_count : {63, 64, 65, 100, 127, 128, 129, 192, 200, 256,
+                            300}) {
+    std::vector<Bits> values = {Bits(bit_count), UBits(1, bit_count),
+                                Bits::AllOnes(bit_count),
+                                Bits::MaxSigned(bit_count),
+                                Bits::MinSigned(bit_count)};
+    for (int64_t i = 0; i < 20; ++i) {
+      values.push_back(random_bits(bit_count));
+    }
+    for (const Bits& lhs : values) {
+      for (const Bits& rhs : values) {
+        BigInt ulhs = BigInt::MakeUnsigned(lhs);
+        BigInt urhs = BigInt::MakeUnsigned(rhs);
+        BigInt slhs = BigInt::MakeSigned(lhs);
+        BigInt srhs = BigInt::MakeSigned(rhs);
+        SCOPED_TRACE(absl::StrFormat("lhs = %s, rhs = %s",
+                                     lhs.ToString(FormatPreference::kHex),
+                                     rhs.ToString(FormatPreference::kHex)));
+        EXPECT_EQ(bits_ops::Add(lhs, rhs),
+                  truncate(BigInt::Add(ulhs, urhs), bit_count));
+        EXPECT_EQ(bits_ops::Sub(lhs, rhs),
+                  truncate(BigInt::Sub(ulhs, urhs), bit_count));
+        EXPECT_EQ(bits_ops::UMul(lhs, rhs),
+                  BigInt::Mul(ulhs, urhs)
+                      .ToUnsignedBitsWithBitCount(2 * bit_count)
+                      .value());
+        EXPECT_EQ(bits_ops::SMul(lhs, rhs),
+                  BigInt::Mul(slhs, srhs)
+                      .ToSignedBitsWithBitCount(2 * bit_count)
+                      .value());
+        EXPECT_EQ(bits_ops::ULessThan(lhs, rhs), BigInt::LessThan(ulhs, urhs));
+        EXPECT_EQ(bits_ops::SLessThan(lhs, rhs), BigInt::LessThan(slhs, srhs));
+        EXPECT_EQ(bits_ops::UEqual(lhs, rhs), ulhs == urhs);
+        if (!rhs.IsZero()) {
+          EXPECT_EQ(bits_ops::UDiv(lhs, rhs),
+                    truncate(BigInt::Div(ulhs, urhs), bit_count));
+          EXPECT_EQ(bits_ops::UMod(lhs, rhs),
+                    truncate(BigInt::Mod(ulhs, urhs), bit_count));
+          EXPECT_EQ(bits_ops::SDiv(lhs, rhs),
+                    truncate(BigInt::Div(slhs, srhs), bit_count));
+          EXPECT_EQ(bits_ops::SMod(lhs, rhs),
+                    truncate(BigInt::Mod(slhs, srhs), bit_count));
+        }
+      }
+      EXPECT_EQ(bits_ops::Negate(lhs),
+                truncate(BigInt::Negate(BigInt::MakeSigned(lhs)), bit_count));
+    }
+  }
+}
+
+// Comparisons of values of different widths.
+TEST(BitsOpsTest, MixedWidthComparisons) {
+  Bits wide = bits_ops::ZeroExtend(UBits(42, 64), 200);
+  EXPECT_TRUE(bits_ops::UEqual(wide, UBits(42, 7)));
+  EXPECT_TRUE(bits_ops::ULessThan(UBits(41, 7), wide));
+  EXPECT_FALSE(bits_ops::ULessThan(wide, UBits(42, 100)));
+
+  Bits wide_negative = bits_ops::SignExtend(SBits(-3, 64), 150);
+  EXPECT_TRUE(bits_ops::SEqual(wide_negative, SBits(-3, 3)));
+  EXPECT_TRUE(bits_ops::SLessThan(wide_negative, SBits(-2, 90)));
+  EXPECT_TRUE(bits_ops::SLessThan(SBits(-4, 130), wide_negative));
+  EXPECT_TRUE(bits_ops::SLessThan(wide_negative, Bits(0)));
+  EXPECT_TRUE(bits_ops::SEqual(Bits(0), Bits(129)));
+}
+
 TEST(BitsOpsTest, ZeroAndSignExtend) {
   Bits empty_bits(0);
   EXPECT_TRUE(bits_ops::ZeroExtend(empty_bits, 47).IsZero());
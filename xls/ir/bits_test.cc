@@ -565,6 +565,38 @@ TEST(BitsTest, Slice) {
             "0b1_0001_0000_0101_0001");
 }
 
+TEST(BitsTest, SliceAtEveryOffsetMatchesBitwise) {
+  Bits big_prime = PrimeBits(300);
+  for (int64_t start = 0; start < 150; ++start) {
+    for (int64_t width : {1, 7, 63, 64, 65, 129}) {
+      Bits slice = big_prime.Slice(start, width);
+      ASSERT_EQ(slice.bit_count(), width);
+      for (int64_t i = 0; i < width; ++i) {
+        ASSERT_EQ(slice.Get(i), big_prime.Get(start + i))
+            << "start: " << start << " width: " << width << " i: " << i;
+      }
+    }
+  }
+}
+
+TEST(BitsTest, BitsRopeOfUnalignedPieces) {
+  Bits big_prime = PrimeBits(1000);
+  std::vector<Bits> pieces;
+  int64_t total = 0;
+  for (int64_t width = 1; total + width <= big_prime.bit_count(); width += 5) {
+    pieces.push_back(big_prime.Slice(total, width));
+    total += width;
+  }
+  BitsRope rope(total + 1);
+  for (const Bits& piece : pieces) {
+    rope.push_back(piece);
+  }
+  rope.push_back(true);
+  Bits result = rope.Build();
+  EXPECT_EQ(result.Slice(0, total), big_prime.Slice(0, total));
+  EXPECT_TRUE(result.Get(total));
+}
+
 TEST(BitsTest, ValueTest) {
   Value b0 = Value(UBits(2, 4));
   EXPECT_EQ(b0.bits(), UBits(2, 4));
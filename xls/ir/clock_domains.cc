@@ -0,0 +1,128 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/ir/clock_domains.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "absl/types/optional.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+// Returns the id of the channel the given node sends on or receives on, and
+// whether it sends, or nullopt if the node doesn't communicate.
+absl::optional<std::pair<int64_t, bool>> GetChannelUse(Node* node) {
+  switch (node->op()) {
+    case Op::kSend:
+      return std::make_pair(node->As<Send>()->channel_id(), true);
+    case Op::kSendIf:
+      return std::make_pair(node->As<SendIf>()->channel_id(), true);
+    case Op::kReceive:
+      return std::make_pair(node->As<Receive>()->channel_id(), false);
+    case Op::kReceiveIf:
+      return std::make_pair(node->As<ReceiveIf>()->channel_id(), false);
+    default:
+      return absl::nullopt;
+  }
+}
+
+}  // namespace
+
+absl::Status VerifyClockDomains(Package* package, const ClockDomains& domains) {
+  for (const auto& [domain, period] : domains.periods) {
+    if (period <= 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Clock domain %s has non-positive period %d", domain, period));
+    }
+  }
+  for (const auto& proc : package->procs()) {
+    auto it = domains.proc_domains.find(proc->name());
+    if (it == domains.proc_domains.end()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Proc %s is not assigned to a clock domain", proc->name()));
+    }
+    if (!domains.periods.contains(it->second)) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Proc %s is assigned to unknown clock domain %s",
+                          proc->name(), it->second));
+    }
+  }
+  if (domains.synchronizer_stages < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Synchronizer stages must be positive, got %d",
+                        domains.synchronizer_stages));
+  }
+  if (domains.fifo_depth < 2 ||
+      (domains.fifo_depth & (domains.fifo_depth - 1)) != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Clock domain crossing FIFO depth must be a power of two of at least "
+        "2, got %d",
+        domains.fifo_depth));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<ClockDomainCrossing>> FindClockDomainCrossings(
+    Package* package, const ClockDomains& domains) {
+  XLS_RETURN_IF_ERROR(VerifyClockDomains(package, domains));
+  absl::flat_hash_map<Channel*, Proc*> senders;
+  absl::flat_hash_map<Channel*, Proc*> receivers;
+  for (const auto& proc : package->procs()) {
+    const std::string& domain = domains.proc_domains.at(proc->name());
+    for (Node* node : proc->nodes()) {
+      absl::optional<std::pair<int64_t, bool>> use = GetChannelUse(node);
+      if (!use.has_value()) {
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(Channel * channel, package->GetChannel(use->first));
+      auto& procs = use->second ? senders : receivers;
+      auto [it, inserted] = procs.insert({channel, proc.get()});
+      if (!inserted && domains.proc_domains.at(it->second->name()) != domain) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Channel %s is %s by procs %s and %s of different clock domains",
+            channel->name(), use->second ? "sent on" : "received on",
+            it->second->name(), proc->name()));
+      }
+    }
+  }
+
+  std::vector<ClockDomainCrossing> crossings;
+  for (const auto& [channel, sender] : senders) {
+    auto it = receivers.find(channel);
+    if (it == receivers.end()) {
+      continue;
+    }
+    Proc* receiver = it->second;
+    const std::string& send_domain = domains.proc_domains.at(sender->name());
+    const std::string& receive_domain =
+        domains.proc_domains.at(receiver->name());
+    if (send_domain != receive_domain) {
+      crossings.push_back(ClockDomainCrossing{channel, sender, receiver,
+                                              send_domain, receive_domain});
+    }
+  }
+  std::sort(crossings.begin(), crossings.end(),
+            [](const ClockDomainCrossing& a, const ClockDomainCrossing& b) {
+              return a.channel->id() < b.channel->id();
+            });
+  return crossings;
+}
+
+}  // namespace xls
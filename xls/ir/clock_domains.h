@@ -0,0 +1,75 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_IR_CLOCK_DOMAINS_H_
+#define XLS_IR_CLOCK_DOMAINS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/ir/channel.h"
+#include "xls/ir/package.h"
+#include "xls/ir/proc.h"
+
+namespace xls {
+
+// An assignment of the procs of a package to clock domains. Channels between
+// procs of different domains cross the domains; in hardware each is
+// implemented as an asynchronous FIFO whose pointers are passed between the
+// domains through synchronizers.
+struct ClockDomains {
+  // The clock period of each domain, by domain name. The unit is arbitrary
+  // (e.g., picoseconds); only the ratios of the periods matter.
+  absl::flat_hash_map<std::string, int64_t> periods;
+
+  // The domain of each proc, by proc name.
+  absl::flat_hash_map<std::string, std::string> proc_domains;
+
+  // The number of flops synchronizing the FIFO pointers into the other domain,
+  // i.e., the number of edges of the destination clock it takes for a value
+  // (or a free slot) to become visible across the crossing.
+  int64_t synchronizer_stages = 2;
+
+  // The number of entries of the FIFO of each crossing channel. Must be a power
+  // of two for the gray-code pointers.
+  int64_t fifo_depth = 4;
+};
+
+// A channel sent on in one clock domain and received on in another.
+struct ClockDomainCrossing {
+  Channel* channel;
+  Proc* sender;
+  Proc* receiver;
+  std::string send_domain;
+  std::string receive_domain;
+};
+
+// Returns an error unless every proc of the package is assigned to a domain
+// with a positive period and the FIFO parameters are valid.
+absl::Status VerifyClockDomains(Package* package, const ClockDomains& domains);
+
+// Returns the channels of the package crossing clock domains, sorted by channel
+// id. Returns an error if the domains are invalid or a channel is sent on (or
+// received on) by procs of more than one domain.
+absl::StatusOr<std::vector<ClockDomainCrossing>> FindClockDomainCrossings(
+    Package* package, const ClockDomains& domains);
+
+}  // namespace xls
+
+#endif  // XLS_IR_CLOCK_DOMAINS_H_
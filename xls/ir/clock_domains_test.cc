@@ -0,0 +1,104 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/ir/clock_domains.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+constexpr char kPackage[] = R"(package test
+
+chan a(bits[32], id=0, kind=streaming, ops=send_receive, metadata="""""")
+chan b(bits[32], id=1, kind=streaming, ops=send_receive, metadata="""""")
+
+proc producer(tok: token, state: bits[32], init=0) {
+  send.1: token = send(tok, state, channel_id=0, id=1)
+  send.2: token = send(send.1, state, channel_id=1, id=2)
+  next (send.2, state)
+}
+
+proc consumer(tok: token, state: bits[32], init=0) {
+  receive.3: (token, bits[32]) = receive(tok, channel_id=0, id=3)
+  tuple_index.4: token = tuple_index(receive.3, index=0, id=4)
+  receive.5: (token, bits[32]) = receive(tuple_index.4, channel_id=1, id=5)
+  tuple_index.6: token = tuple_index(receive.5, index=0, id=6)
+  next (tuple_index.6, state)
+}
+)";
+
+TEST(ClockDomainsTest, SameDomain) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  ClockDomains domains;
+  domains.periods = {{"clk", 10}};
+  domains.proc_domains = {{"producer", "clk"}, {"consumer", "clk"}};
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<ClockDomainCrossing> crossings,
+                           FindClockDomainCrossings(package.get(), domains));
+  EXPECT_TRUE(crossings.empty());
+}
+
+TEST(ClockDomainsTest, CrossingChannels) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  ClockDomains domains;
+  domains.periods = {{"fast", 10}, {"slow", 25}};
+  domains.proc_domains = {{"producer", "fast"}, {"consumer", "slow"}};
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<ClockDomainCrossing> crossings,
+                           FindClockDomainCrossings(package.get(), domains));
+  ASSERT_EQ(crossings.size(), 2);
+  EXPECT_EQ(crossings[0].channel->name(), "a");
+  EXPECT_EQ(crossings[0].sender->name(), "producer");
+  EXPECT_EQ(crossings[0].receiver->name(), "consumer");
+  EXPECT_EQ(crossings[0].send_domain, "fast");
+  EXPECT_EQ(crossings[0].receive_domain, "slow");
+  EXPECT_EQ(crossings[1].channel->name(), "b");
+}
+
+TEST(ClockDomainsTest, InvalidDomains) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  ClockDomains domains;
+  domains.periods = {{"clk", 10}};
+  domains.proc_domains = {{"producer", "clk"}};
+  EXPECT_THAT(VerifyClockDomains(package.get(), domains),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("consumer is not assigned")));
+
+  domains.proc_domains["consumer"] = "other";
+  EXPECT_THAT(VerifyClockDomains(package.get(), domains),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unknown clock domain other")));
+
+  domains.proc_domains["consumer"] = "clk";
+  domains.fifo_depth = 3;
+  EXPECT_THAT(VerifyClockDomains(package.get(), domains),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("power of two")));
+}
+
+}  // namespace
+}  // namespace xls
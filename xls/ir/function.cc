@@ -39,23 +39,46 @@ FunctionType* Function::GetType() {
 
 std::string Function::DumpIr(bool recursive) const {
   std::string nested_funcs = "";
-  std::string res = "fn " + name() + "(";
-  std::vector<std::string> param_strings;
-  for (Param* param : params_) {
-    param_strings.push_back(
-        absl::StrFormat("%s: %s", param->name(), param->GetType()->ToString()));
+  if (recursive) {
+    for (Node* node : TopoSort(const_cast<Function*>(this))) {
+      if (node->op() == Op::kCountedFor) {
+        nested_funcs += node->As<CountedFor>()->body()->DumpIr() + "\n";
+      }
+      if (node->op() == Op::kMap) {
+        nested_funcs += node->As<Map>()->to_apply()->DumpIr() + "\n";
+      }
+      if (node->op() == Op::kInvoke) {
+        nested_funcs += node->As<Invoke>()->to_apply()->DumpIr() + "\n";
+      }
+    }
+  }
+  std::string res;
+  IrWriter writer([&](absl::string_view chunk) {
+    res.append(chunk.data(), chunk.size());
+    return absl::OkStatus();
+  });
+  DumpIrTo(&writer);
+  XLS_CHECK_OK(writer.Close());
+  return nested_funcs + res;
+}
+
+void Function::DumpIrTo(IrWriter* writer) const {
+  std::string* res = writer->buffer();
+  StrAppend(res, "fn ", name(), "(");
+  for (int64_t i = 0; i < params_.size(); ++i) {
+    StrAppend(res, i == 0 ? "" : ", ", params_[i]->name(), ": ",
+              params_[i]->GetType()->ToString());
   }
-  StrAppend(&res, absl::StrJoin(param_strings, ", "));
-  StrAppend(&res, ") -> ");
+  StrAppend(res, ") -> ");
 
   if (return_value() != nullptr) {
-    StrAppend(&res, return_value()->GetType()->ToString());
+    StrAppend(res, return_value()->GetType()->ToString());
   }
-  StrAppend(&res, " {\n");
+  StrAppend(res, " {\n");
 
   for (Node* node : TopoSort(const_cast<Function*>(this))) {
     if (node->op() == Op::kParam && node == return_value()) {
-      absl::StrAppendFormat(&res, "  ret %s: %s = param(name=%s)\n",
+      absl::StrAppendFormat(res, "  ret %s: %s = param(name=%s)\n",
                             node->GetName(), node->GetType()->ToString(),
                             node->As<Param>()->name());
       continue;
@@ -63,21 +86,12 @@ std::string Function::DumpIr(bool recursive) const {
     if (node->op() == Op::kParam) {
       continue;  // Already accounted for in the signature.
     }
-    if (recursive && (node->op() == Op::kCountedFor)) {
-      nested_funcs += node->As<CountedFor>()->body()->DumpIr() + "\n";
-    }
-    if (recursive && (node->op() == Op::kMap)) {
-      nested_funcs += node->As<Map>()->to_apply()->DumpIr() + "\n";
-    }
-    if (recursive && (node->op() == Op::kInvoke)) {
-      nested_funcs += node->As<Invoke>()->to_apply()->DumpIr() + "\n";
-    }
-    StrAppend(&res, "  ", node == return_value() ? "ret " : "",
+    StrAppend(res, "  ", node == return_value() ? "ret " : "",
               node->ToString(), "\n");
+    writer->MaybeFlush();
   }
 
-  StrAppend(&res, "}\n");
-  return nested_funcs + res;
+  StrAppend(res, "}\n");
 }
 
 absl::StatusOr<Function*> Function::Clone(
@@ -111,6 +125,21 @@ absl::StatusOr<Function*> Function::Clone(
                 src->trip_count(), src->stride(), body, src->GetName()));
         break;
       }
+      // Remap DynamicCountedFor body.
+      case Op::kDynamicCountedFor: {
+        DynamicCountedFor* src = node->As<DynamicCountedFor>();
+        Function* body = call_remapping.contains(src->body())
+                             ? call_remapping.at(src->body())
+                             : src->body();
+        XLS_ASSIGN_OR_RETURN(
+            original_to_clone[node],
+            cloned_function->MakeNodeWithName<DynamicCountedFor>(
+                src->loc(), cloned_operands[0], cloned_operands[1],
+                cloned_operands[2],
+                absl::Span<Node*>(cloned_operands).subspan(3), body,
+                src->GetName()));
+        break;
+      }
       // Remap Map to_apply.
       case Op::kMap: {
         Map* src = node->As<Map>();
@@ -37,9 +37,6 @@
 namespace xls {
 
 class Function : public FunctionBase {
- private:
-  using NodeList = std::list<std::unique_ptr<Node>>;
-
  public:
   Function(absl::string_view name, Package* package)
       : FunctionBase(name, package) {}
@@ -53,7 +50,11 @@ class Function : public FunctionBase {
     XLS_RET_CHECK_EQ(n->function_base(), this) << absl::StreamFormat(
         "Return value node %s is not in this function %s (is in function %s)",
         n->GetName(), name(), n->function_base()->name());
+    if (return_value_ != nullptr) {
+      MarkChanged(return_value_);
+    }
     return_value_ = n;
+    MarkChanged(n);
     return absl::OkStatus();
   }
 
@@ -64,6 +65,7 @@ class Function : public FunctionBase {
   //   'recursive' if true, will dump counted-for body functions as well.
   //   This is only useful when dumping individual functions, and not packages.
   std::string DumpIr(bool recursive = false) const override;
+  void DumpIrTo(IrWriter* writer) const override;
 
   // Creates a clone of the function with the new name 'new_name'. Function is
   // owned by targt_package.  call_remapping specifies any function
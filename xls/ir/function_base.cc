@@ -14,6 +14,8 @@
 
 #include "xls/ir/function_base.h"
 
+#include <atomic>
+
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -29,6 +31,74 @@ using absl::StrAppend;
 
 namespace xls {
 
+/* static */ int64_t FunctionBase::NewUid() {
+  static std::atomic<int64_t> next_uid(0);
+  return next_uid.fetch_add(1);
+}
+
+/* static */ int64_t FunctionBase::NewCheckpointKey() {
+  static std::atomic<int64_t> next_key(0);
+  return next_key.fetch_add(1);
+}
+
+FunctionBase::~FunctionBase() {
+  while (first_node_ != nullptr) {
+    Node* node = first_node_;
+    UnlinkNode(node);
+    delete node;
+  }
+}
+
+void FunctionBase::LinkNode(Node* node) {
+  node->prev_node_ = last_node_;
+  node->next_node_ = nullptr;
+  if (last_node_ == nullptr) {
+    first_node_ = node;
+  } else {
+    last_node_->next_node_ = node;
+  }
+  last_node_ = node;
+  ++node_count_;
+}
+
+void FunctionBase::UnlinkNode(Node* node) {
+  if (node->prev_node_ == nullptr) {
+    first_node_ = node->next_node_;
+  } else {
+    node->prev_node_->next_node_ = node->next_node_;
+  }
+  if (node->next_node_ == nullptr) {
+    last_node_ = node->prev_node_;
+  } else {
+    node->next_node_->prev_node_ = node->prev_node_;
+  }
+  node->prev_node_ = nullptr;
+  node->next_node_ = nullptr;
+  --node_count_;
+  // Removing a node may not otherwise change the function (e.g., a node
+  // without operands), but it must invalidate the cached orders.
+  ++change_count_;
+}
+
+std::shared_ptr<const std::vector<Node*>> FunctionBase::CachedTopoSort(
+    bool reverse) {
+  absl::MutexLock lock(&topo_sort_mutex_);
+  if (topo_sort_change_count_ != change_count_) {
+    topo_sort_ = std::make_shared<const std::vector<Node*>>(
+        NodeIterator::ComputeOrder(this));
+    reverse_topo_sort_ = nullptr;
+    topo_sort_change_count_ = change_count_;
+  }
+  if (!reverse) {
+    return topo_sort_;
+  }
+  if (reverse_topo_sort_ == nullptr) {
+    reverse_topo_sort_ = std::make_shared<const std::vector<Node*>>(
+        topo_sort_->rbegin(), topo_sort_->rend());
+  }
+  return reverse_topo_sort_;
+}
+
 absl::StatusOr<Param*> FunctionBase::GetParamByName(
     absl::string_view param_name) const {
   for (Param* param : params()) {
@@ -82,14 +152,13 @@ absl::Status FunctionBase::RemoveNode(Node* node, bool remove_param_ok) {
   for (Node* operand : unique_operands) {
     operand->RemoveUser(node);
   }
-  auto node_it = node_iterators_.find(node);
-  XLS_RET_CHECK(node_it != node_iterators_.end());
-  nodes_.erase(node_it->second);
-  node_iterators_.erase(node_it);
+  XLS_RET_CHECK(node->function_base() == this);
   if (remove_param_ok) {
     params_.erase(std::remove(params_.begin(), params_.end(), node),
                   params_.end());
   }
+  UnlinkNode(node);
+  delete node;
 
   return absl::OkStatus();
 }
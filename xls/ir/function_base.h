@@ -15,22 +15,27 @@
 #ifndef XLS_IR_FUNCTION_BASE_H_
 #define XLS_IR_FUNCTION_BASE_H_
 
+#include <cstddef>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "xls/common/iterator_range.h"
 #include "xls/common/status/ret_check.h"
+#include "xls/ir/ir_writer.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/name_uniquer.h"
 #include "xls/ir/node.h"
 #include "xls/ir/nodes.h"
 #include "xls/ir/package.h"
 #include "xls/ir/type.h"
-#include "xls/ir/unwrapping_iterator.h"
 #include "xls/ir/verifier.h"
 
 namespace xls {
@@ -40,26 +45,66 @@ class Proc;
 
 // Base class for Functions and Procs. A holder of a set of nodes.
 class FunctionBase {
- protected:
-  using NodeList = std::list<std::unique_ptr<Node>>;
-
  public:
+  // Iterates over the nodes of the function in the order they were added.
+  // Removing a node invalidates only iterators referring to that node.
+  class NodeListIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Node*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Node* const*;
+    using reference = Node*;
+
+    explicit NodeListIterator(Node* node) : node_(node) {}
+
+    Node* operator*() const { return node_; }
+    NodeListIterator& operator++() {
+      node_ = NextNode(node_);
+      return *this;
+    }
+    NodeListIterator operator++(int) {
+      NodeListIterator previous = *this;
+      ++*this;
+      return previous;
+    }
+    bool operator==(const NodeListIterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const NodeListIterator& other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    Node* node_;
+  };
+
   FunctionBase(absl::string_view name, Package* package)
       : name_(name),
         qualified_name_(absl::StrCat(package->name(), "::", name_)),
-        package_(package) {}
-  virtual ~FunctionBase() = default;
+        package_(package),
+        uid_(NewUid()) {}
+  virtual ~FunctionBase();
 
   Package* package() const { return package_; }
   const std::string& name() const { return name_; }
   const std::string qualified_name() const { return qualified_name_; }
 
+  // Returns an identifier which is unique among all functions and procs ever
+  // created in the process. Unlike the address of the object, it is never
+  // reused, so it can key caches of per-function analyses.
+  int64_t uid() const { return uid_; }
+
   // DumpIr emits the IR in a parsable, hierarchical text format.
   // Parameter:
   //   'recursive' if true, will dump counted-for body functions as well.
   //   This is only useful when dumping individual functions, and not packages.
   virtual std::string DumpIr(bool recursive = false) const = 0;
 
+  // Writes the (non-recursive) IR text to the given writer, flushing it after
+  // each node rather than building the text of the whole function first.
+  virtual void DumpIrTo(IrWriter* writer) const = 0;
+
   // Return Span of parameters.
   absl::Span<Param* const> params() const { return params_; }
 
@@ -71,18 +116,50 @@ class FunctionBase {
 
   absl::StatusOr<int64_t> GetParamIndex(Param* param) const;
 
-  int64_t node_count() const { return nodes_.size(); }
+  int64_t node_count() const { return node_count_; }
+
+  // Returns one more than the largest Node::node_index of any node ever added
+  // to this function, i.e., the size of a table indexed by node index.
+  int64_t node_index_limit() const { return next_node_index_; }
+
+  // Returns a counter which is incremented on each change to a node of this
+  // function: the node is added, has an operand replaced, gains or loses a
+  // user, or gains or loses an implicit use. Each node records the counter
+  // value at its most recent change (Node::change_count), so the nodes changed
+  // after some point are those with a greater change count than the function
+  // had at that point.
+  int64_t change_count() const { return change_count_; }
+
+  // Records a change to the given node of this function.
+  void MarkChanged(Node* node) { node->change_count_ = ++change_count_; }
+
+  // Records the current change count under the given key, or returns the
+  // value last recorded (if any). Incremental passes use this to remember
+  // the point at which they reached a fixed point on the function. Each client
+  // obtains its own key from NewCheckpointKey.
+  static int64_t NewCheckpointKey();
+  void SetCheckpoint(int64_t key) { checkpoints_[key] = change_count_; }
+  absl::optional<int64_t> GetCheckpoint(int64_t key) const {
+    auto it = checkpoints_.find(key);
+    if (it == checkpoints_.end()) {
+      return absl::nullopt;
+    }
+    return it->second;
+  }
+
+  // Returns the nodes in the stable topological order yielded by TopoSort, or
+  // in reverse. The order is computed on first use and cached until the
+  // function next changes (see change_count), so the verifier, analyses and
+  // passes traversing an unmodified function share a single computation. The
+  // returned vector is a snapshot which stays valid, but is not updated, if
+  // the function is modified afterwards. Thread-safe.
+  std::shared_ptr<const std::vector<Node*>> CachedTopoSort(bool reverse);
 
   // Expose Nodes, so that transformation passes can operate
   // on this function.
-  xabsl::iterator_range<UnwrappingIterator<NodeList::iterator>> nodes() {
-    return xabsl::make_range(MakeUnwrappingIterator(nodes_.begin()),
-                             MakeUnwrappingIterator(nodes_.end()));
-  }
-  xabsl::iterator_range<UnwrappingIterator<NodeList::const_iterator>> nodes()
-      const {
-    return xabsl::make_range(MakeUnwrappingIterator(nodes_.begin()),
-                             MakeUnwrappingIterator(nodes_.end()));
+  xabsl::iterator_range<NodeListIterator> nodes() const {
+    return xabsl::make_range(NodeListIterator(first_node_),
+                             NodeListIterator(nullptr));
   }
 
   // Adds a node to the set owned by this function.
@@ -91,8 +168,10 @@ class FunctionBase {
     if (n->template Is<Param>()) {
       params_.push_back(n->template As<Param>());
     }
-    T* ptr = n.get();
-    node_iterators_[ptr] = nodes_.insert(nodes_.end(), std::move(n));
+    T* ptr = n.release();
+    ptr->node_index_ = next_node_index_++;
+    LinkNode(ptr);
+    MarkChanged(ptr);
     return ptr;
   }
 
@@ -157,15 +236,40 @@ class FunctionBase {
   FunctionBase(const FunctionBase& other) = delete;
   void operator=(const FunctionBase& other) = delete;
 
+  // Appends the node to, or unlinks it from, the list of nodes. The list owns
+  // linked nodes.
+  void LinkNode(Node* node);
+  void UnlinkNode(Node* node);
+
+  static Node* NextNode(const Node* node) { return node->next_node_; }
+
+  static int64_t NewUid();
+
   std::string name_;
   std::string qualified_name_;
   Package* package_;
-
-  // Store Nodes in std::list as they can be added and removed arbitrarily and
-  // we want a stable iteration order. Keep a map from instruction pointer to
-  // location in the list for fast lookup.
-  NodeList nodes_;
-  absl::flat_hash_map<const Node*, NodeList::iterator> node_iterators_;
+  int64_t uid_;
+
+  // The nodes are owned by the function and kept in an intrusive doubly-linked
+  // list threaded through the nodes themselves, as they can be added and
+  // removed arbitrarily and we want a stable iteration order. Adding and
+  // removing a node is O(1) and needs no allocation or lookup table.
+  Node* first_node_ = nullptr;
+  Node* last_node_ = nullptr;
+  int64_t node_count_ = 0;
+  int64_t next_node_index_ = 0;
+
+  int64_t change_count_ = 0;
+  absl::flat_hash_map<int64_t, int64_t> checkpoints_;
+
+  // The topological orders cached by CachedTopoSort, valid while the change
+  // count is topo_sort_change_count_.
+  absl::Mutex topo_sort_mutex_;
+  int64_t topo_sort_change_count_ ABSL_GUARDED_BY(topo_sort_mutex_) = -1;
+  std::shared_ptr<const std::vector<Node*>> topo_sort_
+      ABSL_GUARDED_BY(topo_sort_mutex_);
+  std::shared_ptr<const std::vector<Node*>> reverse_topo_sort_
+      ABSL_GUARDED_BY(topo_sort_mutex_);
 
   std::vector<Param*> params_;
 
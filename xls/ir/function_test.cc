@@ -179,6 +179,91 @@ fn id(x: bits[32], y: bits[32]) -> bits[32] {
   EXPECT_EQ(func->GetType(), updated);
 }
 
+TEST_F(FunctionTest, RemoveNodePreservesOrder) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, ParseFunction(R"(
+fn f(x: bits[8]) -> bits[8] {
+  a: bits[8] = not(x)
+  b: bits[8] = neg(x)
+  c: bits[8] = identity(x)
+  ret d: bits[8] = add(x, x)
+}
+)",
+                                                          p.get()));
+  EXPECT_EQ(func->node_count(), 5);
+  XLS_ASSERT_OK(func->RemoveNode(FindNode("b", func)));
+  EXPECT_THAT(func->nodes(),
+              ElementsAre(FindNode("x", func), FindNode("a", func),
+                          FindNode("c", func), FindNode("d", func)));
+  XLS_ASSERT_OK(func->RemoveNode(FindNode("a", func)));
+  XLS_ASSERT_OK(func->RemoveNode(FindNode("c", func)));
+  EXPECT_THAT(func->nodes(),
+              ElementsAre(FindNode("x", func), FindNode("d", func)));
+  EXPECT_EQ(func->node_count(), 2);
+
+  // Nodes added after removals go at the end.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * e, func->MakeNode<UnOp>(absl::nullopt, FindNode("x", func),
+                                     Op::kNot));
+  EXPECT_THAT(func->nodes(),
+              ElementsAre(FindNode("x", func), FindNode("d", func), e));
+  EXPECT_EQ(func->node_count(), 3);
+}
+
+TEST_F(FunctionTest, ChangeTracking) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, ParseFunction(R"(
+fn f(x: bits[8], y: bits[8]) -> bits[8] {
+  a: bits[8] = not(x)
+  b: bits[8] = neg(a)
+  c: bits[8] = identity(y)
+  ret d: bits[8] = add(b, c)
+}
+)",
+                                                          p.get()));
+  Node* x = FindNode("x", func);
+  Node* y = FindNode("y", func);
+  Node* a = FindNode("a", func);
+  Node* b = FindNode("b", func);
+  Node* c = FindNode("c", func);
+  Node* d = FindNode("d", func);
+  int64_t checkpoint = func->change_count();
+  for (Node* node : func->nodes()) {
+    EXPECT_LE(node->change_count(), checkpoint);
+    EXPECT_FALSE(node->ChangedSince(checkpoint));
+  }
+
+  // Replacing an operand changes the user and both the old and new operands.
+  // Users of changed nodes are affected as well.
+  XLS_ASSERT_OK(b->ReplaceOperandNumber(0, x));
+  EXPECT_GT(func->change_count(), checkpoint);
+  EXPECT_TRUE(b->ChangedSince(checkpoint));
+  EXPECT_TRUE(a->ChangedSince(checkpoint));
+  EXPECT_TRUE(x->ChangedSince(checkpoint));
+  EXPECT_TRUE(d->ChangedSince(checkpoint));
+  EXPECT_FALSE(c->ChangedSince(checkpoint));
+  EXPECT_FALSE(y->ChangedSince(checkpoint));
+
+  // Changing the return value changes the old and new return values.
+  checkpoint = func->change_count();
+  XLS_ASSERT_OK(func->set_return_value(c));
+  EXPECT_EQ(d->change_count(), c->change_count() - 1);
+  EXPECT_GT(d->change_count(), checkpoint);
+  EXPECT_FALSE(b->ChangedSince(checkpoint));
+
+  // New nodes are changed.
+  checkpoint = func->change_count();
+  XLS_ASSERT_OK_AND_ASSIGN(Node * e,
+                           func->MakeNode<UnOp>(absl::nullopt, y, Op::kNot));
+  EXPECT_TRUE(e->ChangedSince(checkpoint));
+  EXPECT_TRUE(y->ChangedSince(checkpoint));
+  EXPECT_TRUE(c->ChangedSince(checkpoint));
+
+  func->SetCheckpoint(42);
+  EXPECT_EQ(func->GetCheckpoint(42), func->change_count());
+  EXPECT_EQ(func->GetCheckpoint(7), absl::nullopt);
+}
+
 TEST_F(FunctionTest, MakeInvalidNode) {
   Package p(TestName());
   XLS_ASSERT_OK_AND_ASSIGN(Function * func, ParseFunction(R"(
@@ -0,0 +1,84 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/ir_file_writer.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#include "absl/strings/str_cat.h"
+#include "xls/common/strerror.h"
+#include "xls/ir/ir_writer.h"
+#include "zlib.h"
+
+namespace xls {
+namespace {
+
+absl::Status WriteError(const std::filesystem::path& path,
+                        absl::string_view message) {
+  return absl::InternalError(
+      absl::StrCat("Failed to write IR to ", path.string(), ": ", message));
+}
+
+absl::Status WriteUncompressed(const Package& package,
+                               const std::filesystem::path& path) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    return WriteError(path, Strerror(errno));
+  }
+  IrWriter writer([&](absl::string_view chunk) {
+    if (fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) {
+      return WriteError(path, Strerror(errno));
+    }
+    return absl::OkStatus();
+  });
+  package.DumpIrTo(&writer);
+  absl::Status status = writer.Close();
+  if (fclose(file) != 0 && status.ok()) {
+    status = WriteError(path, Strerror(errno));
+  }
+  return status;
+}
+
+absl::Status WriteCompressed(const Package& package,
+                             const std::filesystem::path& path) {
+  gzFile file = gzopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return WriteError(path, Strerror(errno));
+  }
+  IrWriter writer([&](absl::string_view chunk) {
+    if (gzwrite(file, chunk.data(), chunk.size()) !=
+        static_cast<int>(chunk.size())) {
+      int errnum;
+      return WriteError(path, gzerror(file, &errnum));
+    }
+    return absl::OkStatus();
+  });
+  package.DumpIrTo(&writer);
+  absl::Status status = writer.Close();
+  if (gzclose(file) != Z_OK && status.ok()) {
+    status = WriteError(path, "gzclose failed");
+  }
+  return status;
+}
+
+}  // namespace
+
+absl::Status WriteIrFile(const Package& package,
+                         const std::filesystem::path& path, bool compress) {
+  return compress ? WriteCompressed(package, path)
+                  : WriteUncompressed(package, path);
+}
+
+}  // namespace xls
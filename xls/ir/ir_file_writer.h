@@ -0,0 +1,35 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_IR_IR_FILE_WRITER_H_
+#define XLS_IR_IR_FILE_WRITER_H_
+
+#include <filesystem>
+
+#include "absl/status/status.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+
+// Writes the IR text of "package" to the file at "path", streaming it in
+// chunks rather than building the whole text in memory. If "compress", the
+// file is written gzip-compressed (the caller chooses the file name, e.g.
+// with a ".gz" suffix).
+absl::Status WriteIrFile(const Package& package,
+                         const std::filesystem::path& path,
+                         bool compress = false);
+
+}  // namespace xls
+
+#endif  // XLS_IR_IR_FILE_WRITER_H_
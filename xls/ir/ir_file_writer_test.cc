@@ -0,0 +1,113 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/ir_file_writer.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/ir_writer.h"
+#include "zlib.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+constexpr char kPackage[] = R"(package test
+
+chan ch(bits[32], id=0, kind=streaming, ops=send_receive, metadata="""""")
+
+fn f(x: bits[32], y: bits[32]) -> bits[32] {
+  literal.3: bits[128] = literal(value=0x1234_5678_9abc_def0_0fed_cba9_8765_4321, id=3)
+  bit_slice.4: bits[32] = bit_slice(literal.3, start=17, width=32, id=4)
+  add.5: bits[32] = add(x, y, id=5)
+  ret xor.6: bits[32] = xor(add.5, bit_slice.4, id=6)
+}
+
+proc my_proc(my_token: token, my_state: bits[32], init=42) {
+  send.7: token = send(my_token, my_state, channel_id=0, id=7)
+  next (send.7, my_state)
+}
+)";
+
+TEST(IrFileWriterTest, WriterMatchesDumpIr) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  std::string streamed;
+  int64_t chunks = 0;
+  IrWriter writer(
+      [&](absl::string_view chunk) {
+        streamed.append(chunk.data(), chunk.size());
+        ++chunks;
+        return absl::OkStatus();
+      },
+      /*flush_threshold=*/1);
+  package->DumpIrTo(&writer);
+  XLS_ASSERT_OK(writer.Close());
+  EXPECT_EQ(streamed, package->DumpIr());
+  EXPECT_GT(chunks, 1);
+}
+
+TEST(IrFileWriterTest, WriterReportsFirstSinkError) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  int64_t calls = 0;
+  IrWriter writer(
+      [&](absl::string_view chunk) {
+        ++calls;
+        return absl::UnavailableError("disk full");
+      },
+      /*flush_threshold=*/1);
+  package->DumpIrTo(&writer);
+  EXPECT_THAT(writer.Close(), StatusIs(absl::StatusCode::kUnavailable));
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(IrFileWriterTest, WriteFiles) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+
+  std::filesystem::path plain = temp_dir.path() / "plain.ir";
+  XLS_ASSERT_OK(WriteIrFile(*package, plain));
+  EXPECT_THAT(GetFileContents(plain), status_testing::IsOkAndHolds(
+                                          package->DumpIr()));
+
+  std::filesystem::path compressed = temp_dir.path() / "compressed.ir.gz";
+  XLS_ASSERT_OK(WriteIrFile(*package, compressed, /*compress=*/true));
+  gzFile file = gzopen(compressed.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  std::string text;
+  char buffer[256];
+  int bytes;
+  while ((bytes = gzread(file, buffer, sizeof(buffer))) > 0) {
+    text.append(buffer, bytes);
+  }
+  gzclose(file);
+  EXPECT_EQ(text, package->DumpIr());
+
+  EXPECT_THAT(WriteIrFile(*package, temp_dir.path() / "missing" / "x.ir"),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace xls
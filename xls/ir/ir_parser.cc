@@ -15,20 +15,33 @@
 #include "xls/ir/ir_parser.h"
 
 #include "google/protobuf/text_format.h"
+#include <algorithm>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "xls/common/file/mapped_file.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/thread_pool.h"
+#include "xls/common/trace.h"
 #include "xls/common/visitor.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/channel.pb.h"
 #include "xls/ir/node.h"
+#include "xls/ir/node_iterator.h"
 #include "xls/ir/nodes.h"
 #include "xls/ir/number_parser.h"
 #include "xls/ir/op.h"
+#include "xls/ir/package_serializer.h"
 #include "xls/ir/type.h"
+#include "xls/ir/value_helpers.h"
 #include "xls/ir/verifier.h"
 
 namespace xls {
@@ -212,7 +225,7 @@ class ArgParser {
                 absl::StrFormat("Invalid keyword @ %s: %s",
                                 name.pos().ToHumanString(), name.value()));
           }
-          seen_keywords.insert(name.value());
+          seen_keywords.insert(std::string(name.value()));
         } else {
           if (!name_to_bvalue_.contains(name.value())) {
             return absl::InvalidArgumentError(absl::StrFormat(
@@ -311,7 +324,7 @@ absl::StatusOr<std::string> Parser::ParseIdentifier(TokenPos* pos) {
   if (pos != nullptr) {
     *pos = token.pos();
   }
-  return token.value();
+  return std::string(token.value());
 }
 
 absl::StatusOr<std::string> Parser::ParseQuotedString(TokenPos* pos) {
@@ -320,7 +333,7 @@ absl::StatusOr<std::string> Parser::ParseQuotedString(TokenPos* pos) {
   if (pos != nullptr) {
     *pos = token.pos();
   }
-  return token.value();
+  return std::string(token.value());
 }
 
 absl::StatusOr<BValue> Parser::ParseAndResolveIdentifier(
@@ -572,7 +585,8 @@ absl::StatusOr<BValue> Parser::ParseNode(
   // should be given when constructing the node as the name is autogenerated
   // (the node has no meaningful given name). Otherwise, output_name is the
   // name of the node.
-  std::string node_name = split_name.has_value() ? "" : output_name.value();
+  std::string node_name =
+      split_name.has_value() ? "" : std::string(output_name.value());
 
   std::vector<BValue> operands;
   switch (op) {
@@ -1146,7 +1160,7 @@ absl::StatusOr<std::string> Parser::ParsePackageName() {
   XLS_ASSIGN_OR_RETURN(
       Token package_name,
       scanner_.PopTokenOrError(LexicalTokenType::kIdent, "package name"));
-  return package_name.value();
+  return std::string(package_name.value());
 }
 
 absl::StatusOr<Function*> Parser::ParseFunction(Package* package) {
@@ -1283,8 +1297,8 @@ absl::StatusOr<Channel*> Parser::ParseChannel(Package* package) {
             Token metadata_token,
             scanner_.PopTokenOrError(LexicalTokenType::kQuotedString));
         ChannelMetadataProto proto;
-        bool success =
-            google::protobuf::TextFormat::ParseFromString(metadata_token.value(), &proto);
+        bool success = google::protobuf::TextFormat::ParseFromString(
+            std::string(metadata_token.value()), &proto);
         if (!success) {
           return absl::InvalidArgumentError(
               absl::StrFormat("Invalid channel metadata @ %s",
@@ -1375,18 +1389,33 @@ absl::StatusOr<FunctionType*> Parser::ParseFunctionType(Package* package) {
   return package->GetFunctionType(parameter_types, return_type);
 }
 
+absl::Status Parser::ExpectEof(absl::string_view item) {
+  if (AtEof()) {
+    return absl::OkStatus();
+  }
+  XLS_ASSIGN_OR_RETURN(Token token, scanner_.PeekToken());
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unexpected text after %s @ %s: %s", item,
+                      token.pos().ToHumanString(), token.ToString()));
+}
+
 /* static */ absl::StatusOr<FunctionType*> Parser::ParseFunctionType(
     absl::string_view input_string, Package* package) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
-  return p.ParseFunctionType(package);
+  XLS_ASSIGN_OR_RETURN(FunctionType * function_type,
+                       p.ParseFunctionType(package));
+  XLS_RETURN_IF_ERROR(p.ExpectEof("function type"));
+  return function_type;
 }
 
 /* static */ absl::StatusOr<Type*> Parser::ParseType(
     absl::string_view input_string, Package* package) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
-  return p.ParseType(package);
+  XLS_ASSIGN_OR_RETURN(Type * type, p.ParseType(package));
+  XLS_RETURN_IF_ERROR(p.ExpectEof("type"));
+  return type;
 }
 
 // Verifies the given package. Replaces InternalError status codes with
@@ -1405,6 +1434,8 @@ absl::StatusOr<Function*> Parser::ParseFunction(absl::string_view input_string,
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
   XLS_ASSIGN_OR_RETURN(Function * function, p.ParseFunction(package));
+  XLS_RETURN_IF_ERROR(
+      p.ExpectEof(absl::StrFormat("function %s", function->name())));
 
   // Verify the whole package because the addition of the function may break
   // package-scoped invariants (eg, duplicate function name).
@@ -1418,6 +1449,7 @@ absl::StatusOr<Proc*> Parser::ParseProc(absl::string_view input_string,
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
   XLS_ASSIGN_OR_RETURN(Proc * proc, p.ParseProc(package));
+  XLS_RETURN_IF_ERROR(p.ExpectEof(absl::StrFormat("proc %s", proc->name())));
 
   // Verify the whole package because the addition of the proc may break
   // package-scoped invariants (eg, duplicate proc name).
@@ -1430,13 +1462,17 @@ absl::StatusOr<Channel*> Parser::ParseChannel(absl::string_view input_string,
                                               Package* package) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
-  return p.ParseChannel(package);
+  XLS_ASSIGN_OR_RETURN(Channel * channel, p.ParseChannel(package));
+  XLS_RETURN_IF_ERROR(
+      p.ExpectEof(absl::StrFormat("channel %s", channel->name())));
+  return channel;
 }
 
 /* static */
 absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackage(
     absl::string_view input_string,
     absl::optional<absl::string_view> filename) {
+  XLS_TRACE_SPAN("ParsePackage", filename.value_or(""));
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
                        ParsePackageNoVerify(input_string, filename));
   XLS_RETURN_IF_ERROR(VerifyAndSwapError(package.get()));
@@ -1453,6 +1489,21 @@ absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageWithEntry(
   return package;
 }
 
+/* static */
+absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageFile(
+    const std::filesystem::path& path,
+    absl::optional<absl::string_view> entry) {
+  XLS_ASSIGN_OR_RETURN(MappedFile file, MappedFile::Open(path));
+  if (IsSerializedPackage(file.contents())) {
+    return DeserializePackage(file.contents(), entry);
+  }
+  std::string filename = path.string();
+  if (entry.has_value()) {
+    return ParsePackageWithEntry(file.contents(), entry.value(), filename);
+  }
+  return ParsePackage(file.contents(), filename);
+}
+
 /* static */
 absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageNoVerify(
     absl::string_view input_string, absl::optional<absl::string_view> filename,
@@ -1460,19 +1511,273 @@ absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageNoVerify(
   return ParseDerivedPackageNoVerify<Package>(input_string, filename, entry);
 }
 
+/* static */
+absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageInParallel(
+    absl::string_view input_string, ThreadPool* pool,
+    absl::optional<absl::string_view> filename) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       ParsePackageNoVerifyImpl<Package>(
+                           input_string, filename, /*entry=*/absl::nullopt,
+                           pool));
+  XLS_RETURN_IF_ERROR(VerifyAndSwapError(package.get()));
+  return package;
+}
+
+namespace {
+
+// A top-level definition in the text of a package.
+struct PackageItem {
+  // "fn", "proc" or "chan".
+  absl::string_view keyword;
+  // The name of the function or proc.
+  absl::string_view name;
+  absl::string_view text;
+  // The functions named by "to_apply" and "body" attributes in a function.
+  std::vector<absl::string_view> callees;
+};
+
+// Splits the rest of the text scanned by "scanner" into its top-level
+// definitions without parsing them.
+absl::StatusOr<std::vector<PackageItem>> ScanPackageItems(
+    absl::string_view input_string, Scanner* scanner) {
+  std::vector<PackageItem> items;
+  absl::flat_hash_set<absl::string_view> callees;
+  int64_t depth = 0;
+  // How much of "<to_apply|body> = <callee>" the last tokens matched.
+  int64_t attribute_tokens = 0;
+  while (!scanner->AtEof()) {
+    XLS_ASSIGN_OR_RETURN(Token token, scanner->PopTokenOrError());
+    if (depth == 0 && token.type() == LexicalTokenType::kKeyword &&
+        (token.value() == "fn" || token.value() == "proc" ||
+         token.value() == "chan")) {
+      if (!items.empty()) {
+        items.back().text = absl::string_view(
+            items.back().text.data(),
+            token.value().data() - items.back().text.data());
+      }
+      PackageItem item;
+      item.keyword = token.value();
+      item.text = input_string.substr(token.value().data() -
+                                      input_string.data());
+      if (item.keyword != "chan") {
+        XLS_ASSIGN_OR_RETURN(
+            Token name, scanner->PopTokenOrError(LexicalTokenType::kIdent));
+        item.name = name.value();
+      }
+      items.push_back(std::move(item));
+      callees.clear();
+      continue;
+    }
+    if (items.empty()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Expected fn, proc, or chan definition, got %s @ %s", token.value(),
+          token.pos().ToHumanString()));
+    }
+    if (token.type() == LexicalTokenType::kCurlOpen) {
+      ++depth;
+    } else if (token.type() == LexicalTokenType::kCurlClose) {
+      --depth;
+    }
+    if (token.type() == LexicalTokenType::kIdent && attribute_tokens == 2) {
+      if (callees.insert(token.value()).second) {
+        items.back().callees.push_back(token.value());
+      }
+      attribute_tokens = 0;
+    } else if (token.type() == LexicalTokenType::kEquals &&
+               attribute_tokens == 1) {
+      attribute_tokens = 2;
+    } else if (token.type() == LexicalTokenType::kIdent &&
+               (token.value() == "to_apply" || token.value() == "body")) {
+      attribute_tokens = 1;
+    } else {
+      attribute_tokens = 0;
+    }
+  }
+  return items;
+}
+
+// Functions are staged with node ids from here up for the nodes whose ids the
+// text doesn't give, which tells them apart from those whose ids it does.
+constexpr int64_t kFirstStagedNodeId = int64_t{1} << 62;
+
+// Clones "staged" into "package", replacing its calls of stand-in functions
+// with calls of the package's functions of the same names. The nodes get the
+// ids parsing the function into "package" with next id "next_node_id" would
+// have given them, and "next_node_id" is advanced the same way.
+absl::Status MergeStagedFunction(Function* staged, Package* package,
+                                 int64_t* next_node_id) {
+  if (staged->return_value() == nullptr) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Function %s has no return value", staged->name()));
+  }
+  absl::flat_hash_map<const Function*, Function*> call_remapping;
+  for (const std::unique_ptr<Function>& stub : staged->package()->functions()) {
+    if (stub.get() != staged) {
+      XLS_ASSIGN_OR_RETURN(call_remapping[stub.get()],
+                           package->GetFunction(stub->name()));
+    }
+  }
+  // The parser creates the nodes in order, each taking the next id unless the
+  // text gives one, which then raises the next id past it.
+  absl::flat_hash_map<Node*, int64_t> ids;
+  for (Node* node : staged->nodes()) {
+    if (node->id() >= kFirstStagedNodeId) {
+      ids[node] = (*next_node_id)++;
+    } else {
+      ids[node] = node->id();
+      *next_node_id = std::max(*next_node_id + 1, node->id() + 1);
+    }
+  }
+
+  std::vector<Node*> originals;
+  for (Node* node : TopoSort(staged)) {
+    originals.push_back(node);
+  }
+  XLS_ASSIGN_OR_RETURN(Function * clone,
+                       staged->Clone(staged->name(), package, call_remapping));
+
+  // The clone's nodes were added in the above order, but with new ids and
+  // names; restore them.
+  auto clone_it = clone->nodes().begin();
+  for (Node* original : originals) {
+    XLS_RET_CHECK(clone_it != clone->nodes().end());
+    Node* node = *clone_it++;
+    XLS_RET_CHECK_EQ(node->op(), original->op());
+    node->set_id(ids.at(original));
+    if (!original->HasAssignedName()) {
+      node->ClearName();
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+/* static */
+ThreadPool* Parser::ParallelParsePool(absl::string_view input_string) {
+  if (input_string.size() < kParallelParseMinBytes) {
+    return nullptr;
+  }
+  ThreadPool* pool = ThreadPool::Default();
+  return pool->thread_count() > 1 ? pool : nullptr;
+}
+
+/* static */
+absl::StatusOr<Function*> Parser::ParseFunctionWithStubs(
+    absl::string_view function_text,
+    absl::Span<const absl::string_view> callee_texts, int64_t first_node_id,
+    Package* package) {
+  for (absl::string_view callee_text : callee_texts) {
+    XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(callee_text));
+    Parser p(std::move(scanner));
+    XLS_RETURN_IF_ERROR(p.scanner_.DropKeywordOrError("fn"));
+    absl::flat_hash_map<std::string, BValue> name_to_value;
+    XLS_ASSIGN_OR_RETURN(auto function_data,
+                         p.ParseFunctionSignature(&name_to_value, package));
+    FunctionBuilder* fb = function_data.first.get();
+    XLS_RETURN_IF_ERROR(
+        fb->BuildWithReturnValue(fb->Literal(ZeroOfType(function_data.second)))
+            .status());
+  }
+
+  package->set_next_node_id(first_node_id);
+  XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(function_text));
+  Parser p(std::move(scanner));
+  XLS_ASSIGN_OR_RETURN(Function * function, p.ParseFunction(package));
+  XLS_RETURN_IF_ERROR(
+      p.ExpectEof(absl::StrFormat("function %s", function->name())));
+  return function;
+}
+
+/* static */
+absl::Status Parser::ParsePackageBodyInParallel(absl::string_view input_string,
+                                                Package* package,
+                                                ThreadPool* pool) {
+  XLS_TRACE_SPAN("ParsePackageBodyInParallel", package->name());
+  XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
+  Parser parser(std::move(scanner));
+  XLS_RETURN_IF_ERROR(parser.ParsePackageName().status());
+  XLS_ASSIGN_OR_RETURN(std::vector<PackageItem> items,
+                       ScanPackageItems(input_string, &parser.scanner_));
+  absl::flat_hash_map<absl::string_view, const PackageItem*> functions;
+  for (const PackageItem& item : items) {
+    if (item.keyword == "fn" && !functions.emplace(item.name, &item).second) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Function %s is defined twice", item.name));
+    }
+  }
+
+  struct StagedFunction {
+    std::unique_ptr<Package> package;
+    Function* function = nullptr;
+  };
+  std::vector<StagedFunction> staged(items.size());
+  auto stage = [&](int64_t i) -> absl::Status {
+    if (items[i].keyword != "fn") {
+      return absl::OkStatus();
+    }
+    std::vector<absl::string_view> callee_texts;
+    for (absl::string_view callee : items[i].callees) {
+      auto it = functions.find(callee);
+      if (it == functions.end()) {
+        return absl::NotFoundError(
+            absl::StrFormat("No function named %s", callee));
+      }
+      callee_texts.push_back(it->second->text);
+    }
+    staged[i].package = absl::make_unique<Package>(package->name());
+    XLS_ASSIGN_OR_RETURN(
+        staged[i].function,
+        ParseFunctionWithStubs(items[i].text, callee_texts, kFirstStagedNodeId,
+                               staged[i].package.get()));
+    return absl::OkStatus();
+  };
+  XLS_RETURN_IF_ERROR(ParallelFor(0, items.size(), stage, pool));
+
+  // Cloning allocates ids of its own, so track the next id the sequential
+  // parser would have reached, keeping ids allocated later the same.
+  int64_t next_node_id = package->next_node_id();
+  for (int64_t i = 0; i < items.size(); ++i) {
+    if (items[i].keyword == "fn") {
+      XLS_RETURN_IF_ERROR(
+          MergeStagedFunction(staged[i].function, package, &next_node_id));
+      staged[i].package.reset();
+      continue;
+    }
+    package->set_next_node_id(next_node_id);
+    XLS_ASSIGN_OR_RETURN(auto item_scanner, Scanner::Create(items[i].text));
+    Parser p(std::move(item_scanner));
+    if (items[i].keyword == "proc") {
+      XLS_RETURN_IF_ERROR(p.ParseProc(package).status());
+    } else {
+      XLS_RETURN_IF_ERROR(p.ParseChannel(package).status());
+    }
+    XLS_RETURN_IF_ERROR(p.ExpectEof(
+        absl::StrFormat("%s %s", items[i].keyword, items[i].name)));
+    next_node_id = package->next_node_id();
+  }
+  package->set_next_node_id(next_node_id);
+  return absl::OkStatus();
+}
+
 /* static */
 absl::StatusOr<Value> Parser::ParseValue(absl::string_view input_string,
                                          Type* expected_type) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
-  return p.ParseValueInternal(expected_type);
+  XLS_ASSIGN_OR_RETURN(Value value, p.ParseValueInternal(expected_type));
+  XLS_RETURN_IF_ERROR(p.ExpectEof("value"));
+  return value;
 }
 
 /* static */
 absl::StatusOr<Value> Parser::ParseTypedValue(absl::string_view input_string) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser p(std::move(scanner));
-  return p.ParseValueInternal(/*expected_type=*/absl::nullopt);
+  XLS_ASSIGN_OR_RETURN(Value value,
+                       p.ParseValueInternal(/*expected_type=*/absl::nullopt));
+  XLS_RETURN_IF_ERROR(p.ExpectEof("value"));
+  return value;
 }
 
 }  // namespace xls
@@ -22,12 +22,17 @@
 #ifndef XLS_IR_IR_PARSER_H_
 #define XLS_IR_IR_PARSER_H_
 
+#include <cstdint>
+#include <filesystem>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/function.h"
@@ -42,6 +47,7 @@
 namespace xls {
 
 class ArgParser;
+class ThreadPool;
 
 class Parser {
  public:
@@ -56,6 +62,14 @@ class Parser {
       absl::string_view input_string, absl::string_view entry,
       absl::optional<absl::string_view> filename = absl::nullopt);
 
+  // Parses the IR file at the given path as a package, optionally setting the
+  // entry function. The file is memory mapped and lexed on demand, so its
+  // text is never copied into memory. Files in the binary IR format (see
+  // package_serializer.h) are also accepted.
+  static absl::StatusOr<std::unique_ptr<Package>> ParsePackageFile(
+      const std::filesystem::path& path,
+      absl::optional<absl::string_view> entry = absl::nullopt);
+
   // Parse the input_string as a function into the given package.
   static absl::StatusOr<Function*> ParseFunction(absl::string_view input_string,
                                                  Package* package);
@@ -91,6 +105,15 @@ class Parser {
       absl::optional<absl::string_view> filename = absl::nullopt,
       absl::optional<absl::string_view> entry = absl::nullopt);
 
+  // As ParsePackage, but parses the package's functions concurrently on "pool"
+  // whatever the package's size. The other package-parsing functions do this
+  // on the shared thread pool for packages of at least kParallelParseMinBytes.
+  static absl::StatusOr<std::unique_ptr<Package>> ParsePackageInParallel(
+      absl::string_view input_string, ThreadPool* pool,
+      absl::optional<absl::string_view> filename = absl::nullopt);
+
+  static constexpr int64_t kParallelParseMinBytes = 1 << 20;
+
   // Parses a literal value that should be of type "expected_type" and returns
   // it.
   static absl::StatusOr<Value> ParseValue(absl::string_view input_string,
@@ -107,7 +130,35 @@ class Parser {
  private:
   friend class ArgParser;
 
-  explicit Parser(Scanner scanner) : scanner_(scanner) {}
+  explicit Parser(Scanner scanner) : scanner_(std::move(scanner)) {}
+
+  // Implements ParseDerivedPackageNoVerify. If "pool" is given, the functions
+  // are parsed on it; should that fail, the package is parsed again
+  // sequentially to report the error at its position in the whole file.
+  template <typename PackageT>
+  static absl::StatusOr<std::unique_ptr<PackageT>> ParsePackageNoVerifyImpl(
+      absl::string_view input_string,
+      absl::optional<absl::string_view> filename,
+      absl::optional<absl::string_view> entry, ThreadPool* pool);
+
+  // Returns the pool to parse the package "input_string" on, or nullptr if it
+  // should be parsed sequentially.
+  static ThreadPool* ParallelParsePool(absl::string_view input_string);
+
+  // Parses the functions, procs and channels of the package "input_string"
+  // into "package". Each function is parsed on "pool" into a staging package
+  // of its own, then cloned into "package" in the order of the text.
+  static absl::Status ParsePackageBodyInParallel(absl::string_view input_string,
+                                                 Package* package,
+                                                 ThreadPool* pool);
+
+  // Parses the function "function_text" into "package", first adding stand-ins
+  // with the signatures of the functions "callee_texts" which it calls. Nodes
+  // whose ids the text doesn't give are numbered from "first_node_id".
+  static absl::StatusOr<Function*> ParseFunctionWithStubs(
+      absl::string_view function_text,
+      absl::Span<const absl::string_view> callee_texts, int64_t first_node_id,
+      Package* package);
 
   // Parse a function starting at the current scanner position.
   absl::StatusOr<Function*> ParseFunction(Package* package);
@@ -227,6 +278,11 @@ class Parser {
 
   bool AtEof() const { return scanner_.AtEof(); }
 
+  // Returns an error unless all of the input has been consumed, e.g., after
+  // parsing a single item with one of the static entry points above. A pending
+  // lexical error is returned as is.
+  absl::Status ExpectEof(absl::string_view item);
+
   Scanner scanner_;
 };
 
@@ -235,12 +291,32 @@ template <typename PackageT>
 absl::StatusOr<std::unique_ptr<PackageT>> Parser::ParseDerivedPackageNoVerify(
     absl::string_view input_string, absl::optional<absl::string_view> filename,
     absl::optional<absl::string_view> entry) {
+  return ParsePackageNoVerifyImpl<PackageT>(input_string, filename, entry,
+                                            ParallelParsePool(input_string));
+}
+
+/* static */
+template <typename PackageT>
+absl::StatusOr<std::unique_ptr<PackageT>> Parser::ParsePackageNoVerifyImpl(
+    absl::string_view input_string, absl::optional<absl::string_view> filename,
+    absl::optional<absl::string_view> entry, ThreadPool* pool) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser parser(std::move(scanner));
 
   XLS_ASSIGN_OR_RETURN(std::string package_name, parser.ParsePackageName());
 
   auto package = absl::make_unique<PackageT>(package_name, entry);
+  if (pool != nullptr) {
+    absl::Status status =
+        ParsePackageBodyInParallel(input_string, package.get(), pool);
+    if (status.ok()) {
+      if (entry.has_value()) {
+        XLS_RETURN_IF_ERROR(package->GetFunction(*entry).status());
+      }
+      return package;
+    }
+    package = absl::make_unique<PackageT>(package_name, entry);
+  }
   std::string filename_str =
       (filename.has_value() ? std::string(filename.value()) : "<unknown file>");
   while (!parser.AtEof()) {
@@ -18,8 +18,10 @@
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/strings/substitute.h"
+#include "xls/common/file/temp_file.h"
 #include "xls/common/source_location.h"
 #include "xls/common/status/matchers.h"
+#include "xls/common/thread_pool.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/number_parser.h"
 
@@ -942,6 +944,32 @@ TEST(IrParserTest, ParseEmptyStringAsPackage) {
                        HasSubstr("Expected token, but found EOF")));
 }
 
+TEST(IrParserTest, ParsePackageFile) {
+  std::string input = R"(package p
+
+fn f(x: bits[8]) -> bits[8] {
+  ret neg.2: bits[8] = neg(x, id=2)
+}
+
+fn g(x: bits[8]) -> bits[8] {
+  ret invoke.4: bits[8] = invoke(x, to_apply=f, id=4)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(input, ".ir"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackageFile(temp_file.path()));
+  ExpectStringsSimilar(package->DumpIr(), input);
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      package, Parser::ParsePackageFile(temp_file.path(), /*entry=*/"g"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry, package->EntryFunction());
+  EXPECT_EQ(entry->name(), "g");
+
+  EXPECT_THAT(Parser::ParsePackageFile("/does/not/exist.ir").status(),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
 TEST(IrParserTest, ParsePackageWithMissingPackageLine) {
   std::string input = R"(fn two_plus_two() -> bits[32] {
   literal.1: bits[32] = literal(value=2, id=1)
@@ -2128,6 +2156,57 @@ fn f(x: bits[4]) -> bits[4] {
   EXPECT_EQ(f->return_value()->operand(0)->operand(0)->operand(0)->id(), 2);
 }
 
+TEST(IrParserTest, ParsePackageInParallel) {
+  const std::string input = R"(package test
+
+chan ch(bits[32], id=0, kind=streaming, ops=send_receive, metadata="""""")
+
+fn body(i: bits[4], accum: bits[32]) -> bits[32] {
+  zero_ext.3: bits[32] = zero_ext(i, new_bit_count=32, id=3)
+  ret add.4: bits[32] = add(zero_ext.3, accum, id=4)
+}
+
+fn negate(x: bits[32]) -> bits[32] {
+  ret neg.6: bits[32] = neg(x, id=6)
+}
+
+proc my_proc(my_token: token, my_state: bits[32], init=42) {
+  send.9: token = send(my_token, my_state, channel_id=0, id=9)
+  next (send.9, my_state)
+}
+
+fn main(x: bits[32], xs: bits[32][2]) -> (bits[32], bits[32][2]) {
+  counted_for.12: bits[32] = counted_for(x, trip_count=16, stride=1, body=body, id=12)
+  sum: bits[32] = invoke(counted_for.12, to_apply=negate)
+  map.14: bits[32][2] = map(xs, to_apply=negate, id=14)
+  ret tuple.15: (bits[32], bits[32][2]) = tuple(sum, map.14, id=15)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> expected,
+                           Parser::ParsePackage(input));
+  ThreadPool pool(4);
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackageInParallel(input, &pool));
+  EXPECT_EQ(package->DumpIr(), expected->DumpIr());
+  EXPECT_EQ(package->next_node_id(), expected->next_node_id());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * negate, package->GetFunction("negate"));
+  EXPECT_EQ(main->return_value()->operand(1)->As<Map>()->to_apply(), negate);
+}
+
+TEST(IrParserTest, ParsePackageInParallelReportsErrorPosition) {
+  const std::string input = R"(package test
+
+fn f(x: bits[32]) -> bits[32] {
+  ret invoke.2: bits[32] = invoke(x, to_apply=missing, id=2)
+}
+)";
+  ThreadPool pool(2);
+  absl::Status status = Parser::ParsePackageInParallel(input, &pool).status();
+  EXPECT_EQ(status, Parser::ParsePackage(input).status());
+  EXPECT_FALSE(status.ok());
+}
+
 TEST(IrParserTest, MismatchedId) {
   const std::string input = R"(
 fn f(x: bits[4]) -> bits[4] {
@@ -2142,4 +2221,37 @@ fn f(x: bits[4]) -> bits[4] {
                          "id '42' specified as an attribute")));
 }
 
+TEST(IrParserTest, RejectsTextAfterSingleItem) {
+  Package p("my_package");
+  XLS_EXPECT_OK(Parser::ParseTypedValue("bits[8]:5  // comment\n").status());
+  // A character which cannot be lexed after the item is still an error even
+  // though the scanner only lexes it once the item has been parsed.
+  EXPECT_FALSE(Parser::ParseTypedValue("bits[8]:5 $").ok());
+  EXPECT_THAT(Parser::ParseTypedValue("bits[8]:5 bits[8]:6").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected text after value")));
+  EXPECT_THAT(Parser::ParseValue("5 6", p.GetBitsType(8)).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected text after value")));
+  EXPECT_THAT(Parser::ParseType("bits[8] bits[4]", &p).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected text after type")));
+  EXPECT_FALSE(Parser::ParseType("(bits[8]) $", &p).ok());
+  EXPECT_THAT(
+      Parser::ParseFunctionType("(bits[8]) -> bits[8] )", &p).status(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("Unexpected text after function type")));
+  EXPECT_THAT(Parser::ParseFunction(R"(
+fn f(x: bits[4]) -> bits[4] {
+  ret x: bits[4] = param(name=x)
+}
+fn g(y: bits[4]) -> bits[4] {
+  ret y: bits[4] = param(name=y)
+})",
+                                    &p)
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected text after function f")));
+}
+
 }  // namespace xls
@@ -14,7 +14,9 @@
 
 #include "xls/ir/ir_scanner.h"
 
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
@@ -112,18 +114,35 @@ std::string Token::ToString() const {
                          pos_.ToHumanString());
 }
 
-namespace {
-
-// Helper class for tokenizing a string.
-// TODO(meheff): This could be combined into Scanner class and made lazy at the
-// same time.
+// Helper class for tokenizing a string one token at a time.
 class Tokenizer {
  public:
+  explicit Tokenizer(absl::string_view str) : str_(str) {}
+
   // Tokenizes the given string and returns the vector of Tokens.
   static absl::StatusOr<std::vector<Token>> TokenizeString(
       absl::string_view str) {
     Tokenizer tokenizer(str);
-    return tokenizer.Tokenize();
+    std::vector<Token> tokens;
+    while (true) {
+      XLS_ASSIGN_OR_RETURN(absl::optional<Token> token, tokenizer.Next());
+      if (!token.has_value()) {
+        return tokens;
+      }
+      tokens.push_back(std::move(token.value()));
+    }
+  }
+
+  // Lexes and returns the next token in the string, or nullopt if the end of
+  // the string has been reached.
+  absl::StatusOr<absl::optional<Token>> Next() {
+    while (!EndOfString()) {
+      if (DropWhiteSpace() || DropEndOfLineComment()) {
+        continue;
+      }
+      return LexToken();
+    }
+    return absl::nullopt;
   }
 
  private:
@@ -222,127 +241,114 @@ class Tokenizer {
     return absl::string_view(str_.data() + start, index_ - start);
   }
 
-  // Tokenizes the internal string.
-  absl::StatusOr<std::vector<Token>> Tokenize() {
-    std::vector<Token> tokens;
-    while (!EndOfString()) {
-      if (DropWhiteSpace() || DropEndOfLineComment()) {
-        continue;
-      }
+  // Lexes a single token starting at the current index, which must be the
+  // start of a token (i.e., not whitespace or a comment).
+  absl::StatusOr<Token> LexToken() {
+    const int64_t start_lineno = lineno();
+    const int64_t start_colno = colno();
+
+    // Literal numbers can decimal, binary (eg, 0b0101) or hexadecimal (eg,
+    // 0xbeef) so capture all alphanumeric characters after the initial
+    // digit. Literal numbers can also contain '_'s after the first
+    // character which are used to improve readability (example:
+    // '0xabcd_ef00').
+    if (isdigit(current()) ||
+        (current() == '-' && next().has_value() && isdigit(*next()))) {
+      absl::string_view value = CaptureWhile(
+          [](char c) { return absl::ascii_isalnum(c) || c == '_'; },
+          /*min_chars=*/1);
+      return Token(LexicalTokenType::kLiteral, value, start_lineno,
+                   start_colno);
+    }
 
-      const int64_t start_lineno = lineno();
-      const int64_t start_colno = colno();
-
-      // Literal numbers can decimal, binary (eg, 0b0101) or hexadecimal (eg,
-      // 0xbeef) so capture all alphanumeric characters after the initial
-      // digit. Literal numbers can also contain '_'s after the first
-      // character which are used to improve readability (example:
-      // '0xabcd_ef00').
-      if (isdigit(current()) ||
-          (current() == '-' && next().has_value() && isdigit(*next()))) {
-        absl::string_view value = CaptureWhile(
-            [](char c) { return absl::ascii_isalnum(c) || c == '_'; },
-            /*min_chars=*/1);
-        tokens.push_back(Token(LexicalTokenType::kLiteral, value, start_lineno,
-                               start_colno));
-        continue;
-      }
+    if (isalpha(current()) || current() == '_') {
+      absl::string_view value = CaptureWhile([](char c) {
+        return isalpha(c) || c == '_' || c == '.' || isdigit(c);
+      });
+      return Token::MakeIdentOrKeyword(value, start_lineno, start_colno);
+    }
 
-      if (isalpha(current()) || current() == '_') {
-        absl::string_view value = CaptureWhile([](char c) {
-          return isalpha(c) || c == '_' || c == '.' || isdigit(c);
-        });
-        tokens.push_back(
-            Token::MakeIdentOrKeyword(value, start_lineno, start_colno));
-        continue;
-      }
+    // Look for multi-character tokens.
+    if (MatchSubstring("->")) {
+      Advance(2);
+      return Token(LexicalTokenType::kRightArrow, "->", start_lineno,
+                   start_colno);
+    }
 
-      // Look for multi-character tokens.
-      if (MatchSubstring("->")) {
-        tokens.push_back(Token(LexicalTokenType::kRightArrow, "->",
-                               start_lineno, start_colno));
-        Advance(2);
-        continue;
-      }
+    // Match quoted strings. Double-quoted strings (e.g., "foo") and
+    // triple-double-quoted strings (e.g., """foo""") are allowed. Only
+    // triple-double-quoted strings can contain new lines.
+    absl::optional<absl::string_view> content;
+    XLS_ASSIGN_OR_RETURN(
+        content, MatchQuotedString("\"\"\"", /*allow_multiline=*/true));
+    if (content.has_value()) {
+      return Token(LexicalTokenType::kQuotedString, content.value(),
+                   start_lineno, start_colno);
+    }
+    XLS_ASSIGN_OR_RETURN(content,
+                         MatchQuotedString("\"", /*allow_multiline=*/false));
+    if (content.has_value()) {
+      return Token(LexicalTokenType::kQuotedString, content.value(),
+                   start_lineno, start_colno);
+    }
 
-      // Match quoted strings. Double-quoted strings (e.g., "foo") and
-      // triple-double-quoted strings (e.g., """foo""") are allowed. Only
-      // triple-double-quoted strings can contain new lines.
-      absl::optional<absl::string_view> content;
-      XLS_ASSIGN_OR_RETURN(
-          content, MatchQuotedString("\"\"\"", /*allow_multiline=*/true));
-      if (content.has_value()) {
-        tokens.push_back(Token(LexicalTokenType::kQuotedString, content.value(),
-                               start_lineno, start_colno));
-        continue;
-      }
-      XLS_ASSIGN_OR_RETURN(content,
-                           MatchQuotedString("\"", /*allow_multiline=*/false));
-      if (content.has_value()) {
-        tokens.push_back(Token(LexicalTokenType::kQuotedString, content.value(),
-                               start_lineno, start_colno));
-        continue;
-      }
+    // Handle single-character tokens.
+    LexicalTokenType token_type;
 
-      // Handle single-character tokens.
-      LexicalTokenType token_type;
-
-      switch (current()) {
-        case '-':
-          token_type = LexicalTokenType::kMinus;
-          break;
-        case '+':
-          token_type = LexicalTokenType::kAdd;
-          break;
-        case '.':
-          token_type = LexicalTokenType::kDot;
-          break;
-        case ':':
-          token_type = LexicalTokenType::kColon;
-          break;
-        case ',':
-          token_type = LexicalTokenType::kComma;
-          break;
-        case '=':
-          token_type = LexicalTokenType::kEquals;
-          break;
-        case '[':
-          token_type = LexicalTokenType::kBracketOpen;
-          break;
-        case ']':
-          token_type = LexicalTokenType::kBracketClose;
-          break;
-        case '{':
-          token_type = LexicalTokenType::kCurlOpen;
-          break;
-        case '}':
-          token_type = LexicalTokenType::kCurlClose;
-          break;
-        case '(':
-          token_type = LexicalTokenType::kParenOpen;
-          break;
-        case ')':
-          token_type = LexicalTokenType::kParenClose;
-          break;
-        case '>':
-          token_type = LexicalTokenType::kGt;
-          break;
-        case '<':
-          token_type = LexicalTokenType::kLt;
-          break;
-        default:
-          std::string char_str = absl::ascii_iscntrl(current())
-                                     ? absl::StrFormat("\\x%02x", current())
-                                     : std::string(1, current());
-          XLS_LOG(ERROR) << "IR text with error: " << str_;
-          return absl::InvalidArgumentError(absl::StrFormat(
-              "Invalid character in IR text \"%s\" @ %s", char_str,
-              TokenPos{lineno(), colno()}.ToHumanString()));
-      }
-      tokens.push_back(Token(token_type, lineno(), colno()));
-      Advance();
+    switch (current()) {
+      case '-':
+        token_type = LexicalTokenType::kMinus;
+        break;
+      case '+':
+        token_type = LexicalTokenType::kAdd;
+        break;
+      case '.':
+        token_type = LexicalTokenType::kDot;
+        break;
+      case ':':
+        token_type = LexicalTokenType::kColon;
+        break;
+      case ',':
+        token_type = LexicalTokenType::kComma;
+        break;
+      case '=':
+        token_type = LexicalTokenType::kEquals;
+        break;
+      case '[':
+        token_type = LexicalTokenType::kBracketOpen;
+        break;
+      case ']':
+        token_type = LexicalTokenType::kBracketClose;
+        break;
+      case '{':
+        token_type = LexicalTokenType::kCurlOpen;
+        break;
+      case '}':
+        token_type = LexicalTokenType::kCurlClose;
+        break;
+      case '(':
+        token_type = LexicalTokenType::kParenOpen;
+        break;
+      case ')':
+        token_type = LexicalTokenType::kParenClose;
+        break;
+      case '>':
+        token_type = LexicalTokenType::kGt;
+        break;
+      case '<':
+        token_type = LexicalTokenType::kLt;
+        break;
+      default:
+        std::string char_str = absl::ascii_iscntrl(current())
+                                   ? absl::StrFormat("\\x%02x", current())
+                                   : std::string(1, current());
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Invalid character in IR text \"%s\" @ %s", char_str,
+            TokenPos{lineno(), colno()}.ToHumanString()));
     }
-    return tokens;
+    Token token(token_type, lineno(), colno());
+    Advance();
+    return token;
   }
 
   // Returns the character at the current index.
@@ -365,8 +371,6 @@ class Tokenizer {
   int64_t colno() const { return colno_; }
 
  private:
-  explicit Tokenizer(absl::string_view str) : str_(str) {}
-
   // The string being tokenized.
   absl::string_view str_;
 
@@ -378,25 +382,52 @@ class Tokenizer {
   int64_t colno_ = 0;
 };
 
-}  // namespace
-
 absl::StatusOr<std::vector<Token>> TokenizeString(absl::string_view str) {
   return Tokenizer::TokenizeString(str);
 }
 
 absl::StatusOr<Scanner> Scanner::Create(absl::string_view text) {
-  XLS_ASSIGN_OR_RETURN(auto tokens, TokenizeString(text));
-  return Scanner(std::move(tokens));
+  Scanner scanner(std::make_unique<Tokenizer>(text));
+  XLS_RETURN_IF_ERROR(scanner.status_);
+  return std::move(scanner);
+}
+
+Scanner::Scanner(std::unique_ptr<Tokenizer> tokenizer)
+    : tokenizer_(std::move(tokenizer)) {
+  Advance();
+}
+
+Scanner::~Scanner() = default;
+Scanner::Scanner(Scanner&& other) = default;
+Scanner& Scanner::operator=(Scanner&& other) = default;
+
+void Scanner::Advance() {
+  absl::StatusOr<absl::optional<Token>> next = tokenizer_->Next();
+  if (!next.ok()) {
+    lookahead_ = absl::nullopt;
+    status_ = next.status();
+    return;
+  }
+  lookahead_ = next.value();
 }
 
 absl::StatusOr<Token> Scanner::PeekToken() const {
+  XLS_RETURN_IF_ERROR(status_);
   if (AtEof()) {
     return absl::InvalidArgumentError("Expected token, but found EOF.");
   }
-  return tokens_[token_idx_];
+  return *lookahead_;
+}
+
+Token Scanner::PopToken() {
+  Token token = PeekTokenOrDie();
+  XLS_VLOG(3) << "Popping token: " << token;
+  Advance();
+  return token;
 }
 
 absl::StatusOr<Token> Scanner::PopTokenOrError(absl::string_view context) {
+  XLS_RETURN_IF_ERROR(status_);
   if (AtEof()) {
     std::string context_str =
         context.empty() ? std::string("") : absl::StrCat(" in ", context);
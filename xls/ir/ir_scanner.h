@@ -16,11 +16,15 @@
 #define XLS_IR_IR_SCANNER_H_
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/bits.h"
 
@@ -58,6 +62,8 @@ struct TokenPos {
   std::string ToHumanString() const;
 };
 
+// A lexical token. Tokens do not own their payload: value() refers directly
+// into the text being scanned, which must outlive the token.
 class Token {
  public:
   // Returns the (singleton) set of keyword strings.
@@ -88,7 +94,7 @@ class Token {
       : type_(type), value_(value), pos_({lineno, colno}) {}
 
   LexicalTokenType type() const { return type_; }
-  const std::string& value() const { return value_; }
+  absl::string_view value() const { return value_; }
   const TokenPos& pos() const { return pos_; }
 
   // Returns the token as a (u)int64_t value. Token must be a literal. The
@@ -112,7 +118,7 @@ class Token {
 
  private:
   LexicalTokenType type_;
-  std::string value_;
+  absl::string_view value_;
   TokenPos pos_;
 };
 
@@ -122,35 +128,45 @@ inline std::ostream& operator<<(std::ostream& os, const Token& token) {
 }
 
 // Tokenizes the given string and returns the tokens. It maintains precise
-// source location information.  Right now this is a eager implementation - it
-// tokenizes the whole input. This can be easily changed later to a more demand
-// driven tokenization.
+// source location information. This eagerly tokenizes the whole input; the
+// Scanner below lexes on demand instead.
 absl::StatusOr<std::vector<Token>> TokenizeString(absl::string_view str);
 
+class Tokenizer;
+
+// Demand-driven token stream over IR text. Only a single token of lookahead is
+// materialized at a time, so memory use is independent of the input size. The
+// text (e.g., the contents of a MappedFile) must outlive the scanner and any
+// tokens it returns.
 class Scanner {
  public:
+  // Creates a scanner over the given text. Returns an error if the first
+  // token cannot be lexed; errors later in the text are returned when the
+  // scanner reaches them.
   static absl::StatusOr<Scanner> Create(absl::string_view text);
 
+  ~Scanner();
+  Scanner(Scanner&& other);
+  Scanner& operator=(Scanner&& other);
+
   // Peeks at the next token in the token stream, or returns an error if we're
-  // at EOF and no more tokens are available.
+  // at EOF and no more tokens are available or the next token could not be
+  // lexed.
   absl::StatusOr<Token> PeekToken() const;
 
   // Return the current token.
   const Token& PeekTokenOrDie() const {
-    XLS_CHECK(!AtEof());
-    return tokens_[token_idx_];
+    XLS_CHECK(lookahead_.has_value()) << status_;
+    return *lookahead_;
   }
 
   // Helper that makes sure we don't peek past EOF.
   bool PeekTokenIs(LexicalTokenType target) const {
-    return !AtEof() && PeekTokenOrDie().type() == target;
+    return lookahead_.has_value() && lookahead_->type() == target;
   }
 
-  // Pop the current token, advance token pointer to next token.
-  Token PopToken() {
-    XLS_VLOG(3) << "Popping token: " << tokens_[token_idx_];
-    return tokens_.at(token_idx_++);
-  }
+  // Pop the current token, lex the next token.
+  Token PopToken();
 
   // Same as PopToken() but returns a status error if we are at EOF (in which
   // case a token cannot be popped).
@@ -190,14 +206,20 @@ class Scanner {
   // Returns an absl::Status error if we cannot.
   absl::Status DropKeywordOrError(absl::string_view keyword);
 
-  // Check if more tokens are available.
-  bool AtEof() const { return token_idx_ >= tokens_.size(); }
+  // Check if more tokens are available. A pending lexical error is not EOF:
+  // the error is returned by the next attempt to peek or pop.
+  bool AtEof() const { return !lookahead_.has_value() && status_.ok(); }
 
  private:
-  explicit Scanner(std::vector<Token> tokens) : tokens_(tokens) {}
+  explicit Scanner(std::unique_ptr<Tokenizer> tokenizer);
+
+  // Lexes the next token of the text into lookahead_. On error lookahead_ is
+  // cleared and the error is latched in status_.
+  void Advance();
 
-  int64_t token_idx_ = 0;
-  std::vector<Token> tokens_;
+  std::unique_ptr<Tokenizer> tokenizer_;
+  absl::optional<Token> lookahead_;
+  absl::Status status_;
 };
 
 }  // namespace xls
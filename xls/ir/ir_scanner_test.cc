@@ -32,7 +32,7 @@ using testing::HasSubstr;
 std::vector<std::string> TokensToStrings(absl::Span<const Token> tokens) {
   std::vector<std::string> strs;
   for (const Token& token : tokens) {
-    strs.push_back(token.value());
+    strs.push_back(std::string(token.value()));
   }
   return strs;
 }
@@ -176,5 +176,35 @@ TEST(IrScannerTest, UnterminatedTripleQuotedStrings) {
                HasSubstr("Unterminated quoted string starting at 1:1")));
 }
 
+TEST(IrScannerTest, ScannerTokensReferToInputText) {
+  std::string text = "fn foo";
+  XLS_ASSERT_OK_AND_ASSIGN(Scanner scanner, Scanner::Create(text));
+  XLS_ASSERT_OK_AND_ASSIGN(Token fn, scanner.PopTokenOrError());
+  XLS_ASSERT_OK_AND_ASSIGN(Token foo, scanner.PopTokenOrError());
+  EXPECT_EQ(fn.value().data(), text.data());
+  EXPECT_EQ(foo.value().data(), text.data() + 3);
+  EXPECT_TRUE(scanner.AtEof());
+}
+
+TEST(IrScannerTest, ScannerLexesOnDemand) {
+  // The invalid character is only diagnosed once the scanner reaches it.
+  XLS_ASSERT_OK_AND_ASSIGN(Scanner scanner, Scanner::Create("fn foo $"));
+  XLS_EXPECT_OK(scanner.DropKeywordOrError("fn"));
+  EXPECT_TRUE(scanner.PeekTokenIs(LexicalTokenType::kIdent));
+  XLS_ASSERT_OK_AND_ASSIGN(Token foo, scanner.PopTokenOrError());
+  EXPECT_EQ(foo.value(), "foo");
+  EXPECT_FALSE(scanner.AtEof());
+  EXPECT_FALSE(scanner.PeekTokenIs(LexicalTokenType::kIdent));
+  EXPECT_THAT(scanner.PopTokenOrError(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Invalid character in IR text \"$\" @ 1:8")));
+}
+
+TEST(IrScannerTest, ScannerInvalidFirstToken) {
+  EXPECT_THAT(Scanner::Create("  $ fn").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Invalid character in IR text")));
+}
+
 }  // namespace
 }  // namespace xls
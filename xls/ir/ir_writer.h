@@ -0,0 +1,75 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_IR_IR_WRITER_H_
+#define XLS_IR_IR_WRITER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace xls {
+
+// Accumulates IR text and hands it to a sink in chunks, so large packages can
+// be dumped without building their whole text in memory. Text is appended to
+// buffer() and the writer flushes it to the sink whenever MaybeFlush() finds
+// more than the flush threshold buffered.
+class IrWriter {
+ public:
+  static constexpr int64_t kDefaultFlushThreshold = 1 << 16;
+
+  // Receives successive chunks of the text. The first error it returns stops
+  // further writes and is returned by Close().
+  using Sink = std::function<absl::Status(absl::string_view chunk)>;
+
+  explicit IrWriter(Sink sink,
+                    int64_t flush_threshold = kDefaultFlushThreshold)
+      : sink_(std::move(sink)), flush_threshold_(flush_threshold) {}
+
+  std::string* buffer() { return &buffer_; }
+
+  void MaybeFlush() {
+    if (buffer_.size() >= flush_threshold_) {
+      Flush();
+    }
+  }
+
+  // Flushes the remaining text and returns the first error of the sink, if
+  // any.
+  absl::Status Close() {
+    Flush();
+    return status_;
+  }
+
+ private:
+  void Flush() {
+    if (status_.ok() && !buffer_.empty()) {
+      status_ = sink_(buffer_);
+    }
+    buffer_.clear();
+  }
+
+  Sink sink_;
+  int64_t flush_threshold_;
+  std::string buffer_;
+  absl::Status status_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_IR_IR_WRITER_H_
@@ -68,18 +68,30 @@ absl::Status Node::AddNodeToFunctionAndReplace(
   return ReplaceUsesWith(replacement_ptr);
 }
 
+namespace {
+
+bool IdLessThan(const Node* a, const Node* b) { return a->id() < b->id(); }
+
+}  // namespace
+
 void Node::AddUser(Node* user) {
-  auto insert_result = users_set_.insert(user);
-  if (insert_result.second) {
-    users_.push_back(user);
-    // Keep the users sequence sorted by ordinal for stability.
-    absl::c_sort(users_, [](Node* a, Node* b) { return a->id() < b->id(); });
+  // Keep the users sequence sorted by ordinal for stability. Ids are normally
+  // unique, but set_id() can introduce duplicates so search the whole range of
+  // nodes with the user's id.
+  auto [begin, end] = absl::c_equal_range(users_, user, IdLessThan);
+  if (std::find(begin, end, user) == end) {
+    users_.insert(end, user);
+    function_base()->MarkChanged(this);
   }
 }
 
 void Node::RemoveUser(Node* user) {
-  users_set_.erase(user);
-  users_.erase(std::remove(users_.begin(), users_.end(), user), users_.end());
+  auto [begin, end] = absl::c_equal_range(users_, user, IdLessThan);
+  auto it = std::find(begin, end, user);
+  if (it != end) {
+    users_.erase(it);
+    function_base()->MarkChanged(this);
+  }
 }
 
 absl::Status Node::VisitSingleNode(DfsVisitor* visitor) {
@@ -541,7 +553,8 @@ std::string Node::GetUsersString() const {
 }
 
 bool Node::HasUser(const Node* target) const {
-  return users_set_.find(const_cast<Node*>(target)) != users_set_.end();
+  auto [begin, end] = absl::c_equal_range(users_, target, IdLessThan);
+  return std::find(begin, end, target) != end;
 }
 
 bool Node::IsDead() const {
@@ -549,6 +562,13 @@ bool Node::IsDead() const {
          !function_base()->HasImplicitUse(const_cast<Node*>(this));
 }
 
+bool Node::ChangedSince(int64_t change_count) const {
+  return change_count_ > change_count ||
+         absl::c_any_of(operands_, [&](Node* operand) {
+           return operand->change_count_ > change_count;
+         });
+}
+
 bool Node::HasOperand(const Node* target) const {
   for (const Node* operand : operands_) {
     if (operand == target) {
@@ -569,7 +589,15 @@ int64_t Node::OperandInstanceCount(const Node* target) const {
 }
 
 void Node::set_id(int64_t id) {
+  // The node's position in its operands' (id-sorted) user lists depends on
+  // the id.
+  for (Node* operand : operands_) {
+    operand->RemoveUser(this);
+  }
   id_ = id;
+  for (Node* operand : operands_) {
+    operand->AddUser(this);
+  }
   package()->set_next_node_id(std::max(id + 1, package()->next_node_id()));
 }
 
@@ -597,10 +625,19 @@ bool Node::ReplaceOperand(Node* old_operand, Node* new_operand) {
       operands_[i] = new_operand;
     }
   }
+  if (did_replace) {
+    function_base()->MarkChanged(this);
+  }
   old_operand->RemoveUser(this);
   return did_replace;
 }
 
+void Node::SwapOperands(int64_t a, int64_t b) {
+  // Operand/user chains already set up properly.
+  std::swap(operands_[a], operands_[b]);
+  function_base()->MarkChanged(this);
+}
+
 absl::Status Node::ReplaceOperandNumber(int64_t operand_no, Node* new_operand,
                                         bool type_must_match) {
   Node* old_operand = operands_[operand_no];
@@ -614,6 +651,7 @@ absl::Status Node::ReplaceOperandNumber(int64_t operand_no, Node* new_operand,
   // node in another operand slot, it is safe to call.
   new_operand->AddUser(this);
   operands_[operand_no] = new_operand;
+  function_base()->MarkChanged(this);
 
   for (Node* operand : operands()) {
     if (operand == old_operand) {
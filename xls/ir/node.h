@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
@@ -119,10 +120,7 @@ class Node {
   absl::StatusOr<bool> ReplaceImplicitUsesWith(Node* replacement);
 
   // Swaps the operands at indices 'a' and 'b' in the operands sequence.
-  void SwapOperands(int64_t a, int64_t b) {
-    // Operand/user chains already set up properly.
-    std::swap(operands_[a], operands_[b]);
-  }
+  void SwapOperands(int64_t a, int64_t b);
 
   // Returns true if analysis indicates that this node always produces the
   // same value as 'other' when run with the same operands. The analysis is
@@ -209,6 +207,20 @@ class Node {
 
   int64_t id() const { return id_; }
 
+  // Returns the index of this node within its function, assigned when the node
+  // is added. Indices are dense (below FunctionBase::node_index_limit) and, as
+  // they are never reused within a function, key side tables such as NodeMap
+  // without hashing.
+  int64_t node_index() const { return node_index_; }
+
+  // Returns the change count of the function (see FunctionBase::change_count)
+  // at the most recent change to this node.
+  int64_t change_count() const { return change_count_; }
+
+  // Returns true if this node or any of its operands has changed since the
+  // function's change count was 'change_count'.
+  bool ChangedSince(int64_t change_count) const;
+
   // Note: use with caution, the id should be unique among all nodes in a
   // function.
   void set_id(int64_t id);
@@ -263,10 +275,23 @@ class Node {
   absl::optional<SourceLocation> loc_;
   std::string name_;
 
-  std::vector<Node*> operands_;
+  // Most nodes have few operands and users, so both are stored inline. Users
+  // are kept sorted by id (and deduplicated), which makes lookups a binary
+  // search without a separate set.
+  absl::InlinedVector<Node*, 3> operands_;
+  absl::InlinedVector<Node*, 2> users_;
+
+ private:
+  // Links in the intrusive list of nodes owned by the function, maintained by
+  // FunctionBase.
+  Node* prev_node_ = nullptr;
+  Node* next_node_ = nullptr;
+
+  // Maintained by FunctionBase::MarkChanged.
+  int64_t change_count_ = 0;
 
-  absl::flat_hash_set<Node*> users_set_;
-  std::vector<Node*> users_;
+  // Assigned by FunctionBase::AddNode.
+  int64_t node_index_ = -1;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Node& node) {
@@ -23,7 +23,7 @@
 
 namespace xls {
 
-void NodeIterator::Initialize() {
+/* static */ std::vector<Node*> NodeIterator::ComputeOrder(FunctionBase* f) {
   // For topological traversal we only add nodes to the order when all of its
   // users have been scheduled.
   //
@@ -37,11 +37,11 @@ void NodeIterator::Initialize() {
   // keeps track of how many more users must be seen (before that node is ready
   // to place into the ordering).
   absl::flat_hash_map<Node*, int64_t> pending_to_remaining_users;
-  pending_to_remaining_users.reserve(f_->node_count());
+  pending_to_remaining_users.reserve(f->node_count());
   std::deque<Node*> ready;
 
-  ordered_ = absl::make_unique<std::vector<Node*>>();
-  ordered_->reserve(f_->node_count());
+  std::vector<Node*> ordered;
+  ordered.reserve(f->node_count());
 
   auto is_scheduled = [&](Node* n) {
     auto it = pending_to_remaining_users.find(n);
@@ -71,7 +71,7 @@ void NodeIterator::Initialize() {
     XLS_VLOG(4) << "Adding node to order: " << r;
     XLS_DCHECK(all_users_scheduled(r))
         << r << " users size: " << r->users().size();
-    ordered_->push_back(r);
+    ordered.push_back(r);
 
     // We want to be careful to only bump down our operands once, since we're a
     // single user, even though we may refer to them multiple times in our
@@ -99,7 +99,7 @@ void NodeIterator::Initialize() {
   };
 
   Node* return_value = nullptr;
-  for (Node* node : f_->nodes()) {
+  for (Node* node : f->nodes()) {
     if (node->users().empty()) {
       if (is_return_value(node)) {
         // Note: we special case the return value so it always comes at the
@@ -131,7 +131,8 @@ void NodeIterator::Initialize() {
   }
 #endif
 
-  absl::c_reverse(*ordered_);
+  absl::c_reverse(ordered);
+  return ordered;
 }
 
 }  // namespace xls
@@ -15,6 +15,9 @@
 #ifndef XLS_IR_NODE_ITERATOR_H_
 #define XLS_IR_NODE_ITERATOR_H_
 
+#include <memory>
+#include <vector>
+
 #include "xls/ir/function_base.h"
 #include "xls/ir/node.h"
 
@@ -23,36 +26,37 @@ namespace xls {
 // A type that orders the reachable nodes in a function into a usable traversal
 // order. Currently just does a stable topological ordering.
 //
+// The order is cached on the function (see FunctionBase::CachedTopoSort) and
+// shared by all iterators created before the function next changes. Each
+// iterator holds a snapshot, so modifying the function while iterating is
+// safe, though nodes added during the iteration are not visited.
+//
 // Note that this container value must outlive any iterators derived from it
 // (via begin()/end()).
 class NodeIterator {
  public:
   static NodeIterator Create(FunctionBase* f) {
-    NodeIterator it(f);
-    it.Initialize();
-    return it;
+    return NodeIterator(f->CachedTopoSort(/*reverse=*/false));
   }
 
   static NodeIterator CreateReverse(FunctionBase* f) {
-    NodeIterator it(f);
-    it.Initialize();
-    std::reverse(it.ordered_->begin(), it.ordered_->end());
-    return it;
+    return NodeIterator(f->CachedTopoSort(/*reverse=*/true));
   }
 
-  std::vector<Node*>::iterator begin() { return ordered_->begin(); }
-  std::vector<Node*>::iterator end() { return ordered_->end(); }
+  // Computes the stable topological order of the nodes of 'f' from scratch.
+  static std::vector<Node*> ComputeOrder(FunctionBase* f);
 
- private:
-  explicit NodeIterator(FunctionBase* f) : f_(f) {}
+  std::vector<Node*>::const_iterator begin() const { return ordered_->begin(); }
+  std::vector<Node*>::const_iterator end() const { return ordered_->end(); }
 
-  void Initialize();
+ private:
+  explicit NodeIterator(std::shared_ptr<const std::vector<Node*>> ordered)
+      : ordered_(std::move(ordered)) {}
 
-  // The vector of nodes is wrapped in a unique_ptr so that the
-  // NodeIterator may be movable but the iterators returned to the
-  // caller of begin()/end() are not invalidated by those moves.
-  std::unique_ptr<std::vector<Node*>> ordered_;
-  FunctionBase* f_;
+  // The vector of nodes is held by pointer so that the NodeIterator may be
+  // movable but the iterators returned to the caller of begin()/end() are not
+  // invalidated by those moves.
+  std::shared_ptr<const std::vector<Node*>> ordered_;
 };
 
 // Convenience function for concise use in foreach constructs; e.g.:
@@ -64,8 +68,8 @@ class NodeIterator {
 // Yields nodes in a stable topological traversal order (dependency ordering is
 // satisfied).
 //
-// Note that the ordering for all nodes is computed up front, *not*
-// incrementally as iteration proceeds.
+// Note that the ordering for all nodes is computed up front (or reused from
+// the function's cache), *not* incrementally as iteration proceeds.
 inline NodeIterator TopoSort(FunctionBase* f) {
   return NodeIterator::Create(f);
 }
@@ -14,6 +14,9 @@
 
 #include "xls/ir/node_iterator.h"
 
+#include <memory>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
@@ -267,5 +270,49 @@ TEST(NodeIteratorTest, RpoVsTopo) {
   EXPECT_EQ(rni.end(), it);
 }
 
+TEST(NodeIteratorTest, OrderIsCachedUntilFunctionChanges) {
+  std::string program = R"(
+  fn f(x: bits[32]) -> bits[32] {
+    neg.1: bits[32] = neg(x)
+    ret neg.2: bits[32] = neg(neg.1)
+  })";
+
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(program, &p));
+  std::shared_ptr<const std::vector<Node*>> order =
+      f->CachedTopoSort(/*reverse=*/false);
+  EXPECT_EQ(f->CachedTopoSort(/*reverse=*/false), order);
+  std::vector<Node*> reverse(order->rbegin(), order->rend());
+  EXPECT_EQ(*f->CachedTopoSort(/*reverse=*/true), reverse);
+
+  // Adding a node invalidates the cached order, but the earlier snapshot is
+  // unaffected.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * literal,
+      f->MakeNode<Literal>(absl::nullopt, Value(UBits(0, 32))));
+  std::shared_ptr<const std::vector<Node*>> new_order =
+      f->CachedTopoSort(/*reverse=*/false);
+  EXPECT_NE(new_order, order);
+  EXPECT_EQ(order->size(), 3);
+  EXPECT_EQ(new_order->size(), 4);
+  NodeIterator rni = TopoSort(f);
+  EXPECT_EQ(std::vector<Node*>(rni.begin(), rni.end()), *new_order);
+
+  // As does removing a node, even one without operands.
+  XLS_ASSERT_OK(f->RemoveNode(literal));
+  EXPECT_EQ(f->CachedTopoSort(/*reverse=*/false)->size(), 3);
+
+  // Swapping operands changes the order.
+  XLS_ASSERT_OK_AND_ASSIGN(Node * neg1, f->GetNode("neg.1"));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * add, f->MakeNode<BinOp>(absl::nullopt, neg1, f->param(0),
+                                     Op::kAdd));
+  XLS_ASSERT_OK(f->set_return_value(add));
+  std::shared_ptr<const std::vector<Node*>> before_swap =
+      f->CachedTopoSort(/*reverse=*/false);
+  add->SwapOperands(0, 1);
+  EXPECT_NE(f->CachedTopoSort(/*reverse=*/false), before_swap);
+}
+
 }  // namespace
 }  // namespace xls
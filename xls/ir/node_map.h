@@ -0,0 +1,189 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_IR_NODE_MAP_H_
+#define XLS_IR_NODE_MAP_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "xls/common/logging/logging.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+
+// Containers keyed by the nodes of a single function. Elements are stored in
+// vectors indexed by Node::node_index, so lookups are an array access rather
+// than a pointer hash. Storage is proportional to the function's
+// node_index_limit() rather than to the number of elements, so these suit
+// per-node analysis results covering most of a function; use a hash map for
+// sparse data.
+//
+// A container is bound to the function of the first node inserted. Lookups
+// of nodes from other functions find nothing, as with a hash map. Entries of
+// nodes removed from the function remain until erased but are never confused
+// with other nodes because node indices are not reused.
+
+// A map from Node* to T.
+template <typename T>
+class NodeMap {
+ public:
+  NodeMap() = default;
+
+  // Reserves space for the current nodes of 'f'.
+  explicit NodeMap(const FunctionBase* f) : function_(f) {
+    values_.reserve(f->node_index_limit());
+  }
+
+  bool contains(const Node* node) const { return find(node) != nullptr; }
+
+  // Returns a pointer to the value of 'node', or nullptr if it has none.
+  const T* find(const Node* node) const {
+    if (node->function_base() != function_ ||
+        node->node_index() >= values_.size() ||
+        !values_[node->node_index()].has_value()) {
+      return nullptr;
+    }
+    return &*values_[node->node_index()];
+  }
+  T* find(const Node* node) {
+    return const_cast<T*>(static_cast<const NodeMap*>(this)->find(node));
+  }
+
+  const T& at(const Node* node) const {
+    const T* value = find(node);
+    XLS_CHECK(value != nullptr) << "Node not in map: " << node->GetName();
+    return *value;
+  }
+  T& at(const Node* node) {
+    return const_cast<T&>(static_cast<const NodeMap*>(this)->at(node));
+  }
+
+  // Returns the value of 'node', default-constructing it if not present.
+  T& operator[](const Node* node) {
+    absl::optional<T>& slot = Slot(node);
+    if (!slot.has_value()) {
+      slot.emplace();
+      ++size_;
+    }
+    return *slot;
+  }
+
+  // Sets the value of 'node'. Returns true if it had no value before.
+  bool insert_or_assign(const Node* node, T value) {
+    absl::optional<T>& slot = Slot(node);
+    bool inserted = !slot.has_value();
+    slot = std::move(value);
+    size_ += inserted ? 1 : 0;
+    return inserted;
+  }
+
+  // Removes the value of 'node'. Returns true if it had one.
+  bool erase(const Node* node) {
+    if (find(node) == nullptr) {
+      return false;
+    }
+    values_[node->node_index()].reset();
+    --size_;
+    return true;
+  }
+
+  void clear() {
+    values_.clear();
+    size_ = 0;
+  }
+
+  int64_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  absl::optional<T>& Slot(const Node* node) {
+    if (function_ == nullptr) {
+      function_ = node->function_base();
+    }
+    XLS_DCHECK_EQ(function_, node->function_base())
+        << "Node " << node->GetName() << " is from another function";
+    if (node->node_index() >= values_.size()) {
+      values_.resize(node->node_index() + 1);
+    }
+    return values_[node->node_index()];
+  }
+
+  const FunctionBase* function_ = nullptr;
+  std::vector<absl::optional<T>> values_;
+  int64_t size_ = 0;
+};
+
+// A set of nodes, stored as a bit per node index.
+class NodeBitSet {
+ public:
+  NodeBitSet() = default;
+
+  // Reserves space for the current nodes of 'f'.
+  explicit NodeBitSet(const FunctionBase* f)
+      : function_(f), bits_(f->node_index_limit(), false) {}
+
+  bool contains(const Node* node) const {
+    return node->function_base() == function_ &&
+           node->node_index() < bits_.size() && bits_[node->node_index()];
+  }
+
+  // Adds 'node' to the set. Returns true if it was not already present.
+  bool insert(const Node* node) {
+    if (function_ == nullptr) {
+      function_ = node->function_base();
+    }
+    XLS_DCHECK_EQ(function_, node->function_base())
+        << "Node " << node->GetName() << " is from another function";
+    if (node->node_index() >= bits_.size()) {
+      bits_.resize(node->node_index() + 1, false);
+    }
+    if (bits_[node->node_index()]) {
+      return false;
+    }
+    bits_[node->node_index()] = true;
+    ++size_;
+    return true;
+  }
+
+  // Removes 'node' from the set. Returns true if it was present.
+  bool erase(const Node* node) {
+    if (!contains(node)) {
+      return false;
+    }
+    bits_[node->node_index()] = false;
+    --size_;
+    return true;
+  }
+
+  void clear() {
+    bits_.clear();
+    size_ = 0;
+  }
+
+  int64_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  const FunctionBase* function_ = nullptr;
+  std::vector<bool> bits_;
+  int64_t size_ = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_IR_NODE_MAP_H_
@@ -0,0 +1,132 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/node_map.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/node.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+constexpr char kProgram[] = R"(
+fn f(x: bits[32], y: bits[32]) -> bits[32] {
+  add.1: bits[32] = add(x, y)
+  ret neg.2: bits[32] = neg(add.1)
+})";
+
+TEST(NodeMapTest, NodeIndicesAreDenseAndNotReused) {
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(kProgram, &p));
+  EXPECT_EQ(f->node_index_limit(), 4);
+  std::vector<bool> seen(f->node_index_limit(), false);
+  for (Node* node : f->nodes()) {
+    ASSERT_GE(node->node_index(), 0);
+    ASSERT_LT(node->node_index(), f->node_index_limit());
+    EXPECT_FALSE(seen[node->node_index()]);
+    seen[node->node_index()] = true;
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(Node * add, f->GetNode("add.1"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * neg, f->GetNode("neg.2"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * sub,
+                           f->MakeNode<BinOp>(add->loc(), add->operand(0),
+                                              add->operand(1), Op::kSub));
+  XLS_ASSERT_OK(neg->ReplaceOperandNumber(0, sub));
+  int64_t add_index = add->node_index();
+  XLS_ASSERT_OK(f->RemoveNode(add));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * literal, f->MakeNode<Literal>(sub->loc(), Value(UBits(0, 32))));
+  EXPECT_NE(literal->node_index(), add_index);
+  EXPECT_EQ(literal->node_index(), 5);
+  EXPECT_EQ(f->node_index_limit(), 6);
+}
+
+TEST(NodeMapTest, MapOperations) {
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(kProgram, &p));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * x, f->GetParamByName("x"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * add, f->GetNode("add.1"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * neg, f->GetNode("neg.2"));
+
+  NodeMap<std::string> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(x));
+  EXPECT_EQ(map.find(x), nullptr);
+
+  map[neg] = "neg";
+  EXPECT_TRUE(map.insert_or_assign(x, "x"));
+  EXPECT_FALSE(map.insert_or_assign(x, "x2"));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(x));
+  EXPECT_FALSE(map.contains(add));
+  EXPECT_EQ(map.at(x), "x2");
+  EXPECT_EQ(*map.find(neg), "neg");
+
+  EXPECT_TRUE(map.erase(x));
+  EXPECT_FALSE(map.erase(x));
+  EXPECT_FALSE(map.contains(x));
+  EXPECT_EQ(map.size(), 1);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(neg));
+}
+
+TEST(NodeMapTest, NodesOfOtherFunctionsAreNotFound) {
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(kProgram, &p));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * g, Parser::ParseFunction(R"(
+fn g(z: bits[32]) -> bits[32] {
+  ret neg.10: bits[32] = neg(z)
+})",
+                                                               &p));
+  NodeMap<int64_t> map(f);
+  NodeBitSet set(f);
+  for (Node* node : f->nodes()) {
+    map[node] = node->id();
+    set.insert(node);
+  }
+  Node* z = g->param(0);
+  EXPECT_FALSE(map.contains(z));
+  EXPECT_FALSE(set.contains(z));
+}
+
+TEST(NodeMapTest, BitSetOperations) {
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(kProgram, &p));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * x, f->GetParamByName("x"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * y, f->GetParamByName("y"));
+
+  NodeBitSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(y));
+  EXPECT_FALSE(set.insert(y));
+  EXPECT_TRUE(set.contains(y));
+  EXPECT_FALSE(set.contains(x));
+  EXPECT_EQ(set.size(), 1);
+  EXPECT_TRUE(set.erase(y));
+  EXPECT_FALSE(set.erase(y));
+  EXPECT_TRUE(set.empty());
+}
+
+}  // namespace
+}  // namespace xls
@@ -27,6 +27,7 @@ namespace {
 
 using status_testing::IsOkAndHolds;
 using status_testing::StatusIs;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::UnorderedElementsAre;
 
@@ -486,5 +487,36 @@ fn ReplaceUses(x: bits[8], y: bits[8]) -> bits[8] {
   EXPECT_TRUE(FindNode("y", f)->IsDead());
 }
 
+TEST_F(NodeTest, UsersSortedById) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+fn f(x: bits[8]) -> bits[8] {
+  not.10: bits[8] = not(x)
+  neg.20: bits[8] = neg(x)
+  ret add.30: bits[8] = add(x, x)
+}
+)",
+                                                       p.get()));
+  Node* x = FindNode("x", f);
+  Node* n = FindNode("not.10", f);
+  Node* neg = FindNode("neg.20", f);
+  Node* add = FindNode("add.30", f);
+  EXPECT_THAT(x->users(), ElementsAre(n, neg, add));
+
+  // Changing an id moves the node within its operands' user lists.
+  add->set_id(5);
+  EXPECT_THAT(x->users(), ElementsAre(add, n, neg));
+  EXPECT_TRUE(x->HasUser(add));
+  EXPECT_TRUE(x->HasUser(neg));
+  EXPECT_FALSE(x->HasUser(x));
+
+  // Duplicate ids are tolerated.
+  neg->set_id(5);
+  EXPECT_TRUE(x->HasUser(add));
+  EXPECT_TRUE(x->HasUser(neg));
+  XLS_ASSERT_OK(f->RemoveNode(neg));
+  EXPECT_THAT(x->users(), ElementsAre(add, n));
+}
+
 }  // namespace
 }  // namespace xls
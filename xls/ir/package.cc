@@ -176,6 +176,7 @@ SourceLocation Package::AddSourceLocation(absl::string_view filename,
 
 std::string Package::SourceLocationToString(const SourceLocation loc) {
   const std::string unknown = "UNKNOWN";
+  absl::MutexLock lock(&mutex_);
   absl::string_view filename =
       fileno_to_filename_.find(loc.fileno()) != fileno_to_filename_.end()
           ? fileno_to_filename_.at(loc.fileno())
@@ -220,6 +221,7 @@ absl::StatusOr<Type*> Package::MapTypeFromOtherPackage(
 }
 
 BitsType* Package::GetBitsType(int64_t bit_count) {
+  absl::MutexLock lock(&mutex_);
   if (bit_count_to_type_.find(bit_count) != bit_count_to_type_.end()) {
     return &bit_count_to_type_.at(bit_count);
   }
@@ -231,10 +233,11 @@ BitsType* Package::GetBitsType(int64_t bit_count) {
 
 ArrayType* Package::GetArrayType(int64_t size, Type* element_type) {
   ArrayKey key{size, element_type};
+  absl::MutexLock lock(&mutex_);
   if (array_types_.find(key) != array_types_.end()) {
     return &array_types_.at(key);
   }
-  XLS_CHECK(IsOwnedType(element_type))
+  XLS_CHECK(owned_types_.contains(element_type))
       << "Type is not owned by package: " << *element_type;
   auto it = array_types_.emplace(key, ArrayType(size, element_type));
   ArrayType* new_type = &(it.first->second);
@@ -244,11 +247,12 @@ ArrayType* Package::GetArrayType(int64_t size, Type* element_type) {
 
 TupleType* Package::GetTupleType(absl::Span<Type* const> element_types) {
   TypeVec key(element_types.begin(), element_types.end());
+  absl::MutexLock lock(&mutex_);
   if (tuple_types_.find(key) != tuple_types_.end()) {
     return &tuple_types_.at(key);
   }
   for (const Type* element_type : element_types) {
-    XLS_CHECK(IsOwnedType(element_type))
+    XLS_CHECK(owned_types_.contains(element_type))
         << "Type is not owned by package: " << *element_type;
   }
   auto it = tuple_types_.emplace(key, TupleType(element_types));
@@ -261,14 +265,18 @@ TokenType* Package::GetTokenType() { return &token_type_; }
 
 FunctionType* Package::GetFunctionType(absl::Span<Type* const> args_types,
                                        Type* return_type) {
-  std::string key = FunctionType(args_types, return_type).ToString();
+  FunctionTypeKey key{TypeVec(args_types.begin(), args_types.end()),
+                      return_type};
+  absl::MutexLock lock(&mutex_);
   if (function_types_.find(key) != function_types_.end()) {
     return &function_types_.at(key);
   }
   for (Type* t : args_types) {
-    XLS_CHECK(IsOwnedType(t))
+    XLS_CHECK(owned_types_.contains(t))
         << "Parameter type is not owned by package: " << t->ToString();
   }
+  XLS_CHECK(owned_types_.contains(return_type))
+      << "Return type is not owned by package: " << return_type->ToString();
   auto it = function_types_.emplace(key, FunctionType(args_types, return_type));
   FunctionType* new_type = &(it.first->second);
   owned_function_types_.insert(new_type);
@@ -356,8 +364,18 @@ Type* Package::GetTypeForValue(const Value& value) {
   XLS_LOG(FATAL) << "Invalid value for type extraction.";
 }
 
+std::vector<std::string> Package::GetFilenames() const {
+  absl::MutexLock lock(&mutex_);
+  std::vector<std::string> filenames(fileno_to_filename_.size());
+  for (const auto& [fileno, filename] : fileno_to_filename_) {
+    filenames[fileno.value()] = filename;
+  }
+  return filenames;
+}
+
 Fileno Package::GetOrCreateFileno(absl::string_view filename) {
   // Attempt to add a new fileno/filename pair to the map.
+  absl::MutexLock lock(&mutex_);
   auto this_fileno = Fileno(filename_to_fileno_.size());
   if (auto it = filename_to_fileno_.find(std::string(filename));
       it != filename_to_fileno_.end()) {
@@ -393,22 +411,31 @@ bool Package::IsDefinitelyEqualTo(const Package* other) const {
 
 std::string Package::DumpIr() const {
   std::string out;
-  absl::StrAppend(&out, "package ", name(), "\n\n");
+  IrWriter writer([&](absl::string_view chunk) {
+    out.append(chunk.data(), chunk.size());
+    return absl::OkStatus();
+  });
+  DumpIrTo(&writer);
+  XLS_CHECK_OK(writer.Close());
+  return out;
+}
+
+void Package::DumpIrTo(IrWriter* writer) const {
+  absl::StrAppend(writer->buffer(), "package ", name(), "\n\n");
   if (!channels().empty()) {
     for (Channel* channel : channels()) {
-      absl::StrAppend(&out, channel->ToString(), "\n");
+      absl::StrAppend(writer->buffer(), channel->ToString(), "\n");
     }
-    absl::StrAppend(&out, "\n");
+    absl::StrAppend(writer->buffer(), "\n");
   }
-  std::vector<std::string> function_dumps;
-  for (auto& function : functions()) {
-    function_dumps.push_back(function->DumpIr());
-  }
-  for (auto& proc : procs()) {
-    function_dumps.push_back(proc->DumpIr());
+  bool first = true;
+  for (FunctionBase* function_base : GetFunctionsAndProcs()) {
+    if (!first) {
+      absl::StrAppend(writer->buffer(), "\n");
+    }
+    first = false;
+    function_base->DumpIrTo(writer);
   }
-  absl::StrAppend(&out, absl::StrJoin(function_dumps, "\n"));
-  return out;
 }
 
 std::ostream& operator<<(std::ostream& os, const Package& package) {
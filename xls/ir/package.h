@@ -15,6 +15,7 @@
 #ifndef XLS_IR_PACKAGE_H_
 #define XLS_IR_PACKAGE_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -26,9 +27,11 @@
 #include "absl/container/node_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/channel.pb.h"
 #include "xls/ir/fileno.h"
+#include "xls/ir/ir_writer.h"
 #include "xls/ir/source_location.h"
 #include "xls/ir/type.h"
 #include "xls/ir/value.h"
@@ -52,12 +55,17 @@ class Package {
   virtual ~Package();
 
   // Returns whether the given type is one of the types owned by this package.
+  //
+  // The type accessors below (IsOwned*Type, Get*Type) and the file-number
+  // table may be used concurrently from passes running on different functions
+  // of the package.
   bool IsOwnedType(const Type* type) {
-    return owned_types_.find(type) != owned_types_.end();
+    absl::MutexLock lock(&mutex_);
+    return owned_types_.contains(type);
   }
   bool IsOwnedFunctionType(const FunctionType* function_type) {
-    return owned_function_types_.find(function_type) !=
-           owned_function_types_.end();
+    absl::MutexLock lock(&mutex_);
+    return owned_function_types_.contains(function_type);
   }
 
   BitsType* GetBitsType(int64_t bit_count);
@@ -90,6 +98,9 @@ class Package {
   // Remove (dead) functions.
   void DeleteDeadFunctions(absl::Span<Function* const> dead_funcs);
 
+  // Returns the name of the entry function given at construction, if any.
+  const absl::optional<std::string>& entry() const { return entry_; }
+
   // Returns the entry function of the package.
   absl::StatusOr<Function*> EntryFunction();
   absl::StatusOr<const Function*> EntryFunction() const;
@@ -120,13 +131,17 @@ class Package {
   std::string SourceLocationToString(const SourceLocation loc);
 
   // Retrieves the next node ID to assign to a node in the package and
-  // increments the next node counter. For use in node construction.
-  int64_t GetNextNodeId() { return next_node_id_++; }
+  // increments the next node counter. For use in node construction. Safe to
+  // call concurrently.
+  int64_t GetNextNodeId() { return next_node_id_.fetch_add(1); }
 
   // Adds a file to the file-number table and returns its corresponding number.
   // If it already exists, returns the existing file-number entry.
   Fileno GetOrCreateFileno(absl::string_view filename);
 
+  // Returns the file names of the file-number table, indexed by file number.
+  std::vector<std::string> GetFilenames() const;
+
   // Returns the total number of nodes in the graph. Traverses the functions and
   // sums the node counts.
   int64_t GetNodeCount() const;
@@ -157,15 +172,19 @@ class Package {
   // Dumps the IR in a parsable text format.
   std::string DumpIr() const;
 
+  // Writes the same text as DumpIr to the given writer, flushing it as it goes
+  // rather than building the text of the whole package first.
+  void DumpIrTo(IrWriter* writer) const;
+
   std::vector<std::string> GetFunctionNames() const;
 
   // Returns whether this package contains a function with the "target" name.
   bool HasFunctionWithName(absl::string_view target) const;
 
-  int64_t next_node_id() const { return next_node_id_; }
+  int64_t next_node_id() const { return next_node_id_.load(); }
 
   // Intended for use by the parser when node ids are suggested by the IR text.
-  void set_next_node_id(int64_t value) { next_node_id_ = value; }
+  void set_next_node_id(int64_t value) { next_node_id_.store(value); }
 
   // Create a channel. Channels are used with send/receive nodes in communicate
   // between procs or between procs and external (to XLS) components. If no
@@ -216,44 +235,56 @@ class Package {
   std::string name_;
 
   // Ordinal to assign to the next node created in this package.
-  int64_t next_node_id_ = 1;
+  std::atomic<int64_t> next_node_id_ = 1;
 
   std::vector<std::unique_ptr<Function>> functions_;
   std::vector<std::unique_ptr<Proc>> procs_;
 
+  // Guards the type tables and the file-number tables below.
+  mutable absl::Mutex mutex_;
+
   // Set of owned types in this package.
-  absl::flat_hash_set<const Type*> owned_types_;
+  absl::flat_hash_set<const Type*> owned_types_ ABSL_GUARDED_BY(mutex_);
 
   // Set of owned function types in this package.
-  absl::flat_hash_set<const FunctionType*> owned_function_types_;
+  absl::flat_hash_set<const FunctionType*> owned_function_types_
+      ABSL_GUARDED_BY(mutex_);
 
   // Mapping from bit count to the owned "bits" type with that many bits. Use
   // node_hash_map for pointer stability.
-  absl::node_hash_map<int64_t, BitsType> bit_count_to_type_;
+  absl::node_hash_map<int64_t, BitsType> bit_count_to_type_
+      ABSL_GUARDED_BY(mutex_);
 
   // Mapping from the size and element type of an array type to the owned
   // ArrayType. Use node_hash_map for pointer stability.
   using ArrayKey = std::pair<int64_t, const Type*>;
-  absl::node_hash_map<ArrayKey, ArrayType> array_types_;
+  absl::node_hash_map<ArrayKey, ArrayType> array_types_
+      ABSL_GUARDED_BY(mutex_);
 
   // Mapping from elements to the owned tuple type.
   //
   // Uses node_hash_map for pointer stability.
   using TypeVec = absl::InlinedVector<const Type*, 4>;
-  absl::node_hash_map<TypeVec, TupleType> tuple_types_;
+  absl::node_hash_map<TypeVec, TupleType> tuple_types_
+      ABSL_GUARDED_BY(mutex_);
 
   // Owned token type.
   TokenType token_type_;
 
-  // Mapping from Type:ToString to the owned function type. Use
-  // node_hash_map for pointer stability.
-  absl::node_hash_map<std::string, FunctionType> function_types_;
+  // Mapping from the parameter types and return type to the owned function
+  // type. Keying on the (canonical) type pointers avoids rendering the types
+  // to strings. Use node_hash_map for pointer stability.
+  using FunctionTypeKey = std::pair<TypeVec, const Type*>;
+  absl::node_hash_map<FunctionTypeKey, FunctionType> function_types_
+      ABSL_GUARDED_BY(mutex_);
 
   // Mapping of Fileno ids to string filenames, and vice-versa for reverse
   // lookups. These two data structures must be updated together for consistency
   // and should always contain the same number of entries.
-  absl::flat_hash_map<Fileno, std::string> fileno_to_filename_;
-  absl::flat_hash_map<std::string, Fileno> filename_to_fileno_;
+  absl::flat_hash_map<Fileno, std::string> fileno_to_filename_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, Fileno> filename_to_fileno_
+      ABSL_GUARDED_BY(mutex_);
 
   // Channels owned by this package. Indexed by channel id. Stored as
   // unique_ptrs for pointer stability.
@@ -0,0 +1,812 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/package_serializer.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/channel.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/op.h"
+#include "xls/ir/verifier.h"
+
+namespace xls {
+namespace {
+
+absl::string_view MagicString() {
+  return absl::string_view(kSerializedPackageMagic,
+                           sizeof(kSerializedPackageMagic) - 1);
+}
+
+// Assigns package type table indices to types, adding each type (and its
+// element types) to the table the first time it is seen.
+class TypeTable {
+ public:
+  explicit TypeTable(PackageProto* proto) : proto_(proto) {}
+
+  int64_t GetIndex(Type* type) {
+    auto it = indices_.find(type);
+    if (it != indices_.end()) {
+      return it->second;
+    }
+    InternedTypeProto interned;
+    switch (type->kind()) {
+      case TypeKind::kBits:
+        interned.set_type_enum(TypeProto::BITS);
+        interned.set_bit_count(type->AsBitsOrDie()->bit_count());
+        break;
+      case TypeKind::kTuple:
+        interned.set_type_enum(TypeProto::TUPLE);
+        for (Type* element : type->AsTupleOrDie()->element_types()) {
+          interned.add_tuple_elements(GetIndex(element));
+        }
+        break;
+      case TypeKind::kArray:
+        interned.set_type_enum(TypeProto::ARRAY);
+        interned.set_array_size(type->AsArrayOrDie()->size());
+        interned.set_array_element(
+            GetIndex(type->AsArrayOrDie()->element_type()));
+        break;
+      case TypeKind::kToken:
+        interned.set_type_enum(TypeProto::TOKEN);
+        break;
+    }
+    int64_t index = proto_->types_size();
+    *proto_->add_types() = std::move(interned);
+    indices_[type] = index;
+    return index;
+  }
+
+ private:
+  PackageProto* proto_;
+  absl::flat_hash_map<Type*, int64_t> indices_;
+};
+
+}  // namespace
+
+ValueProto ValueToProto(const Value& value) {
+  ValueProto proto;
+  switch (value.kind()) {
+    case ValueKind::kBits: {
+      proto.set_kind(ValueProto::BITS);
+      proto.set_bit_count(value.bits().bit_count());
+      std::vector<uint8_t> bytes = value.bits().ToBytes();
+      proto.set_bits(std::string(bytes.begin(), bytes.end()));
+      break;
+    }
+    case ValueKind::kTuple:
+    case ValueKind::kArray:
+      proto.set_kind(value.IsTuple() ? ValueProto::TUPLE : ValueProto::ARRAY);
+      for (const Value& element : value.elements()) {
+        *proto.add_elements() = ValueToProto(element);
+      }
+      break;
+    case ValueKind::kToken:
+      proto.set_kind(ValueProto::TOKEN);
+      break;
+    case ValueKind::kInvalid:
+      proto.set_kind(ValueProto::INVALID);
+      break;
+  }
+  return proto;
+}
+
+absl::StatusOr<Value> ValueFromProto(const ValueProto& proto) {
+  switch (proto.kind()) {
+    case ValueProto::BITS: {
+      if (proto.bit_count() < 0 ||
+          proto.bits().size() < (proto.bit_count() + 7) / 8) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Malformed bits value of width %d with %d bytes",
+                            proto.bit_count(), proto.bits().size()));
+      }
+      absl::Span<const uint8_t> bytes(
+          reinterpret_cast<const uint8_t*>(proto.bits().data()),
+          proto.bits().size());
+      return Value(Bits::FromBytes(bytes, proto.bit_count()));
+    }
+    case ValueProto::TUPLE:
+    case ValueProto::ARRAY: {
+      std::vector<Value> elements;
+      elements.reserve(proto.elements_size());
+      for (const ValueProto& element : proto.elements()) {
+        XLS_ASSIGN_OR_RETURN(Value value, ValueFromProto(element));
+        elements.push_back(std::move(value));
+      }
+      if (proto.kind() == ValueProto::TUPLE) {
+        return Value::TupleOwned(std::move(elements));
+      }
+      return Value::Array(elements);
+    }
+    case ValueProto::TOKEN:
+      return Value::Token();
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid value kind: ", proto.kind()));
+  }
+}
+
+namespace {
+
+NodeProto NodeToProto(Node* node,
+                      const absl::flat_hash_map<Node*, int64_t>& indices,
+                      TypeTable* types) {
+  NodeProto proto;
+  proto.set_op(ToOpProto(node->op()));
+  proto.set_id(node->id());
+  if (node->HasAssignedName()) {
+    proto.set_name(node->GetName());
+  }
+  proto.set_type(types->GetIndex(node->GetType()));
+  for (Node* operand : node->operands()) {
+    proto.add_operands(indices.at(operand));
+  }
+  if (node->loc().has_value()) {
+    SourceLocationProto* loc = proto.mutable_loc();
+    loc->set_fileno(node->loc()->fileno().value());
+    loc->set_lineno(node->loc()->lineno().value());
+    loc->set_colno(node->loc()->colno().value());
+  }
+
+  switch (node->op()) {
+    case Op::kBitSlice:
+      proto.set_start(node->As<BitSlice>()->start());
+      proto.set_width(node->As<BitSlice>()->width());
+      break;
+    case Op::kDynamicBitSlice:
+      proto.set_width(node->As<DynamicBitSlice>()->width());
+      break;
+    case Op::kDecode:
+      proto.set_width(node->As<Decode>()->width());
+      break;
+    case Op::kTupleIndex:
+      proto.set_index(node->As<TupleIndex>()->index());
+      break;
+    case Op::kZeroExt:
+    case Op::kSignExt:
+      proto.set_new_bit_count(node->As<ExtendOp>()->new_bit_count());
+      break;
+    case Op::kCountedFor:
+      proto.set_trip_count(node->As<CountedFor>()->trip_count());
+      proto.set_stride(node->As<CountedFor>()->stride());
+      proto.set_function(node->As<CountedFor>()->body()->name());
+      break;
+    case Op::kDynamicCountedFor:
+      proto.set_function(node->As<DynamicCountedFor>()->body()->name());
+      break;
+    case Op::kInvoke:
+      proto.set_function(node->As<Invoke>()->to_apply()->name());
+      break;
+    case Op::kMap:
+      proto.set_function(node->As<Map>()->to_apply()->name());
+      break;
+    case Op::kLiteral:
+      *proto.mutable_value() = ValueToProto(node->As<Literal>()->value());
+      break;
+    case Op::kOneHot:
+      proto.set_lsb_prio(node->As<OneHot>()->priority() == LsbOrMsb::kLsb);
+      break;
+    case Op::kAssert:
+      proto.set_message(node->As<Assert>()->message());
+      if (node->As<Assert>()->label().has_value()) {
+        proto.set_label(node->As<Assert>()->label().value());
+      }
+      break;
+    case Op::kSel:
+      proto.set_has_default(
+          node->As<Select>()->default_value().has_value());
+      break;
+    case Op::kReceive:
+      proto.set_channel_id(node->As<Receive>()->channel_id());
+      break;
+    case Op::kReceiveIf:
+      proto.set_channel_id(node->As<ReceiveIf>()->channel_id());
+      break;
+    case Op::kSend:
+      proto.set_channel_id(node->As<Send>()->channel_id());
+      break;
+    case Op::kSendIf:
+      proto.set_channel_id(node->As<SendIf>()->channel_id());
+      break;
+    default:
+      break;
+  }
+  return proto;
+}
+
+FunctionBaseProto FunctionBaseToProto(FunctionBase* function_base,
+                                      TypeTable* types) {
+  FunctionBaseProto proto;
+  absl::flat_hash_map<Node*, int64_t> indices;
+  auto add_node = [&](Node* node) {
+    *proto.add_nodes() = NodeToProto(node, indices, types);
+    indices[node] = indices.size();
+  };
+  for (Param* param : function_base->params()) {
+    add_node(param);
+  }
+  for (Node* node : TopoSort(function_base)) {
+    if (!node->Is<Param>()) {
+      add_node(node);
+    }
+  }
+  if (function_base->IsProc()) {
+    Proc* proc = function_base->AsProcOrDie();
+    *proto.mutable_init_value() = ValueToProto(proc->InitValue());
+    proto.set_next_token(indices.at(proc->NextToken()));
+    proto.set_next_state(indices.at(proc->NextState()));
+  } else {
+    Function* function = function_base->AsFunctionOrDie();
+    if (function->return_value() != nullptr) {
+      proto.set_return_value(indices.at(function->return_value()));
+    }
+  }
+  return proto;
+}
+
+absl::StatusOr<SerializedChannelProto> ChannelToProto(Channel* channel,
+                                                      TypeTable* types) {
+  SerializedChannelProto proto;
+  proto.set_name(channel->name());
+  proto.set_id(channel->id());
+  if (channel->IsStreaming()) {
+    proto.set_kind(SerializedChannelProto::STREAMING);
+  } else if (channel->IsPort()) {
+    proto.set_kind(SerializedChannelProto::PORT);
+  } else if (channel->IsRegister()) {
+    proto.set_kind(SerializedChannelProto::REGISTER);
+  } else {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Serialization of logical channel %s not supported", channel->name()));
+  }
+  switch (channel->supported_ops()) {
+    case ChannelOps::kSendOnly:
+      proto.set_supported_ops(SerializedChannelProto::SEND_ONLY);
+      break;
+    case ChannelOps::kReceiveOnly:
+      proto.set_supported_ops(SerializedChannelProto::RECEIVE_ONLY);
+      break;
+    case ChannelOps::kSendReceive:
+      proto.set_supported_ops(SerializedChannelProto::SEND_RECEIVE);
+      break;
+  }
+  proto.set_type(types->GetIndex(channel->type()));
+  for (const Value& value : channel->initial_values()) {
+    *proto.add_initial_values() = ValueToProto(value);
+  }
+  *proto.mutable_metadata() = channel->metadata();
+  return proto;
+}
+
+}  // namespace
+
+bool IsSerializedPackage(absl::string_view bytes) {
+  return absl::StartsWith(bytes, MagicString());
+}
+
+absl::StatusOr<PackageProto> PackageToProto(Package* package) {
+  PackageProto proto;
+  proto.set_name(package->name());
+  if (package->entry().has_value()) {
+    proto.set_entry(package->entry().value());
+  }
+  proto.set_next_node_id(package->next_node_id());
+  TypeTable types(&proto);
+  for (Channel* channel : package->channels()) {
+    XLS_ASSIGN_OR_RETURN(*proto.add_channels(),
+                         ChannelToProto(channel, &types));
+  }
+  auto add_function_base = [&](FunctionBase* function_base) {
+    FunctionBaseEntryProto* entry = proto.add_function_bases();
+    entry->set_kind(function_base->IsProc() ? FunctionBaseEntryProto::PROC
+                                            : FunctionBaseEntryProto::FUNCTION);
+    entry->set_name(function_base->name());
+    entry->set_body(
+        FunctionBaseToProto(function_base, &types).SerializeAsString());
+  };
+  for (const std::unique_ptr<Function>& function : package->functions()) {
+    add_function_base(function.get());
+  }
+  for (const std::unique_ptr<Proc>& proc : package->procs()) {
+    add_function_base(proc.get());
+  }
+  return proto;
+}
+
+absl::StatusOr<std::string> SerializePackage(Package* package) {
+  XLS_ASSIGN_OR_RETURN(PackageProto proto, PackageToProto(package));
+  return absl::StrCat(MagicString(), proto.SerializeAsString());
+}
+
+absl::StatusOr<std::unique_ptr<Package>> DeserializePackage(
+    absl::string_view bytes, absl::optional<absl::string_view> entry) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<PackageLoader> loader,
+                       PackageLoader::Create(bytes, entry));
+  XLS_RETURN_IF_ERROR(loader->LoadAll());
+  std::unique_ptr<Package> package = loader->ReleasePackage();
+  XLS_RETURN_IF_ERROR(VerifyPackage(package.get()));
+  return std::move(package);
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<PackageLoader>>
+PackageLoader::Create(absl::string_view bytes,
+                      absl::optional<absl::string_view> entry) {
+  if (!IsSerializedPackage(bytes)) {
+    return absl::InvalidArgumentError("Not a serialized XLS IR package");
+  }
+  bytes.remove_prefix(MagicString().size());
+  auto loader = absl::WrapUnique(new PackageLoader());
+  if (!loader->proto_.ParseFromArray(bytes.data(), bytes.size())) {
+    return absl::InvalidArgumentError("Malformed serialized XLS IR package");
+  }
+  if (entry.has_value()) {
+    loader->proto_.set_entry(std::string(entry.value()));
+  }
+  XLS_RETURN_IF_ERROR(loader->LoadHeader());
+  return std::move(loader);
+}
+
+absl::Status PackageLoader::LoadHeader() {
+  absl::optional<absl::string_view> entry;
+  if (proto_.has_entry()) {
+    entry = proto_.entry();
+  }
+  package_ = absl::make_unique<Package>(proto_.name(), entry);
+
+  types_.reserve(proto_.types_size());
+  for (const InternedTypeProto& type : proto_.types()) {
+    switch (type.type_enum()) {
+      case TypeProto::BITS:
+        types_.push_back(package_->GetBitsType(type.bit_count()));
+        break;
+      case TypeProto::TUPLE: {
+        std::vector<Type*> elements;
+        for (int64_t element : type.tuple_elements()) {
+          XLS_ASSIGN_OR_RETURN(Type * element_type, GetType(element));
+          elements.push_back(element_type);
+        }
+        types_.push_back(package_->GetTupleType(elements));
+        break;
+      }
+      case TypeProto::ARRAY: {
+        XLS_ASSIGN_OR_RETURN(Type * element_type,
+                             GetType(type.array_element()));
+        types_.push_back(
+            package_->GetArrayType(type.array_size(), element_type));
+        break;
+      }
+      case TypeProto::TOKEN:
+        types_.push_back(package_->GetTokenType());
+        break;
+      default:
+        return absl::InvalidArgumentError(
+            absl::StrCat("Invalid type kind: ", type.type_enum()));
+    }
+  }
+
+  for (const SerializedChannelProto& channel : proto_.channels()) {
+    XLS_ASSIGN_OR_RETURN(Type * type, GetType(channel.type()));
+    std::vector<Value> initial_values;
+    for (const ValueProto& value : channel.initial_values()) {
+      XLS_ASSIGN_OR_RETURN(Value initial_value, ValueFromProto(value));
+      initial_values.push_back(std::move(initial_value));
+    }
+    ChannelOps supported_ops;
+    switch (channel.supported_ops()) {
+      case SerializedChannelProto::SEND_ONLY:
+        supported_ops = ChannelOps::kSendOnly;
+        break;
+      case SerializedChannelProto::RECEIVE_ONLY:
+        supported_ops = ChannelOps::kReceiveOnly;
+        break;
+      default:
+        supported_ops = ChannelOps::kSendReceive;
+        break;
+    }
+    switch (channel.kind()) {
+      case SerializedChannelProto::STREAMING:
+        XLS_RETURN_IF_ERROR(package_
+                                ->CreateStreamingChannel(
+                                    channel.name(), supported_ops, type,
+                                    initial_values, channel.metadata(),
+                                    channel.id())
+                                .status());
+        break;
+      case SerializedChannelProto::PORT:
+        XLS_RETURN_IF_ERROR(
+            package_
+                ->CreatePortChannel(channel.name(), supported_ops, type,
+                                    channel.metadata(), channel.id())
+                .status());
+        break;
+      case SerializedChannelProto::REGISTER: {
+        absl::optional<Value> reset_value;
+        if (!initial_values.empty()) {
+          reset_value = initial_values.front();
+        }
+        XLS_RETURN_IF_ERROR(
+            package_
+                ->CreateRegisterChannel(channel.name(), type, reset_value,
+                                        channel.metadata(), channel.id())
+                .status());
+        break;
+      }
+    }
+  }
+
+  for (int64_t i = 0; i < proto_.function_bases_size(); ++i) {
+    const FunctionBaseEntryProto& entry = proto_.function_bases(i);
+    auto& indices = entry.kind() == FunctionBaseEntryProto::PROC
+                        ? proc_indices_
+                        : function_indices_;
+    if (!indices.insert({entry.name(), i}).second) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Duplicate function or proc %s", entry.name()));
+    }
+  }
+  loaded_.resize(proto_.function_bases_size(), nullptr);
+  loading_.resize(proto_.function_bases_size(), false);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Type*> PackageLoader::GetType(int64_t index) const {
+  if (index < 0 || index >= types_.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid type table index %d", index));
+  }
+  return types_[index];
+}
+
+absl::StatusOr<Function*> PackageLoader::LoadFunction(absl::string_view name) {
+  auto it = function_indices_.find(name);
+  if (it == function_indices_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("No function named %s in serialized package", name));
+  }
+  XLS_ASSIGN_OR_RETURN(FunctionBase * function_base, Load(it->second));
+  return function_base->AsFunctionOrDie();
+}
+
+absl::StatusOr<Proc*> PackageLoader::LoadProc(absl::string_view name) {
+  auto it = proc_indices_.find(name);
+  if (it == proc_indices_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("No proc named %s in serialized package", name));
+  }
+  XLS_ASSIGN_OR_RETURN(FunctionBase * function_base, Load(it->second));
+  return function_base->AsProcOrDie();
+}
+
+absl::Status PackageLoader::LoadAll() {
+  for (int64_t i = 0; i < proto_.function_bases_size(); ++i) {
+    XLS_RETURN_IF_ERROR(Load(i).status());
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<BValue> PackageLoader::AddNode(const NodeProto& node,
+                                              absl::Span<const BValue> values,
+                                              BuilderBase* builder) {
+  std::vector<BValue> operands;
+  operands.reserve(node.operands_size());
+  for (int64_t operand : node.operands()) {
+    if (operand < 0 || operand >= values.size()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Node %d refers to operand %d which is not defined before it",
+          node.id(), operand));
+    }
+    operands.push_back(values[operand]);
+  }
+  auto check_arity = [&](int64_t min_arity) -> absl::Status {
+    if (operands.size() < min_arity) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Node %d has %d operands, expected at least %d",
+                          node.id(), operands.size(), min_arity));
+    }
+    return absl::OkStatus();
+  };
+  absl::Span<const BValue> rest = absl::MakeConstSpan(operands);
+
+  XLS_ASSIGN_OR_RETURN(Type * type, GetType(node.type()));
+  absl::optional<SourceLocation> loc;
+  if (node.has_loc()) {
+    loc = SourceLocation(Fileno(node.loc().fileno()),
+                         Lineno(node.loc().lineno()),
+                         Colno(node.loc().colno()));
+  }
+  absl::string_view name = node.name();
+  Function* function = nullptr;
+  if (node.has_function()) {
+    XLS_ASSIGN_OR_RETURN(function, package_->GetFunction(node.function()));
+  }
+  Channel* channel = nullptr;
+  if (node.has_channel_id()) {
+    XLS_ASSIGN_OR_RETURN(channel, package_->GetChannel(node.channel_id()));
+  }
+
+  Op op = FromOpProto(node.op());
+  BValue result;
+  switch (op) {
+    case Op::kParam:
+      result = builder->Param(name, type, loc);
+      break;
+    case Op::kBitSlice:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->BitSlice(operands[0], node.start(), node.width(), loc,
+                                 name);
+      break;
+    case Op::kDynamicBitSlice:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      result = builder->DynamicBitSlice(operands[0], operands[1], node.width(),
+                                        loc, name);
+      break;
+    case Op::kBitSliceUpdate:
+      XLS_RETURN_IF_ERROR(check_arity(3));
+      result = builder->BitSliceUpdate(operands[0], operands[1], operands[2],
+                                       loc, name);
+      break;
+    case Op::kConcat:
+      result = builder->Concat(operands, loc, name);
+      break;
+    case Op::kLiteral: {
+      XLS_ASSIGN_OR_RETURN(Value value, ValueFromProto(node.value()));
+      result = builder->Literal(value, loc, name);
+      break;
+    }
+    case Op::kMap:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->Map(operands[0], function, loc, name);
+      break;
+    case Op::kCountedFor:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->CountedFor(operands[0], node.trip_count(),
+                                   node.stride(), function, rest.subspan(1),
+                                   loc, name);
+      break;
+    case Op::kDynamicCountedFor:
+      XLS_RETURN_IF_ERROR(check_arity(3));
+      result = builder->DynamicCountedFor(operands[0], operands[1],
+                                          operands[2], function,
+                                          rest.subspan(3), loc, name);
+      break;
+    case Op::kOneHot:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->OneHot(
+          operands[0], node.lsb_prio() ? LsbOrMsb::kLsb : LsbOrMsb::kMsb, loc,
+          name);
+      break;
+    case Op::kOneHotSel:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      result = builder->OneHotSelect(operands[0], rest.subspan(1), loc, name);
+      break;
+    case Op::kSel: {
+      XLS_RETURN_IF_ERROR(check_arity(node.has_default() ? 2 : 1));
+      absl::optional<BValue> default_value;
+      absl::Span<const BValue> cases = rest.subspan(1);
+      if (node.has_default()) {
+        default_value = cases.back();
+        cases.remove_suffix(1);
+      }
+      result = builder->Select(operands[0], cases, default_value, loc, name);
+      break;
+    }
+    case Op::kTuple:
+      result = builder->Tuple(operands, loc, name);
+      break;
+    case Op::kAfterAll:
+      result = builder->AfterAll(operands, loc, name);
+      break;
+    case Op::kArray:
+      if (!type->IsArray()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Array node %d has non-array type", node.id()));
+      }
+      result = builder->Array(operands, type->AsArrayOrDie()->element_type(),
+                              loc, name);
+      break;
+    case Op::kTupleIndex:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->TupleIndex(operands[0], node.index(), loc, name);
+      break;
+    case Op::kArrayIndex:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->ArrayIndex(operands[0], rest.subspan(1), loc, name);
+      break;
+    case Op::kArrayUpdate:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      result = builder->ArrayUpdate(operands[0], operands[1], rest.subspan(2),
+                                    loc, name);
+      break;
+    case Op::kArrayConcat:
+      result = builder->ArrayConcat(operands, loc, name);
+      break;
+    case Op::kInvoke:
+      result = builder->Invoke(operands, function, loc, name);
+      break;
+    case Op::kZeroExt:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result =
+          builder->ZeroExtend(operands[0], node.new_bit_count(), loc, name);
+      break;
+    case Op::kSignExt:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result =
+          builder->SignExtend(operands[0], node.new_bit_count(), loc, name);
+      break;
+    case Op::kEncode:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->Encode(operands[0], loc, name);
+      break;
+    case Op::kDecode:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->Decode(operands[0], node.width(), loc, name);
+      break;
+    case Op::kSMul:
+    case Op::kUMul:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      if (!type->IsBits()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Multiply node %d has non-bits type", node.id()));
+      }
+      result = builder->AddArithOp(op, operands[0], operands[1],
+                                   type->AsBitsOrDie()->bit_count(), loc,
+                                   name);
+      break;
+    case Op::kReceive:
+      XLS_RETURN_IF_ERROR(check_arity(1));
+      result = builder->Receive(channel, operands[0], loc, name);
+      break;
+    case Op::kReceiveIf:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      result = builder->ReceiveIf(channel, operands[0], operands[1], loc, name);
+      break;
+    case Op::kSend:
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      result = builder->Send(channel, operands[0], operands[1], loc, name);
+      break;
+    case Op::kSendIf:
+      XLS_RETURN_IF_ERROR(check_arity(3));
+      result = builder->SendIf(channel, operands[0], operands[1], operands[2],
+                               loc, name);
+      break;
+    case Op::kAssert: {
+      XLS_RETURN_IF_ERROR(check_arity(2));
+      absl::optional<std::string> label;
+      if (node.has_label()) {
+        label = node.label();
+      }
+      result = builder->Assert(operands[0], operands[1], node.message(), label,
+                               loc, name);
+      break;
+    }
+    default:
+      if (IsOpClass<BinOp>(op) || IsOpClass<CompareOp>(op)) {
+        XLS_RETURN_IF_ERROR(check_arity(2));
+        result = IsOpClass<BinOp>(op)
+                     ? builder->AddBinOp(op, operands[0], operands[1], loc,
+                                         name)
+                     : builder->AddCompareOp(op, operands[0], operands[1], loc,
+                                             name);
+      } else if (IsOpClass<UnOp>(op) || IsOpClass<BitwiseReductionOp>(op)) {
+        XLS_RETURN_IF_ERROR(check_arity(1));
+        result = IsOpClass<UnOp>(op)
+                     ? builder->AddUnOp(op, operands[0], loc, name)
+                     : builder->AddBitwiseReductionOp(op, operands[0], loc,
+                                                      name);
+      } else if (IsOpClass<NaryOp>(op)) {
+        result = builder->AddNaryOp(op, operands, loc, name);
+      } else {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Unsupported op in serialized package: %s", OpToString(op)));
+      }
+      break;
+  }
+  if (!result.valid()) {
+    // The builder recorded an error which is reported when building.
+    return result;
+  }
+  if (result.node()->GetType() != type) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Node %d has type %s, expected %s", node.id(),
+        result.node()->GetType()->ToString(), type->ToString()));
+  }
+  result.node()->set_id(node.id());
+  return result;
+}
+
+absl::StatusOr<FunctionBase*> PackageLoader::Load(int64_t index) {
+  if (loaded_[index] != nullptr) {
+    return loaded_[index];
+  }
+  const FunctionBaseEntryProto& entry = proto_.function_bases(index);
+  if (loading_[index]) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Cycle in call graph involving %s", entry.name()));
+  }
+  loading_[index] = true;
+
+  FunctionBaseProto body;
+  if (!body.ParseFromString(entry.body())) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Malformed serialized body of %s", entry.name()));
+  }
+  // Callees must exist before the nodes which refer to them are built.
+  for (const NodeProto& node : body.nodes()) {
+    if (node.has_function()) {
+      XLS_RETURN_IF_ERROR(LoadFunction(node.function()).status());
+    }
+  }
+
+  // Adds the nodes of the body starting at `start` to the builder. Stops
+  // early if the builder records an error; the error is reported by the
+  // builder's Build method.
+  std::vector<BValue> values;
+  values.reserve(body.nodes_size());
+  auto add_nodes = [&](int64_t start, BuilderBase* builder) -> absl::Status {
+    for (int64_t i = start; i < body.nodes_size(); ++i) {
+      XLS_ASSIGN_OR_RETURN(BValue value, AddNode(body.nodes(i), values,
+                                                 builder));
+      if (!value.valid()) {
+        break;
+      }
+      values.push_back(value);
+    }
+    return absl::OkStatus();
+  };
+  auto get_value = [&](int64_t i) -> BValue {
+    return i >= 0 && i < values.size() ? values[i] : BValue();
+  };
+
+  // Verification of the whole package is left to the caller.
+  FunctionBase* result;
+  if (entry.kind() == FunctionBaseEntryProto::PROC) {
+    if (body.nodes_size() < 2 || body.nodes(0).op() != OP_PARAM ||
+        body.nodes(1).op() != OP_PARAM) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Proc %s must begin with token and state parameters", entry.name()));
+    }
+    XLS_ASSIGN_OR_RETURN(Value init_value, ValueFromProto(body.init_value()));
+    ProcBuilder builder(entry.name(), init_value, body.nodes(0).name(),
+                        body.nodes(1).name(), package_.get(),
+                        /*should_verify=*/false);
+    for (BValue param : {builder.GetTokenParam(), builder.GetStateParam()}) {
+      param.node()->set_id(body.nodes(values.size()).id());
+      values.push_back(param);
+    }
+    XLS_RETURN_IF_ERROR(add_nodes(/*start=*/2, &builder));
+    XLS_ASSIGN_OR_RETURN(result, builder.Build(get_value(body.next_token()),
+                                               get_value(body.next_state())));
+  } else {
+    FunctionBuilder builder(entry.name(), package_.get(),
+                            /*should_verify=*/false);
+    XLS_RETURN_IF_ERROR(add_nodes(/*start=*/0, &builder));
+    XLS_ASSIGN_OR_RETURN(
+        result, builder.BuildWithReturnValue(get_value(body.return_value())));
+  }
+  package_->set_next_node_id(
+      std::max(package_->next_node_id(), proto_.next_node_id()));
+
+  loaded_[index] = result;
+  loading_[index] = false;
+  return result;
+}
+
+}  // namespace xls
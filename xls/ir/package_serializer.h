@@ -0,0 +1,122 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Binary serialization of IR packages. The binary form (see
+// serialized_package.proto) is loaded without scanning text or resolving
+// names, and functions can be loaded individually on demand, which makes it
+// suitable for passing large packages between tools.
+
+#ifndef XLS_IR_PACKAGE_SERIALIZER_H_
+#define XLS_IR_PACKAGE_SERIALIZER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/ir/proc.h"
+#include "xls/ir/serialized_package.pb.h"
+#include "xls/ir/type.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+// Prefix of every serialized package. Distinguishes binary IR from text IR.
+constexpr char kSerializedPackageMagic[] = "XLSIRB1\n";
+
+// Returns true if the given bytes start with kSerializedPackageMagic.
+bool IsSerializedPackage(absl::string_view bytes);
+
+// Converts the given package to its binary proto form.
+absl::StatusOr<PackageProto> PackageToProto(Package* package);
+
+// Converts between values and their proto form, e.g., for storing simulation
+// state alongside a serialized package.
+ValueProto ValueToProto(const Value& value);
+absl::StatusOr<Value> ValueFromProto(const ValueProto& proto);
+
+// Serializes the given package into the binary IR format.
+absl::StatusOr<std::string> SerializePackage(Package* package);
+
+// Loads the entire serialized package and verifies it. This is the binary
+// analogue of Parser::ParsePackage. If given, `entry` overrides the entry
+// function recorded in the serialized package.
+absl::StatusOr<std::unique_ptr<Package>> DeserializePackage(
+    absl::string_view bytes,
+    absl::optional<absl::string_view> entry = absl::nullopt);
+
+// Loads a serialized package incrementally. Creating the loader decodes only
+// the package header (types, channels and the function index); the body of a
+// function or proc is decoded when it, or one of its callers, is loaded.
+// Loaded functions are not verified.
+class PackageLoader {
+ public:
+  static absl::StatusOr<std::unique_ptr<PackageLoader>> Create(
+      absl::string_view bytes,
+      absl::optional<absl::string_view> entry = absl::nullopt);
+
+  // The package being populated. Only loaded functions and procs are present.
+  Package* package() const { return package_.get(); }
+
+  // Loads the function (or proc) with the given name, along with any
+  // functions it calls. Returns the already-loaded object on repeated calls.
+  absl::StatusOr<Function*> LoadFunction(absl::string_view name);
+  absl::StatusOr<Proc*> LoadProc(absl::string_view name);
+
+  // Loads all functions and procs which have not yet been loaded.
+  absl::Status LoadAll();
+
+  // Releases ownership of the package. The loader may not be used afterwards.
+  std::unique_ptr<Package> ReleasePackage() { return std::move(package_); }
+
+ private:
+  PackageLoader() = default;
+
+  absl::Status LoadHeader();
+  absl::StatusOr<Type*> GetType(int64_t index) const;
+
+  // Adds the given node to the builder. `values` holds the previously added
+  // nodes of the enclosing function base, which operands refer to by index.
+  // Returns an invalid BValue if the builder recorded an error.
+  absl::StatusOr<BValue> AddNode(const NodeProto& node,
+                                 absl::Span<const BValue> values,
+                                 BuilderBase* builder);
+
+  // Loads the function base at the given index of proto_.function_bases().
+  absl::StatusOr<FunctionBase*> Load(int64_t index);
+
+  PackageProto proto_;
+  std::unique_ptr<Package> package_;
+  std::vector<Type*> types_;
+  absl::flat_hash_map<std::string, int64_t> function_indices_;
+  absl::flat_hash_map<std::string, int64_t> proc_indices_;
+
+  // Loaded function bases, by index; nullptr if not (yet) loaded.
+  std::vector<FunctionBase*> loaded_;
+  // Whether the function base at each index is being loaded. Used to reject
+  // cyclic call graphs.
+  std::vector<bool> loading_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_IR_PACKAGE_SERIALIZER_H_
@@ -0,0 +1,158 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/package_serializer.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+// Parses the given IR text, round trips it through the binary format and
+// verifies the result dumps identically to the original.
+void ExpectRoundTrip(absl::string_view input) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(input));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string bytes,
+                           SerializePackage(package.get()));
+  EXPECT_TRUE(IsSerializedPackage(bytes));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> loaded,
+                           DeserializePackage(bytes));
+  EXPECT_EQ(loaded->DumpIr(), package->DumpIr());
+  EXPECT_EQ(loaded->next_node_id(), package->next_node_id());
+}
+
+TEST(PackageSerializerTest, RoundTripFunctions) {
+  ExpectRoundTrip(R"(package test
+
+fn body(i: bits[32], accum: bits[32], x: bits[32]) -> bits[32] {
+  add.4: bits[32] = add(accum, x, id=4)
+  ret add.5: bits[32] = add(add.4, i, id=5)
+}
+
+fn f(x: bits[32], y: bits[8], a: bits[32][2]) -> (bits[32], bits[2], bits[8]) {
+  literal.10: bits[32] = literal(value=42, id=10)
+  counted_for.11: bits[32] = counted_for(literal.10, trip_count=4, stride=2, body=body, invariant_args=[x], id=11)
+  bit_slice.12: bits[2] = bit_slice(y, start=3, width=2, id=12)
+  sel.13: bits[32] = sel(bit_slice.12, cases=[x, counted_for.11], default=literal.10, id=13)
+  array_index.14: bits[32] = array_index(a, indices=[bit_slice.12], id=14)
+  umul.15: bits[8] = umul(x, array_index.14, id=15)
+  sign_ext.16: bits[8] = sign_ext(bit_slice.12, new_bit_count=8, id=16)
+  one_hot.17: bits[3] = one_hot(bit_slice.12, lsb_prio=true, id=17)
+  result: bits[8] = xor(umul.15, sign_ext.16, y, id=18)
+  ret tuple.19: (bits[32], bits[2], bits[8]) = tuple(sel.13, bit_slice.12, result, id=19)
+}
+
+fn g(x: bits[32]) -> (bits[32], bits[2], bits[8]) {
+  literal.20: bits[8] = literal(value=7, id=20)
+  literal.21: bits[32][2] = literal(value=[1, 2], id=21)
+  ret invoke.22: (bits[32], bits[2], bits[8]) = invoke(x, literal.20, literal.21, to_apply=f, id=22)
+}
+)");
+}
+
+TEST(PackageSerializerTest, RoundTripProc) {
+  ExpectRoundTrip(R"(package test
+
+chan ch(bits[32], id=0, kind=streaming, ops=send_receive, metadata="""""")
+
+proc my_proc(my_token: token, my_state: bits[32], init=42) {
+  send.1: token = send(my_token, my_state, channel_id=0, id=1)
+  receive.2: (token, bits[32]) = receive(send.1, channel_id=0, id=2)
+  tuple_index.3: token = tuple_index(receive.2, index=0, id=3)
+  next (tuple_index.3, my_state)
+}
+)");
+}
+
+TEST(PackageSerializerTest, LoadFunctionLazily) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(package test
+
+fn a(x: bits[8]) -> bits[8] {
+  ret neg.2: bits[8] = neg(x, id=2)
+}
+
+fn b(x: bits[8]) -> bits[8] {
+  ret not.4: bits[8] = not(x, id=4)
+}
+
+fn c(x: bits[8]) -> bits[8] {
+  ret invoke.6: bits[8] = invoke(x, to_apply=b, id=6)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string bytes,
+                           SerializePackage(package.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PackageLoader> loader,
+                           PackageLoader::Create(bytes));
+  EXPECT_TRUE(loader->package()->functions().empty());
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * c, loader->LoadFunction("c"));
+  EXPECT_EQ(c->name(), "c");
+  // Loading c loads its callee b, but not a.
+  EXPECT_EQ(loader->package()->functions().size(), 2);
+  EXPECT_TRUE(loader->package()->GetFunction("b").ok());
+  EXPECT_FALSE(loader->package()->GetFunction("a").ok());
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * c_again, loader->LoadFunction("c"));
+  EXPECT_EQ(c_again, c);
+  EXPECT_THAT(loader->LoadFunction("d").status(),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  XLS_ASSERT_OK(loader->LoadAll());
+  EXPECT_EQ(loader->package()->functions().size(), 3);
+}
+
+TEST(PackageSerializerTest, ParsePackageFileAcceptsBinary) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(package test
+
+fn f(x: bits[8]) -> bits[8] {
+  ret neg.2: bits[8] = neg(x, id=2)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string bytes,
+                           SerializePackage(package.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(bytes, ".irb"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> loaded,
+                           Parser::ParsePackageFile(temp_file.path(),
+                                                    /*entry=*/"f"));
+  EXPECT_EQ(loaded->DumpIr(), package->DumpIr());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry, loaded->EntryFunction());
+  EXPECT_EQ(entry->name(), "f");
+}
+
+TEST(PackageSerializerTest, RejectsMalformedInput) {
+  EXPECT_FALSE(IsSerializedPackage("package test"));
+  EXPECT_THAT(PackageLoader::Create("package test").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Not a serialized XLS IR package")));
+  EXPECT_THAT(
+      DeserializePackage(std::string(kSerializedPackageMagic) + "\xff\xff")
+          .status(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("Malformed serialized XLS IR package")));
+}
+
+}  // namespace
+}  // namespace xls
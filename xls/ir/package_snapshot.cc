@@ -0,0 +1,190 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/package_snapshot.h"
+
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+// Returns the function called by "node", or nullptr if it calls none.
+Function* CalledFunction(Node* node) {
+  switch (node->op()) {
+    case Op::kCountedFor:
+      return node->As<CountedFor>()->body();
+    case Op::kDynamicCountedFor:
+      return node->As<DynamicCountedFor>()->body();
+    case Op::kInvoke:
+      return node->As<Invoke>()->to_apply();
+    case Op::kMap:
+      return node->As<Map>()->to_apply();
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
+/* static */ std::shared_ptr<const PackageSnapshot> PackageSnapshot::Create(
+    std::unique_ptr<Package> package) {
+  return std::shared_ptr<const PackageSnapshot>(
+      new PackageSnapshot(std::move(package)));
+}
+
+PackageSnapshot::PackageSnapshot(std::unique_ptr<Package> package)
+    : package_(std::move(package)) {
+  absl::flat_hash_map<Function*, std::vector<Function*>> callees;
+  absl::flat_hash_map<Function*, std::vector<Function*>> neighbors;
+  for (const std::unique_ptr<Function>& f : package_->functions()) {
+    absl::flat_hash_set<Function*> seen;
+    for (Node* node : f->nodes()) {
+      Function* callee = CalledFunction(node);
+      if (callee != nullptr && seen.insert(callee).second) {
+        callees[f.get()].push_back(callee);
+        neighbors[f.get()].push_back(callee);
+        neighbors[callee].push_back(f.get());
+      }
+    }
+  }
+
+  // Order the functions by a post-order traversal of the call graph, which
+  // is acyclic.
+  absl::flat_hash_set<Function*> visited;
+  std::vector<std::pair<Function*, int64_t>> stack;
+  for (const std::unique_ptr<Function>& f : package_->functions()) {
+    if (!visited.insert(f.get()).second) {
+      continue;
+    }
+    stack.push_back({f.get(), 0});
+    while (!stack.empty()) {
+      auto& [function, next_callee] = stack.back();
+      const std::vector<Function*>& function_callees = callees[function];
+      if (next_callee < function_callees.size()) {
+        Function* callee = function_callees[next_callee++];
+        if (visited.insert(callee).second) {
+          stack.push_back({callee, 0});
+        }
+        continue;
+      }
+      call_order_.push_back(function);
+      stack.pop_back();
+    }
+  }
+
+  // Number the components of the undirected call graph.
+  int64_t component_count = 0;
+  for (Function* f : call_order_) {
+    if (component_.contains(f)) {
+      continue;
+    }
+    std::vector<Function*> worklist = {f};
+    component_[f] = component_count;
+    while (!worklist.empty()) {
+      Function* function = worklist.back();
+      worklist.pop_back();
+      for (Function* neighbor : neighbors[function]) {
+        if (component_.emplace(neighbor, component_count).second) {
+          worklist.push_back(neighbor);
+        }
+      }
+    }
+    ++component_count;
+  }
+}
+
+std::vector<Function*> PackageSnapshot::GetCallComponent(
+    Function* function) const {
+  int64_t component = component_.at(function);
+  std::vector<Function*> result;
+  for (Function* f : call_order_) {
+    if (component_.at(f) == component) {
+      result.push_back(f);
+    }
+  }
+  return result;
+}
+
+PackageVariant::PackageVariant(std::shared_ptr<const PackageSnapshot> snapshot)
+    : snapshot_(std::move(snapshot)) {
+  const Package* base = snapshot_->package();
+  absl::optional<absl::string_view> entry;
+  if (base->entry().has_value()) {
+    entry = *base->entry();
+  }
+  package_ = absl::make_unique<Package>(base->name(), entry);
+  // Keep the file numbers of copied source locations meaningful.
+  for (const std::string& filename : base->GetFilenames()) {
+    package_->GetOrCreateFileno(filename);
+  }
+}
+
+absl::StatusOr<Function*> PackageVariant::GetFunction(
+    absl::string_view name) const {
+  if (fully_copied_) {
+    return package_->GetFunction(name);
+  }
+  XLS_ASSIGN_OR_RETURN(Function * base,
+                       snapshot_->package()->GetFunction(name));
+  auto it = copies_.find(base);
+  return it == copies_.end() ? base : it->second;
+}
+
+absl::StatusOr<Function*> PackageVariant::GetMutableFunction(
+    absl::string_view name) {
+  if (fully_copied_) {
+    return package_->GetFunction(name);
+  }
+  XLS_ASSIGN_OR_RETURN(Function * base,
+                       snapshot_->package()->GetFunction(name));
+  if (!copies_.contains(base)) {
+    XLS_RETURN_IF_ERROR(CopyFunctions(snapshot_->GetCallComponent(base)));
+  }
+  return copies_.at(base);
+}
+
+absl::StatusOr<Package*> PackageVariant::GetMutablePackage() {
+  if (!fully_copied_) {
+    if (!snapshot_->package()->procs().empty()) {
+      return absl::UnimplementedError(
+          "Variants of packages with procs are not supported");
+    }
+    XLS_RETURN_IF_ERROR(CopyFunctions(snapshot_->functions_in_call_order()));
+    fully_copied_ = true;
+  }
+  return package_.get();
+}
+
+absl::Status PackageVariant::CopyFunctions(
+    absl::Span<Function* const> functions) {
+  for (Function* f : functions) {
+    if (copies_.contains(f)) {
+      continue;
+    }
+    XLS_ASSIGN_OR_RETURN(Function * copy,
+                         f->Clone(f->name(), package_.get(), copies_));
+    copies_[f] = copy;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace xls
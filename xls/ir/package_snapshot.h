@@ -0,0 +1,118 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Copy-on-write variants of a package. Exploring design variants (different
+// pass subsets, schedules or clock targets) from one base package would
+// otherwise clone or reparse the whole package per variant; variants of a
+// snapshot share the functions they only read and copy just the ones they
+// modify.
+
+#ifndef XLS_IR_PACKAGE_SNAPSHOT_H_
+#define XLS_IR_PACKAGE_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+
+// An immutable package shared by any number of PackageVariants, which may be
+// used from different threads.
+class PackageSnapshot {
+ public:
+  // Takes ownership of "package", which must not be modified afterwards.
+  static std::shared_ptr<const PackageSnapshot> Create(
+      std::unique_ptr<Package> package);
+
+  const Package* package() const { return package_.get(); }
+
+  // Returns the functions connected to "function" by calls in either
+  // direction, including "function" itself, with callees before callers. A
+  // variant copies these together so calls never cross packages.
+  std::vector<Function*> GetCallComponent(Function* function) const;
+
+  // Returns all functions of the package with callees before callers.
+  absl::Span<Function* const> functions_in_call_order() const {
+    return call_order_;
+  }
+
+ private:
+  explicit PackageSnapshot(std::unique_ptr<Package> package);
+
+  std::unique_ptr<Package> package_;
+  std::vector<Function*> call_order_;
+  // Index of the call-graph component of each function.
+  absl::flat_hash_map<Function*, int64_t> component_;
+};
+
+// A copy-on-write view of a PackageSnapshot. Functions are read from the
+// snapshot until the variant asks to modify them, at which point they are
+// cloned into a package owned by the variant. Not thread-safe; use one
+// variant per thread.
+//
+// Example:
+//
+//   std::shared_ptr<const PackageSnapshot> base =
+//       PackageSnapshot::Create(std::move(package));
+//   PackageVariant variant(base);
+//   // Scheduling only reads the function, so nothing is copied.
+//   XLS_ASSIGN_OR_RETURN(Function * f, variant.GetFunction("main"));
+//   ... schedule f ...
+//   // Optimizing modifies the package, so it is materialized.
+//   XLS_ASSIGN_OR_RETURN(Package * p, variant.GetMutablePackage());
+//   ... run passes on p ...
+class PackageVariant {
+ public:
+  explicit PackageVariant(std::shared_ptr<const PackageSnapshot> snapshot);
+
+  // Returns the current version of the named function: the variant's copy if
+  // it has one, otherwise the snapshot's, which must not be modified.
+  absl::StatusOr<Function*> GetFunction(absl::string_view name) const;
+
+  // Returns the variant's modifiable copy of the named function, making it on
+  // first use along with the rest of its call component (see
+  // PackageSnapshot::GetCallComponent).
+  absl::StatusOr<Function*> GetMutableFunction(absl::string_view name);
+
+  // Copies every function the variant doesn't have yet and returns the
+  // variant's package, e.g., to run a pass pipeline over it. Afterwards the
+  // package is the variant's own and GetFunction reads only from it. Packages
+  // with procs are not supported.
+  absl::StatusOr<Package*> GetMutablePackage();
+
+  // Returns the number of functions the variant has copied.
+  int64_t copied_function_count() const { return copies_.size(); }
+
+ private:
+  absl::Status CopyFunctions(absl::Span<Function* const> functions);
+
+  std::shared_ptr<const PackageSnapshot> snapshot_;
+  std::unique_ptr<Package> package_;
+  // The copy of each snapshot function the variant has copied. Used as the
+  // call remapping when cloning later functions.
+  absl::flat_hash_map<const Function*, Function*> copies_;
+  bool fully_copied_ = false;
+};
+
+}  // namespace xls
+
+#endif  // XLS_IR_PACKAGE_SNAPSHOT_H_
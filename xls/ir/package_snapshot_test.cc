@@ -0,0 +1,115 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/package_snapshot.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+constexpr char kPackage[] = R"(package test
+
+fn helper(x: bits[32]) -> bits[32] {
+  ret neg.1: bits[32] = neg(x, id=1)
+}
+
+fn main(x: bits[32]) -> bits[32] {
+  ret invoke.2: bits[32] = invoke(x, to_apply=helper, id=2)
+}
+
+fn other(x: bits[32]) -> bits[32] {
+  ret not.3: bits[32] = not(x, id=3)
+}
+)";
+
+std::shared_ptr<const PackageSnapshot> MakeSnapshot() {
+  std::unique_ptr<Package> package = Parser::ParsePackage(kPackage).value();
+  return PackageSnapshot::Create(std::move(package));
+}
+
+TEST(PackageSnapshotTest, CallComponents) {
+  std::shared_ptr<const PackageSnapshot> snapshot = MakeSnapshot();
+  Function* helper = snapshot->package()->GetFunction("helper").value();
+  Function* main = snapshot->package()->GetFunction("main").value();
+  Function* other = snapshot->package()->GetFunction("other").value();
+  EXPECT_THAT(snapshot->GetCallComponent(main),
+              testing::ElementsAre(helper, main));
+  EXPECT_THAT(snapshot->GetCallComponent(helper),
+              testing::ElementsAre(helper, main));
+  EXPECT_THAT(snapshot->GetCallComponent(other), testing::ElementsAre(other));
+}
+
+TEST(PackageSnapshotTest, ReadsShareTheSnapshot) {
+  std::shared_ptr<const PackageSnapshot> snapshot = MakeSnapshot();
+  PackageVariant variant(snapshot);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, variant.GetFunction("main"));
+  EXPECT_EQ(main, snapshot->package()->GetFunction("main").value());
+  EXPECT_EQ(variant.copied_function_count(), 0);
+  EXPECT_THAT(variant.GetFunction("missing").status(),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(PackageSnapshotTest, WritesCopyTheCallComponent) {
+  std::shared_ptr<const PackageSnapshot> snapshot = MakeSnapshot();
+  std::string base_ir = snapshot->package()->DumpIr();
+  PackageVariant variant(snapshot);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, variant.GetMutableFunction("main"));
+  EXPECT_NE(main, snapshot->package()->GetFunction("main").value());
+  EXPECT_EQ(variant.copied_function_count(), 2);
+
+  // The copy calls the variant's helper, and reads now see the copies.
+  XLS_ASSERT_OK_AND_ASSIGN(Function * helper, variant.GetFunction("helper"));
+  EXPECT_EQ(main->return_value()->As<Invoke>()->to_apply(), helper);
+  EXPECT_EQ(helper->package(), main->package());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * other, variant.GetFunction("other"));
+  EXPECT_EQ(other, snapshot->package()->GetFunction("other").value());
+
+  // Modifying the copy leaves the snapshot alone.
+  XLS_ASSERT_OK(helper->return_value()
+                    ->ReplaceUsesWithNew<UnOp>(helper->param(0), Op::kNot)
+                    .status());
+  EXPECT_EQ(snapshot->package()->DumpIr(), base_ir);
+  EXPECT_EQ(helper->return_value()->op(), Op::kNot);
+}
+
+TEST(PackageSnapshotTest, MutablePackage) {
+  std::shared_ptr<const PackageSnapshot> snapshot = MakeSnapshot();
+  PackageVariant variant(snapshot);
+  XLS_ASSERT_OK(variant.GetMutableFunction("main").status());
+  XLS_ASSERT_OK_AND_ASSIGN(Package * package, variant.GetMutablePackage());
+  EXPECT_EQ(variant.copied_function_count(), 3);
+  EXPECT_THAT(package->GetFunctionNames(),
+              testing::ElementsAre("helper", "main", "other"));
+  EXPECT_TRUE(package->IsDefinitelyEqualTo(snapshot->package()));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * other, variant.GetFunction("other"));
+  EXPECT_EQ(other->package(), package);
+
+  // Variants are independent of each other.
+  PackageVariant second(snapshot);
+  EXPECT_EQ(second.copied_function_count(), 0);
+}
+
+}  // namespace
+}  // namespace xls
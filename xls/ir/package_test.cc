@@ -108,6 +108,36 @@ TEST_F(PackageTest, GetTupleTypes) {
               IsOkAndHolds(nested_tuple));
 }
 
+TEST_F(PackageTest, TypesAreCanonical) {
+  Package p("my_package");
+  Package other("other_package");
+  auto make_nested = [](Package* pkg) {
+    Type* inner = pkg->GetTupleType(
+        {pkg->GetBitsType(8), pkg->GetArrayType(3, pkg->GetBitsType(16))});
+    return pkg->GetArrayType(
+        2, pkg->GetTupleType({inner, pkg->GetTokenType(), inner}));
+  };
+  ArrayType* nested = make_nested(&p);
+  EXPECT_EQ(nested, make_nested(&p));
+  EXPECT_EQ(nested->GetFlatBitCount(), 2 * 2 * (8 + 3 * 16));
+
+  // Structurally equal types of different packages are distinct objects with
+  // equal hashes.
+  ArrayType* other_nested = make_nested(&other);
+  EXPECT_NE(nested, other_nested);
+  EXPECT_EQ(nested->hash(), other_nested->hash());
+  EXPECT_TRUE(nested->IsEqualTo(other_nested));
+  EXPECT_FALSE(nested->IsEqualTo(
+      other.GetArrayType(3, other_nested->element_type())));
+
+  FunctionType* function_type =
+      p.GetFunctionType({nested, p.GetBitsType(1)}, p.GetBitsType(8));
+  EXPECT_EQ(function_type,
+            p.GetFunctionType({nested, p.GetBitsType(1)}, p.GetBitsType(8)));
+  EXPECT_NE(function_type,
+            p.GetFunctionType({nested, p.GetBitsType(1)}, p.GetBitsType(9)));
+}
+
 TEST_F(PackageTest, GetTokenType) {
   Package p("my_package");
 
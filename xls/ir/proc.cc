@@ -28,22 +28,35 @@ std::string Proc::DumpIr(bool recursive) const {
   // level.
   XLS_CHECK(!recursive);
 
-  std::string res = absl::StrFormat(
-      "proc %s(%s: %s, %s: %s, init=%s) {\n", name(), TokenParam()->GetName(),
-      TokenParam()->GetType()->ToString(), StateParam()->GetName(),
-      StateParam()->GetType()->ToString(), InitValue().ToHumanString());
+  std::string res;
+  IrWriter writer([&](absl::string_view chunk) {
+    res.append(chunk.data(), chunk.size());
+    return absl::OkStatus();
+  });
+  DumpIrTo(&writer);
+  XLS_CHECK_OK(writer.Close());
+  return res;
+}
+
+void Proc::DumpIrTo(IrWriter* writer) const {
+  std::string* res = writer->buffer();
+  absl::StrAppendFormat(
+      res, "proc %s(%s: %s, %s: %s, init=%s) {\n", name(),
+      TokenParam()->GetName(), TokenParam()->GetType()->ToString(),
+      StateParam()->GetName(), StateParam()->GetType()->ToString(),
+      InitValue().ToHumanString());
 
   for (Node* node : TopoSort(const_cast<Proc*>(this))) {
     if (node->op() == Op::kParam) {
       continue;
     }
-    absl::StrAppend(&res, "  ", node->ToString(), "\n");
+    absl::StrAppend(res, "  ", node->ToString(), "\n");
+    writer->MaybeFlush();
   }
-  absl::StrAppend(&res, "  next (", NextToken()->GetName(), ", ",
+  absl::StrAppend(res, "  next (", NextToken()->GetName(), ", ",
                   NextState()->GetName(), ")\n");
 
-  absl::StrAppend(&res, "}\n");
-  return res;
+  absl::StrAppend(res, "}\n");
 }
 
 absl::Status Proc::SetNextToken(Node* next) {
@@ -52,7 +65,11 @@ absl::Status Proc::SetNextToken(Node* next) {
         "Cannot set next token to \"%s\", expected token type but has type %s",
         next->GetName(), next->GetType()->ToString()));
   }
+  if (next_token_ != nullptr) {
+    MarkChanged(next_token_);
+  }
   next_token_ = next;
+  MarkChanged(next);
   return absl::OkStatus();
 }
 
@@ -63,7 +80,11 @@ absl::Status Proc::SetNextState(Node* next) {
         "proc state type %s",
         next->GetName(), next->GetType()->ToString(), StateType()->ToString()));
   }
+  if (next_state_ != nullptr) {
+    MarkChanged(next_state_);
+  }
   next_state_ = next;
+  MarkChanged(next);
   return absl::OkStatus();
 }
 
@@ -81,7 +102,9 @@ absl::Status Proc::ReplaceState(absl::string_view state_param_name,
       state_param_,
       MakeNodeWithName<Param>(/*loc=*/absl::nullopt, state_param_name,
                               next_state->GetType()));
+  MarkChanged(next_state_);
   next_state_ = next_state;
+  MarkChanged(next_state_);
 
   XLS_RET_CHECK(!HasImplicitUse(old_state_param));
   XLS_RETURN_IF_ERROR(RemoveNode(old_state_param, /*remove_param_ok=*/true));
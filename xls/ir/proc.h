@@ -77,6 +77,7 @@ class Proc : public FunctionBase {
   }
 
   std::string DumpIr(bool recursive = false) const override;
+  void DumpIrTo(IrWriter* writer) const override;
 
  private:
   Value init_value_;
@@ -28,7 +28,9 @@ PYBIND11_MODULE(verifier, m) {
   py::module::import("xls.ir.python.package");
 
   m.def("verify_function", PyWrap(&VerifyFunction), py::arg("function"));
-  m.def("verify_package", PyWrap(&VerifyPackage), py::arg("package"));
+  m.def("verify_package",
+        PyWrap(static_cast<absl::Status (*)(Package*)>(&VerifyPackage)),
+        py::arg("package"));
 }
 
 }  // namespace xls
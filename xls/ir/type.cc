@@ -14,6 +14,7 @@
 
 #include "xls/ir/type.h"
 
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -35,6 +36,25 @@ std::string TypeKindToString(TypeKind type_kind) {
   return absl::StrFormat("<invalid TypeKind %d>", static_cast<int>(type_kind));
 }
 
+namespace {
+
+// Combines the hash of a type with the hash of one of its components.
+size_t CombineHash(size_t hash, size_t component) {
+  return absl::Hash<std::pair<size_t, size_t>>()({hash, component});
+}
+
+size_t KindHash(TypeKind kind) { return absl::Hash<TypeKind>()(kind); }
+
+size_t TupleHash(absl::Span<Type* const> members) {
+  size_t hash = CombineHash(KindHash(TypeKind::kTuple), members.size());
+  for (Type* member : members) {
+    hash = CombineHash(hash, member->hash());
+  }
+  return hash;
+}
+
+}  // namespace
+
 std::ostream& operator<<(std::ostream& os, TypeKind type_kind) {
   os << TypeKindToString(type_kind);
   return os;
@@ -85,7 +105,7 @@ bool TupleType::IsEqualTo(const Type* other) const {
     return false;
   }
   const TupleType* other_tuple = other->AsTupleOrDie();
-  if (size() != other_tuple->size()) {
+  if (hash() != other_tuple->hash() || size() != other_tuple->size()) {
     return false;
   }
   for (int64_t i = 0; i < size(); ++i) {
@@ -112,7 +132,7 @@ bool ArrayType::IsEqualTo(const Type* other) const {
     return false;
   }
   const ArrayType* other_array = other->AsArrayOrDie();
-  return size() == other_array->size() &&
+  return hash() == other_array->hash() && size() == other_array->size() &&
          element_type()->IsEqualTo(other_array->element_type());
 }
 
@@ -134,6 +154,17 @@ std::ostream& operator<<(std::ostream& os, const Type& type) {
   return os;
 }
 
+TupleType::TupleType(absl::Span<Type* const> members)
+    : Type(TypeKind::kTuple, TupleHash(members)),
+      leaf_count_(0),
+      flat_bit_count_(0),
+      members_(members.begin(), members.end()) {
+  for (Type* member : members) {
+    leaf_count_ += member->leaf_count();
+    flat_bit_count_ += member->GetFlatBitCount();
+  }
+}
+
 std::string TupleType::ToString() const {
   std::vector<std::string> pieces;
   for (Type* member : members_) {
@@ -143,7 +174,8 @@ std::string TupleType::ToString() const {
 }
 
 BitsType::BitsType(int64_t bit_count)
-    : Type(TypeKind::kBits), bit_count_(bit_count) {
+    : Type(TypeKind::kBits, CombineHash(KindHash(TypeKind::kBits), bit_count)),
+      bit_count_(bit_count) {
   XLS_CHECK_GE(bit_count_, 0);
 }
 
@@ -151,10 +183,19 @@ std::string BitsType::ToString() const {
   return absl::StrFormat("bits[%d]", bit_count());
 }
 
+ArrayType::ArrayType(int64_t size, Type* element_type)
+    : Type(TypeKind::kArray,
+           CombineHash(CombineHash(KindHash(TypeKind::kArray), size),
+                       element_type->hash())),
+      size_(size),
+      element_type_(element_type) {}
+
 std::string ArrayType::ToString() const {
   return absl::StrFormat("%s[%d]", element_type()->ToString(), size());
 }
 
+TokenType::TokenType() : Type(TypeKind::kToken, KindHash(TypeKind::kToken)) {}
+
 std::string TokenType::ToString() const { return absl::StrFormat("token"); }
 
 FunctionTypeProto FunctionType::ToProto() const {
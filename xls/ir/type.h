@@ -58,9 +58,16 @@ class Type {
 
   TypeKind kind() const { return kind_; }
 
-  // Returns true if this type and 'other' represent the same type.
+  // Returns true if this type and 'other' represent the same type. Types
+  // owned by the same package are canonical so this is equivalent to pointer
+  // comparison for them; types from different packages are compared
+  // structurally, after a constant-time check of their hashes.
   virtual bool IsEqualTo(const Type* other) const = 0;
 
+  // Returns a hash of the structure of the type, computed at construction.
+  // Structurally equal types have equal hashes.
+  size_t hash() const { return hash_; }
+
   bool IsBits() const { return kind_ == TypeKind::kBits; }
   BitsType* AsBitsOrDie();
   const BitsType* AsBitsOrDie() const;
@@ -90,10 +97,11 @@ class Type {
   virtual std::string ToString() const = 0;
 
  protected:
-  explicit Type(TypeKind kind) : kind_(kind) {}
+  Type(TypeKind kind, size_t hash) : kind_(kind), hash_(hash) {}
 
  private:
   TypeKind kind_;
+  size_t hash_;
 };
 
 std::ostream& operator<<(std::ostream& os, const Type& type);
@@ -125,13 +133,7 @@ class BitsType : public Type {
 // Note that tuples can be empty.
 class TupleType : public Type {
  public:
-  explicit TupleType(absl::Span<Type* const> members)
-      : Type(TypeKind::kTuple), members_(members.begin(), members.end()) {
-    leaf_count_ = 0;
-    for (Type* t : members) {
-      leaf_count_ += t->leaf_count();
-    }
-  }
+  explicit TupleType(absl::Span<Type* const> members);
   ~TupleType() override {}
   std::string ToString() const override;
 
@@ -149,16 +151,11 @@ class TupleType : public Type {
 
   int64_t leaf_count() const override { return leaf_count_; }
 
-  int64_t GetFlatBitCount() const override {
-    int64_t total = 0;
-    for (const Type* type : members_) {
-      total += type->GetFlatBitCount();
-    }
-    return total;
-  }
+  int64_t GetFlatBitCount() const override { return flat_bit_count_; }
 
  private:
   int64_t leaf_count_;
+  int64_t flat_bit_count_;
   std::vector<Type*> members_;
 };
 
@@ -167,8 +164,7 @@ class TupleType : public Type {
 // Note that arrays can be empty.
 class ArrayType : public Type {
  public:
-  explicit ArrayType(int64_t size, Type* element_type)
-      : Type(TypeKind::kArray), size_(size), element_type_(element_type) {}
+  explicit ArrayType(int64_t size, Type* element_type);
   ~ArrayType() override {}
   std::string ToString() const override;
 
@@ -194,7 +190,7 @@ class ArrayType : public Type {
 // Represents a token type used for ordering channel accesses.
 class TokenType : public Type {
  public:
-  explicit TokenType() : Type(TypeKind::kToken) {}
+  explicit TokenType();
   ~TokenType() override {}
   std::string ToString() const override;
 
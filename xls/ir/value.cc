@@ -15,6 +15,8 @@
 #include "xls/ir/value.h"
 
 #include "absl/algorithm/container.h"
+#include "absl/base/call_once.h"
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -26,6 +28,61 @@
 
 namespace xls {
 
+struct Value::PackedArray {
+  PackedArray(int64_t element_bit_count, int64_t size, Bits bits)
+      : element_bit_count(element_bit_count),
+        size(size),
+        bits(std::move(bits)) {}
+
+  int64_t element_bit_count;
+  int64_t size;
+
+  // Element i occupies bits [i * element_bit_count, (i + 1) *
+  // element_bit_count).
+  Bits bits;
+
+  // The elements as boxed Values, created on first use by elements().
+  mutable absl::once_flag boxed_once;
+  mutable std::vector<Value> boxed;
+
+  // The hash of "bits", computed on first use by PackedHash().
+  mutable absl::once_flag hash_once;
+  mutable size_t hash = 0;
+};
+
+namespace {
+
+// Returns whether an array of "elements" (all of the same type) is stored
+// packed.
+bool ShouldPack(absl::Span<const Value> elements) {
+  return elements.size() >= Value::kMinPackedArraySize &&
+         elements.front().IsBits();
+}
+
+// Concatenates the bits of "elements" with element 0 in the least significant
+// bits.
+template <typename T, typename GetBits>
+Bits PackElements(absl::Span<const T> elements, int64_t element_bit_count,
+                  GetBits get_bits) {
+  BitsRope rope(elements.size() * element_bit_count);
+  for (const T& element : elements) {
+    rope.push_back(get_bits(element));
+  }
+  return rope.Build();
+}
+
+}  // namespace
+
+/* static */ Value Value::MakePackedArray(int64_t element_bit_count,
+                                          int64_t size, Bits bits) {
+  XLS_DCHECK_EQ(bits.bit_count(), element_bit_count * size);
+  Value result;
+  result.kind_ = ValueKind::kArray;
+  result.payload_ = std::shared_ptr<const PackedArray>(
+      std::make_shared<PackedArray>(element_bit_count, size, std::move(bits)));
+  return result;
+}
+
 /* static */ absl::StatusOr<Value> Value::Array(
     absl::Span<const Value> elements) {
   if (elements.empty()) {
@@ -36,9 +93,88 @@ namespace xls {
   for (int64_t i = 1; i < elements.size(); ++i) {
     XLS_RET_CHECK(elements[0].SameTypeAs(elements[i]));
   }
+  if (ShouldPack(elements)) {
+    int64_t element_bit_count = elements[0].bits().bit_count();
+    return MakePackedArray(
+        element_bit_count, elements.size(),
+        PackElements(elements, element_bit_count,
+                     [](const Value& v) -> const Bits& { return v.bits(); }));
+  }
   return Value(ValueKind::kArray, elements);
 }
 
+/* static */ Value Value::ArrayOwned(std::vector<Value>&& elements) {
+  XLS_DCHECK(!elements.empty());
+  if (ShouldPack(elements)) {
+    int64_t element_bit_count = elements[0].bits().bit_count();
+    return MakePackedArray(
+        element_bit_count, elements.size(),
+        PackElements(absl::MakeConstSpan(elements), element_bit_count,
+                     [](const Value& v) -> const Bits& { return v.bits(); }));
+  }
+  return Value(ValueKind::kArray, std::move(elements));
+}
+
+/* static */ absl::StatusOr<Value> Value::BitsArray(
+    absl::Span<const Bits> elements) {
+  if (elements.empty()) {
+    return absl::UnimplementedError("Empty array Values are not supported.");
+  }
+  int64_t element_bit_count = elements[0].bit_count();
+  for (const Bits& element : elements) {
+    XLS_RET_CHECK_EQ(element.bit_count(), element_bit_count);
+  }
+  if (elements.size() >= kMinPackedArraySize) {
+    return MakePackedArray(
+        element_bit_count, elements.size(),
+        PackElements(elements, element_bit_count,
+                     [](const Bits& b) -> const Bits& { return b; }));
+  }
+  std::vector<Value> values;
+  values.reserve(elements.size());
+  for (const Bits& element : elements) {
+    values.push_back(Value(element));
+  }
+  return Value(ValueKind::kArray, std::move(values));
+}
+
+int64_t Value::PackedSize() const { return packed().size; }
+
+int64_t Value::PackedElementBitCount() const {
+  return packed().element_bit_count;
+}
+
+const Bits& Value::PackedBits() const { return packed().bits; }
+
+size_t Value::PackedHash() const {
+  const PackedArray& array = packed();
+  absl::call_once(array.hash_once,
+                  [&array]() { array.hash = absl::Hash<Bits>()(array.bits); });
+  return array.hash;
+}
+
+absl::Span<const Value> Value::BoxedElements() const {
+  const PackedArray& packed_array = packed();
+  absl::call_once(packed_array.boxed_once, [&] {
+    packed_array.boxed.reserve(packed_array.size);
+    for (int64_t i = 0; i < packed_array.size; ++i) {
+      packed_array.boxed.push_back(Value(element_bits(i)));
+    }
+  });
+  return packed_array.boxed;
+}
+
+Bits Value::element_bits(int64_t i) const {
+  if (!IsPackedArray()) {
+    return element(i).bits();
+  }
+  const PackedArray& packed_array = packed();
+  XLS_CHECK_GE(i, 0);
+  XLS_CHECK_LT(i, packed_array.size);
+  return packed_array.bits.Slice(i * packed_array.element_bit_count,
+                                 packed_array.element_bit_count);
+}
+
 /* static */ absl::StatusOr<Value> Value::UBitsArray(
     absl::Span<const uint64_t> elements, int64_t bit_count) {
   if (elements.empty()) {
@@ -145,6 +281,9 @@ int64_t Value::GetFlatBitCount() const {
     }
     return total_size;
   } else if (kind() == ValueKind::kArray) {
+    if (IsPackedArray()) {
+      return packed().bits.bit_count();
+    }
     if (empty()) {
       return 0;
     }
@@ -157,6 +296,8 @@ int64_t Value::GetFlatBitCount() const {
 bool Value::IsAllZeros() const {
   if (kind() == ValueKind::kBits) {
     return bits().IsZero();
+  } else if (IsPackedArray()) {
+    return packed().bits.IsZero();
   } else if (kind() == ValueKind::kTuple || kind() == ValueKind::kArray) {
     for (const Value& e : elements()) {
       if (!e.IsAllZeros()) {
@@ -172,6 +313,8 @@ bool Value::IsAllZeros() const {
 bool Value::IsAllOnes() const {
   if (kind() == ValueKind::kBits) {
     return bits().IsAllOnes();
+  } else if (IsPackedArray()) {
+    return packed().bits.IsAllOnes();
   } else if (kind() == ValueKind::kTuple || kind() == ValueKind::kArray) {
     for (const Value& e : elements()) {
       if (!e.IsAllOnes()) {
@@ -220,6 +363,12 @@ void Value::FlattenTo(BitPushBuffer* buffer) const {
       return;
     case ValueKind::kTuple:
     case ValueKind::kArray:
+      if (IsPackedArray()) {
+        for (int64_t i = 0; i < size(); ++i) {
+          element_bits(i).FlattenTo(buffer);
+        }
+        return;
+      }
       for (const Value& element : elements()) {
         element.FlattenTo(buffer);
       }
@@ -232,7 +381,8 @@ void Value::FlattenTo(BitPushBuffer* buffer) const {
 }
 
 absl::StatusOr<std::vector<Value>> Value::GetElements() const {
-  if (!absl::holds_alternative<std::vector<Value>>(payload_)) {
+  if (!absl::holds_alternative<std::vector<Value>>(payload_) &&
+      !IsPackedArray()) {
     return absl::InvalidArgumentError("Value does not hold elements.");
   }
   return std::vector<Value>(elements().begin(), elements().end());
@@ -292,7 +442,21 @@ bool Value::SameTypeAs(const Value& other) const {
       }
       return true;
     case ValueKind::kArray: {
-      return size() == other.size() && element(0).SameTypeAs(other.element(0));
+      if (size() != other.size()) {
+        return false;
+      }
+      if (IsPackedArray() || other.IsPackedArray()) {
+        // Packed elements are bits, so only their widths need comparing.
+        const Value& boxed = IsPackedArray() ? other : *this;
+        const Value& packed_value = IsPackedArray() ? *this : other;
+        int64_t element_bit_count = packed_value.packed().element_bit_count;
+        if (boxed.IsPackedArray()) {
+          return boxed.packed().element_bit_count == element_bit_count;
+        }
+        return boxed.element(0).IsBits() &&
+               boxed.element(0).bits().bit_count() == element_bit_count;
+      }
+      return element(0).SameTypeAs(other.element(0));
     }
     case ValueKind::kToken:
       return true;
@@ -316,6 +480,14 @@ absl::StatusOr<TypeProto> Value::TypeAsProto() const {
       }
       break;
     case ValueKind::kArray: {
+      if (IsPackedArray()) {
+        proto.set_type_enum(TypeProto::ARRAY);
+        proto.set_array_size(size());
+        proto.mutable_array_element()->set_type_enum(TypeProto::BITS);
+        proto.mutable_array_element()->set_bit_count(
+            packed().element_bit_count);
+        break;
+      }
       if (elements().empty()) {
         return absl::InternalError(
             "Cannot determine type of empty array value");
@@ -349,6 +521,15 @@ bool Value::operator==(const Value& other) const {
     return false;
   }
 
+  if (IsPackedArray() && other.IsPackedArray()) {
+    // Copies of a packed array share its storage.
+    if (&packed() == &other.packed()) {
+      return true;
+    }
+    return packed().element_bit_count == other.packed().element_bit_count &&
+           packed().bits == other.packed().bits;
+  }
+
   return absl::c_equal(elements(), other.elements());
 }
 
@@ -15,9 +15,14 @@
 #ifndef XLS_IR_VALUE_H_
 #define XLS_IR_VALUE_H_
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
+#include "xls/common/logging/logging.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/xls_type.pb.h"
 
@@ -33,8 +38,8 @@ enum class ValueKind {
   kTuple,
 
   // Arrays must be homogeneous in their elements, and may choose to use a
-  // more efficient storage mechanism as a result. For now we always used the
-  // boxed Value type, though.
+  // more efficient storage mechanism as a result: large arrays of bits-typed
+  // elements are packed into a single buffer (see Value::IsPackedArray()).
   kArray,
 
   kToken
@@ -55,17 +60,31 @@ inline std::ostream& operator<<(std::ostream& os, ValueKind kind) {
 // some discussion around this, maybe they should be?
 class Value {
  public:
+  // Arrays of bits-typed elements with at least this many elements are stored
+  // packed end to end in a single buffer which is shared between copies of
+  // the Value, rather than as a vector of boxed element Values.
+  static constexpr int64_t kMinPackedArraySize = 64;
+
   static Value Tuple(absl::Span<const Value> elements) {
     return Value(ValueKind::kTuple, elements);
   }
   static Value TupleOwned(std::vector<Value>&& elements) {
-    return Value(ValueKind::kTuple, elements);
+    return Value(ValueKind::kTuple, std::move(elements));
   }
 
   // All members of "elements" must be of the same type, or an error status will
   // be returned.
   static absl::StatusOr<Value> Array(absl::Span<const Value> elements);
 
+  // As above, but takes ownership of "elements" and doesn't check their types;
+  // "elements" must be non-empty and all of the same type.
+  static Value ArrayOwned(std::vector<Value>&& elements);
+
+  // Creates an array of the given bits-typed elements, which must be non-empty
+  // and all of the same width. Unlike Array(), never boxes the elements of
+  // arrays large enough to be packed.
+  static absl::StatusOr<Value> BitsArray(absl::Span<const Bits> elements);
+
   // Shortcut to create an array of bits from an initializer list of literals
   // ex. UBitsArray({1, 2}, 32) will create a Value of type bits[32][2]
   static absl::StatusOr<Value> UBitsArray(absl::Span<const uint64_t> elements,
@@ -105,12 +124,30 @@ class Value {
 
   absl::StatusOr<std::vector<Value>> GetElements() const;
 
+  // Note: for packed arrays the boxed elements are created (once, shared
+  // between copies) on first use of elements() or element(); element_bits()
+  // and size() don't need them.
   absl::Span<const Value> elements() const {
+    if (IsPackedArray()) {
+      return BoxedElements();
+    }
     return absl::get<std::vector<Value>>(payload_);
   }
   const Value& element(int64_t i) const { return elements().at(i); }
-  int64_t size() const { return elements().size(); }
-  bool empty() const { return elements().empty(); }
+  int64_t size() const {
+    return IsPackedArray() ? PackedSize() : elements().size();
+  }
+  bool empty() const { return size() == 0; }
+
+  // Returns whether this is an array whose bits-typed elements are stored
+  // packed in a single buffer.
+  bool IsPackedArray() const {
+    return absl::holds_alternative<std::shared_ptr<const PackedArray>>(
+        payload_);
+  }
+
+  // Returns the bits of element "i" of an array of bits-typed elements.
+  Bits element_bits(int64_t i) const;
 
   // Returns the total number of bits in this value.
   int64_t GetFlatBitCount() const;
@@ -143,6 +180,27 @@ class Value {
   bool operator==(const Value& other) const;
   bool operator!=(const Value& other) const { return !(*this == other); }
 
+  // Equal values hash equally: arrays of the same type are either all packed
+  // or all boxed.
+  template <typename H>
+  friend H AbslHashValue(H h, const Value& value) {
+    h = H::combine(std::move(h), value.kind());
+    if (value.IsBits()) {
+      return H::combine(std::move(h), value.bits());
+    }
+    if (value.IsPackedArray()) {
+      return H::combine(std::move(h), value.PackedElementBitCount(),
+                        value.PackedHash());
+    }
+    if (value.IsTuple() || value.IsArray()) {
+      for (const Value& element : value.elements()) {
+        h = H::combine(std::move(h), element);
+      }
+      h = H::combine(std::move(h), value.size());
+    }
+    return h;
+  }
+
  private:
   Value(ValueKind kind, absl::Span<const Value> elements)
       : kind_(kind),
@@ -151,8 +209,30 @@ class Value {
   Value(ValueKind kind, std::vector<Value>&& elements)
       : kind_(kind), payload_(std::move(elements)) {}
 
+  // Packed storage of an array of bits-typed elements; defined in value.cc.
+  struct PackedArray;
+
+  // Creates a packed array of "size" elements, element i of which is
+  // "bits.Slice(i * element_bit_count, element_bit_count)".
+  static Value MakePackedArray(int64_t element_bit_count, int64_t size,
+                               Bits bits);
+
+  const PackedArray& packed() const {
+    return *absl::get<std::shared_ptr<const PackedArray>>(payload_);
+  }
+  int64_t PackedSize() const;
+  int64_t PackedElementBitCount() const;
+  const Bits& PackedBits() const;
+
+  // Returns the hash of PackedBits(), computed once and shared between copies
+  // of the Value, as large arrays are often used as hash keys.
+  size_t PackedHash() const;
+  absl::Span<const Value> BoxedElements() const;
+
   ValueKind kind_;
-  absl::variant<std::nullptr_t, std::vector<Value>, Bits> payload_;
+  absl::variant<std::nullptr_t, std::vector<Value>, Bits,
+                std::shared_ptr<const PackedArray>>
+      payload_;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Value& value) {
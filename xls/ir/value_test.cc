@@ -14,9 +14,12 @@
 
 #include "xls/ir/value.h"
 
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
+#include "absl/hash/hash.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/package.h"
 
@@ -330,4 +333,58 @@ TEST(ValueTest, XBitsArrayWrongSizes) {
               HasSubstr("elements of arrays should have consistent size."));
 }
 
+TEST(ValueTest, PackedArray) {
+  std::vector<uint64_t> table;
+  std::vector<Value> elements;
+  for (int64_t i = 0; i < Value::kMinPackedArraySize + 3; ++i) {
+    table.push_back((i * 37) % 101);
+    elements.push_back(Value(UBits(table.back(), 7)));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Value packed, Value::UBitsArray(table, 7));
+  EXPECT_TRUE(packed.IsPackedArray());
+  EXPECT_TRUE(packed.IsArray());
+  EXPECT_EQ(packed.size(), table.size());
+  EXPECT_EQ(packed.GetFlatBitCount(), 7 * table.size());
+  for (int64_t i = 0; i < table.size(); ++i) {
+    EXPECT_EQ(packed.element_bits(i), UBits(table[i], 7));
+  }
+
+  // The boxed elements agree with the packed ones.
+  EXPECT_EQ(packed.elements(), absl::MakeConstSpan(elements));
+  EXPECT_EQ(packed.element(5), Value(UBits(table[5], 7)));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> got, packed.GetElements());
+  EXPECT_EQ(got, elements);
+
+  // Copies share the packed storage and compare equal.
+  Value copy = packed;
+  EXPECT_EQ(copy, packed);
+  EXPECT_EQ(absl::Hash<Value>()(copy), absl::Hash<Value>()(packed));
+
+  std::vector<Bits> bits_elements;
+  for (const Value& element : elements) {
+    bits_elements.push_back(element.bits());
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Value from_bits, Value::BitsArray(bits_elements));
+  EXPECT_TRUE(from_bits.IsPackedArray());
+  EXPECT_EQ(from_bits, packed);
+  EXPECT_EQ(absl::Hash<Value>()(from_bits), absl::Hash<Value>()(packed));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Value different, Value::UBitsArray(table, 8));
+  EXPECT_NE(different, packed);
+  EXPECT_FALSE(different.SameTypeAs(packed));
+  XLS_ASSERT_OK_AND_ASSIGN(TypeProto type, packed.TypeAsProto());
+  EXPECT_EQ(type.array_size(), table.size());
+  EXPECT_EQ(type.array_element().bit_count(), 7);
+  EXPECT_THAT(packed.ToString(),
+              testing::StartsWith("[bits[7]:0, bits[7]:37, bits[7]:74, "));
+}
+
+TEST(ValueTest, SmallArraysAreNotPacked) {
+  XLS_ASSERT_OK_AND_ASSIGN(Value array, Value::UBitsArray({1, 2, 3}, 8));
+  EXPECT_FALSE(array.IsPackedArray());
+  EXPECT_EQ(array.element_bits(1), UBits(2, 8));
+  EXPECT_THAT(Value::BitsArray({UBits(1, 8), UBits(1, 9)}).status(),
+              status_testing::StatusIs(absl::StatusCode::kInternal));
+}
+
 }  // namespace xls
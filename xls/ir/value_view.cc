@@ -0,0 +1,107 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/ir/value_view.h"
+
+#include <vector>
+
+#include "xls/data_structures/inline_bitmap.h"
+
+namespace xls {
+namespace {
+
+// Returns the offset of the given element of a tuple or array value along with
+// the element's type.
+std::pair<int64_t, const Type*> GetElement(const Type* type, int64_t index,
+                                           const TypeLayout* layout) {
+  if (type->IsTuple()) {
+    const TupleType* tuple_type = type->AsTupleOrDie();
+    return {layout->GetTupleElementOffset(tuple_type, index),
+            tuple_type->element_type(index)};
+  }
+  const ArrayType* array_type = type->AsArrayOrDie();
+  XLS_DCHECK_LT(index, array_type->size());
+  return {index * layout->GetTypeByteSize(array_type->element_type()),
+          array_type->element_type()};
+}
+
+}  // namespace
+
+ValueView ValueView::element(int64_t index) const {
+  auto [offset, element_type] = GetElement(type_, index, layout_);
+  return ValueView(buffer_ + offset, element_type, layout_);
+}
+
+Bits ValueView::GetBits() const {
+  InlineBitmap bitmap(type_->AsBitsOrDie()->bit_count());
+  for (int64_t i = 0; i < bitmap.byte_count(); ++i) {
+    bitmap.SetByte(i, buffer_[i]);
+  }
+  return Bits::FromBitmap(std::move(bitmap));
+}
+
+Value ValueView::ToValue() const {
+  switch (type_->kind()) {
+    case TypeKind::kBits:
+      return Value(GetBits());
+    case TypeKind::kTuple: {
+      std::vector<Value> elements;
+      elements.reserve(type_->AsTupleOrDie()->size());
+      for (int64_t i = 0; i < type_->AsTupleOrDie()->size(); ++i) {
+        elements.push_back(element(i).ToValue());
+      }
+      return Value::TupleOwned(std::move(elements));
+    }
+    case TypeKind::kArray: {
+      std::vector<Value> elements;
+      elements.reserve(type_->AsArrayOrDie()->size());
+      for (int64_t i = 0; i < type_->AsArrayOrDie()->size(); ++i) {
+        elements.push_back(element(i).ToValue());
+      }
+      return Value::ArrayOrDie(elements);
+    }
+    case TypeKind::kToken:
+      return Value::Token();
+  }
+  XLS_LOG(FATAL) << "Unsupported XLS type kind: " << type_->kind();
+}
+
+MutableValueView MutableValueView::element(int64_t index) const {
+  auto [offset, element_type] = GetElement(type_, index, layout_);
+  return MutableValueView(buffer_ + offset, element_type, layout_);
+}
+
+void MutableValueView::SetBits(const Bits& bits) const {
+  XLS_DCHECK_EQ(bits.bit_count(), type_->AsBitsOrDie()->bit_count());
+  bits.ToBytes(absl::MakeSpan(buffer_, CeilOfRatio(bits.bit_count(), kCharBit)),
+               /*big_endian=*/false);
+}
+
+void MutableValueView::SetValue(const Value& value) const {
+  switch (type_->kind()) {
+    case TypeKind::kBits:
+      SetBits(value.bits());
+      return;
+    case TypeKind::kTuple:
+    case TypeKind::kArray:
+      for (int64_t i = 0; i < value.size(); ++i) {
+        element(i).SetValue(value.element(i));
+      }
+      return;
+    case TypeKind::kToken:
+      return;
+  }
+  XLS_LOG(FATAL) << "Unsupported XLS type kind: " << type_->kind();
+}
+
+}  // namespace xls
@@ -28,8 +28,10 @@
 #include "xls/common/bits_util.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/math_util.h"
+#include "xls/ir/bits.h"
 #include "xls/ir/package.h"
 #include "xls/ir/type.h"
+#include "xls/ir/value.h"
 
 namespace xls {
 
@@ -486,6 +488,76 @@ class PackedTupleView {
   };
 };
 
+// TypeLayout describes how values of arbitrary IR types are placed in flat
+// buffers, e.g., the native layout of JIT-compiled code (see JitRuntime). A
+// bits value occupies the first ceil(bit_count / 8) bytes of its storage in
+// little-endian byte order, with any unused high bits zero. Array elements are
+// stored contiguously at a stride of the element type's byte size. Tokens carry
+// no data. Everything else, in particular the placement of tuple elements and
+// any padding, is up to the layout.
+class TypeLayout {
+ public:
+  virtual ~TypeLayout() = default;
+
+  // Returns the number of bytes of storage for a value of the given type.
+  virtual int64_t GetTypeByteSize(const Type* type) const = 0;
+
+  // Returns the offset in bytes of element 'index' from the start of the
+  // storage of a tuple value.
+  virtual int64_t GetTupleElementOffset(const TupleType* type,
+                                        int64_t index) const = 0;
+};
+
+// ValueView and MutableValueView are the dynamically-typed counterparts of the
+// views above: a buffer paired with the IR type of the value it holds and the
+// TypeLayout it's stored in, for when types aren't known at compile time.
+class ValueView {
+ public:
+  ValueView(const uint8_t* buffer, const Type* type, const TypeLayout* layout)
+      : buffer_(buffer), type_(type), layout_(layout) {}
+
+  const uint8_t* buffer() const { return buffer_; }
+  const Type* type() const { return type_; }
+
+  // Returns a view of the given element of a tuple or array value.
+  ValueView element(int64_t index) const;
+
+  // Returns the contents of a bits value.
+  Bits GetBits() const;
+
+  // Returns a copy of the viewed value.
+  Value ToValue() const;
+
+ private:
+  const uint8_t* buffer_;
+  const Type* type_;
+  const TypeLayout* layout_;
+};
+
+class MutableValueView {
+ public:
+  MutableValueView(uint8_t* buffer, const Type* type, const TypeLayout* layout)
+      : buffer_(buffer), type_(type), layout_(layout) {}
+
+  uint8_t* buffer() const { return buffer_; }
+  const Type* type() const { return type_; }
+
+  MutableValueView element(int64_t index) const;
+
+  // Stores the given bits value, which must be of this view's width.
+  void SetBits(const Bits& bits) const;
+
+  // Stores the given value, which must be of this view's type.
+  void SetValue(const Value& value) const;
+
+  operator ValueView() const { return ValueView(buffer_, type_, layout_); }
+
+ private:
+  uint8_t* buffer_;
+  const Type* type_;
+  const TypeLayout* layout_;
+};
+
 }  // namespace xls
 
 #endif  // XLS_IR_VALUE_VIEW_H_
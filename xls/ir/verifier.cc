@@ -14,6 +14,9 @@
 
 #include "xls/ir/verifier.h"
 
+#include <atomic>
+
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -22,6 +25,7 @@
 #include "xls/common/math_util.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/function.h"
 #include "xls/ir/node.h"
@@ -1175,8 +1179,32 @@ absl::Status VerifyNodeIdUnique(
   return absl::OkStatus();
 }
 
+// Returns true if the given node must be checked when verifying
+// incrementally from the given checkpoint. Nodes which refer to functions or
+// channels are always checked because the objects they refer to may change
+// without the node itself changing.
+bool NeedsVerification(Node* node, absl::optional<int64_t> checkpoint) {
+  if (!checkpoint.has_value() || node->ChangedSince(*checkpoint)) {
+    return true;
+  }
+  switch (node->op()) {
+    case Op::kCountedFor:
+    case Op::kDynamicCountedFor:
+    case Op::kInvoke:
+    case Op::kMap:
+    case Op::kReceive:
+    case Op::kReceiveIf:
+    case Op::kSend:
+    case Op::kSendIf:
+      return true;
+    default:
+      return false;
+  }
+}
+
 // Verify common invariants to procs and functions.
-absl::Status VerifyFunctionOrProc(FunctionBase* function) {
+absl::Status VerifyFunctionOrProc(FunctionBase* function,
+                                  const VerifierOptions& options) {
   XLS_VLOG(2) << absl::StreamFormat("Verifying function %s:\n",
                                     function->name());
   XLS_VLOG_LINES(4, function->DumpIr());
@@ -1195,8 +1223,14 @@ absl::Status VerifyFunctionOrProc(FunctionBase* function) {
   }
 
   // Verify consistency of node::users() and node::operands().
+  absl::optional<int64_t> checkpoint;
+  if (options.checkpoint_key.has_value()) {
+    checkpoint = function->GetCheckpoint(options.checkpoint_key.value());
+  }
   for (Node* node : function->nodes()) {
-    XLS_RETURN_IF_ERROR(VerifyNode(node));
+    if (NeedsVerification(node, checkpoint)) {
+      XLS_RETURN_IF_ERROR(VerifyNode(node));
+    }
   }
 
   // Verify the set of parameter nodes is exactly Function::params(), and that
@@ -1223,6 +1257,9 @@ absl::Status VerifyFunctionOrProc(FunctionBase* function) {
          "function "
       << function->name();
 
+  if (options.checkpoint_key.has_value()) {
+    function->SetCheckpoint(options.checkpoint_key.value());
+  }
   return absl::OkStatus();
 }
 
@@ -1440,19 +1477,124 @@ absl::Status VerifyChannels(Package* package) {
   return absl::OkStatus();
 }
 
+absl::Status VerifyFunctionInternal(Function* function,
+                                    const VerifierOptions& options) {
+  XLS_VLOG(4) << "Verifying function:\n";
+  XLS_VLOG_LINES(4, function->DumpIr());
+
+  XLS_RETURN_IF_ERROR(VerifyFunctionOrProc(function, options));
+
+  for (Node* node : function->nodes()) {
+    if (IsSendOrReceive(node)) {
+      return absl::InternalError(absl::StrFormat(
+          "Send and receive nodes can only be in procs, not functions (%s)",
+          node->GetName()));
+    }
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status VerifyProcInternal(Proc* proc, const VerifierOptions& options) {
+  XLS_VLOG(4) << "Verifying proc:\n";
+  XLS_VLOG_LINES(4, proc->DumpIr());
+
+  XLS_RETURN_IF_ERROR(VerifyFunctionOrProc(proc, options));
+
+  // A Proc should have two parameters: a token (parameter 0), and the recurent
+  // state (parameter 1).
+  XLS_RET_CHECK_EQ(proc->params().size(), 2) << absl::StreamFormat(
+      "Proc %s does not have two parameters", proc->name());
+
+  XLS_RET_CHECK_EQ(proc->param(0), proc->TokenParam());
+  XLS_RET_CHECK_EQ(proc->param(0)->GetType(), proc->package()->GetTokenType())
+      << absl::StreamFormat("Parameter 0 of a proc %s is not token type, is %s",
+                            proc->name(),
+                            proc->param(1)->GetType()->ToString());
+
+  XLS_RET_CHECK_EQ(proc->param(1), proc->StateParam());
+  XLS_RET_CHECK_EQ(proc->param(1)->GetType(), proc->StateType())
+      << absl::StreamFormat(
+             "Parameter 1 of a proc %s does not match state type %s, is %s",
+             proc->name(), proc->StateType()->ToString(),
+             proc->param(1)->GetType()->ToString());
+
+  // Next token must be token type.
+  XLS_RET_CHECK(proc->NextToken()->GetType()->IsToken());
+
+  // Next state must be state type.
+  XLS_RET_CHECK_EQ(proc->NextState()->GetType(), proc->StateType());
+
+  // Verify that all send/receive nodes are connected to the token parameter and
+  // the return value via paths of tokens.
+  XLS_RETURN_IF_ERROR(VerifyTokenConnectivity(proc));
+
+  return absl::OkStatus();
+}
+
+absl::Status VerifyFunctionBase(FunctionBase* function_base,
+                                const VerifierOptions& options) {
+  if (function_base->IsProc()) {
+    return VerifyProcInternal(function_base->AsProcOrDie(), options);
+  }
+  return VerifyFunctionInternal(function_base->AsFunctionOrDie(), options);
+}
+
+// Verifies the given functions and procs using up to options.parallelism
+// threads. Returns the error of the first invalid one in the given order.
+absl::Status VerifyFunctionBases(
+    absl::Span<FunctionBase* const> function_bases,
+    const VerifierOptions& options) {
+  int64_t thread_count =
+      std::min<int64_t>(options.parallelism, function_bases.size());
+  if (thread_count <= 1) {
+    for (FunctionBase* function_base : function_bases) {
+      XLS_RETURN_IF_ERROR(VerifyFunctionBase(function_base, options));
+    }
+    return absl::OkStatus();
+  }
+
+  // Indices are claimed in increasing order, so once an error is found no
+  // function after it needs to be verified: every earlier function has
+  // already been claimed and its status is reported first if it failed too.
+  std::vector<absl::Status> statuses(function_bases.size());
+  std::atomic<int64_t> next_index(0);
+  std::atomic<bool> failed(false);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < thread_count; ++i) {
+      threads.push_back(absl::make_unique<Thread>([&]() {
+        for (int64_t j = next_index++; j < function_bases.size() && !failed;
+             j = next_index++) {
+          statuses[j] = VerifyFunctionBase(function_bases[j], options);
+          if (!statuses[j].ok()) {
+            failed = true;
+          }
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+  for (const absl::Status& status : statuses) {
+    XLS_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::Status VerifyPackage(Package* package) {
+  return VerifyPackage(package, VerifierOptions());
+}
+
+absl::Status VerifyPackage(Package* package, const VerifierOptions& options) {
   XLS_VLOG(4) << absl::StreamFormat("Verifying package %s:\n", package->name());
   XLS_VLOG_LINES(4, package->DumpIr());
 
-  for (auto& function : package->functions()) {
-    XLS_RETURN_IF_ERROR(VerifyFunction(function.get()));
-  }
-
-  for (auto& proc : package->procs()) {
-    XLS_RETURN_IF_ERROR(VerifyProc(proc.get()));
-  }
+  XLS_RETURN_IF_ERROR(
+      VerifyFunctionBases(package->GetFunctionsAndProcs(), options));
 
   // Verify node IDs are unique within the package and uplinks point to this
   // package.
@@ -1500,57 +1642,11 @@ absl::Status VerifyPackage(Package* package) {
 }
 
 absl::Status VerifyFunction(Function* function) {
-  XLS_VLOG(4) << "Verifying function:\n";
-  XLS_VLOG_LINES(4, function->DumpIr());
-
-  XLS_RETURN_IF_ERROR(VerifyFunctionOrProc(function));
-
-  for (Node* node : function->nodes()) {
-    if (IsSendOrReceive(node)) {
-      return absl::InternalError(absl::StrFormat(
-          "Send and receive nodes can only be in procs, not functions (%s)",
-          node->GetName()));
-    }
-  }
-
-  return absl::OkStatus();
+  return VerifyFunctionInternal(function, VerifierOptions());
 }
 
 absl::Status VerifyProc(Proc* proc) {
-  XLS_VLOG(4) << "Verifying proc:\n";
-  XLS_VLOG_LINES(4, proc->DumpIr());
-
-  XLS_RETURN_IF_ERROR(VerifyFunctionOrProc(proc));
-
-  // A Proc should have two parameters: a token (parameter 0), and the recurent
-  // state (parameter 1).
-  XLS_RET_CHECK_EQ(proc->params().size(), 2) << absl::StreamFormat(
-      "Proc %s does not have two parameters", proc->name());
-
-  XLS_RET_CHECK_EQ(proc->param(0), proc->TokenParam());
-  XLS_RET_CHECK_EQ(proc->param(0)->GetType(), proc->package()->GetTokenType())
-      << absl::StreamFormat("Parameter 0 of a proc %s is not token type, is %s",
-                            proc->name(),
-                            proc->param(1)->GetType()->ToString());
-
-  XLS_RET_CHECK_EQ(proc->param(1), proc->StateParam());
-  XLS_RET_CHECK_EQ(proc->param(1)->GetType(), proc->StateType())
-      << absl::StreamFormat(
-             "Parameter 1 of a proc %s does not match state type %s, is %s",
-             proc->name(), proc->StateType()->ToString(),
-             proc->param(1)->GetType()->ToString());
-
-  // Next token must be token type.
-  XLS_RET_CHECK(proc->NextToken()->GetType()->IsToken());
-
-  // Next state must be state type.
-  XLS_RET_CHECK_EQ(proc->NextState()->GetType(), proc->StateType());
-
-  // Verify that all send/receive nodes are connected to the token parameter and
-  // the return value via paths of tokens.
-  XLS_RETURN_IF_ERROR(VerifyTokenConnectivity(proc));
-
-  return absl::OkStatus();
+  return VerifyProcInternal(proc, VerifierOptions());
 }
 
 absl::Status VerifyNode(Node* node) {
@@ -15,7 +15,10 @@
 #ifndef XLS_IR_VERIFIER_H_
 #define XLS_IR_VERIFIER_H_
 
+#include <cstdint>
+
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
 
 namespace xls {
 
@@ -24,9 +27,25 @@ class Function;
 class Proc;
 class Package;
 
+// Options which control how the verifier runs.
+struct VerifierOptions {
+  // The maximum number of functions and procs verified concurrently. If an
+  // error is found, the error reported is the one for the first invalid
+  // function or proc in package order regardless of this value.
+  int64_t parallelism = 1;
+
+  // If present, the verifier records a checkpoint (see
+  // FunctionBase::SetCheckpoint) under this key on each function and proc it
+  // verifies, and on later calls with the same key only re-checks the nodes
+  // which changed since the checkpoint. Function-, proc- and package-level
+  // invariants are always checked in full.
+  absl::optional<int64_t> checkpoint_key;
+};
+
 // Verifies numerous invariants of the IR for the given package. Returns a
 // error status if a violation is found.
 absl::Status VerifyPackage(Package* package);
+absl::Status VerifyPackage(Package* package, const VerifierOptions& options);
 
 // Overload for Procs.
 absl::Status VerifyProc(Proc* Proc);
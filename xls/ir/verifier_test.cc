@@ -112,6 +112,65 @@ fn graph(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
                                  "bits[42], has type bits[2].")));
 }
 
+TEST_F(VerifierTest, ParallelVerificationReportsFirstError) {
+  std::string input = R"(
+package ParallelVerification
+
+fn f0(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
+  ret and.1: bits[42] = and(q, r)
+}
+
+fn f1(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
+  ret and.2: bits[42] = and(q, r)
+}
+
+fn f2(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
+  ret and.3: bits[42] = and(q, r)
+}
+
+fn f3(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
+  ret and.4: bits[42] = and(q, r)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, ParsePackageNoVerify(input));
+  VerifierOptions options;
+  options.parallelism = 4;
+  XLS_ASSERT_OK(VerifyPackage(p.get(), options));
+
+  for (const char* name : {"f1", "f3"}) {
+    XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction(name));
+    f->return_value()->ReplaceOperand(FindNode("q", f), FindNode("p", f));
+  }
+  EXPECT_THAT(VerifyPackage(p.get(), options),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Expected operand 0 of and.2 to have type "
+                                 "bits[42], has type bits[2].")));
+}
+
+TEST_F(VerifierTest, IncrementalVerificationChecksChangedNodes) {
+  std::string input = R"(
+package IncrementalVerification
+
+fn graph(p: bits[2], q: bits[42], r: bits[42]) -> bits[42] {
+  and.1: bits[42] = and(q, r)
+  ret or.2: bits[42] = or(and.1, r)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, ParsePackageNoVerify(input));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("graph"));
+  VerifierOptions options;
+  options.checkpoint_key = FunctionBase::NewCheckpointKey();
+  XLS_ASSERT_OK(VerifyPackage(p.get(), options));
+  EXPECT_EQ(f->GetCheckpoint(*options.checkpoint_key), f->change_count());
+  XLS_ASSERT_OK(VerifyPackage(p.get(), options));
+
+  FindNode("and.1", f)->ReplaceOperand(FindNode("q", f), FindNode("p", f));
+  EXPECT_THAT(VerifyPackage(p.get(), options),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Expected operand 0 of and.1 to have type "
+                                 "bits[42], has type bits[2].")));
+}
+
 TEST_F(VerifierTest, SelectWithUselessDefault) {
   std::string input = R"(
 package p
@@ -0,0 +1,154 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiles an XLS IR function ahead of time into an object file, along with a
+// wrapper class (in the style of jit_wrapper_generator_main's) for calling it.
+// Binaries linking the object and wrapper don't depend on LLVM or the JIT.
+
+#include <filesystem>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/jit/jit_wrapper_generator.h"
+
+ABSL_FLAG(std::string, class_name, "",
+          "Name of the generated class. "
+          "If unspecified, the camelized function name will be used.");
+ABSL_FLAG(std::string, function, "",
+          "Function to compile. "
+          "If unspecified, the package entry function will be used.");
+ABSL_FLAG(std::string, ir_path, "", "Path to the IR to compile.");
+ABSL_FLAG(std::string, output_name, "",
+          "Name of the generated files, foo.h, foo.cc and foo.o. "
+          "If unspecified, the function name will be used.");
+ABSL_FLAG(std::string, output_dir, "",
+          "Directory into which to write the output.");
+ABSL_FLAG(std::string, genfiles_dir, "",
+          "The directory into which generated files are placed. "
+          "This prefix will be removed from the header guards.");
+ABSL_FLAG(std::string, symbol, "",
+          "Name of the entry point symbol defined by the object. If "
+          "unspecified, it is derived from the package and function names.");
+ABSL_FLAG(int64_t, opt_level, 3, "LLVM optimization level, from 0 to 3.");
+
+namespace xls {
+namespace {
+
+std::string Camelize(absl::string_view input) {
+  std::vector<std::string> pieces =
+      absl::StrSplit(input, absl::ByAnyChar("-_"));
+  for (std::string& piece : pieces) {
+    piece[0] = toupper(piece[0]);
+  }
+  return absl::StrJoin(pieces, "");
+}
+
+// Returns "name" with every character which can't appear in a C identifier
+// replaced by an underscore.
+std::string ToIdentifier(absl::string_view name) {
+  std::string identifier(name);
+  for (char& c : identifier) {
+    if (!absl::ascii_isalnum(c)) {
+      c = '_';
+    }
+  }
+  return identifier;
+}
+
+}  // namespace
+
+absl::Status RealMain(const std::filesystem::path& ir_path,
+                      const std::filesystem::path& output_path,
+                      const std::filesystem::path& genfiles_dir,
+                      std::string class_name, std::string output_name,
+                      std::string function_name, std::string symbol,
+                      int64_t opt_level) {
+  XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
+  XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
+
+  Function* function;
+  std::string package_prefix = absl::StrCat("__", package->name(), "__");
+  if (function_name.empty()) {
+    XLS_ASSIGN_OR_RETURN(function, package->EntryFunction());
+    function_name = absl::StripPrefix(function->name(), package_prefix);
+  } else {
+    // Apply the package prefix if not already there.
+    if (!absl::StartsWith(function_name, package_prefix)) {
+      function_name = absl::StrCat(package_prefix, function_name);
+    }
+    XLS_ASSIGN_OR_RETURN(function, package->GetFunction(function_name));
+    function_name = absl::StripPrefix(function_name, package_prefix);
+  }
+
+  if (class_name.empty()) {
+    class_name = function_name;
+  }
+  class_name = Camelize(class_name);
+  if (symbol.empty()) {
+    symbol = absl::StrCat("xls_aot_", ToIdentifier(package->name()), "_",
+                          ToIdentifier(function_name));
+  }
+  if (output_name.empty()) {
+    output_name = function_name;
+  }
+
+  XLS_ASSIGN_OR_RETURN(std::string object,
+                       IrJit::CompileToObject(function, symbol, opt_level));
+  std::filesystem::path object_path = output_path;
+  object_path.append(absl::StrCat(output_name, ".o"));
+  XLS_RETURN_IF_ERROR(SetFileContents(object_path, object));
+
+  std::filesystem::path header_path = output_path;
+  header_path.append(absl::StrCat(output_name, ".h"));
+  GeneratedJitWrapper wrapper = GenerateAotWrapper(
+      *function, class_name, symbol, header_path, genfiles_dir);
+  XLS_RETURN_IF_ERROR(SetFileContents(header_path, wrapper.header));
+
+  std::filesystem::path source_path = output_path;
+  source_path.append(absl::StrCat(output_name, ".cc"));
+  XLS_RETURN_IF_ERROR(SetFileContents(source_path, wrapper.source));
+
+  return absl::OkStatus();
+}
+
+}  // namespace xls
+
+int main(int argc, char* argv[]) {
+  xls::InitXls(argv[0], argc, argv);
+
+  std::string ir_path = absl::GetFlag(FLAGS_ir_path);
+  XLS_QCHECK(!ir_path.empty()) << "-ir_path must be specified!";
+
+  std::string output_dir = absl::GetFlag(FLAGS_output_dir);
+  XLS_QCHECK(!output_dir.empty()) << "-output_dir must be specified!";
+
+  XLS_QCHECK_OK(xls::RealMain(
+      ir_path, output_dir, absl::GetFlag(FLAGS_genfiles_dir),
+      absl::GetFlag(FLAGS_class_name), absl::GetFlag(FLAGS_output_name),
+      absl::GetFlag(FLAGS_function), absl::GetFlag(FLAGS_symbol),
+      absl::GetFlag(FLAGS_opt_level)));
+
+  return 0;
+}
@@ -0,0 +1,638 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/bit_sliced_jit.h"
+
+#include <algorithm>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "llvm/include/llvm/IR/Constants.h"
+#include "llvm/include/llvm/IR/DerivedTypes.h"
+#include "llvm/include/llvm/IR/IRBuilder.h"
+#include "llvm/include/llvm/IR/Module.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/dfs_visitor.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/value_helpers.h"
+
+namespace xls {
+namespace {
+
+// The bit-sliced form of an XLS value: one lane word per flat bit. Bits values
+// are ordered LSb first; tuple elements are laid out back-to-back, element 0
+// first.
+using Slices = std::vector<llvm::Value*>;
+
+// Appends the bit-sliced constant form of "value" to "slices".
+void AppendConstantSlices(const Value& value, llvm::Constant* zero,
+                          llvm::Constant* ones, Slices* slices) {
+  if (value.IsBits()) {
+    for (int64_t i = 0; i < value.bits().bit_count(); ++i) {
+      slices->push_back(value.bits().Get(i) ? ones : zero);
+    }
+    return;
+  }
+  for (const Value& element : value.elements()) {
+    AppendConstantSlices(element, zero, ones, slices);
+  }
+}
+
+// Visitor which emits bit-sliced LLVM IR for each XLS node.
+class BitSlicedBuilder : public DfsVisitorWithDefault {
+ public:
+  BitSlicedBuilder(llvm::Function* llvm_fn, llvm::Type* word_type)
+      : llvm_fn_(llvm_fn),
+        word_type_(word_type),
+        zero_(llvm::Constant::getNullValue(word_type)),
+        ones_(llvm::Constant::getAllOnesValue(word_type)) {
+    llvm::BasicBlock* block = llvm::BasicBlock::Create(
+        llvm_fn->getContext(), "entry", llvm_fn, /*InsertBefore=*/nullptr);
+    builder_ = std::make_unique<llvm::IRBuilder<>>(block);
+  }
+
+  absl::Status Build(Function* f) {
+    XLS_RETURN_IF_ERROR(f->Accept(this));
+    llvm::Value* output = llvm_fn_->getArg(1);
+    const Slices& result = slices_.at(f->return_value());
+    for (int64_t i = 0; i < result.size(); ++i) {
+      builder_->CreateAlignedStore(result[i], SlicePointer(output, i),
+                                   llvm::Align(8));
+    }
+    builder_->CreateRetVoid();
+    return absl::OkStatus();
+  }
+
+  absl::Status DefaultHandler(Node* node) override {
+    return absl::UnimplementedError(
+        absl::StrCat("Unsupported node for bit-sliced evaluation: ",
+                     node->ToString()));
+  }
+
+  absl::Status HandleParam(Param* param) override {
+    XLS_ASSIGN_OR_RETURN(int64_t index,
+                         param->function_base()->GetParamIndex(param));
+    llvm::Type* i8_ptr_type = builder_->getInt8PtrTy();
+    llvm::Value* buffer = builder_->CreateLoad(
+        i8_ptr_type,
+        builder_->CreateGEP(i8_ptr_type, llvm_fn_->getArg(0),
+                            builder_->getInt64(index)));
+    Slices slices(param->BitCountOrDie());
+    for (int64_t i = 0; i < slices.size(); ++i) {
+      slices[i] = builder_->CreateAlignedLoad(
+          word_type_, SlicePointer(buffer, i), llvm::Align(8));
+    }
+    return Store(param, std::move(slices));
+  }
+
+  absl::Status HandleLiteral(Literal* literal) override {
+    if (literal->value().IsToken() ||
+        !TypeHasNoArrays(literal->GetType())) {
+      return DefaultHandler(literal);
+    }
+    Slices slices;
+    AppendConstantSlices(literal->value(), zero_, ones_, &slices);
+    return Store(literal, std::move(slices));
+  }
+
+  absl::Status HandleIdentity(UnOp* identity) override {
+    return Store(identity, Get(identity->operand(0)));
+  }
+
+  absl::Status HandleNot(UnOp* not_op) override {
+    Slices result;
+    for (llvm::Value* slice : Get(not_op->operand(0))) {
+      result.push_back(Not(slice));
+    }
+    return Store(not_op, std::move(result));
+  }
+
+  absl::Status HandleNaryAnd(NaryOp* op) override {
+    return Store(op, Nary(op, llvm::Instruction::And, /*invert=*/false));
+  }
+  absl::Status HandleNaryNand(NaryOp* op) override {
+    return Store(op, Nary(op, llvm::Instruction::And, /*invert=*/true));
+  }
+  absl::Status HandleNaryOr(NaryOp* op) override {
+    return Store(op, Nary(op, llvm::Instruction::Or, /*invert=*/false));
+  }
+  absl::Status HandleNaryNor(NaryOp* op) override {
+    return Store(op, Nary(op, llvm::Instruction::Or, /*invert=*/true));
+  }
+  absl::Status HandleNaryXor(NaryOp* op) override {
+    return Store(op, Nary(op, llvm::Instruction::Xor, /*invert=*/false));
+  }
+
+  absl::Status HandleAndReduce(BitwiseReductionOp* op) override {
+    return Store(op, {Reduce(Get(op->operand(0)), llvm::Instruction::And)});
+  }
+  absl::Status HandleOrReduce(BitwiseReductionOp* op) override {
+    return Store(op, {Reduce(Get(op->operand(0)), llvm::Instruction::Or)});
+  }
+  absl::Status HandleXorReduce(BitwiseReductionOp* op) override {
+    return Store(op, {Reduce(Get(op->operand(0)), llvm::Instruction::Xor)});
+  }
+
+  absl::Status HandleBitSlice(BitSlice* bit_slice) override {
+    const Slices& input = Get(bit_slice->operand(0));
+    auto start = input.begin() + bit_slice->start();
+    return Store(bit_slice, Slices(start, start + bit_slice->width()));
+  }
+
+  absl::Status HandleConcat(Concat* concat) override {
+    // Operand 0 holds the most significant bits.
+    Slices result;
+    for (int64_t i = concat->operand_count() - 1; i >= 0; --i) {
+      const Slices& operand = Get(concat->operand(i));
+      result.insert(result.end(), operand.begin(), operand.end());
+    }
+    return Store(concat, std::move(result));
+  }
+
+  absl::Status HandleReverse(UnOp* reverse) override {
+    Slices result = Get(reverse->operand(0));
+    std::reverse(result.begin(), result.end());
+    return Store(reverse, std::move(result));
+  }
+
+  absl::Status HandleZeroExtend(ExtendOp* zero_ext) override {
+    Slices result = Get(zero_ext->operand(0));
+    result.resize(zero_ext->new_bit_count(), zero_);
+    return Store(zero_ext, std::move(result));
+  }
+
+  absl::Status HandleSignExtend(ExtendOp* sign_ext) override {
+    Slices result = Get(sign_ext->operand(0));
+    llvm::Value* sign = result.empty() ? zero_ : result.back();
+    result.resize(sign_ext->new_bit_count(), sign);
+    return Store(sign_ext, std::move(result));
+  }
+
+  absl::Status HandleEq(CompareOp* eq) override {
+    return Store(eq, {Equal(Get(eq->operand(0)), Get(eq->operand(1)))});
+  }
+  absl::Status HandleNe(CompareOp* ne) override {
+    return Store(ne, {Not(Equal(Get(ne->operand(0)), Get(ne->operand(1))))});
+  }
+
+  absl::Status HandleULt(CompareOp* lt) override {
+    return Store(lt, {LessThan(Get(lt->operand(0)), Get(lt->operand(1)))});
+  }
+  absl::Status HandleUGt(CompareOp* gt) override {
+    return Store(gt, {LessThan(Get(gt->operand(1)), Get(gt->operand(0)))});
+  }
+  absl::Status HandleULe(CompareOp* le) override {
+    return Store(le,
+                 {Not(LessThan(Get(le->operand(1)), Get(le->operand(0))))});
+  }
+  absl::Status HandleUGe(CompareOp* ge) override {
+    return Store(ge,
+                 {Not(LessThan(Get(ge->operand(0)), Get(ge->operand(1))))});
+  }
+
+  // Signed comparisons are unsigned comparisons with the sign bits flipped.
+  absl::Status HandleSLt(CompareOp* lt) override {
+    return Store(lt, {LessThan(FlipSign(Get(lt->operand(0))),
+                               FlipSign(Get(lt->operand(1))))});
+  }
+  absl::Status HandleSGt(CompareOp* gt) override {
+    return Store(gt, {LessThan(FlipSign(Get(gt->operand(1))),
+                               FlipSign(Get(gt->operand(0))))});
+  }
+  absl::Status HandleSLe(CompareOp* le) override {
+    return Store(le, {Not(LessThan(FlipSign(Get(le->operand(1))),
+                                   FlipSign(Get(le->operand(0)))))});
+  }
+  absl::Status HandleSGe(CompareOp* ge) override {
+    return Store(ge, {Not(LessThan(FlipSign(Get(ge->operand(0))),
+                                   FlipSign(Get(ge->operand(1)))))});
+  }
+
+  absl::Status HandleAdd(BinOp* add) override {
+    return Store(add, Add(Get(add->operand(0)), Get(add->operand(1)), zero_));
+  }
+
+  // a - b == a + ~b + 1.
+  absl::Status HandleSub(BinOp* sub) override {
+    Slices inverted;
+    for (llvm::Value* slice : Get(sub->operand(1))) {
+      inverted.push_back(Not(slice));
+    }
+    return Store(sub, Add(Get(sub->operand(0)), inverted, ones_));
+  }
+
+  absl::Status HandleNeg(UnOp* neg) override {
+    Slices inverted;
+    for (llvm::Value* slice : Get(neg->operand(0))) {
+      inverted.push_back(Not(slice));
+    }
+    Slices zeros(inverted.size(), zero_);
+    return Store(neg, Add(zeros, inverted, ones_));
+  }
+
+  // Shift-and-add multiplication, truncated to the result width.
+  absl::Status HandleUMul(ArithOp* mul) override {
+    int64_t width = mul->BitCountOrDie();
+    Slices lhs = Get(mul->operand(0));
+    lhs.resize(width, zero_);
+    const Slices& rhs = Get(mul->operand(1));
+    Slices result(width, zero_);
+    for (int64_t j = 0; j < std::min<int64_t>(rhs.size(), width); ++j) {
+      Slices partial(width, zero_);
+      for (int64_t i = j; i < width; ++i) {
+        partial[i] = builder_->CreateAnd(lhs[i - j], rhs[j]);
+      }
+      result = Add(result, partial, zero_);
+    }
+    return Store(mul, std::move(result));
+  }
+
+  absl::Status HandleShll(BinOp* shll) override {
+    return Store(shll, Shift(Get(shll->operand(0)), Get(shll->operand(1)),
+                             /*left=*/true, /*fill=*/zero_));
+  }
+  absl::Status HandleShrl(BinOp* shrl) override {
+    return Store(shrl, Shift(Get(shrl->operand(0)), Get(shrl->operand(1)),
+                             /*left=*/false, /*fill=*/zero_));
+  }
+  absl::Status HandleShra(BinOp* shra) override {
+    const Slices& input = Get(shra->operand(0));
+    llvm::Value* sign = input.empty() ? zero_ : input.back();
+    return Store(shra, Shift(input, Get(shra->operand(1)),
+                             /*left=*/false, /*fill=*/sign));
+  }
+
+  absl::Status HandleSel(Select* sel) override {
+    if (!TypeHasNoArrays(sel->GetType())) {
+      return DefaultHandler(sel);
+    }
+    const Slices& selector = Get(sel->selector());
+    Slices result(sel->GetType()->GetFlatBitCount(), zero_);
+    llvm::Value* any_match = zero_;
+    for (int64_t c = 0; c < sel->cases().size(); ++c) {
+      // The lanes in which the selector equals c.
+      llvm::Value* match = ones_;
+      for (int64_t b = 0; b < selector.size(); ++b) {
+        llvm::Value* bit = selector[b];
+        bool bit_set = b < 63 && ((c >> b) & 1);
+        match = builder_->CreateAnd(match, bit_set ? bit : Not(bit));
+      }
+      any_match = builder_->CreateOr(any_match, match);
+      result = Merge(result, Get(sel->get_case(c)), match);
+    }
+    if (sel->default_value().has_value()) {
+      result =
+          Merge(result, Get(sel->default_value().value()), Not(any_match));
+    }
+    return Store(sel, std::move(result));
+  }
+
+  absl::Status HandleOneHotSel(OneHotSelect* sel) override {
+    if (!TypeHasNoArrays(sel->GetType())) {
+      return DefaultHandler(sel);
+    }
+    const Slices& selector = Get(sel->selector());
+    Slices result(sel->GetType()->GetFlatBitCount(), zero_);
+    for (int64_t c = 0; c < sel->cases().size(); ++c) {
+      result = Merge(result, Get(sel->get_case(c)), selector[c]);
+    }
+    return Store(sel, std::move(result));
+  }
+
+  absl::Status HandleTuple(Tuple* tuple) override {
+    if (!TypeHasNoArrays(tuple->GetType())) {
+      return DefaultHandler(tuple);
+    }
+    Slices result;
+    for (Node* operand : tuple->operands()) {
+      const Slices& element = Get(operand);
+      result.insert(result.end(), element.begin(), element.end());
+    }
+    return Store(tuple, std::move(result));
+  }
+
+  absl::Status HandleTupleIndex(TupleIndex* index) override {
+    TupleType* tuple_type = index->operand(0)->GetType()->AsTupleOrDie();
+    int64_t offset = 0;
+    for (int64_t i = 0; i < index->index(); ++i) {
+      offset += tuple_type->element_type(i)->GetFlatBitCount();
+    }
+    const Slices& input = Get(index->operand(0));
+    auto start = input.begin() + offset;
+    return Store(index,
+                 Slices(start, start + index->GetType()->GetFlatBitCount()));
+  }
+
+ private:
+  static bool TypeHasNoArrays(Type* type) {
+    if (type->IsArray() || type->IsToken()) {
+      return false;
+    }
+    if (type->IsTuple()) {
+      for (Type* element : type->AsTupleOrDie()->element_types()) {
+        if (!TypeHasNoArrays(element)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  const Slices& Get(Node* node) { return slices_.at(node); }
+
+  absl::Status Store(Node* node, Slices slices) {
+    XLS_RET_CHECK_EQ(slices.size(), node->GetType()->GetFlatBitCount())
+        << node->ToString();
+    slices_[node] = std::move(slices);
+    return absl::OkStatus();
+  }
+
+  // Returns a pointer to the i'th slice of the given i8* buffer.
+  llvm::Value* SlicePointer(llvm::Value* buffer, int64_t i) {
+    llvm::Value* words = builder_->CreateBitCast(
+        buffer, llvm::PointerType::get(word_type_, /*AddressSpace=*/0));
+    return builder_->CreateGEP(word_type_, words, builder_->getInt64(i));
+  }
+
+  llvm::Value* Not(llvm::Value* value) {
+    return builder_->CreateXor(value, ones_);
+  }
+
+  Slices Nary(NaryOp* op, llvm::Instruction::BinaryOps opcode, bool invert) {
+    Slices result = Get(op->operand(0));
+    for (int64_t i = 1; i < op->operand_count(); ++i) {
+      const Slices& operand = Get(op->operand(i));
+      for (int64_t b = 0; b < result.size(); ++b) {
+        result[b] = builder_->CreateBinOp(opcode, result[b], operand[b]);
+      }
+    }
+    if (invert) {
+      for (llvm::Value*& slice : result) {
+        slice = Not(slice);
+      }
+    }
+    return result;
+  }
+
+  llvm::Value* Reduce(const Slices& input,
+                      llvm::Instruction::BinaryOps opcode) {
+    if (input.empty()) {
+      return opcode == llvm::Instruction::And ? ones_ : zero_;
+    }
+    llvm::Value* result = input[0];
+    for (int64_t i = 1; i < input.size(); ++i) {
+      result = builder_->CreateBinOp(opcode, result, input[i]);
+    }
+    return result;
+  }
+
+  llvm::Value* Equal(const Slices& lhs, const Slices& rhs) {
+    llvm::Value* result = ones_;
+    for (int64_t i = 0; i < lhs.size(); ++i) {
+      result =
+          builder_->CreateAnd(result, Not(builder_->CreateXor(lhs[i], rhs[i])));
+    }
+    return result;
+  }
+
+  // Computes the borrow out of lhs - rhs, i.e., the lanes where lhs < rhs
+  // (unsigned).
+  llvm::Value* LessThan(const Slices& lhs, const Slices& rhs) {
+    llvm::Value* borrow = zero_;
+    for (int64_t i = 0; i < lhs.size(); ++i) {
+      llvm::Value* differ = builder_->CreateXor(lhs[i], rhs[i]);
+      borrow = builder_->CreateOr(
+          builder_->CreateAnd(Not(lhs[i]), rhs[i]),
+          builder_->CreateAnd(Not(differ), borrow));
+    }
+    return borrow;
+  }
+
+  Slices FlipSign(Slices input) {
+    if (!input.empty()) {
+      input.back() = Not(input.back());
+    }
+    return input;
+  }
+
+  // Ripple-carry addition of two equal-width values.
+  Slices Add(const Slices& lhs, const Slices& rhs, llvm::Value* carry) {
+    Slices result(lhs.size());
+    for (int64_t i = 0; i < lhs.size(); ++i) {
+      llvm::Value* partial = builder_->CreateXor(lhs[i], rhs[i]);
+      result[i] = builder_->CreateXor(partial, carry);
+      carry = builder_->CreateOr(builder_->CreateAnd(lhs[i], rhs[i]),
+                                 builder_->CreateAnd(partial, carry));
+    }
+    return result;
+  }
+
+  // Returns "current" with the lanes selected by "mask" OR'd with "value".
+  // Used to build selects from mutually exclusive lane masks.
+  Slices Merge(const Slices& current, const Slices& value, llvm::Value* mask) {
+    Slices result(current.size());
+    for (int64_t i = 0; i < current.size(); ++i) {
+      result[i] =
+          builder_->CreateOr(current[i], builder_->CreateAnd(value[i], mask));
+    }
+    return result;
+  }
+
+  // Logarithmic barrel shifter: stage k conditionally shifts by 2^k in the
+  // lanes where bit k of the shift amount is set. Any set amount bit whose
+  // weight is at least the input width shifts everything out.
+  Slices Shift(const Slices& input, const Slices& amount, bool left,
+               llvm::Value* fill) {
+    int64_t width = input.size();
+    Slices result = input;
+    llvm::Value* overflow = zero_;
+    for (int64_t k = 0; k < amount.size(); ++k) {
+      if (k >= 63 || (int64_t{1} << k) >= width) {
+        overflow = builder_->CreateOr(overflow, amount[k]);
+        continue;
+      }
+      int64_t distance = int64_t{1} << k;
+      Slices shifted(width);
+      for (int64_t i = 0; i < width; ++i) {
+        int64_t source = left ? i - distance : i + distance;
+        llvm::Value* moved =
+            (source >= 0 && source < width) ? result[source] : fill;
+        shifted[i] = builder_->CreateOr(
+            builder_->CreateAnd(amount[k], moved),
+            builder_->CreateAnd(Not(amount[k]), result[i]));
+      }
+      result = std::move(shifted);
+    }
+    for (int64_t i = 0; i < width; ++i) {
+      result[i] =
+          builder_->CreateOr(builder_->CreateAnd(overflow, fill),
+                             builder_->CreateAnd(Not(overflow), result[i]));
+    }
+    return result;
+  }
+
+  llvm::Function* llvm_fn_;
+  llvm::Type* word_type_;
+  llvm::Constant* zero_;
+  llvm::Constant* ones_;
+  std::unique_ptr<llvm::IRBuilder<>> builder_;
+  absl::flat_hash_map<Node*, Slices> slices_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<BitSlicedJit>> BitSlicedJit::Create(
+    Function* xls_function, int64_t lane_count, int64_t opt_level) {
+  if (lane_count <= 0 || lane_count % 64 != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Lane count must be a positive multiple of 64, got %d", lane_count));
+  }
+  for (Param* param : xls_function->params()) {
+    if (!param->GetType()->IsBits()) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Bit-sliced JIT only supports bits-typed parameters: %s",
+          param->ToString()));
+    }
+  }
+  if (!xls_function->return_value()->GetType()->IsBits()) {
+    return absl::UnimplementedError(
+        "Bit-sliced JIT only supports bits-typed return values.");
+  }
+
+  auto jit = absl::WrapUnique(new BitSlicedJit(xls_function, lane_count));
+  XLS_ASSIGN_OR_RETURN(jit->orc_jit_, OrcJit::Create(opt_level));
+  XLS_RETURN_IF_ERROR(jit->Compile());
+  return jit;
+}
+
+absl::Status BitSlicedJit::Compile() {
+  llvm::LLVMContext* context = orc_jit_->GetContext();
+  std::unique_ptr<llvm::Module> module = orc_jit_->NewModule("bit_sliced");
+
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(*context);
+  llvm::Type* word_type =
+      words_per_slice() == 1
+          ? i64_type
+          : llvm::FixedVectorType::get(i64_type, words_per_slice());
+  llvm::Type* i8_ptr_type = llvm::Type::getInt8PtrTy(*context);
+  llvm::FunctionType* function_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(*context),
+      {llvm::PointerType::get(i8_ptr_type, /*AddressSpace=*/0), i8_ptr_type},
+      /*isVarArg=*/false);
+  std::string function_name =
+      absl::StrFormat("%s::%s_bit_sliced", xls_function_->package()->name(),
+                      xls_function_->name());
+  llvm::Function* llvm_function = llvm::cast<llvm::Function>(
+      module->getOrInsertFunction(function_name, function_type).getCallee());
+
+  BitSlicedBuilder builder(llvm_function, word_type);
+  XLS_RETURN_IF_ERROR(builder.Build(xls_function_));
+
+  XLS_RETURN_IF_ERROR(orc_jit_->CompileModule(std::move(module)));
+  XLS_ASSIGN_OR_RETURN(llvm::JITTargetAddress address,
+                       orc_jit_->LoadSymbol(function_name));
+  invoker_ = reinterpret_cast<JitFunctionType>(address);
+  return absl::OkStatus();
+}
+
+int64_t BitSlicedJit::GetArgWordCount(int64_t arg_index) const {
+  return xls_function_->param(arg_index)->BitCountOrDie() * words_per_slice();
+}
+
+int64_t BitSlicedJit::GetResultWordCount() const {
+  return xls_function_->return_value()->BitCountOrDie() * words_per_slice();
+}
+
+absl::Status BitSlicedJit::RunSliced(absl::Span<const uint64_t* const> args,
+                                     absl::Span<uint64_t> result) {
+  if (args.size() != xls_function_->params().size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Arg list has the wrong size: %d vs expected %d.",
+                        args.size(), xls_function_->params().size()));
+  }
+  if (result.size() < GetResultWordCount()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Result buffer too small - must be at least %d words!",
+                        GetResultWordCount()));
+  }
+  invoker_(args.data(), result.data());
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Value>> BitSlicedJit::Run(
+    absl::Span<const std::vector<Value>> arg_sets) {
+  absl::Span<Param* const> params = xls_function_->params();
+  int64_t words = words_per_slice();
+
+  std::vector<std::vector<uint64_t>> arg_buffers(params.size());
+  std::vector<const uint64_t*> arg_pointers(params.size());
+  for (int64_t i = 0; i < params.size(); ++i) {
+    arg_buffers[i].resize(std::max<int64_t>(GetArgWordCount(i), 1));
+    arg_pointers[i] = arg_buffers[i].data();
+  }
+  std::vector<uint64_t> result_buffer(
+      std::max<int64_t>(GetResultWordCount(), 1));
+  int64_t result_width = xls_function_->return_value()->BitCountOrDie();
+
+  std::vector<Value> results;
+  results.reserve(arg_sets.size());
+  for (int64_t base = 0; base < arg_sets.size(); base += lane_count_) {
+    int64_t samples =
+        std::min<int64_t>(lane_count_, arg_sets.size() - base);
+
+    // Transpose the samples into bit-sliced form.
+    for (std::vector<uint64_t>& buffer : arg_buffers) {
+      std::fill(buffer.begin(), buffer.end(), 0);
+    }
+    for (int64_t s = 0; s < samples; ++s) {
+      const std::vector<Value>& args = arg_sets[base + s];
+      if (args.size() != params.size()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Arg list %d has the wrong size: %d vs expected %d.", base + s,
+            args.size(), params.size()));
+      }
+      for (int64_t i = 0; i < params.size(); ++i) {
+        if (!ValueConformsToType(args[i], params[i]->GetType())) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Got argument %s for parameter %d which is not of type %s",
+              args[i].ToString(), i, params[i]->GetType()->ToString()));
+        }
+        const Bits& bits = args[i].bits();
+        for (int64_t b = 0; b < bits.bit_count(); ++b) {
+          if (bits.Get(b)) {
+            arg_buffers[i][b * words + s / 64] |= uint64_t{1} << (s % 64);
+          }
+        }
+      }
+    }
+
+    invoker_(arg_pointers.data(), result_buffer.data());
+
+    // And back out again.
+    for (int64_t s = 0; s < samples; ++s) {
+      InlineBitmap bitmap(result_width);
+      for (int64_t b = 0; b < result_width; ++b) {
+        bitmap.Set(b, (result_buffer[b * words + s / 64] >> (s % 64)) & 1);
+      }
+      results.push_back(Value(Bits::FromBitmap(std::move(bitmap))));
+    }
+  }
+  return results;
+}
+
+}  // namespace xls
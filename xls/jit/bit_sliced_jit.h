@@ -0,0 +1,95 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_BIT_SLICED_JIT_H_
+#define XLS_JIT_BIT_SLICED_JIT_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+#include "xls/jit/orc_jit.h"
+
+namespace xls {
+
+// JIT-compiles an XLS function in "bit-sliced" form: every bit of every XLS
+// value is held in a machine word (or vector of words) whose lanes correspond
+// to independent samples, so a single invocation evaluates `lane_count`
+// samples using only bitwise operations. With lane counts of 256 or 512, LLVM
+// lowers these operations to AVX2/AVX-512 instructions when available.
+//
+// This is profitable for narrow datapaths (e.g., control logic) and for
+// exhaustive testing, where evaluating many samples at once outweighs the
+// cost of the bit-level expansion of arithmetic. Only functions whose
+// parameters and return value are bits-typed are supported, and only a subset
+// of operations (bitwise, comparison, add/sub/neg/umul, shifts, selects,
+// concat/slice/extend and tuples) can be translated; others result in an
+// UnimplementedError from Create().
+//
+// Bit-sliced buffer layout: a value of N bits is N consecutive "slices", each
+// of `lane_count / 64` uint64_t words. Bit i (LSb == 0) of sample s is found in
+// slice i, word s / 64, bit s % 64.
+class BitSlicedJit {
+ public:
+  // Returns a compiled bit-sliced version of the given function. lane_count
+  // must be a positive multiple of 64.
+  static absl::StatusOr<std::unique_ptr<BitSlicedJit>> Create(
+      Function* xls_function, int64_t lane_count = 64, int64_t opt_level = 3);
+
+  // Evaluates the function on bit-sliced buffers (see the class comment for
+  // their layout). Element i of "args" must hold GetArgWordCount(i) words, and
+  // "result" must hold at least GetResultWordCount() words.
+  absl::Status RunSliced(absl::Span<const uint64_t* const> args,
+                         absl::Span<uint64_t> result);
+
+  // Evaluates the function on each of the given argument sets, transposing
+  // them into (and results out of) bit-sliced form `lane_count` samples at a
+  // time.
+  absl::StatusOr<std::vector<Value>> Run(
+      absl::Span<const std::vector<Value>> arg_sets);
+
+  int64_t lane_count() const { return lane_count_; }
+  int64_t words_per_slice() const { return lane_count_ / 64; }
+
+  // Returns the number of uint64_t words in the bit-sliced buffer for the given
+  // parameter or the result.
+  int64_t GetArgWordCount(int64_t arg_index) const;
+  int64_t GetResultWordCount() const;
+
+  Function* function() { return xls_function_; }
+
+ private:
+  BitSlicedJit(Function* xls_function, int64_t lane_count)
+      : xls_function_(xls_function), lane_count_(lane_count) {}
+
+  // Builds and compiles the bit-sliced LLVM function.
+  absl::Status Compile();
+
+  std::unique_ptr<OrcJit> orc_jit_;
+  Function* xls_function_;
+  int64_t lane_count_;
+
+  using JitFunctionType = void (*)(const uint64_t* const* inputs,
+                                   uint64_t* output);
+  JitFunctionType invoker_ = nullptr;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_BIT_SLICED_JIT_H_
@@ -0,0 +1,212 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/bit_sliced_jit.h"
+
+#include <random>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/random_value.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+class BitSlicedJitTest : public IrTestBase,
+                         public testing::WithParamInterface<int64_t> {
+ protected:
+  // Evaluates the function on every possible input (the function must have a
+  // small total parameter width) with the bit-sliced JIT and checks against
+  // the interpreter.
+  void ExpectExhaustiveMatch(Function* f) {
+    int64_t total_width = 0;
+    for (Param* param : f->params()) {
+      total_width += param->BitCountOrDie();
+    }
+    ASSERT_LE(total_width, 16);
+
+    std::vector<std::vector<Value>> arg_sets;
+    for (uint64_t i = 0; i < (uint64_t{1} << total_width); ++i) {
+      std::vector<Value> args;
+      int64_t offset = 0;
+      for (Param* param : f->params()) {
+        int64_t width = param->BitCountOrDie();
+        args.push_back(Value(UBits((i >> offset) & ((1 << width) - 1), width)));
+        offset += width;
+      }
+      arg_sets.push_back(args);
+    }
+
+    XLS_ASSERT_OK_AND_ASSIGN(auto jit, BitSlicedJit::Create(f, GetParam()));
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> results, jit->Run(arg_sets));
+    ASSERT_EQ(results.size(), arg_sets.size());
+    for (int64_t i = 0; i < arg_sets.size(); ++i) {
+      XLS_ASSERT_OK_AND_ASSIGN(Value expected,
+                               IrInterpreter::Run(f, arg_sets[i]));
+      ASSERT_EQ(results[i], expected) << "Sample " << i;
+    }
+  }
+};
+
+TEST_P(BitSlicedJitTest, Bitwise) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[4], y: bits[4], z: bits[2]) -> bits[4] {
+    and.1: bits[4] = and(x, y)
+    or.2: bits[4] = or(x, y, and.1)
+    xor.3: bits[4] = xor(or.2, y)
+    nand.4: bits[4] = nand(xor.3, x)
+    nor.5: bits[4] = nor(nand.4, y)
+    not.6: bits[4] = not(nor.5)
+    and_reduce.7: bits[1] = and_reduce(x)
+    or_reduce.8: bits[1] = or_reduce(y)
+    xor_reduce.9: bits[1] = xor_reduce(not.6)
+    concat.10: bits[5] = concat(and_reduce.7, or_reduce.8, xor_reduce.9, z)
+    reverse.11: bits[5] = reverse(concat.10)
+    bit_slice.12: bits[4] = bit_slice(reverse.11, start=1, width=4)
+    ret xor.13: bits[4] = xor(bit_slice.12, not.6)
+  }
+  )", p.get()));
+  ExpectExhaustiveMatch(f);
+}
+
+TEST_P(BitSlicedJitTest, Arithmetic) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[5], y: bits[5]) -> bits[7] {
+    add.1: bits[5] = add(x, y)
+    sub.2: bits[5] = sub(add.1, y)
+    neg.3: bits[5] = neg(sub.2)
+    umul.4: bits[7] = umul(neg.3, y)
+    zero_ext.5: bits[7] = zero_ext(x, new_bit_count=7)
+    sign_ext.6: bits[7] = sign_ext(y, new_bit_count=7)
+    add.7: bits[7] = add(umul.4, zero_ext.5)
+    ret sub.8: bits[7] = sub(add.7, sign_ext.6)
+  }
+  )", p.get()));
+  ExpectExhaustiveMatch(f);
+}
+
+TEST_P(BitSlicedJitTest, Comparisons) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[4], y: bits[4]) -> bits[10] {
+    eq.1: bits[1] = eq(x, y)
+    ne.2: bits[1] = ne(x, y)
+    ult.3: bits[1] = ult(x, y)
+    ule.4: bits[1] = ule(x, y)
+    ugt.5: bits[1] = ugt(x, y)
+    uge.6: bits[1] = uge(x, y)
+    slt.7: bits[1] = slt(x, y)
+    sle.8: bits[1] = sle(x, y)
+    sgt.9: bits[1] = sgt(x, y)
+    sge.10: bits[1] = sge(x, y)
+    ret concat.11: bits[10] = concat(eq.1, ne.2, ult.3, ule.4, ugt.5, uge.6, slt.7, sle.8, sgt.9, sge.10)
+  }
+  )", p.get()));
+  ExpectExhaustiveMatch(f);
+}
+
+TEST_P(BitSlicedJitTest, Shifts) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[6], y: bits[4]) -> bits[6] {
+    shll.1: bits[6] = shll(x, y)
+    shrl.2: bits[6] = shrl(x, y)
+    shra.3: bits[6] = shra(x, y)
+    xor.4: bits[6] = xor(shll.1, shrl.2)
+    ret xor.5: bits[6] = xor(xor.4, shra.3)
+  }
+  )", p.get()));
+  ExpectExhaustiveMatch(f);
+}
+
+TEST_P(BitSlicedJitTest, SelectsAndTuples) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(s: bits[2], x: bits[4], y: bits[4], h: bits[2]) -> bits[4] {
+    literal.1: bits[4] = literal(value=9)
+    sel.2: bits[4] = sel(s, cases=[x, y, literal.1], default=x)
+    sel.3: bits[4] = sel(s, cases=[x, y, literal.1, y])
+    one_hot_sel.4: bits[4] = one_hot_sel(h, cases=[sel.2, sel.3])
+    tuple.5: (bits[4], bits[2], bits[4]) = tuple(sel.2, h, one_hot_sel.4)
+    tuple_index.6: bits[4] = tuple_index(tuple.5, index=2)
+    tuple_index.7: bits[2] = tuple_index(tuple.5, index=1)
+    zero_ext.8: bits[4] = zero_ext(tuple_index.7, new_bit_count=4)
+    ret add.9: bits[4] = add(tuple_index.6, zero_ext.8)
+  }
+  )", p.get()));
+  ExpectExhaustiveMatch(f);
+}
+
+TEST_P(BitSlicedJitTest, RunSlicedLayout) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[2]) -> bits[2] {
+    ret not.1: bits[2] = not(x)
+  }
+  )", p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, BitSlicedJit::Create(f, GetParam()));
+  int64_t words = jit->words_per_slice();
+  ASSERT_EQ(jit->GetArgWordCount(0), 2 * words);
+  ASSERT_EQ(jit->GetResultWordCount(), 2 * words);
+
+  std::vector<uint64_t> input(2 * words);
+  std::vector<uint64_t> output(2 * words);
+  for (int64_t w = 0; w < words; ++w) {
+    input[w] = 0x0123456789abcdefULL + w;
+    input[words + w] = ~uint64_t{0} << w;
+  }
+  std::vector<const uint64_t*> args = {input.data()};
+  XLS_ASSERT_OK(jit->RunSliced(args, absl::MakeSpan(output)));
+  for (int64_t i = 0; i < input.size(); ++i) {
+    EXPECT_EQ(output[i], ~input[i]);
+  }
+}
+
+TEST_P(BitSlicedJitTest, Unsupported) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+  fn f(x: bits[8], y: bits[8]) -> bits[8] {
+    ret udiv.1: bits[8] = udiv(x, y)
+  }
+  )", p.get()));
+  EXPECT_THAT(BitSlicedJit::Create(f, GetParam()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST(BitSlicedJitLaneTest, InvalidLaneCount) {
+  Package p("p");
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, Parser::ParseFunction(R"(
+  fn f(x: bits[8]) -> bits[8] {
+    ret identity.1: bits[8] = identity(x)
+  }
+  )", &p));
+  EXPECT_THAT(BitSlicedJit::Create(f, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(BitSlicedJit::Create(f, 100),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+INSTANTIATE_TEST_SUITE_P(BitSlicedJitTestInstantiation, BitSlicedJitTest,
+                         testing::Values(64, 256, 512));
+
+}  // namespace
+}  // namespace xls
@@ -20,33 +20,52 @@
 #include <sanitizer/msan_interface.h>
 #endif
 
+#include "absl/algorithm/container.h"
 #include "llvm/include/llvm/IR/Constants.h"
+#include "llvm/include/llvm/IR/GlobalVariable.h"
+#include "llvm/include/llvm/IR/MDBuilder.h"
 #include "xls/codegen/vast.h"
 #include "xls/ir/function.h"
 #include "xls/ir/proc.h"
+#include "xls/jit/jit_events.h"
 
 namespace xls {
+namespace {
+
+// Maps over arrays of bits with at least this many elements are lowered to a
+// loop over memory rather than unrolled (see HandleMap).
+constexpr int64_t kMinLoopMapSize = 8;
+
+// Selects with at least this many arms (cases and default) are lowered to a
+// table lookup or a switch rather than a chain of LLVM selects (see
+// HandleSel).
+constexpr int64_t kMinTableSelectSize = 8;
+
+}  // namespace
 
 absl::Status FunctionBuilderVisitor::Visit(llvm::Module* module,
                                            llvm::Function* llvm_fn,
                                            FunctionBase* xls_fn,
                                            LlvmTypeConverter* type_converter,
-                                           bool is_top, bool generate_packed) {
+                                           bool is_top, bool generate_packed,
+                                           JitNodeCounters* node_counters) {
   FunctionBuilderVisitor visitor(module, llvm_fn, xls_fn, type_converter,
-                                 is_top, generate_packed);
+                                 is_top, generate_packed, node_counters);
   return visitor.BuildInternal();
 }
 
 FunctionBuilderVisitor::FunctionBuilderVisitor(
     llvm::Module* module, llvm::Function* llvm_fn, FunctionBase* xls_fn,
-    LlvmTypeConverter* type_converter, bool is_top, bool generate_packed)
+    LlvmTypeConverter* type_converter, bool is_top, bool generate_packed,
+    JitNodeCounters* node_counters)
     : ctx_(module->getContext()),
       module_(module),
       llvm_fn_(llvm_fn),
       xls_fn_(xls_fn),
       type_converter_(type_converter),
       is_top_(is_top),
-      generate_packed_(generate_packed) {}
+      generate_packed_(generate_packed),
+      node_counters_(node_counters) {}
 
 absl::Status FunctionBuilderVisitor::BuildInternal() {
   auto basic_block = llvm::BasicBlock::Create(ctx_, "so_basic", llvm_fn_,
@@ -138,6 +157,39 @@ absl::Status FunctionBuilderVisitor::HandleAfterAll(AfterAll* after_all) {
   return StoreResult(after_all, type_converter_->GetToken());
 }
 
+absl::Status FunctionBuilderVisitor::HandleAssert(Assert* assert_op) {
+  // A failure calls out to JitEventBuffer::RecordAssertionFailure() with the
+  // address of the node, so nothing about the message is computed in LLVM
+  // space. The branch is weighted as almost never taken.
+  llvm::BasicBlock* fail_block = llvm::BasicBlock::Create(
+      ctx_, absl::StrCat(assert_op->GetName(), "_fail"), llvm_fn_);
+  llvm::BasicBlock* join_block = llvm::BasicBlock::Create(
+      ctx_, absl::StrCat(assert_op->GetName(), "_join"), llvm_fn_);
+  builder_->CreateCondBr(node_map_.at(assert_op->condition()), join_block,
+                         fail_block,
+                         llvm::MDBuilder(ctx_).createBranchWeights(
+                             /*TrueWeight=*/1 << 20, /*FalseWeight=*/1));
+
+  llvm::IRBuilder<> fail_builder(fail_block);
+  llvm::Type* int64_type = llvm::Type::getInt64Ty(ctx_);
+  llvm::FunctionType* fn_type =
+      llvm::FunctionType::get(llvm::Type::getVoidTy(ctx_), {int64_type},
+                              /*isVarArg=*/false);
+  llvm::Value* fn_ptr = fail_builder.CreateIntToPtr(
+      llvm::ConstantInt::get(
+          int64_type,
+          reinterpret_cast<uint64_t>(&JitEventBuffer::RecordAssertionFailure)),
+      llvm::PointerType::get(fn_type, 0));
+  fail_builder.CreateCall(
+      fn_type, fn_ptr,
+      {llvm::ConstantInt::get(int64_type,
+                              reinterpret_cast<uint64_t>(assert_op))});
+  fail_builder.CreateBr(join_block);
+
+  set_builder(std::make_unique<llvm::IRBuilder<>>(join_block));
+  return StoreResult(assert_op, type_converter_->GetToken());
+}
+
 absl::Status FunctionBuilderVisitor::HandleArray(Array* array) {
   llvm::Type* array_type = type_converter_->ConvertToLlvmType(array->GetType());
 
@@ -175,6 +227,14 @@ absl::StatusOr<llvm::Value*> FunctionBuilderVisitor::IndexIntoArray(
       builder_->CreateZExt(inbounds_index,
                            llvm::IntegerType::get(ctx_, index_width + 1))};
 
+  // Constant arrays (e.g., tables from TableSwitchPass) are looked up in
+  // read-only memory.
+  if (auto* constant = llvm::dyn_cast<llvm::Constant>(array)) {
+    llvm::Value* gep =
+        builder_->CreateGEP(GetConstantTable(constant), gep_indices);
+    return builder_->CreateLoad(gep);
+  }
+
   // Ideally, we'd use IRBuilder::CreateExtractValue here, but that requires
   // constant indices. Since there's no other way to extract a value from an
   // aggregate, we're left with storing the value in a temporary alloca and
@@ -192,6 +252,20 @@ absl::StatusOr<llvm::Value*> FunctionBuilderVisitor::IndexIntoArray(
   return builder_->CreateLoad(gep);
 }
 
+llvm::GlobalVariable* FunctionBuilderVisitor::GetConstantTable(
+    llvm::Constant* value) {
+  auto it = constant_tables_.find(value);
+  if (it != constant_tables_.end()) {
+    return it->second;
+  }
+  auto* table = new llvm::GlobalVariable(
+      *module_, value->getType(), /*isConstant=*/true,
+      llvm::GlobalValue::PrivateLinkage, value, "table");
+  table->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  constant_tables_[value] = table;
+  return table;
+}
+
 absl::Status FunctionBuilderVisitor::HandleArrayIndex(ArrayIndex* index) {
   Type* element_type = index->array()->GetType();
   llvm::Value* element = node_map_.at(index->array());
@@ -458,6 +532,15 @@ absl::Status FunctionBuilderVisitor::HandleCountedFor(CountedFor* counted_for) {
     args[1] = builder_->CreateCall(function, {args});
   }
 
+  if (node_counters_ != nullptr) {
+    uint64_t* counters = node_counters_->GetOrAllocate(counted_for, 2);
+    IncrementCounter(builder_.get(), CounterPointer(builder_.get(), counters),
+                     builder_->getInt64(1));
+    IncrementCounter(builder_.get(),
+                     CounterPointer(builder_.get(), counters + 1),
+                     builder_->getInt64(counted_for->trip_count()));
+  }
+
   return StoreResult(counted_for, args[1]);
 }
 
@@ -539,6 +622,15 @@ absl::Status FunctionBuilderVisitor::HandleDynamicCountedFor(
 
   // Calculate index limit and jump entry loop predheader.
   llvm::Value* index_limit = entry_builder->CreateMul(trip_count, stride);
+  if (node_counters_ != nullptr) {
+    uint64_t* counters = node_counters_->GetOrAllocate(dynamic_counted_for, 2);
+    IncrementCounter(entry_builder, CounterPointer(entry_builder, counters),
+                     entry_builder->getInt64(1));
+    // The loop block counts the iterations.
+    IncrementCounter(loop_builder.get(),
+                     CounterPointer(loop_builder.get(), counters + 1),
+                     loop_builder->getInt64(1));
+  }
   entry_builder->CreateBr(preheader_block);
 
   // Preheader
@@ -634,6 +726,11 @@ absl::Status FunctionBuilderVisitor::HandleInvoke(Invoke* invoke) {
   args.back() = llvm_fn_->getArg(llvm_fn_->arg_size() - 1);
 
   llvm::Value* invoke_inst = builder_->CreateCall(function, args);
+  if (node_counters_ != nullptr) {
+    uint64_t* counters = node_counters_->GetOrAllocate(invoke, 1);
+    IncrementCounter(builder_.get(), CounterPointer(builder_.get(), counters),
+                     builder_->getInt64(1));
+  }
   return StoreResult(invoke, invoke_inst);
 }
 
@@ -655,10 +752,55 @@ absl::Status FunctionBuilderVisitor::HandleMap(Map* map) {
   llvm::FunctionType* function_type = llvm::cast<llvm::FunctionType>(
       to_apply->getType()->getPointerElementType());
 
-  llvm::Value* result = CreateTypedZeroValue(llvm::ArrayType::get(
-      function_type->getReturnType(), input_type->getArrayNumElements()));
-
+  llvm::Type* result_type = llvm::ArrayType::get(
+      function_type->getReturnType(), input_type->getArrayNumElements());
   llvm::Value* user_data = llvm_fn_->getArg(llvm_fn_->arg_size() - 1);
+
+  if (map->operand(0)->GetType()->AsArrayOrDie()->element_type()->IsBits() &&
+      map->GetType()->AsArrayOrDie()->element_type()->IsBits() &&
+      input_type->getArrayNumElements() >= kMinLoopMapSize) {
+    // Unrolled calls extracting from and inserting into first-class aggregates
+    // are opaque to the loop vectorizer. Instead, map the elements in a loop
+    // over the arrays in memory: once the mapped function is inlined, this is
+    // a canonical loop of loads and stores of contiguous elements which LLVM
+    // turns into SIMD code.
+    llvm::Type* index_type = llvm::Type::getInt64Ty(ctx_);
+    llvm::Value* zero = llvm::ConstantInt::get(index_type, 0);
+    llvm::AllocaInst* input_alloca = builder_->CreateAlloca(input_type);
+    builder_->CreateStore(input, input_alloca);
+    llvm::AllocaInst* result_alloca = builder_->CreateAlloca(result_type);
+
+    llvm::BasicBlock* entry_block = builder_->GetInsertBlock();
+    llvm::BasicBlock* loop_block = llvm::BasicBlock::Create(
+        ctx_, absl::StrCat(map->GetName(), "_loop"), llvm_fn_);
+    llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(
+        ctx_, absl::StrCat(map->GetName(), "_exit"), llvm_fn_);
+    builder_->CreateBr(loop_block);
+
+    llvm::IRBuilder<> loop_builder(loop_block);
+    llvm::PHINode* index = loop_builder.CreatePHI(index_type, 2);
+    llvm::Value* element = loop_builder.CreateLoad(
+        loop_builder.CreateGEP(input_alloca, {zero, index}));
+    llvm::Value* mapped =
+        loop_builder.CreateCall(to_apply, {element, user_data});
+    loop_builder.CreateStore(
+        mapped, loop_builder.CreateGEP(result_alloca, {zero, index}));
+    llvm::Value* next_index =
+        loop_builder.CreateAdd(index, llvm::ConstantInt::get(index_type, 1));
+    llvm::Value* done = loop_builder.CreateICmpEQ(
+        next_index, llvm::ConstantInt::get(
+                        index_type, input_type->getArrayNumElements()));
+    loop_builder.CreateCondBr(done, exit_block, loop_block);
+    index->addIncoming(zero, entry_block);
+    index->addIncoming(next_index, loop_block);
+
+    set_builder(std::make_unique<llvm::IRBuilder<>>(exit_block));
+    llvm::Value* result = builder_->CreateLoad(result_type, result_alloca);
+    array_storage_[result] = result_alloca;
+    return StoreResult(map, result);
+  }
+
+  llvm::Value* result = CreateTypedZeroValue(result_type);
   for (uint32_t i = 0; i < input_type->getArrayNumElements(); ++i) {
     llvm::Value* iter_input = builder_->CreateExtractValue(input, {i});
     llvm::Value* iter_result =
@@ -966,21 +1108,98 @@ absl::Status FunctionBuilderVisitor::HandleSMod(BinOp* binop) {
 }
 
 absl::Status FunctionBuilderVisitor::HandleSel(Select* sel) {
-  // Sel is implemented by a cascading series of select ops, e.g.,
-  // selector == 0 ? cases[0] : selector == 1 ? cases[1] : selector == 2 ? ...
   llvm::Value* selector = node_map_.at(sel->selector());
-  llvm::Value* llvm_sel =
-      sel->default_value() ? node_map_.at(*sel->default_value()) : nullptr;
-  for (int i = sel->cases().size() - 1; i >= 0; i--) {
-    Node* node = sel->get_case(i);
-    if (llvm_sel == nullptr) {
-      // The last element in the select tree isn't a sel, but an actual value.
-      llvm_sel = node_map_.at(node);
-    } else {
-      llvm::Value* index = llvm::ConstantInt::get(selector->getType(), i);
-      llvm::Value* cmp = builder_->CreateICmpEQ(selector, index);
-      llvm_sel = builder_->CreateSelect(cmp, node_map_.at(node), llvm_sel);
+  std::vector<llvm::Value*> arms;
+  for (Node* node : sel->cases()) {
+    arms.push_back(node_map_.at(node));
+  }
+  if (sel->default_value().has_value()) {
+    arms.push_back(node_map_.at(*sel->default_value()));
+  }
+
+  llvm::Value* llvm_sel;
+  if (arms.size() >= kMinTableSelectSize &&
+      absl::c_all_of(arms, [](llvm::Value* arm) {
+        return llvm::isa<llvm::Constant>(arm);
+      })) {
+    // A large select of constants (e.g., in a decoder) is a lookup in a table
+    // of them, with the default last: IndexIntoArray maps out of bounds
+    // selector values to the last element.
+    std::vector<llvm::Constant*> elements;
+    for (llvm::Value* arm : arms) {
+      elements.push_back(llvm::cast<llvm::Constant>(arm));
+    }
+    llvm::Constant* table = llvm::ConstantArray::get(
+        llvm::ArrayType::get(arms.front()->getType(), arms.size()), elements);
+    XLS_ASSIGN_OR_RETURN(llvm_sel,
+                         IndexIntoArray(table, selector, arms.size()));
+  } else if (arms.size() >= kMinTableSelectSize) {
+    // Other large selects are a switch, which LLVM lowers to a jump table,
+    // joining at a phi of the arms. Every arm gets a block, as the phi
+    // distinguishes arms by predecessor.
+    llvm::BasicBlock* join_block = llvm::BasicBlock::Create(
+        ctx_, absl::StrCat(sel->GetName(), "_join"), llvm_fn_);
+    llvm::BasicBlock* default_block = llvm::BasicBlock::Create(
+        ctx_, absl::StrCat(sel->GetName(), "_default"), llvm_fn_, join_block);
+    llvm::SwitchInst* switch_inst =
+        builder_->CreateSwitch(selector, default_block, arms.size() - 1);
+    llvm::IRBuilder<> join_builder(join_block);
+    llvm::PHINode* phi =
+        join_builder.CreatePHI(arms.front()->getType(), arms.size());
+    for (int64_t i = 0; i < arms.size() - 1; ++i) {
+      llvm::BasicBlock* case_block = llvm::BasicBlock::Create(
+          ctx_, absl::StrCat(sel->GetName(), "_case_", i), llvm_fn_,
+          default_block);
+      switch_inst->addCase(
+          llvm::cast<llvm::ConstantInt>(
+              llvm::ConstantInt::get(selector->getType(), i)),
+          case_block);
+      llvm::BranchInst::Create(join_block, case_block);
+      phi->addIncoming(arms[i], case_block);
+    }
+    llvm::BranchInst::Create(join_block, default_block);
+    phi->addIncoming(arms.back(), default_block);
+    set_builder(std::make_unique<llvm::IRBuilder<>>(join_block));
+    llvm_sel = phi;
+  } else {
+    // Smaller selects are a cascading series of select ops, e.g.,
+    // selector == 0 ? cases[0] : selector == 1 ? cases[1] : selector == 2 ...
+    llvm_sel =
+        sel->default_value() ? node_map_.at(*sel->default_value()) : nullptr;
+    for (int i = sel->cases().size() - 1; i >= 0; i--) {
+      Node* node = sel->get_case(i);
+      if (llvm_sel == nullptr) {
+        // The last element in the select tree isn't a sel, but an actual
+        // value.
+        llvm_sel = node_map_.at(node);
+      } else {
+        llvm::Value* index = llvm::ConstantInt::get(selector->getType(), i);
+        llvm::Value* cmp = builder_->CreateICmpEQ(selector, index);
+        llvm_sel = builder_->CreateSelect(cmp, node_map_.at(node), llvm_sel);
+      }
+    }
+  }
+
+  if (node_counters_ != nullptr) {
+    // Counter i counts selections of case i, and the last counter those of
+    // the default. Without a default, every selector value is a case.
+    int64_t case_count = sel->cases().size();
+    uint64_t* counters = node_counters_->GetOrAllocate(
+        sel, case_count + (sel->default_value().has_value() ? 1 : 0));
+    llvm::Value* arm = selector;
+    if (sel->default_value().has_value()) {
+      llvm::Value* case_count_value =
+          llvm::ConstantInt::get(selector->getType(), case_count);
+      arm = builder_->CreateSelect(
+          builder_->CreateICmpULT(selector, case_count_value), selector,
+          case_count_value);
     }
+    arm = builder_->CreateZExtOrTrunc(arm, builder_->getInt64Ty());
+    IncrementCounter(
+        builder_.get(),
+        builder_->CreateGEP(builder_->getInt64Ty(),
+                            CounterPointer(builder_.get(), counters), arm),
+        builder_->getInt64(1));
   }
   return StoreResult(sel, llvm_sel);
 }
@@ -1417,11 +1636,25 @@ absl::StatusOr<llvm::Function*> FunctionBuilderVisitor::GetModuleFunction(
   // TODO(rspringer): Need to override this for Procs.
   XLS_RETURN_IF_ERROR(FunctionBuilderVisitor::Visit(
       module_, llvm_function, xls_function, type_converter_,
-      /*is_top=*/false, /*generate_packed=*/false));
+      /*is_top=*/false, /*generate_packed=*/false, node_counters_));
 
   return llvm_function;
 }
 
+void FunctionBuilderVisitor::IncrementCounter(llvm::IRBuilder<>* builder,
+                                              llvm::Value* counter,
+                                              llvm::Value* amount) {
+  llvm::Value* count = builder->CreateLoad(builder->getInt64Ty(), counter);
+  builder->CreateStore(builder->CreateAdd(count, amount), counter);
+}
+
+llvm::Value* FunctionBuilderVisitor::CounterPointer(llvm::IRBuilder<>* builder,
+                                                    uint64_t* counter) {
+  return builder->CreateIntToPtr(
+      builder->getInt64(reinterpret_cast<uint64_t>(counter)),
+      llvm::PointerType::get(builder->getInt64Ty(), /*AddressSpace=*/0));
+}
+
 absl::Status FunctionBuilderVisitor::StoreResult(Node* node,
                                                  llvm::Value* value) {
   XLS_RET_CHECK(!node_map_.contains(node));
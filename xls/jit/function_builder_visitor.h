@@ -25,6 +25,7 @@
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/function_base.h"
 #include "xls/ir/nodes.h"
+#include "xls/jit/jit_node_counters.h"
 #include "xls/jit/llvm_type_converter.h"
 
 namespace xls {
@@ -39,10 +40,13 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
   //   is_top: true if this is the top-level function being translated,
   //     false if this is a function invocation from already inside "LLVM
   //     space".
+  //   node_counters: if non-null, the generated code counts the executions of
+  //     nodes in it (see jit_node_counters.h).
   static absl::Status Visit(llvm::Module* module, llvm::Function* llvm_fn,
                             FunctionBase* xls_fn,
                             LlvmTypeConverter* type_converter, bool is_top,
-                            bool generate_packed);
+                            bool generate_packed,
+                            JitNodeCounters* node_counters = nullptr);
 
   absl::Status DefaultHandler(Node* node) override {
     return absl::UnimplementedError(
@@ -56,6 +60,7 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
   absl::Status HandleArrayIndex(ArrayIndex* index) override;
   absl::Status HandleArrayUpdate(ArrayUpdate* update) override;
   absl::Status HandleArrayConcat(ArrayConcat* concat) override;
+  absl::Status HandleAssert(Assert* assert_op) override;
   absl::Status HandleBitSlice(BitSlice* bit_slice) override;
   absl::Status HandleBitSliceUpdate(BitSliceUpdate* update) override;
   absl::Status HandleDynamicBitSlice(
@@ -121,7 +126,8 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
   FunctionBuilderVisitor(llvm::Module* module, llvm::Function* llvm_fn,
                          FunctionBase* xls_fn,
                          LlvmTypeConverter* type_converter, bool is_top,
-                         bool generate_packed);
+                         bool generate_packed,
+                         JitNodeCounters* node_counters = nullptr);
 
   llvm::LLVMContext& ctx() { return ctx_; }
   llvm::Module* module() { return module_; }
@@ -196,6 +202,16 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
                                               llvm::Value* index,
                                               int64_t array_size);
 
+  // Returns a read-only global of the module holding "value", from which
+  // constant arrays are indexed instead of copying them to the stack.
+  llvm::GlobalVariable* GetConstantTable(llvm::Constant* value);
+
+  // Emits code adding "amount" (an i64) to the given counter, and returns a
+  // pointer to the given counter in generated code, respectively.
+  void IncrementCounter(llvm::IRBuilder<>* builder, llvm::Value* counter,
+                        llvm::Value* amount);
+  llvm::Value* CounterPointer(llvm::IRBuilder<>* builder, uint64_t* counter);
+
   llvm::LLVMContext& ctx_;
   llvm::Module* module_;
   llvm::Function* llvm_fn_;
@@ -211,6 +227,9 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
   // header comment for IrJit::RunWithPackedViews()).
   bool generate_packed_;
 
+  // Non-null if the generated code is instrumented.
+  JitNodeCounters* node_counters_;
+
   // The last value constructed during this traversal - represents the return
   // from calculation.
   llvm::Value* return_value_;
@@ -222,6 +241,9 @@ class FunctionBuilderVisitor : public DfsVisitorWithDefault {
   // storage to extract elements (i.e., for GEPs), it makes sense to only create
   // and store the array once.
   absl::flat_hash_map<llvm::Value*, llvm::AllocaInst*> array_storage_;
+
+  // The globals returned by GetConstantTable, by value.
+  absl::flat_hash_map<llvm::Constant*, llvm::GlobalVariable*> constant_tables_;
 };
 
 }  // namespace xls
@@ -0,0 +1,458 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/jit/fused_proc_jit.h"
+
+#include <cstring>
+#include <deque>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "llvm/include/llvm/IR/BasicBlock.h"
+#include "llvm/include/llvm/IR/Constants.h"
+#include "llvm/include/llvm/IR/DerivedTypes.h"
+#include "llvm/include/llvm/IR/IRBuilder.h"
+#include "llvm/include/llvm/IR/Module.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/nodes.h"
+#include "xls/jit/function_builder_visitor.h"
+#include "xls/jit/proc_builder_visitor.h"
+
+namespace xls {
+namespace {
+
+// Extends ProcBuilderVisitor by lowering sends and receives on internal
+// channels into direct accesses of the channels' ring buffers. Operations on
+// external channels are handled by the base class via callbacks.
+class FusedProcBuilderVisitor : public ProcBuilderVisitor {
+ public:
+  // Addresses of the host-side state of an internal channel.
+  struct ChannelAddresses {
+    int64_t* head;
+    int64_t* count;
+    int64_t capacity;
+    uint8_t* data;
+  };
+
+  static absl::Status Visit(
+      llvm::Module* module, llvm::Function* llvm_fn, Proc* proc,
+      LlvmTypeConverter* type_converter, JitChannelQueueManager* queue_mgr,
+      RecvFnT recv_fn, SendFnT send_fn,
+      const absl::flat_hash_map<int64_t, ChannelAddresses>* internal_channels) {
+    FusedProcBuilderVisitor visitor(module, llvm_fn, proc, type_converter,
+                                    queue_mgr, recv_fn, send_fn,
+                                    internal_channels);
+    return visitor.BuildInternal();
+  }
+
+  absl::Status HandleReceive(Receive* recv) override {
+    auto it = internal_channels_->find(recv->channel_id());
+    if (it == internal_channels_->end()) {
+      return ProcBuilderVisitor::HandleReceive(recv);
+    }
+    const ChannelAddresses& channel = it->second;
+    Type* data_type = recv->GetType()->AsTupleOrDie()->element_type(1);
+    llvm::Type* llvm_data_type = type_converter()->ConvertToLlvmType(data_type);
+
+    // The schedule guarantees the channel is non-empty here.
+    llvm::Value* head_ptr = AddressOf(channel.head, int64_type());
+    llvm::Value* count_ptr = AddressOf(channel.count, int64_type());
+    llvm::Value* head = builder()->CreateLoad(int64_type(), head_ptr);
+    llvm::Value* count = builder()->CreateLoad(int64_type(), count_ptr);
+    llvm::Value* data = builder()->CreateLoad(
+        llvm_data_type, ElementPointer(channel, llvm_data_type, head));
+
+    llvm::Value* next_head = Wrap(
+        builder()->CreateAdd(head, llvm::ConstantInt::get(int64_type(), 1)),
+        channel.capacity);
+    builder()->CreateStore(next_head, head_ptr);
+    builder()->CreateStore(
+        builder()->CreateSub(count, llvm::ConstantInt::get(int64_type(), 1)),
+        count_ptr);
+
+    llvm::Type* result_type =
+        type_converter()->ConvertToLlvmType(recv->GetType());
+    llvm::Value* result = CreateTypedZeroValue(result_type);
+    result = builder()->CreateInsertValue(result, type_converter()->GetToken(),
+                                          {0});
+    result = builder()->CreateInsertValue(result, data, {1});
+    return StoreResult(recv, result);
+  }
+
+  absl::Status HandleSend(Send* send) override {
+    auto it = internal_channels_->find(send->channel_id());
+    if (it == internal_channels_->end()) {
+      return ProcBuilderVisitor::HandleSend(send);
+    }
+    const ChannelAddresses& channel = it->second;
+    llvm::Value* data = node_map().at(send->data());
+
+    llvm::Value* head_ptr = AddressOf(channel.head, int64_type());
+    llvm::Value* count_ptr = AddressOf(channel.count, int64_type());
+    llvm::Value* head = builder()->CreateLoad(int64_type(), head_ptr);
+    llvm::Value* count = builder()->CreateLoad(int64_type(), count_ptr);
+    llvm::Value* tail =
+        Wrap(builder()->CreateAdd(head, count), channel.capacity);
+    builder()->CreateStore(data,
+                           ElementPointer(channel, data->getType(), tail));
+    builder()->CreateStore(
+        builder()->CreateAdd(count, llvm::ConstantInt::get(int64_type(), 1)),
+        count_ptr);
+    return StoreResult(send, type_converter()->GetToken());
+  }
+
+ private:
+  FusedProcBuilderVisitor(
+      llvm::Module* module, llvm::Function* llvm_fn, Proc* proc,
+      LlvmTypeConverter* type_converter, JitChannelQueueManager* queue_mgr,
+      RecvFnT recv_fn, SendFnT send_fn,
+      const absl::flat_hash_map<int64_t, ChannelAddresses>* internal_channels)
+      : ProcBuilderVisitor(module, llvm_fn, proc, type_converter,
+                           /*is_top=*/true, /*generate_packed=*/false,
+                           queue_mgr, recv_fn, send_fn),
+        internal_channels_(internal_channels) {}
+
+  llvm::Type* int64_type() { return llvm::Type::getInt64Ty(ctx()); }
+
+  // Returns the given host address as a pointer to the given type.
+  llvm::Value* AddressOf(const void* address, llvm::Type* type) {
+    return builder()->CreateIntToPtr(
+        llvm::ConstantInt::get(int64_type(),
+                               reinterpret_cast<uint64_t>(address)),
+        llvm::PointerType::get(type, /*AddressSpace=*/0));
+  }
+
+  // Returns a pointer to element "index" of the channel's buffer.
+  llvm::Value* ElementPointer(const ChannelAddresses& channel,
+                              llvm::Type* element_type, llvm::Value* index) {
+    return builder()->CreateGEP(element_type,
+                                AddressOf(channel.data, element_type), index);
+  }
+
+  // Returns "index" modulo "capacity", given that index < 2 * capacity.
+  llvm::Value* Wrap(llvm::Value* index, int64_t capacity) {
+    llvm::Value* llvm_capacity =
+        llvm::ConstantInt::get(int64_type(), capacity);
+    return builder()->CreateSelect(
+        builder()->CreateICmpUGE(index, llvm_capacity),
+        builder()->CreateSub(index, llvm_capacity), index);
+  }
+
+  const absl::flat_hash_map<int64_t, ChannelAddresses>* internal_channels_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<FusedProcJit>> FusedProcJit::Create(
+    Package* package, int64_t opt_level) {
+  auto jit = absl::WrapUnique(new FusedProcJit(package));
+  XLS_RETURN_IF_ERROR(jit->Init(opt_level));
+  return jit;
+}
+
+absl::Status FusedProcJit::Init(int64_t opt_level) {
+  XLS_ASSIGN_OR_RETURN(orc_jit_, OrcJit::Create(opt_level));
+  type_converter_ = std::make_unique<LlvmTypeConverter>(
+      orc_jit_->GetContext(), orc_jit_->GetDataLayout());
+  ir_runtime_ = std::make_unique<JitRuntime>(orc_jit_->GetDataLayout(),
+                                             type_converter_.get());
+  XLS_ASSIGN_OR_RETURN(queue_mgr_, JitChannelQueueManager::Create(package_));
+
+  for (Channel* channel : package_->channels()) {
+    if (!channel->IsStreaming()) {
+      return absl::UnimplementedError(
+          "Only streaming channels are supported in fused proc JIT.");
+    }
+    if (channel->supported_ops() != ChannelOps::kSendReceive) {
+      continue;
+    }
+    // With one send and one receive per tick, the occupancy of a channel
+    // between ticks is its number of initial values, and it holds at most
+    // one more element during a tick.
+    auto buffer = std::make_unique<ChannelBuffer>();
+    buffer->capacity = channel->initial_values().size() + 1;
+    buffer->element_size = type_converter_->GetTypeByteSize(channel->type());
+    buffer->data = std::make_unique<uint8_t[]>(
+        std::max<int64_t>(buffer->capacity * buffer->element_size, 1));
+    for (const Value& value : channel->initial_values()) {
+      ir_runtime_->BlitValueToBuffer(
+          value, channel->type(),
+          absl::MakeSpan(buffer->data.get() + buffer->count *
+                                                  buffer->element_size,
+                         buffer->element_size));
+      buffer->count++;
+    }
+    channel_buffers_[channel->id()] = std::move(buffer);
+  }
+
+  XLS_RETURN_IF_ERROR(ComputeSchedule());
+
+  for (Proc* proc : schedule_) {
+    Type* state_type =
+        FunctionBuilderVisitor::GetEffectiveReturnValue(proc)->GetType();
+    int64_t state_size = type_converter_->GetTypeByteSize(state_type);
+    proc_states_.push_back(
+        std::make_unique<uint8_t[]>(std::max<int64_t>(state_size, 1)));
+    proc_state_ptrs_.push_back(proc_states_.back().get());
+    ir_runtime_->BlitValueToBuffer(
+        proc->InitValue(), state_type,
+        absl::MakeSpan(proc_states_.back().get(), state_size));
+  }
+
+  return Compile();
+}
+
+absl::Status FusedProcJit::ComputeSchedule() {
+  // Find the endpoints of each internal channel, rejecting anything which
+  // isn't a single unconditional send and receive.
+  absl::flat_hash_map<int64_t, Proc*> senders;
+  absl::flat_hash_map<int64_t, Proc*> receivers;
+  for (const std::unique_ptr<Proc>& proc : package_->procs()) {
+    for (Node* node : proc->nodes()) {
+      int64_t channel_id;
+      absl::flat_hash_map<int64_t, Proc*>* endpoints;
+      if (node->Is<Send>()) {
+        channel_id = node->As<Send>()->channel_id();
+        endpoints = &senders;
+      } else if (node->Is<Receive>()) {
+        channel_id = node->As<Receive>()->channel_id();
+        endpoints = &receivers;
+      } else if (node->Is<SendIf>() || node->Is<ReceiveIf>()) {
+        channel_id = node->Is<SendIf>() ? node->As<SendIf>()->channel_id()
+                                        : node->As<ReceiveIf>()->channel_id();
+        if (channel_buffers_.contains(channel_id)) {
+          return absl::UnimplementedError(absl::StrFormat(
+              "Conditional channel operation %s on internal channel %d can "
+              "not be statically scheduled.",
+              node->GetName(), channel_id));
+        }
+        continue;
+      } else {
+        continue;
+      }
+      if (!channel_buffers_.contains(channel_id)) {
+        continue;
+      }
+      if (!endpoints->insert({channel_id, proc.get()}).second) {
+        return absl::UnimplementedError(absl::StrFormat(
+            "Internal channel %d has multiple %s operations.", channel_id,
+            node->Is<Send>() ? "send" : "receive"));
+      }
+    }
+  }
+
+  // Edges run from producer to consumer for channels which start out empty.
+  absl::flat_hash_map<Proc*, std::vector<Proc*>> successors;
+  absl::flat_hash_map<Proc*, int64_t> in_degree;
+  for (const auto& [channel_id, buffer] : channel_buffers_) {
+    if (!senders.contains(channel_id) || !receivers.contains(channel_id)) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Internal channel %d must have exactly one send and one receive.",
+          channel_id));
+    }
+    if (buffer->count > 0) {
+      continue;
+    }
+    Proc* producer = senders.at(channel_id);
+    Proc* consumer = receivers.at(channel_id);
+    if (producer == consumer) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Proc %s receives from channel %d which it feeds, and the channel "
+          "has no initial values.",
+          producer->name(), channel_id));
+    }
+    successors[producer].push_back(consumer);
+    in_degree[consumer]++;
+  }
+
+  // Kahn's algorithm, breaking ties by package order for determinism.
+  std::deque<Proc*> ready;
+  for (const std::unique_ptr<Proc>& proc : package_->procs()) {
+    if (in_degree[proc.get()] == 0) {
+      ready.push_back(proc.get());
+    }
+  }
+  while (!ready.empty()) {
+    Proc* proc = ready.front();
+    ready.pop_front();
+    schedule_.push_back(proc);
+    for (Proc* successor : successors[proc]) {
+      if (--in_degree[successor] == 0) {
+        ready.push_back(successor);
+      }
+    }
+  }
+  if (schedule_.size() != package_->procs().size()) {
+    return absl::UnimplementedError(
+        "Proc network contains a cycle of channels without initial values "
+        "and can not be statically scheduled.");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FusedProcJit::Compile() {
+  llvm::LLVMContext* context = orc_jit_->GetContext();
+  std::unique_ptr<llvm::Module> module = orc_jit_->NewModule("fused_procs");
+  llvm::Type* i8_ptr_type =
+      llvm::PointerType::get(llvm::Type::getInt8Ty(*context), 0);
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(*context);
+
+  absl::flat_hash_map<int64_t, FusedProcBuilderVisitor::ChannelAddresses>
+      internal_channels;
+  for (const auto& [channel_id, buffer] : channel_buffers_) {
+    internal_channels[channel_id] = {&buffer->head, &buffer->count,
+                                     buffer->capacity, buffer->data.get()};
+  }
+
+  // Each proc is built as in IrJit (taking an arg pointer array, a state
+  // output pointer, and user data), but with internal linkage so that LLVM can
+  // inline it into the tick function.
+  llvm::ArrayType* arg_array_type = llvm::ArrayType::get(i8_ptr_type, 2);
+  std::vector<llvm::Function*> proc_functions;
+  for (Proc* proc : schedule_) {
+    llvm::Type* state_type = type_converter_->ConvertToLlvmType(
+        FunctionBuilderVisitor::GetEffectiveReturnValue(proc)->GetType());
+    llvm::FunctionType* function_type = llvm::FunctionType::get(
+        llvm::Type::getVoidTy(*context),
+        {llvm::PointerType::get(arg_array_type, 0),
+         llvm::PointerType::get(state_type, 0), i64_type},
+        /*isVarArg=*/false);
+    llvm::Function* function = llvm::Function::Create(
+        function_type, llvm::GlobalValue::InternalLinkage,
+        absl::StrFormat("%s::%s", package_->name(), proc->name()),
+        module.get());
+    XLS_RETURN_IF_ERROR(FusedProcBuilderVisitor::Visit(
+        module.get(), function, proc, type_converter_.get(), queue_mgr_.get(),
+        &RecvFn, &SendFn, &internal_channels));
+    proc_functions.push_back(function);
+  }
+
+  // The tick function: void tick(i8** states, i64 user_data).
+  std::string tick_name = absl::StrFormat("%s::__fused_tick", package_->name());
+  llvm::FunctionType* tick_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(*context),
+      {llvm::PointerType::get(i8_ptr_type, 0), i64_type}, /*isVarArg=*/false);
+  llvm::Function* tick = llvm::Function::Create(
+      tick_type, llvm::GlobalValue::ExternalLinkage, tick_name, module.get());
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(*context, "entry", tick));
+  llvm::Value* zero = llvm::ConstantInt::get(i64_type, 0);
+  llvm::Value* one = llvm::ConstantInt::get(i64_type, 1);
+  llvm::AllocaInst* args = builder.CreateAlloca(arg_array_type);
+  for (int64_t i = 0; i < proc_functions.size(); ++i) {
+    llvm::Value* state = builder.CreateLoad(
+        i8_ptr_type, builder.CreateGEP(i8_ptr_type, tick->getArg(0),
+                                       llvm::ConstantInt::get(i64_type, i)));
+    // As in the other proc runtimes, the token argument is unused and the
+    // state is updated in place.
+    builder.CreateStore(llvm::ConstantPointerNull::get(
+                            llvm::cast<llvm::PointerType>(i8_ptr_type)),
+                        builder.CreateGEP(arg_array_type, args, {zero, zero}));
+    builder.CreateStore(state,
+                        builder.CreateGEP(arg_array_type, args, {zero, one}));
+    llvm::Function* function = proc_functions[i];
+    builder.CreateCall(
+        function,
+        {args,
+         builder.CreateBitCast(state,
+                               function->getFunctionType()->getParamType(1)),
+         tick->getArg(1)});
+  }
+  builder.CreateRetVoid();
+
+  XLS_RETURN_IF_ERROR(orc_jit_->CompileModule(std::move(module)));
+  XLS_ASSIGN_OR_RETURN(llvm::JITTargetAddress address,
+                       orc_jit_->LoadSymbol(tick_name));
+  tick_fn_ = reinterpret_cast<TickFunctionType>(address);
+  return absl::OkStatus();
+}
+
+void FusedProcJit::RecvFn(JitChannelQueue* queue, Receive* recv,
+                          uint8_t* data, int64_t data_bytes,
+                          void* user_data) {
+  FusedProcJit* jit = reinterpret_cast<FusedProcJit*>(user_data);
+  if (queue->Empty()) {
+    queue->RecordRecvStall();
+    if (!jit->underflow_channel_.has_value()) {
+      jit->underflow_channel_ = queue->channel_id();
+    }
+    memset(data, 0, data_bytes);
+    return;
+  }
+  queue->Recv(data, data_bytes);
+}
+
+void FusedProcJit::SendFn(JitChannelQueue* queue, Send* send, uint8_t* data,
+                          int64_t data_bytes, void* user_data) {
+  FusedProcJit* jit = reinterpret_cast<FusedProcJit*>(user_data);
+  if (queue->Full()) {
+    // The fused tick can't suspend, so the value is dropped and the tick fails.
+    queue->RecordSendStall();
+    if (!jit->overflow_channel_.has_value()) {
+      jit->overflow_channel_ = queue->channel_id();
+    }
+    return;
+  }
+  queue->Send(data, data_bytes);
+}
+
+absl::Status FusedProcJit::Tick() {
+  underflow_channel_ = absl::nullopt;
+  overflow_channel_ = absl::nullopt;
+  tick_fn_(proc_state_ptrs_.data(), this);
+  if (underflow_channel_.has_value()) {
+    return absl::UnavailableError(absl::StrFormat(
+        "Proc network received from empty external channel %d.",
+        *underflow_channel_));
+  }
+  if (overflow_channel_.has_value()) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Proc network sent to full external channel %d.",
+        *overflow_channel_));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FusedProcJit::EnqueueValueToChannel(Channel* channel,
+                                                 const Value& value) {
+  XLS_RET_CHECK_EQ(package_->GetTypeForValue(value), channel->type());
+  if (channel_buffers_.contains(channel->id())) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Channel %s is internal to the fused proc network.", channel->name()));
+  }
+  int64_t size = type_converter_->GetTypeByteSize(channel->type());
+  auto buffer = absl::make_unique<uint8_t[]>(size);
+  ir_runtime_->BlitValueToBuffer(value, channel->type(),
+                                 absl::MakeSpan(buffer.get(), size));
+
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr()->GetQueueById(channel->id()));
+  queue->Send(buffer.get(), size);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> FusedProcJit::DequeueValueFromChannel(Channel* channel) {
+  if (channel_buffers_.contains(channel->id())) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Channel %s is internal to the fused proc network.", channel->name()));
+  }
+  int64_t size = type_converter_->GetTypeByteSize(channel->type());
+  auto buffer = absl::make_unique<uint8_t[]>(size);
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr()->GetQueueById(channel->id()));
+  XLS_RET_CHECK(!queue->Empty());
+  queue->Recv(buffer.get(), size);
+  return ir_runtime_->UnpackBuffer(buffer.get(), channel->type());
+}
+
+}  // namespace xls
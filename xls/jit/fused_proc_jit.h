@@ -0,0 +1,130 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef XLS_JIT_FUSED_PROC_JIT_H_
+#define XLS_JIT_FUSED_PROC_JIT_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/ir/package.h"
+#include "xls/ir/proc.h"
+#include "xls/ir/value.h"
+#include "xls/jit/jit_channel_queue.h"
+#include "xls/jit/jit_runtime.h"
+#include "xls/jit/llvm_type_converter.h"
+#include "xls/jit/orc_jit.h"
+
+namespace xls {
+
+// FusedProcJit compiles every proc in a package into a single LLVM module
+// along with a "tick" function which runs one activation of each proc in a
+// static schedule. Channels between procs in the network become fixed-size
+// ring buffers which the generated code reads and writes directly, so there
+// are no callbacks, no locking, and LLVM is free to inline and optimize across
+// proc boundaries. Channels with an endpoint outside the network (i.e.,
+// receive-only or send-only channels) are still accessed through their
+// JitChannelQueues.
+//
+// A static schedule requires the network to be synchronous dataflow with unit
+// rates: every internal channel must have exactly one unconditional send and
+// one unconditional receive. Procs are ordered so that the producer of each
+// channel without initial values runs before its consumer; a cycle of such
+// channels can not be scheduled. Networks outside these restrictions are
+// rejected with an Unimplemented error and should use SerialProcRuntime or
+// ParallelProcRuntime instead.
+//
+// For networks which can be scheduled, results are identical to those of the
+// other proc runtimes.
+class FusedProcJit {
+ public:
+  static absl::StatusOr<std::unique_ptr<FusedProcJit>> Create(
+      Package* package, int64_t opt_level = 3);
+
+  // Execute one cycle of every proc in the network. Returns an error if a proc
+  // received from an empty external channel or sent to a full one (a fused
+  // network can't block), in which case the network state is unspecified.
+  absl::Status Tick();
+
+  Package* package() { return package_; }
+
+  // Holds the queues for the network's external channels. The queues of
+  // internal channels are unused.
+  JitChannelQueueManager* queue_mgr() { return queue_mgr_.get(); }
+
+  // Enqueues/dequeues a value into/from an external channel.
+  absl::Status EnqueueValueToChannel(Channel* channel, const Value& value);
+  absl::StatusOr<Value> DequeueValueFromChannel(Channel* channel);
+
+  // Returns the order in which procs are evaluated in each tick.
+  absl::Span<Proc* const> schedule() const { return schedule_; }
+
+ private:
+  // Host-side storage for an internal channel. The generated code refers to
+  // these fields by address.
+  struct ChannelBuffer {
+    int64_t head = 0;
+    int64_t count = 0;
+    int64_t capacity;
+    int64_t element_size;
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  explicit FusedProcJit(Package* package) : package_(package) {}
+
+  // Validates the network, allocates channel buffers, and computes the
+  // schedule.
+  absl::Status Init(int64_t opt_level);
+  absl::Status ComputeSchedule();
+  absl::Status Compile();
+
+  // Send/receive handlers for external channels, passed to the generated code.
+  static void RecvFn(JitChannelQueue* queue, Receive* recv, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+  static void SendFn(JitChannelQueue* queue, Send* send, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+
+  Package* package_;
+  std::unique_ptr<OrcJit> orc_jit_;
+  std::unique_ptr<LlvmTypeConverter> type_converter_;
+  std::unique_ptr<JitRuntime> ir_runtime_;
+  std::unique_ptr<JitChannelQueueManager> queue_mgr_;
+
+  // Keyed by channel ID; only internal channels are present.
+  absl::flat_hash_map<int64_t, std::unique_ptr<ChannelBuffer>> channel_buffers_;
+
+  std::vector<Proc*> schedule_;
+
+  // Carried state of each proc, in schedule order.
+  std::vector<std::unique_ptr<uint8_t[]>> proc_states_;
+  std::vector<uint8_t*> proc_state_ptrs_;
+
+  // Set by RecvFn if a receive was attempted on an empty external channel.
+  absl::optional<int64_t> underflow_channel_;
+
+  // Set by SendFn if a send was attempted on a full external channel.
+  absl::optional<int64_t> overflow_channel_;
+
+  using TickFunctionType = void (*)(uint8_t* const* states, void* user_data);
+  TickFunctionType tick_fn_ = nullptr;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_FUSED_PROC_JIT_H_
@@ -0,0 +1,276 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/fused_proc_jit.h"
+
+#include "absl/strings/str_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/jit/jit_channel_queue.h"
+#include "xls/jit/serial_proc_runtime.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+template <typename T>
+void EnqueueData(JitChannelQueue* queue, T data) {
+  queue->Send(reinterpret_cast<uint8_t*>(&data), sizeof(T));
+}
+
+template <typename T>
+T DequeueData(JitChannelQueue* queue) {
+  T data;
+  queue->Recv(reinterpret_cast<uint8_t*>(&data), sizeof(T));
+  return data;
+}
+
+// Procs are declared consumer-first so the schedule must reorder them.
+TEST(FusedProcJitTest, SimpleNetwork) {
+  constexpr int kNumCycles = 4;
+  const std::string kIrText = R"(
+package p
+
+chan a_in(bits[32], id=0, kind=streaming, ops=receive_only, metadata="")
+chan a_to_b(bits[32], id=1, kind=streaming, ops=send_receive, metadata="")
+chan b_out(bits[32], id=2, kind=streaming, ops=send_only, metadata="")
+
+proc b(my_token: token, state: (), init=()) {
+  literal.100: bits[32] = literal(value=3)
+  receive.200: (token, bits[32]) = receive(my_token, channel_id=1)
+  tuple_index.300: token = tuple_index(receive.200, index=0)
+  tuple_index.400: bits[32] = tuple_index(receive.200, index=1)
+  umul.500: bits[32] = umul(literal.100, tuple_index.400)
+  send.600: token = send(tuple_index.300, umul.500, channel_id=2)
+  next (send.600, state)
+}
+
+proc a(my_token: token, state: (), init=()) {
+  literal.1: bits[32] = literal(value=2)
+  receive.2: (token, bits[32]) = receive(my_token, channel_id=0)
+  tuple_index.3: token = tuple_index(receive.2, index=0)
+  tuple_index.4: bits[32] = tuple_index(receive.2, index=1)
+  umul.5: bits[32] = umul(literal.1, tuple_index.4)
+  send.6: token = send(tuple_index.3, umul.5, channel_id=1)
+  next (send.6, state)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, FusedProcJit::Create(p.get()));
+  ASSERT_EQ(jit->schedule().size(), 2);
+  EXPECT_EQ(jit->schedule()[0]->name(), "a");
+  EXPECT_EQ(jit->schedule()[1]->name(), "b");
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto input_queue,
+                           jit->queue_mgr()->GetQueueById(0));
+  XLS_ASSERT_OK_AND_ASSIGN(auto output_queue,
+                           jit->queue_mgr()->GetQueueById(2));
+  for (int i = 0; i < kNumCycles; i++) {
+    EnqueueData(input_queue, i);
+    XLS_ASSERT_OK(jit->Tick());
+  }
+  for (int i = 0; i < kNumCycles; i++) {
+    EXPECT_EQ(DequeueData<int>(output_queue), i * 6);
+  }
+  EXPECT_TRUE(output_queue->Empty());
+}
+
+// A pipeline of stateful stages should produce exactly the same output as the
+// serial runtime.
+TEST(FusedProcJitTest, LongPipelineMatchesSerial) {
+  constexpr int kNumStages = 16;
+  constexpr int kNumCycles = 100;
+  std::string ir_text = "package p\n\n";
+  for (int i = 0; i <= kNumStages; ++i) {
+    absl::StrAppendFormat(
+        &ir_text,
+        "chan c%d(bits[32], id=%d, kind=streaming, ops=%s, metadata=\"\")\n",
+        i, i,
+        i == 0 ? "receive_only"
+               : (i == kNumStages ? "send_only" : "send_receive"));
+  }
+  for (int i = 0; i < kNumStages; ++i) {
+    absl::StrAppendFormat(&ir_text, R"(
+proc s%d(tkn: token, state: bits[32], init=%d) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=%d)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  sum: bits[32] = add(data, state)
+  snd: token = send(rcv_tkn, sum, channel_id=%d)
+  inc: bits[32] = literal(value=%d)
+  next_state: bits[32] = add(state, inc)
+  next (snd, next_state)
+}
+)",
+                          i, i, i, i + 1, i + 1);
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto serial_p, Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(auto fused_p, Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(auto serial,
+                           SerialProcRuntime::Create(serial_p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto fused, FusedProcJit::Create(fused_p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto serial_in,
+                           serial->queue_mgr()->GetQueueById(0));
+  XLS_ASSERT_OK_AND_ASSIGN(auto fused_in, fused->queue_mgr()->GetQueueById(0));
+  for (int i = 0; i < kNumCycles; ++i) {
+    EnqueueData(serial_in, i * 7);
+    EnqueueData(fused_in, i * 7);
+    XLS_ASSERT_OK(serial->Tick());
+    XLS_ASSERT_OK(fused->Tick());
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto serial_out,
+                           serial->queue_mgr()->GetQueueById(kNumStages));
+  XLS_ASSERT_OK_AND_ASSIGN(auto fused_out,
+                           fused->queue_mgr()->GetQueueById(kNumStages));
+  for (int i = 0; i < kNumCycles; ++i) {
+    ASSERT_FALSE(serial_out->Empty());
+    ASSERT_FALSE(fused_out->Empty());
+    EXPECT_EQ(DequeueData<int>(fused_out), DequeueData<int>(serial_out))
+        << "cycle " << i;
+  }
+  EXPECT_TRUE(fused_out->Empty());
+}
+
+// A proc feeding itself through a channel with initial values; the sequence of
+// values is interleaved as in the other runtimes' tests.
+TEST(FusedProcJitTest, ChannelInitValues) {
+  const std::string kIrText = R"(
+package p
+
+chan state(bits[32], initial_values={42, 55, 100}, id=0, kind=streaming,
+           ops=send_receive, metadata="")
+chan out(bits[32], id=1, kind=streaming, ops=send_only, metadata="")
+
+proc iota(tkn: token, nil_state: (), init=()) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=0)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  value: bits[32] = tuple_index(rcv, index=1)
+  one: bits[32] = literal(value=1)
+  next_value: bits[32] = add(value, one)
+  out_send: token = send(tkn, value, channel_id=1)
+  state_send: token = send(rcv_tkn, next_value, channel_id=0)
+  after: token = after_all(out_send, state_send)
+  next (after, nil_state)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, FusedProcJit::Create(p.get()));
+  for (int64_t i = 0; i < 6; ++i) {
+    XLS_ASSERT_OK(jit->Tick());
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * out, p->GetChannel(1));
+  std::vector<Value> outputs;
+  for (int64_t i = 0; i < 6; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(Value v, jit->DequeueValueFromChannel(out));
+    outputs.push_back(v);
+  }
+  EXPECT_THAT(outputs,
+              ElementsAre(Value(UBits(42, 32)), Value(UBits(55, 32)),
+                          Value(UBits(100, 32)), Value(UBits(43, 32)),
+                          Value(UBits(56, 32)), Value(UBits(101, 32))));
+}
+
+TEST(FusedProcJitTest, EmptyExternalChannel) {
+  const std::string kIrText = R"(
+package p
+
+chan in(bits[32], id=0, kind=streaming, ops=receive_only, metadata="")
+chan out(bits[32], id=1, kind=streaming, ops=send_only, metadata="")
+
+proc a(tkn: token, state: (), init=()) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=0)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  snd: token = send(rcv_tkn, data, channel_id=1)
+  next (snd, state)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, FusedProcJit::Create(p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * in, p->GetChannel(0));
+  XLS_ASSERT_OK_AND_ASSIGN(Channel * out, p->GetChannel(1));
+  XLS_ASSERT_OK(jit->EnqueueValueToChannel(in, Value(UBits(123, 32))));
+  XLS_ASSERT_OK(jit->Tick());
+  EXPECT_THAT(jit->DequeueValueFromChannel(out),
+              IsOkAndHolds(Value(UBits(123, 32))));
+  EXPECT_THAT(jit->Tick(), StatusIs(absl::StatusCode::kUnavailable));
+}
+
+TEST(FusedProcJitTest, UnschedulableCycle) {
+  // Each proc waits on the other with no initial data; this deadlocks in any
+  // runtime, and can't be statically scheduled.
+  const std::string kIrText = R"(
+package p
+
+chan a_to_b(bits[32], id=0, kind=streaming, ops=send_receive, metadata="")
+chan b_to_a(bits[32], id=1, kind=streaming, ops=send_receive, metadata="")
+
+proc a(tkn: token, state: (), init=()) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=1)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  snd: token = send(rcv_tkn, data, channel_id=0)
+  next (snd, state)
+}
+
+proc b(tkn: token, state: (), init=()) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=0)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  snd: token = send(rcv_tkn, data, channel_id=1)
+  next (snd, state)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+  EXPECT_THAT(FusedProcJit::Create(p.get()),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("can not be statically scheduled")));
+}
+
+TEST(FusedProcJitTest, ConditionalInternalChannel) {
+  const std::string kIrText = R"(
+package p
+
+chan first(bits[32], id=1, kind=streaming, ops=send_receive, metadata="")
+
+proc a(my_token: token, state: bits[1], init=0) {
+  literal.1: bits[32] = literal(value=1)
+  send_if.2: token = send_if(my_token, state, literal.1, channel_id=1)
+  next (send_if.2, state)
+}
+
+proc b(my_token: token, state: (), init=()) {
+  receive.101: (token, bits[32]) = receive(my_token, channel_id=1)
+  tuple_index.102: token = tuple_index(receive.101, index=0)
+  next (tuple_index.102, state)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+  EXPECT_THAT(FusedProcJit::Create(p.get()),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("Conditional channel operation")));
+}
+
+}  // namespace
+}  // namespace xls
@@ -14,53 +14,42 @@
 
 #include "xls/jit/ir_jit.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <random>
+#include <thread>  // NOLINT(build/c++11)
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/types/span.h"
-#include "llvm/include/llvm-c/Target.h"
-#include "llvm/include/llvm/Analysis/TargetLibraryInfo.h"
-#include "llvm/include/llvm/Analysis/TargetTransformInfo.h"
-#include "llvm/include/llvm/ExecutionEngine/ExecutionEngine.h"
-#include "llvm/include/llvm/ExecutionEngine/JITSymbol.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/Core.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/ExecutionUtils.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/IRCompileLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/IRTransformLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/Layer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
-#include "llvm/include/llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/include/llvm/IR/BasicBlock.h"
 #include "llvm/include/llvm/IR/Constants.h"
 #include "llvm/include/llvm/IR/DerivedTypes.h"
 #include "llvm/include/llvm/IR/Instructions.h"
 #include "llvm/include/llvm/IR/Intrinsics.h"
 #include "llvm/include/llvm/IR/LLVMContext.h"
-#include "llvm/include/llvm/IR/LegacyPassManager.h"
 #include "llvm/include/llvm/IR/Module.h"
 #include "llvm/include/llvm/IR/Value.h"
-#include "llvm/include/llvm/Support/CodeGen.h"
-#include "llvm/include/llvm/Support/DynamicLibrary.h"
 #include "llvm/include/llvm/Support/raw_ostream.h"
-#include "llvm/include/llvm/Target/TargetMachine.h"
-#include "llvm/include/llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "xls/codegen/vast.h"
-#include "xls/common/logging/log_lines.h"
 #include "xls/common/logging/logging.h"
-#include "xls/common/logging/vlog_is_on.h"
 #include "xls/common/math_util.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/common/trace.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/format_preference.h"
 #include "xls/ir/keyword_args.h"
@@ -76,27 +65,42 @@
 namespace xls {
 namespace {
 
-absl::once_flag once;
-void OnceInit() {
-  LLVMInitializeNativeTarget();
-  LLVMInitializeNativeAsmPrinter();
-  LLVMInitializeNativeAsmParser();
+// Returns whether "function" or any function it calls contains an assert.
+bool CallsAssert(Function* function,
+                 absl::flat_hash_set<Function*>* visited) {
+  if (!visited->insert(function).second) {
+    return false;
+  }
+  for (Node* node : function->nodes()) {
+    Function* callee = nullptr;
+    if (node->Is<Assert>()) {
+      return true;
+    } else if (node->Is<Invoke>()) {
+      callee = node->As<Invoke>()->to_apply();
+    } else if (node->Is<Map>()) {
+      callee = node->As<Map>()->to_apply();
+    } else if (node->Is<CountedFor>()) {
+      callee = node->As<CountedFor>()->body();
+    } else if (node->Is<DynamicCountedFor>()) {
+      callee = node->As<DynamicCountedFor>()->body();
+    }
+    if (callee != nullptr && CallsAssert(callee, visited)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 }  // namespace
 
-IrJit::~IrJit() {
-  if (auto err = execution_session_.endSession()) {
-    execution_session_.reportError(std::move(err));
-  }
-}
-
-absl::StatusOr<std::unique_ptr<IrJit>> IrJit::Create(Function* xls_function,
-                                                     int64_t opt_level) {
-  absl::call_once(once, OnceInit);
+IrJit::~IrJit() = default;
 
+absl::StatusOr<std::unique_ptr<IrJit>> IrJit::Create(
+    Function* xls_function, int64_t opt_level,
+    absl::optional<std::filesystem::path> object_cache_dir) {
   auto jit = absl::WrapUnique(new IrJit(xls_function, opt_level));
-  XLS_RETURN_IF_ERROR(jit->Init());
+  XLS_TRACE_SPAN("JitCompile", xls_function->name());
+  XLS_RETURN_IF_ERROR(jit->Init(std::move(object_cache_dir)));
   auto visit_fn = [&jit](llvm::Module* module, llvm::Function* llvm_function,
                          bool generate_packed) {
     return FunctionBuilderVisitor::Visit(
@@ -107,14 +111,29 @@ absl::StatusOr<std::unique_ptr<IrJit>> IrJit::Create(Function* xls_function,
   return jit;
 }
 
+absl::StatusOr<std::unique_ptr<IrJit>> IrJit::CreateInstrumented(
+    Function* xls_function, int64_t opt_level) {
+  auto jit = absl::WrapUnique(new IrJit(xls_function, opt_level));
+  XLS_TRACE_SPAN("JitCompile", xls_function->name());
+  jit->node_counters_ = std::make_unique<JitNodeCounters>();
+  XLS_RETURN_IF_ERROR(jit->Init(/*object_cache_dir=*/absl::nullopt));
+  auto visit_fn = [&jit](llvm::Module* module, llvm::Function* llvm_function,
+                         bool generate_packed) {
+    return FunctionBuilderVisitor::Visit(
+        module, llvm_function, jit->xls_function_, jit->type_converter_.get(),
+        /*is_top=*/true, generate_packed, jit->node_counters_.get());
+  };
+  XLS_RETURN_IF_ERROR(jit->Compile(visit_fn));
+  return jit;
+}
+
 absl::StatusOr<std::unique_ptr<IrJit>> IrJit::CreateProc(
     Proc* proc, JitChannelQueueManager* queue_mgr,
     ProcBuilderVisitor::RecvFnT recv_fn, ProcBuilderVisitor::SendFnT send_fn,
-    int64_t opt_level) {
-  absl::call_once(once, OnceInit);
-
+    int64_t opt_level, absl::optional<std::filesystem::path> object_cache_dir) {
   auto jit = absl::WrapUnique(new IrJit(proc, opt_level));
-  XLS_RETURN_IF_ERROR(jit->Init());
+  XLS_TRACE_SPAN("JitCompile", proc->name());
+  XLS_RETURN_IF_ERROR(jit->Init(std::move(object_cache_dir)));
   auto visit_fn = [&jit, queue_mgr, recv_fn, send_fn](
                       llvm::Module* module, llvm::Function* llvm_function,
                       bool generate_packed) {
@@ -126,155 +145,149 @@ absl::StatusOr<std::unique_ptr<IrJit>> IrJit::CreateProc(
   return jit;
 }
 
+absl::StatusOr<std::string> IrJit::CompileToObject(
+    Function* xls_function, absl::string_view symbol_name, int64_t opt_level) {
+#ifdef ABSL_HAVE_MEMORY_SANITIZER
+  // The generated code would call into this process's sanitizer runtime by
+  // address.
+  return absl::UnimplementedError(
+      "Ahead-of-time compilation is not supported under MSan");
+#else
+  XLS_TRACE_SPAN("AotCompile", xls_function->name());
+  bool is_identifier =
+      !symbol_name.empty() && !absl::ascii_isdigit(symbol_name[0]);
+  for (char c : symbol_name) {
+    is_identifier &= absl::ascii_isalnum(c) || c == '_';
+  }
+  if (!is_identifier) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Symbol name \"%s\" is not a C identifier", symbol_name));
+  }
+  absl::flat_hash_set<Function*> visited;
+  if (CallsAssert(xls_function, &visited)) {
+    // Failures would call into this process's JitEventBuffer by address.
+    return absl::UnimplementedError(absl::StrFormat(
+        "Function %s contains assertions, which ahead-of-time compilation "
+        "does not support",
+        xls_function->name()));
+  }
+  if (xls_function->return_value()->GetType()->GetFlatBitCount() == 0) {
+    // The packed entry point has no output parameter in this case.
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Function %s has a zero-width result", xls_function->name()));
+  }
+
+  auto jit = absl::WrapUnique(new IrJit(xls_function, opt_level));
+  XLS_ASSIGN_OR_RETURN(jit->orc_jit_, OrcJit::CreateForObjectFiles(opt_level));
+  jit->InitRuntime();
+  auto visit_fn = [&jit](llvm::Module* module, llvm::Function* llvm_function,
+                         bool generate_packed) {
+    return FunctionBuilderVisitor::Visit(
+        module, llvm_function, jit->xls_function_, jit->type_converter_.get(),
+        /*is_top=*/true, generate_packed);
+  };
+  std::unique_ptr<llvm::Module> module = jit->orc_jit_->NewModule(symbol_name);
+  XLS_RETURN_IF_ERROR(jit->CompilePackedViewFunction(visit_fn, module.get()));
+
+  llvm::Function* entry = module->getFunction(absl::StrFormat(
+      "%s::%s_packed", xls_function->package()->name(), xls_function->name()));
+  XLS_RET_CHECK(entry != nullptr);
+  // Only the entry point is exported, so objects for functions (and their
+  // callees) of the same name in different packages can be linked together.
+  for (llvm::Function& function : *module) {
+    if (&function != entry && !function.isDeclaration()) {
+      function.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+  for (llvm::GlobalVariable& global : module->globals()) {
+    if (!global.isDeclaration()) {
+      global.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+  entry->setName(llvm::StringRef(symbol_name.data(), symbol_name.size()));
+  XLS_RET_CHECK_EQ(std::string(entry->getName()), symbol_name);
+  return jit->orc_jit_->CompileModuleToObject(std::move(module));
+#endif  // ABSL_HAVE_MEMORY_SANITIZER
+}
+
 absl::Status IrJit::Compile(VisitFn visit_fn) {
-  llvm::LLVMContext* bare_context = context_.getContext();
-  auto module = std::make_unique<llvm::Module>("the_module", *bare_context);
-  module->setDataLayout(data_layout_);
+  absl::Time start = absl::Now();
+  std::unique_ptr<llvm::Module> module = orc_jit_->NewModule("the_module");
   XLS_RETURN_IF_ERROR(CompileFunction(visit_fn, module.get()));
   XLS_RETURN_IF_ERROR(CompilePackedViewFunction(visit_fn, module.get()));
-  llvm::Error error = transform_layer_->add(
-      dylib_, llvm::orc::ThreadSafeModule(std::move(module), context_));
-  if (error) {
-    return absl::UnknownError(absl::StrFormat(
-        "Error compiling converted IR: %s", llvm::toString(std::move(error))));
-  }
-
-  auto load_symbol = [this](const std::string& function_name)
-      -> absl::StatusOr<llvm::JITTargetAddress> {
-    llvm::Expected<llvm::JITEvaluatedSymbol> symbol =
-        execution_session_.lookup(&dylib_, function_name);
-    if (!symbol) {
-      return absl::InternalError(
-          absl::StrFormat("Could not find start symbol \"%s\": %s",
-                          function_name, llvm::toString(symbol.takeError())));
+  XLS_RETURN_IF_ERROR(CompileBatchFunction(module.get()));
+  bool has_packed_ticks = false;
+  if (xls_function_->IsProc()) {
+    XLS_RETURN_IF_ERROR(CompileTicksFunction(module.get(), /*packed=*/false));
+    has_packed_ticks = GetPackedReturnTypeSize() != 0;
+    if (has_packed_ticks) {
+      XLS_RETURN_IF_ERROR(CompileTicksFunction(module.get(), /*packed=*/true));
     }
-    return symbol->getAddress();
-  };
+  }
+  absl::Duration ir_generation_time = absl::Now() - start;
+  XLS_RETURN_IF_ERROR(orc_jit_->CompileModule(std::move(module)));
 
   std::string function_name = absl::StrFormat(
       "%s::%s", xls_function_->package()->name(), xls_function_->name());
-  XLS_ASSIGN_OR_RETURN(auto fn_address, load_symbol(function_name));
+  XLS_ASSIGN_OR_RETURN(auto fn_address, orc_jit_->LoadSymbol(function_name));
   invoker_ = reinterpret_cast<JitFunctionType>(fn_address);
 
+  XLS_ASSIGN_OR_RETURN(fn_address,
+                       orc_jit_->LoadSymbol(function_name + "_batch"));
+  batch_invoker_ = reinterpret_cast<BatchJitFunctionType>(fn_address);
+
+  if (xls_function_->IsProc()) {
+    XLS_ASSIGN_OR_RETURN(fn_address,
+                         orc_jit_->LoadSymbol(function_name + "_ticks"));
+    ticks_invoker_ = reinterpret_cast<TicksJitFunctionType>(fn_address);
+  }
+
   absl::StrAppend(&function_name, "_packed");
-  XLS_ASSIGN_OR_RETURN(fn_address, load_symbol(function_name));
+  XLS_ASSIGN_OR_RETURN(fn_address, orc_jit_->LoadSymbol(function_name));
   packed_invoker_ = reinterpret_cast<PackedJitFunctionType>(fn_address);
 
+  if (has_packed_ticks) {
+    XLS_ASSIGN_OR_RETURN(fn_address,
+                         orc_jit_->LoadSymbol(function_name + "_ticks"));
+    packed_ticks_invoker_ = reinterpret_cast<TicksJitFunctionType>(fn_address);
+  }
+
+  // Looking up the symbols materializes (optimizes and generates code for)
+  // the module, so the compilation is complete.
+  compile_stats_ = orc_jit_->optimization_stats();
+  compile_stats_.ir_generation_time = ir_generation_time;
+  compile_stats_.total_time = absl::Now() - start;
+  XLS_VLOG(1) << "JIT compiled " << xls_function_->name() << ": "
+              << JitCompileStatsToString(compile_stats_);
   return absl::OkStatus();
 }
 
 IrJit::IrJit(FunctionBase* xls_function, int64_t opt_level)
-    : context_(std::make_unique<llvm::LLVMContext>()),
-      object_layer_(
-          execution_session_,
-          []() { return std::make_unique<llvm::SectionMemoryManager>(); }),
-      dylib_(execution_session_.createBareJITDylib("main")),
-      data_layout_(""),
-      xls_function_(xls_function),
+    : xls_function_(xls_function),
       opt_level_(opt_level),
-      invoker_(nullptr) {}
-
-llvm::Expected<llvm::orc::ThreadSafeModule> IrJit::Optimizer(
-    llvm::orc::ThreadSafeModule module,
-    const llvm::orc::MaterializationResponsibility& responsibility) {
-  llvm::Module* bare_module = module.getModuleUnlocked();
-
-  XLS_VLOG(2) << "Unoptimized module IR:";
-  XLS_VLOG(2).NoPrefix() << ir_runtime_->DumpToString(*bare_module);
-
-  llvm::TargetLibraryInfoImpl library_info(target_machine_->getTargetTriple());
-  llvm::PassManagerBuilder builder;
-  builder.OptLevel = opt_level_;
-  builder.LibraryInfo =
-      new llvm::TargetLibraryInfoImpl(target_machine_->getTargetTriple());
-
-  // The ostream and its buffer must be declared before the module_pass_manager
-  // because the destrutor of the pass manager calls flush on the ostream so
-  // these must be destructed *after* the pass manager. C++ guarantees that the
-  // destructors are called in reverse order the obects are declared.
-  llvm::SmallVector<char, 0> stream_buffer;
-  llvm::raw_svector_ostream ostream(stream_buffer);
-
-  llvm::legacy::PassManager module_pass_manager;
-  builder.populateModulePassManager(module_pass_manager);
-  module_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(
-      target_machine_->getTargetIRAnalysis()));
-
-  llvm::legacy::FunctionPassManager function_pass_manager(bare_module);
-  builder.populateFunctionPassManager(function_pass_manager);
-  function_pass_manager.doInitialization();
-  for (auto& function : *bare_module) {
-    function_pass_manager.run(function);
-  }
-  function_pass_manager.doFinalization();
-
-  bool dump_asm = false;
-  if (XLS_VLOG_IS_ON(3)) {
-    dump_asm = true;
-    if (target_machine_->addPassesToEmitFile(
-            module_pass_manager, ostream, nullptr, llvm::CGFT_AssemblyFile)) {
-      XLS_VLOG(3) << "Could not create ASM generation pass!";
-      dump_asm = false;
-    }
-  }
-
-  module_pass_manager.run(*bare_module);
-
-  XLS_VLOG(2) << "Optimized module IR:";
-  XLS_VLOG(2).NoPrefix() << ir_runtime_->DumpToString(*bare_module);
-
-  if (dump_asm) {
-    XLS_VLOG(3) << "Generated ASM:";
-    XLS_VLOG_LINES(3, std::string(stream_buffer.begin(), stream_buffer.end()));
-  }
-  return module;
+      invoker_(nullptr),
+      packed_invoker_(nullptr),
+      batch_invoker_(nullptr),
+      ticks_invoker_(nullptr),
+      packed_ticks_invoker_(nullptr) {}
+
+absl::Status IrJit::Init(
+    absl::optional<std::filesystem::path> object_cache_dir) {
+  XLS_ASSIGN_OR_RETURN(orc_jit_,
+                       OrcJit::Create(opt_level_, std::move(object_cache_dir)));
+  InitRuntime();
+  return absl::OkStatus();
 }
 
-absl::Status IrJit::Init() {
-  auto error_or_target_builder =
-      llvm::orc::JITTargetMachineBuilder::detectHost();
-  if (!error_or_target_builder) {
-    return absl::InternalError(
-        absl::StrCat("Unable to detect host: ",
-                     llvm::toString(error_or_target_builder.takeError())));
-  }
-
-  auto error_or_target_machine = error_or_target_builder->createTargetMachine();
-  if (!error_or_target_machine) {
-    return absl::InternalError(
-        absl::StrCat("Unable to create target machine: ",
-                     llvm::toString(error_or_target_machine.takeError())));
-  }
-  target_machine_ = std::move(error_or_target_machine.get());
-  data_layout_ = target_machine_->createDataLayout();
-  type_converter_ =
-      std::make_unique<LlvmTypeConverter>(context_.getContext(), data_layout_);
-
-  execution_session_.runSessionLocked([this]() {
-    dylib_.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            data_layout_.getGlobalPrefix())));
-  });
-
-  auto compiler = std::make_unique<llvm::orc::SimpleCompiler>(*target_machine_);
-  compile_layer_ = std::make_unique<llvm::orc::IRCompileLayer>(
-      execution_session_, object_layer_, std::move(compiler));
-
-  transform_layer_ = std::make_unique<llvm::orc::IRTransformLayer>(
-      execution_session_, *compile_layer_,
-      [this](llvm::orc::ThreadSafeModule module,
-             const llvm::orc::MaterializationResponsibility& responsibility) {
-        return Optimizer(std::move(module), responsibility);
-      });
-
-  ir_runtime_ =
-      std::make_unique<JitRuntime>(data_layout_, type_converter_.get());
-
-  return absl::OkStatus();
+void IrJit::InitRuntime() {
+  type_converter_ = std::make_unique<LlvmTypeConverter>(
+      orc_jit_->GetContext(), orc_jit_->GetDataLayout());
+  ir_runtime_ = std::make_unique<JitRuntime>(orc_jit_->GetDataLayout(),
+                                             type_converter_.get());
 }
 
 absl::Status IrJit::CompileFunction(VisitFn visit_fn, llvm::Module* module) {
-  llvm::LLVMContext* bare_context = context_.getContext();
+  llvm::LLVMContext* bare_context = orc_jit_->GetContext();
 
   // To return values > 64b in size, we need to copy them into a result buffer,
   // instead of returning a fixed-size result element.
@@ -293,6 +306,11 @@ absl::Status IrJit::CompileFunction(VisitFn visit_fn, llvm::Module* module) {
   for (const Param* param : xls_function_->params()) {
     arg_type_bytes_.push_back(
         type_converter_->GetTypeByteSize(param->GetType()));
+    arg_offsets_.push_back(arg_buffer_bytes_);
+    arg_buffer_bytes_ += RoundUpToNearest<int64_t>(arg_type_bytes_.back(),
+                                                   alignof(std::max_align_t));
+    arg_marshallers_.push_back(
+        ir_runtime_->CreateMarshaller(param->GetType()));
   }
 
   // Pass the last param as a pointer to the actual return type.
@@ -303,6 +321,7 @@ absl::Status IrJit::CompileFunction(VisitFn visit_fn, llvm::Module* module) {
   param_types.push_back(
       llvm::PointerType::get(llvm_return_type, /*AddressSpace=*/0));
   param_types.push_back(llvm::Type::getInt64Ty(*bare_context));
+  return_marshaller_ = ir_runtime_->CreateMarshaller(return_type);
   llvm::FunctionType* function_type = llvm::FunctionType::get(
       llvm::Type::getVoidTy(*bare_context),
       llvm::ArrayRef<llvm::Type*>(param_types.data(), param_types.size()),
@@ -329,36 +348,23 @@ absl::StatusOr<Value> IrJit::Run(absl::Span<const Value> args,
                         args.size(), xls_function_->params().size()));
   }
 
+  // Packing checks that each arg conforms to its parameter's type.
+  auto arg_storage = std::make_unique<uint8_t[]>(arg_buffer_bytes_);
+  absl::InlinedVector<uint8_t*, 8> arg_buffers(params.size());
   for (int i = 0; i < params.size(); i++) {
-    if (!ValueConformsToType(args[i], params[i]->GetType())) {
+    arg_buffers[i] = arg_storage.get() + arg_offsets_[i];
+    if (!arg_marshallers_[i].Pack(args[i], arg_buffers[i])) {
       return absl::InvalidArgumentError(absl::StrFormat(
           "Got argument %s for parameter %d which is not of type %s",
           args[i].ToString(), i, params[i]->GetType()->ToString()));
     }
   }
 
-  std::vector<std::unique_ptr<uint8_t[]>> unique_arg_buffers;
-  std::vector<uint8_t*> arg_buffers;
-  unique_arg_buffers.reserve(xls_function_->params().size());
-  arg_buffers.reserve(unique_arg_buffers.size());
-  std::vector<Type*> param_types;
-  for (const Param* param : xls_function_->params()) {
-    unique_arg_buffers.push_back(std::make_unique<uint8_t[]>(
-        type_converter_->GetTypeByteSize(param->GetType())));
-    arg_buffers.push_back(unique_arg_buffers.back().get());
-    param_types.push_back(param->GetType());
-  }
-
-  XLS_RETURN_IF_ERROR(
-      ir_runtime_->PackArgs(args, param_types, absl::MakeSpan(arg_buffers)));
-
   absl::InlinedVector<uint8_t, 16> outputs(return_type_bytes_);
-  invoker_(arg_buffers.data(), outputs.data(), user_data);
+  XLS_RETURN_IF_ERROR(RunWithEventBuffer(
+      [&] { invoker_(arg_buffers.data(), outputs.data(), user_data); }));
 
-  return ir_runtime_->UnpackBuffer(
-      outputs.data(),
-      FunctionBuilderVisitor::GetEffectiveReturnValue(xls_function_)
-          ->GetType());
+  return return_marshaller_->Unpack(outputs.data());
 }
 
 absl::StatusOr<Value> IrJit::Run(
@@ -384,8 +390,167 @@ absl::Status IrJit::RunWithViews(absl::Span<uint8_t*> args,
                      return_type_bytes_));
   }
 
-  invoker_(args.data(), result_buffer.data(), user_data);
-  return absl::OkStatus();
+  return RunWithEventBuffer(
+      [&] { invoker_(args.data(), result_buffer.data(), user_data); });
+}
+
+absl::Status IrJit::RunWithPackedBuffers(absl::Span<uint8_t* const> args,
+                                         absl::Span<uint8_t> result_buffer,
+                                         void* user_data) {
+  absl::Span<Param* const> params = xls_function_->params();
+  if (args.size() != params.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Arg list has the wrong size: %d vs expected %d.",
+                        args.size(), xls_function_->params().size()));
+  }
+  int64_t return_bytes = GetPackedReturnTypeSize();
+  if (result_buffer.size() < return_bytes) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Result buffer too small - must be at least %d bytes!", return_bytes));
+  }
+  if (return_bytes == 0) {
+    // The packed entry point has no output parameter in this case (see
+    // CompilePackedViewFunction()).
+    using NoResultFunctionType =
+        void (*)(const uint8_t* const* inputs, void* user_data);
+    return RunWithEventBuffer([&] {
+      reinterpret_cast<NoResultFunctionType>(packed_invoker_)(args.data(),
+                                                               user_data);
+    });
+  }
+  return RunWithEventBuffer(
+      [&] { packed_invoker_(args.data(), result_buffer.data(), user_data); });
+}
+
+int64_t IrJit::GetPackedReturnTypeSize() {
+  return JitRuntime::GetPackedTypeByteSize(
+      FunctionBuilderVisitor::GetEffectiveReturnValue(xls_function_)
+          ->GetType());
+}
+
+absl::Status IrJit::RunTicks(absl::Span<uint8_t> state, int64_t tick_count,
+                             bool packed, void* user_data) {
+  if (ticks_invoker_ == nullptr) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "%s is not a proc; only procs can be run for ticks",
+        xls_function_->name()));
+  }
+  int64_t state_bytes = packed ? GetPackedReturnTypeSize() : return_type_bytes_;
+  if (state.size() < state_bytes) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "State buffer too small - must be at least %d bytes!", state_bytes));
+  }
+  if (packed && packed_ticks_invoker_ == nullptr) {
+    // The state has no bits, so there is no packed entry point to loop over;
+    // the native one is equivalent.
+    std::vector<uint8_t> native_state(std::max<int64_t>(return_type_bytes_, 1));
+    return RunWithEventBuffer(
+        [&] { ticks_invoker_(native_state.data(), user_data, tick_count); });
+  }
+  return RunWithEventBuffer([&] {
+    (packed ? packed_ticks_invoker_ : ticks_invoker_)(state.data(), user_data,
+                                                      tick_count);
+  });
+}
+
+absl::Status IrJit::RunBatch(absl::Span<uint8_t* const> args,
+                             absl::Span<uint8_t> result_buffer,
+                             int64_t batch_size, void* user_data) {
+  absl::Span<Param* const> params = xls_function_->params();
+  if (args.size() != params.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Arg list has the wrong size: %d vs expected %d.",
+                        args.size(), xls_function_->params().size()));
+  }
+  if (batch_size < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Batch size must be non-negative: %d", batch_size));
+  }
+  if (result_buffer.size() < batch_size * return_type_bytes_) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Result buffer too small - must be at least %d bytes!",
+        batch_size * return_type_bytes_));
+  }
+
+  return RunWithEventBuffer([&] {
+    batch_invoker_(args.data(), result_buffer.data(), user_data, batch_size);
+  });
+}
+
+absl::StatusOr<std::vector<Value>> IrJit::RunBatch(
+    absl::Span<const std::vector<Value>> arg_sets, void* user_data) {
+  absl::Span<Param* const> params = xls_function_->params();
+  int64_t batch_size = arg_sets.size();
+
+  // Each parameter gets a single contiguous buffer holding the entire batch.
+  std::vector<std::vector<uint8_t>> arg_batches(params.size());
+  std::vector<uint8_t*> arg_buffers(params.size());
+  for (int64_t i = 0; i < params.size(); ++i) {
+    arg_batches[i].resize(
+        std::max<int64_t>(arg_type_bytes_[i] * batch_size, 1));
+    arg_buffers[i] = arg_batches[i].data();
+  }
+
+  for (int64_t sample = 0; sample < batch_size; ++sample) {
+    const std::vector<Value>& args = arg_sets[sample];
+    if (args.size() != params.size()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Arg list %d has the wrong size: %d vs expected %d.", sample,
+          args.size(), params.size()));
+    }
+    for (int64_t i = 0; i < params.size(); ++i) {
+      if (!arg_marshallers_[i].Pack(
+              args[i], arg_buffers[i] + sample * arg_type_bytes_[i])) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Got argument %s for parameter %d which is not of type %s",
+            args[i].ToString(), i, params[i]->GetType()->ToString()));
+      }
+    }
+  }
+
+  std::vector<uint8_t> results(
+      std::max<int64_t>(return_type_bytes_ * batch_size, 1));
+  XLS_RETURN_IF_ERROR(RunBatch(arg_buffers, absl::MakeSpan(results),
+                               batch_size, user_data));
+
+  std::vector<Value> values;
+  values.reserve(batch_size);
+  for (int64_t sample = 0; sample < batch_size; ++sample) {
+    values.push_back(return_marshaller_->Unpack(
+        results.data() + sample * return_type_bytes_));
+  }
+  return values;
+}
+
+int64_t ChooseJitOptLevel(const FunctionBase* function,
+                          int64_t expected_call_count) {
+  // The number of calls at which -O3 pays off for functions of up to
+  // kLinearNodeLimit nodes. Beyond, -O3 compile time grows superlinearly, so
+  // proportionally more calls are required.
+  constexpr int64_t kMinCallsForO3 = 2000;
+  constexpr int64_t kLinearNodeLimit = 5000;
+  int64_t node_count = function->node_count();
+  int64_t min_calls = kMinCallsForO3;
+  if (node_count > kLinearNodeLimit) {
+    min_calls = kMinCallsForO3 * node_count / kLinearNodeLimit;
+  }
+  return expected_call_count >= min_calls ? 3 : kJitFastCompileOptLevel;
+}
+
+std::string JitCompileStatsToString(const JitCompileStats& stats) {
+  if (stats.object_cache_hit) {
+    return absl::StrFormat("total %s (IR generation %s), object cache hit",
+                           absl::FormatDuration(stats.total_time),
+                           absl::FormatDuration(stats.ir_generation_time));
+  }
+  return absl::StrFormat(
+      "total %s (IR generation %s, optimization %s), %d -> %d LLVM "
+      "instructions",
+      absl::FormatDuration(stats.total_time),
+      absl::FormatDuration(stats.ir_generation_time),
+      absl::FormatDuration(stats.optimization_time),
+      stats.instructions_before_optimization,
+      stats.instructions_after_optimization);
 }
 
 absl::StatusOr<Value> CreateAndRun(Function* xls_function,
@@ -417,11 +582,85 @@ CreateAndQuickCheck(Function* xls_function, int64_t seed, int64_t num_tests) {
   return std::make_pair(argsets, results);
 }
 
+absl::StatusOr<QuickCheckResult> ParallelQuickCheck(Function* xls_function,
+                                                    int64_t seed,
+                                                    int64_t num_tests,
+                                                    int64_t num_threads) {
+  absl::Time start = absl::Now();
+  const int64_t shard_count = CeilOfRatio(num_tests, kQuickCheckShardSize);
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::max<int64_t>(1, std::min(num_threads, shard_count));
+
+  QuickCheckResult result;
+  std::atomic<int64_t> next_shard(0);
+  std::atomic<int64_t> samples(0);
+  // The earliest shard known to hold a counterexample; later shards are not
+  // run. Only updated with "mutex" held.
+  std::atomic<int64_t> failing_shard(shard_count);
+  absl::Mutex mutex;
+  absl::Status status;
+  auto run_shards = [&]() -> absl::Status {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit,
+                         IrJit::Create(xls_function));
+    for (int64_t shard = next_shard++; shard < failing_shard;
+         shard = next_shard++) {
+      std::seed_seq seed_seq = {static_cast<uint32_t>(seed),
+                                static_cast<uint32_t>(seed >> 32),
+                                static_cast<uint32_t>(shard)};
+      std::minstd_rand rng_engine(seed_seq);
+      const int64_t begin = shard * kQuickCheckShardSize;
+      const int64_t end = std::min(num_tests, begin + kQuickCheckShardSize);
+      std::vector<std::vector<Value>> argsets;
+      argsets.reserve(end - begin);
+      for (int64_t i = begin; i < end; ++i) {
+        argsets.push_back(RandomFunctionArguments(xls_function, &rng_engine));
+      }
+      XLS_ASSIGN_OR_RETURN(std::vector<Value> results, jit->RunBatch(argsets));
+      samples += argsets.size();
+      for (int64_t i = 0; i < results.size(); ++i) {
+        if (results[i].IsAllZeros()) {
+          absl::MutexLock lock(&mutex);
+          if (shard < failing_shard) {
+            failing_shard = shard;
+            result.counterexample = std::move(argsets[i]);
+            result.counterexample_index = begin + i;
+          }
+          break;
+        }
+      }
+    }
+    return absl::OkStatus();
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 0; t < num_threads; ++t) {
+    threads.push_back(std::make_unique<Thread>([&]() {
+      absl::Status thread_status = run_shards();
+      if (!thread_status.ok()) {
+        absl::MutexLock lock(&mutex);
+        status.Update(thread_status);
+        // Stop the other threads.
+        failing_shard = -1;
+      }
+    }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  XLS_RETURN_IF_ERROR(status);
+
+  result.samples = samples;
+  result.elapsed = absl::Now() - start;
+  return result;
+}
+
 // Much of the core here is the same as in CompileFunction() - refer there for
 // general comments.
 absl::Status IrJit::CompilePackedViewFunction(VisitFn visit_fn,
                                               llvm::Module* module) {
-  llvm::LLVMContext* bare_context = context_.getContext();
+  llvm::LLVMContext* bare_context = orc_jit_->GetContext();
   llvm::Type* i8_type = llvm::Type::getInt8Ty(*bare_context);
 
   // Create arg packing/unpacking buffers as in CompileFunction().
@@ -461,4 +700,189 @@ absl::Status IrJit::CompilePackedViewFunction(VisitFn visit_fn,
   return absl::OkStatus();
 }
 
+absl::Status IrJit::CompileBatchFunction(llvm::Module* module) {
+  llvm::LLVMContext* bare_context = orc_jit_->GetContext();
+  llvm::Type* i8_type = llvm::Type::getInt8Ty(*bare_context);
+  llvm::Type* i8_ptr_type = llvm::PointerType::get(i8_type, /*AddressSpace=*/0);
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(*bare_context);
+
+  Package* xls_package = xls_function_->package();
+  std::string single_name =
+      absl::StrFormat("%s::%s", xls_package->name(), xls_function_->name());
+  llvm::Function* single_function = module->getFunction(single_name);
+  XLS_RET_CHECK(single_function != nullptr)
+      << "Batch wrapper requires the single-sample function to be compiled.";
+  llvm::FunctionType* single_type = single_function->getFunctionType();
+
+  // The batch wrapper takes the same arguments as the single-sample function
+  // (except that each arg pointer refers to an array of samples and the output
+  // is a byte buffer), plus a trailing i64 batch count.
+  int64_t param_count = xls_function_->params().size();
+  llvm::ArrayType* arg_array_type =
+      llvm::ArrayType::get(i8_ptr_type, param_count);
+  std::vector<llvm::Type*> param_types = {
+      llvm::PointerType::get(arg_array_type, /*AddressSpace=*/0), i8_ptr_type,
+      i64_type, i64_type};
+  llvm::FunctionType* function_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(*bare_context), param_types, /*isVarArg=*/false);
+  llvm::Function* batch_function = llvm::cast<llvm::Function>(
+      module->getOrInsertFunction(single_name + "_batch", function_type)
+          .getCallee());
+  llvm::Value* inputs = batch_function->getArg(0);
+  llvm::Value* outputs = batch_function->getArg(1);
+  llvm::Value* user_data = batch_function->getArg(2);
+  llvm::Value* batch_size = batch_function->getArg(3);
+
+  // Blocks: entry, loop header (checks the trip count), body, exit.
+  llvm::BasicBlock* entry_block =
+      llvm::BasicBlock::Create(*bare_context, "entry", batch_function);
+  llvm::BasicBlock* header_block =
+      llvm::BasicBlock::Create(*bare_context, "loop_header", batch_function);
+  llvm::BasicBlock* body_block =
+      llvm::BasicBlock::Create(*bare_context, "loop_body", batch_function);
+  llvm::BasicBlock* exit_block =
+      llvm::BasicBlock::Create(*bare_context, "exit", batch_function);
+
+  // Entry: allocate the per-sample arg pointer array passed to the callee.
+  llvm::IRBuilder<> entry_builder(entry_block);
+  llvm::AllocaInst* sample_args = entry_builder.CreateAlloca(arg_array_type);
+  entry_builder.CreateBr(header_block);
+
+  // Header: exit once all samples have been evaluated.
+  llvm::IRBuilder<> header_builder(header_block);
+  llvm::PHINode* index = header_builder.CreatePHI(i64_type, 2);
+  header_builder.CreateCondBr(header_builder.CreateICmpULT(index, batch_size),
+                              body_block, exit_block);
+
+  // Body: point each arg slot at the current sample and invoke the function.
+  llvm::IRBuilder<> body_builder(body_block);
+  llvm::Value* zero = llvm::ConstantInt::get(i64_type, 0);
+  for (int64_t i = 0; i < param_count; ++i) {
+    llvm::Value* slot = llvm::ConstantInt::get(i64_type, i);
+    llvm::Value* base = body_builder.CreateLoad(
+        i8_ptr_type,
+        body_builder.CreateGEP(arg_array_type, inputs, {zero, slot}));
+    llvm::Value* offset = body_builder.CreateMul(
+        index, llvm::ConstantInt::get(i64_type, arg_type_bytes_[i]));
+    body_builder.CreateStore(
+        body_builder.CreateGEP(i8_type, base, offset),
+        body_builder.CreateGEP(arg_array_type, sample_args, {zero, slot}));
+  }
+  llvm::Value* output_offset = body_builder.CreateMul(
+      index, llvm::ConstantInt::get(i64_type, return_type_bytes_));
+  llvm::Value* output = body_builder.CreateBitCast(
+      body_builder.CreateGEP(i8_type, outputs, output_offset),
+      single_type->getParamType(1));
+  body_builder.CreateCall(single_function, {sample_args, output, user_data});
+  llvm::Value* next_index =
+      body_builder.CreateAdd(index, llvm::ConstantInt::get(i64_type, 1));
+  body_builder.CreateBr(header_block);
+
+  index->addIncoming(zero, entry_block);
+  index->addIncoming(next_index, body_block);
+
+  llvm::IRBuilder<> exit_builder(exit_block);
+  exit_builder.CreateRetVoid();
+
+  return absl::OkStatus();
+}
+
+absl::Status IrJit::CompileTicksFunction(llvm::Module* module, bool packed) {
+  llvm::LLVMContext* bare_context = orc_jit_->GetContext();
+  llvm::Type* i8_type = llvm::Type::getInt8Ty(*bare_context);
+  llvm::Type* i8_ptr_type = llvm::PointerType::get(i8_type, /*AddressSpace=*/0);
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(*bare_context);
+
+  Package* xls_package = xls_function_->package();
+  std::string single_name = absl::StrFormat(
+      "%s::%s%s", xls_package->name(), xls_function_->name(),
+      packed ? "_packed" : "");
+  llvm::Function* single_function = module->getFunction(single_name);
+  XLS_RET_CHECK(single_function != nullptr)
+      << "Ticks wrapper requires the single-tick function to be compiled.";
+  llvm::FunctionType* single_type = single_function->getFunctionType();
+  XLS_RET_CHECK_EQ(single_type->getNumParams(), 3);
+
+  // The wrapper takes the state buffer (updated in place), the user data and
+  // the number of ticks to run.
+  std::vector<llvm::Type*> param_types = {i8_ptr_type, i64_type, i64_type};
+  llvm::FunctionType* function_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(*bare_context), param_types, /*isVarArg=*/false);
+  llvm::Function* ticks_function = llvm::cast<llvm::Function>(
+      module->getOrInsertFunction(single_name + "_ticks", function_type)
+          .getCallee());
+  llvm::Value* state = ticks_function->getArg(0);
+  llvm::Value* user_data = ticks_function->getArg(1);
+  llvm::Value* tick_count = ticks_function->getArg(2);
+
+  // Blocks: entry, loop header (checks the tick count), body, exit.
+  llvm::BasicBlock* entry_block =
+      llvm::BasicBlock::Create(*bare_context, "entry", ticks_function);
+  llvm::BasicBlock* header_block =
+      llvm::BasicBlock::Create(*bare_context, "loop_header", ticks_function);
+  llvm::BasicBlock* body_block =
+      llvm::BasicBlock::Create(*bare_context, "loop_body", ticks_function);
+  llvm::BasicBlock* exit_block =
+      llvm::BasicBlock::Create(*bare_context, "exit", ticks_function);
+
+  // Entry: copy the state to the stack, where it lives across ticks (and which
+  // LLVM may promote to registers once the tick function is inlined), and
+  // point the state param slot at it. The token param slot is unused.
+  int64_t state_bytes = std::max<int64_t>(
+      packed ? GetPackedReturnTypeSize() : return_type_bytes_, 1);
+  llvm::IRBuilder<> entry_builder(entry_block);
+  llvm::AllocaInst* local_state =
+      entry_builder.CreateAlloca(llvm::ArrayType::get(i8_type, state_bytes));
+  local_state->setAlignment(llvm::Align(alignof(std::max_align_t)));
+  llvm::Value* local_state_ptr =
+      entry_builder.CreateBitCast(local_state, i8_ptr_type);
+  entry_builder.CreateMemCpy(local_state_ptr, llvm::MaybeAlign(0), state,
+                             llvm::MaybeAlign(0), state_bytes);
+  Param* state_param = xls_function_->AsProcOrDie()->StateParam();
+  int64_t param_count = xls_function_->params().size();
+  llvm::ArrayType* arg_array_type =
+      llvm::ArrayType::get(i8_ptr_type, param_count);
+  llvm::AllocaInst* args = entry_builder.CreateAlloca(arg_array_type);
+  llvm::Value* zero = llvm::ConstantInt::get(i64_type, 0);
+  for (int64_t i = 0; i < param_count; ++i) {
+    bool is_state = xls_function_->params()[i] == state_param;
+    entry_builder.CreateStore(
+        is_state ? local_state_ptr
+                 : llvm::ConstantPointerNull::get(
+                       llvm::cast<llvm::PointerType>(i8_ptr_type)),
+        entry_builder.CreateGEP(arg_array_type, args,
+                                {zero, llvm::ConstantInt::get(i64_type, i)}));
+  }
+  entry_builder.CreateBr(header_block);
+
+  // Header: exit once all ticks have run.
+  llvm::IRBuilder<> header_builder(header_block);
+  llvm::PHINode* index = header_builder.CreatePHI(i64_type, 2);
+  header_builder.CreateCondBr(header_builder.CreateICmpULT(index, tick_count),
+                              body_block, exit_block);
+
+  // Body: run one tick, writing the next state over the current one.
+  llvm::IRBuilder<> body_builder(body_block);
+  body_builder.CreateCall(
+      single_function,
+      {args,
+       body_builder.CreateBitCast(local_state_ptr,
+                                  single_type->getParamType(1)),
+       user_data});
+  llvm::Value* next_index =
+      body_builder.CreateAdd(index, llvm::ConstantInt::get(i64_type, 1));
+  body_builder.CreateBr(header_block);
+
+  index->addIncoming(zero, entry_block);
+  index->addIncoming(next_index, body_block);
+
+  // Exit: write the final state back.
+  llvm::IRBuilder<> exit_builder(exit_block);
+  exit_builder.CreateMemCpy(state, llvm::MaybeAlign(0), local_state_ptr,
+                            llvm::MaybeAlign(0), state_bytes);
+  exit_builder.CreateRetVoid();
+
+  return absl::OkStatus();
+}
+
 }  // namespace xls
@@ -15,27 +15,27 @@
 #ifndef XLS_JIT_IR_JIT_H_
 #define XLS_JIT_IR_JIT_H_
 
+#include <filesystem>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/CompileUtils.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/Core.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/IRCompileLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/IRTransformLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
-#include "llvm/include/llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/include/llvm/IR/DataLayout.h"
 #include "llvm/include/llvm/IR/IRBuilder.h"
 #include "llvm/include/llvm/IR/LLVMContext.h"
-#include "llvm/include/llvm/Target/TargetMachine.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/function.h"
 #include "xls/ir/package.h"
 #include "xls/ir/value.h"
 #include "xls/ir/value_view.h"
 #include "xls/jit/jit_channel_queue.h"
+#include "xls/jit/jit_events.h"
+#include "xls/jit/jit_node_counters.h"
 #include "xls/jit/jit_runtime.h"
 #include "xls/jit/llvm_type_converter.h"
+#include "xls/jit/orc_jit.h"
 #include "xls/jit/proc_builder_visitor.h"
 
 namespace xls {
@@ -47,17 +47,49 @@ class IrJit {
   ~IrJit();
 
   // Returns an object containing a host-compiled version of the specified XLS
-  // function.
-  static absl::StatusOr<std::unique_ptr<IrJit>> Create(Function* xls_function,
-                                                       int64_t opt_level = 3);
+  // function. "opt_level" is an LLVM opt level from 0 to 3, or
+  // kJitFastCompileOptLevel (see ChooseJitOptLevel() to pick one). If
+  // "object_cache_dir" is specified, compiled code is cached in that directory
+  // and reused by later compilations of the same function (see
+  // jit_object_cache.h).
+  static absl::StatusOr<std::unique_ptr<IrJit>> Create(
+      Function* xls_function, int64_t opt_level = 3,
+      absl::optional<std::filesystem::path> object_cache_dir = absl::nullopt);
+
+  // As Create(), but the compiled code counts executions of the function's
+  // nodes into node_counters() (see jit_node_counters.h). The code refers to
+  // the counters by address, so it is never cached.
+  static absl::StatusOr<std::unique_ptr<IrJit>> CreateInstrumented(
+      Function* xls_function, int64_t opt_level = 3);
+
   static absl::StatusOr<std::unique_ptr<IrJit>> CreateProc(
       Proc* proc, JitChannelQueueManager* queue_mgr,
       ProcBuilderVisitor::RecvFnT recv_fn, ProcBuilderVisitor::SendFnT send_fn,
+      int64_t opt_level = 3,
+      absl::optional<std::filesystem::path> object_cache_dir = absl::nullopt);
+
+  // Compiles "xls_function" ahead of time into a relocatable object file for
+  // the host, returning the object file's contents. The object exports a
+  // single symbol, "symbol_name" (which must be a C identifier), for the
+  // packed-view entry point:
+  //
+  //   extern "C" void symbol_name(const uint8_t* const* inputs,
+  //                               uint8_t* output, void* user_data);
+  //
+  // where inputs[i] points to the packed bits of parameter i and "output" to a
+  // buffer for the packed result (see RunWithPackedViews()). The generated
+  // code references neither LLVM nor XLS, so the object can be linked into
+  // binaries which don't otherwise depend on the JIT. It is compiled for the
+  // CPU of the host running this function.
+  static absl::StatusOr<std::string> CompileToObject(
+      Function* xls_function, absl::string_view symbol_name,
       int64_t opt_level = 3);
 
   // Executes the compiled function with the specified arguments.
   // The optional opaque "user_data" argument is passed into Proc send/recv
-  // callbacks.
+  // callbacks. This and the other Run methods return an Aborted error if an
+  // assertion fails, unless a JitEventBuffer is installed for the calling
+  // thread to record the failures (see jit_events.h).
   absl::StatusOr<Value> Run(absl::Span<const Value> args,
                             void* user_data = nullptr);
 
@@ -79,6 +111,22 @@ class IrJit {
                             absl::Span<uint8_t> result_buffer,
                             void* user_data = nullptr);
 
+  // Executes the compiled function "batch_size" times in a single call into
+  // LLVM space. Element i of "args" points to a contiguous buffer holding
+  // "batch_size" back-to-back views of parameter i (each GetArgTypeSize(i)
+  // bytes), and "result_buffer" must hold "batch_size" back-to-back result
+  // views (each GetReturnTypeSize() bytes). The loop over the batch is itself
+  // compiled, so no per-sample argument packing or dispatch is performed.
+  absl::Status RunBatch(absl::Span<uint8_t* const> args,
+                        absl::Span<uint8_t> result_buffer, int64_t batch_size,
+                        void* user_data = nullptr);
+
+  // As above, but with each element of "arg_sets" holding the arguments for
+  // one invocation. Arguments are packed into (and results unpacked from)
+  // batch buffers once for the whole set.
+  absl::StatusOr<std::vector<Value>> RunBatch(
+      absl::Span<const std::vector<Value>> arg_sets, void* user_data = nullptr);
+
   // Similar to RunWithViews(), except the arguments here are _packed_views_ -
   // views whose data elements are tightly packed, with no padding bits or bytes
   // between them. The function return value is specified as the last arg - its
@@ -104,10 +152,34 @@ class IrJit {
     uint8_t* result_buffer;
     // Walk the type tree to get each arg's data buffer into our view/arg list.
     PackArgBuffers(arg_buffers, &result_buffer, args...);
-    packed_invoker_(arg_buffers, result_buffer, /*user_data=*/nullptr);
-    return absl::OkStatus();
+    return RunWithEventBuffer([&] {
+      packed_invoker_(arg_buffers, result_buffer, /*user_data=*/nullptr);
+    });
   }
 
+  // As RunWithPackedViews(), but with the types of the arguments and result
+  // known only at runtime: args[i] points to GetPackedArgTypeSize(i) bytes
+  // holding parameter i in the packed layout, and the result is written to
+  // "result_buffer" in the same layout (see JitRuntime::
+  // BlitValueToPackedBuffer()). Packed buffers are denser than views - e.g.,
+  // an array of 1024 3-bit elements occupies 384 bytes rather than 1024 - at
+  // the cost of converting to the native layout on entry and back on exit.
+  // As with views, "result_buffer" may alias an argument.
+  absl::Status RunWithPackedBuffers(absl::Span<uint8_t* const> args,
+                                    absl::Span<uint8_t> result_buffer,
+                                    void* user_data = nullptr);
+
+  // For a JIT of a proc made by CreateProc(), runs "tick_count" iterations of
+  // the proc within a single call into compiled code, which loops over them
+  // keeping the state on its stack. "state" holds the proc's state on entry
+  // and receives it on exit; it is laid out as a result view
+  // (GetReturnTypeSize() bytes), or in the packed layout of
+  // RunWithPackedBuffers() (GetPackedReturnTypeSize() bytes) if "packed".
+  // Receives and sends within the ticks are handled by the proc's callbacks
+  // as usual, so they may block.
+  absl::Status RunTicks(absl::Span<uint8_t> state, int64_t tick_count,
+                        bool packed = false, void* user_data = nullptr);
+
   // Returns the function that the JIT executes.
   FunctionBase* function() { return xls_function_; }
 
@@ -117,15 +189,31 @@ class IrJit {
   int64_t GetArgTypeSize(int arg_index) { return arg_type_bytes_[arg_index]; }
   int64_t GetReturnTypeSize() { return return_type_bytes_; }
 
+  // As above, but for the buffers of RunWithPackedBuffers().
+  int64_t GetPackedArgTypeSize(int arg_index) {
+    return JitRuntime::GetPackedTypeByteSize(
+        xls_function_->params()[arg_index]->GetType());
+  }
+  int64_t GetPackedReturnTypeSize();
+
   JitRuntime* runtime() { return ir_runtime_.get(); }
 
   LlvmTypeConverter* type_converter() { return type_converter_.get(); }
 
+  // Returns statistics about the compilation of the function.
+  const JitCompileStats& compile_stats() const { return compile_stats_; }
+
+  // Returns the node counters of a JIT made by CreateInstrumented(), or null.
+  JitNodeCounters* node_counters() { return node_counters_.get(); }
+
  private:
   explicit IrJit(FunctionBase* xls_function, int64_t opt_level);
 
   // Performs non-trivial initialization (i.e., that which can fail).
-  absl::Status Init();
+  absl::Status Init(absl::optional<std::filesystem::path> object_cache_dir);
+
+  // Creates the type converter and runtime for the types of "orc_jit_".
+  void InitRuntime();
 
   // Drives regular and packed function compilation.
   using VisitFn = std::function<absl::Status(llvm::Module* module,
@@ -142,9 +230,29 @@ class IrJit {
   absl::Status CompilePackedViewFunction(VisitFn visit_fn,
                                          llvm::Module* module);
 
-  llvm::Expected<llvm::orc::ThreadSafeModule> Optimizer(
-      llvm::orc::ThreadSafeModule module,
-      const llvm::orc::MaterializationResponsibility& responsibility);
+  // Emits a wrapper around the function built by CompileFunction() which
+  // invokes it once per element of a batch of contiguous argument and result
+  // buffers. Must be called after CompileFunction().
+  absl::Status CompileBatchFunction(llvm::Module* module);
+
+  // For procs, emits a wrapper around the function built by CompileFunction()
+  // or, if "packed", CompilePackedViewFunction(), which invokes it a given
+  // number of times, feeding each tick's next state to the following one.
+  absl::Status CompileTicksFunction(llvm::Module* module, bool packed);
+
+  // Calls "invoke", which runs compiled code, with the calling thread's
+  // JitEventBuffer. If the thread has none, a temporary one is installed and
+  // its first assertion failure is returned (see jit_events.h).
+  template <typename InvokeT>
+  static absl::Status RunWithEventBuffer(InvokeT invoke) {
+    if (JitEventBuffer::Current() != nullptr) {
+      invoke();
+      return absl::OkStatus();
+    }
+    JitEventBuffer events(/*capacity=*/1);
+    invoke();
+    return events.FirstFailure();
+  }
 
   // Simple templates to walk down the arg tree and populate the corresponding
   // arg/buffer pointer.
@@ -162,23 +270,29 @@ class IrJit {
     *result_buffer = front.buffer();
   }
 
-  llvm::orc::ThreadSafeContext context_;
-  llvm::orc::ExecutionSession execution_session_;
-  llvm::orc::RTDyldObjectLinkingLayer object_layer_;
-  llvm::orc::JITDylib& dylib_;
-  llvm::DataLayout data_layout_;
+  // Declared before the compiled code referring to them.
+  std::unique_ptr<JitNodeCounters> node_counters_;
 
-  std::unique_ptr<llvm::TargetMachine> target_machine_;
-  std::unique_ptr<llvm::orc::IRCompileLayer> compile_layer_;
-  std::unique_ptr<llvm::orc::IRTransformLayer> transform_layer_;
+  std::unique_ptr<OrcJit> orc_jit_;
 
   FunctionBase* xls_function_;
   int64_t opt_level_;
+  JitCompileStats compile_stats_;
 
   // Size of the function's args or return type as flat bytes.
   std::vector<int64_t> arg_type_bytes_;
   int64_t return_type_bytes_;
 
+  // Run() packs all args into a single allocation of arg_buffer_bytes_, arg i
+  // at arg_offsets_[i].
+  std::vector<int64_t> arg_offsets_;
+  int64_t arg_buffer_bytes_ = 0;
+
+  // Converters for the function's args and return type, created once so calls
+  // needn't walk the types.
+  std::vector<ValueMarshaller> arg_marshallers_;
+  absl::optional<ValueMarshaller> return_marshaller_;
+
   // Cache for XLS type => LLVM type conversions.
   absl::flat_hash_map<const Type*, llvm::Type*> xls_to_llvm_type_;
 
@@ -194,8 +308,34 @@ class IrJit {
   using PackedJitFunctionType = void (*)(const uint8_t* const* inputs,
                                          uint8_t* output, void* user_data);
   PackedJitFunctionType packed_invoker_;
+
+  // Batched types for above. The final argument is the number of elements in
+  // the batch.
+  using BatchJitFunctionType = void (*)(const uint8_t* const* inputs,
+                                        uint8_t* output, void* user_data,
+                                        int64_t batch_size);
+  BatchJitFunctionType batch_invoker_;
+
+  // Multi-tick wrappers for procs (see RunTicks()), or null. The final
+  // argument is the number of ticks.
+  using TicksJitFunctionType = void (*)(uint8_t* state, void* user_data,
+                                        int64_t tick_count);
+  TicksJitFunctionType ticks_invoker_;
+  TicksJitFunctionType packed_ticks_invoker_;
 };
 
+// Returns the opt level to JIT-compile "function" with when it is expected to
+// be evaluated "expected_call_count" times: the fast-compile level when its
+// compilation time at -O3 would likely exceed the execution time saved, and 3
+// otherwise. The estimate assumes -O3 saves about a nanosecond per node per
+// call, and that its extra compile time grows linearly up to a few thousand
+// nodes and faster beyond.
+int64_t ChooseJitOptLevel(const FunctionBase* function,
+                          int64_t expected_call_count);
+
+// Formats the given compile statistics for humans, on one line.
+std::string JitCompileStatsToString(const JitCompileStats& stats);
+
 // JIT-compiles the given xls_function and invokes it with args, returning the
 // resulting return value. Note that this will cause the overhead of creating a
 // IrJit object each time, so external caching strategies are generally
@@ -216,6 +356,34 @@ absl::StatusOr<Value> CreateAndRun(Function* xls_function,
 absl::StatusOr<std::pair<std::vector<std::vector<Value>>, std::vector<Value>>>
 CreateAndQuickCheck(Function* xls_function, int64_t seed, int64_t num_tests);
 
+// The result of ParallelQuickCheck().
+struct QuickCheckResult {
+  // The number of samples that were run.
+  int64_t samples = 0;
+  // The first argument set (in sample order) that falsified the predicate, if
+  // any, and its index among the samples.
+  absl::optional<std::vector<Value>> counterexample;
+  int64_t counterexample_index = -1;
+  // The wall time spent, including JIT compilation.
+  absl::Duration elapsed;
+};
+
+// The number of samples in a shard of ParallelQuickCheck().
+constexpr int64_t kQuickCheckShardSize = 256;
+
+// Like CreateAndQuickCheck(), but runs the samples on "num_threads" threads
+// (one per core if <= 0), each with its own JIT compilation of xls_function.
+//
+// Samples are generated in shards of kQuickCheckShardSize, from an engine
+// seeded with "seed" and the shard index, which threads claim in order. So the
+// result doesn't depend on the number of threads: the counterexample is the
+// first falsifying sample in sample order. Once one is found, threads stop
+// claiming (and running) later shards.
+absl::StatusOr<QuickCheckResult> ParallelQuickCheck(Function* xls_function,
+                                                    int64_t seed,
+                                                    int64_t num_tests,
+                                                    int64_t num_threads);
+
 }  // namespace xls
 
 #endif  // XLS_JIT_IR_JIT_H_
@@ -21,6 +21,8 @@
 #include "absl/random/random.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
 #include "xls/common/status/matchers.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/interpreter/channel_queue.h"
@@ -50,6 +52,23 @@ INSTANTIATE_TEST_SUITE_P(
           return jit->Run(kwargs);
         })));
 
+INSTANTIATE_TEST_SUITE_P(
+    IrJitFastCompileTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function,
+           const std::vector<Value>& args) -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(
+              auto jit, IrJit::Create(function, kJitFastCompileOptLevel));
+          return jit->Run(args);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs)
+            -> absl::StatusOr<Value> {
+          XLS_ASSIGN_OR_RETURN(
+              auto jit, IrJit::Create(function, kJitFastCompileOptLevel));
+          return jit->Run(kwargs);
+        })));
+
 // This test verifies that a compiled JIT function can be re-used.
 TEST(IrJitTest, ReuseTest) {
   Package package("my_package");
@@ -186,6 +205,256 @@ TEST(IrJitTest, Seeding) {
   EXPECT_EQ(results1, results2);
 }
 
+// The parallel QuickCheck finds the same (first) counterexample regardless of
+// the number of threads.
+TEST(IrJitTest, ParallelQuickCheckIsDeterministic) {
+  Package package("rarely_false");
+  std::string ir_text = R"(
+  fn ne_42(x: bits[12]) -> bits[1] {
+    literal.2: bits[12] = literal(value=42)
+    ret ne.3: bits[1] = ne(x, literal.2)
+  }
+  )";
+  int64_t seed = 12345;
+  int64_t num_tests = 100000;
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      QuickCheckResult serial,
+      ParallelQuickCheck(function, seed, num_tests, /*num_threads=*/1));
+  ASSERT_TRUE(serial.counterexample.has_value());
+  EXPECT_EQ(*serial.counterexample, std::vector<Value>({Value(UBits(42, 12))}));
+  EXPECT_GT(serial.samples, serial.counterexample_index);
+  EXPECT_LT(serial.samples, num_tests);
+  for (int64_t num_threads : {2, 8}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        QuickCheckResult parallel,
+        ParallelQuickCheck(function, seed, num_tests, num_threads));
+    EXPECT_EQ(parallel.counterexample, serial.counterexample) << num_threads;
+    EXPECT_EQ(parallel.counterexample_index, serial.counterexample_index)
+        << num_threads;
+  }
+}
+
+TEST(IrJitTest, ParallelQuickCheckRunsAllSamples) {
+  Package package("always_true");
+  std::string ir_text = R"(
+  fn ret_true(x: bits[32]) -> bits[1] {
+    ret eq_value: bits[1] = eq(x, x)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      QuickCheckResult result,
+      ParallelQuickCheck(function, /*seed=*/0, /*num_tests=*/5050,
+                         /*num_threads=*/4));
+  EXPECT_FALSE(result.counterexample.has_value());
+  EXPECT_EQ(result.samples, 5050);
+}
+
+// Verifies that batched execution matches per-sample execution, including for
+// aggregate-typed parameters and results.
+TEST(IrJitTest, RunBatch) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn add_and_swap(x: bits[8], y: (bits[16], bits[3])) -> (bits[3], bits[16]) {
+    y0: bits[16] = tuple_index(y, index=0)
+    y1: bits[3] = tuple_index(y, index=1)
+    x_ext: bits[16] = zero_ext(x, new_bit_count=16)
+    sum: bits[16] = add(x_ext, y0)
+    ret result: (bits[3], bits[16]) = tuple(y1, sum)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function));
+
+  std::minstd_rand bitgen;
+  std::vector<std::vector<Value>> arg_sets;
+  for (int i = 0; i < 100; ++i) {
+    arg_sets.push_back(RandomFunctionArguments(function, &bitgen));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> results,
+                           jit->RunBatch(arg_sets));
+  ASSERT_EQ(results.size(), arg_sets.size());
+  for (int i = 0; i < arg_sets.size(); ++i) {
+    EXPECT_THAT(jit->Run(arg_sets[i]), IsOkAndHolds(results[i]));
+  }
+
+  // An empty batch is a no-op.
+  EXPECT_THAT(jit->RunBatch(std::vector<std::vector<Value>>()),
+              IsOkAndHolds(testing::IsEmpty()));
+}
+
+// Verifies the view-based batch interface on contiguous buffers.
+TEST(IrJitTest, RunBatchWithViews) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn add(x: bits[32], y: bits[32]) -> bits[32] {
+    ret add.1: bits[32] = add(x, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function));
+  ASSERT_EQ(jit->GetArgTypeSize(0), sizeof(uint32_t));
+  ASSERT_EQ(jit->GetReturnTypeSize(), sizeof(uint32_t));
+
+  constexpr int kBatchSize = 1000;
+  std::vector<uint32_t> x(kBatchSize);
+  std::vector<uint32_t> y(kBatchSize);
+  std::vector<uint32_t> sum(kBatchSize);
+  for (int i = 0; i < kBatchSize; ++i) {
+    x[i] = i;
+    y[i] = 3 * i + 0xfffff000;
+  }
+  std::vector<uint8_t*> args = {reinterpret_cast<uint8_t*>(x.data()),
+                                reinterpret_cast<uint8_t*>(y.data())};
+  XLS_ASSERT_OK(jit->RunBatch(
+      args,
+      absl::MakeSpan(reinterpret_cast<uint8_t*>(sum.data()),
+                     kBatchSize * sizeof(uint32_t)),
+      kBatchSize));
+  for (int i = 0; i < kBatchSize; ++i) {
+    EXPECT_EQ(sum[i], x[i] + y[i]);
+  }
+
+  EXPECT_THAT(
+      jit->RunBatch(args,
+                    absl::MakeSpan(reinterpret_cast<uint8_t*>(sum.data()), 4),
+                    kBatchSize),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+// Verifies that compiled objects are written to the object cache and that a
+// later JIT of the same function is served from it.
+TEST(IrJitTest, ObjectCache) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn add(x: bits[32], y: bits[32]) -> bits[32] {
+    ret add.1: bits[32] = add(x, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path cache_dir = temp_dir.path() / "cache";
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit,
+                           IrJit::Create(function, /*opt_level=*/3, cache_dir));
+  EXPECT_THAT(
+      jit->Run(std::vector<Value>{Value(UBits(2, 32)), Value(UBits(3, 32))}),
+      IsOkAndHolds(Value(UBits(5, 32))));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<std::filesystem::path> entries,
+                           GetDirectoryEntries(cache_dir));
+  EXPECT_EQ(entries.size(), 1);
+
+  // The second JIT should hit in the cache and not add any entries.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto cached_jit, IrJit::Create(function, /*opt_level=*/3, cache_dir));
+  EXPECT_THAT(cached_jit->Run(
+                  std::vector<Value>{Value(UBits(7, 32)), Value(UBits(8, 32))}),
+              IsOkAndHolds(Value(UBits(15, 32))));
+  XLS_ASSERT_OK_AND_ASSIGN(entries, GetDirectoryEntries(cache_dir));
+  EXPECT_EQ(entries.size(), 1);
+
+  // A different optimization level is a different cache entry.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto unopt_jit, IrJit::Create(function, /*opt_level=*/0, cache_dir));
+  EXPECT_THAT(unopt_jit->Run(
+                  std::vector<Value>{Value(UBits(1, 32)), Value(UBits(1, 32))}),
+              IsOkAndHolds(Value(UBits(2, 32))));
+  XLS_ASSERT_OK_AND_ASSIGN(entries, GetDirectoryEntries(cache_dir));
+  EXPECT_EQ(entries.size(), 2);
+}
+
+TEST(IrJitTest, OptLevels) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn add(x: bits[32], y: bits[32]) -> bits[32] {
+    add.1: bits[32] = add(x, y)
+    ret umul.2: bits[32] = umul(add.1, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  EXPECT_THAT(IrJit::Create(function, /*opt_level=*/4).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  for (int64_t opt_level : {int64_t{0}, int64_t{3}, kJitFastCompileOptLevel}) {
+    XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function, opt_level));
+    EXPECT_THAT(
+        jit->Run(std::vector<Value>{Value(UBits(2, 32)), Value(UBits(3, 32))}),
+        IsOkAndHolds(Value(UBits(15, 32))));
+    const JitCompileStats& stats = jit->compile_stats();
+    EXPECT_FALSE(stats.object_cache_hit);
+    EXPECT_GT(stats.instructions_before_optimization, 0);
+    EXPECT_GT(stats.instructions_after_optimization, 0);
+    EXPECT_GE(stats.total_time,
+              stats.ir_generation_time + stats.optimization_time);
+  }
+
+  // Short runs get the fast-compile pipeline, long ones -O3.
+  EXPECT_EQ(ChooseJitOptLevel(function, /*expected_call_count=*/10),
+            kJitFastCompileOptLevel);
+  EXPECT_EQ(ChooseJitOptLevel(function, /*expected_call_count=*/1000000), 3);
+}
+
+// Maps over long arrays of bits are lowered to a loop rather than unrolled;
+// check both lowerings at each optimization level.
+TEST(IrJitTest, MapOverBitsArrays) {
+  // long_map also indexes into and updates (with the same value) the result
+  // of the loop, which lives in memory.
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, Parser::ParsePackage(R"(
+package my_package
+
+fn scale(x: bits[8]) -> bits[16] {
+  zero_ext.1: bits[16] = zero_ext(x, new_bit_count=16)
+  literal.2: bits[16] = literal(value=3)
+  ret umul.3: bits[16] = umul(zero_ext.1, literal.2)
+}
+
+fn short_map(a: bits[8][4]) -> bits[16][4] {
+  ret map.4: bits[16][4] = map(a, to_apply=scale)
+}
+
+fn long_map(a: bits[8][37]) -> bits[16][37] {
+  map.5: bits[16][37] = map(a, to_apply=scale)
+  literal.6: bits[6] = literal(value=36)
+  array_index.7: bits[16] = array_index(map.5, indices=[literal.6])
+  ret array_update.8: bits[16][37] = array_update(map.5, array_index.7, indices=[literal.6])
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * short_map,
+                           package->GetFunction("short_map"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * long_map,
+                           package->GetFunction("long_map"));
+  std::vector<uint64_t> input;
+  std::vector<uint64_t> expected;
+  for (uint64_t i = 0; i < 37; ++i) {
+    input.push_back((i * 37) % 256);
+    expected.push_back(3 * input.back());
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Value short_input,
+      Value::UBitsArray(absl::MakeConstSpan(input).subspan(0, 4), 8));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Value short_expected,
+      Value::UBitsArray(absl::MakeConstSpan(expected).subspan(0, 4), 16));
+  XLS_ASSERT_OK_AND_ASSIGN(Value long_input, Value::UBitsArray(input, 8));
+  XLS_ASSERT_OK_AND_ASSIGN(Value long_expected,
+                           Value::UBitsArray(expected, 16));
+
+  for (int64_t opt_level : {int64_t{0}, int64_t{3}, kJitFastCompileOptLevel}) {
+    XLS_ASSERT_OK_AND_ASSIGN(auto short_jit,
+                             IrJit::Create(short_map, opt_level));
+    EXPECT_THAT(short_jit->Run({short_input}), IsOkAndHolds(short_expected));
+    XLS_ASSERT_OK_AND_ASSIGN(auto long_jit, IrJit::Create(long_map, opt_level));
+    EXPECT_THAT(long_jit->Run({long_input}), IsOkAndHolds(long_expected));
+  }
+}
+
 // Very basic smoke test for packed types.
 TEST(IrJitTest, PackedSmoke) {
   Package package("my_package");
@@ -537,6 +806,86 @@ TEST(IrJitTest, ArrayConcatArrayOfArrays) {
   EXPECT_THAT(jit->Run(args), IsOkAndHolds(ret));
 }
 
+// Checks the conversions of aggregate args and results, including large bits
+// arrays (which Values store packed), against the conforming-type checks.
+TEST(IrJitTest, MarshalAggregates) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: (bits[3], bits[65][2], ()), y: bits[12][100], t: token) -> ((bits[3], bits[65][2], ()), bits[12][100], token) {
+    ret tuple.1: ((bits[3], bits[65][2], ()), bits[12][100], token) = tuple(x, y, t)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function));
+
+  Value x = Value::Tuple(
+      {Value(UBits(5, 3)),
+       Value::ArrayOrDie({Value(Bits::AllOnes(65)), Value(UBits(42, 65))}),
+       Value::Tuple({})});
+  std::vector<uint64_t> y_elements(100);
+  for (int64_t i = 0; i < y_elements.size(); ++i) {
+    y_elements[i] = (i * 37) & 0xfff;
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Value y, Value::UBitsArray(y_elements, 12));
+  ASSERT_TRUE(y.IsPackedArray());
+  std::vector<Value> args = {x, y, Value::Token()};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(Value::Tuple(args)));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> batch_results,
+                           jit->RunBatch({args, args}));
+  EXPECT_THAT(batch_results,
+              testing::ElementsAre(Value::Tuple(args), Value::Tuple(args)));
+
+  std::vector<Value> bad_args = {x, Value::Tuple({}), Value::Token()};
+  EXPECT_THAT(jit->Run(bad_args),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("for parameter 1")));
+  XLS_ASSERT_OK_AND_ASSIGN(Value narrow_y, Value::UBitsArray(y_elements, 13));
+  bad_args = {x, narrow_y, Value::Token()};
+  EXPECT_THAT(jit->Run(bad_args),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("for parameter 1")));
+}
+
+TEST(IrJitTest, RunWithPackedBuffers) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: bits[3][5], y: (bits[1], bits[6])) -> (bits[6], bits[3][5]) {
+    one: bits[6] = literal(value=1)
+    y1: bits[6] = tuple_index(y, index=1)
+    sum: bits[6] = add(y1, one)
+    ret result: (bits[6], bits[3][5]) = tuple(sum, x)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, IrJit::Create(function));
+  EXPECT_EQ(jit->GetPackedArgTypeSize(0), 2);
+  EXPECT_EQ(jit->GetPackedArgTypeSize(1), 1);
+  EXPECT_EQ(jit->GetPackedReturnTypeSize(), 3);
+  EXPECT_GT(jit->GetArgTypeSize(0), jit->GetPackedArgTypeSize(0));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Value x, Value::UBitsArray({1, 2, 3, 4, 5}, 3));
+  Value y = Value::Tuple({Value(UBits(1, 1)), Value(UBits(41, 6))});
+  std::vector<uint8_t> x_buffer(jit->GetPackedArgTypeSize(0));
+  std::vector<uint8_t> y_buffer(jit->GetPackedArgTypeSize(1));
+  jit->runtime()->BlitValueToPackedBuffer(x, function->param(0)->GetType(),
+                                          absl::MakeSpan(x_buffer));
+  jit->runtime()->BlitValueToPackedBuffer(y, function->param(1)->GetType(),
+                                          absl::MakeSpan(y_buffer));
+  // Element 0 occupies the least significant bits of arrays, and the last
+  // element those of tuples.
+  EXPECT_EQ(x_buffer[0], 1 | (2 << 3) | (3 << 6));
+  EXPECT_EQ(y_buffer[0], 41 | (1 << 6));
+
+  std::vector<uint8_t> result(jit->GetPackedReturnTypeSize());
+  std::vector<uint8_t*> args = {x_buffer.data(), y_buffer.data()};
+  XLS_ASSERT_OK(jit->RunWithPackedBuffers(args, absl::MakeSpan(result)));
+  EXPECT_EQ(jit->runtime()->UnpackPackedBuffer(
+                result.data(), function->return_value()->GetType()),
+            Value::Tuple({Value(UBits(42, 6)), x}));
+}
+
 TEST(IrJitTest, Assert) {
   Package p("assert_test");
   FunctionBuilder b("fun", &p);
@@ -547,5 +896,26 @@ TEST(IrJitTest, Assert) {
               StatusIs(absl::StatusCode::kUnimplemented));
 }
 
+TEST(IrJitTest, CompileToObject) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn add(x: bits[8], y: bits[8]) -> bits[8] {
+    ret sum: bits[8] = add(x, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::string object,
+      IrJit::CompileToObject(function, "my_package_add_aot"));
+  EXPECT_EQ(object.substr(0, 4), "\x7f" "ELF");
+  EXPECT_THAT(object, testing::HasSubstr("my_package_add_aot"));
+
+  EXPECT_THAT(IrJit::CompileToObject(function, "my_package::add").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(IrJit::CompileToObject(function, "0add").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 }  // namespace
 }  // namespace xls
@@ -14,10 +14,64 @@
 #include "xls/jit/jit_channel_queue.h"
 
 #include "absl/memory/memory.h"
+#include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 
 namespace xls {
 
+JitChannelQueue::JitChannelQueue(int64_t channel_id, int64_t block_capacity)
+    : channel_id_(channel_id), block_capacity_(block_capacity) {
+  XLS_CHECK_GT(block_capacity_, 0);
+  // Start with an empty, zero-capacity sentinel block so that the first Send()
+  // allocates a real block sized for the element type.
+  tail_block_ = new Block;
+  head_block_ = tail_block_;
+}
+
+JitChannelQueue::~JitChannelQueue() {
+  Block* block = head_block_;
+  while (block != nullptr) {
+    Block* next = block->next.load(std::memory_order_relaxed);
+    delete block;
+    block = next;
+  }
+  delete spare_block_.load(std::memory_order_relaxed);
+}
+
+void JitChannelQueue::AppendBlock(int64_t element_size) {
+  Block* block = spare_block_.exchange(nullptr, std::memory_order_acquire);
+  if (block != nullptr && block->element_size != element_size) {
+    delete block;
+    block = nullptr;
+  }
+  if (block == nullptr) {
+    block = new Block;
+    block->element_size = element_size;
+    block->capacity = block_capacity_;
+    block->data = std::make_unique<uint8_t[]>(block_capacity_ * element_size);
+  }
+  tail_block_->next.store(block, std::memory_order_release);
+  tail_block_ = block;
+  tail_index_ = 0;
+}
+
+void JitChannelQueue::AdvanceHeadBlock() {
+  Block* next = head_block_->next.load(std::memory_order_acquire);
+  XLS_CHECK(next != nullptr) << "Recv on empty channel queue " << channel_id_;
+  Block* drained = head_block_;
+  head_block_ = next;
+  head_index_ = 0;
+
+  if (drained->capacity == 0) {
+    // The initial sentinel block isn't worth recycling.
+    delete drained;
+    return;
+  }
+  drained->committed.store(0, std::memory_order_relaxed);
+  drained->next.store(nullptr, std::memory_order_relaxed);
+  delete spare_block_.exchange(drained, std::memory_order_acq_rel);
+}
+
 absl::StatusOr<std::unique_ptr<JitChannelQueueManager>>
 JitChannelQueueManager::Create(Package* package) {
   auto queue_mgr = absl::WrapUnique(new JitChannelQueueManager(package));
@@ -14,12 +14,17 @@
 #ifndef XLS_JIT_JIT_CHANNEL_QUEUE_H_
 #define XLS_JIT_JIT_CHANNEL_QUEUE_H_
 
+#include <atomic>
 #include <cstdint>
-#include <deque>
+#include <cstring>
+#include <limits>
+#include <memory>
 
+#include "absl/base/optimization.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/ir/package.h"
 
@@ -32,48 +37,169 @@ namespace xls {
 // (there's a high cost in marshaling LLVM data into a XLS Value).
 // If the need arises for custom queue implementations, this can be made
 // abstract.
-// TODO(rspringer): Add data pools to avoid extra memcpy and heap alloc.
+//
+// Each channel has exactly one producing and one consuming proc, so the queue
+// is a lock-free single-producer/single-consumer FIFO: at most one thread may
+// be in Send() and at most one thread in Recv()/Empty() at any time. (Handing
+// either role from one thread to another, e.g., enqueueing initial values from
+// the main thread, must be ordered by some other synchronization, as the proc
+// runtimes do with their per-proc mutexes.)
+//
+// Elements are stored inline in fixed-capacity blocks which are chained
+// together as the queue grows. Drained blocks are recycled, so a queue in
+// steady state performs no allocation. Producer and consumer state live on
+// separate cache lines to avoid false sharing.
+//
+// By default the queue is unbounded. A capacity (e.g., the depth of the FIFO
+// generated for the channel) may be set, in which case the proc runtimes
+// block a sender while the queue is Full(). Send() itself never blocks.
 class JitChannelQueue {
  public:
-  JitChannelQueue(int64_t channel_id) : channel_id_(channel_id) {}
+  // Number of elements held by each block of the queue.
+  static constexpr int64_t kDefaultBlockCapacity = 64;
+
+  // Capacity of a queue which may grow without bound.
+  static constexpr int64_t kUnboundedCapacity =
+      std::numeric_limits<int64_t>::max();
 
-  // Called to push data onto this queue/FIFO.
+  explicit JitChannelQueue(int64_t channel_id,
+                           int64_t block_capacity = kDefaultBlockCapacity);
+  ~JitChannelQueue();
+
+  JitChannelQueue(const JitChannelQueue&) = delete;
+  JitChannelQueue& operator=(const JitChannelQueue&) = delete;
+
+  // Called to push data onto this queue/FIFO. All elements of a queue must
+  // have the same size.
   void Send(uint8_t* data, int64_t num_bytes) {
 #ifdef ABSL_HAVE_MEMORY_SANITIZER
     __msan_unpoison(data, num_bytes);
 #endif
-    std::unique_ptr<uint8_t[]> buffer;
-    if (buffer_pool_.empty()) {
-      buffer = std::make_unique<uint8_t[]>(num_bytes);
-    } else {
-      buffer = std::move(buffer_pool_.back());
-      buffer_pool_.pop_back();
+    if (ABSL_PREDICT_FALSE(tail_index_ == tail_block_->capacity)) {
+      AppendBlock(num_bytes);
+    }
+    XLS_DCHECK_EQ(num_bytes, tail_block_->element_size);
+    memcpy(tail_block_->data.get() + tail_index_ * num_bytes, data, num_bytes);
+    ++tail_index_;
+    tail_block_->committed.store(tail_index_, std::memory_order_release);
+
+    int64_t sent = sent_count_.load(std::memory_order_relaxed) + 1;
+    sent_count_.store(sent, std::memory_order_relaxed);
+    int64_t occupancy =
+        sent - received_count_.load(std::memory_order_relaxed);
+    if (occupancy > high_water_mark_.load(std::memory_order_relaxed)) {
+      high_water_mark_.store(occupancy, std::memory_order_relaxed);
     }
-    memcpy(buffer.get(), data, num_bytes);
-    absl::MutexLock lock(&mutex_);
-    the_queue_.push_back(std::move(buffer));
   }
 
-  // Called to pull data off of this queue/FIFO.
+  // Called to pull data off of this queue/FIFO. The queue must not be empty.
   void Recv(uint8_t* buffer, int64_t num_bytes) {
-    absl::MutexLock lock(&mutex_);
-    memcpy(buffer, the_queue_.front().get(), num_bytes);
-    buffer_pool_.push_back(std::move(the_queue_.front()));
-    the_queue_.pop_front();
+    if (ABSL_PREDICT_FALSE(head_index_ == head_block_->capacity)) {
+      AdvanceHeadBlock();
+    }
+    XLS_DCHECK_LT(head_index_,
+                  head_block_->committed.load(std::memory_order_acquire));
+    XLS_DCHECK_EQ(num_bytes, head_block_->element_size);
+    memcpy(buffer, head_block_->data.get() + head_index_ * num_bytes,
+           num_bytes);
+    ++head_index_;
+    received_count_.store(received_count_.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+  }
+
+  // Returns true if the queue holds capacity() elements. Called by the
+  // producer; the consumer may concurrently make room.
+  bool Full() {
+    return capacity_ != kUnboundedCapacity &&
+           sent_count_.load(std::memory_order_relaxed) -
+                   received_count_.load(std::memory_order_acquire) >=
+               capacity_;
+  }
+
+  // Sets the maximum number of elements the queue holds before senders block.
+  // Must not be called while procs are running.
+  void set_capacity(int64_t capacity) {
+    XLS_CHECK_GE(capacity, 1);
+    capacity_ = capacity;
+  }
+  int64_t capacity() const { return capacity_; }
+
+  // Occupancy statistics for sizing FIFOs: the largest number of elements the
+  // queue has held, and the number of times the sender found the queue full or
+  // the receiver found it empty and had to block. The stall counts are
+  // recorded by the proc runtimes.
+  int64_t high_water_mark() const {
+    return high_water_mark_.load(std::memory_order_relaxed);
+  }
+  int64_t send_stall_count() const {
+    return send_stall_count_.load(std::memory_order_relaxed);
+  }
+  int64_t recv_stall_count() const {
+    return recv_stall_count_.load(std::memory_order_relaxed);
+  }
+  void RecordSendStall() {
+    send_stall_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void RecordRecvStall() {
+    recv_stall_count_.fetch_add(1, std::memory_order_relaxed);
   }
 
   bool Empty() {
-    absl::MutexLock lock(&mutex_);
-    return the_queue_.empty();
+    if (head_index_ <
+        head_block_->committed.load(std::memory_order_acquire)) {
+      return false;
+    }
+    if (head_index_ < head_block_->capacity) {
+      return true;
+    }
+    // The head block is exhausted; data may be waiting in the next one.
+    Block* next = head_block_->next.load(std::memory_order_acquire);
+    return next == nullptr ||
+           next->committed.load(std::memory_order_acquire) == 0;
   }
 
   int64_t channel_id() { return channel_id_; }
 
  protected:
+  static constexpr int64_t kCacheLineSize = 64;
+
+  struct Block {
+    // Number of elements written into this block. Stored by the producer with
+    // release semantics after the element data is written.
+    std::atomic<int64_t> committed{0};
+    // The following block, linked in by the producer once this one is full.
+    std::atomic<Block*> next{nullptr};
+    int64_t element_size = 0;
+    int64_t capacity = 0;
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  // Producer side: links a new (or recycled) block onto the tail.
+  void AppendBlock(int64_t element_size);
+
+  // Consumer side: moves to the next block and recycles the drained one.
+  void AdvanceHeadBlock();
+
   int64_t channel_id_;
-  absl::Mutex mutex_;
-  std::deque<std::unique_ptr<uint8_t[]>> the_queue_ ABSL_GUARDED_BY(mutex_);
-  std::vector<std::unique_ptr<uint8_t[]>> buffer_pool_;
+  int64_t block_capacity_;
+  int64_t capacity_ = kUnboundedCapacity;
+
+  // Producer-owned state. The counters are atomic so they may be read from
+  // other threads.
+  alignas(kCacheLineSize) Block* tail_block_;
+  int64_t tail_index_ = 0;
+  std::atomic<int64_t> sent_count_{0};
+  std::atomic<int64_t> high_water_mark_{0};
+  std::atomic<int64_t> send_stall_count_{0};
+
+  // Consumer-owned state.
+  alignas(kCacheLineSize) Block* head_block_;
+  int64_t head_index_ = 0;
+  std::atomic<int64_t> received_count_{0};
+  std::atomic<int64_t> recv_stall_count_{0};
+
+  // A drained block handed from the consumer back to the producer for reuse.
+  alignas(kCacheLineSize) std::atomic<Block*> spare_block_{nullptr};
 };
 
 // JitChannelQueue respository. Holds the set of queues known by a given proc.
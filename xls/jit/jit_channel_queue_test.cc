@@ -0,0 +1,133 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_channel_queue.h"
+
+#include <cstring>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/thread.h"
+
+namespace xls {
+namespace {
+
+void SendU64(JitChannelQueue* queue, uint64_t value) {
+  queue->Send(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+}
+
+uint64_t RecvU64(JitChannelQueue* queue) {
+  uint64_t value;
+  queue->Recv(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+  return value;
+}
+
+TEST(JitChannelQueueTest, FifoOrder) {
+  JitChannelQueue queue(/*channel_id=*/42, /*block_capacity=*/4);
+  EXPECT_EQ(queue.channel_id(), 42);
+  EXPECT_TRUE(queue.Empty());
+
+  // Enough elements to span several blocks.
+  for (uint64_t i = 0; i < 10; ++i) {
+    SendU64(&queue, i);
+  }
+  for (uint64_t i = 0; i < 10; ++i) {
+    EXPECT_FALSE(queue.Empty());
+    EXPECT_EQ(RecvU64(&queue), i);
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(JitChannelQueueTest, CapacityAndOccupancy) {
+  JitChannelQueue queue(/*channel_id=*/0, /*block_capacity=*/2);
+  EXPECT_EQ(queue.capacity(), JitChannelQueue::kUnboundedCapacity);
+  for (uint64_t i = 0; i < 5; ++i) {
+    SendU64(&queue, i);
+  }
+  EXPECT_FALSE(queue.Full());
+  EXPECT_EQ(queue.high_water_mark(), 5);
+
+  queue.set_capacity(3);
+  EXPECT_TRUE(queue.Full());
+  EXPECT_EQ(RecvU64(&queue), 0);
+  EXPECT_EQ(RecvU64(&queue), 1);
+  EXPECT_TRUE(queue.Full());
+  EXPECT_EQ(RecvU64(&queue), 2);
+  EXPECT_FALSE(queue.Full());
+  SendU64(&queue, 5);
+  EXPECT_TRUE(queue.Full());
+  EXPECT_EQ(queue.high_water_mark(), 5);
+
+  queue.RecordSendStall();
+  queue.RecordRecvStall();
+  queue.RecordRecvStall();
+  EXPECT_EQ(queue.send_stall_count(), 1);
+  EXPECT_EQ(queue.recv_stall_count(), 2);
+}
+
+TEST(JitChannelQueueTest, InterleavedAcrossBlockBoundaries) {
+  JitChannelQueue queue(/*channel_id=*/0, /*block_capacity=*/3);
+  uint64_t next_send = 0;
+  uint64_t next_recv = 0;
+  for (int64_t round = 0; round < 20; ++round) {
+    // Alternate between pushing slightly more and slightly fewer elements than
+    // are drained so the queue exercises both block growth and recycling.
+    int64_t sends = round % 2 == 0 ? 4 : 2;
+    for (int64_t i = 0; i < sends; ++i) {
+      SendU64(&queue, next_send++);
+    }
+    while (!queue.Empty() && next_recv + 1 < next_send) {
+      EXPECT_EQ(RecvU64(&queue), next_recv++);
+    }
+  }
+  while (!queue.Empty()) {
+    EXPECT_EQ(RecvU64(&queue), next_recv++);
+  }
+  EXPECT_EQ(next_recv, next_send);
+}
+
+TEST(JitChannelQueueTest, WideElements) {
+  JitChannelQueue queue(/*channel_id=*/0, /*block_capacity=*/2);
+  for (uint8_t i = 0; i < 5; ++i) {
+    uint8_t data[37];
+    memset(data, i, sizeof(data));
+    queue.Send(data, sizeof(data));
+  }
+  for (uint8_t i = 0; i < 5; ++i) {
+    uint8_t data[37];
+    queue.Recv(data, sizeof(data));
+    EXPECT_THAT(data, testing::Each(i));
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(JitChannelQueueTest, ConcurrentProducerConsumer) {
+  constexpr uint64_t kCount = 100000;
+  JitChannelQueue queue(/*channel_id=*/0, /*block_capacity=*/16);
+  Thread producer([&queue]() {
+    for (uint64_t i = 0; i < kCount; ++i) {
+      SendU64(&queue, i);
+    }
+  });
+  for (uint64_t i = 0; i < kCount; ++i) {
+    while (queue.Empty()) {
+    }
+    ASSERT_EQ(RecvU64(&queue), i);
+  }
+  producer.Join();
+  EXPECT_TRUE(queue.Empty());
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,104 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_compile_service.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+
+JitCompileService::JitCompileService(
+    int64_t thread_count, int64_t opt_level,
+    absl::optional<std::filesystem::path> object_cache_dir)
+    : opt_level_(opt_level), object_cache_dir_(std::move(object_cache_dir)) {
+  if (thread_count <= 0) {
+    thread_count = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  }
+  for (int64_t i = 0; i < thread_count; ++i) {
+    threads_.push_back(std::make_unique<Thread>([this]() { WorkerLoop(); }));
+  }
+}
+
+JitCompileService::~JitCompileService() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutting_down_ = true;
+  }
+  for (std::unique_ptr<Thread>& thread : threads_) {
+    thread->Join();
+  }
+}
+
+std::future<JitCompileService::Result> JitCompileService::Compile(
+    Function* function) {
+  Request request{function, std::promise<Result>()};
+  std::future<Result> future = request.promise.get_future();
+  absl::MutexLock lock(&mutex_);
+  XLS_CHECK(!shutting_down_);
+  queue_.push_back(std::move(request));
+  return future;
+}
+
+absl::StatusOr<std::vector<std::unique_ptr<IrJit>>>
+JitCompileService::CompileAll(absl::Span<Function* const> functions) {
+  std::vector<std::future<Result>> futures;
+  futures.reserve(functions.size());
+  for (Function* function : functions) {
+    futures.push_back(Compile(function));
+  }
+  // Wait for every compilation, even after an error, as the caller may free
+  // the functions once this returns.
+  std::vector<std::unique_ptr<IrJit>> jits;
+  absl::Status status;
+  for (std::future<Result>& future : futures) {
+    Result result = future.get();
+    if (!result.ok()) {
+      status.Update(result.status());
+      continue;
+    }
+    jits.push_back(std::move(result).value());
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return jits;
+}
+
+void JitCompileService::WorkerLoop() {
+  while (true) {
+    Request request;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          +[](JitCompileService* s) ABSL_EXCLUSIVE_LOCKS_REQUIRED(s->mutex_) {
+            return s->shutting_down_ || !s->queue_.empty();
+          },
+          this));
+      if (queue_.empty()) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    XLS_VLOG(2) << "Compiling " << request.function->name();
+    request.promise.set_value(
+        IrJit::Create(request.function, opt_level_, object_cache_dir_));
+  }
+}
+
+}  // namespace xls
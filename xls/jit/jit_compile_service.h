@@ -0,0 +1,93 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_JIT_COMPILE_SERVICE_H_
+#define XLS_JIT_JIT_COMPILE_SERVICE_H_
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>  // NOLINT(build/c++11)
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/common/thread.h"
+#include "xls/ir/function.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls {
+
+// Compiles XLS functions with the LLVM JIT on a pool of threads. Each
+// compilation gets its own IrJit (and hence its own LLVM context and ORC
+// session), so compilations are independent and their latency overlaps rather
+// than adding up. This pays off for clients which JIT many functions, e.g.
+// the functions of a multi-function package or the two sides of an
+// equivalence check.
+//
+// A function must not be modified (or destroyed) while it is being compiled,
+// i.e. until the future for it is ready.
+class JitCompileService {
+ public:
+  using Result = absl::StatusOr<std::unique_ptr<IrJit>>;
+
+  // Starts "thread_count" compile threads (or one per hardware thread if
+  // "thread_count" is not positive). The remaining arguments are passed to
+  // IrJit::Create for each function.
+  explicit JitCompileService(
+      int64_t thread_count, int64_t opt_level = 3,
+      absl::optional<std::filesystem::path> object_cache_dir = absl::nullopt);
+
+  // Finishes the compilations which have been requested and stops the
+  // threads.
+  ~JitCompileService();
+
+  // Queues "function" for compilation, returning a future holding the
+  // resulting JIT (or the compilation error). Functions are compiled in the
+  // order they are queued. May be called concurrently.
+  std::future<Result> Compile(Function* function);
+
+  // Compiles all of "functions" concurrently and waits for them. Returns the
+  // JITs in the order of "functions", or the first error.
+  absl::StatusOr<std::vector<std::unique_ptr<IrJit>>> CompileAll(
+      absl::Span<Function* const> functions);
+
+  int64_t thread_count() const { return threads_.size(); }
+
+ private:
+  struct Request {
+    Function* function;
+    std::promise<Result> promise;
+  };
+
+  // Body of each compile thread: compiles queued functions until shutdown.
+  void WorkerLoop();
+
+  const int64_t opt_level_;
+  const absl::optional<std::filesystem::path> object_cache_dir_;
+
+  absl::Mutex mutex_;
+  std::deque<Request> queue_ ABSL_GUARDED_BY(mutex_);
+  bool shutting_down_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_COMPILE_SERVICE_H_
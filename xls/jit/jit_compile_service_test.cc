@@ -0,0 +1,113 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_compile_service.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <future>  // NOLINT(build/c++11)
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/random_value.h"
+
+namespace xls {
+namespace {
+
+class JitCompileServiceTest : public IrTestBase {
+ protected:
+  // Adds "count" distinct functions to "p".
+  absl::StatusOr<std::vector<Function*>> AddFunctions(Package* p,
+                                                      int64_t count) {
+    std::vector<Function*> functions;
+    for (int64_t i = 0; i < count; ++i) {
+      XLS_ASSIGN_OR_RETURN(
+          Function * f,
+          ParseFunction(absl::StrFormat(R"(
+    fn f%d(x: bits[16], y: bits[16]) -> bits[16] {
+      literal.1: bits[16] = literal(value=%d)
+      add.2: bits[16] = add(x, literal.1)
+      ret umul.3: bits[16] = umul(add.2, y)
+    }
+    )",
+                                        i, i),
+                        p));
+      functions.push_back(f);
+    }
+    return functions;
+  }
+};
+
+TEST_F(JitCompileServiceTest, CompilesManyFunctions) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Function*> functions,
+                           AddFunctions(p.get(), 8));
+  JitCompileService service(/*thread_count=*/3);
+  EXPECT_EQ(service.thread_count(), 3);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<std::unique_ptr<IrJit>> jits,
+                           service.CompileAll(functions));
+  ASSERT_EQ(jits.size(), functions.size());
+
+  std::minstd_rand bitgen;
+  for (int64_t i = 0; i < functions.size(); ++i) {
+    EXPECT_EQ(jits[i]->function(), functions[i]);
+    std::vector<Value> args = RandomFunctionArguments(functions[i], &bitgen);
+    XLS_ASSERT_OK_AND_ASSIGN(Value expected,
+                             IrInterpreter::Run(functions[i], args));
+    XLS_ASSERT_OK_AND_ASSIGN(Value actual, jits[i]->Run(args));
+    EXPECT_EQ(actual, expected) << functions[i]->name();
+  }
+}
+
+TEST_F(JitCompileServiceTest, Futures) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Function*> functions,
+                           AddFunctions(p.get(), 2));
+  JitCompileService service(/*thread_count=*/0);
+  EXPECT_GE(service.thread_count(), 1);
+  std::future<JitCompileService::Result> first = service.Compile(functions[0]);
+  std::future<JitCompileService::Result> second =
+      service.Compile(functions[1]);
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> second_jit, second.get());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> first_jit, first.get());
+  EXPECT_EQ(first_jit->function(), functions[0]);
+  EXPECT_EQ(second_jit->function(), functions[1]);
+}
+
+TEST_F(JitCompileServiceTest, DestructionFinishesQueuedCompilations) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Function*> functions,
+                           AddFunctions(p.get(), 4));
+  std::vector<std::future<JitCompileService::Result>> futures;
+  {
+    JitCompileService service(/*thread_count=*/1);
+    for (Function* f : functions) {
+      futures.push_back(service.Compile(f));
+    }
+  }
+  for (std::future<JitCompileService::Result>& future : futures) {
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)),
+              std::future_status::ready);
+    XLS_EXPECT_OK(future.get().status());
+  }
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,108 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_events.h"
+
+#include "absl/strings/str_cat.h"
+#include "xls/common/logging/logging.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+thread_local JitEventBuffer* current_buffer = nullptr;
+
+}  // namespace
+
+JitEventBuffer::JitEventBuffer(int64_t capacity)
+    : capacity_(capacity), previous_(current_buffer) {
+  XLS_CHECK_GT(capacity, 0);
+  current_buffer = this;
+}
+
+JitEventBuffer::~JitEventBuffer() {
+  XLS_CHECK_EQ(current_buffer, this)
+      << "JitEventBuffers destroyed out of order";
+  current_buffer = previous_;
+}
+
+/* static */ JitEventBuffer* JitEventBuffer::Current() {
+  return current_buffer;
+}
+
+/* static */ void JitEventBuffer::RecordAssertionFailure(const Assert* node) {
+  if (current_buffer == nullptr) {
+    XLS_LOG(ERROR) << "Assertion failed: "
+                   << FormatEvent(Event{node, /*sequence=*/0});
+    return;
+  }
+  current_buffer->Record(node);
+}
+
+void JitEventBuffer::Record(const Assert* node) {
+  Event event{node, event_count_++};
+  if (!first_event_.has_value()) {
+    first_event_ = event;
+  }
+  if (ring_.size() < capacity_) {
+    ring_.push_back(event);
+    return;
+  }
+  ring_[ring_next_] = event;
+  ring_next_ = (ring_next_ + 1) % capacity_;
+}
+
+std::vector<JitEventBuffer::Event> JitEventBuffer::events() const {
+  std::vector<Event> events(ring_.begin() + ring_next_, ring_.end());
+  events.insert(events.end(), ring_.begin(), ring_.begin() + ring_next_);
+  return events;
+}
+
+std::vector<std::string> JitEventBuffer::Messages() const {
+  std::vector<std::string> messages;
+  for (const Event& event : events()) {
+    messages.push_back(FormatEvent(event));
+  }
+  return messages;
+}
+
+/* static */ std::string JitEventBuffer::FormatEvent(const Event& event) {
+  const Assert* node = event.node;
+  std::string result =
+      absl::StrCat(node->function_base()->name(), "::", node->GetName());
+  if (node->loc().has_value()) {
+    absl::StrAppend(&result, " [",
+                    node->package()->SourceLocationToString(*node->loc()),
+                    "]");
+  }
+  absl::StrAppend(&result, ": ", node->message());
+  return result;
+}
+
+absl::Status JitEventBuffer::FirstFailure() const {
+  if (!first_event_.has_value()) {
+    return absl::OkStatus();
+  }
+  return absl::AbortedError(first_event_->node->message());
+}
+
+void JitEventBuffer::Clear() {
+  ring_.clear();
+  ring_next_ = 0;
+  event_count_ = 0;
+  first_event_ = absl::nullopt;
+}
+
+}  // namespace xls
@@ -0,0 +1,108 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_JIT_EVENTS_H_
+#define XLS_JIT_JIT_EVENTS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+
+// Records the failed assertions of jitted code, so runs of many samples can
+// keep assertions enabled and report every failure at the end rather than
+// stopping at the first. (XLS IR has no trace operation yet; assertion
+// failures are the only events.)
+//
+// While a buffer exists it is installed for the thread which created it, and
+// every IrJit run on that thread records into it and succeeds regardless of
+// assertions. Runs on a thread without a buffer instead return an Aborted
+// error with the message of the first failed assertion, as the interpreter
+// does. Either way, code only calls out of LLVM space when an assertion
+// fails, so passing assertions cost a compare and an untaken branch.
+//
+// The buffer is a ring: it keeps the first event and the last "capacity", and
+// counts all of them. Messages are formatted only when read.
+//
+//   JitEventBuffer events;
+//   for (const std::vector<Value>& args : samples) {
+//     XLS_RETURN_IF_ERROR(jit->Run(args).status());
+//   }
+//   for (const std::string& message : events.Messages()) { ... }
+class JitEventBuffer {
+ public:
+  static constexpr int64_t kDefaultCapacity = 1024;
+
+  struct Event {
+    const Assert* node;
+    // The number of events recorded before this one.
+    int64_t sequence;
+  };
+
+  explicit JitEventBuffer(int64_t capacity = kDefaultCapacity);
+
+  // Reinstalls the buffer which was current when this one was created.
+  // Buffers must be destroyed in the reverse order of their creation.
+  ~JitEventBuffer();
+
+  JitEventBuffer(const JitEventBuffer&) = delete;
+  JitEventBuffer& operator=(const JitEventBuffer&) = delete;
+
+  // Returns the buffer installed for the calling thread, or null.
+  static JitEventBuffer* Current();
+
+  // Called by jitted code when "node" fails. Failures on a thread without a
+  // buffer are logged.
+  static void RecordAssertionFailure(const Assert* node);
+
+  // The number of events recorded, including those no longer retained.
+  int64_t event_count() const { return event_count_; }
+
+  absl::optional<Event> first_event() const { return first_event_; }
+
+  // Returns the retained events, oldest first.
+  std::vector<Event> events() const;
+
+  // Returns "<function>::<node> [<file>:<line>]: <message>" for each retained
+  // event, oldest first, where the source location is included if the node
+  // has one.
+  std::vector<std::string> Messages() const;
+  static std::string FormatEvent(const Event& event);
+
+  // Returns an Aborted error with the message of the first event, or Ok if
+  // there was none.
+  absl::Status FirstFailure() const;
+
+  void Clear();
+
+ private:
+  void Record(const Assert* node);
+
+  int64_t capacity_;
+  // The retained events; once full, the oldest is at "ring_next_".
+  std::vector<Event> ring_;
+  int64_t ring_next_ = 0;
+  int64_t event_count_ = 0;
+  absl::optional<Event> first_event_;
+  JitEventBuffer* previous_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_EVENTS_H_
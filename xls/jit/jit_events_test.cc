@@ -0,0 +1,137 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_events.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+constexpr char kPackage[] = R"(
+package p
+
+fn check(tkn: token, x: bits[8]) -> token {
+  literal.1: bits[8] = literal(value=100)
+  ult.2: bits[1] = ult(x, literal.1)
+  ret assert.3: token = assert(tkn, ult.2, message="x is too large")
+}
+
+fn main(x: bits[8]) -> bits[8] {
+  after_all.4: token = after_all()
+  invoke.5: token = invoke(after_all.4, x, to_apply=check)
+  literal.6: bits[8] = literal(value=0)
+  ne.7: bits[1] = ne(x, literal.6)
+  assert.8: token = assert(after_all.4, ne.7, message="x is zero")
+  ret add.9: bits[8] = add(x, x)
+}
+)";
+
+TEST(JitEventsTest, FirstFailureIsAnErrorWithoutBuffer) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
+  EXPECT_THAT(jit->Run({Value(UBits(5, 8))}),
+              IsOkAndHolds(Value(UBits(10, 8))));
+  EXPECT_THAT(jit->Run({Value(UBits(0, 8))}),
+              StatusIs(absl::StatusCode::kAborted, "x is zero"));
+  EXPECT_THAT(jit->Run({Value(UBits(200, 8))}),
+              StatusIs(absl::StatusCode::kAborted, "x is too large"));
+}
+
+TEST(JitEventsTest, BufferRecordsAllFailures) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
+
+  JitEventBuffer events;
+  EXPECT_EQ(JitEventBuffer::Current(), &events);
+  for (int64_t x : {0, 5, 100, 200}) {
+    EXPECT_THAT(jit->Run({Value(UBits(x, 8))}),
+                IsOkAndHolds(Value(UBits((2 * x) & 0xff, 8))));
+  }
+  EXPECT_EQ(events.event_count(), 3);
+  EXPECT_THAT(events.Messages(),
+              ElementsAre("main::assert.8: x is zero",
+                          "check::assert.3: x is too large",
+                          "check::assert.3: x is too large"));
+  EXPECT_THAT(events.FirstFailure(),
+              StatusIs(absl::StatusCode::kAborted, "x is zero"));
+
+  events.Clear();
+  EXPECT_EQ(events.event_count(), 0);
+  XLS_EXPECT_OK(events.FirstFailure());
+}
+
+TEST(JitEventsTest, RingKeepsLatestEvents) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * zero_assert, main->GetNode("assert.8"));
+
+  JitEventBuffer events(/*capacity=*/2);
+  std::vector<std::vector<Value>> arg_sets;
+  for (int64_t x : {0, 200, 0, 0}) {
+    arg_sets.push_back({Value(UBits(x, 8))});
+  }
+  XLS_ASSERT_OK(jit->RunBatch(arg_sets).status());
+  EXPECT_EQ(events.event_count(), 4);
+  std::vector<JitEventBuffer::Event> retained = events.events();
+  ASSERT_EQ(retained.size(), 2);
+  EXPECT_EQ(retained[0].sequence, 2);
+  EXPECT_EQ(retained[1].sequence, 3);
+  EXPECT_EQ(retained[1].node, zero_assert);
+  ASSERT_TRUE(events.first_event().has_value());
+  EXPECT_EQ(events.first_event()->sequence, 0);
+}
+
+TEST(JitEventsTest, NestedBuffers) {
+  EXPECT_EQ(JitEventBuffer::Current(), nullptr);
+  {
+    JitEventBuffer outer;
+    {
+      JitEventBuffer inner;
+      EXPECT_EQ(JitEventBuffer::Current(), &inner);
+    }
+    EXPECT_EQ(JitEventBuffer::Current(), &outer);
+    EXPECT_THAT(outer.Messages(), IsEmpty());
+  }
+  EXPECT_EQ(JitEventBuffer::Current(), nullptr);
+}
+
+TEST(JitEventsTest, AotCompilationRejectsAssertions) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  EXPECT_THAT(IrJit::CompileToObject(main, "main").status(),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+}  // namespace
+}  // namespace xls
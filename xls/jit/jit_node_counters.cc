@@ -0,0 +1,104 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_node_counters.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+// Returns the name of counter "index" of the node.
+std::string CounterName(Node* node, int64_t index) {
+  switch (node->op()) {
+    case Op::kSel:
+      return index < node->As<Select>()->cases().size()
+                 ? absl::StrCat("case", index)
+                 : "default";
+    case Op::kCountedFor:
+    case Op::kDynamicCountedFor:
+      return index == 0 ? "executions" : "iterations";
+    default:
+      return "executions";
+  }
+}
+
+}  // namespace
+
+uint64_t* JitNodeCounters::GetOrAllocate(Node* node, int64_t count) {
+  auto it = indices_.find(node);
+  if (it != indices_.end()) {
+    XLS_CHECK_EQ(counters_[it->second].size, count) << node->GetName();
+    return counters_[it->second].counts.get();
+  }
+  indices_[node] = counters_.size();
+  auto counts = std::make_unique<uint64_t[]>(count);
+  std::fill(counts.get(), counts.get() + count, 0);
+  counters_.push_back(NodeCounters{node, std::move(counts), count});
+  return counters_.back().counts.get();
+}
+
+absl::Span<const uint64_t> JitNodeCounters::Get(Node* node) const {
+  auto it = indices_.find(node);
+  if (it == indices_.end()) {
+    return {};
+  }
+  const NodeCounters& counters = counters_[it->second];
+  return absl::MakeConstSpan(counters.counts.get(), counters.size);
+}
+
+std::vector<Node*> JitNodeCounters::nodes() const {
+  std::vector<Node*> nodes;
+  nodes.reserve(counters_.size());
+  for (const NodeCounters& counters : counters_) {
+    nodes.push_back(counters.node);
+  }
+  return nodes;
+}
+
+void JitNodeCounters::Reset() {
+  for (NodeCounters& counters : counters_) {
+    std::fill(counters.counts.get(), counters.counts.get() + counters.size, 0);
+  }
+}
+
+std::string JitNodeCounters::ToString() const {
+  std::string result;
+  for (const NodeCounters& counters : counters_) {
+    Node* node = counters.node;
+    absl::StrAppend(&result, node->function_base()->name(),
+                    "::", node->GetName());
+    if (node->loc().has_value()) {
+      absl::StrAppend(&result, " [",
+                      node->package()->SourceLocationToString(*node->loc()),
+                      "]");
+    }
+    absl::StrAppend(&result, ":");
+    for (int64_t i = 0; i < counters.size; ++i) {
+      absl::StrAppendFormat(&result, " %s=%d", CounterName(node, i),
+                            counters.counts[i]);
+    }
+    absl::StrAppend(&result, "\n");
+  }
+  return result;
+}
+
+}  // namespace xls
@@ -0,0 +1,75 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_JIT_NODE_COUNTERS_H_
+#define XLS_JIT_JIT_NODE_COUNTERS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+
+// Execution counters for the nodes of instrumented jitted code (see
+// IrJit::CreateInstrumented()), giving activity profiles of designs at native
+// speed. The instrumented nodes and their counters are:
+//  - sel: the number of times each case, and the default, was selected.
+//  - counted_for and dynamic_counted_for: the number of times the loop was
+//    executed, and its total number of iterations.
+//  - invoke: the number of times the callee was executed.
+// Nodes of functions called from several places share their counters.
+//
+// Jitted code holds the addresses of the counters, so this object must outlive
+// it. Counters are updated without synchronization, so concurrent runs of
+// instrumented code may lose counts.
+class JitNodeCounters {
+ public:
+  // Returns the "count" counters of the given node, allocating them (zeroed)
+  // if the node has none yet. Addresses of counters are stable for the life of
+  // this object.
+  uint64_t* GetOrAllocate(Node* node, int64_t count);
+
+  // Returns the counters of the node; empty if it isn't instrumented.
+  absl::Span<const uint64_t> Get(Node* node) const;
+
+  // Returns the instrumented nodes, in the order they were instrumented.
+  std::vector<Node*> nodes() const;
+
+  // Zeroes all counters.
+  void Reset();
+
+  // Returns a dump of the counters, one node per line:
+  //   <function>::<node> [<file>:<line>]: <name>=<count> ...
+  // where the source location is included if the node has one.
+  std::string ToString() const;
+
+ private:
+  struct NodeCounters {
+    Node* node;
+    std::unique_ptr<uint64_t[]> counts;
+    int64_t size;
+  };
+
+  std::vector<NodeCounters> counters_;
+  absl::flat_hash_map<Node*, int64_t> indices_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_NODE_COUNTERS_H_
@@ -0,0 +1,94 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_node_counters.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls {
+namespace {
+
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::IsEmpty;
+
+constexpr char kPackage[] = R"(
+package p
+
+fn body(i: bits[4], acc: bits[8]) -> bits[8] {
+  zero_ext.1: bits[8] = zero_ext(i, new_bit_count=8)
+  ret add.2: bits[8] = add(acc, zero_ext.1)
+}
+
+fn double(x: bits[8]) -> bits[8] {
+  ret add.3: bits[8] = add(x, x)
+}
+
+fn main(s: bits[2], x: bits[8]) -> bits[8] {
+  literal.4: bits[8] = literal(value=1)
+  sel.5: bits[8] = sel(s, cases=[x, literal.4], default=x)
+  invoke.6: bits[8] = invoke(sel.5, to_apply=double)
+  ret counted_for.7: bits[8] = counted_for(invoke.6, trip_count=3, stride=1, body=body)
+}
+)";
+
+TEST(JitNodeCountersTest, CountsExecutions) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit,
+                           IrJit::CreateInstrumented(main));
+  for (int64_t s : {0, 1, 3, 3}) {
+    std::vector<Value> args = {Value(UBits(s, 2)), Value(UBits(10, 8))};
+    XLS_ASSERT_OK_AND_ASSIGN(Value result, jit->Run(args));
+    // (sel * 2) + 0 + 1 + 2
+    EXPECT_EQ(result, Value(UBits((s == 1 ? 1 : 10) * 2 + 3, 8)));
+  }
+
+  JitNodeCounters* counters = jit->node_counters();
+  ASSERT_NE(counters, nullptr);
+  XLS_ASSERT_OK_AND_ASSIGN(Node * sel, main->GetNode("sel.5"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * invoke, main->GetNode("invoke.6"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * counted_for, main->GetNode("counted_for.7"));
+  XLS_ASSERT_OK_AND_ASSIGN(Node * literal, main->GetNode("literal.4"));
+  EXPECT_THAT(counters->Get(sel), ElementsAre(1, 1, 2));
+  EXPECT_THAT(counters->Get(invoke), ElementsAre(4));
+  EXPECT_THAT(counters->Get(counted_for), ElementsAre(4, 12));
+  EXPECT_THAT(counters->Get(literal), IsEmpty());
+  EXPECT_THAT(counters->ToString(),
+              HasSubstr("main::sel.5: case0=1 case1=1 default=2\n"));
+  EXPECT_THAT(counters->ToString(),
+              HasSubstr("main::counted_for.7: executions=4 iterations=12\n"));
+
+  counters->Reset();
+  EXPECT_THAT(counters->Get(sel), ElementsAre(0, 0, 0));
+}
+
+TEST(JitNodeCountersTest, UninstrumentedJit) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPackage));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
+  EXPECT_EQ(jit->node_counters(), nullptr);
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,121 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_object_cache.h"
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "llvm/include/llvm/Config/llvm-config.h"
+#include "llvm/include/llvm/Support/MD5.h"
+#include "llvm/include/llvm/Support/raw_ostream.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+
+std::string JitObjectCache::ComputeKey(
+    const llvm::Module& module, int64_t opt_level,
+    const llvm::TargetMachine& target_machine) {
+  std::string module_text;
+  llvm::raw_string_ostream stream(module_text);
+  module.print(stream, /*AAW=*/nullptr);
+  stream.flush();
+
+  llvm::MD5 hash;
+  hash.update(module_text);
+  hash.update(absl::StrCat("opt_level=", opt_level, ";"));
+  hash.update(target_machine.getTargetTriple().str());
+  hash.update(";");
+  hash.update(target_machine.getTargetCPU());
+  hash.update(";");
+  hash.update(target_machine.getTargetFeatureString());
+  hash.update(";llvm=" LLVM_VERSION_STRING);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return absl::StrCat("xls_jit_", result.digest().str().str());
+}
+
+std::filesystem::path JitObjectCache::GetPath(const std::string& key) const {
+  return cache_dir_ / absl::StrCat(key, ".o");
+}
+
+absl::optional<std::string> JitObjectCache::ReadObject(
+    const std::string& key) const {
+  absl::StatusOr<std::string> contents = GetFileContents(GetPath(key));
+  if (!contents.ok()) {
+    if (!absl::IsNotFound(contents.status())) {
+      XLS_LOG(WARNING) << "Unable to read JIT object cache entry: "
+                       << contents.status();
+    }
+    return absl::nullopt;
+  }
+  return std::move(contents).value();
+}
+
+bool JitObjectCache::Contains(const std::string& key) {
+  absl::optional<std::string> contents = ReadObject(key);
+  if (!contents.has_value()) {
+    return false;
+  }
+  absl::MutexLock lock(&mutex_);
+  loaded_objects_[key] = std::move(contents).value();
+  return true;
+}
+
+void JitObjectCache::notifyObjectCompiled(const llvm::Module* module,
+                                          llvm::MemoryBufferRef object) {
+  std::string key = module->getModuleIdentifier();
+  absl::Status status = RecursivelyCreateDir(cache_dir_);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to create JIT object cache directory: "
+                     << status;
+    return;
+  }
+
+  // Concurrent readers, and writers of the same key in this or another
+  // process, never observe a partially-written object.
+  status = AtomicSetFileContents(
+      GetPath(key), absl::string_view(object.getBufferStart(),
+                                      object.getBufferSize()));
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to write JIT object cache entry: " << status;
+  }
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JitObjectCache::getObject(
+    const llvm::Module* module) {
+  const std::string key = module->getModuleIdentifier();
+  absl::optional<std::string> contents;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = loaded_objects_.find(key);
+    if (it != loaded_objects_.end()) {
+      contents = std::move(it->second);
+      loaded_objects_.erase(it);
+    }
+  }
+  if (!contents.has_value()) {
+    contents = ReadObject(key);
+    if (!contents.has_value()) {
+      return nullptr;
+    }
+  }
+  XLS_VLOG(1) << "Loaded JIT object from cache: " << GetPath(key).string();
+  return llvm::MemoryBuffer::getMemBufferCopy(*contents, key);
+}
+
+}  // namespace xls
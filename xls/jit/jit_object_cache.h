@@ -0,0 +1,79 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_JIT_OBJECT_CACHE_H_
+#define XLS_JIT_JIT_OBJECT_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "llvm/include/llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/include/llvm/IR/Module.h"
+#include "llvm/include/llvm/Support/MemoryBuffer.h"
+#include "llvm/include/llvm/Target/TargetMachine.h"
+
+namespace xls {
+
+// A content-addressed, on-disk cache of JIT-compiled object files. Objects are
+// stored in the cache directory under a key derived from the (unoptimized)
+// LLVM IR text of the module, the optimization level, and the target
+// (triple, CPU, features, and LLVM version) - see ComputeKey(). The key is
+// carried as the module identifier, which is how LLVM's ObjectCache interface
+// identifies modules.
+//
+// The cache may be shared by concurrent processes: entries are written to a
+// temporary file and atomically renamed into place. I/O failures are logged
+// and otherwise ignored, i.e., they only cost a recompile.
+class JitObjectCache : public llvm::ObjectCache {
+ public:
+  explicit JitObjectCache(std::filesystem::path cache_dir)
+      : cache_dir_(std::move(cache_dir)) {}
+
+  // Returns the cache key for the given module when compiled at the given
+  // optimization level for the given target machine.
+  static std::string ComputeKey(const llvm::Module& module, int64_t opt_level,
+                                const llvm::TargetMachine& target_machine);
+
+  // Returns true if the object file for the given key was read from the
+  // cache. The object is held in memory and handed out by the next getObject()
+  // for that key, so a hit here is never followed by a failed load; a failed
+  // read is a miss.
+  bool Contains(const std::string& key);
+
+  void notifyObjectCompiled(const llvm::Module* module,
+                            llvm::MemoryBufferRef object) override;
+  std::unique_ptr<llvm::MemoryBuffer> getObject(
+      const llvm::Module* module) override;
+
+ private:
+  std::filesystem::path GetPath(const std::string& key) const;
+
+  // Reads the object file for the given key, returning nullopt on a miss.
+  absl::optional<std::string> ReadObject(const std::string& key) const;
+
+  std::filesystem::path cache_dir_;
+  absl::Mutex mutex_;
+  // Objects read by Contains() which getObject() has not yet handed out.
+  absl::flat_hash_map<std::string, std::string> loaded_objects_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_OBJECT_CACHE_H_
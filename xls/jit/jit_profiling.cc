@@ -0,0 +1,94 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_profiling.h"
+
+#include <unistd.h>
+
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/strings/str_format.h"
+#include "llvm/include/llvm/Object/SymbolSize.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+
+ABSL_FLAG(bool, jit_gdb_registration, false,
+          "Register objects loaded by the JIT with the GDB JIT interface so "
+          "debuggers can symbolize jitted code.");
+ABSL_FLAG(bool, jit_perf_map, false,
+          "Write the symbols of jitted code to /tmp/perf-<pid>.map so perf "
+          "can attribute samples to XLS functions.");
+
+namespace xls {
+
+void PerfMapListener::notifyObjectLoaded(
+    ObjectKey key, const llvm::object::ObjectFile& object,
+    const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+  // The debug object has its sections relocated to their load addresses.
+  llvm::object::OwningBinary<llvm::object::ObjectFile> debug_object =
+      info.getObjectForDebug(object);
+  if (debug_object.getBinary() == nullptr) {
+    return;
+  }
+  std::string lines;
+  for (const auto& symbol_size :
+       llvm::object::computeSymbolSizes(*debug_object.getBinary())) {
+    const llvm::object::SymbolRef& symbol = symbol_size.first;
+    llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
+    if (!type) {
+      llvm::consumeError(type.takeError());
+      continue;
+    }
+    if (*type != llvm::object::SymbolRef::ST_Function) {
+      continue;
+    }
+    llvm::Expected<llvm::StringRef> name = symbol.getName();
+    llvm::Expected<uint64_t> address = symbol.getAddress();
+    if (!name || !address) {
+      llvm::consumeError(name.takeError());
+      llvm::consumeError(address.takeError());
+      continue;
+    }
+    absl::StrAppendFormat(&lines, "%x %x %s\n", *address, symbol_size.second,
+                          name->str());
+  }
+  if (lines.empty()) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  absl::Status status = AppendStringToFile(path_, lines);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to write JIT symbols to " << path_ << ": "
+                     << status;
+  }
+}
+
+PerfMapListener* GetPerfMapListener() {
+  static PerfMapListener* listener =
+      new PerfMapListener(absl::StrFormat("/tmp/perf-%d.map", getpid()));
+  return listener;
+}
+
+void RegisterProfilingListeners(llvm::orc::RTDyldObjectLinkingLayer* layer) {
+  if (absl::GetFlag(FLAGS_jit_gdb_registration)) {
+    layer->registerJITEventListener(
+        *llvm::JITEventListener::createGDBRegistrationListener());
+  }
+  if (absl::GetFlag(FLAGS_jit_perf_map)) {
+    layer->registerJITEventListener(*GetPerfMapListener());
+  }
+}
+
+}  // namespace xls
@@ -0,0 +1,60 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Support for profiling and debugging jitted code with external tools, which
+// otherwise only see anonymous addresses.
+
+#ifndef XLS_JIT_JIT_PROFILING_H_
+#define XLS_JIT_JIT_PROFILING_H_
+
+#include <filesystem>
+
+#include "absl/synchronization/mutex.h"
+#include "llvm/include/llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+
+namespace xls {
+
+// Appends a line "<start> <size> <symbol>" (the first two in hex) to a symbol
+// map file for each function in the objects loaded into a JIT. This is the
+// format perf reads from /tmp/perf-<pid>.map to symbolize samples in code
+// without a backing object file. The functions of an XLS function's module
+// are named after it, so samples are attributed to XLS functions.
+class PerfMapListener : public llvm::JITEventListener {
+ public:
+  explicit PerfMapListener(std::filesystem::path path)
+      : path_(std::move(path)) {}
+
+  void notifyObjectLoaded(
+      ObjectKey key, const llvm::object::ObjectFile& object,
+      const llvm::RuntimeDyld::LoadedObjectInfo& info) override;
+
+  const std::filesystem::path& path() const { return path_; }
+
+ private:
+  absl::Mutex mutex_;
+  std::filesystem::path path_;
+};
+
+// Returns the listener writing /tmp/perf-<pid>.map for this process.
+PerfMapListener* GetPerfMapListener();
+
+// Registers with the given layer the listeners enabled by the flags
+// --jit_gdb_registration (which registers loaded objects with the GDB JIT
+// interface, for symbolized backtraces in gdb and lldb) and --jit_perf_map.
+void RegisterProfilingListeners(llvm::orc::RTDyldObjectLinkingLayer* layer);
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_PROFILING_H_
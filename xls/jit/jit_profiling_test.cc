@@ -0,0 +1,54 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_profiling.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/jit/ir_jit.h"
+
+ABSL_DECLARE_FLAG(bool, jit_perf_map);
+
+namespace xls {
+namespace {
+
+using testing::ContainsRegex;
+
+TEST(JitProfilingTest, PerfMapHasFunctionSymbols) {
+  absl::SetFlag(&FLAGS_jit_perf_map, true);
+  Package package("profiled");
+  FunctionBuilder fb("add_one", &package);
+  fb.Add(fb.Param("x", package.GetBitsType(8)), fb.Literal(UBits(1, 8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<IrJit> jit, IrJit::Create(function));
+  XLS_ASSERT_OK_AND_ASSIGN(Value result, jit->Run({Value(UBits(41, 8))}));
+  EXPECT_EQ(result, Value(UBits(42, 8)));
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::string map,
+                           GetFileContents(GetPerfMapListener()->path()));
+  EXPECT_THAT(map, ContainsRegex("[0-9a-f]+ [0-9a-f]+ profiled::add_one\n"));
+  EXPECT_THAT(map, ContainsRegex("profiled::add_one_packed\n"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -14,10 +14,16 @@
 
 #include "xls/jit/jit_runtime.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "absl/strings/str_format.h"
 #include "llvm/include/llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/include/llvm/Support/TargetSelect.h"
 #include "llvm/include/llvm/Target/TargetMachine.h"
+#include "xls/data_structures/inline_bitmap.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/bits_ops.h"
 #include "xls/ir/format_preference.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/type.h"
@@ -55,18 +61,26 @@ Value JitRuntime::UnpackBuffer(const uint8_t* buffer, const Type* result_type) {
       const BitsType* bits_type = result_type->AsBitsOrDie();
       int64_t bit_count = bits_type->bit_count();
       int64_t byte_count = CeilOfRatio(bit_count, kCharBit);
+      if (data_layout_.isLittleEndian()) {
+        // The buffer has the same layout as the words backing the bitmap, so
+        // copy it a word at a time.
+        InlineBitmap bitmap(bit_count);
+        for (int64_t wordno = 0; wordno < bitmap.word_count(); ++wordno) {
+          uint64_t word = 0;
+          std::memcpy(&word, buffer + wordno * sizeof(word),
+                      std::min<int64_t>(sizeof(word),
+                                        byte_count - wordno * sizeof(word)));
+          bitmap.SetWord(wordno, word);
+        }
+        return Value(Bits::FromBitmap(std::move(bitmap)));
+      }
+
       absl::InlinedVector<uint8_t, 8> data;
       data.reserve(byte_count);
       for (int i = 0; i < byte_count; ++i) {
         data.push_back(buffer[i]);
       }
 
-      // We could copy the data out of the buffer to avoid a swap, but it's
-      // probably not worth the effort.
-      if (data_layout_.isLittleEndian()) {
-        ByteSwap(absl::MakeSpan(data));
-      }
-
       return Value(Bits::FromBytes(absl::MakeSpan(data), bit_count));
     }
     case TypeKind::kTuple: {
@@ -164,6 +178,281 @@ void JitRuntime::BlitValueToBuffer(const Value& value, const Type* type,
   }
 }
 
+namespace {
+
+// Appends the leaves of "value" to "leaves" in the order of the packed layout,
+// least significant first.
+void AppendPackedLeaves(const Value& value, const Type* type,
+                        std::vector<Bits>* leaves) {
+  switch (type->kind()) {
+    case TypeKind::kBits:
+      leaves->push_back(value.bits());
+      return;
+    case TypeKind::kArray: {
+      const ArrayType* array_type = type->AsArrayOrDie();
+      for (int64_t i = 0; i < array_type->size(); ++i) {
+        if (value.IsPackedArray()) {
+          leaves->push_back(value.element_bits(i));
+        } else {
+          AppendPackedLeaves(value.element(i), array_type->element_type(),
+                             leaves);
+        }
+      }
+      return;
+    }
+    case TypeKind::kTuple: {
+      const TupleType* tuple_type = type->AsTupleOrDie();
+      for (int64_t i = tuple_type->size() - 1; i >= 0; --i) {
+        AppendPackedLeaves(value.element(i), tuple_type->element_type(i),
+                           leaves);
+      }
+      return;
+    }
+    case TypeKind::kToken:
+      return;
+    default:
+      XLS_LOG(FATAL) << "Unsupported XLS type kind: " << type->kind();
+  }
+}
+
+// Returns the value of "type" held in "bits" starting at "*offset", advancing
+// "*offset" past it.
+Value ExtractPackedValue(const Bits& bits, const Type* type, int64_t* offset) {
+  switch (type->kind()) {
+    case TypeKind::kBits: {
+      int64_t bit_count = type->AsBitsOrDie()->bit_count();
+      Value value(bits.Slice(*offset, bit_count));
+      *offset += bit_count;
+      return value;
+    }
+    case TypeKind::kArray: {
+      const ArrayType* array_type = type->AsArrayOrDie();
+      if (array_type->size() == 0) {
+        return Value::ArrayOrDie({});
+      }
+      std::vector<Value> elements;
+      elements.reserve(array_type->size());
+      for (int64_t i = 0; i < array_type->size(); ++i) {
+        elements.push_back(
+            ExtractPackedValue(bits, array_type->element_type(), offset));
+      }
+      return Value::ArrayOwned(std::move(elements));
+    }
+    case TypeKind::kTuple: {
+      const TupleType* tuple_type = type->AsTupleOrDie();
+      std::vector<Value> elements(tuple_type->size());
+      for (int64_t i = tuple_type->size() - 1; i >= 0; --i) {
+        elements[i] =
+            ExtractPackedValue(bits, tuple_type->element_type(i), offset);
+      }
+      return Value::TupleOwned(std::move(elements));
+    }
+    case TypeKind::kToken:
+      return Value::Token();
+    default:
+      XLS_LOG(FATAL) << "Unsupported XLS type kind: " << type->kind();
+  }
+}
+
+}  // namespace
+
+Value JitRuntime::UnpackPackedBuffer(const uint8_t* buffer, const Type* type) {
+  // The buffer holds a single integer of the type's flat bit count.
+  Bits bits;
+  int64_t bit_count = type->GetFlatBitCount();
+  if (bit_count != 0) {
+    BitsType bits_type(bit_count);
+    bits = UnpackBuffer(buffer, &bits_type).bits();
+  }
+  int64_t offset = 0;
+  return ExtractPackedValue(bits, type, &offset);
+}
+
+void JitRuntime::BlitValueToPackedBuffer(const Value& value, const Type* type,
+                                         absl::Span<uint8_t> buffer) {
+  int64_t bit_count = type->GetFlatBitCount();
+  if (bit_count == 0) {
+    return;
+  }
+  std::vector<Bits> leaves;
+  AppendPackedLeaves(value, type, &leaves);
+  // Concat() takes its operands most significant first.
+  std::reverse(leaves.begin(), leaves.end());
+  BitsType bits_type(bit_count);
+  BlitValueToBuffer(Value(bits_ops::Concat(leaves)), &bits_type, buffer);
+}
+
+ValueMarshaller JitRuntime::CreateMarshaller(const Type* type) {
+  ValueMarshaller marshaller(data_layout_.isLittleEndian());
+  AddMarshallerSteps(type, /*offset=*/0, &marshaller);
+  return marshaller;
+}
+
+void JitRuntime::AddMarshallerSteps(const Type* type, int64_t offset,
+                                    ValueMarshaller* marshaller) {
+  switch (type->kind()) {
+    case TypeKind::kBits:
+      marshaller->steps_.push_back(
+          {TypeKind::kBits, offset, type->AsBitsOrDie()->bit_count()});
+      return;
+    case TypeKind::kTuple: {
+      const TupleType* tuple_type = type->AsTupleOrDie();
+      marshaller->steps_.push_back({TypeKind::kTuple, offset,
+                                    static_cast<int64_t>(tuple_type->size())});
+      for (int64_t i = 0; i < tuple_type->size(); ++i) {
+        AddMarshallerSteps(tuple_type->element_type(i),
+                           offset + GetTupleElementOffset(tuple_type, i),
+                           marshaller);
+      }
+      return;
+    }
+    case TypeKind::kArray: {
+      const ArrayType* array_type = type->AsArrayOrDie();
+      marshaller->steps_.push_back(
+          {TypeKind::kArray, offset, array_type->size()});
+      int64_t element_size = GetTypeByteSize(array_type->element_type());
+      for (int64_t i = 0; i < array_type->size(); ++i) {
+        AddMarshallerSteps(array_type->element_type(),
+                           offset + i * element_size, marshaller);
+      }
+      return;
+    }
+    case TypeKind::kToken:
+      marshaller->steps_.push_back({TypeKind::kToken, offset, 0});
+      return;
+    default:
+      XLS_LOG(FATAL) << "Unsupported XLS type kind: " << type->kind();
+  }
+}
+
+bool ValueMarshaller::Pack(const Value& value, uint8_t* buffer) const {
+  int64_t step = 0;
+  return PackStep(value, buffer, &step);
+}
+
+Value ValueMarshaller::Unpack(const uint8_t* buffer) const {
+  int64_t step = 0;
+  return UnpackStep(buffer, &step);
+}
+
+bool ValueMarshaller::PackStep(const Value& value, uint8_t* buffer,
+                               int64_t* step) const {
+  const Step& s = steps_[(*step)++];
+  switch (s.kind) {
+    case TypeKind::kBits:
+      return value.IsBits() && PackBits(value.bits(), s, buffer);
+    case TypeKind::kTuple:
+    case TypeKind::kArray:
+      if ((s.kind == TypeKind::kTuple ? !value.IsTuple() : !value.IsArray()) ||
+          value.size() != s.size) {
+        return false;
+      }
+      if (value.IsPackedArray()) {
+        // Avoid boxing the elements.
+        for (int64_t i = 0; i < s.size; ++i) {
+          const Step& element_step = steps_[(*step)++];
+          if (element_step.kind != TypeKind::kBits ||
+              !PackBits(value.element_bits(i), element_step, buffer)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      for (const Value& element : value.elements()) {
+        if (!PackStep(element, buffer, step)) {
+          return false;
+        }
+      }
+      return true;
+    case TypeKind::kToken:
+      return value.IsToken();
+    default:
+      XLS_LOG(FATAL) << "Unsupported XLS type kind: " << s.kind;
+  }
+}
+
+bool ValueMarshaller::PackBits(const Bits& bits, const Step& s,
+                               uint8_t* buffer) const {
+  if (bits.bit_count() != s.size) {
+    return false;
+  }
+  int64_t byte_count = CeilOfRatio(s.size, kCharBit);
+  bits.ToBytes(absl::MakeSpan(buffer + s.offset, byte_count),
+               /*big_endian=*/!little_endian_);
+  // As in BlitValueToBuffer(), bits above the bit count must be zero.
+  int remainder_bits = s.size % kCharBit;
+  if (remainder_bits != 0) {
+    buffer[s.offset + byte_count - 1] &=
+        static_cast<uint8_t>(Mask(remainder_bits));
+  }
+  return true;
+}
+
+Bits ValueMarshaller::UnpackBits(const Step& s, const uint8_t* buffer) const {
+  int64_t byte_count = CeilOfRatio(s.size, kCharBit);
+  if (little_endian_) {
+    InlineBitmap bitmap(s.size);
+    for (int64_t wordno = 0; wordno < bitmap.word_count(); ++wordno) {
+      uint64_t word = 0;
+      std::memcpy(&word, buffer + s.offset + wordno * sizeof(word),
+                  std::min<int64_t>(sizeof(word),
+                                    byte_count - wordno * sizeof(word)));
+      bitmap.SetWord(wordno, word);
+    }
+    return Bits::FromBitmap(std::move(bitmap));
+  }
+  return Bits::FromBytes(absl::MakeSpan(buffer + s.offset, byte_count),
+                         s.size);
+}
+
+Value ValueMarshaller::UnpackStep(const uint8_t* buffer, int64_t* step) const {
+  const Step& s = steps_[(*step)++];
+  switch (s.kind) {
+    case TypeKind::kBits:
+      return Value(UnpackBits(s, buffer));
+    case TypeKind::kTuple:
+    case TypeKind::kArray: {
+      if (s.kind == TypeKind::kArray && s.size == 0) {
+        return Value::ArrayOrDie({});
+      }
+      if (s.kind == TypeKind::kArray &&
+          steps_[*step].kind == TypeKind::kBits) {
+        // Let the array pack the elements if it is large enough.
+        std::vector<Bits> elements;
+        elements.reserve(s.size);
+        for (int64_t i = 0; i < s.size; ++i) {
+          elements.push_back(UnpackBits(steps_[(*step)++], buffer));
+        }
+        return Value::BitsArray(elements).value();
+      }
+      std::vector<Value> elements;
+      elements.reserve(s.size);
+      for (int64_t i = 0; i < s.size; ++i) {
+        elements.push_back(UnpackStep(buffer, step));
+      }
+      if (s.kind == TypeKind::kTuple) {
+        return Value::TupleOwned(std::move(elements));
+      }
+      return Value::ArrayOwned(std::move(elements));
+    }
+    case TypeKind::kToken:
+      return Value::Token();
+    default:
+      XLS_LOG(FATAL) << "Unsupported XLS type kind: " << s.kind;
+  }
+}
+
+int64_t JitRuntime::GetTypeByteSize(const Type* type) const {
+  return type_converter_->GetTypeByteSize(type);
+}
+
+int64_t JitRuntime::GetTupleElementOffset(const TupleType* type,
+                                          int64_t index) const {
+  llvm::Type* llvm_type = type_converter_->ConvertToLlvmType(type);
+  return data_layout_.getStructLayout(llvm::cast<llvm::StructType>(llvm_type))
+      ->getElementOffset(index);
+}
+
 template <typename T>
 std::string JitRuntime::DumpToString(const T& llvm_object) {
   std::string buffer;
@@ -16,23 +16,70 @@
 #define XLS_JIT_JIT_RUNTIME_H_
 
 #include <cstdint>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/types/span.h"
 #include "llvm/include/llvm/IR/DataLayout.h"
 #include "llvm/include/llvm/IR/LLVMContext.h"
 #include "llvm/include/llvm/Support/raw_ostream.h"
+#include "xls/common/math_util.h"
 #include "xls/interpreter/channel_queue.h"
 #include "xls/ir/type.h"
 #include "xls/ir/value.h"
+#include "xls/ir/value_view.h"
 #include "xls/jit/llvm_type_converter.h"
 
 namespace xls {
 
+// Converts Values of one type to and from the buffer layout used by the JIT,
+// following a plan computed once from the LLVM data layout. The plan lists the
+// type's nodes in preorder with their absolute buffer offsets, so packing and
+// unpacking are a single walk over the value with no type or layout queries.
+// Built by JitRuntime::CreateMarshaller().
+class ValueMarshaller {
+ public:
+  // Writes "value" into "buffer", which must hold the type's byte size.
+  // Returns false (leaving the buffer partially written) if "value" does not
+  // conform to the type.
+  bool Pack(const Value& value, uint8_t* buffer) const;
+
+  // Returns the value held in "buffer".
+  Value Unpack(const uint8_t* buffer) const;
+
+ private:
+  friend class JitRuntime;
+
+  struct Step {
+    TypeKind kind;
+    // For bits, the offset of the data in the buffer.
+    int64_t offset;
+    // For bits, the bit count; for tuples and arrays, the element count.
+    int64_t size;
+  };
+
+  explicit ValueMarshaller(bool little_endian)
+      : little_endian_(little_endian) {}
+
+  // Convert the value described by steps_[*step] and its successors,
+  // advancing "step" past them.
+  bool PackStep(const Value& value, uint8_t* buffer, int64_t* step) const;
+  Value UnpackStep(const uint8_t* buffer, int64_t* step) const;
+
+  bool PackBits(const Bits& bits, const Step& s, uint8_t* buffer) const;
+  Bits UnpackBits(const Step& s, const uint8_t* buffer) const;
+
+  bool little_endian_;
+  std::vector<Step> steps_;
+};
+
 // JitRuntime contains routines necessary for executing code generated by the
 // IR JIT. For type resolution, the JIT packs input data into and pulls
 // data out of a flat character buffer, thus these routines are necessary.
-class JitRuntime {
+//
+// JitRuntime is also the TypeLayout describing those buffers, so they can be
+// inspected with ValueViews or evaluated on by ViewInterpreter.
+class JitRuntime : public TypeLayout {
  public:
   JitRuntime(const llvm::DataLayout& data_layout,
              LlvmTypeConverter* type_converter);
@@ -55,11 +102,38 @@ class JitRuntime {
   void BlitValueToBuffer(const Value& value, const Type* type,
                          absl::Span<uint8_t> buffer);
 
+  // As UnpackBuffer() and BlitValueToBuffer(), but for the densely packed
+  // layout of the JIT's packed-view entry points (see
+  // IrJit::RunWithPackedBuffers()): the value's flat bits are stored as one
+  // integer of GetPackedTypeByteSize() bytes, with no padding between
+  // leaves. Array element 0 and the last tuple element occupy the least
+  // significant bits.
+  Value UnpackPackedBuffer(const uint8_t* buffer, const Type* type);
+  void BlitValueToPackedBuffer(const Value& value, const Type* type,
+                               absl::Span<uint8_t> buffer);
+  static int64_t GetPackedTypeByteSize(const Type* type) {
+    return CeilOfRatio(type->GetFlatBitCount(), int64_t{8});
+  }
+
+  // Returns a marshaller which performs the above conversions for values of
+  // "type" without consulting the data layout. Callers converting many values
+  // of the same type (e.g., the arguments of every call of a function) should
+  // create one up front.
+  ValueMarshaller CreateMarshaller(const Type* type);
+
+  int64_t GetTypeByteSize(const Type* type) const override;
+  int64_t GetTupleElementOffset(const TupleType* type,
+                                int64_t index) const override;
+
   // Returns a textual description of the argument LLVM object.
   template <typename T>
   static std::string DumpToString(const T& llvm_object);
 
  private:
+  // Appends the steps for "type" at "offset" in the buffer to "marshaller".
+  void AddMarshallerSteps(const Type* type, int64_t offset,
+                          ValueMarshaller* marshaller);
+
   llvm::DataLayout data_layout_;
   LlvmTypeConverter* type_converter_;
 };
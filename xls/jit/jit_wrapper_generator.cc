@@ -223,8 +223,11 @@ std::string CreateDeclSpecialization(const Function& function,
                          prepend_class_name, absl::StrJoin(params, ", "));
 }
 
+// "packed_call" is the function the implementation invokes with the packed
+// views of the arguments and result.
 std::string CreateImplSpecialization(const Function& function,
-                                     absl::string_view class_name) {
+                                     absl::string_view class_name,
+                                     absl::string_view packed_call) {
   if (!IsSpecializable(function)) {
     return "";
   }
@@ -256,11 +259,122 @@ std::string CreateImplSpecialization(const Function& function,
   param_names.push_back("return_value_view");
   return absl::StrFormat(R"(%s {
 %s;
-  XLS_RETURN_IF_ERROR(jit_->RunWithPackedViews(%s));
+  XLS_RETURN_IF_ERROR(%s(%s));
   return return_value;
 })",
                          signature, absl::StrJoin(param_conversions, ";\n"),
-                         absl::StrJoin(param_names, ", "));
+                         packed_call, absl::StrJoin(param_names, ", "));
+}
+
+// Returns the decl of the batched entry point of the given function, which
+// takes spans of the specialized types, or an empty string if not applicable.
+std::string CreateBatchDeclSpecialization(const Function& function,
+                                          std::string prepend_class_name = "") {
+  if (!IsSpecializable(function)) {
+    return "";
+  }
+
+  std::vector<std::string> params;
+  for (const Param* param : function.params()) {
+    std::string specialization =
+        MatchTypeSpecialization(*param->GetType()).value();
+    params.push_back(absl::StrFormat("absl::Span<const %s> %s", specialization,
+                                     param->name()));
+  }
+  params.push_back(absl::StrFormat(
+      "absl::Span<%s> results",
+      MatchTypeSpecialization(*function.return_value()->GetType()).value()));
+
+  if (!prepend_class_name.empty()) {
+    absl::StrAppend(&prepend_class_name, "::");
+  }
+
+  return absl::StrFormat("absl::Status %sRunBatch(%s);", prepend_class_name,
+                         absl::StrJoin(params, ", "));
+}
+
+// Returns the implementation of the batched entry point, which evaluates the
+// function on each element of its argument spans through packed views of the
+// elements, so no Values are constructed. "packed_call" is as for
+// CreateImplSpecialization().
+std::string CreateBatchImplSpecialization(const Function& function,
+                                          absl::string_view class_name,
+                                          absl::string_view packed_call) {
+  if (!IsSpecializable(function)) {
+    return "";
+  }
+
+  std::string signature =
+      CreateBatchDeclSpecialization(function, std::string(class_name));
+  signature.pop_back();
+
+  std::vector<std::string> size_checks;
+  std::vector<std::string> conversions;
+  std::vector<std::string> view_names;
+  for (const Param* param : function.params()) {
+    std::string element = absl::StrCat(param->name(), "_element");
+    size_checks.push_back(
+        absl::StrFormat("%s.size() != results.size()", param->name()));
+    // The views need mutable pointers, so the elements are copied.
+    conversions.push_back(absl::StrFormat(
+        "    %s %s = %s[i];\n    %s;\n",
+        MatchTypeSpecialization(*param->GetType()).value(), element,
+        param->name(), CreateConversion(element, *param->GetType()).value()));
+    view_names.push_back(absl::StrCat(element, "_view"));
+  }
+  const Type& return_type = *function.return_value()->GetType();
+  // Results narrower than their native type are only partially written.
+  conversions.push_back(absl::StrFormat(
+      "    %s& result_element = results[i];\n"
+      "    result_element = 0;\n"
+      "    %s;\n",
+      MatchTypeSpecialization(return_type).value(),
+      CreateConversion("result_element", return_type).value()));
+  view_names.push_back("result_element_view");
+
+  std::string size_check;
+  if (!size_checks.empty()) {
+    size_check = absl::StrFormat(R"(  if (%s) {
+    return absl::InvalidArgumentError(
+        "All batch arguments must have as many elements as the results.");
+  }
+)",
+                                 absl::StrJoin(size_checks, " || "));
+  }
+  return absl::StrFormat(R"(%s {
+%s  for (int64_t i = 0; i < results.size(); ++i) {
+%s    XLS_RETURN_IF_ERROR(%s(%s));
+  }
+  return absl::OkStatus();
+})",
+                         signature, size_check, absl::StrJoin(conversions, ""),
+                         packed_call, absl::StrJoin(view_names, ", "));
+}
+
+// Transforms "blah/genfiles/xls/foo/bar.h" into "XLS_FOO_BAR_H_".
+std::string HeaderGuard(const std::filesystem::path& header_path,
+                        const std::filesystem::path& genfiles_path) {
+  std::string header_guard =
+      std::string(header_path).substr(std::string(genfiles_path).size() + 1);
+  header_guard = absl::StrReplaceAll(
+      header_guard,
+      {
+          {absl::StrFormat("%c", header_path.preferred_separator), "_"},
+          {".", "_"},
+      });
+  return absl::StrCat(absl::AsciiStrToUpper(header_guard), "_");
+}
+
+// Returns the params of the packed-view Run() entry point.
+std::string PackedParams(const Function& function) {
+  std::vector<std::string> packed_params;
+  for (const Param* param : function.params()) {
+    packed_params.push_back(
+        absl::StrCat(PackedTypeString(*param->GetType()), " ", param->name()));
+  }
+  packed_params.push_back(absl::StrCat(
+      PackedTypeString(*function.return_value()->GetType()), " result"));
+  return absl::StrJoin(packed_params, ", ");
 }
 
 }  // namespace
@@ -274,7 +388,8 @@ std::string GenerateWrapperHeader(const Function& function,
   // $2 : Function name
   // $3 : Packed view params
   // $4 : Any interfaces for specially-matched types, e.g., an interface that
-  //      takes a float for a PackedTupleView<PackedBitsView<1>, ...>.
+  //      takes a float for a PackedTupleView<PackedBitsView<1>, ...>, and
+  //      the batched interface taking spans of them.
   // $5 : Header guard.
   constexpr const char header_template[] =
       R"(// Automatically-generated file! DO NOT EDIT!
@@ -284,6 +399,7 @@ std::string GenerateWrapperHeader(const Function& function,
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/ir/package.h"
 #include "xls/ir/value.h"
 #include "xls/ir/value_view.h"
@@ -323,21 +439,15 @@ class $0 {
   packed_params.push_back(absl::StrCat(
       PackedTypeString(*function.return_value()->GetType()), " result"));
 
-  // Transform "blah/genfiles/xls/foo/bar.h" into "XLS_FOO_BAR_H_"
-  std::string header_guard =
-      std::string(header_path).substr(std::string(genfiles_path).size() + 1);
-  header_guard = absl::StrReplaceAll(
-      header_guard,
-      {
-          {absl::StrFormat("%c", header_path.preferred_separator), "_"},
-          {".", "_"},
-      });
-  header_guard = absl::StrCat(absl::AsciiStrToUpper(header_guard), "_");
-
+  std::string header_guard = HeaderGuard(header_path, genfiles_path);
   return absl::Substitute(header_template, class_name,
                           absl::StrJoin(params, ", "), function.name(),
                           absl::StrJoin(packed_params, ", "),
-                          CreateDeclSpecialization(function), header_guard);
+                          absl::StrJoin({CreateDeclSpecialization(function),
+                                         CreateBatchDeclSpecialization(
+                                             function)},
+                                        "\n  "),
+                          header_guard);
 }
 
 std::string GenerateWrapperSource(const Function& function,
@@ -354,7 +464,8 @@ std::string GenerateWrapperSource(const Function& function,
   //  $6 : Function name (not camelized)
   //  $7 : Packed Run() params
   //  $8 : Packed RunWithPackedViews() arguments
-  //  $9 : Specially-matched type implementations (if any)
+  //  $9 : Specially-matched type implementations (if any), including the
+  //       batched interface
   constexpr const char source_template[] =
       R"-(// Automatically-generated file! DO NOT EDIT!
 #include "$5"
@@ -412,7 +523,12 @@ $9
   arg_list.push_back("result");
   std::string packed_args = absl::StrJoin(arg_list, ", ");
 
-  std::string specialization = CreateImplSpecialization(function, class_name);
+  std::string specialization = absl::StrCat(
+      CreateImplSpecialization(function, class_name,
+                               "jit_->RunWithPackedViews"),
+      "\n\n",
+      CreateBatchImplSpecialization(function, class_name,
+                                    "jit_->RunWithPackedViews"));
 
   return absl::Substitute(
       source_template, class_name, function.package()->DumpIr(), params,
@@ -420,6 +536,126 @@ $9
       packed_params, packed_args, specialization);
 }
 
+std::string GenerateWrapperBenchmark(const Function& function,
+                                     absl::string_view class_name,
+                                     const std::filesystem::path& header_path) {
+  //  $0 : Class name
+  //  $1 : Header path
+  //  $2 : Benchmark body
+  constexpr const char benchmark_template[] =
+      R"(// Automatically-generated file! DO NOT EDIT!
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/value_helpers.h"
+#include "$1"
+
+ABSL_FLAG(int64_t, batch_size, 1024,
+          "Number of evaluations per call of the batched entry point.");
+ABSL_FLAG(double, min_time_seconds, 1.0,
+          "Minimum time for which to run the benchmark.");
+
+namespace xls {
+namespace {
+
+// Returns a value of type T with random bits.
+template <typename T>
+T RandomElement(std::mt19937_64& rng) {
+  uint64_t bits = rng();
+  T value;
+  std::memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+absl::Status RealMain() {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<$0> wrapper, $0::Create());
+  absl::Duration min_time =
+      absl::Seconds(absl::GetFlag(FLAGS_min_time_seconds));
+$2
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  xls::InitXls(argv[0], argc, argv);
+  XLS_QCHECK_OK(xls::RealMain());
+  return 0;
+}
+)";
+
+  std::string body;
+  if (IsSpecializable(function)) {
+    // Time the batched entry point on random inputs.
+    std::vector<std::string> args;
+    absl::StrAppend(&body,
+                    "  int64_t batch_size = absl::GetFlag(FLAGS_batch_size);\n"
+                    "  std::mt19937_64 rng;\n");
+    for (const Param* param : function.params()) {
+      std::string type = MatchTypeSpecialization(*param->GetType()).value();
+      absl::StrAppendFormat(&body,
+                            "  std::vector<%s> %s(batch_size);\n"
+                            "  for (%s& element : %s) {\n"
+                            "    element = RandomElement<%s>(rng);\n"
+                            "  }\n",
+                            type, param->name(), type, param->name(), type);
+      args.push_back(std::string(param->name()));
+    }
+    absl::StrAppendFormat(
+        &body, "  std::vector<%s> results(batch_size);\n",
+        MatchTypeSpecialization(*function.return_value()->GetType()).value());
+    args.push_back("absl::MakeSpan(results)");
+    absl::StrAppendFormat(&body, R"(  int64_t calls = 0;
+  absl::Time start = absl::Now();
+  absl::Duration elapsed;
+  do {
+    XLS_RETURN_IF_ERROR(wrapper->RunBatch(%s));
+    calls += batch_size;
+    elapsed = absl::Now() - start;
+  } while (elapsed < min_time);
+  double ns_per_call = absl::ToDoubleNanoseconds(elapsed) / calls;
+  std::cout << absl::StreamFormat("%s::RunBatch: %%d calls, %%.2f ns/call\n",
+                                  calls, ns_per_call);)",
+                          absl::StrJoin(args, ", "), class_name);
+  } else {
+    // Only the Value interface is available: time it on zero-valued inputs.
+    std::vector<std::string> args;
+    for (int64_t i = 0; i < function.params().size(); ++i) {
+      args.push_back(absl::StrFormat("args[%d]", i));
+    }
+    absl::StrAppendFormat(&body, R"(  std::vector<Value> args;
+  for (Param* param : wrapper->jit()->function()->params()) {
+    args.push_back(ZeroOfType(param->GetType()));
+  }
+  int64_t calls = 0;
+  absl::Time start = absl::Now();
+  absl::Duration elapsed;
+  do {
+    XLS_RETURN_IF_ERROR(wrapper->Run(%s).status());
+    ++calls;
+    elapsed = absl::Now() - start;
+  } while (elapsed < min_time);
+  double ns_per_call = absl::ToDoubleNanoseconds(elapsed) / calls;
+  std::cout << absl::StreamFormat("%s::Run: %%d calls, %%.2f ns/call\n", calls,
+                                  ns_per_call);)",
+                          absl::StrJoin(args, ", "), class_name);
+  }
+  return absl::Substitute(benchmark_template, class_name, header_path.string(),
+                          body);
+}
+
 GeneratedJitWrapper GenerateJitWrapper(
     const Function& function, const std::string& class_name,
     const std::filesystem::path& header_path,
@@ -428,6 +664,109 @@ GeneratedJitWrapper GenerateJitWrapper(
   wrapper.header =
       GenerateWrapperHeader(function, class_name, header_path, genfiles_path);
   wrapper.source = GenerateWrapperSource(function, class_name, header_path);
+  wrapper.benchmark =
+      GenerateWrapperBenchmark(function, class_name, header_path);
+  return wrapper;
+}
+
+GeneratedJitWrapper GenerateAotWrapper(
+    const Function& function, const std::string& class_name,
+    absl::string_view symbol_name, const std::filesystem::path& header_path,
+    const std::filesystem::path& genfiles_path) {
+  // $0 : Class name
+  // $1 : Function name
+  // $2 : Packed view params
+  // $3 : Specialized and batched interfaces (if any)
+  // $4 : Header guard
+  // $5 : Entry point symbol
+  constexpr const char header_template[] =
+      R"(// Automatically-generated file! DO NOT EDIT!
+#ifndef $4
+#define $4
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/value_view.h"
+
+// Entry point of the ahead-of-time compiled code.
+extern "C" void $5(const uint8_t* const* inputs, uint8_t* output,
+                   void* user_data);
+
+namespace xls {
+
+// Ahead-of-time compiled execution wrapper for the $1 XLS IR function. The
+// compiled code is linked into the binary, so nothing is parsed or compiled
+// at run time.
+class $0 {
+ public:
+  static absl::StatusOr<std::unique_ptr<$0>> Create();
+
+  absl::Status Run($2);
+  $3
+};
+
+}  // namespace xls
+
+#endif  // $4
+)";
+
+  //  $0 : Class name
+  //  $1 : Header path
+  //  $2 : Packed Run() params
+  //  $3 : Entry point symbol
+  //  $4 : Input buffer declaration
+  //  $5 : Specialized and batched implementations (if any)
+  constexpr const char source_template[] =
+      R"(// Automatically-generated file! DO NOT EDIT!
+#include "$1"
+
+#include "absl/memory/memory.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+
+absl::StatusOr<std::unique_ptr<$0>> $0::Create() {
+  return absl::make_unique<$0>();
+}
+
+absl::Status $0::Run($2) {
+  $4
+  $3(inputs, result.buffer(), /*user_data=*/nullptr);
+  return absl::OkStatus();
+}
+
+$5
+
+}  // namespace xls
+)";
+
+  std::vector<std::string> buffers;
+  for (const Param* param : function.params()) {
+    buffers.push_back(absl::StrCat(param->name(), ".buffer()"));
+  }
+  // Zero-length arrays aren't valid C++.
+  std::string inputs =
+      buffers.empty()
+          ? "const uint8_t* const* inputs = nullptr;"
+          : absl::StrFormat("const uint8_t* const inputs[] = {%s};",
+                            absl::StrJoin(buffers, ", "));
+
+  GeneratedJitWrapper wrapper;
+  wrapper.header = absl::Substitute(
+      header_template, class_name, function.name(), PackedParams(function),
+      absl::StrJoin({CreateDeclSpecialization(function),
+                     CreateBatchDeclSpecialization(function)},
+                    "\n  "),
+      HeaderGuard(header_path, genfiles_path), symbol_name);
+  wrapper.source = absl::Substitute(
+      source_template, class_name, header_path.string(),
+      PackedParams(function), symbol_name, inputs,
+      absl::StrCat(CreateImplSpecialization(function, class_name, "Run"),
+                   "\n\n",
+                   CreateBatchImplSpecialization(function, class_name, "Run")));
   return wrapper;
 }
 
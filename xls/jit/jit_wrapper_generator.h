@@ -18,6 +18,7 @@
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "xls/ir/function.h"
 
 namespace xls {
@@ -26,10 +27,16 @@ namespace xls {
 struct GeneratedJitWrapper {
   std::string header;
   std::string source;
+  // A standalone program timing calls of the wrapper.
+  std::string benchmark;
 };
 
 // Generates a header and source file for a class that "wraps" JIT creation and
-// invocation for the given function.
+// invocation for the given function, and a benchmark for the class. If all the
+// params and the result of the function map to native types (unsigned integers
+// of up to 64 bits, floats and doubles), the class has a batched RunBatch()
+// entry point which evaluates the function on spans of them without
+// constructing any Values.
 // Args:
 //   function: The function for which to generate the wrapper.
 //   class_name: The name to give to the generated class.
@@ -40,6 +47,16 @@ GeneratedJitWrapper GenerateJitWrapper(
     const std::filesystem::path& header_path,
     const std::filesystem::path& genfiles_path);
 
+// Generates a header and source file for a class with the same packed-view and
+// native-type interfaces as the JIT wrapper above, but which calls the entry
+// point "symbol_name" of an object produced by IrJit::CompileToObject() rather
+// than the JIT, so it has no dependency on LLVM. The Value-based Run() isn't
+// available, and the benchmark is left empty.
+GeneratedJitWrapper GenerateAotWrapper(
+    const Function& function, const std::string& class_name,
+    absl::string_view symbol_name, const std::filesystem::path& header_path,
+    const std::filesystem::path& genfiles_path);
+
 }  // namespace xls
 
 #endif  // XLS_JIT_JIT_WRAPPER_GENERATOR_H_
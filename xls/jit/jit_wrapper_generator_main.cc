@@ -37,7 +37,7 @@ ABSL_FLAG(std::string, function, "",
           "in that case, the package-scoping mangling will be removed.");
 ABSL_FLAG(std::string, ir_path, "", "Path to the IR to wrap.");
 ABSL_FLAG(std::string, output_name, "",
-          "Name of the generated files, foo.h and foo.c. "
+          "Name of the generated files, foo.h, foo.cc and foo_benchmark.cc. "
           "If unspecified, the wrapped function name will be used.");
 ABSL_FLAG(std::string, output_dir, "",
           "Directory into which to write the output. "
@@ -101,6 +101,10 @@ absl::Status RealMain(const std::filesystem::path& ir_path,
   source_path.append(absl::StrCat(output_name, ".cc"));
   XLS_RETURN_IF_ERROR(SetFileContents(source_path, wrapper.source));
 
+  std::filesystem::path benchmark_path = output_path;
+  benchmark_path.append(absl::StrCat(output_name, "_benchmark.cc"));
+  XLS_RETURN_IF_ERROR(SetFileContents(benchmark_path, wrapper.benchmark));
+
   return absl::OkStatus();
 }
 
@@ -26,6 +26,9 @@
 namespace xls {
 namespace {
 
+using ::testing::HasSubstr;
+using ::testing::Not;
+
 TEST(JitWrapperGeneratorTest, GeneratesHeaderGuards) {
   constexpr const char kClassName[] = "MyClass";
   const std::filesystem::path kHeaderPath =
@@ -166,5 +169,103 @@ fn foo65(x: bits[65]) -> bits[65] {
   EXPECT_EQ(pos, std::string::npos);
 }
 
+TEST(JitWrapperGeneratorTest, GeneratesBatchEntryPoint) {
+  constexpr const char kClassName[] = "MyClass";
+  const std::filesystem::path kHeaderPath =
+      "some/silly/genfiles/path/this_is_myclass.h";
+
+  const std::string program = R"(package p
+
+fn add(x: bits[5], y: bits[5]) -> bits[5] {
+  ret add.3: bits[5] = add(x, y)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("add"));
+  GeneratedJitWrapper generated = GenerateJitWrapper(
+      *f, kClassName, kHeaderPath, "some/silly/genfiles/path");
+  EXPECT_THAT(generated.header,
+              HasSubstr("absl::Status RunBatch(absl::Span<const uint8_t> x, "
+                        "absl::Span<const uint8_t> y, "
+                        "absl::Span<uint8_t> results);"));
+  EXPECT_THAT(generated.source,
+              HasSubstr("absl::Status MyClass::RunBatch("
+                        "absl::Span<const uint8_t> x, "
+                        "absl::Span<const uint8_t> y, "
+                        "absl::Span<uint8_t> results) {"));
+  EXPECT_THAT(generated.source,
+              HasSubstr("if (x.size() != results.size() || "
+                        "y.size() != results.size()) {"));
+  EXPECT_THAT(generated.source,
+              HasSubstr("XLS_RETURN_IF_ERROR(jit_->RunWithPackedViews("
+                        "x_element_view, y_element_view, "
+                        "result_element_view));"));
+  EXPECT_THAT(generated.benchmark, HasSubstr("#include \"" +
+                                             kHeaderPath.string() + "\""));
+  EXPECT_THAT(generated.benchmark,
+              HasSubstr("wrapper->RunBatch(x, y, absl::MakeSpan(results))"));
+}
+
+TEST(JitWrapperGeneratorTest, NoBatchEntryPointForNonnativeTypes) {
+  constexpr const char kClassName[] = "MyClass";
+  const std::filesystem::path kHeaderPath =
+      "some/silly/genfiles/path/this_is_myclass.h";
+
+  const std::string program = R"(package p
+
+fn foo(x: (bits[5], bits[3])) -> bits[5] {
+  ret tuple_index.2: bits[5] = tuple_index(x, index=0)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("foo"));
+  GeneratedJitWrapper generated = GenerateJitWrapper(
+      *f, kClassName, kHeaderPath, "some/silly/genfiles/path");
+  EXPECT_THAT(generated.header, Not(HasSubstr("RunBatch")));
+  EXPECT_THAT(generated.benchmark, HasSubstr("wrapper->Run(args[0])"));
+}
+
+TEST(JitWrapperGeneratorTest, GeneratesAotWrapper) {
+  constexpr const char kClassName[] = "MyClass";
+  const std::filesystem::path kHeaderPath =
+      "some/silly/genfiles/path/this_is_myclass.h";
+
+  const std::string program = R"(package p
+
+fn foo(x: bits[8], y: bits[8]) -> bits[8] {
+  ret add.3: bits[8] = add(x, y)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("foo"));
+  GeneratedJitWrapper generated = GenerateAotWrapper(
+      *f, kClassName, "p_foo", kHeaderPath, "some/silly/genfiles/path");
+  EXPECT_THAT(generated.header, HasSubstr("THIS_IS_MYCLASS_H_"));
+  EXPECT_THAT(generated.header,
+              HasSubstr("extern \"C\" void p_foo(const uint8_t* const* inputs, "
+                        "uint8_t* output,"));
+  EXPECT_THAT(generated.header, Not(HasSubstr("ir_jit.h")));
+  EXPECT_THAT(generated.header,
+              HasSubstr("absl::StatusOr<uint8_t> Run(uint8_t x, uint8_t y);"));
+  EXPECT_THAT(generated.header, HasSubstr("RunBatch("));
+  EXPECT_THAT(generated.source,
+              HasSubstr("const uint8_t* const inputs[] = "
+                        "{x.buffer(), y.buffer()};"));
+  EXPECT_THAT(generated.source,
+              HasSubstr("p_foo(inputs, result.buffer(), "
+                        "/*user_data=*/nullptr);"));
+  EXPECT_THAT(generated.source,
+              HasSubstr("XLS_RETURN_IF_ERROR(Run(x_view, y_view, "
+                        "return_value_view));"));
+  EXPECT_THAT(generated.source, Not(HasSubstr("jit_")));
+  EXPECT_TRUE(generated.benchmark.empty());
+}
+
 }  // namespace
 }  // namespace xls
@@ -74,7 +74,7 @@ absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToLlvmConstant(
 absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToLlvmConstant(
     llvm::Type* type, const Value& value) {
   if (type->isIntegerTy()) {
-    return ToIntegralConstant(type, value);
+    return ToIntegralConstant(type, value.bits());
   } else if (type->isStructTy()) {
     std::vector<llvm::Constant*> llvm_elements;
     for (int i = 0; i < type->getStructNumElements(); ++i) {
@@ -89,6 +89,18 @@ absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToLlvmConstant(
   } else if (type->isArrayTy()) {
     std::vector<llvm::Constant*> elements;
     llvm::Type* element_type = type->getArrayElementType();
+    if (value.IsPackedArray()) {
+      elements.reserve(value.size());
+      for (int64_t i = 0; i < value.size(); ++i) {
+        XLS_ASSIGN_OR_RETURN(
+            llvm::Constant * llvm_element,
+            ToIntegralConstant(element_type, value.element_bits(i)));
+        elements.push_back(llvm_element);
+      }
+      return llvm::ConstantArray::get(
+          llvm::ArrayType::get(element_type, type->getArrayNumElements()),
+          elements);
+    }
     for (const Value& element : value.elements()) {
       XLS_ASSIGN_OR_RETURN(llvm::Constant * llvm_element,
                            ToLlvmConstant(element_type, element));
@@ -103,8 +115,7 @@ absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToLlvmConstant(
 }
 
 absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToIntegralConstant(
-    llvm::Type* type, const Value& value) {
-  Bits xls_bits = value.bits();
+    llvm::Type* type, const Bits& xls_bits) {
 
   if (xls_bits.bit_count() > 64) {
     std::vector<uint8_t> bytes = xls_bits.ToBytes();
@@ -121,7 +132,7 @@ absl::StatusOr<llvm::Constant*> LlvmTypeConverter::ToIntegralConstant(
     return llvm::ConstantInt::get(type,
                                   llvm::APInt(xls_bits.bit_count(), array_ref));
   } else {
-    XLS_ASSIGN_OR_RETURN(uint64_t bits, value.bits().ToUint64());
+    XLS_ASSIGN_OR_RETURN(uint64_t bits, xls_bits.ToUint64());
     return llvm::ConstantInt::get(type, bits);
   }
 }
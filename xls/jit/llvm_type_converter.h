@@ -65,7 +65,7 @@ class LlvmTypeConverter {
 
   // Handles the special (and base) case of converting Bits types to LLVM.
   absl::StatusOr<llvm::Constant*> ToIntegralConstant(llvm::Type* type,
-                                                     const Value& value);
+                                                     const Bits& xls_bits);
 
   llvm::LLVMContext& context_;
   llvm::DataLayout data_layout_;
@@ -0,0 +1,281 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/orc_jit.h"
+
+#include "absl/base/call_once.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "llvm/include/llvm-c/Target.h"
+#include "llvm/include/llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/include/llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/include/llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/include/llvm/IR/LegacyPassManager.h"
+#include "llvm/include/llvm/Support/CodeGen.h"
+#include "llvm/include/llvm/Support/raw_ostream.h"
+#include "llvm/include/llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/include/llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/include/llvm/Transforms/Scalar.h"
+#include "llvm/include/llvm/Transforms/Utils.h"
+#include "xls/common/logging/log_lines.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/logging/vlog_is_on.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/jit/jit_profiling.h"
+#include "xls/jit/jit_runtime.h"
+
+namespace xls {
+namespace {
+
+absl::once_flag once;
+void OnceInit() {
+  LLVMInitializeNativeTarget();
+  LLVMInitializeNativeAsmPrinter();
+  LLVMInitializeNativeAsmParser();
+}
+
+}  // namespace
+
+OrcJit::~OrcJit() {
+  if (auto err = execution_session_.endSession()) {
+    execution_session_.reportError(std::move(err));
+  }
+}
+
+OrcJit::OrcJit(int64_t opt_level)
+    : context_(std::make_unique<llvm::LLVMContext>()),
+      object_layer_(
+          execution_session_,
+          []() { return std::make_unique<llvm::SectionMemoryManager>(); }),
+      dylib_(execution_session_.createBareJITDylib("main")),
+      data_layout_(""),
+      opt_level_(opt_level) {}
+
+absl::StatusOr<std::unique_ptr<OrcJit>> OrcJit::Create(
+    int64_t opt_level, absl::optional<std::filesystem::path> object_cache_dir) {
+  if (opt_level != kJitFastCompileOptLevel &&
+      (opt_level < 0 || opt_level > 3)) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid JIT opt level %d; expected 0 to 3 or the fast-compile level",
+        opt_level));
+  }
+  absl::call_once(once, OnceInit);
+  auto jit = absl::WrapUnique(new OrcJit(opt_level));
+  if (object_cache_dir.has_value()) {
+    jit->object_cache_ = std::make_unique<JitObjectCache>(*object_cache_dir);
+  }
+  XLS_RETURN_IF_ERROR(jit->Init(/*position_independent=*/false));
+  return jit;
+}
+
+absl::StatusOr<std::unique_ptr<OrcJit>> OrcJit::CreateForObjectFiles(
+    int64_t opt_level) {
+  if (opt_level < 0 || opt_level > 3) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid opt level %d for object files; expected 0 to 3", opt_level));
+  }
+  absl::call_once(once, OnceInit);
+  auto jit = absl::WrapUnique(new OrcJit(opt_level));
+  XLS_RETURN_IF_ERROR(jit->Init(/*position_independent=*/true));
+  return jit;
+}
+
+std::unique_ptr<llvm::Module> OrcJit::NewModule(absl::string_view name) {
+  auto module = std::make_unique<llvm::Module>(
+      llvm::StringRef(name.data(), name.size()), *GetContext());
+  module->setDataLayout(data_layout_);
+  return module;
+}
+
+absl::Status OrcJit::CompileModule(std::unique_ptr<llvm::Module>&& module) {
+  if (object_cache_ != nullptr) {
+    // The key must be computed before optimization, as the point of the cache
+    // is to skip the optimizer entirely.
+    module->setModuleIdentifier(
+        JitObjectCache::ComputeKey(*module, opt_level_, *target_machine_));
+  }
+  llvm::Error error = transform_layer_->add(
+      dylib_, llvm::orc::ThreadSafeModule(std::move(module), context_));
+  if (error) {
+    return absl::UnknownError(absl::StrFormat(
+        "Error compiling converted IR: %s", llvm::toString(std::move(error))));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> OrcJit::CompileModuleToObject(
+    std::unique_ptr<llvm::Module>&& module) {
+  module->setTargetTriple(target_machine_->getTargetTriple().str());
+  OptimizeModule(module.get());
+
+  // As in OptimizeModule(), the stream must outlive the pass manager.
+  llvm::SmallVector<char, 0> stream_buffer;
+  llvm::raw_svector_ostream ostream(stream_buffer);
+  {
+    llvm::legacy::PassManager pass_manager;
+    if (target_machine_->addPassesToEmitFile(pass_manager, ostream, nullptr,
+                                             llvm::CGFT_ObjectFile)) {
+      return absl::InternalError(
+          "Target machine is unable to emit object files");
+    }
+    pass_manager.run(*module);
+  }
+  return std::string(stream_buffer.begin(), stream_buffer.end());
+}
+
+absl::StatusOr<llvm::JITTargetAddress> OrcJit::LoadSymbol(
+    absl::string_view function_name) {
+  llvm::Expected<llvm::JITEvaluatedSymbol> symbol = execution_session_.lookup(
+      &dylib_, llvm::StringRef(function_name.data(), function_name.size()));
+  if (!symbol) {
+    return absl::InternalError(
+        absl::StrFormat("Could not find start symbol \"%s\": %s",
+                        function_name, llvm::toString(symbol.takeError())));
+  }
+  return symbol->getAddress();
+}
+
+llvm::Expected<llvm::orc::ThreadSafeModule> OrcJit::Optimizer(
+    llvm::orc::ThreadSafeModule module,
+    const llvm::orc::MaterializationResponsibility& responsibility) {
+  llvm::Module* bare_module = module.getModuleUnlocked();
+  if (object_cache_ != nullptr &&
+      object_cache_->Contains(bare_module->getModuleIdentifier())) {
+    // The compile layer will load the cached object in place of this module,
+    // so there's no point in optimizing it.
+    XLS_VLOG(2) << "JIT object cache hit: "
+                << bare_module->getModuleIdentifier();
+    optimization_stats_.object_cache_hit = true;
+    return module;
+  }
+  OptimizeModule(bare_module);
+  return module;
+}
+
+void OrcJit::OptimizeModule(llvm::Module* bare_module) {
+  absl::Time start = absl::Now();
+  optimization_stats_.instructions_before_optimization +=
+      bare_module->getInstructionCount();
+
+  XLS_VLOG(2) << "Unoptimized module IR:";
+  XLS_VLOG(2).NoPrefix() << JitRuntime::DumpToString(*bare_module);
+
+  // The ostream and its buffer must be declared before the module_pass_manager
+  // because the destrutor of the pass manager calls flush on the ostream so
+  // these must be destructed *after* the pass manager. C++ guarantees that the
+  // destructors are called in reverse order the obects are declared.
+  llvm::SmallVector<char, 0> stream_buffer;
+  llvm::raw_svector_ostream ostream(stream_buffer);
+
+  llvm::legacy::PassManager module_pass_manager;
+  llvm::legacy::FunctionPassManager function_pass_manager(bare_module);
+  if (opt_level_ == kJitFastCompileOptLevel) {
+    function_pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
+    function_pass_manager.add(llvm::createInstructionCombiningPass());
+    function_pass_manager.add(llvm::createCFGSimplificationPass());
+  } else {
+    llvm::PassManagerBuilder builder;
+    builder.OptLevel = opt_level_;
+    builder.LibraryInfo =
+        new llvm::TargetLibraryInfoImpl(target_machine_->getTargetTriple());
+    builder.populateModulePassManager(module_pass_manager);
+    module_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(
+        target_machine_->getTargetIRAnalysis()));
+    builder.populateFunctionPassManager(function_pass_manager);
+  }
+  function_pass_manager.doInitialization();
+  for (auto& function : *bare_module) {
+    function_pass_manager.run(function);
+  }
+  function_pass_manager.doFinalization();
+
+  bool dump_asm = false;
+  if (XLS_VLOG_IS_ON(3)) {
+    dump_asm = true;
+    if (target_machine_->addPassesToEmitFile(
+            module_pass_manager, ostream, nullptr, llvm::CGFT_AssemblyFile)) {
+      XLS_VLOG(3) << "Could not create ASM generation pass!";
+      dump_asm = false;
+    }
+  }
+
+  module_pass_manager.run(*bare_module);
+  optimization_stats_.instructions_after_optimization +=
+      bare_module->getInstructionCount();
+  optimization_stats_.optimization_time += absl::Now() - start;
+
+  XLS_VLOG(2) << "Optimized module IR:";
+  XLS_VLOG(2).NoPrefix() << JitRuntime::DumpToString(*bare_module);
+
+  if (dump_asm) {
+    XLS_VLOG(3) << "Generated ASM:";
+    XLS_VLOG_LINES(3, std::string(stream_buffer.begin(), stream_buffer.end()));
+  }
+}
+
+absl::Status OrcJit::Init(bool position_independent) {
+  auto error_or_target_builder =
+      llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!error_or_target_builder) {
+    return absl::InternalError(
+        absl::StrCat("Unable to detect host: ",
+                     llvm::toString(error_or_target_builder.takeError())));
+  }
+
+  if (opt_level_ == kJitFastCompileOptLevel) {
+    error_or_target_builder->setCodeGenOptLevel(llvm::CodeGenOpt::None);
+  }
+  if (position_independent) {
+    error_or_target_builder->setRelocationModel(llvm::Reloc::PIC_);
+  }
+  auto error_or_target_machine = error_or_target_builder->createTargetMachine();
+  if (!error_or_target_machine) {
+    return absl::InternalError(
+        absl::StrCat("Unable to create target machine: ",
+                     llvm::toString(error_or_target_machine.takeError())));
+  }
+  target_machine_ = std::move(error_or_target_machine.get());
+  if (opt_level_ == kJitFastCompileOptLevel) {
+    target_machine_->setFastISel(true);
+  }
+  data_layout_ = target_machine_->createDataLayout();
+
+  execution_session_.runSessionLocked([this]() {
+    dylib_.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            data_layout_.getGlobalPrefix())));
+  });
+
+  RegisterProfilingListeners(&object_layer_);
+
+  auto compiler = std::make_unique<llvm::orc::SimpleCompiler>(
+      *target_machine_, object_cache_.get());
+  compile_layer_ = std::make_unique<llvm::orc::IRCompileLayer>(
+      execution_session_, object_layer_, std::move(compiler));
+
+  transform_layer_ = std::make_unique<llvm::orc::IRTransformLayer>(
+      execution_session_, *compile_layer_,
+      [this](llvm::orc::ThreadSafeModule module,
+             const llvm::orc::MaterializationResponsibility& responsibility) {
+        return Optimizer(std::move(module), responsibility);
+      });
+
+  return absl::OkStatus();
+}
+
+}  // namespace xls
@@ -0,0 +1,152 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_ORC_JIT_H_
+#define XLS_JIT_ORC_JIT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "llvm/include/llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/IRTransformLayer.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/include/llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/include/llvm/IR/DataLayout.h"
+#include "llvm/include/llvm/IR/LLVMContext.h"
+#include "llvm/include/llvm/IR/Module.h"
+#include "llvm/include/llvm/Target/TargetMachine.h"
+#include "xls/jit/jit_object_cache.h"
+
+namespace xls {
+
+// Opt level (in place of an LLVM level from 0 to 3) selecting the fast-compile
+// pipeline: a minimal list of scalar passes (register promotion, instruction
+// combining and CFG simplification, with no loop or vector passes) followed by
+// FastISel code generation without codegen optimizations. The generated code
+// is slower than at higher levels but compiles several times faster, which
+// wins for functions evaluated too few times to amortize -O3.
+constexpr int64_t kJitFastCompileOptLevel = -1;
+
+// Statistics about the compilation of a module by the JIT.
+struct JitCompileStats {
+  // Time spent generating LLVM IR (filled in by IrJit).
+  absl::Duration ir_generation_time;
+  // Time spent in the LLVM optimization pipeline; zero on an object cache hit.
+  absl::Duration optimization_time;
+  // Wall time of the whole compilation, including code generation.
+  absl::Duration total_time;
+  // The number of LLVM instructions in the module before and after
+  // optimization.
+  int64_t instructions_before_optimization = 0;
+  int64_t instructions_after_optimization = 0;
+  bool object_cache_hit = false;
+};
+
+// Wraps the LLVM ORC machinery used to turn LLVM modules into host code: an
+// execution session, a dylib into which modules are compiled, and an
+// optimizing IR transform layer. Generators of LLVM IR (e.g., IrJit) populate
+// modules created in this object's context and then look up entry points by
+// symbol name.
+class OrcJit {
+ public:
+  ~OrcJit();
+
+  // "opt_level" is an LLVM opt level from 0 to 3, or kJitFastCompileOptLevel.
+  // If "object_cache_dir" is given, compiled objects are stored in (and, when
+  // the same module is compiled again, loaded from) that directory, skipping
+  // both optimization and code generation on a cache hit. See
+  // jit_object_cache.h.
+  static absl::StatusOr<std::unique_ptr<OrcJit>> Create(
+      int64_t opt_level,
+      absl::optional<std::filesystem::path> object_cache_dir = absl::nullopt);
+
+  // As above, but for use with CompileModuleToObject(): code is generated
+  // position-independent so the objects can be linked into any host binary.
+  static absl::StatusOr<std::unique_ptr<OrcJit>> CreateForObjectFiles(
+      int64_t opt_level);
+
+  // Returns a new, empty module in this JIT's context with the host data
+  // layout already applied.
+  std::unique_ptr<llvm::Module> NewModule(absl::string_view name);
+
+  // Optimizes and compiles the given module into the JIT's dylib. Symbols
+  // defined in the module are available via LoadSymbol() afterwards. When an
+  // object cache is in use, the module's identifier is replaced with its cache
+  // key.
+  absl::Status CompileModule(std::unique_ptr<llvm::Module>&& module);
+
+  // Optimizes the given module as CompileModule() would, but emits it as a
+  // relocatable object file for the host (returned as its contents) instead of
+  // loading it into the JIT's dylib.
+  absl::StatusOr<std::string> CompileModuleToObject(
+      std::unique_ptr<llvm::Module>&& module);
+
+  // Returns the address of the given compiled function.
+  absl::StatusOr<llvm::JITTargetAddress> LoadSymbol(
+      absl::string_view function_name);
+
+  llvm::LLVMContext* GetContext() { return context_.getContext(); }
+  const llvm::DataLayout& GetDataLayout() { return data_layout_; }
+  llvm::TargetMachine* GetTargetMachine() { return target_machine_.get(); }
+  int64_t opt_level() const { return opt_level_; }
+
+  // Returns statistics about the optimization of the modules compiled so far
+  // (the timing fields other than optimization_time are left zero).
+  const JitCompileStats& optimization_stats() const {
+    return optimization_stats_;
+  }
+
+ private:
+  explicit OrcJit(int64_t opt_level);
+
+  // Performs non-trivial initialization (i.e., that which can fail).
+  absl::Status Init(bool position_independent);
+
+  // Runs the optimization pipeline for "opt_level_" over the module in place.
+  void OptimizeModule(llvm::Module* module);
+
+  llvm::Expected<llvm::orc::ThreadSafeModule> Optimizer(
+      llvm::orc::ThreadSafeModule module,
+      const llvm::orc::MaterializationResponsibility& responsibility);
+
+  llvm::orc::ThreadSafeContext context_;
+  llvm::orc::ExecutionSession execution_session_;
+  llvm::orc::RTDyldObjectLinkingLayer object_layer_;
+  llvm::orc::JITDylib& dylib_;
+  llvm::DataLayout data_layout_;
+
+  std::unique_ptr<llvm::TargetMachine> target_machine_;
+  std::unique_ptr<llvm::orc::IRCompileLayer> compile_layer_;
+  std::unique_ptr<llvm::orc::IRTransformLayer> transform_layer_;
+
+  int64_t opt_level_;
+  JitCompileStats optimization_stats_;
+
+  // Non-null if compiled objects should be cached on disk.
+  std::unique_ptr<JitObjectCache> object_cache_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_ORC_JIT_H_
@@ -0,0 +1,310 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/jit/parallel_proc_runtime.h"
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
+#include "xls/ir/proc.h"
+#include "xls/jit/function_builder_visitor.h"
+
+namespace xls {
+namespace {
+
+// Channels fed from outside the network are written directly through their
+// queues, which doesn't wake the receiver, so receivers on such channels poll.
+constexpr absl::Duration kExternalPollInterval = absl::Milliseconds(1);
+
+}  // namespace
+
+void ParallelProcRuntime::ThreadFn(ThreadData* thread_data) {
+  ParallelProcRuntime* runtime = thread_data->runtime;
+  int64_t generation = 0;
+  while (true) {
+    {
+      absl::MutexLock lock(&runtime->mutex_);
+      struct AwaitData {
+        ParallelProcRuntime* runtime;
+        int64_t generation;
+      };
+      AwaitData await_data({runtime, generation});
+      runtime->mutex_.Await(absl::Condition(
+          +[](AwaitData* await_data) {
+            await_data->runtime->mutex_.AssertReaderHeld();
+            return await_data->runtime->cancelled_ ||
+                   await_data->runtime->generation_ > await_data->generation;
+          },
+          &await_data));
+      if (runtime->cancelled_) {
+        return;
+      }
+      generation = runtime->generation_;
+    }
+
+    // RunWithViews takes an array of arg view pointers - even if they're unused
+    // during execution, tokens still occupy one of those spots.
+    std::vector<uint8_t*> args({nullptr, thread_data->proc_state.get()});
+    XLS_CHECK_OK(thread_data->jit->RunWithViews(
+        absl::MakeSpan(args),
+        absl::MakeSpan(thread_data->proc_state.get(),
+                       thread_data->proc_state_size),
+        thread_data));
+
+    absl::MutexLock lock(&runtime->mutex_);
+    if (runtime->cancelled_) {
+      return;
+    }
+    runtime->done_count_++;
+  }
+}
+
+// A receive on an empty queue (or a send on a full one) registers the proc as
+// blocked and sleeps until the proc at the other end of the channel clears the
+// registration. The other end only takes the runtime lock when some proc is
+// blocked; the fences below ensure that either it observes the registration or
+// the blocked proc observes the change to the queue.
+bool ParallelProcRuntime::WaitOnChannel(ThreadData* thread_data,
+                                        JitChannelQueue* queue,
+                                        bool (*ready)(JitChannelQueue*)) {
+  ParallelProcRuntime* runtime = thread_data->runtime;
+  absl::MutexLock lock(&runtime->mutex_);
+  while (true) {
+    if (runtime->cancelled_) {
+      return false;
+    }
+    thread_data->blocking_channel = queue->channel_id();
+    thread_data->blocked_on_external =
+        runtime->package_->GetChannel(queue->channel_id()).value()
+            ->supported_ops() == ChannelOps::kReceiveOnly;
+    if (thread_data->blocked_on_external) {
+      runtime->external_blocked_count_++;
+    }
+    runtime->blocked_count_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!ready(queue)) {
+      absl::Condition woken(
+          +[](ThreadData* thread_data) {
+            thread_data->runtime->mutex_.AssertReaderHeld();
+            return thread_data->blocking_channel == kNotBlocked ||
+                   thread_data->runtime->cancelled_;
+          },
+          thread_data);
+      if (thread_data->blocked_on_external) {
+        runtime->mutex_.AwaitWithTimeout(woken, kExternalPollInterval);
+      } else {
+        runtime->mutex_.Await(woken);
+      }
+    }
+
+    // Clear the registration if nobody else did.
+    if (thread_data->blocking_channel != kNotBlocked) {
+      thread_data->blocking_channel = kNotBlocked;
+      runtime->blocked_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (thread_data->blocked_on_external) {
+      thread_data->blocked_on_external = false;
+      runtime->external_blocked_count_--;
+    }
+    if (ready(queue)) {
+      return true;
+    }
+  }
+}
+
+void ParallelProcRuntime::RecvFn(JitChannelQueue* queue, Receive* recv,
+                                 uint8_t* data, int64_t data_bytes,
+                                 void* user_data) {
+  ThreadData* thread_data = reinterpret_cast<ThreadData*>(user_data);
+  if (queue->Empty()) {
+    queue->RecordRecvStall();
+    if (!WaitOnChannel(thread_data, queue, +[](JitChannelQueue* queue) {
+          return !queue->Empty();
+        })) {
+      return;
+    }
+  }
+  queue->Recv(data, data_bytes);
+  if (queue->capacity() != JitChannelQueue::kUnboundedCapacity) {
+    // The sender may be blocked on the queue being full.
+    thread_data->runtime->WakeBlockedProcs(queue->channel_id());
+  }
+}
+
+void ParallelProcRuntime::SendFn(JitChannelQueue* queue, Send* send,
+                                 uint8_t* data, int64_t data_bytes,
+                                 void* user_data) {
+  ThreadData* thread_data = reinterpret_cast<ThreadData*>(user_data);
+  if (queue->Full()) {
+    queue->RecordSendStall();
+    if (!WaitOnChannel(thread_data, queue, +[](JitChannelQueue* queue) {
+          return !queue->Full();
+        })) {
+      return;
+    }
+  }
+  queue->Send(data, data_bytes);
+  thread_data->runtime->WakeBlockedProcs(queue->channel_id());
+}
+
+void ParallelProcRuntime::WakeBlockedProcs(int64_t channel_id) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (blocked_count_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  for (auto& thread_data : threads_) {
+    // Both the sender and the receiver of the channel may be registered
+    // briefly, until a blocked proc re-checks the queue.
+    if (thread_data->blocking_channel == channel_id) {
+      thread_data->blocking_channel = kNotBlocked;
+      blocked_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+bool ParallelProcRuntime::TickFinished() const {
+  int64_t running = threads_.size() - done_count_;
+  if (running == 0) {
+    return true;
+  }
+  // Every proc which hasn't finished is waiting on another proc in the
+  // network, so none of them can make progress.
+  return blocked_count_.load(std::memory_order_relaxed) == running &&
+         external_blocked_count_ == 0;
+}
+
+absl::StatusOr<std::unique_ptr<ParallelProcRuntime>>
+ParallelProcRuntime::Create(Package* package) {
+  auto runtime = absl::WrapUnique(new ParallelProcRuntime(package));
+  XLS_RETURN_IF_ERROR(runtime->Init());
+  return runtime;
+}
+
+ParallelProcRuntime::~ParallelProcRuntime() {
+  {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+  }
+  for (auto& thread_data : threads_) {
+    thread_data->thread->Join();
+  }
+}
+
+absl::Status ParallelProcRuntime::Init() {
+  XLS_ASSIGN_OR_RETURN(queue_mgr_, JitChannelQueueManager::Create(package_));
+
+  threads_.reserve(package_->procs().size());
+  for (int i = 0; i < package_->procs().size(); i++) {
+    auto thread = std::make_unique<ThreadData>();
+    thread->runtime = this;
+    Proc* proc = package_->procs()[i].get();
+    XLS_ASSIGN_OR_RETURN(thread->jit, IrJit::CreateProc(proc, queue_mgr_.get(),
+                                                        &RecvFn, &SendFn));
+    auto* jit = thread->jit.get();
+
+    thread->proc_state_size = jit->GetReturnTypeSize();
+    thread->proc_state = std::make_unique<uint8_t[]>(thread->proc_state_size);
+    jit->runtime()->BlitValueToBuffer(
+        proc->InitValue(),
+        FunctionBuilderVisitor::GetEffectiveReturnValue(proc)->GetType(),
+        absl::MakeSpan(thread->proc_state.get(), jit->GetReturnTypeSize()));
+    threads_.push_back(std::move(thread));
+  }
+
+  // Enqueue initial values into channels before any proc can run.
+  for (Channel* channel : package_->channels()) {
+    if (!channel->IsStreaming()) {
+      return absl::UnimplementedError(
+          "Only streaming channels are supported in parallel proc runtime.");
+    }
+    for (const Value& value : channel->initial_values()) {
+      XLS_RETURN_IF_ERROR(EnqueueValueToChannel(channel, value));
+    }
+  }
+
+  // Start the threads - each waits for the first Tick().
+  for (auto& thread : threads_) {
+    ThreadData* thread_ptr = thread.get();
+    thread_ptr->thread =
+        std::make_unique<Thread>([thread_ptr]() { ThreadFn(thread_ptr); });
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status ParallelProcRuntime::Tick() {
+  XLS_TRACE_SPAN("ParallelProcRuntime::Tick");
+  absl::MutexLock lock(&mutex_);
+  if (deadlocked_) {
+    return absl::FailedPreconditionError(
+        "Proc network previously deadlocked; it can not be ticked again.");
+  }
+  done_count_ = 0;
+  generation_++;
+  mutex_.Await(absl::Condition(
+      +[](ParallelProcRuntime* runtime) {
+        runtime->mutex_.AssertReaderHeld();
+        return runtime->TickFinished();
+      },
+      this));
+  if (done_count_ != threads_.size()) {
+    deadlocked_ = true;
+    return absl::AbortedError(
+        "Deadlock detected; all unfinished procs are blocked on channels "
+        "within the network.");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ParallelProcRuntime::EnqueueValueToChannel(Channel* channel,
+                                                        const Value& value) {
+  XLS_RET_CHECK_EQ(package_->GetTypeForValue(value), channel->type());
+  Type* type = package_->GetTypeForValue(value);
+
+  XLS_RET_CHECK(!threads_.empty());
+  IrJit* jit = threads_.front()->jit.get();
+  int64_t size = jit->type_converter()->GetTypeByteSize(type);
+  auto buffer = absl::make_unique<uint8_t[]>(size);
+  jit->runtime()->BlitValueToBuffer(value, type,
+                                    absl::MakeSpan(buffer.get(), size));
+
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr()->GetQueueById(channel->id()));
+  queue->Send(buffer.get(), size);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> ParallelProcRuntime::DequeueValueFromChannel(
+    Channel* channel) {
+  Type* type = channel->type();
+
+  XLS_RET_CHECK(!threads_.empty());
+  IrJit* jit = threads_.front()->jit.get();
+  int64_t size = jit->type_converter()->GetTypeByteSize(type);
+  auto buffer = absl::make_unique<uint8_t[]>(size);
+
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr()->GetQueueById(channel->id()));
+  XLS_RET_CHECK(!queue->Empty());
+  queue->Recv(buffer.get(), size);
+
+  return jit->runtime()->UnpackBuffer(buffer.get(), type);
+}
+
+}  // namespace xls
@@ -0,0 +1,140 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef XLS_JIT_PARALLEL_PROC_RUNTIME_H_
+#define XLS_JIT_PARALLEL_PROC_RUNTIME_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "xls/common/thread.h"
+#include "xls/ir/package.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/jit/jit_channel_queue.h"
+
+namespace xls {
+
+// ParallelProcRuntime executes a proc network with every proc running
+// concurrently. As with SerialProcRuntime, each Tick() runs every proc for one
+// activation, but rather than being stepped one at a time, all procs start
+// together and a proc only waits when it tries to receive from an empty
+// channel; it is woken as soon as the producing proc sends. Channel queues are
+// unbounded unless given a capacity, in which case a send on a full queue
+// waits until the consuming proc receives.
+//
+// Because every channel has a single producer and a single consumer and
+// receives are blocking, the values sent on each channel (and thus the results
+// of the network) are independent of the thread interleaving: for a network
+// which doesn't deadlock, the results are identical to those of
+// SerialProcRuntime.
+//
+// Each proc gets its own thread: JIT-compiled code can suspend in the middle
+// of an activation (inside a blocking receive), which requires a stack per
+// proc.
+class ParallelProcRuntime {
+ public:
+  static absl::StatusOr<std::unique_ptr<ParallelProcRuntime>> Create(
+      Package* package);
+  ~ParallelProcRuntime();
+
+  // Execute one cycle of every proc in the network. Returns an error if the
+  // network deadlocks, after which the runtime can not be ticked again.
+  absl::Status Tick();
+
+  Package* package() { return package_; }
+  JitChannelQueueManager* queue_mgr() { return queue_mgr_.get(); }
+
+  // Enqueues the given set of values into the given channel. 'values' must
+  // match the number and type of the data elements of the channel. Must not be
+  // called during Tick().
+  absl::Status EnqueueValueToChannel(Channel* channel, const Value& value);
+
+  // Dequeues a set of values into the given channel. The number and type of the
+  // returned values matches the number and type of the data elements of the
+  // channel. Must not be called during Tick().
+  absl::StatusOr<Value> DequeueValueFromChannel(Channel* channel);
+
+ private:
+  static constexpr int64_t kNotBlocked = -1;
+
+  // Per-proc state.
+  struct ThreadData {
+    ParallelProcRuntime* runtime;
+    std::unique_ptr<Thread> thread;
+    std::unique_ptr<IrJit> jit;
+
+    // The size of and actual buffer used to hold the Proc's carried state.
+    int64_t proc_state_size;
+    std::unique_ptr<uint8_t[]> proc_state;
+
+    // The ID of the channel this proc is waiting to receive from or send to,
+    // or kNotBlocked. Guarded by runtime->mutex_.
+    int64_t blocking_channel = kNotBlocked;
+
+    // True if the channel being waited on is fed from outside the network.
+    // Guarded by runtime->mutex_.
+    bool blocked_on_external = false;
+  };
+
+  explicit ParallelProcRuntime(Package* package) : package_(package) {}
+  absl::Status Init();
+  static void ThreadFn(ThreadData* thread_data);
+
+  // Proc Receive/ReceiveIf handler function.
+  static void RecvFn(JitChannelQueue* queue, Receive* recv, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+
+  // Proc Send/SendIf handler function.
+  static void SendFn(JitChannelQueue* queue, Send* send, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+
+  // Blocks the calling proc until "ready" returns true for "queue". Returns
+  // false if the runtime was cancelled while waiting.
+  static bool WaitOnChannel(ThreadData* thread_data, JitChannelQueue* queue,
+                            bool (*ready)(JitChannelQueue*));
+
+  // Wakes the procs (if any) blocked on the given channel after the calling
+  // proc changed its queue.
+  void WakeBlockedProcs(int64_t channel_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns true when Tick() can return: all procs have finished, or the
+  // network is deadlocked.
+  bool TickFinished() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Package* package_;
+  std::vector<std::unique_ptr<ThreadData>> threads_;
+  std::unique_ptr<JitChannelQueueManager> queue_mgr_;
+
+  absl::Mutex mutex_;
+  // Incremented to start each Tick().
+  int64_t generation_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Number of procs which have finished the current activation.
+  int64_t done_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Number of blocked procs which are waiting on data from outside the
+  // network; such a network is not considered deadlocked.
+  int64_t external_blocked_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool deadlocked_ ABSL_GUARDED_BY(mutex_) = false;
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Number of procs blocked in a receive or send. Only modified with mutex_
+  // held, but atomic so that the other ends of channels can check it without
+  // taking the lock.
+  std::atomic<int64_t> blocked_count_{0};
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_PARALLEL_PROC_RUNTIME_H_
@@ -74,7 +74,7 @@ class ProcBuilderVisitor : public FunctionBuilderVisitor {
   absl::Status HandleSend(Send* send) override;
   absl::Status HandleSendIf(SendIf* send) override;
 
- private:
+ protected:
   ProcBuilderVisitor(llvm::Module* module, llvm::Function* llvm_fn,
                      FunctionBase* xls_fn, LlvmTypeConverter* type_converter,
                      bool is_top, bool generate_packed,
@@ -14,14 +14,296 @@
 
 #include "xls/jit/ir_jit.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "pybind11/numpy.h"
 #include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
 #include "xls/common/python/absl_casters.h"
+#include "xls/common/status/status_macros.h"
 #include "xls/common/status/statusor_pybind_caster.h"
 #include "xls/ir/python/wrapper_types.h"
 
 namespace py = pybind11;
 
 namespace xls {
+namespace {
+
+// Returns whether values of "type" fit in a numpy integer.
+bool IsNumpyIntegerType(Type* type) {
+  return type->IsBits() && type->AsBitsOrDie()->bit_count() <= 64;
+}
+
+// Returns the size in bytes of the smallest unsigned numpy integer type
+// holding "bit_count" bits.
+int64_t NumpyItemSize(int64_t bit_count) {
+  if (bit_count <= 8) {
+    return 1;
+  }
+  if (bit_count <= 16) {
+    return 2;
+  }
+  return bit_count <= 32 ? 4 : 8;
+}
+
+uint64_t LowBitMask(int64_t bit_count) {
+  return bit_count == 64 ? ~uint64_t{0} : (uint64_t{1} << bit_count) - 1;
+}
+
+// Loads the native-endian unsigned integer of "size" bytes (1, 2, 4 or 8) at
+// "p".
+uint64_t LoadUnsigned(const uint8_t* p, int64_t size) {
+  switch (size) {
+    case 1:
+      return *p;
+    case 2: {
+      uint16_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    case 4: {
+      uint32_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    default: {
+      uint64_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+  }
+}
+
+// Stores "value" as a native-endian unsigned integer of "size" bytes (1, 2, 4
+// or 8) at "p".
+void StoreUnsigned(uint64_t value, uint8_t* p, int64_t size) {
+  switch (size) {
+    case 1:
+      *p = static_cast<uint8_t>(value);
+      return;
+    case 2: {
+      uint16_t narrow = static_cast<uint16_t>(value);
+      memcpy(p, &narrow, sizeof(narrow));
+      return;
+    }
+    case 4: {
+      uint32_t narrow = static_cast<uint32_t>(value);
+      memcpy(p, &narrow, sizeof(narrow));
+      return;
+    }
+    default:
+      memcpy(p, &value, sizeof(value));
+      return;
+  }
+}
+
+// Returns a one-dimensional unsigned integer array of "size" elements of
+// "item_size" bytes each.
+py::array MakeUnsignedArray(int64_t item_size, int64_t size) {
+  switch (item_size) {
+    case 1:
+      return py::array_t<uint8_t>(size);
+    case 2:
+      return py::array_t<uint16_t>(size);
+    case 4:
+      return py::array_t<uint32_t>(size);
+    default:
+      return py::array_t<uint64_t>(size);
+  }
+}
+
+// A JIT-compiled function evaluated on whole batches of samples held in numpy
+// arrays (or any other objects supporting the buffer protocol), one array of
+// integers per parameter. This avoids converting every sample to and from
+// Python Value objects: the arguments are packed, the function evaluated and
+// the results unpacked in C++ with the GIL released.
+//
+// All parameters must be bits types of at most 64 bits, and the return type
+// either such a bits type, whose results are returned in one array, or a tuple
+// of them, whose elements are returned in a tuple of arrays. Each result array
+// has the smallest unsigned integer dtype holding its element.
+class BatchJit {
+ public:
+  static absl::StatusOr<std::unique_ptr<BatchJit>> Create(FunctionHolder f) {
+    Function* function = &f.deref();
+    for (Param* param : function->params()) {
+      if (!IsNumpyIntegerType(param->GetType())) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Parameter %s has type %s; batched evaluation only supports bits "
+            "types of at most 64 bits",
+            param->GetName(), param->GetType()->ToString()));
+      }
+    }
+    Type* return_type = function->return_value()->GetType();
+    bool return_type_ok = IsNumpyIntegerType(return_type);
+    if (return_type->IsTuple()) {
+      return_type_ok = true;
+      for (Type* element_type : return_type->AsTupleOrDie()->element_types()) {
+        return_type_ok &= IsNumpyIntegerType(element_type);
+      }
+    }
+    if (!return_type_ok) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Return type %s is not supported by batched evaluation; expected a "
+          "bits type of at most 64 bits or a tuple of them",
+          return_type->ToString()));
+    }
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit, IrJit::Create(function));
+    return absl::WrapUnique(
+        new BatchJit(f.package(), function, std::move(jit)));
+  }
+
+  // Evaluates the function once per element of the one-dimensional integer
+  // buffers "args", which must all have the same length. Argument values are
+  // truncated to the width of their parameter, so signed arrays are read as
+  // two's complement.
+  absl::StatusOr<py::object> Run(const std::vector<py::buffer>& args) {
+    absl::Span<Param* const> params = function_->params();
+    if (args.size() != params.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Got %d argument arrays but the function has %d "
+                          "parameters",
+                          args.size(), params.size()));
+    }
+    if (params.empty()) {
+      return absl::InvalidArgumentError(
+          "Batched evaluation requires a function with parameters");
+    }
+    std::vector<py::buffer_info> infos;
+    infos.reserve(args.size());
+    for (int64_t i = 0; i < args.size(); ++i) {
+      infos.push_back(args[i].request());
+      const py::buffer_info& info = infos.back();
+      bool integer_format =
+          !info.format.empty() &&
+          absl::string_view("?bBhHiIlLqQ").find(info.format.back()) !=
+              absl::string_view::npos;
+      if (info.ndim != 1 || !integer_format ||
+          (info.itemsize != 1 && info.itemsize != 2 && info.itemsize != 4 &&
+           info.itemsize != 8)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Argument %d must be a one-dimensional array of integers", i));
+      }
+      if (info.shape[0] != infos.front().shape[0]) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Argument %d has %d elements but argument 0 has %d", i,
+            info.shape[0], infos.front().shape[0]));
+      }
+    }
+    int64_t batch_size = infos.front().shape[0];
+
+    Type* return_type = function_->return_value()->GetType();
+    std::vector<Type*> output_types;
+    if (return_type->IsTuple()) {
+      output_types = return_type->AsTupleOrDie()->element_types();
+    } else {
+      output_types.push_back(return_type);
+    }
+    std::vector<py::array> outputs;
+    std::vector<uint8_t*> output_data;
+    for (Type* type : output_types) {
+      outputs.push_back(MakeUnsignedArray(
+          NumpyItemSize(type->GetFlatBitCount()), batch_size));
+      output_data.push_back(
+          static_cast<uint8_t*>(outputs.back().mutable_data()));
+    }
+
+    absl::Status status;
+    {
+      py::gil_scoped_release release;
+      status = RunWithoutGil(infos, batch_size, output_types, output_data);
+    }
+    XLS_RETURN_IF_ERROR(status);
+    if (!return_type->IsTuple()) {
+      return py::object(outputs.front());
+    }
+    py::tuple result(outputs.size());
+    for (int64_t i = 0; i < outputs.size(); ++i) {
+      result[i] = outputs[i];
+    }
+    return py::object(result);
+  }
+
+ private:
+  BatchJit(std::shared_ptr<Package> package, Function* function,
+           std::unique_ptr<IrJit> jit)
+      : package_(std::move(package)),
+        function_(function),
+        jit_(std::move(jit)) {}
+
+  // Packs the arguments into the JIT's batch buffers, evaluates the batch and
+  // writes each result element to the corresponding array of "output_data".
+  absl::Status RunWithoutGil(const std::vector<py::buffer_info>& infos,
+                             int64_t batch_size,
+                             absl::Span<Type* const> output_types,
+                             absl::Span<uint8_t* const> output_data) {
+    absl::Span<Param* const> params = function_->params();
+    std::vector<std::vector<uint8_t>> arg_batches(params.size());
+    std::vector<uint8_t*> arg_buffers(params.size());
+    for (int64_t i = 0; i < params.size(); ++i) {
+      // Bits types of at most 64 bits are held in 1, 2, 4 or 8 bytes.
+      int64_t arg_bytes = jit_->GetArgTypeSize(i);
+      uint64_t mask = LowBitMask(params[i]->GetType()->GetFlatBitCount());
+      arg_batches[i].resize(std::max<int64_t>(arg_bytes * batch_size, 1));
+      arg_buffers[i] = arg_batches[i].data();
+      const py::buffer_info& info = infos[i];
+      const uint8_t* data = static_cast<const uint8_t*>(info.ptr);
+      for (int64_t sample = 0; sample < batch_size; ++sample) {
+        uint64_t value =
+            LoadUnsigned(data + sample * info.strides[0], info.itemsize);
+        StoreUnsigned(value & mask, arg_buffers[i] + sample * arg_bytes,
+                      arg_bytes);
+      }
+    }
+
+    int64_t result_bytes = jit_->GetReturnTypeSize();
+    std::vector<uint8_t> results(
+        std::max<int64_t>(result_bytes * batch_size, 1));
+    XLS_RETURN_IF_ERROR(
+        jit_->RunBatch(arg_buffers, absl::MakeSpan(results), batch_size));
+
+    Type* return_type = function_->return_value()->GetType();
+    std::vector<int64_t> item_sizes;
+    for (Type* type : output_types) {
+      item_sizes.push_back(NumpyItemSize(type->GetFlatBitCount()));
+    }
+    for (int64_t sample = 0; sample < batch_size; ++sample) {
+      const uint8_t* result = results.data() + sample * result_bytes;
+      if (!return_type->IsTuple()) {
+        uint64_t value = LoadUnsigned(result, result_bytes);
+        StoreUnsigned(value & LowBitMask(return_type->GetFlatBitCount()),
+                      output_data[0] + sample * item_sizes[0], item_sizes[0]);
+        continue;
+      }
+      // Tuple layouts are the JIT's, so go through its unpacking.
+      Value tuple = jit_->runtime()->UnpackBuffer(result, return_type);
+      for (int64_t i = 0; i < output_types.size(); ++i) {
+        XLS_ASSIGN_OR_RETURN(uint64_t value,
+                             tuple.element(i).bits().ToUint64());
+        StoreUnsigned(value, output_data[i] + sample * item_sizes[i],
+                      item_sizes[i]);
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Keeps the function alive.
+  std::shared_ptr<Package> package_;
+  Function* function_;
+  std::unique_ptr<IrJit> jit_;
+};
+
+}  // namespace
 
 PYBIND11_MODULE(ir_jit, m) {
   ImportStatusModule();
@@ -32,6 +314,18 @@ PYBIND11_MODULE(ir_jit, m) {
   m.def("ir_jit_run", PyWrap(&CreateAndRun), py::arg("f"), py::arg("args"));
   m.def("quickcheck_jit", PyWrap(&CreateAndQuickCheck), py::arg("f"),
         py::arg("seed"), py::arg("num_tests"));
+
+  py::class_<BatchJit>(m, "BatchJit")
+      .def(py::init([](FunctionHolder f) {
+             absl::StatusOr<std::unique_ptr<BatchJit>> jit =
+                 BatchJit::Create(f);
+             if (!jit.ok()) {
+               throw StatusNotOk(jit.status());
+             }
+             return std::move(jit).value();
+           }),
+           py::arg("f"))
+      .def("run", &BatchJit::Run, py::arg("args"));
 }
 
 }  // namespace xls
@@ -0,0 +1,90 @@
+# Copyright 2021 The XLS Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Lint as: python3
+
+"""Tests for xls.jit.python.ir_jit."""
+
+import numpy as np
+
+from xls.ir.python import ir_parser
+from xls.jit.python import ir_jit
+from absl.testing import absltest
+
+IR = """package p
+
+fn add(x: bits[17], y: bits[8]) -> bits[17] {
+  zero_ext.1: bits[17] = zero_ext(y, new_bit_count=17)
+  ret add.2: bits[17] = add(x, zero_ext.1)
+}
+
+fn sum_and_diff(x: bits[32], y: bits[32]) -> (bits[32], bits[32], bits[1]) {
+  add.3: bits[32] = add(x, y)
+  sub.4: bits[32] = sub(x, y)
+  ult.5: bits[1] = ult(x, y)
+  ret tuple.6: (bits[32], bits[32], bits[1]) = tuple(add.3, sub.4, ult.5)
+}
+
+fn wide(x: bits[128]) -> bits[128] {
+  ret identity.7: bits[128] = identity(x)
+}
+"""
+
+
+class IrJitTest(absltest.TestCase):
+
+  def setUp(self):
+    super().setUp()
+    self.package = ir_parser.Parser.parse_package(IR)
+
+  def test_run_batch(self):
+    jit = ir_jit.BatchJit(self.package.get_function('add'))
+    x = np.array([0, 1, 0x1ffff, 0x10000], dtype=np.uint32)
+    y = np.array([0, 2, 1, -1], dtype=np.int8)
+    result = jit.run([x, y])
+    self.assertEqual(result.dtype, np.uint32)
+    np.testing.assert_array_equal(result, [0, 3, 0, 0x100ff])
+
+  def test_run_batch_tuple_result(self):
+    jit = ir_jit.BatchJit(self.package.get_function('sum_and_diff'))
+    x = np.arange(1000, dtype=np.uint64)
+    y = np.full(1000, 500, dtype=np.uint32)
+    sums, diffs, less = jit.run([x, y])
+    np.testing.assert_array_equal(sums, x + 500)
+    np.testing.assert_array_equal(diffs, (x - 500) & 0xffffffff)
+    self.assertEqual(less.dtype, np.uint8)
+    np.testing.assert_array_equal(less, x < 500)
+
+  def test_run_batch_strided(self):
+    jit = ir_jit.BatchJit(self.package.get_function('add'))
+    x = np.arange(10, dtype=np.uint32)[::2]
+    y = np.ones(5, dtype=np.uint8)
+    np.testing.assert_array_equal(jit.run([x, y]), [1, 3, 5, 7, 9])
+
+  def test_bad_arguments(self):
+    jit = ir_jit.BatchJit(self.package.get_function('add'))
+    with self.assertRaisesRegex(RuntimeError, 'same length|elements'):
+      jit.run([np.zeros(3, np.uint32), np.zeros(2, np.uint8)])
+    with self.assertRaisesRegex(RuntimeError, 'parameters'):
+      jit.run([np.zeros(3, np.uint32)])
+    with self.assertRaisesRegex(RuntimeError, 'integers'):
+      jit.run([np.zeros(3, np.float32), np.zeros(3, np.uint8)])
+
+  def test_unsupported_type(self):
+    with self.assertRaisesRegex(RuntimeError, 'at most 64 bits'):
+      ir_jit.BatchJit(self.package.get_function('wide'))
+
+
+if __name__ == '__main__':
+  absltest.main()
@@ -13,10 +13,19 @@
 // limitations under the License.
 #include "xls/jit/serial_proc_runtime.h"
 
+#include <algorithm>
+#include <cstring>
+#include <string>
+
 #include "absl/status/status.h"
+#include "absl/strings/str_format.h"
 #include "xls/common/cleanup.h"
+#include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
+#include "xls/interpreter/proc_network_checkpoint.h"
 #include "xls/ir/proc.h"
+#include "xls/ir/value_helpers.h"
 #include "xls/jit/function_builder_visitor.h"
 #include "xls/jit/jit_channel_queue.h"
 #include "xls/jit/proc_builder_visitor.h"
@@ -44,20 +53,31 @@ void SerialProcRuntime::AwaitState(
 void SerialProcRuntime::ThreadFn(ThreadData* thread_data) {
   absl::flat_hash_set<ThreadData::State> await_states(
       {ThreadData::State::kRunning, ThreadData::State::kCancelled});
+  int64_t tick_count;
   {
     absl::MutexLock lock(&thread_data->mutex);
     AwaitState(thread_data, await_states);
+    tick_count = thread_data->tick_count;
   }
 
   while (true) {
-    // RunWithViews takes an array of arg view pointers - even if they're unused
-    // during execution, tokens still occupy one of those spots.
-    std::vector<uint8_t*> args({nullptr, thread_data->proc_state.get()});
-    XLS_CHECK_OK(thread_data->jit->RunWithViews(
-        absl::MakeSpan(args),
-        absl::MakeSpan(thread_data->proc_state.get(),
-                       thread_data->proc_state_size),
-        thread_data));
+    absl::Span<uint8_t> state(thread_data->proc_state.get(),
+                              thread_data->proc_state_size);
+    if (tick_count == 1) {
+      // RunWithViews takes an array of arg view pointers - even if they're
+      // unused during execution, tokens still occupy one of those spots.
+      std::vector<uint8_t*> args({nullptr, thread_data->proc_state.get()});
+      if (thread_data->pack_state) {
+        XLS_CHECK_OK(
+            thread_data->jit->RunWithPackedBuffers(args, state, thread_data));
+      } else {
+        XLS_CHECK_OK(thread_data->jit->RunWithViews(absl::MakeSpan(args),
+                                                    state, thread_data));
+      }
+    } else {
+      XLS_CHECK_OK(thread_data->jit->RunTicks(
+          state, tick_count, thread_data->pack_state, thread_data));
+    }
 
     absl::MutexLock lock(&thread_data->mutex);
     if (thread_data->thread_state == ThreadData::State::kCancelled) {
@@ -68,12 +88,13 @@ void SerialProcRuntime::ThreadFn(ThreadData* thread_data) {
     if (thread_data->thread_state == ThreadData::State::kCancelled) {
       break;
     }
+    tick_count = thread_data->tick_count;
   }
 }
 
 // To implement Proc blocking receive semantics, RecvFn blocks if its associated
-// queue is empty. The main thread unblocks it periodically (by changing its
-// ThreadData::State) to try to receive again.
+// queue is empty (and SendFn if its queue is full). The main thread unblocks it
+// periodically (by changing its ThreadData::State) to try to receive again.
 void SerialProcRuntime::RecvFn(JitChannelQueue* queue, Receive* recv,
                                uint8_t* data, int64_t data_bytes,
                                void* user_data) {
@@ -86,10 +107,12 @@ void SerialProcRuntime::RecvFn(JitChannelQueue* queue, Receive* recv,
     if (thread_data->thread_state == ThreadData::State::kCancelled) {
       return;
     }
+    queue->RecordRecvStall();
     thread_data->thread_state = ThreadData::State::kBlocked;
     thread_data->blocking_channel = queue->channel_id();
     AwaitState(thread_data, await_states);
   }
+  thread_data->received_data = true;
   queue->Recv(data, data_bytes);
 }
 
@@ -97,19 +120,35 @@ void SerialProcRuntime::SendFn(JitChannelQueue* queue, Send* send,
                                uint8_t* data, int64_t data_bytes,
                                void* user_data) {
   ThreadData* thread_data = reinterpret_cast<ThreadData*>(user_data);
+  absl::flat_hash_set<ThreadData::State> await_states(
+      {ThreadData::State::kRunning, ThreadData::State::kCancelled});
+
+  // As with receives, a send on a full queue blocks until the main thread
+  // resumes the proc, by which time the receiver may have made room.
   absl::MutexLock lock(&thread_data->mutex);
+  while (queue->Full()) {
+    if (thread_data->thread_state == ThreadData::State::kCancelled) {
+      return;
+    }
+    queue->RecordSendStall();
+    thread_data->thread_state = ThreadData::State::kBlocked;
+    thread_data->blocking_channel = queue->channel_id();
+    AwaitState(thread_data, await_states);
+  }
   thread_data->sent_data = true;
   queue->Send(data, data_bytes);
 }
 
 absl::StatusOr<std::unique_ptr<SerialProcRuntime>> SerialProcRuntime::Create(
-    Package* package) {
-  auto runtime = absl::WrapUnique(new SerialProcRuntime(std::move(package)));
+    Package* package, bool pack_state) {
+  auto runtime = absl::WrapUnique(
+      new SerialProcRuntime(std::move(package), pack_state));
   XLS_RETURN_IF_ERROR(runtime->Init());
   return runtime;
 }
 
-SerialProcRuntime::SerialProcRuntime(Package* package) : package_(package) {}
+SerialProcRuntime::SerialProcRuntime(Package* package, bool pack_state)
+    : package_(package), pack_state_(pack_state) {}
 
 SerialProcRuntime::~SerialProcRuntime() {
   for (auto& thread_data : threads_) {
@@ -132,15 +171,31 @@ absl::Status SerialProcRuntime::Init() {
                                                         &RecvFn, &SendFn));
     auto* jit = thread->jit.get();
 
-    thread->proc_state_size = jit->GetReturnTypeSize();
+    Type* state_type =
+        FunctionBuilderVisitor::GetEffectiveReturnValue(proc)->GetType();
+    thread->pack_state = pack_state_;
+    if (pack_state_) {
+      XLS_RET_CHECK(ValueConformsToType(proc->InitValue(), state_type))
+          << "Initial value of proc " << proc->name()
+          << " does not match its state type";
+      thread->proc_state_size = jit->GetPackedReturnTypeSize();
+    } else {
+      thread->proc_state_size = jit->GetReturnTypeSize();
+    }
     thread->proc_state = std::make_unique<uint8_t[]>(thread->proc_state_size);
-    jit->runtime()->BlitValueToBuffer(
-        proc->InitValue(),
-        FunctionBuilderVisitor::GetEffectiveReturnValue(proc)->GetType(),
-        absl::MakeSpan(thread->proc_state.get(), jit->GetReturnTypeSize()));
+    absl::Span<uint8_t> state(thread->proc_state.get(),
+                              thread->proc_state_size);
+    if (pack_state_) {
+      jit->runtime()->BlitValueToPackedBuffer(proc->InitValue(), state_type,
+                                              state);
+    } else {
+      jit->runtime()->BlitValueToBuffer(proc->InitValue(), state_type, state);
+    }
 
     absl::MutexLock lock(&thread->mutex);
     thread->sent_data = false;
+    thread->received_data = false;
+    thread->tick_count = 1;
     thread->thread_state = ThreadData::State::kPending;
     threads_.push_back(std::move(thread));
 
@@ -167,13 +222,36 @@ absl::Status SerialProcRuntime::Init() {
 }
 
 absl::Status SerialProcRuntime::Tick() {
+  XLS_TRACE_SPAN("SerialProcRuntime::Tick");
+  XLS_RETURN_IF_ERROR(RunTicksInternal(1));
+  return AdvanceTickCount(1);
+}
+
+absl::Status SerialProcRuntime::RunTicksInternal(int64_t tick_count) {
+  auto set_tick_count = [this](int64_t count) {
+    for (auto& thread : threads_) {
+      absl::MutexLock lock(&thread->mutex);
+      thread->tick_count = count;
+    }
+  };
+  if (tick_count != 1) {
+    set_tick_count(tick_count);
+  }
+  auto reset_tick_count = xabsl::MakeCleanup([&]() {
+    if (tick_count != 1) {
+      set_tick_count(1);
+    }
+  });
+
   absl::flat_hash_set<ThreadData::State> await_states(
       {ThreadData::State::kBlocked, ThreadData::State::kDone});
   bool done = false;
   while (!done) {
     done = true;
-    // True if any proc sent data during this pass/activation/partial cycle.
-    bool data_sent = false;
+    // True if any proc sent or received data during this
+    // pass/activation/partial cycle. (A receive may unblock a sender on a full
+    // queue.)
+    bool data_moved = false;
     // True if the proc network is blocked waiting on data from "outside".
     bool blocked_by_external = false;
     for (auto& thread : threads_) {
@@ -185,6 +263,7 @@ absl::Status SerialProcRuntime::Tick() {
       // Each blocked thread is stuck on a Condition waiting to be set to
       // kRunning before starting/resuming (so we can ensure serial operation).
       thread->sent_data = false;
+      thread->received_data = false;
       thread->thread_state = ThreadData::State::kRunning;
       AwaitState(thread.get(), await_states);
       if (thread->thread_state != ThreadData::State::kDone) {
@@ -199,11 +278,12 @@ absl::Status SerialProcRuntime::Tick() {
         }
       }
 
-      data_sent |= thread->sent_data;
+      data_moved |= thread->sent_data || thread->received_data;
       thread->sent_data = false;
+      thread->received_data = false;
     }
 
-    if (!done && !data_sent && !blocked_by_external) {
+    if (!done && !data_moved && !blocked_by_external) {
       return absl::AbortedError(
           "Deadlock detected; some procs were blocked with no data sent.");
     }
@@ -213,12 +293,173 @@ absl::Status SerialProcRuntime::Tick() {
     // Reset state for the next Tick().
     absl::MutexLock lock(&thread->mutex);
     thread->sent_data = false;
+    thread->received_data = false;
     thread->thread_state = ThreadData::State::kPending;
   }
 
   return absl::OkStatus();
 }
 
+absl::Status SerialProcRuntime::RunTicks(int64_t tick_count) {
+  XLS_TRACE_SPAN("SerialProcRuntime::RunTicks");
+  XLS_RET_CHECK_GE(tick_count, 0);
+  while (tick_count > 0) {
+    int64_t chunk = tick_count;
+    if (checkpoint_interval_ != 0) {
+      chunk = std::min(chunk, next_checkpoint_tick_ - tick_count_);
+    }
+    XLS_RETURN_IF_ERROR(RunTicksInternal(chunk));
+    XLS_RETURN_IF_ERROR(AdvanceTickCount(chunk));
+    tick_count -= chunk;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SerialProcRuntime::AdvanceTickCount(int64_t tick_count) {
+  tick_count_ += tick_count;
+  if (checkpoint_interval_ == 0 || tick_count_ < next_checkpoint_tick_) {
+    return absl::OkStatus();
+  }
+  XLS_ASSIGN_OR_RETURN(ProcNetworkCheckpointProto checkpoint, Checkpoint());
+  XLS_RETURN_IF_ERROR(WriteProcNetworkCheckpoint(checkpoint, checkpoint_path_));
+  ScheduleNextCheckpoint();
+  return absl::OkStatus();
+}
+
+void SerialProcRuntime::ScheduleNextCheckpoint() {
+  next_checkpoint_tick_ =
+      (tick_count_ / checkpoint_interval_ + 1) * checkpoint_interval_;
+}
+
+absl::StatusOr<int64_t> SerialProcRuntime::GetElementSize(Channel* channel) {
+  XLS_RET_CHECK(!threads_.empty());
+  return threads_.front()->jit->type_converter()->GetTypeByteSize(
+      channel->type());
+}
+
+absl::StatusOr<ProcNetworkCheckpointProto> SerialProcRuntime::Checkpoint() {
+  ProcNetworkCheckpointProto checkpoint;
+  checkpoint.set_package(package_->name());
+  checkpoint.set_tick(tick_count_);
+  checkpoint.set_state_layout(pack_state_
+                                  ? ProcNetworkCheckpointProto::JIT_PACKED
+                                  : ProcNetworkCheckpointProto::JIT_NATIVE);
+  for (int64_t i = 0; i < threads_.size(); ++i) {
+    ProcStateCheckpointProto* proc = checkpoint.add_procs();
+    proc->set_proc(package_->procs()[i]->name());
+    proc->set_buffer(
+        std::string(reinterpret_cast<char*>(threads_[i]->proc_state.get()),
+                    threads_[i]->proc_state_size));
+  }
+
+  // The queues can't be inspected in place, so each is drained and refilled.
+  // The procs are all idle between ticks.
+  for (Channel* channel : package_->channels()) {
+    XLS_ASSIGN_OR_RETURN(int64_t size, GetElementSize(channel));
+    XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                         queue_mgr_->GetQueueById(channel->id()));
+    ChannelCheckpointProto* channel_proto = checkpoint.add_channels();
+    channel_proto->set_channel_id(channel->id());
+    std::string* data = channel_proto->mutable_buffer_data();
+    int64_t count = 0;
+    while (!queue->Empty()) {
+      data->resize((count + 1) * size);
+      queue->Recv(reinterpret_cast<uint8_t*>(&(*data)[count * size]), size);
+      ++count;
+    }
+    for (int64_t i = 0; i < count; ++i) {
+      queue->Send(reinterpret_cast<uint8_t*>(&(*data)[i * size]), size);
+    }
+    channel_proto->set_buffer_count(count);
+  }
+  return checkpoint;
+}
+
+absl::Status SerialProcRuntime::Restore(
+    const ProcNetworkCheckpointProto& checkpoint) {
+  if (checkpoint.package() != package_->name()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Checkpoint is of package %s, expected %s", checkpoint.package(),
+        package_->name()));
+  }
+  ProcNetworkCheckpointProto::Layout layout =
+      pack_state_ ? ProcNetworkCheckpointProto::JIT_PACKED
+                  : ProcNetworkCheckpointProto::JIT_NATIVE;
+  if (checkpoint.state_layout() != layout) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Checkpoint has state layout %s, expected %s",
+        ProcNetworkCheckpointProto::Layout_Name(checkpoint.state_layout()),
+        ProcNetworkCheckpointProto::Layout_Name(layout)));
+  }
+  XLS_RET_CHECK_EQ(checkpoint.procs_size(), threads_.size())
+      << "Checkpoint has the wrong number of procs";
+  for (const ProcStateCheckpointProto& proc : checkpoint.procs()) {
+    auto it = std::find_if(package_->procs().begin(), package_->procs().end(),
+                           [&](const std::unique_ptr<Proc>& p) {
+                             return p->name() == proc.proc();
+                           });
+    if (it == package_->procs().end()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Checkpoint has unknown proc %s", proc.proc()));
+    }
+    ThreadData* thread =
+        threads_[std::distance(package_->procs().begin(), it)].get();
+    if (proc.buffer().size() != thread->proc_state_size) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "State of proc %s has %d bytes, expected %d", proc.proc(),
+          proc.buffer().size(), thread->proc_state_size));
+    }
+    memcpy(thread->proc_state.get(), proc.buffer().data(),
+           thread->proc_state_size);
+  }
+
+  for (Channel* channel : package_->channels()) {
+    XLS_ASSIGN_OR_RETURN(int64_t size, GetElementSize(channel));
+    XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                         queue_mgr_->GetQueueById(channel->id()));
+    std::vector<uint8_t> element(size);
+    while (!queue->Empty()) {
+      queue->Recv(element.data(), size);
+    }
+  }
+  for (const ChannelCheckpointProto& channel_proto : checkpoint.channels()) {
+    XLS_ASSIGN_OR_RETURN(Channel * channel,
+                         package_->GetChannel(channel_proto.channel_id()));
+    XLS_ASSIGN_OR_RETURN(int64_t size, GetElementSize(channel));
+    if (channel_proto.buffer_count() < 0 ||
+        channel_proto.buffer_data().size() !=
+            channel_proto.buffer_count() * size) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Contents of channel %s have %d bytes, expected %d elements of %d "
+          "bytes",
+          channel->name(), channel_proto.buffer_data().size(),
+          channel_proto.buffer_count(), size));
+    }
+    XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                         queue_mgr_->GetQueueById(channel->id()));
+    std::vector<uint8_t> element(size);
+    for (int64_t i = 0; i < channel_proto.buffer_count(); ++i) {
+      memcpy(element.data(), channel_proto.buffer_data().data() + i * size,
+             size);
+      queue->Send(element.data(), size);
+    }
+  }
+  tick_count_ = checkpoint.tick();
+  if (checkpoint_interval_ != 0) {
+    ScheduleNextCheckpoint();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SerialProcRuntime::EnableAutomaticCheckpoints(
+    std::filesystem::path path, int64_t interval_ticks) {
+  XLS_RET_CHECK_GT(interval_ticks, 0);
+  checkpoint_path_ = std::move(path);
+  checkpoint_interval_ = interval_ticks;
+  ScheduleNextCheckpoint();
+  return absl::OkStatus();
+}
+
 absl::Status SerialProcRuntime::EnqueueValueToChannel(Channel* channel,
                                                       const Value& value) {
   XLS_RET_CHECK_EQ(package_->GetTypeForValue(value), channel->type());
@@ -14,11 +14,13 @@
 #ifndef XLS_JIT_SERIAL_PROC_RUNTIME_H_
 #define XLS_JIT_SERIAL_PROC_RUNTIME_H_
 
+#include <filesystem>
 #include <memory>
 #include <vector>
 
 #include "absl/status/statusor.h"
 #include "xls/common/thread.h"
+#include "xls/interpreter/proc_network_checkpoint.pb.h"
 #include "xls/ir/package.h"
 #include "xls/jit/ir_jit.h"
 #include "xls/jit/jit_channel_queue.h"
@@ -38,13 +40,48 @@ namespace xls {
 // when a deadlock is detected.
 class SerialProcRuntime {
  public:
+  // If "pack_state" is true, each proc's carried state is held between ticks
+  // in the JIT's densely packed layout (see IrJit::RunWithPackedBuffers())
+  // rather than its native one, which shrinks state with arrays of narrow
+  // elements or many tuple elements several-fold, at the cost of converting
+  // the state on entry to and exit from each activation.
   static absl::StatusOr<std::unique_ptr<SerialProcRuntime>> Create(
-      Package* package);
+      Package* package, bool pack_state = false);
   ~SerialProcRuntime();
 
   // Execute one cycle of every proc in the network.
   absl::Status Tick();
 
+  // Executes "tick_count" cycles of every proc in the network, with the same
+  // results as that many calls to Tick(). Each proc runs all of its
+  // iterations in a single call into compiled code (see IrJit::RunTicks()),
+  // yielding to the others only when it blocks on a channel, so the per-tick
+  // thread handoffs and state writebacks are avoided.
+  absl::Status RunTicks(int64_t tick_count);
+
+  // Returns the number of ticks run, counting from the tick of a restored
+  // checkpoint.
+  int64_t tick_count() const { return tick_count_; }
+
+  // Returns a checkpoint of the state of every proc and the contents of every
+  // channel queue, including those of receive-only channels. State is stored
+  // as the raw buffers the JIT operates on (in the JIT_PACKED layout if
+  // "pack_state" was given, else JIT_NATIVE) and channel elements in the
+  // JIT's native layout, so checkpoints can only be restored on the same kind
+  // of host.
+  absl::StatusOr<ProcNetworkCheckpointProto> Checkpoint();
+
+  // Restores a checkpoint taken by Checkpoint() from a runtime for the same
+  // package with the same "pack_state". Queues of channels absent from the
+  // checkpoint are emptied.
+  absl::Status Restore(const ProcNetworkCheckpointProto& checkpoint);
+
+  // Writes a checkpoint to "path" after every "interval_ticks" ticks,
+  // replacing the previous one. RunTicks() stops at each checkpoint along the
+  // way.
+  absl::Status EnableAutomaticCheckpoints(std::filesystem::path path,
+                                          int64_t interval_ticks);
+
   Package* package() { return package_; }
   JitChannelQueueManager* queue_mgr() { return queue_mgr_.get(); }
 
@@ -70,9 +107,14 @@ class SerialProcRuntime {
     std::unique_ptr<Thread> thread;
     std::unique_ptr<IrJit> jit;
 
-    // The size of and actual buffer used to hold the Proc's carried state.
+    // The size of and actual buffer used to hold the Proc's carried state,
+    // packed if "pack_state".
     int64_t proc_state_size;
     std::unique_ptr<uint8_t[]> proc_state;
+    bool pack_state;
+
+    // The number of iterations the proc runs per activation.
+    int64_t tick_count ABSL_GUARDED_BY(mutex);
 
     absl::Mutex mutex;
     State thread_state ABSL_GUARDED_BY(mutex);
@@ -81,13 +123,32 @@ class SerialProcRuntime {
     // network deadlock.
     bool sent_data ABSL_GUARDED_BY(mutex);
 
+    // True if the proc received data during its last activation, which may
+    // have made room for a sender blocked on a full queue.
+    bool received_data ABSL_GUARDED_BY(mutex);
+
     // True if this proc is blocked on data coming from "outside" the network,
     // i.e., a receive_only channel. Stops network deadlock false positives.
     int64_t blocking_channel ABSL_GUARDED_BY(mutex);
   };
 
-  SerialProcRuntime(Package* package);
+  SerialProcRuntime(Package* package, bool pack_state);
   absl::Status Init();
+
+  // Runs "tick_count" ticks where each proc runs that many iterations per
+  // activation.
+  absl::Status RunTicksInternal(int64_t tick_count);
+
+  // Counts "tick_count" completed ticks and writes an automatic checkpoint if
+  // one is due.
+  absl::Status AdvanceTickCount(int64_t tick_count);
+
+  // Sets the next automatic checkpoint to be taken at the next multiple of the
+  // interval after the current tick.
+  void ScheduleNextCheckpoint();
+
+  // Returns the size of the native layout of an element of "channel".
+  absl::StatusOr<int64_t> GetElementSize(Channel* channel);
   static void ThreadFn(ThreadData* thread_data);
 
   // Proc Receive/ReceiveIf handler function.
@@ -103,8 +164,16 @@ class SerialProcRuntime {
                          const absl::flat_hash_set<ThreadData::State>& states);
 
   Package* package_;
+  bool pack_state_;
   std::vector<std::unique_ptr<ThreadData>> threads_;
   std::unique_ptr<JitChannelQueueManager> queue_mgr_;
+  int64_t tick_count_ = 0;
+
+  // Where and how often automatic checkpoints are written, if enabled, and
+  // the tick count at which the next one is due.
+  std::filesystem::path checkpoint_path_;
+  int64_t checkpoint_interval_ = 0;
+  int64_t next_checkpoint_tick_ = 0;
 };
 
 }  // namespace xls
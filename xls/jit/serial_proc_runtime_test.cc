@@ -13,11 +13,15 @@
 // limitations under the License.
 #include "xls/jit/serial_proc_runtime.h"
 
+#include <filesystem>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "xls/common/file/temp_directory.h"
 #include "xls/common/status/matchers.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/thread.h"
+#include "xls/interpreter/proc_network_checkpoint.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
 #include "xls/jit/jit_channel_queue.h"
@@ -26,6 +30,8 @@ namespace xls {
 namespace {
 
 using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
 
 template <typename T>
 void EnqueueData(JitChannelQueue* queue, T data) {
@@ -391,8 +397,238 @@ proc a(my_token: token, state: (), init=()) {
             "bits[217]:0x1111_2222_3333_4444_abcd_4321_4444_2468_357b)");
 }
 
+// This test verifies that running many ticks at once gives the same results as
+// running them one at a time, including across procs which block on each
+// other.
+TEST(SerialProcRuntimeTest, RunTicks) {
+  const std::string kIrText = R"(
+package p
+
+chan a_in(bits[32], id=0, kind=streaming, ops=receive_only, metadata="")
+chan a_to_b(bits[32], id=1, kind=streaming, ops=send_receive, metadata="")
+chan b_out(bits[32], id=2, kind=streaming, ops=send_only, metadata="")
+
+proc a(my_token: token, state: (bits[32]), init=(1)) {
+  counter: bits[32] = tuple_index(state, index=0)
+  rcv: (token, bits[32]) = receive(my_token, channel_id=0)
+  rcv_token: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  product: bits[32] = umul(counter, data)
+  snd: token = send(rcv_token, product, channel_id=1)
+  one: bits[32] = literal(value=1)
+  next_counter: bits[32] = add(counter, one)
+  next_state: (bits[32]) = tuple(next_counter)
+  next (snd, next_state)
+}
+
+proc b(my_token: token, state: bits[32], init=0) {
+  rcv: (token, bits[32]) = receive(my_token, channel_id=1)
+  rcv_token: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  sum: bits[32] = add(state, data)
+  snd: token = send(rcv_token, sum, channel_id=2)
+  next (snd, sum)
+}
+)";
+  constexpr int64_t kTickCount = 1000;
+  for (bool pack_state : {false, true}) {
+    XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+    XLS_ASSERT_OK_AND_ASSIGN(auto runtime,
+                             SerialProcRuntime::Create(p.get(), pack_state));
+    XLS_ASSERT_OK_AND_ASSIGN(auto input_queue,
+                             runtime->queue_mgr()->GetQueueById(0));
+    XLS_ASSERT_OK_AND_ASSIGN(auto output_queue,
+                             runtime->queue_mgr()->GetQueueById(2));
+    for (int i = 0; i < kTickCount; i++) {
+      EnqueueData(input_queue, i);
+    }
+    XLS_ASSERT_OK(runtime->RunTicks(kTickCount / 2));
+    XLS_ASSERT_OK(runtime->Tick());
+    XLS_ASSERT_OK(runtime->RunTicks(0));
+    XLS_ASSERT_OK(runtime->RunTicks(kTickCount / 2 - 1));
+
+    // Each output is the running sum of i * (i + 1).
+    int sum = 0;
+    for (int i = 0; i < kTickCount; i++) {
+      sum += i * (i + 1);
+      ASSERT_EQ(DequeueData<int>(output_queue), sum)
+          << "pack_state: " << pack_state << ", tick: " << i;
+    }
+    EXPECT_TRUE(output_queue->Empty());
+  }
+}
+
+// This test verifies that a network restored from a checkpoint, including
+// automatic ones taken partway through RunTicks(), resumes where it left off.
+TEST(SerialProcRuntimeTest, CheckpointAndRestore) {
+  const std::string kIrText = R"(
+package p
+
+chan a_in(bits[32], id=0, kind=streaming, ops=receive_only, metadata="")
+chan a_to_b(bits[32], id=1, kind=streaming, ops=send_receive, metadata="")
+chan b_out(bits[32], id=2, kind=streaming, ops=send_only, metadata="")
+
+proc a(my_token: token, state: (bits[32]), init=(1)) {
+  counter: bits[32] = tuple_index(state, index=0)
+  rcv: (token, bits[32]) = receive(my_token, channel_id=0)
+  rcv_token: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  product: bits[32] = umul(counter, data)
+  snd: token = send(rcv_token, product, channel_id=1)
+  one: bits[32] = literal(value=1)
+  next_counter: bits[32] = add(counter, one)
+  next_state: (bits[32]) = tuple(next_counter)
+  next (snd, next_state)
+}
+
+proc b(my_token: token, state: bits[32], init=0) {
+  rcv: (token, bits[32]) = receive(my_token, channel_id=1)
+  rcv_token: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  sum: bits[32] = add(state, data)
+  snd: token = send(rcv_token, sum, channel_id=2)
+  next (snd, sum)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint";
+  for (bool pack_state : {false, true}) {
+    XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+    XLS_ASSERT_OK_AND_ASSIGN(auto runtime,
+                             SerialProcRuntime::Create(p.get(), pack_state));
+    XLS_ASSERT_OK(runtime->EnableAutomaticCheckpoints(path, 7));
+    XLS_ASSERT_OK_AND_ASSIGN(auto input_queue,
+                             runtime->queue_mgr()->GetQueueById(0));
+    for (int i = 0; i < 20; i++) {
+      EnqueueData(input_queue, i);
+    }
+    XLS_ASSERT_OK(runtime->RunTicks(10));
+    XLS_ASSERT_OK_AND_ASSIGN(ProcNetworkCheckpointProto checkpoint,
+                             runtime->Checkpoint());
+    EXPECT_EQ(checkpoint.tick(), 10);
+    EXPECT_EQ(checkpoint.state_layout(),
+              pack_state ? ProcNetworkCheckpointProto::JIT_PACKED
+                         : ProcNetworkCheckpointProto::JIT_NATIVE);
+
+    // The automatic checkpoint taken after the seventh tick holds the
+    // remaining inputs and the outputs produced so far.
+    XLS_ASSERT_OK_AND_ASSIGN(checkpoint, ReadProcNetworkCheckpoint(path));
+    EXPECT_EQ(checkpoint.tick(), 7);
+    XLS_ASSERT_OK_AND_ASSIGN(auto restored,
+                             SerialProcRuntime::Create(p.get(), pack_state));
+    XLS_ASSERT_OK(restored->Restore(checkpoint));
+    XLS_ASSERT_OK(restored->RunTicks(13));
+    EXPECT_EQ(restored->tick_count(), 20);
+    XLS_ASSERT_OK_AND_ASSIGN(auto output_queue,
+                             restored->queue_mgr()->GetQueueById(2));
+    int sum = 0;
+    for (int i = 0; i < 20; i++) {
+      sum += i * (i + 1);
+      ASSERT_EQ(DequeueData<int>(output_queue), sum)
+          << "pack_state: " << pack_state << ", tick: " << i;
+    }
+    EXPECT_TRUE(output_queue->Empty());
+
+    XLS_ASSERT_OK_AND_ASSIGN(auto other_layout,
+                             SerialProcRuntime::Create(p.get(), !pack_state));
+    EXPECT_THAT(other_layout->Restore(checkpoint),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("state layout")));
+  }
+}
+
+// This test verifies that state kept in the packed layout evolves as state kept
+// in the native layout does.
+TEST(SerialProcRuntimeTest, PackedState) {
+  const std::string kIrText = R"(
+package p
+
+chan out(bits[3], id=0, kind=streaming, ops=send_only, metadata="")
+
+proc a(my_token: token, state: (bits[3][4], bits[2]), init=([1, 2, 3, 4], 0)) {
+  arr: bits[3][4] = tuple_index(state, index=0)
+  idx: bits[2] = tuple_index(state, index=1)
+  elem: bits[3] = array_index(arr, indices=[idx])
+  one: bits[3] = literal(value=1)
+  new_elem: bits[3] = add(elem, one)
+  new_arr: bits[3][4] = array_update(arr, new_elem, indices=[idx])
+  one_idx: bits[2] = literal(value=1)
+  new_idx: bits[2] = add(idx, one_idx)
+  snd: token = send(my_token, new_elem, channel_id=0)
+  new_state: (bits[3][4], bits[2]) = tuple(new_arr, new_idx)
+  next (snd, new_state)
+}
+)";
+  for (bool pack_state : {false, true}) {
+    XLS_ASSERT_OK_AND_ASSIGN(auto p, Parser::ParsePackage(kIrText));
+    XLS_ASSERT_OK_AND_ASSIGN(auto runtime,
+                             SerialProcRuntime::Create(p.get(), pack_state));
+    XLS_ASSERT_OK_AND_ASSIGN(Channel * channel, p->GetChannel(0));
+    for (int64_t i = 0; i < 10; ++i) {
+      XLS_ASSERT_OK(runtime->Tick());
+      // Element i % 4 starts at (i % 4) + 1 and is incremented every fourth
+      // tick.
+      EXPECT_THAT(runtime->DequeueValueFromChannel(channel),
+                  IsOkAndHolds(Value(UBits(i % 4 + 2 + i / 4, 3))))
+          << "pack_state: " << pack_state << ", tick: " << i;
+    }
+  }
+}
+
 // TODO(meheff): This test is a duplicate of one in
 // proc_network_interpreter_test. Unify the set of tests in one location.
+TEST(SerialProcRuntimeTest, BoundedChannelBackpressure) {
+  // The producer sends two values per activation through a channel of capacity
+  // one, so its second send blocks until the consumer receives the first.
+  constexpr char kIrText[] = R"(
+package p
+
+chan pair(bits[32], id=0, kind=streaming, ops=send_receive, metadata="")
+chan out(bits[32], id=1, kind=streaming, ops=send_only, metadata="")
+
+proc producer(tkn: token, state: bits[32], init=0) {
+  one: bits[32] = literal(value=1)
+  two: bits[32] = literal(value=2)
+  second_value: bits[32] = add(state, one)
+  first: token = send(tkn, state, channel_id=0)
+  second: token = send(first, second_value, channel_id=0)
+  next_state: bits[32] = add(state, two)
+  next (second, next_state)
+}
+
+proc consumer(tkn: token, state: (), init=()) {
+  first: (token, bits[32]) = receive(tkn, channel_id=0)
+  first_tkn: token = tuple_index(first, index=0)
+  second: (token, bits[32]) = receive(first_tkn, channel_id=0)
+  second_tkn: token = tuple_index(second, index=0)
+  a: bits[32] = tuple_index(first, index=1)
+  b: bits[32] = tuple_index(second, index=1)
+  sum: bits[32] = add(a, b)
+  snd: token = send(second_tkn, sum, channel_id=1)
+  next (snd, state)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, Parser::ParsePackage(kIrText));
+  XLS_ASSERT_OK_AND_ASSIGN(auto runtime,
+                           SerialProcRuntime::Create(package.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(JitChannelQueue * pair,
+                           runtime->queue_mgr()->GetQueueById(0));
+  pair->set_capacity(1);
+
+  for (int64_t i = 0; i < 3; ++i) {
+    XLS_ASSERT_OK(runtime->Tick());
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(JitChannelQueue * out,
+                           runtime->queue_mgr()->GetQueueById(1));
+  EXPECT_EQ(DequeueData<int>(out), 1);
+  EXPECT_EQ(DequeueData<int>(out), 5);
+  EXPECT_EQ(DequeueData<int>(out), 9);
+  EXPECT_TRUE(out->Empty());
+  EXPECT_EQ(pair->high_water_mark(), 1);
+  EXPECT_GT(pair->send_stall_count(), 0);
+}
+
 TEST(SerialProcRuntimeTest, ChannelInitValues) {
   auto p = absl::make_unique<Package>("init_value");
   // Create an iota proc which uses a channel to convey the state rather than
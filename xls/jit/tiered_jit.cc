@@ -0,0 +1,100 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/tiered_jit.h"
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/interpreter/ir_interpreter.h"
+
+namespace xls {
+
+absl::StatusOr<std::unique_ptr<TieredJit>> TieredJit::Create(
+    Function* function, int64_t promotion_threshold, int64_t opt_level) {
+  if (promotion_threshold < 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Promotion threshold must be non-negative, got %d",
+        promotion_threshold));
+  }
+  auto tiered_jit = absl::WrapUnique(
+      new TieredJit(function, promotion_threshold, opt_level));
+  if (promotion_threshold == 0) {
+    tiered_jit->StartCompilation();
+  }
+  return tiered_jit;
+}
+
+TieredJit::~TieredJit() {
+  // The compile thread touches members of this object, so it must be joined
+  // before any of them are destroyed.
+  std::unique_ptr<Thread> thread;
+  {
+    absl::MutexLock lock(&mutex_);
+    thread = std::move(compile_thread_);
+  }
+  if (thread != nullptr) {
+    thread->Join();
+  }
+}
+
+absl::StatusOr<Value> TieredJit::Run(absl::Span<const Value> args) {
+  IrJit* jit = jit_.load(std::memory_order_acquire);
+  if (jit != nullptr) {
+    return jit->Run(args);
+  }
+  // Exactly one caller observes the threshold being crossed, so compilation is
+  // started at most once.
+  int64_t count =
+      interpreted_count_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (count == promotion_threshold_) {
+    StartCompilation();
+  }
+  return IrInterpreter::Run(function_, args);
+}
+
+absl::Status TieredJit::WaitForCompilation() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](TieredJit* t) ABSL_EXCLUSIVE_LOCKS_REQUIRED(t->mutex_) {
+        return !t->compile_started_ || t->compile_done_;
+      },
+      this));
+  return compile_status_;
+}
+
+void TieredJit::StartCompilation() {
+  absl::MutexLock lock(&mutex_);
+  XLS_CHECK(!compile_started_);
+  compile_started_ = true;
+  compile_thread_ = std::make_unique<Thread>([this]() {
+    XLS_VLOG(2) << "Compiling " << function_->name() << " after "
+                << interpreted_count() << " interpreted invocations";
+    absl::StatusOr<std::unique_ptr<IrJit>> jit_or =
+        IrJit::Create(function_, opt_level_);
+    absl::MutexLock lock(&mutex_);
+    compile_done_ = true;
+    if (!jit_or.ok()) {
+      XLS_LOG(WARNING) << "Unable to JIT compile " << function_->name()
+                       << "; continuing in the interpreter: "
+                       << jit_or.status();
+      compile_status_ = jit_or.status();
+      return;
+    }
+    owned_jit_ = std::move(jit_or).value();
+    jit_.store(owned_jit_.get(), std::memory_order_release);
+  });
+}
+
+}  // namespace xls
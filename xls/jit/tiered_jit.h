@@ -0,0 +1,110 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_TIERED_JIT_H_
+#define XLS_JIT_TIERED_JIT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xls/common/thread.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+#include "xls/jit/ir_jit.h"
+
+namespace xls {
+
+// Evaluates an XLS function by starting in the IR interpreter and promoting
+// the function to the LLVM JIT once it has been invoked enough times to make
+// compilation worthwhile. Compilation happens on a background thread; calls
+// made while it is in flight continue to be interpreted, and calls after it
+// completes go to the JIT. Short runs thus avoid LLVM compile latency
+// entirely, while long runs still get JIT throughput.
+//
+// If compilation fails, evaluation silently stays in the interpreter (the
+// error is available from WaitForCompilation()).
+//
+// Run() may be called concurrently from multiple threads.
+class TieredJit {
+ public:
+  // Number of interpreted invocations after which compilation is kicked off.
+  static constexpr int64_t kDefaultPromotionThreshold = 64;
+
+  // Creates an evaluator for the given function. A promotion_threshold of zero
+  // starts compilation immediately.
+  static absl::StatusOr<std::unique_ptr<TieredJit>> Create(
+      Function* function,
+      int64_t promotion_threshold = kDefaultPromotionThreshold,
+      int64_t opt_level = 3);
+
+  // Waits for any in-flight compilation to finish.
+  ~TieredJit();
+
+  // Evaluates the function on the given arguments, in whichever tier is
+  // currently active.
+  absl::StatusOr<Value> Run(absl::Span<const Value> args);
+
+  // Blocks until the background compilation (if one has been started) is
+  // complete and returns its status. Returns OK if compilation has not been
+  // started.
+  absl::Status WaitForCompilation();
+
+  // Returns true once calls are being dispatched to the JIT.
+  bool IsPromoted() const {
+    return jit_.load(std::memory_order_acquire) != nullptr;
+  }
+
+  // Returns the number of calls which have been evaluated by the interpreter.
+  int64_t interpreted_count() const {
+    return interpreted_count_.load(std::memory_order_relaxed);
+  }
+
+  Function* function() { return function_; }
+
+ private:
+  TieredJit(Function* function, int64_t promotion_threshold,
+            int64_t opt_level)
+      : function_(function),
+        promotion_threshold_(promotion_threshold),
+        opt_level_(opt_level) {}
+
+  // Spawns the background thread which compiles the function.
+  void StartCompilation() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Function* function_;
+  int64_t promotion_threshold_;
+  int64_t opt_level_;
+
+  std::atomic<int64_t> interpreted_count_{0};
+
+  // Published (with release semantics) by the compile thread once owned_jit_
+  // is ready to use.
+  std::atomic<IrJit*> jit_{nullptr};
+
+  absl::Mutex mutex_;
+  std::unique_ptr<IrJit> owned_jit_ ABSL_GUARDED_BY(mutex_);
+  std::unique_ptr<Thread> compile_thread_ ABSL_GUARDED_BY(mutex_);
+  bool compile_started_ ABSL_GUARDED_BY(mutex_) = false;
+  bool compile_done_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::Status compile_status_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_TIERED_JIT_H_
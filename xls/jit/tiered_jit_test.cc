@@ -0,0 +1,102 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/tiered_jit.h"
+
+#include <random>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/random_value.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+
+class TieredJitTest : public IrTestBase {
+ protected:
+  absl::StatusOr<Function*> ParseAdd(Package* p) {
+    return ParseFunction(R"(
+    fn f(x: bits[16], y: bits[16]) -> bits[16] {
+      add.1: bits[16] = add(x, y)
+      ret umul.2: bits[16] = umul(add.1, y)
+    }
+    )", p);
+  }
+};
+
+TEST_F(TieredJitTest, PromotesAfterThreshold) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseAdd(p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto tiered,
+                           TieredJit::Create(f, /*promotion_threshold=*/3));
+
+  std::minstd_rand bitgen;
+  for (int64_t i = 0; i < 3; ++i) {
+    EXPECT_FALSE(tiered->IsPromoted()) << i;
+    std::vector<Value> args = RandomFunctionArguments(f, &bitgen);
+    XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(f, args));
+    EXPECT_THAT(tiered->Run(args), IsOkAndHolds(expected));
+  }
+  XLS_ASSERT_OK(tiered->WaitForCompilation());
+  EXPECT_TRUE(tiered->IsPromoted());
+
+  for (int64_t i = 0; i < 100; ++i) {
+    std::vector<Value> args = RandomFunctionArguments(f, &bitgen);
+    XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(f, args));
+    EXPECT_THAT(tiered->Run(args), IsOkAndHolds(expected));
+  }
+  EXPECT_EQ(tiered->interpreted_count(), 3);
+}
+
+TEST_F(TieredJitTest, ZeroThresholdCompilesImmediately) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseAdd(p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto tiered,
+                           TieredJit::Create(f, /*promotion_threshold=*/0));
+  XLS_ASSERT_OK(tiered->WaitForCompilation());
+  EXPECT_TRUE(tiered->IsPromoted());
+  EXPECT_THAT(tiered->Run({Value(UBits(2, 16)), Value(UBits(3, 16))}),
+              IsOkAndHolds(Value(UBits(15, 16))));
+  EXPECT_EQ(tiered->interpreted_count(), 0);
+}
+
+TEST_F(TieredJitTest, NotPromotedBelowThreshold) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseAdd(p.get()));
+  XLS_ASSERT_OK_AND_ASSIGN(auto tiered,
+                           TieredJit::Create(f, /*promotion_threshold=*/10));
+  for (int64_t i = 0; i < 9; ++i) {
+    EXPECT_THAT(tiered->Run({Value(UBits(i, 16)), Value(UBits(1, 16))}),
+                IsOkAndHolds(Value(UBits(i + 1, 16))));
+  }
+  // No compilation has been started so this returns immediately.
+  XLS_ASSERT_OK(tiered->WaitForCompilation());
+  EXPECT_FALSE(tiered->IsPromoted());
+}
+
+TEST_F(TieredJitTest, NegativeThreshold) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseAdd(p.get()));
+  EXPECT_THAT(TieredJit::Create(f, /*promotion_threshold=*/-1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace xls
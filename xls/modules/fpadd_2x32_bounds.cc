@@ -19,6 +19,10 @@
 //
 // With default flags, it proves that results are _exactly_ identical when
 // subnormals are flushed to zero.
+//
+// With --split_cases, the proof is split into cases by the signs and exponent
+// ranges of the inputs, which are proved in parallel, each with its own Z3
+// context; these are much easier than the whole query.
 
 #include <filesystem>
 #include <thread>  // NOLINT(build/c++11)
@@ -35,6 +39,7 @@
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/solvers/z3_case_split.h"
 #include "xls/solvers/z3_ir_translator.h"
 #include "xls/solvers/z3_utils.h"
 #include "../z3/src/api/z3_api.h"
@@ -56,6 +61,16 @@ ABSL_FLAG(
     "less than this value. This is an absolute, not relative, value. "
     "This is specified as a uint32_t to enable, e.g., subnormal values to "
     "be specified.");
+ABSL_FLAG(bool, split_cases, false,
+          "Prove the bound separately for each combination of the inputs' "
+          "signs and exponent ranges, in parallel. The timeout applies to "
+          "each case.");
+ABSL_FLAG(int64_t, exponent_ranges, 4,
+          "With --split_cases, the number of ranges the normal exponents of "
+          "each input are split into.");
+ABSL_FLAG(int64_t, proof_threads, 0,
+          "With --split_cases, the number of cases proved concurrently; 0 for "
+          "one per core.");
 
 namespace xls {
 
@@ -63,6 +78,9 @@ constexpr const char kIrPath[] = "xls/modules/fpadd_2x32.ir";
 constexpr const char kOptIrPath[] = "xls/modules/fpadd_2x32.opt.ir";
 constexpr const char kFunctionName[] = "__fpadd_2x32__fpadd_2x32";
 
+using solvers::z3::CaseQuery;
+using solvers::z3::CaseSplitOptions;
+using solvers::z3::CaseSplitResult;
 using solvers::z3::IrTranslator;
 
 // Adds an error comparsion to the translated XLS function. To do so:
@@ -137,11 +155,11 @@ absl::StatusOr<std::unique_ptr<Package>> GetIr(bool opt_ir) {
   return Parser::ParsePackage(ir_text);
 }
 
-absl::Status CompareToReference(bool use_opt_ir, uint32_t error_bound,
-                                bool flush_subnormals, absl::Duration timeout) {
-  XLS_ASSIGN_OR_RETURN(auto package, GetIr(use_opt_ir));
-  XLS_ASSIGN_OR_RETURN(auto function, package->GetFunction(kFunctionName));
-
+// Returns the query, in a new Z3 context, of whether the error of "function"
+// exceeds "error_bound".
+absl::StatusOr<CaseQuery> CreateBoundQuery(Function* function,
+                                           uint32_t error_bound,
+                                           bool flush_subnormals) {
   // Translate our IR into a matching Z3 AST.
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrTranslator> translator,
                        IrTranslator::CreateAndTranslate(function));
@@ -157,14 +175,61 @@ absl::Status CompareToReference(bool use_opt_ir, uint32_t error_bound,
   Z3_context ctx = translator->ctx();
   Z3_ast bounds = Z3_mk_fpa_numeral_float(
       ctx, absl::bit_cast<float>(error_bound), Z3_mk_fpa_sort_32(ctx));
+  Z3_ast objective = Z3_mk_fpa_gt(ctx, error, bounds);
+  return CaseQuery{std::move(translator), objective};
+}
+
+// Proves the bound with a query per combination of the signs and exponent
+// ranges of the two inputs.
+absl::Status CompareToReferenceByCases(Function* function,
+                                       uint32_t error_bound,
+                                       bool flush_subnormals,
+                                       absl::Duration timeout,
+                                       int64_t exponent_ranges,
+                                       int64_t thread_count) {
+  std::vector<solvers::z3::CaseConstraint> cases = solvers::z3::CrossProduct(
+      {solvers::z3::Float32SignCases(0), solvers::z3::Float32SignCases(1),
+       solvers::z3::Float32ExponentCases(0, exponent_ranges),
+       solvers::z3::Float32ExponentCases(1, exponent_ranges)});
+  CaseSplitOptions options;
+  options.thread_count = thread_count;
+  options.timeout_per_case = timeout;
+  XLS_ASSIGN_OR_RETURN(
+      CaseSplitResult result,
+      solvers::z3::ProveByCases(
+          [&]() {
+            return CreateBoundQuery(function, error_bound, flush_subnormals);
+          },
+          cases, options));
+  std::cout << result.ToString() << std::endl;
+  std::cout << (result.proved() ? "Proved" : "Not proved") << " in "
+            << result.cases.size() << " cases." << std::endl;
+  return absl::OkStatus();
+}
+
+absl::Status CompareToReference(bool use_opt_ir, uint32_t error_bound,
+                                bool flush_subnormals, absl::Duration timeout,
+                                bool split_cases, int64_t exponent_ranges,
+                                int64_t proof_threads) {
+  XLS_ASSIGN_OR_RETURN(auto package, GetIr(use_opt_ir));
+  XLS_ASSIGN_OR_RETURN(auto function, package->GetFunction(kFunctionName));
+  if (split_cases) {
+    return CompareToReferenceByCases(function, error_bound, flush_subnormals,
+                                     timeout, exponent_ranges, proof_threads);
+  }
+
+  XLS_ASSIGN_OR_RETURN(
+      CaseQuery query,
+      CreateBoundQuery(function, error_bound, flush_subnormals));
+  IrTranslator* translator = query.translator.get();
+  Z3_context ctx = translator->ctx();
 
   // Push all that work into z3, and have the solver do its work.
   translator->SetTimeout(timeout);
 
   Z3_solver solver =
       solvers::z3::CreateSolver(ctx, std::thread::hardware_concurrency());
-  Z3_ast objective = Z3_mk_fpa_gt(ctx, error, bounds);
-  Z3_solver_assert(ctx, solver, objective);
+  Z3_solver_assert(ctx, solver, query.violation);
 
   // Finally, print the output to the terminal in gorgeous two-color ASCII.
   Z3_lbool satisfiable = Z3_solver_check(ctx, solver);
@@ -183,6 +248,8 @@ int main(int argc, char** argv) {
   XLS_QCHECK_OK(xls::CompareToReference(
       absl::GetFlag(FLAGS_reference_use_opt_ir),
       absl::GetFlag(FLAGS_error_bound), absl::GetFlag(FLAGS_flush_subnormals),
-      absl::GetFlag(FLAGS_timeout)));
+      absl::GetFlag(FLAGS_timeout), absl::GetFlag(FLAGS_split_cases),
+      absl::GetFlag(FLAGS_exponent_ranges),
+      absl::GetFlag(FLAGS_proof_threads)));
   return 0;
 }
@@ -0,0 +1,131 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/netlist/cell_library_loader.h"
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/mapped_file.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/netlist/function_extractor.h"
+#include "xls/netlist/lib_parser.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+// Returns a string identifying the current contents of the given file, for
+// validating caches derived from it.
+absl::StatusOr<std::string> GetSourceId(const std::filesystem::path& path) {
+  std::error_code ec;
+  uintmax_t size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return absl::NotFoundError(absl::StrFormat(
+        "Could not stat cell library %s: %s", path.string(), ec.message()));
+  }
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return absl::NotFoundError(absl::StrFormat(
+        "Could not stat cell library %s: %s", path.string(), ec.message()));
+  }
+  return absl::StrFormat("%s:%d:%d", std::filesystem::absolute(path).string(),
+                         size, mtime.time_since_epoch().count());
+}
+
+// Reads the cache at the given path, returning an empty library if it does not
+// exist, cannot be parsed or was extracted from a different library.
+CellLibraryProto ReadCache(const std::filesystem::path& cache_path,
+                           const std::string& source) {
+  CellLibraryProto proto;
+  if (!FileExists(cache_path).ok()) {
+    return proto;
+  }
+  absl::StatusOr<std::string> contents = GetFileContents(cache_path);
+  if (!contents.ok() || !proto.ParseFromString(contents.value()) ||
+      proto.source() != source) {
+    XLS_VLOG(1) << "Discarding cell library cache " << cache_path;
+    proto.Clear();
+  }
+  return proto;
+}
+
+}  // namespace
+
+absl::StatusOr<CellLibraryProto> LoadCellLibraryForNetlist(
+    const std::filesystem::path& liberty_path,
+    const std::filesystem::path& netlist_path,
+    absl::optional<std::filesystem::path> cache_path) {
+  std::vector<std::string> cell_names;
+  {
+    XLS_ASSIGN_OR_RETURN(MappedFile netlist_file,
+                         MappedFile::Open(netlist_path));
+    rtl::Scanner scanner(netlist_file.contents());
+    XLS_ASSIGN_OR_RETURN(cell_names, rtl::Parser::ScanCellNames(&scanner));
+  }
+
+  XLS_ASSIGN_OR_RETURN(std::string source, GetSourceId(liberty_path));
+  CellLibraryProto proto;
+  if (cache_path.has_value()) {
+    proto = ReadCache(cache_path.value(), source);
+  }
+  proto.set_source(source);
+
+  absl::flat_hash_set<std::string> present;
+  for (const CellLibraryEntryProto& entry : proto.entries()) {
+    present.insert(entry.name());
+  }
+  std::vector<std::string> missing;
+  for (const std::string& name : cell_names) {
+    if (!present.contains(name)) {
+      missing.push_back(name);
+    }
+  }
+  if (missing.empty()) {
+    return proto;
+  }
+
+  XLS_ASSIGN_OR_RETURN(MappedFile liberty_file, MappedFile::Open(liberty_path));
+  XLS_ASSIGN_OR_RETURN(
+      cell_lib::LibraryIndex index,
+      cell_lib::LibraryIndex::Create(liberty_file.contents()));
+  XLS_ASSIGN_OR_RETURN(CellLibraryProto extracted,
+                       function::ExtractFunctions(index, missing));
+  XLS_VLOG(1) << "Extracted " << extracted.entries_size() << " of "
+              << index.cell_count() << " cells from " << liberty_path;
+  if (extracted.entries().empty()) {
+    // The missing cells are not in the library (e.g., they are LUTs which
+    // the netlist parser provides itself); there is nothing to cache.
+    return proto;
+  }
+  for (CellLibraryEntryProto& entry : *extracted.mutable_entries()) {
+    *proto.add_entries() = std::move(entry);
+  }
+  if (cache_path.has_value()) {
+    XLS_RETURN_IF_ERROR(
+        AtomicSetFileContents(cache_path.value(), proto.SerializeAsString()));
+  }
+  return proto;
+}
+
+}  // namespace netlist
+}  // namespace xls
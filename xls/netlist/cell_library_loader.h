@@ -0,0 +1,46 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_NETLIST_CELL_LIBRARY_LOADER_H_
+#define XLS_NETLIST_CELL_LIBRARY_LOADER_H_
+
+#include <filesystem>
+
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/netlist/netlist.pb.h"
+
+namespace xls {
+namespace netlist {
+
+// Extracts the cells of the Liberty library at `liberty_path` which are
+// instantiated by the netlist at `netlist_path`. The library is indexed in a
+// single pass and only the groups of the instantiated cells are parsed, which
+// is much faster than ExtractFunctions on a full foundry library.
+//
+// If `cache_path` is given, the result is also stored there as a binary
+// CellLibraryProto, which later calls (e.g., for other netlists using the
+// same library) extend as needed; cells already in the cache are not
+// extracted again, and a library with all required cells cached is not read
+// at all. The cache is discarded if the library's size or modification time
+// changes. The result may contain cells that the netlist does not use.
+absl::StatusOr<CellLibraryProto> LoadCellLibraryForNetlist(
+    const std::filesystem::path& liberty_path,
+    const std::filesystem::path& netlist_path,
+    absl::optional<std::filesystem::path> cache_path = absl::nullopt);
+
+}  // namespace netlist
+}  // namespace xls
+
+#endif  // XLS_NETLIST_CELL_LIBRARY_LOADER_H_
@@ -0,0 +1,138 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/netlist/cell_library_loader.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/status/matchers.h"
+#include "xls/netlist/cell_library.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr char kLibrary[] = R"lib(
+library (test) {
+  cell (AND) {
+    pin (A) { direction: input; }
+    pin (B) { direction: input; }
+    pin (Z) { direction: output; function: "A&B"; }
+  }
+  cell (OR) {
+    pin (A) { direction: input; }
+    pin (B) { direction: input; }
+    pin (Z) { direction: output; function: "A|B"; }
+  }
+  cell (INV) {
+    pin (A) { direction: input; }
+    pin (ZN) { direction: output; function: "!A"; }
+  }
+}
+)lib";
+
+constexpr char kAndNetlist[] = R"(
+module sub (a, b, z);
+  input a, b;
+  output z;
+  AND and0 ( .A(a), .B(b), .Z(z) );
+endmodule
+
+module main (a, b, z);
+  input a, b;
+  output z;
+  sub sub0 ( .a(a), .b(b), .z(z) );
+endmodule
+)";
+
+constexpr char kInvNetlist[] = R"(
+module main (a, z);
+  input a;
+  output z;
+  INV inv0 ( .A(a), .ZN(z) );
+endmodule
+)";
+
+std::vector<std::string> EntryNames(const CellLibraryProto& proto) {
+  std::vector<std::string> names;
+  for (const CellLibraryEntryProto& entry : proto.entries()) {
+    names.push_back(entry.name());
+  }
+  return names;
+}
+
+TEST(CellLibraryLoaderTest, ScanCellNames) {
+  rtl::Scanner scanner(kAndNetlist);
+  EXPECT_THAT(rtl::Parser::ScanCellNames(&scanner),
+              status_testing::IsOkAndHolds(ElementsAre("AND")));
+}
+
+TEST(CellLibraryLoaderTest, LoadsOnlyInstantiatedCells) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile library,
+                           TempFile::CreateWithContent(kLibrary, ".lib"));
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile netlist,
+                           TempFile::CreateWithContent(kAndNetlist, ".v"));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      CellLibraryProto proto,
+      LoadCellLibraryForNetlist(library.path(), netlist.path()));
+  EXPECT_THAT(EntryNames(proto), ElementsAre("AND"));
+
+  // The result is sufficient to parse the netlist.
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library,
+                           CellLibrary::FromProto(proto));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto parsed,
+      rtl::Parser::ParseNetlistFile(&cell_library, netlist.path()));
+  XLS_EXPECT_OK(parsed->GetModule("main").status());
+}
+
+TEST(CellLibraryLoaderTest, ExtendsCache) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path library = temp_dir.path() / "test.lib";
+  std::filesystem::path and_netlist = temp_dir.path() / "and.v";
+  std::filesystem::path inv_netlist = temp_dir.path() / "inv.v";
+  std::filesystem::path cache = temp_dir.path() / "test.lib.pb";
+  XLS_ASSERT_OK(SetFileContents(library, kLibrary));
+  XLS_ASSERT_OK(SetFileContents(and_netlist, kAndNetlist));
+  XLS_ASSERT_OK(SetFileContents(inv_netlist, kInvNetlist));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      CellLibraryProto proto,
+      LoadCellLibraryForNetlist(library, and_netlist, cache));
+  EXPECT_THAT(EntryNames(proto), ElementsAre("AND"));
+  XLS_ASSERT_OK(FileExists(cache));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      proto, LoadCellLibraryForNetlist(library, inv_netlist, cache));
+  EXPECT_THAT(EntryNames(proto), ElementsAre("AND", "INV"));
+
+  // Cells which are cached are not read from the library.
+  XLS_ASSERT_OK_AND_ASSIGN(std::string cache_contents, GetFileContents(cache));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      proto, LoadCellLibraryForNetlist(library, and_netlist, cache));
+  EXPECT_THAT(EntryNames(proto), ElementsAre("AND", "INV"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string new_cache_contents,
+                           GetFileContents(cache));
+  EXPECT_EQ(new_cache_contents, cache_contents);
+}
+
+}  // namespace
+}  // namespace netlist
+}  // namespace xls
@@ -0,0 +1,563 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/netlist/compiled_simulator.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+// Cells referring to a state table with more inputs than this are not
+// supported; the table is expanded into a sum of products over all input
+// combinations.
+constexpr int64_t kMaxStateTableInputs = 8;
+
+}  // namespace
+
+/* static */ absl::StatusOr<std::unique_ptr<CompiledSimulator>>
+CompiledSimulator::Create(const rtl::Netlist* netlist,
+                          const rtl::Module* module) {
+  auto simulator = absl::WrapUnique(new CompiledSimulator());
+  simulator->netlist_ = netlist;
+  simulator->module_ = module;
+
+  absl::flat_hash_map<rtl::NetRef, int64_t> nets;
+  nets.reserve(module->nets().size());
+  for (const std::unique_ptr<rtl::NetDef>& net : module->nets()) {
+    nets[net.get()] = simulator->NewNet(net.get());
+  }
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef zero, module->ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef one, module->ResolveNumber(1));
+  simulator->zero_net_ = nets.at(zero);
+  simulator->one_net_ = nets.at(one);
+  simulator->dummy_net_ = nets.at(module->GetDummyRef());
+  for (rtl::NetRef input : module->inputs()) {
+    simulator->input_nets_.push_back(nets.at(input));
+  }
+  for (rtl::NetRef output : module->outputs()) {
+    simulator->output_nets_.push_back(nets.at(output));
+  }
+
+  XLS_RETURN_IF_ERROR(simulator->CompileModule(module, nets));
+  simulator->top_nets_ = std::move(nets);
+  simulator->function_cache_.clear();
+  XLS_RETURN_IF_ERROR(simulator->Levelize());
+  return std::move(simulator);
+}
+
+int64_t CompiledSimulator::NewNet(rtl::NetRef ref) {
+  values_.push_back(0);
+  net_refs_.push_back(ref);
+  return values_.size() - 1;
+}
+
+absl::Status CompiledSimulator::CompileModule(
+    const rtl::Module* module,
+    const absl::flat_hash_map<rtl::NetRef, int64_t>& nets) {
+  for (const std::unique_ptr<rtl::Cell>& cell : module->cells()) {
+    absl::StatusOr<const rtl::Module*> submodule =
+        netlist_->GetModule(cell->cell_library_entry()->name());
+    if (submodule.ok()) {
+      XLS_RETURN_IF_ERROR(
+          CompileSubmoduleInstance(*cell, submodule.value(), nets));
+    } else {
+      XLS_RETURN_IF_ERROR(CompileCell(*cell, nets));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompiledSimulator::CompileSubmoduleInstance(
+    const rtl::Cell& cell, const rtl::Module* submodule,
+    const absl::flat_hash_map<rtl::NetRef, int64_t>& nets) {
+  // Nets of the submodule connected to the instance's pins are the nets of
+  // the enclosing module; all others are new nets of the flattened module.
+  absl::flat_hash_map<rtl::NetRef, int64_t> submodule_nets;
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef zero, submodule->ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef one, submodule->ResolveNumber(1));
+  submodule_nets[zero] = zero_net_;
+  submodule_nets[one] = one_net_;
+  submodule_nets[submodule->GetDummyRef()] = dummy_net_;
+
+  absl::Span<const std::string> input_names =
+      submodule->AsCellLibraryEntry()->input_names();
+  for (const rtl::Cell::Pin& input : cell.inputs()) {
+    auto it = std::find(input_names.begin(), input_names.end(), input.name);
+    XLS_RET_CHECK(it != input_names.end()) << absl::StrFormat(
+        "Could not find input pin \"%s\" in module \"%s\", referenced in "
+        "cell \"%s\"!",
+        input.name, submodule->name(), cell.name());
+    submodule_nets[submodule->inputs()[it - input_names.begin()]] =
+        nets.at(input.netref);
+  }
+  for (const rtl::Cell::Pin& output : cell.outputs()) {
+    XLS_ASSIGN_OR_RETURN(rtl::NetRef submodule_output,
+                         submodule->ResolveNet(output.name));
+    int64_t net = nets.at(output.netref);
+    // An unconnected output may still be used within the submodule.
+    if (net != dummy_net_) {
+      submodule_nets[submodule_output] = net;
+    }
+  }
+  for (const std::unique_ptr<rtl::NetDef>& net : submodule->nets()) {
+    if (!submodule_nets.contains(net.get())) {
+      submodule_nets[net.get()] = NewNet(net.get());
+    }
+  }
+  return CompileModule(submodule, submodule_nets);
+}
+
+absl::Status CompiledSimulator::CompileCell(
+    const rtl::Cell& cell,
+    const absl::flat_hash_map<rtl::NetRef, int64_t>& nets) {
+  const CellLibraryEntry* entry = cell.cell_library_entry();
+  for (const rtl::Cell::Pin& output : cell.outputs()) {
+    int64_t output_net = nets.at(output.netref);
+    if (output_net == dummy_net_) {
+      continue;
+    }
+    auto key = std::make_pair(entry, output.name);
+    auto it = function_cache_.find(key);
+    if (it == function_cache_.end()) {
+      auto function = entry->output_pin_to_function().find(output.name);
+      if (function == entry->output_pin_to_function().end()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Cell %s has no function for output pin %s",
+                            cell.name(), output.name));
+      }
+      XLS_ASSIGN_OR_RETURN(function::Ast ast,
+                           function::Parser::ParseFunction(function->second));
+      it = function_cache_.emplace(key, std::move(ast)).first;
+    }
+
+    Evaluation evaluation;
+    evaluation.begin = instructions_.size();
+    XLS_RETURN_IF_ERROR(
+        CompileFunction(cell, it->second, nets, &evaluation.input_nets));
+    evaluation.end = instructions_.size();
+    std::sort(evaluation.input_nets.begin(), evaluation.input_nets.end());
+    evaluation.input_nets.erase(std::unique(evaluation.input_nets.begin(),
+                                            evaluation.input_nets.end()),
+                                evaluation.input_nets.end());
+    evaluation.output_net = output_net;
+    evaluation.level = 0;
+    evaluations_.push_back(std::move(evaluation));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompiledSimulator::CompileFunction(
+    const rtl::Cell& cell, const function::Ast& ast,
+    const absl::flat_hash_map<rtl::NetRef, int64_t>& nets,
+    std::vector<int64_t>* input_nets) {
+  switch (ast.kind()) {
+    case function::Ast::Kind::kIdentifier: {
+      for (const rtl::Cell::Pin& input : cell.inputs()) {
+        if (input.name == ast.name()) {
+          int64_t net = nets.at(input.netref);
+          instructions_.push_back({Opcode::kLoad, net});
+          input_nets->push_back(net);
+          return absl::OkStatus();
+        }
+      }
+      for (const rtl::Cell::Pin& internal : cell.internal_pins()) {
+        if (internal.name == ast.name()) {
+          return CompileStateTable(cell, internal.name, nets, input_nets);
+        }
+      }
+      return absl::NotFoundError(
+          absl::StrFormat("Identifier \"%s\" not found in cell %s's inputs "
+                          "or internal signals.",
+                          ast.name(), cell.name()));
+    }
+    case function::Ast::Kind::kLiteralZero:
+      instructions_.push_back({Opcode::kZero, 0});
+      return absl::OkStatus();
+    case function::Ast::Kind::kLiteralOne:
+      instructions_.push_back({Opcode::kOne, 0});
+      return absl::OkStatus();
+    case function::Ast::Kind::kNot:
+      XLS_RETURN_IF_ERROR(
+          CompileFunction(cell, ast.children()[0], nets, input_nets));
+      instructions_.push_back({Opcode::kNot, 0});
+      return absl::OkStatus();
+    case function::Ast::Kind::kAnd:
+    case function::Ast::Kind::kOr:
+    case function::Ast::Kind::kXor: {
+      XLS_RETURN_IF_ERROR(
+          CompileFunction(cell, ast.children()[0], nets, input_nets));
+      XLS_RETURN_IF_ERROR(
+          CompileFunction(cell, ast.children()[1], nets, input_nets));
+      Opcode opcode = ast.kind() == function::Ast::Kind::kAnd  ? Opcode::kAnd
+                      : ast.kind() == function::Ast::Kind::kOr ? Opcode::kOr
+                                                               : Opcode::kXor;
+      instructions_.push_back({opcode, 0});
+      return absl::OkStatus();
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown AST element type: ", static_cast<int>(ast.kind())));
+}
+
+absl::Status CompiledSimulator::CompileStateTable(
+    const rtl::Cell& cell, const std::string& pin_name,
+    const absl::flat_hash_map<rtl::NetRef, int64_t>& nets,
+    std::vector<int64_t>* input_nets) {
+  XLS_RET_CHECK(cell.cell_library_entry()->state_table());
+  const StateTable& state_table =
+      cell.cell_library_entry()->state_table().value();
+  absl::Span<const rtl::Cell::Pin> inputs = cell.inputs();
+  if (inputs.size() > kMaxStateTableInputs) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Cell %s has a state table with %d inputs; at most %d are supported",
+        cell.name(), inputs.size(), kMaxStateTableInputs));
+  }
+  for (const rtl::Cell::Pin& input : inputs) {
+    input_nets->push_back(nets.at(input.netref));
+  }
+
+  // Emit one product term per input combination for which the signal is
+  // high, and OR them together.
+  bool have_term = false;
+  for (int64_t minterm = 0; minterm < (int64_t{1} << inputs.size());
+       ++minterm) {
+    StateTable::InputStimulus stimulus;
+    for (int64_t i = 0; i < inputs.size(); ++i) {
+      stimulus[inputs[i].name] = (minterm >> i) & 1;
+    }
+    XLS_ASSIGN_OR_RETURN(bool value,
+                         state_table.GetSignalValue(stimulus, pin_name));
+    if (!value) {
+      continue;
+    }
+    if (inputs.empty()) {
+      instructions_.push_back({Opcode::kOne, 0});
+    }
+    for (int64_t i = 0; i < inputs.size(); ++i) {
+      instructions_.push_back({Opcode::kLoad, nets.at(inputs[i].netref)});
+      if (((minterm >> i) & 1) == 0) {
+        instructions_.push_back({Opcode::kNot, 0});
+      }
+      if (i > 0) {
+        instructions_.push_back({Opcode::kAnd, 0});
+      }
+    }
+    if (have_term) {
+      instructions_.push_back({Opcode::kOr, 0});
+    }
+    have_term = true;
+  }
+  if (!have_term) {
+    instructions_.push_back({Opcode::kZero, 0});
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompiledSimulator::Levelize() {
+  int64_t net_count = values_.size();
+  std::vector<int64_t> driver(net_count, -1);
+  for (int64_t i = 0; i < evaluations_.size(); ++i) {
+    int64_t net = evaluations_[i].output_net;
+    if (driver[net] != -1) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Net %s is driven by more than one cell output",
+          net_refs_[net]->name()));
+    }
+    driver[net] = i;
+  }
+  std::vector<bool> is_source(net_count, false);
+  is_source[zero_net_] = true;
+  is_source[one_net_] = true;
+  for (int64_t net : input_nets_) {
+    is_source[net] = true;
+  }
+  auto check_driven = [&](int64_t net) -> absl::Status {
+    if (!is_source[net] && driver[net] == -1) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Netlist contains unconnected subgraphs and cannot be translated. "
+          "Example: net %s has no driver.",
+          net_refs_[net]->name()));
+    }
+    return absl::OkStatus();
+  };
+  for (int64_t net : output_nets_) {
+    XLS_RETURN_IF_ERROR(check_driven(net));
+  }
+
+  // Kahn's algorithm over the evaluations. An evaluation's level is one more
+  // than the greatest level of the evaluations driving its inputs.
+  std::vector<int64_t> pending(evaluations_.size(), 0);
+  std::vector<std::vector<int64_t>> readers(net_count);
+  std::deque<int64_t> ready;
+  for (int64_t i = 0; i < evaluations_.size(); ++i) {
+    for (int64_t net : evaluations_[i].input_nets) {
+      XLS_RETURN_IF_ERROR(check_driven(net));
+      if (driver[net] != -1) {
+        ++pending[i];
+        readers[net].push_back(i);
+      }
+    }
+    if (pending[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+  int64_t processed = 0;
+  while (!ready.empty()) {
+    int64_t i = ready.front();
+    ready.pop_front();
+    ++processed;
+    for (int64_t reader : readers[evaluations_[i].output_net]) {
+      evaluations_[reader].level =
+          std::max(evaluations_[reader].level, evaluations_[i].level + 1);
+      if (--pending[reader] == 0) {
+        ready.push_back(reader);
+      }
+    }
+  }
+  if (processed != evaluations_.size()) {
+    for (int64_t i = 0; i < evaluations_.size(); ++i) {
+      if (pending[i] != 0) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Netlist contains a combinational cycle through net %s",
+            net_refs_[evaluations_[i].output_net]->name()));
+      }
+    }
+  }
+
+  // Lay out the programs contiguously in evaluation order, and size the
+  // stack for the deepest one.
+  std::stable_sort(evaluations_.begin(), evaluations_.end(),
+                   [](const Evaluation& a, const Evaluation& b) {
+                     return a.level < b.level;
+                   });
+  std::vector<Instruction> instructions;
+  instructions.reserve(instructions_.size());
+  int64_t max_depth = 0;
+  for (Evaluation& evaluation : evaluations_) {
+    int64_t begin = instructions.size();
+    int64_t depth = 0;
+    for (int64_t i = evaluation.begin; i < evaluation.end; ++i) {
+      const Instruction& instruction = instructions_[i];
+      switch (instruction.opcode) {
+        case Opcode::kLoad:
+        case Opcode::kZero:
+        case Opcode::kOne:
+          max_depth = std::max(max_depth, ++depth);
+          break;
+        case Opcode::kNot:
+          break;
+        case Opcode::kAnd:
+        case Opcode::kOr:
+        case Opcode::kXor:
+          --depth;
+          break;
+      }
+      instructions.push_back(instruction);
+    }
+    XLS_RET_CHECK_EQ(depth, 1);
+    evaluation.begin = begin;
+    evaluation.end = instructions.size();
+    level_count_ = std::max(level_count_, evaluation.level + 1);
+  }
+  instructions_ = std::move(instructions);
+  stack_.resize(max_depth);
+
+  reader_offsets_.assign(net_count + 1, 0);
+  for (const Evaluation& evaluation : evaluations_) {
+    for (int64_t net : evaluation.input_nets) {
+      ++reader_offsets_[net + 1];
+    }
+  }
+  for (int64_t net = 0; net < net_count; ++net) {
+    reader_offsets_[net + 1] += reader_offsets_[net];
+  }
+  reader_indices_.resize(reader_offsets_[net_count]);
+  std::vector<int64_t> next_reader(reader_offsets_.begin(),
+                                   reader_offsets_.end() - 1);
+  for (int64_t i = 0; i < evaluations_.size(); ++i) {
+    for (int64_t net : evaluations_[i].input_nets) {
+      reader_indices_[next_reader[net]++] = i;
+    }
+  }
+  scheduled_by_level_.resize(level_count_);
+  scheduled_.assign(evaluations_.size(), false);
+  toggle_counts_.assign(net_count, 0);
+  return absl::OkStatus();
+}
+
+uint64_t CompiledSimulator::Run(const Evaluation& evaluation) {
+  uint64_t* top = stack_.data();
+  for (int64_t i = evaluation.begin; i < evaluation.end; ++i) {
+    const Instruction& instruction = instructions_[i];
+    switch (instruction.opcode) {
+      case Opcode::kLoad:
+        *top++ = values_[instruction.net];
+        break;
+      case Opcode::kZero:
+        *top++ = 0;
+        break;
+      case Opcode::kOne:
+        *top++ = ~uint64_t{0};
+        break;
+      case Opcode::kNot:
+        top[-1] = ~top[-1];
+        break;
+      case Opcode::kAnd:
+        --top;
+        top[-1] &= top[0];
+        break;
+      case Opcode::kOr:
+        --top;
+        top[-1] |= top[0];
+        break;
+      case Opcode::kXor:
+        --top;
+        top[-1] ^= top[0];
+        break;
+    }
+  }
+  return top[-1];
+}
+
+absl::StatusOr<std::vector<uint64_t>> CompiledSimulator::Evaluate(
+    absl::Span<const uint64_t> inputs) {
+  XLS_RET_CHECK_EQ(inputs.size(), input_nets_.size());
+  values_[zero_net_] = 0;
+  values_[one_net_] = ~uint64_t{0};
+  for (int64_t i = 0; i < inputs.size(); ++i) {
+    values_[input_nets_[i]] = inputs[i];
+  }
+  for (const Evaluation& evaluation : evaluations_) {
+    values_[evaluation.output_net] = Run(evaluation);
+  }
+  has_state_ = true;
+  std::vector<uint64_t> outputs;
+  outputs.reserve(output_nets_.size());
+  for (int64_t net : output_nets_) {
+    outputs.push_back(values_[net]);
+  }
+  return outputs;
+}
+
+void CompiledSimulator::Update(int64_t net, uint64_t value, uint64_t mask) {
+  uint64_t changed = values_[net] ^ value;
+  if (changed == 0) {
+    return;
+  }
+  values_[net] = value;
+  int64_t toggles = absl::popcount(changed & mask);
+  toggle_counts_[net] += toggles;
+  activity_.toggle_count += toggles;
+  for (int64_t i = reader_offsets_[net]; i < reader_offsets_[net + 1]; ++i) {
+    int64_t reader = reader_indices_[i];
+    if (!scheduled_[reader]) {
+      scheduled_[reader] = true;
+      scheduled_by_level_[evaluations_[reader].level].push_back(reader);
+    }
+  }
+}
+
+absl::StatusOr<std::vector<uint64_t>> CompiledSimulator::EvaluateIncremental(
+    absl::Span<const uint64_t> inputs, int64_t lane_count) {
+  XLS_RET_CHECK_GE(lane_count, 1);
+  XLS_RET_CHECK_LE(lane_count, kLanes);
+  if (!has_state_) {
+    XLS_ASSIGN_OR_RETURN(std::vector<uint64_t> outputs, Evaluate(inputs));
+    activity_.evaluation_count += evaluations_.size();
+    return outputs;
+  }
+  XLS_RET_CHECK_EQ(inputs.size(), input_nets_.size());
+  uint64_t mask =
+      lane_count == kLanes ? ~uint64_t{0} : (uint64_t{1} << lane_count) - 1;
+  activity_.vector_count += lane_count;
+  for (int64_t i = 0; i < inputs.size(); ++i) {
+    Update(input_nets_[i], inputs[i], mask);
+  }
+  // Readers of a net are at a higher level than its driver, so evaluations
+  // scheduled while processing a level never belong to that level.
+  for (std::vector<int64_t>& scheduled : scheduled_by_level_) {
+    for (int64_t index : scheduled) {
+      scheduled_[index] = false;
+      const Evaluation& evaluation = evaluations_[index];
+      Update(evaluation.output_net, Run(evaluation), mask);
+    }
+    activity_.evaluation_count += scheduled.size();
+    scheduled.clear();
+  }
+  std::vector<uint64_t> outputs;
+  outputs.reserve(output_nets_.size());
+  for (int64_t net : output_nets_) {
+    outputs.push_back(values_[net]);
+  }
+  return outputs;
+}
+
+double CompiledSimulator::activity_factor() const {
+  int64_t switchable_nets = input_nets_.size() + evaluations_.size();
+  if (activity_.vector_count == 0 || switchable_nets == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(activity_.toggle_count) /
+         (static_cast<double>(activity_.vector_count) * switchable_nets);
+}
+
+absl::StatusOr<int64_t> CompiledSimulator::GetToggleCount(
+    rtl::NetRef net) const {
+  auto it = top_nets_.find(net);
+  if (it == top_nets_.end()) {
+    return absl::NotFoundError(absl::StrFormat(
+        "Net %s is not a net of module %s", net->name(), module_->name()));
+  }
+  return toggle_counts_[it->second];
+}
+
+void CompiledSimulator::ResetActivity() {
+  activity_ = ActivityStats();
+  std::fill(toggle_counts_.begin(), toggle_counts_.end(), 0);
+}
+
+absl::StatusOr<absl::flat_hash_map<const rtl::NetRef, bool>>
+CompiledSimulator::InterpretModule(
+    const absl::flat_hash_map<const rtl::NetRef, bool>& inputs) {
+  std::vector<uint64_t> input_words;
+  input_words.reserve(module_->inputs().size());
+  for (rtl::NetRef input : module_->inputs()) {
+    auto it = inputs.find(input);
+    if (it == inputs.end()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("No value given for input %s", input->name()));
+    }
+    input_words.push_back(it->second ? 1 : 0);
+  }
+  XLS_ASSIGN_OR_RETURN(std::vector<uint64_t> output_words,
+                       Evaluate(input_words));
+  absl::flat_hash_map<const rtl::NetRef, bool> outputs;
+  outputs.reserve(output_words.size());
+  for (int64_t i = 0; i < output_words.size(); ++i) {
+    outputs[module_->outputs()[i]] = output_words[i] & 1;
+  }
+  return outputs;
+}
+
+}  // namespace netlist
+}  // namespace xls
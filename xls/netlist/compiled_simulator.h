@@ -0,0 +1,214 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef XLS_NETLIST_COMPILED_SIMULATOR_H_
+#define XLS_NETLIST_COMPILED_SIMULATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/netlist/function_parser.h"
+#include "xls/netlist/netlist.h"
+
+namespace xls {
+namespace netlist {
+
+// Simulates a netlist module which has been compiled ahead of time, as a
+// faster alternative to Interpreter for repeated evaluation of large
+// netlists.
+//
+// Compilation flattens instances of submodules, levelizes the cells so each
+// is evaluated after the cells driving its inputs, and lowers each cell
+// output function (and any combinational state table it refers to) to a short
+// stack bytecode program. Net values are stored in a flat array indexed by
+// net, with one bit per input vector, so each evaluation processes kLanes
+// input vectors at once.
+class CompiledSimulator {
+ public:
+  // The number of input vectors evaluated together by Evaluate.
+  static constexpr int64_t kLanes = 64;
+
+  static absl::StatusOr<std::unique_ptr<CompiledSimulator>> Create(
+      const rtl::Netlist* netlist, const rtl::Module* module);
+
+  // Evaluates the module on kLanes input vectors. `inputs` has one word per
+  // module input, in the order of Module::inputs(); bit i of a word is the
+  // value of that input in vector i. Returns one word per module output, in
+  // the order of Module::outputs().
+  absl::StatusOr<std::vector<uint64_t>> Evaluate(
+      absl::Span<const uint64_t> inputs);
+
+  // Evaluates a single input vector. Same interface as
+  // Interpreter::InterpretModule.
+  absl::StatusOr<absl::flat_hash_map<const rtl::NetRef, bool>>
+  InterpretModule(const absl::flat_hash_map<const rtl::NetRef, bool>& inputs);
+
+  // Switching activity recorded by EvaluateIncremental.
+  struct ActivityStats {
+    // The number of input vectors evaluated, not counting the first call,
+    // which establishes the initial state.
+    int64_t vector_count = 0;
+    // The number of cell output programs run.
+    int64_t evaluation_count = 0;
+    // The number of value changes of any net in any lane, between each
+    // vector and the previous one in the same lane.
+    int64_t toggle_count = 0;
+  };
+
+  // Event-driven variant of Evaluate for input vectors which differ little
+  // from the previous ones: only cell outputs in the fan-out of nets which
+  // changed since the previous call (in any lane) are re-evaluated. Only the
+  // low `lane_count` lanes contribute to the activity statistics.
+  absl::StatusOr<std::vector<uint64_t>> EvaluateIncremental(
+      absl::Span<const uint64_t> inputs, int64_t lane_count = kLanes);
+
+  const ActivityStats& activity() const { return activity_; }
+
+  // The fraction of nets switching per vector: toggles per vector, averaged
+  // over the module inputs and cell outputs.
+  double activity_factor() const;
+
+  // Returns the number of toggles recorded for the given net of the top-level
+  // module.
+  absl::StatusOr<int64_t> GetToggleCount(rtl::NetRef net) const;
+
+  // Clears the activity statistics. The state of the nets is kept.
+  void ResetActivity();
+
+  // The number of nets in the flattened module (including those of inlined
+  // submodule instances) and the number of cell outputs computed per
+  // evaluation.
+  int64_t net_count() const { return values_.size(); }
+  int64_t cell_output_count() const { return evaluations_.size(); }
+
+  // The number of levels of the levelized netlist: the length of the longest
+  // path of cells from a module input or constant to a net.
+  int64_t level_count() const { return level_count_; }
+
+ private:
+  enum class Opcode : uint8_t { kLoad, kZero, kOne, kNot, kAnd, kOr, kXor };
+
+  struct Instruction {
+    Opcode opcode;
+    // For kLoad, the index of the net whose value is pushed.
+    int64_t net;
+  };
+
+  // The computation of the value of one net driven by a cell output.
+  struct Evaluation {
+    // Range of the program in instructions_.
+    int64_t begin;
+    int64_t end;
+    // The (deduplicated) nets which the program loads.
+    std::vector<int64_t> input_nets;
+    int64_t output_net;
+    int64_t level;
+  };
+
+  CompiledSimulator() = default;
+
+  // Allocates a net in the flattened module for the given net of the module
+  // or of a submodule.
+  int64_t NewNet(rtl::NetRef ref);
+
+  // Compiles the cells of `module` into evaluations. `nets` maps each net of
+  // the module to its index in the flattened module.
+  absl::Status CompileModule(
+      const rtl::Module* module,
+      const absl::flat_hash_map<rtl::NetRef, int64_t>& nets);
+  absl::Status CompileSubmoduleInstance(
+      const rtl::Cell& cell, const rtl::Module* submodule,
+      const absl::flat_hash_map<rtl::NetRef, int64_t>& nets);
+  absl::Status CompileCell(
+      const rtl::Cell& cell,
+      const absl::flat_hash_map<rtl::NetRef, int64_t>& nets);
+
+  // Appends the program for the given function of a cell to instructions_.
+  absl::Status CompileFunction(
+      const rtl::Cell& cell, const function::Ast& ast,
+      const absl::flat_hash_map<rtl::NetRef, int64_t>& nets,
+      std::vector<int64_t>* input_nets);
+  // Appends a sum-of-products program for the given internal pin of a cell
+  // with a (combinational) state table.
+  absl::Status CompileStateTable(
+      const rtl::Cell& cell, const std::string& pin_name,
+      const absl::flat_hash_map<rtl::NetRef, int64_t>& nets,
+      std::vector<int64_t>* input_nets);
+
+  // Orders the evaluations by level and lays out their programs in that
+  // order.
+  absl::Status Levelize();
+
+  // Runs the program of the given evaluation on values_.
+  uint64_t Run(const Evaluation& evaluation);
+
+  // Sets the value of a net during EvaluateIncremental, recording toggles in
+  // `mask` and scheduling the net's readers if it changed.
+  void Update(int64_t net, uint64_t value, uint64_t mask);
+
+  const rtl::Netlist* netlist_;
+  const rtl::Module* module_;
+
+  std::vector<Instruction> instructions_;
+  std::vector<Evaluation> evaluations_;
+  int64_t level_count_ = 0;
+
+  // Nets of the flattened module which hold module inputs and constants.
+  std::vector<int64_t> input_nets_;
+  std::vector<int64_t> output_nets_;
+  int64_t zero_net_;
+  int64_t one_net_;
+  // Sink for unused cell outputs; never evaluated.
+  int64_t dummy_net_;
+
+  // Value of each net, one bit per input vector, and the (sub)module net each
+  // was created for.
+  std::vector<uint64_t> values_;
+  std::vector<rtl::NetRef> net_refs_;
+  // Scratch stack for Run, sized for the deepest program.
+  std::vector<uint64_t> stack_;
+
+  // Nets of the top-level module, by index in the flattened module.
+  absl::flat_hash_map<rtl::NetRef, int64_t> top_nets_;
+
+  // Evaluations reading each net, as ranges of reader_indices_ delimited by
+  // reader_offsets_[net] and reader_offsets_[net + 1].
+  std::vector<int64_t> reader_offsets_;
+  std::vector<int64_t> reader_indices_;
+
+  // State of EvaluateIncremental: whether values_ holds the result of a
+  // previous evaluation, the evaluations scheduled at each level, and
+  // whether each evaluation is scheduled.
+  bool has_state_ = false;
+  std::vector<std::vector<int64_t>> scheduled_by_level_;
+  std::vector<bool> scheduled_;
+  ActivityStats activity_;
+  std::vector<int64_t> toggle_counts_;
+
+  // Parsed cell functions, keyed by cell library entry and output pin name.
+  absl::flat_hash_map<std::pair<const CellLibraryEntry*, std::string>,
+                      function::Ast>
+      function_cache_;
+};
+
+}  // namespace netlist
+}  // namespace xls
+
+#endif  // XLS_NETLIST_COMPILED_SIMULATOR_H_
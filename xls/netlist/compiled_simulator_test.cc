@@ -0,0 +1,328 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/netlist/compiled_simulator.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/netlist/fake_cell_library.h"
+#include "xls/netlist/interpreter.h"
+#include "xls/netlist/netlist.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+// Returns input words for Evaluate which, across the lanes, enumerate all
+// combinations of `input_count` inputs (repeating if there are fewer
+// combinations than lanes).
+std::vector<uint64_t> ExhaustiveInputs(int64_t input_count) {
+  std::vector<uint64_t> words(input_count, 0);
+  for (int64_t lane = 0; lane < CompiledSimulator::kLanes; ++lane) {
+    for (int64_t i = 0; i < input_count; ++i) {
+      words[i] |= static_cast<uint64_t>((lane >> i) & 1) << lane;
+    }
+  }
+  return words;
+}
+
+// Checks that the compiled simulator agrees with the interpreter on every
+// combination of inputs of the given module, both one vector at a time and
+// with all lanes at once.
+void ExpectMatchesInterpreter(rtl::Netlist* netlist,
+                              const rtl::Module* module) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> simulator,
+                           CompiledSimulator::Create(netlist, module));
+  Interpreter interpreter(netlist);
+  int64_t input_count = module->inputs().size();
+  ASSERT_LE(input_count, 6);
+  std::vector<uint64_t> words = ExhaustiveInputs(input_count);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> output_words,
+                           simulator->Evaluate(words));
+  ASSERT_EQ(output_words.size(), module->outputs().size());
+
+  using OutputT = absl::flat_hash_map<const rtl::NetRef, bool>;
+  for (int64_t lane = 0; lane < (int64_t{1} << input_count); ++lane) {
+    absl::flat_hash_map<const rtl::NetRef, bool> inputs;
+    for (int64_t i = 0; i < input_count; ++i) {
+      inputs[module->inputs()[i]] = (lane >> i) & 1;
+    }
+    XLS_ASSERT_OK_AND_ASSIGN(OutputT expected,
+                             interpreter.InterpretModule(module, inputs));
+    XLS_ASSERT_OK_AND_ASSIGN(OutputT actual,
+                             simulator->InterpretModule(inputs));
+    EXPECT_EQ(actual, expected) << "lane " << lane;
+    for (int64_t i = 0; i < module->outputs().size(); ++i) {
+      EXPECT_EQ((output_words[i] >> lane) & 1,
+                expected[module->outputs()[i]])
+          << "lane " << lane << ", output " << i;
+    }
+  }
+}
+
+TEST(CompiledSimulatorTest, Tree) {
+  std::string module_text = R"(
+module main (i0, i1, i2, i3, o0);
+  input i0, i1, i2, i3;
+  output o0;
+  wire and_out, or_out;
+
+  AND and0( .A(i0), .B(i1), .Z(and_out) );
+  OR or0( .A(i2), .B(i3), .Z(or_out) );
+  XOR xor0( .A(and_out), .B(or_out), .Z(o0) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> simulator,
+                           CompiledSimulator::Create(netlist.get(), module));
+  EXPECT_EQ(simulator->cell_output_count(), 3);
+  EXPECT_EQ(simulator->level_count(), 2);
+
+  // Evaluate 64 vectors at once and check each lane against the expected
+  // function.
+  std::vector<uint64_t> words = ExhaustiveInputs(4);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> outputs,
+                           simulator->Evaluate(words));
+  ASSERT_EQ(outputs.size(), 1);
+  EXPECT_EQ(outputs[0], (words[0] & words[1]) ^ (words[2] | words[3]));
+
+  ExpectMatchesInterpreter(netlist.get(), module);
+}
+
+TEST(CompiledSimulatorTest, Submodules) {
+  std::string module_text = R"(
+module submodule_0 (i2_0, i2_1, o2_0);
+  input i2_0, i2_1;
+  output o2_0;
+
+  AND and0( .A(i2_0), .B(i2_1), .Z(o2_0) );
+endmodule
+
+module submodule_1 (i2_2, i2_3, o2_1);
+  input i2_2, i2_3;
+  output o2_1;
+
+  OR or0( .A(i2_2), .B(i2_3), .Z(o2_1) );
+endmodule
+
+module submodule_2 (i1_0, i1_1, i1_2, i1_3, o1_0);
+  input i1_0, i1_1, i1_2, i1_3;
+  output o1_0;
+  wire res0, res1;
+
+  submodule_0 and0 ( .i2_0(i1_0), .i2_1(i1_1), .o2_0(res0) );
+  submodule_1 or0 ( .i2_2(i1_2), .i2_3(i1_3), .o2_1(res1) );
+  XOR xor0 ( .A(res0), .B(res1), .Z(o1_0) );
+endmodule
+
+module main (i0, i1, i2, i3, o0, o1);
+  input i0, i1, i2, i3;
+  output o0, o1;
+
+  submodule_2 bleh( .i1_0(i0), .i1_1(i1), .i1_2(i2), .i1_3(i3), .o1_0(o0) );
+  submodule_0 blah( .i2_0(i3), .i2_1(i0), .o2_0(o1) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  ExpectMatchesInterpreter(netlist.get(), module);
+
+  // Each instance of a submodule is flattened into its own cells.
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> simulator,
+                           CompiledSimulator::Create(netlist.get(), module));
+  EXPECT_EQ(simulator->cell_output_count(), 4);
+}
+
+TEST(CompiledSimulatorTest, StateTables) {
+  std::string module_text = R"(
+module main(i0, i1, i2, i3, o0);
+  input i0, i1, i2, i3;
+  output o0;
+  wire and0_out, and1_out;
+
+  AND and0 ( .A(i0), .B(i1), .Z(and0_out) );
+  STATETABLE_AND and1 (.A(i2), .B(i3), .Z(and1_out) );
+  AND and2 ( .A(and0_out), .B(and1_out), .Z(o0) );
+endmodule
+  )";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  ExpectMatchesInterpreter(netlist.get(), module);
+}
+
+TEST(CompiledSimulatorTest, IncrementalEvaluation) {
+  std::string module_text = R"(
+module main (i0, i1, i2, i3, o0);
+  input i0, i1, i2, i3;
+  output o0;
+  wire and_out, or_out;
+
+  AND and0( .A(i0), .B(i1), .Z(and_out) );
+  OR or0( .A(i2), .B(i3), .Z(or_out) );
+  XOR xor0( .A(and_out), .B(or_out), .Z(o0) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> simulator,
+                           CompiledSimulator::Create(netlist.get(), module));
+
+  // The first call evaluates everything and records no activity.
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> outputs,
+                           simulator->EvaluateIncremental({0, 0, 0, 0}));
+  EXPECT_EQ(outputs[0], 0);
+  EXPECT_EQ(simulator->activity().evaluation_count, 3);
+  EXPECT_EQ(simulator->activity().toggle_count, 0);
+
+  // Changing i2 only re-evaluates the OR and the XOR.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      outputs, simulator->EvaluateIncremental({0, 0, ~uint64_t{0}, 0}));
+  EXPECT_EQ(outputs[0], ~uint64_t{0});
+  EXPECT_EQ(simulator->activity().evaluation_count, 5);
+  EXPECT_EQ(simulator->activity().vector_count, CompiledSimulator::kLanes);
+  EXPECT_EQ(simulator->activity().toggle_count,
+            3 * CompiledSimulator::kLanes);
+  XLS_ASSERT_OK_AND_ASSIGN(rtl::NetRef or_out, module->ResolveNet("or_out"));
+  XLS_ASSERT_OK_AND_ASSIGN(rtl::NetRef and_out,
+                           module->ResolveNet("and_out"));
+  EXPECT_THAT(simulator->GetToggleCount(or_out),
+              IsOkAndHolds(CompiledSimulator::kLanes));
+  EXPECT_THAT(simulator->GetToggleCount(and_out), IsOkAndHolds(0));
+  // Three of the seven inputs and cell outputs switched on every vector.
+  EXPECT_DOUBLE_EQ(simulator->activity_factor(), 3.0 / 7.0);
+
+  // Unchanged inputs evaluate nothing.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      outputs, simulator->EvaluateIncremental({0, 0, ~uint64_t{0}, 0}));
+  EXPECT_EQ(simulator->activity().evaluation_count, 5);
+
+  // Setting i0 in lane 1 and i1 in all lanes changes the AND output in lane
+  // 1, which flips the XOR in that lane. Only toggles in lane 0 are counted.
+  std::vector<uint64_t> inputs = {2, ~uint64_t{0}, ~uint64_t{0}, 0};
+  XLS_ASSERT_OK_AND_ASSIGN(
+      outputs, simulator->EvaluateIncremental(inputs, /*lane_count=*/1));
+  EXPECT_EQ(outputs[0], ~uint64_t{2});
+  EXPECT_EQ(simulator->activity().evaluation_count, 7);
+  EXPECT_EQ(simulator->activity().toggle_count,
+            3 * CompiledSimulator::kLanes + 1);
+
+  simulator->ResetActivity();
+  EXPECT_EQ(simulator->activity().toggle_count, 0);
+  EXPECT_THAT(simulator->GetToggleCount(or_out), IsOkAndHolds(0));
+}
+
+TEST(CompiledSimulatorTest, IncrementalMatchesFullEvaluation) {
+  std::string module_text = R"(
+module submodule_0 (i2_0, i2_1, o2_0);
+  input i2_0, i2_1;
+  output o2_0;
+
+  AND and0( .A(i2_0), .B(i2_1), .Z(o2_0) );
+endmodule
+
+module main(i0, i1, i2, i3, o0, o1);
+  input i0, i1, i2, i3;
+  output o0, o1;
+  wire and0_out, and1_out;
+
+  submodule_0 and0 ( .i2_0(i0), .i2_1(i1), .o2_0(and0_out) );
+  STATETABLE_AND and1 (.A(i2), .B(i3), .Z(and1_out) );
+  OR or0 ( .A(and0_out), .B(and1_out), .Z(o0) );
+  XOR xor0 ( .A(o0), .B(i3), .Z(o1) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> incremental,
+                           CompiledSimulator::Create(netlist.get(), module));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> full,
+                           CompiledSimulator::Create(netlist.get(), module));
+
+  // Flip a few bits of one input at a time.
+  std::vector<uint64_t> inputs = ExhaustiveInputs(4);
+  uint64_t state = 0x9e3779b97f4a7c15;
+  for (int64_t step = 0; step < 32; ++step) {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    inputs[step % inputs.size()] ^= state >> 40;
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> expected,
+                             full->Evaluate(inputs));
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> actual,
+                             incremental->EvaluateIncremental(inputs));
+    EXPECT_EQ(actual, expected) << "step " << step;
+  }
+}
+
+TEST(CompiledSimulatorTest, RejectsBadInputs) {
+  std::string module_text = R"(
+module main (i0, i1, o0);
+  input i0, i1;
+  output o0;
+
+  AND and0( .A(i0), .B(i1), .Z(o0) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<CompiledSimulator> simulator,
+                           CompiledSimulator::Create(netlist.get(), module));
+  EXPECT_FALSE(simulator->Evaluate({1}).ok());
+
+  absl::flat_hash_map<const rtl::NetRef, bool> inputs;
+  inputs[module->inputs()[0]] = true;
+  EXPECT_THAT(simulator->InterpretModule(inputs).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("No value given for input")));
+}
+
+}  // namespace
+}  // namespace netlist
+}  // namespace xls
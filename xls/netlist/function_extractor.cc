@@ -290,6 +290,22 @@ absl::StatusOr<CellLibraryProto> ExtractFunctions(
   return proto;
 }
 
+absl::StatusOr<CellLibraryProto> ExtractFunctions(
+    const cell_lib::LibraryIndex& index,
+    absl::Span<const std::string> cell_names) {
+  CellLibraryProto proto;
+  absl::flat_hash_set<std::string> seen;
+  for (const std::string& name : cell_names) {
+    if (!index.Contains(name) || !seen.insert(name).second) {
+      continue;
+    }
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<cell_lib::Block> cell,
+                         index.ParseCell(name));
+    XLS_RETURN_IF_ERROR(ExtractFromCell(*cell, proto.add_entries()));
+  }
+  return proto;
+}
+
 }  // namespace function
 }  // namespace netlist
 }  // namespace xls
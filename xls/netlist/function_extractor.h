@@ -18,6 +18,7 @@
 #include <string>
 
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/netlist/lib_parser.h"
 #include "xls/netlist/netlist.pb.h"
 
@@ -31,6 +32,13 @@ namespace function {
 // logical operation of the cell or pin (in the case of multiple output pins).
 absl::StatusOr<CellLibraryProto> ExtractFunctions(cell_lib::CharStream* stream);
 
+// As above, but extracts only the named cells from an indexed library; only the
+// groups of those cells are parsed. Names which are not cells of the library
+// (e.g., modules defined in a netlist) are ignored.
+absl::StatusOr<CellLibraryProto> ExtractFunctions(
+    const cell_lib::LibraryIndex& index,
+    absl::Span<const std::string> cell_names);
+
 }  // namespace function
 }  // namespace netlist
 }  // namespace xls
@@ -148,6 +148,94 @@ Interpreter::InterpretModule(
   return outputs;
 }
 
+absl::StatusOr<absl::flat_hash_map<const rtl::NetRef, bool>>
+Interpreter::InterpretPartition(
+    const rtl::Module* module, const rtl::NetlistPartition& partition,
+    const absl::flat_hash_map<const rtl::NetRef, bool>& inputs) {
+  absl::flat_hash_map<const rtl::NetRef, bool> processed_wires;
+  for (const rtl::NetRef input : partition.inputs) {
+    auto it = inputs.find(input);
+    if (it == inputs.end()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "No value given for input net %s of partition", input->name()));
+    }
+    processed_wires[input] = it->second;
+  }
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef net_0, module->ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef net_1, module->ResolveNumber(1));
+  processed_wires[net_0] = false;
+  processed_wires[net_1] = true;
+
+  // The cells are in topological order, so the inputs of each are known by the
+  // time it is reached.
+  for (const rtl::Cell* cell : partition.cells) {
+    XLS_RETURN_IF_ERROR(InterpretCell(*cell, &processed_wires));
+  }
+  return processed_wires;
+}
+
+absl::StatusOr<Interpreter::CycleResult> Interpreter::InterpretCycle(
+    const rtl::Module* module,
+    absl::Span<const rtl::NetlistPartition> partitions,
+    const absl::flat_hash_map<const rtl::NetRef, bool>& inputs,
+    const absl::flat_hash_map<const rtl::NetRef, bool>& state,
+    int64_t thread_count) {
+  // Within the cycle, the module inputs and flop outputs are the inputs of
+  // every partition.
+  absl::flat_hash_map<const rtl::NetRef, bool> boundary = inputs;
+  boundary.insert(state.begin(), state.end());
+
+  std::vector<CycleResult> results(partitions.size());
+  XLS_RETURN_IF_ERROR(rtl::RunOnPartitions(
+      partitions, thread_count,
+      [&](int64_t index, const rtl::NetlistPartition& partition)
+          -> absl::Status {
+        XLS_ASSIGN_OR_RETURN(auto values,
+                             InterpretPartition(module, partition, boundary));
+        CycleResult& result = results[index];
+        for (const rtl::NetRef output : partition.outputs) {
+          result.outputs[output] = values.at(output);
+        }
+        // Evaluate each flop on its own so its output keeps its current value
+        // for the cells of the partition.
+        for (const rtl::Cell* flop : partition.terminating_flops) {
+          absl::flat_hash_map<const rtl::NetRef, bool> flop_wires;
+          for (const auto& input : flop->inputs()) {
+            flop_wires[input.netref] = values.at(input.netref);
+          }
+          XLS_RETURN_IF_ERROR(InterpretCell(*flop, &flop_wires));
+          for (const auto& output : flop->outputs()) {
+            if (output.netref != module->GetDummyRef()) {
+              result.next_state[output.netref] = flop_wires.at(output.netref);
+            }
+          }
+        }
+        return absl::OkStatus();
+      }));
+
+  // Stitch the partitions together. Module outputs not driven by any
+  // partition's cells come straight from a module input or flop.
+  CycleResult cycle;
+  absl::flat_hash_map<const rtl::NetRef, bool> driven;
+  for (CycleResult& result : results) {
+    driven.insert(result.outputs.begin(), result.outputs.end());
+    cycle.next_state.insert(result.next_state.begin(),
+                            result.next_state.end());
+  }
+  for (const rtl::NetRef output : module->outputs()) {
+    auto it = driven.find(output);
+    if (it == driven.end()) {
+      it = boundary.find(output);
+      if (it == boundary.end()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "No value for module output %s", output->name()));
+      }
+    }
+    cycle.outputs[output] = it->second;
+  }
+  return cycle;
+}
+
 absl::Status Interpreter::InterpretCell(
     const rtl::Cell& cell,
     absl::flat_hash_map<const rtl::NetRef, bool>* processed_wires) {
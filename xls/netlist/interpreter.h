@@ -24,6 +24,7 @@
 #include "xls/ir/value.h"
 #include "xls/netlist/function_parser.h"
 #include "xls/netlist/netlist.h"
+#include "xls/netlist/netlist_partition.h"
 
 namespace xls {
 namespace netlist {
@@ -44,6 +45,35 @@ class Interpreter {
       const absl::flat_hash_map<const rtl::NetRef, bool>& inputs,
       absl::Span<const std::string> dump_cells = {});
 
+  // Interprets the combinational cells of a partition of the given module (see
+  // netlist_partition.h). "inputs" must hold the values of the partition's
+  // input nets. Returns the values of the partition's inputs and of the nets
+  // driven by its cells.
+  absl::StatusOr<absl::flat_hash_map<const rtl::NetRef, bool>>
+  InterpretPartition(
+      const rtl::Module* module, const rtl::NetlistPartition& partition,
+      const absl::flat_hash_map<const rtl::NetRef, bool>& inputs);
+
+  // The values of a sequential module in a clock cycle.
+  struct CycleResult {
+    // The values of the module outputs during the cycle.
+    absl::flat_hash_map<const rtl::NetRef, bool> outputs;
+
+    // The value of each flop output net in the next cycle.
+    absl::flat_hash_map<const rtl::NetRef, bool> next_state;
+  };
+
+  // Interprets one clock cycle of the given module, split into "partitions" by
+  // rtl::PartitionModule, given the values of the module inputs and the current
+  // value of each flop output net ("state"). The partitions are interpreted
+  // independently on up to "thread_count" threads and stitched at the flops.
+  absl::StatusOr<CycleResult> InterpretCycle(
+      const rtl::Module* module,
+      absl::Span<const rtl::NetlistPartition> partitions,
+      const absl::flat_hash_map<const rtl::NetRef, bool>& inputs,
+      const absl::flat_hash_map<const rtl::NetRef, bool>& state,
+      int64_t thread_count = 1);
+
  private:
   // Returns true if the specified NetRef is an output of the given cell.
   bool IsCellOutput(const rtl::Cell& cell, const rtl::NetRef ref);
@@ -14,7 +14,10 @@
 
 #include "xls/netlist/lib_parser.h"
 
+#include <algorithm>
+
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_join.h"
 #include "xls/common/logging/logging.h"
 
@@ -373,6 +376,109 @@ absl::StatusOr<std::unique_ptr<Block>> Parser::ParseBlock(
   return block;
 }
 
+/* static */ absl::StatusOr<LibraryIndex> LibraryIndex::Create(
+    absl::string_view text) {
+  LibraryIndex index(text);
+  auto is_identifier_char = [](char c) {
+    return std::isalnum(c) || c == '_';
+  };
+  auto error = [&](int64_t offset, absl::string_view message) {
+    int64_t lineno = std::count(text.begin(), text.begin() + offset, '\n');
+    return absl::InvalidArgumentError(
+        absl::StrFormat("%s @ line %d", message, lineno + 1));
+  };
+
+  // Nesting depth of braces; the library group itself is at depth 1.
+  int64_t depth = 0;
+  // Start offset and name of the cell group being scanned, if any.
+  int64_t cell_start = -1;
+  std::string cell_name;
+  int64_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+      int64_t end = text.find("*/", i + 2);
+      i = end == absl::string_view::npos ? text.size() : end + 2;
+    } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+      int64_t end = text.find('\n', i + 2);
+      i = end == absl::string_view::npos ? text.size() : end + 1;
+    } else if (c == '"') {
+      int64_t end = text.find('"', i + 1);
+      if (end == absl::string_view::npos) {
+        return error(i, "Unexpected end-of-file in string");
+      }
+      i = end + 1;
+    } else if (c == '{') {
+      ++depth;
+      ++i;
+    } else if (c == '}') {
+      if (depth == 0) {
+        return error(i, "Unbalanced '}'");
+      }
+      --depth;
+      ++i;
+      if (depth == 1 && cell_start >= 0) {
+        auto [it, inserted] = index.cells_.emplace(
+            std::move(cell_name), std::make_pair(cell_start, i - cell_start));
+        if (!inserted) {
+          return error(cell_start,
+                       absl::StrCat("Duplicate cell group: ", it->first));
+        }
+        cell_start = -1;
+        cell_name.clear();
+      }
+    } else if (std::isalpha(c)) {
+      int64_t start = i;
+      while (i < text.size() && is_identifier_char(text[i])) {
+        ++i;
+      }
+      if (depth != 1 || text.substr(start, i - start) != "cell") {
+        continue;
+      }
+      int64_t open = text.find('(', i);
+      int64_t close =
+          open == absl::string_view::npos ? open : text.find(')', open);
+      if (close == absl::string_view::npos) {
+        return error(start, "Expected parenthesized cell name");
+      }
+      absl::string_view name = absl::StripAsciiWhitespace(
+          text.substr(open + 1, close - open - 1));
+      if (name.size() >= 2 && name.front() == '"' && name.back() == '"') {
+        name = name.substr(1, name.size() - 2);
+      }
+      cell_start = start;
+      cell_name = std::string(name);
+      i = close + 1;
+    } else {
+      ++i;
+    }
+  }
+  if (depth != 0) {
+    return error(text.size(), "Unexpected end-of-file in group");
+  }
+  return index;
+}
+
+absl::StatusOr<absl::string_view> LibraryIndex::GetCellText(
+    absl::string_view cell_name) const {
+  auto it = cells_.find(cell_name);
+  if (it == cells_.end()) {
+    return absl::NotFoundError(
+        absl::StrCat("Cell not found in library: ", cell_name));
+  }
+  return text_.substr(it->second.first, it->second.second);
+}
+
+absl::StatusOr<std::unique_ptr<Block>> LibraryIndex::ParseCell(
+    absl::string_view cell_name) const {
+  XLS_ASSIGN_OR_RETURN(absl::string_view cell_text, GetCellText(cell_name));
+  XLS_ASSIGN_OR_RETURN(CharStream stream,
+                       CharStream::FromText(std::string(cell_text)));
+  Scanner scanner(&stream);
+  Parser parser(&scanner);
+  return parser.ParseCell();
+}
+
 }  // namespace cell_lib
 }  // namespace netlist
 }  // namespace xls
@@ -23,6 +23,7 @@
 #include <fstream>
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -370,6 +371,12 @@ class Parser {
     return ParseBlock("library");
   }
 
+  // Parses a single "cell" group, e.g. one extracted by LibraryIndex.
+  absl::StatusOr<std::unique_ptr<Block>> ParseCell() {
+    XLS_RETURN_IF_ERROR(DropIdentifierOrError("cell"));
+    return ParseBlock("cell");
+  }
+
  private:
   absl::StatusOr<bool> TryDropToken(TokenKind target, Pos* pos = nullptr);
   absl::Status DropTokenOrError(TokenKind kind);
@@ -411,6 +418,37 @@ class Parser {
   absl::optional<absl::flat_hash_set<std::string>> kind_allowlist_;
 };
 
+// Index of the "cell" groups at the top level of a library, built by a single
+// pass over the text which only tracks comments, strings and brace nesting.
+// Individual cells can then be parsed without tokenizing the rest of the
+// library, which is mostly timing and power tables for cells a given netlist
+// does not use.
+class LibraryIndex {
+ public:
+  // Indexes the given library text, which must outlive the index.
+  static absl::StatusOr<LibraryIndex> Create(absl::string_view text);
+
+  bool Contains(absl::string_view cell_name) const {
+    return cells_.contains(cell_name);
+  }
+  int64_t cell_count() const { return cells_.size(); }
+
+  // Returns the text of the "cell" group with the given name.
+  absl::StatusOr<absl::string_view> GetCellText(
+      absl::string_view cell_name) const;
+
+  // Parses the "cell" group with the given name.
+  absl::StatusOr<std::unique_ptr<Block>> ParseCell(
+      absl::string_view cell_name) const;
+
+ private:
+  explicit LibraryIndex(absl::string_view text) : text_(text) {}
+
+  absl::string_view text_;
+  // Offset and length in text_ of each cell group, by cell name.
+  absl::flat_hash_map<std::string, std::pair<int64_t, int64_t>> cells_;
+};
+
 }  // namespace cell_lib
 }  // namespace netlist
 }  // namespace xls
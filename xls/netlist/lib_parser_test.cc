@@ -18,6 +18,7 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "xls/common/status/matchers.h"
 
@@ -159,6 +160,41 @@ library (foo) {
             "))");
 }
 
+TEST(LibParserTest, LibraryIndex) {
+  std::string text = R"lib(library (foo) {
+  /* cell (commented) { } */
+  comment: "cell (in_string) { }";
+  cell (and2) {
+    pin (o) {
+      function: "(a*b)";
+      timing () { values ("1, 2", "3, 4"); }
+    }
+  }
+  cell ("or2") { pin (o) { function: "a+b"; } }
+}
+)lib";
+  XLS_ASSERT_OK_AND_ASSIGN(LibraryIndex index, LibraryIndex::Create(text));
+  EXPECT_EQ(index.cell_count(), 2);
+  EXPECT_TRUE(index.Contains("and2"));
+  EXPECT_TRUE(index.Contains("or2"));
+  EXPECT_FALSE(index.Contains("commented"));
+  EXPECT_FALSE(index.Contains("in_string"));
+
+  XLS_ASSERT_OK_AND_ASSIGN(absl::string_view or2_text,
+                           index.GetCellText("or2"));
+  EXPECT_EQ(or2_text, R"(cell ("or2") { pin (o) { function: "a+b"; } })");
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Block> or2, index.ParseCell("or2"));
+  EXPECT_EQ(or2->ToString(),
+            "(block cell (or2) ((block pin (o) ((function \"a+b\")))))");
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Block> and2,
+                           index.ParseCell("and2"));
+  EXPECT_EQ(and2->GetSubBlocks("pin").size(), 1);
+  EXPECT_THAT(index.ParseCell("xor2").status(),
+              status_testing::StatusIs(absl::StatusCode::kNotFound));
+
+  EXPECT_FALSE(LibraryIndex::Create("library (foo) { cell (a) {").ok());
+}
+
 }  // namespace
 }  // namespace cell_lib
 }  // namespace netlist
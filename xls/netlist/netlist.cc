@@ -63,45 +63,44 @@ absl::StatusOr<NetRef> Module::ResolveNumber(int64_t number) const {
 }
 
 absl::StatusOr<NetRef> Module::ResolveNet(absl::string_view name) const {
-  for (const auto& net : nets_) {
-    if (net->name() == name) {
-      return net.get();
-    }
+  auto it = nets_by_name_.find(name);
+  if (it != nets_by_name_.end()) {
+    return it->second;
   }
 
   return absl::NotFoundError(absl::StrCat("Could not find net: ", name));
 }
 
 absl::StatusOr<Cell*> Module::ResolveCell(absl::string_view name) const {
-  for (const auto& cell : cells_) {
-    if (cell->name() == name) {
-      return cell.get();
-    }
+  auto it = cells_by_name_.find(name);
+  if (it != cells_by_name_.end()) {
+    return it->second;
   }
   return absl::NotFoundError(
       absl::StrCat("Could not find cell with name: ", name));
 }
 
 absl::StatusOr<Cell*> Module::AddCell(Cell cell) {
-  auto status_or_cell = ResolveCell(cell.name());
-  if (status_or_cell.status().ok()) {
+  if (cells_by_name_.contains(cell.name())) {
     return absl::InvalidArgumentError(
         absl::StrCat("Module already has a cell with name: ", cell.name()));
   }
 
-  cells_.push_back(absl::make_unique<Cell>(cell));
-  return cells_.back().get();
+  cells_.push_back(absl::make_unique<Cell>(std::move(cell)));
+  Cell* cell_ptr = cells_.back().get();
+  cells_by_name_[cell_ptr->name()] = cell_ptr;
+  return cell_ptr;
 }
 
 absl::Status Module::AddNetDecl(NetDeclKind kind, absl::string_view name) {
-  auto status_or_net = ResolveNet(name);
-  if (status_or_net.status().ok()) {
+  if (nets_by_name_.contains(name)) {
     return absl::InvalidArgumentError(
         absl::StrCat("Module already has a net/wire decl with name: ", name));
   }
 
   nets_.emplace_back(absl::make_unique<NetDef>(name));
   NetRef ref = nets_.back().get();
+  nets_by_name_[ref->name()] = ref;
   switch (kind) {
     case NetDeclKind::kInput:
       inputs_.push_back(ref);
@@ -183,6 +183,10 @@ class Module {
   std::vector<NetRef> wires_;
   std::vector<std::unique_ptr<NetDef>> nets_;
   std::vector<std::unique_ptr<Cell>> cells_;
+  // Nets and cells by name. The keys refer to the names held by the (heap
+  // allocated) nets and cells themselves.
+  absl::flat_hash_map<absl::string_view, NetRef> nets_by_name_;
+  absl::flat_hash_map<absl::string_view, Cell*> cells_by_name_;
   NetRef zero_;
   NetRef one_;
   NetRef dummy_;
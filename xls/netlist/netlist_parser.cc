@@ -14,12 +14,15 @@
 
 #include "xls/netlist/netlist_parser.h"
 
+#include <algorithm>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
 #include "absl/types/variant.h"
+#include "xls/common/file/mapped_file.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
@@ -179,9 +182,7 @@ absl::StatusOr<Token> Scanner::Pop() {
   return result;
 }
 
-absl::StatusOr<Token> Scanner::ScanNumber(char startc, Pos pos) {
-  std::string chars;
-  chars.push_back(startc);
+absl::StatusOr<Token> Scanner::ScanNumber(int64_t start, Pos pos) {
   bool seen_separator = false;
   auto is_hex_char = [](char c) {
     return absl::ascii_isxdigit(absl::ascii_toupper(c));
@@ -196,20 +197,19 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, Pos pos) {
   while (!AtEofInternal()) {
     char c = PeekCharOrDie();
     if (is_hex_char(c)) {
-      chars.push_back(PopCharOrDie());
+      DropCharOrDie();
     } else if (c == '\'' && !seen_separator) {
       // If we see a base separator, pop it, then the optional signedness
       // indicator (s|S), then the base indicator (d|b|o|h|D|B|O|H).
-      chars.push_back(PopCharOrDie());
+      DropCharOrDie();
       XLS_RET_CHECK(!AtEofInternal()) << "Saw EOF while scanning number base!";
-      chars.push_back(PopCharOrDie());
-      if (chars.back() == 's' || chars.back() == 'S') {
+      c = PopCharOrDie();
+      if (c == 's' || c == 'S') {
         XLS_RET_CHECK(!AtEofInternal())
             << "Saw EOF while scanning number base (post-signedness)!";
-        chars.push_back(PopCharOrDie());
+        c = PopCharOrDie();
       }
 
-      c = chars.back();
       XLS_RET_CHECK(c == 'd' || c == 'b' || c == 'o' || c == 'h' || c == 'D' ||
                     c == 'B' || c == 'O' || c == 'H')
           << "Expected [dbohDBOH], saw '" << c << "'";
@@ -220,23 +220,22 @@ absl::StatusOr<Token> Scanner::ScanNumber(char startc, Pos pos) {
     }
   }
 
-  return Token{TokenKind::kNumber, pos, chars};
+  return Token{TokenKind::kNumber, pos, text_.substr(start, index_ - start)};
 }
 
-absl::StatusOr<Token> Scanner::ScanName(char startc, Pos pos, bool is_escaped) {
-  std::string chars;
-  chars.push_back(startc);
+absl::StatusOr<Token> Scanner::ScanName(int64_t start, Pos pos,
+                                        bool is_escaped) {
   while (!AtEofInternal()) {
     char c = PeekCharOrDie();
     bool is_whitespace = c == ' ' || c == '\t' || c == '\n';
     if ((is_escaped && !is_whitespace) || isalpha(c) || isdigit(c) ||
         c == '_') {
-      chars.push_back(PopCharOrDie());
+      DropCharOrDie();
     } else {
       break;
     }
   }
-  return Token{TokenKind::kName, pos, chars};
+  return Token{TokenKind::kName, pos, text_.substr(start, index_ - start)};
 }
 
 absl::StatusOr<Token> Scanner::PeekInternal() {
@@ -245,6 +244,7 @@ absl::StatusOr<Token> Scanner::PeekInternal() {
     return absl::FailedPreconditionError("Scan has reached EOF.");
   }
   auto pos = GetPos();
+  int64_t start = index_;
   char c = PopCharOrDie();
   switch (c) {
     case '(':
@@ -275,10 +275,10 @@ absl::StatusOr<Token> Scanner::PeekInternal() {
       [[fallthrough]];
     default:
       if (isdigit(c)) {
-        return ScanNumber(c, pos);
+        return ScanNumber(start, pos);
       }
       if (isalpha(c) || c == '\\') {
-        return ScanName(c, pos, c == '\\');
+        return ScanName(start, pos, c == '\\');
       }
       return absl::UnimplementedError(absl::StrFormat(
           "Unsupported character: '%c' (%#x) @ %s", c, c, pos.ToHumanString()));
@@ -288,7 +288,7 @@ absl::StatusOr<Token> Scanner::PeekInternal() {
 absl::StatusOr<std::string> Parser::PopNameOrError() {
   XLS_ASSIGN_OR_RETURN(Token token, scanner_->Pop());
   if (token.kind == TokenKind::kName) {
-    return token.value;
+    return std::string(token.value);
   }
   return absl::InvalidArgumentError("Expected name token; got: " +
                                     token.ToString());
@@ -335,8 +335,8 @@ absl::StatusOr<int64_t> Parser::PopNumberOrError() {
     int64_t result;
     if (!absl::SimpleAtoi(token.value, &result)) {
       return absl::InternalError(
-          "Number token's value cannot be parsed as an int64_t: " +
-          token.value);
+          absl::StrCat("Number token's value cannot be parsed as an int64_t: ",
+                       token.value));
     }
     return result;
   }
@@ -349,7 +349,7 @@ Parser::PopNameOrNumberOrError() {
   TokenKind kind = scanner_->Peek()->kind;
   if (kind == TokenKind::kName) {
     XLS_ASSIGN_OR_RETURN(Token token, scanner_->Pop());
-    return token.value;
+    return std::string(token.value);
   } else if (kind == TokenKind::kNumber) {
     return PopNumberOrError();
   }
@@ -596,6 +596,60 @@ absl::StatusOr<std::unique_ptr<Netlist>> Parser::ParseNetlist(
   return std::move(netlist);
 }
 
+absl::StatusOr<std::vector<std::string>> Parser::ScanCellNames(
+    Scanner* scanner) {
+  absl::flat_hash_set<std::string> module_names;
+  absl::flat_hash_set<std::string> cell_names;
+  auto drop_statement = [&]() -> absl::Status {
+    while (true) {
+      XLS_ASSIGN_OR_RETURN(Token token, scanner->Pop());
+      if (token.kind == TokenKind::kSemicolon) {
+        return absl::OkStatus();
+      }
+    }
+  };
+  while (!scanner->AtEof()) {
+    XLS_ASSIGN_OR_RETURN(Token token, scanner->Pop());
+    if (token.kind != TokenKind::kName || token.value != "module") {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Want keyword 'module', got: %s", token.ToString()));
+    }
+    XLS_ASSIGN_OR_RETURN(Token name, scanner->Pop());
+    module_names.insert(std::string(name.value));
+    XLS_RETURN_IF_ERROR(drop_statement());
+    while (true) {
+      XLS_ASSIGN_OR_RETURN(Token statement, scanner->Pop());
+      if (statement.kind != TokenKind::kName) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Expected module statement; got: %s", statement.ToString()));
+      }
+      if (statement.value == "endmodule") {
+        break;
+      }
+      if (statement.value != "input" && statement.value != "output" &&
+          statement.value != "wire") {
+        cell_names.insert(std::string(statement.value));
+      }
+      XLS_RETURN_IF_ERROR(drop_statement());
+    }
+  }
+  std::vector<std::string> result;
+  for (const std::string& name : cell_names) {
+    if (!module_names.contains(name)) {
+      result.push_back(name);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+absl::StatusOr<std::unique_ptr<Netlist>> Parser::ParseNetlistFile(
+    CellLibrary* cell_library, const std::filesystem::path& path) {
+  XLS_ASSIGN_OR_RETURN(MappedFile file, MappedFile::Open(path));
+  Scanner scanner(file.contents());
+  return ParseNetlist(cell_library, &scanner);
+}
+
 }  // namespace rtl
 }  // namespace netlist
 }  // namespace xls
@@ -15,8 +15,11 @@
 #ifndef XLS_NETLIST_NETLIST_PARSER_H_
 #define XLS_NETLIST_NETLIST_PARSER_H_
 
+#include <filesystem>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "xls/netlist/netlist.h"
 
 namespace xls {
@@ -52,15 +55,18 @@ struct Pos {
 };
 
 // Represents a scanned token (that comes from scanning a character stream).
+// The value of name and number tokens refers to the scanned text, which must
+// outlive the token.
 struct Token {
   TokenKind kind;
   Pos pos;
-  std::string value;
+  absl::string_view value;
 
   std::string ToString() const;
 };
 
-// Token scanner for netlist files.
+// Token scanner for netlist files. Tokens are scanned on demand, one at a
+// time, so the text is never tokenized as a whole.
 class Scanner {
  public:
   explicit Scanner(absl::string_view text) : text_(text) {}
@@ -75,8 +81,10 @@ class Scanner {
   }
 
  private:
-  absl::StatusOr<Token> ScanName(char startc, Pos pos, bool is_escaped);
-  absl::StatusOr<Token> ScanNumber(char startc, Pos pos);
+  // Scan the remainder of a token whose first character, at `start`, has
+  // already been popped.
+  absl::StatusOr<Token> ScanName(int64_t start, Pos pos, bool is_escaped);
+  absl::StatusOr<Token> ScanNumber(int64_t start, Pos pos);
   absl::StatusOr<Token> PeekInternal();
 
   // Drops any characters that should not be converted to Tokens, including
@@ -112,6 +120,17 @@ class Parser {
   static absl::StatusOr<std::unique_ptr<Netlist>> ParseNetlist(
       CellLibrary* cell_library, Scanner* scanner);
 
+  // Parses the netlist file at the given path. The file is memory mapped and
+  // scanned in a single pass, so its text is never copied into memory.
+  static absl::StatusOr<std::unique_ptr<Netlist>> ParseNetlistFile(
+      CellLibrary* cell_library, const std::filesystem::path& path);
+
+  // Returns the names of the cells instantiated by the netlist, other than
+  // modules defined in the netlist itself, without resolving them against a
+  // cell library. Used to load only the required parts of a cell library.
+  static absl::StatusOr<std::vector<std::string>> ScanCellNames(
+      Scanner* scanner);
+
  private:
   explicit Parser(CellLibrary* cell_library, Scanner* scanner)
       : cell_library_(cell_library), scanner_(scanner) {}
@@ -19,7 +19,9 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/status/status.h"
 #include "absl/strings/substitute.h"
+#include "xls/common/file/temp_file.h"
 #include "xls/common/status/matchers.h"
 #include "xls/netlist/fake_cell_library.h"
 
@@ -243,6 +245,44 @@ endmodule
   EXPECT_EQ("<lut_0x8000>", lut_cell->cell_library_entry()->name());
 }
 
+TEST(NetlistParserTest, ParseNetlistFile) {
+  std::string netlist = R"(module main(a, z);
+  input a;
+  output z;
+  wire [1:0] w;
+  INV inv_0(.A(a), .ZN(w[0]));
+  INV inv_1(.A(w[0]), .ZN(z));
+endmodule)";
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(netlist, ".v"));
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> n,
+      Parser::ParseNetlistFile(&cell_library, temp_file.path()));
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, n->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef w0, m->ResolveNet("w[0]"));
+  EXPECT_EQ("w[0]", w0->name());
+  XLS_ASSERT_OK_AND_ASSIGN(Cell * inv_1, m->ResolveCell("inv_1"));
+  EXPECT_EQ(inv_1->inputs()[0].netref, w0);
+  EXPECT_THAT(m->ResolveNet("w[2]").status(),
+              status_testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(NetlistParserTest, TokensReferToText) {
+  std::string text = "INV \\foo.bar[0] 1'b1";
+  Scanner scanner(text);
+  XLS_ASSERT_OK_AND_ASSIGN(Token inv, scanner.Pop());
+  EXPECT_EQ(inv.value, "INV");
+  EXPECT_EQ(inv.value.data(), text.data());
+  XLS_ASSERT_OK_AND_ASSIGN(Token escaped, scanner.Pop());
+  EXPECT_EQ(escaped.kind, TokenKind::kName);
+  EXPECT_EQ(escaped.value, "\\foo.bar[0]");
+  XLS_ASSERT_OK_AND_ASSIGN(Token number, scanner.Pop());
+  EXPECT_EQ(number.kind, TokenKind::kNumber);
+  EXPECT_EQ(number.value, "1'b1");
+  EXPECT_TRUE(scanner.AtEof());
+}
+
 }  // namespace
 }  // namespace rtl
 }  // namespace netlist
@@ -0,0 +1,187 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/netlist/netlist_partition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/netlist/find_logic_clouds.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+namespace {
+
+bool NetNameLt(NetRef a, NetRef b) { return a->name() < b->name(); }
+
+// Builds the partition of the given cloud of "module".
+absl::StatusOr<NetlistPartition> MakePartition(const Module& module,
+                                               const Cluster& cluster) {
+  XLS_ASSIGN_OR_RETURN(NetRef zero, module.ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(NetRef one, module.ResolveNumber(1));
+  NetRef dummy = module.GetDummyRef();
+
+  absl::flat_hash_map<NetRef, Cell*> drivers;
+  for (const Cell* cell : cluster.other_cells()) {
+    for (const Cell::Pin& output : cell->outputs()) {
+      if (output.netref != dummy) {
+        drivers[output.netref] = const_cast<Cell*>(cell);
+      }
+    }
+  }
+
+  // Order the cells topologically, starting from those only reading nets
+  // driven outside the cloud; ties are broken by name.
+  absl::flat_hash_map<Cell*, int64_t> unsatisfied_inputs;
+  absl::flat_hash_map<Cell*, std::vector<Cell*>> users;
+  std::deque<Cell*> ready;
+  for (const Cell* const_cell : cluster.other_cells()) {
+    Cell* cell = const_cast<Cell*>(const_cell);
+    int64_t count = 0;
+    for (const Cell::Pin& input : cell->inputs()) {
+      auto it = drivers.find(input.netref);
+      if (it != drivers.end()) {
+        ++count;
+        users[it->second].push_back(cell);
+      }
+    }
+    unsatisfied_inputs[cell] = count;
+    if (count == 0) {
+      ready.push_back(cell);
+    }
+  }
+  NetlistPartition partition;
+  while (!ready.empty()) {
+    Cell* cell = ready.front();
+    ready.pop_front();
+    partition.cells.push_back(cell);
+    for (Cell* user : users[cell]) {
+      if (--unsatisfied_inputs[user] == 0) {
+        ready.push_back(user);
+      }
+    }
+  }
+  if (partition.cells.size() != cluster.other_cells().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Module %s has a combinational cycle through the logic cloud of "
+        "cell %s",
+        module.name(), cluster.other_cells().front()->name()));
+  }
+
+  for (const Cell* flop : cluster.terminating_flops()) {
+    partition.terminating_flops.push_back(const_cast<Cell*>(flop));
+  }
+
+  // Gather the nets crossing the boundary of the cloud.
+  absl::flat_hash_set<NetRef> inputs;
+  absl::flat_hash_set<NetRef> outputs;
+  absl::flat_hash_set<NetRef> module_outputs(module.outputs().begin(),
+                                             module.outputs().end());
+  auto add_input = [&](NetRef net) {
+    if (net != zero && net != one && !drivers.contains(net)) {
+      inputs.insert(net);
+    }
+  };
+  for (Cell* cell : partition.cells) {
+    for (const Cell::Pin& input : cell->inputs()) {
+      add_input(input.netref);
+    }
+    for (const Cell::Pin& output : cell->outputs()) {
+      if (module_outputs.contains(output.netref)) {
+        outputs.insert(output.netref);
+      }
+    }
+  }
+  for (Cell* flop : partition.terminating_flops) {
+    for (const Cell::Pin& input : flop->inputs()) {
+      add_input(input.netref);
+      if (drivers.contains(input.netref)) {
+        outputs.insert(input.netref);
+      }
+    }
+  }
+  partition.inputs.assign(inputs.begin(), inputs.end());
+  std::sort(partition.inputs.begin(), partition.inputs.end(), NetNameLt);
+  partition.outputs.assign(outputs.begin(), outputs.end());
+  std::sort(partition.outputs.begin(), partition.outputs.end(), NetNameLt);
+  return partition;
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<NetlistPartition>> PartitionModule(
+    const Module& module) {
+  std::vector<NetlistPartition> partitions;
+  for (const Cluster& cluster :
+       FindLogicClouds(module, /*include_vacuous=*/true)) {
+    XLS_ASSIGN_OR_RETURN(NetlistPartition partition,
+                         MakePartition(module, cluster));
+    partitions.push_back(std::move(partition));
+  }
+  return partitions;
+}
+
+absl::Status RunOnPartitions(
+    absl::Span<const NetlistPartition> partitions, int64_t thread_count,
+    const std::function<absl::Status(int64_t, const NetlistPartition&)>&
+        analysis) {
+  thread_count = std::min<int64_t>(thread_count, partitions.size());
+  if (thread_count <= 1) {
+    for (int64_t i = 0; i < partitions.size(); ++i) {
+      XLS_RETURN_IF_ERROR(analysis(i, partitions[i]));
+    }
+    return absl::OkStatus();
+  }
+
+  // Indices are claimed in increasing order, so once an analysis fails no
+  // later partition needs to be analyzed.
+  std::vector<absl::Status> statuses(partitions.size());
+  std::atomic<int64_t> next_index(0);
+  std::atomic<bool> failed(false);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t t = 0; t < thread_count; ++t) {
+      threads.push_back(absl::make_unique<Thread>([&]() {
+        for (int64_t i = next_index++; i < partitions.size() && !failed;
+             i = next_index++) {
+          statuses[i] = analysis(i, partitions[i]);
+          if (!statuses[i].ok()) {
+            failed = true;
+          }
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+  for (const absl::Status& status : statuses) {
+    XLS_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
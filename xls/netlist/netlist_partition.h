@@ -0,0 +1,74 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_NETLIST_NETLIST_PARTITION_H_
+#define XLS_NETLIST_NETLIST_PARTITION_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/netlist/netlist.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+
+// A logic cloud of a module (see FindLogicClouds) as an independent unit of
+// analysis. The combinational cells of a cloud only read module inputs,
+// constants, flop outputs and nets driven by the cloud itself, so within a
+// clock cycle the clouds can be analyzed independently of each other and the
+// results stitched together at the flops.
+struct NetlistPartition {
+  // The combinational cells of the cloud, in topological order.
+  std::vector<Cell*> cells;
+
+  // The flops whose inputs the cloud drives, sorted by name.
+  std::vector<Cell*> terminating_flops;
+
+  // The nets read by the cells or the terminating flops of the cloud which
+  // aren't driven by its cells: module inputs and flop outputs, sorted by name.
+  // Constants are excluded.
+  std::vector<NetRef> inputs;
+
+  // The nets driven by the cells of the cloud which are read by its
+  // terminating flops or are module outputs, sorted by name.
+  std::vector<NetRef> outputs;
+};
+
+// Partitions the module into its logic clouds. Every cell belongs to exactly
+// one partition; flops without input logic get partitions of their own.
+// Returns an error if the combinational logic has a cycle.
+absl::StatusOr<std::vector<NetlistPartition>> PartitionModule(
+    const Module& module);
+
+// Runs "analysis" on each of the given partitions, with its index, on up to
+// "thread_count" threads. Analyses of different partitions may run
+// concurrently, so "analysis" must be thread-safe; results are typically
+// written to a vector indexed by partition. Returns the error of the first
+// failing analysis in partition order.
+absl::Status RunOnPartitions(
+    absl::Span<const NetlistPartition> partitions, int64_t thread_count,
+    const std::function<absl::Status(int64_t, const NetlistPartition&)>&
+        analysis);
+
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
+
+#endif  // XLS_NETLIST_NETLIST_PARTITION_H_
@@ -0,0 +1,197 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/netlist/netlist_partition.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/status/matchers.h"
+#include "xls/netlist/fake_cell_library.h"
+#include "xls/netlist/interpreter.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+namespace {
+
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+// ai -> |inv_a| -> |dff_0| -> |inv_b| -> |dff_1| -> |inv_c| -> ao
+constexpr char kTwoFlops[] = R"(module main(clk, ai, ao);
+  input clk;
+  input ai;
+  output ao;
+  wire ain, a1, a1n, a2;
+
+  INV inv_a(.A(ai), .ZN(ain));
+  DFF dff_0(.D(ain), .Q(a1), .CLK(clk));
+  INV inv_b(.A(a1), .ZN(a1n));
+  DFF dff_1(.D(a1n), .Q(a2), .CLK(clk));
+  INV inv_c(.A(a2), .ZN(ao));
+endmodule)";
+
+std::string PartitionToString(const NetlistPartition& partition) {
+  auto cell_names = [](const std::vector<Cell*>& cells) {
+    return absl::StrJoin(cells, " ", [](std::string* out, const Cell* cell) {
+      absl::StrAppend(out, cell->name());
+    });
+  };
+  auto net_names = [](const std::vector<NetRef>& nets) {
+    return absl::StrJoin(nets, " ", [](std::string* out, const NetRef net) {
+      absl::StrAppend(out, net->name());
+    });
+  };
+  return absl::StrCat("cells: ", cell_names(partition.cells),
+                      "; flops: ", cell_names(partition.terminating_flops),
+                      "; inputs: ", net_names(partition.inputs),
+                      "; outputs: ", net_names(partition.outputs));
+}
+
+class NetlistPartitionTest : public testing::Test {
+ protected:
+  absl::StatusOr<const Module*> Parse(const std::string& text) {
+    Scanner scanner(text);
+    XLS_ASSIGN_OR_RETURN(cell_library_, MakeFakeCellLibrary());
+    XLS_ASSIGN_OR_RETURN(netlist_,
+                         Parser::ParseNetlist(&cell_library_, &scanner));
+    return netlist_->GetModule("main");
+  }
+
+  CellLibrary cell_library_;
+  std::unique_ptr<Netlist> netlist_;
+};
+
+TEST_F(NetlistPartitionTest, TwoFlops) {
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, Parse(kTwoFlops));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<NetlistPartition> partitions,
+                           PartitionModule(*m));
+  std::vector<std::string> strings;
+  for (const NetlistPartition& partition : partitions) {
+    strings.push_back(PartitionToString(partition));
+  }
+  EXPECT_THAT(strings,
+              ElementsAre("cells: inv_c; flops: ; inputs: a2; outputs: ao",
+                          "cells: inv_a; flops: dff_0; inputs: ai; "
+                          "outputs: ain",
+                          "cells: inv_b; flops: dff_1; inputs: a1; "
+                          "outputs: a1n"));
+}
+
+TEST_F(NetlistPartitionTest, CellsInTopologicalOrder) {
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, Parse(R"(module main(clk, a, b);
+  input clk;
+  input a;
+  output b;
+  wire x, y, z;
+
+  INV inv_3(.A(y), .ZN(z));
+  AND and_2(.A(x), .B(a), .Z(y));
+  INV inv_1(.A(a), .ZN(x));
+  DFF dff(.D(z), .Q(b), .CLK(clk));
+endmodule)"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<NetlistPartition> partitions,
+                           PartitionModule(*m));
+  ASSERT_EQ(partitions.size(), 1);
+  EXPECT_EQ(PartitionToString(partitions[0]),
+            "cells: inv_1 and_2 inv_3; flops: dff; inputs: a; outputs: z");
+}
+
+TEST_F(NetlistPartitionTest, RunOnPartitions) {
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, Parse(kTwoFlops));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<NetlistPartition> partitions,
+                           PartitionModule(*m));
+  for (int64_t thread_count : {1, 2, 8}) {
+    std::vector<int64_t> cell_counts(partitions.size(), -1);
+    XLS_ASSERT_OK(RunOnPartitions(
+        partitions, thread_count,
+        [&](int64_t index, const NetlistPartition& partition) {
+          cell_counts[index] = partition.cells.size();
+          return absl::OkStatus();
+        }));
+    EXPECT_THAT(cell_counts, ElementsAre(1, 1, 1));
+
+    std::atomic<int64_t> runs(0);
+    EXPECT_THAT(
+        RunOnPartitions(partitions, thread_count,
+                        [&](int64_t index, const NetlistPartition& partition) {
+                          ++runs;
+                          if (index == 0) {
+                            return absl::OkStatus();
+                          }
+                          return absl::InternalError(
+                              absl::StrCat("partition ", index));
+                        }),
+        StatusIs(absl::StatusCode::kInternal, HasSubstr("partition 1")));
+    EXPECT_GE(runs.load(), 2);
+  }
+}
+
+TEST_F(NetlistPartitionTest, InterpretCycle) {
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, Parse(kTwoFlops));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<NetlistPartition> partitions,
+                           PartitionModule(*m));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef clk, m->ResolveNet("clk"));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef ai, m->ResolveNet("ai"));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef ao, m->ResolveNet("ao"));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef a1, m->ResolveNet("a1"));
+  XLS_ASSERT_OK_AND_ASSIGN(NetRef a2, m->ResolveNet("a2"));
+
+  Interpreter interpreter(netlist_.get());
+  for (int64_t thread_count : {1, 4}) {
+    absl::flat_hash_map<const NetRef, bool> inputs = {{clk, false},
+                                                      {ai, true}};
+    absl::flat_hash_map<const NetRef, bool> state = {{a1, true}, {a2, false}};
+    XLS_ASSERT_OK_AND_ASSIGN(
+        Interpreter::CycleResult cycle,
+        interpreter.InterpretCycle(m, partitions, inputs, state, thread_count));
+    EXPECT_EQ(cycle.outputs.at(ao), true);
+    EXPECT_EQ(cycle.next_state.at(a1), false);
+    EXPECT_EQ(cycle.next_state.at(a2), false);
+
+    // Two more cycles flush the input through to the output.
+    XLS_ASSERT_OK_AND_ASSIGN(
+        cycle, interpreter.InterpretCycle(m, partitions, inputs,
+                                          cycle.next_state, thread_count));
+    EXPECT_EQ(cycle.outputs.at(ao), true);
+    XLS_ASSERT_OK_AND_ASSIGN(
+        cycle, interpreter.InterpretCycle(m, partitions, inputs,
+                                          cycle.next_state, thread_count));
+    EXPECT_EQ(cycle.outputs.at(ao), false);
+  }
+}
+
+TEST_F(NetlistPartitionTest, MissingPartitionInput) {
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* m, Parse(kTwoFlops));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<NetlistPartition> partitions,
+                           PartitionModule(*m));
+  Interpreter interpreter(netlist_.get());
+  EXPECT_THAT(interpreter.InterpretPartition(m, partitions[0], {}).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("a2")));
+}
+
+}  // namespace
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
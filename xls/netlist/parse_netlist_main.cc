@@ -38,11 +38,9 @@ absl::Status RealMain(absl::string_view netlist_path,
                          netlist::CellLibrary::FromProto(cell_library_proto));
   }
 
-  XLS_ASSIGN_OR_RETURN(std::string netlist_text, GetFileContents(netlist_path));
-  netlist::rtl::Scanner scanner(netlist_text);
-  XLS_ASSIGN_OR_RETURN(
-      std::unique_ptr<netlist::rtl::Netlist> netlist,
-      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<netlist::rtl::Netlist> netlist,
+                       netlist::rtl::Parser::ParseNetlistFile(
+                           &cell_library, std::string(netlist_path)));
   netlist::rtl::Module* module = netlist->modules()[0].get();
   std::cout << "nets:  " << module->nets().size() << std::endl;
   std::cout << "cells: " << module->cells().size() << std::endl;
@@ -0,0 +1,294 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/netlist/static_timing.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/netlist/logical_effort.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+namespace {
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+}  // namespace
+
+/* static */ absl::StatusOr<std::unique_ptr<StaticTiming>> StaticTiming::Create(
+    const Module* module, const TimingOptions& options) {
+  XLS_RET_CHECK_GT(options.tau_in_ps, 0.0);
+  XLS_ASSIGN_OR_RETURN(std::vector<NetlistPartition> partitions,
+                       PartitionModule(*module));
+  auto timing = absl::WrapUnique(
+      new StaticTiming(module, options, std::move(partitions)));
+  XLS_RETURN_IF_ERROR(RunOnPartitions(
+      timing->partitions_, options.thread_count,
+      [&](int64_t index, const NetlistPartition& partition) -> absl::Status {
+        XLS_RETURN_IF_ERROR(timing->ComputeCellDelays(index));
+        timing->PropagateArrivals(index);
+        return absl::OkStatus();
+      }));
+
+  for (const NetlistPartition& partition : timing->partitions_) {
+    for (NetRef output : partition.outputs) {
+      timing->worst_arrival_ =
+          std::max(timing->worst_arrival_, timing->GetArrival(output));
+    }
+  }
+  XLS_RETURN_IF_ERROR(RunOnPartitions(
+      timing->partitions_, options.thread_count,
+      [&](int64_t index, const NetlistPartition& partition) {
+        timing->PropagateRequired(index);
+        return absl::OkStatus();
+      }));
+  return timing;
+}
+
+StaticTiming::StaticTiming(const Module* module, const TimingOptions& options,
+                           std::vector<NetlistPartition> partitions)
+    : module_(module),
+      options_(options),
+      partitions_(std::move(partitions)),
+      timings_(partitions_.size()),
+      module_outputs_(module->outputs().begin(), module->outputs().end()) {
+  for (int64_t i = 0; i < partitions_.size(); ++i) {
+    for (Cell* cell : partitions_[i].cells) {
+      cell_partitions_[cell] = i;
+      for (const Cell::Pin& output : cell->outputs()) {
+        if (output.netref != module_->GetDummyRef()) {
+          net_partitions_[output.netref] = i;
+          drivers_[output.netref] = cell;
+        }
+      }
+    }
+    for (NetRef input : partitions_[i].inputs) {
+      readers_[input].push_back(i);
+    }
+  }
+}
+
+absl::Status StaticTiming::ComputeCellDelays(int64_t partition_index) {
+  PartitionTiming& timing = timings_[partition_index];
+  for (const Cell* cell : partitions_[partition_index].cells) {
+    if (options_.cell_delay) {
+      XLS_ASSIGN_OR_RETURN(timing.cell_delays[cell],
+                           options_.cell_delay(*cell));
+      continue;
+    }
+    int64_t input_count = cell->inputs().size();
+    XLS_ASSIGN_OR_RETURN(
+        double g, logical_effort::GetLogicalEffort(cell->kind(), input_count),
+        _ << "; cell " << cell->name());
+    XLS_ASSIGN_OR_RETURN(
+        double p, logical_effort::GetParasiticDelay(cell->kind(), input_count),
+        _ << "; cell " << cell->name());
+
+    // The load of an output is the number of cell input pins and module
+    // outputs it drives.
+    int64_t h = 0;
+    for (const Cell::Pin& output : cell->outputs()) {
+      if (output.netref == module_->GetDummyRef()) {
+        continue;
+      }
+      int64_t load = module_outputs_.contains(output.netref) ? 1 : 0;
+      absl::flat_hash_set<const Cell*> seen;
+      for (const Cell* reader : output.netref->connected_cells()) {
+        if (!seen.insert(reader).second) {
+          continue;
+        }
+        for (const Cell::Pin& input : reader->inputs()) {
+          if (input.netref == output.netref) {
+            ++load;
+          }
+        }
+      }
+      h = std::max(h, load);
+    }
+    timing.cell_delays[cell] = (g * h + p) * options_.tau_in_ps;
+  }
+  return absl::OkStatus();
+}
+
+void StaticTiming::PropagateArrivals(int64_t partition_index) {
+  PartitionTiming& timing = timings_[partition_index];
+  timing.arrivals.clear();
+  // The cells are in topological order, and every net they read is either
+  // driven by an earlier cell or arrives at time zero.
+  for (const Cell* cell : partitions_[partition_index].cells) {
+    double arrival = 0.0;
+    for (const Cell::Pin& input : cell->inputs()) {
+      auto it = timing.arrivals.find(input.netref);
+      if (it != timing.arrivals.end()) {
+        arrival = std::max(arrival, it->second);
+      }
+    }
+    arrival += timing.cell_delays.at(cell);
+    for (const Cell::Pin& output : cell->outputs()) {
+      if (output.netref != module_->GetDummyRef()) {
+        timing.arrivals[output.netref] = arrival;
+      }
+    }
+  }
+}
+
+void StaticTiming::PropagateRequired(int64_t partition_index) {
+  const NetlistPartition& partition = partitions_[partition_index];
+  PartitionTiming& timing = timings_[partition_index];
+  timing.required.clear();
+  for (NetRef output : partition.outputs) {
+    timing.required[output] = required_time();
+  }
+  auto required = [&](NetRef net) {
+    auto it = timing.required.find(net);
+    return it == timing.required.end() ? kInfinity : it->second;
+  };
+  for (auto it = partition.cells.rbegin(); it != partition.cells.rend();
+       ++it) {
+    const Cell* cell = *it;
+    double output_required = kInfinity;
+    for (const Cell::Pin& output : cell->outputs()) {
+      if (output.netref != module_->GetDummyRef()) {
+        output_required = std::min(output_required, required(output.netref));
+      }
+    }
+    double input_required = output_required - timing.cell_delays.at(cell);
+    for (const Cell::Pin& input : cell->inputs()) {
+      timing.required[input.netref] =
+          std::min(required(input.netref), input_required);
+    }
+  }
+}
+
+absl::Status StaticTiming::UpdateWorstArrival() {
+  double worst_arrival = 0.0;
+  for (const NetlistPartition& partition : partitions_) {
+    for (NetRef output : partition.outputs) {
+      worst_arrival = std::max(worst_arrival, GetArrival(output));
+    }
+  }
+  bool required_changed = !options_.clock_period_ps.has_value() &&
+                          worst_arrival != worst_arrival_;
+  worst_arrival_ = worst_arrival;
+  if (!required_changed) {
+    return absl::OkStatus();
+  }
+  return RunOnPartitions(partitions_, options_.thread_count,
+                         [&](int64_t index, const NetlistPartition& partition) {
+                           PropagateRequired(index);
+                           return absl::OkStatus();
+                         });
+}
+
+double StaticTiming::GetCellDelay(const Cell* cell) const {
+  auto it = cell_partitions_.find(cell);
+  return it == cell_partitions_.end()
+             ? 0.0
+             : timings_[it->second].cell_delays.at(cell);
+}
+
+double StaticTiming::GetArrival(NetRef net) const {
+  auto it = net_partitions_.find(net);
+  return it == net_partitions_.end() ? 0.0
+                                     : timings_[it->second].arrivals.at(net);
+}
+
+double StaticTiming::GetRequired(NetRef net) const {
+  // A startpoint must arrive in time for every partition reading it.
+  std::vector<int64_t> partitions;
+  auto it = net_partitions_.find(net);
+  if (it != net_partitions_.end()) {
+    partitions.push_back(it->second);
+  } else if (readers_.contains(net)) {
+    partitions = readers_.at(net);
+  }
+  double required = kInfinity;
+  for (int64_t index : partitions) {
+    auto required_it = timings_[index].required.find(net);
+    if (required_it != timings_[index].required.end()) {
+      required = std::min(required, required_it->second);
+    }
+  }
+  return required;
+}
+
+std::vector<TimingPath> StaticTiming::GetCriticalPaths(int64_t count) const {
+  std::vector<NetRef> endpoints;
+  for (const NetlistPartition& partition : partitions_) {
+    endpoints.insert(endpoints.end(), partition.outputs.begin(),
+                     partition.outputs.end());
+  }
+  std::sort(endpoints.begin(), endpoints.end(), [&](NetRef a, NetRef b) {
+    double a_slack = GetSlack(a);
+    double b_slack = GetSlack(b);
+    return a_slack != b_slack ? a_slack < b_slack : a->name() < b->name();
+  });
+  if (endpoints.size() > count) {
+    endpoints.resize(count);
+  }
+
+  std::vector<TimingPath> paths;
+  for (NetRef endpoint : endpoints) {
+    TimingPath path;
+    path.endpoint = endpoint;
+    path.arrival_ps = GetArrival(endpoint);
+    path.slack_ps = GetSlack(endpoint);
+    // Walk back through the latest-arriving input of each cell.
+    NetRef net = endpoint;
+    auto driver = drivers_.find(net);
+    while (driver != drivers_.end()) {
+      Cell* cell = driver->second;
+      path.cells.push_back(cell);
+      NetRef latest = nullptr;
+      for (const Cell::Pin& input : cell->inputs()) {
+        if (latest == nullptr ||
+            GetArrival(input.netref) > GetArrival(latest)) {
+          latest = input.netref;
+        }
+      }
+      if (latest == nullptr) {
+        break;
+      }
+      net = latest;
+      driver = drivers_.find(net);
+    }
+    path.startpoint = net;
+    std::reverse(path.cells.begin(), path.cells.end());
+    paths.push_back(std::move(path));
+  }
+  return paths;
+}
+
+absl::Status StaticTiming::SetCellDelay(const Cell* cell, double delay_ps) {
+  auto it = cell_partitions_.find(cell);
+  if (it == cell_partitions_.end()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Cell %s is not a combinational cell of module %s", cell->name(),
+        module_->name()));
+  }
+  timings_[it->second].cell_delays[cell] = delay_ps;
+  PropagateArrivals(it->second);
+  PropagateRequired(it->second);
+  return UpdateWorstArrival();
+}
+
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
@@ -0,0 +1,159 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Static timing analysis of netlists using the method of logical effort.
+
+#ifndef XLS_NETLIST_STATIC_TIMING_H_
+#define XLS_NETLIST_STATIC_TIMING_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/netlist/netlist.h"
+#include "xls/netlist/netlist_partition.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+
+struct TimingOptions {
+  // The delay of an inverter driving an identical inverter without parasitics
+  // (tau), in picoseconds.
+  double tau_in_ps = 1.0;
+
+  // The time by which every endpoint must be reached. If unset, endpoints are
+  // required by the latest arrival time in the module.
+  absl::optional<double> clock_period_ps;
+
+  // If set, gives the delay of each cell in picoseconds (e.g., looked up in
+  // Liberty tables) instead of computing it by logical effort.
+  std::function<absl::StatusOr<double>(const Cell&)> cell_delay;
+
+  // The number of threads the partitions of the module are timed on.
+  int64_t thread_count = 1;
+};
+
+// A path through the combinational cells of a module.
+struct TimingPath {
+  // The module input or flop output the path starts from.
+  NetRef startpoint;
+
+  // The module output or flop input the path ends at.
+  NetRef endpoint;
+
+  // The cells along the path, from the one reading the startpoint to the one
+  // driving the endpoint.
+  std::vector<Cell*> cells;
+
+  double arrival_ps;
+  double slack_ps;
+};
+
+// Levelized static timing of a module. Paths start at module inputs and flop
+// outputs, which arrive at time zero, and end at module outputs and flop
+// inputs. Each cell has a single delay from all of its inputs to all of its
+// outputs; by default this is its logical effort delay d = gh + p, where the
+// electrical effort h is the number of input pins (and module outputs) its
+// most heavily loaded output drives.
+//
+// As flops break every path, the logic clouds of the module (see
+// netlist_partition.h) are timed independently: in parallel when the timing
+// is created, and one at a time as cell delays are updated.
+class StaticTiming {
+ public:
+  static absl::StatusOr<std::unique_ptr<StaticTiming>> Create(
+      const Module* module, const TimingOptions& options = TimingOptions());
+
+  // Returns the delay of the given combinational cell.
+  double GetCellDelay(const Cell* cell) const;
+
+  // Returns the time at which the value of the net settles; zero for
+  // startpoints and constants.
+  double GetArrival(NetRef net) const;
+
+  // Returns the latest time at which the net may settle for every endpoint it
+  // reaches to meet its required time; infinite if it reaches none.
+  double GetRequired(NetRef net) const;
+
+  double GetSlack(NetRef net) const {
+    return GetRequired(net) - GetArrival(net);
+  }
+
+  // Returns the latest arrival time of any endpoint.
+  double worst_arrival() const { return worst_arrival_; }
+
+  // Returns the critical paths to the "count" endpoints with the least slack,
+  // worst first.
+  std::vector<TimingPath> GetCriticalPaths(int64_t count) const;
+
+  // Sets the delay of the given combinational cell (e.g., after it is resized)
+  // and updates the timing of its logic cloud.
+  absl::Status SetCellDelay(const Cell* cell, double delay_ps);
+
+ private:
+  // The timing of the nets driven by the cells of one partition.
+  struct PartitionTiming {
+    absl::flat_hash_map<const Cell*, double> cell_delays;
+    absl::flat_hash_map<NetRef, double> arrivals;
+    absl::flat_hash_map<NetRef, double> required;
+  };
+
+  StaticTiming(const Module* module, const TimingOptions& options,
+               std::vector<NetlistPartition> partitions);
+
+  absl::Status ComputeCellDelays(int64_t partition_index);
+  void PropagateArrivals(int64_t partition_index);
+  void PropagateRequired(int64_t partition_index);
+
+  // Updates the required times of every partition if they depend on the worst
+  // arrival and it has changed.
+  absl::Status UpdateWorstArrival();
+
+  double required_time() const {
+    return options_.clock_period_ps.value_or(worst_arrival_);
+  }
+
+  const Module* module_;
+  TimingOptions options_;
+  std::vector<NetlistPartition> partitions_;
+  std::vector<PartitionTiming> timings_;
+
+  // The partition containing each combinational cell, and the one driving
+  // each net driven by such a cell.
+  absl::flat_hash_map<const Cell*, int64_t> cell_partitions_;
+  absl::flat_hash_map<NetRef, int64_t> net_partitions_;
+
+  // The driver of each net driven by a combinational cell.
+  absl::flat_hash_map<NetRef, Cell*> drivers_;
+
+  // The partitions reading each startpoint.
+  absl::flat_hash_map<NetRef, std::vector<int64_t>> readers_;
+
+  absl::flat_hash_set<NetRef> module_outputs_;
+
+  double worst_arrival_ = 0.0;
+};
+
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
+
+#endif  // XLS_NETLIST_STATIC_TIMING_H_
@@ -0,0 +1,180 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/netlist/static_timing.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/netlist/fake_cell_library.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace rtl {
+namespace {
+
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+// a -> |inv_a| -(an)-> |nand_x| -(x)-> |dff|
+//                 b --/
+// |dff| -(q)-> |inv_q| -(qn)-> |inv_o| -> o
+constexpr char kNetlist[] = R"(module main(clk, a, b, o);
+  input clk;
+  input a, b;
+  output o;
+  wire an, x, q, qn;
+
+  INV inv_a(.A(a), .ZN(an));
+  NAND nand_x(.A(an), .B(b), .ZN(x));
+  DFF dff(.D(x), .Q(q), .CLK(clk));
+  INV inv_q(.A(q), .ZN(qn));
+  INV inv_o(.A(qn), .ZN(o));
+endmodule)";
+
+std::vector<std::string> CellNames(const TimingPath& path) {
+  std::vector<std::string> names;
+  for (const Cell* cell : path.cells) {
+    names.push_back(cell->name());
+  }
+  return names;
+}
+
+class StaticTimingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    Scanner scanner(kNetlist);
+    XLS_ASSERT_OK_AND_ASSIGN(cell_library_, MakeFakeCellLibrary());
+    XLS_ASSERT_OK_AND_ASSIGN(netlist_,
+                             Parser::ParseNetlist(&cell_library_, &scanner));
+    XLS_ASSERT_OK_AND_ASSIGN(module_, netlist_->GetModule("main"));
+  }
+
+  NetRef Net(const std::string& name) {
+    return module_->ResolveNet(name).value();
+  }
+  Cell* GetCell(const std::string& name) {
+    return module_->ResolveCell(name).value();
+  }
+
+  CellLibrary cell_library_;
+  std::unique_ptr<Netlist> netlist_;
+  const Module* module_;
+};
+
+TEST_F(StaticTimingTest, LogicalEffortDelays) {
+  for (int64_t thread_count : {1, 4}) {
+    TimingOptions options;
+    options.tau_in_ps = 3.0;
+    options.clock_period_ps = 30.0;
+    options.thread_count = thread_count;
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StaticTiming> timing,
+                             StaticTiming::Create(module_, options));
+    // An inverter driving one load: d = 1 * 1 + 1.
+    EXPECT_DOUBLE_EQ(timing->GetCellDelay(GetCell("inv_a")), 6.0);
+    // A two-input NAND driving one load: d = 4/3 * 1 + 2.
+    EXPECT_DOUBLE_EQ(timing->GetCellDelay(GetCell("nand_x")), 10.0);
+
+    EXPECT_DOUBLE_EQ(timing->GetArrival(Net("a")), 0.0);
+    EXPECT_DOUBLE_EQ(timing->GetArrival(Net("an")), 6.0);
+    EXPECT_DOUBLE_EQ(timing->GetArrival(Net("x")), 16.0);
+    EXPECT_DOUBLE_EQ(timing->GetArrival(Net("q")), 0.0);
+    EXPECT_DOUBLE_EQ(timing->GetArrival(Net("o")), 12.0);
+    EXPECT_DOUBLE_EQ(timing->worst_arrival(), 16.0);
+
+    EXPECT_DOUBLE_EQ(timing->GetRequired(Net("x")), 30.0);
+    EXPECT_DOUBLE_EQ(timing->GetRequired(Net("an")), 20.0);
+    EXPECT_DOUBLE_EQ(timing->GetRequired(Net("a")), 14.0);
+    EXPECT_DOUBLE_EQ(timing->GetRequired(Net("b")), 20.0);
+    EXPECT_DOUBLE_EQ(timing->GetSlack(Net("o")), 18.0);
+  }
+}
+
+TEST_F(StaticTimingTest, CriticalPaths) {
+  TimingOptions options;
+  options.clock_period_ps = 10.0;
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StaticTiming> timing,
+                           StaticTiming::Create(module_, options));
+  std::vector<TimingPath> paths = timing->GetCriticalPaths(5);
+  ASSERT_EQ(paths.size(), 2);
+  EXPECT_EQ(paths[0].startpoint, Net("a"));
+  EXPECT_EQ(paths[0].endpoint, Net("x"));
+  EXPECT_THAT(CellNames(paths[0]), ElementsAre("inv_a", "nand_x"));
+  EXPECT_DOUBLE_EQ(paths[0].arrival_ps, 16.0 / 3.0);
+  EXPECT_DOUBLE_EQ(paths[0].slack_ps, 10.0 - 16.0 / 3.0);
+  EXPECT_EQ(paths[1].startpoint, Net("q"));
+  EXPECT_EQ(paths[1].endpoint, Net("o"));
+  EXPECT_THAT(CellNames(paths[1]), ElementsAre("inv_q", "inv_o"));
+
+  EXPECT_EQ(timing->GetCriticalPaths(1).size(), 1);
+}
+
+TEST_F(StaticTimingTest, IncrementalUpdate) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StaticTiming> timing,
+                           StaticTiming::Create(module_));
+  // Without a clock period the worst endpoint has zero slack.
+  EXPECT_DOUBLE_EQ(timing->GetSlack(Net("x")), 0.0);
+  EXPECT_DOUBLE_EQ(timing->GetSlack(Net("o")), 16.0 / 3.0 - 4.0);
+
+  XLS_ASSERT_OK(timing->SetCellDelay(GetCell("inv_q"), 5.0));
+  EXPECT_DOUBLE_EQ(timing->GetArrival(Net("qn")), 5.0);
+  EXPECT_DOUBLE_EQ(timing->GetArrival(Net("o")), 7.0);
+  EXPECT_DOUBLE_EQ(timing->worst_arrival(), 7.0);
+  EXPECT_DOUBLE_EQ(timing->GetSlack(Net("o")), 0.0);
+  EXPECT_DOUBLE_EQ(timing->GetSlack(Net("x")), 7.0 - 16.0 / 3.0);
+  std::vector<TimingPath> paths = timing->GetCriticalPaths(1);
+  ASSERT_EQ(paths.size(), 1);
+  EXPECT_EQ(paths[0].endpoint, Net("o"));
+
+  EXPECT_THAT(timing->SetCellDelay(GetCell("dff"), 1.0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a combinational cell")));
+}
+
+TEST_F(StaticTimingTest, CustomCellDelays) {
+  TimingOptions options;
+  options.cell_delay = [](const Cell& cell) -> absl::StatusOr<double> {
+    return cell.kind() == CellKind::kNand ? 10.0 : 1.0;
+  };
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StaticTiming> timing,
+                           StaticTiming::Create(module_, options));
+  EXPECT_DOUBLE_EQ(timing->GetArrival(Net("x")), 11.0);
+  EXPECT_DOUBLE_EQ(timing->GetArrival(Net("o")), 2.0);
+}
+
+TEST(StaticTimingErrorTest, UnsupportedCellKind) {
+  Scanner scanner(R"(module main(a, b, o);
+  input a, b;
+  output o;
+
+  AND and_0(.A(a), .B(b), .Z(o));
+endmodule)");
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Netlist> netlist,
+                           Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const Module* module, netlist->GetModule("main"));
+  EXPECT_THAT(StaticTiming::Create(module).status(),
+              StatusIs(absl::StatusCode::kUnimplemented, HasSubstr("and_0")));
+}
+
+}  // namespace
+}  // namespace rtl
+}  // namespace netlist
+}  // namespace xls
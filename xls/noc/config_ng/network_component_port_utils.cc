@@ -92,7 +92,7 @@ std::vector<const NetworkComponent*> GetComponentsConnectedTo(
     for (const NetworkConnection* connection : port.GetConnections()) {
       XLS_CHECK(connection != nullptr)
           << "The port must have a valid connection.";
-      if (connection->GetSinkPort() != nullptr) {
+      if (connection->GetSourcePort() != nullptr) {
         components.push_back(&connection->GetSourcePort()->GetComponent());
       }
     }
@@ -110,5 +110,25 @@ TEST(NetworkComponentPortUtilsTest, GetComponentsConnectedTo) {
   EXPECT_EQ(components[0], &componentA);
 }
 
+// GetComponentsConnectedTo an input port, including one with a connection
+// that has no source port.
+TEST(NetworkComponentPortUtilsTest, GetComponentsConnectedToInputPort) {
+  NetworkView view;
+  NetworkComponent& component = view.AddComponent<FakeNetworkComponent>();
+  NetworkComponent& componentA = view.AddComponent<FakeNetworkComponent>();
+  NetworkComponentPort& input_port =
+      componentA.AddPort(PortType::kData, PortDirection::kInput);
+  view.AddConnection().ConnectToSinkPort(&input_port);
+  EXPECT_TRUE(GetComponentsConnectedTo(input_port).empty());
+  view.AddConnection()
+      .ConnectToSourcePort(
+          &component.AddPort(PortType::kData, PortDirection::kOutput))
+      .ConnectToSinkPort(&input_port);
+  std::vector<const NetworkComponent*> components =
+      GetComponentsConnectedTo(input_port);
+  ASSERT_EQ(components.size(), 1);
+  EXPECT_EQ(components[0], &component);
+}
+
 }  // namespace
 }  // namespace xls::noc
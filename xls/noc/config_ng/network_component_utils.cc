@@ -91,6 +91,24 @@ std::vector<const NetworkComponent*> GetComponentsConnectedToOutputPortsFrom(
   return components;
 }
 
+std::vector<const NetworkConnection*> GetConnectionsOf(
+    const NetworkComponent& component) {
+  std::vector<const NetworkConnection*> connections;
+  for (const NetworkComponentPort* port : component.ports()) {
+    for (const NetworkConnection* connection : port->GetConnections()) {
+      // A connection between two ports of the component is reported by its
+      // source port only.
+      const NetworkComponentPort* source_port = connection->GetSourcePort();
+      if (port->IsInput() && source_port != nullptr &&
+          &source_port->GetComponent() == &component) {
+        continue;
+      }
+      connections.push_back(connection);
+    }
+  }
+  return connections;
+}
+
 absl::Status AddNameToComponent(
     const absl::flat_hash_map<std::string, NetworkComponent*>& components) {
   // Set names for routers
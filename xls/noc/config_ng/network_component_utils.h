@@ -22,6 +22,7 @@ namespace xls::noc {
 
 class NetworkComponentPort;
 class NetworkComponent;
+class NetworkConnection;
 
 // Returns OK if the component is valid. Otherwise, returns an error.
 // A valid component contains valid ports and is the owner of its ports.
@@ -53,6 +54,12 @@ std::vector<const NetworkComponentPort*> GetControlPortsFrom(
 std::vector<const NetworkComponent*> GetComponentsConnectedToOutputPortsFrom(
     const NetworkComponent& component);
 
+// Returns the connections to and from the ports of the component, each once,
+// using the connections indexed by the ports. Runs in time linear in the
+// number of ports and connections of the component.
+std::vector<const NetworkConnection*> GetConnectionsOf(
+    const NetworkComponent& component);
+
 // Sets the name of the component to the name that it is associated with.
 // Side-effect: replaces the existing name in the component. Returns OK if all
 // components are valid (e.g. not nullptr). Otherwise, returns an error.
@@ -18,12 +18,15 @@
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
 #include "xls/noc/config_ng/fake_network_component.h"
+#include "xls/noc/config_ng/network_connection.h"
 #include "xls/noc/config_ng/network_view.h"
 
 namespace xls::noc {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::StrEq;
+using ::testing::UnorderedElementsAre;
 
 // Validate a component with one port.
 TEST(NetworkComponentUtilsTest, ValidateNetworkComponentOfValidComponent) {
@@ -51,6 +54,30 @@ TEST(NetworkComponentUtilsTest, GetComponentsConnectedToOutputPortsFrom) {
   EXPECT_EQ(components[0], &componentA);
 }
 
+// GetConnectionsOf a component with connections to another component and to
+// itself.
+TEST(NetworkComponentUtilsTest, GetConnectionsOf) {
+  NetworkView view;
+  NetworkComponent& component = view.AddComponent<FakeNetworkComponent>();
+  NetworkComponent& componentA = view.AddComponent<FakeNetworkComponent>();
+  NetworkComponentPort& output_port =
+      component.AddPort(PortType::kData, PortDirection::kOutput);
+  NetworkComponentPort& input_port =
+      component.AddPort(PortType::kData, PortDirection::kInput);
+  EXPECT_TRUE(GetConnectionsOf(component).empty());
+  NetworkConnection& to_a =
+      view.AddConnection()
+          .ConnectToSourcePort(&output_port)
+          .ConnectToSinkPort(
+              &componentA.AddPort(PortType::kData, PortDirection::kInput));
+  NetworkConnection& loop = view.AddConnection()
+                                .ConnectToSourcePort(&output_port)
+                                .ConnectToSinkPort(&input_port);
+  EXPECT_THAT(GetConnectionsOf(component),
+              UnorderedElementsAre(&to_a, &loop));
+  EXPECT_THAT(GetConnectionsOf(componentA), ElementsAre(&to_a));
+}
+
 // Populate two components with names using AddNameToComponent.
 TEST(NetworkComponentTest, AddNameToComponent) {
   absl::flat_hash_map<std::string, NetworkComponent*> names;
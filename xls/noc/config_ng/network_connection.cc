@@ -30,7 +30,9 @@ NetworkConnection& NetworkConnection::ConnectToSourcePort(
     source_port_->RemoveConnection(this);
   }
   source_port_ = source_port;
-  source_port_->AddConnection(this);
+  if (source_port_ != nullptr) {
+    source_port_->AddConnection(this);
+  }
   return *this;
 }
 
@@ -44,7 +46,9 @@ NetworkConnection& NetworkConnection::ConnectToSinkPort(
     sink_port_->RemoveConnection(this);
   }
   sink_port_ = sink_port;
-  sink_port_->AddConnection(this);
+  if (sink_port_ != nullptr) {
+    sink_port_->AddConnection(this);
+  }
   return *this;
 }
 
@@ -38,6 +38,10 @@ TEST(NetworkConnectionTest, MemberFunction) {
   EXPECT_EQ(connection.GetSinkPort(), &sink_port);
   EXPECT_EQ(source_port.GetConnections().size(), 1);
   EXPECT_EQ(sink_port.GetConnections().size(), 1);
+  connection.ConnectToSourcePort(nullptr);
+  EXPECT_EQ(connection.GetSourcePort(), nullptr);
+  EXPECT_TRUE(source_port.GetConnections().empty());
+  EXPECT_EQ(sink_port.GetConnections().size(), 1);
 }
 
 }  // namespace
@@ -31,6 +31,10 @@ NetworkView::components() const {
 
 int64_t NetworkView::GetComponentCount() const { return components_.size(); }
 
+bool NetworkView::HasComponent(const NetworkComponent& component) const {
+  return component_set_.contains(&component);
+}
+
 NetworkConnection& NetworkView::AddConnection() {
   // Using `new` to access a non-public constructor.
   connections_.emplace_back(absl::WrapUnique(new NetworkConnection(this)));
@@ -15,8 +15,12 @@
 #ifndef XLS_NOC_CONFIG_NETWORK_VIEW_H_
 #define XLS_NOC_CONFIG_NETWORK_VIEW_H_
 
+#include <typeindex>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "xls/noc/config_ng/network_component.h"
 #include "xls/noc/config_ng/network_connection.h"
 
@@ -41,24 +45,25 @@ class NetworkView {
     static_assert(std::is_base_of<NetworkComponent, Type>::value,
                   "Type is not a Network Component subclass");
     components_.emplace_back(absl::make_unique<Type>(this));
+    component_set_.insert(components_.back().get());
+    component_counts_[std::type_index(typeid(Type))]++;
     return static_cast<Type&>(*components_.back());
   }
 
   // Counts the number of a components of the type specified by the template.
   // The component type must be a network component base class or derived class.
+  // Runs in constant time.
   template <typename Type>
   int64_t GetCount() const {
     static_assert(std::is_base_of<NetworkComponent, Type>::value,
                   "Type is not a Network Component subclass");
-    int64_t count = 0;
-    for (const NetworkComponent* component : components()) {
-      if (typeid(*component) == typeid(Type)) {
-        count++;
-      }
-    }
-    return count;
+    auto it = component_counts_.find(std::type_index(typeid(Type)));
+    return it == component_counts_.end() ? 0 : it->second;
   }
 
+  // Returns true if the component is owned by the view. Runs in constant time.
+  bool HasComponent(const NetworkComponent& component) const;
+
   // Returns an iterator range for the components. The objects are guaranteed to
   // be non-null. Note that, when using the result of this function, if the view
   // is modified (e.g. a component is added), the returned result may become
@@ -96,6 +101,9 @@ class NetworkView {
  private:
   std::vector<std::unique_ptr<NetworkComponent>> components_;
   std::vector<std::unique_ptr<NetworkConnection>> connections_;
+  // Indexes of the components, maintained by AddComponent.
+  absl::flat_hash_set<const NetworkComponent*> component_set_;
+  absl::flat_hash_map<std::type_index, int64_t> component_counts_;
 };
 
 }  // namespace xls::noc
@@ -20,6 +20,12 @@
 namespace xls::noc {
 namespace {
 
+class OtherFakeNetworkComponent : public NetworkComponent {
+ public:
+  explicit OtherFakeNetworkComponent(NetworkView* network_view)
+      : NetworkComponent(network_view) {}
+};
+
 // Test member functions for network view.
 TEST(NetworkViewTest, MemberFunction) {
   NetworkView view;
@@ -34,5 +40,23 @@ TEST(NetworkViewTest, MemberFunction) {
   EXPECT_EQ(*view.connections().begin(), &connection);
 }
 
+// Test the indexes maintained by the network view.
+TEST(NetworkViewTest, Indexes) {
+  NetworkView view;
+  NetworkView other_view;
+  EXPECT_EQ(view.GetCount<FakeNetworkComponent>(), 0);
+  FakeNetworkComponent& component = view.AddComponent<FakeNetworkComponent>();
+  view.AddComponent<OtherFakeNetworkComponent>();
+  view.AddComponent<OtherFakeNetworkComponent>();
+  FakeNetworkComponent& other_component =
+      other_view.AddComponent<FakeNetworkComponent>();
+  EXPECT_EQ(view.GetCount<FakeNetworkComponent>(), 1);
+  EXPECT_EQ(view.GetCount<OtherFakeNetworkComponent>(), 2);
+  EXPECT_EQ(view.GetCount<NetworkComponent>(), 0);
+  EXPECT_TRUE(view.HasComponent(component));
+  EXPECT_FALSE(view.HasComponent(other_component));
+  EXPECT_TRUE(other_view.HasComponent(other_component));
+}
+
 }  // namespace
 }  // namespace xls::noc
@@ -15,6 +15,7 @@
 #include "xls/noc/config_ng/network_view_utils.h"
 
 #include "xls/common/status/status_macros.h"
+#include "xls/noc/config_ng/network_component_port.h"
 #include "xls/noc/config_ng/network_component_utils.h"
 #include "xls/noc/config_ng/network_connection_utils.h"
 #include "xls/noc/config_ng/network_view.h"
@@ -35,6 +36,12 @@ absl::Status ValidateNetworkView(const NetworkView& view) {
       return absl::FailedPreconditionError(
           "Network view contains connection that it does not own.");
     }
+    if (!view.HasComponent(connection->GetSourcePort()->GetComponent()) ||
+        !view.HasComponent(connection->GetSinkPort()->GetComponent())) {
+      return absl::FailedPreconditionError(
+          "Network view contains connection to a component that it does not "
+          "own.");
+    }
   }
   return absl::Status();
 }
@@ -17,6 +17,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
+#include "xls/noc/config_ng/fake_network_component.h"
 #include "xls/noc/config_ng/network_view.h"
 
 namespace xls::noc {
@@ -28,5 +29,28 @@ TEST(NetworkViewUtilsTest, ValidateNetworkView) {
   XLS_EXPECT_OK(ValidateNetworkView(view));
 }
 
+// Validates a network view with a connection to a component of another view.
+TEST(NetworkViewUtilsTest, ValidateNetworkViewForeignComponent) {
+  NetworkView view;
+  NetworkView other_view;
+  NetworkComponent& component = view.AddComponent<FakeNetworkComponent>();
+  NetworkComponent& other_component =
+      other_view.AddComponent<FakeNetworkComponent>();
+  NetworkComponentPort& input_port =
+      component.AddPort(PortType::kData, PortDirection::kInput);
+  NetworkConnection& connection =
+      view.AddConnection()
+          .ConnectToSourcePort(
+              &component.AddPort(PortType::kData, PortDirection::kOutput))
+          .ConnectToSinkPort(&input_port);
+  XLS_EXPECT_OK(ValidateNetworkView(view));
+  connection.ConnectToSinkPort(
+      &other_component.AddPort(PortType::kData, PortDirection::kInput));
+  EXPECT_THAT(ValidateNetworkView(view),
+              status_testing::StatusIs(
+                  absl::StatusCode::kFailedPrecondition,
+                  testing::HasSubstr("component that it does not own")));
+}
+
 }  // namespace
 }  // namespace xls::noc
@@ -0,0 +1,135 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/noc/simulation/batch_simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/noc/simulation/global_routing_table.h"
+#include "xls/noc/simulation/network_graph.h"
+#include "xls/noc/simulation/network_graph_builder.h"
+#include "xls/noc/simulation/parameters.h"
+#include "xls/noc/simulation/sim_objects.h"
+
+namespace xls {
+namespace noc {
+namespace {
+
+// Builds and simulates "variant", storing the statistics in "result".
+absl::Status SimulateVariant(const BatchSimulationVariant& variant,
+                             const BatchSimulationOptions& options,
+                             BatchSimulationResult* result) {
+  NetworkManager graph;
+  NocParameters params;
+  XLS_RETURN_IF_ERROR(
+      BuildNetworkGraphFromProto(variant.config, &graph, &params));
+  XLS_RET_CHECK_EQ(graph.GetNetworkIds().size(), 1);
+  NetworkId network = graph.GetNetworkIds()[0];
+
+  DistributedRoutingTableBuilderForTrees route_builder;
+  XLS_ASSIGN_OR_RETURN(
+      DistributedRoutingTable routing_table,
+      route_builder.BuildNetworkRoutingTables(network, graph, params));
+  result->source_count =
+      routing_table.GetSourceIndices().NetworkComponentCount();
+  result->sink_count = routing_table.GetSinkIndices().NetworkComponentCount();
+
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<TrafficModel> model,
+      options.traffic_model_factory(result->source_count, result->sink_count));
+
+  NocSimulator simulator;
+  XLS_RETURN_IF_ERROR(
+      simulator.Initialize(graph, params, routing_table, network));
+  XLS_ASSIGN_OR_RETURN(TrafficDriver driver,
+                       TrafficDriver::Create(&simulator, model.get()));
+  XLS_RETURN_IF_ERROR(driver.Run(options.cycle_count));
+
+  result->total = driver.total();
+  result->throughput = driver.Throughput();
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<BatchSimulationResult>> RunBatchSimulation(
+    absl::Span<const BatchSimulationVariant> variants,
+    const BatchSimulationOptions& options) {
+  XLS_RET_CHECK(options.traffic_model_factory != nullptr);
+  XLS_RET_CHECK_GE(options.cycle_count, 0);
+  XLS_RET_CHECK_GE(options.thread_count, 1);
+
+  std::vector<BatchSimulationResult> results(variants.size());
+  std::atomic<int64_t> next_variant(0);
+  auto simulate_variants = [&]() {
+    for (int64_t i = next_variant++; i < variants.size();
+         i = next_variant++) {
+      results[i].name = variants[i].name;
+      results[i].status = SimulateVariant(variants[i], options, &results[i]);
+    }
+  };
+
+  // The calling thread simulates variants too.
+  int64_t thread_count =
+      std::min<int64_t>(options.thread_count, variants.size());
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 1; i < thread_count; ++i) {
+    threads.push_back(absl::make_unique<Thread>(simulate_variants));
+  }
+  simulate_variants();
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  return results;
+}
+
+std::string BatchSimulationResultsToTable(
+    absl::Span<const BatchSimulationResult> results) {
+  int64_t name_width = 7;
+  for (const BatchSimulationResult& result : results) {
+    name_width = std::max<int64_t>(name_width, result.name.size());
+  }
+
+  std::string out = absl::StrFormat(
+      "%-*s %8s %8s %10s %10s %10s %8s %8s %8s\n", name_width, "variant",
+      "sources", "sinks", "injected", "received", "throughput", "lat_mean",
+      "lat_p99", "lat_max");
+  for (const BatchSimulationResult& result : results) {
+    if (!result.status.ok()) {
+      absl::StrAppendFormat(&out, "%-*s error: %s\n", name_width, result.name,
+                            result.status.ToString());
+      continue;
+    }
+    const LatencyHistogram& latency = result.total.latency;
+    absl::StrAppendFormat(
+        &out, "%-*s %8d %8d %10d %10d %10.4f %8.2f %8d %8d\n", name_width,
+        result.name, result.source_count, result.sink_count,
+        result.total.injected, result.total.received, result.throughput,
+        latency.mean(), latency.Percentile(99), latency.max());
+  }
+  return out;
+}
+
+}  // namespace noc
+}  // namespace xls
@@ -0,0 +1,90 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_NOC_SIMULATION_BATCH_SIMULATION_H_
+#define XLS_NOC_SIMULATION_BATCH_SIMULATION_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/noc/config/network_config.pb.h"
+#include "xls/noc/simulation/traffic.h"
+
+// This file contains a runner that simulates many variants of a network
+// (e.g. with different buffer depths, vc counts or topologies) concurrently,
+// for design-space exploration.
+
+namespace xls {
+namespace noc {
+
+// A network to simulate.
+struct BatchSimulationVariant {
+  std::string name;
+  NetworkConfigProto config;
+};
+
+struct BatchSimulationOptions {
+  // Number of cycles to simulate each variant for.
+  int64_t cycle_count = 1000;
+
+  // Number of variants simulated concurrently.
+  int64_t thread_count = 1;
+
+  // Returns the traffic model of a variant, given its number of sources and
+  // sinks; called once per variant, possibly concurrently.
+  std::function<absl::StatusOr<std::unique_ptr<TrafficModel>>(
+      int64_t source_count, int64_t sink_count)>
+      traffic_model_factory;
+};
+
+// The statistics of the simulation of a variant.
+struct BatchSimulationResult {
+  std::string name;
+
+  // Error building or simulating the variant, in which case the statistics
+  // are not set.
+  absl::Status status;
+
+  int64_t source_count = 0;
+  int64_t sink_count = 0;
+  FlowStats total;
+  double throughput = 0.0;
+};
+
+// Simulates each of "variants" with the traffic of
+// options.traffic_model_factory, and returns their results in the same
+// order.
+//
+// A variant failing doesn't stop the others (see
+// BatchSimulationResult::status); an error is returned only for invalid
+// options.
+absl::StatusOr<std::vector<BatchSimulationResult>> RunBatchSimulation(
+    absl::Span<const BatchSimulationVariant> variants,
+    const BatchSimulationOptions& options);
+
+// Returns a table comparing the latency and throughput of "results", one row
+// per variant.
+std::string BatchSimulationResultsToTable(
+    absl::Span<const BatchSimulationResult> results);
+
+}  // namespace noc
+}  // namespace xls
+
+#endif  // XLS_NOC_SIMULATION_BATCH_SIMULATION_H_
@@ -0,0 +1,133 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/noc/simulation/batch_simulation.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/matchers.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/noc/config/network_config.pb.h"
+#include "xls/noc/config/network_config_proto_builder.h"
+
+namespace xls {
+namespace noc {
+namespace {
+
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+// Returns a network of two sources and two sinks connected through a router,
+// with the given buffer depth and link pipeline stages.
+absl::StatusOr<NetworkConfigProto> MakeNetwork(int64_t depth,
+                                               int64_t pipeline_stages) {
+  NetworkConfigProtoBuilder builder("Test");
+  builder.WithVirtualChannel("VC0").WithFlitBitWidth(64).WithDepth(depth);
+  builder.WithPort("SendPort0").AsInputDirection().WithVirtualChannel("VC0");
+  builder.WithPort("SendPort1").AsInputDirection().WithVirtualChannel("VC0");
+  builder.WithPort("RecvPort0").AsOutputDirection().WithVirtualChannel("VC0");
+  builder.WithPort("RecvPort1").AsOutputDirection().WithVirtualChannel("VC0");
+
+  auto routera = builder.WithRouter("RouterA");
+  routera.WithInputPort("Ain0").WithVirtualChannel("VC0");
+  routera.WithInputPort("Ain1").WithVirtualChannel("VC0");
+  routera.WithOutputPort("Aout0").WithVirtualChannel("VC0");
+  routera.WithOutputPort("Aout1").WithVirtualChannel("VC0");
+
+  builder.WithLink("Link0A").WithSourcePort("SendPort0").WithSinkPort("Ain0");
+  builder.WithLink("Link1A").WithSourcePort("SendPort1").WithSinkPort("Ain1");
+  builder.WithLink("LinkA0")
+      .WithSourcePort("Aout0")
+      .WithSinkPort("RecvPort0")
+      .WithSourceSinkPipelineStage(pipeline_stages);
+  builder.WithLink("LinkA1")
+      .WithSourcePort("Aout1")
+      .WithSinkPort("RecvPort1")
+      .WithSourceSinkPipelineStage(pipeline_stages);
+  return builder.Build();
+}
+
+BatchSimulationOptions UniformTrafficOptions(int64_t thread_count) {
+  BatchSimulationOptions options;
+  options.cycle_count = 200;
+  options.thread_count = thread_count;
+  options.traffic_model_factory = [](int64_t source_count, int64_t sink_count)
+      -> absl::StatusOr<std::unique_ptr<TrafficModel>> {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<UniformRandomTrafficModel> model,
+                         UniformRandomTrafficModel::Create(
+                             source_count, sink_count, 0.5, /*seed=*/7));
+    return std::unique_ptr<TrafficModel>(std::move(model));
+  };
+  return options;
+}
+
+TEST(BatchSimulationTest, ComparesVariants) {
+  std::vector<BatchSimulationVariant> variants;
+  for (int64_t depth : {1, 4}) {
+    for (int64_t stages : {0, 3}) {
+      XLS_ASSERT_OK_AND_ASSIGN(NetworkConfigProto config,
+                               MakeNetwork(depth, stages));
+      variants.push_back(BatchSimulationVariant{
+          absl::StrFormat("depth%d_stages%d", depth, stages), config});
+    }
+  }
+  // A variant that fails to build doesn't stop the others.
+  variants.push_back(BatchSimulationVariant{"empty", NetworkConfigProto()});
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<BatchSimulationResult> serial,
+      RunBatchSimulation(variants, UniformTrafficOptions(1)));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<BatchSimulationResult> parallel,
+      RunBatchSimulation(variants, UniformTrafficOptions(3)));
+  ASSERT_EQ(serial.size(), variants.size());
+  ASSERT_EQ(parallel.size(), variants.size());
+
+  for (int64_t i = 0; i + 1 < variants.size(); ++i) {
+    XLS_EXPECT_OK(serial[i].status) << serial[i].name;
+    EXPECT_EQ(serial[i].name, variants[i].name);
+    EXPECT_EQ(serial[i].source_count, 2);
+    EXPECT_EQ(serial[i].sink_count, 2);
+    EXPECT_GT(serial[i].total.received, 0);
+    // Each variant's simulation is independent of the others.
+    EXPECT_EQ(parallel[i].total.received, serial[i].total.received);
+    EXPECT_EQ(parallel[i].total.latency.buckets(),
+              serial[i].total.latency.buckets());
+  }
+  EXPECT_FALSE(serial.back().status.ok());
+
+  // Longer links add latency.
+  EXPECT_GT(serial[1].total.latency.mean(), serial[0].total.latency.mean());
+
+  std::string table = BatchSimulationResultsToTable(serial);
+  EXPECT_THAT(table, HasSubstr("variant"));
+  EXPECT_THAT(table, HasSubstr("depth4_stages3"));
+  EXPECT_THAT(table, HasSubstr("empty"));
+  EXPECT_THAT(table, HasSubstr("error"));
+}
+
+TEST(BatchSimulationTest, InvalidOptions) {
+  BatchSimulationOptions options = UniformTrafficOptions(0);
+  EXPECT_THAT(RunBatchSimulation({}, options).status(),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace noc
+}  // namespace xls
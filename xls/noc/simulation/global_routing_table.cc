@@ -14,7 +14,9 @@
 
 #include "xls/noc/simulation/global_routing_table.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -174,6 +176,16 @@ DistributedRoutingTable::GetRouterOutputPortByIndex(PortAndVCIndex from,
       sink.AsUInt64()));
 }
 
+absl::Status DistributedRoutingTable::RouteNotFoundError(
+    NetworkComponentId router, PortIndexAndVCIndex from,
+    int64_t destination_index) {
+  return absl::NotFoundError(absl::StrFormat(
+      "Unable to find hop from router %x input port index %d vc %d to sink "
+      "index %d",
+      router.AsUInt64(), from.port_index_, from.vc_index_,
+      destination_index));
+}
+
 void DistributedRoutingTable::AllocateTableForNetwork(NetworkId network_id,
                                                       int64_t component_count) {
   int64_t network_index = network_id.id();
@@ -198,6 +210,7 @@ DistributedRoutingTableBuilderForTrees::BuildNetworkRoutingTables(
   XLS_RET_CHECK_OK(
       BuildPortAndVirtualChannelIndices(network_id, &routing_table));
   XLS_RET_CHECK_OK(BuildRoutingTable(network_id, &routing_table));
+  XLS_RET_CHECK_OK(CompileRoutingTables(network_id, &routing_table));
 
   return routing_table;
 }
@@ -387,5 +400,59 @@ absl::Status DistributedRoutingTableBuilderForTrees::AddRoutes(
   return absl::OkStatus();
 }
 
+absl::Status DistributedRoutingTableBuilderForTrees::CompileRoutingTables(
+    NetworkId network_id, DistributedRoutingTable* routing_table) {
+  NetworkManager* network_manager = routing_table->network_manager_;
+  const PortIndexMap& port_indices = routing_table->GetPortIndices();
+  int64_t destination_count =
+      routing_table->GetSinkIndices().NetworkComponentCount();
+
+  for (NetworkComponent& nc :
+       network_manager->GetNetwork(network_id).GetNetworkComponents()) {
+    if (nc.kind() != NetworkComponentKind::kRouter) {
+      continue;
+    }
+
+    DistributedRoutingTable::RouterRoutingTable& table =
+        routing_table->GetRoutingTable(nc.id());
+    table.input_port_count = nc.GetInputPortIds().size();
+    table.destination_count = destination_count;
+    table.max_vc = 0;
+    for (const std::vector<DistributedRoutingTable::PortRoutingList>&
+             port_routes : table.routes) {
+      table.max_vc = std::max<int64_t>(table.max_vc, port_routes.size());
+    }
+    table.compiled_routes.assign(
+        table.input_port_count * table.max_vc * destination_count,
+        PortIndexAndVCIndex{-1, -1});
+
+    for (Port& port : nc.GetPorts()) {
+      if (port.direction() != PortDirection::kInput ||
+          port.id().id() >= table.routes.size()) {
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(
+          int64_t input_index,
+          port_indices.GetPortIndex(port.id(), PortDirection::kInput));
+      const std::vector<DistributedRoutingTable::PortRoutingList>& vc_routes =
+          table.routes[port.id().id()];
+      for (int64_t vc = 0; vc < vc_routes.size(); ++vc) {
+        for (const std::pair<int64_t, PortAndVCIndex>& hop : vc_routes[vc]) {
+          XLS_ASSIGN_OR_RETURN(
+              int64_t output_index,
+              port_indices.GetPortIndex(hop.second.port_id_,
+                                        PortDirection::kOutput));
+          table.compiled_routes[(input_index * table.max_vc + vc) *
+                                    destination_count +
+                                hop.first] =
+              PortIndexAndVCIndex{output_index, hop.second.vc_index_};
+        }
+      }
+    }
+  }
+
+  return absl::OkStatus();
+}
+
 }  // namespace noc
 }  // namespace xls
@@ -62,6 +62,16 @@ class DistributedRoutingTable {
 
   struct RouterRoutingTable {
     std::vector<std::vector<PortRoutingList>> routes;
+
+    // Compiled form of routes, for constant time lookups: the output port
+    // index and vc for a phit arriving at input port index i and vc with
+    // destination index d is
+    //   compiled_routes[(i * max_vc + vc) * destination_count + d]
+    // or has a port_index_ of -1 if there's no such route.
+    std::vector<PortIndexAndVCIndex> compiled_routes;
+    int64_t input_port_count = 0;
+    int64_t max_vc = 0;
+    int64_t destination_count = 0;
   };
 
   // Returns route to destination from a particular source network interface
@@ -97,8 +107,31 @@ class DistributedRoutingTable {
   absl::StatusOr<PortAndVCIndex> GetRouterOutputPortByIndex(
       PortAndVCIndex from, int64_t destination_index);
 
-  // TODO(tedhong): 2020-01-25 Add indexer for input/output ports of a router
-  //                          and support routing directly via indices.
+  // Given a router, the index of one of its input ports and a local virtual
+  // channel, and final destination index (sink), return the index of the
+  // output port and vc the data should go out on.
+  //
+  // Unlike GetRouterOutputPortByIndex(), this doesn't search the routes, so
+  // it's suitable for forwarding every phit.
+  absl::StatusOr<PortIndexAndVCIndex> GetRouterOutputPortIndexAndVCIndex(
+      NetworkComponentId router, PortIndexAndVCIndex from,
+      int64_t destination_index) {
+    const RouterRoutingTable& table = GetRoutingTable(router);
+    if (from.port_index_ >= 0 && from.port_index_ < table.input_port_count &&
+        from.vc_index_ >= 0 && from.vc_index_ < table.max_vc &&
+        destination_index >= 0 &&
+        destination_index < table.destination_count) {
+      const PortIndexAndVCIndex& to =
+          table.compiled_routes[(from.port_index_ * table.max_vc +
+                                 from.vc_index_) *
+                                    table.destination_count +
+                                destination_index];
+      if (to.port_index_ >= 0) {
+        return to;
+      }
+    }
+    return RouteNotFoundError(router, from, destination_index);
+  }
 
   // Returns mapping of vc params to local indicies.
   const VirtualChannelIndexMap& GetVirtualChannelIndices() {
@@ -126,6 +159,10 @@ class DistributedRoutingTable {
     return routing_tables_[nc_id.network()][nc_id.id()];
   }
 
+  absl::Status RouteNotFoundError(NetworkComponentId router,
+                                  PortIndexAndVCIndex from,
+                                  int64_t destination_index);
+
   // Get possible routes associated with given port and vc.
   PortRoutingList& GetRoutingList(PortAndVCIndex port_and_vc) {
     NetworkComponentId nc_id = port_and_vc.port_id_.GetNetworkComponentId();
@@ -175,6 +212,10 @@ class DistributedRoutingTableBuilderForTrees {
   absl::Status AddRoutes(int64_t destination_index, NetworkComponentId nc,
                          PortId via_port,
                          DistributedRoutingTable* routing_table);
+
+  // Setup the compiled_routes of each router's routing table from its routes.
+  absl::Status CompileRoutingTables(NetworkId network_id,
+                                    DistributedRoutingTable* routing_table);
 };
 
 }  // namespace noc
@@ -169,6 +169,40 @@ TEST(GlobalRoutingTableTest, Index) {
       status_testing::StatusIs(absl::StatusCode::kNotFound,
                                testing::HasSubstr("Unable to find")));
 
+  // The compiled tables agree with the routes.
+  const PortIndexMap& port_indices = routing_table.GetPortIndices();
+  for (NetworkComponentId router : {routera_id, routerb_id}) {
+    for (PortId input : graph.GetNetworkComponent(router).GetInputPortIds()) {
+      XLS_ASSERT_OK_AND_ASSIGN(
+          int64_t input_index,
+          port_indices.GetPortIndex(input, PortDirection::kInput));
+      for (int64_t vc = 0; vc < 2; ++vc) {
+        for (int64_t sink = 0; sink < 4; ++sink) {
+          absl::StatusOr<PortAndVCIndex> hop =
+              routing_table.GetRouterOutputPortByIndex(
+                  PortAndVCIndex{input, vc}, sink);
+          absl::StatusOr<PortIndexAndVCIndex> compiled_hop =
+              routing_table.GetRouterOutputPortIndexAndVCIndex(
+                  router, PortIndexAndVCIndex{input_index, vc}, sink);
+          ASSERT_EQ(hop.ok(), compiled_hop.ok());
+          if (hop.ok()) {
+            EXPECT_THAT(
+                port_indices.GetPortIndex(hop->port_id_,
+                                          PortDirection::kOutput),
+                status_testing::IsOkAndHolds(compiled_hop->port_index_));
+            EXPECT_EQ(hop->vc_index_, compiled_hop->vc_index_);
+          }
+        }
+      }
+    }
+  }
+  EXPECT_THAT(routing_table
+                  .GetRouterOutputPortIndexAndVCIndex(
+                      routera_id, PortIndexAndVCIndex{0, 0}, 4)
+                  .status(),
+              status_testing::StatusIs(absl::StatusCode::kNotFound,
+                                       testing::HasSubstr("Unable to find")));
+
   // Test route.
   XLS_ASSERT_OK_AND_ASSIGN(
       NetworkComponentId routera_nc,
@@ -15,10 +15,17 @@
 #include "xls/noc/simulation/sim_objects.h"
 
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/noc/config/network_config.pb.h"
@@ -83,11 +90,38 @@ bool SimplePipelineImpl<DataTimePhitT, DataPhitT>::TryPropagation(
     XLS_LOG(INFO) << absl::StreamFormat(
         "... link sending data %x valid %d connection", to_.phit.data,
         to_.phit.valid);
+    return true;
   }
 
   return false;
 }
 
+// The phits exchanged with a SimProcRouter's proc are tuples of these
+// widths: valid, vc, destination index, data and payload handle.
+constexpr int64_t kProcPhitFieldWidths[] = {1, 16, 16, 64, 64};
+
+Value PhitToValue(const DataPhit& phit) {
+  return Value::Tuple({Value(UBits(phit.valid, 1)), Value(UBits(phit.vc, 16)),
+                       Value(UBits(phit.destination_index, 16)),
+                       Value(SBits(phit.data, 64)),
+                       Value(SBits(phit.payload, 64))});
+}
+
+absl::StatusOr<DataPhit> ValueToPhit(const Value& value) {
+  XLS_RET_CHECK(value.IsTuple() && value.size() == 5) << value.ToString();
+  DataPhit phit;
+  XLS_ASSIGN_OR_RETURN(uint64_t valid, value.element(0).bits().ToUint64());
+  XLS_ASSIGN_OR_RETURN(uint64_t vc, value.element(1).bits().ToUint64());
+  XLS_ASSIGN_OR_RETURN(uint64_t destination_index,
+                       value.element(2).bits().ToUint64());
+  phit.valid = valid != 0;
+  phit.vc = static_cast<int16_t>(vc);
+  phit.destination_index = static_cast<int16_t>(destination_index);
+  XLS_ASSIGN_OR_RETURN(phit.data, value.element(3).bits().ToInt64());
+  XLS_ASSIGN_OR_RETURN(phit.payload, value.element(4).bits().ToInt64());
+  return phit;
+}
+
 }  // namespace
 
 absl::Status NocSimulator::CreateSimulationObjects(NetworkId network) {
@@ -99,15 +133,101 @@ absl::Status NocSimulator::CreateSimulationObjects(NetworkId network) {
     XLS_RETURN_IF_ERROR(CreateConnection(id));
   }
 
+  // Point the connections at their reverse channels, now that the store
+  // won't grow anymore.
+  int64_t reverse_channel_start = 0;
+  for (SimConnectionState& connection : connections_) {
+    int64_t vc_count = connection.reverse_channels.size();
+    connection.reverse_channels = absl::MakeSpan(
+        reverse_channel_store_.data() + reverse_channel_start, vc_count);
+    reverse_channel_start += vc_count;
+  }
+
   // Create component simulation objects.
   for (int64_t i = 0; i < network_obj.GetNetworkComponentCount(); ++i) {
     NetworkComponentId id = network_obj.GetNetworkComponentIdByIndex(i);
     XLS_RETURN_IF_ERROR(CreateNetworkComponent(id));
   }
 
+  BuildPropagationOrder();
+
   return absl::OkStatus();
 }
 
+std::vector<SimNetworkComponentBase*> NocSimulator::GetComponents() {
+  std::vector<SimNetworkComponentBase*> components;
+  for (SimNetworkInterfaceSrc& nc : network_interface_sources_) {
+    components.push_back(&nc);
+  }
+  for (SimLink& nc : links_) {
+    components.push_back(&nc);
+  }
+  for (SimInputBufferedVCRouter& nc : routers_) {
+    components.push_back(&nc);
+  }
+  for (SimProcRouter& nc : proc_routers_) {
+    components.push_back(&nc);
+  }
+  for (SimNetworkInterfaceSink& nc : network_interface_sinks_) {
+    components.push_back(&nc);
+  }
+  return components;
+}
+
+void NocSimulator::BuildPropagationOrder() {
+  std::vector<SimNetworkComponentBase*> components = GetComponents();
+  absl::flat_hash_map<NetworkComponentId, int64_t> component_index;
+  for (int64_t i = 0; i < components.size(); ++i) {
+    component_index[components[i]->GetId()] = i;
+  }
+
+  // Each connection makes its sink's component depend on its source's.
+  std::vector<std::vector<int64_t>> successors(components.size());
+  std::vector<int64_t> predecessor_count(components.size(), 0);
+  Network& network_obj = mgr_->GetNetwork(network_);
+  for (int64_t i = 0; i < network_obj.GetConnectionCount(); ++i) {
+    Connection& connection =
+        mgr_->GetConnection(network_obj.GetConnectionIdByIndex(i));
+    auto src = component_index.find(connection.src().GetNetworkComponentId());
+    auto sink =
+        component_index.find(connection.sink().GetNetworkComponentId());
+    if (src == component_index.end() || sink == component_index.end()) {
+      continue;
+    }
+    successors[src->second].push_back(sink->second);
+    ++predecessor_count[sink->second];
+  }
+
+  // Kahn's algorithm, taking ready components in serial tick order.
+  std::vector<bool> placed(components.size(), false);
+  std::deque<int64_t> ready;
+  for (int64_t i = 0; i < components.size(); ++i) {
+    if (predecessor_count[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+  propagation_order_.clear();
+  while (!ready.empty()) {
+    int64_t i = ready.front();
+    ready.pop_front();
+    placed[i] = true;
+    propagation_order_.push_back(components[i]);
+    for (int64_t successor : successors[i]) {
+      if (--predecessor_count[successor] == 0) {
+        ready.push_back(successor);
+      }
+    }
+  }
+
+  // Components on (combinational) loops can't be ordered; they go last, and
+  // RunCycle() iterates until they converge.
+  for (int64_t i = 0; i < components.size(); ++i) {
+    if (!placed[i]) {
+      propagation_order_.push_back(components[i]);
+    }
+  }
+}
+
 absl::Status NocSimulator::CreateConnection(ConnectionId connection) {
   // Find number of vc's.
   Connection& connection_obj = mgr_->GetConnection(connection);
@@ -122,6 +242,7 @@ absl::Status NocSimulator::CreateConnection(ConnectionId connection) {
   new_connection.forward_channels.cycle = cycle_;
   new_connection.forward_channels.phit.valid = false;
   new_connection.forward_channels.phit.destination_index = 0;
+  new_connection.forward_channels.phit.payload = DataPhit::kNoPayload;
   new_connection.forward_channels.phit.vc = 0;
   new_connection.forward_channels.phit.data = 0;
 
@@ -129,12 +250,16 @@ absl::Status NocSimulator::CreateConnection(ConnectionId connection) {
     vc_count = 1;
   }
 
-  new_connection.reverse_channels.resize(vc_count);
+  // The channels are added to reverse_channel_store_; until all connections
+  // are created, the span only records their count.
+  new_connection.reverse_channels =
+      absl::Span<TimedMetadataPhit>(nullptr, vc_count);
   for (int64_t i = 0; i < vc_count; ++i) {
-    TimedMetadataPhit& phit = new_connection.reverse_channels[i];
+    TimedMetadataPhit phit;
     phit.cycle = cycle_;
     phit.phit.valid = false;
     phit.phit.data = 0;
+    reverse_channel_store_.push_back(phit);
   }
 
   return absl::OkStatus();
@@ -190,6 +315,13 @@ absl::Status NocSimulator::CreateLink(NetworkComponentId nc_id) {
 }
 
 absl::Status NocSimulator::CreateRouter(NetworkComponentId nc_id) {
+  auto model = proc_router_models_.find(nc_id);
+  if (model != proc_router_models_.end()) {
+    XLS_ASSIGN_OR_RETURN(SimProcRouter sim_obj,
+                         SimProcRouter::Create(nc_id, model->second, *this));
+    proc_routers_.push_back(std::move(sim_obj));
+    return absl::OkStatus();
+  }
   XLS_ASSIGN_OR_RETURN(SimInputBufferedVCRouter sim_obj,
                        SimInputBufferedVCRouter::Create(nc_id, *this));
   routers_.push_back(std::move(sim_obj));
@@ -226,7 +358,17 @@ absl::Status NocSimulator::RunCycle(int64_t max_ticks) {
 
   bool converged = false;
   int64_t nticks = 0;
+  if (tick_phases_.empty()) {
+    XLS_LOG(INFO) << "Levelized sweeps";
+    converged = SweepTick();
+    nticks = 2;
+  }
   while (!converged) {
+    if (nticks >= max_ticks) {
+      return absl::InternalError(absl::StrFormat(
+          "Simulator unable to converge after %d ticks for cycle %d", nticks,
+          cycle_));
+    }
     XLS_LOG(INFO) << absl::StreamFormat("Tick %d", nticks);
     converged = Tick();
     ++nticks;
@@ -251,12 +393,6 @@ absl::Status NocSimulator::RunCycle(int64_t max_ticks) {
           connections_[i].reverse_channels[vc].phit.data,
           connections_[i].reverse_channels[vc].phit.valid);
     }
-
-    if (nticks >= max_ticks) {
-      return absl::InternalError(absl::StrFormat(
-          "Simulator unable to converge after %d ticks for cycle %d", nticks,
-          cycle_));
-    }
   }
 
   return absl::OkStatus();
@@ -265,6 +401,9 @@ absl::Status NocSimulator::RunCycle(int64_t max_ticks) {
 bool NocSimulator::Tick() {
   // Goes through each simulator object and run atick.
   // Converges when everyone returns True -- that determines new cycle
+  if (!tick_phases_.empty()) {
+    return ParallelTick();
+  }
 
   bool converged = true;
 
@@ -303,6 +442,162 @@ bool NocSimulator::Tick() {
   return converged;
 }
 
+bool NocSimulator::SweepTick() {
+  for (SimNetworkComponentBase* nc : propagation_order_) {
+    nc->Tick(*this);
+  }
+  bool converged = true;
+  for (auto it = propagation_order_.rbegin(); it != propagation_order_.rend();
+       ++it) {
+    bool this_converged = (*it)->Tick(*this);
+    converged &= this_converged;
+    XLS_LOG(INFO) << absl::StreamFormat(
+        " NC %x Converged %d", (*it)->GetId().AsUInt64(), this_converged);
+  }
+  return converged;
+}
+
+NocSimulator::~NocSimulator() { StopTickThreads(); }
+
+absl::Status NocSimulator::SetThreadCount(int64_t thread_count) {
+  XLS_RET_CHECK(mgr_ != nullptr) << "SetThreadCount() before Initialize()";
+  StopTickThreads();
+  tick_phases_.clear();
+  if (thread_count <= 1) {
+    return absl::OkStatus();
+  }
+
+  std::vector<SimNetworkComponentBase*> components = GetComponents();
+
+  // Greedily color the components so that the (two) components attached to a
+  // connection get different colors.
+  std::vector<std::vector<int64_t>> connection_colors(connections_.size());
+  std::vector<std::vector<SimNetworkComponentBase*>> colors;
+  for (SimNetworkComponentBase* component : components) {
+    std::vector<int64_t> connection_indices;
+    for (PortId port_id :
+         mgr_->GetNetworkComponent(component->GetId()).GetPortIds()) {
+      auto it = connection_index_map_.find(mgr_->GetPort(port_id).connection());
+      if (it != connection_index_map_.end()) {
+        connection_indices.push_back(it->second);
+      }
+    }
+    int64_t color = 0;
+    bool color_used = true;
+    while (color_used) {
+      color_used = false;
+      for (int64_t index : connection_indices) {
+        if (absl::c_linear_search(connection_colors[index], color)) {
+          color_used = true;
+          ++color;
+          break;
+        }
+      }
+    }
+    for (int64_t index : connection_indices) {
+      connection_colors[index].push_back(color);
+    }
+    if (color >= colors.size()) {
+      colors.resize(color + 1);
+    }
+    colors[color].push_back(component);
+  }
+
+  for (const std::vector<SimNetworkComponentBase*>& color : colors) {
+    std::vector<std::vector<SimNetworkComponentBase*>>& phase =
+        tick_phases_.emplace_back(thread_count);
+    for (int64_t i = 0; i < color.size(); ++i) {
+      phase[i * thread_count / color.size()].push_back(color[i]);
+    }
+  }
+  XLS_LOG(INFO) << absl::StreamFormat(
+      "Ticking %d components in %d phases on %d threads", components.size(),
+      tick_phases_.size(), thread_count);
+
+  int64_t generation;
+  {
+    absl::MutexLock lock(&tick_mutex_);
+    stop_tick_threads_ = false;
+    generation = tick_generation_;
+  }
+  for (int64_t partition = 1; partition < thread_count; ++partition) {
+    tick_threads_.push_back(
+        absl::make_unique<Thread>([this, partition, generation]() {
+          TickWorker(partition, generation);
+        }));
+  }
+  return absl::OkStatus();
+}
+
+void NocSimulator::StopTickThreads() {
+  {
+    absl::MutexLock lock(&tick_mutex_);
+    stop_tick_threads_ = true;
+  }
+  for (std::unique_ptr<Thread>& thread : tick_threads_) {
+    thread->Join();
+  }
+  tick_threads_.clear();
+}
+
+bool NocSimulator::ParallelTick() {
+  {
+    absl::MutexLock lock(&tick_mutex_);
+    tick_converged_ = true;
+  }
+  bool converged = true;
+  for (int64_t phase = 0; phase < tick_phases_.size(); ++phase) {
+    {
+      absl::MutexLock lock(&tick_mutex_);
+      tick_phase_ = phase;
+      tick_pending_ = tick_threads_.size();
+      ++tick_generation_;
+    }
+    converged &= TickPartition(phase, 0);
+
+    absl::MutexLock lock(&tick_mutex_);
+    tick_mutex_.Await(absl::Condition(
+        +[](int64_t* pending) { return *pending == 0; }, &tick_pending_));
+  }
+  absl::MutexLock lock(&tick_mutex_);
+  return converged && tick_converged_;
+}
+
+bool NocSimulator::TickPartition(int64_t phase, int64_t partition) {
+  bool converged = true;
+  for (SimNetworkComponentBase* nc : tick_phases_[phase][partition]) {
+    bool this_converged = nc->Tick(*this);
+    converged &= this_converged;
+    XLS_LOG(INFO) << absl::StreamFormat(" NC %x Converged %d",
+                                        nc->GetId().AsUInt64(), this_converged);
+  }
+  return converged;
+}
+
+void NocSimulator::TickWorker(int64_t partition, int64_t generation) {
+  while (true) {
+    int64_t phase;
+    {
+      absl::MutexLock lock(&tick_mutex_);
+      auto dispatched = [this, &generation]() {
+        tick_mutex_.AssertHeld();
+        return stop_tick_threads_ || tick_generation_ != generation;
+      };
+      tick_mutex_.Await(absl::Condition(&dispatched));
+      if (stop_tick_threads_) {
+        return;
+      }
+      generation = tick_generation_;
+      phase = tick_phase_;
+    }
+    bool converged = TickPartition(phase, partition);
+
+    absl::MutexLock lock(&tick_mutex_);
+    tick_converged_ &= converged;
+    --tick_pending_;
+  }
+}
+
 bool SimNetworkComponentBase::Tick(NocSimulator& simulator) {
   int64_t cycle = simulator.GetCurrentCycle();
 
@@ -370,8 +665,13 @@ absl::Status SimNetworkInterfaceSrc::InitializeImpl(NocSimulator& simulator) {
   NetworkInterfaceSrcParam& param =
       absl::get<NetworkInterfaceSrcParam>(nc_param);
 
-  int64_t virtual_channel_count = param.GetPortParam().VirtualChannelCount();
+  PortParam port_param = param.GetPortParam();
+  int64_t virtual_channel_count = port_param.VirtualChannelCount();
   data_to_send_.resize(virtual_channel_count);
+  for (const VirtualChannelParam& vc_param : port_param.GetVirtualChannels()) {
+    flit_bit_width_.push_back(vc_param.GetFlitDataBitWidth());
+  }
+  payload_pool_ = &simulator.GetPayloadPool();
   credit_.resize(virtual_channel_count, 0);
   credit_update_.resize(virtual_channel_count,
                         CreditState{simulator.GetCurrentCycle(), 0});
@@ -400,6 +700,23 @@ absl::Status SimNetworkInterfaceSrc::SendPhitAtTime(TimedDataPhit phit) {
   }
 }
 
+absl::Status SimNetworkInterfaceSrc::SendPhitWithPayloadAtTime(
+    TimedDataPhit phit, Bits payload) {
+  int64_t vc_index = phit.phit.vc;
+  if (vc_index < flit_bit_width_.size() &&
+      payload.bit_count() > flit_bit_width_[vc_index]) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Payload of %d bits doesn't fit in a flit of vc index %d (%d bits)",
+        payload.bit_count(), vc_index, flit_bit_width_[vc_index]));
+  }
+  phit.phit.payload = payload_pool_->Add(std::move(payload));
+  absl::Status status = SendPhitAtTime(phit);
+  if (!status.ok()) {
+    payload_pool_->Release(phit.phit.payload);
+  }
+  return status;
+}
+
 absl::Status SimNetworkInterfaceSink::InitializeImpl(NocSimulator& simulator) {
   XLS_ASSIGN_OR_RETURN(
       NetworkComponentParam nc_param,
@@ -435,15 +752,15 @@ absl::Status SimInputBufferedVCRouter::InitializeImpl(NocSimulator& simulator) {
 
   // Setup structures associated with the inputs.
   //  - input to SimConnectionState (input_connection_index_start_ and count_)
-  //  - input_buffers_
+  //  - input buffers
   input_connection_count_ = nc.GetInputPortIds().size();
   input_connection_index_start_ =
       simulator.GetNewConnectionIndicesStore(input_connection_count_);
   absl::Span<int64_t> input_indices = simulator.GetConnectionIndicesStore(
       input_connection_index_start_, input_connection_count_);
 
-  input_buffers_.resize(input_connection_count_);
-  input_credit_to_send_.resize(input_connection_count_);
+  std::vector<PortParam> input_port_params;
+  input_vc_count_.resize(input_connection_count_);
   max_vc_ = 0;
   for (int64_t i = 0; i < input_connection_count_; ++i) {
     XLS_ASSIGN_OR_RETURN(
@@ -454,17 +771,26 @@ absl::Status SimInputBufferedVCRouter::InitializeImpl(NocSimulator& simulator) {
 
     XLS_ASSIGN_OR_RETURN(PortParam port_param,
                          simulator.GetNocParameters()->GetPortParam(port_id));
-    std::vector<VirtualChannelParam> vc_params =
-        port_param.GetVirtualChannels();
-
-    input_buffers_[i].resize(port_param.VirtualChannelCount());
-    for (int64_t vc = 0; vc < port_param.VirtualChannelCount(); ++vc) {
-      input_buffers_[i][vc].max_queue_size = vc_params[vc].GetDepth();
-    }
-    input_credit_to_send_[i].resize(port_param.VirtualChannelCount());
+    input_vc_count_[i] = port_param.VirtualChannelCount();
     if (max_vc_ < port_param.VirtualChannelCount()) {
       max_vc_ = port_param.VirtualChannelCount();
     }
+    input_port_params.push_back(std::move(port_param));
+  }
+
+  // Allocate the input buffers, with their phits.
+  input_vc_index_start_ =
+      simulator.GetNewVirtualChannelStore(input_connection_count_ * max_vc_);
+  for (int64_t i = 0; i < input_connection_count_; ++i) {
+    std::vector<VirtualChannelParam> vc_params =
+        input_port_params[i].GetVirtualChannels();
+    for (int64_t vc = 0; vc < input_vc_count_[i]; ++vc) {
+      int64_t depth = vc_params[vc].GetDepth();
+      DataPhitBuffer& buffer = simulator.GetPhitBufferStore(
+          input_vc_index_start_ + i * max_vc_ + vc)[0];
+      buffer.phit_start = simulator.GetNewPhitStore(depth);
+      buffer.capacity = depth;
+    }
   }
 
   // Setup structures associated with the outputs.
@@ -475,8 +801,8 @@ absl::Status SimInputBufferedVCRouter::InitializeImpl(NocSimulator& simulator) {
       simulator.GetNewConnectionIndicesStore(output_connection_count_);
   absl::Span<int64_t> output_indices = simulator.GetConnectionIndicesStore(
       output_connection_index_start_, output_connection_count_);
-  credit_.resize(output_connection_count_);
-  credit_update_.resize(output_connection_count_);
+  output_vc_count_.resize(output_connection_count_);
+  max_output_vc_ = 0;
   for (int64_t i = 0; i < output_connection_count_; ++i) {
     XLS_ASSIGN_OR_RETURN(
         PortId port_id,
@@ -486,10 +812,13 @@ absl::Status SimInputBufferedVCRouter::InitializeImpl(NocSimulator& simulator) {
 
     XLS_ASSIGN_OR_RETURN(PortParam port_param,
                          simulator.GetNocParameters()->GetPortParam(port_id));
-    credit_[i].resize(port_param.VirtualChannelCount(), 0);
-    credit_update_[i].resize(port_param.VirtualChannelCount(),
-                             CreditState{simulator.GetCurrentCycle(), 0});
+    output_vc_count_[i] = port_param.VirtualChannelCount();
+    if (max_output_vc_ < port_param.VirtualChannelCount()) {
+      max_output_vc_ = port_param.VirtualChannelCount();
+    }
   }
+  output_vc_index_start_ = simulator.GetNewVirtualChannelStore(
+      output_connection_count_ * max_output_vc_);
 
   internal_propagated_cycle_ = simulator.GetCurrentCycle();
 
@@ -600,6 +929,7 @@ bool SimNetworkInterfaceSrc::TryForwardPropagation(NocSimulator& simulator) {
     sink.forward_channels.phit.data = 0;
     sink.forward_channels.phit.vc = 0;
     sink.forward_channels.phit.destination_index = 0;
+    sink.forward_channels.phit.payload = DataPhit::kNoPayload;
     sink.forward_channels.cycle = current_cycle;
   }
 
@@ -655,21 +985,13 @@ SimInputBufferedVCRouter::GetDestinationPortIndexAndVcIndex(
     int64_t destination_index) {
   DistributedRoutingTable* routes = simulator.GetRoutingTable();
 
-  XLS_ASSIGN_OR_RETURN(PortId input_port,
-                       routes->GetPortIndices().GetPortByIndex(
-                           GetId(), PortDirection::kInput, input.port_index));
-
-  PortAndVCIndex port_from{input_port, input.vc_index};
-
   XLS_ASSIGN_OR_RETURN(
-      PortAndVCIndex port_to,
-      routes->GetRouterOutputPortByIndex(port_from, destination_index));
+      noc::PortIndexAndVCIndex port_to,
+      routes->GetRouterOutputPortIndexAndVCIndex(
+          GetId(), noc::PortIndexAndVCIndex{input.port_index, input.vc_index},
+          destination_index));
 
-  XLS_ASSIGN_OR_RETURN(int64_t output_port_index,
-                       routes->GetPortIndices().GetPortIndex(
-                           port_to.port_id_, PortDirection::kOutput));
-
-  return PortIndexAndVCIndex{output_port_index, port_to.vc_index_};
+  return PortIndexAndVCIndex{port_to.port_index_, port_to.vc_index_};
 }
 
 bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
@@ -683,22 +1005,32 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
       simulator.GetConnectionIndicesStore(output_connection_index_start_,
                                           output_connection_count_);
 
+  absl::Span<DataPhitBuffer> input_buffers = simulator.GetPhitBufferStore(
+      input_vc_index_start_, input_connection_count_ * max_vc_);
+  absl::Span<int64_t> input_credit_to_send = simulator.GetCreditStore(
+      input_vc_index_start_, input_connection_count_ * max_vc_);
+  absl::Span<int64_t> credit = simulator.GetCreditStore(
+      output_vc_index_start_, output_connection_count_ * max_output_vc_);
+  absl::Span<CreditState> credit_update = simulator.GetCreditUpdateStore(
+      output_vc_index_start_, output_connection_count_ * max_output_vc_);
+
   // Update credits (for output ports)
   if (internal_propagated_cycle_ != current_cycle) {
-    for (int64_t i = 0; i < credit_update_.size(); ++i) {
-      for (int64_t vc = 0; vc < credit_update_[i].size(); ++vc) {
-        if (credit_update_[i][vc].credit > 0) {
-          credit_[i][vc] += credit_update_[i][vc].credit;
+    for (int64_t i = 0; i < output_connection_count_; ++i) {
+      for (int64_t vc = 0; vc < output_vc_count_[i]; ++vc) {
+        int64_t index = i * max_output_vc_ + vc;
+        if (credit_update[index].credit > 0) {
+          credit[index] += credit_update[index].credit;
           XLS_LOG(INFO) << absl::StrFormat(
               "... router %x output port %d vc %d added credits %d, now %d",
-              GetId().AsUInt64(), i, vc, credit_update_[i][vc].credit,
-              credit_[i][vc]);
+              GetId().AsUInt64(), i, vc, credit_update[index].credit,
+              credit[index]);
         } else {
           XLS_LOG(INFO) << absl::StrFormat(
               "... router %x output port %d vc %d did not add credits %d, now "
               "%d",
-              GetId().AsUInt64(), i, vc, credit_update_[i][vc].credit,
-              credit_[i][vc]);
+              GetId().AsUInt64(), i, vc, credit_update[index].credit,
+              credit[index]);
         }
       }
     }
@@ -723,10 +1055,8 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
   }
 
   // Reset credits to send on reverse channel to 0.
-  for (int64_t i = 0; i < input_connection_count_; ++i) {
-    for (int64_t vc = 0; vc < input_credit_to_send_[i].size(); ++vc) {
-      input_credit_to_send_[i][vc] = 0;
-    }
+  for (int64_t& credit_to_send : input_credit_to_send) {
+    credit_to_send = 0;
   }
 
   // This router supports bypass so an phit arriving at the
@@ -737,7 +1067,8 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
 
     if (input.forward_channels.phit.valid) {
       int64_t vc = input.forward_channels.phit.vc;
-      input_buffers_[i][vc].queue.push(input.forward_channels.phit);
+      simulator.PushPhit(input_buffers[i * max_vc_ + vc],
+                         input.forward_channels.phit);
 
       XLS_LOG(INFO) << absl::StrFormat(
           "... router %x from %x received data %x port %d vc %d",
@@ -749,17 +1080,18 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
   // Use fixed priority to route to output ports.
   // Priority goes to the port with the least vc and the least port index.
   for (int64_t vc = 0; vc < max_vc_; ++vc) {
-    for (int64_t i = 0; i < input_buffers_.size(); ++i) {
-      if (vc >= input_buffers_[i].size()) {
+    for (int64_t i = 0; i < input_connection_count_; ++i) {
+      if (vc >= input_vc_count_[i]) {
         continue;
       }
 
       // See if we have a flit to route and can route it.
-      if (input_buffers_[i][vc].queue.empty()) {
+      DataPhitBuffer& input_buffer = input_buffers[i * max_vc_ + vc];
+      if (input_buffer.size == 0) {
         continue;
       }
 
-      DataPhit phit = input_buffers_[i][vc].queue.front();
+      DataPhit phit = simulator.FrontPhit(input_buffer);
       int64_t destination_index = phit.destination_index;
 
       PortIndexAndVCIndex input{i, vc};
@@ -768,15 +1100,16 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
                                             destination_index);
       XLS_CHECK_OK(output_status.status());
       PortIndexAndVCIndex output = output_status.value();
+      XLS_CHECK_LT(output.vc_index, output_vc_count_.at(output.port_index));
+      int64_t& output_credit =
+          credit[output.port_index * max_output_vc_ + output.vc_index];
 
       // Now see if we have sufficient credits.
-      if (credit_.at(output.port_index).at(output.vc_index) <= 0) {
+      if (output_credit <= 0) {
         XLS_LOG(INFO) << absl::StreamFormat(
             "... router unable to send data %x vc %d credit now %d"
             " from port index %d to port index %d.",
-            phit.data, phit.vc,
-            credit_.at(output.port_index).at(output.vc_index), i,
-            output.port_index);
+            phit.data, phit.vc, output_credit, i, output.port_index);
         continue;
       }
 
@@ -795,18 +1128,17 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
       output_state.forward_channels.cycle = current_cycle;
 
       // Update credit on output.
-      --credit_.at(output.port_index).at(output.vc_index);
+      --output_credit;
 
       // Update credit to send back to input.
-      ++input_credit_to_send_[i][vc];
-      input_buffers_[i][vc].queue.pop();
+      ++input_credit_to_send[i * max_vc_ + vc];
+      simulator.PopPhit(input_buffer);
 
       XLS_LOG(INFO) << absl::StreamFormat(
           "... router sending data %x vc %d credit now %d"
           " from port index %d to port index %d on %x.",
           output_state.forward_channels.phit.data,
-          output_state.forward_channels.phit.vc,
-          credit_.at(output.port_index).at(output.vc_index), i,
+          output_state.forward_channels.phit.vc, output_credit, i,
           output.port_index, output_state.id.AsUInt64());
     }
   }
@@ -821,6 +1153,7 @@ bool SimInputBufferedVCRouter::TryForwardPropagation(NocSimulator& simulator) {
       output.forward_channels.phit.data = 0;
       output.forward_channels.phit.vc = 0;
       output.forward_channels.phit.destination_index = 0;
+      output.forward_channels.phit.payload = DataPhit::kNoPayload;
     }
   }
 
@@ -840,6 +1173,10 @@ bool SimInputBufferedVCRouter::TryReversePropagation(NocSimulator& simulator) {
   absl::Span<int64_t> input_connection_index =
       simulator.GetConnectionIndicesStore(input_connection_index_start_,
                                           input_connection_count_);
+  absl::Span<DataPhitBuffer> input_buffers = simulator.GetPhitBufferStore(
+      input_vc_index_start_, input_connection_count_ * max_vc_);
+  absl::Span<int64_t> input_credit_to_send = simulator.GetCreditStore(
+      input_vc_index_start_, input_connection_count_ * max_vc_);
 
   // Send credit upstream.
   for (int64_t i = 0; i < input_connection_count_; ++i) {
@@ -852,9 +1189,10 @@ bool SimInputBufferedVCRouter::TryReversePropagation(NocSimulator& simulator) {
       // Upon reset (cycle-0) a full update of credits is sent.
       if (current_cycle == 0) {
         input.reverse_channels[vc].phit.data =
-            input_buffers_[i][vc].max_queue_size;
+            input_buffers.at(i * max_vc_ + vc).capacity;
       } else {
-        input.reverse_channels[vc].phit.data = input_credit_to_send_[i][vc];
+        input.reverse_channels[vc].phit.data =
+            input_credit_to_send.at(i * max_vc_ + vc);
       }
       input.reverse_channels[vc].cycle = current_cycle;
 
@@ -871,25 +1209,29 @@ bool SimInputBufferedVCRouter::TryReversePropagation(NocSimulator& simulator) {
       simulator.GetConnectionIndicesStore(output_connection_index_start_,
                                           output_connection_count_);
 
+  absl::Span<CreditState> credit_update = simulator.GetCreditUpdateStore(
+      output_vc_index_start_, output_connection_count_ * max_output_vc_);
+
   int64_t num_propagated = 0;
   int64_t possible_propagation = 0;
-  for (int64_t i = 0; i < credit_update_.size(); ++i) {
+  for (int64_t i = 0; i < output_connection_count_; ++i) {
     SimConnectionState& output =
         simulator.GetSimConnectionByIndex(output_connection_index.at(i));
 
-    for (int64_t vc = 0; vc < credit_update_[i].size(); ++vc) {
+    for (int64_t vc = 0; vc < output_vc_count_[i]; ++vc) {
       TimedMetadataPhit possible_credit = output.reverse_channels[vc];
+      CreditState& vc_credit_update = credit_update[i * max_output_vc_ + vc];
 
       if (possible_credit.cycle == current_cycle) {
-        if (credit_update_[i][vc].cycle != current_cycle) {
-          credit_update_[i][vc].cycle = current_cycle;
-          credit_update_[i][vc].credit =
+        if (vc_credit_update.cycle != current_cycle) {
+          vc_credit_update.cycle = current_cycle;
+          vc_credit_update.credit =
               possible_credit.phit.valid ? possible_credit.phit.data : 0;
 
           XLS_LOG(INFO) << absl::StreamFormat(
               "... router received credit %d output port %d vc %d via "
               "connection %x",
-              credit_update_[i][vc].credit, i, vc, output.id.AsUInt64());
+              vc_credit_update.credit, i, vc, output.id.AsUInt64());
         }
 
         ++num_propagated;
@@ -972,6 +1314,246 @@ bool SimNetworkInterfaceSink::TryForwardPropagation(NocSimulator& simulator) {
   return true;
 }
 
+absl::StatusOr<Channel*> SimProcRouter::GetChannel(absl::string_view name,
+                                                   Type* type) {
+  XLS_ASSIGN_OR_RETURN(Channel * channel, model_.package->GetChannel(name));
+  if (channel->type() != type) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Channel %s of router proc %s has type %s, expected %s", name,
+        proc_->name(), channel->type()->ToString(), type->ToString()));
+  }
+  return channel;
+}
+
+absl::Status SimProcRouter::InitializeImpl(NocSimulator& simulator) {
+  XLS_RET_CHECK(model_.package != nullptr);
+  XLS_ASSIGN_OR_RETURN(proc_, model_.package->GetProc(model_.proc_name));
+  XLS_ASSIGN_OR_RETURN(queue_mgr_,
+                       JitChannelQueueManager::Create(model_.package));
+  XLS_ASSIGN_OR_RETURN(jit_, IrJit::CreateProc(proc_, queue_mgr_.get(),
+                                               &RecvFn, &SendFn));
+  state_.resize(jit_->GetReturnTypeSize());
+  jit_->runtime()->BlitValueToBuffer(proc_->InitValue(), proc_->StateType(),
+                                     absl::MakeSpan(state_));
+
+  std::vector<Type*> phit_field_types;
+  for (int64_t width : kProcPhitFieldWidths) {
+    phit_field_types.push_back(model_.package->GetBitsType(width));
+  }
+  Type* phit_type = model_.package->GetTupleType(phit_field_types);
+  auto credit_type = [&](int64_t connection_index) {
+    int64_t vc_count =
+        simulator.GetSimConnectionByIndex(connection_index)
+            .reverse_channels.size();
+    return model_.package->GetArrayType(vc_count,
+                                        model_.package->GetBitsType(64));
+  };
+
+  NetworkManager* network_manager = simulator.GetNetworkManager();
+  NetworkComponent& nc = network_manager->GetNetworkComponent(id_);
+  const PortIndexMap& port_indexer =
+      simulator.GetRoutingTable()->GetPortIndices();
+
+  int64_t input_count = nc.GetInputPortIds().size();
+  for (int64_t i = 0; i < input_count; ++i) {
+    XLS_ASSIGN_OR_RETURN(
+        PortId port_id,
+        port_indexer.GetPortByIndex(nc.id(), PortDirection::kInput, i));
+    int64_t connection_index = simulator.GetConnectionIndex(
+        network_manager->GetPort(port_id).connection());
+    input_connection_index_.push_back(connection_index);
+    XLS_ASSIGN_OR_RETURN(Channel * input,
+                         GetChannel(absl::StrCat("in", i), phit_type));
+    input_channels_.push_back(input);
+    XLS_ASSIGN_OR_RETURN(Channel * credit_output,
+                         GetChannel(absl::StrCat("credit_out", i),
+                                    credit_type(connection_index)));
+    credit_output_channels_.push_back(credit_output);
+    credit_to_send_.emplace_back(
+        simulator.GetSimConnectionByIndex(connection_index)
+            .reverse_channels.size(),
+        0);
+  }
+
+  int64_t output_count = nc.GetOutputPortIds().size();
+  for (int64_t i = 0; i < output_count; ++i) {
+    XLS_ASSIGN_OR_RETURN(
+        PortId port_id,
+        port_indexer.GetPortByIndex(nc.id(), PortDirection::kOutput, i));
+    int64_t connection_index = simulator.GetConnectionIndex(
+        network_manager->GetPort(port_id).connection());
+    output_connection_index_.push_back(connection_index);
+    XLS_ASSIGN_OR_RETURN(Channel * output,
+                         GetChannel(absl::StrCat("out", i), phit_type));
+    output_channels_.push_back(output);
+    XLS_ASSIGN_OR_RETURN(Channel * credit_input,
+                         GetChannel(absl::StrCat("credit_in", i),
+                                    credit_type(connection_index)));
+    credit_input_channels_.push_back(credit_input);
+    credit_update_.emplace_back(
+        simulator.GetSimConnectionByIndex(connection_index)
+            .reverse_channels.size(),
+        CreditState{simulator.GetCurrentCycle(), 0});
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status SimProcRouter::EnqueueValue(Channel* channel,
+                                         const Value& value) {
+  int64_t size = jit_->type_converter()->GetTypeByteSize(channel->type());
+  std::vector<uint8_t> buffer(size);
+  jit_->runtime()->BlitValueToBuffer(value, channel->type(),
+                                     absl::MakeSpan(buffer));
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr_->GetQueueById(channel->id()));
+  queue->Send(buffer.data(), size);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> SimProcRouter::DequeueValue(Channel* channel) {
+  XLS_ASSIGN_OR_RETURN(JitChannelQueue * queue,
+                       queue_mgr_->GetQueueById(channel->id()));
+  if (queue->Empty()) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("Router proc %s did not send on channel %s",
+                        proc_->name(), channel->name()));
+  }
+  int64_t size = jit_->type_converter()->GetTypeByteSize(channel->type());
+  std::vector<uint8_t> buffer(size);
+  queue->Recv(buffer.data(), size);
+  if (!queue->Empty()) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("Router proc %s sent more than once on channel %s",
+                        proc_->name(), channel->name()));
+  }
+  return jit_->runtime()->UnpackBuffer(buffer.data(), channel->type());
+}
+
+void SimProcRouter::RecvFn(JitChannelQueue* queue, Receive* recv,
+                           uint8_t* data, int64_t data_bytes,
+                           void* user_data) {
+  if (queue->Empty()) {
+    reinterpret_cast<SimProcRouter*>(user_data)->recv_underflow_ = true;
+    memset(data, 0, data_bytes);
+    return;
+  }
+  queue->Recv(data, data_bytes);
+}
+
+void SimProcRouter::SendFn(JitChannelQueue* queue, Send* send, uint8_t* data,
+                           int64_t data_bytes, void* user_data) {
+  queue->Send(data, data_bytes);
+}
+
+absl::Status SimProcRouter::TickProc(NocSimulator& simulator) {
+  int64_t current_cycle = simulator.GetCurrentCycle();
+
+  for (int64_t i = 0; i < input_channels_.size(); ++i) {
+    SimConnectionState& input =
+        simulator.GetSimConnectionByIndex(input_connection_index_[i]);
+    XLS_RETURN_IF_ERROR(EnqueueValue(
+        input_channels_[i], PhitToValue(input.forward_channels.phit)));
+  }
+  for (int64_t i = 0; i < credit_input_channels_.size(); ++i) {
+    std::vector<Value> credits;
+    for (const CreditState& credit : credit_update_[i]) {
+      credits.push_back(Value(UBits(credit.credit, 64)));
+    }
+    XLS_RETURN_IF_ERROR(
+        EnqueueValue(credit_input_channels_[i], Value::ArrayOrDie(credits)));
+  }
+
+  // RunWithViews takes an array of arg view pointers - even if they're
+  // unused during execution, tokens still occupy one of those spots.
+  recv_underflow_ = false;
+  std::vector<uint8_t*> args({nullptr, state_.data()});
+  XLS_RETURN_IF_ERROR(jit_->RunWithViews(absl::MakeSpan(args),
+                                         absl::MakeSpan(state_), this));
+  if (recv_underflow_) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Router proc %s received more than once from a channel in a tick",
+        proc_->name()));
+  }
+
+  for (int64_t i = 0; i < output_channels_.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(Value value, DequeueValue(output_channels_[i]));
+    XLS_ASSIGN_OR_RETURN(DataPhit phit, ValueToPhit(value));
+    SimConnectionState& output =
+        simulator.GetSimConnectionByIndex(output_connection_index_[i]);
+    output.forward_channels.phit = phit;
+    output.forward_channels.cycle = current_cycle;
+
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "... proc router %x sending data %x valid %d vc %d on %x",
+        GetId().AsUInt64(), phit.data, phit.valid, phit.vc,
+        output.id.AsUInt64());
+  }
+  for (int64_t i = 0; i < credit_output_channels_.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(Value credits,
+                         DequeueValue(credit_output_channels_[i]));
+    for (int64_t vc = 0; vc < credit_to_send_[i].size(); ++vc) {
+      XLS_ASSIGN_OR_RETURN(credit_to_send_[i][vc],
+                           credits.element(vc).bits().ToInt64());
+    }
+  }
+  return absl::OkStatus();
+}
+
+bool SimProcRouter::TryForwardPropagation(NocSimulator& simulator) {
+  int64_t current_cycle = simulator.GetCurrentCycle();
+
+  for (int64_t index : input_connection_index_) {
+    if (simulator.GetSimConnectionByIndex(index).forward_channels.cycle !=
+        current_cycle) {
+      return false;
+    }
+  }
+
+  XLS_CHECK_OK(TickProc(simulator));
+  forward_propagated_cycle_ = current_cycle;
+  return true;
+}
+
+bool SimProcRouter::TryReversePropagation(NocSimulator& simulator) {
+  int64_t current_cycle = simulator.GetCurrentCycle();
+
+  // Reverse propagation occurs only after forward propagation.
+  if (forward_propagated_cycle_ != current_cycle) {
+    return false;
+  }
+
+  // Send credit upstream.
+  for (int64_t i = 0; i < input_connection_index_.size(); ++i) {
+    SimConnectionState& input =
+        simulator.GetSimConnectionByIndex(input_connection_index_[i]);
+    for (int64_t vc = 0; vc < input.reverse_channels.size(); ++vc) {
+      input.reverse_channels[vc].phit.valid = true;
+      input.reverse_channels[vc].phit.data = credit_to_send_[i][vc];
+      input.reverse_channels[vc].cycle = current_cycle;
+    }
+  }
+
+  // Receive credit from downstream.
+  bool converged = true;
+  for (int64_t i = 0; i < output_connection_index_.size(); ++i) {
+    SimConnectionState& output =
+        simulator.GetSimConnectionByIndex(output_connection_index_[i]);
+    for (int64_t vc = 0; vc < output.reverse_channels.size(); ++vc) {
+      TimedMetadataPhit possible_credit = output.reverse_channels[vc];
+      CreditState& vc_credit_update = credit_update_[i][vc];
+      if (possible_credit.cycle != current_cycle) {
+        converged = false;
+      } else if (vc_credit_update.cycle != current_cycle) {
+        vc_credit_update.cycle = current_cycle;
+        vc_credit_update.credit =
+            possible_credit.phit.valid ? possible_credit.phit.data : 0;
+      }
+    }
+  }
+  return converged;
+}
+
 absl::StatusOr<SimNetworkInterfaceSrc*> NocSimulator::GetSimNetworkInterfaceSrc(
     NetworkComponentId src) {
   auto iter = src_index_map_.find(src);
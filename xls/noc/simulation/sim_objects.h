@@ -16,10 +16,27 @@
 #define XLS_NOC_SIMULATION_SIM_OBJECTS_H_
 
 #include <cstdint>
+#include <memory>
 #include <queue>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/thread.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/channel.h"
+#include "xls/ir/package.h"
+#include "xls/ir/proc.h"
+#include "xls/ir/value.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/jit/jit_channel_queue.h"
 #include "xls/noc/simulation/common.h"
 #include "xls/noc/simulation/global_routing_table.h"
 #include "xls/noc/simulation/parameters.h"
@@ -34,12 +51,52 @@ namespace noc {
 
 // Represents a phit being sent from a source to a sink (forward).
 struct DataPhit {
-  // TODO(tedhong) : 2020-01-24 - Convert to use Bits/DSLX structs.
+  // Value of payload for phits without one.
+  static constexpr int64_t kNoPayload = -1;
+
   // TODO(tedhong) : 2020-02-20 - Add fluent phit builder to initialize struct.
   bool valid;
   int16_t destination_index;
   int16_t vc;
   int64_t data;
+
+  // Handle of the phit's payload in the simulator's PhitPayloadPool, or
+  // kNoPayload. Payloads can be arbitrarily wide, and are moved through the
+  // network by handle (i.e. without being copied at each hop).
+  int64_t payload = kNoPayload;
+};
+
+// Stores the payloads of the phits in flight.
+class PhitPayloadPool {
+ public:
+  // Adds "payload" to the pool and returns its handle.
+  int64_t Add(Bits payload) {
+    if (free_handles_.empty()) {
+      payloads_.push_back(std::move(payload));
+      return payloads_.size() - 1;
+    }
+    int64_t handle = free_handles_.back();
+    free_handles_.pop_back();
+    payloads_[handle] = std::move(payload);
+    return handle;
+  }
+
+  const Bits& Get(int64_t handle) const { return payloads_.at(handle); }
+
+  // Removes the payload with the given handle from the pool and returns it;
+  // the handle may then be reused.
+  Bits Release(int64_t handle) {
+    Bits payload = std::move(payloads_.at(handle));
+    free_handles_.push_back(handle);
+    return payload;
+  }
+
+  // Returns the number of payloads in the pool.
+  int64_t size() const { return payloads_.size() - free_handles_.size(); }
+
+ private:
+  std::vector<Bits> payloads_;
+  std::vector<int64_t> free_handles_;
 };
 
 // Associates a phit with a time (cycle).
@@ -66,7 +123,8 @@ struct TimedMetadataPhit {
 struct SimConnectionState {
   ConnectionId id;
   TimedDataPhit forward_channels;
-  std::vector<TimedMetadataPhit> reverse_channels;
+  // Stored in the simulator's reverse channel store, indexed by vc.
+  absl::Span<TimedMetadataPhit> reverse_channels;
 };
 
 // Used to store the valid credit available at a certain time.
@@ -81,6 +139,15 @@ struct DataFlitQueue {
   int64_t max_queue_size;
 };
 
+// Represents a fifo/buffer of up to capacity phits, stored as a ring in
+// NocSimulator::GetPhitStore(phit_start, capacity).
+struct DataPhitBuffer {
+  int64_t phit_start;
+  int64_t capacity;
+  int64_t head;
+  int64_t size;
+};
+
 // Represents a fifo/buffer used to store metadata phits.
 struct MetadataFlitQueue {
   std::queue<MetadataPhit> queue;
@@ -207,6 +274,13 @@ class SimNetworkInterfaceSrc : public SimNetworkComponentBase {
   // Register a phit to be sent at a specific time.
   absl::Status SendPhitAtTime(TimedDataPhit phit);
 
+  // Register a phit carrying "payload" to be sent at a specific time.
+  //
+  // The payload is added to the simulator's payload pool, and must fit in
+  // a flit of the phit's vc. Once received, it should be released from the
+  // pool by the receiver (see NocSimulator::GetPayloadPool()).
+  absl::Status SendPhitWithPayloadAtTime(TimedDataPhit phit, Bits payload);
+
  private:
   SimNetworkInterfaceSrc() = default;
 
@@ -217,6 +291,10 @@ class SimNetworkInterfaceSrc : public SimNetworkComponentBase {
   int64_t sink_connection_index_;
   std::vector<int64_t> credit_;
   std::vector<CreditState> credit_update_;
+  PhitPayloadPool* payload_pool_;
+
+  // The flit data width of each vc.
+  std::vector<int64_t> flit_bit_width_;
   std::vector<std::queue<TimedDataPhit>> data_to_send_;
 };
 
@@ -236,6 +314,10 @@ class SimNetworkInterfaceSink : public SimNetworkComponentBase {
     return received_traffic_;
   }
 
+  // Drops the traffic received so far, e.g. once it's been accounted for by
+  // long-running simulations.
+  void ClearReceivedTraffic() { received_traffic_.clear(); }
+
  private:
   SimNetworkInterfaceSink() = default;
 
@@ -324,23 +406,138 @@ class SimInputBufferedVCRouter : public SimNetworkComponentBase {
   // updated its credit count from the updates received in the previous cycle.
   int64_t internal_propagated_cycle_;
 
-  // Stores the input buffers associated with each input port and vc.
-  std::vector<std::vector<DataFlitQueue>> input_buffers_;
-
-  // Stores the credit count associated with each output port and vc.
-  // Each cycle, the router updates its credit count from credit_update_.
-  std::vector<std::vector<int64_t>> credit_;
-
-  // Stores the credit count received on cycle N-1.
-  std::vector<std::vector<CreditState>> credit_update_;
-
   // The maximum number of vcs on for an input port.
   // Used for the priority scheme implementation.
   int64_t max_vc_;
 
-  // Used by forward propagation to store the number of phits that left
-  // the input buffers and hence credits that can be sent back upstream.
-  std::vector<std::vector<int64_t>> input_credit_to_send_;
+  // The maximum number of vcs on for an output port.
+  int64_t max_output_vc_;
+
+  // The number of vcs of each input and output port.
+  std::vector<int64_t> input_vc_count_;
+  std::vector<int64_t> output_vc_count_;
+
+  // The state of input port i and vc is at index
+  // input_vc_index_start_ + i * max_vc_ + vc of the simulator's virtual
+  // channel stores:
+  //  - the phit buffer stores the input buffers.
+  //  - the credit store is used by forward propagation to store the number
+  //    of phits that left the input buffers and hence credits that can be
+  //    sent back upstream.
+  int64_t input_vc_index_start_;
+
+  // The state of output port i and vc is at index
+  // output_vc_index_start_ + i * max_output_vc_ + vc of the simulator's
+  // virtual channel stores:
+  //  - the credit store stores the credit count. Each cycle, the router
+  //    updates its credit count from the credit update store.
+  //  - the credit update store stores the credit count received on cycle N-1.
+  int64_t output_vc_index_start_;
+};
+
+// Describes the XLS proc modeling a router (see SimProcRouter).
+struct ProcRouterModel {
+  // The package holding the proc. Does not take ownership of the package,
+  // which must outlive the simulator.
+  Package* package;
+  std::string proc_name;
+};
+
+// Represents a router whose logic is an XLS proc, JIT-compiled and ticked once
+// per cycle, so that the actual router implementation can be simulated
+// alongside the behavioral models of the other components.
+//
+// On each tick, the proc must receive exactly once from each of the channels
+//   - in<i>: the phit arriving on input port i,
+//   - credit_in<o>: the credits received from downstream of output port o on
+//     the previous cycle,
+// and send exactly once on each of the channels
+//   - out<o>: the phit leaving on output port o (invalid if none),
+//   - credit_out<i>: the credits to send upstream of input port i,
+// where ports are indexed as in the routing table's port indices.
+//
+// Phits have type (bits[1], bits[16], bits[16], bits[64], bits[64]) holding
+// the valid bit, vc, destination index, data and payload handle (all ones if
+// none) of a DataPhit; the proc must forward the payload handle with its
+// phit. Credits have type bits[64][N], with an element for each of the N
+// virtual channels of the port's connection. As the behavioral router does,
+// the proc should send a full credit update upstream on its first tick.
+//
+// Each router compiles its own instance of the proc, with its own state and
+// channel queues.
+class SimProcRouter : public SimNetworkComponentBase {
+ public:
+  static absl::StatusOr<SimProcRouter> Create(NetworkComponentId nc_id,
+                                              const ProcRouterModel& model,
+                                              NocSimulator& simulator) {
+    SimProcRouter ret;
+    ret.model_ = model;
+    XLS_RETURN_IF_ERROR(ret.Initialize(nc_id, simulator));
+    return ret;
+  }
+
+ private:
+  SimProcRouter() = default;
+
+  absl::Status InitializeImpl(NocSimulator& simulator) override;
+
+  // Forward propagation
+  //  1. Waits until all input ports are ready.
+  //  2. Ticks the proc on the input phits and the credits received on the
+  //     previous cycle, and sends the phits it produces downstream.
+  bool TryForwardPropagation(NocSimulator& simulator) override;
+
+  // Reverse propagation
+  //  1. Sends the credits produced by the proc's tick upstream.
+  //  2. Registers credits received from downstream.
+  bool TryReversePropagation(NocSimulator& simulator) override;
+
+  // Runs the steps of forward propagation after the inputs are ready.
+  absl::Status TickProc(NocSimulator& simulator);
+
+  // Returns the channel "name" of the proc, checking it has type "type".
+  absl::StatusOr<Channel*> GetChannel(absl::string_view name, Type* type);
+
+  absl::Status EnqueueValue(Channel* channel, const Value& value);
+  absl::StatusOr<Value> DequeueValue(Channel* channel);
+
+  // Receive and send handlers of the proc. A proc must not block within a
+  // tick, so receiving from an empty queue is recorded as an error.
+  static void RecvFn(JitChannelQueue* queue, Receive* recv, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+  static void SendFn(JitChannelQueue* queue, Send* send, uint8_t* data,
+                     int64_t data_bytes, void* user_data);
+
+  ProcRouterModel model_;
+  Proc* proc_;
+  std::unique_ptr<JitChannelQueueManager> queue_mgr_;
+  std::unique_ptr<IrJit> jit_;
+
+  // The proc's state between ticks, laid out as a JIT result view.
+  std::vector<uint8_t> state_;
+
+  // Set if the proc received from an empty queue during the last tick.
+  bool recv_underflow_;
+
+  // For each input port: its connection index, and the channels of phits
+  // received and credits sent upstream.
+  std::vector<int64_t> input_connection_index_;
+  std::vector<Channel*> input_channels_;
+  std::vector<Channel*> credit_output_channels_;
+
+  // For each output port: its connection index, and the channels of phits
+  // sent and credits received from downstream.
+  std::vector<int64_t> output_connection_index_;
+  std::vector<Channel*> output_channels_;
+  std::vector<Channel*> credit_input_channels_;
+
+  // The credits to send upstream of each input port and vc, produced by the
+  // last tick.
+  std::vector<std::vector<int64_t>> credit_to_send_;
+
+  // The credits received from downstream of each output port and vc on the
+  // last cycle their reverse propagation ran.
+  std::vector<std::vector<CreditState>> credit_update_;
 };
 
 // Main simulator class that drives the simulation and stores simulation
@@ -350,6 +547,8 @@ class NocSimulator {
   NocSimulator()
       : mgr_(nullptr), params_(nullptr), routing_(nullptr), cycle_(-1) {}
 
+  ~NocSimulator();
+
   // Creates all simulation objects for a given network.
   // NetworkManager, NocParameters, and DistributedRoutingTable should
   // have aleady been setup.
@@ -366,6 +565,13 @@ class NocSimulator {
 
   NetworkManager* GetNetworkManager() { return mgr_; }
   NocParameters* GetNocParameters() { return params_; }
+
+  // Simulates the router "router" with an XLS proc (see SimProcRouter) rather
+  // than a SimInputBufferedVCRouter. Must be called before Initialize().
+  void SetProcRouterModel(NetworkComponentId router, ProcRouterModel model) {
+    proc_router_models_[router] = std::move(model);
+  }
+
   DistributedRoutingTable* GetRoutingTable() { return routing_; }
 
   // Maps a given connection id to its index in the connection store.
@@ -410,12 +616,76 @@ class NocSimulator {
     return next_start;
   }
 
+  // Allocates and returns an index that can be used with the
+  // Get*Store(index, size) functions below to retrieve the state of size
+  // virtual channels.
+  //
+  // The state of the virtual channels is stored as a structure of arrays:
+  // the buffers, credits and credit updates of all components are each
+  // contiguous, which keeps the router's inner loops free of indirections.
+  int64_t GetNewVirtualChannelStore(int64_t size) {
+    int64_t next_start = phit_buffer_store_.size();
+    phit_buffer_store_.resize(next_start + size, DataPhitBuffer{0, 0, 0, 0});
+    credit_store_.resize(next_start + size, 0);
+    credit_update_store_.resize(next_start + size, CreditState{cycle_, 0});
+    return next_start;
+  }
+
+  absl::Span<DataPhitBuffer> GetPhitBufferStore(int64_t start,
+                                                int64_t size = 1) {
+    return absl::Span<DataPhitBuffer>(phit_buffer_store_.data() + start, size);
+  }
+
+  absl::Span<int64_t> GetCreditStore(int64_t start, int64_t size = 1) {
+    return absl::Span<int64_t>(credit_store_.data() + start, size);
+  }
+
+  absl::Span<CreditState> GetCreditUpdateStore(int64_t start,
+                                               int64_t size = 1) {
+    return absl::Span<CreditState>(credit_update_store_.data() + start, size);
+  }
+
+  // Allocates and returns an index that can be used with
+  // GetPhitStore to retrieve an array of size phits.
+  int64_t GetNewPhitStore(int64_t size) {
+    int64_t next_start = phit_store_.size();
+    phit_store_.resize(next_start + size);
+    return next_start;
+  }
+
+  absl::Span<DataPhit> GetPhitStore(int64_t start, int64_t size = 1) {
+    return absl::Span<DataPhit>(phit_store_.data() + start, size);
+  }
+
+  // Fifo operations on a buffer from GetPhitBufferStore.
+  void PushPhit(DataPhitBuffer& buffer, const DataPhit& phit) {
+    XLS_CHECK_LT(buffer.size, buffer.capacity);
+    int64_t tail = buffer.head + buffer.size;
+    if (tail >= buffer.capacity) {
+      tail -= buffer.capacity;
+    }
+    phit_store_[buffer.phit_start + tail] = phit;
+    ++buffer.size;
+  }
+  const DataPhit& FrontPhit(const DataPhitBuffer& buffer) {
+    return phit_store_[buffer.phit_start + buffer.head];
+  }
+  void PopPhit(DataPhitBuffer& buffer) {
+    if (++buffer.head == buffer.capacity) {
+      buffer.head = 0;
+    }
+    --buffer.size;
+  }
+
   // Returns a reference to the store previously reserved with
   // GetNewConnectionIndicesStore.
   absl::Span<PortId> GetPortIdStore(int64_t start, int64_t size = 1) {
     return absl::Span<PortId>(port_id_store_.data() + start, size);
   }
 
+  // Returns the pool storing the payloads of phits.
+  PhitPayloadPool& GetPayloadPool() { return payload_pool_; }
+
   // Returns current/in-progress cycle;
   int64_t GetCurrentCycle() { return cycle_; }
 
@@ -423,11 +693,29 @@ class NocSimulator {
   void Dump();
 
   // Run a single cycle of the simulator.
+  //
+  // In serial mode, the cycle starts with one forward sweep over the
+  // components in topological (upstream to downstream) order and one reverse
+  // sweep in the opposite order, which completes it unless the network has
+  // combinational loops; it is then completed with up to "max_ticks" ticks.
   absl::Status RunCycle(int64_t max_ticks = 9999);
 
   // Runs a single tick of the simulator.
   bool Tick();
 
+  // Runs each tick on "thread_count" threads (serially if at most one).
+  //
+  // The components are colored so that no two components of the same color
+  // share a connection, and each color's components are split into
+  // "thread_count" partitions (contiguous in network order, i.e. roughly by
+  // network region) that are ticked concurrently, with a barrier between
+  // colors. As a component propagates at most once per cycle, and only from
+  // the state of its own connections, each cycle's result is identical to
+  // that of serial mode (though it may take a different number of ticks).
+  //
+  // Must be called after Initialize().
+  absl::Status SetThreadCount(int64_t thread_count);
+
   // Returns corresponding simulation object for a src network component.
   absl::StatusOr<SimNetworkInterfaceSrc*> GetSimNetworkInterfaceSrc(
       NetworkComponentId src);
@@ -445,6 +733,30 @@ class NocSimulator {
   absl::Status CreateLink(NetworkComponentId nc_id);
   absl::Status CreateRouter(NetworkComponentId nc_id);
 
+  // Returns all components, in the order Tick() ticks them.
+  std::vector<SimNetworkComponentBase*> GetComponents();
+
+  // Computes propagation_order_.
+  void BuildPropagationOrder();
+
+  // Ticks each component in propagation_order_, then again in reverse order,
+  // and returns whether they all converged.
+  bool SweepTick();
+
+  // Runs a tick on the threads set up by SetThreadCount().
+  bool ParallelTick();
+
+  // Ticks the components of the given partition of tick_phases_[phase] and
+  // returns whether they all converged.
+  bool TickPartition(int64_t phase, int64_t partition);
+
+  // Body of the thread ticking "partition" of each phase dispatched after
+  // "generation".
+  void TickWorker(int64_t partition, int64_t generation);
+
+  // Stops and joins the threads set up by SetThreadCount().
+  void StopTickThreads();
+
   NetworkManager* mgr_;
   NocParameters* params_;
   DistributedRoutingTable* routing_;
@@ -473,6 +785,18 @@ class NocSimulator {
   std::vector<int64_t> component_to_connection_index_;
   std::vector<SimConnectionState> connections_;
 
+  // Stores the reverse channels of all connections_.
+  std::vector<TimedMetadataPhit> reverse_channel_store_;
+
+  // Stores the state of virtual channels (see GetNewVirtualChannelStore),
+  // and the phits of the buffers.
+  std::vector<DataPhitBuffer> phit_buffer_store_;
+  std::vector<int64_t> credit_store_;
+  std::vector<CreditState> credit_update_store_;
+  std::vector<DataPhit> phit_store_;
+
+  PhitPayloadPool payload_pool_;
+
   // Stores port ids for routers.
   std::vector<PortId> port_id_store_;
 
@@ -480,6 +804,29 @@ class NocSimulator {
   std::vector<SimNetworkInterfaceSrc> network_interface_sources_;
   std::vector<SimNetworkInterfaceSink> network_interface_sinks_;
   std::vector<SimInputBufferedVCRouter> routers_;
+  std::vector<SimProcRouter> proc_routers_;
+
+  // The routers simulated by SimProcRouters, and their models.
+  absl::flat_hash_map<NetworkComponentId, ProcRouterModel> proc_router_models_;
+
+  // Components in topological order of the network's connections (sources
+  // first), followed by those on loops.
+  std::vector<SimNetworkComponentBase*> propagation_order_;
+
+  // Components to tick in parallel mode, indexed by phase (color), then
+  // partition; the calling thread ticks partition 0 and tick_threads_[i]
+  // partition i + 1.
+  std::vector<std::vector<std::vector<SimNetworkComponentBase*>>> tick_phases_;
+  std::vector<std::unique_ptr<Thread>> tick_threads_;
+
+  // Hands the phases of a parallel tick to the threads: each phase bumps
+  // tick_generation_, and is complete once tick_pending_ threads finished it.
+  absl::Mutex tick_mutex_;
+  int64_t tick_generation_ ABSL_GUARDED_BY(tick_mutex_) = 0;
+  int64_t tick_phase_ ABSL_GUARDED_BY(tick_mutex_) = 0;
+  int64_t tick_pending_ ABSL_GUARDED_BY(tick_mutex_) = 0;
+  bool tick_converged_ ABSL_GUARDED_BY(tick_mutex_) = true;
+  bool stop_tick_threads_ ABSL_GUARDED_BY(tick_mutex_) = false;
 };
 
 }  // namespace noc
@@ -18,6 +18,10 @@
 #include "gtest/gtest.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
 #include "xls/noc/config/network_config.pb.h"
 #include "xls/noc/config/network_config_proto_builder.h"
 #include "xls/noc/simulation/network_graph_builder.h"
@@ -121,8 +125,9 @@ TEST(SimObjectsTest, BackToBackNetwork0) {
                            simulator.GetSimNetworkInterfaceSrc(send_port_0));
   XLS_ASSERT_OK(sim_send_port_0->SendPhitAtTime(phit0));
 
+  // Without loops, each cycle completes in a forward and a reverse sweep.
   for (int64_t i = 0; i < 10; ++i) {
-    XLS_ASSERT_OK(simulator.RunCycle());
+    XLS_ASSERT_OK(simulator.RunCycle(/*max_ticks=*/2));
   }
 
   XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSink * sim_recv_port_0,
@@ -136,7 +141,88 @@ TEST(SimObjectsTest, BackToBackNetwork0) {
   EXPECT_EQ(traffic_recv_port_0[0].phit.data, 707);
 }
 
-TEST(SimObjectsTest, TreeNework0) {
+TEST(SimObjectsTest, WidePayload) {
+  NetworkConfigProtoBuilder builder("Test");
+
+  // Network:
+  //   SendPort0 -> RouterA -> RecvPort0, with 512-bit flits.
+  builder.WithVirtualChannel("VC0").WithFlitBitWidth(512).WithDepth(3);
+
+  builder.WithPort("SendPort0").AsInputDirection().WithVirtualChannel("VC0");
+  builder.WithPort("RecvPort0").AsOutputDirection().WithVirtualChannel("VC0");
+
+  auto routera = builder.WithRouter("RouterA");
+  routera.WithInputPort("Ain0").WithVirtualChannel("VC0");
+  routera.WithOutputPort("Aout0").WithVirtualChannel("VC0");
+
+  builder.WithLink("Link0A")
+      .WithSourcePort("SendPort0")
+      .WithSinkPort("Ain0")
+      .WithSourceSinkPipelineStage(2);
+  builder.WithLink("LinkA0").WithSourcePort("Aout0").WithSinkPort(
+      "RecvPort0");
+
+  XLS_ASSERT_OK_AND_ASSIGN(NetworkConfigProto nc_proto, builder.Build());
+  NetworkManager graph;
+  NocParameters params;
+  XLS_ASSERT_OK(BuildNetworkGraphFromProto(nc_proto, &graph, &params));
+
+  DistributedRoutingTableBuilderForTrees route_builder;
+  XLS_ASSERT_OK_AND_ASSIGN(DistributedRoutingTable routing_table,
+                           route_builder.BuildNetworkRoutingTables(
+                               graph.GetNetworkIds()[0], graph, params));
+
+  NocSimulator simulator;
+  XLS_ASSERT_OK(simulator.Initialize(graph, params, routing_table,
+                                     graph.GetNetworkIds()[0]));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId send_port_0,
+      FindNetworkComponentByName("SendPort0", graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId recv_port_0,
+      FindNetworkComponentByName("RecvPort0", graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSrc * sim_send_port_0,
+                           simulator.GetSimNetworkInterfaceSrc(send_port_0));
+  XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSink * sim_recv_port_0,
+                           simulator.GetSimNetworkInterfaceSink(recv_port_0));
+
+  TimedDataPhit phit;
+  phit.phit.valid = true;
+  phit.phit.vc = 0;
+  phit.phit.data = 0;
+  phit.phit.destination_index = 0;
+  phit.cycle = 1;
+
+  std::vector<Bits> payloads = {
+      Bits::AllOnes(512), bits_ops::Concat({UBits(0x1234, 64), Bits(448)})};
+  for (const Bits& payload : payloads) {
+    XLS_ASSERT_OK(sim_send_port_0->SendPhitWithPayloadAtTime(phit, payload));
+  }
+  EXPECT_THAT(sim_send_port_0->SendPhitWithPayloadAtTime(phit, Bits(513)),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument,
+                                       testing::HasSubstr("doesn't fit")));
+  EXPECT_EQ(simulator.GetPayloadPool().size(), 2);
+
+  for (int64_t i = 0; i < 10; ++i) {
+    XLS_ASSERT_OK(simulator.RunCycle(/*max_ticks=*/2));
+  }
+
+  absl::Span<const TimedDataPhit> received =
+      sim_recv_port_0->GetReceivedTraffic();
+  ASSERT_EQ(received.size(), 2);
+  for (int64_t i = 0; i < received.size(); ++i) {
+    EXPECT_EQ(simulator.GetPayloadPool().Release(received[i].phit.payload),
+              payloads[i]);
+  }
+  EXPECT_EQ(simulator.GetPayloadPool().size(), 0);
+}
+
+// Runs with the given number of simulator threads; the results must be the
+// same as in serial mode.
+class SimObjectsThreadsTest : public ::testing::TestWithParam<int64_t> {};
+
+TEST_P(SimObjectsThreadsTest, TreeNework0) {
   XLS_LOG(INFO) << "Setting up network ...";
   NetworkConfigProtoBuilder builder("Test");
 
@@ -266,6 +352,7 @@ TEST(SimObjectsTest, TreeNework0) {
   NocSimulator simulator;
   XLS_ASSERT_OK(simulator.Initialize(graph, params, routing_table,
                                      graph.GetNetworkIds()[0]));
+  XLS_ASSERT_OK(simulator.SetThreadCount(GetParam()));
   simulator.Dump();
 
   // Retrieve src and sink objects
@@ -330,8 +417,10 @@ TEST(SimObjectsTest, TreeNework0) {
   XLS_ASSERT_OK(sim_send_port_1->SendPhitAtTime(phit1));
   XLS_ASSERT_OK(sim_send_port_1->SendPhitAtTime(phit2));
 
+  // Serially, each cycle completes in a forward and a reverse sweep.
+  int64_t max_ticks = GetParam() > 1 ? 9999 : 2;
   for (int64_t i = 0; i < 10; ++i) {
-    XLS_ASSERT_OK(simulator.RunCycle());
+    XLS_ASSERT_OK(simulator.RunCycle(max_ticks));
   }
 
   XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSink * sim_recv_port_0,
@@ -365,6 +454,169 @@ TEST(SimObjectsTest, TreeNework0) {
   EXPECT_EQ(traffic_recv_port_3[1].phit.data, 2002);
 }
 
+INSTANTIATE_TEST_SUITE_P(SimObjectsThreadsTestInstantiation,
+                         SimObjectsThreadsTest, testing::Values(1, 2, 3, 8));
+
+// A router proc with one input and one output port which forwards phits and
+// credits unchanged.
+constexpr char kPassThroughRouterIr[] = R"(
+package router
+
+chan in0((bits[1], bits[16], bits[16], bits[64], bits[64]), id=0, kind=streaming, ops=receive_only, metadata="")
+chan credit_in0(bits[64][1], id=1, kind=streaming, ops=receive_only, metadata="")
+chan out0((bits[1], bits[16], bits[16], bits[64], bits[64]), id=2, kind=streaming, ops=send_only, metadata="")
+chan credit_out0(bits[64][1], id=3, kind=streaming, ops=send_only, metadata="")
+
+proc pass_through(tkn: token, state: (), init=()) {
+  receive.1: (token, (bits[1], bits[16], bits[16], bits[64], bits[64])) = receive(tkn, channel_id=0)
+  tuple_index.2: token = tuple_index(receive.1, index=0)
+  tuple_index.3: (bits[1], bits[16], bits[16], bits[64], bits[64]) = tuple_index(receive.1, index=1)
+  receive.4: (token, bits[64][1]) = receive(tuple_index.2, channel_id=1)
+  tuple_index.5: token = tuple_index(receive.4, index=0)
+  tuple_index.6: bits[64][1] = tuple_index(receive.4, index=1)
+  send.7: token = send(tuple_index.5, tuple_index.3, channel_id=2)
+  send.8: token = send(send.7, tuple_index.6, channel_id=3)
+  next (send.8, state)
+}
+)";
+
+// Builds the network SendPort0 -> RouterA -> RecvPort0, with links of two
+// pipeline stages.
+absl::Status BuildBackToBackNetwork(NetworkManager* graph,
+                                    NocParameters* params) {
+  NetworkConfigProtoBuilder builder("Test");
+  builder.WithVirtualChannel("VC0").WithFlitBitWidth(100).WithDepth(3);
+  builder.WithPort("SendPort0").AsInputDirection().WithVirtualChannel("VC0");
+  builder.WithPort("RecvPort0").AsOutputDirection().WithVirtualChannel("VC0");
+  auto routera = builder.WithRouter("RouterA");
+  routera.WithInputPort("Ain0").WithVirtualChannel("VC0");
+  routera.WithOutputPort("Aout0").WithVirtualChannel("VC0");
+  builder.WithLink("Link0A")
+      .WithSourcePort("SendPort0")
+      .WithSinkPort("Ain0")
+      .WithSourceSinkPipelineStage(2);
+  builder.WithLink("LinkA0")
+      .WithSourcePort("Aout0")
+      .WithSinkPort("RecvPort0")
+      .WithSourceSinkPipelineStage(2);
+  XLS_ASSIGN_OR_RETURN(NetworkConfigProto nc_proto, builder.Build());
+  return BuildNetworkGraphFromProto(nc_proto, graph, params);
+}
+
+TEST(SimObjectsTest, ProcRouter) {
+  NetworkManager graph;
+  NocParameters params;
+  XLS_ASSERT_OK(BuildBackToBackNetwork(&graph, &params));
+  DistributedRoutingTableBuilderForTrees route_builder;
+  XLS_ASSERT_OK_AND_ASSIGN(DistributedRoutingTable routing_table,
+                           route_builder.BuildNetworkRoutingTables(
+                               graph.GetNetworkIds()[0], graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kPassThroughRouterIr));
+
+  NocSimulator simulator;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId routera_id,
+      FindNetworkComponentByName("RouterA", graph, params));
+  simulator.SetProcRouterModel(routera_id,
+                               ProcRouterModel{package.get(), "pass_through"});
+  XLS_ASSERT_OK(simulator.Initialize(graph, params, routing_table,
+                                     graph.GetNetworkIds()[0]));
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId send_port_0,
+      FindNetworkComponentByName("SendPort0", graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId recv_port_0,
+      FindNetworkComponentByName("RecvPort0", graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSrc * sim_send_port_0,
+                           simulator.GetSimNetworkInterfaceSrc(send_port_0));
+  XLS_ASSERT_OK_AND_ASSIGN(SimNetworkInterfaceSink * sim_recv_port_0,
+                           simulator.GetSimNetworkInterfaceSink(recv_port_0));
+
+  TimedDataPhit phit;
+  phit.phit.valid = true;
+  phit.phit.vc = 0;
+  phit.phit.data = 707;
+  phit.phit.destination_index = 0;
+  phit.cycle = 1;
+  XLS_ASSERT_OK(sim_send_port_0->SendPhitAtTime(phit));
+  phit.phit.data = 708;
+  XLS_ASSERT_OK(
+      sim_send_port_0->SendPhitWithPayloadAtTime(phit, UBits(0x1234, 100)));
+
+  for (int64_t i = 0; i < 10; ++i) {
+    XLS_ASSERT_OK(simulator.RunCycle(/*max_ticks=*/2));
+  }
+
+  // The proc forwards the sink's credits rather than advertising buffers of
+  // its own, so the source first gets credits, and sends, on cycle 2 (rather
+  // than 1 as with the behavioral router of BackToBackNetwork0).
+  absl::Span<const TimedDataPhit> received =
+      sim_recv_port_0->GetReceivedTraffic();
+  ASSERT_EQ(received.size(), 2);
+  EXPECT_EQ(received[0].cycle, 6);
+  EXPECT_EQ(received[0].phit.data, 707);
+  EXPECT_EQ(received[0].phit.payload, DataPhit::kNoPayload);
+  EXPECT_EQ(received[1].cycle, 7);
+  EXPECT_EQ(received[1].phit.data, 708);
+  EXPECT_EQ(simulator.GetPayloadPool().Release(received[1].phit.payload),
+            UBits(0x1234, 100));
+}
+
+TEST(SimObjectsTest, ProcRouterWithMissingChannel) {
+  NetworkManager graph;
+  NocParameters params;
+  XLS_ASSERT_OK(BuildBackToBackNetwork(&graph, &params));
+  DistributedRoutingTableBuilderForTrees route_builder;
+  XLS_ASSERT_OK_AND_ASSIGN(DistributedRoutingTable routing_table,
+                           route_builder.BuildNetworkRoutingTables(
+                               graph.GetNetworkIds()[0], graph, params));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(R"(
+package router
+
+chan out0((bits[1], bits[16], bits[16], bits[64], bits[64]), id=0, kind=streaming, ops=send_only, metadata="")
+
+proc idle(tkn: token, state: (), init=()) {
+  literal.1: (bits[1], bits[16], bits[16], bits[64], bits[64]) = literal(value=(0, 0, 0, 0, 0))
+  send.2: token = send(tkn, literal.1, channel_id=0)
+  next (send.2, state)
+}
+)"));
+
+  NocSimulator simulator;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      NetworkComponentId routera_id,
+      FindNetworkComponentByName("RouterA", graph, params));
+  simulator.SetProcRouterModel(routera_id,
+                               ProcRouterModel{package.get(), "idle"});
+  EXPECT_THAT(simulator.Initialize(graph, params, routing_table,
+                                   graph.GetNetworkIds()[0]),
+              status_testing::StatusIs(absl::StatusCode::kNotFound,
+                                       testing::HasSubstr("in0")));
+}
+
+TEST(SimObjectsTest, PhitBufferWrapsAround) {
+  NocSimulator simulator;
+  int64_t index = simulator.GetNewVirtualChannelStore(2);
+  DataPhitBuffer& buffer = simulator.GetPhitBufferStore(index + 1)[0];
+  buffer.phit_start = simulator.GetNewPhitStore(3);
+  buffer.capacity = 3;
+
+  for (int64_t data = 0; data < 10; ++data) {
+    simulator.PushPhit(buffer, DataPhit{true, 0, 0, data});
+    simulator.PushPhit(buffer, DataPhit{true, 0, 0, data + 100});
+    EXPECT_EQ(simulator.FrontPhit(buffer).data, data);
+    simulator.PopPhit(buffer);
+    EXPECT_EQ(simulator.FrontPhit(buffer).data, data + 100);
+    simulator.PopPhit(buffer);
+  }
+  EXPECT_EQ(buffer.size, 0);
+  EXPECT_EQ(simulator.GetPhitBufferStore(index)[0].capacity, 0);
+  EXPECT_EQ(simulator.GetCreditStore(index, 2)[1], 0);
+}
+
 }  // namespace
 }  // namespace noc
 }  // namespace xls
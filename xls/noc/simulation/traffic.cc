@@ -0,0 +1,393 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/noc/simulation/traffic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/strip.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace noc {
+namespace {
+
+constexpr absl::string_view kTraceMagic = "XLSNOCT1";
+
+// The data of an injected phit holds its source index in the low
+// kSourceIndexBits bits, and its injection cycle above them.
+constexpr int64_t kSourceIndexBits = 16;
+constexpr int64_t kMaxSourceCount = int64_t{1} << kSourceIndexBits;
+
+// DataPhit::destination_index is an int16_t.
+constexpr int64_t kMaxSinkCount = int64_t{1} << 15;
+
+absl::Status CheckRandomTrafficParams(int64_t source_count, int64_t sink_count,
+                                      double injection_rate) {
+  if (source_count <= 0 || sink_count <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Traffic needs sources and sinks, got %d and %d",
+                        source_count, sink_count));
+  }
+  if (injection_rate < 0.0 || injection_rate > 1.0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Injection rate must be in [0, 1], got %f", injection_rate));
+  }
+  return absl::OkStatus();
+}
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+absl::StatusOr<uint64_t> ReadVarint(absl::string_view* data) {
+  uint64_t value = 0;
+  for (int64_t shift = 0; shift < 64; shift += 7) {
+    if (data->empty()) {
+      return absl::InvalidArgumentError("Truncated traffic trace");
+    }
+    uint8_t byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  return absl::InvalidArgumentError("Invalid varint in traffic trace");
+}
+
+}  // namespace
+
+absl::Status RandomTrafficModel::GetEvents(int64_t cycle,
+                                           std::vector<TrafficEvent>* events) {
+  for (int64_t source = 0; source < source_count_; ++source) {
+    if (injection_(rng_)) {
+      events->push_back(TrafficEvent{cycle, source, SelectDestination(source),
+                                     /*vc=*/0});
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<UniformRandomTrafficModel>>
+UniformRandomTrafficModel::Create(int64_t source_count, int64_t sink_count,
+                                  double injection_rate, int64_t seed) {
+  XLS_RETURN_IF_ERROR(
+      CheckRandomTrafficParams(source_count, sink_count, injection_rate));
+  return absl::WrapUnique(new UniformRandomTrafficModel(
+      source_count, sink_count, injection_rate, seed));
+}
+
+int64_t UniformRandomTrafficModel::SelectDestination(int64_t source_index) {
+  return std::uniform_int_distribution<int64_t>(0, sink_count_ - 1)(rng_);
+}
+
+absl::StatusOr<std::unique_ptr<HotspotTrafficModel>>
+HotspotTrafficModel::Create(int64_t source_count, int64_t sink_count,
+                            double injection_rate, int64_t hotspot_index,
+                            double hotspot_fraction, int64_t seed) {
+  XLS_RETURN_IF_ERROR(
+      CheckRandomTrafficParams(source_count, sink_count, injection_rate));
+  if (hotspot_index < 0 || hotspot_index >= sink_count) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Hotspot %d is not a sink index (of %d)", hotspot_index, sink_count));
+  }
+  if (hotspot_fraction < 0.0 || hotspot_fraction > 1.0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Hotspot fraction must be in [0, 1], got %f", hotspot_fraction));
+  }
+  return absl::WrapUnique(
+      new HotspotTrafficModel(source_count, sink_count, injection_rate,
+                              hotspot_index, hotspot_fraction, seed));
+}
+
+int64_t HotspotTrafficModel::SelectDestination(int64_t source_index) {
+  if (hotspot_(rng_)) {
+    return hotspot_index_;
+  }
+  return std::uniform_int_distribution<int64_t>(0, sink_count_ - 1)(rng_);
+}
+
+absl::StatusOr<std::unique_ptr<TransposeTrafficModel>>
+TransposeTrafficModel::Create(int64_t node_count, double injection_rate,
+                              int64_t seed) {
+  XLS_RETURN_IF_ERROR(
+      CheckRandomTrafficParams(node_count, node_count, injection_rate));
+  int64_t side = std::llround(std::sqrt(static_cast<double>(node_count)));
+  if (side * side != node_count) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Transpose traffic needs a square number of nodes, got %d",
+        node_count));
+  }
+  return absl::WrapUnique(
+      new TransposeTrafficModel(node_count, side, injection_rate, seed));
+}
+
+int64_t TransposeTrafficModel::SelectDestination(int64_t source_index) {
+  int64_t x = source_index % side_;
+  int64_t y = source_index / side_;
+  return x * side_ + y;
+}
+
+absl::Status TraceTrafficModel::GetEvents(int64_t cycle,
+                                          std::vector<TrafficEvent>* events) {
+  // Events of earlier cycles (e.g. before the simulation started) are
+  // injected late rather than dropped.
+  while (next_ < events_.size() && events_[next_].cycle <= cycle) {
+    events->push_back(events_[next_]);
+    ++next_;
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> SerializeTrafficTrace(
+    absl::Span<const TrafficEvent> events) {
+  std::string data(kTraceMagic);
+  int64_t cycle = 0;
+  for (const TrafficEvent& event : events) {
+    if (event.cycle < cycle) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Traffic trace events must be sorted by cycle; cycle %d follows %d",
+          event.cycle, cycle));
+    }
+    if (event.source_index < 0 || event.destination_index < 0 ||
+        event.vc < 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Invalid traffic event at cycle %d: source %d destination %d vc %d",
+          event.cycle, event.source_index, event.destination_index, event.vc));
+    }
+    AppendVarint(event.cycle - cycle, &data);
+    AppendVarint(event.source_index, &data);
+    AppendVarint(event.destination_index, &data);
+    AppendVarint(event.vc, &data);
+    cycle = event.cycle;
+  }
+  return data;
+}
+
+absl::StatusOr<std::vector<TrafficEvent>> DeserializeTrafficTrace(
+    absl::string_view data) {
+  if (!absl::ConsumePrefix(&data, kTraceMagic)) {
+    return absl::InvalidArgumentError("Not a traffic trace");
+  }
+  std::vector<TrafficEvent> events;
+  int64_t cycle = 0;
+  while (!data.empty()) {
+    XLS_ASSIGN_OR_RETURN(uint64_t cycle_delta, ReadVarint(&data));
+    XLS_ASSIGN_OR_RETURN(uint64_t source_index, ReadVarint(&data));
+    XLS_ASSIGN_OR_RETURN(uint64_t destination_index, ReadVarint(&data));
+    XLS_ASSIGN_OR_RETURN(uint64_t vc, ReadVarint(&data));
+    cycle += cycle_delta;
+    events.push_back(TrafficEvent{cycle, static_cast<int64_t>(source_index),
+                                  static_cast<int64_t>(destination_index),
+                                  static_cast<int64_t>(vc)});
+  }
+  return events;
+}
+
+absl::Status WriteTrafficTrace(const std::filesystem::path& path,
+                               absl::Span<const TrafficEvent> events) {
+  XLS_ASSIGN_OR_RETURN(std::string data, SerializeTrafficTrace(events));
+  return SetFileContents(path, data);
+}
+
+absl::StatusOr<std::vector<TrafficEvent>> ReadTrafficTrace(
+    const std::filesystem::path& path) {
+  XLS_ASSIGN_OR_RETURN(std::string data, GetFileContents(path));
+  return DeserializeTrafficTrace(data);
+}
+
+void LatencyHistogram::Add(int64_t latency) {
+  int64_t bucket = 0;
+  while (bucket < 63 && (latency >> bucket) != 0) {
+    ++bucket;
+  }
+  if (bucket >= buckets_.size()) {
+    buckets_.resize(bucket + 1, 0);
+  }
+  ++buckets_[bucket];
+  if (count_ == 0 || latency < min_) {
+    min_ = latency;
+  }
+  if (count_ == 0 || latency > max_) {
+    max_ = latency;
+  }
+  ++count_;
+  sum_ += latency;
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(percentile / 100.0 * count_)));
+  int64_t seen = 0;
+  for (int64_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      int64_t bucket_max = bucket == 0 ? 0 : (int64_t{1} << bucket) - 1;
+      return std::min(bucket_max, max_);
+    }
+  }
+  return max_;
+}
+
+std::string LatencyHistogram::ToString() const {
+  return absl::StrFormat("min %d mean %.2f p50 <= %d p99 <= %d max %d", min_,
+                         mean(), Percentile(50), Percentile(99), max_);
+}
+
+absl::StatusOr<TrafficDriver> TrafficDriver::Create(NocSimulator* simulator,
+                                                    TrafficModel* model) {
+  DistributedRoutingTable* routing = simulator->GetRoutingTable();
+  XLS_RET_CHECK(routing != nullptr) << "The simulator must be initialized";
+
+  const NetworkComponentIndexMap& source_indices = routing->GetSourceIndices();
+  if (source_indices.NetworkComponentCount() > kMaxSourceCount) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Traffic supports up to %d sources, the network has %d",
+        kMaxSourceCount, source_indices.NetworkComponentCount()));
+  }
+  std::vector<SimNetworkInterfaceSrc*> sources;
+  for (int64_t i = 0; i < source_indices.NetworkComponentCount(); ++i) {
+    XLS_ASSIGN_OR_RETURN(NetworkComponentId id,
+                         source_indices.GetNetworkComponentByIndex(i));
+    XLS_ASSIGN_OR_RETURN(SimNetworkInterfaceSrc * source,
+                         simulator->GetSimNetworkInterfaceSrc(id));
+    sources.push_back(source);
+  }
+
+  const NetworkComponentIndexMap& sink_indices = routing->GetSinkIndices();
+  if (sink_indices.NetworkComponentCount() > kMaxSinkCount) {
+    return absl::UnimplementedError(
+        absl::StrFormat("Traffic supports up to %d sinks, the network has %d",
+                        kMaxSinkCount, sink_indices.NetworkComponentCount()));
+  }
+  std::vector<SimNetworkInterfaceSink*> sinks;
+  for (int64_t i = 0; i < sink_indices.NetworkComponentCount(); ++i) {
+    XLS_ASSIGN_OR_RETURN(NetworkComponentId id,
+                         sink_indices.GetNetworkComponentByIndex(i));
+    XLS_ASSIGN_OR_RETURN(SimNetworkInterfaceSink * sink,
+                         simulator->GetSimNetworkInterfaceSink(id));
+    sinks.push_back(sink);
+  }
+
+  return TrafficDriver(simulator, model, std::move(sources), std::move(sinks));
+}
+
+absl::Status TrafficDriver::Run(int64_t cycle_count) {
+  for (int64_t i = 0; i < cycle_count; ++i) {
+    int64_t cycle = simulator_->GetCurrentCycle() + 1;
+    events_.clear();
+    XLS_RETURN_IF_ERROR(model_->GetEvents(cycle, &events_));
+    for (const TrafficEvent& event : events_) {
+      if (event.source_index < 0 || event.source_index >= sources_.size() ||
+          event.destination_index < 0 ||
+          event.destination_index >= sinks_.size()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Traffic event at cycle %d from source %d to sink %d is out of "
+            "range for a network with %d sources and %d sinks",
+            event.cycle, event.source_index, event.destination_index,
+            sources_.size(), sinks_.size()));
+      }
+      TimedDataPhit phit;
+      phit.cycle = event.cycle;
+      phit.phit.valid = true;
+      phit.phit.vc = event.vc;
+      phit.phit.destination_index = event.destination_index;
+      phit.phit.data = (event.cycle << kSourceIndexBits) | event.source_index;
+      XLS_RETURN_IF_ERROR(sources_[event.source_index]->SendPhitAtTime(phit));
+
+      ++flows_[{event.source_index, event.destination_index}].injected;
+      ++total_.injected;
+    }
+
+    XLS_RETURN_IF_ERROR(simulator_->RunCycle());
+    ++cycles_;
+    CollectReceivedTraffic();
+  }
+  return absl::OkStatus();
+}
+
+void TrafficDriver::CollectReceivedTraffic() {
+  for (int64_t sink_index = 0; sink_index < sinks_.size(); ++sink_index) {
+    SimNetworkInterfaceSink* sink = sinks_[sink_index];
+    for (const TimedDataPhit& received : sink->GetReceivedTraffic()) {
+      int64_t source_index = received.phit.data & (kMaxSourceCount - 1);
+      int64_t latency =
+          received.cycle - (received.phit.data >> kSourceIndexBits);
+      FlowStats& flow = flows_[{source_index, sink_index}];
+      ++flow.received;
+      flow.latency.Add(latency);
+      ++total_.received;
+      total_.latency.Add(latency);
+    }
+    sink->ClearReceivedTraffic();
+  }
+}
+
+double TrafficDriver::Throughput(int64_t source_index,
+                                 int64_t sink_index) const {
+  auto it = flows_.find({source_index, sink_index});
+  if (it == flows_.end() || cycles_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(it->second.received) / cycles_;
+}
+
+double TrafficDriver::Throughput() const {
+  return cycles_ == 0 ? 0.0 : static_cast<double>(total_.received) / cycles_;
+}
+
+std::string TrafficDriver::ToString() const {
+  std::vector<std::pair<int64_t, int64_t>> keys;
+  for (const auto& [key, flow] : flows_) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::string out;
+  for (const std::pair<int64_t, int64_t>& key : keys) {
+    const FlowStats& flow = flows_.at(key);
+    absl::StrAppendFormat(
+        &out, "%d -> %d: injected %d received %d throughput %.4f latency %s\n",
+        key.first, key.second, flow.injected, flow.received,
+        Throughput(key.first, key.second), flow.latency.ToString());
+  }
+  absl::StrAppendFormat(
+      &out, "total over %d cycles: injected %d received %d throughput %.4f "
+      "latency %s\n",
+      cycles_, total_.injected, total_.received, Throughput(),
+      total_.latency.ToString());
+  return out;
+}
+
+}  // namespace noc
+}  // namespace xls
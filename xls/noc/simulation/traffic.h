@@ -0,0 +1,273 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_NOC_SIMULATION_TRAFFIC_H_
+#define XLS_NOC_SIMULATION_TRAFFIC_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xls/noc/simulation/sim_objects.h"
+
+// This file contains the traffic models that generate the phits injected into
+// a simulated network, and the statistics collected on their delivery.
+//
+// Sources and sinks are identified by their index in the routing table's
+// source and sink indices (see DistributedRoutingTable).
+
+namespace xls {
+namespace noc {
+
+// A phit injected by source "source_index" on "cycle", on virtual channel "vc",
+// for sink "destination_index".
+struct TrafficEvent {
+  int64_t cycle;
+  int64_t source_index;
+  int64_t destination_index;
+  int64_t vc;
+
+  bool operator==(const TrafficEvent& other) const {
+    return cycle == other.cycle && source_index == other.source_index &&
+           destination_index == other.destination_index && vc == other.vc;
+  }
+};
+
+// Generates the traffic injected each cycle.
+class TrafficModel {
+ public:
+  virtual ~TrafficModel() = default;
+
+  // Appends the events injected on "cycle" to "events". Called for
+  // consecutive cycles.
+  virtual absl::Status GetEvents(int64_t cycle,
+                                 std::vector<TrafficEvent>* events) = 0;
+};
+
+// Each cycle, each source injects a phit with probability "injection_rate";
+// destinations are drawn by SelectDestination(). All phits are sent on vc 0.
+class RandomTrafficModel : public TrafficModel {
+ public:
+  absl::Status GetEvents(int64_t cycle,
+                         std::vector<TrafficEvent>* events) override;
+
+ protected:
+  RandomTrafficModel(int64_t source_count, int64_t sink_count,
+                     double injection_rate, int64_t seed)
+      : source_count_(source_count),
+        sink_count_(sink_count),
+        injection_(injection_rate),
+        rng_(seed) {}
+
+  // Returns the destination of a phit from "source_index".
+  virtual int64_t SelectDestination(int64_t source_index) = 0;
+
+  int64_t source_count_;
+  int64_t sink_count_;
+  std::bernoulli_distribution injection_;
+  std::mt19937_64 rng_;
+};
+
+// Uniform random traffic: destinations are uniformly distributed.
+class UniformRandomTrafficModel : public RandomTrafficModel {
+ public:
+  static absl::StatusOr<std::unique_ptr<UniformRandomTrafficModel>> Create(
+      int64_t source_count, int64_t sink_count, double injection_rate,
+      int64_t seed);
+
+ private:
+  using RandomTrafficModel::RandomTrafficModel;
+
+  int64_t SelectDestination(int64_t source_index) override;
+};
+
+// Hotspot traffic: a phit goes to sink "hotspot_index" with probability
+// "hotspot_fraction", and to a uniformly distributed sink otherwise.
+class HotspotTrafficModel : public RandomTrafficModel {
+ public:
+  static absl::StatusOr<std::unique_ptr<HotspotTrafficModel>> Create(
+      int64_t source_count, int64_t sink_count, double injection_rate,
+      int64_t hotspot_index, double hotspot_fraction, int64_t seed);
+
+ private:
+  HotspotTrafficModel(int64_t source_count, int64_t sink_count,
+                      double injection_rate, int64_t hotspot_index,
+                      double hotspot_fraction, int64_t seed)
+      : RandomTrafficModel(source_count, sink_count, injection_rate, seed),
+        hotspot_index_(hotspot_index),
+        hotspot_(hotspot_fraction) {}
+
+  int64_t SelectDestination(int64_t source_index) override;
+
+  int64_t hotspot_index_;
+  std::bernoulli_distribution hotspot_;
+};
+
+// Transpose traffic: the sources and sinks are both the nodes of a k x k grid
+// numbered in row-major order, and node (x, y) sends to node (y, x).
+class TransposeTrafficModel : public RandomTrafficModel {
+ public:
+  // "node_count" must be a perfect square.
+  static absl::StatusOr<std::unique_ptr<TransposeTrafficModel>> Create(
+      int64_t node_count, double injection_rate, int64_t seed);
+
+ private:
+  TransposeTrafficModel(int64_t node_count, int64_t side,
+                        double injection_rate, int64_t seed)
+      : RandomTrafficModel(node_count, node_count, injection_rate, seed),
+        side_(side) {}
+
+  int64_t SelectDestination(int64_t source_index) override;
+
+  int64_t side_;
+};
+
+// Replays a recorded trace of events, sorted by cycle.
+class TraceTrafficModel : public TrafficModel {
+ public:
+  explicit TraceTrafficModel(std::vector<TrafficEvent> events)
+      : events_(std::move(events)) {}
+
+  absl::Status GetEvents(int64_t cycle,
+                         std::vector<TrafficEvent>* events) override;
+
+ private:
+  std::vector<TrafficEvent> events_;
+  int64_t next_ = 0;
+};
+
+// Traces are stored in a compact binary format: the magic "XLSNOCT1", then
+// for each event (sorted by cycle) the difference from the previous event's
+// cycle, the source index, destination index and vc, each as an unsigned
+// LEB128 varint.
+absl::StatusOr<std::string> SerializeTrafficTrace(
+    absl::Span<const TrafficEvent> events);
+absl::StatusOr<std::vector<TrafficEvent>> DeserializeTrafficTrace(
+    absl::string_view data);
+
+absl::Status WriteTrafficTrace(const std::filesystem::path& path,
+                               absl::Span<const TrafficEvent> events);
+absl::StatusOr<std::vector<TrafficEvent>> ReadTrafficTrace(
+    const std::filesystem::path& path);
+
+// Histogram of latencies (in cycles), with power-of-two buckets: bucket 0
+// counts latencies of 0, and bucket i > 0 those in [2^(i-1), 2^i).
+class LatencyHistogram {
+ public:
+  void Add(int64_t latency);
+
+  int64_t count() const { return count_; }
+  int64_t min() const { return min_; }
+  int64_t max() const { return max_; }
+  double mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+  }
+  absl::Span<const int64_t> buckets() const { return buckets_; }
+
+  // Returns an upper bound on the given percentile (in [0, 100]) of the
+  // latencies: the largest latency of its bucket, capped by max().
+  int64_t Percentile(double percentile) const;
+
+  std::string ToString() const;
+
+ private:
+  int64_t count_ = 0;
+  int64_t sum_ = 0;
+  int64_t min_ = 0;
+  int64_t max_ = 0;
+  std::vector<int64_t> buckets_;
+};
+
+// Latency and throughput statistics of the phits sent between a source and a
+// sink.
+struct FlowStats {
+  int64_t injected = 0;
+  int64_t received = 0;
+  LatencyHistogram latency;
+};
+
+// Drives a simulator with the traffic of a model and collects statistics on
+// it.
+//
+// The latency of a phit is measured from the cycle it's generated on (so it
+// includes the time it waits for credits at the source) to the cycle it's
+// received. To keep the overhead low, the injection cycle and source index are
+// carried in the phit's data rather than looked up, and received phits are
+// collected (and dropped) from the sinks after each cycle.
+class TrafficDriver {
+ public:
+  // "simulator" must be initialized; both it and "model" must outlive this
+  // object.
+  static absl::StatusOr<TrafficDriver> Create(NocSimulator* simulator,
+                                              TrafficModel* model);
+
+  // Injects the model's traffic and runs the simulator for "cycle_count"
+  // cycles.
+  absl::Status Run(int64_t cycle_count);
+
+  // Number of cycles run.
+  int64_t cycles() const { return cycles_; }
+
+  // Statistics of the flows that have been injected into, keyed by source and
+  // sink index.
+  const absl::flat_hash_map<std::pair<int64_t, int64_t>, FlowStats>& flows()
+      const {
+    return flows_;
+  }
+
+  // Statistics over all flows.
+  const FlowStats& total() const { return total_; }
+
+  // Returns the received phits per cycle of the given flow, or of all flows.
+  double Throughput(int64_t source_index, int64_t sink_index) const;
+  double Throughput() const;
+
+  // Returns a summary of the statistics, one line per flow.
+  std::string ToString() const;
+
+ private:
+  TrafficDriver(NocSimulator* simulator, TrafficModel* model,
+                std::vector<SimNetworkInterfaceSrc*> sources,
+                std::vector<SimNetworkInterfaceSink*> sinks)
+      : simulator_(simulator),
+        model_(model),
+        sources_(std::move(sources)),
+        sinks_(std::move(sinks)) {}
+
+  // Records the phits received by the sinks in the last cycle and drops them
+  // from the sinks.
+  void CollectReceivedTraffic();
+
+  NocSimulator* simulator_;
+  TrafficModel* model_;
+  std::vector<SimNetworkInterfaceSrc*> sources_;
+  std::vector<SimNetworkInterfaceSink*> sinks_;
+  int64_t cycles_ = 0;
+  std::vector<TrafficEvent> events_;
+  absl::flat_hash_map<std::pair<int64_t, int64_t>, FlowStats> flows_;
+  FlowStats total_;
+};
+
+}  // namespace noc
+}  // namespace xls
+
+#endif  // XLS_NOC_SIMULATION_TRAFFIC_H_
@@ -0,0 +1,238 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/noc/simulation/traffic.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/noc/config/network_config.pb.h"
+#include "xls/noc/config/network_config_proto_builder.h"
+#include "xls/noc/simulation/global_routing_table.h"
+#include "xls/noc/simulation/network_graph_builder.h"
+#include "xls/noc/simulation/sim_objects.h"
+
+namespace xls {
+namespace noc {
+namespace {
+
+using status_testing::StatusIs;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+// Records the events of another model.
+class RecordingTrafficModel : public TrafficModel {
+ public:
+  explicit RecordingTrafficModel(TrafficModel* model) : model_(model) {}
+
+  absl::Status GetEvents(int64_t cycle,
+                         std::vector<TrafficEvent>* events) override {
+    int64_t start = events->size();
+    XLS_RETURN_IF_ERROR(model_->GetEvents(cycle, events));
+    recorded_.insert(recorded_.end(), events->begin() + start, events->end());
+    return absl::OkStatus();
+  }
+
+  const std::vector<TrafficEvent>& recorded() const { return recorded_; }
+
+ private:
+  TrafficModel* model_;
+  std::vector<TrafficEvent> recorded_;
+};
+
+// A network of two sources and two sinks connected through a router:
+//
+//   SendPort0  SendPort1
+//       |          |
+//     Ain0       Ain1
+//      [  RouterA   ]
+//     Aout0      Aout1
+//       |          |
+//   RecvPort0  RecvPort1
+class TrafficTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    NetworkConfigProtoBuilder builder("Test");
+    builder.WithVirtualChannel("VC0").WithFlitBitWidth(100).WithDepth(3);
+    builder.WithPort("SendPort0").AsInputDirection().WithVirtualChannel("VC0");
+    builder.WithPort("SendPort1").AsInputDirection().WithVirtualChannel("VC0");
+    builder.WithPort("RecvPort0").AsOutputDirection().WithVirtualChannel("VC0");
+    builder.WithPort("RecvPort1").AsOutputDirection().WithVirtualChannel("VC0");
+
+    auto routera = builder.WithRouter("RouterA");
+    routera.WithInputPort("Ain0").WithVirtualChannel("VC0");
+    routera.WithInputPort("Ain1").WithVirtualChannel("VC0");
+    routera.WithOutputPort("Aout0").WithVirtualChannel("VC0");
+    routera.WithOutputPort("Aout1").WithVirtualChannel("VC0");
+
+    builder.WithLink("Link0A").WithSourcePort("SendPort0").WithSinkPort("Ain0");
+    builder.WithLink("Link1A").WithSourcePort("SendPort1").WithSinkPort("Ain1");
+    builder.WithLink("LinkA0")
+        .WithSourcePort("Aout0")
+        .WithSinkPort("RecvPort0")
+        .WithSourceSinkPipelineStage(2);
+    builder.WithLink("LinkA1").WithSourcePort("Aout1").WithSinkPort(
+        "RecvPort1");
+
+    XLS_ASSERT_OK_AND_ASSIGN(NetworkConfigProto nc_proto, builder.Build());
+    XLS_ASSERT_OK(BuildNetworkGraphFromProto(nc_proto, &graph_, &params_));
+    DistributedRoutingTableBuilderForTrees route_builder;
+    XLS_ASSERT_OK_AND_ASSIGN(routing_table_,
+                             route_builder.BuildNetworkRoutingTables(
+                                 graph_.GetNetworkIds()[0], graph_, params_));
+  }
+
+  // Runs "model" on a fresh simulation of the network for "cycle_count"
+  // cycles, and returns the statistics.
+  absl::StatusOr<std::string> Run(TrafficModel* model, int64_t cycle_count) {
+    NocSimulator simulator;
+    XLS_RETURN_IF_ERROR(simulator.Initialize(graph_, params_, routing_table_,
+                                             graph_.GetNetworkIds()[0]));
+    XLS_ASSIGN_OR_RETURN(TrafficDriver driver,
+                         TrafficDriver::Create(&simulator, model));
+    XLS_RETURN_IF_ERROR(driver.Run(cycle_count));
+    EXPECT_EQ(driver.cycles(), cycle_count);
+    EXPECT_LE(driver.total().received, driver.total().injected);
+    return driver.ToString();
+  }
+
+  NetworkManager graph_;
+  NocParameters params_;
+  DistributedRoutingTable routing_table_;
+};
+
+TEST_F(TrafficTest, LatencyAndThroughput) {
+  // One phit per flow: the phit to sink 0 crosses the two stages of LinkA0.
+  TraceTrafficModel model({TrafficEvent{1, 0, 0, 0}, TrafficEvent{1, 1, 1, 0},
+                           TrafficEvent{4, 0, 1, 0}});
+  NocSimulator simulator;
+  XLS_ASSERT_OK(simulator.Initialize(graph_, params_, routing_table_,
+                                     graph_.GetNetworkIds()[0]));
+  XLS_ASSERT_OK_AND_ASSIGN(TrafficDriver driver,
+                           TrafficDriver::Create(&simulator, &model));
+  XLS_ASSERT_OK(driver.Run(10));
+
+  EXPECT_EQ(driver.total().injected, 3);
+  EXPECT_EQ(driver.total().received, 3);
+  ASSERT_EQ(driver.flows().size(), 3);
+  const FlowStats& to_sink_0 = driver.flows().at({0, 0});
+  const FlowStats& to_sink_1 = driver.flows().at({1, 1});
+  EXPECT_EQ(to_sink_0.latency.min(), to_sink_1.latency.min() + 2);
+  EXPECT_DOUBLE_EQ(driver.Throughput(0, 0), 0.1);
+  EXPECT_DOUBLE_EQ(driver.Throughput(), 0.3);
+  EXPECT_DOUBLE_EQ(driver.Throughput(1, 0), 0.0);
+  EXPECT_THAT(driver.ToString(), HasSubstr("0 -> 0: injected 1 received 1"));
+}
+
+TEST_F(TrafficTest, ReplayMatchesGeneratedTraffic) {
+  for (double rate : {0.1, 0.9}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<UniformRandomTrafficModel> uniform,
+        UniformRandomTrafficModel::Create(2, 2, rate, /*seed=*/42));
+    RecordingTrafficModel recording(uniform.get());
+    XLS_ASSERT_OK_AND_ASSIGN(std::string generated, Run(&recording, 500));
+
+    XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+    std::filesystem::path path = temp_dir.path() / "trace.bin";
+    XLS_ASSERT_OK(WriteTrafficTrace(path, recording.recorded()));
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<TrafficEvent> events,
+                             ReadTrafficTrace(path));
+    EXPECT_EQ(events, recording.recorded());
+
+    TraceTrafficModel replay(std::move(events));
+    EXPECT_THAT(Run(&replay, 500), status_testing::IsOkAndHolds(generated));
+  }
+}
+
+TEST_F(TrafficTest, HotspotAndTransposeTraffic) {
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<HotspotTrafficModel> hotspot,
+      HotspotTrafficModel::Create(2, 2, 0.5, /*hotspot_index=*/1,
+                                  /*hotspot_fraction=*/1.0, /*seed=*/1));
+  std::vector<TrafficEvent> events;
+  for (int64_t cycle = 0; cycle < 100; ++cycle) {
+    XLS_ASSERT_OK(hotspot->GetEvents(cycle, &events));
+  }
+  EXPECT_FALSE(events.empty());
+  for (const TrafficEvent& event : events) {
+    EXPECT_EQ(event.destination_index, 1);
+  }
+  XLS_EXPECT_OK(Run(hotspot.get(), 100).status());
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TransposeTrafficModel> transpose,
+                           TransposeTrafficModel::Create(9, 1.0, /*seed=*/1));
+  events.clear();
+  XLS_ASSERT_OK(transpose->GetEvents(0, &events));
+  ASSERT_EQ(events.size(), 9);
+  EXPECT_EQ(events[1].destination_index, 3);
+  EXPECT_EQ(events[5].destination_index, 7);
+  EXPECT_EQ(events[8].destination_index, 8);
+
+  EXPECT_THAT(TransposeTrafficModel::Create(8, 0.5, /*seed=*/1).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("square number of nodes")));
+  EXPECT_THAT(UniformRandomTrafficModel::Create(2, 2, 1.5, /*seed=*/1).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Injection rate")));
+}
+
+TEST_F(TrafficTest, OutOfRangeEvent) {
+  TraceTrafficModel model({TrafficEvent{0, 0, 2, 0}});
+  EXPECT_THAT(Run(&model, 1), StatusIs(absl::StatusCode::kInvalidArgument,
+                                       HasSubstr("is out of range")));
+}
+
+TEST(TrafficTraceTest, Serialization) {
+  std::vector<TrafficEvent> events = {{0, 1, 2, 0}, {0, 3, 4, 1},
+                                      {1000000, 300, 2, 0}};
+  XLS_ASSERT_OK_AND_ASSIGN(std::string data, SerializeTrafficTrace(events));
+  // Magic, then 4 bytes for each of the first two events and 7 for the last.
+  EXPECT_EQ(data.size(), 8 + 4 + 4 + 7);
+  EXPECT_THAT(DeserializeTrafficTrace(data),
+              status_testing::IsOkAndHolds(events));
+
+  EXPECT_THAT(DeserializeTrafficTrace(data.substr(0, data.size() - 1)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Truncated")));
+  EXPECT_THAT(DeserializeTrafficTrace("not a trace"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Not a traffic trace")));
+  EXPECT_THAT(SerializeTrafficTrace({{1, 0, 0, 0}, {0, 0, 0, 0}}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("sorted by cycle")));
+}
+
+TEST(LatencyHistogramTest, Buckets) {
+  LatencyHistogram histogram;
+  for (int64_t latency : {0, 1, 2, 3, 4, 7, 8, 100}) {
+    histogram.Add(latency);
+  }
+  EXPECT_EQ(histogram.count(), 8);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 100);
+  EXPECT_DOUBLE_EQ(histogram.mean(), 125.0 / 8);
+  EXPECT_THAT(histogram.buckets(), ElementsAre(1, 1, 2, 2, 1, 0, 0, 1));
+  EXPECT_EQ(histogram.Percentile(50), 3);
+  EXPECT_EQ(histogram.Percentile(100), 100);
+}
+
+}  // namespace
+}  // namespace noc
+}  // namespace xls
@@ -32,6 +32,8 @@ class ArithSimplificationPass : public FunctionBasePass {
   ~ArithSimplificationPass() override {}
 
  protected:
+  bool IsIncremental() const override { return true; }
+
   int64_t opt_level_;
   absl::StatusOr<bool> RunOnFunctionBaseInternal(
       FunctionBase* f, const PassOptions& options,
@@ -21,6 +21,7 @@
 #include "xls/ir/nodes.h"
 #include "xls/ir/type.h"
 #include "xls/ir/value_helpers.h"
+#include "xls/passes/query_engine_cache.h"
 #include "xls/passes/ternary_query_engine.h"
 
 namespace xls {
@@ -112,12 +113,14 @@ bool IndicesAreDefinitelyPrefixOf(absl::Span<Node* const> prefix,
 // replaced with a literal value equal to the maximum in-bounds index value
 // (size of array minus one). Only known-OOB are clamped. Maybe OOB indices
 // cannot be replaced because the index might be a different in-bounds value.
-absl::StatusOr<bool> ClampArrayIndexIndices(FunctionBase* func) {
+absl::StatusOr<bool> ClampArrayIndexIndices(FunctionBase* func,
+                                            const PassOptions& options) {
   // This transformation may add nodes to the graph which invalidates the query
-  // engine for later use, so create a private engine for exclusive use of this
-  // transformation.
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(func));
+  // engine for later use, so later transformations request the engine again
+  // (bringing it up to date) rather than sharing this one.
+  std::unique_ptr<TernaryQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(TernaryQueryEngine * query_engine,
+                       GetTernaryQueryEngine(func, options, &owned_engine));
   bool changed = false;
   for (Node* node : TopoSort(func)) {
     if (node->Is<ArrayIndex>()) {
@@ -658,9 +661,11 @@ FlattenArrayUpdateChain(ArrayUpdate* array_update,
 
 // Walk the function and replace chains of sequential array updates with kArray
 // operations with gather the update values.
-absl::StatusOr<bool> FlattenSequentialUpdates(FunctionBase* func) {
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(func));
+absl::StatusOr<bool> FlattenSequentialUpdates(FunctionBase* func,
+                                              const PassOptions& options) {
+  std::unique_ptr<TernaryQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(TernaryQueryEngine * query_engine,
+                       GetTernaryQueryEngine(func, options, &owned_engine));
   absl::flat_hash_set<ArrayUpdate*> flattened_updates;
   bool changed = false;
   // Perform this optimization in reverse topo sort order because we are looking
@@ -913,11 +918,13 @@ absl::StatusOr<bool> ArraySimplificationPass::RunOnFunctionBaseInternal(
     PassResults* results) const {
   bool changed = false;
 
-  XLS_ASSIGN_OR_RETURN(bool clamp_changed, ClampArrayIndexIndices(func));
+  XLS_ASSIGN_OR_RETURN(bool clamp_changed,
+                       ClampArrayIndexIndices(func, options));
   changed |= clamp_changed;
 
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(func));
+  std::unique_ptr<TernaryQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(TernaryQueryEngine * query_engine,
+                       GetTernaryQueryEngine(func, options, &owned_engine));
 
   for (Node* node : TopoSort(func)) {
     if (node->Is<ArrayIndex>()) {
@@ -942,7 +949,8 @@ absl::StatusOr<bool> ArraySimplificationPass::RunOnFunctionBaseInternal(
     }
   }
 
-  XLS_ASSIGN_OR_RETURN(bool flatten_changed, FlattenSequentialUpdates(func));
+  XLS_ASSIGN_OR_RETURN(bool flatten_changed,
+                       FlattenSequentialUpdates(func, options));
   changed = changed | flatten_changed;
   return changed;
 }
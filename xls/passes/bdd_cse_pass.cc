@@ -14,7 +14,9 @@
 
 #include "xls/passes/bdd_cse_pass.h"
 
+#include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -29,6 +31,9 @@
 #include "xls/ir/node.h"
 #include "xls/ir/node_iterator.h"
 #include "xls/passes/bdd_function.h"
+#include "xls/passes/bdd_query_engine.h"
+#include "xls/passes/partitioned_bdd_query_engine.h"
+#include "xls/passes/query_engine_cache.h"
 
 namespace xls {
 
@@ -95,18 +100,49 @@ absl::StatusOr<std::vector<Node*>> GetNodeOrder(FunctionBase* f) {
 absl::StatusOr<bool> BddCsePass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
   // TODO(meheff): Try tuning the minterm limit.
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<BddFunction> bdd_function,
-                       BddFunction::Run(f, /*minterm_limit=*/4096));
+  std::unique_ptr<BddQueryEngine> owned_engine;
+  std::unique_ptr<PartitionedBddQueryEngine> partitioned_engine;
+  // Identifies the expression of each bit by the partition of the BDD holding
+  // it (zero if the function is not partitioned) and its BDD node. Constant
+  // expressions are identified by value alone, since they are the only ones
+  // which may be shared by different partitions.
+  std::function<std::pair<int64_t, int64_t>(Node*, int64_t)> bit_key;
+  if (options.bdd_parallelism > 1) {
+    XLS_ASSIGN_OR_RETURN(
+        partitioned_engine,
+        PartitionedBddQueryEngine::Run(f, options.bdd_parallelism,
+                                       /*minterm_limit=*/4096));
+    bit_key = [&](Node* n, int64_t i) -> std::pair<int64_t, int64_t> {
+      int64_t partition = partitioned_engine->GetPartition(n).value();
+      const BddFunction& bdd_function =
+          partitioned_engine->partition_engine(partition).bdd_function();
+      BddNodeIndex bdd_node = bdd_function.GetBddNode(n, i);
+      if (bdd_node == bdd_function.bdd().zero() ||
+          bdd_node == bdd_function.bdd().one()) {
+        return {-1, bdd_node == bdd_function.bdd().one()};
+      }
+      return {partition, bdd_node.value()};
+    };
+  } else {
+    XLS_ASSIGN_OR_RETURN(BddQueryEngine * query_engine,
+                         GetBddQueryEngine(f, options, &owned_engine,
+                                           /*minterm_limit=*/4096));
+    const BddFunction* bdd_function = &query_engine->bdd_function();
+    bit_key = [bdd_function](Node* n,
+                             int64_t i) -> std::pair<int64_t, int64_t> {
+      return {0, bdd_function->GetBddNode(n, i).value()};
+    };
+  }
 
   // To improve efficiency, bucket potentially common nodes together. The
   // bucketing is done via a int64_t hash value of the BDD node indices of each
   // bit of the node.
-  auto hasher = absl::Hash<std::vector<int64_t>>();
+  auto hasher = absl::Hash<std::vector<std::pair<int64_t, int64_t>>>();
   auto node_hash = [&](Node* n) {
     XLS_CHECK(n->GetType()->IsBits());
-    std::vector<int64_t> values_to_hash;
+    std::vector<std::pair<int64_t, int64_t>> values_to_hash;
     for (int64_t i = 0; i < n->BitCountOrDie(); ++i) {
-      values_to_hash.push_back(bdd_function->GetBddNode(n, i).value());
+      values_to_hash.push_back(bit_key(n, i));
     }
     return hasher(values_to_hash);
   };
@@ -116,7 +152,7 @@ absl::StatusOr<bool> BddCsePass::RunOnFunctionBaseInternal(
       return false;
     }
     for (int64_t i = 0; i < a->BitCountOrDie(); ++i) {
-      if (bdd_function->GetBddNode(a, i) != bdd_function->GetBddNode(b, i)) {
+      if (bit_key(a, i) != bit_key(b, i)) {
         return false;
       }
     }
@@ -35,9 +35,11 @@ class BddCsePassTest : public IrTestBase {
  protected:
   BddCsePassTest() = default;
 
-  absl::StatusOr<bool> Run(Function* f) {
+  absl::StatusOr<bool> Run(Function* f, int64_t bdd_parallelism = 1) {
     PassResults results;
-    return BddCsePass().RunOnFunctionBase(f, PassOptions(), &results);
+    PassOptions options;
+    options.bdd_parallelism = bdd_parallelism;
+    return BddCsePass().RunOnFunctionBase(f, options, &results);
   }
 };
 
@@ -86,5 +88,29 @@ TEST_F(BddCsePassTest, DecodeEquivalentToDeconstructedDecode) {
   EXPECT_THAT(f->return_value(), m::Tuple(m::Decode(), m::Decode()));
 }
 
+TEST_F(BddCsePassTest, Partitioned) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(16));
+  BValue forty_two = fb.Literal(UBits(42, 16));
+  BValue x_eq_42 = fb.Eq(x, forty_two);
+  BValue forty_two_not_ne_x = fb.Not(fb.Ne(forty_two, x));
+  // The sum is in a different logic cloud from x. Its comparison with 42 has
+  // the same form but not the same value as x's.
+  BValue sum = fb.Add(x, x);
+  BValue sum_forty_two = fb.Literal(UBits(42, 16));
+  BValue sum_eq_42 = fb.Eq(sum, sum_forty_two);
+  BValue sum_not_ne_42 = fb.Not(fb.Ne(sum, sum_forty_two));
+  fb.Tuple({x_eq_42, forty_two_not_ne_x, sum_eq_42, sum_not_ne_42});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  EXPECT_THAT(Run(f, /*bdd_parallelism=*/4), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(),
+              m::Tuple(m::Eq(m::Param("x"), m::Literal(42)),
+                       m::Eq(m::Param("x"), m::Literal(42)),
+                       m::Eq(m::Add(), m::Literal(42)),
+                       m::Eq(m::Add(), m::Literal(42))));
+}
+
 }  // namespace
 }  // namespace xls
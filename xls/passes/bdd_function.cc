@@ -14,8 +14,10 @@
 
 #include "xls/passes/bdd_function.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
@@ -25,6 +27,7 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/data_structures/union_find.h"
 #include "xls/interpreter/ir_interpreter.h"
 #include "xls/ir/abstract_evaluator.h"
 #include "xls/ir/abstract_node_evaluator.h"
@@ -79,8 +82,9 @@ BddNodeVector ToBddNodeVector(const SaturatingBddNodeVector& input) {
 class SaturatingBddEvaluator
     : public AbstractEvaluator<SaturatingBddNodeIndex, SaturatingBddEvaluator> {
  public:
-  SaturatingBddEvaluator(int64_t minterm_limit, BinaryDecisionDiagram* bdd)
-      : minterm_limit_(minterm_limit), bdd_(bdd) {}
+  SaturatingBddEvaluator(int64_t minterm_limit, int64_t node_limit,
+                         BinaryDecisionDiagram* bdd)
+      : minterm_limit_(minterm_limit), node_limit_(node_limit), bdd_(bdd) {}
 
   SaturatingBddNodeIndex One() const { return bdd_->one(); }
 
@@ -108,6 +112,9 @@ class SaturatingBddEvaluator
     if (minterm_limit_ > 0 && bdd_->minterm_count(result) > minterm_limit_) {
       return TooManyMinterms();
     }
+    if (node_limit_ > 0 && bdd_->size() > node_limit_) {
+      return TooManyMinterms();
+    }
     return result;
   }
 
@@ -122,11 +129,15 @@ class SaturatingBddEvaluator
     if (minterm_limit_ > 0 && bdd_->minterm_count(result) > minterm_limit_) {
       return TooManyMinterms();
     }
+    if (node_limit_ > 0 && bdd_->size() > node_limit_) {
+      return TooManyMinterms();
+    }
     return result;
   }
 
  private:
   int64_t minterm_limit_;
+  int64_t node_limit_;
   BinaryDecisionDiagram* bdd_;
 };
 
@@ -241,60 +252,158 @@ bool ShouldEvaluate(Node* node) {
   XLS_LOG(FATAL) << "Invalid op: " << static_cast<int64_t>(node->op());
 }
 
+// Returns true if the expression of 'node' is composed from the expressions of
+// its operands, as opposed to the node being modeled as variables.
+bool EvaluatesOperands(Node* node,
+                       const absl::flat_hash_set<Op>& do_not_evaluate_ops) {
+  return ShouldEvaluate(node) && !do_not_evaluate_ops.contains(node->op()) &&
+         std::all_of(node->operands().begin(), node->operands().end(),
+                     [](Node* o) { return o->GetType()->IsBits(); });
+}
+
 }  // namespace
 
 /* static */ absl::StatusOr<std::unique_ptr<BddFunction>> BddFunction::Run(
     FunctionBase* f, int64_t minterm_limit,
-    absl::Span<const Op> do_not_evaluate_ops) {
+    absl::Span<const Op> do_not_evaluate_ops, int64_t node_limit,
+    int64_t reorder_threshold) {
   XLS_VLOG(1) << absl::StreamFormat("BddFunction::Run(%s):", f->name());
-  XLS_VLOG_LINES(5, f->DumpIr());
+  auto bdd_function = absl::WrapUnique(new BddFunction(
+      f, minterm_limit, do_not_evaluate_ops, node_limit, reorder_threshold));
+  XLS_RETURN_IF_ERROR(bdd_function->Update().status());
+  return std::move(bdd_function);
+}
 
-  auto bdd_function = absl::WrapUnique(new BddFunction(f));
-  SaturatingBddEvaluator evaluator(minterm_limit, &bdd_function->bdd());
-  absl::flat_hash_set<Op> do_not_evaluate_ops_set;
-  for (Op op : do_not_evaluate_ops) {
-    do_not_evaluate_ops_set.insert(op);
-  }
+/* static */ absl::StatusOr<std::unique_ptr<BddFunction>>
+BddFunction::RunOnNodes(FunctionBase* f, absl::Span<Node* const> nodes,
+                        int64_t minterm_limit,
+                        absl::Span<const Op> do_not_evaluate_ops) {
+  XLS_VLOG(1) << absl::StreamFormat("BddFunction::RunOnNodes(%s, %d nodes):",
+                                    f->name(), nodes.size());
+  auto bdd_function = absl::WrapUnique(
+      new BddFunction(f, minterm_limit, do_not_evaluate_ops, /*node_limit=*/0,
+                      /*reorder_threshold=*/0));
+  bdd_function->nodes_.emplace(nodes.begin(), nodes.end());
+  XLS_RETURN_IF_ERROR(bdd_function->Update().status());
+  return std::move(bdd_function);
+}
 
-  // Create and return a vector containing newly defined BDD variables.
-  auto create_new_node_vector = [&](Node* n) {
-    SaturatingBddNodeVector v;
-    for (int64_t i = 0; i < n->BitCountOrDie(); ++i) {
-      v.push_back(bdd_function->bdd().NewVariable());
+/* static */ std::vector<std::vector<Node*>> BddFunction::LogicClouds(
+    FunctionBase* f, absl::Span<const Op> do_not_evaluate_ops) {
+  absl::flat_hash_set<Op> ops(do_not_evaluate_ops.begin(),
+                              do_not_evaluate_ops.end());
+  std::vector<Node*> order;
+  absl::flat_hash_map<Node*, int64_t> index;
+  for (Node* node : TopoSort(f)) {
+    if (node->GetType()->IsBits()) {
+      index[node] = order.size();
+      order.push_back(node);
     }
-    bdd_function->saturated_expressions_.insert(n);
-    return v;
-  };
+  }
+  std::vector<UnionFind<int64_t>> clouds(order.size());
+  for (int64_t i = 0; i < order.size(); ++i) {
+    if (!EvaluatesOperands(order[i], ops)) {
+      continue;
+    }
+    for (Node* operand : order[i]->operands()) {
+      clouds[i].Merge(&clouds[index.at(operand)]);
+    }
+  }
+  std::vector<std::vector<Node*>> result;
+  absl::flat_hash_map<UnionFind<int64_t>*, int64_t> result_index;
+  for (int64_t i = 0; i < order.size(); ++i) {
+    auto [it, inserted] =
+        result_index.insert({clouds[i].FindRoot(), result.size()});
+    if (inserted) {
+      result.emplace_back();
+    }
+    result[it->second].push_back(order[i]);
+  }
+  return result;
+}
+
+absl::StatusOr<std::vector<Node*>> BddFunction::Update() {
+  XLS_VLOG(1) << absl::StreamFormat("BddFunction::Update(%s):",
+                                    func_base_->name());
+  XLS_VLOG_LINES(5, func_base_->DumpIr());
+
+  SaturatingBddEvaluator evaluator(minterm_limit_, node_limit_, &bdd_);
 
   XLS_VLOG(3) << "BDD expressions:";
-  absl::flat_hash_map<Node*, SaturatingBddNodeVector> values;
-  for (Node* node : TopoSort(f)) {
-    if (!node->GetType()->IsBits()) {
+  std::vector<Node*> updated;
+  absl::flat_hash_set<const Node*> updated_set;
+  absl::flat_hash_set<const Node*> live;
+  for (Node* node : TopoSort(func_base_)) {
+    if (!node->GetType()->IsBits() ||
+        (nodes_.has_value() && !nodes_->contains(node))) {
       continue;
     }
+    live.insert(node);
+    if (bdd_.size() > gc_threshold_ ||
+        (reorder_threshold_ > 0 && bdd_.size() > reorder_threshold_)) {
+      CollectGarbage();
+    }
+    auto value_it = node_map_.find(node);
+    bool tracked = value_it != node_map_.end();
+    if (tracked && node->change_count() <= change_count_ &&
+        std::none_of(node->operands().begin(), node->operands().end(),
+                     [&](Node* o) { return updated_set.contains(o); })) {
+      continue;
+    }
+
+    // The variables previously owned by this node, if any.
+    const BddNodeVector* old_value = nullptr;
+    const std::vector<bool>* old_is_variable = nullptr;
+    auto variables_it = variable_bits_.find(node);
+    if (tracked && variables_it != variable_bits_.end() &&
+        variables_it->second.node_id == node->id() &&
+        value_it->second.size() == node->BitCountOrDie()) {
+      old_value = &value_it->second;
+      old_is_variable = &variables_it->second.is_variable;
+    }
+    std::vector<bool> is_variable(node->BitCountOrDie(), false);
+    auto variable = [&](int64_t bit_index) -> BddNodeIndex {
+      is_variable[bit_index] = true;
+      if (old_is_variable != nullptr && (*old_is_variable)[bit_index]) {
+        return (*old_value)[bit_index];
+      }
+      return bdd_.NewVariable();
+    };
+
+    // Create and return a vector containing BDD variables for the node.
+    auto create_new_node_vector = [&](Node* n) {
+      XLS_CHECK_EQ(n, node);
+      SaturatingBddNodeVector v;
+      for (int64_t i = 0; i < n->BitCountOrDie(); ++i) {
+        v.push_back(variable(i));
+      }
+      return v;
+    };
+
     // If we shouldn't evaluate this node, the node is to be modeled as
     // variables, or the node includes some non-bits-typed operands, then just
-    // create a vector of new BDD variables for this node.
-    if (!ShouldEvaluate(node) || do_not_evaluate_ops_set.contains(node->op()) ||
+    // create a vector of BDD variables for this node.
+    SaturatingBddNodeVector value;
+    if (!EvaluatesOperands(node, do_not_evaluate_ops_) ||
         std::any_of(node->operands().begin(), node->operands().end(),
-                    [](Node* o) { return !o->GetType()->IsBits(); })) {
-      values[node] = create_new_node_vector(node);
+                    [&](Node* o) { return !node_map_.contains(o); })) {
+      value = create_new_node_vector(node);
     } else {
       std::vector<SaturatingBddNodeVector> operand_values;
       for (Node* operand : node->operands()) {
-        operand_values.push_back(values.at(operand));
+        const BddNodeVector& operand_value = node_map_.at(operand);
+        operand_values.emplace_back(operand_value.begin(),
+                                    operand_value.end());
       }
       XLS_ASSIGN_OR_RETURN(
-          values[node],
-          AbstractEvaluate(node, operand_values, &evaluator,
-                           /*default_handler=*/create_new_node_vector));
+          value, AbstractEvaluate(node, operand_values, &evaluator,
+                                  /*default_handler=*/create_new_node_vector));
 
-      // Associate a new BDD variable with each bit that exceeded the minterm
+      // Associate a BDD variable with each bit that exceeded the minterm
       // limit.
-      for (SaturatingBddNodeIndex& value : values.at(node)) {
-        if (absl::holds_alternative<TooManyMinterms>(value)) {
-          bdd_function->saturated_expressions_.insert(node);
-          value = bdd_function->bdd().NewVariable();
+      for (int64_t i = 0; i < value.size(); ++i) {
+        if (absl::holds_alternative<TooManyMinterms>(value[i])) {
+          value[i] = variable(i);
         }
       }
     }
@@ -302,19 +411,61 @@ bool ShouldEvaluate(Node* node) {
     for (int64_t i = 0; i < node->BitCountOrDie(); ++i) {
       XLS_VLOG(5) << absl::StreamFormat(
           "    bit %d : %s", i,
-          bdd_function->bdd().ToStringDnf(
-              absl::get<BddNodeIndex>(values.at(node)[i]),
-              /*minterm_limit=*/15));
+          bdd_.ToStringDnf(absl::get<BddNodeIndex>(value[i]),
+                           /*minterm_limit=*/15));
+    }
+
+    // At this point any TooManyMinterm sentinel values have been replaced with
+    // BDD variables.
+    BddNodeVector bdd_value = ToBddNodeVector(value);
+    if (std::find(is_variable.begin(), is_variable.end(), true) !=
+        is_variable.end()) {
+      variable_bits_[node] = VariableBits{node->id(), std::move(is_variable)};
+    } else {
+      variable_bits_.erase(node);
+    }
+    if (!tracked || value_it->second != bdd_value) {
+      updated.push_back(node);
+      updated_set.insert(node);
+      node_map_[node] = std::move(bdd_value);
     }
   }
 
-  // Copy over the vector and BDD variables into the node map which is exposed
-  // via the BddFunction interface. At this point any TooManyMinterm sentinel
-  // values have been replaced with new Bdd variables.
-  for (const auto& pair : values) {
-    bdd_function->node_map_[pair.first] = ToBddNodeVector(pair.second);
+  // Drop the expressions of nodes which have been removed from the function.
+  for (auto it = node_map_.begin(); it != node_map_.end();) {
+    if (live.contains(it->first)) {
+      ++it;
+    } else {
+      node_map_.erase(it++);
+    }
+  }
+  for (auto it = variable_bits_.begin(); it != variable_bits_.end();) {
+    if (live.contains(it->first)) {
+      ++it;
+    } else {
+      variable_bits_.erase(it++);
+    }
+  }
+  change_count_ = func_base_->change_count();
+  return updated;
+}
+
+void BddFunction::CollectGarbage() {
+  std::vector<BddNodeIndex> roots;
+  for (const auto& [node, value] : node_map_) {
+    roots.insert(roots.end(), value.begin(), value.end());
+  }
+  bdd_.GarbageCollect(roots);
+  if (reorder_threshold_ > 0 && bdd_.size() > reorder_threshold_) {
+    bdd_.Reorder(roots);
+    reorder_threshold_ = std::max(reorder_threshold_, 2 * bdd_.size());
+  }
+  gc_threshold_ = std::max(kMinGcThreshold, 2 * bdd_.size());
+  // Collect again before the node limit is reached, unless the function's
+  // expressions alone exceed it.
+  if (node_limit_ > 0 && bdd_.size() < node_limit_) {
+    gc_threshold_ = std::min(gc_threshold_, node_limit_);
   }
-  return std::move(bdd_function);
 }
 
 absl::StatusOr<Value> BddFunction::Evaluate(
@@ -338,7 +489,7 @@ absl::StatusOr<Value> BddFunction::Evaluate(
                            function->GetParamIndex(node->As<Param>()));
       result = args.at(param_index);
     } else if (!node->GetType()->IsBits() ||
-               saturated_expressions_.contains(node)) {
+               variable_bits_.contains(node)) {
       std::vector<const Value*> operand_values;
       for (Node* operand : node->operands()) {
         operand_values.push_back(&values.at(operand));
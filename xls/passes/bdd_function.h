@@ -15,8 +15,14 @@
 #ifndef XLS_PASSES_BDD_FUNCTION_H_
 #define XLS_PASSES_BDD_FUNCTION_H_
 
+#include <algorithm>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "xls/common/logging/logging.h"
 #include "xls/data_structures/binary_decision_diagram.h"
 #include "xls/data_structures/leaf_type_tree.h"
@@ -26,7 +32,7 @@
 namespace xls {
 
 using BddNodeVector = std::vector<BddNodeIndex>;
-using NodeMap = absl::flat_hash_map<const Node*, BddNodeVector>;
+using BddNodeMap = absl::flat_hash_map<const Node*, BddNodeVector>;
 
 // A class which represents an XLS function using a binary decision diagram
 // (BDD). The BDD is constructed by an abstract evaluation of the operations in
@@ -48,9 +54,54 @@ class BddFunction {
   // new BDD variable. If a node's op is in 'do_not_evaluate_ops', its
   // bits are modeled as BDD variables. Otherwise, bits are represented as BDD
   // nodes whose values are determined by the values of other BDD nodes.
+  //
+  // The BDD is garbage collected as it grows, so its size is bounded by the
+  // expressions of the function's current nodes. If 'node_limit' is non-zero,
+  // it further bounds the number of BDD nodes (and hence the memory of the
+  // BDD): while the BDD holds more nodes than this, bits are modeled as new
+  // variables as if they had exceeded the minterm limit.
+  //
+  // If 'reorder_threshold' is non-zero, the BDD variables are reordered by
+  // sifting (see BinaryDecisionDiagram::Reorder) whenever the BDD holds more
+  // nodes than this after garbage collection. The threshold is then raised to
+  // twice the size of the reordered BDD.
   static absl::StatusOr<std::unique_ptr<BddFunction>> Run(
       FunctionBase* f, int64_t minterm_limit = 0,
-      absl::Span<const Op> do_not_evaluate_ops = {});
+      absl::Span<const Op> do_not_evaluate_ops = {}, int64_t node_limit = 0,
+      int64_t reorder_threshold = 0);
+
+  // Like Run, but only the given nodes of the function are expressed in the
+  // BDD; no other node is tracked, and operands outside the set are modeled as
+  // variables. Used to build the BDDs of the logic clouds of a function
+  // separately (see LogicClouds).
+  static absl::StatusOr<std::unique_ptr<BddFunction>> RunOnNodes(
+      FunctionBase* f, absl::Span<Node* const> nodes,
+      int64_t minterm_limit = 0, absl::Span<const Op> do_not_evaluate_ops = {});
+
+  // Partitions the bits-typed nodes of 'f' into logic clouds: sets of nodes
+  // whose BDD expressions share no variables. A node evaluated in the BDD is
+  // in the cloud of each of its operands, so clouds are separated where a node
+  // modeled as variables (e.g., an arithmetic operation or a node whose op is
+  // in 'do_not_evaluate_ops') consumes values. Each cloud's nodes are in
+  // topological order.
+  static std::vector<std::vector<Node*>> LogicClouds(
+      FunctionBase* f, absl::Span<const Op> do_not_evaluate_ops = {});
+
+  // Brings the BDD up to date with changes made to the function since it was
+  // built or last updated. Only nodes which changed, or whose operands'
+  // expressions changed, are re-evaluated. A re-evaluated node keeps the BDD
+  // variables it previously owned for bits which are still modeled as
+  // variables, so users of such nodes are unaffected. Returns the nodes whose
+  // expressions were added or changed.
+  //
+  // BDD expressions other than those of the function's nodes (for example
+  // ones built by queries) may be garbage collected by Update.
+  absl::StatusOr<std::vector<Node*>> Update();
+
+  // The minimum number of BDD nodes at which the BDD is garbage collected.
+  static constexpr int64_t kMinGcThreshold = 1 << 16;
+
+  FunctionBase* function_base() const { return func_base_; }
 
   // Returns the underlying BDD.
   const BinaryDecisionDiagram& bdd() const { return bdd_; }
@@ -70,18 +121,55 @@ class BddFunction {
   absl::StatusOr<Value> Evaluate(absl::Span<const Value> args) const;
 
  private:
-  explicit BddFunction(FunctionBase* f) : func_base_(f) {}
+  BddFunction(FunctionBase* f, int64_t minterm_limit,
+              absl::Span<const Op> do_not_evaluate_ops, int64_t node_limit,
+              int64_t reorder_threshold)
+      : func_base_(f),
+        minterm_limit_(minterm_limit),
+        do_not_evaluate_ops_(do_not_evaluate_ops.begin(),
+                             do_not_evaluate_ops.end()),
+        node_limit_(node_limit),
+        gc_threshold_(node_limit > 0 ? std::min(kMinGcThreshold, node_limit)
+                                     : kMinGcThreshold),
+        reorder_threshold_(reorder_threshold) {}
+
+  // Frees the BDD nodes not used by the expressions of the function's nodes,
+  // and reorders the BDD variables if the BDD is above the reorder threshold.
+  void CollectGarbage();
 
   FunctionBase* func_base_;
+  int64_t minterm_limit_;
+  absl::flat_hash_set<Op> do_not_evaluate_ops_;
+  int64_t node_limit_;
   BinaryDecisionDiagram bdd_;
 
+  // The BDD is garbage collected when it holds more nodes than this. After
+  // each collection it is reset to twice the number of remaining nodes.
+  int64_t gc_threshold_;
+
+  // The BDD is reordered when it holds more nodes than this after garbage
+  // collection. Zero disables reordering.
+  int64_t reorder_threshold_;
+
+  // The change count of the function when the BDD was last updated.
+  int64_t change_count_ = -1;
+
+  // If present, the only nodes expressed in the BDD.
+  absl::optional<absl::flat_hash_set<Node*>> nodes_;
+
   // A map from XLS Node to vector of BDD nodes representing the XLS Node's
   // expression.
-  NodeMap node_map_;
+  BddNodeMap node_map_;
 
-  // Map containing the Nodes whose expressions exceeded the maximum number of
-  // minterms.
-  absl::flat_hash_set<Node*> saturated_expressions_;
+  // The bits of a node which are modeled as BDD variables, either because the
+  // node is not evaluated or because the bit's expression exceeded the maximum
+  // number of minterms. Only nodes with at least one such bit are present. The
+  // node id guards against a new node reusing the address of a removed one.
+  struct VariableBits {
+    int64_t node_id;
+    std::vector<bool> is_variable;
+  };
+  absl::flat_hash_map<const Node*, VariableBits> variable_bits_;
 };
 
 }  // namespace xls
@@ -107,6 +107,75 @@ TEST_F(BddFunctionTest, Parity) {
   }
 }
 
+TEST_F(BddFunctionTest, NodeLimit) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(16));
+  BValue y = fb.Param("y", p->GetBitsType(16));
+  // Comparing interleaved operands with this variable order gives a BDD which
+  // is exponential in the bit count.
+  BValue equal = fb.Literal(UBits(1, 1));
+  for (int64_t i = 0; i < 16; ++i) {
+    equal = fb.And(equal, fb.Not(fb.Xor(fb.BitSlice(x, i, 1),
+                                        fb.BitSlice(y, 15 - i, 1))));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  const int64_t kNumSamples = 100;
+  std::minstd_rand engine;
+  for (int64_t node_limit : {0, 256, 1024}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<BddFunction> bdd_function,
+        BddFunction::Run(f, /*minterm_limit=*/0, /*do_not_evaluate_ops=*/{},
+                         node_limit));
+    if (node_limit > 0) {
+      // The limit may be exceeded by the nodes built for a single operation.
+      EXPECT_LT(bdd_function->bdd().size(), 2 * node_limit);
+    }
+    for (int64_t i = 0; i < kNumSamples; ++i) {
+      std::vector<Value> inputs = RandomFunctionArguments(f, &engine);
+      XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(f, inputs));
+      XLS_ASSERT_OK_AND_ASSIGN(Value actual, bdd_function->Evaluate(inputs));
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST_F(BddFunctionTest, Reorder) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(16));
+  BValue y = fb.Param("y", p->GetBitsType(16));
+  BValue equal = fb.Literal(UBits(1, 1));
+  for (int64_t i = 0; i < 16; ++i) {
+    equal = fb.And(equal, fb.Not(fb.Xor(fb.BitSlice(x, i, 1),
+                                        fb.BitSlice(y, 15 - i, 1))));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // Sifting pairs up the compared bits, so the comparison is computed exactly
+  // in a small BDD.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<BddFunction> bdd_function,
+      BddFunction::Run(f, /*minterm_limit=*/0, /*do_not_evaluate_ops=*/{},
+                       /*node_limit=*/0, /*reorder_threshold=*/128));
+  EXPECT_GT(bdd_function->bdd().reorder_stats().reorder_count, 0);
+  EXPECT_LT(bdd_function->bdd().size(), 1024);
+  EXPECT_EQ(bdd_function->bdd().variable_count(), 32);
+
+  const int64_t kNumSamples = 100;
+  std::minstd_rand engine;
+  for (int64_t i = 0; i < kNumSamples; ++i) {
+    std::vector<Value> inputs = RandomFunctionArguments(f, &engine);
+    XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(f, inputs));
+    XLS_ASSERT_OK_AND_ASSIGN(Value actual, bdd_function->Evaluate(inputs));
+    EXPECT_EQ(expected, actual);
+  }
+  EXPECT_THAT(bdd_function->Evaluate({Value(UBits(0x1234, 16)),
+                                      Value(UBits(0x2c48, 16))}),
+              IsOkAndHolds(Value(UBits(1, 1))));
+}
+
 TEST_F(BddFunctionTest, BenchmarkTest) {
   // Run samples through various bechmarks and verify against the interpreter.
   for (std::string benchmark : {"crc32", "sha256"}) {
@@ -14,6 +14,9 @@
 
 #include "xls/passes/bdd_query_engine.h"
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
@@ -30,35 +33,75 @@ absl::StatusOr<std::unique_ptr<BddQueryEngine>> BddQueryEngine::Run(
     FunctionBase* f, int64_t minterm_limit,
     absl::Span<const Op> do_not_evaluate_ops) {
   auto query_engine = absl::WrapUnique(new BddQueryEngine(minterm_limit));
-  XLS_ASSIGN_OR_RETURN(query_engine->bdd_function_,
-                       BddFunction::Run(f, minterm_limit, do_not_evaluate_ops));
-  // Construct the Bits objects indication which bit values are statically known
-  // for each node and what those values are (0 or 1) if known.
-  BinaryDecisionDiagram& bdd = query_engine->bdd();
+  XLS_ASSIGN_OR_RETURN(
+      query_engine->bdd_function_,
+      BddFunction::Run(f, minterm_limit, do_not_evaluate_ops));
   for (Node* node : f->nodes()) {
     if (node->GetType()->IsBits()) {
-      absl::InlinedVector<bool, 1> known_bits;
-      absl::InlinedVector<bool, 1> bits_values;
-      for (int64_t i = 0; i < node->BitCountOrDie(); ++i) {
-        if (query_engine->GetBddNode(BitLocation(node, i)) == bdd.zero()) {
-          known_bits.push_back(true);
-          bits_values.push_back(false);
-        } else if (query_engine->GetBddNode(BitLocation(node, i)) ==
-                   bdd.one()) {
-          known_bits.push_back(true);
-          bits_values.push_back(true);
-        } else {
-          known_bits.push_back(false);
-          bits_values.push_back(false);
-        }
-      }
-      query_engine->known_bits_[node] = Bits(known_bits);
-      query_engine->bits_values_[node] = Bits(bits_values);
+      query_engine->SetKnownBits(node);
+    }
+  }
+  return std::move(query_engine);
+}
+
+/* static */
+absl::StatusOr<std::unique_ptr<BddQueryEngine>> BddQueryEngine::RunOnNodes(
+    FunctionBase* f, absl::Span<Node* const> nodes, int64_t minterm_limit,
+    absl::Span<const Op> do_not_evaluate_ops) {
+  auto query_engine = absl::WrapUnique(new BddQueryEngine(minterm_limit));
+  XLS_ASSIGN_OR_RETURN(
+      query_engine->bdd_function_,
+      BddFunction::RunOnNodes(f, nodes, minterm_limit, do_not_evaluate_ops));
+  for (Node* node : nodes) {
+    if (node->GetType()->IsBits()) {
+      query_engine->SetKnownBits(node);
     }
   }
   return std::move(query_engine);
 }
 
+absl::Status BddQueryEngine::Update() {
+  XLS_ASSIGN_OR_RETURN(std::vector<Node*> updated, bdd_function_->Update());
+  for (Node* node : updated) {
+    SetKnownBits(node);
+  }
+  // Drop the entries of nodes which have been removed from the function.
+  absl::flat_hash_set<Node*> live;
+  for (Node* node : function()->nodes()) {
+    live.insert(node);
+  }
+  for (auto it = known_bits_.begin(); it != known_bits_.end();) {
+    if (live.contains(it->first)) {
+      ++it;
+    } else {
+      bits_values_.erase(it->first);
+      known_bits_.erase(it++);
+    }
+  }
+  return absl::OkStatus();
+}
+
+void BddQueryEngine::SetKnownBits(Node* node) {
+  // Construct the Bits objects indication which bit values are statically known
+  // for the node and what those values are (0 or 1) if known.
+  absl::InlinedVector<bool, 1> known_bits;
+  absl::InlinedVector<bool, 1> bits_values;
+  for (int64_t i = 0; i < node->BitCountOrDie(); ++i) {
+    if (GetBddNode(BitLocation(node, i)) == bdd().zero()) {
+      known_bits.push_back(true);
+      bits_values.push_back(false);
+    } else if (GetBddNode(BitLocation(node, i)) == bdd().one()) {
+      known_bits.push_back(true);
+      bits_values.push_back(true);
+    } else {
+      known_bits.push_back(false);
+      bits_values.push_back(false);
+    }
+  }
+  known_bits_[node] = Bits(known_bits);
+  bits_values_[node] = Bits(bits_values);
+}
+
 bool BddQueryEngine::AtMostOneTrue(absl::Span<BitLocation const> bits) const {
   BddNodeIndex result = bdd().zero();
   for (int64_t i = 0; i < bits.size(); ++i) {
@@ -19,6 +19,7 @@
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/function.h"
 #include "xls/ir/nodes.h"
@@ -44,6 +45,20 @@ class BddQueryEngine : public QueryEngine {
       FunctionBase* f, int64_t minterm_limit = 0,
       absl::Span<const Op> do_not_evaluate_ops = {});
 
+  // Like Run, but only the given nodes are tracked (see
+  // BddFunction::RunOnNodes).
+  static absl::StatusOr<std::unique_ptr<BddQueryEngine>> RunOnNodes(
+      FunctionBase* f, absl::Span<Node* const> nodes,
+      int64_t minterm_limit = 0,
+      absl::Span<const Op> do_not_evaluate_ops = {});
+
+  // Brings the engine up to date with changes made to the function since it
+  // was run or last updated. Only the fan-out cone of modified nodes is
+  // re-evaluated.
+  absl::Status Update();
+
+  FunctionBase* function() const { return bdd_function_->function_base(); }
+
   bool IsTracked(Node* node) const override {
     return known_bits_.contains(node);
   }
@@ -72,6 +87,9 @@ class BddQueryEngine : public QueryEngine {
   explicit BddQueryEngine(int64_t minterm_limit)
       : minterm_limit_(minterm_limit) {}
 
+  // Sets the known bits and their values for the given node from the BDD.
+  void SetKnownBits(Node* node);
+
   // Returns the underlying BDD. This method is const, but queries on a BDD
   // generally mutate the object. We sneakily avoid conflicts with C++ const
   // because the BDD is only held indirectly via pointers.
@@ -92,8 +110,7 @@ class BddQueryEngine : public QueryEngine {
   // performed and the BDD method returns a union of minterm limit exceeded or
   // the result of the query.
   bool ExceedsMintermLimit(BddNodeIndex node) const {
-    return minterm_limit_ > 0 &&
-           bdd().GetNode(node).minterm_count > minterm_limit_;
+    return minterm_limit_ > 0 && bdd().minterm_count(node) > minterm_limit_;
   }
 
   // The maximum number of minterms in expression in the BDD before truncating.
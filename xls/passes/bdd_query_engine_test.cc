@@ -281,5 +281,40 @@ TEST_F(BddQueryEngineTest, BitValuesImplyNodeValuePredicateAlwaysFalse) {
   EXPECT_FALSE(result.has_value());
 }
 
+TEST_F(BddQueryEngineTest, UpdateAfterChange) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue a = fb.Param("a", p->GetBitsType(1));
+  BValue b = fb.Param("b", p->GetBitsType(1));
+  BValue sum = fb.Add(a, b);
+  BValue not_sum = fb.Not(sum);
+  BValue a_or_b = fb.Or(a, b);
+  BValue result = fb.And(a_or_b, fb.Not(a));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(result));
+  XLS_ASSERT_OK_AND_ASSIGN(auto query_engine, BddQueryEngine::Run(f));
+  EXPECT_FALSE(query_engine->IsKnown(BitLocation(result.node(), 0)));
+  EXPECT_TRUE(Implies(*query_engine, result.node(), b.node()));
+
+  // Replace 'b' with 'a' in the or, which makes the result known to be zero.
+  XLS_ASSERT_OK(a_or_b.node()->ReplaceOperandNumber(1, a.node()));
+  XLS_ASSERT_OK(query_engine->Update());
+  EXPECT_TRUE(query_engine->IsAllZeros(result.node()));
+
+  // The add is not expressed in the BDD, so it is modeled as a variable.
+  // Replacing its operand leaves the variable, and hence its users'
+  // expressions, unchanged.
+  XLS_ASSERT_OK(sum.node()->ReplaceOperandNumber(1, a.node()));
+  XLS_ASSERT_OK(query_engine->Update());
+  EXPECT_TRUE(query_engine->IsTracked(not_sum.node()));
+  EXPECT_TRUE(KnownNotEquals(*query_engine, sum.node(), not_sum.node()));
+
+  // Removed nodes are no longer tracked.
+  XLS_ASSERT_OK(f->RemoveNode(not_sum.node()));
+  XLS_ASSERT_OK(f->RemoveNode(sum.node()));
+  XLS_ASSERT_OK(query_engine->Update());
+  EXPECT_FALSE(query_engine->IsTracked(sum.node()));
+  EXPECT_TRUE(query_engine->IsAllZeros(result.node()));
+}
+
 }  // namespace
 }  // namespace xls
@@ -36,6 +36,7 @@
 #include "xls/passes/bdd_query_engine.h"
 #include "xls/passes/post_dominator_analysis.h"
 #include "xls/passes/query_engine.h"
+#include "xls/passes/query_engine_cache.h"
 
 namespace xls {
 
@@ -324,7 +325,8 @@ absl::StatusOr<bool> SimplifyNode(Node* node, const QueryEngine& query_engine,
   return false;
 }
 
-absl::StatusOr<bool> SimplifyOneHotMsb(FunctionBase* f) {
+absl::StatusOr<bool> SimplifyOneHotMsb(FunctionBase* f,
+                                       const PassOptions& options) {
   bool changed = false;
   XLS_ASSIGN_OR_RETURN(
       std::unique_ptr<PostDominatorAnalysis> post_dominator_analysis,
@@ -340,11 +342,16 @@ absl::StatusOr<bool> SimplifyOneHotMsb(FunctionBase* f) {
   // this is not necessary for the case MSB = 1. Performing BDD analysis
   // including OneHots in this case gives more information / opens up more
   // optimization opportunities.
+  std::unique_ptr<QueryEngine> owned_engine_minus_one_hot;
   XLS_ASSIGN_OR_RETURN(
-      std::unique_ptr<BddQueryEngine> bdd_query_engine_minus_one_hot,
-      BddQueryEngine::Run(f, /*minterm_limit=*/4096, {Op::kOneHot}));
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<BddQueryEngine> bdd_query_engine_default,
-                       BddQueryEngine::Run(f, /*minterm_limit=*/4096));
+      QueryEngine * bdd_query_engine_minus_one_hot,
+      GetBddBasedQueryEngine(f, options, &owned_engine_minus_one_hot,
+                             /*minterm_limit=*/4096, {Op::kOneHot}));
+  std::unique_ptr<QueryEngine> owned_engine_default;
+  XLS_ASSIGN_OR_RETURN(
+      QueryEngine * bdd_query_engine_default,
+      GetBddBasedQueryEngine(f, options, &owned_engine_default,
+                             /*minterm_limit=*/4096));
 
   for (Node* node : f->nodes()) {
     // Check if one-hot's MSB affect the function's output.
@@ -440,12 +447,14 @@ absl::StatusOr<bool> BddSimplificationPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
   bool one_hot_modified = false;
   if (SplitsEnabled(opt_level_)) {
-    XLS_ASSIGN_OR_RETURN(one_hot_modified, SimplifyOneHotMsb(f));
+    XLS_ASSIGN_OR_RETURN(one_hot_modified, SimplifyOneHotMsb(f, options));
   }
 
   // TODO(meheff): Try tuning the minterm limit.
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<BddQueryEngine> query_engine,
-                       BddQueryEngine::Run(f, /*minterm_limit=*/4096));
+  std::unique_ptr<QueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(QueryEngine * query_engine,
+                       GetBddBasedQueryEngine(f, options, &owned_engine,
+                                              /*minterm_limit=*/4096));
 
   bool modified = false;
   for (Node* node : TopoSort(f)) {
@@ -275,6 +275,16 @@ absl::StatusOr<bool> CanonicalizeNode(Node* n) {
   return false;
 }
 
+std::vector<Op> CanonicalizableOps() {
+  std::vector<Op> ops = {Op::kSel, Op::kSub, Op::kZeroExt, Op::kSignExt};
+  for (Op op : AllOps()) {
+    if (OpIsCommutative(op) || OpIsCompare(op)) {
+      ops.push_back(op);
+    }
+  }
+  return ops;
+}
+
 absl::StatusOr<bool> CanonicalizationPass::RunOnFunctionBaseInternal(
     FunctionBase* func, const PassOptions& options,
     PassResults* results) const {
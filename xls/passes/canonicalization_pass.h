@@ -17,12 +17,23 @@
 #ifndef XLS_PASSES_CANONICALIZATION_PASS_H_
 #define XLS_PASSES_CANONICALIZATION_PASS_H_
 
+#include <vector>
+
 #include "absl/status/statusor.h"
 #include "xls/ir/function.h"
+#include "xls/ir/op.h"
 #include "xls/passes/passes.h"
 
 namespace xls {
 
+// Performs one canonicalization of the node, if any applies, such as moving a
+// literal operand of a commutative op to the right. Returns true if the IR was
+// modified.
+absl::StatusOr<bool> CanonicalizeNode(Node* n);
+
+// The ops which CanonicalizeNode may rewrite.
+std::vector<Op> CanonicalizableOps();
+
 // class CanonicalizationPass iterates over nodes and tries
 // to canonicalize the expressions found. For example, for an add
 // between a node and a literal, the literal should only be the
@@ -35,6 +46,8 @@ class CanonicalizationPass : public FunctionBasePass {
   ~CanonicalizationPass() override {}
 
  protected:
+  bool IsIncremental() const override { return true; }
+
   absl::StatusOr<bool> RunOnFunctionBaseInternal(
       FunctionBase* f, const PassOptions& options,
       PassResults* results) const override;
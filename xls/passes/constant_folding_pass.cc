@@ -22,21 +22,32 @@
 
 namespace xls {
 
+absl::StatusOr<bool> FoldConstantNode(Node* node) {
+  // TODO(meheff): 2019/6/26 Consider not folding loops with large trip counts
+  // to avoid hanging at compile time.
+  if (node->operand_count() == 0 ||
+      !std::all_of(node->operands().begin(), node->operands().end(),
+                   [](Node* o) { return o->Is<Literal>(); })) {
+    return false;
+  }
+  XLS_VLOG(2) << "Folding: " << *node;
+  XLS_ASSIGN_OR_RETURN(Value result,
+                       IrInterpreter::EvaluateNodeWithLiteralOperands(node));
+  XLS_RETURN_IF_ERROR(node->ReplaceUsesWithNew<Literal>(result).status());
+  return true;
+}
+
 absl::StatusOr<bool> ConstantFoldingPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
   bool changed = false;
+  int64_t since = LastRunChangeCount(f);
   for (Node* node : TopoSort(f)) {
-    // TODO(meheff): 2019/6/26 Consider not folding loops with large trip counts
-    // to avoid hanging at compile time.
-    if (node->operand_count() > 0 &&
-        std::all_of(node->operands().begin(), node->operands().end(),
-                    [](Node* o) { return o->Is<Literal>(); })) {
-      XLS_VLOG(2) << "Folding: " << *node;
-      XLS_ASSIGN_OR_RETURN(
-          Value result, IrInterpreter::EvaluateNodeWithLiteralOperands(node));
-      XLS_RETURN_IF_ERROR(node->ReplaceUsesWithNew<Literal>(result).status());
-      changed = true;
+    // Whether a node can be folded depends only on its operands.
+    if (!node->ChangedSince(since)) {
+      continue;
     }
+    XLS_ASSIGN_OR_RETURN(bool node_changed, FoldConstantNode(node));
+    changed |= node_changed;
   }
 
   return changed;
@@ -21,6 +21,10 @@
 
 namespace xls {
 
+// Replaces the uses of the node with a literal if all of its operands are
+// literals. Returns true if it did.
+absl::StatusOr<bool> FoldConstantNode(Node* node);
+
 // Pass which performs constant folding. Every op with only literal operands is
 // replaced by a equivalent literal. Runs DCE after constant folding.
 class ConstantFoldingPass : public FunctionBasePass {
@@ -29,6 +33,8 @@ class ConstantFoldingPass : public FunctionBasePass {
   ~ConstantFoldingPass() override {}
 
  protected:
+  bool IsIncremental() const override { return true; }
+
   absl::StatusOr<bool> RunOnFunctionBaseInternal(
       FunctionBase* f, const PassOptions& options,
       PassResults* results) const override;
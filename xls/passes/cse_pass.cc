@@ -14,84 +14,151 @@
 
 #include "xls/passes/cse_pass.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
 
 namespace xls {
 
 namespace {
 
-// Returns the operands of the given node for the purposes of the CSE
-// optimization. The order of the nodes may not match the order of the node's
-// actual operands. Motivation: generally for nodes to be considered equivalent
-// the operands must be in the same order. However, commutative operations are
-// agnostic to operand order. So to expand the CSE optimization, compare
-// operands as an unordered set for commutative operands. This is done be
-// ordered commutative operation operands by id prior to comparison. To avoid
-// having to construct a vector every time, a span is returned by this
-// function. If the operation is not commutative, the node's own operand span is
-// simply returned. For the commutative case, a vector of sorted operands is
-// constructed in span_backing_store from which a span is constructed.
-absl::Span<Node* const> GetOperandsForCse(
-    Node* node, std::vector<Node*>* span_backing_store) {
-  XLS_CHECK(span_backing_store->empty());
-  if (!OpIsCommutative(node->op())) {
-    return node->operands();
-  }
-  span_backing_store->insert(span_backing_store->begin(),
-                             node->operands().begin(), node->operands().end());
-  std::sort(span_backing_store->begin(), span_backing_store->end(),
-            [](Node* a, Node* b) { return a->id() < b->id(); });
-  return *span_backing_store;
+// Bounds the number of operands an associative expression is flattened into,
+// so long chains of the same op don't take quadratic time and space.
+constexpr int64_t kMaxFlattenedOperandCount = 16;
+
+// Ops for which any grouping and ordering of the same terms gives the same
+// result, as long as all terms have the same type.
+bool IsAssociativeAndCommutative(Op op) {
+  return OpIsAssociative(op) && OpIsCommutative(op);
 }
 
-}  // namespace
+// The value number of a node: nodes with equal value numbers compute the same
+// value, so all but one of them can be replaced.
+struct ValueNumber {
+  // The terms the node is numbered by. For most nodes these are the operands,
+  // sorted by id if the op is commutative. For associative and commutative ops,
+  // operands which are the same op of the same type are replaced by their own
+  // terms, so (a + b) + c, a + (b + c) and (c + a) + b are all numbered by the
+  // sorted terms {a, b, c}.
+  std::vector<Node*> terms;
+  // Whether the terms came from flattening an associative and commutative op.
+  // Such ops compare equal by their op, type and terms alone.
+  bool flattened = false;
+  size_t hash = 0;
+};
 
-absl::StatusOr<bool> CsePass::RunOnFunctionBaseInternal(
-    FunctionBase* f, const PassOptions& options, PassResults* results) const {
-  // To improve efficiency, bucket potentially common nodes together. The
-  // bucketing is done via an int64_t hash value which is constructed from the
-  // op() of the node and the uid's of the node's operands.
-  auto hasher = absl::Hash<std::vector<int64_t>>();
-  auto node_hash = [&](Node* n) {
-    std::vector<int64_t> values_to_hash = {static_cast<int64_t>(n->op())};
-    std::vector<Node*> span_backing_store;
-    for (Node* operand : GetOperandsForCse(n, &span_backing_store)) {
-      values_to_hash.push_back(operand->id());
+// Hashes a literal's value. Literals have no operands, so without their value
+// all literals of a function would collide.
+size_t HashLiteral(const Literal* literal) {
+  return absl::Hash<Value>()(literal->value());
+}
+
+// Computes value numbers for the nodes of a function, visited in topological
+// order, and finds the first node with each value number.
+class ValueNumbering {
+ public:
+  explicit ValueNumbering(int64_t node_count)
+      : leaders_(node_count, LeaderHash{&numbers_}, LeaderEq{&numbers_}) {
+    numbers_.reserve(node_count);
+  }
+
+  // Numbers the node, whose operands must already have been numbered, and
+  // returns a previously numbered node which computes the same value, or
+  // nullptr if there is none.
+  Node* FindEquivalent(Node* node) {
+    ValueNumber& number = numbers_[node];
+    Op op = node->op();
+    number.terms.reserve(node->operand_count());
+    if (IsAssociativeAndCommutative(op)) {
+      number.flattened = true;
+      for (int64_t i = 0; i < node->operand_count(); ++i) {
+        Node* operand = node->operand(i);
+        int64_t remaining_count = node->operand_count() - i - 1;
+        auto it = numbers_.find(operand);
+        if (operand->op() == op && it != numbers_.end() &&
+            operand->GetType()->IsEqualTo(node->GetType()) &&
+            number.terms.size() + it->second.terms.size() + remaining_count <=
+                kMaxFlattenedOperandCount) {
+          number.terms.insert(number.terms.end(), it->second.terms.begin(),
+                              it->second.terms.end());
+        } else {
+          number.terms.push_back(operand);
+        }
+      }
+    } else {
+      number.terms.assign(node->operands().begin(), node->operands().end());
+    }
+    if (OpIsCommutative(op)) {
+      std::sort(number.terms.begin(), number.terms.end(),
+                [](Node* a, Node* b) { return a->id() < b->id(); });
     }
-    // If this is slow because of many literals, the Literal values could be
-    // combined into the hash. As is, all literals get the same hash value.
-    return hasher(values_to_hash);
-  };
 
-  bool changed = false;
-  absl::flat_hash_map<int64_t, std::vector<Node*>> node_buckets;
-  node_buckets.reserve(f->node_count());
-  for (Node* node : TopoSort(f)) {
-    int64_t hash = node_hash(node);
-    if (!node_buckets.contains(hash)) {
-      node_buckets[hash].push_back(node);
-      continue;
+    std::vector<int64_t> values_to_hash = {static_cast<int64_t>(op)};
+    values_to_hash.reserve(number.terms.size() + 2);
+    for (Node* term : number.terms) {
+      values_to_hash.push_back(term->id());
     }
-    bool replaced = false;
-    std::vector<Node*> node_span_backing_store;
-    absl::Span<Node* const> node_operands_for_cse =
-        GetOperandsForCse(node, &node_span_backing_store);
-    for (Node* candidate : node_buckets.at(hash)) {
-      std::vector<Node*> candidate_span_backing_store;
-      if (node_operands_for_cse ==
-              GetOperandsForCse(candidate, &candidate_span_backing_store) &&
-          node->IsDefinitelyEqualTo(candidate)) {
-        XLS_RETURN_IF_ERROR(node->ReplaceUsesWith(candidate));
-        changed = true;
-        replaced = true;
-        break;
+    if (node->Is<Literal>()) {
+      values_to_hash.push_back(HashLiteral(node->As<Literal>()));
+    }
+    number.hash = absl::Hash<std::vector<int64_t>>()(values_to_hash);
+
+    auto [it, inserted] = leaders_.insert(node);
+    return inserted ? nullptr : *it;
+  }
+
+ private:
+  using NumberMap = absl::flat_hash_map<Node*, ValueNumber>;
+
+  struct LeaderHash {
+    size_t operator()(Node* node) const { return numbers->at(node).hash; }
+    const NumberMap* numbers;
+  };
+
+  struct LeaderEq {
+    bool operator()(Node* a, Node* b) const {
+      if (a == b) {
+        return true;
+      }
+      const ValueNumber& a_number = numbers->at(a);
+      const ValueNumber& b_number = numbers->at(b);
+      if (a->op() != b->op() || a_number.terms != b_number.terms) {
+        return false;
       }
+      if (a_number.flattened) {
+        return a->GetType()->IsEqualTo(b->GetType());
+      }
+      return a->IsDefinitelyEqualTo(b);
     }
-    if (!replaced) {
-      node_buckets[hash].push_back(node);
+    const NumberMap* numbers;
+  };
+
+  NumberMap numbers_;
+  // The first node with each value number.
+  absl::flat_hash_set<Node*, LeaderHash, LeaderEq> leaders_;
+};
+
+}  // namespace
+
+absl::StatusOr<bool> CsePass::RunOnFunctionBaseInternal(
+    FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  // Nodes are visited in topological order, so by the time a node is numbered
+  // its operands have been replaced by their leaders and its number is final.
+  bool changed = false;
+  ValueNumbering numbering(f->node_count());
+  for (Node* node : TopoSort(f)) {
+    Node* leader = numbering.FindEquivalent(node);
+    if (leader != nullptr) {
+      XLS_RETURN_IF_ERROR(node->ReplaceUsesWith(leader));
+      changed = true;
     }
   }
 
@@ -212,5 +212,65 @@ TEST_F(CsePassTest, NonCommutativeOperands) {
   EXPECT_NE(f->return_value()->operand(0), f->return_value()->operand(1));
 }
 
+TEST_F(CsePassTest, AssociativeRegrouping) {
+  // Associative and commutative operations are equivalent irrespective of how
+  // their terms are grouped.
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn regrouped(x: bits[8], y: bits[8], z: bits[8]) -> (bits[8], bits[8], bits[8], bits[8]) {
+        xy: bits[8] = add(x, y)
+        xy_z: bits[8] = add(xy, z)
+        zy: bits[8] = add(z, y)
+        x_zy: bits[8] = add(x, zy)
+        xz: bits[8] = and(x, z)
+        xz_y: bits[8] = and(xz, y)
+        xyz: bits[8] = and(x, y, z)
+        ret result: (bits[8], bits[8], bits[8], bits[8]) = tuple(xy_z, x_zy, xz_y, xyz)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_EQ(f->return_value()->operand(0), f->return_value()->operand(1));
+  EXPECT_EQ(f->return_value()->operand(2), f->return_value()->operand(3));
+  EXPECT_NE(f->return_value()->operand(0), f->return_value()->operand(2));
+}
+
+TEST_F(CsePassTest, AssociativeRegroupingRequiresSameType) {
+  // The inner multiplies truncate to a different width than the outer ones, so
+  // regrouping them is not equivalent.
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn truncated(x: bits[8], y: bits[8], z: bits[8]) -> (bits[8], bits[8]) {
+        xy: bits[4] = umul(x, y)
+        xy_z: bits[8] = umul(xy, z)
+        zy: bits[4] = umul(z, y)
+        x_zy: bits[8] = umul(x, zy)
+        ret result: (bits[8], bits[8]) = tuple(xy_z, x_zy)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(f), IsOkAndHolds(false));
+  EXPECT_NE(f->return_value()->operand(0), f->return_value()->operand(1));
+}
+
+TEST_F(CsePassTest, LiteralsHashedByValue) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  std::vector<BValue> elements;
+  for (int64_t i = 0; i < 100; ++i) {
+    elements.push_back(fb.Literal(UBits(i, 32)));
+    elements.push_back(fb.Literal(UBits(i, 32)));
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f,
+                           fb.BuildWithReturnValue(fb.Tuple(elements)));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_EQ(f->node_count(), 101);
+  for (int64_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(f->return_value()->operand(2 * i),
+              f->return_value()->operand(2 * i + 1));
+    EXPECT_THAT(f->return_value()->operand(2 * i), m::Literal(i));
+  }
+}
+
 }  // namespace
 }  // namespace xls
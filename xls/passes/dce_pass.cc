@@ -24,9 +24,13 @@ namespace xls {
 
 absl::StatusOr<bool> DeadCodeEliminationPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  // Nodes only become dead by losing users or implicit uses, which counts as
+  // a change to the node.
+  int64_t since = LastRunChangeCount(f);
   std::deque<Node*> worklist;
   for (Node* n : f->nodes()) {
-    if (n->users().empty() && !f->HasImplicitUse(n) && !n->Is<Param>()) {
+    if (n->change_count() > since && n->users().empty() &&
+        !f->HasImplicitUse(n) && !n->Is<Param>()) {
       worklist.push_back(n);
     }
   }
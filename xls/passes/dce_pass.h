@@ -33,6 +33,8 @@ class DeadCodeEliminationPass : public FunctionBasePass {
   ~DeadCodeEliminationPass() override {}
 
  protected:
+  bool IsIncremental() const override { return true; }
+
   // Iterate all nodes, mark and eliminate the unvisited nodes.
   absl::StatusOr<bool> RunOnFunctionBaseInternal(
       FunctionBase* f, const PassOptions& options,
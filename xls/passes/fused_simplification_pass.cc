@@ -0,0 +1,36 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/fused_simplification_pass.h"
+
+#include "xls/passes/canonicalization_pass.h"
+#include "xls/passes/constant_folding_pass.h"
+
+namespace xls {
+
+FusedSimplificationPass::FusedSimplificationPass()
+    : FunctionBasePass("fused_simp", "Fused simplification") {
+  // Folding first so literal operands are folded away rather than
+  // canonicalized.
+  engine_.AddRule(FoldConstantNode);
+  engine_.AddRule(CanonicalizableOps(), CanonicalizeNode);
+}
+
+absl::StatusOr<bool> FusedSimplificationPass::RunOnFunctionBaseInternal(
+    FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  return engine_.Run(f, LastRunChangeCount(f));
+}
+
+}  // namespace xls
@@ -0,0 +1,48 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_PASSES_FUSED_SIMPLIFICATION_PASS_H_
+#define XLS_PASSES_FUSED_SIMPLIFICATION_PASS_H_
+
+#include "absl/status/statusor.h"
+#include "xls/ir/function_base.h"
+#include "xls/passes/passes.h"
+#include "xls/passes/rewrite_engine.h"
+
+namespace xls {
+
+// Pass which applies the rules of constant folding and canonicalization
+// together with a RewriteEngine, removing dead nodes as it goes. Equivalent to
+// running ConstantFoldingPass, CanonicalizationPass and DeadCodeEliminationPass
+// to a fixed point, without a sweep over the whole function per pass.
+class FusedSimplificationPass : public FunctionBasePass {
+ public:
+  FusedSimplificationPass();
+  ~FusedSimplificationPass() override {}
+
+ protected:
+  bool IsIncremental() const override { return true; }
+
+  absl::StatusOr<bool> RunOnFunctionBaseInternal(
+      FunctionBase* f, const PassOptions& options,
+      PassResults* results) const override;
+
+ private:
+  RewriteEngine engine_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_FUSED_SIMPLIFICATION_PASS_H_
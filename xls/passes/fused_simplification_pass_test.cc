@@ -0,0 +1,77 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/fused_simplification_pass.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_matcher.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+
+namespace m = ::xls::op_matchers;
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class FusedSimplificationPassTest : public IrTestBase {
+ protected:
+  absl::StatusOr<bool> Run(Package* p) {
+    PassResults results;
+    return FusedSimplificationPass().Run(p, PassOptions(), &results);
+  }
+};
+
+TEST_F(FusedSimplificationPassTest, FoldsAndCanonicalizesWithoutDce) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8]) -> bits[8] {
+        one: bits[8] = literal(value=1)
+        two: bits[8] = literal(value=2)
+        three: bits[8] = add(one, two)
+        four: bits[8] = add(three, one)
+        ret result: bits[8] = sub(x, four)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(p.get()), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Add(m::Param("x"), m::Literal(252)));
+  EXPECT_EQ(f->node_count(), 3);
+  EXPECT_THAT(Run(p.get()), IsOkAndHolds(false));
+}
+
+TEST_F(FusedSimplificationPassTest, CanonicalizedNodeIsFolded) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8]) -> bits[16] {
+        one: bits[8] = literal(value=1)
+        ext: bits[16] = zero_ext(one, new_bit_count=16)
+        x_ext: bits[16] = zero_ext(x, new_bit_count=16)
+        ret result: bits[16] = and(ext, x_ext)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(p.get()), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(),
+              m::And(m::Concat(m::Literal(0), m::Param("x")), m::Literal(1)));
+}
+
+}  // namespace
+}  // namespace xls
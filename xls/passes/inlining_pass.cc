@@ -14,6 +14,10 @@
 
 #include "xls/passes/inlining_pass.h"
 
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
@@ -186,6 +190,34 @@ std::vector<FunctionBase*> FunctionsInPostOrder(Package* p) {
 
 }  // namespace
 
+InliningPass::InliningPass(
+    std::vector<std::unique_ptr<FunctionBasePass>> callee_passes)
+    : Pass("inlining", "Inlines invocations"),
+      callee_passes_(std::move(callee_passes)),
+      checkpoint_key_(FunctionBase::NewCheckpointKey()) {}
+
+absl::StatusOr<bool> InliningPass::OptimizeCallee(Function* f,
+                                                  const PassOptions& options,
+                                                  PassResults* results) const {
+  absl::optional<int64_t> checkpoint = f->GetCheckpoint(checkpoint_key_);
+  if (checkpoint.has_value() && *checkpoint == f->change_count()) {
+    return false;
+  }
+  bool changed = false;
+  bool iteration_changed = true;
+  while (iteration_changed) {
+    iteration_changed = false;
+    for (const std::unique_ptr<FunctionBasePass>& pass : callee_passes_) {
+      XLS_ASSIGN_OR_RETURN(bool pass_changed,
+                           pass->RunOnFunctionBase(f, options, results));
+      iteration_changed |= pass_changed;
+    }
+    changed |= iteration_changed;
+  }
+  f->SetCheckpoint(checkpoint_key_);
+  return changed;
+}
+
 absl::StatusOr<bool> InliningPass::RunInternal(Package* p,
                                                const PassOptions& options,
                                                PassResults* results) const {
@@ -194,7 +226,16 @@ absl::StatusOr<bool> InliningPass::RunInternal(Package* p,
   // post order of the call graph (leaves first). This ensures that when a
   // function Foo is inlined into its callsites, no invokes remain in Foo. This
   // avoid duplicate work.
-  for (FunctionBase* f : FunctionsInPostOrder(p)) {
+  std::vector<FunctionBase*> post_order = FunctionsInPostOrder(p);
+  absl::flat_hash_set<FunctionBase*> callees;
+  if (!callee_passes_.empty()) {
+    for (FunctionBase* f : post_order) {
+      for (FunctionBase* invoked : InvokedFunctions(f)) {
+        callees.insert(invoked);
+      }
+    }
+  }
+  for (FunctionBase* f : post_order) {
     // Create copy of nodes() because we will be adding and removing nodes
     // during inlining.
     std::vector<Node*> nodes(f->nodes().begin(), f->nodes().end());
@@ -204,6 +245,15 @@ absl::StatusOr<bool> InliningPass::RunInternal(Package* p,
         changed = true;
       }
     }
+    // In bottom-up mode, optimize the callee now that it contains no invokes
+    // so its callers inline the optimized body. Functions which are not
+    // invoked are left to the passes which follow inlining.
+    if (callees.contains(f)) {
+      XLS_ASSIGN_OR_RETURN(
+          bool optimized,
+          OptimizeCallee(f->AsFunctionOrDie(), options, results));
+      changed |= optimized;
+    }
   }
   return changed;
 }
@@ -15,6 +15,9 @@
 #ifndef XLS_PASSES_INLINING_PASS_H_
 #define XLS_PASSES_INLINING_PASS_H_
 
+#include <memory>
+#include <vector>
+
 #include "absl/status/statusor.h"
 #include "xls/ir/function.h"
 #include "xls/passes/passes.h"
@@ -25,9 +28,29 @@ class InliningPass : public Pass {
  public:
   InliningPass() : Pass("inlining", "Inlines invocations") {}
 
+  // Bottom-up mode: each invoked function is optimized by running
+  // "callee_passes" on it to a fixed point after its own invokes are inlined
+  // and before it is inlined into its callers. The body of a function called
+  // from many sites is thereby simplified once rather than once per call site.
+  // A callee which has not changed since this pass last optimized it is not
+  // optimized again.
+  explicit InliningPass(
+      std::vector<std::unique_ptr<FunctionBasePass>> callee_passes);
+
  protected:
   absl::StatusOr<bool> RunInternal(Package* p, const PassOptions& options,
                                    PassResults* results) const override;
+
+ private:
+  // Runs the callee passes on "f" to a fixed point unless it is unchanged
+  // since it was last optimized.
+  absl::StatusOr<bool> OptimizeCallee(Function* f, const PassOptions& options,
+                                      PassResults* results) const;
+
+  std::vector<std::unique_ptr<FunctionBasePass>> callee_passes_;
+
+  // Key under which optimized callees are checkpointed.
+  int64_t checkpoint_key_ = 0;
 };
 
 }  // namespace xls
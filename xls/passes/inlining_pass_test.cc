@@ -14,13 +14,19 @@
 
 #include "xls/passes/inlining_pass.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
 #include "xls/common/status/matchers.h"
 #include "xls/ir/ir_matcher.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/ir_test_base.h"
+#include "xls/passes/arith_simplification_pass.h"
 #include "xls/passes/dce_pass.h"
 
 namespace m = ::xls::op_matchers;
@@ -29,6 +35,7 @@ namespace xls {
 namespace {
 
 using status_testing::IsOkAndHolds;
+using ::testing::ElementsAre;
 
 class InliningPassTest : public IrTestBase {
  protected:
@@ -157,5 +164,66 @@ fn f(foobar: bits[32]) -> bits[32] {
               m::Name("foobar"));
 }
 
+// Records the functions it runs on, changing nothing.
+class RecordingPass : public FunctionBasePass {
+ public:
+  explicit RecordingPass(std::vector<std::string>* runs)
+      : FunctionBasePass("recording", "Recording"), runs_(runs) {}
+
+ protected:
+  absl::StatusOr<bool> RunOnFunctionBaseInternal(
+      FunctionBase* f, const PassOptions& options,
+      PassResults* results) const override {
+    runs_->push_back(f->name());
+    return false;
+  }
+
+ private:
+  std::vector<std::string>* runs_;
+};
+
+TEST_F(InliningPassTest, BottomUpOptimizesEachCalleeOnce) {
+  const std::string program = R"(
+package some_package
+
+fn callee2(x: bits[32]) -> bits[32] {
+  literal.1: bits[32] = literal(value=0)
+  ret add.2: bits[32] = add(x, literal.1)
+}
+
+fn callee1(x: bits[32]) -> bits[32] {
+  invoke.3: bits[32] = invoke(x, to_apply=callee2)
+  ret invoke.4: bits[32] = invoke(invoke.3, to_apply=callee2)
+}
+
+fn caller(a: bits[32], b: bits[32]) -> (bits[32], bits[32]) {
+  invoke.5: bits[32] = invoke(a, to_apply=callee1)
+  invoke.6: bits[32] = invoke(b, to_apply=callee1)
+  ret tuple.7: (bits[32], bits[32]) = tuple(invoke.5, invoke.6)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, ParsePackage(program));
+  std::vector<std::string> runs;
+  std::vector<std::unique_ptr<FunctionBasePass>> callee_passes;
+  callee_passes.push_back(absl::make_unique<RecordingPass>(&runs));
+  callee_passes.push_back(absl::make_unique<ArithSimplificationPass>());
+  callee_passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  InliningPass pass(std::move(callee_passes));
+  PassResults results;
+  ASSERT_THAT(pass.Run(package.get(), PassOptions(), &results),
+              IsOkAndHolds(true));
+
+  // Each callee is optimized (to a fixed point) once, however many times it
+  // is invoked, and the function at the root of the call graph is not.
+  EXPECT_THAT(runs, ElementsAre("callee2", "callee2", "callee1"));
+  EXPECT_THAT(FindFunction("caller", package.get())->return_value(),
+              m::Tuple(m::Param("a"), m::Param("b")));
+
+  // Nothing remains to inline, so another run optimizes nothing.
+  ASSERT_THAT(pass.Run(package.get(), PassOptions(), &results),
+              IsOkAndHolds(false));
+  EXPECT_EQ(runs.size(), 3);
+}
+
 }  // namespace
 }  // namespace xls
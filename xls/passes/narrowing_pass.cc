@@ -22,7 +22,8 @@
 #include "xls/ir/node_util.h"
 #include "xls/ir/op.h"
 #include "xls/passes/query_engine.h"
-#include "xls/passes/ternary_query_engine.h"
+#include "xls/passes/query_engine_cache.h"
+#include "xls/passes/range_query_engine.h"
 
 namespace xls {
 
@@ -441,8 +442,9 @@ absl::StatusOr<bool> MaybeNarrowMultiply(ArithOp* mul,
 
 absl::StatusOr<bool> NarrowingPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(f));
+  std::unique_ptr<RangeQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(RangeQueryEngine * query_engine,
+                       GetRangeQueryEngine(f, options, &owned_engine));
 
   bool modified = false;
   for (Node* node : TopoSort(f)) {
@@ -0,0 +1,271 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/packed_ternary_evaluator.h"
+
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/abstract_node_evaluator.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/nodes.h"
+#include "xls/passes/ternary_evaluator.h"
+
+namespace xls {
+namespace {
+
+using Vector = PackedTernaryVector;
+
+// The bits which are known to be zero.
+Bits KnownZeros(const Vector& v) {
+  return bits_ops::And(v.known, bits_ops::Not(v.value));
+}
+
+Vector Not(const Vector& v) {
+  return Vector(v.known, bits_ops::And(v.known, bits_ops::Not(v.value)));
+}
+
+Vector And(const Vector& a, const Vector& b) {
+  // The result is known where both operands are known or either is known zero.
+  return Vector(bits_ops::Or(bits_ops::And(a.known, b.known),
+                             bits_ops::Or(KnownZeros(a), KnownZeros(b))),
+                bits_ops::And(a.value, b.value));
+}
+
+Vector Or(const Vector& a, const Vector& b) {
+  // The result is known where both operands are known or either is known one.
+  return Vector(bits_ops::Or(bits_ops::And(a.known, b.known),
+                             bits_ops::Or(a.value, b.value)),
+                bits_ops::Or(a.value, b.value));
+}
+
+Vector Xor(const Vector& a, const Vector& b) {
+  Bits known = bits_ops::And(a.known, b.known);
+  return Vector(known, bits_ops::And(known, bits_ops::Xor(a.value, b.value)));
+}
+
+Vector FoldOperands(absl::Span<const Vector* const> operands,
+              Vector (*op)(const Vector&, const Vector&)) {
+  Vector result = *operands.front();
+  for (const Vector* operand : operands.subspan(1)) {
+    result = op(result, *operand);
+  }
+  return result;
+}
+
+// A single-bit vector which is known to be the given value if 'known' is true.
+Vector SingleBit(bool known, bool value) {
+  return Vector(UBits(known, 1), UBits(known && value, 1));
+}
+
+// Adds the operands by computing the carry into each bit for the smallest
+// (unknown bits zero) and largest (unknown bits one) values of the operands.
+// Because carries are monotonic in the operand bits, a carry is known if it is
+// the same in both sums. A result bit is known if its operand bits and carry
+// are known.
+Vector Add(const Vector& a, const Vector& b) {
+  Bits min_sum = bits_ops::Add(a.value, b.value);
+  Bits max_sum =
+      bits_ops::Add(bits_ops::Or(a.value, bits_ops::Not(a.known)),
+                    bits_ops::Or(b.value, bits_ops::Not(b.known)));
+  Bits carry_known_zero = bits_ops::Not(bits_ops::Xor(
+      max_sum, bits_ops::Xor(KnownZeros(a), KnownZeros(b))));
+  Bits carry_known_one =
+      bits_ops::Xor(min_sum, bits_ops::Xor(a.value, b.value));
+  Bits known =
+      bits_ops::And(bits_ops::And(a.known, b.known),
+                    bits_ops::Or(carry_known_zero, carry_known_one));
+  return Vector(known, bits_ops::And(known, min_sum));
+}
+
+Vector Eq(const Vector& a, const Vector& b) {
+  Bits both_known = bits_ops::And(a.known, b.known);
+  if (!bits_ops::And(both_known, bits_ops::Xor(a.value, b.value)).IsZero()) {
+    return SingleBit(/*known=*/true, /*value=*/false);
+  }
+  return SingleBit(/*known=*/both_known.IsAllOnes(), /*value=*/true);
+}
+
+// Returns the shift amount if it is known, saturated at the given width.
+absl::optional<int64_t> KnownShiftAmount(const Vector& amount, int64_t width) {
+  if (!amount.known.IsAllOnes()) {
+    return absl::nullopt;
+  }
+  if (bits_ops::UGreaterThanOrEqual(amount.value, width)) {
+    return width;
+  }
+  return static_cast<int64_t>(amount.value.ToUint64().value());
+}
+
+// Evaluates the node bit by bit with TernaryEvaluator.
+absl::StatusOr<Vector> EvaluateUnpacked(
+    Node* node, absl::Span<const Vector* const> operands) {
+  TernaryEvaluator evaluator;
+  std::vector<TernaryVector> unpacked;
+  unpacked.reserve(operands.size());
+  for (const Vector* operand : operands) {
+    unpacked.push_back(operand->ToTernaryVector());
+  }
+  XLS_ASSIGN_OR_RETURN(
+      TernaryVector result,
+      AbstractEvaluate(node, unpacked, &evaluator,
+                       /*default_handler=*/[](Node* n) {
+                         return TernaryVector(n->BitCountOrDie(),
+                                              TernaryValue::kUnknown);
+                       }));
+  return Vector::FromTernaryVector(result);
+}
+
+}  // namespace
+
+/* static */ PackedTernaryVector PackedTernaryVector::FromBits(
+    const Bits& bits) {
+  return PackedTernaryVector(Bits::AllOnes(bits.bit_count()), bits);
+}
+
+/* static */ PackedTernaryVector PackedTernaryVector::Unknown(
+    int64_t bit_count) {
+  return PackedTernaryVector(Bits(bit_count), Bits(bit_count));
+}
+
+/* static */ PackedTernaryVector PackedTernaryVector::FromTernaryVector(
+    const TernaryVector& vector) {
+  // Use InlinedVector to avoid std::vector<bool> specialization madness.
+  absl::InlinedVector<bool, 1> known(vector.size());
+  absl::InlinedVector<bool, 1> value(vector.size());
+  for (int64_t i = 0; i < vector.size(); ++i) {
+    known[i] = vector[i] != TernaryValue::kUnknown;
+    value[i] = vector[i] == TernaryValue::kKnownOne;
+  }
+  return PackedTernaryVector(Bits(known), Bits(value));
+}
+
+TernaryVector PackedTernaryVector::ToTernaryVector() const {
+  TernaryVector result(bit_count());
+  for (int64_t i = 0; i < bit_count(); ++i) {
+    if (!known.Get(i)) {
+      result[i] = TernaryValue::kUnknown;
+    } else {
+      result[i] =
+          value.Get(i) ? TernaryValue::kKnownOne : TernaryValue::kKnownZero;
+    }
+  }
+  return result;
+}
+
+absl::StatusOr<PackedTernaryVector> PackedTernaryEvaluate(
+    Node* node, absl::Span<const PackedTernaryVector* const> operands) {
+  switch (node->op()) {
+    case Op::kLiteral:
+      return Vector::FromBits(node->As<Literal>()->value().bits());
+    case Op::kIdentity:
+      return *operands[0];
+    case Op::kNot:
+      return Not(*operands[0]);
+    case Op::kAnd:
+      return FoldOperands(operands, And);
+    case Op::kOr:
+      return FoldOperands(operands, Or);
+    case Op::kXor:
+      return FoldOperands(operands, Xor);
+    case Op::kNand:
+      return Not(FoldOperands(operands, And));
+    case Op::kNor:
+      return Not(FoldOperands(operands, Or));
+    case Op::kAndReduce: {
+      const Vector& operand = *operands[0];
+      if (!KnownZeros(operand).IsZero()) {
+        return SingleBit(/*known=*/true, /*value=*/false);
+      }
+      return SingleBit(/*known=*/operand.known.IsAllOnes(), /*value=*/true);
+    }
+    case Op::kOrReduce: {
+      const Vector& operand = *operands[0];
+      if (!operand.value.IsZero()) {
+        return SingleBit(/*known=*/true, /*value=*/true);
+      }
+      return SingleBit(/*known=*/operand.known.IsAllOnes(), /*value=*/false);
+    }
+    case Op::kXorReduce: {
+      const Vector& operand = *operands[0];
+      bool parity = bits_ops::XorReduce(operand.value).IsAllOnes();
+      return SingleBit(/*known=*/operand.known.IsAllOnes(), parity);
+    }
+    case Op::kAdd:
+      return Add(*operands[0], *operands[1]);
+    case Op::kEq:
+      return Eq(*operands[0], *operands[1]);
+    case Op::kNe:
+      return Not(Eq(*operands[0], *operands[1]));
+    case Op::kConcat: {
+      std::vector<Bits> known;
+      std::vector<Bits> value;
+      for (const Vector* operand : operands) {
+        known.push_back(operand->known);
+        value.push_back(operand->value);
+      }
+      return Vector(bits_ops::Concat(known), bits_ops::Concat(value));
+    }
+    case Op::kBitSlice: {
+      BitSlice* bit_slice = node->As<BitSlice>();
+      return Vector(
+          operands[0]->known.Slice(bit_slice->start(), bit_slice->width()),
+          operands[0]->value.Slice(bit_slice->start(), bit_slice->width()));
+    }
+    case Op::kZeroExt: {
+      // The new bits are known zeros.
+      int64_t width = node->BitCountOrDie();
+      return Vector(bits_ops::Not(bits_ops::ZeroExtend(
+                        bits_ops::Not(operands[0]->known), width)),
+                    bits_ops::ZeroExtend(operands[0]->value, width));
+    }
+    case Op::kSignExt: {
+      // The new bits are copies of the sign bit, known or not.
+      int64_t width = node->BitCountOrDie();
+      return Vector(bits_ops::SignExtend(operands[0]->known, width),
+                    bits_ops::SignExtend(operands[0]->value, width));
+    }
+    case Op::kShll:
+    case Op::kShrl:
+    case Op::kShra: {
+      const Vector& input = *operands[0];
+      absl::optional<int64_t> amount =
+          KnownShiftAmount(*operands[1], input.bit_count());
+      if (!amount.has_value()) {
+        break;
+      }
+      if (input.bit_count() == 0) {
+        return input;
+      }
+      if (node->op() == Op::kShra) {
+        // The shifted-in bits are copies of the sign bit, known or not.
+        return Vector(bits_ops::ShiftRightArith(input.known, *amount),
+                      bits_ops::ShiftRightArith(input.value, *amount));
+      }
+      // The shifted-in bits are known zeros.
+      auto shift = node->op() == Op::kShll ? bits_ops::ShiftLeftLogical
+                                           : bits_ops::ShiftRightLogical;
+      return Vector(bits_ops::Not(shift(bits_ops::Not(input.known), *amount)),
+                    shift(input.value, *amount));
+    }
+    default:
+      break;
+  }
+  return EvaluateUnpacked(node, operands);
+}
+
+}  // namespace xls
@@ -0,0 +1,81 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_PACKED_TERNARY_EVALUATOR_H_
+#define XLS_PASSES_PACKED_TERNARY_EVALUATOR_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/node.h"
+#include "xls/ir/ternary.h"
+
+namespace xls {
+
+// A vector of ternary values packed into two bitmaps, so operations can act on
+// whole machine words rather than individual TernaryValues.
+struct PackedTernaryVector {
+  PackedTernaryVector() = default;
+  PackedTernaryVector(Bits known, Bits value)
+      : known(std::move(known)), value(std::move(value)) {}
+
+  // Returns a vector with all bits known to have the given values.
+  static PackedTernaryVector FromBits(const Bits& bits);
+
+  // Returns a vector of the given width with all bits unknown.
+  static PackedTernaryVector Unknown(int64_t bit_count);
+
+  static PackedTernaryVector FromTernaryVector(const TernaryVector& vector);
+  TernaryVector ToTernaryVector() const;
+
+  int64_t bit_count() const { return known.bit_count(); }
+
+  bool operator==(const PackedTernaryVector& other) const {
+    return known == other.known && value == other.value;
+  }
+  bool operator!=(const PackedTernaryVector& other) const {
+    return !(*this == other);
+  }
+
+  // A one in a bit position indicates the respective bit value is known.
+  Bits known;
+  // The values of the known bits. Unknown bits are zero.
+  Bits value;
+};
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const PackedTernaryVector& vector) {
+  os << ToString(vector.ToTernaryVector());
+  return os;
+}
+
+// Evaluates the given node using ternary logic over the given operand values.
+// Bitwise logical operations, reductions, add, shifts by known amounts,
+// concat, bit slices, extensions and equality comparisons act on whole words.
+// Other operations are evaluated bit by bit with TernaryEvaluator, and
+// operations TernaryEvaluator does not support produce unknown values.
+//
+// Results are identical to those of TernaryEvaluator except for add, where
+// the word-level computation of the carries is more precise.
+absl::StatusOr<PackedTernaryVector> PackedTernaryEvaluate(
+    Node* node, absl::Span<const PackedTernaryVector* const> operands);
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PACKED_TERNARY_EVALUATOR_H_
@@ -0,0 +1,298 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/packed_ternary_evaluator.h"
+
+#include <functional>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/abstract_node_evaluator.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/ternary.h"
+#include "xls/passes/ternary_evaluator.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class PackedTernaryEvaluatorTest : public IrTestBase {
+ protected:
+  // Returns all TernaryVectors of the given width.
+  std::vector<TernaryVector> AllTernaryVectors(int64_t width) {
+    std::vector<TernaryVector> vectors = {{}};
+    for (int64_t i = 0; i < width; ++i) {
+      std::vector<TernaryVector> extended;
+      for (const TernaryVector& vector : vectors) {
+        for (TernaryValue value :
+             {TernaryValue::kKnownZero, TernaryValue::kKnownOne,
+              TernaryValue::kUnknown}) {
+          extended.push_back(vector);
+          extended.back().push_back(value);
+        }
+      }
+      vectors = std::move(extended);
+    }
+    return vectors;
+  }
+
+  // Returns all combinations of the given ternary vectors, one per param of
+  // the given function.
+  std::vector<std::vector<TernaryVector>> AllArguments(Function* f) {
+    std::vector<std::vector<TernaryVector>> arguments = {{}};
+    for (Param* param : f->params()) {
+      std::vector<std::vector<TernaryVector>> extended;
+      for (const std::vector<TernaryVector>& prefix : arguments) {
+        for (const TernaryVector& vector :
+             AllTernaryVectors(param->BitCountOrDie())) {
+          extended.push_back(prefix);
+          extended.back().push_back(vector);
+        }
+      }
+      arguments = std::move(extended);
+    }
+    return arguments;
+  }
+
+  // Returns the exact ternary value of the function for the given ternary
+  // arguments: a bit is known iff it has the same value for every assignment
+  // of the unknown argument bits.
+  TernaryVector ExactResult(Function* f,
+                            absl::Span<const TernaryVector> arguments) {
+    absl::optional<TernaryVector> result;
+    std::function<void(std::vector<Value>)> expand =
+        [&](std::vector<Value> values) {
+          if (values.size() == arguments.size()) {
+            Bits bits = IrInterpreter::Run(f, values).value().bits();
+            if (!result.has_value()) {
+              result = TernaryVector(bits.bit_count());
+              for (int64_t i = 0; i < bits.bit_count(); ++i) {
+                (*result)[i] = bits.Get(i) ? TernaryValue::kKnownOne
+                                           : TernaryValue::kKnownZero;
+              }
+              return;
+            }
+            for (int64_t i = 0; i < bits.bit_count(); ++i) {
+              if ((*result)[i] != (bits.Get(i) ? TernaryValue::kKnownOne
+                                               : TernaryValue::kKnownZero)) {
+                (*result)[i] = TernaryValue::kUnknown;
+              }
+            }
+            return;
+          }
+          const TernaryVector& argument = arguments[values.size()];
+          std::vector<Bits> candidates = {Bits()};
+          for (TernaryValue value : argument) {
+            std::vector<Bits> extended;
+            for (const Bits& prefix : candidates) {
+              for (bool bit : {false, true}) {
+                if (value == TernaryValue::kUnknown ||
+                    bit == (value == TernaryValue::kKnownOne)) {
+                  extended.push_back(bits_ops::Concat({UBits(bit, 1), prefix}));
+                }
+              }
+            }
+            candidates = std::move(extended);
+          }
+          for (const Bits& candidate : candidates) {
+            std::vector<Value> extended = values;
+            extended.push_back(Value(candidate));
+            expand(extended);
+          }
+        };
+    expand({});
+    return *result;
+  }
+
+  // Evaluates the return value of the given function, whose operands must be
+  // the function's params in order, for the given ternary arguments.
+  PackedTernaryVector Evaluate(Function* f,
+                               absl::Span<const TernaryVector> arguments) {
+    std::vector<PackedTernaryVector> packed;
+    for (const TernaryVector& argument : arguments) {
+      packed.push_back(PackedTernaryVector::FromTernaryVector(argument));
+    }
+    std::vector<const PackedTernaryVector*> operands;
+    for (const PackedTernaryVector& operand : packed) {
+      operands.push_back(&operand);
+    }
+    return PackedTernaryEvaluate(f->return_value(), operands).value();
+  }
+
+  // Returns the result of TernaryEvaluator for the return value of the given
+  // function.
+  TernaryVector EvaluateUnpacked(Function* f,
+                                 absl::Span<const TernaryVector> arguments) {
+    TernaryEvaluator evaluator;
+    return AbstractEvaluate(f->return_value(), arguments, &evaluator,
+                            [](Node* n) {
+                              return TernaryVector(n->BitCountOrDie(),
+                                                   TernaryValue::kUnknown);
+                            })
+        .value();
+  }
+
+  // Builds a function of two three-bit params x and y with the given body.
+  Function* BuildBinary(Package* p, absl::string_view name,
+                        std::function<BValue(FunctionBuilder*, BValue,
+                                             BValue)>
+                            body) {
+    FunctionBuilder fb(name, p);
+    BValue x = fb.Param("x", p->GetBitsType(3));
+    BValue y = fb.Param("y", p->GetBitsType(3));
+    body(&fb, x, y);
+    return fb.Build().value();
+  }
+};
+
+TEST_F(PackedTernaryEvaluatorTest, Conversions) {
+  TernaryVector vector = StringToTernaryVector("0b1X0X1").value();
+  PackedTernaryVector packed = PackedTernaryVector::FromTernaryVector(vector);
+  EXPECT_EQ(packed.known, UBits(0b10101, 5));
+  EXPECT_EQ(packed.value, UBits(0b10001, 5));
+  EXPECT_EQ(packed.ToTernaryVector(), vector);
+  EXPECT_EQ(PackedTernaryVector::FromBits(UBits(5, 3)),
+            PackedTernaryVector(UBits(7, 3), UBits(5, 3)));
+  EXPECT_EQ(PackedTernaryVector::Unknown(4).ToTernaryVector(),
+            StringToTernaryVector("0bXXXX").value());
+}
+
+// The word-level operations give exactly the bits which are the same for all
+// values of the unknown operand bits.
+TEST_F(PackedTernaryEvaluatorTest, WordLevelOpsAreExact) {
+  auto p = CreatePackage();
+  using Body = std::function<BValue(FunctionBuilder*, BValue, BValue)>;
+  std::vector<std::pair<std::string, Body>> bodies = {
+      {"and", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->And(x, y);
+       }},
+      {"or", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Or(x, y);
+       }},
+      {"xor", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Xor(x, y);
+       }},
+      {"nand", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->AddNaryOp(Op::kNand, {x, y});
+       }},
+      {"nor", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->AddNaryOp(Op::kNor, {x, y});
+       }},
+      {"add", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Add(x, y);
+       }},
+      {"eq", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Eq(x, y);
+       }},
+      {"ne", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Ne(x, y);
+       }},
+      {"concat", [](FunctionBuilder* fb, BValue x, BValue y) {
+         return fb->Concat({x, y});
+       }},
+  };
+  for (const auto& [name, body] : bodies) {
+    Function* f = BuildBinary(p.get(), name, body);
+    for (const std::vector<TernaryVector>& arguments : AllArguments(f)) {
+      EXPECT_EQ(Evaluate(f, arguments).ToTernaryVector(),
+                ExactResult(f, arguments))
+          << name << " of " << ToString(arguments[0]) << " and "
+          << ToString(arguments[1]);
+    }
+  }
+
+  using UnaryBody = std::function<BValue(FunctionBuilder*, BValue)>;
+  std::vector<std::pair<std::string, UnaryBody>> unary_bodies = {
+      {"not", [](FunctionBuilder* fb, BValue x) { return fb->Not(x); }},
+      {"and_reduce",
+       [](FunctionBuilder* fb, BValue x) { return fb->AndReduce(x); }},
+      {"or_reduce",
+       [](FunctionBuilder* fb, BValue x) { return fb->OrReduce(x); }},
+      {"xor_reduce",
+       [](FunctionBuilder* fb, BValue x) { return fb->XorReduce(x); }},
+      {"bit_slice",
+       [](FunctionBuilder* fb, BValue x) { return fb->BitSlice(x, 1, 2); }},
+      {"zero_ext",
+       [](FunctionBuilder* fb, BValue x) { return fb->ZeroExtend(x, 5); }},
+      {"sign_ext",
+       [](FunctionBuilder* fb, BValue x) { return fb->SignExtend(x, 5); }},
+  };
+  for (const auto& [name, body] : unary_bodies) {
+    FunctionBuilder fb(name, p.get());
+    body(&fb, fb.Param("x", p->GetBitsType(3)));
+    XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+    for (const std::vector<TernaryVector>& arguments : AllArguments(f)) {
+      EXPECT_EQ(Evaluate(f, arguments).ToTernaryVector(),
+                ExactResult(f, arguments))
+          << name << " of " << ToString(arguments[0]);
+    }
+  }
+}
+
+// Shifts by known amounts, including amounts of at least the width, are
+// exact. Shifts by unknown amounts are evaluated by TernaryEvaluator.
+TEST_F(PackedTernaryEvaluatorTest, Shifts) {
+  auto p = CreatePackage();
+  for (Op op : {Op::kShll, Op::kShrl, Op::kShra}) {
+    Function* f = BuildBinary(
+        p.get(), OpToString(op), [op](FunctionBuilder* fb, BValue x, BValue y) {
+          return fb->AddBinOp(op, x, y);
+        });
+    for (const std::vector<TernaryVector>& arguments : AllArguments(f)) {
+      bool known_amount = std::none_of(arguments[1].begin(), arguments[1].end(),
+                                       ternary_ops::IsUnknown);
+      EXPECT_EQ(Evaluate(f, arguments).ToTernaryVector(),
+                known_amount ? ExactResult(f, arguments)
+                             : EvaluateUnpacked(f, arguments))
+          << OpToString(op) << " of " << ToString(arguments[0]) << " by "
+          << ToString(arguments[1]);
+    }
+  }
+}
+
+TEST_F(PackedTernaryEvaluatorTest, OtherOpsMatchTernaryEvaluator) {
+  auto p = CreatePackage();
+  for (Op op : {Op::kSub, Op::kULt, Op::kSGt}) {
+    Function* f = BuildBinary(
+        p.get(), OpToString(op), [op](FunctionBuilder* fb, BValue x, BValue y) {
+          return op == Op::kSub ? fb->AddBinOp(op, x, y)
+                                : fb->AddCompareOp(op, x, y);
+        });
+    for (const std::vector<TernaryVector>& arguments : AllArguments(f)) {
+      EXPECT_EQ(Evaluate(f, arguments).ToTernaryVector(),
+                EvaluateUnpacked(f, arguments))
+          << OpToString(op) << " of " << ToString(arguments[0]) << " and "
+          << ToString(arguments[1]);
+    }
+  }
+}
+
+TEST_F(PackedTernaryEvaluatorTest, Literal) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Literal(UBits(0xabcd, 100));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  EXPECT_THAT(PackedTernaryEvaluate(f->return_value(), {}),
+              IsOkAndHolds(PackedTernaryVector::FromBits(UBits(0xabcd, 100))));
+}
+
+}  // namespace
+}  // namespace xls
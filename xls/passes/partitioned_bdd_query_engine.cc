@@ -0,0 +1,204 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/partitioned_bdd_query_engine.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/passes/bdd_function.h"
+
+namespace xls {
+
+/* static */
+absl::StatusOr<std::unique_ptr<PartitionedBddQueryEngine>>
+PartitionedBddQueryEngine::Run(FunctionBase* f, int64_t partition_count,
+                               int64_t minterm_limit,
+                               absl::Span<const Op> do_not_evaluate_ops) {
+  XLS_CHECK_GE(partition_count, 1);
+  std::vector<std::vector<Node*>> clouds =
+      BddFunction::LogicClouds(f, do_not_evaluate_ops);
+
+  // Assign the clouds, largest first, to the partition with the fewest nodes.
+  std::sort(clouds.begin(), clouds.end(),
+            [](const std::vector<Node*>& a, const std::vector<Node*>& b) {
+              return a.size() > b.size();
+            });
+  std::vector<std::vector<Node*>> partitions(
+      std::min<int64_t>(partition_count, std::max<int64_t>(clouds.size(), 1)));
+  for (std::vector<Node*>& cloud : clouds) {
+    auto smallest = std::min_element(
+        partitions.begin(), partitions.end(),
+        [](const std::vector<Node*>& a, const std::vector<Node*>& b) {
+          return a.size() < b.size();
+        });
+    smallest->insert(smallest->end(), cloud.begin(), cloud.end());
+  }
+  XLS_VLOG(2) << absl::StreamFormat(
+      "Partitioned %s into %d clouds and %d partitions", f->name(),
+      clouds.size(), partitions.size());
+
+  auto engine = absl::WrapUnique(new PartitionedBddQueryEngine());
+  std::vector<absl::StatusOr<std::unique_ptr<BddQueryEngine>>> engines(
+      partitions.size());
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < partitions.size(); ++i) {
+      threads.push_back(absl::make_unique<Thread>([&, i]() {
+        engines[i] = BddQueryEngine::RunOnNodes(f, partitions[i], minterm_limit,
+                                                do_not_evaluate_ops);
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+  for (int64_t i = 0; i < partitions.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<BddQueryEngine> partition_engine,
+                         std::move(engines[i]));
+    engine->engines_.push_back(std::move(partition_engine));
+    for (Node* node : partitions[i]) {
+      engine->partitions_[node] = i;
+    }
+  }
+  return std::move(engine);
+}
+
+absl::optional<int64_t> PartitionedBddQueryEngine::GetPartition(
+    Node* node) const {
+  auto it = partitions_.find(node);
+  if (it == partitions_.end()) {
+    return absl::nullopt;
+  }
+  return it->second;
+}
+
+absl::optional<absl::flat_hash_map<int64_t, std::vector<BitLocation>>>
+PartitionedBddQueryEngine::GroupByPartition(
+    absl::Span<BitLocation const> bits) const {
+  absl::flat_hash_map<int64_t, std::vector<BitLocation>> groups;
+  for (const BitLocation& location : bits) {
+    absl::optional<int64_t> partition = GetPartition(location.node);
+    if (!partition.has_value()) {
+      return absl::nullopt;
+    }
+    groups[*partition].push_back(location);
+  }
+  return groups;
+}
+
+bool PartitionedBddQueryEngine::AtMostOneTrue(
+    absl::Span<BitLocation const> bits) const {
+  auto groups = GroupByPartition(bits);
+  if (!groups.has_value()) {
+    return false;
+  }
+  // The partitions are independent, so at most one bit is true only if the
+  // bits of all partitions but one are known zero, and at most one bit of the
+  // remaining partition can be true.
+  const std::vector<BitLocation>* maybe_true = nullptr;
+  int64_t maybe_true_partition = 0;
+  for (const auto& [partition, locations] : *groups) {
+    if (std::all_of(locations.begin(), locations.end(),
+                    [&](const BitLocation& l) { return IsZero(l); })) {
+      continue;
+    }
+    if (maybe_true != nullptr) {
+      return false;
+    }
+    maybe_true = &locations;
+    maybe_true_partition = partition;
+  }
+  return maybe_true == nullptr ||
+         engines_[maybe_true_partition]->AtMostOneTrue(*maybe_true);
+}
+
+bool PartitionedBddQueryEngine::AtLeastOneTrue(
+    absl::Span<BitLocation const> bits) const {
+  auto groups = GroupByPartition(bits);
+  if (!groups.has_value()) {
+    return false;
+  }
+  // The partitions are independent, so the bits can all be false at once
+  // unless the bits of some partition cannot.
+  for (const auto& [partition, locations] : *groups) {
+    if (engines_[partition]->AtLeastOneTrue(locations)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PartitionedBddQueryEngine::Implies(const BitLocation& a,
+                                        const BitLocation& b) const {
+  if (!IsTracked(a.node) || !IsTracked(b.node)) {
+    return false;
+  }
+  if (partitions_.at(a.node) == partitions_.at(b.node)) {
+    return EngineOf(a.node).Implies(a, b);
+  }
+  return IsZero(a) || IsOne(b);
+}
+
+absl::optional<Bits> PartitionedBddQueryEngine::ImpliedNodeValue(
+    absl::Span<const std::pair<BitLocation, bool>> predicate_bit_values,
+    Node* node) const {
+  if (!IsTracked(node)) {
+    return absl::nullopt;
+  }
+  // Predicates on other partitions are independent of the node's value, so
+  // they can be dropped. Dropping predicates on untracked nodes only weakens
+  // the premise.
+  int64_t partition = partitions_.at(node);
+  std::vector<std::pair<BitLocation, bool>> same_partition;
+  for (const std::pair<BitLocation, bool>& predicate : predicate_bit_values) {
+    absl::optional<int64_t> predicate_partition =
+        GetPartition(predicate.first.node);
+    if (predicate_partition == partition) {
+      same_partition.push_back(predicate);
+    }
+  }
+  return engines_[partition]->ImpliedNodeValue(same_partition, node);
+}
+
+bool PartitionedBddQueryEngine::KnownEquals(const BitLocation& a,
+                                            const BitLocation& b) const {
+  if (!IsTracked(a.node) || !IsTracked(b.node)) {
+    return false;
+  }
+  if (partitions_.at(a.node) == partitions_.at(b.node)) {
+    return EngineOf(a.node).KnownEquals(a, b);
+  }
+  return IsKnown(a) && IsKnown(b) && IsOne(a) == IsOne(b);
+}
+
+bool PartitionedBddQueryEngine::KnownNotEquals(const BitLocation& a,
+                                               const BitLocation& b) const {
+  if (!IsTracked(a.node) || !IsTracked(b.node)) {
+    return false;
+  }
+  if (partitions_.at(a.node) == partitions_.at(b.node)) {
+    return EngineOf(a.node).KnownNotEquals(a, b);
+  }
+  return IsKnown(a) && IsKnown(b) && IsOne(a) != IsOne(b);
+}
+
+}  // namespace xls
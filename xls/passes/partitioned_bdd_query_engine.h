@@ -0,0 +1,103 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_PASSES_PARTITIONED_BDD_QUERY_ENGINE_H_
+#define XLS_PASSES_PARTITIONED_BDD_QUERY_ENGINE_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+#include "xls/passes/bdd_query_engine.h"
+#include "xls/passes/query_engine.h"
+
+namespace xls {
+
+// A BDD-based query engine which splits a function into independent logic
+// clouds (see BddFunction::LogicClouds) and builds a separate BDD for each
+// group of clouds, concurrently. The BDDs of large functions are thereby
+// built in parallel, and each stays smaller than a BDD of the whole function.
+//
+// Because different clouds share no BDD variables, queries about the bits of a
+// single partition are answered exactly as by a BddQueryEngine of the whole
+// function, and queries spanning partitions are answered from the
+// independence of the partitions and the known bits of each.
+//
+// The engine is not updated as the function changes; nodes added after it is
+// run are not tracked.
+class PartitionedBddQueryEngine : public QueryEngine {
+ public:
+  // Groups the clouds of 'f' into at most 'partition_count' partitions of
+  // similar size and builds the engine of each partition on its own thread.
+  // See BddQueryEngine::Run for the meaning of the other arguments.
+  static absl::StatusOr<std::unique_ptr<PartitionedBddQueryEngine>> Run(
+      FunctionBase* f, int64_t partition_count, int64_t minterm_limit = 0,
+      absl::Span<const Op> do_not_evaluate_ops = {});
+
+  // Returns the partition whose BDD holds 'node', or nullopt if the node is
+  // not tracked.
+  absl::optional<int64_t> GetPartition(Node* node) const;
+
+  int64_t partition_count() const { return engines_.size(); }
+  const BddQueryEngine& partition_engine(int64_t partition) const {
+    return *engines_.at(partition);
+  }
+
+  bool IsTracked(Node* node) const override {
+    return partitions_.contains(node);
+  }
+  const Bits& GetKnownBits(Node* node) const override {
+    return EngineOf(node).GetKnownBits(node);
+  }
+  const Bits& GetKnownBitsValues(Node* node) const override {
+    return EngineOf(node).GetKnownBitsValues(node);
+  }
+
+  bool AtMostOneTrue(absl::Span<BitLocation const> bits) const override;
+  bool AtLeastOneTrue(absl::Span<BitLocation const> bits) const override;
+  bool Implies(const BitLocation& a, const BitLocation& b) const override;
+  absl::optional<Bits> ImpliedNodeValue(
+      absl::Span<const std::pair<BitLocation, bool>> predicate_bit_values,
+      Node* node) const override;
+  bool KnownEquals(const BitLocation& a, const BitLocation& b) const override;
+  bool KnownNotEquals(const BitLocation& a,
+                      const BitLocation& b) const override;
+
+ private:
+  const BddQueryEngine& EngineOf(Node* node) const {
+    return *engines_[partitions_.at(node)];
+  }
+
+  // Groups the given bits by partition. Returns nullopt if any bit's node is
+  // not tracked.
+  absl::optional<absl::flat_hash_map<int64_t, std::vector<BitLocation>>>
+  GroupByPartition(absl::Span<BitLocation const> bits) const;
+
+  std::vector<std::unique_ptr<BddQueryEngine>> engines_;
+
+  // The partition of each tracked node.
+  absl::flat_hash_map<Node*, int64_t> partitions_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PARTITIONED_BDD_QUERY_ENGINE_H_
@@ -0,0 +1,112 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/partitioned_bdd_query_engine.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+#include "xls/passes/bdd_function.h"
+
+namespace xls {
+namespace {
+
+using ::testing::UnorderedElementsAre;
+
+class PartitionedBddQueryEngineTest : public IrTestBase {};
+
+TEST_F(PartitionedBddQueryEngineTest, LogicClouds) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  BValue x_and_y = fb.And(x, y);
+  // The add is modeled as variables so it starts a new cloud.
+  BValue sum = fb.Add(x, y);
+  BValue not_sum = fb.Not(sum);
+  BValue literal = fb.Literal(UBits(1, 8));
+  BValue result = fb.Or(not_sum, literal);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  EXPECT_THAT(
+      BddFunction::LogicClouds(f),
+      UnorderedElementsAre(
+          UnorderedElementsAre(x.node(), y.node(), x_and_y.node()),
+          UnorderedElementsAre(sum.node(), not_sum.node(), literal.node(),
+                               result.node())));
+
+  // Modeling the and as variables also separates it from the parameters.
+  EXPECT_EQ(BddFunction::LogicClouds(f, /*do_not_evaluate_ops=*/{Op::kAnd})
+                .size(),
+            4);
+}
+
+TEST_F(PartitionedBddQueryEngineTest, Queries) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue x_eq_0 = fb.Eq(x, fb.Literal(UBits(0, 8)));
+  BValue x_ne_0 = fb.Not(x_eq_0);
+  BValue x_eq_7 = fb.Eq(x, fb.Literal(UBits(7, 8)));
+  // The sum is in a different partition from x.
+  BValue sum = fb.Add(x, x);
+  BValue sum_eq_0 = fb.Eq(sum, fb.Literal(UBits(0, 8)));
+  BValue sum_ne_0 = fb.Not(sum_eq_0);
+  BValue zero = fb.And(sum_eq_0, sum_ne_0);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PartitionedBddQueryEngine> engine,
+                           PartitionedBddQueryEngine::Run(f, 2));
+  EXPECT_EQ(engine->partition_count(), 2);
+  ASSERT_NE(engine->GetPartition(x.node()), engine->GetPartition(sum.node()));
+
+  // Queries within a partition are as precise as a whole-function BDD.
+  EXPECT_TRUE(engine->AtMostOneNodeTrue({x_eq_0.node(), x_eq_7.node()}));
+  EXPECT_TRUE(engine->AtLeastOneNodeTrue({x_eq_0.node(), x_ne_0.node()}));
+  EXPECT_TRUE(engine->KnownNotEquals(BitLocation(x_eq_0.node(), 0),
+                                     BitLocation(x_ne_0.node(), 0)));
+  EXPECT_TRUE(engine->IsAllZeros(zero.node()));
+
+  // Queries spanning partitions rely on known bits.
+  EXPECT_FALSE(engine->AtMostOneNodeTrue({x_eq_0.node(), sum_eq_0.node()}));
+  EXPECT_TRUE(engine->AtMostOneNodeTrue({x_eq_0.node(), zero.node()}));
+  EXPECT_TRUE(engine->AtLeastOneNodeTrue(
+      {x_eq_0.node(), sum_eq_0.node(), sum_ne_0.node()}));
+  EXPECT_FALSE(engine->Implies(BitLocation(x_eq_0.node(), 0),
+                               BitLocation(sum_eq_0.node(), 0)));
+  EXPECT_TRUE(engine->Implies(BitLocation(zero.node(), 0),
+                              BitLocation(x_eq_0.node(), 0)));
+
+  // Predicates on other partitions do not affect implied values.
+  EXPECT_EQ(engine->ImpliedNodeValue({{BitLocation(x_eq_0.node(), 0), true},
+                                      {BitLocation(sum_eq_0.node(), 0), true}},
+                                     x_eq_7.node()),
+            UBits(0, 1));
+  EXPECT_FALSE(
+      engine
+          ->ImpliedNodeValue({{BitLocation(sum_eq_0.node(), 0), true}},
+                             x_eq_7.node())
+          .has_value());
+}
+
+}  // namespace
+}  // namespace xls
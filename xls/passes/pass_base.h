@@ -21,23 +21,32 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "xls/common/file/filesystem.h"
+#include "xls/common/memory_usage.h"
 #include "xls/common/logging/log_lines.h"
 #include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
 #include "xls/ir/function.h"
+#include "xls/ir/ir_file_writer.h"
 #include "xls/ir/package.h"
+#include "xls/passes/pass_cache.h"
 
 namespace xls {
 
+class QueryEngineCache;
+
 // This file defines a set of base classes for building XLS compiler passes and
 // pass pipelines. The base classes are templated allowing polymorphism of the
 // data types the pass operates on.
@@ -50,6 +59,10 @@ struct PassOptions {
   // intermediate IR files.
   std::filesystem::path ir_dump_path;
 
+  // Whether the IR files dumped to ir_dump_path are gzip-compressed (and named
+  // with a ".gz" suffix).
+  bool compress_ir_dumps = false;
+
   // If present, only passes whose short names are in this list will be run.
   absl::optional<std::vector<std::string>> run_only_passes;
 
@@ -57,6 +70,36 @@ struct PassOptions {
   // both run_only_passes and skip_passes are present, then only passes which
   // are present in run_only_passes and not present in skip_passes will be run.
   std::vector<std::string> skip_passes;
+
+  // The maximum number of functions and procs on which a function-scoped pass
+  // (FunctionBasePass) may run concurrently. Functions are never transformed
+  // while a function they call, directly or indirectly, is being transformed.
+  // With a value greater than one, the ids (and hence the default names) of
+  // nodes created by the passes depend on thread timing.
+  int64_t function_parallelism = 1;
+
+  // If greater than one, the BDD-based passes split each function into
+  // independent logic clouds and build their BDDs on up to this many threads
+  // (see PartitionedBddQueryEngine) rather than building one BDD of the whole
+  // function.
+  int64_t bdd_parallelism = 1;
+
+  // If non-null, passes take their query engines from this cache rather than
+  // building them from scratch, so analyses persist across passes and are
+  // only recomputed for the parts of a function which changed.
+  QueryEngineCache* query_engine_cache = nullptr;
+
+  // If present, UnrollPass leaves a counted_for rolled when unrolling it would
+  // add more than this many nodes once the unrolled invocations are inlined.
+  // Rolled loops are left for the sequential generator.
+  absl::optional<int64_t> max_unrolled_node_count;
+
+  // If non-null, each compound pass run on a package first looks up the
+  // result of running it on the package's current IR in this cache and, on a
+  // hit, substitutes the cached IR rather than running its passes. The passes
+  // selected by run_only_passes and skip_passes are part of the key; the
+  // cache's salt must account for any other option which affects the result.
+  PassCache* pass_cache = nullptr;
 };
 
 // An object containing information about the invocation of a pass (single call
@@ -70,6 +113,14 @@ struct PassInvocation {
 
   // The run duration of the pass.
   absl::Duration run_duration;
+
+  // The number of nodes in the IR after the pass minus the number before.
+  int64_t node_count_delta = 0;
+
+  // The amount by which the peak resident set size of the process grew while
+  // the pass ran, in bytes. This approximates the peak memory allocated by the
+  // pass beyond what earlier passes allocated.
+  int64_t peak_memory_growth = 0;
 };
 
 // A object to which metadata may be written in each pass invocation. This data
@@ -82,11 +133,12 @@ struct PassResults {
 // Base class for all compiler passes. Template parameters:
 //
 //   IrT : The data type that the pass operates on (e.g., xls::Package). The
-//     type should define 'DumpIr' and 'name' methods used for dumping and
-//     logging in compound passes. A pass which strictly operate on the XLS IR
-//     may use the xls::Package type as the IrT template argument. Passes which
-//     operate on the IR and a schedule may be instantiated on a data structure
-//     containing both an xls::Package and a schedule.
+//     type should define 'DumpIr', 'name' and 'GetNodeCount' methods used for
+//     dumping, logging and profiling in compound passes. A pass which strictly
+//     operate on the XLS IR may use the xls::Package type as the IrT template
+//     argument. Passes which operate on the IR and a schedule may be
+//     instantiated on a data structure containing both an xls::Package and a
+//     schedule.
 //
 //   OptionsT : Options type passed as an immutable object to each invocation of
 //     PassBase::Run. This type should be derived from PassOptions because
@@ -114,6 +166,7 @@ class PassBase {
   // fixed point computation.
   virtual absl::StatusOr<bool> Run(IrT* ir, const OptionsT& options,
                                    ResultsT* results) const {
+    XLS_TRACE_SPAN(short_name());
     XLS_VLOG(2) << absl::StreamFormat("Running %s [pass #%d]", long_name(),
                                       results->invocations.size());
     XLS_VLOG(3) << "Before:";
@@ -201,12 +254,13 @@ class CompoundPassBase : public PassBase<IrT, OptionsT, ResultsT> {
                                    ResultsT* results) const override {
     if (!options.ir_dump_path.empty()) {
       // Start of the top-level pass. Dump IR.
-      XLS_RETURN_IF_ERROR(DumpIr(options.ir_dump_path, ir, this->short_name(),
-                                 "start",
+      XLS_RETURN_IF_ERROR(DumpIr(options.ir_dump_path,
+                                 options.compress_ir_dumps, ir,
+                                 this->short_name(), "start",
                                  /*ordinal=*/0, /*changed=*/false));
     }
-    return RunNested(ir, options, results, this->short_name(),
-                     /*invariant_checkers=*/{});
+    return RunNestedCached(ir, options, results, this->short_name(),
+                           /*invariant_checkers=*/{});
   }
 
   // Internal implementation of Run for compound passes. Invoked when a compound
@@ -219,18 +273,38 @@ class CompoundPassBase : public PassBase<IrT, OptionsT, ResultsT> {
 
   bool IsCompound() const override { return true; }
 
+  // Returns a string identifying the (transitively) contained passes, used to
+  // key cached results of running this compound pass.
+  std::string Fingerprint() const;
+
  protected:
+  // Runs RunNested, unless options.pass_cache holds the result of running this
+  // compound pass on the IR, in which case the IR is replaced by that result.
+  // Only packages are cached.
+  absl::StatusOr<bool> RunNestedCached(
+      IrT* ir, const OptionsT& options, ResultsT* results,
+      absl::string_view top_level_name,
+      absl::Span<const InvariantChecker* const> invariant_checkers) const;
+
   // Dump the IR to a file in the given directory. Name is determined by the
   // various arguments passed in. File names will be lexographically ordered by
   // package name and ordinal.
-  absl::Status DumpIr(const std::filesystem::path& ir_dump_path, IrT* ir,
-                      absl::string_view top_level_name, absl::string_view tag,
-                      int64_t ordinal, bool changed) const {
+  absl::Status DumpIr(const std::filesystem::path& ir_dump_path, bool compress,
+                      IrT* ir, absl::string_view top_level_name,
+                      absl::string_view tag, int64_t ordinal,
+                      bool changed) const {
     std::filesystem::path path =
-        ir_dump_path / absl::StrFormat("%s.%s.%03d.%s.%s.ir", ir->name(),
+        ir_dump_path / absl::StrFormat("%s.%s.%03d.%s.%s.ir%s", ir->name(),
                                        top_level_name, ordinal, tag,
-                                       changed ? "changed" : "unchanged");
-    return SetFileContents(path, ir->DumpIr());
+                                       changed ? "changed" : "unchanged",
+                                       compress ? ".gz" : "");
+    if constexpr (std::is_same_v<IrT, Package>) {
+      // Stream packages to the file; their text can be very large.
+      return WriteIrFile(*ir, path, compress);
+    } else {
+      XLS_RET_CHECK(!compress) << "Compressed dumps require a package";
+      return SetFileContents(path, ir->DumpIr());
+    }
   }
 
   std::vector<std::unique_ptr<Pass>> passes_;
@@ -269,6 +343,60 @@ class FixedPointCompoundPassBase
   }
 };
 
+template <typename IrT, typename OptionsT, typename ResultsT>
+std::string CompoundPassBase<IrT, OptionsT, ResultsT>::Fingerprint() const {
+  std::vector<std::string> parts;
+  for (const auto& pass : passes_) {
+    if (pass->IsCompound()) {
+      parts.push_back(
+          down_cast<const CompoundPassBase<IrT, OptionsT, ResultsT>*>(
+              pass.get())
+              ->Fingerprint());
+    } else {
+      parts.push_back(pass->short_name());
+    }
+  }
+  return absl::StrFormat("%s(%s)", this->short_name(),
+                         absl::StrJoin(parts, ","));
+}
+
+template <typename IrT, typename OptionsT, typename ResultsT>
+absl::StatusOr<bool> CompoundPassBase<IrT, OptionsT, ResultsT>::RunNestedCached(
+    IrT* ir, const OptionsT& options, ResultsT* results,
+    absl::string_view top_level_name,
+    absl::Span<const InvariantChecker* const> invariant_checkers) const {
+  if constexpr (std::is_same_v<IrT, Package>) {
+    if (options.pass_cache != nullptr) {
+      std::string pipeline = Fingerprint();
+      if (options.run_only_passes.has_value()) {
+        absl::StrAppend(&pipeline, " only:",
+                        absl::StrJoin(*options.run_only_passes, ","));
+      }
+      if (!options.skip_passes.empty()) {
+        absl::StrAppend(&pipeline, " skip:",
+                        absl::StrJoin(options.skip_passes, ","));
+      }
+      absl::optional<std::string> key =
+          options.pass_cache->GetKey(pipeline, *ir);
+      if (key.has_value()) {
+        XLS_ASSIGN_OR_RETURN(absl::optional<bool> cached_changed,
+                             options.pass_cache->Load(*key, ir));
+        if (cached_changed.has_value()) {
+          XLS_VLOG(1) << "Loaded cached result of compound pass "
+                      << this->short_name() << " on package " << ir->name();
+          return *cached_changed;
+        }
+        XLS_ASSIGN_OR_RETURN(bool changed,
+                             RunNested(ir, options, results, top_level_name,
+                                       invariant_checkers));
+        options.pass_cache->Store(*key, *ir, changed);
+        return changed;
+      }
+    }
+  }
+  return RunNested(ir, options, results, top_level_name, invariant_checkers);
+}
+
 template <typename IrT, typename OptionsT, typename ResultsT>
 absl::StatusOr<bool> CompoundPassBase<IrT, OptionsT, ResultsT>::RunNested(
     IrT* ir, const OptionsT& options, ResultsT* results,
@@ -328,13 +456,16 @@ absl::StatusOr<bool> CompoundPassBase<IrT, OptionsT, ResultsT>::RunNested(
     // do not check it in optimized builds.
     std::string ir_before = ir->DumpIr();
 #endif
+    int64_t node_count_before = ir->GetNodeCount();
+    int64_t peak_memory_before = GetPeakResidentSetBytes();
     absl::Time start = absl::Now();
     bool pass_changed;
     if (pass->IsCompound()) {
       XLS_ASSIGN_OR_RETURN(
           pass_changed,
           (down_cast<CompoundPassBase<IrT, OptionsT, ResultsT>*>(pass.get())
-               ->RunNested(ir, options, results, top_level_name, checkers)));
+               ->RunNestedCached(ir, options, results, top_level_name,
+                                 checkers)));
     } else {
       XLS_ASSIGN_OR_RETURN(pass_changed, pass->Run(ir, options, results));
     }
@@ -362,11 +493,18 @@ absl::StatusOr<bool> CompoundPassBase<IrT, OptionsT, ResultsT>::RunNested(
         pass->short_name(),
         (pass_changed ? "changed IR" : "did not change IR"));
     if (!pass->IsCompound()) {
-      results->invocations.push_back(
-          {pass->short_name(), pass_changed, duration});
+      PassInvocation invocation;
+      invocation.pass_name = pass->short_name();
+      invocation.ir_changed = pass_changed;
+      invocation.run_duration = duration;
+      invocation.node_count_delta = ir->GetNodeCount() - node_count_before;
+      invocation.peak_memory_growth =
+          GetPeakResidentSetBytes() - peak_memory_before;
+      results->invocations.push_back(invocation);
     }
     if (!options.ir_dump_path.empty()) {
-      XLS_RETURN_IF_ERROR(DumpIr(options.ir_dump_path, ir, top_level_name,
+      XLS_RETURN_IF_ERROR(DumpIr(options.ir_dump_path,
+                                 options.compress_ir_dumps, ir, top_level_name,
                                  absl::StrCat("after_", pass->short_name()),
                                  /*ordinal=*/results->invocations.size(),
                                  /*changed=*/pass_changed));
@@ -0,0 +1,164 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pass_cache.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "xls/common/file/atomic_write.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/stable_hash.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_parser.h"
+
+namespace xls {
+namespace {
+
+// Bump this whenever the entry format changes, to invalidate existing entries.
+constexpr int64_t kPassCacheFormatVersion = 1;
+
+constexpr char kEntryMagic[] = "xls_pass_cache";
+
+// An entry is a header of the form
+//
+//   xls_pass_cache <version> <changed> <next node id>
+//
+// followed by a line break and the IR of the package after the pipeline ran.
+struct Entry {
+  bool changed;
+  int64_t next_node_id;
+  absl::string_view ir_text;
+};
+
+absl::optional<Entry> ParseEntry(absl::string_view text) {
+  size_t newline = text.find('\n');
+  if (newline == absl::string_view::npos) {
+    return absl::nullopt;
+  }
+  std::vector<absl::string_view> header =
+      absl::StrSplit(text.substr(0, newline), ' ');
+  int64_t version;
+  int64_t changed;
+  Entry entry;
+  if (header.size() != 4 || header[0] != kEntryMagic ||
+      !absl::SimpleAtoi(header[1], &version) ||
+      version != kPassCacheFormatVersion ||
+      !absl::SimpleAtoi(header[2], &changed) ||
+      !absl::SimpleAtoi(header[3], &entry.next_node_id)) {
+    return absl::nullopt;
+  }
+  entry.changed = changed != 0;
+  entry.ir_text = text.substr(newline + 1);
+  return entry;
+}
+
+}  // namespace
+
+absl::optional<std::string> PassCache::GetKey(absl::string_view pipeline,
+                                              const Package& package) const {
+  if (!package.procs().empty() || !package.channels().empty()) {
+    return absl::nullopt;
+  }
+  // The key covers everything the result depends on: the pipeline, the
+  // package-level state which shows up in the output (the names and ids given
+  // to new nodes depend on the next node id), and each function's IR.
+  std::string key_text = absl::StrFormat(
+      "%d\n%s\n%s\n%s\n%s\n%d\n", kPassCacheFormatVersion, salt_, pipeline,
+      package.name(), package.entry().value_or(""), package.next_node_id());
+  for (const std::unique_ptr<Function>& f : package.functions()) {
+    absl::StrAppendFormat(&key_text, "%016x\n", StableHash64(f->DumpIr()));
+  }
+  return absl::StrFormat("%s-%016x", package.name(), StableHash64(key_text));
+}
+
+std::filesystem::path PassCache::GetPath(const std::string& key) const {
+  return cache_dir_ / absl::StrCat(key, ".ir");
+}
+
+absl::optional<bool> PassCache::Miss() {
+  absl::MutexLock lock(&mutex_);
+  ++misses_;
+  return absl::nullopt;
+}
+
+absl::StatusOr<absl::optional<bool>> PassCache::Load(const std::string& key,
+                                                     Package* package) {
+  std::filesystem::path path = GetPath(key);
+  if (!FileExists(path).ok()) {
+    return Miss();
+  }
+  absl::StatusOr<std::string> text = GetFileContents(path);
+  if (!text.ok()) {
+    XLS_LOG(WARNING) << "Unable to read pass cache entry: " << text.status();
+    return Miss();
+  }
+  absl::optional<Entry> entry = ParseEntry(*text);
+  if (!entry.has_value()) {
+    XLS_LOG(WARNING) << "Ignoring malformed pass cache entry " << path;
+    return Miss();
+  }
+  // Parse the entry on its own first so that a corrupt entry leaves the
+  // package untouched.
+  absl::StatusOr<std::unique_ptr<Package>> cached =
+      Parser::ParsePackage(entry->ir_text);
+  if (!cached.ok()) {
+    XLS_LOG(WARNING) << "Ignoring unparsable pass cache entry " << path << ": "
+                     << cached.status();
+    return Miss();
+  }
+
+  // Functions are dumped after the functions they call, so each can be parsed
+  // into the package in turn.
+  std::vector<Function*> old_functions;
+  for (const std::unique_ptr<Function>& f : package->functions()) {
+    old_functions.push_back(f.get());
+  }
+  package->DeleteDeadFunctions(old_functions);
+  for (const std::unique_ptr<Function>& f : (*cached)->functions()) {
+    XLS_RETURN_IF_ERROR(Parser::ParseFunction(f->DumpIr(), package).status());
+  }
+  package->set_next_node_id(
+      std::max(package->next_node_id(), entry->next_node_id));
+
+  absl::MutexLock lock(&mutex_);
+  ++hits_;
+  return entry->changed;
+}
+
+void PassCache::Store(const std::string& key, const Package& package,
+                      bool changed) {
+  absl::Status status = RecursivelyCreateDir(cache_dir_);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to create pass cache directory: " << status;
+    return;
+  }
+  std::string text = absl::StrFormat(
+      "%s %d %d %d\n%s", kEntryMagic, kPassCacheFormatVersion,
+      changed ? 1 : 0, package.next_node_id(), package.DumpIr());
+  status = AtomicSetFileContents(GetPath(key), text);
+  if (!status.ok()) {
+    XLS_LOG(WARNING) << "Unable to write pass cache entry: " << status;
+  }
+}
+
+}  // namespace xls
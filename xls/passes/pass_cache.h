@@ -0,0 +1,90 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_PASS_CACHE_H_
+#define XLS_PASSES_PASS_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+
+// A persistent on-disk cache of the results of running compound passes (pass
+// pipelines) on packages. Each entry is keyed by a hash of the pipeline and of
+// the IR of every function of the package before the pipeline ran, and holds
+// the IR afterwards. When a package is optimized repeatedly with few or no
+// changes, the sub-pipelines whose input is unchanged are then replaced by
+// loading their output. Entries are never invalidated, so the cache directory
+// must be cleared when the passes themselves change (or the change must be
+// reflected in the salt).
+//
+// Only packages consisting solely of functions are cached; the results of
+// pipelines run on packages with procs or channels are always computed.
+class PassCache {
+ public:
+  // "salt" should identify everything besides the pipeline structure and the
+  // IR which affects the result of the passes (e.g., the optimization level
+  // and pass options).
+  PassCache(std::filesystem::path cache_dir, std::string salt)
+      : cache_dir_(std::move(cache_dir)), salt_(std::move(salt)) {}
+
+  // Returns the key of the entry for running the pipeline identified by
+  // "pipeline" on "package" as it is now, or nullopt if the package can't be
+  // cached.
+  absl::optional<std::string> GetKey(absl::string_view pipeline,
+                                     const Package& package) const;
+
+  // If there is an entry for "key", replaces the functions of "package" with
+  // the ones it holds and returns whether the pipeline changed the package.
+  // Returns nullopt if there is no usable entry.
+  absl::StatusOr<absl::optional<bool>> Load(const std::string& key,
+                                            Package* package);
+
+  // Stores "package" as the result of the pipeline run for "key", where
+  // "changed" is whether the pipeline changed the package. Failures to write
+  // the entry are logged and otherwise ignored.
+  void Store(const std::string& key, const Package& package, bool changed);
+
+  int64_t hits() const {
+    absl::MutexLock lock(&mutex_);
+    return hits_;
+  }
+  int64_t misses() const {
+    absl::MutexLock lock(&mutex_);
+    return misses_;
+  }
+
+ private:
+  std::filesystem::path GetPath(const std::string& key) const;
+
+  absl::optional<bool> Miss();
+
+  const std::filesystem::path cache_dir_;
+  const std::string salt_;
+  mutable absl::Mutex mutex_;
+  int64_t hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t misses_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PASS_CACHE_H_
@@ -0,0 +1,147 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pass_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/passes/dce_pass.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+constexpr char kProgram[] = R"(
+package p
+
+fn callee(x: bits[32]) -> bits[32] {
+  ret neg.1: bits[32] = neg(x)
+}
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  dead.2: bits[32] = add(x, y)
+  ret invoke.3: bits[32] = invoke(x, to_apply=callee)
+}
+)";
+
+// Counts its runs, changing nothing.
+class CountingPass : public Pass {
+ public:
+  explicit CountingPass(int64_t* runs)
+      : Pass("counting", "Counting"), runs_(runs) {}
+
+ protected:
+  absl::StatusOr<bool> RunInternal(Package* p, const PassOptions& options,
+                                   PassResults* results) const override {
+    ++*runs_;
+    return false;
+  }
+
+ private:
+  int64_t* runs_;
+};
+
+class PassCacheTest : public IrTestBase {
+ protected:
+  void SetUp() override {
+    XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+    temp_dir_ = std::make_unique<TempDirectory>(std::move(temp_dir));
+    pipeline_.Add<CountingPass>(&runs_);
+    pipeline_.Add<DeadCodeEliminationPass>();
+  }
+
+  // Runs the pipeline on "package" with a fresh cache (as a new process
+  // would) over the test's cache directory.
+  absl::StatusOr<bool> Run(Package* package, PassOptions options = {}) {
+    cache_ = absl::make_unique<PassCache>(temp_dir_->path(), "salt");
+    options.pass_cache = cache_.get();
+    PassResults results;
+    return pipeline_.Run(package, options, &results);
+  }
+
+  std::unique_ptr<TempDirectory> temp_dir_;
+  int64_t runs_ = 0;
+  CompoundPass pipeline_{"pipeline", "Pipeline"};
+  std::unique_ptr<PassCache> cache_;
+};
+
+TEST_F(PassCacheTest, HitSubstitutesCachedResult) {
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, ParsePackage(kProgram));
+  ASSERT_THAT(Run(package.get()), IsOkAndHolds(true));
+  EXPECT_EQ(runs_, 1);
+  EXPECT_EQ(cache_->misses(), 1);
+  std::string optimized = package->DumpIr();
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto again, ParsePackage(kProgram));
+  ASSERT_THAT(Run(again.get()), IsOkAndHolds(true));
+  EXPECT_EQ(runs_, 1);
+  EXPECT_EQ(cache_->hits(), 1);
+  EXPECT_EQ(again->DumpIr(), optimized);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, again->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * callee, again->GetFunction("callee"));
+  EXPECT_EQ(main->return_value()->As<Invoke>()->to_apply(), callee);
+
+  // The optimized package is a fixed point, which is a separate entry.
+  ASSERT_THAT(Run(again.get()), IsOkAndHolds(false));
+  EXPECT_EQ(runs_, 2);
+  ASSERT_THAT(Run(again.get()), IsOkAndHolds(false));
+  EXPECT_EQ(runs_, 2);
+}
+
+TEST_F(PassCacheTest, KeyDependsOnIrAndOptions) {
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, ParsePackage(kProgram));
+  ASSERT_THAT(Run(package.get()), IsOkAndHolds(true));
+  EXPECT_EQ(runs_, 1);
+
+  std::string changed_program = kProgram;
+  changed_program.replace(changed_program.find("neg("), 4, "not(");
+  changed_program.replace(changed_program.find("neg."), 4, "not.");
+  XLS_ASSERT_OK_AND_ASSIGN(auto changed, ParsePackage(changed_program));
+  ASSERT_THAT(Run(changed.get()), IsOkAndHolds(true));
+  EXPECT_EQ(runs_, 2);
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto skipped, ParsePackage(kProgram));
+  PassOptions options;
+  options.skip_passes = {"dce"};
+  ASSERT_THAT(Run(skipped.get(), options), IsOkAndHolds(false));
+  EXPECT_EQ(runs_, 3);
+  EXPECT_EQ(cache_->misses(), 1);
+}
+
+TEST_F(PassCacheTest, ProcsAreNotCached) {
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, ParsePackage(R"(
+package p
+
+proc foo(my_token: token, my_state: bits[32], init=42) {
+  next (my_token, my_state)
+}
+)"));
+  PassCache cache(temp_dir_->path(), "salt");
+  EXPECT_EQ(cache.GetKey("pipeline", *package), absl::nullopt);
+  ASSERT_THAT(Run(package.get()), IsOkAndHolds(false));
+  ASSERT_THAT(Run(package.get()), IsOkAndHolds(false));
+  EXPECT_EQ(runs_, 2);
+}
+
+}  // namespace
+}  // namespace xls
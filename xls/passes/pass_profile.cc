@@ -0,0 +1,92 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pass_profile.h"
+
+#include <algorithm>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
+
+namespace xls {
+
+std::vector<PassProfileEntry> AggregatePassProfile(const PassResults& results) {
+  std::vector<PassProfileEntry> profile;
+  absl::flat_hash_map<std::string, int64_t> index;
+  for (const PassInvocation& invocation : results.invocations) {
+    auto [it, inserted] = index.insert(
+        {invocation.pass_name, static_cast<int64_t>(profile.size())});
+    if (inserted) {
+      profile.push_back(PassProfileEntry{invocation.pass_name});
+    }
+    PassProfileEntry& entry = profile[it->second];
+    ++entry.run_count;
+    entry.changed_count += invocation.ir_changed ? 1 : 0;
+    entry.total_duration += invocation.run_duration;
+    entry.node_count_delta += invocation.node_count_delta;
+    entry.peak_memory_growth += invocation.peak_memory_growth;
+  }
+  // Passes of equal duration stay in the order they first ran.
+  std::stable_sort(profile.begin(), profile.end(),
+                   [](const PassProfileEntry& a, const PassProfileEntry& b) {
+                     return a.total_duration > b.total_duration;
+                   });
+  return profile;
+}
+
+std::string PassProfileToString(absl::Span<const PassProfileEntry> profile) {
+  absl::Duration total;
+  for (const PassProfileEntry& entry : profile) {
+    total += entry.total_duration;
+  }
+  std::string result = absl::StrFormat(
+      "%-24s %12s %7s %15s %12s %12s\n", "pass", "time (ms)", "% time",
+      "changed / runs", "node delta", "peak (KiB)");
+  for (const PassProfileEntry& entry : profile) {
+    double percent =
+        total == absl::ZeroDuration()
+            ? 0.0
+            : 100.0 * absl::FDivDuration(entry.total_duration, total);
+    absl::StrAppendFormat(
+        &result, "%-24s %12.3f %6.1f%% %7d / %-5d %12d %12d\n",
+        entry.pass_name, absl::ToDoubleMilliseconds(entry.total_duration),
+        percent, entry.changed_count, entry.run_count, entry.node_count_delta,
+        entry.peak_memory_growth / 1024);
+  }
+  return result;
+}
+
+std::string PassProfileToJson(absl::Span<const PassProfileEntry> profile) {
+  std::vector<std::string> entries;
+  for (const PassProfileEntry& entry : profile) {
+    std::string name = absl::StrReplaceAll(entry.pass_name,
+                                           {{"\\", "\\\\"}, {"\"", "\\\""}});
+    entries.push_back(absl::StrFormat(
+        "  {\"pass_name\": \"%s\", \"run_count\": %d, \"changed_count\": %d, "
+        "\"total_duration_us\": %d, \"node_count_delta\": %d, "
+        "\"peak_memory_growth_bytes\": %d}",
+        name, entry.run_count, entry.changed_count,
+        absl::ToInt64Microseconds(entry.total_duration),
+        entry.node_count_delta, entry.peak_memory_growth));
+  }
+  if (entries.empty()) {
+    return "[]\n";
+  }
+  return absl::StrCat("[\n", absl::StrJoin(entries, ",\n"), "\n]\n");
+}
+
+}  // namespace xls
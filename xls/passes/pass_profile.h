@@ -0,0 +1,53 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_PASS_PROFILE_H_
+#define XLS_PASSES_PASS_PROFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/passes/pass_base.h"
+
+namespace xls {
+
+// The aggregate cost of all invocations of the passes with a particular short
+// name, e.g., across the iterations of a fixed-point compound pass.
+struct PassProfileEntry {
+  std::string pass_name;
+  int64_t run_count = 0;
+  int64_t changed_count = 0;
+  absl::Duration total_duration;
+  int64_t node_count_delta = 0;
+  // The sum over invocations of the growth of the process's peak resident set
+  // size, i.e., how much the high-water mark rose while this pass ran.
+  int64_t peak_memory_growth = 0;
+};
+
+// Aggregates the invocations in 'results' by pass name. Entries are sorted by
+// decreasing total duration.
+std::vector<PassProfileEntry> AggregatePassProfile(const PassResults& results);
+
+// Returns the profile as a table with one line per pass.
+std::string PassProfileToString(absl::Span<const PassProfileEntry> profile);
+
+// Returns the profile as a JSON array with one object per pass.
+std::string PassProfileToJson(absl::Span<const PassProfileEntry> profile);
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PASS_PROFILE_H_
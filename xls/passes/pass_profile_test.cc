@@ -0,0 +1,90 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pass_profile.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace xls {
+namespace {
+
+using ::testing::HasSubstr;
+
+PassInvocation MakeInvocation(absl::string_view name, bool changed,
+                              int64_t ms, int64_t node_count_delta,
+                              int64_t peak_memory_growth) {
+  PassInvocation invocation;
+  invocation.pass_name = std::string(name);
+  invocation.ir_changed = changed;
+  invocation.run_duration = absl::Milliseconds(ms);
+  invocation.node_count_delta = node_count_delta;
+  invocation.peak_memory_growth = peak_memory_growth;
+  return invocation;
+}
+
+TEST(PassProfileTest, AggregatesByNameSortedByTime) {
+  PassResults results;
+  results.invocations = {
+      MakeInvocation("dce", true, 2, -10, 0),
+      MakeInvocation("bdd_simp", true, 50, -3, 4096),
+      MakeInvocation("dce", true, 3, -5, 0),
+      MakeInvocation("inlining", true, 20, 100, 1024),
+      MakeInvocation("bdd_simp", false, 40, 0, 2048),
+      MakeInvocation("dce", false, 1, 0, 0),
+  };
+  std::vector<PassProfileEntry> profile = AggregatePassProfile(results);
+  ASSERT_EQ(profile.size(), 3);
+
+  EXPECT_EQ(profile[0].pass_name, "bdd_simp");
+  EXPECT_EQ(profile[0].run_count, 2);
+  EXPECT_EQ(profile[0].changed_count, 1);
+  EXPECT_EQ(profile[0].total_duration, absl::Milliseconds(90));
+  EXPECT_EQ(profile[0].node_count_delta, -3);
+  EXPECT_EQ(profile[0].peak_memory_growth, 6144);
+
+  EXPECT_EQ(profile[1].pass_name, "inlining");
+  EXPECT_EQ(profile[1].node_count_delta, 100);
+
+  EXPECT_EQ(profile[2].pass_name, "dce");
+  EXPECT_EQ(profile[2].run_count, 3);
+  EXPECT_EQ(profile[2].changed_count, 2);
+  EXPECT_EQ(profile[2].total_duration, absl::Milliseconds(6));
+  EXPECT_EQ(profile[2].node_count_delta, -15);
+
+  std::string text = PassProfileToString(profile);
+  EXPECT_THAT(text, HasSubstr("bdd_simp"));
+  EXPECT_THAT(text, HasSubstr("77.6%"));
+  EXPECT_LT(text.find("bdd_simp"), text.find("dce"));
+
+  EXPECT_EQ(PassProfileToJson(absl::MakeSpan(profile).subspan(1)),
+            R"([
+  {"pass_name": "inlining", "run_count": 1, "changed_count": 1, )"
+            R"("total_duration_us": 20000, "node_count_delta": 100, )"
+            R"("peak_memory_growth_bytes": 1024},
+  {"pass_name": "dce", "run_count": 3, "changed_count": 2, )"
+            R"("total_duration_us": 6000, "node_count_delta": -15, )"
+            R"("peak_memory_growth_bytes": 0}
+]
+)");
+}
+
+TEST(PassProfileTest, Empty) {
+  std::vector<PassProfileEntry> profile = AggregatePassProfile(PassResults());
+  EXPECT_TRUE(profile.empty());
+  EXPECT_EQ(PassProfileToJson(profile), "[]\n");
+}
+
+}  // namespace
+}  // namespace xls
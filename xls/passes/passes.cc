@@ -14,13 +14,79 @@
 
 #include "xls/passes/passes.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/ir/nodes.h"
 
 namespace xls {
+namespace {
+
+// Returns the functions called directly by the given function or proc.
+std::vector<FunctionBase*> GetCallees(FunctionBase* f) {
+  std::vector<FunctionBase*> callees;
+  for (Node* node : f->nodes()) {
+    switch (node->op()) {
+      case Op::kCountedFor:
+        callees.push_back(node->As<CountedFor>()->body());
+        break;
+      case Op::kDynamicCountedFor:
+        callees.push_back(node->As<DynamicCountedFor>()->body());
+        break;
+      case Op::kInvoke:
+        callees.push_back(node->As<Invoke>()->to_apply());
+        break;
+      case Op::kMap:
+        callees.push_back(node->As<Map>()->to_apply());
+        break;
+      default:
+        break;
+    }
+  }
+  return callees;
+}
+
+// Partitions the functions and procs of the package into groups such that
+// each function only calls functions in earlier groups. Passes may inspect the
+// functions called by the function they transform (e.g., to evaluate an
+// invoke), so the functions within a single group may be transformed
+// concurrently but a function may not be transformed concurrently with one of
+// its callees. Within each group functions appear in package order.
+std::vector<std::vector<FunctionBase*>> GetCallGraphLevels(Package* p) {
+  absl::flat_hash_map<FunctionBase*, int64_t> levels;
+  std::function<int64_t(FunctionBase*)> get_level = [&](FunctionBase* f) {
+    auto it = levels.find(f);
+    if (it != levels.end()) {
+      return it->second;
+    }
+    int64_t level = 0;
+    for (FunctionBase* callee : GetCallees(f)) {
+      level = std::max(level, get_level(callee) + 1);
+    }
+    levels[f] = level;
+    return level;
+  };
+  std::vector<std::vector<FunctionBase*>> result;
+  for (FunctionBase* f : p->GetFunctionsAndProcs()) {
+    int64_t level = get_level(f);
+    if (level >= result.size()) {
+      result.resize(level + 1);
+    }
+    result[level].push_back(f);
+  }
+  return result;
+}
+
+}  // namespace
 
 absl::StatusOr<bool> FunctionBasePass::RunOnFunctionBase(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
@@ -41,15 +107,87 @@ absl::StatusOr<bool> FunctionBasePass::RunOnFunctionBase(
 absl::StatusOr<bool> FunctionBasePass::RunInternal(Package* p,
                                                    const PassOptions& options,
                                                    PassResults* results) const {
+  if (options.function_parallelism <= 1) {
+    return RunOnFunctionBases(p->GetFunctionsAndProcs(), options, results);
+  }
   bool changed = false;
-  for (FunctionBase* f : p->GetFunctionsAndProcs()) {
-    XLS_ASSIGN_OR_RETURN(bool function_changed,
-                         RunOnFunctionBaseInternal(f, options, results));
-    changed |= function_changed;
+  for (const std::vector<FunctionBase*>& level : GetCallGraphLevels(p)) {
+    XLS_ASSIGN_OR_RETURN(bool level_changed,
+                         RunOnFunctionBases(level, options, results));
+    changed |= level_changed;
   }
   return changed;
 }
 
+absl::StatusOr<bool> FunctionBasePass::RunOnFunctionBases(
+    absl::Span<FunctionBase* const> function_bases, const PassOptions& options,
+    PassResults* results) const {
+  int64_t thread_count = std::min<int64_t>(options.function_parallelism,
+                                           function_bases.size());
+  bool changed = false;
+  if (thread_count <= 1) {
+    for (FunctionBase* f : function_bases) {
+      XLS_ASSIGN_OR_RETURN(bool function_changed,
+                           RunOnFunctionBaseInPackage(f, options, results));
+      changed |= function_changed;
+    }
+    return changed;
+  }
+
+  // Each function is given its own results which are merged in package order
+  // afterwards so the contents of 'results' do not depend on thread timing.
+  std::vector<PassResults> function_results(function_bases.size());
+  std::vector<absl::StatusOr<bool>> function_changed(function_bases.size());
+  std::atomic<int64_t> next_index(0);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < thread_count; ++i) {
+      threads.push_back(absl::make_unique<Thread>([&]() {
+        for (int64_t j = next_index++; j < function_bases.size();
+             j = next_index++) {
+          function_changed[j] = RunOnFunctionBaseInPackage(
+              function_bases[j], options, &function_results[j]);
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+  for (int64_t i = 0; i < function_bases.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(bool changed_i, function_changed[i]);
+    changed |= changed_i;
+    results->invocations.insert(results->invocations.end(),
+                                function_results[i].invocations.begin(),
+                                function_results[i].invocations.end());
+  }
+  return changed;
+}
+
+absl::StatusOr<bool> FunctionBasePass::RunOnFunctionBaseInPackage(
+    FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  if (!IsIncremental()) {
+    return RunOnFunctionBaseInternal(f, options, results);
+  }
+  absl::optional<int64_t> checkpoint = f->GetCheckpoint(checkpoint_key_);
+  if (checkpoint.has_value() && *checkpoint == f->change_count()) {
+    XLS_VLOG(3) << absl::StreamFormat("Skipping %s on unchanged %s",
+                                      short_name(), f->name());
+    return false;
+  }
+  XLS_ASSIGN_OR_RETURN(bool changed,
+                       RunOnFunctionBaseInternal(f, options, results));
+  f->SetCheckpoint(checkpoint_key_);
+  return changed;
+}
+
+int64_t FunctionBasePass::LastRunChangeCount(FunctionBase* f) const {
+  if (!IsIncremental()) {
+    return 0;
+  }
+  return f->GetCheckpoint(checkpoint_key_).value_or(0);
+}
+
 absl::StatusOr<bool> FunctionBasePass::TransformNodesToFixedPoint(
     FunctionBase* f,
     std::function<absl::StatusOr<bool>(Node*)> simplify_f) const {
@@ -58,8 +196,11 @@ absl::StatusOr<bool> FunctionBasePass::TransformNodesToFixedPoint(
   absl::flat_hash_set<int64_t> simplified_node_ids;
   bool changed = false;
   bool changed_this_time = false;
+  // Nodes not affected by changes since this point need not be visited.
+  int64_t since = LastRunChangeCount(f);
   do {
     changed_this_time = false;
+    int64_t iteration_start = f->change_count();
     auto node_it = f->nodes().begin();
     while (node_it != f->nodes().end()) {
       // Save the next iterator because node_it may be invalidated by the call
@@ -69,7 +210,8 @@ absl::StatusOr<bool> FunctionBasePass::TransformNodesToFixedPoint(
       // If the node was previously simplified and is now dead, avoid running
       // simplification on it again to avoid inf-looping while simplifying the
       // same node over and over again.
-      if (!node->IsDead() || !simplified_node_ids.contains(node->id())) {
+      if (node->ChangedSince(since) &&
+          (!node->IsDead() || !simplified_node_ids.contains(node->id()))) {
         // Grab the node ID before simplifying because the node might be
         // removed when simplifying.
         int64_t node_id = node->id();
@@ -82,6 +224,9 @@ absl::StatusOr<bool> FunctionBasePass::TransformNodesToFixedPoint(
       }
       node_it = next_it;
     }
+    if (IsIncremental()) {
+      since = iteration_start;
+    }
   } while (changed_this_time);
 
   return changed;
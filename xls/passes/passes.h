@@ -26,6 +26,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "xls/ir/function.h"
 #include "xls/ir/package.h"
 #include "xls/ir/proc.h"
@@ -52,7 +53,7 @@ inline bool NarrowingEnabled(int64_t opt_level) { return opt_level >= 2; }
 class FunctionBasePass : public Pass {
  public:
   FunctionBasePass(absl::string_view short_name, absl::string_view long_name)
-      : Pass(short_name, long_name) {}
+      : Pass(short_name, long_name), checkpoint_key_(FunctionBase::NewCheckpointKey()) {}
 
   // Runs the pass on a single function/proc.
   absl::StatusOr<bool> RunOnFunctionBase(FunctionBase* f,
@@ -69,16 +70,53 @@ class FunctionBasePass : public Pass {
       FunctionBase* f, const PassOptions& options,
       PassResults* results) const = 0;
 
+  // Returns true if the pass is incremental. When run over a package, an
+  // incremental pass skips functions which have not changed since it last ran
+  // on them, and it need only revisit the nodes of a function affected by
+  // changes made since then (see LastRunChangeCount). A pass may opt in if
+  // what it does with a node depends only on the node, its operands and
+  // users, and the operands' operands and users.
+  virtual bool IsIncremental() const { return false; }
+
+  // For incremental passes, returns the change count of the function (see
+  // FunctionBase::change_count) when this pass last finished running on it
+  // over a package, or zero if it has not. Nodes for which
+  // ChangedSince(count) is false need not be revisited. Returns zero for
+  // passes which are not incremental.
+  int64_t LastRunChangeCount(FunctionBase* f) const;
+
   // Calls the given function for every node in the graph in a loop until no
   // further simplifications are possible.  simplify_f should return true if the
   // IR was modified. simplify_f can add or remove nodes including the node
   // passed to it.
   //
+  // For incremental passes only the nodes affected by changes since the last
+  // run, or since the previous iteration of the loop, are visited.
+  //
   // TransformNodesToFixedPoint returns true iff any invocations of simplify_f
   // returned true.
   absl::StatusOr<bool> TransformNodesToFixedPoint(
       FunctionBase* f,
       std::function<absl::StatusOr<bool>(Node*)> simplify_f) const;
+
+ private:
+  // Runs the pass on each of the given functions/procs, using up to
+  // options.function_parallelism threads. None of the functions may call
+  // another in the set.
+  absl::StatusOr<bool> RunOnFunctionBases(
+      absl::Span<FunctionBase* const> function_bases,
+      const PassOptions& options, PassResults* results) const;
+
+  // Runs the pass on a single function/proc as part of a package. Incremental
+  // passes skip unchanged functions and record a checkpoint afterwards.
+  absl::StatusOr<bool> RunOnFunctionBaseInPackage(FunctionBase* f,
+                                                  const PassOptions& options,
+                                                  PassResults* results) const;
+
+  // Key under which the pass records checkpoints in functions. Unique to each
+  // pass object so distinct instances of a pass (which may be configured
+  // differently) do not share checkpoints.
+  const int64_t checkpoint_key_;
 };
 
 // Abstract base class for passes operate on procs. The derived
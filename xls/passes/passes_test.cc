@@ -16,8 +16,11 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/common/casts.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/matchers.h"
@@ -29,6 +32,7 @@
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
 #include "xls/ir/type.h"
+#include "xls/ir/verifier.h"
 
 namespace xls {
 namespace {
@@ -432,5 +436,155 @@ TEST(PassesTest, TestTransformNodesToFixedPointWhileRemovingNodes) {
               IsOkAndHolds(false));
 }
 
+// Adds a dead literal to each function, recording whether any callee of the
+// function was not yet done when the function was visited.
+class AddLiteralPass : public FunctionBasePass {
+ public:
+  AddLiteralPass() : FunctionBasePass("add_literal", "add literal") {}
+
+  bool callee_order_violated() const {
+    absl::MutexLock lock(&mutex_);
+    return callee_order_violated_;
+  }
+
+ protected:
+  absl::StatusOr<bool> RunOnFunctionBaseInternal(
+      FunctionBase* f, const PassOptions& options,
+      PassResults* results) const override {
+    {
+      absl::MutexLock lock(&mutex_);
+      for (Node* node : f->nodes()) {
+        if (node->Is<Invoke>() &&
+            !done_.contains(node->As<Invoke>()->to_apply())) {
+          callee_order_violated_ = true;
+        }
+      }
+    }
+    XLS_RETURN_IF_ERROR(
+        f->MakeNode<Literal>(absl::nullopt, Value(UBits(42, 17))).status());
+    absl::MutexLock lock(&mutex_);
+    done_.insert(f);
+    return true;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  mutable absl::flat_hash_set<FunctionBase*> done_ ABSL_GUARDED_BY(mutex_);
+  mutable bool callee_order_violated_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+TEST(PassesTest, FunctionParallelism) {
+  auto m = absl::make_unique<Package>("m");
+  Type* u32 = m->GetBitsType(32);
+  // A three-level call tree: main invokes 4 functions, each invoking 4 leaves.
+  int64_t leaf_count = 0;
+  auto build_caller = [&](absl::string_view name,
+                          absl::Span<Function* const> callees) {
+    FunctionBuilder fb(name, m.get());
+    BValue x = fb.Param("x", u32);
+    BValue sum = callees.empty() ? fb.Literal(UBits(leaf_count++, 32)) : x;
+    for (Function* callee : callees) {
+      sum = fb.Add(sum, fb.Invoke({x}, callee));
+    }
+    return fb.BuildWithReturnValue(fb.Add(x, sum)).value();
+  };
+  std::vector<Function*> mids;
+  for (int64_t i = 0; i < 4; ++i) {
+    std::vector<Function*> leaves;
+    for (int64_t j = 0; j < 4; ++j) {
+      leaves.push_back(build_caller(absl::StrFormat("leaf_%d_%d", i, j), {}));
+    }
+    mids.push_back(build_caller(absl::StrFormat("mid_%d", i), leaves));
+  }
+  build_caller("main", mids);
+  std::string original_ir = m->DumpIr();
+
+  PassOptions options;
+  options.function_parallelism = 4;
+  AddLiteralPass add_literal;
+  PassResults results;
+  EXPECT_THAT(add_literal.Run(m.get(), options, &results), IsOkAndHolds(true));
+  EXPECT_FALSE(add_literal.callee_order_violated());
+  XLS_EXPECT_OK(VerifyPackage(m.get()));
+  for (FunctionBase* f : m->GetFunctionsAndProcs()) {
+    EXPECT_EQ(absl::c_count_if(f->nodes(),
+                               [](Node* n) {
+                                 return n->Is<Literal>() &&
+                                        n->BitCountOrDie() == 17;
+                               }),
+              1)
+        << f->name();
+  }
+
+  // Removing the literals in parallel restores the original IR.
+  EXPECT_THAT(NaiveDcePass().Run(m.get(), options, &results),
+              IsOkAndHolds(true));
+  XLS_EXPECT_OK(VerifyPackage(m.get()));
+  EXPECT_EQ(m->DumpIr(), original_ir);
+}
+
+// Incremental pass which replaces not(not(x)) with x, counting the nodes it
+// visits.
+class IncrementalNotNotPass : public FunctionBasePass {
+ public:
+  IncrementalNotNotPass() : FunctionBasePass("not_not", "not not") {}
+
+  int64_t visit_count() const { return visit_count_; }
+
+ protected:
+  bool IsIncremental() const override { return true; }
+
+  absl::StatusOr<bool> RunOnFunctionBaseInternal(
+      FunctionBase* f, const PassOptions& options,
+      PassResults* results) const override {
+    return TransformNodesToFixedPoint(f, [&](Node* n) -> absl::StatusOr<bool> {
+      ++visit_count_;
+      if (n->op() == Op::kNot && n->operand(0)->op() == Op::kNot) {
+        XLS_RETURN_IF_ERROR(n->ReplaceUsesWith(n->operand(0)->operand(0)));
+        return true;
+      }
+      return false;
+    });
+  }
+
+ private:
+  mutable int64_t visit_count_ = 0;
+};
+
+TEST(PassesTest, IncrementalPass) {
+  auto m = absl::make_unique<Package>("m");
+  FunctionBuilder fb("f", m.get());
+  BValue x = fb.Param("x", m->GetBitsType(32));
+  BValue y = fb.Param("y", m->GetBitsType(32));
+  BValue chain = fb.Param("z", m->GetBitsType(32));
+  for (int64_t i = 0; i < 20; ++i) {
+    chain = fb.Negate(chain);
+  }
+  BValue sum = fb.Add(fb.Add(fb.Not(fb.Not(x)), fb.Negate(y)), chain);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(sum));
+
+  IncrementalNotNotPass pass;
+  PassResults results;
+  EXPECT_THAT(pass.Run(m.get(), PassOptions(), &results), IsOkAndHolds(true));
+  int64_t first_visit_count = pass.visit_count();
+  EXPECT_GE(first_visit_count, f->node_count());
+
+  // Nothing has changed since the last run so the function is skipped.
+  EXPECT_THAT(pass.Run(m.get(), PassOptions(), &results), IsOkAndHolds(false));
+  EXPECT_EQ(pass.visit_count(), first_visit_count);
+
+  // After adding not(not(y)) only the changed nodes and their users are
+  // visited, not the unrelated chain of negations.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * not_y, f->MakeNode<UnOp>(absl::nullopt, y.node(), Op::kNot));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * not_not_y, f->MakeNode<UnOp>(absl::nullopt, not_y, Op::kNot));
+  XLS_ASSERT_OK(y.node()->users()[0]->ReplaceOperandNumber(0, not_not_y));
+  int64_t visits_before = pass.visit_count();
+  EXPECT_THAT(pass.Run(m.get(), PassOptions(), &results), IsOkAndHolds(true));
+  EXPECT_LT(pass.visit_count() - visits_before, 20);
+  EXPECT_EQ(f->return_value()->operand(0)->operand(1)->operand(0), y.node());
+}
+
 }  // namespace
 }  // namespace xls
@@ -0,0 +1,201 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pipeline_autotuner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <tuple>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/delay_model/analyze_critical_path.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/passes/query_engine_cache.h"
+#include "xls/scheduling/pipeline_schedule.h"
+
+namespace xls {
+namespace {
+
+// Returns the score of the optimized package.
+absl::StatusOr<PipelineScore> ScorePackage(Package* package,
+                                           const AutotuneOptions& options) {
+  PipelineScore score;
+  score.node_count = package->GetNodeCount();
+  if (options.delay_estimator == nullptr) {
+    return score;
+  }
+  XLS_ASSIGN_OR_RETURN(Function * entry, package->EntryFunction());
+  XLS_ASSIGN_OR_RETURN(
+      std::vector<CriticalPathEntry> critical_path,
+      AnalyzeCriticalPath(entry, /*clock_period_ps=*/absl::nullopt,
+                          *options.delay_estimator));
+  if (!critical_path.empty()) {
+    score.critical_path_ps = critical_path.front().path_delay_ps;
+  }
+  if (options.pipeline_stages > 0) {
+    std::vector<SchedulingOptions> scheduling_options = {
+        SchedulingOptions().pipeline_stages(options.pipeline_stages)};
+    XLS_ASSIGN_OR_RETURN(
+        std::vector<ScheduleSweepPoint> points,
+        RunScheduleSweep(entry, *options.delay_estimator, scheduling_options,
+                         /*num_threads=*/1));
+    XLS_RETURN_IF_ERROR(points.front().schedule.status());
+    score.registers = points.front().registers;
+  }
+  return score;
+}
+
+// Optimizes a fresh copy of the package with the given pipeline variant and
+// scores it.
+absl::StatusOr<std::pair<PipelineScore, std::unique_ptr<Package>>> RunVariant(
+    absl::string_view ir_text, const StandardPipelineConfig& config,
+    const AutotuneOptions& options) {
+  std::unique_ptr<Package> package;
+  if (options.entry.has_value()) {
+    XLS_ASSIGN_OR_RETURN(
+        package, Parser::ParsePackageWithEntry(ir_text, *options.entry));
+  } else {
+    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(ir_text));
+  }
+  PassOptions pass_options = options.pass_options;
+  pass_options.ir_dump_path.clear();
+  pass_options.pass_cache = nullptr;
+  QueryEngineCache query_engine_cache;
+  pass_options.query_engine_cache = &query_engine_cache;
+  PassResults results;
+  XLS_RETURN_IF_ERROR(CreateStandardPassPipeline(config)
+                          ->Run(package.get(), pass_options, &results)
+                          .status());
+  XLS_ASSIGN_OR_RETURN(PipelineScore score,
+                       ScorePackage(package.get(), options));
+  return std::make_pair(score, std::move(package));
+}
+
+}  // namespace
+
+bool PipelineScore::operator<(const PipelineScore& other) const {
+  return std::tie(registers, critical_path_ps, node_count) <
+         std::tie(other.registers, other.critical_path_ps, other.node_count);
+}
+
+std::string PipelineScore::ToString() const {
+  return absl::StrFormat("registers=%d critical_path_ps=%d node_count=%d",
+                         registers, critical_path_ps, node_count);
+}
+
+std::vector<StandardPipelineConfig> StandardPipelineVariants(
+    int64_t opt_level) {
+  std::vector<int64_t> opt_levels = {opt_level};
+  if (opt_level > 2) {
+    opt_levels.push_back(2);
+  }
+  std::vector<StandardPipelineConfig> configs;
+  for (int64_t level : opt_levels) {
+    for (bool bdd_passes : {true, false}) {
+      for (bool narrowing_first : {false, true}) {
+        StandardPipelineConfig config;
+        config.opt_level = level;
+        config.bdd_passes = bdd_passes;
+        config.narrowing_first = narrowing_first;
+        configs.push_back(config);
+      }
+    }
+  }
+  return configs;
+}
+
+absl::StatusOr<AutotuneResult> AutotunePassPipeline(
+    absl::string_view ir_text, const AutotuneOptions& options) {
+  std::vector<StandardPipelineConfig> configs = options.configs;
+  if (configs.empty()) {
+    configs = StandardPipelineVariants();
+  }
+
+  AutotuneResult result;
+  std::vector<std::unique_ptr<Package>> packages(configs.size());
+  for (const StandardPipelineConfig& config : configs) {
+    result.candidates.push_back({config, PipelineScore()});
+  }
+  auto run_candidate = [&](int64_t i) {
+    absl::StatusOr<std::pair<PipelineScore, std::unique_ptr<Package>>> run =
+        RunVariant(ir_text, configs[i], options);
+    if (!run.ok()) {
+      XLS_VLOG(1) << "Pipeline " << configs[i].ToString()
+                  << " failed: " << run.status();
+      result.candidates[i].score = run.status();
+      return;
+    }
+    result.candidates[i].score = run->first;
+    packages[i] = std::move(run->second);
+  };
+
+  int64_t thread_count = options.thread_count;
+  if (thread_count <= 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count = std::min<int64_t>(thread_count, configs.size());
+  std::atomic<int64_t> next_candidate(0);
+  auto worker = [&]() {
+    for (int64_t i = next_candidate++; i < configs.size();
+         i = next_candidate++) {
+      run_candidate(i);
+    }
+  };
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 1; t < thread_count; ++t) {
+    threads.push_back(std::make_unique<Thread>(worker));
+  }
+  worker();
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  absl::optional<int64_t> best;
+  for (int64_t i = 0; i < result.candidates.size(); ++i) {
+    const absl::StatusOr<PipelineScore>& score = result.candidates[i].score;
+    if (score.ok() &&
+        (!best.has_value() || *score < *result.candidates[*best].score)) {
+      best = i;
+    }
+  }
+  if (!best.has_value()) {
+    return result.candidates.front().score.status();
+  }
+  result.best_index = *best;
+  result.package = std::move(packages[*best]);
+  return result;
+}
+
+std::string AutotuneResultToString(const AutotuneResult& result) {
+  std::string text;
+  for (int64_t i = 0; i < result.candidates.size(); ++i) {
+    const AutotuneCandidate& candidate = result.candidates[i];
+    absl::StrAppendFormat(
+        &text, "%s %-50s %s\n", i == result.best_index ? "*" : " ",
+        candidate.config.ToString(),
+        candidate.score.ok() ? candidate.score->ToString()
+                             : candidate.score.status().ToString());
+  }
+  return text;
+}
+
+}  // namespace xls
@@ -0,0 +1,114 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_PIPELINE_AUTOTUNER_H_
+#define XLS_PASSES_PIPELINE_AUTOTUNER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/package.h"
+#include "xls/passes/passes.h"
+#include "xls/passes/standard_pipeline.h"
+
+namespace xls {
+
+// The quality of a package optimized by a pipeline variant. Lower is better,
+// comparing the fields in order: register bits first, as they dominate area,
+// then the delay, then the node count. Fields which were not measured are
+// zero.
+struct PipelineScore {
+  // The number of pipeline register bits of the entry function scheduled into
+  // AutotuneOptions::pipeline_stages stages.
+  int64_t registers = 0;
+
+  // The critical path delay of the entry function.
+  int64_t critical_path_ps = 0;
+
+  // The number of nodes in the package.
+  int64_t node_count = 0;
+
+  bool operator<(const PipelineScore& other) const;
+  std::string ToString() const;
+};
+
+struct AutotuneOptions {
+  // The pipeline variants to try. Defaults to StandardPipelineVariants.
+  std::vector<StandardPipelineConfig> configs;
+
+  // The options every variant is run with. Per-variant state (the query
+  // engine and pass caches and the IR dump directory) is not shared.
+  PassOptions pass_options;
+
+  // The entry function to optimize and measure, if not the package's.
+  absl::optional<std::string> entry;
+
+  // If non-null, the critical path of the entry function is measured.
+  const DelayEstimator* delay_estimator = nullptr;
+
+  // If positive (and there is a delay estimator), the entry function is
+  // scheduled into this many stages and its pipeline registers measured.
+  int64_t pipeline_stages = 0;
+
+  // The maximum number of variants run concurrently; zero means one per core.
+  int64_t thread_count = 0;
+};
+
+struct AutotuneCandidate {
+  StandardPipelineConfig config;
+
+  // The score of the optimized package, or the error with which the pipeline
+  // or the measurement failed.
+  absl::StatusOr<PipelineScore> score;
+};
+
+struct AutotuneResult {
+  // One candidate per configuration, in the order of the options.
+  std::vector<AutotuneCandidate> candidates;
+
+  // The index of the best candidate. Ties go to the earliest.
+  int64_t best_index = 0;
+
+  // The package optimized by the best candidate.
+  std::unique_ptr<Package> package;
+
+  const StandardPipelineConfig& best_config() const {
+    return candidates[best_index].config;
+  }
+};
+
+// Returns the default variants tried by the autotuner for the given maximum
+// optimization level: the standard pipeline first, then the combinations of a
+// lower optimization level, without the BDD passes, and with narrowing first.
+std::vector<StandardPipelineConfig> StandardPipelineVariants(
+    int64_t opt_level = kMaxOptLevel);
+
+// Optimizes a copy of the package "ir_text" with each pipeline variant, on
+// concurrent threads, and returns the best result. Returns an error only if
+// every variant fails.
+absl::StatusOr<AutotuneResult> AutotunePassPipeline(
+    absl::string_view ir_text, const AutotuneOptions& options);
+
+// Returns a table of the candidates and their scores with the best marked.
+std::string AutotuneResultToString(const AutotuneResult& result);
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PIPELINE_AUTOTUNER_H_
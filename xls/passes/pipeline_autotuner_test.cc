@@ -0,0 +1,91 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/pipeline_autotuner.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/verifier.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+constexpr char kIr[] = R"(
+package p
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  literal.1: bits[32] = literal(value=0)
+  add.2: bits[32] = add(x, literal.1)
+  and.3: bits[32] = and(add.2, y)
+  not.4: bits[32] = not(and.3)
+  ret not.5: bits[32] = not(not.4)
+}
+)";
+
+TEST(PipelineAutotunerTest, StandardVariants) {
+  std::vector<StandardPipelineConfig> variants = StandardPipelineVariants(3);
+  EXPECT_EQ(variants.size(), 8);
+  EXPECT_EQ(variants.front(), StandardPipelineConfig());
+  EXPECT_EQ(StandardPipelineVariants(1).size(), 4);
+}
+
+TEST(PipelineAutotunerTest, PicksBestVariant) {
+  AutotuneOptions options;
+  options.configs = StandardPipelineVariants(3);
+  XLS_ASSERT_OK_AND_ASSIGN(options.delay_estimator, GetDelayEstimator("unit"));
+  options.pipeline_stages = 2;
+  options.thread_count = 3;
+  XLS_ASSERT_OK_AND_ASSIGN(AutotuneResult result,
+                           AutotunePassPipeline(kIr, options));
+
+  ASSERT_EQ(result.candidates.size(), options.configs.size());
+  const absl::StatusOr<PipelineScore>& best =
+      result.candidates[result.best_index].score;
+  XLS_ASSERT_OK(best.status());
+  for (const AutotuneCandidate& candidate : result.candidates) {
+    XLS_ASSERT_OK(candidate.score.status());
+    EXPECT_FALSE(*candidate.score < *best) << candidate.config.ToString();
+  }
+  ASSERT_NE(result.package, nullptr);
+  XLS_EXPECT_OK(VerifyPackage(result.package.get()));
+  EXPECT_EQ(result.package->GetNodeCount(), best->node_count);
+  EXPECT_THAT(AutotuneResultToString(result), HasSubstr("* opt_level="));
+}
+
+TEST(PipelineAutotunerTest, AllVariantsFail) {
+  AutotuneOptions options;
+  options.configs = {StandardPipelineConfig()};
+  EXPECT_THAT(AutotunePassPipeline("not ir", options).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(PipelineAutotunerTest, ScoreOrder) {
+  PipelineScore a{/*registers=*/1, /*critical_path_ps=*/10, /*node_count=*/5};
+  PipelineScore b{/*registers=*/2, /*critical_path_ps=*/1, /*node_count=*/1};
+  PipelineScore c{/*registers=*/1, /*critical_path_ps=*/10, /*node_count=*/4};
+  EXPECT_TRUE(a < b);
+  EXPECT_TRUE(c < a);
+  EXPECT_FALSE(a < a);
+}
+
+}  // namespace
+}  // namespace xls
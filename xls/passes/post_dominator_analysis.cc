@@ -15,139 +15,125 @@
 #include "xls/passes/post_dominator_analysis.h"
 
 #include <algorithm>
-#include <cstdio>
-#include <queue>
+#include <vector>
 
 #include "absl/algorithm/container.h"
-#include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
-#include "absl/meta/type_traits.h"
-#include "absl/status/status.h"
 #include "absl/status/statusor.h"
-#include "xls/common/status/ret_check.h"
-#include "xls/ir/function.h"
 #include "xls/ir/node_iterator.h"
-#include "xls/ir/proc.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 namespace {
 
-using NodeIndex = int64_t;
+bool CompareById(const Node* a, const Node* b) { return a->id() < b->id(); }
 
-// Returns the intersection of the given sorted lists. Lists should be sorted in
-// ascending order.
-std::vector<NodeIndex> IntersectSortedLists(
-    absl::Span<const absl::Span<const NodeIndex>> lists) {
-  std::vector<NodeIndex> intersection;
-  if (lists.empty()) {
-    return intersection;
-  }
-  std::vector<int64_t> indices(lists.size(), 0);
+}  // namespace
 
-  // Returns true if any of the indices are at the end of their respective
-  // lists.
-  auto at_end_of_a_list = [&]() {
-    for (int64_t i = 0; i < indices.size(); ++i) {
-      if (indices[i] == lists[i].size()) {
-        return true;
+/* static */ absl::StatusOr<std::unique_ptr<PostDominatorAnalysis>>
+PostDominatorAnalysis::Run(FunctionBase* f) {
+  auto analysis = absl::make_unique<PostDominatorAnalysis>();
+  NodeMap<TreeNode>& tree = analysis->tree_;
+  tree = NodeMap<TreeNode>(f);
+
+  // Returns the nearest common ancestor of the given nodes in the tree, or
+  // nullptr if they are in different trees.
+  auto nearest_common_ancestor = [&](Node* a, Node* b) -> Node* {
+    while (a != b) {
+      if (a == nullptr || b == nullptr) {
+        return nullptr;
       }
-    }
-    return false;
-  };
-  while (!at_end_of_a_list()) {
-    // Find the minimum value among the list elements at their respective
-    // indices.
-    NodeIndex min_value = lists[0][indices[0]];
-    for (int64_t i = 1; i < lists.size(); ++i) {
-      NodeIndex value = lists[i][indices[i]];
-      if (value < min_value) {
-        min_value = value;
+      const TreeNode& tree_a = tree.at(a);
+      const TreeNode& tree_b = tree.at(b);
+      if (tree_a.depth >= tree_b.depth) {
+        a = tree_a.immediate_post_dominator;
       }
-    }
-
-    // Advance all list indices which hold the minimum value.
-    int64_t match_count = 0;
-    for (int64_t i = 0; i < lists.size(); ++i) {
-      if (lists[i][indices[i]] == min_value) {
-        indices[i]++;
-        match_count++;
+      if (tree_b.depth >= tree_a.depth) {
+        b = tree_b.immediate_post_dominator;
       }
     }
+    return a;
+  };
 
-    // If all lists contained the minimum value then add the value to the
-    // intersection.
-    if (match_count == lists.size()) {
-      intersection.push_back(min_value);
+  // The post-dominators of a node are the node itself plus the intersection
+  // of the post-dominators of its users. Each user's post-dominators are the
+  // path from it to the root of its tree, so the intersection is the path
+  // from the users' nearest common ancestor to the root. Visiting nodes in
+  // reverse topological order means users are already in the tree.
+  for (Node* node : ReverseTopoSort(f)) {
+    TreeNode& tree_node = tree[node];
+    if (node->users().empty()) {
+      continue;
     }
-  }
-  return intersection;
-}
-
-}  // namespace
-
-/* static */ absl::StatusOr<std::unique_ptr<PostDominatorAnalysis>>
-PostDominatorAnalysis::Run(FunctionBase* f) {
-  auto analysis = absl::make_unique<PostDominatorAnalysis>();
-
-  // A reverse topological sort of the function nodes.
-  NodeIterator r = ReverseTopoSort(f);
-  std::vector<Node*> reverse_toposort(r.begin(), r.end());
-
-  // Map from node to index in a reverse topo sort.
-  absl::flat_hash_map<Node*, NodeIndex> node_index;
-  for (NodeIndex i = 0; i < reverse_toposort.size(); ++i) {
-    node_index[reverse_toposort[i]] = i;
-  }
-
-  // Construct the postdominators for each node. Postdominators are gathered as
-  // a sorted vector containing the node indices (in a reverse toposort) of the
-  // post dominator nodes.
-  absl::flat_hash_map<Node*, std::vector<NodeIndex>> postdominators;
-  for (NodeIndex i = 0; i < reverse_toposort.size(); ++i) {
-    Node* node = reverse_toposort[i];
-    std::vector<absl::Span<const NodeIndex>> user_postdominators;
+    Node* ipdom = node->users().front();
     for (Node* user : node->users()) {
-      user_postdominators.push_back(postdominators.at(user));
+      ipdom = nearest_common_ancestor(ipdom, user);
+      if (ipdom == nullptr) {
+        break;
+      }
     }
-    // The postdominators of a node is the intersection of the lists of
-    // postdominators for its users plus the node itself.
-    postdominators[node] = IntersectSortedLists(user_postdominators);
-    postdominators[node].push_back(i);
+    tree_node.immediate_post_dominator = ipdom;
+    tree_node.depth = ipdom == nullptr ? 0 : tree.at(ipdom).depth + 1;
   }
 
+  // Number the nodes by a depth-first traversal of each tree so every subtree
+  // is a contiguous range.
+  NodeMap<std::vector<Node*>> children(f);
+  std::vector<Node*> roots;
   for (Node* node : f->nodes()) {
-    for (NodeIndex postdominator_index : postdominators[node]) {
-      Node* postdominator = reverse_toposort.at(postdominator_index);
-      analysis->dominated_node_to_post_dominators_[node].insert(postdominator);
-      analysis->post_dominator_to_dominated_nodes_[postdominator].insert(node);
+    Node* ipdom = tree.at(node).immediate_post_dominator;
+    if (ipdom == nullptr) {
+      roots.push_back(node);
+    } else {
+      children[ipdom].push_back(node);
     }
   }
-
-  // Order nodes.
-  auto generate_ordered_by_id_nodes =
-      [](const absl::flat_hash_map<Node*, absl::flat_hash_set<Node*>>&
-             node_to_node_set,
-         absl::flat_hash_map<Node*, std::vector<Node*>>* node_to_node_vect) {
-        for (auto& [base_node, node_set] : node_to_node_set) {
-          auto& node_vect = (*node_to_node_vect)[base_node];
-          node_vect.insert(node_vect.begin(), node_set.begin(), node_set.end());
-          std::sort(node_vect.begin(), node_vect.end(),
-                    [](Node* a, Node* b) { return a->id() < b->id(); });
+  std::vector<Node*>& preorder = analysis->preorder_;
+  preorder.reserve(f->node_count());
+  // Each entry is a node and whether its subtree has been visited.
+  std::vector<std::pair<Node*, bool>> stack;
+  for (Node* root : roots) {
+    stack.push_back({root, false});
+    while (!stack.empty()) {
+      auto [node, visited] = stack.back();
+      stack.pop_back();
+      TreeNode& tree_node = tree.at(node);
+      if (visited) {
+        tree_node.preorder_end = preorder.size();
+        continue;
+      }
+      tree_node.preorder_begin = preorder.size();
+      preorder.push_back(node);
+      stack.push_back({node, true});
+      if (const std::vector<Node*>* node_children = children.find(node)) {
+        for (Node* child : *node_children) {
+          stack.push_back({child, false});
         }
-      };
-  XLS_RET_CHECK(
-      analysis->dominated_node_to_post_dominators_ordered_by_id_.empty());
-  XLS_RET_CHECK(
-      analysis->post_dominator_to_dominated_nodes_ordered_by_id_.empty());
-  generate_ordered_by_id_nodes(
-      analysis->dominated_node_to_post_dominators_,
-      &analysis->dominated_node_to_post_dominators_ordered_by_id_);
-  generate_ordered_by_id_nodes(
-      analysis->post_dominator_to_dominated_nodes_,
-      &analysis->post_dominator_to_dominated_nodes_ordered_by_id_);
+      }
+    }
+  }
 
   return std::move(analysis);
 }
 
+std::vector<Node*> PostDominatorAnalysis::GetPostDominatorsOfNode(
+    const Node* node) const {
+  std::vector<Node*> post_dominators;
+  for (Node* n = preorder_.at(tree_.at(node).preorder_begin); n != nullptr;
+       n = tree_.at(n).immediate_post_dominator) {
+    post_dominators.push_back(n);
+  }
+  absl::c_sort(post_dominators, CompareById);
+  return post_dominators;
+}
+
+std::vector<Node*> PostDominatorAnalysis::GetNodesPostDominatedByNode(
+    const Node* node) const {
+  const TreeNode& tree_node = tree_.at(node);
+  std::vector<Node*> dominated(preorder_.begin() + tree_node.preorder_begin,
+                               preorder_.begin() + tree_node.preorder_end);
+  absl::c_sort(dominated, CompareById);
+  return dominated;
+}
+
 }  // namespace xls
@@ -15,51 +15,70 @@
 #ifndef XLS_PASSES_POSTDOMINATOR_FUNCTION_H_
 #define XLS_PASSES_POSTDOMINATOR_FUNCTION_H_
 
-#include "absl/container/flat_hash_set.h"
+#include <memory>
+#include <vector>
+
 #include "absl/status/statusor.h"
-#include "absl/types/span.h"
 #include "xls/ir/function.h"
 #include "xls/ir/node.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 
 // A class for post-dominator analysis of the IR instructions in a function.
+// A node is post-dominated by itself and by each node which lies on every path
+// from it to a node without users. Implicit uses such as the function's
+// return value are not considered.
+//
+// The analysis is represented as a forest of immediate post-dominators, built
+// in a single pass over the function in reverse topological order, with each
+// tree numbered by a depth-first traversal so post-dominance queries are a
+// constant-time interval check. Memory is linear in the size of the function;
+// only the list-returning queries enumerate sets of nodes.
 class PostDominatorAnalysis {
  public:
   // Performs post-dominator analysis on the function and returns the result.
   static absl::StatusOr<std::unique_ptr<PostDominatorAnalysis>> Run(
       FunctionBase* f);
 
-  // Returns the nodes that post-dominate this node.
-  absl::Span<Node* const> GetPostDominatorsOfNode(const Node* node) const {
-    return dominated_node_to_post_dominators_ordered_by_id_.at(node);
-  }
-  // Returns the nodes that are post-dominated by this node.
-  absl::Span<Node* const> GetNodesPostDominatedByNode(const Node* node) const {
-    return post_dominator_to_dominated_nodes_ordered_by_id_.at(node);
+  // Returns the immediate post-dominator of the node: the post-dominator
+  // nearest to it other than itself. Returns nullptr if the node has no
+  // users, or if its users reach different nodes without users.
+  Node* GetImmediatePostDominator(const Node* node) const {
+    return tree_.at(node).immediate_post_dominator;
   }
+
+  // Returns the nodes that post-dominate this node, ordered by id.
+  std::vector<Node*> GetPostDominatorsOfNode(const Node* node) const;
+  // Returns the nodes that are post-dominated by this node, ordered by id.
+  std::vector<Node*> GetNodesPostDominatedByNode(const Node* node) const;
+
   // Returns true if 'node' is post-dominated by 'post_dominator'.
   bool NodeIsPostDominatedBy(const Node* node,
                              const Node* post_dominator) const {
-    return dominated_node_to_post_dominators_.at(node).contains(post_dominator);
+    const TreeNode& n = tree_.at(node);
+    const TreeNode& d = tree_.at(post_dominator);
+    return d.preorder_begin <= n.preorder_begin &&
+           n.preorder_begin < d.preorder_end;
   }
   // Returns true if 'node' post_dominates 'post_dominated'.
   bool NodePostDominates(const Node* node, const Node* post_dominated) const {
-    return post_dominator_to_dominated_nodes_.at(node).contains(post_dominated);
+    return NodeIsPostDominatedBy(post_dominated, node);
   }
 
  private:
-  // Maps from a node to all nodes that post-dominate the node.
-  absl::flat_hash_map<Node*, absl::flat_hash_set<Node*>>
-      dominated_node_to_post_dominators_;
-  absl::flat_hash_map<Node*, std::vector<Node*>>
-      dominated_node_to_post_dominators_ordered_by_id_;
+  struct TreeNode {
+    Node* immediate_post_dominator = nullptr;
+    // Distance from the root of the node's tree.
+    int64_t depth = 0;
+    // The node's subtree, i.e., the nodes it post-dominates, occupies the
+    // range [preorder_begin, preorder_end) of preorder_.
+    int64_t preorder_begin = 0;
+    int64_t preorder_end = 0;
+  };
 
-  // Maps from a node to all nodes that are post-dominated by the node.
-  absl::flat_hash_map<Node*, absl::flat_hash_set<Node*>>
-      post_dominator_to_dominated_nodes_;
-  absl::flat_hash_map<Node*, std::vector<Node*>>
-      post_dominator_to_dominated_nodes_ordered_by_id_;
+  NodeMap<TreeNode> tree_;
+  std::vector<Node*> preorder_;
 };
 
 }  // namespace xls
@@ -14,6 +14,8 @@
 
 #include "xls/passes/post_dominator_analysis.h"
 
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
@@ -220,5 +222,55 @@ TEST_F(PostDominatorAnalysisTest, DisconnectedNode) {
               ElementsAre(x.node(), z.node()));
 }
 
+TEST_F(PostDominatorAnalysisTest, ImmediatePostDominators) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(1));
+  BValue a = fb.Not(x);
+  BValue b = fb.Not(x);
+  BValue and_op = fb.And(a, b);
+  BValue dangling = fb.Not(a);
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PostDominatorAnalysis> analysis,
+                           PostDominatorAnalysis::Run(f));
+
+  // 'a' reaches both 'and_op' and 'dangling', which have no users.
+  EXPECT_EQ(analysis->GetImmediatePostDominator(a.node()), nullptr);
+  EXPECT_EQ(analysis->GetImmediatePostDominator(x.node()), nullptr);
+  EXPECT_EQ(analysis->GetImmediatePostDominator(b.node()), and_op.node());
+  EXPECT_EQ(analysis->GetImmediatePostDominator(and_op.node()), nullptr);
+  EXPECT_EQ(analysis->GetImmediatePostDominator(dangling.node()), nullptr);
+}
+
+TEST_F(PostDominatorAnalysisTest, LongChainOfDiamonds) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(1));
+  std::vector<BValue> joins;
+  BValue value = x;
+  constexpr int64_t kDiamonds = 20000;
+  for (int64_t i = 0; i < kDiamonds; ++i) {
+    value = fb.And(fb.Not(value), fb.Not(value));
+    joins.push_back(value);
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<PostDominatorAnalysis> analysis,
+                           PostDominatorAnalysis::Run(f));
+
+  EXPECT_TRUE(analysis->NodeIsPostDominatedBy(x.node(), joins.back().node()));
+  EXPECT_TRUE(analysis->NodePostDominates(joins[kDiamonds / 2].node(),
+                                          joins[kDiamonds / 4].node()));
+  EXPECT_FALSE(analysis->NodePostDominates(joins[kDiamonds / 4].node(),
+                                           joins[kDiamonds / 2].node()));
+  EXPECT_EQ(analysis->GetImmediatePostDominator(x.node()), joins[0].node());
+  // Each join is post-dominated by itself and each later join.
+  EXPECT_EQ(analysis->GetPostDominatorsOfNode(joins.front().node()).size(),
+            kDiamonds);
+  EXPECT_EQ(analysis->GetNodesPostDominatedByNode(joins.back().node()).size(),
+            f->node_count());
+}
+
 }  // namespace
 }  // namespace xls
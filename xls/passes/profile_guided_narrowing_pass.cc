@@ -0,0 +1,165 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/profile_guided_narrowing_pass.h"
+
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+// Returns the number of most significant bits which are known in "bits".
+int64_t CountLeadingKnownBits(const TernaryVector& bits) {
+  int64_t count = 0;
+  for (auto it = bits.rbegin(); it != bits.rend() && ternary_ops::IsKnown(*it);
+       ++it) {
+    ++count;
+  }
+  return count;
+}
+
+// Returns true if "node" has already been guarded by an earlier run of the
+// pass, i.e., one of its users is the slice of its "known_count" leading bits.
+bool IsGuarded(Node* node, int64_t narrowed_width, int64_t known_count) {
+  return absl::c_any_of(node->users(), [&](Node* user) {
+    return user->Is<BitSlice>() &&
+           user->As<BitSlice>()->start() == narrowed_width &&
+           user->As<BitSlice>()->width() == known_count;
+  });
+}
+
+}  // namespace
+
+absl::StatusOr<bool> ProfileGuidedNarrowingPass::RunOnFunctionBaseInternal(
+    FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  // Replacing implicit uses of proc state isn't supported.
+  if (!f->IsFunction()) {
+    return false;
+  }
+  Function* function = f->AsFunctionOrDie();
+
+  // The nodes of the narrowed datapath which differ from those of the full
+  // one, by the node of the full datapath they stand for.
+  absl::flat_hash_map<Node*, Node*> narrowed;
+  auto get_narrowed = [&](Node* node) {
+    auto it = narrowed.find(node);
+    return it == narrowed.end() ? node : it->second;
+  };
+  // Conditions which all hold when the value of each narrowed node has the
+  // profiled leading bits.
+  std::vector<Node*> guards;
+
+  auto topo_sort = TopoSort(f);
+  std::vector<Node*> nodes(topo_sort.begin(), topo_sort.end());
+  for (Node* node : nodes) {
+    // A node which uses narrowed nodes is duplicated in the narrowed datapath.
+    // Effects aren't duplicated, so those stay in the full datapath only.
+    Node* narrowed_node = node;
+    auto is_narrowed = [&](Node* operand) {
+      return narrowed.contains(operand);
+    };
+    if (!node->Is<Assert>() && !node->GetType()->IsToken() &&
+        absl::c_any_of(node->operands(), is_narrowed)) {
+      std::vector<Node*> operands;
+      for (Node* operand : node->operands()) {
+        operands.push_back(get_narrowed(operand));
+      }
+      XLS_ASSIGN_OR_RETURN(narrowed_node, node->Clone(operands));
+      if (narrowed_node->HasAssignedName()) {
+        narrowed_node->ClearName();
+      }
+      narrowed[node] = narrowed_node;
+    }
+
+    if (!node->GetType()->IsBits() || node->Is<Literal>() ||
+        (node->users().empty() && node != function->return_value())) {
+      continue;
+    }
+    const NodeValueProfile* profile = profile_->Get(node);
+    if (profile == nullptr) {
+      continue;
+    }
+    int64_t bit_count = node->BitCountOrDie();
+    int64_t known_count = CountLeadingKnownBits(profile->known_bits);
+    int64_t narrowed_width = bit_count - known_count;
+    if (known_count == 0 || IsGuarded(node, narrowed_width, known_count)) {
+      continue;
+    }
+    XLS_VLOG(1) << absl::StreamFormat(
+        "Narrowing %s from %d to %d bits (observed range [%s, %s])",
+        node->GetName(), bit_count, narrowed_width,
+        profile->min.ToString(FormatPreference::kHex),
+        profile->max.ToString(FormatPreference::kHex));
+
+    // All observed values share their leading bits so those of any of them
+    // give the known value.
+    XLS_ASSIGN_OR_RETURN(
+        Node * known,
+        f->MakeNode<Literal>(node->loc(), Value(profile->max.Slice(
+                                              narrowed_width, known_count))));
+    XLS_ASSIGN_OR_RETURN(Node * leading_bits,
+                         f->MakeNode<BitSlice>(node->loc(), node,
+                                               /*start=*/narrowed_width,
+                                               known_count));
+    XLS_ASSIGN_OR_RETURN(Node * guard,
+                         f->MakeNode<CompareOp>(node->loc(), leading_bits,
+                                                known, Op::kEq));
+    guards.push_back(guard);
+
+    Node* replacement = known;
+    if (narrowed_width > 0) {
+      XLS_ASSIGN_OR_RETURN(Node * low_bits,
+                           f->MakeNode<BitSlice>(node->loc(), narrowed_node,
+                                                 /*start=*/0, narrowed_width));
+      XLS_ASSIGN_OR_RETURN(replacement,
+                           f->MakeNode<Concat>(node->loc(),
+                                               std::vector<Node*>{known,
+                                                                  low_bits}));
+    }
+    narrowed[node] = replacement;
+  }
+  if (guards.empty()) {
+    return false;
+  }
+
+  // The narrowed datapath computes the same value as the full one when all the
+  // guards hold, so the result is taken from it then.
+  Node* full_result = function->return_value();
+  Node* selector = guards.front();
+  if (guards.size() > 1) {
+    XLS_ASSIGN_OR_RETURN(selector, f->MakeNode<NaryOp>(full_result->loc(),
+                                                       guards, Op::kAnd));
+  }
+  XLS_ASSIGN_OR_RETURN(
+      Node * result,
+      f->MakeNode<Select>(full_result->loc(), selector,
+                          /*cases=*/
+                          std::vector<Node*>{full_result,
+                                             get_narrowed(full_result)},
+                          /*default_value=*/absl::nullopt));
+  XLS_RETURN_IF_ERROR(function->set_return_value(result));
+  return true;
+}
+
+}  // namespace xls
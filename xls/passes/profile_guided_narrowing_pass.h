@@ -0,0 +1,57 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
+#define XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
+
+#include "absl/status/statusor.h"
+#include "xls/interpreter/value_profile.h"
+#include "xls/ir/function.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+
+// A pass which speculatively narrows the nodes of functions according to the
+// values observed for them in a value profile. The function gets a second,
+// narrowed datapath, in which the leading bits of a node which had the same
+// value in every profiled evaluation are replaced by a literal, so that later
+// passes (e.g., narrowing) can shrink it.
+//
+// The speculation is guarded: the leading bits of each narrowed node are
+// compared with the profiled ones, and the result of the function is taken
+// from the narrowed datapath only if they all match, and from the full one
+// otherwise. So the function computes the same values on any input, though
+// it is larger than before the pass. The pass is not part of the standard
+// pipeline; it is intended for exploring which datapaths of a design are
+// wider than its workloads need.
+class ProfileGuidedNarrowingPass : public FunctionBasePass {
+ public:
+  explicit ProfileGuidedNarrowingPass(const ValueProfile* profile)
+      : FunctionBasePass("profile_narrow", "Profile-guided narrowing"),
+        profile_(profile) {}
+  ~ProfileGuidedNarrowingPass() override {}
+
+ protected:
+  absl::StatusOr<bool> RunOnFunctionBaseInternal(
+      FunctionBase* f, const PassOptions& options,
+      PassResults* results) const override;
+
+ private:
+  const ValueProfile* profile_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
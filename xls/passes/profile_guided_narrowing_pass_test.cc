@@ -0,0 +1,133 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/profile_guided_narrowing_pass.h"
+
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter_stats.h"
+#include "xls/interpreter/value_profile.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_matcher.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/passes/pass_base.h"
+
+namespace m = ::xls::op_matchers;
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class ProfileGuidedNarrowingPassTest : public IrTestBase {
+ protected:
+  absl::StatusOr<bool> Run(Package* p, const ValueProfile& profile) {
+    PassResults results;
+    return ProfileGuidedNarrowingPass(&profile).Run(p, PassOptions(),
+                                                    &results);
+  }
+};
+
+TEST_F(ProfileGuidedNarrowingPassTest, NarrowsProfiledNode) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(16));
+  BValue y = fb.Param("y", p->GetBitsType(16));
+  BValue sum = fb.Add(x, y);
+  fb.UMul(sum, y);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // Profile the function on small values: the sum never exceeds 8 bits.
+  InterpreterStats stats;
+  for (int64_t i = 0; i < 100; ++i) {
+    XLS_ASSERT_OK(IrInterpreter::Run(f,
+                                     {Value(UBits(i, 16)),
+                                      Value(UBits(100 - i, 16))},
+                                     &stats)
+                      .status());
+  }
+  ValueProfile profile = stats.ToValueProfile();
+  const NodeValueProfile* sum_profile = profile.Get(sum.node());
+  ASSERT_NE(sum_profile, nullptr);
+  EXPECT_EQ(sum_profile->ObservedBitCount(), 7);
+
+  ASSERT_THAT(Run(p.get(), profile), IsOkAndHolds(true));
+  // The sum is always 100 so all of its bits are known; the product's leading
+  // zeros are known as well. The narrowed datapath is used if they are.
+  EXPECT_THAT(
+      f->return_value(),
+      m::Select(
+          m::And(m::Eq(m::BitSlice(m::Add(), /*start=*/0, /*width=*/16),
+                       m::Literal(UBits(100, 16))),
+                 m::Eq(m::BitSlice(m::UMul(), /*start=*/14, /*width=*/2),
+                       m::Literal())),
+          /*cases=*/{m::UMul(m::Add(), m::Param("y")),
+                     m::Concat(m::Literal(),
+                               m::BitSlice(m::UMul(m::Literal(UBits(100, 16)),
+                                                   m::Param("y")),
+                                           /*start=*/0, /*width=*/14))}));
+
+  // The function computes the same values inside and outside the profile.
+  for (auto [x, y] : std::vector<std::pair<int64_t, int64_t>>{
+           {40, 60}, {1000, 7}, {3, 97}, {0xffff, 0xffff}}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        Value result,
+        IrInterpreter::Run(f, {Value(UBits(x, 16)), Value(UBits(y, 16))}));
+    EXPECT_EQ(result, Value(UBits(((x + y) * y) & 0xffff, 16)))
+        << x << " " << y;
+  }
+
+  // The result of the pass is stable.
+  ASSERT_THAT(Run(p.get(), profile), IsOkAndHolds(false));
+}
+
+TEST_F(ProfileGuidedNarrowingPassTest, KeepsUnknownLowBits) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Add(fb.Param("x", p->GetBitsType(8)), fb.Param("y", p->GetBitsType(8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      ValueProfile profile,
+      ValueProfile::Parse(absl::StrFormat("%s %s 0b10X0XXXX 0x80 0xaf\n",
+                                          f->name(),
+                                          f->return_value()->GetName())));
+  ASSERT_THAT(Run(p.get(), profile), IsOkAndHolds(true));
+  EXPECT_THAT(
+      f->return_value(),
+      m::Select(m::Eq(m::BitSlice(m::Add(), /*start=*/6, /*width=*/2),
+                      m::Literal(UBits(0b10, 2))),
+                /*cases=*/{m::Add(),
+                           m::Concat(m::Literal(UBits(0b10, 2)),
+                                     m::BitSlice(m::Add(), /*start=*/0,
+                                                 /*width=*/6))}));
+}
+
+TEST_F(ProfileGuidedNarrowingPassTest, IgnoresUnprofiledNodes) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Add(fb.Param("x", p->GetBitsType(8)), fb.Param("y", p->GetBitsType(8)));
+  XLS_ASSERT_OK(fb.Build().status());
+  ASSERT_THAT(Run(p.get(), ValueProfile()), IsOkAndHolds(false));
+}
+
+}  // namespace
+}  // namespace xls
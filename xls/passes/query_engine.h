@@ -120,11 +120,13 @@ class QueryEngine {
   // Returns whether *all* the bits are known for "node".
   bool AllBitsKnown(Node* node) const;
 
-  // Returns the maximum unsigned value that the node can be.
-  Bits MaxUnsignedValue(Node* node) const;
+  // Returns the maximum unsigned value that the node can be. By default this is
+  // derived from the known bits of the node.
+  virtual Bits MaxUnsignedValue(Node* node) const;
 
-  // Returns the minimum unsigned value that the node can be.
-  Bits MinUnsignedValue(Node* node) const;
+  // Returns the minimum unsigned value that the node can be. By default this is
+  // derived from the known bits of the node.
+  virtual Bits MinUnsignedValue(Node* node) const;
 
   // Returns true if the values of the two nodes are known to be equal when
   // interpreted as unsigned numbers. The nodes can be of different widths.
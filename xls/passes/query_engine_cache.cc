@@ -0,0 +1,190 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/query_engine_cache.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/function.h"
+#include "xls/ir/proc.h"
+
+namespace xls {
+
+void QueryEngineCache::AddFunction(FunctionBase* f) {
+  Package* p = f->package();
+  packages_[f->uid()] = p;
+  absl::flat_hash_set<int64_t> live;
+  for (const std::unique_ptr<Function>& function : p->functions()) {
+    live.insert(function->uid());
+  }
+  for (const std::unique_ptr<Proc>& proc : p->procs()) {
+    live.insert(proc->uid());
+  }
+  for (auto it = packages_.begin(); it != packages_.end();) {
+    if (it->second != p || live.contains(it->first)) {
+      ++it;
+      continue;
+    }
+    int64_t uid = it->first;
+    ternary_engines_.erase(uid);
+    range_engines_.erase(uid);
+    absl::erase_if(bdd_engines_, [uid](const auto& entry) {
+      return std::get<0>(entry.first) == uid;
+    });
+    packages_.erase(it++);
+  }
+}
+
+absl::StatusOr<TernaryQueryEngine*> QueryEngineCache::GetTernaryQueryEngine(
+    FunctionBase* f) {
+  TernaryQueryEngine* engine = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = ternary_engines_.find(f->uid());
+    if (it != ternary_engines_.end()) {
+      engine = it->second.get();
+    }
+  }
+  // The engine of a function is only used by the pass currently running on
+  // that function, so it can be updated outside of the lock.
+  if (engine != nullptr) {
+    XLS_RETURN_IF_ERROR(engine->Update());
+    return engine;
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> new_engine,
+                       TernaryQueryEngine::Run(f));
+  engine = new_engine.get();
+  absl::MutexLock lock(&mutex_);
+  AddFunction(f);
+  ternary_engines_[f->uid()] = std::move(new_engine);
+  return engine;
+}
+
+absl::StatusOr<RangeQueryEngine*> QueryEngineCache::GetRangeQueryEngine(
+    FunctionBase* f) {
+  RangeQueryEngine* engine = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = range_engines_.find(f->uid());
+    if (it != range_engines_.end()) {
+      engine = it->second.get();
+    }
+  }
+  if (engine != nullptr) {
+    XLS_RETURN_IF_ERROR(engine->Update());
+    return engine;
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<RangeQueryEngine> new_engine,
+                       RangeQueryEngine::Run(f));
+  engine = new_engine.get();
+  absl::MutexLock lock(&mutex_);
+  AddFunction(f);
+  range_engines_[f->uid()] = std::move(new_engine);
+  return engine;
+}
+
+absl::StatusOr<BddQueryEngine*> QueryEngineCache::GetBddQueryEngine(
+    FunctionBase* f, int64_t minterm_limit,
+    absl::Span<const Op> do_not_evaluate_ops) {
+  BddKey key(f->uid(), minterm_limit,
+             std::vector<Op>(do_not_evaluate_ops.begin(),
+                             do_not_evaluate_ops.end()));
+  BddQueryEngine* engine = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = bdd_engines_.find(key);
+    if (it != bdd_engines_.end()) {
+      engine = it->second.get();
+    }
+  }
+  if (engine != nullptr) {
+    XLS_RETURN_IF_ERROR(engine->Update());
+    return engine;
+  }
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<BddQueryEngine> new_engine,
+      BddQueryEngine::Run(f, minterm_limit, do_not_evaluate_ops));
+  engine = new_engine.get();
+  absl::MutexLock lock(&mutex_);
+  AddFunction(f);
+  bdd_engines_[key] = std::move(new_engine);
+  return engine;
+}
+
+void QueryEngineCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  ternary_engines_.clear();
+  range_engines_.clear();
+  bdd_engines_.clear();
+  packages_.clear();
+}
+
+int64_t QueryEngineCache::engine_count() {
+  absl::MutexLock lock(&mutex_);
+  return ternary_engines_.size() + range_engines_.size() + bdd_engines_.size();
+}
+
+absl::StatusOr<TernaryQueryEngine*> GetTernaryQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<TernaryQueryEngine>* storage) {
+  if (options.query_engine_cache != nullptr) {
+    return options.query_engine_cache->GetTernaryQueryEngine(f);
+  }
+  XLS_ASSIGN_OR_RETURN(*storage, TernaryQueryEngine::Run(f));
+  return storage->get();
+}
+
+absl::StatusOr<RangeQueryEngine*> GetRangeQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<RangeQueryEngine>* storage) {
+  if (options.query_engine_cache != nullptr) {
+    return options.query_engine_cache->GetRangeQueryEngine(f);
+  }
+  XLS_ASSIGN_OR_RETURN(*storage, RangeQueryEngine::Run(f));
+  return storage->get();
+}
+
+absl::StatusOr<BddQueryEngine*> GetBddQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<BddQueryEngine>* storage, int64_t minterm_limit,
+    absl::Span<const Op> do_not_evaluate_ops) {
+  if (options.query_engine_cache != nullptr) {
+    return options.query_engine_cache->GetBddQueryEngine(f, minterm_limit,
+                                                         do_not_evaluate_ops);
+  }
+  XLS_ASSIGN_OR_RETURN(
+      *storage, BddQueryEngine::Run(f, minterm_limit, do_not_evaluate_ops));
+  return storage->get();
+}
+
+absl::StatusOr<QueryEngine*> GetBddBasedQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<QueryEngine>* storage, int64_t minterm_limit,
+    absl::Span<const Op> do_not_evaluate_ops) {
+  if (options.bdd_parallelism > 1) {
+    XLS_ASSIGN_OR_RETURN(
+        *storage,
+        PartitionedBddQueryEngine::Run(f, options.bdd_parallelism,
+                                       minterm_limit, do_not_evaluate_ops));
+    return storage->get();
+  }
+  std::unique_ptr<BddQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(BddQueryEngine * engine,
+                       GetBddQueryEngine(f, options, &owned_engine,
+                                         minterm_limit, do_not_evaluate_ops));
+  *storage = std::move(owned_engine);
+  return engine;
+}
+
+}  // namespace xls
@@ -0,0 +1,111 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_QUERY_ENGINE_CACHE_H_
+#define XLS_PASSES_QUERY_ENGINE_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/op.h"
+#include "xls/ir/package.h"
+#include "xls/passes/bdd_query_engine.h"
+#include "xls/passes/partitioned_bdd_query_engine.h"
+#include "xls/passes/pass_base.h"
+#include "xls/passes/query_engine.h"
+#include "xls/passes/range_query_engine.h"
+#include "xls/passes/ternary_query_engine.h"
+
+namespace xls {
+
+// Holds query engines across passes so that a pass pipeline analyzes each
+// function once rather than once per pass (and per pass iteration). When an
+// engine is requested it is brought up to date with the changes made to the
+// function since it was last requested; only the fan-out cone of modified
+// nodes is re-evaluated. Engines are keyed by FunctionBase::uid, so engines of
+// removed functions are never handed out for new functions; they are dropped
+// when the next engine of a function in the same package is built.
+//
+// An engine returned by the cache remains valid until the next request for an
+// engine of the same function and configuration, which updates it in place.
+// Requests for different functions may be made concurrently.
+class QueryEngineCache {
+ public:
+  absl::StatusOr<TernaryQueryEngine*> GetTernaryQueryEngine(FunctionBase* f);
+  absl::StatusOr<RangeQueryEngine*> GetRangeQueryEngine(FunctionBase* f);
+
+  // See BddQueryEngine::Run for the meaning of the arguments. Each distinct
+  // configuration has its own engine.
+  absl::StatusOr<BddQueryEngine*> GetBddQueryEngine(
+      FunctionBase* f, int64_t minterm_limit = 0,
+      absl::Span<const Op> do_not_evaluate_ops = {});
+
+  // Drops all cached engines.
+  void Clear();
+
+  // Returns the number of cached engines.
+  int64_t engine_count();
+
+ private:
+  using BddKey = std::tuple<int64_t, int64_t, std::vector<Op>>;
+
+  // Records that an engine of 'f' is cached and drops the engines of the
+  // functions of f's package which are no longer in it.
+  void AddFunction(FunctionBase* f) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::Mutex mutex_;
+  // The package of each function with cached engines, by uid.
+  absl::flat_hash_map<int64_t, Package*> packages_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<int64_t, std::unique_ptr<TernaryQueryEngine>>
+      ternary_engines_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<int64_t, std::unique_ptr<RangeQueryEngine>>
+      range_engines_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<BddKey, std::unique_ptr<BddQueryEngine>> bdd_engines_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns a query engine for the given function for use by a pass. If
+// 'options' holds a QueryEngineCache the engine comes from the cache;
+// otherwise a new engine is built and its ownership is passed to '*storage'.
+absl::StatusOr<TernaryQueryEngine*> GetTernaryQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<TernaryQueryEngine>* storage);
+absl::StatusOr<RangeQueryEngine*> GetRangeQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<RangeQueryEngine>* storage);
+absl::StatusOr<BddQueryEngine*> GetBddQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<BddQueryEngine>* storage, int64_t minterm_limit = 0,
+    absl::Span<const Op> do_not_evaluate_ops = {});
+
+// Returns a BDD-based query engine for use by a pass. If
+// options.bdd_parallelism is greater than one this is a
+// PartitionedBddQueryEngine, which is never cached; otherwise it is the engine
+// returned by GetBddQueryEngine. If the engine is not cached its ownership is
+// passed to '*storage'.
+absl::StatusOr<QueryEngine*> GetBddBasedQueryEngine(
+    FunctionBase* f, const PassOptions& options,
+    std::unique_ptr<QueryEngine>* storage, int64_t minterm_limit = 0,
+    absl::Span<const Op> do_not_evaluate_ops = {});
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_QUERY_ENGINE_CACHE_H_
@@ -0,0 +1,111 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/query_engine_cache.h"
+
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+#include "xls/passes/pass_base.h"
+
+namespace xls {
+namespace {
+
+class QueryEngineCacheTest : public IrTestBase {};
+
+TEST_F(QueryEngineCacheTest, EnginesPersistAndUpdate) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(4));
+  BValue y = fb.And(x, fb.Literal(UBits(0b0011, 4)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(y));
+
+  QueryEngineCache cache;
+  XLS_ASSERT_OK_AND_ASSIGN(TernaryQueryEngine * ternary,
+                           cache.GetTernaryQueryEngine(f));
+  XLS_ASSERT_OK_AND_ASSIGN(BddQueryEngine * bdd, cache.GetBddQueryEngine(f));
+  EXPECT_EQ(ternary->ToString(y.node()), "0b00XX");
+  EXPECT_EQ(bdd->ToString(y.node()), "0b00XX");
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * zero, f->MakeNode<Literal>(absl::nullopt, Value(UBits(0, 4))));
+  XLS_ASSERT_OK(y.node()->ReplaceOperandNumber(1, zero));
+
+  // The same engines are returned, brought up to date.
+  EXPECT_THAT(cache.GetTernaryQueryEngine(f),
+              status_testing::IsOkAndHolds(ternary));
+  EXPECT_THAT(cache.GetBddQueryEngine(f),
+              status_testing::IsOkAndHolds(bdd));
+  EXPECT_EQ(ternary->ToString(y.node()), "0b0000");
+  EXPECT_EQ(bdd->ToString(y.node()), "0b0000");
+
+  // Other configurations get their own engines.
+  XLS_ASSERT_OK_AND_ASSIGN(BddQueryEngine * bdd_and_as_variable,
+                           cache.GetBddQueryEngine(f, /*minterm_limit=*/0,
+                                                   {Op::kAnd}));
+  EXPECT_NE(bdd_and_as_variable, bdd);
+  EXPECT_EQ(bdd_and_as_variable->ToString(y.node()), "0bXXXX");
+}
+
+TEST_F(QueryEngineCacheTest, EnginesOfRemovedFunctionsAreDropped) {
+  auto p = CreatePackage();
+  FunctionBuilder fb_dead("dead", p.get());
+  fb_dead.Param("x", p->GetBitsType(4));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * dead, fb_dead.Build());
+  FunctionBuilder fb_live("live", p.get());
+  fb_live.Param("x", p->GetBitsType(4));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * live, fb_live.Build());
+
+  QueryEngineCache cache;
+  XLS_ASSERT_OK(cache.GetTernaryQueryEngine(dead).status());
+  XLS_ASSERT_OK(cache.GetBddQueryEngine(dead).status());
+  EXPECT_EQ(cache.engine_count(), 2);
+
+  p->DeleteDeadFunctions({dead});
+  XLS_ASSERT_OK(cache.GetTernaryQueryEngine(live).status());
+  EXPECT_EQ(cache.engine_count(), 1);
+}
+
+TEST_F(QueryEngineCacheTest, WithoutCacheInOptions) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Param("x", p->GetBitsType(4));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  std::unique_ptr<TernaryQueryEngine> storage;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      TernaryQueryEngine * engine,
+      GetTernaryQueryEngine(f, PassOptions(), &storage));
+  EXPECT_EQ(engine, storage.get());
+
+  QueryEngineCache cache;
+  PassOptions options;
+  options.query_engine_cache = &cache;
+  std::unique_ptr<TernaryQueryEngine> unused_storage;
+  XLS_ASSERT_OK_AND_ASSIGN(engine,
+                           GetTernaryQueryEngine(f, options, &unused_storage));
+  EXPECT_EQ(unused_storage, nullptr);
+  EXPECT_THAT(cache.GetTernaryQueryEngine(f),
+              status_testing::IsOkAndHolds(engine));
+}
+
+}  // namespace
+}  // namespace xls
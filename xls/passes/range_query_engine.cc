@@ -0,0 +1,353 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/range_query_engine.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/bits_ops.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+namespace {
+
+// An inclusive interval of unsigned values.
+struct Interval {
+  Bits low;
+  Bits high;
+};
+
+const Bits& UMin(const Bits& a, const Bits& b) {
+  return bits_ops::ULessThan(a, b) ? a : b;
+}
+
+const Bits& UMax(const Bits& a, const Bits& b) {
+  return bits_ops::UGreaterThan(a, b) ? a : b;
+}
+
+// Zero-extends or truncates 'bits' to 'width' bits.
+Bits Resize(const Bits& bits, int64_t width) {
+  return bits.bit_count() >= width ? bits.Slice(0, width)
+                                   : bits_ops::ZeroExtend(bits, width);
+}
+
+// Returns the value of 'bits' clamped to 'limit'.
+int64_t ClampedValue(const Bits& bits, int64_t limit) {
+  return bits_ops::UGreaterThanOrEqual(bits, limit)
+             ? limit
+             : static_cast<int64_t>(bits.ToUint64().value());
+}
+
+Interval Singleton(bool value) {
+  return Interval{UBits(value, 1), UBits(value, 1)};
+}
+
+// Returns an interval containing every value 'node' can take given the
+// intervals of its operands, or nullopt if the operation is not modeled or
+// the interval would be no tighter than the full range.
+absl::optional<Interval> EvaluateInterval(
+    Node* node, absl::Span<const Interval> operands) {
+  int64_t width = node->BitCountOrDie();
+  switch (node->op()) {
+    case Op::kAdd: {
+      Bits high = bits_ops::Add(Resize(operands[0].high, width + 1),
+                                Resize(operands[1].high, width + 1));
+      if (!high.FitsInNBitsUnsigned(width)) {
+        return absl::nullopt;
+      }
+      return Interval{bits_ops::Add(operands[0].low, operands[1].low),
+                      high.Slice(0, width)};
+    }
+    case Op::kSub:
+      if (bits_ops::ULessThan(operands[0].low, operands[1].high)) {
+        return absl::nullopt;
+      }
+      return Interval{bits_ops::Sub(operands[0].low, operands[1].high),
+                      bits_ops::Sub(operands[0].high, operands[1].low)};
+    case Op::kUMul: {
+      Bits high = bits_ops::UMul(operands[0].high, operands[1].high);
+      if (!high.FitsInNBitsUnsigned(width)) {
+        return absl::nullopt;
+      }
+      return Interval{
+          Resize(bits_ops::UMul(operands[0].low, operands[1].low), width),
+          Resize(high, width)};
+    }
+    case Op::kUDiv:
+      // Division by zero produces all ones.
+      if (operands[1].low.IsZero()) {
+        return absl::nullopt;
+      }
+      return Interval{bits_ops::UDiv(operands[0].low, operands[1].high),
+                      bits_ops::UDiv(operands[0].high, operands[1].low)};
+    case Op::kUMod: {
+      // Modulus by zero produces zero.
+      Bits zero(width);
+      if (operands[1].high.IsZero()) {
+        return Interval{zero, zero};
+      }
+      return Interval{zero,
+                      UMin(operands[0].high,
+                           bits_ops::Sub(operands[1].high, UBits(1, width)))};
+    }
+    case Op::kZeroExt:
+      return Interval{bits_ops::ZeroExtend(operands[0].low, width),
+                      bits_ops::ZeroExtend(operands[0].high, width)};
+    case Op::kConcat: {
+      // Concatenation is monotonic in each operand.
+      std::vector<Bits> lows;
+      std::vector<Bits> highs;
+      for (const Interval& operand : operands) {
+        lows.push_back(operand.low);
+        highs.push_back(operand.high);
+      }
+      return Interval{bits_ops::Concat(lows), bits_ops::Concat(highs)};
+    }
+    case Op::kBitSlice: {
+      int64_t start = node->As<BitSlice>()->start();
+      Bits high = bits_ops::ShiftRightLogical(operands[0].high, start);
+      if (!high.FitsInNBitsUnsigned(width)) {
+        return absl::nullopt;
+      }
+      return Interval{
+          bits_ops::ShiftRightLogical(operands[0].low, start).Slice(0, width),
+          high.Slice(0, width)};
+    }
+    case Op::kShrl: {
+      int64_t min_amount = ClampedValue(operands[1].low, width);
+      int64_t max_amount = ClampedValue(operands[1].high, width);
+      return Interval{
+          bits_ops::ShiftRightLogical(operands[0].low, max_amount),
+          bits_ops::ShiftRightLogical(operands[0].high, min_amount)};
+    }
+    case Op::kShll: {
+      int64_t min_amount = ClampedValue(operands[1].low, width);
+      int64_t max_amount = ClampedValue(operands[1].high, width);
+      if (max_amount == width ||
+          operands[0].high.CountLeadingZeros() < max_amount) {
+        return absl::nullopt;
+      }
+      return Interval{
+          bits_ops::ShiftLeftLogical(operands[0].low, min_amount),
+          bits_ops::ShiftLeftLogical(operands[0].high, max_amount)};
+    }
+    case Op::kAnd: {
+      Bits high = operands[0].high;
+      for (const Interval& operand : operands) {
+        high = UMin(high, operand.high);
+      }
+      return Interval{Bits(width), high};
+    }
+    case Op::kOr: {
+      Bits low = operands[0].low;
+      for (const Interval& operand : operands) {
+        low = UMax(low, operand.low);
+      }
+      return Interval{low, Bits::AllOnes(width)};
+    }
+    case Op::kSel: {
+      // The union of the intervals of the cases the selector can choose.
+      Select* select = node->As<Select>();
+      const Interval& selector = operands[0];
+      absl::optional<Interval> result;
+      auto add_case = [&](const Interval& value) {
+        if (!result.has_value()) {
+          result = value;
+          return;
+        }
+        result->low = UMin(result->low, value.low);
+        result->high = UMax(result->high, value.high);
+      };
+      int64_t case_count = select->cases().size();
+      for (int64_t i = 0; i < case_count; ++i) {
+        if (bits_ops::ULessThanOrEqual(selector.low, i) &&
+            bits_ops::UGreaterThanOrEqual(selector.high, i)) {
+          add_case(operands[i + 1]);
+        }
+      }
+      if (select->default_value().has_value() &&
+          bits_ops::UGreaterThanOrEqual(selector.high, case_count)) {
+        add_case(operands.back());
+      }
+      return result;
+    }
+    case Op::kULt:
+    case Op::kUGt: {
+      const Interval& lhs = operands[node->op() == Op::kULt ? 0 : 1];
+      const Interval& rhs = operands[node->op() == Op::kULt ? 1 : 0];
+      if (bits_ops::ULessThan(lhs.high, rhs.low)) {
+        return Singleton(true);
+      }
+      if (bits_ops::UGreaterThanOrEqual(lhs.low, rhs.high)) {
+        return Singleton(false);
+      }
+      return absl::nullopt;
+    }
+    case Op::kULe:
+    case Op::kUGe: {
+      const Interval& lhs = operands[node->op() == Op::kULe ? 0 : 1];
+      const Interval& rhs = operands[node->op() == Op::kULe ? 1 : 0];
+      if (bits_ops::ULessThanOrEqual(lhs.high, rhs.low)) {
+        return Singleton(true);
+      }
+      if (bits_ops::UGreaterThan(lhs.low, rhs.high)) {
+        return Singleton(false);
+      }
+      return absl::nullopt;
+    }
+    case Op::kEq:
+    case Op::kNe:
+      if (bits_ops::ULessThan(operands[0].high, operands[1].low) ||
+          bits_ops::ULessThan(operands[1].high, operands[0].low)) {
+        return Singleton(node->op() == Op::kNe);
+      }
+      return absl::nullopt;
+    default:
+      return absl::nullopt;
+  }
+}
+
+}  // namespace
+
+/* static */
+absl::StatusOr<std::unique_ptr<RangeQueryEngine>> RangeQueryEngine::Run(
+    FunctionBase* f) {
+  auto engine = absl::make_unique<RangeQueryEngine>();
+  XLS_ASSIGN_OR_RETURN(engine->ternary_, TernaryQueryEngine::Run(f));
+  XLS_RETURN_IF_ERROR(engine->Update());
+  return std::move(engine);
+}
+
+RangeQueryEngine::NodeInfo RangeQueryEngine::Evaluate(Node* node) const {
+  NodeInfo info;
+  info.ternary_known = ternary_->GetKnownBits(node);
+  info.ternary_values = ternary_->GetKnownBitsValues(node);
+  // The bounds implied by the known bits.
+  info.low = info.ternary_values;
+  info.high = bits_ops::Or(info.ternary_values,
+                           bits_ops::Not(info.ternary_known));
+
+  int64_t width = node->BitCountOrDie();
+  bool operands_tracked =
+      width > 0 &&
+      std::all_of(node->operands().begin(), node->operands().end(),
+                  [&](Node* o) { return info_.contains(o); });
+  if (operands_tracked) {
+    std::vector<Interval> operands;
+    for (Node* operand : node->operands()) {
+      const NodeInfo& operand_info = info_.at(operand);
+      operands.push_back(Interval{operand_info.low, operand_info.high});
+    }
+    absl::optional<Interval> interval = EvaluateInterval(node, operands);
+    // Both sets of bounds are sound so their intersection is not empty.
+    if (interval.has_value()) {
+      info.low = UMax(info.low, interval->low);
+      info.high = UMin(info.high, interval->high);
+    }
+  }
+
+  // The bits above the most significant bit in which the bounds differ are
+  // the same for every value in the interval.
+  int64_t common_prefix =
+      width == 0 ? 0
+                 : bits_ops::Xor(info.low, info.high).CountLeadingZeros();
+  Bits prefix_mask = bits_ops::Concat(
+      {Bits::AllOnes(common_prefix), Bits(width - common_prefix)});
+  info.known = bits_ops::Or(info.ternary_known, prefix_mask);
+  info.known_values = bits_ops::Or(info.ternary_values,
+                                   bits_ops::And(info.low, prefix_mask));
+  return info;
+}
+
+absl::Status RangeQueryEngine::Update() {
+  XLS_RETURN_IF_ERROR(ternary_->Update());
+  // Nodes whose information changed in this update. Users of these nodes must
+  // be re-evaluated even if they were not themselves modified.
+  absl::flat_hash_set<Node*> changed;
+  absl::flat_hash_set<Node*> live;
+  for (Node* node : TopoSort(function())) {
+    if (!node->GetType()->IsBits()) {
+      continue;
+    }
+    live.insert(node);
+    auto it = info_.find(node);
+    if (it != info_.end() && node->change_count() <= change_count_ &&
+        it->second.ternary_known == ternary_->GetKnownBits(node) &&
+        it->second.ternary_values == ternary_->GetKnownBitsValues(node) &&
+        std::none_of(node->operands().begin(), node->operands().end(),
+                     [&](Node* o) { return changed.contains(o); })) {
+      continue;
+    }
+    NodeInfo info = Evaluate(node);
+    if (it != info_.end() && it->second == info) {
+      it->second = std::move(info);
+      continue;
+    }
+    changed.insert(node);
+    info_[node] = std::move(info);
+  }
+
+  // Drop the entries of nodes which have been removed from the function.
+  if (live.size() != info_.size()) {
+    for (auto it = info_.begin(); it != info_.end();) {
+      if (live.contains(it->first)) {
+        ++it;
+        continue;
+      }
+      info_.erase(it++);
+    }
+  }
+  change_count_ = function()->change_count();
+  return absl::OkStatus();
+}
+
+bool RangeQueryEngine::AtMostOneTrue(
+    absl::Span<BitLocation const> bits) const {
+  int64_t maybe_one_count = 0;
+  for (const BitLocation& location : bits) {
+    if (!IsKnown(location) || IsOne(location)) {
+      maybe_one_count++;
+    }
+  }
+  return maybe_one_count <= 1;
+}
+
+bool RangeQueryEngine::AtLeastOneTrue(
+    absl::Span<BitLocation const> bits) const {
+  for (const BitLocation& location : bits) {
+    if (IsOne(location)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RangeQueryEngine::KnownEquals(const BitLocation& a,
+                                   const BitLocation& b) const {
+  return IsKnown(a) && IsKnown(b) && IsOne(a) == IsOne(b);
+}
+
+bool RangeQueryEngine::KnownNotEquals(const BitLocation& a,
+                                      const BitLocation& b) const {
+  return IsKnown(a) && IsKnown(b) && IsOne(a) != IsOne(b);
+}
+
+}  // namespace xls
@@ -0,0 +1,121 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_PASSES_RANGE_QUERY_ENGINE_H_
+#define XLS_PASSES_RANGE_QUERY_ENGINE_H_
+
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/node.h"
+#include "xls/passes/query_engine.h"
+#include "xls/passes/ternary_query_engine.h"
+
+namespace xls {
+
+// A query engine which tracks an interval of possible unsigned values for each
+// bits-typed node, in addition to the known bits computed by ternary
+// evaluation. Intervals are propagated forward through arithmetic, shifts,
+// extensions, slices, concats and selects, so values whose bits are unknown
+// but whose magnitude is bounded (e.g., a counter compared against a limit or
+// the sum of two narrow values) still have known leading zeros, and
+// comparisons between values with disjoint intervals have known results.
+//
+// The known bits reported by the engine are the union of the ternary known
+// bits and the bits common to both ends of the interval.
+class RangeQueryEngine : public QueryEngine {
+ public:
+  static absl::StatusOr<std::unique_ptr<RangeQueryEngine>> Run(
+      FunctionBase* f);
+
+  // Brings the engine up to date with changes made to the function since it
+  // was run or last updated. Only nodes which changed, or whose operands'
+  // information changed, are re-evaluated.
+  absl::Status Update();
+
+  FunctionBase* function() const { return ternary_->function(); }
+
+  bool IsTracked(Node* node) const override { return info_.contains(node); }
+
+  const Bits& GetKnownBits(Node* node) const override {
+    return info_.at(node).known;
+  }
+  const Bits& GetKnownBitsValues(Node* node) const override {
+    return info_.at(node).known_values;
+  }
+
+  // The bounds of the interval of 'node'.
+  Bits MaxUnsignedValue(Node* node) const override {
+    return info_.at(node).high;
+  }
+  Bits MinUnsignedValue(Node* node) const override {
+    return info_.at(node).low;
+  }
+
+  bool AtMostOneTrue(absl::Span<BitLocation const> bits) const override;
+  bool AtLeastOneTrue(absl::Span<BitLocation const> bits) const override;
+  bool KnownEquals(const BitLocation& a, const BitLocation& b) const override;
+  bool KnownNotEquals(const BitLocation& a,
+                      const BitLocation& b) const override;
+
+  // Intervals provide no information about bit implications.
+  bool Implies(const BitLocation& a, const BitLocation& b) const override {
+    return false;
+  }
+  absl::optional<Bits> ImpliedNodeValue(
+      absl::Span<const std::pair<BitLocation, bool>> predicate_bit_values,
+      Node* node) const override {
+    return absl::nullopt;
+  }
+
+ private:
+  struct NodeInfo {
+    // The node's value lies in the unsigned interval [low, high].
+    Bits low;
+    Bits high;
+
+    // The known bits of the node combining ternary and interval information.
+    Bits known;
+    Bits known_values;
+
+    // The ternary information the entry was computed from.
+    Bits ternary_known;
+    Bits ternary_values;
+
+    bool operator==(const NodeInfo& other) const {
+      return low == other.low && high == other.high && known == other.known &&
+             known_values == other.known_values;
+    }
+  };
+
+  // Computes the information of 'node' from its ternary value and the
+  // intervals of its operands, which must be up to date.
+  NodeInfo Evaluate(Node* node) const;
+
+  std::unique_ptr<TernaryQueryEngine> ternary_;
+
+  // The change count of the function when it was last evaluated.
+  int64_t change_count_ = -1;
+
+  absl::flat_hash_map<Node*, NodeInfo> info_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_RANGE_QUERY_ENGINE_H_
@@ -0,0 +1,150 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/range_query_engine.h"
+
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/op.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+class RangeQueryEngineTest : public IrTestBase {};
+
+TEST_F(RangeQueryEngineTest, BoundedArithmetic) {
+  // Ternary evaluation knows no bits of a remainder, but its interval is
+  // bounded by the divisor.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue ten = fb.Literal(UBits(10, 16));
+  BValue x = fb.AddBinOp(Op::kUMod, fb.Param("x", p->GetBitsType(16)), ten);
+  BValue y = fb.AddBinOp(Op::kUMod, fb.Param("y", p->GetBitsType(16)), ten);
+  BValue sum = fb.Add(x, y);
+  BValue product = fb.UMul(x, y);
+  BValue quotient = fb.UDiv(fb.Param("z", p->GetBitsType(16)), ten);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_EQ(engine->MaxUnsignedValue(x.node()), UBits(9, 16));
+  EXPECT_EQ(engine->ToString(x.node()), "0b0000_0000_0000_XXXX");
+  EXPECT_EQ(engine->MinUnsignedValue(sum.node()), UBits(0, 16));
+  EXPECT_EQ(engine->MaxUnsignedValue(sum.node()), UBits(18, 16));
+  EXPECT_EQ(engine->ToString(sum.node()), "0b0000_0000_000X_XXXX");
+  EXPECT_EQ(engine->MaxUnsignedValue(product.node()), UBits(81, 16));
+  EXPECT_EQ(engine->MaxUnsignedValue(quotient.node()), UBits(6553, 16));
+}
+
+TEST_F(RangeQueryEngineTest, OverflowingAdd) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.ZeroExtend(fb.Param("x", p->GetBitsType(4)), 5);
+  BValue sum = fb.Add(x, fb.Literal(UBits(17, 5)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_EQ(engine->MaxUnsignedValue(sum.node()), UBits(31, 5));
+  EXPECT_FALSE(engine->IsMsbKnown(sum.node()));
+}
+
+TEST_F(RangeQueryEngineTest, Comparisons) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.ZeroExtend(fb.Param("x", p->GetBitsType(3)), 8);
+  BValue y = fb.Add(fb.ZeroExtend(fb.Param("y", p->GetBitsType(3)), 8),
+                    fb.Literal(UBits(8, 8)));
+  BValue lt = fb.ULt(x, y);
+  BValue ge = fb.UGe(x, y);
+  BValue eq = fb.Eq(x, y);
+  BValue ne = fb.Ne(x, y);
+  BValue unknown = fb.ULt(x, fb.Param("z", p->GetBitsType(8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_TRUE(engine->IsAllOnes(lt.node()));
+  EXPECT_TRUE(engine->IsAllZeros(ge.node()));
+  EXPECT_TRUE(engine->IsAllZeros(eq.node()));
+  EXPECT_TRUE(engine->IsAllOnes(ne.node()));
+  EXPECT_FALSE(engine->AllBitsKnown(unknown.node()));
+}
+
+TEST_F(RangeQueryEngineTest, ShiftsAndSlices) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.ZeroExtend(fb.Param("x", p->GetBitsType(4)), 16);
+  BValue amount = fb.ZeroExtend(fb.Param("amount", p->GetBitsType(2)), 8);
+  BValue shll = fb.Shll(x, amount);
+  BValue shrl = fb.Shrl(fb.Add(x, x), amount);
+  BValue slice = fb.BitSlice(fb.Add(x, x), /*start=*/1, /*width=*/8);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_EQ(engine->MaxUnsignedValue(shll.node()), UBits(120, 16));
+  EXPECT_EQ(engine->MaxUnsignedValue(shrl.node()), UBits(30, 16));
+  EXPECT_EQ(engine->MaxUnsignedValue(slice.node()), UBits(15, 8));
+}
+
+TEST_F(RangeQueryEngineTest, SelectUnionsReachableCases) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  // The selector is at most 1 so the last case and the default are never
+  // selected.
+  BValue selector = fb.ZeroExtend(fb.Param("s", p->GetBitsType(1)), 2);
+  BValue sel = fb.Select(selector,
+                         {fb.Literal(UBits(3, 8)), fb.Literal(UBits(12, 8)),
+                          fb.Literal(UBits(200, 8))},
+                         /*default_value=*/fb.Literal(UBits(255, 8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_EQ(engine->MinUnsignedValue(sel.node()), UBits(3, 8));
+  EXPECT_EQ(engine->MaxUnsignedValue(sel.node()), UBits(12, 8));
+  EXPECT_EQ(engine->ToString(sel.node()), "0b0000_XXXX");
+}
+
+TEST_F(RangeQueryEngineTest, Update) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.ZeroExtend(fb.Param("x", p->GetBitsType(4)), 16);
+  BValue y = fb.ZeroExtend(fb.Param("y", p->GetBitsType(4)), 16);
+  BValue wide = fb.Param("wide", p->GetBitsType(16));
+  BValue sum = fb.Add(x, y);
+  BValue lt = fb.ULt(sum, fb.Literal(UBits(100, 16)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RangeQueryEngine> engine,
+                           RangeQueryEngine::Run(f));
+  EXPECT_EQ(engine->MaxUnsignedValue(sum.node()), UBits(30, 16));
+  EXPECT_TRUE(engine->IsAllOnes(lt.node()));
+
+  // Widen an operand of the add. The add and the comparison must be
+  // re-evaluated although neither was modified.
+  XLS_ASSERT_OK(y.node()->ReplaceUsesWith(wide.node()));
+  XLS_ASSERT_OK(f->RemoveNode(y.node()));
+  XLS_ASSERT_OK(engine->Update());
+  EXPECT_EQ(engine->MaxUnsignedValue(sum.node()), Bits::AllOnes(16));
+  EXPECT_FALSE(engine->AllBitsKnown(lt.node()));
+}
+
+}  // namespace
+}  // namespace xls
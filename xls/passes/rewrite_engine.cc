@@ -0,0 +1,186 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/rewrite_engine.h"
+
+#include <deque>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace {
+
+// The nodes waiting to be visited, each at most once. Removed nodes are
+// dropped from the set but not the queue, so they are skipped when popped.
+class Worklist {
+ public:
+  void Push(Node* node) {
+    if (queued_.insert(node).second) {
+      queue_.push_back(node);
+    }
+  }
+
+  // Returns the next node to visit, or nullptr if there are none.
+  Node* Pop() {
+    while (!queue_.empty()) {
+      Node* node = queue_.front();
+      queue_.pop_front();
+      if (queued_.erase(node) > 0) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  void Remove(Node* node) { queued_.erase(node); }
+
+ private:
+  std::deque<Node*> queue_;
+  absl::flat_hash_set<Node*> queued_;
+};
+
+bool IsRemovable(Node* node) { return node->IsDead() && !node->Is<Param>(); }
+
+// Removes 'node' if it is dead, along with the operands only it used,
+// transitively. Operands which stay alive lost a user, so they are queued to
+// be revisited.
+absl::StatusOr<int64_t> RemoveIfDead(Node* node, Worklist* worklist) {
+  if (!IsRemovable(node)) {
+    return 0;
+  }
+  FunctionBase* f = node->function_base();
+  int64_t removed_count = 0;
+  std::vector<Node*> dead = {node};
+  absl::flat_hash_set<Node*> unique_operands;
+  while (!dead.empty()) {
+    Node* n = dead.back();
+    dead.pop_back();
+    unique_operands.clear();
+    for (Node* operand : n->operands()) {
+      if (!unique_operands.insert(operand).second) {
+        continue;
+      }
+      // 'n' is the last user of the operand, so it will be dead once 'n' is
+      // removed. Each operand is pushed only when its last user goes.
+      if (operand->users().size() == 1 && !f->HasImplicitUse(operand) &&
+          !operand->Is<Param>()) {
+        dead.push_back(operand);
+      } else {
+        worklist->Push(operand);
+      }
+    }
+    worklist->Remove(n);
+    XLS_RETURN_IF_ERROR(f->RemoveNode(n));
+    ++removed_count;
+  }
+  return removed_count;
+}
+
+}  // namespace
+
+void RewriteEngine::AddRule(absl::Span<const Op> ops, RewriteRule rule) {
+  int64_t index = rules_.size();
+  rules_.push_back(std::move(rule));
+  for (Op op : ops) {
+    rules_by_op_[static_cast<int64_t>(op)].push_back(index);
+  }
+}
+
+absl::StatusOr<bool> RewriteEngine::Run(FunctionBase* f, int64_t since) const {
+  Worklist worklist;
+  for (Node* node : TopoSort(f)) {
+    if (node->ChangedSince(since)) {
+      worklist.Push(node);
+    }
+  }
+
+  bool changed = false;
+  int64_t rewrite_count = 0;
+  int64_t removed_count = 0;
+  std::vector<Node*> affected;
+  absl::flat_hash_set<Node*> visited;
+  while (Node* node = worklist.Pop()) {
+    if (IsRemovable(node)) {
+      XLS_ASSIGN_OR_RETURN(int64_t removed, RemoveIfDead(node, &worklist));
+      removed_count += removed;
+      continue;
+    }
+
+    std::vector<Node*> users(node->users().begin(), node->users().end());
+    int64_t before = f->change_count();
+    bool node_changed = false;
+    for (int64_t rule_index : rules_by_op_[static_cast<int64_t>(node->op())]) {
+      XLS_ASSIGN_OR_RETURN(node_changed, rules_[rule_index](node));
+      if (node_changed) {
+        break;
+      }
+    }
+    if (!node_changed) {
+      continue;
+    }
+    ++rewrite_count;
+    changed = true;
+
+    // Find the nodes changed by the rewrite. Anything it created or rewired
+    // is reachable through the operands of the former users (or of the return
+    // value, if the node was returned), and is marked changed.
+    affected = users;
+    affected.push_back(node);
+    if (f->IsFunction()) {
+      affected.push_back(f->AsFunctionOrDie()->return_value());
+    }
+    visited.clear();
+    while (!affected.empty()) {
+      Node* n = affected.back();
+      affected.pop_back();
+      if (!visited.insert(n).second || !n->ChangedSince(before)) {
+        continue;
+      }
+      worklist.Push(n);
+      for (Node* user : n->users()) {
+        worklist.Push(user);
+      }
+      affected.insert(affected.end(), n->operands().begin(),
+                      n->operands().end());
+    }
+    XLS_ASSIGN_OR_RETURN(int64_t removed, RemoveIfDead(node, &worklist));
+    removed_count += removed;
+  }
+
+  // Rewrites may create nodes they end up not using; remove those too.
+  std::vector<Node*> dead;
+  for (Node* node : f->nodes()) {
+    if (node->ChangedSince(since) && node->users().empty() &&
+        IsRemovable(node)) {
+      dead.push_back(node);
+    }
+  }
+  for (Node* node : dead) {
+    XLS_ASSIGN_OR_RETURN(int64_t removed, RemoveIfDead(node, &worklist));
+    removed_count += removed;
+  }
+
+  XLS_VLOG(2) << absl::StreamFormat("Applied %d rewrites, removed %d nodes",
+                                    rewrite_count, removed_count);
+  return changed || removed_count > 0;
+}
+
+}  // namespace xls
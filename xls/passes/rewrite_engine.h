@@ -0,0 +1,66 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_PASSES_REWRITE_ENGINE_H_
+#define XLS_PASSES_REWRITE_ENGINE_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function_base.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+
+namespace xls {
+
+// A local rewrite of a node, typically replacing its uses with a simpler new or
+// existing node. Returns true if the IR was modified. Rules must not remove
+// nodes; the engine removes nodes which become dead.
+using RewriteRule = std::function<absl::StatusOr<bool>(Node*)>;
+
+// Applies a set of local rewrite rules to a function using a worklist. Rather
+// than sweeping the whole function once per rule until nothing changes, only
+// the nodes affected by a rewrite (the rewritten node's operands, its former
+// users and any nodes the rewrite created) are revisited, and nodes which
+// become dead are removed immediately so no separate dead code elimination is
+// needed between rules.
+class RewriteEngine {
+ public:
+  RewriteEngine() : rules_by_op_(kOpLimit) {}
+
+  // Registers a rule which is tried on nodes with any of the given ops.
+  void AddRule(absl::Span<const Op> ops, RewriteRule rule);
+
+  // Registers a rule which is tried on every node.
+  void AddRule(RewriteRule rule) { AddRule(AllOps(), std::move(rule)); }
+
+  // Applies the rules until none applies to any node. Starts from the nodes
+  // for which ChangedSince(since) holds (all nodes if zero). For each node,
+  // rules are tried in the order they were registered until one modifies the
+  // IR. Returns true if the IR was modified, including by removing dead nodes.
+  absl::StatusOr<bool> Run(FunctionBase* f, int64_t since = 0) const;
+
+ private:
+  std::vector<RewriteRule> rules_;
+  // Indices into rules_ of the rules to try for each op, in registration order.
+  std::vector<std::vector<int64_t>> rules_by_op_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_REWRITE_ENGINE_H_
@@ -0,0 +1,126 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/passes/rewrite_engine.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_matcher.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+
+namespace m = ::xls::op_matchers;
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class RewriteEngineTest : public IrTestBase {};
+
+// Replaces not(not(x)) with x.
+absl::StatusOr<bool> RemoveDoubleNot(Node* node) {
+  if (node->operand(0)->op() != Op::kNot) {
+    return false;
+  }
+  XLS_RETURN_IF_ERROR(node->ReplaceUsesWith(node->operand(0)->operand(0)));
+  return true;
+}
+
+TEST_F(RewriteEngineTest, RulesOnlySeeTheirOps) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8], y: bits[8]) -> bits[8] {
+        a: bits[8] = and(x, y)
+        b: bits[8] = not(a)
+        ret c: bits[8] = or(b, x)
+     }
+  )",
+                                                       p.get()));
+  int64_t not_count = 0;
+  int64_t all_count = 0;
+  RewriteEngine engine;
+  engine.AddRule({Op::kNot}, [&](Node* node) -> absl::StatusOr<bool> {
+    EXPECT_EQ(node->op(), Op::kNot);
+    ++not_count;
+    return false;
+  });
+  engine.AddRule([&](Node* node) -> absl::StatusOr<bool> {
+    ++all_count;
+    return false;
+  });
+  EXPECT_THAT(engine.Run(f), IsOkAndHolds(false));
+  EXPECT_EQ(not_count, 1);
+  EXPECT_EQ(all_count, f->node_count());
+}
+
+TEST_F(RewriteEngineTest, RevisitsAffectedNodesAndRemovesDeadOnes) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8]) -> bits[8] {
+        a: bits[8] = not(x)
+        b: bits[8] = not(a)
+        c: bits[8] = not(b)
+        ret d: bits[8] = not(c)
+     }
+  )",
+                                                       p.get()));
+  RewriteEngine engine;
+  engine.AddRule({Op::kNot}, RemoveDoubleNot);
+  EXPECT_THAT(engine.Run(f), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Param("x"));
+  EXPECT_EQ(f->node_count(), 1);
+}
+
+TEST_F(RewriteEngineTest, RemovesDeadNodesWithoutRules) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8], y: bits[8]) -> bits[8] {
+        a: bits[8] = and(x, y)
+        dead: bits[8] = not(a)
+        ret b: bits[8] = or(x, y)
+     }
+  )",
+                                                       p.get()));
+  RewriteEngine engine;
+  EXPECT_THAT(engine.Run(f), IsOkAndHolds(true));
+  EXPECT_EQ(f->node_count(), 3);
+  EXPECT_THAT(engine.Run(f), IsOkAndHolds(false));
+}
+
+TEST_F(RewriteEngineTest, OnlyVisitsChangedNodes) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn f(x: bits[8], y: bits[8]) -> bits[8] {
+        a: bits[8] = and(x, y)
+        ret b: bits[8] = or(a, y)
+     }
+  )",
+                                                       p.get()));
+  int64_t visit_count = 0;
+  RewriteEngine engine;
+  engine.AddRule([&](Node* node) -> absl::StatusOr<bool> {
+    ++visit_count;
+    return false;
+  });
+  EXPECT_THAT(engine.Run(f, f->change_count()), IsOkAndHolds(false));
+  EXPECT_EQ(visit_count, 0);
+}
+
+}  // namespace
+}  // namespace xls
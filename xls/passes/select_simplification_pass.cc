@@ -33,6 +33,7 @@
 #include "xls/ir/node_util.h"
 #include "xls/ir/nodes.h"
 #include "xls/passes/post_dominator_analysis.h"
+#include "xls/passes/query_engine_cache.h"
 #include "xls/passes/ternary_query_engine.h"
 
 namespace xls {
@@ -1046,8 +1047,9 @@ absl::StatusOr<bool> SpecializeSelectArms(FunctionBase* func) {
 absl::StatusOr<bool> SelectSimplificationPass::RunOnFunctionBaseInternal(
     FunctionBase* func, const PassOptions& options,
     PassResults* results) const {
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(func));
+  std::unique_ptr<TernaryQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(TernaryQueryEngine * query_engine,
+                       GetTernaryQueryEngine(func, options, &owned_engine));
   bool changed = false;
   for (Node* node : TopoSort(func)) {
     XLS_ASSIGN_OR_RETURN(bool node_changed,
@@ -17,24 +17,35 @@
 
 #include "xls/passes/standard_pipeline.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "xls/common/status/status_macros.h"
 #include "xls/passes/arith_simplification_pass.h"
 #include "xls/passes/array_simplification_pass.h"
 #include "xls/passes/bdd_cse_pass.h"
 #include "xls/passes/bdd_simplification_pass.h"
 #include "xls/passes/bit_slice_simplification_pass.h"
 #include "xls/passes/boolean_simplification_pass.h"
-#include "xls/passes/canonicalization_pass.h"
 #include "xls/passes/concat_simplification_pass.h"
-#include "xls/passes/constant_folding_pass.h"
 #include "xls/passes/cse_pass.h"
 #include "xls/passes/dce_pass.h"
 #include "xls/passes/dfe_pass.h"
+#include "xls/passes/fused_simplification_pass.h"
 #include "xls/passes/identity_removal_pass.h"
 #include "xls/passes/inlining_pass.h"
 #include "xls/passes/literal_uncommoning_pass.h"
 #include "xls/passes/map_inlining_pass.h"
 #include "xls/passes/narrowing_pass.h"
+#include "xls/passes/query_engine_cache.h"
 #include "xls/passes/reassociation_pass.h"
 #include "xls/passes/select_simplification_pass.h"
 #include "xls/passes/strength_reduction_pass.h"
@@ -43,18 +54,22 @@
 #include "xls/passes/unroll_pass.h"
 #include "xls/passes/verifier_checker.h"
 #include "xls/scheduling/pipeline_scheduling_pass.h"
+#include "xls/scheduling/retiming_pass.h"
 #include "xls/scheduling/scheduling_checker.h"
 
 namespace xls {
 
 class SimplificationPass : public FixedPointCompoundPass {
  public:
-  explicit SimplificationPass(int64_t opt_level)
+  explicit SimplificationPass(int64_t opt_level, bool narrowing_first = false)
       : FixedPointCompoundPass("simp", "Simplification") {
-    Add<ConstantFoldingPass>();
-    Add<DeadCodeEliminationPass>();
-    Add<CanonicalizationPass>();
-    Add<DeadCodeEliminationPass>();
+    // The fused pass removes the dead nodes left by the previous pass as well
+    // as those it creates, so it needs no DCE before or after it.
+    Add<FusedSimplificationPass>();
+    if (narrowing_first) {
+      Add<NarrowingPass>(opt_level);
+      Add<DeadCodeEliminationPass>();
+    }
     Add<ArithSimplificationPass>(opt_level);
     Add<DeadCodeEliminationPass>();
     Add<TableSwitchPass>();
@@ -62,9 +77,7 @@ class SimplificationPass : public FixedPointCompoundPass {
     Add<SelectSimplificationPass>(opt_level);
     Add<DeadCodeEliminationPass>();
     Add<ReassociationPass>();
-    Add<DeadCodeEliminationPass>();
-    Add<ConstantFoldingPass>();
-    Add<DeadCodeEliminationPass>();
+    Add<FusedSimplificationPass>();
     Add<BitSliceSimplificationPass>(opt_level);
     Add<DeadCodeEliminationPass>();
     Add<ConcatSimplificationPass>(opt_level);
@@ -75,15 +88,86 @@ class SimplificationPass : public FixedPointCompoundPass {
     Add<DeadCodeEliminationPass>();
     Add<ArraySimplificationPass>(opt_level);
     Add<DeadCodeEliminationPass>();
-    Add<NarrowingPass>(opt_level);
-    Add<DeadCodeEliminationPass>();
+    if (!narrowing_first) {
+      Add<NarrowingPass>(opt_level);
+      Add<DeadCodeEliminationPass>();
+    }
     Add<BooleanSimplificationPass>();
     Add<DeadCodeEliminationPass>();
     Add<CsePass>();
   }
 };
 
+// Returns the function-level passes with which InliningPass optimizes each
+// callee before inlining it. These are the cheap local simplifications; the
+// analysis-based passes run on the callers after inlining.
+std::vector<std::unique_ptr<FunctionBasePass>> CalleeOptimizationPasses(
+    int64_t opt_level) {
+  std::vector<std::unique_ptr<FunctionBasePass>> passes;
+  passes.push_back(absl::make_unique<FusedSimplificationPass>());
+  passes.push_back(absl::make_unique<ArithSimplificationPass>(opt_level));
+  passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  passes.push_back(absl::make_unique<BitSliceSimplificationPass>(opt_level));
+  passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  passes.push_back(absl::make_unique<ConcatSimplificationPass>(opt_level));
+  passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  passes.push_back(absl::make_unique<TupleSimplificationPass>());
+  passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  passes.push_back(absl::make_unique<BooleanSimplificationPass>());
+  passes.push_back(absl::make_unique<DeadCodeEliminationPass>());
+  passes.push_back(absl::make_unique<CsePass>());
+  return passes;
+}
+
+std::string StandardPipelineConfig::ToString() const {
+  return absl::StrFormat("opt_level=%d bdd_passes=%s narrowing_first=%s",
+                         opt_level, bdd_passes ? "true" : "false",
+                         narrowing_first ? "true" : "false");
+}
+
+absl::StatusOr<StandardPipelineConfig> StandardPipelineConfig::Parse(
+    absl::string_view text) {
+  StandardPipelineConfig config;
+  auto parse_bool = [](absl::string_view key, absl::string_view value,
+                       bool* result) -> absl::Status {
+    if (!absl::SimpleAtob(value, result)) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid value of %s: %s", key, value));
+    }
+    return absl::OkStatus();
+  };
+  for (absl::string_view item :
+       absl::StrSplit(text, absl::ByAnyChar(" \n"), absl::SkipEmpty())) {
+    std::pair<absl::string_view, absl::string_view> key_value =
+        absl::StrSplit(item, absl::MaxSplits('=', 1));
+    const auto& [key, value] = key_value;
+    if (key == "opt_level") {
+      if (!absl::SimpleAtoi(value, &config.opt_level) ||
+          config.opt_level < 1 || config.opt_level > kMaxOptLevel) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Invalid value of opt_level: %s", value));
+      }
+    } else if (key == "bdd_passes") {
+      XLS_RETURN_IF_ERROR(parse_bool(key, value, &config.bdd_passes));
+    } else if (key == "narrowing_first") {
+      XLS_RETURN_IF_ERROR(parse_bool(key, value, &config.narrowing_first));
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unknown pipeline configuration key: %s", key));
+    }
+  }
+  return config;
+}
+
 std::unique_ptr<CompoundPass> CreateStandardPassPipeline(int64_t opt_level) {
+  StandardPipelineConfig config;
+  config.opt_level = opt_level;
+  return CreateStandardPassPipeline(config);
+}
+
+std::unique_ptr<CompoundPass> CreateStandardPassPipeline(
+    const StandardPipelineConfig& config) {
+  const int64_t opt_level = config.opt_level;
   auto top = absl::make_unique<CompoundPass>("ir", "Top level pass pipeline");
   top->AddInvariantChecker<VerifierChecker>();
 
@@ -94,32 +178,47 @@ std::unique_ptr<CompoundPass> CreateStandardPassPipeline(int64_t opt_level) {
   // run. 'opt_level' is the maximum level of optimization which should be run
   // in the entire pipeline so set the level of the simplification pass to the
   // minimum of the two values. Same below.
-  top->Add<SimplificationPass>(std::min(int64_t{2}, opt_level));
+  top->Add<SimplificationPass>(std::min(int64_t{2}, opt_level),
+                               config.narrowing_first);
   top->Add<UnrollPass>();
   top->Add<MapInliningPass>();
-  top->Add<InliningPass>();
+  // Callees are fully simplified once, bottom-up, so a function invoked from
+  // many sites is not re-simplified at each of them after inlining.
+  top->Add<InliningPass>(
+      CalleeOptimizationPasses(std::min(int64_t{2}, opt_level)));
   top->Add<DeadFunctionEliminationPass>();
-  top->Add<BddSimplificationPass>(std::min(int64_t{2}, opt_level));
-  top->Add<DeadCodeEliminationPass>();
-  top->Add<BddCsePass>();
-  top->Add<DeadCodeEliminationPass>();
-  top->Add<SimplificationPass>(std::min(int64_t{2}, opt_level));
+  if (config.bdd_passes) {
+    top->Add<BddSimplificationPass>(std::min(int64_t{2}, opt_level));
+    top->Add<DeadCodeEliminationPass>();
+    top->Add<BddCsePass>();
+    top->Add<DeadCodeEliminationPass>();
+  }
+  top->Add<SimplificationPass>(std::min(int64_t{2}, opt_level),
+                               config.narrowing_first);
 
-  top->Add<BddSimplificationPass>(std::min(int64_t{3}, opt_level));
-  top->Add<DeadCodeEliminationPass>();
-  top->Add<BddCsePass>();
-  top->Add<DeadCodeEliminationPass>();
-  top->Add<SimplificationPass>(std::min(int64_t{3}, opt_level));
+  if (config.bdd_passes) {
+    top->Add<BddSimplificationPass>(std::min(int64_t{3}, opt_level));
+    top->Add<DeadCodeEliminationPass>();
+    top->Add<BddCsePass>();
+    top->Add<DeadCodeEliminationPass>();
+  }
+  top->Add<SimplificationPass>(std::min(int64_t{3}, opt_level),
+                               config.narrowing_first);
   top->Add<LiteralUncommoningPass>();
   top->Add<DeadFunctionEliminationPass>();
   return top;
 }
 
 absl::StatusOr<bool> RunStandardPassPipeline(Package* package,
-                                             int64_t opt_level) {
+                                             int64_t opt_level,
+                                             PassResults* results) {
   std::unique_ptr<CompoundPass> pipeline = CreateStandardPassPipeline();
-  PassResults results;
-  return pipeline->Run(package, PassOptions(), &results);
+  QueryEngineCache query_engine_cache;
+  PassOptions options;
+  options.query_engine_cache = &query_engine_cache;
+  PassResults local_results;
+  return pipeline->Run(package, options,
+                       results == nullptr ? &local_results : results);
 }
 
 std::unique_ptr<SchedulingCompoundPass> CreateStandardSchedulingPassPipeline() {
@@ -127,6 +226,7 @@ std::unique_ptr<SchedulingCompoundPass> CreateStandardSchedulingPassPipeline() {
       "sched", "Top level scheduling pass pipeline");
   top->AddInvariantChecker<SchedulingChecker>();
   top->Add<PipelineSchedulingPass>();
+  top->Add<RetimingPass>();
   return top;
 }
 
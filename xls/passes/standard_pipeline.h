@@ -15,21 +15,53 @@
 #ifndef XLS_PASSES_STANDARD_PIPELINE_H_
 #define XLS_PASSES_STANDARD_PIPELINE_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "xls/passes/passes.h"
 #include "xls/scheduling/scheduling_pass.h"
 
 namespace xls {
 
+// The variations of the standard pipeline, which the pipeline autotuner (see
+// pipeline_autotuner.h) chooses between for each design.
+struct StandardPipelineConfig {
+  int64_t opt_level = kMaxOptLevel;
+
+  // Whether the BDD-based simplification and CSE passes are run.
+  bool bdd_passes = true;
+
+  // Whether the narrowing pass runs at the start of each round of
+  // simplification rather than towards the end.
+  bool narrowing_first = false;
+
+  // Returns the configuration as space-separated "key=value" items, e.g.,
+  // "opt_level=3 bdd_passes=true narrowing_first=false", which Parse accepts.
+  // Keys missing from the text of Parse keep their default values.
+  std::string ToString() const;
+  static absl::StatusOr<StandardPipelineConfig> Parse(absl::string_view text);
+
+  bool operator==(const StandardPipelineConfig& other) const {
+    return opt_level == other.opt_level && bdd_passes == other.bdd_passes &&
+           narrowing_first == other.narrowing_first;
+  }
+};
+
 // CreateStandardPassPipeline connects together the various optimization
 // and analysis passes in the order of execution.
 std::unique_ptr<CompoundPass> CreateStandardPassPipeline(
     int64_t opt_level = kMaxOptLevel);
+std::unique_ptr<CompoundPass> CreateStandardPassPipeline(
+    const StandardPipelineConfig& config);
 
 // Creates and runs the standard pipeline on the given package with default
-// options.
+// options. If "results" is given, the pass invocations are recorded in it.
 absl::StatusOr<bool> RunStandardPassPipeline(Package* package,
-                                             int64_t opt_level = kMaxOptLevel);
+                                             int64_t opt_level = kMaxOptLevel,
+                                             PassResults* results = nullptr);
 
 // Creates a pipeline for constructing a schedule for a feedforward pipeline.
 std::unique_ptr<SchedulingCompoundPass> CreateStandardSchedulingPassPipeline();
@@ -38,6 +38,7 @@ namespace xls {
 namespace {
 
 using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
 
 class StandardPipelineTest : public IrTestBase {
  protected:
@@ -269,6 +270,22 @@ TEST_F(StandardPipelineTest, LogicCombining) {
   EXPECT_THAT(f->return_value(), m::Param("x"));
 }
 
+TEST_F(StandardPipelineTest, ConfigRoundTrip) {
+  StandardPipelineConfig config;
+  config.opt_level = 2;
+  config.bdd_passes = false;
+  config.narrowing_first = true;
+  EXPECT_EQ(config.ToString(),
+            "opt_level=2 bdd_passes=false narrowing_first=true");
+  EXPECT_THAT(StandardPipelineConfig::Parse(config.ToString()),
+              IsOkAndHolds(config));
+  EXPECT_THAT(StandardPipelineConfig::Parse("bdd_passes=false\n"),
+              IsOkAndHolds(StandardPipelineConfig{kMaxOptLevel, false, false}));
+  EXPECT_THAT(StandardPipelineConfig::Parse("opt_level=two"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(StandardPipelineConfig::Parse("inline=true"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
 
 }  // namespace
 }  // namespace xls
@@ -25,7 +25,8 @@
 #include "xls/ir/node_util.h"
 #include "xls/ir/nodes.h"
 #include "xls/passes/query_engine.h"
-#include "xls/passes/ternary_query_engine.h"
+#include "xls/passes/query_engine_cache.h"
+#include "xls/passes/range_query_engine.h"
 
 namespace xls {
 namespace {
@@ -330,8 +331,9 @@ absl::StatusOr<bool> StrengthReduceNode(
 
 absl::StatusOr<bool> StrengthReductionPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<TernaryQueryEngine> query_engine,
-                       TernaryQueryEngine::Run(f));
+  std::unique_ptr<RangeQueryEngine> owned_engine;
+  XLS_ASSIGN_OR_RETURN(RangeQueryEngine * query_engine,
+                       GetRangeQueryEngine(f, options, &owned_engine));
   XLS_ASSIGN_OR_RETURN(absl::flat_hash_set<Node*> reducible_adds,
                        FindReducibleAdds(f, *query_engine));
   // Note: because we introduce new nodes into the graph that were not present
@@ -295,5 +295,22 @@ TEST_F(StrengthReductionPassTest, SignExtMuxNegated) {
   EXPECT_THAT(f->return_value(), m::SignExt(m::Not(m::Param("s"))));
 }
 
+TEST_F(StrengthReductionPassTest, ComparisonOfBoundedValues) {
+  auto p = CreatePackage();
+  // The remainder is at most 9 so it is always less than 12, although none of
+  // its bits are known from ternary evaluation alone.
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn func(x: bits[8]) -> bits[1] {
+       literal.1: bits[8] = literal(value=10)
+       umod.2: bits[8] = umod(x, literal.1)
+       literal.3: bits[8] = literal(value=12)
+       ret ult.4: bits[1] = ult(umod.2, literal.3)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Literal(1));
+}
+
 }  // namespace
 }  // namespace xls
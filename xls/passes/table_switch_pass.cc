@@ -13,6 +13,9 @@
 // limitations under the License.
 #include "xls/passes/table_switch_pass.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "xls/common/status/status_macros.h"
@@ -338,6 +341,37 @@ bool IsChainCandidate(Node* node) {
          select->get_case(1)->op() == Op::kLiteral;
 }
 
+// Returns true if the node is a OneHotSelect of at least the minimum table size
+// choosing between literals by a OneHot node.
+bool IsOneHotTableCandidate(Node* node) {
+  if (!node->Is<OneHotSelect>()) {
+    return false;
+  }
+  OneHotSelect* select = node->As<OneHotSelect>();
+  return select->selector()->op() == Op::kOneHot &&
+         select->cases().size() >= SelectChain::kMinimumSize &&
+         std::all_of(select->cases().begin(), select->cases().end(),
+                     [](Node* c) { return c->Is<Literal>(); });
+}
+
+// Replaces the OneHotSelect (see IsOneHotTableCandidate) with an ArrayIndex of
+// a table of its cases by the index of the hot selector bit.
+absl::Status ReplaceWithArrayIndex(OneHotSelect* select) {
+  FunctionBase* f = select->function_base();
+  std::vector<Value> values;
+  for (Node* c : select->cases()) {
+    values.push_back(c->As<Literal>()->value());
+  }
+  XLS_ASSIGN_OR_RETURN(Value array, Value::Array(values));
+  XLS_ASSIGN_OR_RETURN(Literal * literal,
+                       f->MakeNode<Literal>(select->loc(), array));
+  XLS_ASSIGN_OR_RETURN(
+      Encode * index, f->MakeNode<Encode>(select->loc(), select->selector()));
+  return select
+      ->ReplaceUsesWithNew<ArrayIndex>(literal, std::vector<Node*>({index}))
+      .status();
+}
+
 // Returns true if this node is already in another SelectChain.
 bool IsInChain(Select* select, const std::vector<SelectChain>& chains) {
   for (const auto& chain : chains) {
@@ -373,6 +407,13 @@ absl::StatusOr<bool> TableSwitchPass::RunOnFunctionBaseInternal(
     changed = true;
   }
 
+  for (Node* node : TopoSort(f)) {
+    if (IsOneHotTableCandidate(node)) {
+      XLS_RETURN_IF_ERROR(ReplaceWithArrayIndex(node->As<OneHotSelect>()));
+      changed = true;
+    }
+  }
+
   return changed;
 }
 
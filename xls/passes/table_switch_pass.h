@@ -32,6 +32,12 @@ namespace xls {
 //  - The increment between indices must be positive or negative 1.
 //  - There can be no "gaps" between indices.
 //  - The Select ops have to be binary (i.e., selecting between only two cases).
+//
+// It also converts OneHotSelect nodes choosing between literals by a OneHot
+// node, which exactly one selector bit is set in, into an ArrayIndex by the
+// Encode of the selector:
+// one_hot_sel(one_hot(X), cases=[literal.A, literal.B, ...])
+//   => array_index([A, B, ...], encode(one_hot(X)))
 class TableSwitchPass : public FunctionBasePass {
  public:
   TableSwitchPass()
@@ -506,6 +506,65 @@ fn main(index: bits[128]) -> bits[128] {
   XLS_ASSERT_OK(CompareBeforeAfter(f, before_data));
 }
 
+// Verifies that a one-hot select of literals by a one-hot node is converted
+// into a table lookup by the index of the hot bit.
+TEST_F(TableSwitchPassTest, SwitchesOneHotSelect) {
+  const std::string program = R"(
+package p
+
+fn main(index: bits[8]) -> bits[32] {
+  literal.0: bits[32] = literal(value=0)
+  literal.1: bits[32] = literal(value=11)
+  literal.2: bits[32] = literal(value=22)
+  literal.3: bits[32] = literal(value=33)
+  literal.4: bits[32] = literal(value=44)
+  literal.5: bits[32] = literal(value=55)
+  literal.6: bits[32] = literal(value=66)
+  literal.7: bits[32] = literal(value=77)
+  literal.8: bits[32] = literal(value=88)
+  one_hot.20: bits[9] = one_hot(index, lsb_prio=true)
+  ret result: bits[32] = one_hot_sel(one_hot.20, cases=[literal.0, literal.1, literal.2, literal.3, literal.4, literal.5, literal.6, literal.7, literal.8])
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<VerifiedPackage> p,
+                           ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> before_data,
+                           GetBeforeData(f, /*max_index=*/128, /*width=*/8));
+
+  PassResults results;
+  TableSwitchPass pass;
+  ASSERT_THAT(pass.RunOnFunctionBase(f, PassOptions(), &results),
+              IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::ArrayIndex(m::Literal(), /*indices=*/{
+                                                   m::Encode(m::OneHot())}));
+  XLS_ASSERT_OK(CompareBeforeAfter(f, before_data));
+}
+
+// Verifies that one-hot selects by arbitrary selectors, which may have several
+// or no bits set, are left alone.
+TEST_F(TableSwitchPassTest, SkipsOneHotSelectOfArbitrarySelector) {
+  const std::string program = R"(
+package p
+
+fn main(index: bits[3]) -> bits[32] {
+  literal.0: bits[32] = literal(value=1)
+  literal.1: bits[32] = literal(value=2)
+  literal.2: bits[32] = literal(value=4)
+  ret result: bits[32] = one_hot_sel(index, cases=[literal.0, literal.1, literal.2])
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<VerifiedPackage> p,
+                           ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("main"));
+  PassResults results;
+  TableSwitchPass pass;
+  EXPECT_THAT(pass.RunOnFunctionBase(f, PassOptions(), &results),
+              IsOkAndHolds(false));
+}
+
 TEST_F(TableSwitchPassTest, Crasher70d2fb09) {
   // Minimized example extracted from the optimization pipeline right before
   // TableSwitchPass is run.
@@ -21,70 +21,59 @@
 #include "absl/strings/str_cat.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/data_structures/leaf_type_tree.h"
-#include "xls/ir/abstract_node_evaluator.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/node_iterator.h"
-#include "xls/passes/ternary_evaluator.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 
-Bits TernaryVectorToKnownBits(const TernaryEvaluator::Vector& ternary_vector) {
-  // Use InlinedVector to avoid std::vector<bool> specialization madness.
-  absl::InlinedVector<bool, 1> bits(ternary_vector.size());
-  for (int64_t i = 0; i < bits.size(); ++i) {
-    bits[i] = (ternary_vector[i] == TernaryValue::kKnownOne ||
-               ternary_vector[i] == TernaryValue::kKnownZero);
-  }
-  return Bits(bits);
-}
-
-Bits TernaryVectorToValueBits(const TernaryEvaluator::Vector& ternary_vector) {
-  // Use InlinedVector to avoid std::vector<bool> specialization madness.
-  absl::InlinedVector<bool, 1> bits(ternary_vector.size());
-  for (int64_t i = 0; i < bits.size(); ++i) {
-    bits[i] = ternary_vector[i] == TernaryValue::kKnownOne;
-  }
-  return Bits(bits);
-}
-
 /* static */
 absl::StatusOr<std::unique_ptr<TernaryQueryEngine>> TernaryQueryEngine::Run(
     FunctionBase* f) {
-  TernaryEvaluator evaluator;
-  absl::flat_hash_map<Node*, TernaryEvaluator::Vector> values;
-  for (Node* node : TopoSort(f)) {
+  auto engine = absl::make_unique<TernaryQueryEngine>();
+  engine->function_ = f;
+  XLS_RETURN_IF_ERROR(engine->Update());
+  return std::move(engine);
+}
+
+absl::Status TernaryQueryEngine::Update() {
+  // Nodes whose value changed in this update. Users of these nodes must be
+  // re-evaluated even if they were not themselves modified.
+  NodeBitSet changed(function_);
+  for (Node* node : TopoSort(function_)) {
     if (!node->GetType()->IsBits()) {
       continue;
     }
-    auto create_unknown_vector = [](Node* n) {
-      return TernaryEvaluator::Vector(n->BitCountOrDie(),
-                                      TernaryValue::kUnknown);
-    };
+    PackedTernaryVector* previous = values_.find(node);
+    if (previous != nullptr && node->change_count() <= change_count_ &&
+        std::none_of(node->operands().begin(), node->operands().end(),
+                     [&](Node* o) { return changed.contains(o); })) {
+      continue;
+    }
+    PackedTernaryVector value;
     if (std::any_of(node->operands().begin(), node->operands().end(),
                     [](Node* o) { return !o->GetType()->IsBits(); })) {
-      values[node] = create_unknown_vector(node);
-      continue;
+      value = PackedTernaryVector::Unknown(node->BitCountOrDie());
+    } else {
+      absl::InlinedVector<const PackedTernaryVector*, 3> operand_values;
+      for (Node* operand : node->operands()) {
+        operand_values.push_back(&values_.at(operand));
+      }
+      XLS_ASSIGN_OR_RETURN(value, PackedTernaryEvaluate(node, operand_values));
     }
-    std::vector<TernaryEvaluator::Vector> operand_values;
-    for (Node* operand : node->operands()) {
-      operand_values.push_back(values.at(operand));
+    if (previous != nullptr && *previous == value) {
+      continue;
     }
-    XLS_ASSIGN_OR_RETURN(
-        values[node],
-        AbstractEvaluate(node, operand_values, &evaluator,
-                         /*default_handler=*/create_unknown_vector));
-  }
-
-  auto engine = absl::make_unique<TernaryQueryEngine>();
-  for (Node* node : f->nodes()) {
+    changed.insert(node);
     // TODO(meheff): Handle types other than bits.
-    if (node->GetType()->IsBits()) {
-      engine->known_bits_[node] = TernaryVectorToKnownBits(values.at(node));
-      engine->bits_values_[node] = TernaryVectorToValueBits(values.at(node));
-    }
+    values_.insert_or_assign(node, std::move(value));
   }
-  return std::move(engine);
+
+  // Entries of nodes which have been removed from the function are left in
+  // place: node indices are not reused, so they are never looked up again.
+  change_count_ = function_->change_count();
+  return absl::OkStatus();
 }
 
 bool TernaryQueryEngine::AtMostOneTrue(
@@ -19,7 +19,9 @@
 #include "absl/types/optional.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/function.h"
+#include "xls/ir/node_map.h"
 #include "xls/ir/nodes.h"
+#include "xls/passes/packed_ternary_evaluator.h"
 #include "xls/passes/query_engine.h"
 
 namespace xls {
@@ -34,15 +36,21 @@ class TernaryQueryEngine : public QueryEngine {
   static absl::StatusOr<std::unique_ptr<TernaryQueryEngine>> Run(
       FunctionBase* f);
 
-  bool IsTracked(Node* node) const override {
-    return known_bits_.contains(node);
-  }
+  // Brings the engine up to date with changes made to the function since it
+  // was run or last updated. Only nodes which changed, or whose operands'
+  // values changed, are re-evaluated, so the work is proportional to the
+  // fan-out cone of the modified nodes.
+  absl::Status Update();
+
+  FunctionBase* function() const { return function_; }
+
+  bool IsTracked(Node* node) const override { return values_.contains(node); }
 
   const Bits& GetKnownBits(Node* node) const override {
-    return known_bits_.at(node);
+    return values_.at(node).known;
   }
   const Bits& GetKnownBitsValues(Node* node) const override {
-    return bits_values_.at(node);
+    return values_.at(node).value;
   }
 
   bool AtMostOneTrue(absl::Span<BitLocation const> bits) const override;
@@ -62,13 +70,15 @@ class TernaryQueryEngine : public QueryEngine {
   }
 
  private:
-  // Holds which bits values are known for nodes in the function. A one in a bit
-  // position indications the respective bit value in the respective node is
-  // statically known.
-  absl::flat_hash_map<Node*, Bits> known_bits_;
+  FunctionBase* function_ = nullptr;
+
+  // The change count of the function when it was last evaluated.
+  int64_t change_count_ = -1;
 
-  // Holds the values of statically known bits of nodes in the function.
-  absl::flat_hash_map<Node*, Bits> bits_values_;
+  // The ternary value of each bits-typed node in the function. The known
+  // mask of a value holds which bits of the node are statically known, and
+  // the value holds the values of those bits.
+  NodeMap<PackedTernaryVector> values_;
 };
 
 }  // namespace xls
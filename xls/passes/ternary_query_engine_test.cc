@@ -130,5 +130,38 @@ TEST_F(TernaryQueryEngineTest, Ne) {
   EXPECT_THAT(RunOnBinaryOp("0b011", "0b011", make_ne), IsOkAndHolds("0b0"));
 }
 
+TEST_F(TernaryQueryEngineTest, UpdateAfterChange) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue mask = fb.Literal(UBits(0x0f, 8));
+  BValue masked = fb.And(x, mask);
+  BValue y = fb.Or(masked, fb.Literal(UBits(0x80, 8)));
+  BValue z = fb.Not(x);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(y));
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TernaryQueryEngine> engine,
+                           TernaryQueryEngine::Run(f));
+  EXPECT_EQ(engine->ToString(y.node()), "0b1000_XXXX");
+  std::string z_string = engine->ToString(z.node());
+
+  // Narrow the mask and remove the old one. The values of the mask's fan-out
+  // change; other nodes are unaffected.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Node * new_mask, f->MakeNode<Literal>(absl::nullopt, Value(UBits(3, 8))));
+  XLS_ASSERT_OK(masked.node()->ReplaceOperandNumber(1, new_mask));
+  XLS_ASSERT_OK(f->RemoveNode(mask.node()));
+  XLS_ASSERT_OK(engine->Update());
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TernaryQueryEngine> fresh_engine,
+                           TernaryQueryEngine::Run(f));
+  EXPECT_EQ(engine->ToString(y.node()), "0b1000_00XX");
+  EXPECT_EQ(engine->ToString(new_mask), "0b0000_0011");
+  EXPECT_EQ(engine->ToString(z.node()), z_string);
+  for (Node* node : f->nodes()) {
+    EXPECT_EQ(engine->ToString(node), fresh_engine->ToString(node));
+  }
+}
+
 }  // namespace
 }  // namespace xls
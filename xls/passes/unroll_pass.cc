@@ -14,24 +14,58 @@
 
 #include "xls/passes/unroll_pass.h"
 
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
 
 namespace xls {
 namespace {
 
-// Finds an "effectively used" (has users or is return value) counted for in the
-// function f, or returns nullptr if none is found.
-CountedFor* FindCountedFor(FunctionBase* f) {
+// Finds the "effectively used" (has users or is return value) counted fors in
+// the function f.
+std::vector<CountedFor*> FindCountedFors(FunctionBase* f) {
+  std::vector<CountedFor*> loops;
   for (Node* node : TopoSort(f)) {
     if (node->Is<CountedFor>() &&
         (f->HasImplicitUse(node) || !node->users().empty())) {
-      return node->As<CountedFor>();
+      loops.push_back(node->As<CountedFor>());
+    }
+  }
+  return loops;
+}
+
+// Returns the number of nodes f would add to a caller with all of its invokes,
+// maps and counted fors fully inlined and unrolled. Params are not counted, as
+// inlining replaces them with the arguments. Memoized in "sizes".
+int64_t InlinedNodeCount(Function* f,
+                         absl::flat_hash_map<Function*, int64_t>* sizes) {
+  auto it = sizes->find(f);
+  if (it != sizes->end()) {
+    return it->second;
+  }
+  int64_t count = 0;
+  for (Node* node : f->nodes()) {
+    if (node->Is<Invoke>()) {
+      count += InlinedNodeCount(node->As<Invoke>()->to_apply(), sizes);
+    } else if (node->Is<Map>()) {
+      count += node->operand(0)->GetType()->AsArrayOrDie()->size() *
+               InlinedNodeCount(node->As<Map>()->to_apply(), sizes);
+    } else if (node->Is<CountedFor>()) {
+      count += node->As<CountedFor>()->trip_count() *
+               InlinedNodeCount(node->As<CountedFor>()->body(), sizes);
+    } else if (!node->Is<Param>()) {
+      ++count;
     }
   }
-  return nullptr;
+  (*sizes)[f] = count;
+  return count;
 }
 
 // Unrolls the node "loop" by replacing it with a sequence of dependent
@@ -65,11 +99,19 @@ absl::Status UnrollCountedFor(CountedFor* loop) {
 
 absl::StatusOr<bool> UnrollPass::RunOnFunctionBaseInternal(
     FunctionBase* f, const PassOptions& options, PassResults* results) const {
+  // Unrolling replaces loops with invokes, so it creates no new loops in f.
   bool changed = false;
-  while (true) {
-    CountedFor* loop = FindCountedFor(f);
-    if (loop == nullptr) {
-      break;
+  absl::flat_hash_map<Function*, int64_t> inlined_sizes;
+  for (CountedFor* loop : FindCountedFors(f)) {
+    if (options.max_unrolled_node_count.has_value()) {
+      int64_t unrolled_size =
+          loop->trip_count() * InlinedNodeCount(loop->body(), &inlined_sizes);
+      if (unrolled_size > *options.max_unrolled_node_count) {
+        XLS_VLOG(2) << absl::StreamFormat(
+            "Not unrolling %s: unrolled size %d exceeds the limit of %d",
+            loop->GetName(), unrolled_size, *options.max_unrolled_node_count);
+        continue;
+      }
     }
     XLS_RETURN_IF_ERROR(UnrollCountedFor(loop));
     changed = true;
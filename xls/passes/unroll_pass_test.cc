@@ -57,5 +57,45 @@ fn unrollable() -> bits[32] {
                         m::Literal(0)));
 }
 
+TEST(UnrollPassTest, LeavesLoopsOverBudgetRolled) {
+  const std::string program = R"(
+package some_package
+
+fn inner(x: bits[32]) -> bits[32] {
+  ret neg.1: bits[32] = neg(x)
+}
+
+fn body(i: bits[4], accum: bits[32]) -> bits[32] {
+  zero_ext.2: bits[32] = zero_ext(i, new_bit_count=32)
+  invoke.3: bits[32] = invoke(accum, to_apply=inner)
+  ret add.4: bits[32] = add(zero_ext.2, invoke.3)
+}
+
+fn loops(x: bits[32]) -> (bits[32], bits[32]) {
+  counted_for.5: bits[32] = counted_for(x, trip_count=2, stride=1, body=body)
+  counted_for.6: bits[32] = counted_for(x, trip_count=8, stride=1, body=body)
+  ret tuple.7: (bits[32], bits[32]) = tuple(counted_for.5, counted_for.6)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("loops"));
+  PassResults results;
+  PassOptions options;
+  // Besides its params the body is 3 nodes once "inner" is inlined, so the
+  // first loop unrolls to 6 nodes and the second to 24.
+  options.max_unrolled_node_count = 20;
+  EXPECT_THAT(UnrollPass().RunOnFunctionBase(f, options, &results),
+              IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(),
+              m::Tuple(m::Invoke(m::Literal(1), m::Invoke()), m::CountedFor()));
+
+  options.max_unrolled_node_count = 24;
+  EXPECT_THAT(UnrollPass().RunOnFunctionBase(f, options, &results),
+              IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Tuple(m::Invoke(), m::Invoke()));
+}
+
 }  // namespace
 }  // namespace xls
@@ -20,7 +20,10 @@ namespace xls {
 
 absl::Status VerifierChecker::Run(Package* p, const PassOptions& options,
                                   PassResults* results) const {
-  return VerifyPackage(p);
+  VerifierOptions verifier_options;
+  verifier_options.parallelism = options.function_parallelism;
+  verifier_options.checkpoint_key = checkpoint_key_;
+  return VerifyPackage(p, verifier_options);
 }
 
 }  // namespace xls
@@ -16,15 +16,24 @@
 #define XLS_PASSES_VERIFIER_CHECKER_H_
 
 #include "absl/status/status.h"
+#include "xls/ir/function_base.h"
 #include "xls/passes/passes.h"
 
 namespace xls {
 
 // Invariant checker which just runs xls::Verifier.
+// Invariant checker which runs the IR verifier. Functions are verified on up
+// to PassOptions::function_parallelism threads, and only the nodes changed
+// since the previous run of the checker are re-verified.
 class VerifierChecker : public InvariantChecker {
  public:
+  VerifierChecker() : checkpoint_key_(FunctionBase::NewCheckpointKey()) {}
+
   absl::Status Run(Package* p, const PassOptions& options,
                    PassResults* results) const override;
+
+ private:
+  const int64_t checkpoint_key_;
 };
 
 }  // namespace xls
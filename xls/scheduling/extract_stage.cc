@@ -15,9 +15,12 @@
 #include "xls/scheduling/extract_stage.h"
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "xls/common/status/status_macros.h"
@@ -26,53 +29,101 @@
 #include "xls/ir/nodes.h"
 
 namespace xls {
+namespace {
+
+// Builds the function holding the nodes of a single pipeline stage. Nodes of
+// the stage must be added in topological order.
+class StageBuilder {
+ public:
+  StageBuilder(Function* src, const PipelineSchedule& schedule, int stage)
+      : src_(src),
+        schedule_(schedule),
+        stage_(stage),
+        new_f_(std::make_unique<Function>(
+            absl::StrFormat("%s_stage_%d", src->name(), stage),
+            src->package())) {}
+
+  absl::Status AddNode(Node* node) {
+    std::vector<Node*> new_operands;
+    for (Node* operand : node->operands()) {
+      if (node_map_.contains(operand)) {
+        new_operands.push_back(node_map_.at(operand));
+      } else {
+        Node* new_param = new_f_->AddNode(
+            absl::make_unique<Param>(operand->loc(), operand->GetName(),
+                                     operand->GetType(), new_f_.get()));
+        node_map_[operand] = new_param;
+        new_operands.push_back(new_param);
+      }
+    }
+    XLS_ASSIGN_OR_RETURN(Node * new_node,
+                         node->CloneInNewFunction(new_operands, new_f_.get()));
+    node_map_[node] = new_node;
+    if (std::any_of(node->users().begin(), node->users().end(),
+                    [&](Node* u) { return schedule_.cycle(u) > stage_; })) {
+      live_out_.push_back(new_node);
+    }
+    return absl::OkStatus();
+  }
+
+  // Sets the return value of the stage function and adds it to the package.
+  absl::StatusOr<Function*> Finish() {
+    // If this stage doesn't include the function output, create a final tuple
+    // which gathers all nodes scheduled in the stage that are live out.
+    // The tuple will be the return value of the new function.
+    // Otherwise, just use the mapped function output.
+    if (node_map_.contains(src_->return_value())) {
+      XLS_RETURN_IF_ERROR(
+          new_f_->set_return_value(node_map_[src_->return_value()]));
+    } else {
+      XLS_ASSIGN_OR_RETURN(Node * return_tuple,
+                           new_f_->MakeNode<Tuple>(absl::nullopt, live_out_));
+      XLS_RETURN_IF_ERROR(new_f_->set_return_value(return_tuple));
+    }
+    return src_->package()->AddFunction(std::move(new_f_));
+  }
+
+ private:
+  Function* src_;
+  const PipelineSchedule& schedule_;
+  int stage_;
+  std::unique_ptr<Function> new_f_;
+  absl::flat_hash_map<Node*, Node*> node_map_;
+  std::vector<Node*> live_out_;
+};
+
+}  // namespace
 
 absl::StatusOr<Function*> ExtractStage(Function* src,
                                        const PipelineSchedule& schedule,
                                        int stage) {
   // Create a new function in the package which only contains the nodes at the
   // given stage (cycle).
-  Package* package = src->package();
-  auto new_f = std::make_unique<Function>(
-      absl::StrFormat("%s_stage_%d", src->name(), stage), package);
-  absl::flat_hash_map<Node*, Node*> node_map;
-  std::vector<Node*> live_out;
+  StageBuilder builder(src, schedule, stage);
   for (Node* node : TopoSort(src)) {
     if (schedule.cycle(node) == stage) {
-      std::vector<Node*> new_operands;
-      for (Node* operand : node->operands()) {
-        if (node_map.contains(operand)) {
-          new_operands.push_back(node_map.at(operand));
-        } else {
-          Node* new_param = new_f->AddNode(
-              absl::make_unique<Param>(operand->loc(), operand->GetName(),
-                                       operand->GetType(), new_f.get()));
-          node_map[operand] = new_param;
-          new_operands.push_back(new_param);
-        }
-      }
-      XLS_ASSIGN_OR_RETURN(Node * new_node,
-                           node->CloneInNewFunction(new_operands, new_f.get()));
-      node_map[node] = new_node;
-      if (std::any_of(node->users().begin(), node->users().end(),
-                      [&](Node* u) { return schedule.cycle(u) > stage; })) {
-        live_out.push_back(new_node);
-      }
+      XLS_RETURN_IF_ERROR(builder.AddNode(node));
     }
   }
+  return builder.Finish();
+}
 
-  // If this stage doesn't include the function output, create a final tuple
-  // which gathers all nodes scheduled in the stage that are live out.
-  // The tuple will be the return value of the new function.
-  // Otherwise, just use the mapped function output.
-  if (node_map.contains(src->return_value())) {
-    XLS_RETURN_IF_ERROR(new_f->set_return_value(node_map[src->return_value()]));
-  } else {
-    XLS_ASSIGN_OR_RETURN(Node * return_tuple,
-                         new_f->MakeNode<Tuple>(absl::nullopt, live_out));
-    XLS_RETURN_IF_ERROR(new_f->set_return_value(return_tuple));
+absl::StatusOr<std::vector<Function*>> ExtractAllStages(
+    Function* src, const PipelineSchedule& schedule) {
+  std::vector<StageBuilder> builders;
+  builders.reserve(schedule.length());
+  for (int stage = 0; stage < schedule.length(); ++stage) {
+    builders.emplace_back(src, schedule, stage);
+  }
+  for (Node* node : TopoSort(src)) {
+    XLS_RETURN_IF_ERROR(builders.at(schedule.cycle(node)).AddNode(node));
+  }
+  std::vector<Function*> stages;
+  for (StageBuilder& builder : builders) {
+    XLS_ASSIGN_OR_RETURN(Function * stage_f, builder.Finish());
+    stages.push_back(stage_f);
   }
-  return package->AddFunction(std::move(new_f));
+  return stages;
 }
 
 }  // namespace xls
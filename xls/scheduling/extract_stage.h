@@ -15,6 +15,8 @@
 #ifndef XLS_SCHEDULING_EXTRACT_STAGE_H_
 #define XLS_SCHEDULING_EXTRACT_STAGE_H_
 
+#include <vector>
+
 #include "absl/status/statusor.h"
 #include "xls/ir/function.h"
 #include "xls/scheduling/pipeline_schedule.h"
@@ -27,6 +29,11 @@ absl::StatusOr<Function*> ExtractStage(Function* src,
                                        const PipelineSchedule& schedule,
                                        int stage);
 
+// Extracts every stage of the schedule as ExtractStage would, in a single pass
+// over the nodes of the function. Returns the new functions in stage order.
+absl::StatusOr<std::vector<Function*>> ExtractAllStages(
+    Function* src, const PipelineSchedule& schedule);
+
 }  // namespace xls
 
 #endif  // XLS_SCHEDULING_EXTRACT_STAGE_H_
@@ -14,6 +14,9 @@
 
 #include "xls/scheduling/extract_stage.h"
 
+#include <string>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "xls/common/status/matchers.h"
@@ -138,5 +141,50 @@ fn main(i0: bits[3], i1: bits[1], i2: bits[8], i3: bits[23]) -> (bits[1], bits[8
   }
 }
 
+// Verifies extracting all stages at once matches extracting them one by one.
+TEST_F(ExtractStageTest, ExtractAllStages) {
+  std::string ir_text = R"(
+package p
+
+fn main(i0: bits[3], i1: bits[3]) -> bits[3] {
+  add.1: bits[3] = add(i0, i1)
+  sub.2: bits[3] = sub(add.1, i1)
+  or.3: bits[3] = or(sub.2, add.1)
+  ret and.4: bits[3] = and(or.3, i0)
+}
+)";
+
+  auto make_schedule = [&](Function* function) {
+    ScheduleCycleMap cycle_map;
+    cycle_map[FindNode("i0", function)] = 0;
+    cycle_map[FindNode("i1", function)] = 0;
+    cycle_map[FindNode("add.1", function)] = 0;
+    cycle_map[FindNode("sub.2", function)] = 1;
+    cycle_map[FindNode("or.3", function)] = 1;
+    cycle_map[FindNode("and.4", function)] = 2;
+    return PipelineSchedule(function, cycle_map, 3);
+  };
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto package, Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->GetFunction("main"));
+  PipelineSchedule schedule = make_schedule(function);
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Function*> stages,
+                           ExtractAllStages(function, schedule));
+  ASSERT_EQ(stages.size(), 3);
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto expected_package,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * expected_function,
+                           expected_package->GetFunction("main"));
+  PipelineSchedule expected_schedule = make_schedule(expected_function);
+  for (int i = 0; i < 3; i++) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        Function * expected_stage_fn,
+        ExtractStage(expected_function, expected_schedule, i));
+    EXPECT_EQ(stages[i]->DumpIr(), expected_stage_fn->DumpIr());
+  }
+  EXPECT_THAT(stages[2]->return_value(), m::And(m::Param(), m::Param("i0")));
+}
+
 }  // namespace
 }  // namespace xls
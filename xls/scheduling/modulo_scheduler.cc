@@ -0,0 +1,144 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/scheduling/modulo_scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace sched {
+
+bool IsShareableOp(Op op) {
+  switch (op) {
+    case Op::kSDiv:
+    case Op::kSMod:
+    case Op::kSMul:
+    case Op::kUDiv:
+    case Op::kUMod:
+    case Op::kUMul:
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::string SharedOperatorKey(Node* node) {
+  std::string key =
+      absl::StrCat(OpToString(node->op()), ":", node->GetType()->ToString());
+  for (Node* operand : node->operands()) {
+    absl::StrAppend(&key, ":", operand->GetType()->ToString());
+  }
+  return key;
+}
+
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>> ModuloSchedule(
+    Function* f, int64_t initiation_interval,
+    const absl::flat_hash_map<Op, int64_t>& resource_limits,
+    absl::optional<int64_t> pipeline_stages, int64_t clock_period_ps,
+    const DelayEstimator& delay_estimator) {
+  XLS_RET_CHECK_GE(initiation_interval, 1);
+  for (const auto& [op, limit] : resource_limits) {
+    if (!IsShareableOp(op)) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Operation %s cannot be resource limited", OpToString(op)));
+    }
+    if (limit < 1) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Resource limit of operation %s must be positive, is %d",
+          OpToString(op), limit));
+    }
+  }
+
+  // The cycle of each node and the delay from the start of its cycle through
+  // the node.
+  absl::flat_hash_map<Node*, int64_t> cycle;
+  absl::flat_hash_map<Node*, int64_t> cycle_delay;
+  // The modulo reservation table: the number of operations of each operator
+  // key placed in cycles congruent to each slot modulo the initiation
+  // interval.
+  absl::flat_hash_map<std::string, std::vector<int64_t>> reservations;
+  int64_t max_cycle = 0;
+  for (Node* node : TopoSort(f)) {
+    XLS_ASSIGN_OR_RETURN(int64_t node_delay,
+                         delay_estimator.GetOperationDelayInPs(node));
+    XLS_RET_CHECK_LE(node_delay, clock_period_ps) << node;
+
+    // The earliest cycle satisfying the dependencies, and the delay through the
+    // node if placed in that cycle.
+    int64_t node_cycle = 0;
+    int64_t node_start = 0;
+    for (Node* operand : node->operands()) {
+      if (cycle.at(operand) > node_cycle) {
+        node_cycle = cycle.at(operand);
+        node_start = 0;
+      }
+      if (cycle.at(operand) == node_cycle) {
+        node_start = std::max(node_start, cycle_delay.at(operand));
+      }
+    }
+    if (node_start + node_delay > clock_period_ps) {
+      ++node_cycle;
+      node_start = 0;
+    }
+
+    auto limit_it = resource_limits.find(node->op());
+    if (limit_it != resource_limits.end()) {
+      // Delay the node until a cycle with a free operator instance. Each
+      // instance can compute one operation per slot.
+      std::vector<int64_t>& slots = reservations[SharedOperatorKey(node)];
+      slots.resize(initiation_interval, 0);
+      if (absl::c_all_of(slots, [&](int64_t count) {
+            return count >= limit_it->second;
+          })) {
+        return absl::ResourceExhaustedError(absl::StrFormat(
+            "Cannot schedule node %s: %d instances of %s with initiation "
+            "interval %d can compute at most %d operations",
+            node->GetName(), limit_it->second, OpToString(node->op()),
+            initiation_interval, limit_it->second * initiation_interval));
+      }
+      while (slots[node_cycle % initiation_interval] >= limit_it->second) {
+        ++node_cycle;
+        node_start = 0;
+      }
+      ++slots[node_cycle % initiation_interval];
+    }
+
+    cycle[node] = node_cycle;
+    cycle_delay[node] = node_start + node_delay;
+    max_cycle = std::max(max_cycle, node_cycle);
+    XLS_VLOG(4) << absl::StreamFormat("Scheduled %s in cycle %d",
+                                      node->GetName(), node_cycle);
+  }
+
+  if (pipeline_stages.has_value() && max_cycle >= *pipeline_stages) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Cannot be scheduled in %d stages with initiation interval %d and the "
+        "given resource limits. Modulo schedule requires %d stages.",
+        *pipeline_stages, initiation_interval, max_cycle + 1));
+  }
+  return cycle;
+}
+
+}  // namespace sched
+}  // namespace xls
@@ -0,0 +1,69 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SCHEDULING_MODULO_SCHEDULER_H_
+#define XLS_SCHEDULING_MODULO_SCHEDULER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/ir/op.h"
+
+namespace xls {
+namespace sched {
+
+// Returns whether operations with the given op may share a single operator
+// instance in a pipeline with an initiation interval greater than one. Only
+// operations expensive enough to be worth the operand multiplexers are shared.
+bool IsShareableOp(Op op);
+
+// Returns a key identifying the operator instances which can implement the
+// given node: two nodes can share an operator iff their keys are equal, which
+// requires the same op and the same operand and result types.
+std::string SharedOperatorKey(Node* node);
+
+// Schedules the nodes of the function for a pipeline which accepts a new input
+// every 'initiation_interval' cycles. In such a pipeline a stage is active only
+// in the cycles congruent to its index modulo the initiation interval, so
+// operations in stages which differ modulo the initiation interval are never
+// active at the same time and can share an operator instance.
+//
+// 'resource_limits' gives the number of operator instances available for each
+// shareable op (see IsShareableOp). The limit applies separately to each
+// operator key (see SharedOperatorKey) as only identically typed operations
+// can share an instance. Nodes are placed in topological order in the earliest
+// cycle which satisfies the dependency and timing constraints and which has a
+// free instance in the modulo reservation table, i.e., fewer than the limit of
+// operations of the same key in cycles congruent modulo the initiation
+// interval.
+//
+// Returns a map from node to cycle, or an error if the operations of a key
+// outnumber its instances times the initiation interval or the resulting
+// schedule is longer than 'pipeline_stages' (if given).
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>> ModuloSchedule(
+    Function* f, int64_t initiation_interval,
+    const absl::flat_hash_map<Op, int64_t>& resource_limits,
+    absl::optional<int64_t> pipeline_stages, int64_t clock_period_ps,
+    const DelayEstimator& delay_estimator);
+
+}  // namespace sched
+}  // namespace xls
+
+#endif  // XLS_SCHEDULING_MODULO_SCHEDULER_H_
@@ -0,0 +1,368 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/scheduling/multiway_partition.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/optional.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace sched {
+namespace {
+
+// The maximum number of refinement passes from each starting schedule.
+constexpr int64_t kMaxPasses = 16;
+
+// The function with nodes identified by their index in a topological sort.
+struct Graph {
+  std::vector<Node*> nodes;
+
+  // The distinct operands and users of each node.
+  std::vector<std::vector<int64_t>> operands;
+  std::vector<std::vector<int64_t>> users;
+
+  std::vector<int64_t> delay_ps;
+  std::vector<int64_t> bit_count;
+  std::vector<int64_t> lb;
+  std::vector<int64_t> ub;
+  int64_t clock_period_ps;
+};
+
+absl::StatusOr<Graph> BuildGraph(Function* f, int64_t clock_period_ps,
+                                 const DelayEstimator& delay_estimator,
+                                 const ScheduleBounds& bounds) {
+  Graph graph;
+  graph.clock_period_ps = clock_period_ps;
+  absl::flat_hash_map<Node*, int64_t> node_index;
+  for (Node* node : TopoSort(f)) {
+    node_index[node] = graph.nodes.size();
+    graph.nodes.push_back(node);
+    XLS_ASSIGN_OR_RETURN(int64_t delay,
+                         delay_estimator.GetOperationDelayInPs(node));
+    graph.delay_ps.push_back(delay);
+    graph.bit_count.push_back(node->GetType()->GetFlatBitCount());
+    graph.lb.push_back(bounds.lb(node));
+    graph.ub.push_back(bounds.ub(node));
+  }
+  auto distinct_indices = [&](absl::Span<Node* const> nodes) {
+    std::vector<int64_t> indices;
+    for (Node* node : nodes) {
+      indices.push_back(node_index.at(node));
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    return indices;
+  };
+  for (Node* node : graph.nodes) {
+    graph.operands.push_back(distinct_indices(node->operands()));
+    std::vector<Node*> users(node->users().begin(), node->users().end());
+    graph.users.push_back(distinct_indices(users));
+  }
+  return graph;
+}
+
+// A schedule of the graph being refined. Alongside the cycle of each node, it
+// keeps the longest combinational path within the node's stage which ends
+// (arrival) and which starts (departure) at the node, both including the delay
+// of the node itself, so the timing of a move can be checked locally.
+class Refinement {
+ public:
+  Refinement(const Graph* graph, std::vector<int64_t> cycles)
+      : graph_(graph),
+        cycles_(std::move(cycles)),
+        arrival_ps_(cycles_.size()),
+        departure_ps_(cycles_.size()) {}
+
+  // Computes the path delays, and checks that the initial schedule meets the
+  // clock period.
+  absl::Status Initialize() {
+    for (int64_t i = 0; i < cycles_.size(); ++i) {
+      arrival_ps_[i] = ComputeArrival(i);
+      XLS_RET_CHECK_LE(arrival_ps_[i], graph_->clock_period_ps)
+          << graph_->nodes[i]->GetName();
+      for (int64_t operand : graph_->operands[i]) {
+        XLS_RET_CHECK_LE(cycles_[operand], cycles_[i])
+            << graph_->nodes[i]->GetName();
+      }
+    }
+    for (int64_t i = cycles_.size() - 1; i >= 0; --i) {
+      departure_ps_[i] = ComputeDeparture(i);
+    }
+    return absl::OkStatus();
+  }
+
+  // Makes passes of refinement while they reduce the register count.
+  void Refine() {
+    for (int64_t pass = 0; pass < kMaxPasses; ++pass) {
+      int64_t gain = RunPass();
+      XLS_VLOG(4) << absl::StreamFormat("Pass %d removed %d register bits",
+                                        pass, gain);
+      if (gain <= 0) {
+        break;
+      }
+    }
+  }
+
+  int64_t RegisterCount() const {
+    int64_t count = 0;
+    for (int64_t i = 0; i < cycles_.size(); ++i) {
+      count += RegisterCost(i);
+    }
+    return count;
+  }
+
+  const std::vector<int64_t>& cycles() const { return cycles_; }
+
+ private:
+  // Returns the number of register bits holding the value of node i.
+  int64_t RegisterCost(int64_t i) const {
+    int64_t latest_use = cycles_[i];
+    for (int64_t user : graph_->users[i]) {
+      latest_use = std::max(latest_use, cycles_[user]);
+    }
+    return graph_->bit_count[i] * (latest_use - cycles_[i]);
+  }
+
+  int64_t ComputeArrival(int64_t i) const {
+    int64_t start_ps = 0;
+    for (int64_t operand : graph_->operands[i]) {
+      if (cycles_[operand] == cycles_[i]) {
+        start_ps = std::max(start_ps, arrival_ps_[operand]);
+      }
+    }
+    return start_ps + graph_->delay_ps[i];
+  }
+
+  int64_t ComputeDeparture(int64_t i) const {
+    int64_t rest_ps = 0;
+    for (int64_t user : graph_->users[i]) {
+      if (cycles_[user] == cycles_[i]) {
+        rest_ps = std::max(rest_ps, departure_ps_[user]);
+      }
+    }
+    return graph_->delay_ps[i] + rest_ps;
+  }
+
+  // Returns the number of register bits saved by moving node i one cycle in
+  // "direction" (-1 or 1), or nullopt if the move is illegal.
+  absl::optional<int64_t> MoveGain(int64_t i, int64_t direction) {
+    int64_t cycle = cycles_[i] + direction;
+    if (cycle < graph_->lb[i] || cycle > graph_->ub[i]) {
+      return absl::nullopt;
+    }
+    // The node joins the stage of its operands (users) in "cycle", so the
+    // paths through it are those ending at the operands (starting at the
+    // users) extended by the node.
+    int64_t path_ps = 0;
+    const std::vector<int64_t>& neighbors =
+        direction > 0 ? graph_->users[i] : graph_->operands[i];
+    for (int64_t neighbor : neighbors) {
+      if (direction > 0 ? cycles_[neighbor] < cycle
+                        : cycles_[neighbor] > cycle) {
+        return absl::nullopt;
+      }
+      if (cycles_[neighbor] == cycle) {
+        path_ps = std::max(path_ps, direction > 0 ? departure_ps_[neighbor]
+                                                  : arrival_ps_[neighbor]);
+      }
+    }
+    if (path_ps + graph_->delay_ps[i] > graph_->clock_period_ps) {
+      return absl::nullopt;
+    }
+
+    // Only the registers of the node and of its operands change.
+    auto affected_cost = [&]() {
+      int64_t cost = RegisterCost(i);
+      for (int64_t operand : graph_->operands[i]) {
+        cost += RegisterCost(operand);
+      }
+      return cost;
+    };
+    int64_t before = affected_cost();
+    cycles_[i] = cycle;
+    int64_t after = affected_cost();
+    cycles_[i] = cycle - direction;
+    return before - after;
+  }
+
+  // Moves node i one cycle in "direction" and updates the path delays. Only
+  // the paths through the node change: the arrivals of its descendants and the
+  // departures of its ancestors, in both the stage it leaves and the one it
+  // joins.
+  void Move(int64_t i, int64_t direction) {
+    cycles_[i] += direction;
+
+    std::set<int64_t> forward(graph_->users[i].begin(),
+                              graph_->users[i].end());
+    arrival_ps_[i] = ComputeArrival(i);
+    while (!forward.empty()) {
+      int64_t j = *forward.begin();
+      forward.erase(forward.begin());
+      int64_t arrival_ps = ComputeArrival(j);
+      if (arrival_ps != arrival_ps_[j]) {
+        arrival_ps_[j] = arrival_ps;
+        for (int64_t user : graph_->users[j]) {
+          if (cycles_[user] == cycles_[j]) {
+            forward.insert(user);
+          }
+        }
+      }
+    }
+
+    std::set<int64_t, std::greater<int64_t>> backward(
+        graph_->operands[i].begin(), graph_->operands[i].end());
+    departure_ps_[i] = ComputeDeparture(i);
+    while (!backward.empty()) {
+      int64_t j = *backward.begin();
+      backward.erase(backward.begin());
+      int64_t departure_ps = ComputeDeparture(j);
+      if (departure_ps != departure_ps_[j]) {
+        departure_ps_[j] = departure_ps;
+        for (int64_t operand : graph_->operands[j]) {
+          if (cycles_[operand] == cycles_[j]) {
+            backward.insert(operand);
+          }
+        }
+      }
+    }
+  }
+
+  // Runs a pass of refinement: repeatedly makes the legal move with the
+  // largest gain among the nodes not yet moved, then undoes the moves past the
+  // point of largest total gain. Returns that gain.
+  int64_t RunPass() {
+    // Candidates are ordered by gain, then by lowest node index.
+    using Candidate = std::tuple<int64_t, int64_t, int64_t>;
+    std::priority_queue<Candidate> candidates;
+    std::vector<bool> moved(cycles_.size(), false);
+    auto consider = [&](int64_t i) {
+      if (moved[i]) {
+        return;
+      }
+      for (int64_t direction : {-1, 1}) {
+        absl::optional<int64_t> gain = MoveGain(i, direction);
+        if (gain.has_value()) {
+          candidates.push({*gain, -i, direction});
+        }
+      }
+    };
+    for (int64_t i = 0; i < cycles_.size(); ++i) {
+      consider(i);
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> moves;
+    int64_t total_gain = 0;
+    int64_t best_gain = 0;
+    int64_t best_move_count = 0;
+    while (!candidates.empty()) {
+      auto [gain, negated_index, direction] = candidates.top();
+      candidates.pop();
+      int64_t i = -negated_index;
+      if (moved[i]) {
+        continue;
+      }
+      // The gain may have changed since the candidate was queued by moves of
+      // nearby nodes.
+      absl::optional<int64_t> current_gain = MoveGain(i, direction);
+      if (!current_gain.has_value()) {
+        continue;
+      }
+      if (*current_gain != gain) {
+        candidates.push({*current_gain, negated_index, direction});
+        continue;
+      }
+      Move(i, direction);
+      moved[i] = true;
+      moves.push_back({i, direction});
+      total_gain += gain;
+      if (total_gain > best_gain) {
+        best_gain = total_gain;
+        best_move_count = moves.size();
+      }
+      // Requeue the nodes whose legality or gain the move may have changed.
+      for (int64_t user : graph_->users[i]) {
+        consider(user);
+      }
+      for (int64_t operand : graph_->operands[i]) {
+        consider(operand);
+        for (int64_t sibling : graph_->users[operand]) {
+          consider(sibling);
+        }
+      }
+    }
+    while (moves.size() > best_move_count) {
+      Move(moves.back().first, -moves.back().second);
+      moves.pop_back();
+    }
+    return best_gain;
+  }
+
+  const Graph* graph_;
+  std::vector<int64_t> cycles_;
+  std::vector<int64_t> arrival_ps_;
+  std::vector<int64_t> departure_ps_;
+};
+
+}  // namespace
+
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>> MultiwayPartitionSchedule(
+    Function* f, int64_t pipeline_stages, int64_t clock_period_ps,
+    const DelayEstimator& delay_estimator, const ScheduleBounds& bounds) {
+  XLS_ASSIGN_OR_RETURN(
+      Graph graph, BuildGraph(f, clock_period_ps, delay_estimator, bounds));
+  for (int64_t i = 0; i < graph.nodes.size(); ++i) {
+    XLS_RET_CHECK(graph.lb[i] >= 0 && graph.ub[i] < pipeline_stages)
+        << graph.nodes[i]->GetName();
+  }
+
+  absl::optional<Refinement> best;
+  int64_t best_register_count = std::numeric_limits<int64_t>::max();
+  for (const std::vector<int64_t>* start : {&graph.lb, &graph.ub}) {
+    Refinement refinement(&graph, *start);
+    XLS_RETURN_IF_ERROR(refinement.Initialize());
+    int64_t initial_register_count = refinement.RegisterCount();
+    refinement.Refine();
+    int64_t register_count = refinement.RegisterCount();
+    XLS_VLOG(3) << absl::StreamFormat(
+        "Refined the %s schedule from %d to %d register bits",
+        start == &graph.lb ? "ASAP" : "ALAP", initial_register_count,
+        register_count);
+    if (register_count < best_register_count) {
+      best = std::move(refinement);
+      best_register_count = register_count;
+    }
+  }
+
+  absl::flat_hash_map<Node*, int64_t> cycle_map;
+  for (int64_t i = 0; i < graph.nodes.size(); ++i) {
+    cycle_map[graph.nodes[i]] = best->cycles()[i];
+  }
+  return cycle_map;
+}
+
+}  // namespace sched
+}  // namespace xls
@@ -0,0 +1,58 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SCHEDULING_MULTIWAY_PARTITION_H_
+#define XLS_SCHEDULING_MULTIWAY_PARTITION_H_
+
+#include <cstdint>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/scheduling/schedule_bounds.h"
+
+namespace xls {
+namespace sched {
+
+// Schedules the nodes of the function into the given number of pipeline stages
+// such that the total number of pipeline register bits is small, placing all
+// stage boundaries in one run rather than one min-cut per boundary as
+// MINIMIZE_REGISTERS does.
+//
+// Starting from both the ASAP and the ALAP schedule, passes of
+// Fiduccia-Mattheyses style refinement move single nodes to the adjacent
+// earlier or later stage. A move is legal if the node stays within its bounds,
+// after its operands and before its users, and no combinational path within a
+// stage exceeds the clock period. Each pass makes the best legal move of a node
+// not yet moved in the pass until there are none (even if that increases the
+// register count, which lets the search escape local minima), then rolls back
+// to the best schedule seen. Passes repeat while they improve the schedule, and
+// the better of the two final schedules is returned.
+//
+// The register cost of a node is its bit count times the number of cycles from
+// its cycle to that of its latest user. Unlike min-cut this is a heuristic, but
+// its cost does not grow with the number of stages.
+//
+// "bounds" must be propagated for the clock period (see ScheduleBounds) and all
+// upper bounds must be less than "pipeline_stages".
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>> MultiwayPartitionSchedule(
+    Function* f, int64_t pipeline_stages, int64_t clock_period_ps,
+    const DelayEstimator& delay_estimator, const ScheduleBounds& bounds);
+
+}  // namespace sched
+}  // namespace xls
+
+#endif  // XLS_SCHEDULING_MULTIWAY_PARTITION_H_
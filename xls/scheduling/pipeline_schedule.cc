@@ -14,6 +14,13 @@
 
 #include "xls/scheduling/pipeline_schedule.h"
 
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -21,10 +28,15 @@
 #include "xls/common/logging/log_lines.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
+#include "xls/common/thread.h"
+#include "xls/common/trace.h"
 #include "xls/data_structures/binary_search.h"
 #include "xls/ir/node_iterator.h"
 #include "xls/scheduling/function_partition.h"
+#include "xls/scheduling/modulo_scheduler.h"
+#include "xls/scheduling/multiway_partition.h"
 #include "xls/scheduling/schedule_bounds.h"
+#include "xls/scheduling/sdc_scheduler.h"
 
 namespace xls {
 namespace {
@@ -103,11 +115,10 @@ absl::StatusOr<ScheduleCycleMap> ScheduleToMinimizeRegisters(
   XLS_VLOG_LINES(4, bounds->ToString());
 
   // Try a number of different orderings of cycle boundary at which the min-cut
-  // is performed and keep the best one.
-  int64_t best_register_count;
-  absl::optional<sched::ScheduleBounds> best_bounds;
-  for (const std::vector<int64_t>& cut_order :
-       GetMinCutCycleOrders(pipeline_stages - 1)) {
+  // is performed and keep the best one. The orderings are independent so they
+  // are tried concurrently.
+  auto try_cut_order = [&](const std::vector<int64_t>& cut_order)
+      -> absl::StatusOr<sched::ScheduleBounds> {
     XLS_VLOG(3) << absl::StreamFormat("Trying cycle order: {%s}",
                                       absl::StrJoin(cut_order, ", "));
     sched::ScheduleBounds trial_bounds = *bounds;
@@ -121,11 +132,32 @@ absl::StatusOr<ScheduleCycleMap> ScheduleToMinimizeRegisters(
       XLS_RETURN_IF_ERROR(trial_bounds.PropagateLowerBounds());
       XLS_RETURN_IF_ERROR(trial_bounds.PropagateUpperBounds());
     }
+    return trial_bounds;
+  };
+  std::vector<std::vector<int64_t>> cut_orders =
+      GetMinCutCycleOrders(pipeline_stages - 1);
+  std::vector<absl::StatusOr<sched::ScheduleBounds>> trials(cut_orders.size());
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 1; i < cut_orders.size(); ++i) {
+      threads.push_back(std::make_unique<Thread>(
+          [&, i]() { trials[i] = try_cut_order(cut_orders[i]); }));
+    }
+    trials[0] = try_cut_order(cut_orders[0]);
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+
+  int64_t best_register_count;
+  absl::optional<sched::ScheduleBounds> best_bounds;
+  for (absl::StatusOr<sched::ScheduleBounds>& trial_bounds : trials) {
+    XLS_RETURN_IF_ERROR(trial_bounds.status());
     XLS_ASSIGN_OR_RETURN(int64_t trial_register_count,
-                         CountInteriorPipelineRegisters(f, trial_bounds));
+                         CountInteriorPipelineRegisters(f, *trial_bounds));
     if (!best_bounds.has_value() ||
         best_register_count > trial_register_count) {
-      best_bounds = std::move(trial_bounds);
+      best_bounds = std::move(*trial_bounds);
       best_register_count = trial_register_count;
     }
   }
@@ -161,12 +193,10 @@ absl::StatusOr<int64_t> FunctionCriticalPath(
 // Returns the minimum clock period in picoseconds for which it is feasible to
 // schedule the function into a pipeline with the given number of stages.
 absl::StatusOr<int64_t> FindMinimumClockPeriod(
-    Function* f, int64_t pipeline_stages,
+    Function* f, const std::vector<Node*>& topo_sort, int64_t pipeline_stages,
     const DelayEstimator& delay_estimator) {
   XLS_VLOG(4) << "FindMinimumClockPeriod()";
   XLS_VLOG(4) << "  pipeline stages = " << pipeline_stages;
-  auto topo_sort_it = TopoSort(f);
-  std::vector<Node*> topo_sort(topo_sort_it.begin(), topo_sort_it.end());
   XLS_ASSIGN_OR_RETURN(int64_t function_cp,
                        FunctionCriticalPath(topo_sort, delay_estimator));
   // The lower bound of the search is the critical path delay evenly distributed
@@ -224,6 +254,286 @@ std::vector<int64_t> MiddleFirstOrder(int64_t first, int64_t last) {
   return ret;
 }
 
+// Returns the clock period to schedule the function with under the given
+// options: the target clock period less the clock margin, or the minimum
+// feasible clock period if only a pipeline length is given.
+absl::StatusOr<int64_t> ComputeClockPeriod(
+    Function* f, const std::vector<Node*>& topo_sort,
+    const DelayEstimator& delay_estimator, const SchedulingOptions& options) {
+  int64_t clock_period_ps;
+  if (options.clock_period_ps().has_value()) {
+    clock_period_ps = *options.clock_period_ps();
+
+    if (options.clock_margin_percent().has_value()) {
+      int64_t original_clock_period_ps = clock_period_ps;
+      clock_period_ps -=
+          (clock_period_ps * options.clock_margin_percent().value() + 50) / 100;
+      if (clock_period_ps <= 0) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Clock period non-positive (%dps) after adjusting for margin. "
+            "Original clock period: %dps, clock margin: %d%%",
+            clock_period_ps, original_clock_period_ps,
+            *options.clock_margin_percent()));
+      }
+    }
+  } else {
+    XLS_RET_CHECK(options.pipeline_stages().has_value());
+    // A pipeline length is specified, but no target clock period. Determine
+    // the minimum clock period for which the function can be scheduled in the
+    // given pipeline length.
+    XLS_ASSIGN_OR_RETURN(
+        clock_period_ps,
+        FindMinimumClockPeriod(f, topo_sort, *options.pipeline_stages(),
+                               delay_estimator));
+  }
+  return clock_period_ps;
+}
+
+// Pins the nodes of the function named in the schedule "previous" to their
+// cycles in it, as far as "bounds" allow, tightening "bounds" accordingly.
+// Returns the number of nodes pinned.
+absl::StatusOr<int64_t> PinToPreviousSchedule(
+    const std::vector<Node*>& topo_sort, const PipelineScheduleProto& previous,
+    sched::ScheduleBounds* bounds) {
+  absl::flat_hash_map<std::string, int64_t> previous_cycles;
+  for (const StageProto& stage : previous.stages()) {
+    for (const std::string& name : stage.nodes()) {
+      previous_cycles[name] = stage.stage();
+    }
+  }
+  std::vector<std::pair<Node*, int64_t>> pins;
+  for (Node* node : topo_sort) {
+    auto it = previous_cycles.find(node->GetName());
+    if (it != previous_cycles.end()) {
+      pins.push_back({node, it->second});
+    }
+  }
+
+  // Returns whether all of "node_pins" fit in the bounds "b", pinning them if
+  // so. Infeasible bounds are reported as ResourceExhausted.
+  auto try_pin = [](absl::Span<const std::pair<Node*, int64_t>> node_pins,
+                    sched::ScheduleBounds* b) -> absl::StatusOr<bool> {
+    absl::Status status;
+    for (const auto& [node, cycle] : node_pins) {
+      status = b->TightenNodeLb(node, cycle);
+      if (status.ok()) {
+        status = b->TightenNodeUb(node, cycle);
+      }
+      if (!status.ok()) {
+        break;
+      }
+    }
+    if (status.ok()) {
+      status = b->PropagateLowerBounds();
+    }
+    if (status.ok()) {
+      status = b->PropagateUpperBounds();
+    }
+    if (absl::IsResourceExhausted(status)) {
+      return false;
+    }
+    XLS_RETURN_IF_ERROR(status);
+    return true;
+  };
+
+  // Usually all the previous cycles are still feasible.
+  sched::ScheduleBounds trial = *bounds;
+  XLS_ASSIGN_OR_RETURN(bool all_pinned, try_pin(pins, &trial));
+  if (all_pinned) {
+    *bounds = std::move(trial);
+    return pins.size();
+  }
+
+  // Otherwise the changes conflict with some of them, so the nodes are pinned
+  // one at a time (in topological order), skipping those which can't be.
+  int64_t pin_count = 0;
+  for (const std::pair<Node*, int64_t>& pin : pins) {
+    if (pin.second < bounds->lb(pin.first) ||
+        pin.second > bounds->ub(pin.first)) {
+      continue;
+    }
+    trial = *bounds;
+    XLS_ASSIGN_OR_RETURN(bool pinned, try_pin({pin}, &trial));
+    if (pinned) {
+      *bounds = std::move(trial);
+      ++pin_count;
+    }
+  }
+  return pin_count;
+}
+
+// Schedules the function with the given options and clock period (as computed
+// by ComputeClockPeriod).
+absl::StatusOr<PipelineSchedule> ScheduleWithClockPeriod(
+    Function* f, const std::vector<Node*>& topo_sort,
+    const DelayEstimator& delay_estimator, const SchedulingOptions& options,
+    int64_t clock_period_ps) {
+  if (options.strategy() != SchedulingStrategy::MODULO &&
+      (options.initiation_interval() != 1 ||
+       !options.resource_limits().empty())) {
+    return absl::InvalidArgumentError(
+        "An initiation interval or resource limits require the MODULO "
+        "scheduling strategy");
+  }
+  if (options.initiation_interval() < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Initiation interval must be positive, is %d",
+                        options.initiation_interval()));
+  }
+
+  sched::ScheduleBounds bounds(f, topo_sort, clock_period_ps, delay_estimator);
+  XLS_RETURN_IF_ERROR(bounds.PropagateLowerBounds());
+
+  if (options.warm_start().has_value() &&
+      options.strategy() != SchedulingStrategy::MINIMIZE_REGISTERS &&
+      options.strategy() != SchedulingStrategy::MULTIWAY_PARTITION &&
+      options.strategy() != SchedulingStrategy::ASAP) {
+    return absl::InvalidArgumentError(
+        "Starting from a previous schedule requires the MINIMIZE_REGISTERS, "
+        "MULTIWAY_PARTITION or ASAP scheduling strategy");
+  }
+
+  int64_t max_ub;
+  if (options.pipeline_stages().has_value()) {
+    if (*options.pipeline_stages() < bounds.max_lower_bound()) {
+      return absl::ResourceExhaustedError(absl::StrFormat(
+          "Cannot be scheduled in %d stages. Computed lower bound is %d.",
+          *options.pipeline_stages(), bounds.max_lower_bound()));
+    }
+    max_ub = *options.pipeline_stages() - 1;
+  } else {
+    max_ub = bounds.max_lower_bound();
+    if (options.warm_start().has_value()) {
+      // Keep the previous pipeline length if it is longer than necessary.
+      for (const StageProto& stage : options.warm_start()->stages()) {
+        max_ub = std::max<int64_t>(max_ub, stage.stage());
+      }
+    }
+  }
+
+  for (Node* node : f->nodes()) {
+    XLS_RETURN_IF_ERROR(bounds.TightenNodeUb(node, max_ub));
+  }
+  XLS_RETURN_IF_ERROR(bounds.PropagateUpperBounds());
+  if (options.warm_start().has_value()) {
+    XLS_ASSIGN_OR_RETURN(
+        int64_t pin_count,
+        PinToPreviousSchedule(topo_sort, *options.warm_start(), &bounds));
+    XLS_VLOG(2) << absl::StreamFormat(
+        "Kept %d of %d nodes in their cycles of the previous schedule",
+        pin_count, f->node_count());
+  }
+  ScheduleCycleMap cycle_map;
+  if (options.strategy() == SchedulingStrategy::MINIMIZE_REGISTERS) {
+    XLS_ASSIGN_OR_RETURN(
+        cycle_map,
+        ScheduleToMinimizeRegisters(f, max_ub + 1, delay_estimator, &bounds));
+  } else if (options.strategy() == SchedulingStrategy::MULTIWAY_PARTITION) {
+    XLS_ASSIGN_OR_RETURN(cycle_map, sched::MultiwayPartitionSchedule(
+                                        f, max_ub + 1, clock_period_ps,
+                                        delay_estimator, bounds));
+  } else if (options.strategy() == SchedulingStrategy::SDC) {
+    XLS_ASSIGN_OR_RETURN(cycle_map,
+                         sched::SdcScheduleToMinimizeRegisters(
+                             f, max_ub + 1, clock_period_ps, delay_estimator));
+  } else if (options.strategy() == SchedulingStrategy::MODULO) {
+    XLS_ASSIGN_OR_RETURN(
+        cycle_map, sched::ModuloSchedule(
+                       f, options.initiation_interval(),
+                       options.resource_limits(), options.pipeline_stages(),
+                       clock_period_ps, delay_estimator));
+  } else {
+    XLS_RET_CHECK(options.strategy() == SchedulingStrategy::ASAP);
+    XLS_RET_CHECK(!options.pipeline_stages().has_value());
+    // Just schedule everything as soon as possible.
+    for (Node* node : f->nodes()) {
+      cycle_map[node] = bounds.lb(node);
+    }
+  }
+  auto schedule = PipelineSchedule(f, cycle_map, options.pipeline_stages(),
+                                   options.initiation_interval());
+  XLS_RETURN_IF_ERROR(schedule.VerifyTiming(clock_period_ps, delay_estimator));
+  XLS_VLOG_LINES(3, "Schedule\n" + schedule.ToString());
+  return schedule;
+}
+
+// A delay estimator which returns the delays of the nodes of one function
+// computed up front by another estimator. Lookups are read-only, so a single
+// instance can be shared by concurrent scheduling runs.
+class PrecomputedDelayEstimator : public DelayEstimator {
+ public:
+  static absl::StatusOr<std::unique_ptr<PrecomputedDelayEstimator>> Create(
+      Function* f, const DelayEstimator& delay_estimator) {
+    auto estimator = absl::WrapUnique(new PrecomputedDelayEstimator());
+    for (Node* node : f->nodes()) {
+      XLS_ASSIGN_OR_RETURN(estimator->delays_[node],
+                           delay_estimator.GetOperationDelayInPs(node));
+    }
+    return estimator;
+  }
+
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override {
+    auto it = delays_.find(node);
+    if (it == delays_.end()) {
+      return absl::NotFoundError(
+          absl::StrFormat("No precomputed delay for node %s", node->GetName()));
+    }
+    return it->second;
+  }
+
+ private:
+  PrecomputedDelayEstimator() = default;
+
+  absl::flat_hash_map<Node*, int64_t> delays_;
+};
+
+// Returns the number of pipeline registers (flops) on the interior of the
+// given schedule.
+int64_t CountScheduleRegisters(const PipelineSchedule& schedule) {
+  int64_t registers = 0;
+  for (Node* node : schedule.function()->nodes()) {
+    int64_t latest_use = schedule.cycle(node);
+    for (Node* user : node->users()) {
+      latest_use = std::max(latest_use, schedule.cycle(user));
+    }
+    registers += node->GetType()->GetFlatBitCount() *
+                 (latest_use - schedule.cycle(node));
+  }
+  return registers;
+}
+
+// Returns the delay of the longest path of nodes scheduled in the same cycle.
+absl::StatusOr<int64_t> LongestStagePath(
+    const PipelineSchedule& schedule, absl::Span<Node* const> topo_sort,
+    const DelayEstimator& delay_estimator) {
+  int64_t longest_path = 0;
+  absl::flat_hash_map<Node*, int64_t> node_cp;
+  for (Node* node : topo_sort) {
+    int64_t node_start = 0;
+    for (Node* operand : node->operands()) {
+      if (schedule.cycle(operand) == schedule.cycle(node)) {
+        node_start = std::max(node_start, node_cp.at(operand));
+      }
+    }
+    XLS_ASSIGN_OR_RETURN(int64_t node_delay,
+                         delay_estimator.GetOperationDelayInPs(node));
+    node_cp[node] = node_start + node_delay;
+    longest_path = std::max(longest_path, node_cp[node]);
+  }
+  return longest_path;
+}
+
+// Returns whether sweep point 'a' is at least as good as 'b' in clock period,
+// stages, registers and slack, and strictly better in at least one of them.
+bool Dominates(const ScheduleSweepPoint& a, const ScheduleSweepPoint& b) {
+  if (a.clock_period_ps > b.clock_period_ps || a.stages > b.stages ||
+      a.registers > b.registers || a.slack_ps < b.slack_ps) {
+    return false;
+  }
+  return a.clock_period_ps < b.clock_period_ps || a.stages < b.stages ||
+         a.registers < b.registers || a.slack_ps > b.slack_ps;
+}
+
 }  // namespace
 
 std::vector<std::vector<int64_t>> GetMinCutCycleOrders(int64_t length) {
@@ -254,8 +564,11 @@ std::vector<std::vector<int64_t>> GetMinCutCycleOrders(int64_t length) {
 
 PipelineSchedule::PipelineSchedule(Function* function,
                                    ScheduleCycleMap cycle_map,
-                                   absl::optional<int64_t> length)
-    : function_(function), cycle_map_(std::move(cycle_map)) {
+                                   absl::optional<int64_t> length,
+                                   int64_t initiation_interval)
+    : function_(function),
+      cycle_map_(std::move(cycle_map)),
+      initiation_interval_(initiation_interval) {
   // Build the mapping from cycle to the vector of nodes in that cycle.
   int64_t max_cycle = MaximumCycle(cycle_map_);
   if (length.has_value()) {
@@ -295,7 +608,8 @@ absl::StatusOr<PipelineSchedule> PipelineSchedule::FromProto(
       cycle_map[node] = stage.stage();
     }
   }
-  return PipelineSchedule(function, cycle_map);
+  return PipelineSchedule(function, cycle_map, /*length=*/absl::nullopt,
+                          proto.initiation_interval());
 }
 
 absl::Span<Node* const> PipelineSchedule::nodes_in_cycle(int64_t cycle) const {
@@ -322,68 +636,14 @@ std::vector<Node*> PipelineSchedule::GetLiveOutOfCycle(int64_t c) const {
 /*static*/ absl::StatusOr<PipelineSchedule> PipelineSchedule::Run(
     Function* f, const DelayEstimator& delay_estimator,
     const SchedulingOptions& options) {
-  int64_t clock_period_ps;
-  if (options.clock_period_ps().has_value()) {
-    clock_period_ps = *options.clock_period_ps();
-
-    if (options.clock_margin_percent().has_value()) {
-      int64_t original_clock_period_ps = clock_period_ps;
-      clock_period_ps -=
-          (clock_period_ps * options.clock_margin_percent().value() + 50) / 100;
-      if (clock_period_ps <= 0) {
-        return absl::InvalidArgumentError(absl::StrFormat(
-            "Clock period non-positive (%dps) after adjusting for margin. "
-            "Original clock period: %dps, clock margin: %d%%",
-            clock_period_ps, original_clock_period_ps,
-            *options.clock_margin_percent()));
-      }
-    }
-  } else {
-    XLS_RET_CHECK(options.pipeline_stages().has_value());
-    // A pipeline length is specified, but no target clock period. Determine
-    // the minimum clock period for which the function can be scheduled in the
-    // given pipeline length.
-    XLS_ASSIGN_OR_RETURN(
-        clock_period_ps,
-        FindMinimumClockPeriod(f, *options.pipeline_stages(), delay_estimator));
-  }
-
-  sched::ScheduleBounds bounds(f, clock_period_ps, delay_estimator);
-  XLS_RETURN_IF_ERROR(bounds.PropagateLowerBounds());
-
-  int64_t max_ub;
-  if (options.pipeline_stages().has_value()) {
-    if (*options.pipeline_stages() < bounds.max_lower_bound()) {
-      return absl::ResourceExhaustedError(absl::StrFormat(
-          "Cannot be scheduled in %d stages. Computed lower bound is %d.",
-          *options.pipeline_stages(), bounds.max_lower_bound()));
-    }
-    max_ub = *options.pipeline_stages() - 1;
-  } else {
-    max_ub = bounds.max_lower_bound();
-  }
-
-  for (Node* node : f->nodes()) {
-    XLS_RETURN_IF_ERROR(bounds.TightenNodeUb(node, max_ub));
-  }
-  XLS_RETURN_IF_ERROR(bounds.PropagateUpperBounds());
-  ScheduleCycleMap cycle_map;
-  if (options.strategy() == SchedulingStrategy::MINIMIZE_REGISTERS) {
-    XLS_ASSIGN_OR_RETURN(
-        cycle_map,
-        ScheduleToMinimizeRegisters(f, max_ub + 1, delay_estimator, &bounds));
-  } else {
-    XLS_RET_CHECK(options.strategy() == SchedulingStrategy::ASAP);
-    XLS_RET_CHECK(!options.pipeline_stages().has_value());
-    // Just schedule everything as soon as possible.
-    for (Node* node : f->nodes()) {
-      cycle_map[node] = bounds.lb(node);
-    }
-  }
-  auto schedule = PipelineSchedule(f, cycle_map, options.pipeline_stages());
-  XLS_RETURN_IF_ERROR(schedule.VerifyTiming(clock_period_ps, delay_estimator));
-  XLS_VLOG_LINES(3, "Schedule\n" + schedule.ToString());
-  return schedule;
+  XLS_TRACE_SPAN("Schedule", f->name());
+  auto topo_sort_it = TopoSort(f);
+  std::vector<Node*> topo_sort(topo_sort_it.begin(), topo_sort_it.end());
+  XLS_ASSIGN_OR_RETURN(
+      int64_t clock_period_ps,
+      ComputeClockPeriod(f, topo_sort, delay_estimator, options));
+  return ScheduleWithClockPeriod(f, topo_sort, delay_estimator, options,
+                                 clock_period_ps);
 }
 
 std::string PipelineSchedule::ToString() const {
@@ -479,6 +739,7 @@ absl::Status PipelineSchedule::VerifyTiming(
 PipelineScheduleProto PipelineSchedule::ToProto() {
   PipelineScheduleProto proto;
   proto.set_function(function_->name());
+  proto.set_initiation_interval(initiation_interval_);
   for (int i = 0; i < cycle_to_nodes_.size(); i++) {
     StageProto* stage = proto.add_stages();
     stage->set_stage(i);
@@ -489,4 +750,83 @@ PipelineScheduleProto PipelineSchedule::ToProto() {
   return proto;
 }
 
+absl::StatusOr<std::vector<ScheduleSweepPoint>> RunScheduleSweep(
+    Function* f, const DelayEstimator& delay_estimator,
+    absl::Span<const SchedulingOptions> options, int64_t num_threads) {
+  // Work shared by all runs: the topological sort and the node delays.
+  auto topo_sort_it = TopoSort(f);
+  std::vector<Node*> topo_sort(topo_sort_it.begin(), topo_sort_it.end());
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<PrecomputedDelayEstimator> delays,
+                       PrecomputedDelayEstimator::Create(f, delay_estimator));
+
+  std::vector<ScheduleSweepPoint> points(options.size());
+  auto run_point = [&](int64_t i) -> absl::Status {
+    ScheduleSweepPoint& point = points[i];
+    point.options = options[i];
+    XLS_ASSIGN_OR_RETURN(point.clock_period_ps,
+                         ComputeClockPeriod(f, topo_sort, *delays, options[i]));
+    point.schedule = ScheduleWithClockPeriod(f, topo_sort, *delays, options[i],
+                                             point.clock_period_ps);
+    XLS_RETURN_IF_ERROR(point.schedule.status());
+    point.stages = point.schedule->length();
+    point.registers = CountScheduleRegisters(*point.schedule);
+    XLS_ASSIGN_OR_RETURN(int64_t longest_path,
+                         LongestStagePath(*point.schedule, topo_sort, *delays));
+    point.slack_ps = point.clock_period_ps - longest_path;
+    return absl::OkStatus();
+  };
+
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min<int64_t>(num_threads, options.size());
+  std::atomic<int64_t> next_point(0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 0; t < num_threads; ++t) {
+    threads.push_back(std::make_unique<Thread>([&]() {
+      for (int64_t i = next_point++; i < options.size(); i = next_point++) {
+        absl::Status status = run_point(i);
+        if (!status.ok()) {
+          points[i].schedule = status;
+        }
+      }
+    }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  for (ScheduleSweepPoint& point : points) {
+    if (!point.schedule.ok()) {
+      continue;
+    }
+    point.pareto_optimal =
+        absl::c_none_of(points, [&](const ScheduleSweepPoint& other) {
+          return other.schedule.ok() && Dominates(other, point);
+        });
+  }
+  return points;
+}
+
+std::string ScheduleSweepToString(absl::Span<const ScheduleSweepPoint> points) {
+  std::string result = absl::StrFormat("%-8s %12s %8s %10s %10s\n", "pareto",
+                                       "clock (ps)", "stages", "registers",
+                                       "slack (ps)");
+  for (const ScheduleSweepPoint& point : points) {
+    if (!point.schedule.ok()) {
+      absl::StrAppendFormat(&result, "%-8s %12s %s\n", "",
+                            point.options.clock_period_ps().has_value()
+                                ? absl::StrCat(*point.options.clock_period_ps())
+                                : "-",
+                            point.schedule.status().ToString());
+      continue;
+    }
+    absl::StrAppendFormat(&result, "%-8s %12d %8d %10d %10d\n",
+                          point.pareto_optimal ? "*" : "",
+                          point.clock_period_ps, point.stages, point.registers,
+                          point.slack_ps);
+  }
+  return result;
+}
+
 }  // namespace xls
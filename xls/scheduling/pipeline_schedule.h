@@ -15,11 +15,16 @@
 #ifndef XLS_SCHEDULING_PIPELINE_SCHEDULE_H_
 #define XLS_SCHEDULING_PIPELINE_SCHEDULE_H_
 
+#include <string>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/ir/function.h"
+#include "xls/ir/op.h"
 #include "xls/scheduling/pipeline_schedule.pb.h"
 
 namespace xls {
@@ -31,7 +36,38 @@ enum class SchedulingStrategy {
   ASAP,
 
   // Minimize the number of pipeline registers when scheduling.
-  MINIMIZE_REGISTERS
+  MINIMIZE_REGISTERS,
+
+  // Minimize the number of pipeline registers by solving a system of
+  // difference constraints, which optimizes all stage boundaries jointly (see
+  // sdc_scheduler.h) rather than one at a time as MINIMIZE_REGISTERS does.
+  SDC,
+
+  // Minimize the number of pipeline registers by refining a schedule with
+  // moves of single nodes across all stage boundaries at once (see
+  // multiway_partition.h). Faster than MINIMIZE_REGISTERS for deep pipelines,
+  // but heuristic.
+  MULTIWAY_PARTITION,
+
+  // Schedule for a pipeline which accepts a new input every initiation interval
+  // cycles, placing nodes modulo the initiation interval so that expensive
+  // operations can share operator instances within the given resource limits
+  // (see modulo_scheduler.h).
+  MODULO
+};
+
+// The objective of the register retiming which may follow scheduling (see
+// retiming_pass.h).
+enum class RetimingObjective {
+  // No retiming.
+  NONE,
+
+  // Minimize the longest path of nodes scheduled in the same stage.
+  MIN_STAGE_DELAY,
+
+  // Minimize the number of pipeline register bits without making the longest
+  // path of nodes scheduled in the same stage exceed the clock period.
+  MIN_REGISTERS
 };
 
 // Returns the list of ordering of cycles (pipeline stages) in which to compute
@@ -94,11 +130,57 @@ class SchedulingOptions {
     return clock_margin_percent_;
   }
 
+  // Sets/gets the number of cycles between successive inputs of the
+  // pipeline. Values greater than one are only supported by the MODULO
+  // strategy.
+  SchedulingOptions& initiation_interval(int64_t value) {
+    initiation_interval_ = value;
+    return *this;
+  }
+  int64_t initiation_interval() const { return initiation_interval_; }
+
+  // Sets the number of operator instances available to operations with the
+  // given op. Only supported by the MODULO strategy, and only for ops which
+  // can be shared (see sched::IsShareableOp).
+  SchedulingOptions& resource_limit(Op op, int64_t count) {
+    resource_limits_[op] = count;
+    return *this;
+  }
+  const absl::flat_hash_map<Op, int64_t>& resource_limits() const {
+    return resource_limits_;
+  }
+
+  // Sets/gets the objective of retiming the schedule once it is computed. Only
+  // effective in a scheduling pass pipeline including the RetimingPass.
+  SchedulingOptions& retiming_objective(RetimingObjective value) {
+    retiming_objective_ = value;
+    return *this;
+  }
+  RetimingObjective retiming_objective() const { return retiming_objective_; }
+
+  // Sets/gets the schedule of a previous version of the function to start
+  // from. Nodes with the name of a node of the previous schedule are kept in
+  // its cycle where that is feasible, so only new and changed nodes are
+  // placed, and stage boundaries stay put. Without a pipeline length, the
+  // previous length is kept if it's feasible. Only supported by the
+  // MINIMIZE_REGISTERS, MULTIWAY_PARTITION and ASAP strategies.
+  SchedulingOptions& warm_start(PipelineScheduleProto value) {
+    warm_start_ = std::move(value);
+    return *this;
+  }
+  const absl::optional<PipelineScheduleProto>& warm_start() const {
+    return warm_start_;
+  }
+
  private:
   SchedulingStrategy strategy_;
   absl::optional<int64_t> clock_period_ps_;
   absl::optional<int64_t> pipeline_stages_;
   absl::optional<int64_t> clock_margin_percent_;
+  int64_t initiation_interval_ = 1;
+  absl::flat_hash_map<Op, int64_t> resource_limits_;
+  RetimingObjective retiming_objective_ = RetimingObjective::NONE;
+  absl::optional<PipelineScheduleProto> warm_start_;
 };
 
 // A map from node to cycle as a bare-bones representation of a schedule.
@@ -108,7 +190,8 @@ using ScheduleCycleMap = absl::flat_hash_map<Node*, int64_t>;
 class PipelineSchedule {
  public:
   // Produces a feed-forward pipeline schedule using the given delay model and
-  // scheduling options.
+  // scheduling options. The delay estimator may be called from multiple
+  // threads.
   static absl::StatusOr<PipelineSchedule> Run(
       Function* f, const DelayEstimator& delay_estimator,
       const SchedulingOptions& options);
@@ -121,10 +204,17 @@ class PipelineSchedule {
   // length is not given, then the length equal to the largest cycle in cycle
   // map minus one.
   PipelineSchedule(Function* function, ScheduleCycleMap cycle_map,
-                   absl::optional<int64_t> length = absl::nullopt);
+                   absl::optional<int64_t> length = absl::nullopt,
+                   int64_t initiation_interval = 1);
 
   Function* function() const { return function_; }
 
+  // Returns the number of cycles between successive inputs of the pipeline.
+  // With an initiation interval greater than one, each stage is active only
+  // every initiation interval cycles, and operations in stages which differ
+  // modulo the initiation interval may share an operator instance.
+  int64_t initiation_interval() const { return initiation_interval_; }
+
   // Returns whether the given node is contained in this schedule.
   bool IsScheduled(Node* node) const { return cycle_map_.contains(node); }
 
@@ -170,8 +260,47 @@ class PipelineSchedule {
 
   // The nodes scheduled each cycle.
   std::vector<std::vector<Node*>> cycle_to_nodes_;
+
+  int64_t initiation_interval_;
 };
 
+// One point of a scheduling sweep: the result of scheduling a function with one
+// set of options, and the figures of merit of the resulting schedule.
+struct ScheduleSweepPoint {
+  SchedulingOptions options;
+  absl::StatusOr<PipelineSchedule> schedule;
+
+  // The remaining fields are only meaningful if 'schedule' is ok.
+
+  // The clock period the schedule was constrained by. Includes the clock
+  // margin, and is the minimum feasible period if the options only specify a
+  // pipeline length.
+  int64_t clock_period_ps = 0;
+  int64_t stages = 0;
+  // The number of pipeline register bits on the interior of the pipeline.
+  int64_t registers = 0;
+  // The clock period minus the longest path of nodes scheduled in one stage.
+  int64_t slack_ps = 0;
+  // Whether no other successfully scheduled point is at least as good in each
+  // of clock period, stages, registers and slack, and strictly better in one.
+  bool pareto_optimal = false;
+};
+
+// Schedules the function once for each of the given options, running up to
+// 'num_threads' schedules concurrently (zero means one per hardware thread).
+// The runs share the function, its topological sort and the delay of each
+// node, which is computed once up front, so the function must not be modified
+// during the sweep. Returns one point per option in the same order; failing
+// to schedule with an option is reported in the point's 'schedule' rather than
+// as an error of the sweep.
+absl::StatusOr<std::vector<ScheduleSweepPoint>> RunScheduleSweep(
+    Function* f, const DelayEstimator& delay_estimator,
+    absl::Span<const SchedulingOptions> options, int64_t num_threads = 0);
+
+// Returns a table of the given sweep points with one row per point. Pareto
+// optimal points are marked with an asterisk.
+std::string ScheduleSweepToString(absl::Span<const ScheduleSweepPoint> points);
+
 }  // namespace xls
 
 #endif  // XLS_SCHEDULING_PIPELINE_SCHEDULE_H_
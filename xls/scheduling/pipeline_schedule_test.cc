@@ -474,5 +474,346 @@ TEST_F(PipelineScheduleTest, SerializeAndDeserialize) {
   }
 }
 
+TEST_F(PipelineScheduleTest, WarmStartKeepsPreviousCycles) {
+  // Builds the function, with an extra node consuming its result if
+  // "extended". The nodes common to both versions get the same names.
+  auto build = [&](Package* p, bool extended) {
+    FunctionBuilder fb(TestName(), p);
+    Type* u32 = p->GetBitsType(32);
+    auto x = fb.Param("x", u32);
+    auto y = fb.Param("y", u32);
+    auto z = fb.Param("z", u32);
+    BValue result =
+        fb.Negate(fb.Concat({(fb.Not(fb.Negate(x | y)) - z) * x, z + z}));
+    if (extended) {
+      fb.Add(result, fb.Concat({x, y}));
+    }
+    return fb.Build();
+  };
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * previous_func, build(p.get(), false));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule previous,
+      PipelineSchedule::Run(previous_func, TestDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(3)));
+  PipelineScheduleProto proto = previous.ToProto();
+  // Names of nodes which no longer exist are ignored.
+  proto.mutable_stages(0)->add_nodes("no_such_node");
+
+  auto new_p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, build(new_p.get(), true));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(
+          func, TestDelayEstimator(),
+          SchedulingOptions().pipeline_stages(4).warm_start(proto)));
+  XLS_ASSERT_OK(schedule.Verify());
+  EXPECT_EQ(schedule.length(), 4);
+  for (Node* node : previous_func->nodes()) {
+    XLS_ASSERT_OK_AND_ASSIGN(Node * new_node, func->GetNode(node->GetName()));
+    EXPECT_EQ(schedule.cycle(new_node), previous.cycle(node))
+        << node->GetName();
+  }
+  EXPECT_GE(schedule.cycle(func->return_value()), 2);
+
+  // Without a pipeline length, the previous one is kept even though the clock
+  // period allows a single stage.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule same_length,
+      PipelineSchedule::Run(
+          func, TestDelayEstimator(),
+          SchedulingOptions().clock_period_ps(7).warm_start(proto)));
+  EXPECT_EQ(same_length.length(), 3);
+
+  EXPECT_THAT(PipelineSchedule::Run(
+                  func, TestDelayEstimator(),
+                  SchedulingOptions(SchedulingStrategy::SDC)
+                      .pipeline_stages(4)
+                      .warm_start(proto))
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("previous schedule")));
+}
+
+TEST_F(PipelineScheduleTest, ScheduleSweep) {
+  // A narrow chain of four unit-delay operations alongside a sign extension of
+  // a single-bit parameter. ASAP computes the sign extension in the first
+  // stage and so registers all 32 bits of it; minimizing registers defers it.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(1));
+  BValue chain = fb.Not(fb.Not(fb.Not(fb.OrReduce(x))));
+  fb.Concat({chain, fb.SignExtend(y, 32)});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  std::vector<SchedulingOptions> options = {
+      SchedulingOptions().clock_period_ps(2),
+      SchedulingOptions(SchedulingStrategy::ASAP).clock_period_ps(2),
+      SchedulingOptions().pipeline_stages(2),
+      SchedulingOptions().clock_period_ps(4),
+      SchedulingOptions().clock_period_ps(1).pipeline_stages(2)};
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<ScheduleSweepPoint> points,
+      RunScheduleSweep(f, TestDelayEstimator(), options, /*num_threads=*/2));
+  ASSERT_EQ(points.size(), options.size());
+
+  XLS_ASSERT_OK(points[0].schedule.status());
+  EXPECT_EQ(points[0].clock_period_ps, 2);
+  EXPECT_EQ(points[0].stages, 2);
+  EXPECT_EQ(points[0].registers, 2);
+  EXPECT_EQ(points[0].slack_ps, 0);
+  EXPECT_TRUE(points[0].pareto_optimal);
+
+  // The sweep produces the same schedule as a standalone run.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(f, TestDelayEstimator(), options[0]));
+  for (Node* node : f->nodes()) {
+    EXPECT_EQ(points[0].schedule->cycle(node), schedule.cycle(node));
+  }
+
+  XLS_ASSERT_OK(points[1].schedule.status());
+  EXPECT_EQ(points[1].stages, 2);
+  EXPECT_EQ(points[1].registers, 33);
+  EXPECT_FALSE(points[1].pareto_optimal);
+
+  // The minimum clock period for two stages is found, giving the same point as
+  // the first one. Neither dominates the other.
+  XLS_ASSERT_OK(points[2].schedule.status());
+  EXPECT_EQ(points[2].clock_period_ps, 2);
+  EXPECT_EQ(points[2].registers, 2);
+  EXPECT_TRUE(points[2].pareto_optimal);
+
+  XLS_ASSERT_OK(points[3].schedule.status());
+  EXPECT_EQ(points[3].stages, 1);
+  EXPECT_EQ(points[3].registers, 0);
+  EXPECT_EQ(points[3].slack_ps, 0);
+  EXPECT_TRUE(points[3].pareto_optimal);
+
+  EXPECT_THAT(points[4].schedule.status(),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("Cannot be scheduled in 2 stages")));
+  EXPECT_FALSE(points[4].pareto_optimal);
+
+  EXPECT_THAT(ScheduleSweepToString(points),
+              HasSubstr("Cannot be scheduled in 2 stages"));
+}
+
+TEST_F(PipelineScheduleTest, SdcSchedule) {
+  // The same function as in ScheduleSweep: the sign extension should be
+  // deferred to the second stage.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(1));
+  BValue chain = fb.Not(fb.Not(fb.Not(fb.OrReduce(x))));
+  BValue sign_ext = fb.SignExtend(y, 32);
+  fb.Concat({chain, sign_ext});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(
+          f, TestDelayEstimator(),
+          SchedulingOptions(SchedulingStrategy::SDC).clock_period_ps(2)));
+  EXPECT_EQ(schedule.length(), 2);
+  EXPECT_EQ(schedule.cycle(x.node()), 0);
+  EXPECT_EQ(schedule.cycle(y.node()), 0);
+  EXPECT_EQ(schedule.cycle(sign_ext.node()), 1);
+  EXPECT_EQ(schedule.cycle(chain.node()), 1);
+  EXPECT_EQ(schedule.cycle(f->return_value()), 1);
+
+  EXPECT_THAT(
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::SDC)
+                                .clock_period_ps(1)
+                                .pipeline_stages(2))
+          .status(),
+      StatusIs(absl::StatusCode::kResourceExhausted,
+               HasSubstr("Cannot be scheduled in 2 stages")));
+}
+
+TEST_F(PipelineScheduleTest, SdcScheduleRegistersNoWorseThanMinCut) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  Type* u32 = p->GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  BValue narrow = fb.BitSlice(fb.Not(x), /*start=*/0, /*width=*/4);
+  BValue wide = fb.Negate(fb.Not(fb.Negate(x | y)) - z) * x;
+  fb.Concat({wide, fb.UDiv(narrow, narrow), z + z});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  for (int64_t stages : {2, 3, 4}) {
+    std::vector<SchedulingOptions> options = {
+        SchedulingOptions().pipeline_stages(stages),
+        SchedulingOptions(SchedulingStrategy::SDC).pipeline_stages(stages)};
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::vector<ScheduleSweepPoint> points,
+        RunScheduleSweep(f, TestDelayEstimator(), options));
+    XLS_ASSERT_OK(points[0].schedule.status());
+    XLS_ASSERT_OK(points[1].schedule.status());
+    XLS_EXPECT_OK(points[1].schedule->Verify());
+    EXPECT_EQ(points[1].stages, stages);
+    EXPECT_GE(points[1].slack_ps, 0);
+    EXPECT_LE(points[1].registers, points[0].registers) << "stages: " << stages;
+  }
+}
+
+TEST_F(PipelineScheduleTest, MultiwayPartitionSchedule) {
+  // The same function as in SdcSchedule.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(1));
+  BValue chain = fb.Not(fb.Not(fb.Not(fb.OrReduce(x))));
+  BValue sign_ext = fb.SignExtend(y, 32);
+  fb.Concat({chain, sign_ext});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(
+                                SchedulingStrategy::MULTIWAY_PARTITION)
+                                .clock_period_ps(2)));
+  XLS_ASSERT_OK(schedule.Verify());
+  EXPECT_EQ(schedule.length(), 2);
+  EXPECT_EQ(schedule.cycle(sign_ext.node()), 1);
+}
+
+TEST_F(PipelineScheduleTest, MultiwayPartitionDeepPipeline) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  Type* u32 = p->GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  BValue narrow = fb.BitSlice(fb.Not(x), /*start=*/0, /*width=*/4);
+  BValue wide = fb.Negate(fb.Not(fb.Negate(x | y)) - z) * x;
+  fb.Concat({wide, fb.UDiv(narrow, narrow), z + z});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  for (int64_t stages : {2, 4, 8, 16}) {
+    std::vector<SchedulingOptions> options = {
+        SchedulingOptions(SchedulingStrategy::SDC).pipeline_stages(stages),
+        SchedulingOptions(SchedulingStrategy::MULTIWAY_PARTITION)
+            .pipeline_stages(stages)};
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::vector<ScheduleSweepPoint> points,
+        RunScheduleSweep(f, TestDelayEstimator(), options));
+    XLS_ASSERT_OK(points[0].schedule.status());
+    XLS_ASSERT_OK(points[1].schedule.status());
+    XLS_EXPECT_OK(points[1].schedule->Verify());
+    EXPECT_EQ(points[1].stages, stages);
+    EXPECT_GE(points[1].slack_ps, 0);
+    // The SDC schedule has the fewest registers possible.
+    EXPECT_GE(points[1].registers, points[0].registers) << "stages: " << stages;
+  }
+}
+
+TEST_F(PipelineScheduleTest, ModuloScheduleSharesMultiplier) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  Type* u32 = p->GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  auto z = fb.Param("z", u32);
+  BValue xy = fb.UMul(x, y);
+  BValue yz = fb.UMul(y, z);
+  BValue sum = fb.Add(xy, yz);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // With one multiplier and an initiation interval of two, the multiplies must
+  // be placed in cycles which differ modulo two.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .initiation_interval(2)
+                                .resource_limit(Op::kUMul, 1)));
+  XLS_EXPECT_OK(schedule.Verify());
+  EXPECT_EQ(schedule.initiation_interval(), 2);
+  EXPECT_EQ(schedule.length(), 2);
+  EXPECT_THAT(std::vector<int64_t>({schedule.cycle(xy.node()),
+                                    schedule.cycle(yz.node())}),
+              UnorderedElementsAre(0, 1));
+  EXPECT_EQ(schedule.cycle(sum.node()), 1);
+
+  // Without a resource limit the multiplies are scheduled as soon as possible.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule unlimited,
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .initiation_interval(2)));
+  EXPECT_EQ(unlimited.cycle(xy.node()), 0);
+  EXPECT_EQ(unlimited.cycle(yz.node()), 0);
+
+  // The initiation interval survives serialization.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule clone,
+      PipelineSchedule::FromProto(f, schedule.ToProto()));
+  EXPECT_EQ(clone.initiation_interval(), 2);
+  EXPECT_EQ(clone.cycle(yz.node()), schedule.cycle(yz.node()));
+
+  EXPECT_THAT(
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .pipeline_stages(1)
+                                .initiation_interval(2)
+                                .resource_limit(Op::kUMul, 1))
+          .status(),
+      StatusIs(absl::StatusCode::kResourceExhausted,
+               HasSubstr("Cannot be scheduled in 1 stages")));
+}
+
+TEST_F(PipelineScheduleTest, ModuloScheduleTooFewResources) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  Type* u32 = p->GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto y = fb.Param("y", u32);
+  fb.Add(fb.Add(fb.UMul(x, y), fb.UMul(y, y)), fb.UMul(x, x));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // Three multiplies cannot share one multiplier every two cycles.
+  EXPECT_THAT(
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .initiation_interval(2)
+                                .resource_limit(Op::kUMul, 1))
+          .status(),
+      StatusIs(absl::StatusCode::kResourceExhausted,
+               HasSubstr("can compute at most 2 operations")));
+  XLS_EXPECT_OK(
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .initiation_interval(3)
+                                .resource_limit(Op::kUMul, 1))
+          .status());
+
+  EXPECT_THAT(
+      PipelineSchedule::Run(f, TestDelayEstimator(),
+                            SchedulingOptions(SchedulingStrategy::MODULO)
+                                .clock_period_ps(2)
+                                .resource_limit(Op::kAdd, 1))
+          .status(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("cannot be resource limited")));
+  EXPECT_THAT(PipelineSchedule::Run(
+                  f, TestDelayEstimator(),
+                  SchedulingOptions().clock_period_ps(2).initiation_interval(2))
+                  .status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("require the MODULO scheduling strategy")));
+}
+
 }  // namespace
 }  // namespace xls
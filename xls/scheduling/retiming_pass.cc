@@ -0,0 +1,242 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/scheduling/retiming_pass.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace {
+
+// Figures of merit of a schedule being retimed.
+struct ScheduleCost {
+  // The delay of the longest path of nodes scheduled in the same stage.
+  int64_t max_stage_delay = 0;
+  // The number of nodes at which such a longest path ends. Reducing it without
+  // shortening the longest path makes progress towards doing so.
+  int64_t critical_nodes = 0;
+  // The number of pipeline register bits on the interior of the pipeline.
+  int64_t register_bits = 0;
+};
+
+// Returns whether cost 'a' is strictly better than cost 'b' for the objective.
+bool IsBetter(const ScheduleCost& a, const ScheduleCost& b,
+              RetimingObjective objective) {
+  if (objective == RetimingObjective::MIN_REGISTERS) {
+    return std::tie(a.register_bits, a.max_stage_delay, a.critical_nodes) <
+           std::tie(b.register_bits, b.max_stage_delay, b.critical_nodes);
+  }
+  return std::tie(a.max_stage_delay, a.critical_nodes, a.register_bits) <
+         std::tie(b.max_stage_delay, b.critical_nodes, b.register_bits);
+}
+
+// Moves nodes of a schedule between stages, keeping track of the schedule
+// through its cycle map.
+class Retimer {
+ public:
+  Retimer(const PipelineSchedule& schedule,
+          absl::flat_hash_map<Node*, int64_t> delays)
+      : function_(schedule.function()),
+        length_(schedule.length()),
+        delays_(std::move(delays)) {
+    for (Node* node : TopoSort(function_)) {
+      topo_sort_.push_back(node);
+      cycle_map_[node] = schedule.cycle(node);
+    }
+  }
+
+  const ScheduleCycleMap& cycle_map() const { return cycle_map_; }
+  absl::Span<Node* const> nodes() const { return topo_sort_; }
+
+  // Returns whether the node can be moved to the given cycle without being
+  // scheduled before its operands or after its users.
+  bool CanMove(Node* node, int64_t cycle) const {
+    if (node->Is<Param>() || cycle < 0 || cycle >= length_) {
+      return false;
+    }
+    for (Node* operand : node->operands()) {
+      if (cycle_map_.at(operand) > cycle) {
+        return false;
+      }
+    }
+    for (Node* user : node->users()) {
+      if (cycle_map_.at(user) < cycle) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Move(Node* node, int64_t cycle) { cycle_map_[node] = cycle; }
+
+  ScheduleCost Cost() const {
+    ScheduleCost cost;
+    absl::flat_hash_map<Node*, int64_t> node_cp;
+    for (Node* node : topo_sort_) {
+      const int64_t cycle = cycle_map_.at(node);
+      int64_t node_start = 0;
+      for (Node* operand : node->operands()) {
+        if (cycle_map_.at(operand) == cycle) {
+          node_start = std::max(node_start, node_cp.at(operand));
+        }
+      }
+      const int64_t cp = node_start + delays_.at(node);
+      node_cp[node] = cp;
+      if (cp > cost.max_stage_delay) {
+        cost.max_stage_delay = cp;
+        cost.critical_nodes = 1;
+      } else if (cp == cost.max_stage_delay) {
+        ++cost.critical_nodes;
+      }
+
+      // The return value is carried to the outputs at the end of the
+      // pipeline.
+      int64_t latest_use =
+          node == function_->return_value() ? length_ - 1 : cycle;
+      for (Node* user : node->users()) {
+        latest_use = std::max(latest_use, cycle_map_.at(user));
+      }
+      cost.register_bits +=
+          node->GetType()->GetFlatBitCount() * (latest_use - cycle);
+    }
+    return cost;
+  }
+
+ private:
+  Function* function_;
+  int64_t length_;
+  std::vector<Node*> topo_sort_;
+  absl::flat_hash_map<Node*, int64_t> delays_;
+  ScheduleCycleMap cycle_map_;
+};
+
+}  // namespace
+
+absl::StatusOr<PipelineSchedule> RetimeSchedule(
+    const PipelineSchedule& schedule, const DelayEstimator& delay_estimator,
+    RetimingObjective objective, absl::optional<int64_t> clock_period_ps) {
+  if (objective == RetimingObjective::NONE ||
+      schedule.initiation_interval() > 1) {
+    return schedule;
+  }
+  absl::flat_hash_map<Node*, int64_t> delays;
+  for (Node* node : schedule.function()->nodes()) {
+    XLS_ASSIGN_OR_RETURN(delays[node],
+                         delay_estimator.GetOperationDelayInPs(node));
+  }
+  Retimer retimer(schedule, std::move(delays));
+  ScheduleCost cost = retimer.Cost();
+  // No stage may be made longer than the clock period, but a schedule which
+  // already exceeds it may be retimed without making it worse.
+  const int64_t delay_limit =
+      std::max(clock_period_ps.value_or(0), cost.max_stage_delay);
+  XLS_VLOG(3) << absl::StreamFormat(
+      "Retiming schedule with longest stage %dps and %d register bits",
+      cost.max_stage_delay, cost.register_bits);
+
+  // Each move strictly improves the cost so this terminates, but bound the
+  // number of moves in case the improvements are many and small.
+  const int64_t max_moves =
+      static_cast<int64_t>(retimer.nodes().size()) * schedule.length();
+  int64_t moves = 0;
+  for (; moves < max_moves; ++moves) {
+    Node* best_node = nullptr;
+    int64_t best_cycle = 0;
+    ScheduleCost best_cost = cost;
+    for (Node* node : retimer.nodes()) {
+      const int64_t cycle = retimer.cycle_map().at(node);
+      for (int64_t new_cycle : {cycle - 1, cycle + 1}) {
+        if (!retimer.CanMove(node, new_cycle)) {
+          continue;
+        }
+        retimer.Move(node, new_cycle);
+        ScheduleCost new_cost = retimer.Cost();
+        retimer.Move(node, cycle);
+        if (objective == RetimingObjective::MIN_REGISTERS &&
+            new_cost.max_stage_delay > delay_limit) {
+          continue;
+        }
+        if (IsBetter(new_cost, best_cost, objective)) {
+          best_node = node;
+          best_cycle = new_cycle;
+          best_cost = new_cost;
+        }
+      }
+    }
+    if (best_node == nullptr) {
+      break;
+    }
+    XLS_VLOG(4) << absl::StreamFormat("Moving %s from cycle %d to cycle %d",
+                                      best_node->GetName(),
+                                      retimer.cycle_map().at(best_node),
+                                      best_cycle);
+    retimer.Move(best_node, best_cycle);
+    cost = best_cost;
+  }
+  XLS_VLOG(3) << absl::StreamFormat(
+      "Retimed schedule with %d moves: longest stage %dps and %d register bits",
+      moves, cost.max_stage_delay, cost.register_bits);
+
+  PipelineSchedule retimed(schedule.function(), retimer.cycle_map(),
+                           schedule.length());
+  XLS_RETURN_IF_ERROR(retimed.Verify());
+  return retimed;
+}
+
+absl::StatusOr<bool> RetimingPass::RunInternal(
+    SchedulingUnit* unit, const SchedulingPassOptions& options,
+    SchedulingPassResults* results) const {
+  const SchedulingOptions& scheduling_options = options.scheduling_options;
+  if (scheduling_options.retiming_objective() == RetimingObjective::NONE) {
+    return false;
+  }
+  XLS_RET_CHECK(unit->schedule.has_value())
+      << "Package " << unit->name() << " has no schedule to retime.";
+  XLS_RET_CHECK_NE(options.delay_estimator, nullptr);
+
+  absl::optional<int64_t> clock_period_ps =
+      scheduling_options.clock_period_ps();
+  if (clock_period_ps.has_value() &&
+      scheduling_options.clock_margin_percent().has_value()) {
+    *clock_period_ps -=
+        (*clock_period_ps * *scheduling_options.clock_margin_percent() + 50) /
+        100;
+  }
+  XLS_ASSIGN_OR_RETURN(
+      PipelineSchedule retimed,
+      RetimeSchedule(*unit->schedule, *options.delay_estimator,
+                     scheduling_options.retiming_objective(), clock_period_ps));
+  bool changed = false;
+  for (Node* node : retimed.function()->nodes()) {
+    if (retimed.cycle(node) != unit->schedule->cycle(node)) {
+      changed = true;
+      break;
+    }
+  }
+  unit->schedule = std::move(retimed);
+  return changed;
+}
+
+}  // namespace xls
@@ -0,0 +1,60 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SCHEDULING_RETIMING_PASS_H_
+#define XLS_SCHEDULING_RETIMING_PASS_H_
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/scheduling/pipeline_schedule.h"
+#include "xls/scheduling/scheduling_pass.h"
+
+namespace xls {
+
+// Retimes the pipeline registers of a schedule by moving nodes across the
+// boundaries of their stage, which coarse node-granularity scheduling may have
+// placed suboptimally. Moves are made one node and one stage at a time, taking
+// the move which improves the objective most until none does, so a node may
+// travel several stages. Parameters stay in their stage and the length of the
+// schedule is unchanged.
+//
+// With the MIN_REGISTERS objective, no stage is made longer than
+// 'clock_period_ps', or than the longest stage of the given schedule if no
+// clock period is given. Schedules with an initiation interval greater than
+// one are returned unchanged, as moves would disturb operator sharing.
+absl::StatusOr<PipelineSchedule> RetimeSchedule(
+    const PipelineSchedule& schedule, const DelayEstimator& delay_estimator,
+    RetimingObjective objective,
+    absl::optional<int64_t> clock_period_ps = absl::nullopt);
+
+// Retimes the schedule of the unit with the retiming objective of the
+// scheduling options, using the clock period (less the clock margin) as the
+// limit on stage delays.
+class RetimingPass : public SchedulingPass {
+ public:
+  RetimingPass() : SchedulingPass("retime", "Register retiming") {}
+  ~RetimingPass() override {}
+
+ protected:
+  absl::StatusOr<bool> RunInternal(
+      SchedulingUnit* unit, const SchedulingPassOptions& options,
+      SchedulingPassResults* results) const override;
+};
+
+}  // namespace xls
+
+#endif  // XLS_SCHEDULING_RETIMING_PASS_H_
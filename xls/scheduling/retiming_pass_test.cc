@@ -0,0 +1,138 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/scheduling/retiming_pass.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/op.h"
+#include "xls/scheduling/pipeline_schedule.h"
+#include "xls/scheduling/scheduling_pass.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class TestDelayEstimator : public DelayEstimator {
+ public:
+  absl::StatusOr<int64_t> GetOperationDelayInPs(Node* node) const override {
+    switch (node->op()) {
+      case Op::kParam:
+      case Op::kLiteral:
+      case Op::kBitSlice:
+      case Op::kConcat:
+        return 0;
+      default:
+        return 1;
+    }
+  }
+};
+
+class RetimingPassTest : public IrTestBase {};
+
+TEST_F(RetimingPassTest, BalancesStageDelays) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue a = fb.Not(x);
+  BValue b = fb.Not(a);
+  BValue c = fb.Not(b);
+  BValue d = fb.Not(c);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // The first stage holds a path of three nodes and the second one of one.
+  PipelineSchedule schedule(f, {{x.node(), 0},
+                                {a.node(), 0},
+                                {b.node(), 0},
+                                {c.node(), 0},
+                                {d.node(), 1}});
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule retimed,
+      RetimeSchedule(schedule, TestDelayEstimator(),
+                     RetimingObjective::MIN_STAGE_DELAY));
+  EXPECT_EQ(retimed.length(), 2);
+  EXPECT_EQ(retimed.cycle(b.node()), 0);
+  EXPECT_EQ(retimed.cycle(c.node()), 1);
+  XLS_EXPECT_OK(retimed.VerifyTiming(2, TestDelayEstimator()));
+}
+
+TEST_F(RetimingPassTest, ReducesRegistersWithinClockPeriod) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue a = fb.Not(x);
+  BValue b = fb.OrReduce(a);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // The 32-bit value 'a' is registered, though registering the single bit of
+  // 'b' would do but lengthen the first stage.
+  PipelineSchedule schedule(f, {{x.node(), 0}, {a.node(), 0}, {b.node(), 1}});
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule retimed,
+      RetimeSchedule(schedule, TestDelayEstimator(),
+                     RetimingObjective::MIN_REGISTERS,
+                     /*clock_period_ps=*/2));
+  EXPECT_EQ(retimed.cycle(b.node()), 0);
+
+  for (absl::optional<int64_t> clock_period_ps :
+       {absl::optional<int64_t>(1), absl::optional<int64_t>()}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        retimed, RetimeSchedule(schedule, TestDelayEstimator(),
+                                RetimingObjective::MIN_REGISTERS,
+                                clock_period_ps));
+    EXPECT_EQ(retimed.cycle(b.node()), 1);
+  }
+}
+
+TEST_F(RetimingPassTest, PassUsesRetimingObjective) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue a = fb.Not(x);
+  BValue b = fb.Not(a);
+  BValue c = fb.Not(b);
+  BValue d = fb.Not(c);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  TestDelayEstimator delay_estimator;
+  SchedulingPassOptions options;
+  options.delay_estimator = &delay_estimator;
+  SchedulingPassResults results;
+  SchedulingUnit unit = {
+      p.get(), PipelineSchedule(f, {{x.node(), 0},
+                                    {a.node(), 0},
+                                    {b.node(), 0},
+                                    {c.node(), 0},
+                                    {d.node(), 1}})};
+  EXPECT_THAT(RetimingPass().Run(&unit, options, &results),
+              IsOkAndHolds(false));
+  EXPECT_EQ(unit.schedule->cycle(c.node()), 0);
+
+  options.scheduling_options.retiming_objective(
+      RetimingObjective::MIN_STAGE_DELAY);
+  EXPECT_THAT(RetimingPass().Run(&unit, options, &results),
+              IsOkAndHolds(true));
+  EXPECT_EQ(unit.schedule->cycle(c.node()), 1);
+  EXPECT_THAT(RetimingPass().Run(&unit, options, &results),
+              IsOkAndHolds(false));
+}
+
+}  // namespace
+}  // namespace xls
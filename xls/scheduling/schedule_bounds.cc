@@ -14,42 +14,159 @@
 
 #include "xls/scheduling/schedule_bounds.h"
 
+#include <algorithm>
+#include <functional>
+#include <thread>  // NOLINT(build/c++11)
+
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
 #include "xls/ir/node_iterator.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 namespace sched {
+namespace {
+
+// Levels are only partitioned among threads if each thread gets at least this
+// many nodes, as starting a thread costs about as much as propagating bounds
+// through a few thousand nodes.
+constexpr int64_t kMinNodesPerThread = 4096;
+
+// Calls 'propagate(begin, end)' on ranges of node indices covering each level
+// in turn, in order of increasing level or of decreasing level if 'reverse' is
+// true. Wide levels are split into ranges propagated concurrently. Returns the
+// error of the first failing range.
+absl::Status ForEachLevel(
+    absl::Span<const int64_t> level_begin, bool reverse,
+    const std::function<absl::Status(int64_t, int64_t)>& propagate) {
+  const int64_t max_threads =
+      std::max<int64_t>(1, std::thread::hardware_concurrency());
+  const int64_t level_count = level_begin.size() - 1;
+  std::vector<absl::Status> statuses;
+  for (int64_t i = 0; i < level_count; ++i) {
+    int64_t level = reverse ? level_count - 1 - i : i;
+    int64_t begin = level_begin[level];
+    int64_t end = level_begin[level + 1];
+    int64_t thread_count =
+        std::min(max_threads, (end - begin) / kMinNodesPerThread);
+    if (thread_count <= 1) {
+      XLS_RETURN_IF_ERROR(propagate(begin, end));
+      continue;
+    }
+    int64_t chunk_size = CeilOfRatio(end - begin, thread_count);
+    statuses.assign(thread_count, absl::OkStatus());
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t t = 1; t < thread_count; ++t) {
+      threads.push_back(std::make_unique<Thread>([&, t]() {
+        statuses[t] = propagate(begin + t * chunk_size,
+                                std::min(end, begin + (t + 1) * chunk_size));
+      }));
+    }
+    statuses[0] = propagate(begin, begin + chunk_size);
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+    for (const absl::Status& status : statuses) {
+      XLS_RETURN_IF_ERROR(status);
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+/* static */ std::shared_ptr<const ScheduleBounds::Graph>
+ScheduleBounds::BuildGraph(absl::Span<Node* const> topo_sort,
+                           const DelayEstimator& delay_estimator) {
+  auto graph = std::make_shared<Graph>();
+
+  // Bucket the nodes by level. Nodes within a level keep their relative order
+  // in the given topological sort.
+  NodeMap<int64_t> level;
+  std::vector<int64_t> level_size;
+  for (Node* node : topo_sort) {
+    int64_t node_level = 0;
+    for (Node* operand : node->operands()) {
+      node_level = std::max(node_level, level.at(operand) + 1);
+    }
+    level[node] = node_level;
+    if (node_level >= level_size.size()) {
+      level_size.resize(node_level + 1, 0);
+    }
+    ++level_size[node_level];
+  }
+  graph->level_begin.resize(level_size.size() + 1, 0);
+  for (int64_t l = 0; l < level_size.size(); ++l) {
+    graph->level_begin[l + 1] = graph->level_begin[l] + level_size[l];
+  }
+  graph->nodes.resize(topo_sort.size());
+  std::vector<int64_t> next_index(graph->level_begin.begin(),
+                                  graph->level_begin.end() - 1);
+  for (Node* node : topo_sort) {
+    int64_t index = next_index[level.at(node)]++;
+    graph->nodes[index] = node;
+    graph->node_index[node] = index;
+  }
+
+  graph->delay_ps.resize(graph->nodes.size(), 0);
+  for (int64_t i = 0; i < graph->nodes.size(); ++i) {
+    Node* node = graph->nodes[i];
+    graph->operand_begin.push_back(graph->operand_indices.size());
+    for (Node* operand : node->operands()) {
+      graph->operand_indices.push_back(graph->node_index.at(operand));
+    }
+    graph->user_begin.push_back(graph->user_indices.size());
+    for (Node* user : node->users()) {
+      graph->user_indices.push_back(graph->node_index.at(user));
+    }
+    absl::StatusOr<int64_t> delay = delay_estimator.GetOperationDelayInPs(node);
+    if (!delay.ok()) {
+      if (graph->delay_status.ok()) {
+        graph->delay_status = delay.status();
+      }
+      continue;
+    }
+    graph->delay_ps[i] = *delay;
+  }
+  graph->operand_begin.push_back(graph->operand_indices.size());
+  graph->user_begin.push_back(graph->user_indices.size());
+  return graph;
+}
 
 ScheduleBounds::ScheduleBounds(Function* f, int64_t clock_period_ps,
                                const DelayEstimator& delay_estimator)
-    : clock_period_ps_(clock_period_ps), delay_estimator_(&delay_estimator) {
+    : clock_period_ps_(clock_period_ps) {
   auto topo_sort_it = TopoSort(f);
-  topo_sort_ = std::vector<Node*>(topo_sort_it.begin(), topo_sort_it.end());
+  graph_ = BuildGraph(
+      std::vector<Node*>(topo_sort_it.begin(), topo_sort_it.end()),
+      delay_estimator);
   Reset();
 }
 
 ScheduleBounds::ScheduleBounds(Function* f, std::vector<Node*> topo_sort,
                                int64_t clock_period_ps,
                                const DelayEstimator& delay_estimator)
-    : topo_sort_(std::move(topo_sort)),
-      clock_period_ps_(clock_period_ps),
-      delay_estimator_(&delay_estimator) {
+    : graph_(BuildGraph(topo_sort, delay_estimator)),
+      clock_period_ps_(clock_period_ps) {
   Reset();
 }
 
 void ScheduleBounds::Reset() {
   max_lower_bound_ = 0;
   min_upper_bound_ = 0;
-  for (Node* node : topo_sort_) {
-    if (node->Is<Param>()) {
+  bounds_.resize(graph_->nodes.size());
+  for (int64_t i = 0; i < graph_->nodes.size(); ++i) {
+    if (graph_->nodes[i]->Is<Param>()) {
       // Always schedule parameters in cycle zero.
-      bounds_[node] = {0, 0};
+      bounds_[i] = {0, 0};
     } else {
-      bounds_[node] = {0, std::numeric_limits<int64_t>::max()};
+      bounds_[i] = {0, std::numeric_limits<int64_t>::max()};
       max_lower_bound_ = 0;
       min_upper_bound_ = std::numeric_limits<int64_t>::max();
     }
@@ -58,9 +175,9 @@ void ScheduleBounds::Reset() {
 
 std::string ScheduleBounds::ToString() const {
   std::string out = "Bounds:\n";
-  if (!bounds_.empty()) {
-    for (Node* node : TopoSort(bounds_.begin()->first->function_base())) {
-      if (bounds_.contains(node)) {
+  if (!graph_->nodes.empty()) {
+    for (Node* node : TopoSort(graph_->nodes.front()->function_base())) {
+      if (graph_->node_index.contains(node)) {
         absl::StrAppendFormat(&out, "  %s : [%d, %d]\n", node->GetName(),
                               lb(node), ub(node));
       }
@@ -71,91 +188,115 @@ std::string ScheduleBounds::ToString() const {
 
 absl::Status ScheduleBounds::PropagateLowerBounds() {
   XLS_VLOG(4) << "PropagateLowerBounds()";
+  XLS_RETURN_IF_ERROR(graph_->delay_status);
   // The delay in picoseconds from the beginning of a cycle to the start of the
   // node.
-  absl::flat_hash_map<Node*, int64_t> in_cycle_delay;
+  std::vector<int64_t> in_cycle_delay(graph_->nodes.size(), 0);
 
   // Compute the lower bound of each node based on the lower bounds of the
-  // operands of the node.
-  for (Node* node : topo_sort_) {
-    int64_t& node_in_cycle_delay = in_cycle_delay[node];
-    XLS_VLOG(4) << absl::StreamFormat("  %s : original lb=%d", node->GetName(),
-                                      lb(node));
-    for (Node* operand : node->operands()) {
-      int64_t operand_lb = lb(operand);
-      if (operand_lb < lb(node)) {
-        continue;
+  // operands of the node. The operands of a node are in earlier levels so the
+  // nodes of a level may be processed concurrently.
+  absl::Mutex mutex;
+  auto propagate = [&](int64_t begin, int64_t end) -> absl::Status {
+    int64_t max_lower_bound = 0;
+    for (int64_t i = begin; i < end; ++i) {
+      Node* node = graph_->nodes[i];
+      int64_t& node_lb = bounds_[i].first;
+      int64_t& node_in_cycle_delay = in_cycle_delay[i];
+      XLS_VLOG(4) << absl::StreamFormat("  %s : original lb=%d",
+                                        node->GetName(), node_lb);
+      for (int64_t k = graph_->operand_begin[i];
+           k < graph_->operand_begin[i + 1]; ++k) {
+        int64_t operand = graph_->operand_indices[k];
+        int64_t operand_lb = bounds_[operand].first;
+        if (operand_lb < node_lb) {
+          continue;
+        }
+        int64_t operand_delay = graph_->delay_ps[operand];
+        if (operand_lb > node_lb) {
+          XLS_VLOG(4) << absl::StreamFormat(
+              "    tightened lb to %d because of operand %s", operand_lb,
+              graph_->nodes[operand]->GetName());
+          XLS_RETURN_IF_ERROR(TightenLb(i, operand_lb));
+          node_in_cycle_delay = in_cycle_delay[operand] + operand_delay;
+          continue;
+        }
+        node_in_cycle_delay = std::max(
+            node_in_cycle_delay, in_cycle_delay[operand] + operand_delay);
       }
-      XLS_ASSIGN_OR_RETURN(int64_t operand_delay,
-                           delay_estimator_->GetOperationDelayInPs(operand));
-      if (operand_lb > lb(node)) {
-        XLS_VLOG(4) << absl::StreamFormat(
-            "    tightened lb to %d because of operand %s", operand_lb,
-            operand->GetName());
-        XLS_RETURN_IF_ERROR(TightenNodeLb(node, operand_lb));
-        node_in_cycle_delay = in_cycle_delay.at(operand) + operand_delay;
-        continue;
+      int64_t node_delay = graph_->delay_ps[i];
+      XLS_RET_CHECK_LE(node_delay, clock_period_ps_) << node;
+      if (node_in_cycle_delay + node_delay > clock_period_ps_) {
+        // Node does not fit in this cycle. Move to next cycle.
+        XLS_VLOG(4) << "    overflows clock period, tightened lb to "
+                    << node_lb + 1;
+        XLS_RETURN_IF_ERROR(TightenLb(i, node_lb + 1));
+        node_in_cycle_delay = 0;
       }
-      node_in_cycle_delay = std::max(
-          node_in_cycle_delay, in_cycle_delay.at(operand) + operand_delay);
-    }
-    XLS_ASSIGN_OR_RETURN(int64_t node_delay,
-                         delay_estimator_->GetOperationDelayInPs(node));
-    XLS_RET_CHECK_LE(node_delay, clock_period_ps_) << node;
-    if (node_in_cycle_delay + node_delay > clock_period_ps_) {
-      // Node does not fit in this cycle. Move to next cycle.
-      XLS_VLOG(4) << "    overflows clock period, tightened lb to "
-                  << lb(node) + 1;
-      XLS_RETURN_IF_ERROR(TightenNodeLb(node, lb(node) + 1));
-      node_in_cycle_delay = 0;
+      max_lower_bound = std::max(max_lower_bound, node_lb);
     }
-  }
-  return absl::OkStatus();
+    absl::MutexLock lock(&mutex);
+    max_lower_bound_ = std::max(max_lower_bound_, max_lower_bound);
+    return absl::OkStatus();
+  };
+  return ForEachLevel(graph_->level_begin, /*reverse=*/false, propagate);
 }
 
 absl::Status ScheduleBounds::PropagateUpperBounds() {
   XLS_VLOG(4) << "PropagateUpperBounds()";
+  XLS_RETURN_IF_ERROR(graph_->delay_status);
   // The delay in picoseconds from the end of a cycle to the end of the node.
-  absl::flat_hash_map<Node*, int64_t> in_cycle_delay;
+  std::vector<int64_t> in_cycle_delay(graph_->nodes.size(), 0);
 
   // Compute the upper bound of each node based on the upper bounds of the
-  // users of the node.
-  for (auto it = topo_sort_.rbegin(); it != topo_sort_.rend(); ++it) {
-    Node* node = *it;
-    int64_t& node_in_cycle_delay = in_cycle_delay[node];
-    XLS_VLOG(4) << absl::StreamFormat("  %s : original ub=%d", node->GetName(),
-                                      ub(node));
-    for (Node* user : node->users()) {
-      int64_t user_ub = ub(user);
-      if (user_ub == std::numeric_limits<int64_t>::max() ||
-          user_ub > ub(node)) {
-        continue;
+  // users of the node. The users of a node are in later levels so the nodes of
+  // a level may be processed concurrently.
+  absl::Mutex mutex;
+  auto propagate = [&](int64_t begin, int64_t end) -> absl::Status {
+    int64_t min_upper_bound = std::numeric_limits<int64_t>::max();
+    for (int64_t i = begin; i < end; ++i) {
+      Node* node = graph_->nodes[i];
+      int64_t& node_ub = bounds_[i].second;
+      int64_t& node_in_cycle_delay = in_cycle_delay[i];
+      XLS_VLOG(4) << absl::StreamFormat("  %s : original ub=%d",
+                                        node->GetName(), node_ub);
+      for (int64_t k = graph_->user_begin[i]; k < graph_->user_begin[i + 1];
+           ++k) {
+        int64_t user = graph_->user_indices[k];
+        int64_t user_ub = bounds_[user].second;
+        if (user_ub == std::numeric_limits<int64_t>::max() ||
+            user_ub > node_ub) {
+          continue;
+        }
+        int64_t user_delay = graph_->delay_ps[user];
+        if (user_ub < node_ub) {
+          XLS_VLOG(4) << absl::StreamFormat(
+              "    tightened ub to %d because of user %s", user_ub,
+              graph_->nodes[user]->GetName());
+          XLS_RETURN_IF_ERROR(TightenUb(i, user_ub));
+          min_upper_bound = std::min(min_upper_bound, user_ub);
+          node_in_cycle_delay = in_cycle_delay[user] + user_delay;
+          continue;
+        }
+        node_in_cycle_delay =
+            std::max(node_in_cycle_delay, in_cycle_delay[user] + user_delay);
       }
-      XLS_ASSIGN_OR_RETURN(int64_t user_delay,
-                           delay_estimator_->GetOperationDelayInPs(user));
-      if (user_ub < ub(node)) {
-        XLS_VLOG(4) << absl::StreamFormat(
-            "    tightened ub to %d because of user %s", user_ub,
-            user->GetName());
-        XLS_RETURN_IF_ERROR(TightenNodeUb(node, user_ub));
-        node_in_cycle_delay = in_cycle_delay.at(user) + user_delay;
-        continue;
+      int64_t node_delay = graph_->delay_ps[i];
+      XLS_RET_CHECK_LE(node_delay, clock_period_ps_) << node;
+      if (node_in_cycle_delay + node_delay > clock_period_ps_) {
+        // Node does not fit in this cycle. Move to next cycle.
+        XLS_VLOG(4) << "    overflows clock period, tightened ub to "
+                    << node_ub - 1;
+        XLS_RETURN_IF_ERROR(TightenUb(i, node_ub - 1));
+        min_upper_bound = std::min(min_upper_bound, node_ub);
+        node_in_cycle_delay = 0;
       }
-      node_in_cycle_delay =
-          std::max(node_in_cycle_delay, in_cycle_delay.at(user) + user_delay);
-    }
-    XLS_ASSIGN_OR_RETURN(int64_t node_delay,
-                         delay_estimator_->GetOperationDelayInPs(node));
-    XLS_RET_CHECK_LE(node_delay, clock_period_ps_) << node;
-    if (node_in_cycle_delay + node_delay > clock_period_ps_) {
-      // Node does not fit in this cycle. Move to next cycle.
-      XLS_VLOG(4) << "    overflows clock period, tightened ub to "
-                  << ub(node) - 1;
-      XLS_RETURN_IF_ERROR(TightenNodeUb(node, ub(node) - 1));
-      node_in_cycle_delay = 0;
     }
-  }
-  return absl::OkStatus();
+    absl::MutexLock lock(&mutex);
+    min_upper_bound_ = std::min(min_upper_bound_, min_upper_bound);
+    return absl::OkStatus();
+  };
+  return ForEachLevel(graph_->level_begin, /*reverse=*/true, propagate);
 }
 
 /* static */
@@ -17,17 +17,22 @@
 
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/ir/function.h"
 #include "xls/ir/node.h"
+#include "xls/ir/node_map.h"
 
 namespace xls {
 namespace sched {
@@ -35,6 +40,13 @@ namespace sched {
 // An abstraction holding lower and upper bounds for each node in a
 // function. The bounds are constraints on cycles in which a node may be
 // scheduled.
+//
+// Bounds are stored in a vector indexed by the position of the node in a
+// topological order grouped by level, where the level of a node is the length
+// of the longest path to it from a node with no operands. The nodes of a level
+// are independent so propagation processes wide levels in parallel. The
+// function structure and the node delays, which are estimated once upon
+// construction, are shared between copies of the bounds.
 class ScheduleBounds {
  public:
   // Returns a object with the lower bounds of each node set to the earliest
@@ -47,7 +59,7 @@ class ScheduleBounds {
       const DelayEstimator& delay_estimator);
 
   // Upon construction all parameters have lower and upper bounds of 0. All
-  // other nodes have a lower bound of 1 and an upper bound of INT64_MAX.
+  // other nodes have a lower bound of 0 and an upper bound of INT64_MAX.
   ScheduleBounds(Function* f, int64_t clock_period_ps,
                  const DelayEstimator& delay_estimator);
 
@@ -66,24 +78,19 @@ class ScheduleBounds {
   void Reset();
 
   // Return the lower/upper bound of the given node.
-  int64_t lb(Node* node) const { return bounds_.at(node).first; }
-  int64_t ub(Node* node) const { return bounds_.at(node).second; }
+  int64_t lb(Node* node) const { return bounds(node).first; }
+  int64_t ub(Node* node) const { return bounds(node).second; }
 
   // Return the lower and upper bound as a pair (lower bound is first element).
   const std::pair<int64_t, int64_t>& bounds(Node* node) const {
-    return bounds_.at(node);
+    return bounds_[graph_->node_index.at(node)];
   }
 
   // Sets the lower bound of the given node to the maximum of its existing value
   // and the given value. Raises a ResourceExhaustedError if the new value
   // results in infeasible bounds (lower bound is greater than upper bound).
   absl::Status TightenNodeLb(Node* node, int64_t value) {
-    if (value > ub(node)) {
-      return absl::ResourceExhaustedError(
-          absl::StrFormat("Unable to tighten the lower bound of node %s to %d.",
-                          node->GetName(), value));
-    }
-    bounds_.at(node).first = std::max(bounds_.at(node).first, value);
+    XLS_RETURN_IF_ERROR(TightenLb(graph_->node_index.at(node), value));
     max_lower_bound_ = std::max(max_lower_bound_, value);
     return absl::OkStatus();
   }
@@ -92,12 +99,7 @@ class ScheduleBounds {
   // and the given value. Raises a ResourceExhaustedError if the new value
   // results in infeasible bounds (lower bound is greater than upper bound).
   absl::Status TightenNodeUb(Node* node, int64_t value) {
-    if (value < lb(node)) {
-      return absl::ResourceExhaustedError(
-          absl::StrFormat("Unable to tighten the upper bound of node %s to %d.",
-                          node->GetName(), value));
-    }
-    bounds_.at(node).second = std::min(bounds_.at(node).second, value);
+    XLS_RETURN_IF_ERROR(TightenUb(graph_->node_index.at(node), value));
     min_upper_bound_ = std::min(min_upper_bound_, value);
     return absl::OkStatus();
   }
@@ -118,14 +120,61 @@ class ScheduleBounds {
   absl::Status PropagateUpperBounds();
 
  private:
-  // A topological sort of the nodes in the function.
-  std::vector<Node*> topo_sort_;
+  // The structure of the function with nodes identified by index.
+  struct Graph {
+    // The nodes in topological order grouped by level: the nodes of level l
+    // are at indices [level_begin[l], level_begin[l + 1]).
+    std::vector<Node*> nodes;
+    std::vector<int64_t> level_begin;
+    NodeMap<int64_t> node_index;
+
+    // The operands (users) of node i are operand_indices (user_indices) in the
+    // range [operand_begin[i], operand_begin[i + 1]).
+    std::vector<int64_t> operand_begin;
+    std::vector<int64_t> operand_indices;
+    std::vector<int64_t> user_begin;
+    std::vector<int64_t> user_indices;
+
+    // The delay of each node, and the error if any delay could not be
+    // estimated. The error is returned when bounds are propagated.
+    std::vector<int64_t> delay_ps;
+    absl::Status delay_status;
+  };
+
+  static std::shared_ptr<const Graph> BuildGraph(
+      absl::Span<Node* const> topo_sort, const DelayEstimator& delay_estimator);
+
+  // Versions of TightenNodeLb and TightenNodeUb taking a node index which do
+  // not update max_lower_bound_ and min_upper_bound_ and so may be called
+  // concurrently for different nodes.
+  absl::Status TightenLb(int64_t index, int64_t value) {
+    std::pair<int64_t, int64_t>& node_bounds = bounds_[index];
+    if (value > node_bounds.second) {
+      return absl::ResourceExhaustedError(
+          absl::StrFormat("Unable to tighten the lower bound of node %s to %d.",
+                          graph_->nodes[index]->GetName(), value));
+    }
+    node_bounds.first = std::max(node_bounds.first, value);
+    return absl::OkStatus();
+  }
+  absl::Status TightenUb(int64_t index, int64_t value) {
+    std::pair<int64_t, int64_t>& node_bounds = bounds_[index];
+    if (value < node_bounds.first) {
+      return absl::ResourceExhaustedError(
+          absl::StrFormat("Unable to tighten the upper bound of node %s to %d.",
+                          graph_->nodes[index]->GetName(), value));
+    }
+    node_bounds.second = std::min(node_bounds.second, value);
+    return absl::OkStatus();
+  }
+
+  std::shared_ptr<const Graph> graph_;
 
   int64_t clock_period_ps_;
-  const DelayEstimator* delay_estimator_;
 
-  // The bounds of each node stored as a {lower, upper} pair.
-  absl::flat_hash_map<Node*, std::pair<int64_t, int64_t>> bounds_;
+  // The bounds of each node stored as a {lower, upper} pair, indexed as in
+  // graph_.
+  std::vector<std::pair<int64_t, int64_t>> bounds_;
 
   int64_t max_lower_bound_;
   int64_t min_upper_bound_;
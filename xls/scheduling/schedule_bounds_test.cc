@@ -14,6 +14,9 @@
 
 #include "xls/scheduling/schedule_bounds.h"
 
+#include <limits>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/statusor.h"
@@ -160,6 +163,39 @@ TEST_F(ScheduleBoundsTest, SimpleExpressionTightenBounds) {
   EXPECT_EQ(bounds.lb(result.node()), 23);
 }
 
+TEST_F(ScheduleBoundsTest, WideLevelsArePropagatedConcurrently) {
+  // Two levels wide enough to be partitioned among threads.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  auto x = fb.Param("x", p->GetBitsType(1));
+  std::vector<BValue> firsts;
+  std::vector<BValue> seconds;
+  for (int64_t i = 0; i < 20000; ++i) {
+    firsts.push_back(fb.Not(x));
+    seconds.push_back(fb.Not(firsts.back()));
+  }
+  fb.Concat(seconds);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(ScheduleBounds bounds,
+                           ScheduleBounds::ComputeAsapAndAlapBounds(
+                               f,
+                               /*clock_period_ps=*/1, delay_estimator_));
+  EXPECT_EQ(bounds.max_lower_bound(), 1);
+  for (int64_t i = 0; i < firsts.size(); ++i) {
+    EXPECT_THAT(bounds.bounds(firsts[i].node()), Pair(0, 0));
+    EXPECT_THAT(bounds.bounds(seconds[i].node()), Pair(1, 1));
+  }
+  EXPECT_THAT(bounds.bounds(f->return_value()), Pair(1, 1));
+
+  // Copies share the function structure but not the bounds.
+  ScheduleBounds copy = bounds;
+  copy.Reset();
+  EXPECT_THAT(copy.bounds(seconds[0].node()),
+              Pair(0, std::numeric_limits<int64_t>::max()));
+  EXPECT_THAT(bounds.bounds(seconds[0].node()), Pair(1, 1));
+}
+
 }  // namespace
 }  // namespace sched
 }  // namespace xls
@@ -35,6 +35,7 @@ struct SchedulingUnit {
   // Methods required by CompoundPassBase.
   std::string DumpIr() const;
   std::string name() const { return package->name(); }
+  int64_t GetNodeCount() const { return package->GetNodeCount(); }
 };
 
 // Options passed to each scheduling pass.
@@ -0,0 +1,170 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/scheduling/sdc_scheduler.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/data_structures/difference_constraints.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace sched {
+namespace {
+
+// Returns the pairs of nodes (u, v) such that the longest path from the start
+// of u to the end of v exceeds the clock period, so v must be scheduled in a
+// later cycle than u. Pairs implied by others are omitted: the search forward
+// from each node stops at the nodes where the clock period is first exceeded,
+// as their descendants must be scheduled no earlier than they are.
+std::vector<std::pair<Node*, Node*>> TimingConstraints(
+    absl::Span<Node* const> topo_sort,
+    const absl::flat_hash_map<Node*, int64_t>& topo_index,
+    const absl::flat_hash_map<Node*, int64_t>& delays,
+    int64_t clock_period_ps) {
+  std::vector<std::pair<Node*, Node*>> constraints;
+  for (Node* source : topo_sort) {
+    // The longest path from the start of 'source' to the end of each node
+    // reached without exceeding the clock period. Nodes are visited in
+    // topological order so each node's path is final when it is visited.
+    absl::flat_hash_map<Node*, int64_t> path_delay = {
+        {source, delays.at(source)}};
+    absl::flat_hash_set<Node*> later_nodes;
+    using QueueEntry = std::pair<int64_t, Node*>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        queue;
+    queue.push({topo_index.at(source), source});
+    while (!queue.empty()) {
+      Node* node = queue.top().second;
+      queue.pop();
+      int64_t node_path_delay = path_delay.at(node);
+      for (Node* user : node->users()) {
+        int64_t user_path_delay = node_path_delay + delays.at(user);
+        if (user_path_delay > clock_period_ps) {
+          if (later_nodes.insert(user).second) {
+            constraints.push_back({source, user});
+          }
+          continue;
+        }
+        auto [it, inserted] = path_delay.insert({user, user_path_delay});
+        if (inserted) {
+          queue.push({topo_index.at(user), user});
+        } else {
+          it->second = std::max(it->second, user_path_delay);
+        }
+      }
+    }
+  }
+  return constraints;
+}
+
+}  // namespace
+
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>>
+SdcScheduleToMinimizeRegisters(Function* f, int64_t pipeline_stages,
+                               int64_t clock_period_ps,
+                               const DelayEstimator& delay_estimator) {
+  XLS_VLOG(3) << "SdcScheduleToMinimizeRegisters()";
+  XLS_VLOG(3) << "  pipeline stages = " << pipeline_stages;
+  XLS_RET_CHECK_GT(pipeline_stages, 0);
+
+  std::vector<Node*> topo_sort;
+  absl::flat_hash_map<Node*, int64_t> topo_index;
+  absl::flat_hash_map<Node*, int64_t> delays;
+  for (Node* node : TopoSort(f)) {
+    topo_index[node] = topo_sort.size();
+    topo_sort.push_back(node);
+    XLS_ASSIGN_OR_RETURN(delays[node],
+                         delay_estimator.GetOperationDelayInPs(node));
+    if (delays[node] > clock_period_ps) {
+      return absl::ResourceExhaustedError(absl::StrFormat(
+          "Node %s has a delay of %dps which exceeds the clock period of %dps",
+          node->GetName(), delays[node], clock_period_ps));
+    }
+  }
+
+  // The variables are the cycle of each node, relative to 'origin', and for
+  // each node with users a 'lifetime end' no earlier than the cycle of each
+  // user. The objective is the sum over nodes of the bit count times the
+  // difference between the lifetime end and the cycle of the node.
+  DifferenceConstraintSystem system;
+  std::vector<int64_t> costs;
+  auto add_variable = [&]() {
+    costs.push_back(0);
+    return system.AddVariable();
+  };
+  int64_t origin = add_variable();
+  absl::flat_hash_map<Node*, int64_t> cycle;
+  for (Node* node : topo_sort) {
+    int64_t node_cycle = add_variable();
+    cycle[node] = node_cycle;
+    system.AddConstraint(origin, node_cycle, 0);
+    system.AddConstraint(node_cycle, origin, -(pipeline_stages - 1));
+    if (node->Is<Param>()) {
+      system.AddConstraint(node_cycle, origin, 0);
+    } else if (node == f->return_value()) {
+      system.AddConstraint(origin, node_cycle, pipeline_stages - 1);
+    }
+    for (Node* operand : node->operands()) {
+      system.AddConstraint(cycle.at(operand), node_cycle, 0);
+    }
+  }
+  for (Node* node : topo_sort) {
+    int64_t bit_count = node->GetType()->GetFlatBitCount();
+    if (node->users().empty() || bit_count == 0) {
+      continue;
+    }
+    int64_t lifetime_end = add_variable();
+    for (Node* user : node->users()) {
+      system.AddConstraint(cycle.at(user), lifetime_end, 0);
+    }
+    costs[lifetime_end] += bit_count;
+    costs[cycle.at(node)] -= bit_count;
+  }
+  for (const auto& [from, to] :
+       TimingConstraints(topo_sort, topo_index, delays, clock_period_ps)) {
+    system.AddConstraint(cycle.at(from), cycle.at(to), 1);
+  }
+  XLS_VLOG(3) << absl::StreamFormat("SDC: %d variables, %d constraints",
+                                    system.variable_count(),
+                                    system.constraint_count());
+
+  absl::StatusOr<std::vector<int64_t>> values = system.Minimize(costs);
+  if (!values.ok()) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Cannot be scheduled in %d stages: %s", pipeline_stages,
+        values.status().message()));
+  }
+  // All cycles are at least the origin's, so the smallest value (which
+  // Minimize shifts to zero) is the origin.
+  XLS_RET_CHECK_EQ((*values)[origin], 0);
+  absl::flat_hash_map<Node*, int64_t> cycle_map;
+  for (Node* node : topo_sort) {
+    cycle_map[node] = (*values)[cycle.at(node)];
+  }
+  return cycle_map;
+}
+
+}  // namespace sched
+}  // namespace xls
@@ -0,0 +1,56 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SCHEDULING_SDC_SCHEDULER_H_
+#define XLS_SCHEDULING_SDC_SCHEDULER_H_
+
+#include <cstdint>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+namespace sched {
+
+// Schedules the nodes of the function into the given number of pipeline stages
+// such that the total number of pipeline register bits is minimized, by
+// formulating scheduling as a system of difference constraints (SDC) over the
+// cycle of each node:
+//
+//  (1) Each node is scheduled no earlier than its operands.
+//  (2) A node is scheduled at least one cycle after any node from which the
+//      longest path through it (including both endpoints) exceeds the clock
+//      period.
+//  (3) Parameters are scheduled in the first stage, the return value in the
+//      last stage, and all other nodes within the pipeline.
+//
+// The register cost of a node is its bit count times the number of cycles from
+// its cycle to that of its latest user. Unlike the iterated min-cut of
+// MINIMIZE_REGISTERS, which optimizes one stage boundary at a time, this
+// optimizes all boundaries jointly and exactly in polynomial time.
+//
+// Returns a map from node to cycle, or an error if the function cannot be
+// scheduled in the given number of stages.
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>>
+SdcScheduleToMinimizeRegisters(Function* f, int64_t pipeline_stages,
+                               int64_t clock_period_ps,
+                               const DelayEstimator& delay_estimator);
+
+}  // namespace sched
+}  // namespace xls
+
+#endif  // XLS_SCHEDULING_SDC_SCHEDULER_H_
@@ -14,6 +14,8 @@
 
 #include "xls/simulation/module_simulator.h"
 
+#include <utility>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
@@ -56,6 +58,9 @@ absl::Status ModuleSimulator::DeassertControlSignals(
         signature_.proto().pipeline().pipeline_control();
     if (pipeline_control.has_valid()) {
       tb->Set(pipeline_control.valid().input_name(), 0);
+    } else if (pipeline_control.has_ready_valid()) {
+      tb->Set(pipeline_control.ready_valid().input_valid_name(), 0);
+      tb->Set(pipeline_control.ready_valid().output_ready_name(), 0);
     }
   }
   return absl::OkStatus();
@@ -187,64 +192,110 @@ ModuleSimulator::RunBatched(absl::Span<const BitsMap> inputs) const {
       pipeline_control = signature_.proto().pipeline().pipeline_control();
     }
 
+    // The names of the input and output valid signals, if any.
+    absl::optional<std::string> input_valid;
+    absl::optional<std::string> output_valid;
     if (pipeline_control.has_value() && pipeline_control->has_manual()) {
       // Drive the pipeline register load-enable signals high.
       tb.Set(pipeline_control->manual().input_name(), Bits::AllOnes(latency));
+    } else if (pipeline_control.has_value() && pipeline_control->has_valid()) {
+      input_valid = pipeline_control->valid().input_name();
+      if (pipeline_control->valid().has_output_name()) {
+        output_valid = pipeline_control->valid().output_name();
+      }
+    } else if (pipeline_control.has_value() &&
+               pipeline_control->has_ready_valid()) {
+      // The outputs are always consumed so the pipeline never stalls and
+      // behaves like one with valid control.
+      const ReadyValidPipelineControl& ready_valid =
+          pipeline_control->ready_valid();
+      input_valid = ready_valid.input_valid_name();
+      output_valid = ready_valid.output_valid_name();
+      tb.Set(ready_valid.output_ready_name(), 1);
     }
 
     // Expect the output_valid signal (if it exists) to be the given value or X.
     auto maybe_expect_output_valid = [&](bool expect_x, bool expected_value) {
-      if (pipeline_control.has_value() && pipeline_control->has_valid() &&
-          pipeline_control->valid().has_output_name()) {
+      if (output_valid.has_value()) {
         if (expect_x) {
-          tb.ExpectX(pipeline_control->valid().output_name());
+          tb.ExpectX(*output_valid);
         } else {
-          tb.ExpectEq(pipeline_control->valid().output_name(), expected_value);
+          tb.ExpectEq(*output_valid, expected_value);
         }
       }
     };
-    while (cycle < inputs.size()) {
-      drive_data(cycle);
-      if (pipeline_control.has_value() && pipeline_control->has_valid()) {
-        tb.Set(pipeline_control->valid().input_name(), 1);
+    const int64_t initiation_interval =
+        signature_.proto().pipeline().initiation_interval();
+    if (initiation_interval > 1) {
+      // Drive each input for a full initiation interval so it is sampled in
+      // the cycle in which the first stage is active, whatever the phase of
+      // the pipeline. The outputs are then held for an initiation interval
+      // starting at most 'initiation_interval' - 1 cycles after the latency,
+      // so capture them at the end of that window.
+      if (input_valid.has_value()) {
+        tb.Set(*input_valid, 1);
       }
-      // Pipelined interface: drive inputs for a cycle, then wait for compute to
-      // complete.  A pipelined interface should not require that the inputs be
-      // held for more than a cycle.
-      tb.NextCycle();
-      cycle++;
-
-      if (cycle >= latency) {
+      const int64_t capture_cycle = latency + initiation_interval - 1;
+      for (; captured_outputs < inputs.size(); ++cycle) {
+        if (cycle % initiation_interval == 0 &&
+            cycle / initiation_interval < inputs.size()) {
+          drive_data(cycle / initiation_interval);
+        }
+        if (cycle >= capture_cycle &&
+            (cycle - capture_cycle) % initiation_interval == 0) {
+          maybe_expect_output_valid(/*expect_x=*/false,
+                                    /*expected_value=*/true);
+          capture_outputs(captured_outputs);
+          captured_outputs++;
+        }
+        tb.NextCycle();
+      }
+    } else {
+      while (cycle < inputs.size()) {
+        drive_data(cycle);
+        if (input_valid.has_value()) {
+          tb.Set(*input_valid, 1);
+        }
+        // Pipelined interface: drive inputs for a cycle, then wait for compute
+        // to complete.  A pipelined interface should not require that the
+        // inputs be held for more than a cycle.
+        tb.NextCycle();
+        cycle++;
+
+        if (cycle >= latency) {
+          maybe_expect_output_valid(/*expect_x=*/false,
+                                    /*expected_value=*/true);
+          capture_outputs(captured_outputs);
+          captured_outputs++;
+        } else {
+          // The initial inputs have not yet reached the end of the pipeline.
+          // The output_valid signal (if it exists) should still be X if there
+          // is no reset signal.
+          maybe_expect_output_valid(
+              /*expect_x=*/!signature_.proto().has_reset(),
+              /*expected_value=*/false);
+        }
+      }
+      for (const PortProto& input : signature_.data_inputs()) {
+        tb.SetX(input.name());
+      }
+      if (input_valid.has_value()) {
+        tb.Set(*input_valid, 0);
+      }
+      if (cycle < latency - 1) {
+        tb.AdvanceNCycles(latency - 1 - cycle);
+      }
+      while (captured_outputs < inputs.size()) {
+        tb.NextCycle();
         maybe_expect_output_valid(/*expect_x=*/false, /*expected_value=*/true);
         capture_outputs(captured_outputs);
         captured_outputs++;
-      } else {
-        // The initial inputs have not yet reached the end of the pipeline. The
-        // output_valid signal (if it exists) should still be X if there is no
-        // reset signal.
-        maybe_expect_output_valid(/*expect_x=*/!signature_.proto().has_reset(),
-                                  /*expected_value=*/false);
       }
-    }
-    for (const PortProto& input : signature_.data_inputs()) {
-      tb.SetX(input.name());
-    }
-    if (pipeline_control.has_value() && pipeline_control->has_valid()) {
-      tb.Set(pipeline_control->valid().input_name(), 0);
-    }
-    if (cycle < latency - 1) {
-      tb.AdvanceNCycles(latency - 1 - cycle);
-    }
-    while (captured_outputs < inputs.size()) {
+      // valid == 0 should have propagated all the way through the pipeline to
+      // output_valid.
       tb.NextCycle();
-      maybe_expect_output_valid(/*expect_x=*/false, /*expected_value=*/true);
-      capture_outputs(captured_outputs);
-      captured_outputs++;
+      maybe_expect_output_valid(/*expect_x=*/false, /*expected_value=*/false);
     }
-    // valid == 0 should have propagated all the way through the pipeline to
-    // output_valid.
-    tb.NextCycle();
-    maybe_expect_output_valid(/*expect_x=*/false, /*expected_value=*/false);
   } else if (signature_.proto().has_combinational()) {
     for (int64_t i = 0; i < inputs.size(); ++i) {
       drive_data(i);
@@ -288,6 +339,40 @@ absl::StatusOr<Value> ModuleSimulator::Run(
   return outputs[0];
 }
 
+absl::Status ModuleSimulator::RunStreaming(const InputGenerator& next_input,
+                                           const OutputHandler& handle_output,
+                                           int64_t chunk_size) const {
+  XLS_RET_CHECK_GT(chunk_size, 0);
+  int64_t chunk_start = 0;
+  std::vector<BitsMap> chunk;
+  bool inputs_remaining = true;
+  while (inputs_remaining) {
+    chunk.clear();
+    while (chunk.size() < chunk_size) {
+      XLS_ASSIGN_OR_RETURN(absl::optional<BitsMap> input,
+                           next_input(chunk_start + chunk.size()));
+      if (!input.has_value()) {
+        inputs_remaining = false;
+        break;
+      }
+      chunk.push_back(std::move(*input));
+    }
+    if (chunk.empty()) {
+      break;
+    }
+    XLS_VLOG(1) << absl::StreamFormat("Simulating inputs %d to %d",
+                                      chunk_start,
+                                      chunk_start + chunk.size());
+    XLS_ASSIGN_OR_RETURN(std::vector<BitsMap> outputs, RunBatched(chunk));
+    XLS_RET_CHECK_EQ(outputs.size(), chunk.size());
+    for (int64_t i = 0; i < outputs.size(); ++i) {
+      XLS_RETURN_IF_ERROR(handle_output(chunk_start + i, outputs[i]));
+    }
+    chunk_start += chunk.size();
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::vector<Value>> ModuleSimulator::RunBatched(
     absl::Span<const absl::flat_hash_map<std::string, Value>> inputs) const {
   std::vector<BitsMap> bits_inputs;
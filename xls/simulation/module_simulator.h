@@ -15,8 +15,12 @@
 #ifndef XLS_SIMULATION_MODULE_SIMULATOR_H_
 #define XLS_SIMULATION_MODULE_SIMULATOR_H_
 
+#include <functional>
+
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "xls/codegen/module_signature.h"
 #include "xls/codegen/vast.h"
 #include "xls/ir/value.h"
@@ -58,6 +62,29 @@ class ModuleSimulator {
   absl::StatusOr<std::vector<BitsMap>> RunBatched(
       absl::Span<const BitsMap> inputs) const;
 
+  // Produces the input at the given index, or nullopt if there are no more
+  // inputs. Returning an error stops the simulation.
+  using InputGenerator =
+      std::function<absl::StatusOr<absl::optional<BitsMap>>(int64_t index)>;
+  // Consumes the output for the input at the given index. Returning an error
+  // stops the simulation.
+  using OutputHandler =
+      std::function<absl::Status(int64_t index, const BitsMap& output)>;
+
+  static constexpr int64_t kDefaultChunkSize = 1024;
+
+  // Runs the inputs produced by 'next_input' through the module in chunks of
+  // at most 'chunk_size' inputs, each simulated with one invocation of the
+  // Verilog simulator, and passes the outputs to 'handle_output' in order as
+  // each chunk completes. Only a single chunk of inputs and outputs is held in
+  // memory at a time, so arbitrarily many inputs can be simulated. Returns the
+  // first error returned by 'handle_output', for example on a mismatch with
+  // the expected output, or by 'next_input' without simulating the remaining
+  // inputs.
+  absl::Status RunStreaming(const InputGenerator& next_input,
+                            const OutputHandler& handle_output,
+                            int64_t chunk_size = kDefaultChunkSize) const;
+
   // Overloads which accept Values rather than Bits.
   absl::StatusOr<Value> Run(
       const absl::flat_hash_map<std::string, Value>& inputs) const;
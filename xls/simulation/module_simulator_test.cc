@@ -16,7 +16,9 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "xls/codegen/module_signature.h"
 #include "xls/common/status/matchers.h"
 #include "xls/common/status/status_macros.h"
@@ -139,6 +141,43 @@ TEST_P(ModuleSimulatorTest, FixedLatencyBatched) {
   EXPECT_THAT(outputs[2], ElementsAre(Pair("out", UBits(14, 8))));
 }
 
+TEST_P(ModuleSimulatorTest, FixedLatencyStreaming) {
+  XLS_ASSERT_OK_AND_ASSIGN(auto verilog_signature, MakeFixedLatencyModule());
+  ModuleSimulator simulator(verilog_signature.second, verilog_signature.first,
+                            GetSimulator());
+
+  auto next_input = [](int64_t index)
+      -> absl::StatusOr<absl::optional<ModuleSimulator::BitsMap>> {
+    if (index >= 10) {
+      return absl::nullopt;
+    }
+    return ModuleSimulator::BitsMap{{"x", UBits(index, 8)}};
+  };
+  std::vector<int64_t> indices;
+  XLS_ASSERT_OK(simulator.RunStreaming(
+      next_input,
+      [&](int64_t index, const ModuleSimulator::BitsMap& output) {
+        indices.push_back(index);
+        EXPECT_THAT(output, ElementsAre(Pair("out", UBits(2 * index, 8))));
+        return absl::OkStatus();
+      },
+      /*chunk_size=*/4));
+  EXPECT_THAT(indices, ElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+
+  // An error from the output handler stops the simulation.
+  indices.clear();
+  EXPECT_THAT(simulator.RunStreaming(
+                  next_input,
+                  [&](int64_t index, const ModuleSimulator::BitsMap& output) {
+                    indices.push_back(index);
+                    return index == 5 ? absl::InternalError("Mismatch")
+                                      : absl::OkStatus();
+                  },
+                  /*chunk_size=*/4),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("Mismatch")));
+  EXPECT_THAT(indices, ElementsAre(0, 1, 2, 3, 4, 5));
+}
+
 TEST_P(ModuleSimulatorTest, CombinationalBatched) {
   XLS_ASSERT_OK_AND_ASSIGN(auto verilog_signature, MakeCombinationalModule());
   ModuleSimulator simulator(verilog_signature.second, verilog_signature.first,
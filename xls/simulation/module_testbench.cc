@@ -14,7 +14,16 @@
 
 #include "xls/simulation/module_testbench.h"
 
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/str_split.h"
+#include "absl/types/span.h"
 #include "xls/common/logging/log_lines.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
@@ -45,6 +54,53 @@ std::string GetTimeoutMessage() {
                          kSimulationCycleLimit);
 }
 
+// Returns the ports of "port_widths" sorted by name, so the testbench is the
+// same for the same module.
+std::vector<std::pair<std::string, int64_t>> SortedPorts(
+    const absl::flat_hash_map<std::string, int64_t>& port_widths) {
+  std::vector<std::pair<std::string, int64_t>> ports(port_widths.begin(),
+                                                     port_widths.end());
+  std::sort(ports.begin(), ports.end());
+  return ports;
+}
+
+// The opcodes of the actions in a stimulus read at runtime (see
+// ModuleTestbench::AddStimulusReader()). Each is followed by its operands: a
+// cycle count, or the index of a port and, for some, a hex value.
+enum StimulusOp {
+  kStimulusEnd = 0,
+  kStimulusAdvanceCycles = 1,
+  kStimulusSet = 2,
+  kStimulusSetX = 3,
+  kStimulusWaitForValue = 4,
+  kStimulusWaitForX = 5,
+  kStimulusWaitForNotX = 6,
+  kStimulusDisplay = 7,
+};
+
+// Displays of outputs driven by a stimulus can't print the instance they are
+// for, as $strobe prints after the stimulus has moved on; they print this
+// marker instead, which is replaced in order (see NumberDisplays()).
+constexpr char kInstanceMarker[] = "(#)";
+
+// Replaces the instance markers in "output" with the instances of the displays
+// in the order they were performed.
+std::string NumberDisplays(absl::string_view output,
+                           absl::Span<const int64_t> instances) {
+  std::vector<absl::string_view> pieces =
+      absl::StrSplit(output, kInstanceMarker);
+  std::string result(pieces.front());
+  for (int64_t i = 1; i < pieces.size(); ++i) {
+    if (i - 1 < instances.size()) {
+      absl::StrAppend(&result, "(#", instances[i - 1], ")");
+    } else {
+      absl::StrAppend(&result, kInstanceMarker);
+    }
+    absl::StrAppend(&result, pieces[i]);
+  }
+  return result;
+}
+
 }  // namespace
 
 ModuleTestbench::ModuleTestbench(Module* module,
@@ -125,6 +181,17 @@ ModuleTestbench::ModuleTestbench(absl::string_view verilog_text,
                              .manual()
                              .input_name()] =
           signature.proto().pipeline().latency();
+    } else if (signature.proto()
+                   .pipeline()
+                   .pipeline_control()
+                   .has_ready_valid()) {
+      // Add the flow control signals.
+      const ReadyValidPipelineControl& ready_valid =
+          signature.proto().pipeline().pipeline_control().ready_valid();
+      input_port_widths_[ready_valid.input_valid_name()] = 1;
+      output_port_widths_[ready_valid.input_ready_name()] = 1;
+      input_port_widths_[ready_valid.output_ready_name()] = 1;
+      output_port_widths_[ready_valid.output_valid_name()] = 1;
     }
   }
 }
@@ -336,7 +403,7 @@ absl::Status ModuleTestbench::Run() {
 
   absl::flat_hash_map<std::string, LogicRef*> port_refs;
   std::vector<Connection> connections;
-  for (const auto& pair : input_port_widths_) {
+  for (const auto& pair : SortedPorts(input_port_widths_)) {
     if (pair.second == 0) {
       // Skip zero-width inputs (e.g., empty tuples) as these have no actual
       // port in the Verilog module.
@@ -349,7 +416,7 @@ absl::Status ModuleTestbench::Run() {
     connections.push_back(Connection{port_name, ref});
   }
 
-  for (const auto& pair : output_port_widths_) {
+  for (const auto& pair : SortedPorts(output_port_widths_)) {
     if (pair.second == 0) {
       // Skip zero-width outputs (e.g., empty tuples) as these have no actual
       // port in the Verilog module.
@@ -430,9 +497,22 @@ absl::Status ModuleTestbench::Run() {
   Initial* initial = m->Add<Initial>();
   wait_n_cycles(initial->statements(), 1);
 
-  // All actions occur at the falling edge of the clock to avoid races with
-  // signals changing at the rising edge of the clock.
-  for (const Action& action : actions_) {
+  // A simulator which compiles the testbench can reuse the compilation if the
+  // testbench reads the actions at runtime rather than containing them.
+  const bool runtime_stimulus = simulator_->SupportsRuntimeStimulus();
+  std::string stimulus;
+  std::vector<int64_t> display_instances;
+  if (runtime_stimulus) {
+    stimulus = AddStimulusReader(&file, m, initial->statements(), port_refs,
+                                 clk, &display_instances);
+  }
+
+  // Otherwise the testbench contains the actions. All actions occur at the
+  // falling edge of the clock to avoid races with signals changing at the
+  // rising edge of the clock (as do those read at runtime).
+  absl::Span<const Action> actions =
+      runtime_stimulus ? absl::Span<const Action>() : actions_;
+  for (const Action& action : actions) {
     absl::visit(
         Visitor{
             [&](const AdvanceCycle& a) {
@@ -495,7 +575,16 @@ absl::Status ModuleTestbench::Run() {
   XLS_VLOG(2) << verilog_text;
 
   std::pair<std::string, std::string> stdout_stderr;
-  XLS_ASSIGN_OR_RETURN(stdout_stderr, simulator_->Run(verilog_text));
+  if (runtime_stimulus) {
+    XLS_VLOG(2) << "Stimulus:\n" << stimulus;
+    XLS_ASSIGN_OR_RETURN(stdout_stderr,
+                         simulator_->RunWithStimulus(verilog_text, stimulus,
+                                                     /*includes=*/{}));
+    stdout_stderr.first =
+        NumberDisplays(stdout_stderr.first, display_instances);
+  } else {
+    XLS_ASSIGN_OR_RETURN(stdout_stderr, simulator_->Run(verilog_text));
+  }
 
   XLS_VLOG(2) << "Verilog simulator stdout:\n" << stdout_stderr.first;
   XLS_VLOG(2) << "Verilog simulator stderr:\n" << stdout_stderr.second;
@@ -504,6 +593,194 @@ absl::Status ModuleTestbench::Run() {
   return CheckOutput(stdout_str);
 }
 
+std::string ModuleTestbench::AddStimulusReader(
+    VerilogFile* file, Module* m, StatementBlock* block,
+    const absl::flat_hash_map<std::string, LogicRef*>& port_refs,
+    LogicRef* clk, std::vector<int64_t>* display_instances) {
+  // Ports are referred to by their index in name order.
+  std::vector<std::string> port_names;
+  int64_t max_width = 1;
+  for (const auto& pair : port_refs) {
+    if (pair.first != clk_name_) {
+      port_names.push_back(pair.first);
+      max_width = std::max(max_width, GetPortWidth(pair.first));
+    }
+  }
+  std::sort(port_names.begin(), port_names.end());
+  absl::flat_hash_map<std::string, int64_t> port_indices;
+  for (int64_t i = 0; i < port_names.size(); ++i) {
+    port_indices[port_names[i]] = i;
+  }
+
+  LogicRef* path = m->AddReg("stimulus_path", file->BitVectorType(8 * 4096));
+  LogicRef* fd = m->AddReg("stimulus_fd", file->BitVectorType(32));
+  LogicRef* scanned = m->AddReg("stimulus_scanned", file->BitVectorType(32));
+  LogicRef* op = m->AddReg("stimulus_op", file->BitVectorType(32));
+  LogicRef* operand = m->AddReg("stimulus_operand", file->BitVectorType(32));
+  LogicRef* value = m->AddReg("stimulus_value", file->BitVectorType(max_width));
+
+  // Reads the values of "args" from the stimulus with the format "format".
+  auto scan = [&](StatementBlock* statements, absl::string_view format,
+                  std::vector<Expression*> args) {
+    args.insert(args.begin(), {fd, file->Make<QuotedString>(format)});
+    statements->Add<BlockingAssignment>(
+        scanned, file->Make<SystemFunctionCall>("fscanf", args));
+  };
+  auto wait_cycle = [&](StatementBlock* statements) {
+    statements->Add<EventControl>(file->Make<PosEdge>(clk));
+    statements->Add<EventControl>(file->Make<NegEdge>(clk));
+  };
+  // Adds to "case_statement" an arm per port, with the statements "make_arm"
+  // adds for the port.
+  auto add_port_arms = [&](Case* case_statement,
+                           const std::function<void(StatementBlock*,
+                                                    LogicRef*, int64_t)>&
+                               make_arm) {
+    for (int64_t i = 0; i < port_names.size(); ++i) {
+      make_arm(case_statement->AddCaseArm(file->PlainLiteral(i)),
+               port_refs.at(port_names[i]), GetPortWidth(port_names[i]));
+    }
+  };
+
+  Conditional* no_path = block->Add<Conditional>(
+      file->LogicalNot(file->Make<SystemFunctionCall>(
+          "value$plusargs", std::vector<Expression*>{
+                                file->Make<QuotedString>("stimulus=%s"),
+                                path})));
+  no_path->consequent()->Add<Display>(std::vector<Expression*>{
+      file->Make<QuotedString>("ERROR: no +stimulus=<path> given.")});
+  no_path->consequent()->Add<Finish>();
+  block->Add<BlockingAssignment>(
+      fd, file->Make<SystemFunctionCall>(
+              "fopen",
+              std::vector<Expression*>{path, file->Make<QuotedString>("r")}));
+
+  // The reader stops at the end of the stimulus, where no opcode is read.
+  block->Add<BlockingAssignment>(op, file->PlainLiteral(kStimulusEnd));
+  scan(block, "%d", {op});
+  WhileStatement* loop = block->Add<WhileStatement>(
+      file->NotEquals(op, file->PlainLiteral(kStimulusEnd)));
+  Case* ops = loop->statements()->Add<Case>(op);
+
+  StatementBlock* advance = ops->AddCaseArm(
+      file->PlainLiteral(kStimulusAdvanceCycles));
+  scan(advance, "%d", {operand});
+  advance->Add<RepeatStatement>(
+      operand, file->Make<EventControl>(file->Make<PosEdge>(clk)));
+  advance->Add<EventControl>(file->Make<NegEdge>(clk));
+
+  StatementBlock* set = ops->AddCaseArm(file->PlainLiteral(kStimulusSet));
+  scan(set, "%d %h", {operand, value});
+  add_port_arms(set->Add<Case>(operand),
+                [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+                  arm->Add<NonblockingAssignment>(
+                      port, file->Slice(value, width - 1, 0));
+                });
+
+  StatementBlock* set_x = ops->AddCaseArm(file->PlainLiteral(kStimulusSetX));
+  scan(set_x, "%d", {operand});
+  add_port_arms(set_x->Add<Case>(operand),
+                [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+                  arm->Add<NonblockingAssignment>(
+                      port, file->Make<XSentinel>(width));
+                });
+
+  // The waits sample the port every cycle at the falling edge of the clock,
+  // until it has the value.
+  StatementBlock* wait_value =
+      ops->AddCaseArm(file->PlainLiteral(kStimulusWaitForValue));
+  scan(wait_value, "%d %h", {operand, value});
+  add_port_arms(wait_value->Add<Case>(operand),
+                [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+                  wait_cycle(arm->Add<WhileStatement>(
+                                    file->NotEquals(
+                                        port, file->Slice(value, width - 1, 0)))
+                                 ->statements());
+                });
+  StatementBlock* wait_x =
+      ops->AddCaseArm(file->PlainLiteral(kStimulusWaitForX));
+  scan(wait_x, "%d", {operand});
+  add_port_arms(wait_x->Add<Case>(operand),
+                [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+                  wait_cycle(arm->Add<WhileStatement>(file->NotEqualsX(port))
+                                 ->statements());
+                });
+  StatementBlock* wait_not_x =
+      ops->AddCaseArm(file->PlainLiteral(kStimulusWaitForNotX));
+  scan(wait_not_x, "%d", {operand});
+  add_port_arms(wait_not_x->Add<Case>(operand),
+                [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+                  wait_cycle(arm->Add<WhileStatement>(file->EqualsX(port))
+                                 ->statements());
+                });
+
+  StatementBlock* display =
+      ops->AddCaseArm(file->PlainLiteral(kStimulusDisplay));
+  scan(display, "%d", {operand});
+  add_port_arms(
+      display->Add<Case>(operand),
+      [&](StatementBlock* arm, LogicRef* port, int64_t width) {
+        arm->Add<Strobe>(std::vector<Expression*>{
+            file->Make<QuotedString>(absl::StrFormat(
+                "%%t OUTPUT %s = %d'h%%0x %s", port->GetName(), width,
+                kInstanceMarker)),
+            file->Make<SystemFunctionCall>("time"), port});
+      });
+
+  loop->statements()->Add<BlockingAssignment>(op,
+                                              file->PlainLiteral(kStimulusEnd));
+  scan(loop->statements(), "%d", {op});
+
+  // Encode the actions, skipping those of zero-width ports as the testbench
+  // does when it contains them.
+  auto hex = [](const Bits& bits) {
+    return absl::StrReplaceAll(bits.ToRawDigits(FormatPreference::kHex),
+                               {{"_", ""}});
+  };
+  std::string stimulus;
+  for (const Action& action : actions_) {
+    absl::visit(
+        Visitor{
+            [&](const AdvanceCycle& a) {
+              absl::StrAppend(&stimulus, kStimulusAdvanceCycles, " ", a.amount,
+                              "\n");
+            },
+            [&](const SetInput& s) {
+              if (port_indices.contains(s.port)) {
+                absl::StrAppend(&stimulus, kStimulusSet, " ",
+                                port_indices.at(s.port), " ", hex(s.value),
+                                "\n");
+              }
+            },
+            [&](const SetInputX& s) {
+              if (port_indices.contains(s.port)) {
+                absl::StrAppend(&stimulus, kStimulusSetX, " ",
+                                port_indices.at(s.port), "\n");
+              }
+            },
+            [&](const WaitForOutput& w) {
+              int64_t index = port_indices.at(w.port);
+              if (absl::holds_alternative<Bits>(w.value)) {
+                absl::StrAppend(&stimulus, kStimulusWaitForValue, " ", index,
+                                " ", hex(absl::get<Bits>(w.value)), "\n");
+              } else if (absl::holds_alternative<IsX>(w.value)) {
+                absl::StrAppend(&stimulus, kStimulusWaitForX, " ", index, "\n");
+              } else {
+                absl::StrAppend(&stimulus, kStimulusWaitForNotX, " ", index,
+                                "\n");
+              }
+            },
+            [&](const DisplayOutput& c) {
+              absl::StrAppend(&stimulus, kStimulusDisplay, " ",
+                              port_indices.at(c.port), "\n");
+              display_instances->push_back(c.instance);
+            }},
+        action);
+  }
+  absl::StrAppend(&stimulus, kStimulusEnd, "\n");
+  return stimulus;
+}
+
 int64_t ModuleTestbench::GetPortWidth(absl::string_view port) {
   if (input_port_widths_.contains(port)) {
     return input_port_widths_.at(port);
@@ -104,6 +104,18 @@ class ModuleTestbench {
   // Checks the stdout of a simulation run against expectations.
   absl::Status CheckOutput(absl::string_view stdout_str) const;
 
+  // Adds to "block", of the testbench module "m" in "file", statements which
+  // perform actions read at runtime from the stimulus file named by the
+  // "+stimulus=<path>" plusarg (see VerilogSimulator::RunWithStimulus()).
+  // "port_refs" holds the signals of the ports and "clk" is the clock. So the
+  // testbench is the same for any actions. Returns the stimulus encoding the
+  // actions of the testbench, and appends to "display_instances" the instances
+  // of its displays in order.
+  std::string AddStimulusReader(
+      VerilogFile* file, Module* m, StatementBlock* block,
+      const absl::flat_hash_map<std::string, LogicRef*>& port_refs,
+      LogicRef* clk, std::vector<int64_t>* display_instances);
+
   // Returns the width of the given port.
   int64_t GetPortWidth(absl::string_view port);
 
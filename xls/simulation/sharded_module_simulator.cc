@@ -0,0 +1,132 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/simulation/sharded_module_simulator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "absl/strings/str_format.h"
+#include "absl/types/optional.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+// Runs RunBatched of the simulator on contiguous shards of the inputs
+// concurrently and concatenates the outputs.
+template <typename InputT, typename OutputT>
+absl::StatusOr<std::vector<OutputT>> RunShards(
+    const ModuleSimulator& simulator, absl::Span<const InputT> inputs,
+    int64_t num_shards) {
+  XLS_RET_CHECK_GT(num_shards, 0);
+  if (inputs.empty()) {
+    return std::vector<OutputT>();
+  }
+  const int64_t shard_size = CeilOfRatio<int64_t>(inputs.size(), num_shards);
+  num_shards = CeilOfRatio<int64_t>(inputs.size(), shard_size);
+  if (num_shards == 1) {
+    return simulator.RunBatched(inputs);
+  }
+  std::vector<absl::StatusOr<std::vector<OutputT>>> shard_outputs(num_shards);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t shard = 0; shard < num_shards; ++shard) {
+    threads.push_back(std::make_unique<Thread>([&, shard]() {
+      shard_outputs[shard] =
+          simulator.RunBatched(inputs.subspan(shard * shard_size, shard_size));
+    }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  std::vector<OutputT> outputs;
+  outputs.reserve(inputs.size());
+  for (absl::StatusOr<std::vector<OutputT>>& shard_output : shard_outputs) {
+    XLS_RETURN_IF_ERROR(shard_output.status());
+    std::move(shard_output->begin(), shard_output->end(),
+              std::back_inserter(outputs));
+  }
+  XLS_RET_CHECK_EQ(outputs.size(), inputs.size());
+  return outputs;
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<ModuleSimulator::BitsMap>> RunBatchedSharded(
+    const ModuleSimulator& simulator,
+    absl::Span<const ModuleSimulator::BitsMap> inputs, int64_t num_shards) {
+  return RunShards<ModuleSimulator::BitsMap, ModuleSimulator::BitsMap>(
+      simulator, inputs, num_shards);
+}
+
+absl::StatusOr<std::vector<Value>> RunBatchedSharded(
+    const ModuleSimulator& simulator,
+    absl::Span<const absl::flat_hash_map<std::string, Value>> inputs,
+    int64_t num_shards) {
+  return RunShards<absl::flat_hash_map<std::string, Value>, Value>(
+      simulator, inputs, num_shards);
+}
+
+absl::Status RunStreamingSharded(
+    const ModuleSimulator& simulator,
+    const ModuleSimulator::InputGenerator& next_input,
+    const ModuleSimulator::OutputHandler& handle_output, int64_t num_shards,
+    int64_t chunk_size) {
+  XLS_RET_CHECK_GT(num_shards, 0);
+  XLS_RET_CHECK_GT(chunk_size, 0);
+  // Gather the inputs of all shards, then split them evenly so the shards of
+  // the final, partial batch are balanced as well.
+  const int64_t batch_size = num_shards * chunk_size;
+  int64_t batch_start = 0;
+  std::vector<ModuleSimulator::BitsMap> batch;
+  while (true) {
+    batch.clear();
+    while (batch.size() < batch_size) {
+      XLS_ASSIGN_OR_RETURN(absl::optional<ModuleSimulator::BitsMap> input,
+                           next_input(batch_start + batch.size()));
+      if (!input.has_value()) {
+        break;
+      }
+      batch.push_back(std::move(*input));
+    }
+    if (batch.empty()) {
+      break;
+    }
+    XLS_VLOG(1) << absl::StreamFormat(
+        "Simulating inputs %d to %d in %d shards", batch_start,
+        batch_start + batch.size(), num_shards);
+    XLS_ASSIGN_OR_RETURN(std::vector<ModuleSimulator::BitsMap> outputs,
+                         RunBatchedSharded(simulator, batch, num_shards));
+    for (int64_t i = 0; i < outputs.size(); ++i) {
+      XLS_RETURN_IF_ERROR(handle_output(batch_start + i, outputs[i]));
+    }
+    if (batch.size() < batch_size) {
+      break;
+    }
+    batch_start += batch.size();
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace verilog
+}  // namespace xls
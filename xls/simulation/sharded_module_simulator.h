@@ -0,0 +1,60 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_SIMULATION_SHARDED_MODULE_SIMULATOR_H_
+#define XLS_SIMULATION_SHARDED_MODULE_SIMULATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/value.h"
+#include "xls/simulation/module_simulator.h"
+
+namespace xls {
+namespace verilog {
+
+// Runs the given batch of inputs through the module, split into at most
+// 'num_shards' contiguous shards which are simulated concurrently, each with a
+// separate invocation of the Verilog simulator. Returns the outputs in the
+// order of the inputs. Results are identical to ModuleSimulator::RunBatched
+// as each shard resets the module before driving its inputs.
+absl::StatusOr<std::vector<ModuleSimulator::BitsMap>> RunBatchedSharded(
+    const ModuleSimulator& simulator,
+    absl::Span<const ModuleSimulator::BitsMap> inputs, int64_t num_shards);
+
+// Overload which accepts Values rather than Bits.
+absl::StatusOr<std::vector<Value>> RunBatchedSharded(
+    const ModuleSimulator& simulator,
+    absl::Span<const absl::flat_hash_map<std::string, Value>> inputs,
+    int64_t num_shards);
+
+// As ModuleSimulator::RunStreaming, but simulates 'num_shards' chunks of at
+// most 'chunk_size' inputs concurrently. Outputs are passed to 'handle_output'
+// in order once all chunks simulated concurrently complete.
+absl::Status RunStreamingSharded(
+    const ModuleSimulator& simulator,
+    const ModuleSimulator::InputGenerator& next_input,
+    const ModuleSimulator::OutputHandler& handle_output, int64_t num_shards,
+    int64_t chunk_size = ModuleSimulator::kDefaultChunkSize);
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_SIMULATION_SHARDED_MODULE_SIMULATOR_H_
@@ -0,0 +1,110 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/simulation/sharded_module_simulator.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/common/status/matchers.h"
+#include "xls/simulation/module_simulator.h"
+#include "xls/simulation/verilog_test_base.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+constexpr char kFixedLatencyModule[] = R"(
+module fixed_latency_3(input wire clk, input wire [7:0] x, output wire [7:0] out);
+  reg [7:0] x_0; reg [7:0] x_1; reg [7:0] x_2;
+
+  assign out = x_2 + x;
+
+  always @ (posedge clk) begin
+    x_0 <= x;
+    x_1 <= x_0;
+    x_2 <= x_1;
+  end
+endmodule
+)";
+
+class ShardedModuleSimulatorTest : public VerilogTestBase {
+ protected:
+  absl::StatusOr<ModuleSignature> MakeSignature() const {
+    ModuleSignatureBuilder b("fixed_latency_3");
+    b.WithClock("clk").WithFixedLatencyInterface(3);
+    b.AddDataInput("x", 8);
+    b.AddDataOutput("out", 8);
+    return b.Build();
+  }
+};
+
+TEST_P(ShardedModuleSimulatorTest, MatchesRunBatched) {
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleSignature signature, MakeSignature());
+  ModuleSimulator simulator(signature, kFixedLatencyModule, GetSimulator());
+
+  std::vector<ModuleSimulator::BitsMap> inputs;
+  for (int64_t i = 0; i < 7; ++i) {
+    inputs.push_back({{"x", UBits(10 * i, 8)}});
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<ModuleSimulator::BitsMap> expected,
+                           simulator.RunBatched(inputs));
+  for (int64_t num_shards : {1, 2, 3, 7, 10}) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<ModuleSimulator::BitsMap> outputs,
+                             RunBatchedSharded(simulator, inputs, num_shards));
+    EXPECT_EQ(outputs, expected) << num_shards << " shards";
+  }
+}
+
+TEST_P(ShardedModuleSimulatorTest, Streaming) {
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleSignature signature, MakeSignature());
+  ModuleSimulator simulator(signature, kFixedLatencyModule, GetSimulator());
+
+  std::vector<int64_t> indices;
+  XLS_ASSERT_OK(RunStreamingSharded(
+      simulator,
+      [](int64_t index)
+          -> absl::StatusOr<absl::optional<ModuleSimulator::BitsMap>> {
+        if (index >= 11) {
+          return absl::nullopt;
+        }
+        return ModuleSimulator::BitsMap{{"x", UBits(index, 8)}};
+      },
+      [&](int64_t index, const ModuleSimulator::BitsMap& output) {
+        indices.push_back(index);
+        EXPECT_THAT(output, ElementsAre(Pair("out", UBits(2 * index, 8))));
+        return absl::OkStatus();
+      },
+      /*num_shards=*/3, /*chunk_size=*/2));
+  EXPECT_THAT(indices, ElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+}
+
+INSTANTIATE_TEST_SUITE_P(ShardedModuleSimulatorTestInstantiation,
+                         ShardedModuleSimulatorTest,
+                         testing::ValuesIn(kVerilogOnlySimulationTargets),
+                         ParameterizedTestName<ShardedModuleSimulatorTest>);
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
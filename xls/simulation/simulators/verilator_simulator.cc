@@ -0,0 +1,180 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/simulation/simulators/verilator_simulator.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/module_initializer.h"
+#include "xls/common/stable_hash.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/subprocess.h"
+
+ABSL_FLAG(std::string, verilator_path, "",
+          "Path to the verilator binary used by the \"verilator\" Verilog "
+          "simulator. If empty, verilator is searched for on PATH.");
+
+namespace xls {
+namespace verilog {
+
+absl::StatusOr<std::filesystem::path> GetVerilatorPath() {
+  if (!absl::GetFlag(FLAGS_verilator_path).empty()) {
+    return std::filesystem::path(absl::GetFlag(FLAGS_verilator_path));
+  }
+  const char* path_env = std::getenv("PATH");
+  if (path_env != nullptr) {
+    for (absl::string_view dir : absl::StrSplit(path_env, ':')) {
+      std::filesystem::path candidate =
+          std::filesystem::path(std::string(dir)) / "verilator";
+      if (FileExists(candidate).ok()) {
+        return candidate;
+      }
+    }
+  }
+  return absl::NotFoundError(
+      "Unable to find verilator on PATH; specify it with --verilator_path");
+}
+
+namespace {
+
+absl::StatusOr<std::pair<std::string, std::string>> InvokeVerilator(
+    absl::Span<const std::string> args) {
+  XLS_ASSIGN_OR_RETURN(std::filesystem::path verilator_path,
+                       GetVerilatorPath());
+  std::vector<std::string> args_vec = {verilator_path.string(), "-Wno-fatal",
+                                       "-Wno-lint", "-Wno-style", "--timing"};
+  args_vec.insert(args_vec.end(), args.begin(), args.end());
+  return InvokeSubprocess(args_vec);
+}
+
+// Writes the Verilog text and the included files into the given directory and
+// returns the arguments which pass them to verilator.
+absl::StatusOr<std::vector<std::string>> WriteSources(
+    const std::filesystem::path& dir, absl::string_view text,
+    absl::Span<const VerilogInclude> includes) {
+  for (const VerilogInclude& include : includes) {
+    std::filesystem::path path = dir / include.relative_path;
+    XLS_RETURN_IF_ERROR(RecursivelyCreateDir(path.parent_path()));
+    XLS_RETURN_IF_ERROR(SetFileContents(path, include.verilog_text));
+  }
+  std::filesystem::path source = dir / "top.sv";
+  XLS_RETURN_IF_ERROR(SetFileContents(source, text));
+  return std::vector<std::string>{absl::StrCat("-I", dir.string()),
+                                  source.string()};
+}
+
+}  // namespace
+
+absl::StatusOr<std::pair<std::string, std::string>> VerilatorSimulator::Run(
+    absl::string_view text, absl::Span<const VerilogInclude> includes) const {
+  // Holding the model keeps the binary alive even if it is evicted from the
+  // cache while running.
+  XLS_ASSIGN_OR_RETURN(std::shared_ptr<const CompiledModel> model,
+                       GetCompiledModel(text, includes));
+  return InvokeSubprocess({model->binary.string()});
+}
+
+absl::StatusOr<std::pair<std::string, std::string>>
+VerilatorSimulator::RunWithStimulus(
+    absl::string_view text, absl::string_view stimulus,
+    absl::Span<const VerilogInclude> includes) const {
+  XLS_ASSIGN_OR_RETURN(std::shared_ptr<const CompiledModel> model,
+                       GetCompiledModel(text, includes));
+  XLS_ASSIGN_OR_RETURN(TempFile stimulus_file,
+                       TempFile::CreateWithContent(stimulus));
+  return InvokeSubprocess(
+      {model->binary.string(),
+       absl::StrCat("+stimulus=", stimulus_file.path().string())});
+}
+
+absl::Status VerilatorSimulator::RunSyntaxChecking(
+    absl::string_view text, absl::Span<const VerilogInclude> includes) const {
+  XLS_ASSIGN_OR_RETURN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSIGN_OR_RETURN(std::vector<std::string> args,
+                       WriteSources(temp_dir.path(), text, includes));
+  args.insert(args.begin(), "--lint-only");
+  return InvokeVerilator(args).status();
+}
+
+absl::StatusOr<std::shared_ptr<const VerilatorSimulator::CompiledModel>>
+VerilatorSimulator::GetCompiledModel(
+    absl::string_view text, absl::Span<const VerilogInclude> includes) const {
+  std::string sources(text);
+  for (const VerilogInclude& include : includes) {
+    absl::StrAppend(&sources, "\n// include ", include.relative_path.string(),
+                    "\n", include.verilog_text);
+  }
+  uint64_t key = StableHash64(sources);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = models_.find(key);
+    if (it != models_.end()) {
+      return it->second;
+    }
+  }
+
+  // Compile without holding the lock so distinct Verilog compiles
+  // concurrently.
+  XLS_ASSIGN_OR_RETURN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSIGN_OR_RETURN(std::vector<std::string> args,
+                       WriteSources(temp_dir.path(), text, includes));
+  std::filesystem::path obj_dir = temp_dir.path() / "obj";
+  args.insert(args.begin(), {"--binary", "-j", "0", "--Mdir", obj_dir.string(),
+                             "-o", "sim"});
+  absl::Status compiled = InvokeVerilator(args).status();
+  if (!compiled.ok()) {
+    return absl::Status(
+        compiled.code(),
+        absl::StrCat("Verilator compilation failed: ", compiled.message()));
+  }
+  auto model = std::make_shared<const CompiledModel>(
+      CompiledModel{std::move(temp_dir), obj_dir / "sim"});
+
+  absl::MutexLock lock(&mutex_);
+  ++compilations_;
+  auto it = models_.find(key);
+  if (it != models_.end()) {
+    // Another thread compiled the same Verilog meanwhile.
+    return it->second;
+  }
+  while (models_.size() >= kMaxCachedModels) {
+    models_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+  insertion_order_.push_back(key);
+  models_[key] = model;
+  return model;
+}
+
+namespace {
+
+XLS_REGISTER_MODULE_INITIALIZER(verilator_simulator, {
+  XLS_CHECK_OK(GetVerilogSimulatorManagerSingleton().RegisterVerilogSimulator(
+      "verilator", absl::make_unique<VerilatorSimulator>()));
+});
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,100 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_SIMULATION_SIMULATORS_VERILATOR_SIMULATOR_H_
+#define XLS_SIMULATION_SIMULATORS_VERILATOR_SIMULATOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/simulation/verilog_simulator.h"
+#include "xls/tools/verilog_include.h"
+
+namespace xls {
+namespace verilog {
+
+// Returns the path of the verilator binary: the value of --verilator_path if
+// set, otherwise the first one on PATH.
+absl::StatusOr<std::filesystem::path> GetVerilatorPath();
+
+// Verilog simulator backed by Verilator, registered as "verilator". Verilator
+// is run out of process: it compiles the Verilog into a native simulation
+// binary which is much faster to run than interpreting the Verilog, at the
+// cost of a slower compilation. Compiled binaries are cached by a hash of the
+// text of the Verilog and its includes, so repeated simulations of the same
+// Verilog only compile once. A testbench which reads its stimulus at runtime
+// (see RunWithStimulus()) is compiled once for any stimulus.
+class VerilatorSimulator : public VerilogSimulator {
+ public:
+  // The maximum number of compiled simulation binaries kept at any time.
+  static constexpr int64_t kMaxCachedModels = 16;
+
+  absl::StatusOr<std::pair<std::string, std::string>> Run(
+      absl::string_view text,
+      absl::Span<const VerilogInclude> includes) const override;
+
+  absl::Status RunSyntaxChecking(
+      absl::string_view text,
+      absl::Span<const VerilogInclude> includes) const override;
+
+  bool SupportsRuntimeStimulus() const override { return true; }
+
+  absl::StatusOr<std::pair<std::string, std::string>> RunWithStimulus(
+      absl::string_view text, absl::string_view stimulus,
+      absl::Span<const VerilogInclude> includes) const override;
+
+  // Number of simulation binaries compiled so far (i.e. of cache misses).
+  int64_t compilations() const {
+    absl::MutexLock lock(&mutex_);
+    return compilations_;
+  }
+
+ private:
+  // A directory holding a compiled simulation binary.
+  struct CompiledModel {
+    TempDirectory dir;
+    std::filesystem::path binary;
+  };
+
+  // Returns the simulation binary compiled from the given Verilog, compiling it
+  // unless a binary for the same Verilog has been compiled.
+  absl::StatusOr<std::shared_ptr<const CompiledModel>> GetCompiledModel(
+      absl::string_view text, absl::Span<const VerilogInclude> includes) const;
+
+  mutable absl::Mutex mutex_;
+  // Compiled models keyed by the stable hash of the text of the Verilog and
+  // included files.
+  mutable absl::flat_hash_map<uint64_t, std::shared_ptr<const CompiledModel>>
+      models_ ABSL_GUARDED_BY(mutex_);
+  // Keys of the compiled models in the order they were compiled, for eviction.
+  mutable std::deque<uint64_t> insertion_order_ ABSL_GUARDED_BY(mutex_);
+  mutable int64_t compilations_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_SIMULATION_SIMULATORS_VERILATOR_SIMULATOR_H_
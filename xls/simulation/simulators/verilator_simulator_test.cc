@@ -0,0 +1,155 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/simulation/simulators/verilator_simulator.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_replace.h"
+#include "xls/codegen/vast.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/simulation/module_testbench.h"
+#include "xls/simulation/verilog_simulator.h"
+#include "xls/tools/verilog_include.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+constexpr char kTestbench[] = R"(`include "width.vh"
+
+module device_under_test(
+  input [`WIDTH-1:0] x,
+  input [`WIDTH-1:0] y,
+  output [`WIDTH-1:0] z
+);
+  assign z = x + y;
+endmodule
+
+module tb;
+  reg [`WIDTH-1:0] x = 3;
+  reg [`WIDTH-1:0] y = 4;
+  wire [`WIDTH-1:0] z;
+  device_under_test dut(.x(x), .y(y), .z(z));
+  initial begin
+    #1 $display("%t: z = %h", $time, z);
+    $finish;
+  end
+endmodule
+)";
+
+class VerilatorSimulatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!GetVerilatorPath().ok()) {
+      GTEST_SKIP() << "verilator is not installed";
+    }
+  }
+
+  std::vector<VerilogInclude> Width(int64_t width) {
+    return {VerilogInclude{"width.vh", absl::StrFormat("`define WIDTH %d\n",
+                                                       width)}};
+  }
+
+  VerilatorSimulator simulator_;
+};
+
+TEST_F(VerilatorSimulatorTest, ReusesCompiledModel) {
+  XLS_ASSERT_OK(simulator_.Run(kTestbench, Width(8)).status());
+  XLS_ASSERT_OK(simulator_.Run(kTestbench, Width(8)).status());
+  EXPECT_EQ(simulator_.compilations(), 1);
+
+  // A change of an included file, or of the Verilog itself, compiles again.
+  XLS_ASSERT_OK(simulator_.Run(kTestbench, Width(4)).status());
+  EXPECT_EQ(simulator_.compilations(), 2);
+  std::string changed = absl::StrReplaceAll(kTestbench, {{"x + y", "x - y"}});
+  XLS_ASSERT_OK(simulator_.Run(changed, Width(8)).status());
+  EXPECT_EQ(simulator_.compilations(), 3);
+
+  XLS_ASSERT_OK(simulator_.Run(kTestbench, Width(4)).status());
+  EXPECT_EQ(simulator_.compilations(), 3);
+}
+
+TEST_F(VerilatorSimulatorTest, OutputParsesToObservations) {
+  // The output of the compiled binary has the "$time: $name = %h" form
+  // SimulateCombinational() expects.
+  std::string text = absl::StrReplaceAll(
+      kTestbench, {{"`include \"width.vh\"\n", ""}, {"`WIDTH", "8"}});
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<Observation> observations,
+      simulator_.SimulateCombinational(text, /*to_observe=*/{{"z", 8}}));
+  ASSERT_EQ(observations.size(), 1);
+  EXPECT_EQ(observations[0].name, "z");
+  EXPECT_EQ(observations[0].value, UBits(7, /*bit_count=*/8));
+  EXPECT_EQ(simulator_.compilations(), 1);
+}
+
+TEST_F(VerilatorSimulatorTest, OneCompilationServesDifferentStimuli) {
+  VerilogFile f(/*use_system_verilog=*/false);
+  Module* m = f.AddModule("adder");
+  LogicRef* clk = m->AddInput("clk", f.ScalarType());
+  LogicRef* x = m->AddInput("x", f.BitVectorType(16));
+  LogicRef* y = m->AddInput("y", f.BitVectorType(16));
+  LogicRef* out = m->AddOutput("out", f.BitVectorType(16));
+  LogicRef* sum = m->AddReg("sum", f.BitVectorType(16));
+  m->Add<AlwaysFlop>(clk)->AddRegister(sum, f.Add(x, y));
+  m->Add<ContinuousAssignment>(out, sum);
+
+  // The testbenches differ in their inputs, and the second in its number of
+  // cycles, but they read them at runtime from one compiled binary.
+  ModuleTestbench first(m, &simulator_, "clk");
+  first.Set("x", 1).Set("y", 2).NextCycle().ExpectEq("out", 3);
+  XLS_ASSERT_OK(first.Run());
+
+  Bits captured;
+  ModuleTestbench second(m, &simulator_, "clk");
+  second.Set("x", 0x1234).Set("y", 0x1111).NextCycle().ExpectEq("out", 0x2345);
+  second.Set("x", 0xffff).Set("y", 2).NextCycle().Capture("out", &captured);
+  XLS_ASSERT_OK(second.Run());
+  EXPECT_EQ(captured, UBits(1, 16));
+  EXPECT_EQ(simulator_.compilations(), 1);
+
+  // A failed expectation is still reported.
+  ModuleTestbench failing(m, &simulator_, "clk");
+  failing.Set("x", 1).Set("y", 1).NextCycle().ExpectEq("out", 3);
+  EXPECT_THAT(failing.Run(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("expected output 'out', instance #0")));
+  EXPECT_EQ(simulator_.compilations(), 1);
+}
+
+TEST_F(VerilatorSimulatorTest, CompilationErrorIsReported) {
+  std::string broken =
+      absl::StrReplaceAll(kTestbench, {{"assign z = x + y;", "assign z = ;"}});
+  EXPECT_THAT(simulator_.Run(broken, Width(8)),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Verilator compilation failed")));
+  EXPECT_EQ(simulator_.compilations(), 0);
+  EXPECT_THAT(simulator_.RunSyntaxChecking(broken, Width(8)),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
@@ -94,6 +94,14 @@ absl::Status VerilogSimulator::RunSyntaxChecking(absl::string_view text) const {
   return RunSyntaxChecking(text, /*includes=*/{});
 }
 
+absl::StatusOr<std::pair<std::string, std::string>>
+VerilogSimulator::RunWithStimulus(
+    absl::string_view text, absl::string_view stimulus,
+    absl::Span<const VerilogInclude> includes) const {
+  return absl::UnimplementedError(
+      "Simulator does not support reading stimulus at runtime");
+}
+
 absl::StatusOr<std::vector<Observation>>
 VerilogSimulator::SimulateCombinational(
     absl::string_view text, const NameToBitCount& to_observe) const {
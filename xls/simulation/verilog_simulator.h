@@ -54,6 +54,18 @@ class VerilogSimulator {
       absl::Span<const VerilogInclude> includes) const = 0;
   absl::Status RunSyntaxChecking(absl::string_view text) const;
 
+  // Whether the simulator supports RunWithStimulus().
+  virtual bool SupportsRuntimeStimulus() const { return false; }
+
+  // Runs the simulator with the given Verilog text, whose testbench reads its
+  // stimulus at runtime from the file named by the "+stimulus=<path>" plusarg,
+  // which holds "stimulus". Returns the stdout/stderr as a string pair. As the
+  // text doesn't depend on the stimulus, a simulator which compiles the
+  // Verilog can run any stimulus with one compilation.
+  virtual absl::StatusOr<std::pair<std::string, std::string>> RunWithStimulus(
+      absl::string_view text, absl::string_view stimulus,
+      absl::Span<const VerilogInclude> includes) const;
+
   // Simulation runner harness: runs the given Verilog text using the verilog
   // simulator infrastructure and returns observations of data values that arose
   // during simulation.
@@ -0,0 +1,73 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/aig.h"
+
+#include <utility>
+
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+namespace solvers {
+
+Aig::Aig() {
+  // Node 0 is the constant; its literal is kFalse and its complement kTrue.
+  nodes_.push_back(Node{kFalse, kFalse, /*is_input=*/false});
+}
+
+AigLiteral Aig::AddInput() {
+  nodes_.push_back(Node{kFalse, kFalse, /*is_input=*/true});
+  inputs_.push_back(nodes_.size() - 1);
+  return MakeLiteral(nodes_.size() - 1, /*complemented=*/false);
+}
+
+AigLiteral Aig::And(AigLiteral a, AigLiteral b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  if (a == kFalse || a == Not(b)) {
+    return kFalse;
+  }
+  if (a == kTrue || a == b) {
+    return b;
+  }
+  uint64_t key = (static_cast<uint64_t>(a) << 32) | b;
+  auto it = and_cache_.find(key);
+  if (it != and_cache_.end()) {
+    return it->second;
+  }
+  nodes_.push_back(Node{a, b, /*is_input=*/false});
+  AigLiteral result = MakeLiteral(nodes_.size() - 1, /*complemented=*/false);
+  and_cache_[key] = result;
+  return result;
+}
+
+std::vector<uint64_t> Aig::Simulate(
+    absl::Span<const uint64_t> input_words) const {
+  XLS_CHECK_EQ(input_words.size(), inputs_.size());
+  std::vector<uint64_t> words(nodes_.size(), 0);
+  for (int64_t i = 0; i < inputs_.size(); ++i) {
+    words[inputs_[i]] = input_words[i];
+  }
+  for (int64_t node = 1; node < nodes_.size(); ++node) {
+    if (!nodes_[node].is_input) {
+      words[node] = LiteralValue(words, nodes_[node].fanin0) &
+                    LiteralValue(words, nodes_[node].fanin1);
+    }
+  }
+  return words;
+}
+
+}  // namespace solvers
+}  // namespace xls
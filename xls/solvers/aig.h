@@ -0,0 +1,132 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_AIG_H_
+#define XLS_SOLVERS_AIG_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "xls/ir/abstract_evaluator.h"
+
+namespace xls {
+namespace solvers {
+
+// A reference to a node of an Aig, possibly complemented. The low bit of the
+// value is the complement flag and the remaining bits are the node index.
+using AigLiteral = uint32_t;
+
+// An and-inverter graph: a combinational circuit built solely of two-input AND
+// gates and inverters. Inverters are not nodes but the complement bit of
+// literals, so every node is either the constant, an input or an AND gate.
+//
+// The graph is structurally hashed: requesting an AND of the same two
+// literals twice returns the same node, and ANDs with constant, identical or
+// complementary operands are folded away. Nodes are created after their
+// operands, so node indices are a topological order.
+class Aig {
+ public:
+  static constexpr AigLiteral kFalse = 0;
+  static constexpr AigLiteral kTrue = 1;
+
+  static AigLiteral Not(AigLiteral a) { return a ^ 1; }
+  static int64_t NodeIndex(AigLiteral a) { return a >> 1; }
+  static bool IsComplemented(AigLiteral a) { return a & 1; }
+  static AigLiteral MakeLiteral(int64_t node, bool complemented) {
+    return (static_cast<AigLiteral>(node) << 1) | (complemented ? 1 : 0);
+  }
+
+  Aig();
+
+  // Returns the literal of a new primary input.
+  AigLiteral AddInput();
+
+  AigLiteral And(AigLiteral a, AigLiteral b);
+  AigLiteral Or(AigLiteral a, AigLiteral b) {
+    return Not(And(Not(a), Not(b)));
+  }
+  AigLiteral Xor(AigLiteral a, AigLiteral b) {
+    return Or(And(a, Not(b)), And(Not(a), b));
+  }
+  // Returns "selector ? on_true : on_false".
+  AigLiteral Mux(AigLiteral selector, AigLiteral on_true, AigLiteral on_false) {
+    return Or(And(selector, on_true), And(Not(selector), on_false));
+  }
+
+  // Returns the number of nodes, including the constant node (index 0).
+  int64_t node_count() const { return nodes_.size(); }
+  int64_t input_count() const { return inputs_.size(); }
+  int64_t and_count() const { return node_count() - input_count() - 1; }
+
+  // Returns the node indices of the primary inputs, in creation order.
+  absl::Span<const int64_t> inputs() const { return inputs_; }
+
+  bool IsInput(int64_t node) const { return nodes_[node].is_input; }
+  bool IsAnd(int64_t node) const {
+    return node != 0 && !nodes_[node].is_input;
+  }
+  // Returns the operands of the given AND node.
+  AigLiteral fanin0(int64_t node) const { return nodes_[node].fanin0; }
+  AigLiteral fanin1(int64_t node) const { return nodes_[node].fanin1; }
+
+  // Evaluates the graph on 64 input vectors at once. "input_words" holds one
+  // word per primary input, in the order of inputs(), where bit i of each word
+  // is the input's value in vector i. Returns one word per node.
+  std::vector<uint64_t> Simulate(absl::Span<const uint64_t> input_words) const;
+
+  // Returns the simulated value of the given literal from a Simulate() result.
+  static uint64_t LiteralValue(absl::Span<const uint64_t> node_words,
+                               AigLiteral a) {
+    uint64_t value = node_words[NodeIndex(a)];
+    return IsComplemented(a) ? ~value : value;
+  }
+
+ private:
+  struct Node {
+    AigLiteral fanin0;
+    AigLiteral fanin1;
+    bool is_input;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<int64_t> inputs_;
+  absl::flat_hash_map<uint64_t, AigLiteral> and_cache_;
+};
+
+// An AbstractEvaluator which builds logic in an Aig, for bit-blasting XLS
+// operations.
+class AigEvaluator : public AbstractEvaluator<AigLiteral, AigEvaluator> {
+ public:
+  explicit AigEvaluator(Aig* aig) : aig_(aig) {}
+
+  AigLiteral One() const { return Aig::kTrue; }
+  AigLiteral Zero() const { return Aig::kFalse; }
+  AigLiteral Not(const AigLiteral& input) const { return Aig::Not(input); }
+  AigLiteral And(const AigLiteral& a, const AigLiteral& b) const {
+    return aig_->And(a, b);
+  }
+  AigLiteral Or(const AigLiteral& a, const AigLiteral& b) const {
+    return aig_->Or(a, b);
+  }
+
+ private:
+  Aig* aig_;
+};
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_AIG_H_
@@ -0,0 +1,87 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/aig_ir_translator.h"
+
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/abstract_node_evaluator.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+namespace solvers {
+
+absl::StatusOr<absl::flat_hash_map<const Node*, AigEvaluator::Vector>>
+TranslateIrToAig(
+    Aig* aig, Function* function,
+    const absl::flat_hash_map<const Node*, AigEvaluator::Vector>& inputs,
+    absl::Span<const Node* const> outputs) {
+  // Only the cones of the outputs, cut at the inputs, are translated.
+  absl::flat_hash_set<const Node*> needed;
+  std::vector<const Node*> worklist(outputs.begin(), outputs.end());
+  while (!worklist.empty()) {
+    const Node* node = worklist.back();
+    worklist.pop_back();
+    if (inputs.contains(node) || !needed.insert(node).second) {
+      continue;
+    }
+    worklist.insert(worklist.end(), node->operands().begin(),
+                    node->operands().end());
+  }
+
+  AigEvaluator evaluator(aig);
+  absl::flat_hash_map<const Node*, AigEvaluator::Vector> values = inputs;
+  for (Node* node : TopoSort(function)) {
+    if (!needed.contains(node)) {
+      continue;
+    }
+    if (node->Is<Param>()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "No input value given for parameter: ", node->GetName()));
+    }
+    if (!node->GetType()->IsBits()) {
+      return absl::UnimplementedError(absl::StrCat(
+          "Cannot bit-blast non-bits-typed node: ", node->ToString()));
+    }
+    std::vector<AigEvaluator::Vector> operands;
+    for (Node* operand : node->operands()) {
+      if (!operand->GetType()->IsBits()) {
+        return absl::UnimplementedError(absl::StrCat(
+            "Cannot bit-blast non-bits-typed node: ", operand->ToString()));
+      }
+      operands.push_back(values.at(operand));
+    }
+    bool unsupported = false;
+    XLS_ASSIGN_OR_RETURN(
+        values[node],
+        AbstractEvaluate(node, operands, &evaluator, [&](Node* n) {
+          unsupported = true;
+          return AigEvaluator::Vector(n->BitCountOrDie(), Aig::kFalse);
+        }));
+    if (unsupported) {
+      return absl::UnimplementedError(
+          absl::StrCat("Cannot bit-blast node: ", node->ToString()));
+    }
+    XLS_RET_CHECK_EQ(values[node].size(), node->BitCountOrDie());
+  }
+  return values;
+}
+
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,46 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_AIG_IR_TRANSLATOR_H_
+#define XLS_SOLVERS_AIG_IR_TRANSLATOR_H_
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/solvers/aig.h"
+
+namespace xls {
+namespace solvers {
+
+// Bit-blasts the logic of "function" computing "outputs" into "aig", using
+// the AbstractEvaluator versions of each operation. The nodes in "inputs" take
+// the given bit vectors (LSB first) instead of being translated, and nodes
+// which no output depends on are skipped. Returns the bit vectors of all inputs
+// and translated nodes.
+//
+// Returns an UnimplementedError if one of the nodes to translate is not
+// bits-typed or has no AbstractEvaluator implementation, and an
+// InvalidArgumentError if an output depends on a parameter not in "inputs".
+absl::StatusOr<absl::flat_hash_map<const Node*, AigEvaluator::Vector>>
+TranslateIrToAig(
+    Aig* aig, Function* function,
+    const absl::flat_hash_map<const Node*, AigEvaluator::Vector>& inputs,
+    absl::Span<const Node* const> outputs);
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_AIG_IR_TRANSLATOR_H_
@@ -0,0 +1,297 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/aig_netlist_translator.h"
+
+#include <deque>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace solvers {
+
+using netlist::CellLibraryEntry;
+using netlist::StateTable;
+using netlist::StateTableSignal;
+using netlist::function::Ast;
+using netlist::rtl::Cell;
+using netlist::rtl::Module;
+using netlist::rtl::NetRef;
+
+absl::StatusOr<std::unique_ptr<AigNetlistTranslator>>
+AigNetlistTranslator::CreateAndTranslate(
+    Aig* aig, const Module* module,
+    const absl::flat_hash_map<std::string, const Module*>& module_refs,
+    const absl::flat_hash_map<std::string, AigLiteral>& inputs) {
+  auto translator =
+      absl::WrapUnique(new AigNetlistTranslator(aig, module, module_refs));
+  for (const auto& pair : inputs) {
+    XLS_ASSIGN_OR_RETURN(NetRef ref, module->ResolveNet(pair.first));
+    translator->translated_[ref] = pair.second;
+  }
+  for (const char* name : {"clk", "input_valid"}) {
+    absl::StatusOr<NetRef> ref = module->ResolveNet(name);
+    if (ref.ok() && !inputs.contains(name)) {
+      translator->translated_[ref.value()] = Aig::kTrue;
+    }
+  }
+  XLS_ASSIGN_OR_RETURN(NetRef zero, module->ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(NetRef one, module->ResolveNumber(1));
+  translator->translated_[zero] = Aig::kFalse;
+  translator->translated_[one] = Aig::kTrue;
+  XLS_RETURN_IF_ERROR(translator->Translate());
+  return translator;
+}
+
+AigNetlistTranslator::AigNetlistTranslator(
+    Aig* aig, const Module* module,
+    const absl::flat_hash_map<std::string, const Module*>& module_refs)
+    : aig_(aig), module_(module), module_refs_(module_refs) {}
+
+absl::StatusOr<AigLiteral> AigNetlistTranslator::GetTranslation(
+    NetRef ref) const {
+  auto it = translated_.find(ref);
+  if (it == translated_.end()) {
+    return absl::NotFoundError(absl::StrFormat(
+        "Net %s is not computable from the netlist inputs.", ref->name()));
+  }
+  return it->second;
+}
+
+// As in z3::NetlistTranslator, cells are translated once all of their input
+// nets are: the nets with known values seed a worklist, and translating a cell
+// adds its outputs to it.
+absl::Status AigNetlistTranslator::Translate() {
+  absl::flat_hash_map<Cell*, absl::flat_hash_set<NetRef>> cell_inputs;
+  std::deque<NetRef> active_wires;
+  for (const auto& pair : translated_) {
+    active_wires.push_back(pair.first);
+  }
+  for (const auto& cell : module_->cells()) {
+    if (cell->inputs().empty()) {
+      XLS_RETURN_IF_ERROR(TranslateCell(*cell));
+      for (const auto& output : cell->outputs()) {
+        active_wires.push_back(output.netref);
+      }
+    } else {
+      absl::flat_hash_set<NetRef> inputs;
+      for (const auto& input : cell->inputs()) {
+        inputs.insert(input.netref);
+      }
+      cell_inputs[cell.get()] = std::move(inputs);
+    }
+  }
+
+  while (!active_wires.empty()) {
+    NetRef ref = active_wires.front();
+    active_wires.pop_front();
+    for (Cell* cell : ref->connected_cells()) {
+      auto it = cell_inputs.find(cell);
+      if (it == cell_inputs.end()) {
+        continue;
+      }
+      it->second.erase(ref);
+      if (!it->second.empty()) {
+        continue;
+      }
+      cell_inputs.erase(it);
+      XLS_RETURN_IF_ERROR(TranslateCell(*cell));
+      for (const auto& output : cell->outputs()) {
+        active_wires.push_back(output.netref);
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AigNetlistTranslator::TranslateCell(const Cell& cell) {
+  std::string entry_name = cell.cell_library_entry()->name();
+  auto module_ref = module_refs_.find(entry_name);
+  if (module_ref != module_refs_.end()) {
+    absl::flat_hash_map<std::string, AigLiteral> inputs;
+    for (const auto& input : cell.inputs()) {
+      inputs[input.name] = translated_.at(input.netref);
+    }
+    XLS_ASSIGN_OR_RETURN(auto subtranslator,
+                         CreateAndTranslate(aig_, module_ref->second,
+                                            module_refs_, inputs));
+    for (const auto& output : cell.outputs()) {
+      if (translated_.contains(output.netref)) {
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(NetRef module_output,
+                           module_ref->second->ResolveNet(output.name));
+      // Outputs the submodule can't compute are left untranslated here too.
+      absl::StatusOr<AigLiteral> translation =
+          subtranslator->GetTranslation(module_output);
+      if (translation.ok()) {
+        translated_[output.netref] = translation.value();
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  const CellLibraryEntry* entry = cell.cell_library_entry();
+  absl::flat_hash_map<std::string, AigLiteral> state_table_values;
+  if (entry->state_table()) {
+    XLS_ASSIGN_OR_RETURN(state_table_values, TranslateStateTable(cell));
+  }
+  for (const auto& output : cell.outputs()) {
+    // Nets given as inputs keep their provided values.
+    if (translated_.contains(output.netref)) {
+      continue;
+    }
+    auto key = std::make_pair(entry, output.name);
+    auto it = functions_.find(key);
+    if (it == functions_.end()) {
+      auto function = entry->output_pin_to_function().find(output.name);
+      if (function == entry->output_pin_to_function().end()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Cell %s has no function for output pin %s",
+                            cell.name(), output.name));
+      }
+      XLS_ASSIGN_OR_RETURN(
+          Ast ast, netlist::function::Parser::ParseFunction(function->second));
+      it = functions_.emplace(key, std::move(ast)).first;
+    }
+    XLS_ASSIGN_OR_RETURN(translated_[output.netref],
+                         TranslateFunction(cell, it->second,
+                                           state_table_values));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<AigLiteral> AigNetlistTranslator::TranslateFunction(
+    const Cell& cell, const Ast& ast,
+    const absl::flat_hash_map<std::string, AigLiteral>& state_table_values) {
+  switch (ast.kind()) {
+    case Ast::Kind::kIdentifier: {
+      for (const auto& input : cell.inputs()) {
+        if (input.name == ast.name()) {
+          return translated_.at(input.netref);
+        }
+      }
+      auto it = state_table_values.find(ast.name());
+      if (it != state_table_values.end()) {
+        return it->second;
+      }
+      return absl::NotFoundError(absl::StrFormat(
+          "Identifier \"%s\", was not found in cell %s's inputs.", ast.name(),
+          cell.name()));
+    }
+    case Ast::Kind::kLiteralOne:
+      return Aig::kTrue;
+    case Ast::Kind::kLiteralZero:
+      return Aig::kFalse;
+    case Ast::Kind::kNot: {
+      XLS_ASSIGN_OR_RETURN(
+          AigLiteral child,
+          TranslateFunction(cell, ast.children()[0], state_table_values));
+      return Aig::Not(child);
+    }
+    case Ast::Kind::kAnd:
+    case Ast::Kind::kOr:
+    case Ast::Kind::kXor: {
+      XLS_ASSIGN_OR_RETURN(
+          AigLiteral lhs,
+          TranslateFunction(cell, ast.children()[0], state_table_values));
+      XLS_ASSIGN_OR_RETURN(
+          AigLiteral rhs,
+          TranslateFunction(cell, ast.children()[1], state_table_values));
+      if (ast.kind() == Ast::Kind::kAnd) {
+        return aig_->And(lhs, rhs);
+      }
+      if (ast.kind() == Ast::Kind::kOr) {
+        return aig_->Or(lhs, rhs);
+      }
+      return aig_->Xor(lhs, rhs);
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown AST kind: ", static_cast<int>(ast.kind())));
+}
+
+// Mirrors z3::NetlistTranslator::TranslateStateTable(): each internal signal is
+// an if-then-else chain over the rows of the table which assign it.
+absl::StatusOr<absl::flat_hash_map<std::string, AigLiteral>>
+AigNetlistTranslator::TranslateStateTable(const Cell& cell) {
+  const StateTable& table = cell.cell_library_entry()->state_table().value();
+  struct OutputCase {
+    AigLiteral stimulus;
+    AigLiteral value;
+  };
+  absl::flat_hash_map<std::string, std::vector<OutputCase>> output_table;
+  for (const StateTable::Row& row : table.rows()) {
+    AigLiteral stimulus = Aig::kTrue;
+    for (const auto& kv : row.stimulus) {
+      StateTableSignal signal = kv.second;
+      if (signal != StateTableSignal::kHigh &&
+          signal != StateTableSignal::kLow) {
+        continue;
+      }
+      const Cell::Pin* pin = nullptr;
+      for (const Cell::Pin& input : cell.inputs()) {
+        if (input.name == kv.first) {
+          pin = &input;
+          break;
+        }
+      }
+      if (pin == nullptr) {
+        return absl::NotFoundError(
+            absl::StrCat("Couldn't find pin: ", kv.first));
+      }
+      XLS_RET_CHECK(translated_.contains(pin->netref));
+      AigLiteral value = translated_.at(pin->netref);
+      if (signal == StateTableSignal::kLow) {
+        value = Aig::Not(value);
+      }
+      stimulus = aig_->And(stimulus, value);
+    }
+
+    for (const auto& kv : row.response) {
+      StateTableSignal signal = kv.second;
+      if (signal != StateTableSignal::kHigh &&
+          signal != StateTableSignal::kLow) {
+        XLS_LOG(WARNING) << "Non-high or -low output signal encountered: "
+                         << cell.name() << ":" << kv.first << ": "
+                         << static_cast<int>(signal);
+        continue;
+      }
+      output_table[kv.first].push_back(OutputCase{
+          stimulus,
+          signal == StateTableSignal::kHigh ? Aig::kTrue : Aig::kFalse});
+    }
+  }
+
+  absl::flat_hash_map<std::string, AigLiteral> final_values;
+  for (const auto& kv : output_table) {
+    const std::vector<OutputCase>& cases = kv.second;
+    AigLiteral value = cases.back().value;
+    for (int64_t i = cases.size() - 2; i >= 0; --i) {
+      value = aig_->Mux(cases[i].stimulus, cases[i].value, value);
+    }
+    final_values[kv.first] = value;
+  }
+  return final_values;
+}
+
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,84 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_AIG_NETLIST_TRANSLATOR_H_
+#define XLS_SOLVERS_AIG_NETLIST_TRANSLATOR_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/netlist/function_parser.h"
+#include "xls/netlist/netlist.h"
+#include "xls/solvers/aig.h"
+
+namespace xls {
+namespace solvers {
+
+// Converts a netlist into logic in an Aig, in the manner of
+// z3::NetlistTranslator: each cell's "function" attribute (or state table) is
+// bit-blasted into AND gates, and the cells are combined as described by the
+// module's nets. Cells referring to other modules of the netlist are flattened
+// into the same graph.
+class AigNetlistTranslator {
+ public:
+  // Translates "module" into "aig". "inputs" maps net names to the literals
+  // providing their values; these nets are not translated from their drivers.
+  // As with z3::NetlistTranslator, "clk" and "input_valid" are tied high, and
+  // only nets computable from these sources are translated.
+  //  - module_refs is a collection of modules that may be present as Cell
+  //    references in the module being processed.
+  static absl::StatusOr<std::unique_ptr<AigNetlistTranslator>>
+  CreateAndTranslate(
+      Aig* aig, const netlist::rtl::Module* module,
+      const absl::flat_hash_map<std::string, const netlist::rtl::Module*>&
+          module_refs,
+      const absl::flat_hash_map<std::string, AigLiteral>& inputs);
+
+  // Returns the literal computing the value of the specified net.
+  absl::StatusOr<AigLiteral> GetTranslation(netlist::rtl::NetRef ref) const;
+
+ private:
+  AigNetlistTranslator(
+      Aig* aig, const netlist::rtl::Module* module,
+      const absl::flat_hash_map<std::string, const netlist::rtl::Module*>&
+          module_refs);
+
+  absl::Status Translate();
+  absl::Status TranslateCell(const netlist::rtl::Cell& cell);
+  absl::StatusOr<AigLiteral> TranslateFunction(
+      const netlist::rtl::Cell& cell, const netlist::function::Ast& ast,
+      const absl::flat_hash_map<std::string, AigLiteral>& state_table_values);
+  absl::StatusOr<absl::flat_hash_map<std::string, AigLiteral>>
+  TranslateStateTable(const netlist::rtl::Cell& cell);
+
+  Aig* aig_;
+  const netlist::rtl::Module* module_;
+  const absl::flat_hash_map<std::string, const netlist::rtl::Module*>&
+      module_refs_;
+  absl::flat_hash_map<netlist::rtl::NetRef, AigLiteral> translated_;
+
+  // Parsed cell functions, keyed by cell library entry and output pin name.
+  absl::flat_hash_map<std::pair<const netlist::CellLibraryEntry*, std::string>,
+                      netlist::function::Ast>
+      functions_;
+};
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_AIG_NETLIST_TRANSLATOR_H_
@@ -0,0 +1,255 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/aig_sat.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/thread.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+constexpr int64_t kLanes = 64;
+
+// Returns the input words of the given simulation pass over the corner-case
+// vectors: vector 0 is all zeros, vector 1 all ones, and vectors 2 * i + 2
+// and 2 * i + 3 are one-hot and one-cold at input i. Lanes past the last
+// vector repeat vector 0.
+std::vector<uint64_t> CornerCaseWords(int64_t input_count, int64_t pass) {
+  std::vector<uint64_t> words(input_count, 0);
+  uint64_t ones = 0;
+  std::vector<std::pair<int64_t, uint64_t>> one_hot;
+  std::vector<std::pair<int64_t, uint64_t>> one_cold;
+  for (int64_t lane = 0; lane < kLanes; ++lane) {
+    int64_t vector = pass * kLanes + lane;
+    uint64_t bit = uint64_t{1} << lane;
+    if (vector == 1) {
+      ones |= bit;
+    } else if (vector >= 2 && vector < 2 * input_count + 2) {
+      int64_t input = (vector - 2) / 2;
+      if (vector % 2 == 0) {
+        one_hot.push_back({input, bit});
+      } else {
+        ones |= bit;
+        one_cold.push_back({input, bit});
+      }
+    }
+  }
+  std::fill(words.begin(), words.end(), ones);
+  for (const auto& pair : one_hot) {
+    words[pair.first] |= pair.second;
+  }
+  for (const auto& pair : one_cold) {
+    words[pair.first] &= ~pair.second;
+  }
+  return words;
+}
+
+}  // namespace
+
+AigCnfEncoder::AigCnfEncoder(const Aig* aig, SatSolver* solver)
+    : aig_(aig), solver_(solver), variables_(aig->node_count(), -1) {}
+
+SatLiteral AigCnfEncoder::Encode(AigLiteral literal) {
+  XLS_CHECK_EQ(variables_.size(), aig_->node_count())
+      << "The Aig was modified after the encoder was created.";
+
+  // Encode the cone depth-first without recursion, as graphs bit-blasted from
+  // arithmetic can be very deep. A node is encoded once both of its fanins
+  // are.
+  std::vector<int64_t> stack = {Aig::NodeIndex(literal)};
+  while (!stack.empty()) {
+    int64_t node = stack.back();
+    if (variables_[node] >= 0) {
+      stack.pop_back();
+      continue;
+    }
+    if (!aig_->IsAnd(node)) {
+      variables_[node] = solver_->NewVariable();
+      if (node == 0) {
+        solver_->AddClause(
+            {SatSolver::MakeLiteral(variables_[node], /*negated=*/true)});
+      }
+      stack.pop_back();
+      continue;
+    }
+    int64_t fanin0 = Aig::NodeIndex(aig_->fanin0(node));
+    int64_t fanin1 = Aig::NodeIndex(aig_->fanin1(node));
+    if (variables_[fanin0] < 0 || variables_[fanin1] < 0) {
+      stack.push_back(fanin0);
+      stack.push_back(fanin1);
+      continue;
+    }
+    stack.pop_back();
+
+    // out <-> a & b, as (!out | a), (!out | b) and (out | !a | !b).
+    int64_t variable = solver_->NewVariable();
+    variables_[node] = variable;
+    SatLiteral out = SatSolver::MakeLiteral(variable, /*negated=*/false);
+    SatLiteral a = SatSolver::MakeLiteral(
+        variables_[fanin0], Aig::IsComplemented(aig_->fanin0(node)));
+    SatLiteral b = SatSolver::MakeLiteral(
+        variables_[fanin1], Aig::IsComplemented(aig_->fanin1(node)));
+    solver_->AddClause({SatSolver::Negate(out), a});
+    solver_->AddClause({SatSolver::Negate(out), b});
+    solver_->AddClause({out, SatSolver::Negate(a), SatSolver::Negate(b)});
+  }
+  return SatSolver::MakeLiteral(variables_[Aig::NodeIndex(literal)],
+                                Aig::IsComplemented(literal));
+}
+
+absl::StatusOr<absl::optional<std::vector<bool>>> FindAigCounterexample(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    absl::Duration timeout, const std::atomic<bool>* interrupt) {
+  SatSolver solver;
+  AigCnfEncoder encoder(&aig, &solver);
+  solver.set_deadline(absl::Now() + timeout);
+  solver.set_interrupt(interrupt);
+
+  // The miter: some pair differs. Each "diff" variable is only constrained to
+  // be false when its pair is equal, which is all the miter needs.
+  std::vector<SatLiteral> any_differ;
+  for (const auto& pair : outputs) {
+    if (pair.first == pair.second) {
+      continue;
+    }
+    SatLiteral a = encoder.Encode(pair.first);
+    SatLiteral b = encoder.Encode(pair.second);
+    SatLiteral diff = SatSolver::MakeLiteral(solver.NewVariable(),
+                                             /*negated=*/false);
+    solver.AddClause({SatSolver::Negate(diff), a, b});
+    solver.AddClause(
+        {SatSolver::Negate(diff), SatSolver::Negate(a), SatSolver::Negate(b)});
+    any_differ.push_back(diff);
+  }
+  solver.AddClause(any_differ);
+
+  SatSolver::Result result = solver.Solve();
+  XLS_VLOG(1) << "SAT miter: " << solver.variable_count() << " variables, "
+              << solver.conflicts() << " conflicts, " << solver.decisions()
+              << " decisions.";
+  switch (result) {
+    case SatSolver::Result::kUnsatisfiable:
+      return absl::nullopt;
+    case SatSolver::Result::kUnknown:
+      if (interrupt != nullptr && interrupt->load()) {
+        return absl::CancelledError("SAT solver interrupted.");
+      }
+      return absl::DeadlineExceededError(absl::StrCat(
+          "SAT solver timed out after ", solver.conflicts(), " conflicts."));
+    case SatSolver::Result::kSatisfiable:
+      break;
+  }
+  std::vector<bool> inputs;
+  for (int64_t input : aig.inputs()) {
+    // Inputs outside the cones of the outputs don't matter.
+    int64_t variable = encoder.NodeVariable(input);
+    inputs.push_back(variable >= 0 && solver.ModelValue(variable));
+  }
+  return inputs;
+}
+
+absl::optional<std::vector<bool>> FindAigCounterexampleBySimulation(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    int64_t random_vector_count, int64_t thread_count, uint64_t seed) {
+  const int64_t input_count = aig.input_count();
+  const int64_t corner_passes = (2 * input_count + 2 + kLanes - 1) / kLanes;
+  const int64_t pass_count =
+      corner_passes + (random_vector_count + kLanes - 1) / kLanes;
+  if (thread_count <= 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  thread_count = std::max<int64_t>(1, std::min(thread_count, pass_count));
+
+  // Passes are claimed in order, and every pass before the first one to find
+  // a mismatch is completed, so the counterexample found is deterministic.
+  absl::Mutex mutex;
+  int64_t next_pass = 0;
+  int64_t found_pass = pass_count;
+  std::vector<bool> counterexample;
+  auto worker = [&]() {
+    while (true) {
+      int64_t pass;
+      {
+        absl::MutexLock lock(&mutex);
+        if (next_pass >= found_pass) {
+          return;
+        }
+        pass = next_pass++;
+      }
+      std::vector<uint64_t> words;
+      if (pass < corner_passes) {
+        words = CornerCaseWords(input_count, pass);
+      } else {
+        std::mt19937_64 engine(seed + pass);
+        words.resize(input_count);
+        for (uint64_t& word : words) {
+          word = engine();
+        }
+      }
+      std::vector<uint64_t> values = aig.Simulate(words);
+      uint64_t differ = 0;
+      for (const auto& pair : outputs) {
+        differ |= Aig::LiteralValue(values, pair.first) ^
+                  Aig::LiteralValue(values, pair.second);
+      }
+      if (differ == 0) {
+        continue;
+      }
+      int64_t lane = 0;
+      while (((differ >> lane) & 1) == 0) {
+        ++lane;
+      }
+      absl::MutexLock lock(&mutex);
+      if (pass < found_pass) {
+        found_pass = pass;
+        counterexample.clear();
+        for (uint64_t word : words) {
+          counterexample.push_back((word >> lane) & 1);
+        }
+      }
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 0; i < thread_count; ++i) {
+    threads.push_back(std::make_unique<Thread>(worker));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  XLS_VLOG(1) << "Simulated " << std::min(next_pass, pass_count) * kLanes
+              << " vectors; "
+              << (found_pass < pass_count ? "found" : "no")
+              << " counterexample.";
+  if (found_pass == pass_count) {
+    return absl::nullopt;
+  }
+  return counterexample;
+}
+
+}  // namespace solvers
+}  // namespace xls
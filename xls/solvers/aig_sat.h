@@ -0,0 +1,80 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_AIG_SAT_H_
+#define XLS_SOLVERS_AIG_SAT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/solvers/aig.h"
+#include "xls/solvers/sat_solver.h"
+
+namespace xls {
+namespace solvers {
+
+// Converts the logic of an Aig to CNF in a SatSolver, with one variable per
+// node and the three Tseitin clauses of each AND gate. Nodes are encoded on
+// demand, so only the cones of the literals requested enter the solver.
+class AigCnfEncoder {
+ public:
+  AigCnfEncoder(const Aig* aig, SatSolver* solver);
+
+  // Returns the solver literal equal to the given AIG literal, encoding its
+  // cone of logic if it isn't already.
+  SatLiteral Encode(AigLiteral literal);
+
+  // Returns the solver variable of the given node, or -1 if not encoded.
+  int64_t NodeVariable(int64_t node) const { return variables_[node]; }
+
+ private:
+  const Aig* aig_;
+  SatSolver* solver_;
+  std::vector<int64_t> variables_;
+};
+
+// Checks that the two literals of each pair in "outputs" are equivalent
+// functions of the inputs of "aig", by solving the CNF of a miter over all of
+// them. Returns nullopt if they are equivalent and otherwise the input values
+// of a counterexample, one per input, in the order of Aig::inputs(). Returns
+// a DeadlineExceeded error if the solver runs out of time, and a Cancelled
+// error if "interrupt" is given and set by another thread while solving.
+absl::StatusOr<absl::optional<std::vector<bool>>> FindAigCounterexample(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    absl::Duration timeout = absl::InfiniteDuration(),
+    const std::atomic<bool>* interrupt = nullptr);
+
+// A cheap prefilter for FindAigCounterexample(): searches for inputs under
+// which the literals of some pair in "outputs" differ by simulating "aig" on
+// the all-zeros and all-ones input vectors, each one-hot and one-cold vector,
+// and "random_vector_count" random vectors. Vectors are simulated 64 at a time
+// over "thread_count" threads (one per core if <= 0); the result only depends
+// on "seed". Returns a counterexample as FindAigCounterexample() does, or
+// nullopt if none was found, which proves nothing.
+absl::optional<std::vector<bool>> FindAigCounterexampleBySimulation(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    int64_t random_vector_count, int64_t thread_count = 0, uint64_t seed = 0);
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_AIG_SAT_H_
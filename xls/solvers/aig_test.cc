@@ -0,0 +1,82 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/aig.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+TEST(AigTest, StructuralHashing) {
+  Aig aig;
+  AigLiteral a = aig.AddInput();
+  AigLiteral b = aig.AddInput();
+  AigLiteral ab = aig.And(a, b);
+  EXPECT_EQ(aig.And(b, a), ab);
+  EXPECT_EQ(aig.and_count(), 1);
+
+  EXPECT_EQ(aig.And(a, Aig::kFalse), Aig::kFalse);
+  EXPECT_EQ(aig.And(a, Aig::kTrue), a);
+  EXPECT_EQ(aig.And(a, a), a);
+  EXPECT_EQ(aig.And(a, Aig::Not(a)), Aig::kFalse);
+  EXPECT_EQ(aig.Or(a, Aig::Not(a)), Aig::kTrue);
+  EXPECT_EQ(aig.and_count(), 1);
+
+  EXPECT_NE(aig.And(a, Aig::Not(b)), ab);
+  EXPECT_EQ(aig.and_count(), 2);
+}
+
+TEST(AigTest, Simulate) {
+  Aig aig;
+  AigLiteral a = aig.AddInput();
+  AigLiteral b = aig.AddInput();
+  AigLiteral c = aig.AddInput();
+  AigLiteral mux = aig.Mux(a, b, c);
+  AigLiteral x = aig.Xor(a, b);
+
+  std::vector<uint64_t> words = aig.Simulate({0b1100, 0b1010, 0b0110});
+  EXPECT_EQ(Aig::LiteralValue(words, mux) & 0xf, 0b1010);
+  EXPECT_EQ(Aig::LiteralValue(words, x) & 0xf, 0b0110);
+  EXPECT_EQ(Aig::LiteralValue(words, Aig::Not(x)) & 0xf, 0b1001);
+  EXPECT_EQ(Aig::LiteralValue(words, Aig::kTrue), ~uint64_t{0});
+}
+
+TEST(AigTest, AbstractEvaluator) {
+  Aig aig;
+  AigEvaluator evaluator(&aig);
+  AigEvaluator::Vector a;
+  AigEvaluator::Vector b;
+  for (int64_t i = 0; i < 4; ++i) {
+    a.push_back(aig.AddInput());
+    b.push_back(aig.AddInput());
+  }
+  AigEvaluator::Vector sum = evaluator.Add(a, b);
+  ASSERT_EQ(sum.size(), 4);
+
+  // 5 + 6 = 11, with a at inputs 0, 2, 4, 6 and b at 1, 3, 5, 7.
+  std::vector<uint64_t> inputs = {1, 0, 0, 1, 1, 1, 0, 0};
+  std::vector<uint64_t> words = aig.Simulate(inputs);
+  int64_t value = 0;
+  for (int64_t i = 0; i < sum.size(); ++i) {
+    value |= (Aig::LiteralValue(words, sum[i]) & 1) << i;
+  }
+  EXPECT_EQ(value, 11);
+}
+
+}  // namespace
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,522 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/sat_solver.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+// The number of conflicts between restarts is this multiple of the Luby
+// sequence.
+constexpr int64_t kRestartBase = 100;
+
+// During search, the deadline is only checked every this many conflicts.
+constexpr int64_t kDeadlineCheckInterval = 256;
+
+constexpr double kVariableDecay = 0.95;
+constexpr double kClauseDecay = 0.999;
+
+// Returns the i'th element (zero-based) of the Luby sequence: 1, 1, 2, 1, 1,
+// 2, 4, 1, 1, 2, ...
+int64_t Luby(int64_t i) {
+  int64_t size = 1;
+  int64_t exponent = 0;
+  while (size < i + 1) {
+    size = 2 * size + 1;
+    ++exponent;
+  }
+  while (size - 1 != i) {
+    size = (size - 1) >> 1;
+    --exponent;
+    i = i % size;
+  }
+  return int64_t{1} << exponent;
+}
+
+}  // namespace
+
+int64_t SatSolver::NewVariable() {
+  int64_t variable = values_.size();
+  values_.push_back(kUnassigned);
+  levels_.push_back(0);
+  reasons_.push_back(kNoClause);
+  saved_phases_.push_back(false);
+  activities_.push_back(0.0);
+  heap_positions_.push_back(-1);
+  seen_.push_back(false);
+  watches_.emplace_back();
+  watches_.emplace_back();
+  HeapInsert(variable);
+  return variable;
+}
+
+void SatSolver::AddClause(absl::Span<const SatLiteral> literals) {
+  XLS_CHECK_EQ(DecisionLevel(), 0);
+  if (!ok_) {
+    return;
+  }
+  std::vector<SatLiteral> sorted(literals.begin(), literals.end());
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  std::vector<SatLiteral> clause;
+  for (int64_t i = 0; i < sorted.size(); ++i) {
+    XLS_CHECK_LT(Variable(sorted[i]), variable_count());
+    // A literal and its negation sort next to each other.
+    if (i > 0 && sorted[i] == Negate(sorted[i - 1])) {
+      return;
+    }
+    int8_t value = LiteralValue(sorted[i]);
+    if (value == 1) {
+      return;
+    }
+    if (value == kUnassigned) {
+      clause.push_back(sorted[i]);
+    }
+  }
+
+  if (clause.empty()) {
+    ok_ = false;
+  } else if (clause.size() == 1) {
+    Assign(clause[0], kNoClause);
+    ok_ = Propagate() == kNoClause;
+  } else {
+    clauses_.push_back(Clause{std::move(clause), /*learned=*/false, 0.0});
+    AttachClause(clauses_.size() - 1);
+  }
+}
+
+SatSolver::Result SatSolver::Solve(absl::Span<const SatLiteral> assumptions) {
+  model_.clear();
+  if (!ok_) {
+    return Result::kUnsatisfiable;
+  }
+  max_learned_ = std::max<int64_t>(max_learned_, clauses_.size() / 3 + 1000);
+  int64_t start_conflicts = conflicts_;
+  for (int64_t restart = 0;; ++restart) {
+    Result result =
+        Search(Luby(restart) * kRestartBase, assumptions, start_conflicts);
+    if (result != Result::kUnknown ||
+        LimitReached(start_conflicts, /*check_clock=*/true)) {
+      return result;
+    }
+  }
+}
+
+SatSolver::Result SatSolver::Search(int64_t conflict_budget,
+                                    absl::Span<const SatLiteral> assumptions,
+                                    int64_t start_conflicts) {
+  int64_t budget_end = conflicts_ + conflict_budget;
+  while (true) {
+    int32_t conflict = Propagate();
+    if (conflict != kNoClause) {
+      ++conflicts_;
+      if (DecisionLevel() == 0) {
+        ok_ = false;
+        return Result::kUnsatisfiable;
+      }
+      std::vector<SatLiteral> learned = Analyze(conflict);
+      if (learned.size() == 1) {
+        Backtrack(0);
+        Assign(learned[0], kNoClause);
+      } else {
+        Backtrack(levels_[Variable(learned[1])]);
+        SatLiteral asserting = learned[0];
+        clauses_.push_back(Clause{std::move(learned), /*learned=*/true, 0.0});
+        int32_t clause = clauses_.size() - 1;
+        AttachClause(clause);
+        BumpClause(clauses_[clause]);
+        ++learned_count_;
+        Assign(asserting, clause);
+      }
+      variable_increment_ /= kVariableDecay;
+      clause_increment_ /= kClauseDecay;
+      if (conflicts_ >= budget_end ||
+          LimitReached(start_conflicts,
+                       conflicts_ % kDeadlineCheckInterval == 0)) {
+        Backtrack(0);
+        return Result::kUnknown;
+      }
+      continue;
+    }
+
+    if (DecisionLevel() == 0 && learned_count_ >= max_learned_) {
+      ReduceClauses();
+      max_learned_ += max_learned_ / 10;
+    }
+
+    // Assumptions are the first decisions; one which is already true still
+    // gets its own (empty) decision level, to keep levels and indices aligned.
+    SatLiteral next = -1;
+    while (DecisionLevel() < assumptions.size()) {
+      SatLiteral assumption = assumptions[DecisionLevel()];
+      int8_t value = LiteralValue(assumption);
+      if (value == 1) {
+        trail_limits_.push_back(trail_.size());
+      } else if (value == 0) {
+        Backtrack(0);
+        return Result::kUnsatisfiable;
+      } else {
+        next = assumption;
+        break;
+      }
+    }
+    if (next == -1) {
+      int64_t variable = PickBranchVariable();
+      if (variable < 0) {
+        model_.resize(variable_count());
+        for (int64_t i = 0; i < variable_count(); ++i) {
+          model_[i] = values_[i] == 1;
+        }
+        Backtrack(0);
+        return Result::kSatisfiable;
+      }
+      ++decisions_;
+      next = MakeLiteral(variable, /*negated=*/!saved_phases_[variable]);
+    }
+    trail_limits_.push_back(trail_.size());
+    Assign(next, kNoClause);
+  }
+}
+
+bool SatSolver::LimitReached(int64_t start_conflicts, bool check_clock) const {
+  if (conflict_limit_ >= 0 && conflicts_ - start_conflicts >= conflict_limit_) {
+    return true;
+  }
+  if (interrupt_ != nullptr && interrupt_->load(std::memory_order_relaxed)) {
+    return true;
+  }
+  return check_clock && deadline_ != absl::InfiniteFuture() &&
+         absl::Now() >= deadline_;
+}
+
+void SatSolver::Assign(SatLiteral literal, int32_t reason) {
+  int64_t variable = Variable(literal);
+  values_[variable] = IsNegated(literal) ? 0 : 1;
+  levels_[variable] = DecisionLevel();
+  reasons_[variable] = reason;
+  trail_.push_back(literal);
+}
+
+void SatSolver::AttachClause(int32_t clause) {
+  const std::vector<SatLiteral>& literals = clauses_[clause].literals;
+  watches_[literals[0]].push_back(clause);
+  watches_[literals[1]].push_back(clause);
+}
+
+int32_t SatSolver::Propagate() {
+  while (propagation_head_ < trail_.size()) {
+    SatLiteral false_literal = Negate(trail_[propagation_head_++]);
+    ++propagations_;
+    std::vector<int32_t>& watchers = watches_[false_literal];
+    int64_t kept = 0;
+    for (int64_t i = 0; i < watchers.size(); ++i) {
+      int32_t clause = watchers[i];
+      std::vector<SatLiteral>& literals = clauses_[clause].literals;
+      if (literals[0] == false_literal) {
+        std::swap(literals[0], literals[1]);
+      }
+      if (LiteralValue(literals[0]) == 1) {
+        watchers[kept++] = clause;
+        continue;
+      }
+
+      // Look for a new literal to watch in place of the false one.
+      bool moved = false;
+      for (int64_t j = 2; j < literals.size(); ++j) {
+        if (LiteralValue(literals[j]) != 0) {
+          std::swap(literals[1], literals[j]);
+          watches_[literals[1]].push_back(clause);
+          moved = true;
+          break;
+        }
+      }
+      if (moved) {
+        continue;
+      }
+
+      // The clause is unit or falsified.
+      watchers[kept++] = clause;
+      if (LiteralValue(literals[0]) == 0) {
+        for (++i; i < watchers.size(); ++i) {
+          watchers[kept++] = watchers[i];
+        }
+        watchers.resize(kept);
+        propagation_head_ = trail_.size();
+        return clause;
+      }
+      Assign(literals[0], clause);
+    }
+    watchers.resize(kept);
+  }
+  return kNoClause;
+}
+
+std::vector<SatLiteral> SatSolver::Analyze(int32_t conflict) {
+  // Walk back along the trail, resolving the conflict clause with the reasons
+  // of its current-level literals until only one such literal remains.
+  std::vector<SatLiteral> learned(1);
+  int64_t pending = 0;
+  SatLiteral literal = -1;
+  int64_t index = trail_.size() - 1;
+  int32_t clause = conflict;
+  do {
+    XLS_CHECK_NE(clause, kNoClause);
+    Clause& c = clauses_[clause];
+    if (c.learned) {
+      BumpClause(c);
+    }
+    // The first literal of a reason clause is the one it implied.
+    for (int64_t j = literal == -1 ? 0 : 1; j < c.literals.size(); ++j) {
+      SatLiteral other = c.literals[j];
+      int64_t variable = Variable(other);
+      if (seen_[variable] || levels_[variable] == 0) {
+        continue;
+      }
+      seen_[variable] = true;
+      BumpVariable(variable);
+      if (levels_[variable] >= DecisionLevel()) {
+        ++pending;
+      } else {
+        learned.push_back(other);
+      }
+    }
+    while (!seen_[Variable(trail_[index])]) {
+      --index;
+    }
+    literal = trail_[index--];
+    clause = reasons_[Variable(literal)];
+    seen_[Variable(literal)] = false;
+    --pending;
+  } while (pending > 0);
+  learned[0] = Negate(literal);
+
+  // Drop literals implied by the others.
+  std::vector<SatLiteral> original(learned.begin() + 1, learned.end());
+  int64_t kept = 1;
+  for (int64_t i = 1; i < learned.size(); ++i) {
+    if (!IsRedundant(learned[i])) {
+      learned[kept++] = learned[i];
+    }
+  }
+  learned.resize(kept);
+  for (SatLiteral other : original) {
+    seen_[Variable(other)] = false;
+  }
+
+  // Watch a literal of the backjump level second.
+  int64_t max_index = 1;
+  for (int64_t i = 2; i < learned.size(); ++i) {
+    if (levels_[Variable(learned[i])] >
+        levels_[Variable(learned[max_index])]) {
+      max_index = i;
+    }
+  }
+  if (learned.size() > 1) {
+    std::swap(learned[1], learned[max_index]);
+  }
+  return learned;
+}
+
+bool SatSolver::IsRedundant(SatLiteral literal) const {
+  int32_t reason = reasons_[Variable(literal)];
+  if (reason == kNoClause) {
+    return false;
+  }
+  const std::vector<SatLiteral>& literals = clauses_[reason].literals;
+  for (int64_t i = 1; i < literals.size(); ++i) {
+    int64_t variable = Variable(literals[i]);
+    if (!seen_[variable] && levels_[variable] > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SatSolver::Backtrack(int64_t level) {
+  if (DecisionLevel() <= level) {
+    return;
+  }
+  for (int64_t i = trail_.size() - 1; i >= trail_limits_[level]; --i) {
+    int64_t variable = Variable(trail_[i]);
+    saved_phases_[variable] = !IsNegated(trail_[i]);
+    values_[variable] = kUnassigned;
+    reasons_[variable] = kNoClause;
+    if (heap_positions_[variable] < 0) {
+      HeapInsert(variable);
+    }
+  }
+  trail_.resize(trail_limits_[level]);
+  trail_limits_.resize(level);
+  propagation_head_ = trail_.size();
+}
+
+void SatSolver::ReduceClauses() {
+  XLS_CHECK_EQ(DecisionLevel(), 0);
+  std::vector<bool> removed(clauses_.size(), false);
+
+  // Forget the less active half of the (non-binary) learned clauses.
+  std::vector<int32_t> learned;
+  for (int32_t i = 0; i < clauses_.size(); ++i) {
+    if (clauses_[i].learned && clauses_[i].literals.size() > 2) {
+      learned.push_back(i);
+    }
+  }
+  std::sort(learned.begin(), learned.end(), [&](int32_t a, int32_t b) {
+    return clauses_[a].activity < clauses_[b].activity;
+  });
+  for (int64_t i = 0; i < learned.size() / 2; ++i) {
+    removed[learned[i]] = true;
+  }
+
+  // Top-level assignments are permanent: clauses they satisfy are dropped and
+  // literals they falsify are removed. Nothing needs their reasons any more.
+  std::vector<Clause> clauses;
+  learned_count_ = 0;
+  for (int32_t i = 0; i < clauses_.size(); ++i) {
+    if (removed[i]) {
+      continue;
+    }
+    Clause& clause = clauses_[i];
+    bool satisfied = false;
+    int64_t kept = 0;
+    for (SatLiteral literal : clause.literals) {
+      int8_t value = LiteralValue(literal);
+      if (value == 1) {
+        satisfied = true;
+        break;
+      }
+      if (value == kUnassigned) {
+        clause.literals[kept++] = literal;
+      }
+    }
+    if (satisfied) {
+      continue;
+    }
+    // Propagation is complete, so every unsatisfied clause has at least two
+    // unassigned literals.
+    XLS_CHECK_GE(kept, 2);
+    clause.literals.resize(kept);
+    learned_count_ += clause.learned ? 1 : 0;
+    clauses.push_back(std::move(clause));
+  }
+  clauses_ = std::move(clauses);
+  for (SatLiteral literal : trail_) {
+    reasons_[Variable(literal)] = kNoClause;
+  }
+  for (std::vector<int32_t>& watchers : watches_) {
+    watchers.clear();
+  }
+  for (int32_t i = 0; i < clauses_.size(); ++i) {
+    AttachClause(i);
+  }
+}
+
+int64_t SatSolver::PickBranchVariable() {
+  while (!heap_.empty()) {
+    int64_t variable = HeapPop();
+    if (values_[variable] == kUnassigned) {
+      return variable;
+    }
+  }
+  return -1;
+}
+
+void SatSolver::BumpVariable(int64_t variable) {
+  activities_[variable] += variable_increment_;
+  if (activities_[variable] > 1e100) {
+    for (double& activity : activities_) {
+      activity *= 1e-100;
+    }
+    variable_increment_ *= 1e-100;
+  }
+  if (heap_positions_[variable] >= 0) {
+    HeapSiftUp(heap_positions_[variable]);
+  }
+}
+
+void SatSolver::BumpClause(Clause& clause) {
+  clause.activity += clause_increment_;
+  if (clause.activity > 1e20) {
+    for (Clause& c : clauses_) {
+      c.activity *= 1e-20;
+    }
+    clause_increment_ *= 1e-20;
+  }
+}
+
+void SatSolver::HeapInsert(int64_t variable) {
+  heap_positions_[variable] = heap_.size();
+  heap_.push_back(variable);
+  HeapSiftUp(heap_.size() - 1);
+}
+
+int64_t SatSolver::HeapPop() {
+  int64_t top = heap_.front();
+  heap_positions_[top] = -1;
+  int64_t last = heap_.back();
+  heap_.pop_back();
+  if (!heap_.empty()) {
+    heap_[0] = last;
+    heap_positions_[last] = 0;
+    HeapSiftDown(0);
+  }
+  return top;
+}
+
+void SatSolver::HeapSiftUp(int64_t position) {
+  int64_t variable = heap_[position];
+  while (position > 0) {
+    int64_t parent = (position - 1) / 2;
+    if (!HeapLess(variable, heap_[parent])) {
+      break;
+    }
+    heap_[position] = heap_[parent];
+    heap_positions_[heap_[position]] = position;
+    position = parent;
+  }
+  heap_[position] = variable;
+  heap_positions_[variable] = position;
+}
+
+void SatSolver::HeapSiftDown(int64_t position) {
+  int64_t variable = heap_[position];
+  while (true) {
+    int64_t child = 2 * position + 1;
+    if (child >= heap_.size()) {
+      break;
+    }
+    if (child + 1 < heap_.size() && HeapLess(heap_[child + 1], heap_[child])) {
+      ++child;
+    }
+    if (!HeapLess(heap_[child], variable)) {
+      break;
+    }
+    heap_[position] = heap_[child];
+    heap_positions_[heap_[position]] = position;
+    position = child;
+  }
+  heap_[position] = variable;
+  heap_positions_[variable] = position;
+}
+
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,189 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_SAT_SOLVER_H_
+#define XLS_SOLVERS_SAT_SOLVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace xls {
+namespace solvers {
+
+// A literal of a SatSolver variable: the low bit is the negation flag and the
+// remaining bits are the variable index.
+using SatLiteral = int32_t;
+
+// A small conflict-driven clause-learning SAT solver, for problems bit-blasted
+// to CNF (see aig_sat.h). It uses the usual MiniSat-style machinery: two
+// watched literals per clause, first-UIP learning, activity-based decisions
+// with phase saving, and Luby restarts.
+//
+// The solver is incremental: clauses may be added between calls to Solve(),
+// and each call may be given assumptions -- literals which are treated as
+// decisions for that call only. Learned clauses are kept across calls, so a
+// series of related queries posed as assumptions over one clause set is
+// cheaper than solving each from scratch.
+class SatSolver {
+ public:
+  enum class Result { kSatisfiable, kUnsatisfiable, kUnknown };
+
+  static SatLiteral MakeLiteral(int64_t variable, bool negated) {
+    return static_cast<SatLiteral>(variable << 1) | (negated ? 1 : 0);
+  }
+  static SatLiteral Negate(SatLiteral literal) { return literal ^ 1; }
+  static int64_t Variable(SatLiteral literal) { return literal >> 1; }
+  static bool IsNegated(SatLiteral literal) { return literal & 1; }
+
+  // Returns the index of a new variable.
+  int64_t NewVariable();
+  int64_t variable_count() const { return values_.size(); }
+
+  // Adds the disjunction of "literals" to the clause set. Adding the empty
+  // clause (or a clause contradicting those already present at the top level)
+  // makes the problem unsatisfiable.
+  void AddClause(absl::Span<const SatLiteral> literals);
+
+  // Searches for an assignment of the variables satisfying all clauses and
+  // assumptions. Returns kUnknown if the deadline or conflict limit is reached
+  // first.
+  Result Solve(absl::Span<const SatLiteral> assumptions = {});
+
+  // Returns the value of the variable in the satisfying assignment found by
+  // the last Solve() call, which must have returned kSatisfiable.
+  bool ModelValue(int64_t variable) const { return model_[variable]; }
+  bool LiteralModelValue(SatLiteral literal) const {
+    return model_[Variable(literal)] != IsNegated(literal);
+  }
+
+  // Limits on each subsequent Solve() call. A negative conflict limit means
+  // there is none. If an interrupt flag is given, Solve() returns kUnknown
+  // soon after another thread sets it.
+  void set_deadline(absl::Time deadline) { deadline_ = deadline; }
+  void set_conflict_limit(int64_t limit) { conflict_limit_ = limit; }
+  void set_interrupt(const std::atomic<bool>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
+  // Cumulative search statistics.
+  int64_t conflicts() const { return conflicts_; }
+  int64_t decisions() const { return decisions_; }
+  int64_t propagations() const { return propagations_; }
+
+ private:
+  // Sentinel values.
+  static constexpr int32_t kNoClause = -1;
+  static constexpr int8_t kUnassigned = -1;
+
+  struct Clause {
+    std::vector<SatLiteral> literals;
+    bool learned;
+    double activity;
+  };
+
+  // Returns 1 if the literal is true, 0 if false and kUnassigned otherwise.
+  int8_t LiteralValue(SatLiteral literal) const {
+    int8_t value = values_[Variable(literal)];
+    return value == kUnassigned ? kUnassigned : value ^ IsNegated(literal);
+  }
+  int64_t DecisionLevel() const { return trail_limits_.size(); }
+
+  // Runs conflict-driven search until a result is found or "conflict_budget"
+  // conflicts have occurred (returning kUnknown, so the caller can restart).
+  Result Search(int64_t conflict_budget,
+                absl::Span<const SatLiteral> assumptions,
+                int64_t start_conflicts);
+  // Returns true if the limits on the current Solve() call, begun after
+  // "start_conflicts" conflicts, have been reached. The deadline is only
+  // checked if "check_clock" is set.
+  bool LimitReached(int64_t start_conflicts, bool check_clock) const;
+
+  void Assign(SatLiteral literal, int32_t reason);
+  void AttachClause(int32_t clause);
+
+  // Propagates the unprocessed assignments of the trail. Returns the index of
+  // a falsified clause, or kNoClause.
+  int32_t Propagate();
+
+  // Computes the first-UIP clause learned from the given conflict, with the
+  // asserting literal first and a literal of the backjump level second.
+  std::vector<SatLiteral> Analyze(int32_t conflict);
+  bool IsRedundant(SatLiteral literal) const;
+  void Backtrack(int64_t level);
+
+  // Removes satisfied clauses, false literals and the less active half of the
+  // learned clauses. Must be called at decision level zero after propagation.
+  void ReduceClauses();
+
+  // Returns the unassigned variable with the highest activity, or -1.
+  int64_t PickBranchVariable();
+  void BumpVariable(int64_t variable);
+  void BumpClause(Clause& clause);
+
+  // The activity-ordered heap of decision candidates.
+  void HeapInsert(int64_t variable);
+  int64_t HeapPop();
+  void HeapSiftUp(int64_t position);
+  void HeapSiftDown(int64_t position);
+  bool HeapLess(int64_t a, int64_t b) const {
+    return activities_[a] > activities_[b];
+  }
+
+  // Per-variable state.
+  std::vector<int8_t> values_;
+  std::vector<int64_t> levels_;
+  std::vector<int32_t> reasons_;
+  std::vector<bool> saved_phases_;
+  std::vector<double> activities_;
+  std::vector<int64_t> heap_positions_;
+  mutable std::vector<bool> seen_;
+
+  std::vector<Clause> clauses_;
+  int64_t learned_count_ = 0;
+  int64_t max_learned_ = 0;
+
+  // Indexed by literal: the clauses watching that literal, which are visited
+  // when it becomes false.
+  std::vector<std::vector<int32_t>> watches_;
+
+  std::vector<SatLiteral> trail_;
+  std::vector<int64_t> trail_limits_;
+  int64_t propagation_head_ = 0;
+
+  std::vector<int64_t> heap_;
+
+  double variable_increment_ = 1.0;
+  double clause_increment_ = 1.0;
+
+  // False once the clause set is known to be unsatisfiable.
+  bool ok_ = true;
+  std::vector<bool> model_;
+
+  absl::Time deadline_ = absl::InfiniteFuture();
+  int64_t conflict_limit_ = -1;
+  const std::atomic<bool>* interrupt_ = nullptr;
+
+  int64_t conflicts_ = 0;
+  int64_t decisions_ = 0;
+  int64_t propagations_ = 0;
+};
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_SAT_SOLVER_H_
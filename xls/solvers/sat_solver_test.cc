@@ -0,0 +1,197 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/sat_solver.h"
+
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+using Result = SatSolver::Result;
+
+SatLiteral Pos(int64_t variable) {
+  return SatSolver::MakeLiteral(variable, /*negated=*/false);
+}
+SatLiteral Neg(int64_t variable) {
+  return SatSolver::MakeLiteral(variable, /*negated=*/true);
+}
+
+bool Satisfies(const SatSolver& solver,
+               const std::vector<std::vector<SatLiteral>>& clauses) {
+  for (const std::vector<SatLiteral>& clause : clauses) {
+    bool satisfied = false;
+    for (SatLiteral literal : clause) {
+      satisfied |= solver.LiteralModelValue(literal);
+    }
+    if (!satisfied) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(SatSolverTest, TrivialProblems) {
+  SatSolver solver;
+  EXPECT_EQ(solver.Solve(), Result::kSatisfiable);
+
+  int64_t a = solver.NewVariable();
+  int64_t b = solver.NewVariable();
+  solver.AddClause({Pos(a), Pos(b)});
+  solver.AddClause({Neg(a)});
+  ASSERT_EQ(solver.Solve(), Result::kSatisfiable);
+  EXPECT_FALSE(solver.ModelValue(a));
+  EXPECT_TRUE(solver.ModelValue(b));
+
+  solver.AddClause({Neg(b)});
+  EXPECT_EQ(solver.Solve(), Result::kUnsatisfiable);
+}
+
+TEST(SatSolverTest, PigeonholeIsUnsatisfiable) {
+  // Five pigeons in four holes: variable p * kHoles + h places pigeon p in
+  // hole h.
+  constexpr int64_t kPigeons = 5;
+  constexpr int64_t kHoles = 4;
+  SatSolver solver;
+  for (int64_t i = 0; i < kPigeons * kHoles; ++i) {
+    solver.NewVariable();
+  }
+  for (int64_t p = 0; p < kPigeons; ++p) {
+    std::vector<SatLiteral> somewhere;
+    for (int64_t h = 0; h < kHoles; ++h) {
+      somewhere.push_back(Pos(p * kHoles + h));
+    }
+    solver.AddClause(somewhere);
+  }
+  for (int64_t h = 0; h < kHoles; ++h) {
+    for (int64_t p = 0; p < kPigeons; ++p) {
+      for (int64_t q = p + 1; q < kPigeons; ++q) {
+        solver.AddClause({Neg(p * kHoles + h), Neg(q * kHoles + h)});
+      }
+    }
+  }
+  EXPECT_EQ(solver.Solve(), Result::kUnsatisfiable);
+  EXPECT_GT(solver.conflicts(), 0);
+}
+
+TEST(SatSolverTest, RandomThreeSatMatchesBruteForce) {
+  constexpr int64_t kVariables = 12;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int64_t> variable_dist(0, kVariables - 1);
+  std::bernoulli_distribution sign_dist(0.5);
+  int64_t satisfiable_count = 0;
+  for (int64_t trial = 0; trial < 100; ++trial) {
+    // About the satisfiability threshold, so both outcomes occur.
+    std::vector<std::vector<SatLiteral>> clauses;
+    for (int64_t i = 0; i < 52; ++i) {
+      std::vector<SatLiteral> clause;
+      for (int64_t j = 0; j < 3; ++j) {
+        clause.push_back(
+            SatSolver::MakeLiteral(variable_dist(rng), sign_dist(rng)));
+      }
+      clauses.push_back(clause);
+    }
+
+    bool expected = false;
+    for (int64_t assignment = 0; assignment < (1 << kVariables) && !expected;
+         ++assignment) {
+      bool all = true;
+      for (const std::vector<SatLiteral>& clause : clauses) {
+        bool any = false;
+        for (SatLiteral literal : clause) {
+          bool value = (assignment >> SatSolver::Variable(literal)) & 1;
+          any |= value != SatSolver::IsNegated(literal);
+        }
+        all &= any;
+      }
+      expected = all;
+    }
+
+    SatSolver solver;
+    for (int64_t i = 0; i < kVariables; ++i) {
+      solver.NewVariable();
+    }
+    for (const std::vector<SatLiteral>& clause : clauses) {
+      solver.AddClause(clause);
+    }
+    Result result = solver.Solve();
+    EXPECT_EQ(result, expected ? Result::kSatisfiable : Result::kUnsatisfiable)
+        << "trial " << trial;
+    if (result == Result::kSatisfiable) {
+      EXPECT_TRUE(Satisfies(solver, clauses)) << "trial " << trial;
+      ++satisfiable_count;
+    }
+  }
+  EXPECT_GT(satisfiable_count, 0);
+  EXPECT_LT(satisfiable_count, 100);
+}
+
+TEST(SatSolverTest, IncrementalAssumptions) {
+  // x XOR y XOR z == 1.
+  SatSolver solver;
+  int64_t x = solver.NewVariable();
+  int64_t y = solver.NewVariable();
+  int64_t z = solver.NewVariable();
+  solver.AddClause({Pos(x), Pos(y), Pos(z)});
+  solver.AddClause({Pos(x), Neg(y), Neg(z)});
+  solver.AddClause({Neg(x), Pos(y), Neg(z)});
+  solver.AddClause({Neg(x), Neg(y), Pos(z)});
+
+  ASSERT_EQ(solver.Solve({Pos(x), Pos(y)}), Result::kSatisfiable);
+  EXPECT_TRUE(solver.ModelValue(z));
+  ASSERT_EQ(solver.Solve({Pos(x), Neg(y)}), Result::kSatisfiable);
+  EXPECT_FALSE(solver.ModelValue(z));
+  EXPECT_EQ(solver.Solve({Neg(x), Neg(y), Neg(z)}), Result::kUnsatisfiable);
+
+  // Assumptions don't persist, but added clauses do.
+  EXPECT_EQ(solver.Solve(), Result::kSatisfiable);
+  solver.AddClause({Neg(z)});
+  EXPECT_EQ(solver.Solve({Neg(x), Neg(y)}), Result::kUnsatisfiable);
+  ASSERT_EQ(solver.Solve({Neg(x)}), Result::kSatisfiable);
+  EXPECT_TRUE(solver.ModelValue(y));
+}
+
+TEST(SatSolverTest, ConflictLimit) {
+  constexpr int64_t kPigeons = 9;
+  constexpr int64_t kHoles = 8;
+  SatSolver solver;
+  for (int64_t i = 0; i < kPigeons * kHoles; ++i) {
+    solver.NewVariable();
+  }
+  for (int64_t p = 0; p < kPigeons; ++p) {
+    std::vector<SatLiteral> somewhere;
+    for (int64_t h = 0; h < kHoles; ++h) {
+      somewhere.push_back(Pos(p * kHoles + h));
+    }
+    solver.AddClause(somewhere);
+  }
+  for (int64_t h = 0; h < kHoles; ++h) {
+    for (int64_t p = 0; p < kPigeons; ++p) {
+      for (int64_t q = p + 1; q < kPigeons; ++q) {
+        solver.AddClause({Neg(p * kHoles + h), Neg(q * kHoles + h)});
+      }
+    }
+  }
+  solver.set_conflict_limit(10);
+  EXPECT_EQ(solver.Solve(), Result::kUnknown);
+}
+
+}  // namespace
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,513 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/smtlib_emitter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/lsb_or_msb.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+// Node names are identifiers, so they never contain '|' and are safe to quote.
+std::string Symbol(absl::string_view name) {
+  return absl::StrCat("|", name, "|");
+}
+
+std::string BitVecSort(int64_t width) {
+  return absl::StrFormat("(_ BitVec %d)", width);
+}
+
+std::string Constant(uint64_t value, int64_t width) {
+  return absl::StrFormat("(_ bv%d %d)", value, width);
+}
+
+std::string AllOnes(int64_t width) {
+  return absl::StrFormat("(bvnot %s)", Constant(0, width));
+}
+
+std::string BoolToBitVec(absl::string_view condition) {
+  return absl::StrFormat("(ite %s #b1 #b0)", condition);
+}
+
+// Returns bits [low, low + width) of "term", which is "term_width" bits wide.
+std::string Extract(absl::string_view term, int64_t low, int64_t width,
+                    int64_t term_width) {
+  if (low == 0 && width == term_width) {
+    return std::string(term);
+  }
+  return absl::StrFormat("((_ extract %d %d) %s)", low + width - 1, low, term);
+}
+
+std::string ZeroExtend(absl::string_view term, int64_t by) {
+  if (by == 0) {
+    return std::string(term);
+  }
+  return absl::StrFormat("((_ zero_extend %d) %s)", by, term);
+}
+
+std::string SignExtend(absl::string_view term, int64_t by) {
+  if (by == 0) {
+    return std::string(term);
+  }
+  return absl::StrFormat("((_ sign_extend %d) %s)", by, term);
+}
+
+// Concatenates "terms" with the first in the most significant bits.
+std::string Concat(absl::Span<const std::string> terms) {
+  if (terms.size() == 1) {
+    return terms.front();
+  }
+  return absl::StrFormat("(concat %s)", absl::StrJoin(terms, " "));
+}
+
+// Applies the left-associative "op" to "terms", or returns the only term.
+std::string Fold(absl::string_view op, absl::Span<const std::string> terms) {
+  if (terms.size() == 1) {
+    return terms.front();
+  }
+  return absl::StrFormat("(%s %s)", op, absl::StrJoin(terms, " "));
+}
+
+std::string Reverse(absl::string_view term, int64_t width) {
+  std::vector<std::string> bits;
+  for (int64_t i = 0; i < width; ++i) {
+    bits.push_back(Extract(term, i, 1, width));
+  }
+  return Concat(bits);
+}
+
+// Returns a term which is "choices[i]" if "index" (of width "index_width")
+// is i, and the last choice if "index" is past the end.
+std::string Choose(absl::string_view index, int64_t index_width,
+                   absl::Span<const std::string> choices) {
+  int64_t reachable = choices.size();
+  if (index_width < 63) {
+    reachable = std::min(reachable, int64_t{1} << index_width);
+  }
+  std::string result = choices[reachable - 1];
+  for (int64_t i = reachable - 2; i >= 0; --i) {
+    result = absl::StrFormat("(ite (= %s %s) %s %s)", index,
+                             Constant(i, index_width), choices[i], result);
+  }
+  return result;
+}
+
+void AppendValueBits(const Value& value, std::string* digits) {
+  if (value.IsBits()) {
+    for (int64_t i = value.bits().bit_count() - 1; i >= 0; --i) {
+      digits->push_back(value.bits().Get(i) ? '1' : '0');
+    }
+    return;
+  }
+  for (const Value& element : value.elements()) {
+    AppendValueBits(element, digits);
+  }
+}
+
+class SmtLibEmitter {
+ public:
+  explicit SmtLibEmitter(std::ostream& out) : out_(out) {}
+
+  absl::Status Emit(Function* function) {
+    out_ << "; Function " << function->name() << "\n";
+    out_ << "(set-logic QF_BV)\n";
+    for (Node* node : TopoSort(function)) {
+      int64_t width = node->GetType()->GetFlatBitCount();
+      if (width == 0) {
+        continue;
+      }
+      if (node->Is<Param>()) {
+        out_ << absl::StreamFormat("(declare-fun %s () %s)\n", Ref(node),
+                                   BitVecSort(width));
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(std::string term, Translate(node));
+      out_ << absl::StreamFormat("(define-fun %s () %s %s)\n", Ref(node),
+                                 BitVecSort(width), term);
+    }
+    Node* return_value = function->return_value();
+    XLS_ASSIGN_OR_RETURN(std::string result, Operand(return_value));
+    out_ << absl::StreamFormat(
+        "(define-fun %s () %s %s)\n",
+        Symbol(absl::StrCat("fn:", function->name())),
+        BitVecSort(return_value->GetType()->GetFlatBitCount()), result);
+    if (!out_) {
+      return absl::InternalError("Failed to write SMT-LIB output");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  static std::string Ref(const Node* node) { return Symbol(node->GetName()); }
+
+  static int64_t Width(const Node* node) {
+    return node->GetType()->GetFlatBitCount();
+  }
+
+  static absl::StatusOr<std::string> Operand(const Node* node) {
+    if (Width(node) == 0) {
+      return absl::UnimplementedError(absl::StrFormat(
+          "Zero-width value %s cannot be expressed in SMT-LIB",
+          node->GetName()));
+    }
+    return Ref(node);
+  }
+
+  // Returns the terms of the operands, except for zero-width ones, which
+  // contribute no bits to a concatenation.
+  static std::vector<std::string> NonEmptyOperands(const Node* node) {
+    std::vector<std::string> terms;
+    for (const Node* operand : node->operands()) {
+      if (Width(operand) > 0) {
+        terms.push_back(Ref(operand));
+      }
+    }
+    return terms;
+  }
+
+  static absl::StatusOr<std::vector<std::string>> Operands(
+      absl::Span<Node* const> nodes) {
+    std::vector<std::string> terms;
+    for (const Node* node : nodes) {
+      XLS_ASSIGN_OR_RETURN(std::string term, Operand(node));
+      terms.push_back(term);
+    }
+    return terms;
+  }
+
+  // Returns a term for a shift of operand 0 by operand 1. The operands are
+  // brought to a common width, which "extend" applies to the shifted value.
+  static absl::StatusOr<std::string> Shift(
+      const Node* node, absl::string_view op,
+      std::string (*extend)(absl::string_view, int64_t)) {
+    XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                         Operands(node->operands()));
+    int64_t width = Width(node);
+    int64_t amount_width = Width(node->operand(1));
+    int64_t common = std::max(width, amount_width);
+    return Extract(absl::StrFormat("(%s %s %s)", op,
+                                   extend(terms[0], common - width),
+                                   ZeroExtend(terms[1], common - amount_width)),
+                   0, width, common);
+  }
+
+  static absl::StatusOr<std::string> Multiply(const Node* node,
+                                              bool is_signed) {
+    XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                         Operands(node->operands()));
+    int64_t width = Width(node);
+    int64_t common = std::max(
+        {width, Width(node->operand(0)), Width(node->operand(1))});
+    for (int64_t i = 0; i < 2; ++i) {
+      int64_t by = common - Width(node->operand(i));
+      terms[i] =
+          is_signed ? SignExtend(terms[i], by) : ZeroExtend(terms[i], by);
+    }
+    return Extract(absl::StrFormat("(bvmul %s %s)", terms[0], terms[1]), 0,
+                   width, common);
+  }
+
+  static absl::StatusOr<std::string> Compare(const Node* node,
+                                             absl::string_view op) {
+    XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                         Operands(node->operands()));
+    return BoolToBitVec(absl::StrFormat("(%s %s %s)", op, terms[0], terms[1]));
+  }
+
+  static absl::StatusOr<std::string> Nary(const Node* node,
+                                          absl::string_view op, bool invert) {
+    XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                         Operands(node->operands()));
+    std::string result = Fold(op, terms);
+    return invert ? absl::StrFormat("(bvnot %s)", result) : result;
+  }
+
+  static absl::StatusOr<std::string> ArrayIndexTerm(ArrayIndex* index) {
+    XLS_ASSIGN_OR_RETURN(std::string array, Operand(index->array()));
+    Type* type = index->array()->GetType();
+    // Each level of indexing selects from the previous level's result, which
+    // is bound with let so it is written once.
+    std::vector<std::string> bindings;
+    for (int64_t level = 0; level < index->indices().size(); ++level) {
+      Node* index_node = index->indices()[level];
+      XLS_ASSIGN_OR_RETURN(std::string index_term, Operand(index_node));
+      ArrayType* array_type = type->AsArrayOrDie();
+      int64_t element_width = array_type->element_type()->GetFlatBitCount();
+      std::vector<std::string> elements;
+      for (int64_t i = 0; i < array_type->size(); ++i) {
+        elements.push_back(Extract(array,
+                                   (array_type->size() - i - 1) * element_width,
+                                   element_width, type->GetFlatBitCount()));
+      }
+      std::string selected = Choose(index_term, Width(index_node), elements);
+      if (level + 1 == index->indices().size()) {
+        return absl::StrCat(absl::StrJoin(bindings, ""), selected,
+                            std::string(bindings.size(), ')'));
+      }
+      array = Symbol(absl::StrCat(index->GetName(), ":", level));
+      bindings.push_back(absl::StrFormat("(let ((%s %s)) ", array, selected));
+      type = array_type->element_type();
+    }
+    return array;
+  }
+
+  static absl::StatusOr<std::string> OneHotTerm(OneHot* one_hot) {
+    XLS_ASSIGN_OR_RETURN(std::string input, Operand(one_hot->operand(0)));
+    int64_t width = Width(one_hot->operand(0));
+    std::string none_set = BoolToBitVec(
+        absl::StrFormat("(= %s %s)", input, Constant(0, width)));
+    // x & -x isolates the least significant set bit; the most significant one
+    // is found the same way on the reversed input.
+    if (one_hot->priority() == LsbOrMsb::kLsb) {
+      return Concat(
+          {none_set, absl::StrFormat("(bvand %s (bvneg %s))", input, input)});
+    }
+    std::string reversed = Symbol(absl::StrCat(one_hot->GetName(), ":rev"));
+    std::string lowest = Symbol(absl::StrCat(one_hot->GetName(), ":low"));
+    return absl::StrFormat(
+        "(let ((%s %s)) (let ((%s (bvand %s (bvneg %s)))) %s))", reversed,
+        Reverse(input, width), lowest, reversed, reversed,
+        Concat({none_set, Reverse(lowest, width)}));
+  }
+
+  static absl::StatusOr<std::string> Translate(Node* node) {
+    int64_t width = Width(node);
+    switch (node->op()) {
+      case Op::kLiteral: {
+        std::string digits = "#b";
+        AppendValueBits(node->As<Literal>()->value(), &digits);
+        return digits;
+      }
+      case Op::kIdentity:
+        return Operand(node->operand(0));
+      case Op::kAdd:
+        return Nary(node, "bvadd", /*invert=*/false);
+      case Op::kSub:
+        return Nary(node, "bvsub", /*invert=*/false);
+      case Op::kNeg:
+      case Op::kNot: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        return absl::StrFormat("(%s %s)",
+                               node->op() == Op::kNeg ? "bvneg" : "bvnot",
+                               input);
+      }
+      case Op::kAnd:
+        return Nary(node, "bvand", /*invert=*/false);
+      case Op::kOr:
+        return Nary(node, "bvor", /*invert=*/false);
+      case Op::kXor:
+        return Nary(node, "bvxor", /*invert=*/false);
+      case Op::kNand:
+        return Nary(node, "bvand", /*invert=*/true);
+      case Op::kNor:
+        return Nary(node, "bvor", /*invert=*/true);
+      case Op::kUMul:
+        return Multiply(node, /*is_signed=*/false);
+      case Op::kSMul:
+        return Multiply(node, /*is_signed=*/true);
+      case Op::kShll:
+        return Shift(node, "bvshl", ZeroExtend);
+      case Op::kShrl:
+        return Shift(node, "bvlshr", ZeroExtend);
+      case Op::kShra:
+        return Shift(node, "bvashr", SignExtend);
+      case Op::kEq:
+        return Compare(node, "=");
+      case Op::kNe:
+        return Compare(node, "distinct");
+      case Op::kULt:
+        return Compare(node, "bvult");
+      case Op::kULe:
+        return Compare(node, "bvule");
+      case Op::kUGt:
+        return Compare(node, "bvugt");
+      case Op::kUGe:
+        return Compare(node, "bvuge");
+      case Op::kSLt:
+        return Compare(node, "bvslt");
+      case Op::kSLe:
+        return Compare(node, "bvsle");
+      case Op::kSGt:
+        return Compare(node, "bvsgt");
+      case Op::kSGe:
+        return Compare(node, "bvsge");
+      case Op::kAndReduce:
+      case Op::kOrReduce:
+      case Op::kXorReduce: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        int64_t input_width = Width(node->operand(0));
+        if (node->op() == Op::kAndReduce) {
+          return BoolToBitVec(
+              absl::StrFormat("(= %s %s)", input, AllOnes(input_width)));
+        }
+        if (node->op() == Op::kOrReduce) {
+          return BoolToBitVec(absl::StrFormat("(distinct %s %s)", input,
+                                              Constant(0, input_width)));
+        }
+        std::vector<std::string> bits;
+        for (int64_t i = 0; i < input_width; ++i) {
+          bits.push_back(Extract(input, i, 1, input_width));
+        }
+        return Fold("bvxor", bits);
+      }
+      case Op::kConcat:
+      case Op::kTuple:
+      case Op::kArray:
+      case Op::kArrayConcat:
+        return Concat(NonEmptyOperands(node));
+      case Op::kTupleIndex: {
+        TupleIndex* tuple_index = node->As<TupleIndex>();
+        XLS_ASSIGN_OR_RETURN(std::string tuple,
+                             Operand(tuple_index->operand(0)));
+        TupleType* tuple_type =
+            tuple_index->operand(0)->GetType()->AsTupleOrDie();
+        int64_t low = 0;
+        for (int64_t i = tuple_type->size() - 1; i > tuple_index->index();
+             --i) {
+          low += tuple_type->element_type(i)->GetFlatBitCount();
+        }
+        return Extract(tuple, low, width, tuple_type->GetFlatBitCount());
+      }
+      case Op::kArrayIndex:
+        return ArrayIndexTerm(node->As<ArrayIndex>());
+      case Op::kBitSlice: {
+        BitSlice* slice = node->As<BitSlice>();
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(slice->operand(0)));
+        return Extract(input, slice->start(), slice->width(),
+                       Width(slice->operand(0)));
+      }
+      case Op::kDynamicBitSlice: {
+        DynamicBitSlice* slice = node->As<DynamicBitSlice>();
+        XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                             Operands(slice->operands()));
+        int64_t input_width = Width(slice->to_slice());
+        int64_t start_width = Width(slice->start());
+        int64_t common = std::max({input_width, start_width, width});
+        // Bits shifted in from past the end of the input are zero.
+        return Extract(
+            absl::StrFormat("(bvlshr %s %s)",
+                            ZeroExtend(terms[0], common - input_width),
+                            ZeroExtend(terms[1], common - start_width)),
+            0, width, common);
+      }
+      case Op::kBitSliceUpdate: {
+        BitSliceUpdate* update = node->As<BitSliceUpdate>();
+        XLS_ASSIGN_OR_RETURN(std::vector<std::string> terms,
+                             Operands(update->operands()));
+        int64_t start_width = Width(update->start());
+        int64_t update_width = Width(update->update_value());
+        int64_t common = std::max({width, start_width, update_width});
+        std::string start = ZeroExtend(terms[1], common - start_width);
+        std::string mask = absl::StrFormat(
+            "(bvshl %s %s)",
+            ZeroExtend(AllOnes(update_width), common - update_width), start);
+        return Extract(
+            absl::StrFormat(
+                "(bvor (bvand %s (bvnot %s)) (bvshl %s %s))",
+                ZeroExtend(terms[0], common - width), mask,
+                ZeroExtend(terms[2], common - update_width), start),
+            0, width, common);
+      }
+      case Op::kZeroExt:
+      case Op::kSignExt: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        int64_t by = width - Width(node->operand(0));
+        return node->op() == Op::kZeroExt ? ZeroExtend(input, by)
+                                          : SignExtend(input, by);
+      }
+      case Op::kReverse: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        return Reverse(input, width);
+      }
+      case Op::kSel: {
+        Select* select = node->As<Select>();
+        XLS_ASSIGN_OR_RETURN(std::string selector,
+                             Operand(select->selector()));
+        XLS_ASSIGN_OR_RETURN(std::vector<std::string> choices,
+                             Operands(select->cases()));
+        if (select->default_value().has_value()) {
+          XLS_ASSIGN_OR_RETURN(std::string default_value,
+                               Operand(*select->default_value()));
+          choices.push_back(default_value);
+        }
+        return Choose(selector, Width(select->selector()), choices);
+      }
+      case Op::kOneHotSel: {
+        OneHotSelect* select = node->As<OneHotSelect>();
+        XLS_ASSIGN_OR_RETURN(std::string selector,
+                             Operand(select->selector()));
+        XLS_ASSIGN_OR_RETURN(std::vector<std::string> cases,
+                             Operands(select->cases()));
+        std::vector<std::string> selected;
+        for (int64_t i = 0; i < cases.size(); ++i) {
+          selected.push_back(absl::StrFormat(
+              "(ite (= %s #b1) %s %s)",
+              Extract(selector, i, 1, Width(select->selector())), cases[i],
+              Constant(0, width)));
+        }
+        return Fold("bvor", selected);
+      }
+      case Op::kOneHot:
+        return OneHotTerm(node->As<OneHot>());
+      case Op::kEncode: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        int64_t input_width = Width(node->operand(0));
+        std::vector<std::string> indices;
+        for (int64_t i = 0; i < input_width; ++i) {
+          indices.push_back(absl::StrFormat(
+              "(ite (= %s #b1) %s %s)", Extract(input, i, 1, input_width),
+              Constant(i, width), Constant(0, width)));
+        }
+        return Fold("bvor", indices);
+      }
+      case Op::kDecode: {
+        XLS_ASSIGN_OR_RETURN(std::string input, Operand(node->operand(0)));
+        int64_t input_width = Width(node->operand(0));
+        int64_t common = std::max(width, input_width);
+        return Extract(absl::StrFormat("(bvshl %s %s)", Constant(1, common),
+                                       ZeroExtend(input, common - input_width)),
+                       0, width, common);
+      }
+      default:
+        return absl::UnimplementedError(
+            absl::StrFormat("Cannot emit SMT-LIB for node: %s",
+                            node->ToString()));
+    }
+  }
+
+  std::ostream& out_;
+};
+
+}  // namespace
+
+absl::Status EmitSmtLib(Function* function, std::ostream& out) {
+  return SmtLibEmitter(out).Emit(function);
+}
+
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,46 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Streams an XLS IR function out as SMT-LIB2 over fixed-width bit vectors,
+// for external solvers.
+//
+// Unlike translating with z3::IrTranslator and printing the result, nothing is
+// materialized beyond the text of one node at a time: parameters become
+// declare-fun constants and every node becomes a define-fun in topological
+// order, so shared subterms are written once however often they're used.
+// Values of tuple and array type are flattened to bit vectors the way codegen
+// flattens them, with element zero in the most significant bits.
+//
+// The function's result is defined as the constant |fn:<function name>|.
+
+#ifndef XLS_SOLVERS_SMTLIB_EMITTER_H_
+#define XLS_SOLVERS_SMTLIB_EMITTER_H_
+
+#include <ostream>
+
+#include "absl/status/status.h"
+#include "xls/ir/function.h"
+
+namespace xls {
+namespace solvers {
+
+// Writes "function" to "out". Returns an Unimplemented error for operations
+// the emitter doesn't support (e.g., division or array_update) and for
+// zero-width values used by anything but concatenations, tuples, and arrays.
+absl::Status EmitSmtLib(Function* function, std::ostream& out);
+
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_SMTLIB_EMITTER_H_
@@ -0,0 +1,193 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/smtlib_emitter.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/ascii.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "../z3/src/api/z3.h"
+#include "../z3/src/api/z3_api.h"
+
+namespace xls {
+namespace solvers {
+namespace {
+
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+// Emits the entry function of "ir_text", appends "query" to it, and returns
+// Z3's answer to the query's check-sat.
+absl::StatusOr<std::string> Check(absl::string_view ir_text,
+                                  absl::string_view query) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(Function * function, package->EntryFunction());
+  std::ostringstream smtlib;
+  XLS_RETURN_IF_ERROR(EmitSmtLib(function, smtlib));
+  smtlib << query;
+
+  Z3_config config = Z3_mk_config();
+  Z3_context ctx = Z3_mk_context(config);
+  Z3_del_config(config);
+  std::string result = Z3_eval_smtlib2_string(ctx, smtlib.str().c_str());
+  Z3_del_context(ctx);
+  return std::string(absl::StripAsciiWhitespace(result));
+}
+
+// Returns Z3's answer to whether "f" can differ from "expected", given the
+// assertions in "given".
+absl::StatusOr<std::string> CheckResult(absl::string_view ir_text,
+                                        absl::string_view given,
+                                        absl::string_view expected) {
+  return Check(ir_text, absl::StrCat(given, "(assert (not (= |fn:f| ",
+                                     expected, ")))(check-sat)"));
+}
+
+TEST(SmtLibEmitterTest, Arithmetic) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[8], y: bits[8]) -> bits[8] {
+  add.1: bits[8] = add(x, y)
+  ret sub.2: bits[8] = sub(add.1, y)
+}
+)";
+  EXPECT_THAT(CheckResult(kIr, "", "|x|"),
+              status_testing::IsOkAndHolds("unsat"));
+}
+
+TEST(SmtLibEmitterTest, SharedSubtermsAreDefinedOnce) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[8]) -> bits[8] {
+  not.1: bits[8] = not(x)
+  and.2: bits[8] = and(not.1, not.1)
+  ret or.3: bits[8] = or(and.2, not.1)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kIr));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->EntryFunction());
+  std::ostringstream smtlib;
+  XLS_ASSERT_OK(EmitSmtLib(function, smtlib));
+  EXPECT_THAT(smtlib.str(), HasSubstr("(declare-fun |x| () (_ BitVec 8))"));
+  EXPECT_THAT(smtlib.str(),
+              HasSubstr("(define-fun |not.1| () (_ BitVec 8) (bvnot |x|))"));
+  EXPECT_THAT(smtlib.str(), HasSubstr("(define-fun |and.2| () (_ BitVec 8) "
+                                      "(bvand |not.1| |not.1|))"));
+  EXPECT_THAT(CheckResult(kIr, "", "(bvnot |x|)"),
+              status_testing::IsOkAndHolds("unsat"));
+}
+
+TEST(SmtLibEmitterTest, MixedWidthOperations) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[8], s: bits[3]) -> bits[16] {
+  shll.1: bits[8] = shll(x, s)
+  shra.2: bits[8] = shra(x, s)
+  umul.3: bits[16] = umul(x, s)
+  ult.4: bits[1] = ult(x, s)
+  concat.5: bits[17] = concat(ult.4, shll.1, shra.2)
+  bit_slice.6: bits[16] = bit_slice(concat.5, start=0, width=16)
+  ret xor.7: bits[16] = xor(bit_slice.6, umul.3)
+}
+)";
+  // 0x81 << 2 = 0x04, 0x81 >>> 2 = 0xe0, 0x81 * 2 = 0x0102.
+  EXPECT_THAT(
+      CheckResult(kIr, "(assert (= |x| #x81))(assert (= |s| #b010))",
+                  "(bvxor #x04e0 #x0102)"),
+      status_testing::IsOkAndHolds("unsat"));
+}
+
+TEST(SmtLibEmitterTest, AggregatesAreFlattened) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[4], y: bits[4], i: bits[2]) -> (bits[4], bits[1]) {
+  literal.1: bits[4][2] = literal(value=[1, 2])
+  array.2: bits[4][2][2] = array(literal.1, literal.1)
+  tuple.3: (bits[4], (), bits[4]) = tuple(x, (), y)
+  tuple_index.4: bits[4] = tuple_index(tuple.3, index=2)
+  array_index.5: bits[4] = array_index(array.2, indices=[i, i])
+  add.6: bits[4] = add(tuple_index.4, array_index.5)
+  or_reduce.7: bits[1] = or_reduce(x)
+  ret tuple.8: (bits[4], bits[1]) = tuple(add.6, or_reduce.7)
+}
+)";
+  // Index 3 is clamped to the last element, 2.
+  EXPECT_THAT(CheckResult(kIr,
+                          "(assert (= |x| #x0))(assert (= |y| #x5))"
+                          "(assert (= |i| #b11))",
+                          "#b01110"),
+              status_testing::IsOkAndHolds("unsat"));
+  EXPECT_THAT(CheckResult(kIr,
+                          "(assert (= |x| #x0))(assert (= |y| #x5))"
+                          "(assert (= |i| #b00))",
+                          "#b01100"),
+              status_testing::IsOkAndHolds("unsat"));
+}
+
+TEST(SmtLibEmitterTest, Selects) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[4], p: bits[2]) -> bits[4] {
+  literal.1: bits[4] = literal(value=7)
+  sel.2: bits[4] = sel(p, cases=[x, literal.1], default=x)
+  one_hot.3: bits[5] = one_hot(x, lsb_prio=false)
+  bit_slice.4: bits[4] = bit_slice(one_hot.3, start=0, width=4)
+  one_hot_sel.5: bits[4] = one_hot_sel(p, cases=[bit_slice.4, literal.1])
+  ret xor.6: bits[4] = xor(sel.2, one_hot_sel.5)
+}
+)";
+  // The msb of x one-hot encodes to 0b0100. With p = 1, sel picks 7 and
+  // one_hot_sel the one-hot value; with p = 3, sel takes the default and
+  // one_hot_sel ORs both cases.
+  EXPECT_THAT(CheckResult(kIr, "(assert (= |x| #x6))(assert (= |p| #b01))",
+                          "(bvxor #x7 #x4)"),
+              status_testing::IsOkAndHolds("unsat"));
+  EXPECT_THAT(CheckResult(kIr, "(assert (= |x| #x6))(assert (= |p| #b11))",
+                          "(bvxor #x6 #x7)"),
+              status_testing::IsOkAndHolds("unsat"));
+}
+
+TEST(SmtLibEmitterTest, UnsupportedOperation) {
+  constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[8], y: bits[8]) -> bits[8] {
+  ret udiv.1: bits[8] = udiv(x, y)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kIr));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->EntryFunction());
+  std::ostringstream smtlib;
+  EXPECT_THAT(EmitSmtLib(function, smtlib),
+              StatusIs(absl::StatusCode::kUnimplemented, HasSubstr("udiv")));
+}
+
+}  // namespace
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,351 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/solvers/z3_aig_sweeper.h"
+
+#include <random>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "xls/common/logging/logging.h"
+#include "../z3/src/api/z3.h"
+
+namespace xls {
+namespace solvers {
+namespace z3 {
+namespace {
+
+// Translates the nodes of an Aig into Z3 boolean terms on demand. Nodes are
+// translated in index order, so each is translated at most once and its
+// operands are always available.
+class AigToZ3 {
+ public:
+  explicit AigToZ3(const Aig* aig) : aig_(aig) {
+    Z3_config config = Z3_mk_config();
+    ctx_ = Z3_mk_context(config);
+    Z3_del_config(config);
+  }
+  ~AigToZ3() { Z3_del_context(ctx_); }
+
+  Z3_context ctx() { return ctx_; }
+
+  Z3_ast Translate(AigLiteral literal) {
+    for (int64_t node = nodes_.size(); node <= Aig::NodeIndex(literal);
+         ++node) {
+      if (node == 0) {
+        nodes_.push_back(Z3_mk_false(ctx_));
+      } else if (aig_->IsInput(node)) {
+        nodes_.push_back(Z3_mk_const(ctx_, Z3_mk_int_symbol(ctx_, node),
+                                     Z3_mk_bool_sort(ctx_)));
+      } else {
+        Z3_ast operands[] = {GetLiteral(aig_->fanin0(node)),
+                             GetLiteral(aig_->fanin1(node))};
+        nodes_.push_back(Z3_mk_and(ctx_, 2, operands));
+      }
+    }
+    return GetLiteral(literal);
+  }
+
+  // Creates a solver, with the given timeout if it's finite. The solver must be
+  // released with Z3_solver_dec_ref().
+  Z3_solver CreateSolver(absl::Duration timeout) {
+    Z3_solver solver = Z3_mk_solver(ctx_);
+    Z3_solver_inc_ref(ctx_, solver);
+    if (timeout != absl::InfiniteDuration()) {
+      Z3_params params = Z3_mk_params(ctx_);
+      Z3_params_inc_ref(ctx_, params);
+      Z3_params_set_uint(ctx_, params, Z3_mk_string_symbol(ctx_, "timeout"),
+                         absl::ToInt64Milliseconds(timeout));
+      Z3_solver_set_params(ctx_, solver, params);
+      Z3_params_dec_ref(ctx_, params);
+    }
+    return solver;
+  }
+
+  // Checks whether the two literals can take different values. If they can,
+  // the inputs of a distinguishing assignment are stored in "counterexample",
+  // in the order of Aig::inputs().
+  Z3_lbool CheckDifferent(Z3_solver solver, AigLiteral a, AigLiteral b,
+                          std::vector<bool>* counterexample) {
+    Z3_ast difference = Z3_mk_xor(ctx_, Translate(a), Translate(b));
+    Z3_solver_push(ctx_, solver);
+    Z3_solver_assert(ctx_, solver, difference);
+    Z3_lbool satisfiable = Z3_solver_check(ctx_, solver);
+    if (satisfiable == Z3_L_TRUE) {
+      StoreCounterexample(solver, counterexample);
+    }
+    Z3_solver_pop(ctx_, solver, 1);
+    return satisfiable;
+  }
+
+  // Checks whether the literals of any pair can take different values.
+  Z3_lbool CheckAnyDifferent(
+      Z3_solver solver,
+      absl::Span<const std::pair<AigLiteral, AigLiteral>> pairs) {
+    std::vector<Z3_ast> differences;
+    for (const auto& pair : pairs) {
+      differences.push_back(
+          Z3_mk_xor(ctx_, Translate(pair.first), Translate(pair.second)));
+    }
+    Z3_solver_assert(ctx_, solver,
+                     Z3_mk_or(ctx_, differences.size(), differences.data()));
+    return Z3_solver_check(ctx_, solver);
+  }
+
+ private:
+  Z3_ast GetLiteral(AigLiteral literal) {
+    Z3_ast node = nodes_[Aig::NodeIndex(literal)];
+    return Aig::IsComplemented(literal) ? Z3_mk_not(ctx_, node) : node;
+  }
+
+  void StoreCounterexample(Z3_solver solver,
+                           std::vector<bool>* counterexample) {
+    Z3_model model = Z3_solver_get_model(ctx_, solver);
+    Z3_model_inc_ref(ctx_, model);
+    counterexample->clear();
+    for (int64_t input : aig_->inputs()) {
+      bool value = false;
+      Z3_ast evaluated;
+      // Inputs outside of the translated cones may take any value.
+      if (input < nodes_.size() &&
+          Z3_model_eval(ctx_, model, nodes_[input], /*model_completion=*/true,
+                        &evaluated)) {
+        value = Z3_get_bool_value(ctx_, evaluated) == Z3_L_TRUE;
+      }
+      counterexample->push_back(value);
+    }
+    Z3_model_dec_ref(ctx_, model);
+  }
+
+  const Aig* aig_;
+  Z3_context ctx_;
+  std::vector<Z3_ast> nodes_;
+};
+
+// Returns which nodes are in the transitive fanin of the given pairs.
+std::vector<bool> MarkCone(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> pairs) {
+  std::vector<bool> live(aig.node_count(), false);
+  live[0] = true;
+  for (const auto& pair : pairs) {
+    live[Aig::NodeIndex(pair.first)] = true;
+    live[Aig::NodeIndex(pair.second)] = true;
+  }
+  for (int64_t node = aig.node_count() - 1; node > 0; --node) {
+    if (live[node] && aig.IsAnd(node)) {
+      live[Aig::NodeIndex(aig.fanin0(node))] = true;
+      live[Aig::NodeIndex(aig.fanin1(node))] = true;
+    }
+  }
+  return live;
+}
+
+int64_t CountAnds(const Aig& aig, const std::vector<bool>& live) {
+  int64_t count = 0;
+  for (int64_t node = 0; node < aig.node_count(); ++node) {
+    if (live[node] && aig.IsAnd(node)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint64_t MixSignature(uint64_t signature, uint64_t word) {
+  signature ^= word + 0x9e3779b97f4a7c15ULL + (signature << 6) +
+               (signature >> 2);
+  return signature * 0xff51afd7ed558ccdULL;
+}
+
+// Returns the stimulus words of the given simulation word index: random
+// values, with the lanes of words past "random_words" holding the
+// counterexamples collected so far.
+std::vector<uint64_t> MakeStimulus(
+    int64_t word, int64_t random_words, int64_t input_count,
+    const std::vector<std::vector<bool>>& counterexamples,
+    std::mt19937_64* rng) {
+  std::vector<uint64_t> stimulus(input_count);
+  for (uint64_t& value : stimulus) {
+    value = (*rng)();
+  }
+  if (word < random_words) {
+    return stimulus;
+  }
+  int64_t first = (word - random_words) * 64;
+  for (int64_t lane = 0;
+       lane < 64 && first + lane < counterexamples.size(); ++lane) {
+    const std::vector<bool>& counterexample = counterexamples[first + lane];
+    for (int64_t i = 0; i < input_count; ++i) {
+      uint64_t bit = uint64_t{1} << lane;
+      stimulus[i] = counterexample[i] ? (stimulus[i] | bit)
+                                      : (stimulus[i] & ~bit);
+    }
+  }
+  return stimulus;
+}
+
+}  // namespace
+
+absl::StatusOr<AigSweepResult> SweepAndCheckEquivalence(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    const AigSweepOptions& options) {
+  AigSweepResult result = {};
+  result.initial_and_count = CountAnds(aig, MarkCone(aig, outputs));
+
+  std::mt19937_64 rng(options.seed);
+  std::vector<std::vector<bool>> counterexamples;
+  Aig graph = aig;
+  std::vector<std::pair<AigLiteral, AigLiteral>> pairs(outputs.begin(),
+                                                       outputs.end());
+  auto all_equal = [&]() {
+    for (const auto& pair : pairs) {
+      if (pair.first != pair.second) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  while (result.rounds < options.max_rounds && !all_equal()) {
+    ++result.rounds;
+    std::vector<bool> live = MarkCone(graph, pairs);
+
+    // Simulate to compute a signature of each node's function. Signatures are
+    // normalized so that a node and its complement share one, with "phase"
+    // recording which of the two the node is.
+    int64_t word_count = options.simulation_words +
+                         (counterexamples.size() + 63) / 64;
+    std::vector<uint64_t> signatures(graph.node_count(), 0);
+    std::vector<bool> phases(graph.node_count(), false);
+    for (int64_t w = 0; w < word_count; ++w) {
+      std::vector<uint64_t> words = graph.Simulate(
+          MakeStimulus(w, options.simulation_words, graph.input_count(),
+                       counterexamples, &rng));
+      for (const auto& pair : pairs) {
+        if (Aig::LiteralValue(words, pair.first) !=
+            Aig::LiteralValue(words, pair.second)) {
+          XLS_VLOG(1) << "Simulation distinguishes an output pair in round "
+                      << result.rounds;
+          result.equivalent = false;
+          result.reduced_and_count = CountAnds(graph, live);
+          return result;
+        }
+      }
+      for (int64_t node = 0; node < graph.node_count(); ++node) {
+        if (w == 0) {
+          phases[node] = words[node] & 1;
+        }
+        signatures[node] = MixSignature(
+            signatures[node], phases[node] ? ~words[node] : words[node]);
+      }
+    }
+
+    // Rebuild the live part of the graph, merging each node into the first node
+    // of its class when they're proved equivalent.
+    Aig reduced;
+    std::vector<AigLiteral> node_map(graph.node_count(), Aig::kFalse);
+    auto map_literal = [&](AigLiteral literal) {
+      return node_map[Aig::NodeIndex(literal)] ^
+             (Aig::IsComplemented(literal) ? 1 : 0);
+    };
+    for (int64_t input : graph.inputs()) {
+      node_map[input] = reduced.AddInput();
+    }
+    bool found_counterexample = false;
+    {
+      AigToZ3 translator(&reduced);
+      Z3_solver solver = translator.CreateSolver(options.pair_timeout);
+      absl::flat_hash_map<uint64_t, int64_t> classes;
+      std::vector<bool> counterexample;
+      for (int64_t node = 0; node < graph.node_count(); ++node) {
+        if (!live[node]) {
+          continue;
+        }
+        if (graph.IsAnd(node)) {
+          node_map[node] = reduced.And(map_literal(graph.fanin0(node)),
+                                       map_literal(graph.fanin1(node)));
+        }
+        auto insert = classes.insert({signatures[node], node});
+        if (insert.second) {
+          continue;
+        }
+        int64_t representative = insert.first->second;
+        AigLiteral target =
+            node_map[representative] ^
+            (phases[node] != phases[representative] ? 1 : 0);
+        if (node_map[node] == target) {
+          continue;
+        }
+        Z3_lbool different = translator.CheckDifferent(
+            solver, node_map[node], target, &counterexample);
+        if (different == Z3_L_FALSE) {
+          node_map[node] = target;
+          ++result.proven_pairs;
+        } else if (different == Z3_L_TRUE) {
+          counterexamples.push_back(counterexample);
+          found_counterexample = true;
+          ++result.disproven_pairs;
+        } else {
+          ++result.timed_out_pairs;
+        }
+      }
+      Z3_solver_dec_ref(translator.ctx(), solver);
+    }
+    for (auto& pair : pairs) {
+      pair = {map_literal(pair.first), map_literal(pair.second)};
+    }
+    graph = std::move(reduced);
+    XLS_VLOG(1) << "Sweep round " << result.rounds << ": "
+                << CountAnds(graph, MarkCone(graph, pairs)) << " live ANDs, "
+                << result.proven_pairs << " pairs merged so far";
+    if (!found_counterexample) {
+      // Further rounds would see the same candidates.
+      break;
+    }
+  }
+
+  result.reduced_and_count = CountAnds(graph, MarkCone(graph, pairs));
+  std::vector<std::pair<AigLiteral, AigLiteral>> remaining;
+  for (const auto& pair : pairs) {
+    if (pair.first == Aig::Not(pair.second)) {
+      result.equivalent = false;
+      return result;
+    }
+    if (pair.first != pair.second) {
+      remaining.push_back(pair);
+    }
+  }
+  result.remaining_outputs = remaining.size();
+  if (remaining.empty()) {
+    result.equivalent = true;
+    return result;
+  }
+
+  AigToZ3 translator(&graph);
+  Z3_solver solver = translator.CreateSolver(absl::InfiniteDuration());
+  Z3_lbool different = translator.CheckAnyDifferent(solver, remaining);
+  Z3_solver_dec_ref(translator.ctx(), solver);
+  if (different == Z3_L_UNDEF) {
+    return absl::InternalError(
+        "Z3 could not decide the reduced equivalence miter.");
+  }
+  result.equivalent = different == Z3_L_FALSE;
+  return result;
+}
+
+}  // namespace z3
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,85 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SOLVERS_Z3_AIG_SWEEPER_H_
+#define XLS_SOLVERS_Z3_AIG_SWEEPER_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/solvers/aig.h"
+
+namespace xls {
+namespace solvers {
+namespace z3 {
+
+struct AigSweepOptions {
+  // The number of 64-vector words of random stimulus simulated to find
+  // candidate equivalent nodes.
+  int64_t simulation_words = 8;
+
+  // The maximum number of simulate-and-sweep rounds. Counterexamples found
+  // while sweeping a round are added to the stimulus of the next, splitting
+  // candidate classes that random simulation could not.
+  int64_t max_rounds = 4;
+
+  // The solver timeout for proving each candidate pair; pairs which time out
+  // are left unmerged.
+  absl::Duration pair_timeout = absl::Seconds(1);
+
+  // Seed for the random stimulus.
+  uint64_t seed = 0;
+};
+
+struct AigSweepResult {
+  // True if every output pair was proved equivalent.
+  bool equivalent;
+
+  // The number of AND nodes in the graph before and after sweeping.
+  int64_t initial_and_count;
+  int64_t reduced_and_count;
+
+  int64_t rounds;
+
+  // The outcomes of the candidate-pair queries over all rounds.
+  int64_t proven_pairs;
+  int64_t disproven_pairs;
+  int64_t timed_out_pairs;
+
+  // The number of output pairs not resolved by simulation and sweeping, and so
+  // checked by the final query over the reduced miter. If zero, Z3 was only
+  // used to prove internal equivalences.
+  int64_t remaining_outputs;
+};
+
+// Checks that the two literals of each pair in "outputs" are equivalent
+// functions of the inputs of "aig", as a SAT-sweeping equivalence checker
+// does: random simulation groups nodes into classes of candidate equivalents,
+// each candidate is proved equal to the first node of its class with a small
+// Z3 query, and proven equivalences are merged, so that structural hashing
+// folds their fanout together. Only output pairs not merged this way are
+// solved directly, as a single miter over the reduced graph.
+absl::StatusOr<AigSweepResult> SweepAndCheckEquivalence(
+    const Aig& aig,
+    absl::Span<const std::pair<AigLiteral, AigLiteral>> outputs,
+    const AigSweepOptions& options = AigSweepOptions());
+
+}  // namespace z3
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_Z3_AIG_SWEEPER_H_
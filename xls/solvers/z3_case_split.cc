@@ -0,0 +1,256 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/solvers/z3_case_split.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/solvers/z3_utils.h"
+
+namespace xls {
+namespace solvers {
+namespace z3 {
+namespace {
+
+// Returns field "field" (0 for the sign, 1 for the biased exponent, 2 for the
+// fraction) of parameter "param_index", which must be a float32 tuple.
+absl::StatusOr<Z3_ast> GetFloat32Field(Z3_context ctx,
+                                       absl::Span<const Z3_ast> params,
+                                       int64_t param_index, int64_t field) {
+  if (param_index >= params.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Parameter index %d out of range; %d parameters",
+                        param_index, params.size()));
+  }
+  Z3_ast value = params[param_index];
+  Z3_sort sort = Z3_get_sort(ctx, value);
+  if (Z3_get_sort_kind(ctx, sort) != Z3_DATATYPE_SORT ||
+      Z3_get_tuple_sort_num_fields(ctx, sort) != 3) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Parameter %d is not a float32 tuple", param_index));
+  }
+  Z3_func_decl field_decl = Z3_get_tuple_sort_field_decl(ctx, sort, field);
+  return Z3_mk_app(ctx, field_decl, 1, &value);
+}
+
+// Returns the constraint that "value", a bit vector, is in [min, max].
+Z3_ast InRange(Z3_context ctx, Z3_ast value, uint64_t min, uint64_t max) {
+  Z3_sort sort = Z3_get_sort(ctx, value);
+  Z3_ast bounds[] = {
+      Z3_mk_bvuge(ctx, value, Z3_mk_unsigned_int64(ctx, min, sort)),
+      Z3_mk_bvule(ctx, value, Z3_mk_unsigned_int64(ctx, max, sort))};
+  return Z3_mk_and(ctx, 2, bounds);
+}
+
+// Returns the case constraining the field "field" of float32 parameter
+// "param_index" to [min, max].
+CaseConstraint Float32FieldCase(std::string description, int64_t param_index,
+                                int64_t field, uint64_t min, uint64_t max) {
+  return CaseConstraint{
+      std::move(description),
+      [=](IrTranslator* translator,
+          absl::Span<const Z3_ast> params) -> absl::StatusOr<Z3_ast> {
+        Z3_context ctx = translator->ctx();
+        XLS_ASSIGN_OR_RETURN(Z3_ast value, GetFloat32Field(ctx, params,
+                                                           param_index, field));
+        return InRange(ctx, value, min, max);
+      }};
+}
+
+}  // namespace
+
+std::vector<CaseConstraint> CrossProduct(
+    absl::Span<const CasePartition> partitions) {
+  std::vector<CaseConstraint> cases = {CaseConstraint{
+      "all inputs",
+      [](IrTranslator* translator,
+         absl::Span<const Z3_ast> params) -> absl::StatusOr<Z3_ast> {
+        return Z3_mk_true(translator->ctx());
+      }}};
+  bool first = true;
+  for (const CasePartition& partition : partitions) {
+    std::vector<CaseConstraint> product;
+    for (const CaseConstraint& prefix : cases) {
+      for (const CaseConstraint& constraint : partition) {
+        if (first) {
+          product.push_back(constraint);
+          continue;
+        }
+        product.push_back(CaseConstraint{
+            absl::StrCat(prefix.description, ", ", constraint.description),
+            [lhs = prefix.build, rhs = constraint.build](
+                IrTranslator* translator,
+                absl::Span<const Z3_ast> params) -> absl::StatusOr<Z3_ast> {
+              XLS_ASSIGN_OR_RETURN(Z3_ast lhs_ast, lhs(translator, params));
+              XLS_ASSIGN_OR_RETURN(Z3_ast rhs_ast, rhs(translator, params));
+              Z3_ast both[] = {lhs_ast, rhs_ast};
+              return Z3_mk_and(translator->ctx(), 2, both);
+            }});
+      }
+    }
+    cases = std::move(product);
+    first = false;
+  }
+  return cases;
+}
+
+CasePartition Float32SignCases(int64_t param_index) {
+  std::string name = absl::StrCat("param ", param_index);
+  return {Float32FieldCase(absl::StrCat(name, " positive"), param_index,
+                           /*field=*/0, 0, 0),
+          Float32FieldCase(absl::StrCat(name, " negative"), param_index,
+                           /*field=*/0, 1, 1)};
+}
+
+CasePartition Float32ExponentCases(int64_t param_index,
+                                   int64_t normal_range_count) {
+  constexpr uint64_t kMaxBexp = 255;
+  std::string name = absl::StrCat("param ", param_index);
+  CasePartition cases = {
+      Float32FieldCase(absl::StrCat(name, " zero/subnormal"), param_index,
+                       /*field=*/1, 0, 0),
+      Float32FieldCase(absl::StrCat(name, " inf/nan"), param_index,
+                       /*field=*/1, kMaxBexp, kMaxBexp)};
+  // The normal exponents, [1, kMaxBexp - 1].
+  uint64_t normal_count = kMaxBexp - 1;
+  uint64_t range_count = std::max<int64_t>(
+      1, std::min<int64_t>(normal_range_count, normal_count));
+  for (uint64_t i = 0; i < range_count; ++i) {
+    uint64_t min = 1 + i * normal_count / range_count;
+    uint64_t max = (i + 1) * normal_count / range_count;
+    cases.push_back(Float32FieldCase(
+        absl::StrFormat("%s bexp in [%d, %d]", name, min, max), param_index,
+        /*field=*/1, min, max));
+  }
+  return cases;
+}
+
+bool CaseSplitResult::proved() const {
+  return std::all_of(cases.begin(), cases.end(), [](const CaseResult& c) {
+    return c.result == Z3_L_FALSE;
+  });
+}
+
+std::string CaseSplitResult::ToString() const {
+  std::vector<std::string> lines;
+  for (const CaseResult& c : cases) {
+    absl::string_view label = c.result == Z3_L_FALSE  ? "proved"
+                              : c.result == Z3_L_TRUE ? "COUNTEREXAMPLE"
+                                                      : "unknown";
+    lines.push_back(absl::StrFormat("[%-14s] %s (%s)", label, c.description,
+                                    absl::FormatDuration(c.duration)));
+  }
+  for (const CaseResult& c : cases) {
+    if (c.result != Z3_L_FALSE) {
+      lines.push_back(absl::StrCat(c.description, ":\n", c.output));
+    }
+  }
+  return absl::StrJoin(lines, "\n");
+}
+
+absl::StatusOr<CaseSplitResult> ProveByCases(
+    const CaseQueryBuilder& build_query,
+    absl::Span<const CaseConstraint> cases, const CaseSplitOptions& options) {
+  if (cases.empty()) {
+    return absl::InvalidArgumentError("No cases to prove");
+  }
+  CaseSplitResult result;
+  for (const CaseConstraint& c : cases) {
+    result.cases.push_back(
+        CaseResult{c.description, Z3_L_UNDEF, "skipped", absl::ZeroDuration()});
+  }
+
+  // Each case is solved on its own, with its own context.
+  auto solve_case = [&](int64_t i) -> absl::Status {
+    absl::Time start = absl::Now();
+    XLS_ASSIGN_OR_RETURN(CaseQuery query, build_query());
+    IrTranslator* translator = query.translator.get();
+    Z3_context ctx = translator->ctx();
+    std::vector<Z3_ast> params;
+    for (Param* param : translator->xls_function()->params()) {
+      params.push_back(translator->GetTranslation(param));
+    }
+    XLS_ASSIGN_OR_RETURN(Z3_ast constraint, cases[i].build(translator, params));
+    translator->SetTimeout(options.timeout_per_case);
+
+    Z3_solver solver = CreateSolver(ctx, /*num_threads=*/1);
+    Z3_solver_assert(ctx, solver, constraint);
+    Z3_solver_assert(ctx, solver, query.violation);
+    Z3_lbool satisfiable = Z3_solver_check(ctx, solver);
+    CaseResult& case_result = result.cases[i];
+    case_result.result = satisfiable;
+    case_result.output = SolverResultToString(ctx, solver, satisfiable);
+    case_result.duration = absl::Now() - start;
+    Z3_solver_dec_ref(ctx, solver);
+    XLS_VLOG(1) << "Case " << cases[i].description << ": "
+                << (satisfiable == Z3_L_FALSE  ? "proved"
+                    : satisfiable == Z3_L_TRUE ? "counterexample"
+                                               : "unknown")
+                << " (" << case_result.duration << ")";
+    return absl::OkStatus();
+  };
+
+  int64_t thread_count = options.thread_count;
+  if (thread_count <= 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count = std::min<int64_t>(thread_count, cases.size());
+
+  std::atomic<int64_t> next_case(0);
+  std::atomic<bool> found_counterexample(false);
+  std::vector<absl::Status> statuses(thread_count);
+  auto run_worker = [&](int64_t t) {
+    for (int64_t i = next_case++; i < cases.size(); i = next_case++) {
+      if (options.stop_on_counterexample && found_counterexample) {
+        continue;
+      }
+      absl::Status status = solve_case(i);
+      if (!status.ok()) {
+        statuses[t].Update(status);
+        continue;
+      }
+      if (result.cases[i].result == Z3_L_TRUE) {
+        found_counterexample = true;
+      }
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 1; t < thread_count; ++t) {
+    threads.push_back(std::make_unique<Thread>([&, t]() { run_worker(t); }));
+  }
+  run_worker(0);
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  for (const absl::Status& status : statuses) {
+    XLS_RETURN_IF_ERROR(status);
+  }
+  return result;
+}
+
+}  // namespace z3
+}  // namespace solvers
+}  // namespace xls
@@ -0,0 +1,130 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Proves properties of XLS functions by splitting their input space into
+// cases, each of which is a separate (and usually much easier) query to Z3.
+
+#ifndef XLS_SOLVERS_Z3_CASE_SPLIT_H_
+#define XLS_SOLVERS_Z3_CASE_SPLIT_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/solvers/z3_ir_translator.h"
+#include "../z3/src/api/z3.h"
+
+namespace xls {
+namespace solvers {
+namespace z3 {
+
+// The query for one case of a proof: a translator, which owns the Z3 context
+// of the query, and a boolean formula which is satisfiable iff the property
+// doesn't hold for some input.
+struct CaseQuery {
+  std::unique_ptr<IrTranslator> translator;
+  Z3_ast violation;
+};
+
+// Builds the query of a proof in a new Z3 context. Called once per case, and
+// concurrently from several threads.
+using CaseQueryBuilder = std::function<absl::StatusOr<CaseQuery>()>;
+
+// A constraint on the inputs of a query, which defines one case of a proof.
+struct CaseConstraint {
+  std::string description;
+
+  // Returns the constraint, given the translator of the query and the
+  // translations of its function's parameters.
+  std::function<absl::StatusOr<Z3_ast>(IrTranslator* translator,
+                                       absl::Span<const Z3_ast> params)>
+      build;
+};
+
+// A set of constraints which together cover the whole input space.
+using CasePartition = std::vector<CaseConstraint>;
+
+// Returns the cases of the product of "partitions": one per combination of a
+// constraint from each partition, constrained to all of them.
+std::vector<CaseConstraint> CrossProduct(
+    absl::Span<const CasePartition> partitions);
+
+// Partitions of a float32 parameter, i.e. a (u1 sign, u8 biased exponent,
+// u23 fraction) tuple, of a query's function.
+//
+// The parameter is positive or negative.
+CasePartition Float32SignCases(int64_t param_index);
+// The biased exponent of the parameter is zero (zeros and subnormals), all
+// ones (infinities and NaNs) or, for the normal numbers, in one of
+// "normal_range_count" ranges of about the same size.
+CasePartition Float32ExponentCases(int64_t param_index,
+                                   int64_t normal_range_count);
+
+// The result of a single case; see ProveByCases().
+struct CaseResult {
+  std::string description;
+
+  // Z3_L_FALSE if the property was proved for the case, Z3_L_TRUE if a
+  // counterexample was found, and Z3_L_UNDEF if the solver gave up (e.g. on
+  // timeout) or the case was skipped.
+  Z3_lbool result;
+
+  // The solver's output, with the counterexample if one was found.
+  std::string output;
+
+  // The time spent building and solving the case.
+  absl::Duration duration;
+};
+
+struct CaseSplitResult {
+  std::vector<CaseResult> cases;
+
+  // Whether the property was proved for every case.
+  bool proved() const;
+
+  // A summary line per case, followed by the output of the cases which
+  // weren't proved.
+  std::string ToString() const;
+};
+
+struct CaseSplitOptions {
+  // Number of cases to solve concurrently; one per hardware thread if not
+  // positive.
+  int64_t thread_count = 0;
+
+  // How long to let the solver work on each case.
+  absl::Duration timeout_per_case = absl::InfiniteDuration();
+
+  // If set, cases not yet started when a counterexample is found are skipped.
+  bool stop_on_counterexample = true;
+};
+
+// Proves the property of "build_query" by solving a query per case of
+// "cases", which must together cover the input space. Each query has its own
+// Z3 context, so the cases are solved in parallel.
+absl::StatusOr<CaseSplitResult> ProveByCases(
+    const CaseQueryBuilder& build_query,
+    absl::Span<const CaseConstraint> cases, const CaseSplitOptions& options);
+
+}  // namespace z3
+}  // namespace solvers
+}  // namespace xls
+
+#endif  // XLS_SOLVERS_Z3_CASE_SPLIT_H_
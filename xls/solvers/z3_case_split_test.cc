@@ -0,0 +1,174 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/solvers/z3_case_split.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+#include "../z3/src/api/z3_api.h"
+#include "../z3/src/api/z3_fpa.h"
+
+namespace xls {
+namespace {
+
+using solvers::z3::CaseConstraint;
+using solvers::z3::CaseQuery;
+using solvers::z3::CaseQueryBuilder;
+using solvers::z3::CaseSplitOptions;
+using solvers::z3::CaseSplitResult;
+using solvers::z3::CrossProduct;
+using solvers::z3::Float32ExponentCases;
+using solvers::z3::Float32SignCases;
+using solvers::z3::IrTranslator;
+using solvers::z3::ProveByCases;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+// Returns a builder of the query that "f(x) < limit" for all bits[8] x.
+CaseQueryBuilder LessThanQuery(Function* f, uint64_t limit) {
+  return [f, limit]() -> absl::StatusOr<CaseQuery> {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrTranslator> translator,
+                         IrTranslator::CreateAndTranslate(f));
+    Z3_context ctx = translator->ctx();
+    Z3_ast result = translator->GetReturnNode();
+    Z3_ast violation = Z3_mk_bvuge(
+        ctx, result,
+        Z3_mk_unsigned_int64(ctx, limit, Z3_get_sort(ctx, result)));
+    return CaseQuery{std::move(translator), violation};
+  };
+}
+
+// Returns the case that the first parameter is in [min, max].
+CaseConstraint RangeCase(uint64_t min, uint64_t max) {
+  return CaseConstraint{
+      absl::StrFormat("x in [%d, %d]", min, max),
+      [=](IrTranslator* translator,
+          absl::Span<const Z3_ast> params) -> absl::StatusOr<Z3_ast> {
+        Z3_context ctx = translator->ctx();
+        Z3_sort sort = Z3_get_sort(ctx, params[0]);
+        Z3_ast bounds[] = {
+            Z3_mk_bvuge(ctx, params[0], Z3_mk_unsigned_int64(ctx, min, sort)),
+            Z3_mk_bvule(ctx, params[0], Z3_mk_unsigned_int64(ctx, max, sort))};
+        return Z3_mk_and(ctx, 2, bounds);
+      }};
+}
+
+class Z3CaseSplitTest : public IrTestBase {};
+
+TEST_F(Z3CaseSplitTest, ProvesEveryCase) {
+  auto p = CreatePackage();
+  FunctionBuilder b("f", p.get());
+  auto x = b.Param("x", p->GetBitsType(8));
+  b.Shrl(x, b.Literal(UBits(1, 8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, b.Build());
+
+  CaseSplitOptions options;
+  options.thread_count = 2;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      CaseSplitResult result,
+      ProveByCases(LessThanQuery(f, 128),
+                   {RangeCase(0, 63), RangeCase(64, 191), RangeCase(192, 255)},
+                   options));
+  EXPECT_TRUE(result.proved());
+  ASSERT_EQ(result.cases.size(), 3);
+  for (const auto& c : result.cases) {
+    EXPECT_EQ(c.result, Z3_L_FALSE) << c.description;
+  }
+  EXPECT_THAT(result.ToString(), HasSubstr("[proved        ] x in [64, 191]"));
+}
+
+TEST_F(Z3CaseSplitTest, FindsCounterexampleInOneCase) {
+  auto p = CreatePackage();
+  FunctionBuilder b("f", p.get());
+  b.Param("x", p->GetBitsType(8));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, b.Build());
+
+  CaseSplitOptions options;
+  options.thread_count = 2;
+  options.stop_on_counterexample = false;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      CaseSplitResult result,
+      ProveByCases(LessThanQuery(f, 200),
+                   {RangeCase(0, 127), RangeCase(128, 255)}, options));
+  EXPECT_FALSE(result.proved());
+  ASSERT_EQ(result.cases.size(), 2);
+  EXPECT_EQ(result.cases[0].result, Z3_L_FALSE);
+  EXPECT_EQ(result.cases[1].result, Z3_L_TRUE);
+  EXPECT_THAT(result.ToString(),
+              HasSubstr("[COUNTEREXAMPLE] x in [128, 255]"));
+}
+
+TEST_F(Z3CaseSplitTest, Float32Partitions) {
+  std::vector<CaseConstraint> cases =
+      CrossProduct({Float32SignCases(0), Float32ExponentCases(0, 2)});
+  std::vector<std::string> descriptions;
+  for (const CaseConstraint& c : cases) {
+    descriptions.push_back(c.description);
+  }
+  EXPECT_THAT(
+      descriptions,
+      ElementsAre("param 0 positive, param 0 zero/subnormal",
+                  "param 0 positive, param 0 inf/nan",
+                  "param 0 positive, param 0 bexp in [1, 127]",
+                  "param 0 positive, param 0 bexp in [128, 254]",
+                  "param 0 negative, param 0 zero/subnormal",
+                  "param 0 negative, param 0 inf/nan",
+                  "param 0 negative, param 0 bexp in [1, 127]",
+                  "param 0 negative, param 0 bexp in [128, 254]"));
+
+  // The sign bit of a float32 other than a NaN is set iff it's negative.
+  auto p = CreatePackage();
+  FunctionBuilder b("f", p.get());
+  auto x = b.Param("x", p->GetTupleType({p->GetBitsType(1), p->GetBitsType(8),
+                                         p->GetBitsType(23)}));
+  b.TupleIndex(x, 0);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, b.Build());
+  CaseQueryBuilder sign_query = [f]() -> absl::StatusOr<CaseQuery> {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrTranslator> translator,
+                         IrTranslator::CreateAndTranslate(f));
+    Z3_context ctx = translator->ctx();
+    XLS_ASSIGN_OR_RETURN(
+        Z3_ast fp,
+        translator->ToFloat32(translator->GetTranslation(f->params()[0])));
+    Z3_ast sign_set =
+        Z3_mk_eq(ctx, translator->GetReturnNode(),
+                 Z3_mk_unsigned_int(ctx, 1, Z3_mk_bv_sort(ctx, 1)));
+    Z3_ast violation_terms[] = {
+        Z3_mk_not(ctx, Z3_mk_fpa_is_nan(ctx, fp)),
+        Z3_mk_not(ctx,
+                  Z3_mk_eq(ctx, sign_set, Z3_mk_fpa_is_negative(ctx, fp)))};
+    Z3_ast violation = Z3_mk_and(ctx, 2, violation_terms);
+    return CaseQuery{std::move(translator), violation};
+  };
+  XLS_ASSERT_OK_AND_ASSIGN(CaseSplitResult result,
+                           ProveByCases(sign_query, cases, CaseSplitOptions()));
+  EXPECT_TRUE(result.proved()) << result.ToString();
+}
+
+TEST_F(Z3CaseSplitTest, NoCases) {
+  auto p = CreatePackage();
+  FunctionBuilder b("f", p.get());
+  b.Param("x", p->GetBitsType(8));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, b.Build());
+  EXPECT_THAT(ProveByCases(LessThanQuery(f, 1), {}, CaseSplitOptions()),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace xls
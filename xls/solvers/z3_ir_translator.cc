@@ -1241,40 +1241,66 @@ absl::StatusOr<Z3_ast> PredicateToObjective(Predicate p, Z3_ast a,
 
 absl::StatusOr<bool> TryProve(Function* f, Node* subject, Predicate p,
                               absl::Duration timeout) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<ProverSession> session,
+                       ProverSession::Create(f, timeout));
+  return session->TryProve(subject, p);
+}
+
+absl::StatusOr<std::unique_ptr<ProverSession>> ProverSession::Create(
+    Function* f, absl::Duration timeout) {
   XLS_ASSIGN_OR_RETURN(auto translator, IrTranslator::CreateAndTranslate(f));
   translator->SetTimeout(timeout);
-  Z3_ast value = translator->GetTranslation(subject);
+  Z3_solver solver = solvers::z3::CreateSolver(translator->ctx(), 1);
+  return absl::WrapUnique(new ProverSession(std::move(translator), solver));
+}
 
+ProverSession::~ProverSession() {
+  Z3_solver_dec_ref(translator_->ctx(), solver_);
+}
+
+absl::StatusOr<bool> ProverSession::TryProve(Node* subject, Predicate p) {
+  auto key = std::make_tuple(
+      subject, p.kind(),
+      p.kind() == PredicateKind::kEqualToNode ? p.node() : nullptr);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    ++cache_hits_;
+    return it->second;
+  }
+  XLS_ASSIGN_OR_RETURN(bool proven, Prove(subject, p));
+  cache_[key] = proven;
+  return proven;
+}
+
+absl::StatusOr<bool> ProverSession::Prove(Node* subject, Predicate p) {
   // All token types are equal.
   if (subject->GetType()->IsToken() &&
       p.kind() == PredicateKind::kEqualToNode &&
       p.node()->GetType()->IsToken()) {
     return true;
   }
-  if (translator->GetValueKind(value) != Z3_BV_SORT) {
+  Z3_ast value = translator_->GetTranslation(subject);
+  if (translator_->GetValueKind(value) != Z3_BV_SORT) {
     return absl::InvalidArgumentError(
         "Cannot prove properties of non-bits-typed node: " +
         subject->ToString());
   }
   XLS_ASSIGN_OR_RETURN(Z3_ast objective,
-                       PredicateToObjective(p, value, translator.get()));
-  Z3_context ctx = translator->ctx();
+                       PredicateToObjective(p, value, translator_.get()));
+  Z3_context ctx = translator_->ctx();
   XLS_VLOG(2) << "objective:\n" << Z3_ast_to_string(ctx, objective);
-  Z3_solver solver = solvers::z3::CreateSolver(ctx, 1);
-  Z3_solver_assert(ctx, solver, objective);
-  Z3_lbool satisfiable = Z3_solver_check(ctx, solver);
-  XLS_VLOG(2) << solvers::z3::SolverResultToString(ctx, solver, satisfiable)
+  ++solver_queries_;
+  Z3_solver_push(ctx, solver_);
+  Z3_solver_assert(ctx, solver_, objective);
+  Z3_lbool satisfiable = Z3_solver_check(ctx, solver_);
+  XLS_VLOG(2) << solvers::z3::SolverResultToString(ctx, solver_, satisfiable)
               << std::endl;
-  Z3_solver_dec_ref(ctx, solver);
-
-  if (Z3_solver_check(ctx, solver) == Z3_L_FALSE) {
-    // We posit the inverse of the predicate we want to check -- when that is
-    // unsatisfiable, the predicate has been proven (there was no way found that
-    // we could not satisfy its inverse).
-    return true;
-  }
+  Z3_solver_pop(ctx, solver_, 1);
 
-  return false;
+  // We posit the inverse of the predicate we want to check -- when that is
+  // unsatisfiable, the predicate has been proven (there was no way found that
+  // we could not satisfy its inverse).
+  return satisfiable == Z3_L_FALSE;
 }
 
 }  // namespace z3
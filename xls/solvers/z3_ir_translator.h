@@ -18,6 +18,11 @@
 #ifndef XLS_TOOLS_Z3_IR_TRANSLATOR_H_
 #define XLS_TOOLS_Z3_IR_TRANSLATOR_H_
 
+#include <cstdint>
+#include <memory>
+#include <tuple>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "xls/common/logging/logging.h"
@@ -285,9 +290,45 @@ class Predicate {
 
 // Attempts to prove node "subject" in function "f" satisfies the given
 // predicate (over all possible inputs) within the duration "timeout".
+// Each call translates the whole function; use a ProverSession to make
+// several queries about the same function.
 absl::StatusOr<bool> TryProve(Function* f, Node* subject, Predicate p,
                               absl::Duration timeout);
 
+// Answers a series of TryProve() queries about a single function. The function
+// is translated once, each query is checked in its own push/pop scope of a
+// shared incremental solver, and results are cached per (subject, predicate).
+// The function must not be modified while the session is in use; create a new
+// session after changing it.
+class ProverSession {
+ public:
+  static absl::StatusOr<std::unique_ptr<ProverSession>> Create(
+      Function* f, absl::Duration timeout);
+  ~ProverSession();
+
+  // As the free TryProve() function, for a node of this session's function.
+  absl::StatusOr<bool> TryProve(Node* subject, Predicate p);
+
+  // The number of TryProve() calls answered from the cache, and the number
+  // which queried the solver.
+  int64_t cache_hits() const { return cache_hits_; }
+  int64_t solver_queries() const { return solver_queries_; }
+
+ private:
+  ProverSession(std::unique_ptr<IrTranslator> translator, Z3_solver solver)
+      : translator_(std::move(translator)), solver_(solver) {}
+
+  absl::StatusOr<bool> Prove(Node* subject, Predicate p);
+
+  std::unique_ptr<IrTranslator> translator_;
+  Z3_solver solver_;
+
+  // Key is (subject, predicate kind, node compared against, if any).
+  absl::flat_hash_map<std::tuple<Node*, PredicateKind, Node*>, bool> cache_;
+  int64_t cache_hits_ = 0;
+  int64_t solver_queries_ = 0;
+};
+
 }  // namespace z3
 }  // namespace solvers
 }  // namespace xls
@@ -31,6 +31,7 @@ namespace {
 
 using solvers::z3::IrTranslator;
 using solvers::z3::Predicate;
+using solvers::z3::ProverSession;
 using solvers::z3::TryProve;
 using status_testing::IsOkAndHolds;
 
@@ -58,6 +59,39 @@ TEST_F(Z3IrTranslatorTest, ZeroTwoBitsIsZero) {
   EXPECT_TRUE(proven);
 }
 
+TEST_F(Z3IrTranslatorTest, ProverSessionCachesQueries) {
+  auto p = CreatePackage();
+  FunctionBuilder b("f", p.get());
+  auto x = b.Param("x", p->GetBitsType(4));
+  auto zero = b.Literal(UBits(0, /*bit_count=*/4));
+  auto masked = b.And(x, zero);
+  auto ored = b.Or(x, b.Literal(UBits(1, /*bit_count=*/4)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, b.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ProverSession> session,
+      ProverSession::Create(f, absl::InfiniteDuration()));
+
+  EXPECT_THAT(session->TryProve(masked.node(), Predicate::EqualToZero()),
+              IsOkAndHolds(true));
+  EXPECT_THAT(session->TryProve(x.node(), Predicate::EqualToZero()),
+              IsOkAndHolds(false));
+  EXPECT_THAT(session->TryProve(ored.node(), Predicate::NotEqualToZero()),
+              IsOkAndHolds(true));
+  EXPECT_THAT(
+      session->TryProve(masked.node(), Predicate::EqualTo(zero.node())),
+              IsOkAndHolds(true));
+  EXPECT_EQ(session->solver_queries(), 4);
+  EXPECT_EQ(session->cache_hits(), 0);
+
+  // Repeated queries are answered from the cache.
+  EXPECT_THAT(session->TryProve(ored.node(), Predicate::NotEqualToZero()),
+              IsOkAndHolds(true));
+  EXPECT_THAT(session->TryProve(x.node(), Predicate::EqualToZero()),
+              IsOkAndHolds(false));
+  EXPECT_EQ(session->solver_queries(), 4);
+  EXPECT_EQ(session->cache_hits(), 2);
+}
+
 TEST_F(Z3IrTranslatorTest, OneIsNotEqualToZero) {
   auto p = CreatePackage();
   FunctionBuilder b("f", p.get());
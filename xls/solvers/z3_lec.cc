@@ -14,6 +14,7 @@
 
 #include "xls/solvers/z3_lec.h"
 
+#include <atomic>
 #include <thread>  // NOLINT(build/c++11)
 
 #include "absl/base/internal/sysinfo.h"
@@ -21,11 +22,18 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/strip.h"
+#include "absl/time/clock.h"
 #include "xls/codegen/vast.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
 #include "xls/ir/bits_ops.h"
+#include "xls/ir/node_iterator.h"
 #include "xls/ir/node_util.h"
+#include "xls/solvers/aig.h"
+#include "xls/solvers/aig_ir_translator.h"
+#include "xls/solvers/aig_netlist_translator.h"
+#include "xls/solvers/aig_sat.h"
 #include "xls/solvers/z3_utils.h"
 #include "../z3/src/api/z3_api.h"
 
@@ -111,7 +119,6 @@ absl::Status Lec::Init() {
   // Helpful for reading result output.
   Z3_ast x = Z3_mk_const(ctx(), Z3_mk_string_symbol(ctx(), "X"),
                          Z3_mk_bv_sort(ctx(), 1));
-  std::vector<Z3_ast> eq_nodes;
   for (const Node* node : ir_output_nodes_) {
     // Extract the individual bits out of each IR output node, and match those
     // up the corresponding netlist bits. The netlist outputs do not contain
@@ -135,19 +142,98 @@ absl::Status Lec::Init() {
       } else {
         ir_outputs_.push_back(ir_bits[i]);
         netlist_outputs_.push_back(netlist_bits[i]);
-        eq_nodes.push_back(Z3_mk_eq(ctx(), ir_bits[i], netlist_bits[i]));
+        // Both bit vectors are flattened most-significant bit first.
+        output_bits_.push_back(
+            OutputBit{node, static_cast<int64_t>(ir_bits.size()) - 1 - i,
+                      Z3_mk_eq(ctx(), ir_bits[i], netlist_bits[i])});
       }
     }
   }
 
-  Z3_ast eval_node = Z3_mk_and(ctx(), eq_nodes.size(), eq_nodes.data());
-  eval_node = Z3_mk_not(ctx(), eval_node);
+  // The miter itself is asserted by Run() (or per bit by CheckOutputBit()), so
+  // that constraints can be shared by both.
   solver_ = CreateSolver(ctx(), std::thread::hardware_concurrency());
-  Z3_solver_assert(ctx(), solver_.value(), eval_node);
-
   return absl::OkStatus();
 }
 
+absl::StatusOr<std::vector<LecOutputResult>> Lec::RunPerOutput(
+    const LecParams& params, absl::optional<PipelineSchedule> schedule,
+    int stage, Function* constraints, int thread_count) {
+  auto create_lec = [&]() -> absl::StatusOr<std::unique_ptr<Lec>> {
+    auto lec = absl::WrapUnique<Lec>(
+        new Lec(params.ir_package, params.ir_function, params.netlist,
+                params.netlist_module_name, schedule, stage));
+    XLS_RETURN_IF_ERROR(lec->Init());
+    if (constraints != nullptr) {
+      XLS_RETURN_IF_ERROR(lec->AddConstraints(constraints));
+    }
+    return lec;
+  };
+
+  // The first worker's Lec is built up front to size the results; the others
+  // are built on their own threads.
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Lec> first_lec, create_lec());
+  int64_t bit_count = first_lec->output_bit_count();
+  std::vector<LecOutputResult> results(bit_count);
+  if (thread_count <= 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count =
+      std::max<int64_t>(1, std::min<int64_t>(thread_count, bit_count));
+
+  std::atomic<int64_t> next_bit(0);
+  std::vector<absl::Status> statuses(thread_count);
+  auto run_worker = [&](int64_t t, std::unique_ptr<Lec> lec) {
+    if (lec == nullptr) {
+      absl::StatusOr<std::unique_ptr<Lec>> lec_or = create_lec();
+      if (!lec_or.ok()) {
+        statuses[t] = lec_or.status();
+        return;
+      }
+      lec = std::move(lec_or.value());
+      if (lec->output_bit_count() != bit_count) {
+        statuses[t] = absl::InternalError(
+            "Inconsistent output bit count between LEC workers.");
+        return;
+      }
+    }
+    for (int64_t i = next_bit++; i < bit_count; i = next_bit++) {
+      results[i] = lec->CheckOutputBit(i);
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 1; t < thread_count; ++t) {
+    threads.push_back(
+        std::make_unique<Thread>([&, t]() { run_worker(t, nullptr); }));
+  }
+  run_worker(0, std::move(first_lec));
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  for (const absl::Status& status : statuses) {
+    XLS_RETURN_IF_ERROR(status);
+  }
+  return results;
+}
+
+LecOutputResult Lec::CheckOutputBit(int64_t index) {
+  const OutputBit& bit = output_bits_[index];
+  Z3_solver_push(ctx(), solver_.value());
+  Z3_solver_assert(ctx(), solver_.value(), Z3_mk_not(ctx(), bit.eq));
+  absl::Time start = absl::Now();
+  Z3_lbool satisfiable = Z3_solver_check(ctx(), solver_.value());
+  absl::Duration duration = absl::Now() - start;
+  Z3_solver_pop(ctx(), solver_.value(), 1);
+  bool equivalent = satisfiable == Z3_L_FALSE;
+  XLS_VLOG(2) << "Output " << bit.node->GetName() << " bit " << bit.bit_index
+              << ": " << (equivalent ? "equivalent" : "not proven") << " ("
+              << duration << ")";
+  return LecOutputResult{bit.node->GetName(), bit.bit_index, equivalent,
+                         duration};
+}
+
 absl::Status Lec::CollectIrInputs() {
   if (CheckingSingleStage(schedule_, stage_) && stage_ != 0) {
     // If we're evaluating a single stage (aside from the first), then we need
@@ -263,11 +349,20 @@ absl::Status Lec::AddConstraints(Function* constraints) {
   Z3_ast eq_node = Z3_mk_eq(ctx(), constraint_translator->GetReturnNode(),
                             Z3_mk_int(ctx(), 1, Z3_mk_bv_sort(ctx(), 1)));
   Z3_solver_assert(ctx(), solver_.value(), eq_node);
+  has_constraints_ = true;
   return absl::OkStatus();
 }
 
 bool Lec::Run() {
   XLS_LOG(INFO) << "Beginning execution";
+  std::vector<Z3_ast> eq_nodes;
+  eq_nodes.reserve(output_bits_.size());
+  for (const OutputBit& bit : output_bits_) {
+    eq_nodes.push_back(bit.eq);
+  }
+  Z3_ast eval_node = Z3_mk_and(ctx(), eq_nodes.size(), eq_nodes.data());
+  eval_node = Z3_mk_not(ctx(), eval_node);
+  Z3_solver_assert(ctx(), solver_.value(), eval_node);
   satisfiable_ = Z3_solver_check(ctx(), solver_.value()) == Z3_L_TRUE;
   if (satisfiable_) {
     model_ = Z3_solver_get_model(ctx(), solver_.value());
@@ -276,6 +371,144 @@ bool Lec::Run() {
   return !satisfiable_;
 }
 
+absl::StatusOr<std::vector<std::pair<AigLiteral, AigLiteral>>>
+Lec::BuildAigMiter(Aig* aig) {
+  if (has_constraints_) {
+    return absl::UnimplementedError(
+        "Constraints are not supported when bit-blasting.");
+  }
+
+  // Bit-blast the IR, from the inputs to the outputs.
+  absl::flat_hash_map<const Node*, AigEvaluator::Vector> ir_inputs;
+  absl::flat_hash_set<const Node*> inputs;
+  for (const auto& pair : input_mapping_) {
+    inputs.insert(pair.first);
+  }
+  for (const Node* input : SetToIdSortedVector(inputs)) {
+    if (!input->GetType()->IsBits()) {
+      return absl::UnimplementedError(absl::StrCat(
+          "Cannot bit-blast non-bits-typed input: ", input->ToString()));
+    }
+    AigEvaluator::Vector& value = ir_inputs[input];
+    for (int64_t i = 0; i < input->BitCountOrDie(); ++i) {
+      value.push_back(aig->AddInput());
+    }
+  }
+  XLS_ASSIGN_OR_RETURN(
+      auto ir_values,
+      TranslateIrToAig(aig, ir_function_, ir_inputs, ir_output_nodes_));
+
+  // Then the netlist, driven by the same inputs.
+  absl::flat_hash_map<std::string, AigLiteral> netlist_inputs;
+  for (const Node* input : SetToIdSortedVector(inputs)) {
+    const AigEvaluator::Vector& value = ir_values.at(input);
+    for (int64_t i = 0; i < value.size(); ++i) {
+      for (NetRef net : GetNetlistInputNets(input, i, value.size())) {
+        netlist_inputs[net->name()] = value[i];
+      }
+    }
+  }
+  absl::flat_hash_map<std::string, const Module*> module_refs;
+  for (const std::unique_ptr<Module>& module : netlist_->modules()) {
+    if (module->name() != netlist_module_name_) {
+      module_refs[module->name()] = module.get();
+    }
+  }
+  XLS_ASSIGN_OR_RETURN(auto netlist_translator,
+                       AigNetlistTranslator::CreateAndTranslate(
+                           aig, module_, module_refs, netlist_inputs));
+
+  // Pair up the output bits as Init() does for the Z3 miter.
+  std::vector<std::pair<AigLiteral, AigLiteral>> outputs;
+  for (const Node* node : ir_output_nodes_) {
+    const AigEvaluator::Vector& ir_bits = ir_values.at(node);
+    XLS_ASSIGN_OR_RETURN(std::vector<NetRef> netrefs, GetIrNetrefs(node));
+    XLS_RET_CHECK_EQ(netrefs.size(), ir_bits.size());
+    for (int64_t i = 0; i < netrefs.size(); ++i) {
+      // Netrefs are ordered from the most-significant bit down.
+      if (netrefs[i] == nullptr || netrefs[i]->name() == "output_valid") {
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(AigLiteral netlist_bit,
+                           netlist_translator->GetTranslation(netrefs[i]));
+      outputs.push_back({ir_bits[ir_bits.size() - 1 - i], netlist_bit});
+    }
+  }
+
+  return outputs;
+}
+
+absl::StatusOr<AigSweepResult> Lec::RunWithSweeping(
+    const AigSweepOptions& options) {
+  Aig aig;
+  XLS_ASSIGN_OR_RETURN(auto outputs, BuildAigMiter(&aig));
+  XLS_ASSIGN_OR_RETURN(AigSweepResult result,
+                       SweepAndCheckEquivalence(aig, outputs, options));
+  XLS_LOG(INFO) << "SAT sweeping reduced " << result.initial_and_count
+                << " AND nodes to " << result.reduced_and_count << " in "
+                << result.rounds << " round(s); " << result.remaining_outputs
+                << " of " << outputs.size()
+                << " output bits remained for the final query";
+  return result;
+}
+
+absl::StatusOr<bool> Lec::RunWithSat(absl::Duration timeout) {
+  Aig aig;
+  XLS_ASSIGN_OR_RETURN(auto outputs, BuildAigMiter(&aig));
+  XLS_LOG(INFO) << "Bit-blasted the IR and netlist into " << aig.and_count()
+                << " AND nodes over " << aig.input_count() << " inputs";
+  XLS_ASSIGN_OR_RETURN(absl::optional<std::vector<bool>> counterexample,
+                       FindAigCounterexample(aig, outputs, timeout));
+  return !counterexample.has_value();
+}
+
+absl::StatusOr<absl::optional<std::string>>
+Lec::FindCounterexampleBySimulation(int64_t vector_count,
+                                    int64_t thread_count) {
+  Aig aig;
+  XLS_ASSIGN_OR_RETURN(auto outputs, BuildAigMiter(&aig));
+  absl::optional<std::vector<bool>> counterexample =
+      FindAigCounterexampleBySimulation(aig, outputs, vector_count,
+                                        thread_count);
+  if (!counterexample.has_value()) {
+    return absl::nullopt;
+  }
+
+  std::vector<uint64_t> input_words;
+  for (bool value : *counterexample) {
+    input_words.push_back(value ? 1 : 0);
+  }
+  std::vector<uint64_t> words = aig.Simulate(input_words);
+  int64_t differing_bits = 0;
+  for (const auto& pair : outputs) {
+    differing_bits += (Aig::LiteralValue(words, pair.first) ^
+                       Aig::LiteralValue(words, pair.second)) &
+                      1;
+  }
+
+  // BuildAigMiter() creates the inputs in this order, least-significant bit
+  // first.
+  std::vector<std::string> lines = {
+      absl::StrCat("Simulation found ", differing_bits,
+                   " mismatching output bit(s) for inputs:")};
+  absl::flat_hash_set<const Node*> inputs;
+  for (const auto& pair : input_mapping_) {
+    inputs.insert(pair.first);
+  }
+  int64_t input_index = 0;
+  for (const Node* input : SetToIdSortedVector(inputs)) {
+    BitsRope rope(input->BitCountOrDie());
+    for (int64_t i = 0; i < input->BitCountOrDie(); ++i) {
+      rope.push_back(counterexample->at(input_index++));
+    }
+    lines.push_back(absl::StrCat(
+        "  ", input->GetName(), " = ",
+        rope.Build().ToString(FormatPreference::kHex,
+                              /*include_bit_count=*/true)));
+  }
+  return absl::StrJoin(lines, "\n");
+}
+
 std::string Lec::ResultToString() {
   std::vector<std::string> output;
   output.push_back(SolverResultToString(ctx(), solver_.value(),
@@ -338,27 +571,8 @@ absl::flat_hash_map<std::string, Z3_ast> Lec::FlattenNetlistInputs() {
         node->GetType(), translation, /*little_endian=*/true);
     std::reverse(bits.begin(), bits.end());
     for (int i = 0; i < bits.size(); i++) {
-      // We have a flat IR node that's our input; we need to find the matching
-      // cells and use their outputs.
-      std::string name;
-      if (bits.size() == 1) {
-        name = NodeToNetlistName(node, absl::nullopt);
-      } else {
-        name = NodeToNetlistName(node, i);
-      }
-
-      // Get the cell...
-      auto status_or_cell = module_->ResolveCell(name);
-      if (!status_or_cell.ok()) {
-        XLS_VLOG(3) << "Could not resolve input cell: " << name << "; skipping";
-        XLS_LOG(INFO) << "Could not resolve input cell: " << name
-                      << "; skipping";
-        continue;
-      }
-
-      // Then plop its output in.
-      for (const auto& output : status_or_cell.value()->outputs()) {
-        netlist_inputs[output.netref->name()] = bits[i];
+      for (NetRef net : GetNetlistInputNets(node, i, bits.size())) {
+        netlist_inputs[net->name()] = bits[i];
       }
     }
   }
@@ -366,6 +580,34 @@ absl::flat_hash_map<std::string, Z3_ast> Lec::FlattenNetlistInputs() {
   return netlist_inputs;
 }
 
+std::vector<NetRef> Lec::GetNetlistInputNets(const Node* node,
+                                             int64_t bit_index,
+                                             int64_t bit_count) {
+  // We have a flat IR node that's our input; we need to find the matching
+  // cells and use their outputs.
+  std::string name;
+  if (bit_count == 1) {
+    name = NodeToNetlistName(node, absl::nullopt);
+  } else {
+    name = NodeToNetlistName(node, bit_index);
+  }
+
+  // Get the cell...
+  auto status_or_cell = module_->ResolveCell(name);
+  if (!status_or_cell.ok()) {
+    XLS_VLOG(3) << "Could not resolve input cell: " << name << "; skipping";
+    XLS_LOG(INFO) << "Could not resolve input cell: " << name << "; skipping";
+    return {};
+  }
+
+  // Then collect its outputs.
+  std::vector<NetRef> nets;
+  for (const auto& output : status_or_cell.value()->outputs()) {
+    nets.push_back(output.netref);
+  }
+  return nets;
+}
+
 absl::StatusOr<std::vector<Z3_ast>> Lec::GetNetlistZ3ForIr(const Node* node) {
   std::vector<Z3_ast> netlist_output;
 
@@ -15,15 +15,21 @@
 #ifndef XLS_SOLVERS_Z3_LEC_H_
 #define XLS_SOLVERS_Z3_LEC_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "xls/ir/package.h"
 #include "xls/netlist/netlist.h"
 #include "xls/scheduling/pipeline_schedule.h"
+#include "xls/solvers/aig.h"
+#include "xls/solvers/z3_aig_sweeper.h"
 #include "xls/solvers/z3_ir_translator.h"
 #include "xls/solvers/z3_netlist_translator.h"
 
@@ -48,6 +54,22 @@ struct LecParams {
   std::string netlist_module_name;
 };
 
+// The result of checking a single output bit; see Lec::RunPerOutput().
+struct LecOutputResult {
+  // The name of the IR node producing the output.
+  std::string node_name;
+
+  // The index of the bit within the node's flattened value, where bit 0 is the
+  // least-significant bit.
+  int64_t bit_index;
+
+  // True if the IR and netlist values of the bit were proved equivalent.
+  bool equivalent;
+
+  // The time spent in the solver checking this bit.
+  absl::Duration duration;
+};
+
 // Class for performing logical equivalence checks between a function specified
 // in XLS IR (perhaps converted from DSLX) and a netlist.
 class Lec {
@@ -63,6 +85,20 @@ class Lec {
       const LecParams& params, const PipelineSchedule& schedule, int stage);
   ~Lec();
 
+  // Checks each output bit as an independent query instead of as a single
+  // miter over all outputs, so that small output cones are proved quickly and
+  // mismatches are reported per bit. The bits are distributed over
+  // "thread_count" workers (one per core if <= 0), each of which builds its
+  // own Lec - and thus its own Z3_context - from the given arguments. If
+  // "schedule" is set, only the given stage is checked, as in
+  // CreateForStage(). If "constraints" is non-null, it's applied to every
+  // query, as in AddConstraints().
+  // Results are returned in output order; bits not present in the netlist are
+  // not checked.
+  static absl::StatusOr<std::vector<LecOutputResult>> RunPerOutput(
+      const LecParams& params, absl::optional<PipelineSchedule> schedule,
+      int stage, Function* constraints, int thread_count);
+
   // Applies additional constraints (aside from the LEC itself), such as
   // restricting the input space.
   // This function must have the same signature as the function being compared
@@ -76,6 +112,39 @@ class Lec {
   // Returns true of the netlist and IR are proved to be equivalent.
   bool Run();
 
+  // Performs the same check as Run(), but by bit-blasting the IR and netlist
+  // into a shared and-inverter graph and SAT-sweeping it (see
+  // SweepAndCheckEquivalence()), so that Z3 only sees small internal
+  // equivalence queries and whatever remains of the miter afterwards. This
+  // scales to much larger designs than Run()'s single bit-vector query.
+  // Returns an UnimplementedError if the IR contains operations or types which
+  // can't be bit-blasted, or if constraints have been added; Run() can be used
+  // instead in those cases, and to obtain a counterexample if the check fails.
+  absl::StatusOr<AigSweepResult> RunWithSweeping(
+      const AigSweepOptions& options = AigSweepOptions());
+
+  // Performs the same check as Run() without Z3: the IR and netlist are
+  // bit-blasted as for RunWithSweeping() and the miter is converted to CNF
+  // for the embedded SatSolver. For control-dominated logic this is usually
+  // much faster than Z3's bit-vector theory, and uses far less memory. Returns
+  // true if the two are equivalent, a DeadlineExceededError on timeout, and
+  // the same errors for unsupported IR as RunWithSweeping().
+  absl::StatusOr<bool> RunWithSat(
+      absl::Duration timeout = absl::InfiniteDuration());
+
+  // Searches for a counterexample by simulating the bit-blasted IR and netlist
+  // (as for RunWithSat()) on corner-case inputs and "vector_count" random
+  // ones, over "thread_count" threads (one per core if <= 0). This is far
+  // cheaper than a proof and catches most mismatches, so it's worth running
+  // first. Returns a description of the mismatching inputs, or nullopt if none
+  // was found, which proves nothing. Returns the same errors for unsupported
+  // IR as RunWithSweeping().
+  absl::StatusOr<absl::optional<std::string>> FindCounterexampleBySimulation(
+      int64_t vector_count, int64_t thread_count = 0);
+
+  // Returns the number of output bits compared by this object.
+  int64_t output_bit_count() const { return output_bits_.size(); }
+
   // Dumps all Z3 values corresponding to IR nodes in the input function.
   void DumpIrTree();
 
@@ -88,7 +157,19 @@ class Lec {
   Lec(Package* ir_package, Function* ir_function,
       netlist::rtl::Netlist* netlist, const std::string& netlist_module_name,
       absl::optional<PipelineSchedule> schedule, int stage);
+  // An output bit present in both the IR and the netlist.
+  struct OutputBit {
+    const Node* node;
+    int64_t bit_index;
+    // The equality of the IR and netlist values of the bit.
+    Z3_ast eq;
+  };
+
   absl::Status Init();
+
+  // Checks the single output bit at the given index of output_bits_ in a
+  // solver scope which is discarded afterwards.
+  LecOutputResult CheckOutputBit(int64_t index);
   absl::Status CreateIrTranslator();
   absl::Status CreateNetlistTranslator();
 
@@ -113,6 +194,17 @@ class Lec {
   //  input_value_0_ will be the LSB.
   absl::flat_hash_map<std::string, Z3_ast> FlattenNetlistInputs();
 
+  // Returns the nets carrying the given bit of the input node - the outputs of
+  // its input cell - or an empty vector if the cell isn't in the netlist.
+  // Bit-blasts the IR and netlist into "aig", returning the pairs of literals
+  // of each compared output bit.
+  absl::StatusOr<std::vector<std::pair<AigLiteral, AigLiteral>>>
+  BuildAigMiter(Aig* aig);
+
+  std::vector<netlist::rtl::NetRef> GetNetlistInputNets(const Node* node,
+                                                        int64_t bit_index,
+                                                        int64_t bit_count);
+
   // The opposite of BindNetlistInputs - given the output nodes from the
   // stage, collect the corresponding NetRefs and use them to reconstruct
   // the composite output value.
@@ -151,9 +243,11 @@ class Lec {
   std::vector<const Node*> ir_output_nodes_;
   std::vector<Z3_ast> ir_outputs_;
   std::vector<Z3_ast> netlist_outputs_;
+  std::vector<OutputBit> output_bits_;
 
   absl::optional<PipelineSchedule> schedule_;
   int stage_;
+  bool has_constraints_ = false;
 
   // Z3 elements are, under the hood, void pointers, but let's respect the
   // interface and use absl::optional to determine live-ness.
@@ -18,6 +18,7 @@
 #include "gtest/gtest.h"
 #include "absl/status/statusor.h"
 #include "xls/common/status/matchers.h"
+#include "xls/common/status/ret_check.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/netlist/cell_library.h"
 #include "xls/netlist/fake_cell_library.h"
@@ -52,7 +53,22 @@ absl::StatusOr<bool> Match(const std::string& ir_text,
   params.netlist_module_name = "main";
 
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Lec> lec, Lec::Create(params));
-  return lec->Run();
+  bool equal = lec->Run();
+
+  // SAT sweeping and the CNF backend must reach the same verdict.
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Lec> aig_lec, Lec::Create(params));
+  XLS_ASSIGN_OR_RETURN(AigSweepResult sweep_result, aig_lec->RunWithSweeping());
+  XLS_RET_CHECK_EQ(sweep_result.equivalent, equal);
+  XLS_ASSIGN_OR_RETURN(bool sat_equal, aig_lec->RunWithSat());
+  XLS_RET_CHECK_EQ(sat_equal, equal);
+
+  // Simulation can't prove equivalence, but all of these small mismatches are
+  // found by the corner cases alone.
+  XLS_ASSIGN_OR_RETURN(
+      absl::optional<std::string> counterexample,
+      aig_lec->FindCounterexampleBySimulation(/*vector_count=*/0));
+  XLS_RET_CHECK_EQ(counterexample.has_value(), !equal);
+  return equal;
 }
 
 // This test verifies that we can do a simple LEC.
@@ -463,6 +479,71 @@ endmodule
   }
 }
 
+// Verifies that per-output LEC reports exactly the mismatching output bit.
+TEST(Z3LecTest, PerOutputLec) {
+  std::string ir_text = R"(
+package p
+
+fn main(input: bits[4]) -> bits[4] {
+  ret not.2: bits[4] = not(input)
+}
+)";
+
+  std::string netlist_text = R"(
+module main ( clk, input_3_, input_2_, input_1_, input_0_, out_3_, out_2_, out_1_, out_0_);
+  input clk, input_3_, input_2_, input_1_, input_0_;
+  output out_3_, out_2_, out_1_, out_0_;
+  wire p0_input_3_, p0_input_2_, p0_input_1_, p0_input_0_,
+       p0_not_2_comb_3_, p0_not_2_comb_2_, p0_not_2_comb_1_, p0_not_2_comb_0_;
+
+  DFF p0_input_reg_3_ ( .D(input_3_), .CLK(clk), .Q(p0_input_3_) );
+  DFF p0_input_reg_2_ ( .D(input_2_), .CLK(clk), .Q(p0_input_2_) );
+  DFF p0_input_reg_1_ ( .D(input_1_), .CLK(clk), .Q(p0_input_1_) );
+  DFF p0_input_reg_0_ ( .D(input_0_), .CLK(clk), .Q(p0_input_0_) );
+
+  INV p0_not_2_3_ ( .A(p0_input_3_), .ZN(p0_not_2_comb_3_) );
+  INV p0_not_2_2_ ( .A(p0_input_2_), .ZN(p0_not_2_comb_2_) );
+  OR  p0_not_2_1_ ( .A(p0_input_1_), .B(p0_input_1_), .Z(p0_not_2_comb_1_) );
+  INV p0_not_2_0_ ( .A(p0_input_0_), .ZN(p0_not_2_comb_0_) );
+
+  DFF p0_not_2_reg_3_ (.D(p0_not_2_comb_3_), .CLK(clk), .Q(out_3_));
+  DFF p0_not_2_reg_2_ (.D(p0_not_2_comb_2_), .CLK(clk), .Q(out_2_));
+  DFF p0_not_2_reg_1_ (.D(p0_not_2_comb_1_), .CLK(clk), .Q(out_1_));
+  DFF p0_not_2_reg_0_ (.D(p0_not_2_comb_0_), .CLK(clk), .Q(out_0_));
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry_function,
+                           package->EntryFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  params.ir_package = package.get();
+  params.ir_function = entry_function;
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  for (int thread_count : {1, 3}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::vector<LecOutputResult> results,
+        Lec::RunPerOutput(params, /*schedule=*/absl::nullopt, /*stage=*/0,
+                          /*constraints=*/nullptr, thread_count));
+    ASSERT_EQ(results.size(), 4);
+    for (int i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].node_name, "not.2");
+      EXPECT_EQ(results[i].bit_index, 3 - i);
+      EXPECT_EQ(results[i].equivalent, results[i].bit_index != 1);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace z3
 }  // namespace solvers
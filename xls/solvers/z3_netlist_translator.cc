@@ -18,6 +18,7 @@
 
 #include "absl/flags/flag.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
 #include "xls/common/logging/logging.h"
@@ -185,81 +186,149 @@ absl::Status NetlistTranslator::Translate() {
 }
 
 absl::Status NetlistTranslator::TranslateCell(const Cell& cell) {
-  using netlist::function::Ast;
-
   // If this cell is actually a reference to a module defined in this netlist,
   // then translate it into Z3-space here and grab its output nodes.
   std::string entry_name = cell.cell_library_entry()->name();
   if (module_refs_.contains(entry_name)) {
-    absl::flat_hash_map<std::string, Z3_ast> inputs;
-    for (const auto& input : cell.inputs()) {
-      inputs[input.name] = translated_[input.netref];
-    }
+    return TranslateModuleRef(cell, module_refs_.at(entry_name));
+  }
+
+  // Netlists hold many instances of few cell types, so each type is translated
+  // once and its instances are made by substituting their inputs.
+  XLS_ASSIGN_OR_RETURN(CellTemplate * cell_template, GetCellTemplate(cell));
+  std::vector<Z3_ast> placeholders;
+  std::vector<Z3_ast> inputs;
+  for (const auto& input : cell.inputs()) {
+    XLS_RET_CHECK(cell_template->inputs.contains(input.name)) << input.name;
+    placeholders.push_back(cell_template->inputs.at(input.name));
+    inputs.push_back(translated_.at(input.netref));
+  }
+  for (const auto& output : cell.outputs()) {
+    XLS_ASSIGN_OR_RETURN(Z3_ast result,
+                         GetOutputTemplate(cell, cell_template, output.name));
+    translated_[output.netref] = Z3_substitute(
+        ctx_, result, placeholders.size(), placeholders.data(), inputs.data());
+  }
+
+  return absl::OkStatus();
+}
 
-    const Module* module_ref = module_refs_.at(entry_name);
+absl::Status NetlistTranslator::TranslateModuleRef(const Cell& cell,
+                                                   const Module* module_ref) {
+  // The referenced module is translated once, in terms of its own input
+  // symbols, which are then bound to the inputs of each instance.
+  auto it = subtranslators_.find(module_ref->name());
+  if (it == subtranslators_.end()) {
     XLS_ASSIGN_OR_RETURN(
         auto subtranslator,
         NetlistTranslator::CreateAndTranslate(ctx_, module_ref, module_refs_));
+    it = subtranslators_.emplace(module_ref->name(), std::move(subtranslator))
+             .first;
+  }
+  NetlistTranslator* subtranslator = it->second.get();
+
+  std::vector<Z3_ast> module_inputs;
+  std::vector<Z3_ast> inputs;
+  for (const auto& input : cell.inputs()) {
+    XLS_ASSIGN_OR_RETURN(NetRef module_input,
+                         module_ref->ResolveNet(input.name));
+    XLS_ASSIGN_OR_RETURN(Z3_ast symbol,
+                         subtranslator->GetTranslation(module_input));
+    // Inputs the subtranslator fixed to constants (e.g. "clk") stay fixed.
+    if (Z3_get_ast_kind(ctx_, symbol) != Z3_APP_AST ||
+        Z3_get_decl_kind(ctx_, Z3_get_app_decl(ctx_, Z3_to_app(
+                                   ctx_, symbol))) != Z3_OP_UNINTERPRETED) {
+      continue;
+    }
+    module_inputs.push_back(symbol);
+    inputs.push_back(translated_.at(input.netref));
+  }
 
-    // Now match the module outputs to the corresponding netref in this module's
-    // corresponding cell.
-    for (const auto& module_output : module_ref->outputs()) {
-      XLS_ASSIGN_OR_RETURN(Z3_ast translation,
-                           subtranslator->GetTranslation(module_output));
-      for (const auto& cell_output : cell.outputs()) {
-        if (cell_output.name == module_output->name()) {
-          if (translated_.contains(cell_output.netref)) {
-            XLS_LOG(INFO) << "Skipping translation of "
-                          << cell_output.netref->name()
-                          << "; already translated.";
-          } else {
-            translated_[cell_output.netref] = translation;
-          }
-          break;
+  // Now match the module outputs to the corresponding netref in this module's
+  // corresponding cell.
+  for (const auto& module_output : module_ref->outputs()) {
+    XLS_ASSIGN_OR_RETURN(Z3_ast translation,
+                         subtranslator->GetTranslation(module_output));
+    for (const auto& cell_output : cell.outputs()) {
+      if (cell_output.name == module_output->name()) {
+        if (translated_.contains(cell_output.netref)) {
+          XLS_LOG(INFO) << "Skipping translation of "
+                        << cell_output.netref->name()
+                        << "; already translated.";
+        } else {
+          translated_[cell_output.netref] =
+              Z3_substitute(ctx_, translation, module_inputs.size(),
+                            module_inputs.data(), inputs.data());
         }
+        break;
       }
     }
-    return absl::OkStatus();
   }
+  return absl::OkStatus();
+}
 
+absl::StatusOr<NetlistTranslator::CellTemplate*>
+NetlistTranslator::GetCellTemplate(const Cell& cell) {
   const CellLibraryEntry* entry = cell.cell_library_entry();
-  absl::flat_hash_map<std::string, Z3_ast> state_table_values;
-  if (entry->state_table()) {
-    XLS_ASSIGN_OR_RETURN(state_table_values, TranslateStateTable(cell));
+  auto it = cell_templates_.find(entry);
+  if (it != cell_templates_.end()) {
+    return &it->second;
   }
 
-  const CellLibraryEntry::OutputPinToFunction& pins =
-      entry->output_pin_to_function();
-  for (const auto& output : cell.outputs()) {
-    XLS_ASSIGN_OR_RETURN(Ast ast, netlist::function::Parser::ParseFunction(
-                                      pins.at(output.name)));
-    XLS_ASSIGN_OR_RETURN(Z3_ast result,
-                         TranslateFunction(cell, ast, state_table_values));
-    translated_[output.netref] = result;
+  CellTemplate cell_template;
+  Z3_sort bit_sort = Z3_mk_bv_sort(ctx_, 1);
+  for (const std::string& input_name : entry->input_names()) {
+    cell_template.inputs[input_name] = Z3_mk_fresh_const(
+        ctx_, absl::StrCat(entry->name(), ".", input_name).c_str(), bit_sort);
+  }
+  if (entry->state_table()) {
+    XLS_ASSIGN_OR_RETURN(cell_template.state_table_values,
+                         TranslateStateTable(cell, cell_template.inputs));
   }
+  return &cell_templates_.emplace(entry, std::move(cell_template))
+              .first->second;
+}
 
-  return absl::OkStatus();
+absl::StatusOr<Z3_ast> NetlistTranslator::GetOutputTemplate(
+    const Cell& cell, CellTemplate* cell_template,
+    const std::string& output_name) {
+  auto it = cell_template->outputs.find(output_name);
+  if (it != cell_template->outputs.end()) {
+    return it->second;
+  }
+  const CellLibraryEntry::OutputPinToFunction& pins =
+      cell.cell_library_entry()->output_pin_to_function();
+  XLS_ASSIGN_OR_RETURN(Ast ast, netlist::function::Parser::ParseFunction(
+                                    pins.at(output_name)));
+  XLS_ASSIGN_OR_RETURN(
+      Z3_ast result,
+      TranslateFunction(cell, ast, cell_template->inputs,
+                        cell_template->state_table_values));
+  cell_template->outputs[output_name] = result;
+  return result;
 }
 
 // After all the above, this is the spot where any _ACTUAL_ translation happens.
 absl::StatusOr<Z3_ast> NetlistTranslator::TranslateFunction(
     const Cell& cell, netlist::function::Ast ast,
+    const absl::flat_hash_map<std::string, Z3_ast>& pin_values,
     const absl::flat_hash_map<std::string, Z3_ast>& state_table_values) {
   switch (ast.kind()) {
     case Ast::Kind::kAnd: {
       XLS_ASSIGN_OR_RETURN(
           Z3_ast lhs,
-          TranslateFunction(cell, ast.children()[0], state_table_values));
+          TranslateFunction(cell, ast.children()[0], pin_values,
+                            state_table_values));
       XLS_ASSIGN_OR_RETURN(
           Z3_ast rhs,
-          TranslateFunction(cell, ast.children()[1], state_table_values));
+          TranslateFunction(cell, ast.children()[1], pin_values,
+                            state_table_values));
       return Z3_mk_bvand(ctx_, lhs, rhs);
     }
     case Ast::Kind::kIdentifier: {
-      for (const auto& input : cell.inputs()) {
-        if (input.name == ast.name()) {
-          return translated_.at(input.netref);
-        }
+      auto it = pin_values.find(ast.name());
+      if (it != pin_values.end()) {
+        return it->second;
       }
 
       if (state_table_values.contains(ast.name())) {
@@ -279,25 +348,30 @@ absl::StatusOr<Z3_ast> NetlistTranslator::TranslateFunction(
     case Ast::Kind::kNot: {
       XLS_ASSIGN_OR_RETURN(
           Z3_ast child,
-          TranslateFunction(cell, ast.children()[0], state_table_values));
+          TranslateFunction(cell, ast.children()[0], pin_values,
+                            state_table_values));
       return Z3_mk_bvnot(ctx_, child);
     }
     case Ast::Kind::kOr: {
       XLS_ASSIGN_OR_RETURN(
           Z3_ast lhs,
-          TranslateFunction(cell, ast.children()[0], state_table_values));
+          TranslateFunction(cell, ast.children()[0], pin_values,
+                            state_table_values));
       XLS_ASSIGN_OR_RETURN(
           Z3_ast rhs,
-          TranslateFunction(cell, ast.children()[1], state_table_values));
+          TranslateFunction(cell, ast.children()[1], pin_values,
+                            state_table_values));
       return Z3_mk_bvor(ctx_, lhs, rhs);
     }
     case Ast::Kind::kXor: {
       XLS_ASSIGN_OR_RETURN(
           Z3_ast lhs,
-          TranslateFunction(cell, ast.children()[0], state_table_values));
+          TranslateFunction(cell, ast.children()[0], pin_values,
+                            state_table_values));
       XLS_ASSIGN_OR_RETURN(
           Z3_ast rhs,
-          TranslateFunction(cell, ast.children()[1], state_table_values));
+          TranslateFunction(cell, ast.children()[1], pin_values,
+                            state_table_values));
       return Z3_mk_bvxor(ctx_, lhs, rhs);
     }
     default:
@@ -307,20 +381,11 @@ absl::StatusOr<Z3_ast> NetlistTranslator::TranslateFunction(
 }
 
 absl::StatusOr<absl::flat_hash_map<std::string, Z3_ast>>
-NetlistTranslator::TranslateStateTable(const Cell& cell) {
+NetlistTranslator::TranslateStateTable(
+    const Cell& cell,
+    const absl::flat_hash_map<std::string, Z3_ast>& pin_values) {
   const StateTable& table = cell.cell_library_entry()->state_table().value();
 
-  auto get_pin_netref =
-      [](const absl::Span<const Cell::Pin>& pins,
-         const std::string& pin_name) -> absl::StatusOr<NetRef> {
-    for (const auto& pin : pins) {
-      if (pin.name == pin_name) {
-        return pin.netref;
-      }
-    }
-    return absl::NotFoundError(absl::StrCat("Couldn't find pin: ", pin_name));
-  };
-
   Z3_ast one = Z3_mk_int(ctx_, 1, Z3_mk_bv_sort(ctx_, 1));
   Z3_ast zero = Z3_mk_int(ctx_, 0, Z3_mk_bv_sort(ctx_, 1));
   // Simple pair of a combined stimulus value to an output value; essentially
@@ -345,11 +410,13 @@ NetlistTranslator::TranslateStateTable(const Cell& cell) {
         continue;
       }
 
-      XLS_ASSIGN_OR_RETURN(NetRef input_ref,
-                           get_pin_netref(cell.inputs(), input_name));
-      XLS_RET_CHECK(translated_.contains(input_ref));
+      auto pin_value = pin_values.find(input_name);
+      if (pin_value == pin_values.end()) {
+        return absl::NotFoundError(
+            absl::StrCat("Couldn't find pin: ", input_name));
+      }
       stimulus.push_back(
-          Z3_mk_eq(ctx_, translated_[input_ref],
+          Z3_mk_eq(ctx_, pin_value->second,
                    signal == StateTableSignal::kHigh ? one : zero));
     }
 
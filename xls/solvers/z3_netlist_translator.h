@@ -82,14 +82,38 @@ class NetlistTranslator {
           module_refs);
   absl::Status Init();
 
+  // The translation of a cell library entry, shared by all of its instances.
+  // Its outputs are in terms of placeholder constants for its input pins;
+  // each instance substitutes the translations of its input nets for them.
+  struct CellTemplate {
+    // Input pin name to placeholder.
+    absl::flat_hash_map<std::string, Z3_ast> inputs;
+    absl::flat_hash_map<std::string, Z3_ast> state_table_values;
+    // Output pin name to translation, filled in as the pins are used.
+    absl::flat_hash_map<std::string, Z3_ast> outputs;
+  };
+
   // Translates the module, cell, or cell function, respectively, into Z3-space.
+  // Cell functions are translated with the given values of the cell's input
+  // pins, by name.
   absl::Status Translate();
   absl::Status TranslateCell(const netlist::rtl::Cell& cell);
+  absl::Status TranslateModuleRef(const netlist::rtl::Cell& cell,
+                                  const netlist::rtl::Module* module_ref);
   absl::StatusOr<Z3_ast> TranslateFunction(
       const netlist::rtl::Cell& cell, const netlist::function::Ast ast,
+      const absl::flat_hash_map<std::string, Z3_ast>& pin_values,
       const absl::flat_hash_map<std::string, Z3_ast>& state_table_values);
   absl::StatusOr<absl::flat_hash_map<std::string, Z3_ast>> TranslateStateTable(
-      const netlist::rtl::Cell& cell);
+      const netlist::rtl::Cell& cell,
+      const absl::flat_hash_map<std::string, Z3_ast>& pin_values);
+
+  // Returns the template of the cell's library entry, creating it if needed,
+  // and the translation of the given output pin in it.
+  absl::StatusOr<CellTemplate*> GetCellTemplate(const netlist::rtl::Cell& cell);
+  absl::StatusOr<Z3_ast> GetOutputTemplate(const netlist::rtl::Cell& cell,
+                                           CellTemplate* cell_template,
+                                           const std::string& output_name);
 
   Z3_context ctx_;
   const netlist::rtl::Module* module_;
@@ -99,6 +123,13 @@ class NetlistTranslator {
 
   const absl::flat_hash_map<std::string, const netlist::rtl::Module*>
       module_refs_;
+
+  // Translations of cell library entries, and of the modules referenced by
+  // cells, each created on first use.
+  absl::flat_hash_map<const netlist::CellLibraryEntry*, CellTemplate>
+      cell_templates_;
+  absl::flat_hash_map<std::string, std::unique_ptr<NetlistTranslator>>
+      subtranslators_;
 };
 
 }  // namespace z3
@@ -539,6 +539,43 @@ endmodule)";
   ASSERT_TRUE(IsSatisfiable(Z3_mk_eq(ctx_, module_output, value_1)));
 }
 
+// Verifies that instances of the same cell type, which share one translation of
+// the cell's function, are each bound to their own inputs.
+TEST_F(NetlistTranslatorTest, InstancesOfSameCell) {
+  std::string module_text = R"(
+module main (i0, i1, i2, o0, o1);
+  input i0, i1, i2;
+  output o0, o1;
+  wire t;
+
+  AND and_0 ( .A(i0), .B(i1), .Z(t) );
+  AND and_1 ( .A(t), .B(i2), .Z(o0) );
+  INV inv_0 ( .A(t), .ZN(o1) );
+endmodule)";
+  XLS_ASSERT_OK(Init(module_text));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Z3_ast o0,
+                           translator_->GetTranslation(module_->outputs()[0]));
+  std::string ast_text = Z3_ast_to_string(ctx_, o0);
+  EXPECT_NE(ast_text.find("bvand (bvand i0 i1) i2"), std::string::npos)
+      << ast_text;
+
+  Z3_sort bit_sort = Z3_mk_bv_sort(ctx_, 1);
+  Z3_ast value_0 = Z3_mk_int(ctx_, 0, bit_sort);
+  Z3_ast value_1 = Z3_mk_int(ctx_, 1, bit_sort);
+  XLS_ASSERT_OK(translator_->Retranslate({
+      {"i0", value_1},
+      {"i1", value_1},
+      {"i2", value_0},
+  }));
+  XLS_ASSERT_OK_AND_ASSIGN(o0,
+                           translator_->GetTranslation(module_->outputs()[0]));
+  XLS_ASSERT_OK_AND_ASSIGN(Z3_ast o1,
+                           translator_->GetTranslation(module_->outputs()[1]));
+  EXPECT_FALSE(IsSatisfiable(Z3_mk_eq(ctx_, o0, value_1)));
+  EXPECT_FALSE(IsSatisfiable(Z3_mk_eq(ctx_, o1, value_1)));
+}
+
 // This test verifies that a state-table-containing-cell-containing netlist is
 // properly handled - i.e., that we properly translate into Z3 when a state
 // table is present.
@@ -75,6 +75,19 @@ class DummySynthesisServiceImpl : public SynthesisService::Service {
     return ::grpc::Status::OK;
   }
 
+  ::grpc::Status BatchCompile(::grpc::ServerContext* server_context,
+                              const BatchCompileRequest* request,
+                              BatchCompileResponse* result) override {
+    for (const CompileRequest& compile_request : request->requests()) {
+      ::grpc::Status status =
+          Compile(server_context, &compile_request, result->add_responses());
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return ::grpc::Status::OK;
+  }
+
  private:
   int64_t max_frequency_hz_;
   bool serve_errors_;
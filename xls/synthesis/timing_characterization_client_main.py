@@ -22,7 +22,7 @@ format.
 
 import itertools
 
-from typing import Sequence
+from typing import List, Sequence, Tuple
 
 from absl import app
 from absl import flags
@@ -75,39 +75,46 @@ def get_bit_widths():
   return [1] + list(range(2, FLAGS.max_width + 1, 2))
 
 
-def _synth(stub: synthesis_service_pb2_grpc.SynthesisServiceStub,
-           verilog_text: str,
-           top_module_name: str) -> synthesis_pb2.CompileResponse:
-  request = synthesis_pb2.CompileRequest()
-  request.module_text = verilog_text
-  request.top_module_name = top_module_name
+def _synthesize_ir(
+    stub: synthesis_service_pb2_grpc.SynthesisServiceStub, op: str,
+    samples: Sequence[Tuple[str, int, Sequence[int]]]
+) -> List[delay_model_pb2.DataPoint]:
+  """Synthesizes the given IR samples in one batch and returns data points.
+
+  Args:
+    stub: The synthesis service to use.
+    op: The op being characterized.
+    samples: Tuples of (IR text, result bit count, operand bit counts), one per
+      data point.
+
+  Returns:
+    The data points, in the order of the samples.
+  """
+  module_name = 'top'
+  request = synthesis_pb2.BatchCompileRequest()
+  for ir_text, _, _ in samples:
+    mod_generator_result = op_module_generator.generate_verilog_module(
+        module_name, ir_text)
+    compile_request = request.requests.add()
+    compile_request.module_text = mod_generator_result.verilog_text
+    compile_request.top_module_name = module_name
   logging.vlog(3, '--- Request')
   logging.vlog(3, request)
 
-  return stub.Compile(request)
-
-
-def _synthesize_ir(
-    stub: synthesis_service_pb2_grpc.SynthesisServiceStub,
-    ir_text: str,
-    op: str,
-    result_bit_count: int,
-    operand_bit_counts=Sequence[int]) -> delay_model_pb2.DataPoint:
-  """Synthesis the given IR text and return a data point."""
-  module_name = 'top'
-  mod_generator_result = op_module_generator.generate_verilog_module(
-      module_name, ir_text)
-  verilog_text = mod_generator_result.verilog_text
-  result = _synth(stub, verilog_text, module_name)
-  ps = 1e12 / result.max_frequency_hz
-  result = delay_model_pb2.DataPoint()
-  result.operation.op = op
-  result.operation.bit_count = result_bit_count
-  for bit_count in operand_bit_counts:
-    operand = result.operation.operands.add()
-    operand.bit_count = bit_count
-  result.delay = int(ps)
-  return result
+  response = stub.BatchCompile(request)
+  results = []
+  for (_, result_bit_count, operand_bit_counts), compile_response in zip(
+      samples, response.responses):
+    ps = 1e12 / compile_response.max_frequency_hz
+    result = delay_model_pb2.DataPoint()
+    result.operation.op = op
+    result.operation.bit_count = result_bit_count
+    for bit_count in operand_bit_counts:
+      operand = result.operation.operands.add()
+      operand.bit_count = bit_count
+    result.delay = int(ps)
+    results.append(result)
+  return results
 
 
 def _run_unary_bitwise(
@@ -123,13 +130,12 @@ def _run_unary_bitwise(
   op = ENUM2NAME_MAP[op]
 
   # Compute samples
-  results = []
+  samples = []
   for bit_count in get_bit_widths():
     op_type = f'bits[{bit_count}]'
     ir_text = op_module_generator.generate_ir_package(op, op_type, (op_type,))
-    result = _synthesize_ir(stub, ir_text, op, bit_count, (bit_count,))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, bit_count, (bit_count,)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_variadic_bitwise(
@@ -148,14 +154,13 @@ def _run_variadic_bitwise(
   widths = get_bit_widths()
   arity = list(range(2, 8))
   combs = itertools.product(widths, arity)
-  results = []
+  samples = []
   for bit_count, arity in combs:
     op_type = f'bits[{bit_count}]'
     ir_text = op_module_generator.generate_ir_package(op, op_type,
                                                       (op_type,) * arity)
-    result = _synthesize_ir(stub, ir_text, op, bit_count, (bit_count,) * arity)
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, bit_count, (bit_count,) * arity))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_arithmetic_unary(
@@ -170,13 +175,12 @@ def _run_arithmetic_unary(
 
   op = ENUM2NAME_MAP[op]
 
-  results = []
+  samples = []
   for bit_count in get_bit_widths():
     op_type = f'bits[{bit_count}]'
     ir_text = op_module_generator.generate_ir_package(op, op_type, (op_type,))
-    result = _synthesize_ir(stub, ir_text, op, bit_count, (bit_count,))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, bit_count, (bit_count,)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_arithmetic_binary(
@@ -191,15 +195,13 @@ def _run_arithmetic_binary(
 
   op = ENUM2NAME_MAP[op]
 
-  results = []
+  samples = []
   for bit_count in get_bit_widths():
     op_type = f'bits[{bit_count}]'
     ir_text = op_module_generator.generate_ir_package(op, op_type,
                                                       (op_type, op_type))
-    result = _synthesize_ir(stub, ir_text, op, bit_count,
-                            (bit_count, bit_count))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, bit_count, (bit_count, bit_count)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_comparison(
@@ -214,15 +216,14 @@ def _run_comparison(
 
   op = ENUM2NAME_MAP[op]
 
-  results = []
+  samples = []
   for bit_count in get_bit_widths():
     op_type = f'bits[{bit_count}]'
     ret_type = 'bits[1]'
     ir_text = op_module_generator.generate_ir_package(op, ret_type,
                                                       (op_type, op_type))
-    result = _synthesize_ir(stub, ir_text, op, 1, (bit_count, bit_count))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, 1, (bit_count, bit_count)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_shift(op: str, model: delay_model_pb2.DelayModel,
@@ -237,14 +238,13 @@ def _run_shift(op: str, model: delay_model_pb2.DelayModel,
   op = ENUM2NAME_MAP[op]
 
   # Compute samples
-  results = []
+  samples = []
   for bit_count in get_bit_widths():
     op_type = f'bits[{bit_count}]'
     ir_text = op_module_generator.generate_ir_package(op, op_type,
                                                       (op_type, op_type))
-    result = _synthesize_ir(stub, ir_text, op, bit_count, (bit_count,))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, bit_count, (bit_count,)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_extension(
@@ -262,15 +262,14 @@ def _run_extension(
   # Compute samples
   widths = get_bit_widths()
   combs = filter(lambda b: b[1] > b[0], itertools.product(widths, widths))
-  results = []
+  samples = []
   for bit_count, new_bit_count in combs:
     op_type = f'bits[{bit_count}]'
     ret_type = f'bits[{new_bit_count}]'
     ir_text = op_module_generator.generate_ir_package(
         op, ret_type, (op_type,), attributes=[('new_bit_count', new_bit_count)])
-    result = _synthesize_ir(stub, ir_text, op, new_bit_count, (bit_count, 64))
-    results.append(result)
-  model.data_points.extend(results)
+    samples.append((ir_text, new_bit_count, (bit_count, 64)))
+  model.data_points.extend(_synthesize_ir(stub, op, samples))
 
 
 def _run_miscellaneous(
@@ -12,15 +12,28 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "grpcpp/grpcpp.h"
 #include "grpcpp/security/server_credentials.h"
 #include "grpcpp/server.h"
 #include "grpcpp/server_builder.h"
 #include "grpcpp/server_context.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/temp_directory.h"
@@ -31,6 +44,7 @@
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/subprocess.h"
+#include "xls/common/thread.h"
 #include "xls/synthesis/server_credentials.h"
 #include "xls/synthesis/synthesis.pb.h"
 #include "xls/synthesis/synthesis_service.grpc.pb.h"
@@ -55,6 +69,14 @@ ABSL_FLAG(bool, synthesis_only, false,
           "Perform synthesis but not place and route");
 ABSL_FLAG(bool, return_netlist, true,
           "Return the netlist generated by synthesis");
+ABSL_FLAG(int32_t, max_concurrent_jobs, 0,
+          "Maximum number of synthesis jobs to run at once; further requests "
+          "are queued in arrival order. If zero, the number of hardware "
+          "threads is used.");
+ABSL_FLAG(int64_t, cache_size, 1024,
+          "Maximum number of synthesis results to cache. Requests identical to "
+          "a cached one are answered without running synthesis. Zero disables "
+          "the cache.");
 
 namespace xls {
 namespace synthesis {
@@ -64,37 +86,107 @@ class YosysSynthesisServiceImpl : public SynthesisService::Service {
  public:
   explicit YosysSynthesisServiceImpl(absl::string_view yosys_path,
                                      absl::string_view nextpnr_path,
-                                     absl::string_view synthesis_target)
+                                     absl::string_view synthesis_target,
+                                     int64_t max_concurrent_jobs,
+                                     int64_t cache_size)
       : yosys_path_(yosys_path),
         nextpnr_path_(nextpnr_path),
-        synthesis_target_(synthesis_target) {}
+        synthesis_target_(synthesis_target),
+        max_concurrent_jobs_(max_concurrent_jobs),
+        cache_size_(cache_size) {}
 
   ::grpc::Status Compile(::grpc::ServerContext* server_context,
                          const CompileRequest* request,
                          CompileResponse* result) override {
-    auto start = absl::Now();
-
-    absl::Status synthesis_status = RunSynthesis(request, result);
-    if (!synthesis_status.ok()) {
+    absl::Status status = CompileWithCache(request, result);
+    if (!status.ok()) {
       return ::grpc::Status(grpc::StatusCode::INTERNAL,
-                            std::string(synthesis_status.message()));
+                            std::string(status.message()));
     }
+    return ::grpc::Status::OK;
+  }
 
-    result->set_elapsed_runtime_ms(
-        absl::ToInt64Milliseconds(absl::Now() - start));
-
+  // Compiles the requests on up to max_concurrent_jobs_ threads. Each request
+  // still goes through the cache and the worker queue, so concurrent batches
+  // share the workers fairly.
+  ::grpc::Status BatchCompile(::grpc::ServerContext* server_context,
+                              const BatchCompileRequest* request,
+                              BatchCompileResponse* result) override {
+    int64_t request_count = request->requests_size();
+    for (int64_t i = 0; i < request_count; ++i) {
+      result->add_responses();
+    }
+    std::vector<absl::Status> statuses(request_count);
+    std::atomic<int64_t> next_request{0};
+    std::vector<std::unique_ptr<Thread>> threads;
+    int64_t thread_count = std::min(request_count, max_concurrent_jobs_);
+    for (int64_t i = 0; i < thread_count; ++i) {
+      threads.push_back(absl::make_unique<Thread>([&]() {
+        for (int64_t j = next_request++; j < request_count;
+             j = next_request++) {
+          statuses[j] = CompileWithCache(&request->requests(j),
+                                         result->mutable_responses(j));
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+    for (int64_t i = 0; i < request_count; ++i) {
+      if (!statuses[i].ok()) {
+        return ::grpc::Status(
+            grpc::StatusCode::INTERNAL,
+            absl::StrFormat("Request %d (%s): %s", i,
+                            request->requests(i).top_module_name(),
+                            statuses[i].message()));
+      }
+    }
     return ::grpc::Status::OK;
   }
 
+  // Answers the request from the result cache if possible, and otherwise
+  // waits for a free worker slot and runs synthesis, caching the result.
+  absl::Status CompileWithCache(const CompileRequest* request,
+                                CompileResponse* result) {
+    std::string key = CacheKey(*request);
+    if (LookupCache(key, result)) {
+      result->set_queue_time_ms(0);
+      result->set_cache_hit(true);
+      XLS_LOG(INFO) << "Cache hit for " << request->top_module_name();
+      return absl::OkStatus();
+    }
+
+    absl::Time enqueued = absl::Now();
+    AcquireWorker();
+    absl::Time start = absl::Now();
+    absl::Status synthesis_status = RunSynthesis(request, result);
+    ReleaseWorker();
+    absl::Time end = absl::Now();
+    XLS_RETURN_IF_ERROR(synthesis_status);
+
+    result->set_elapsed_runtime_ms(absl::ToInt64Milliseconds(end - start));
+    result->set_queue_time_ms(absl::ToInt64Milliseconds(start - enqueued));
+    result->set_cache_hit(false);
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "Synthesized %s: queued %dms, ran %dms", request->top_module_name(),
+        result->queue_time_ms(), result->elapsed_runtime_ms());
+    InsertIntoCache(key, *result);
+    return absl::OkStatus();
+  }
+
   // Run the given arguments as a subprocess with InvokeSubprocess.
   // InvokeSubprocess is wrapped because the error message can be very large (it
   // includes both stdout and stderr) which breaks propagation of the error via
   // GRPC because GRPC instead gives an error about trailing metadata being too
-  // large.
+  // large. A Cancelled error is returned unchanged.
   absl::StatusOr<std::pair<std::string, std::string>> RunSubprocess(
-      absl::Span<const std::string> args) {
+      absl::Span<const std::string> args,
+      const std::atomic<bool>* cancel = nullptr) {
     absl::StatusOr<std::pair<std::string, std::string>> stdout_stderr_status =
-        InvokeSubprocess(args);
+        InvokeSubprocess(args, /*cwd=*/"", cancel);
+    if (absl::IsCancelled(stdout_stderr_status.status())) {
+      return stdout_stderr_status.status();
+    }
     if (!stdout_stderr_status.ok()) {
       XLS_LOG(ERROR) << stdout_stderr_status.status();
       const int64_t kMaxMessageSize = 1024;
@@ -166,7 +258,37 @@ class YosysSynthesisServiceImpl : public SynthesisService::Service {
       return absl::OkStatus();
     }
 
-    // Invoke nextpnr for place and route.
+    if (request->place_and_route_seed_count() > 1) {
+      return RunPlaceAndRouteSeeds(request, netlist_path, temp_dir_path,
+                                   result);
+    }
+    XLS_ASSIGN_OR_RETURN(
+        PlaceAndRouteResult pnr,
+        RunPlaceAndRoute(request, netlist_path, temp_dir_path,
+                         /*seed=*/absl::nullopt, /*cancel=*/nullptr));
+    if (pnr.place_and_route_result.has_value()) {
+      result->set_place_and_route_result(*pnr.place_and_route_result);
+    }
+    result->set_max_frequency_hz(pnr.max_frequency_hz);
+    return absl::OkStatus();
+  }
+
+ private:
+  struct PlaceAndRouteResult {
+    int64_t max_frequency_hz;
+    // The contents of the place-and-route result file, if the target produces
+    // one.
+    absl::optional<std::string> place_and_route_result;
+  };
+
+  // Invokes nextpnr on the netlist, with the given placement seed if any.
+  // Returns a Cancelled error if 'cancel' becomes true before nextpnr is done.
+  absl::StatusOr<PlaceAndRouteResult> RunPlaceAndRoute(
+      const CompileRequest* request, const std::filesystem::path& netlist_path,
+      const std::filesystem::path& temp_dir_path, absl::optional<int64_t> seed,
+      const std::atomic<bool>* cancel) {
+    // Concurrent runs must not share output files.
+    std::string suffix = seed.has_value() ? absl::StrCat("_", *seed) : "";
     absl::optional<std::filesystem::path> pnr_path;
     std::vector<std::string> nextpnr_args = {nextpnr_path_, "--json",
                                              netlist_path.string()};
@@ -174,7 +296,7 @@ class YosysSynthesisServiceImpl : public SynthesisService::Service {
     if (synthesis_target_ == "ecp5") {
       nextpnr_args.push_back("--45k");
       nextpnr_args.push_back("--textcfg");
-      pnr_path = temp_dir_path / "pnr.cfg";
+      pnr_path = temp_dir_path / absl::StrCat("pnr", suffix, ".cfg");
       nextpnr_args.push_back(pnr_path->string());
     } else if (synthesis_target_ == "ice40") {
       nextpnr_args.push_back("--hx8k");
@@ -183,35 +305,178 @@ class YosysSynthesisServiceImpl : public SynthesisService::Service {
     if (request->has_target_frequency_hz()) {
       nextpnr_args.push_back("--freq");
       nextpnr_args.push_back(
-          absl::StrCat(request->has_target_frequency_hz() / 1000000));
+          absl::StrCat(request->target_frequency_hz() / 1000000));
+    }
+    if (seed.has_value()) {
+      nextpnr_args.push_back("--seed");
+      nextpnr_args.push_back(absl::StrCat(*seed));
     }
-    XLS_ASSIGN_OR_RETURN(string_pair, RunSubprocess(nextpnr_args));
+    XLS_ASSIGN_OR_RETURN(auto string_pair, RunSubprocess(nextpnr_args, cancel));
     auto [nextpnr_stdout, nextpnr_stderr] = string_pair;
     if (absl::GetFlag(FLAGS_save_temps)) {
-      XLS_RETURN_IF_ERROR(
-          SetFileContents(temp_dir_path / "nextpnr.stdout", nextpnr_stdout));
-      XLS_RETURN_IF_ERROR(
-          SetFileContents(temp_dir_path / "nextpnr.stderr", nextpnr_stderr));
+      XLS_RETURN_IF_ERROR(SetFileContents(
+          temp_dir_path / absl::StrCat("nextpnr", suffix, ".stdout"),
+          nextpnr_stdout));
+      XLS_RETURN_IF_ERROR(SetFileContents(
+          temp_dir_path / absl::StrCat("nextpnr", suffix, ".stderr"),
+          nextpnr_stderr));
     }
 
+    PlaceAndRouteResult pnr;
     if (pnr_path.has_value()) {
-      XLS_ASSIGN_OR_RETURN(std::string pnr_result, GetFileContents(*pnr_path));
-      result->set_place_and_route_result(pnr_result);
+      XLS_ASSIGN_OR_RETURN(pnr.place_and_route_result,
+                           GetFileContents(*pnr_path));
     }
 
     // Parse the stderr from nextpnr to get the maximum frequency.
-    XLS_ASSIGN_OR_RETURN(int64_t max_frequency_hz,
+    XLS_ASSIGN_OR_RETURN(pnr.max_frequency_hz,
                          ParseNextpnrOutput(nextpnr_stderr));
-    result->set_max_frequency_hz(max_frequency_hz);
-    XLS_LOG(INFO) << "max_frequency_mhz: " << (max_frequency_hz / 1e6);
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "max_frequency_mhz%s: %f",
+        seed.has_value() ? absl::StrCat(" (seed ", *seed, ")") : "",
+        pnr.max_frequency_hz / 1e6);
+    return pnr;
+  }
+
+  // Runs place and route with seeds 1 through place_and_route_seed_count
+  // concurrently and reports the best of them. The runs all count against the
+  // request's single worker slot.
+  absl::Status RunPlaceAndRouteSeeds(const CompileRequest* request,
+                                     const std::filesystem::path& netlist_path,
+                                     const std::filesystem::path& temp_dir_path,
+                                     CompileResponse* result) {
+    int64_t seed_count = request->place_and_route_seed_count();
+    std::vector<absl::StatusOr<PlaceAndRouteResult>> runs(
+        seed_count, absl::UnknownError("Place and route did not run"));
+    std::vector<absl::Duration> elapsed(seed_count);
+    std::atomic<bool> target_met{false};
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < seed_count; ++i) {
+      threads.push_back(absl::make_unique<Thread>([&, i]() {
+        absl::Time start = absl::Now();
+        runs[i] = RunPlaceAndRoute(request, netlist_path, temp_dir_path,
+                                   /*seed=*/i + 1, &target_met);
+        elapsed[i] = absl::Now() - start;
+        if (runs[i].ok() && request->has_target_frequency_hz() &&
+            runs[i]->max_frequency_hz >= request->target_frequency_hz()) {
+          target_met = true;
+        }
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
 
+    absl::optional<int64_t> best;
+    for (int64_t i = 0; i < seed_count; ++i) {
+      PlaceAndRouteRun* run = result->add_place_and_route_runs();
+      run->set_seed(i + 1);
+      run->set_elapsed_runtime_ms(absl::ToInt64Milliseconds(elapsed[i]));
+      if (absl::IsCancelled(runs[i].status())) {
+        run->set_cancelled(true);
+        continue;
+      }
+      XLS_RETURN_IF_ERROR(runs[i].status());
+      run->set_max_frequency_hz(runs[i]->max_frequency_hz);
+      if (!best.has_value() ||
+          runs[i]->max_frequency_hz > runs[*best]->max_frequency_hz) {
+        best = i;
+      }
+    }
+    XLS_RET_CHECK(best.has_value());
+    result->set_place_and_route_seed(*best + 1);
+    result->set_max_frequency_hz(runs[*best]->max_frequency_hz);
+    if (runs[*best]->place_and_route_result.has_value()) {
+      result->set_place_and_route_result(
+          *runs[*best]->place_and_route_result);
+    }
     return absl::OkStatus();
   }
 
- private:
+  // Returns a key which identifies everything the result of synthesizing the
+  // request depends on. Fields are length-prefixed so distinct requests never
+  // share a key.
+  std::string CacheKey(const CompileRequest& request) const {
+    std::string key;
+    for (absl::string_view field :
+         {absl::string_view(synthesis_target_),
+          absl::string_view(request.top_module_name()),
+          absl::string_view(request.module_text())}) {
+      absl::StrAppend(&key, field.size(), ":", field);
+    }
+    absl::StrAppend(&key, request.has_target_frequency_hz()
+                              ? request.target_frequency_hz()
+                              : int64_t{-1});
+    absl::StrAppend(&key, ":", std::max(request.place_and_route_seed_count(),
+                                        int64_t{1}));
+    absl::StrAppend(&key, absl::GetFlag(FLAGS_synthesis_only) ? "S" : "P",
+                    absl::GetFlag(FLAGS_return_netlist) ? "N" : "-");
+    return key;
+  }
+
+  bool LookupCache(const std::string& key, CompileResponse* result) {
+    absl::MutexLock lock(&cache_mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      return false;
+    }
+    *result = it->second;
+    return true;
+  }
+
+  // Evicts the oldest entries to keep the cache within cache_size_.
+  void InsertIntoCache(const std::string& key, const CompileResponse& result) {
+    if (cache_size_ <= 0) {
+      return;
+    }
+    absl::MutexLock lock(&cache_mutex_);
+    if (!cache_.emplace(key, result).second) {
+      return;
+    }
+    cache_order_.push_back(key);
+    while (cache_order_.size() > static_cast<size_t>(cache_size_)) {
+      cache_.erase(cache_order_.front());
+      cache_order_.pop_front();
+    }
+  }
+
+  // Blocks until fewer than max_concurrent_jobs_ jobs are running and every
+  // request which arrived earlier has started.
+  void AcquireWorker() {
+    absl::MutexLock lock(&worker_mutex_);
+    int64_t ticket = next_ticket_++;
+    XLS_VLOG(1) << "Queued synthesis job " << ticket << "; "
+                << (ticket - next_to_start_) << " ahead in queue";
+    auto can_start = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(worker_mutex_) {
+      return ticket == next_to_start_ && running_jobs_ < max_concurrent_jobs_;
+    };
+    worker_mutex_.Await(absl::Condition(&can_start));
+    ++next_to_start_;
+    ++running_jobs_;
+  }
+
+  void ReleaseWorker() {
+    absl::MutexLock lock(&worker_mutex_);
+    --running_jobs_;
+  }
+
   std::string yosys_path_;
   std::string nextpnr_path_;
   std::string synthesis_target_;
+  int64_t max_concurrent_jobs_;
+  int64_t cache_size_;
+
+  absl::Mutex cache_mutex_;
+  absl::flat_hash_map<std::string, CompileResponse> cache_
+      ABSL_GUARDED_BY(cache_mutex_);
+  // Keys of cache_ in insertion order.
+  std::deque<std::string> cache_order_ ABSL_GUARDED_BY(cache_mutex_);
+
+  // Requests are served in order of the tickets they take on arrival.
+  absl::Mutex worker_mutex_;
+  int64_t next_ticket_ ABSL_GUARDED_BY(worker_mutex_) = 0;
+  int64_t next_to_start_ ABSL_GUARDED_BY(worker_mutex_) = 0;
+  int64_t running_jobs_ ABSL_GUARDED_BY(worker_mutex_) = 0;
 };
 
 void RealMain() {
@@ -223,7 +488,13 @@ void RealMain() {
   XLS_QCHECK_OK(FileExists(nextpnr_path));
   std::string synthesis_target = absl::GetFlag(FLAGS_synthesis_target);
   XLS_QCHECK(!synthesis_target.empty()) << "-synthesis_target must be provided";
-  YosysSynthesisServiceImpl service(yosys_path, nextpnr_path, synthesis_target);
+  int64_t max_concurrent_jobs = absl::GetFlag(FLAGS_max_concurrent_jobs);
+  if (max_concurrent_jobs <= 0) {
+    max_concurrent_jobs = std::max(1u, std::thread::hardware_concurrency());
+  }
+  YosysSynthesisServiceImpl service(yosys_path, nextpnr_path, synthesis_target,
+                                    max_concurrent_jobs,
+                                    absl::GetFlag(FLAGS_cache_size));
 
   ::grpc::ServerBuilder builder;
   std::shared_ptr<::grpc::ServerCredentials> creds = GetServerCredentials();
@@ -232,6 +503,7 @@ void RealMain() {
   std::unique_ptr<::grpc::Server> server(builder.BuildAndStart());
   XLS_LOG(INFO) << "Serving on port: " << port;
   XLS_LOG(INFO) << "synthesis_target: " << synthesis_target;
+  XLS_LOG(INFO) << "max_concurrent_jobs: " << max_concurrent_jobs;
   server->Wait();
 }
 
@@ -17,12 +17,15 @@
 
 import subprocess
 
+import grpc
 import portpicker
 
 from google.protobuf import text_format
 from absl.testing import absltest
 from xls.common import runfiles
+from xls.synthesis import client_credentials
 from xls.synthesis import synthesis_pb2
+from xls.synthesis import synthesis_service_pb2_grpc
 
 CLIENT_PATH = runfiles.get_path('xls/synthesis/synthesis_client_main')
 SERVER_PATH = runfiles.get_path('xls/synthesis/yosys/yosys_server_main')
@@ -90,6 +93,81 @@ class SynthesisServerTest(absltest.TestCase):
     proc.terminate()
     proc.wait()
 
+  def test_cache_hit(self):
+    port, proc = self._start_server()
+
+    verilog_file = self.create_tempfile(content=VERILOG)
+
+    def compile_verilog():
+      response_text = subprocess.check_output(
+          [CLIENT_PATH, verilog_file.full_path, f'--port={port}',
+           '--ghz=1.0']).decode('utf-8')
+      return text_format.Parse(response_text,
+                               synthesis_pb2.CompileResponse())
+
+    first = compile_verilog()
+    self.assertFalse(first.cache_hit)
+    second = compile_verilog()
+    self.assertTrue(second.cache_hit)
+    self.assertEqual(second.max_frequency_hz, first.max_frequency_hz)
+    self.assertEqual(second.elapsed_runtime_ms, first.elapsed_runtime_ms)
+
+    proc.terminate()
+    proc.wait()
+
+  def test_batch_compile(self):
+    port, proc = self._start_server()
+
+    request = synthesis_pb2.BatchCompileRequest()
+    for top in ('main', 'other'):
+      compile_request = request.requests.add()
+      compile_request.module_text = VERILOG
+      compile_request.top_module_name = top
+      compile_request.target_frequency_hz = 1000000000
+
+    channel_creds = client_credentials.get_credentials()
+    with grpc.secure_channel(f'localhost:{port}', channel_creds) as channel:
+      grpc.channel_ready_future(channel).result()
+      stub = synthesis_service_pb2_grpc.SynthesisServiceStub(channel)
+      response = stub.BatchCompile(request)
+
+    self.assertLen(response.responses, 2)
+    for compile_response in response.responses:
+      # The response is generated by parsing testdata/nextpnr.out.
+      self.assertEqual(compile_response.max_frequency_hz, 180280000)
+      self.assertFalse(compile_response.cache_hit)
+
+    proc.terminate()
+    proc.wait()
+
+  def test_place_and_route_seeds(self):
+    port, proc = self._start_server()
+
+    request = synthesis_pb2.CompileRequest()
+    request.module_text = VERILOG
+    request.top_module_name = 'main'
+    request.target_frequency_hz = 1000000000
+    request.place_and_route_seed_count = 3
+
+    channel_creds = client_credentials.get_credentials()
+    with grpc.secure_channel(f'localhost:{port}', channel_creds) as channel:
+      grpc.channel_ready_future(channel).result()
+      stub = synthesis_service_pb2_grpc.SynthesisServiceStub(channel)
+      response = stub.Compile(request)
+
+    # The target is never met, so every seed runs to completion.
+    self.assertEqual([run.seed for run in response.place_and_route_runs],
+                     [1, 2, 3])
+    for run in response.place_and_route_runs:
+      self.assertFalse(run.cancelled)
+      self.assertEqual(run.max_frequency_hz, 180280000)
+    self.assertEqual(response.max_frequency_hz, 180280000)
+    self.assertEqual(response.place_and_route_seed, 1)
+    self.assertNotEmpty(response.place_and_route_result)
+
+    proc.terminate()
+    proc.wait()
+
 
 if __name__ == '__main__':
   absltest.main()
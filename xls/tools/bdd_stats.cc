@@ -41,6 +41,13 @@ To gather BDD stats of a set of benchmarks:
 ABSL_FLAG(int64_t, bdd_minterm_limit, 0,
           "Maximum number of minterms before truncating the BDD subgraph "
           "and declaring a new variable. If zero, then no limit.");
+ABSL_FLAG(int64_t, bdd_node_limit, 0,
+          "Maximum number of BDD nodes. While the BDD holds more nodes than "
+          "this after garbage collection, bits are modeled as new variables. "
+          "If zero, then no limit.");
+ABSL_FLAG(int64_t, bdd_reorder_threshold, 0,
+          "Number of BDD nodes above which the BDD variables are reordered "
+          "by sifting. If zero, then the variables are not reordered.");
 ABSL_FLAG(std::vector<std::string>, benchmarks, {},
           "Comma-separated list of benchmarks gather BDD stats about.");
 
@@ -99,13 +106,24 @@ absl::Status RealMain(absl::string_view input_path) {
     absl::Time start = absl::Now();
     XLS_ASSIGN_OR_RETURN(
         std::unique_ptr<BddFunction> bdd_function,
-        BddFunction::Run(entry, absl::GetFlag(FLAGS_bdd_minterm_limit)));
+        BddFunction::Run(entry, absl::GetFlag(FLAGS_bdd_minterm_limit),
+                         /*do_not_evaluate_ops=*/{},
+                         absl::GetFlag(FLAGS_bdd_node_limit),
+                         absl::GetFlag(FLAGS_bdd_reorder_threshold)));
     absl::Duration bdd_time = absl::Now() - start;
     total_time += bdd_time;
     std::cout << "BDD construction time: " << bdd_time << "\n";
     std::cout << "BDD node count: " << bdd_function->bdd().size() << "\n";
     std::cout << "BDD variable count: " << bdd_function->bdd().variable_count()
               << "\n";
+    const BddReorderStats& reorder_stats = bdd_function->bdd().reorder_stats();
+    if (reorder_stats.reorder_count > 0) {
+      std::cout << "BDD reorderings: " << reorder_stats.reorder_count << "\n";
+      std::cout << "BDD variable swaps: " << reorder_stats.swap_count << "\n";
+      std::cout << "BDD nodes before/after reordering: "
+                << reorder_stats.nodes_before << "/"
+                << reorder_stats.nodes_after << "\n";
+    }
 
     int64_t number_bits = 0;
     for (Node* node : entry->nodes()) {
@@ -114,9 +132,15 @@ absl::Status RealMain(absl::string_view input_path) {
     std::cout << "Bits in graph: " << number_bits << "\n";
 
     int64_t max_minterms = 0;
-    for (int64_t i = 0; i < bdd_function->bdd().size(); ++i) {
-      max_minterms = std::max(
-          max_minterms, bdd_function->bdd().minterm_count(BddNodeIndex(i)));
+    for (Node* node : entry->nodes()) {
+      if (!node->GetType()->IsBits()) {
+        continue;
+      }
+      for (int64_t i = 0; i < node->BitCountOrDie(); ++i) {
+        max_minterms = std::max(max_minterms,
+                                bdd_function->bdd().minterm_count(
+                                    bdd_function->GetBddNode(node, i)));
+      }
     }
     if (max_minterms == std::numeric_limits<int32_t>::max()) {
       std::cout << "Maximum minterms of any expression: INT32_MAX\n";
@@ -32,7 +32,9 @@
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/node_iterator.h"
 #include "xls/passes/bdd_query_engine.h"
+#include "xls/passes/pass_profile.h"
 #include "xls/passes/passes.h"
+#include "xls/passes/query_engine_cache.h"
 #include "xls/passes/standard_pipeline.h"
 #include "xls/scheduling/pipeline_schedule.h"
 
@@ -61,7 +63,8 @@ ABSL_FLAG(bool, show_known_bits, false,
 ABSL_FLAG(std::string, entry, "",
           "Entry function to use in lieu of the default.");
 ABSL_FLAG(std::string, delay_model, "",
-          "Delay model name to use from registry.");
+          "Delay model name to use from registry, or the path of a DelayModel "
+          "text proto file ending in .textproto to load.");
 
 namespace xls {
 namespace {
@@ -99,10 +102,12 @@ void PrintNodeBreakdown(Function* f) {
 absl::Status RunOptimizationAndPrintStats(Package* package) {
   std::unique_ptr<CompoundPass> pipeline = CreateStandardPassPipeline();
 
+  QueryEngineCache query_engine_cache;
+  PassOptions options;
+  options.query_engine_cache = &query_engine_cache;
   absl::Time start = absl::Now();
   PassResults pass_results;
-  XLS_RETURN_IF_ERROR(
-      pipeline->Run(package, PassOptions(), &pass_results).status());
+  XLS_RETURN_IF_ERROR(pipeline->Run(package, options, &pass_results).status());
   absl::Duration total_time = absl::Now() - start;
   auto to_ms = [](absl::Duration d) { return d / absl::Milliseconds(1); };
   std::cout << absl::StreamFormat("Optimization time: %dms\n",
@@ -110,32 +115,10 @@ absl::Status RunOptimizationAndPrintStats(Package* package) {
   std::cout << absl::StreamFormat("Dynamic pass count: %d\n",
                                   pass_results.invocations.size());
 
-  // Aggregate run times by the pass name and print a table of the aggregate
-  // execution time of each pass in decending order.
-  absl::flat_hash_map<std::string, absl::Duration> pass_times;
-  absl::flat_hash_map<std::string, int64_t> pass_counts;
-  absl::flat_hash_map<std::string, int64_t> changed_counts;
-  for (const PassInvocation& invocation : pass_results.invocations) {
-    pass_times[invocation.pass_name] += invocation.run_duration;
-    ++pass_counts[invocation.pass_name];
-    changed_counts[invocation.pass_name] += invocation.ir_changed ? 1 : 0;
-  }
-  std::vector<std::string> pass_names;
-  for (const auto& pair : pass_times) {
-    pass_names.push_back(pair.first);
-  }
-  std::sort(pass_names.begin(), pass_names.end(),
-            [&](const std::string& a, const std::string& b) {
-              return pass_times.at(a) > pass_times.at(b);
-            });
-  std::cout << "Pass run durations (# of times pass changed IR / # of times "
-               "pass was run):"
-            << std::endl;
-  for (const std::string& name : pass_names) {
-    std::cout << absl::StreamFormat(
-        "  %-20s : %-5dms (%3d / %3d)\n", name, to_ms(pass_times.at(name)),
-        changed_counts.at(name), pass_counts.at(name));
-  }
+  // Print a table of the aggregate cost of each pass in decending order of
+  // execution time.
+  std::cout << "Pass profile:" << std::endl;
+  std::cout << PassProfileToString(AggregatePassProfile(pass_results));
   return absl::OkStatus();
 }
 
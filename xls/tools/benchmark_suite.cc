@@ -0,0 +1,539 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/tools/benchmark_suite.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/common/memory_usage.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/interpreter/proc_network_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/random_value.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/jit/serial_proc_runtime.h"
+#include "xls/netlist/fake_cell_library.h"
+#include "xls/netlist/interpreter.h"
+#include "xls/netlist/netlist.h"
+#include "xls/netlist/netlist_parser.h"
+#include "xls/passes/standard_pipeline.h"
+#include "xls/scheduling/pipeline_schedule.h"
+
+namespace xls {
+namespace {
+
+// Returns "text" as a quoted JSON string.
+std::string JsonString(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        absl::StrAppend(&result, "\\\"");
+        break;
+      case '\\':
+        absl::StrAppend(&result, "\\\\");
+        break;
+      case '\n':
+        absl::StrAppend(&result, "\\n");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", c);
+        } else {
+          result.push_back(c);
+        }
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+// Takes samples until the minimum time and sample count of "options" are
+// reached, doubling the number of samples between clock reads. "sample" is
+// given the index of the sample.
+absl::Status MeasureSamples(const EvalBenchmarkOptions& options,
+                            const std::function<absl::Status(int64_t)>& sample,
+                            EvalBenchmarkResult* result) {
+  XLS_RETURN_IF_ERROR(sample(0));
+  absl::Time start = absl::Now();
+  int64_t batch = 1;
+  while (true) {
+    for (int64_t i = 0; i < batch; ++i) {
+      XLS_RETURN_IF_ERROR(sample(result->samples + i));
+    }
+    result->samples += batch;
+    result->duration = absl::Now() - start;
+    if (result->samples >= options.min_samples &&
+        result->duration >= options.min_time) {
+      return absl::OkStatus();
+    }
+    batch *= 2;
+  }
+}
+
+EvalBenchmarkResult MeasureEngine(
+    absl::string_view workload, absl::string_view engine, int64_t node_count,
+    const EvalBenchmarkOptions& options,
+    const std::function<absl::Status(int64_t)>& sample) {
+  EvalBenchmarkResult result;
+  result.workload = std::string(workload);
+  result.engine = std::string(engine);
+  result.node_count = node_count;
+  absl::Status status = MeasureSamples(options, sample, &result);
+  if (!status.ok()) {
+    result.error = status.ToString();
+  }
+  return result;
+}
+
+EvalBenchmarkResult FailedEngine(absl::string_view workload,
+                                 absl::string_view engine,
+                                 const absl::Status& status) {
+  EvalBenchmarkResult result;
+  result.workload = std::string(workload);
+  result.engine = std::string(engine);
+  result.error = status.ToString();
+  return result;
+}
+
+EvalBenchmarkResult ResultOrFailed(
+    const absl::StatusOr<EvalBenchmarkResult>& result,
+    absl::string_view workload, absl::string_view engine) {
+  if (!result.ok()) {
+    return FailedEngine(workload, engine, result.status());
+  }
+  return result.value();
+}
+
+int64_t ProcNodeCount(const Package& package) {
+  int64_t node_count = 0;
+  for (const std::unique_ptr<Proc>& proc : package.procs()) {
+    node_count += proc->node_count();
+  }
+  return node_count;
+}
+
+// Each proc engine gets its own package so that neither sees the other's
+// channel state.
+absl::StatusOr<EvalBenchmarkResult> MeasureProcNetworkInterpreter(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<ProcNetworkInterpreter> interpreter,
+                       ProcNetworkInterpreter::Create(package.get(), {}));
+  return MeasureEngine(workload, "proc_network_interpreter",
+                       ProcNodeCount(*package), options,
+                       [&](int64_t) { return interpreter->Tick(); });
+}
+
+absl::StatusOr<EvalBenchmarkResult> MeasureSerialProcRuntime(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<SerialProcRuntime> runtime,
+                       SerialProcRuntime::Create(package.get()));
+  return MeasureEngine(workload, "serial_proc_runtime",
+                       ProcNodeCount(*package), options,
+                       [&](int64_t) { return runtime->Tick(); });
+}
+
+}  // namespace
+
+BenchmarkResult RunBenchmark(absl::string_view name, absl::string_view ir_text,
+                             const BenchmarkSuiteOptions& options) {
+  BenchmarkResult result;
+  result.name = std::string(name);
+
+  // Runs "phase", recording its cost, and returns whether it succeeded.
+  auto run_phase = [&](absl::string_view phase_name,
+                       const std::function<absl::Status()>& phase) {
+    absl::Time start = absl::Now();
+    absl::Status status = phase();
+    result.phases.push_back(BenchmarkPhase{
+        .name = std::string(phase_name),
+        .duration = absl::Now() - start,
+        .peak_rss_bytes = GetPeakResidentSetBytes()});
+    if (!status.ok()) {
+      result.error = absl::StrCat(phase_name, ": ", status.ToString());
+      return false;
+    }
+    return true;
+  };
+
+  std::unique_ptr<Package> package;
+  Function* entry = nullptr;
+  if (!run_phase("parse", [&]() -> absl::Status {
+        XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(ir_text));
+        XLS_ASSIGN_OR_RETURN(entry, package->EntryFunction());
+        result.unoptimized_node_count = entry->node_count();
+        return absl::OkStatus();
+      })) {
+    return result;
+  }
+
+  if (!run_phase("optimize", [&]() -> absl::Status {
+        std::unique_ptr<CompoundPass> pipeline =
+            CreateStandardPassPipeline(options.opt_level);
+        PassResults pass_results;
+        XLS_RETURN_IF_ERROR(
+            pipeline->Run(package.get(), PassOptions(), &pass_results)
+                .status());
+        XLS_ASSIGN_OR_RETURN(entry, package->EntryFunction());
+        result.optimized_node_count = entry->node_count();
+        return absl::OkStatus();
+      })) {
+    return result;
+  }
+
+  if (options.clock_period_ps.has_value() ||
+      options.pipeline_stages.has_value()) {
+    absl::optional<PipelineSchedule> schedule;
+    if (!run_phase("schedule", [&]() -> absl::Status {
+          XLS_RET_CHECK(options.delay_estimator != nullptr);
+          SchedulingOptions scheduling_options;
+          if (options.clock_period_ps.has_value()) {
+            scheduling_options.clock_period_ps(*options.clock_period_ps);
+          }
+          if (options.pipeline_stages.has_value()) {
+            scheduling_options.pipeline_stages(*options.pipeline_stages);
+          }
+          XLS_ASSIGN_OR_RETURN(
+              schedule, PipelineSchedule::Run(entry, *options.delay_estimator,
+                                              scheduling_options));
+          return absl::OkStatus();
+        })) {
+      return result;
+    }
+    if (!run_phase("codegen", [&]() -> absl::Status {
+          return verilog::ToPipelineModuleText(*schedule, entry).status();
+        })) {
+      return result;
+    }
+  }
+
+  std::unique_ptr<IrJit> jit;
+  if (!run_phase("jit_compile", [&]() -> absl::Status {
+        XLS_ASSIGN_OR_RETURN(jit, IrJit::Create(entry));
+        return absl::OkStatus();
+      })) {
+    return result;
+  }
+
+  std::minstd_rand engine(options.seed);
+  std::vector<std::vector<Value>> arg_sets(options.eval_iterations);
+  for (std::vector<Value>& args : arg_sets) {
+    args = RandomFunctionArguments(entry, &engine);
+  }
+  if (!run_phase("jit_run", [&]() -> absl::Status {
+        for (const std::vector<Value>& args : arg_sets) {
+          XLS_RETURN_IF_ERROR(jit->Run(args).status());
+        }
+        return absl::OkStatus();
+      })) {
+    return result;
+  }
+  run_phase("interpreter_run", [&]() -> absl::Status {
+    for (const std::vector<Value>& args : arg_sets) {
+      XLS_RETURN_IF_ERROR(IrInterpreter::Run(entry, args).status());
+    }
+    return absl::OkStatus();
+  });
+  return result;
+}
+
+std::string BenchmarkResultsToJson(absl::Span<const BenchmarkResult> results) {
+  std::vector<std::string> benchmarks;
+  for (const BenchmarkResult& result : results) {
+    std::vector<std::string> phases;
+    for (const BenchmarkPhase& phase : result.phases) {
+      phases.push_back(absl::StrFormat(
+          "{\"name\": %s, \"time_us\": %d, \"peak_rss_bytes\": %d}",
+          JsonString(phase.name), absl::ToInt64Microseconds(phase.duration),
+          phase.peak_rss_bytes));
+    }
+    std::string error;
+    if (result.error.has_value()) {
+      error = absl::StrCat(", \"error\": ", JsonString(*result.error));
+    }
+    benchmarks.push_back(absl::StrFormat(
+        "    {\"name\": %s, \"unoptimized_node_count\": %d, "
+        "\"optimized_node_count\": %d%s,\n     \"phases\": [%s]}",
+        JsonString(result.name), result.unoptimized_node_count,
+        result.optimized_node_count, error, absl::StrJoin(phases, ", ")));
+  }
+  return absl::StrFormat("{\"benchmarks\": [\n%s\n]}\n",
+                         absl::StrJoin(benchmarks, ",\n"));
+}
+
+double EvalBenchmarkResult::SamplesPerSecond() const {
+  if (duration <= absl::ZeroDuration()) {
+    return 0.0;
+  }
+  return samples / absl::ToDoubleSeconds(duration);
+}
+
+double EvalBenchmarkResult::NsPerNode() const {
+  if (samples == 0 || node_count == 0) {
+    return 0.0;
+  }
+  return absl::ToDoubleNanoseconds(duration) / samples / node_count;
+}
+
+std::vector<EvalBenchmarkResult> RunFunctionEvalBenchmarks(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options) {
+  absl::StatusOr<std::unique_ptr<Package>> package =
+      Parser::ParsePackage(ir_text);
+  if (!package.ok()) {
+    return {FailedEngine(workload, "jit", package.status()),
+            FailedEngine(workload, "interpreter", package.status())};
+  }
+  absl::StatusOr<Function*> entry = package.value()->EntryFunction();
+  if (!entry.ok()) {
+    return {FailedEngine(workload, "jit", entry.status()),
+            FailedEngine(workload, "interpreter", entry.status())};
+  }
+  Function* f = entry.value();
+  std::minstd_rand engine(options.seed);
+  std::vector<std::vector<Value>> arg_sets(
+      std::max<int64_t>(1, options.input_count));
+  for (std::vector<Value>& args : arg_sets) {
+    args = RandomFunctionArguments(f, &engine);
+  }
+
+  std::vector<EvalBenchmarkResult> results;
+  absl::StatusOr<std::unique_ptr<IrJit>> jit = IrJit::Create(f);
+  if (jit.ok()) {
+    results.push_back(MeasureEngine(
+        workload, "jit", f->node_count(), options, [&](int64_t i) {
+          return jit.value()->Run(arg_sets[i % arg_sets.size()]).status();
+        }));
+  } else {
+    results.push_back(FailedEngine(workload, "jit", jit.status()));
+  }
+  results.push_back(MeasureEngine(
+      workload, "interpreter", f->node_count(), options, [&](int64_t i) {
+        return IrInterpreter::Run(f, arg_sets[i % arg_sets.size()]).status();
+      }));
+  return results;
+}
+
+std::vector<EvalBenchmarkResult> RunProcEvalBenchmarks(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options) {
+  return {
+      ResultOrFailed(
+          MeasureProcNetworkInterpreter(workload, ir_text, options), workload,
+          "proc_network_interpreter"),
+      ResultOrFailed(MeasureSerialProcRuntime(workload, ir_text, options),
+                     workload, "serial_proc_runtime"),
+  };
+}
+
+EvalBenchmarkResult RunNetlistEvalBenchmark(
+    absl::string_view workload, absl::string_view netlist_text,
+    absl::string_view module_name, const EvalBenchmarkOptions& options) {
+  constexpr absl::string_view kEngine = "netlist_interpreter";
+  absl::StatusOr<netlist::CellLibrary> cell_library =
+      netlist::MakeFakeCellLibrary();
+  if (!cell_library.ok()) {
+    return FailedEngine(workload, kEngine, cell_library.status());
+  }
+  netlist::rtl::Scanner scanner(netlist_text);
+  absl::StatusOr<std::unique_ptr<netlist::rtl::Netlist>> parsed =
+      netlist::rtl::Parser::ParseNetlist(&cell_library.value(), &scanner);
+  if (!parsed.ok()) {
+    return FailedEngine(workload, kEngine, parsed.status());
+  }
+  absl::StatusOr<const netlist::rtl::Module*> module =
+      parsed.value()->GetModule(std::string(module_name));
+  if (!module.ok()) {
+    return FailedEngine(workload, kEngine, module.status());
+  }
+
+  std::minstd_rand engine(options.seed);
+  std::vector<absl::flat_hash_map<const netlist::rtl::NetRef, bool>>
+      input_sets(std::max<int64_t>(1, options.input_count));
+  for (auto& inputs : input_sets) {
+    for (const netlist::rtl::NetRef input : module.value()->inputs()) {
+      inputs[input] = std::bernoulli_distribution()(engine);
+    }
+  }
+  netlist::Interpreter interpreter(parsed.value().get());
+  return MeasureEngine(
+      workload, kEngine, module.value()->cells().size(), options,
+      [&](int64_t i) {
+        return interpreter
+            .InterpretModule(module.value(), input_sets[i % input_sets.size()])
+            .status();
+      });
+}
+
+std::vector<EvalBenchmarkResult> RunSyntheticEvalBenchmarks(
+    const EvalBenchmarkOptions& options) {
+  std::vector<EvalBenchmarkResult> results =
+      RunFunctionEvalBenchmarks("select_decoder", SelectDecoderIr(8), options);
+  for (EvalBenchmarkResult& result :
+       RunProcEvalBenchmarks("proc_pipeline", ProcPipelineIr(8), options)) {
+    results.push_back(std::move(result));
+  }
+  results.push_back(RunNetlistEvalBenchmark(
+      "netlist_adder", RippleCarryAdderNetlist(64), "adder", options));
+  return results;
+}
+
+std::string SelectDecoderIr(int64_t selector_width) {
+  int64_t case_count = int64_t{1} << selector_width;
+  std::string ir = absl::StrFormat(R"(package select_decoder
+
+fn main(s: bits[%d], x: bits[32]) -> (bits[32], bits[%d]) {
+)",
+                                   selector_width, case_count);
+  std::vector<std::string> cases;
+  for (int64_t i = 0; i < case_count; ++i) {
+    absl::StrAppendFormat(&ir,
+                          "  k%d: bits[32] = literal(value=%d)\n"
+                          "  case%d: bits[32] = xor(x, k%d)\n",
+                          i, (i * 0x9e3779b1) & 0xffffffff, i, i);
+    cases.push_back(absl::StrCat("case", i));
+  }
+  absl::StrAppendFormat(&ir,
+                        "  selected: bits[32] = sel(s, cases=[%s])\n"
+                        "  decoded: bits[%d] = decode(s, width=%d)\n"
+                        "  ret result: (bits[32], bits[%d]) = "
+                        "tuple(selected, decoded)\n}\n",
+                        absl::StrJoin(cases, ", "), case_count, case_count,
+                        case_count);
+  return ir;
+}
+
+std::string ProcPipelineIr(int64_t stage_count) {
+  std::string ir = "package proc_pipeline\n\n";
+  // Channel i connects stage i to stage i + 1.
+  for (int64_t i = 0; i + 1 < stage_count; ++i) {
+    absl::StrAppendFormat(
+        &ir,
+        "chan c%d(bits[32], id=%d, kind=streaming, ops=send_receive, "
+        "metadata=\"\")\n",
+        i, i);
+  }
+  absl::StrAppend(&ir, R"(
+proc s0(tkn: token, state: bits[32], init=0) {
+  snd: token = send(tkn, state, channel_id=0)
+  one: bits[32] = literal(value=1)
+  next_state: bits[32] = add(state, one)
+  next (snd, next_state)
+}
+)");
+  for (int64_t i = 1; i + 1 < stage_count; ++i) {
+    absl::StrAppendFormat(&ir, R"(
+proc s%d(tkn: token, state: bits[32], init=%d) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=%d)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  k: bits[32] = literal(value=2654435761)
+  sum: bits[32] = add(data, state)
+  product: bits[32] = umul(sum, k)
+  snd: token = send(rcv_tkn, product, channel_id=%d)
+  next (snd, product)
+}
+)",
+                          i, i, i - 1, i);
+  }
+  absl::StrAppendFormat(&ir, R"(
+proc s%d(tkn: token, state: bits[32], init=0) {
+  rcv: (token, bits[32]) = receive(tkn, channel_id=%d)
+  rcv_tkn: token = tuple_index(rcv, index=0)
+  data: bits[32] = tuple_index(rcv, index=1)
+  next_state: bits[32] = xor(state, data)
+  next (rcv_tkn, next_state)
+}
+)",
+                        stage_count - 1, stage_count - 2);
+  return ir;
+}
+
+std::string RippleCarryAdderNetlist(int64_t bit_count) {
+  std::vector<std::string> a, b, s, wires;
+  for (int64_t i = 0; i < bit_count; ++i) {
+    a.push_back(absl::StrCat("a", i));
+    b.push_back(absl::StrCat("b", i));
+    s.push_back(absl::StrCat("s", i));
+    wires.push_back(absl::StrFormat("x%d, g%d, p%d", i, i, i));
+    if (i > 0) {
+      wires.push_back(absl::StrCat("c", i));
+    }
+  }
+  std::string netlist = absl::StrFormat(
+      "module adder (%s, %s, cin, %s, cout);\n"
+      "  input %s;\n  input %s;\n  input cin;\n"
+      "  output %s;\n  output cout;\n  wire %s;\n\n",
+      absl::StrJoin(a, ", "), absl::StrJoin(b, ", "), absl::StrJoin(s, ", "),
+      absl::StrJoin(a, ", "), absl::StrJoin(b, ", "), absl::StrJoin(s, ", "),
+      absl::StrJoin(wires, ", "));
+  for (int64_t i = 0; i < bit_count; ++i) {
+    std::string carry_in = i == 0 ? "cin" : absl::StrCat("c", i);
+    std::string carry_out =
+        i + 1 == bit_count ? "cout" : absl::StrCat("c", i + 1);
+    absl::StrAppendFormat(
+        &netlist,
+        "  XOR x%1$d_cell ( .A(a%1$d), .B(b%1$d), .Z(x%1$d) );\n"
+        "  XOR s%1$d_cell ( .A(x%1$d), .B(%2$s), .Z(s%1$d) );\n"
+        "  AND g%1$d_cell ( .A(a%1$d), .B(b%1$d), .Z(g%1$d) );\n"
+        "  AND p%1$d_cell ( .A(x%1$d), .B(%2$s), .Z(p%1$d) );\n"
+        "  OR c%1$d_cell ( .A(g%1$d), .B(p%1$d), .Z(%3$s) );\n",
+        i, carry_in, carry_out);
+  }
+  absl::StrAppend(&netlist, "endmodule\n");
+  return netlist;
+}
+
+std::string EvalBenchmarkResultsToJson(
+    absl::Span<const EvalBenchmarkResult> results) {
+  std::vector<std::string> benchmarks;
+  for (const EvalBenchmarkResult& result : results) {
+    std::string error;
+    if (result.error.has_value()) {
+      error = absl::StrCat(", \"error\": ", JsonString(*result.error));
+    }
+    benchmarks.push_back(absl::StrFormat(
+        "    {\"workload\": %s, \"engine\": %s, \"node_count\": %d, "
+        "\"samples\": %d, \"time_us\": %d,\n     \"samples_per_second\": %.1f, "
+        "\"ns_per_node\": %.3f%s}",
+        JsonString(result.workload), JsonString(result.engine),
+        result.node_count, result.samples,
+        absl::ToInt64Microseconds(result.duration), result.SamplesPerSecond(),
+        result.NsPerNode(), error));
+  }
+  return absl::StrFormat("{\"eval_benchmarks\": [\n%s\n]}\n",
+                         absl::StrJoin(benchmarks, ",\n"));
+}
+
+}  // namespace xls
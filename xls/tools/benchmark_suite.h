@@ -0,0 +1,166 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef XLS_TOOLS_BENCHMARK_SUITE_H_
+#define XLS_TOOLS_BENCHMARK_SUITE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+
+struct BenchmarkSuiteOptions {
+  int64_t opt_level = kMaxOptLevel;
+
+  // Scheduling and codegen are skipped if neither is given.
+  absl::optional<int64_t> clock_period_ps;
+  absl::optional<int64_t> pipeline_stages;
+  const DelayEstimator* delay_estimator = nullptr;
+
+  // Number of random argument sets the entry function is evaluated with by the
+  // JIT and the interpreter.
+  int64_t eval_iterations = 100;
+  int64_t seed = 0;
+};
+
+// The cost of one phase of the toolchain run on a design.
+struct BenchmarkPhase {
+  std::string name;
+  absl::Duration duration;
+  // Peak resident set size of the process at the end of the phase. This is a
+  // high-water mark over the whole process so it never decreases; its growth
+  // across a phase bounds the memory the phase needed.
+  int64_t peak_rss_bytes = 0;
+};
+
+struct BenchmarkResult {
+  // Name of the design, e.g., the path of its IR.
+  std::string name;
+  int64_t unoptimized_node_count = 0;
+  int64_t optimized_node_count = 0;
+  std::vector<BenchmarkPhase> phases;
+  // Set if a phase failed, in which case the later phases were not run.
+  absl::optional<std::string> error;
+};
+
+// Runs a design given as IR text through parsing, optimization, scheduling,
+// codegen, JIT compilation, and evaluation of the entry function with the JIT
+// and the interpreter, timing each phase. A failing phase is recorded in the
+// result's "error" rather than returned so a suite keeps going.
+BenchmarkResult RunBenchmark(absl::string_view name, absl::string_view ir_text,
+                             const BenchmarkSuiteOptions& options);
+
+// Returns the results as a JSON object of the form:
+//
+//   {"benchmarks": [{"name": "...", "unoptimized_node_count": N,
+//     "optimized_node_count": N, "error": "...",
+//     "phases": [{"name": "parse", "time_us": N, "peak_rss_bytes": N}, ...]},
+//    ...]}
+//
+// "error" is only present for failed benchmarks.
+std::string BenchmarkResultsToJson(absl::Span<const BenchmarkResult> results);
+
+// Evaluation benchmarks measure the steady-state throughput of the evaluation
+// engines on a workload, to catch performance regressions in the engines
+// themselves rather than in the toolchain.
+struct EvalBenchmarkOptions {
+  // Samples are taken until both minimums are reached, after one untimed
+  // warm-up sample.
+  absl::Duration min_time = absl::Milliseconds(500);
+  int64_t min_samples = 10;
+
+  // Number of random inputs generated up front and cycled through.
+  int64_t input_count = 64;
+  int64_t seed = 0;
+};
+
+// The throughput of one engine on one workload.
+struct EvalBenchmarkResult {
+  std::string workload;
+  // One of "jit", "interpreter", "proc_network_interpreter",
+  // "serial_proc_runtime" or "netlist_interpreter".
+  std::string engine;
+  // Number of IR nodes, or of cells for a netlist, evaluated per sample.
+  int64_t node_count = 0;
+  // A sample is a function invocation, a tick of a proc network, or an
+  // evaluation of a netlist module.
+  int64_t samples = 0;
+  absl::Duration duration;
+  absl::optional<std::string> error;
+
+  double SamplesPerSecond() const;
+  double NsPerNode() const;
+};
+
+// Benchmarks the entry function of the package in "ir_text" with the JIT and
+// the interpreter on random arguments.
+std::vector<EvalBenchmarkResult> RunFunctionEvalBenchmarks(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options);
+
+// Benchmarks ticking the procs of the package in "ir_text" with the proc
+// network interpreter and the serial proc runtime. The package must not have
+// receive-only channels, i.e., the network must drive itself.
+std::vector<EvalBenchmarkResult> RunProcEvalBenchmarks(
+    absl::string_view workload, absl::string_view ir_text,
+    const EvalBenchmarkOptions& options);
+
+// Benchmarks the netlist interpreter on the module "module_name" of
+// "netlist_text", which is written against the fake cell library (see
+// xls/netlist/fake_cell_library.h), with random inputs.
+EvalBenchmarkResult RunNetlistEvalBenchmark(
+    absl::string_view workload, absl::string_view netlist_text,
+    absl::string_view module_name, const EvalBenchmarkOptions& options);
+
+// Runs the built-in synthetic workloads: a select decoder, a proc pipeline
+// and the netlist of a ripple-carry adder.
+std::vector<EvalBenchmarkResult> RunSyntheticEvalBenchmarks(
+    const EvalBenchmarkOptions& options);
+
+// Returns IR of a function which decodes a selector of the given width into a
+// one-hot value and selects among 2^selector_width cases.
+std::string SelectDecoderIr(int64_t selector_width);
+
+// Returns IR of a self-driving pipeline of stateful procs: the first stage
+// produces values, each middle stage transforms them, and the last stage
+// accumulates them in its state.
+std::string ProcPipelineIr(int64_t stage_count);
+
+// Returns a netlist of a module "adder" adding two unsigned values of the
+// given width and a carry-in, built from the cells of the fake cell library.
+std::string RippleCarryAdderNetlist(int64_t bit_count);
+
+// Returns the results as a JSON object of the form:
+//
+//   {"eval_benchmarks": [{"workload": "...", "engine": "...",
+//     "node_count": N, "samples": N, "time_us": N,
+//     "samples_per_second": X, "ns_per_node": X, "error": "..."}, ...]}
+//
+// "error" is only present for failed benchmarks.
+std::string EvalBenchmarkResultsToJson(
+    absl::Span<const EvalBenchmarkResult> results);
+
+}  // namespace xls
+
+#endif  // XLS_TOOLS_BENCHMARK_SUITE_H_
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Copyright 2021 The XLS Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Runs benchmark_suite_main on the IR corpus given as arguments by the
+# benchmark_suite target. Additional flags, e.g., --output_json, are forwarded.
+exec ./xls/tools/benchmark_suite_main "$@"
@@ -0,0 +1,128 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Runs a corpus of IR designs through the toolchain (parse, optimize,
+// schedule, codegen, JIT compile, and JIT/interpreter evaluation) and emits
+// per-phase timings and peak RSS as JSON, for tracking toolchain performance
+// across releases.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/tools/benchmark_suite.h"
+
+const char kUsage[] = R"(
+Usage:
+  benchmark_suite_main [--output_json=results.json] <ir_path> [<ir_path>...]
+
+Paths ending in .opt.ir are skipped unless --include_optimized_inputs is given,
+as the suite optimizes each design itself.
+)";
+
+ABSL_FLAG(std::string, output_json, "",
+          "Path to write the JSON results to. If empty, they are written to "
+          "stdout.");
+ABSL_FLAG(int64_t, opt_level, xls::kMaxOptLevel,
+          "Optimization level of the standard pipeline.");
+ABSL_FLAG(int64_t, clock_period_ps, 0,
+          "Clock period to schedule for. If both this and --pipeline_stages "
+          "are zero, scheduling and codegen are skipped.");
+ABSL_FLAG(int64_t, pipeline_stages, 3,
+          "Number of pipeline stages to schedule into.");
+ABSL_FLAG(std::string, delay_model, "",
+          "Delay model name to use from registry. If empty, the standard "
+          "delay model is used.");
+ABSL_FLAG(int64_t, eval_iterations, 100,
+          "Number of random argument sets to evaluate the entry function with "
+          "in the JIT and the interpreter.");
+ABSL_FLAG(int64_t, seed, 0, "Seed for the random arguments.");
+ABSL_FLAG(bool, include_optimized_inputs, false,
+          "Also benchmark inputs whose paths end in .opt.ir.");
+
+namespace xls {
+namespace {
+
+absl::Status RealMain(absl::Span<const absl::string_view> paths) {
+  BenchmarkSuiteOptions options;
+  options.opt_level = absl::GetFlag(FLAGS_opt_level);
+  if (absl::GetFlag(FLAGS_clock_period_ps) > 0) {
+    options.clock_period_ps = absl::GetFlag(FLAGS_clock_period_ps);
+  }
+  if (absl::GetFlag(FLAGS_pipeline_stages) > 0) {
+    options.pipeline_stages = absl::GetFlag(FLAGS_pipeline_stages);
+  }
+  if (absl::GetFlag(FLAGS_delay_model).empty()) {
+    options.delay_estimator = &GetStandardDelayEstimator();
+  } else {
+    XLS_ASSIGN_OR_RETURN(options.delay_estimator,
+                         GetDelayEstimator(absl::GetFlag(FLAGS_delay_model)));
+  }
+  options.eval_iterations = absl::GetFlag(FLAGS_eval_iterations);
+  options.seed = absl::GetFlag(FLAGS_seed);
+
+  std::vector<BenchmarkResult> results;
+  int64_t failures = 0;
+  for (absl::string_view path : paths) {
+    if (absl::EndsWith(path, ".opt.ir") &&
+        !absl::GetFlag(FLAGS_include_optimized_inputs)) {
+      continue;
+    }
+    XLS_LOG(INFO) << "Benchmarking " << path;
+    XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(path));
+    results.push_back(RunBenchmark(path, ir_text, options));
+    if (results.back().error.has_value()) {
+      XLS_LOG(ERROR) << path << " failed: " << *results.back().error;
+      ++failures;
+    }
+  }
+
+  std::string json = BenchmarkResultsToJson(results);
+  if (absl::GetFlag(FLAGS_output_json).empty()) {
+    std::cout << json;
+  } else {
+    XLS_RETURN_IF_ERROR(
+        SetFileContents(absl::GetFlag(FLAGS_output_json), json));
+  }
+  if (failures > 0) {
+    return absl::InternalError(
+        absl::StrFormat("%d of %d benchmarks failed", failures,
+                        results.size()));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  if (positional_arguments.empty()) {
+    XLS_LOG(QFATAL) << "Expected at least one IR path: " << argv[0]
+                    << " <ir_path>...";
+  }
+  XLS_QCHECK_OK(xls::RealMain(positional_arguments));
+  return EXIT_SUCCESS;
+}
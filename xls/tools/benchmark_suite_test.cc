@@ -0,0 +1,186 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "xls/tools/benchmark_suite.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/delay_model/delay_estimators.h"
+
+namespace xls {
+namespace {
+
+using testing::AllOf;
+using testing::Contains;
+using testing::Each;
+using testing::ElementsAre;
+using testing::Field;
+using testing::HasSubstr;
+using testing::Not;
+
+constexpr char kIr[] = R"(
+package p
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  zero: bits[8] = literal(value=0)
+  y_plus_zero: bits[8] = add(y, zero)
+  ret add.4: bits[8] = add(x, y_plus_zero)
+}
+)";
+
+TEST(BenchmarkSuiteTest, RunsAllPhases) {
+  BenchmarkSuiteOptions options;
+  options.pipeline_stages = 2;
+  options.delay_estimator = &GetStandardDelayEstimator();
+  options.eval_iterations = 10;
+  BenchmarkResult result = RunBenchmark("add", kIr, options);
+  EXPECT_FALSE(result.error.has_value()) << *result.error;
+  EXPECT_EQ(result.name, "add");
+  EXPECT_EQ(result.unoptimized_node_count, 5);
+  EXPECT_LT(result.optimized_node_count, result.unoptimized_node_count);
+  EXPECT_THAT(result.phases,
+              ElementsAre(Field(&BenchmarkPhase::name, "parse"),
+                          Field(&BenchmarkPhase::name, "optimize"),
+                          Field(&BenchmarkPhase::name, "schedule"),
+                          Field(&BenchmarkPhase::name, "codegen"),
+                          Field(&BenchmarkPhase::name, "jit_compile"),
+                          Field(&BenchmarkPhase::name, "jit_run"),
+                          Field(&BenchmarkPhase::name, "interpreter_run")));
+}
+
+TEST(BenchmarkSuiteTest, SkipsSchedulingWithoutTarget) {
+  BenchmarkSuiteOptions options;
+  options.eval_iterations = 1;
+  BenchmarkResult result = RunBenchmark("add", kIr, options);
+  EXPECT_FALSE(result.error.has_value());
+  EXPECT_THAT(result.phases,
+              Not(Contains(Field(&BenchmarkPhase::name, "schedule"))));
+}
+
+TEST(BenchmarkSuiteTest, FailureStopsAtPhase) {
+  BenchmarkResult result =
+      RunBenchmark("bad", "package p\nfn", BenchmarkSuiteOptions());
+  ASSERT_TRUE(result.error.has_value());
+  EXPECT_THAT(*result.error, HasSubstr("parse: "));
+  EXPECT_THAT(result.phases,
+              ElementsAre(Field(&BenchmarkPhase::name, "parse")));
+}
+
+TEST(BenchmarkSuiteTest, Json) {
+  BenchmarkResult ok;
+  ok.name = "a\"b";
+  ok.unoptimized_node_count = 10;
+  ok.optimized_node_count = 4;
+  ok.phases.push_back(BenchmarkPhase{.name = "parse",
+                                     .duration = absl::Microseconds(42),
+                                     .peak_rss_bytes = 1024});
+  BenchmarkResult failed;
+  failed.name = "c";
+  failed.error = "parse: bad\ninput";
+  std::string json = BenchmarkResultsToJson({ok, failed});
+  EXPECT_EQ(json,
+            "{\"benchmarks\": [\n"
+            "    {\"name\": \"a\\\"b\", \"unoptimized_node_count\": 10, "
+            "\"optimized_node_count\": 4,\n"
+            "     \"phases\": [{\"name\": \"parse\", \"time_us\": 42, "
+            "\"peak_rss_bytes\": 1024}]},\n"
+            "    {\"name\": \"c\", \"unoptimized_node_count\": 0, "
+            "\"optimized_node_count\": 0, \"error\": \"parse: bad\\ninput\",\n"
+            "     \"phases\": []}\n"
+            "]}\n");
+}
+
+EvalBenchmarkOptions QuickEvalOptions() {
+  EvalBenchmarkOptions options;
+  options.min_time = absl::ZeroDuration();
+  options.min_samples = 3;
+  options.input_count = 2;
+  return options;
+}
+
+MATCHER(EvalSucceeded, "") {
+  if (arg.error.has_value()) {
+    *result_listener << "failed: " << *arg.error;
+    return false;
+  }
+  return arg.samples >= 3 && arg.node_count > 0 && arg.SamplesPerSecond() > 0;
+}
+
+TEST(BenchmarkSuiteTest, EvalFunction) {
+  EXPECT_THAT(
+      RunFunctionEvalBenchmarks("add", kIr, QuickEvalOptions()),
+      ElementsAre(AllOf(Field(&EvalBenchmarkResult::engine, "jit"),
+                        Field(&EvalBenchmarkResult::node_count, 5),
+                        EvalSucceeded()),
+                  AllOf(Field(&EvalBenchmarkResult::engine, "interpreter"),
+                        EvalSucceeded())));
+  EXPECT_THAT(
+      RunFunctionEvalBenchmarks("decoder", SelectDecoderIr(3),
+                                QuickEvalOptions()),
+      Each(EvalSucceeded()));
+}
+
+TEST(BenchmarkSuiteTest, EvalProcs) {
+  EXPECT_THAT(
+      RunProcEvalBenchmarks("pipeline", ProcPipelineIr(3), QuickEvalOptions()),
+      ElementsAre(AllOf(Field(&EvalBenchmarkResult::engine,
+                              "proc_network_interpreter"),
+                        EvalSucceeded()),
+                  AllOf(Field(&EvalBenchmarkResult::engine,
+                              "serial_proc_runtime"),
+                        EvalSucceeded())));
+}
+
+TEST(BenchmarkSuiteTest, EvalNetlist) {
+  EvalBenchmarkResult result = RunNetlistEvalBenchmark(
+      "adder", RippleCarryAdderNetlist(4), "adder", QuickEvalOptions());
+  EXPECT_THAT(result, EvalSucceeded());
+  EXPECT_EQ(result.node_count, 20);
+
+  result = RunNetlistEvalBenchmark("adder", RippleCarryAdderNetlist(4),
+                                   "missing", QuickEvalOptions());
+  EXPECT_TRUE(result.error.has_value());
+  EXPECT_EQ(result.samples, 0);
+}
+
+TEST(BenchmarkSuiteTest, EvalJson) {
+  EvalBenchmarkResult ok;
+  ok.workload = "w";
+  ok.engine = "jit";
+  ok.node_count = 4;
+  ok.samples = 1000;
+  ok.duration = absl::Microseconds(2000);
+  EvalBenchmarkResult failed;
+  failed.workload = "x";
+  failed.engine = "interpreter";
+  failed.error = "bad";
+  EXPECT_EQ(EvalBenchmarkResultsToJson({ok, failed}),
+            "{\"eval_benchmarks\": [\n"
+            "    {\"workload\": \"w\", \"engine\": \"jit\", "
+            "\"node_count\": 4, \"samples\": 1000, \"time_us\": 2000,\n"
+            "     \"samples_per_second\": 500000.0, "
+            "\"ns_per_node\": 500.000},\n"
+            "    {\"workload\": \"x\", \"engine\": \"interpreter\", "
+            "\"node_count\": 0, \"samples\": 0, \"time_us\": 0,\n"
+            "     \"samples_per_second\": 0.0, \"ns_per_node\": 0.000, "
+            "\"error\": \"bad\"}\n"
+            "]}\n");
+}
+
+}  // namespace
+}  // namespace xls
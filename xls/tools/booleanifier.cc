@@ -18,6 +18,7 @@
 #include "xls/tools/booleanifier.h"
 
 #include <filesystem>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "xls/common/logging/logging.h"
@@ -32,6 +33,12 @@ namespace xls {
 
 // Evaluator for converting Nodes representing high-level Ops into
 // single-bit AND/OR/NOT-based ones.
+//
+// Gates are structurally hashed as in an and-inverter graph: a gate whose
+// (commutatively ordered) operands match an existing gate reuses it, and
+// gates with constant, identical or complementary operands fold away. This
+// keeps wide arithmetic, whose bit-level expansion repeats many
+// subexpressions, from bloating the generated function.
 class BitEvaluator : public AbstractEvaluator<Node*, BitEvaluator> {
  public:
   BitEvaluator(FunctionBuilder* builder)
@@ -42,19 +49,79 @@ class BitEvaluator : public AbstractEvaluator<Node*, BitEvaluator> {
   Node* One() const { return one_.node(); }
   Node* Zero() const { return zero_.node(); }
   Node* Not(Node* const& input) const {
-    return builder_->Not(BValue(input, builder_)).node();
+    if (input == One()) {
+      return Zero();
+    }
+    if (input == Zero()) {
+      return One();
+    }
+    auto it = complements_.find(input);
+    if (it != complements_.end()) {
+      return it->second;
+    }
+    Node* result = builder_->Not(BValue(input, builder_)).node();
+    complements_[input] = result;
+    complements_[result] = input;
+    return result;
   }
   Node* And(Node* const& a, Node* const& b) const {
-    return builder_->And(BValue(a, builder_), BValue(b, builder_)).node();
+    if (a == Zero() || b == Zero() || AreComplements(a, b)) {
+      return Zero();
+    }
+    if (a == One() || a == b) {
+      return b;
+    }
+    if (b == One()) {
+      return a;
+    }
+    return HashedGate(Op::kAnd, a, b, &ands_);
   }
   Node* Or(Node* const& a, Node* const& b) const {
-    return builder_->Or(BValue(a, builder_), BValue(b, builder_)).node();
+    if (a == One() || b == One() || AreComplements(a, b)) {
+      return One();
+    }
+    if (a == Zero() || a == b) {
+      return b;
+    }
+    if (b == Zero()) {
+      return a;
+    }
+    return HashedGate(Op::kOr, a, b, &ors_);
   }
 
  private:
+  using GateTable = absl::flat_hash_map<std::pair<Node*, Node*>, Node*>;
+
+  bool AreComplements(Node* a, Node* b) const {
+    auto it = complements_.find(a);
+    return it != complements_.end() && it->second == b;
+  }
+
+  // Returns the existing gate of the given op over "a" and "b", creating it
+  // if there is none.
+  Node* HashedGate(Op op, Node* a, Node* b, GateTable* table) const {
+    if (a->id() > b->id()) {
+      std::swap(a, b);
+    }
+    auto [it, inserted] = table->insert({{a, b}, nullptr});
+    if (inserted) {
+      BValue bv_a(a, builder_);
+      BValue bv_b(b, builder_);
+      it->second = (op == Op::kAnd ? builder_->And(bv_a, bv_b)
+                                   : builder_->Or(bv_a, bv_b))
+                       .node();
+    }
+    return it->second;
+  }
+
   FunctionBuilder* builder_;
   BValue one_;
   BValue zero_;
+  // The evaluator interface is const, so the structural hash tables are
+  // mutable. Each node created by Not() maps to its input and vice versa.
+  mutable absl::flat_hash_map<Node*, Node*> complements_;
+  mutable GateTable ands_;
+  mutable GateTable ors_;
 };
 
 absl::StatusOr<Function*> Booleanifier::Booleanify(
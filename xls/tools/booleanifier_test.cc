@@ -134,6 +134,48 @@ fn main(a: (bits[2], bits[3], bits[4]), b: (bits[2], bits[3], bits[4])) -> (bits
   }
 }
 
+int64_t CountGates(Function* f) {
+  int64_t count = 0;
+  for (Node* node : f->nodes()) {
+    if (node->op() == Op::kAnd || node->op() == Op::kOr ||
+        node->op() == Op::kNot) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Identical gates are shared and gates over constant or complementary inputs
+// fold away.
+TEST_F(BooleanifierTest, StructurallyHashesGates) {
+  const std::string kIrText = R"(
+package p
+
+fn main(x: bits[8], y: bits[8]) -> (bits[8], bits[8], bits[8], bits[8]) {
+  a: bits[8] = and(x, y)
+  b: bits[8] = and(y, x)
+  zero: bits[8] = xor(a, b)
+  nn: bits[8] = not(x)
+  nnn: bits[8] = not(nn)
+  ret result: (bits[8], bits[8], bits[8], bits[8]) = tuple(a, b, zero, nnn)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(FunctionData fd, GetFunctionData(kIrText, "main"));
+  // "b" reuses the eight ANDs of "a", "zero" folds to literals after negating
+  // "a", and the double negation folds back to x after negating x once.
+  EXPECT_EQ(CountGates(fd.boolified), 8 + 8 + 8);
+  XLS_ASSERT_OK_AND_ASSIGN(auto fancy_jit, IrJit::Create(fd.source));
+  XLS_ASSERT_OK_AND_ASSIGN(auto basic_jit, IrJit::Create(fd.boolified));
+  for (int i = 0; i < 256; i += 7) {
+    for (int j = 0; j < 256; j += 5) {
+      std::vector<Value> inputs = {Value(UBits(i, 8)), Value(UBits(j, 8))};
+      XLS_ASSERT_OK_AND_ASSIGN(Value fancy_value, fancy_jit->Run(inputs));
+      XLS_ASSERT_OK_AND_ASSIGN(Value basic_value, basic_jit->Run(inputs));
+      ASSERT_EQ(fancy_value, basic_value);
+    }
+  }
+}
+
 TEST_F(BooleanifierTest, BooleanFunctionName) {
   auto p = CreatePackage();
   FunctionBuilder fb("foo", p.get());
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <thread>  // NOLINT(build/c++11)
+#include <algorithm>
+#include <string>
+#include <vector>
 
 #include "absl/base/internal/sysinfo.h"
 #include "absl/flags/flag.h"
@@ -27,16 +29,14 @@
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
+#include "xls/ir/value.h"
 #include "xls/passes/dce_pass.h"
 #include "xls/passes/inlining_pass.h"
 #include "xls/passes/map_inlining_pass.h"
 #include "xls/passes/pass_base.h"
 #include "xls/passes/passes.h"
 #include "xls/passes/unroll_pass.h"
-#include "xls/solvers/z3_ir_translator.h"
-#include "xls/solvers/z3_utils.h"
-#include "../z3/src/api/z3.h"
-#include "../z3/src/api/z3_api.h"
+#include "xls/tools/ir_equivalence.h"
 
 const char kUsage[] = R"(
 Verifies that the two provided XLS IR files are logically equivalent; that is,
@@ -56,29 +56,46 @@ ABSL_FLAG(std::string, function, "",
           "and check an entry function for the package.");
 ABSL_FLAG(absl::Duration, timeout, absl::InfiniteDuration(),
           "How long to wait for any proof to complete.");
+ABSL_FLAG(std::string, solver, "z3",
+          "The equivalence-checking strategy: one of \"z3\", \"z3_qfbv\", "
+          "\"z3_bitblast\", \"sat\", \"bdd\" or \"simulation\" (see "
+          "xls/tools/ir_equivalence.h), or \"portfolio\" to run several "
+          "strategies concurrently and report the first conclusive result. "
+          "The bit-blasting strategies only support bits-typed parameters and "
+          "return values; otherwise the tool falls back to \"z3\".");
+ABSL_FLAG(std::vector<std::string>, portfolio_strategies,
+          xls::EquivalenceStrategyNames(),
+          "Comma-separated strategies run by --solver=portfolio.");
+ABSL_FLAG(int64_t, simulation_vectors, 4096,
+          "Number of random argument sets to evaluate (JIT-compiled, along "
+          "with corner cases) before invoking any solver. A mismatch found "
+          "this way is reported immediately. 0 disables simulation.");
 
 namespace xls {
 
-using solvers::z3::IrTranslator;
-
-// To compare, simply take the output nodes of each function and compare them.
-absl::StatusOr<Z3_ast> CreateComparisonFunction(
-    absl::Span<std::unique_ptr<IrTranslator>> translators,
-    const std::vector<Function*>& functions) {
-  Z3_context ctx = translators[0]->ctx();
-  Z3_ast result1 = translators[0]->GetReturnNode();
-  Z3_ast result2 = translators[1]->GetReturnNode();
-
-  Z3_sort opt_sort = Z3_get_sort(ctx, result1);
-  Z3_sort unopt_sort = Z3_get_sort(ctx, result2);
-  XLS_RET_CHECK(Z3_is_eq_sort(ctx, opt_sort, unopt_sort));
-
-  return Z3_mk_eq(ctx, result1, result2);
+void PrintResult(const EquivalenceResult& result, Function* function,
+                 bool print_strategy) {
+  std::cout << result.details << std::endl;
+  if (result.counterexample.has_value()) {
+    std::cout << "  Counterexample:" << std::endl;
+    for (int64_t i = 0; i < function->params().size(); ++i) {
+      std::cout << "    " << function->params()[i]->GetName() << " = "
+                << result.counterexample->at(i).ToString(
+                       FormatPreference::kHex)
+                << std::endl;
+    }
+    std::cout << std::endl;
+  }
+  if (print_strategy) {
+    std::cout << "Strategy: " << result.strategy << " ("
+              << absl::FormatDuration(result.duration) << ")" << std::endl;
+  }
 }
 
 absl::Status RealMain(const std::vector<absl::string_view>& ir_paths,
                       const std::string& entry_function,
-                      absl::Duration timeout) {
+                      absl::Duration timeout, const std::string& solver_name,
+                      int64_t simulation_vectors) {
   std::vector<std::unique_ptr<Package>> packages;
   for (const auto ir_path : ir_paths) {
     XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
@@ -121,45 +138,35 @@ absl::Status RealMain(const std::vector<absl::string_view>& ir_paths,
     }
   }
 
-  std::vector<std::unique_ptr<IrTranslator>> translators;
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrTranslator> translator,
-                       IrTranslator::CreateAndTranslate(functions[0]));
-  translators.push_back(std::move(translator));
-
-  // Get the params for the first function, so we can map the second function's
-  // parameters to them.
-  Z3_context ctx = translators[0]->ctx();
-  std::vector<Z3_ast> z3_params;
-  for (const Param* param : functions[0]->params()) {
-    z3_params.push_back(translators[0]->GetTranslation(param));
+  if (simulation_vectors > 0 && solver_name != "simulation") {
+    absl::StatusOr<EquivalenceResult> result =
+        RunSimulationPrefilter(functions[0], functions[1], simulation_vectors);
+    if (!result.ok()) {
+      XLS_LOG(WARNING) << "Skipping simulation: " << result.status();
+    } else if (result->status == EquivalenceStatus::kNotEquivalent) {
+      PrintResult(*result, functions[0], /*print_strategy=*/true);
+      return absl::OkStatus();
+    }
   }
 
-  XLS_ASSIGN_OR_RETURN(
-      translator, IrTranslator::CreateAndTranslate(ctx, functions[1],
-                                                   absl::MakeSpan(z3_params)));
-  translators.push_back(std::move(translator));
-
-  XLS_ASSIGN_OR_RETURN(
-      Z3_ast results_equal,
-      CreateComparisonFunction(absl::MakeSpan(translators), functions));
-  translators[0]->SetTimeout(timeout);
-
-  Z3_solver solver =
-      solvers::z3::CreateSolver(ctx, std::thread::hardware_concurrency());
-
-  // Remember: we try to prove the condition by searching for a model that
-  // produces the opposite result. Thus, we want to find a model where the
-  // results are _not_ equal.
-  Z3_ast objective = Z3_mk_eq(ctx, Z3_mk_false(ctx), results_equal);
-  Z3_solver_assert(ctx, solver, objective);
-
-  // Finally, print the output to the terminal in gorgeous two-color ASCII.
-  Z3_lbool satisfiable = Z3_solver_check(ctx, solver);
-  std::cout << solvers::z3::SolverResultToString(ctx, solver, satisfiable)
-            << std::endl;
-
-  Z3_solver_dec_ref(ctx, solver);
+  if (solver_name == "portfolio") {
+    XLS_ASSIGN_OR_RETURN(
+        EquivalenceResult result,
+        CheckEquivalencePortfolio(functions[0], functions[1],
+                                  absl::GetFlag(FLAGS_portfolio_strategies),
+                                  timeout));
+    PrintResult(result, functions[0], /*print_strategy=*/true);
+    return absl::OkStatus();
+  }
 
+  absl::StatusOr<EquivalenceResult> result =
+      CheckEquivalence(functions[0], functions[1], solver_name, timeout);
+  if (absl::IsUnimplemented(result.status()) && solver_name != "z3") {
+    XLS_LOG(WARNING) << "Falling back to Z3: " << result.status().message();
+    result = CheckEquivalence(functions[0], functions[1], "z3", timeout);
+  }
+  XLS_RETURN_IF_ERROR(result.status());
+  PrintResult(*result, functions[0], /*print_strategy=*/false);
   return absl::OkStatus();
 }
 
@@ -169,6 +176,14 @@ int main(int argc, char** argv) {
   std::vector<absl::string_view> positional_args =
       xls::InitXls(kUsage, argc, argv);
   XLS_QCHECK_EQ(positional_args.size(), 2) << "Two IR files must be specified!";
+  std::string solver = absl::GetFlag(FLAGS_solver);
+  std::vector<std::string> strategies = xls::EquivalenceStrategyNames();
+  XLS_QCHECK(solver == "portfolio" ||
+             std::find(strategies.begin(), strategies.end(), solver) !=
+                 strategies.end())
+      << "--solver must be \"portfolio\" or one of: "
+      << absl::StrJoin(strategies, ", ");
   XLS_QCHECK_OK(xls::RealMain(positional_args, absl::GetFlag(FLAGS_function),
-                              absl::GetFlag(FLAGS_timeout)));
+                              absl::GetFlag(FLAGS_timeout), solver,
+                              absl::GetFlag(FLAGS_simulation_vectors)));
 }
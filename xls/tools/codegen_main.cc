@@ -12,21 +12,33 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "xls/codegen/codegen_cache.h"
 #include "xls/codegen/combinational_generator.h"
+#include "xls/codegen/inlining_cost_model.h"
 #include "xls/codegen/module_signature.pb.h"
 #include "xls/codegen/pipeline_generator.h"
+#include "xls/codegen/resource_shared_generator.h"
+#include "xls/codegen/verilog_sink.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/ir/op.h"
 #include "xls/passes/standard_pipeline.h"
 #include "xls/scheduling/pipeline_schedule.h"
 #include "xls/scheduling/scheduling_pass.h"
@@ -44,13 +56,20 @@ Emit a feed-forward pipelined module:
        --clock_period_ps=500 \
        --pipeline_stages=7 \
        IR_FILE
+
+Emit a multi-cycle module sharing a single multiplier:
+   codegen_main --generator=resource_shared \
+       --resource_limits=umul=1 \
+       --reset=rst \
+       IR_FILE
 )";
 
 ABSL_FLAG(int64_t, clock_period_ps, 0, "Target clock period, in picoseconds.");
 ABSL_FLAG(int64_t, pipeline_stages, 0,
           "The number of stages in the generated pipeline.");
 ABSL_FLAG(std::string, delay_model, "",
-          "Delay model name to use from registry.");
+          "Delay model name to use from registry, or the path of a DelayModel "
+          "text proto file ending in .textproto to load.");
 ABSL_FLAG(
     std::string, output_verilog_path, "",
     "Specific output path for the Verilog generated. If not specified then "
@@ -58,6 +77,12 @@ ABSL_FLAG(
 ABSL_FLAG(std::string, output_schedule_path, "",
           "Specific output path for the generated pipeline schedule. "
           "If not specified, then no schedule is output.");
+ABSL_FLAG(std::string, warm_start_schedule_path, "",
+          "Path of a pipeline schedule (text proto, as written by "
+          "--output_schedule_path) of a previous version of the function. "
+          "Nodes with the same names are kept in the same stages where that "
+          "is feasible. Requires --scheduling_strategy=minimize_registers or "
+          "multiway.");
 ABSL_FLAG(
     std::string, output_signature_path, "",
     "Specific output path for the module signature. If not specified then "
@@ -65,7 +90,7 @@ ABSL_FLAG(
 ABSL_FLAG(std::string, entry, "", "Entry function for the package.");
 ABSL_FLAG(std::string, generator, "pipeline",
           "The generator to use when emitting the device function. Valid "
-          "values: pipeline, combinational.");
+          "values: pipeline, combinational, resource_shared.");
 ABSL_FLAG(
     std::string, input_valid_signal, "",
     "If specified, the emitted module will use an external \"valid\" signal "
@@ -89,6 +114,27 @@ ABSL_FLAG(bool, flop_outputs, true,
 ABSL_FLAG(std::string, module_name, "",
           "Explicit name to use for the generated module; if not provided the "
           "mangled IR function name is used");
+ABSL_FLAG(std::string, scheduling_strategy, "minimize_registers",
+          "The strategy used to schedule the pipeline. Valid values: "
+          "minimize_registers (iterated min-cut), multiway (refinement across "
+          "all stage boundaries at once, for deep pipelines), sdc (system of "
+          "difference constraints), modulo (operator sharing with --initiation_interval "
+          "greater than one).");
+ABSL_FLAG(std::string, retiming, "none",
+          "Objective of retiming the pipeline registers after scheduling by "
+          "moving nodes across stage boundaries. Valid values: none, "
+          "min_stage_delay (shorten the longest stage), min_registers "
+          "(reduce register bits within the clock period).");
+ABSL_FLAG(int64_t, initiation_interval, 1,
+          "The number of cycles between successive inputs of the pipeline. "
+          "Values greater than one require --scheduling_strategy=modulo and "
+          "--reset.");
+ABSL_FLAG(std::string, resource_limits, "",
+          "Comma-separated list of op=count pairs giving the number of "
+          "operator instances available to the op with "
+          "--scheduling_strategy=modulo, e.g. \"umul=1,udiv=1\", or the "
+          "number of functional units of the op with "
+          "--generator=resource_shared.");
 ABSL_FLAG(int64_t, clock_margin_percent, 0,
           "The percentage of clock period to set aside as a margin to ensure "
           "timing is met. Effectively, this lowers the clock period by this "
@@ -104,16 +150,105 @@ ABSL_FLAG(bool, reset_asynchronous, false,
           "Whether the reset signal is asynchronous.");
 ABSL_FLAG(bool, use_system_verilog, true,
           "If true, emit SystemVerilog otherwise emit Verilog.");
+ABSL_FLAG(int64_t, stage_emission_threads, 1,
+          "Number of threads with which to emit the pipeline stages. Only "
+          "used with the pipeline generator.");
+ABSL_FLAG(std::string, inlining_strategy, "default",
+          "Strategy for choosing which values are emitted as named "
+          "temporaries rather than inline expressions: default, readability "
+          "or simulation_speed. Only used with the pipeline generator.");
+ABSL_FLAG(std::string, clock_gate_cell, "",
+          "If specified, gate the clock of the pipeline registers of each "
+          "stage by their load enable through instances of this clock-gating "
+          "cell, given as its module name optionally followed by the names of "
+          "its clock, enable and gated clock ports, e.g. "
+          "\"icg,CK,E,GCK\". Requires pipeline register control.");
+ABSL_FLAG(std::string, codegen_cache_dir, "",
+          "If specified, the directory of a persistent cache of generated "
+          "modules keyed by the IR of the function (and the functions it "
+          "calls), its schedule and the codegen options. An unchanged function "
+          "gets byte-identical module text loaded from the cache rather than "
+          "regenerated. The directory must be cleared when XLS is updated.");
+ABSL_FLAG(std::string, trace_file, "",
+          "If specified, record timing spans of parsing, scheduling and "
+          "Verilog generation and write them to this path in the Chrome "
+          "trace event format (viewable in chrome://tracing or Perfetto).");
 
 namespace xls {
 namespace {
 
+// Parses the --resource_limits flag.
+absl::StatusOr<absl::flat_hash_map<Op, int64_t>> ParseResourceLimits() {
+  absl::flat_hash_map<Op, int64_t> resource_limits;
+  if (absl::GetFlag(FLAGS_resource_limits).empty()) {
+    return resource_limits;
+  }
+  for (absl::string_view limit :
+       absl::StrSplit(absl::GetFlag(FLAGS_resource_limits), ',')) {
+    std::vector<absl::string_view> op_and_count = absl::StrSplit(limit, '=');
+    int64_t count;
+    if (op_and_count.size() != 2 ||
+        !absl::SimpleAtoi(op_and_count[1], &count)) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid resource limit: \"%s\"", limit));
+    }
+    XLS_ASSIGN_OR_RETURN(Op op, StringToOp(op_and_count[0]));
+    resource_limits[op] = count;
+  }
+  return resource_limits;
+}
+
+// Returns the text of the flags besides the schedule which the generated module
+// depends on, for keying the codegen cache.
+std::string CodegenOptionsText() {
+  return absl::StrFormat(
+      "generator=%s module_name=%s use_system_verilog=%d "
+      "input_valid_signal=%s output_valid_signal=%s "
+      "manual_load_enable_signal=%s flop_inputs=%d flop_outputs=%d reset=%s "
+      "reset_active_low=%d reset_asynchronous=%d inlining_strategy=%s "
+      "clock_gate_cell=%s resource_limits=%s",
+      absl::GetFlag(FLAGS_generator), absl::GetFlag(FLAGS_module_name),
+      absl::GetFlag(FLAGS_use_system_verilog),
+      absl::GetFlag(FLAGS_input_valid_signal),
+      absl::GetFlag(FLAGS_output_valid_signal),
+      absl::GetFlag(FLAGS_manual_load_enable_signal),
+      absl::GetFlag(FLAGS_flop_inputs), absl::GetFlag(FLAGS_flop_outputs),
+      absl::GetFlag(FLAGS_reset), absl::GetFlag(FLAGS_reset_active_low),
+      absl::GetFlag(FLAGS_reset_asynchronous),
+      absl::GetFlag(FLAGS_inlining_strategy),
+      absl::GetFlag(FLAGS_clock_gate_cell),
+      absl::GetFlag(FLAGS_resource_limits));
+}
+
+// Returns the module generated by "generate", loading it from "cache" (if
+// given) when "main" was generated with the same schedule and options before.
+absl::StatusOr<verilog::ModuleGeneratorResult> GenerateCached(
+    verilog::CodegenCache* cache, Function* main, absl::string_view schedule,
+    const std::function<absl::StatusOr<verilog::ModuleGeneratorResult>()>&
+        generate) {
+  if (cache == nullptr) {
+    return generate();
+  }
+  std::string key =
+      verilog::CodegenCache::GetKey(main, schedule, CodegenOptionsText());
+  absl::optional<verilog::ModuleGeneratorResult> cached = cache->Load(key);
+  if (cached.has_value()) {
+    XLS_VLOG(1) << "Loaded module from codegen cache: " << key;
+    return *std::move(cached);
+  }
+  XLS_ASSIGN_OR_RETURN(verilog::ModuleGeneratorResult result, generate());
+  cache->Store(key, result);
+  return result;
+}
+
 absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
                       absl::string_view signature_path,
                       absl::string_view schedule_path) {
-  XLS_ASSIGN_OR_RETURN(std::string ir_contents, GetFileContents(ir_path));
+  if (!absl::GetFlag(FLAGS_trace_file).empty()) {
+    StartTracing();
+  }
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> p,
-                       Parser::ParsePackage(ir_contents, ir_path));
+                       Parser::ParsePackageFile(std::string(ir_path)));
 
   Function* main;
   if (absl::GetFlag(FLAGS_entry).empty()) {
@@ -122,6 +257,26 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
     XLS_ASSIGN_OR_RETURN(main, p->GetFunction(absl::GetFlag(FLAGS_entry)));
   }
 
+  // Stream the Verilog to the output file as it is emitted rather than
+  // building the text of the whole file in memory.
+  std::unique_ptr<verilog::FileVerilogSink> verilog_sink;
+  if (!verilog_path.empty()) {
+    XLS_ASSIGN_OR_RETURN(
+        verilog_sink,
+        verilog::FileVerilogSink::Create(std::string(verilog_path)));
+  }
+
+  // With a cache, the text of each module is generated into memory (to be
+  // stored) and written out afterwards.
+  std::unique_ptr<verilog::CodegenCache> cache;
+  if (!absl::GetFlag(FLAGS_codegen_cache_dir).empty()) {
+    cache = absl::make_unique<verilog::CodegenCache>(
+        absl::GetFlag(FLAGS_codegen_cache_dir));
+  }
+  verilog::VerilogSink* generator_sink =
+      cache == nullptr ? verilog_sink.get() : nullptr;
+  bool streamed = false;
+
   verilog::ModuleGeneratorResult result;
   if (absl::GetFlag(FLAGS_generator) == "pipeline") {
     XLS_QCHECK(absl::GetFlag(FLAGS_pipeline_stages) != 0 ||
@@ -129,6 +284,37 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
         << "Musts specify --pipeline_stages or --clock_period_ps (or both).";
 
     SchedulingPassOptions sched_options;
+    if (absl::GetFlag(FLAGS_scheduling_strategy) == "sdc") {
+      sched_options.scheduling_options =
+          SchedulingOptions(SchedulingStrategy::SDC);
+    } else if (absl::GetFlag(FLAGS_scheduling_strategy) == "multiway") {
+      sched_options.scheduling_options =
+          SchedulingOptions(SchedulingStrategy::MULTIWAY_PARTITION);
+    } else if (absl::GetFlag(FLAGS_scheduling_strategy) == "modulo") {
+      sched_options.scheduling_options =
+          SchedulingOptions(SchedulingStrategy::MODULO);
+    } else {
+      XLS_QCHECK_EQ(absl::GetFlag(FLAGS_scheduling_strategy),
+                    "minimize_registers")
+          << "Invalid --scheduling_strategy.";
+    }
+    if (absl::GetFlag(FLAGS_retiming) == "min_stage_delay") {
+      sched_options.scheduling_options.retiming_objective(
+          RetimingObjective::MIN_STAGE_DELAY);
+    } else if (absl::GetFlag(FLAGS_retiming) == "min_registers") {
+      sched_options.scheduling_options.retiming_objective(
+          RetimingObjective::MIN_REGISTERS);
+    } else {
+      XLS_QCHECK_EQ(absl::GetFlag(FLAGS_retiming), "none")
+          << "Invalid --retiming.";
+    }
+    sched_options.scheduling_options.initiation_interval(
+        absl::GetFlag(FLAGS_initiation_interval));
+    XLS_ASSIGN_OR_RETURN(auto resource_limits, ParseResourceLimits());
+    for (const auto& op_and_count : resource_limits) {
+      sched_options.scheduling_options.resource_limit(op_and_count.first,
+                                                      op_and_count.second);
+    }
     if (absl::GetFlag(FLAGS_pipeline_stages) != 0) {
       sched_options.scheduling_options.pipeline_stages(
           absl::GetFlag(FLAGS_pipeline_stages));
@@ -141,6 +327,12 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
       sched_options.scheduling_options.clock_margin_percent(
           absl::GetFlag(FLAGS_clock_margin_percent));
     }
+    if (!absl::GetFlag(FLAGS_warm_start_schedule_path).empty()) {
+      XLS_ASSIGN_OR_RETURN(PipelineScheduleProto previous,
+                           ParseTextProtoFile<PipelineScheduleProto>(
+                               absl::GetFlag(FLAGS_warm_start_schedule_path)));
+      sched_options.scheduling_options.warm_start(std::move(previous));
+    }
     XLS_ASSIGN_OR_RETURN(sched_options.delay_estimator,
                          GetDelayEstimator(absl::GetFlag(FLAGS_delay_model)));
     std::unique_ptr<SchedulingCompoundPass> scheduling_pipeline =
@@ -184,6 +376,31 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
     }
     pipeline_options.flop_inputs(absl::GetFlag(FLAGS_flop_inputs));
     pipeline_options.flop_outputs(absl::GetFlag(FLAGS_flop_outputs));
+    pipeline_options.verilog_sink(generator_sink);
+    pipeline_options.stage_emission_threads(
+        absl::GetFlag(FLAGS_stage_emission_threads));
+    XLS_ASSIGN_OR_RETURN(
+        verilog::InliningOptions inlining_options,
+        verilog::InliningOptionsFromString(
+            absl::GetFlag(FLAGS_inlining_strategy)));
+    pipeline_options.inlining(inlining_options);
+    if (!absl::GetFlag(FLAGS_clock_gate_cell).empty()) {
+      std::vector<std::string> fields =
+          absl::StrSplit(absl::GetFlag(FLAGS_clock_gate_cell), ',');
+      if (fields.size() != 1 && fields.size() != 4) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Invalid clock gate cell: \"%s\"",
+                            absl::GetFlag(FLAGS_clock_gate_cell)));
+      }
+      verilog::ClockGateCell cell;
+      cell.module_name = fields[0];
+      if (fields.size() == 4) {
+        cell.clock_port = fields[1];
+        cell.enable_port = fields[2];
+        cell.gated_clock_port = fields[3];
+      }
+      pipeline_options.clock_gate_cell(cell);
+    }
 
     if (!absl::GetFlag(FLAGS_reset).empty()) {
       verilog::ResetProto reset_proto;
@@ -193,31 +410,67 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
       pipeline_options.reset(reset_proto);
     }
 
+    std::string schedule_text =
+        scheduling_unit.schedule->ToProto().DebugString();
     XLS_ASSIGN_OR_RETURN(
-        result, verilog::ToPipelineModuleText(*scheduling_unit.schedule, main,
-                                              pipeline_options));
+        result, GenerateCached(cache.get(), main, schedule_text, [&]() {
+          return verilog::ToPipelineModuleText(*scheduling_unit.schedule, main,
+                                               pipeline_options);
+        }));
+    streamed = generator_sink != nullptr;
     if (!schedule_path.empty()) {
       XLS_RETURN_IF_ERROR(
           SetTextProtoFile(schedule_path, scheduling_unit.schedule->ToProto()));
     }
   } else if (absl::GetFlag(FLAGS_generator) == "combinational") {
-    XLS_ASSIGN_OR_RETURN(result,
-                         verilog::GenerateCombinationalModule(
-                             main, absl::GetFlag(FLAGS_use_system_verilog)));
+    XLS_ASSIGN_OR_RETURN(
+        result, GenerateCached(cache.get(), main, /*schedule=*/"", [&]() {
+          return verilog::GenerateCombinationalModule(
+              main, absl::GetFlag(FLAGS_use_system_verilog), generator_sink);
+        }));
+    streamed = generator_sink != nullptr;
+  } else if (absl::GetFlag(FLAGS_generator) == "resource_shared") {
+    XLS_QCHECK(!absl::GetFlag(FLAGS_reset).empty())
+        << "The resource_shared generator requires --reset.";
+    verilog::ResourceSharingOptions sharing_options;
+    XLS_ASSIGN_OR_RETURN(auto resource_limits, ParseResourceLimits());
+    for (const auto& op_and_count : resource_limits) {
+      sharing_options.resource_limit(op_and_count.first, op_and_count.second);
+    }
+    if (!absl::GetFlag(FLAGS_module_name).empty()) {
+      sharing_options.module_name(absl::GetFlag(FLAGS_module_name));
+    }
+    verilog::ResetProto reset_proto;
+    reset_proto.set_name(absl::GetFlag(FLAGS_reset));
+    reset_proto.set_asynchronous(absl::GetFlag(FLAGS_reset_asynchronous));
+    reset_proto.set_active_low(absl::GetFlag(FLAGS_reset_active_low));
+    sharing_options.reset(reset_proto);
+    sharing_options.use_system_verilog(absl::GetFlag(FLAGS_use_system_verilog));
+    XLS_ASSIGN_OR_RETURN(
+        result, GenerateCached(cache.get(), main, /*schedule=*/"", [&]() {
+          return verilog::GenerateResourceSharedModule(main, sharing_options);
+        }));
   } else {
     XLS_LOG(QFATAL) << absl::StreamFormat(
-        "Invalid value for --generator: %s. Expected 'pipeline' or "
-        "'combinational'",
+        "Invalid value for --generator: %s. Expected 'pipeline', "
+        "'combinational' or 'resource_shared'",
         absl::GetFlag(FLAGS_generator));
   }
   if (!signature_path.empty()) {
     XLS_RETURN_IF_ERROR(
         SetTextProtoFile(signature_path, result.signature.proto()));
   }
-  if (verilog_path.empty()) {
+  if (verilog_sink == nullptr) {
     std::cout << result.verilog_text;
   } else {
-    XLS_RETURN_IF_ERROR(SetFileContents(verilog_path, result.verilog_text));
+    if (!streamed) {
+      verilog_sink->Write(result.verilog_text);
+    }
+    XLS_RETURN_IF_ERROR(verilog_sink->Close());
+  }
+  if (!absl::GetFlag(FLAGS_trace_file).empty()) {
+    StopTracing();
+    XLS_RETURN_IF_ERROR(WriteChromeTrace(absl::GetFlag(FLAGS_trace_file)));
   }
   return absl::OkStatus();
 }
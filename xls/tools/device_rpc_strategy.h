@@ -15,6 +15,10 @@
 #ifndef XLS_TOOLS_DEVICE_RPC_STRATEGY_H_
 #define XLS_TOOLS_DEVICE_RPC_STRATEGY_H_
 
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
@@ -38,6 +42,28 @@ class DeviceRpcStrategy {
   // Calls an unnamed function on the device.
   virtual absl::StatusOr<Value> CallUnnamed(
       const FunctionType& function_type, absl::Span<const Value> arguments) = 0;
+
+  // Calls an unnamed function on the device once per element of
+  // "argument_sets" and returns the results in the same order. Strategies may
+  // pipeline the calls, sending up to "max_in_flight" requests before reading
+  // their responses, which requires a device wrapper that accepts back-to-back
+  // requests (see WrapIoOptions::buffer_requests). The default implementation
+  // performs the calls one at a time.
+  virtual absl::StatusOr<std::vector<Value>> CallUnnamedBatch(
+      const FunctionType& function_type,
+      absl::Span<const std::vector<Value>> argument_sets,
+      int64_t max_in_flight) {
+    std::vector<Value> results;
+    results.reserve(argument_sets.size());
+    for (const std::vector<Value>& arguments : argument_sets) {
+      absl::StatusOr<Value> result = CallUnnamed(function_type, arguments);
+      if (!result.ok()) {
+        return result.status();
+      }
+      results.push_back(std::move(result).value());
+    }
+    return results;
+  }
 };
 
 }  // namespace xls
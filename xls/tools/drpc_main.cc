@@ -20,6 +20,8 @@
 
 #include "absl/flags/flag.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_split.h"
+#include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/ir_parser.h"
@@ -32,6 +34,15 @@ ABSL_FLAG(int64_t, device_ordinal, 0,
           "Device ordinal within the -target_device category, useful when "
           "multiple are present.");
 ABSL_FLAG(std::string, function_type, "", "Function type being invoked.");
+ABSL_FLAG(std::string, input_file, "",
+          "If specified, call the function once per line of this file, each "
+          "holding the semicolon-separated arguments of a call, instead of "
+          "with the arguments on the command line. Results are printed one "
+          "per line.");
+ABSL_FLAG(int64_t, max_in_flight, 1,
+          "With --input_file, the maximum number of calls sent to the device "
+          "before their results are received. Values above one require a "
+          "device wrapper generated with wrap_io_main --buffer_requests.");
 
 namespace xls {
 namespace tools {
@@ -50,14 +61,17 @@ void RealMain(absl::Span<const absl::string_view> args) {
   XLS_QCHECK_OK(function_type_status.status());
   FunctionType* function_type = function_type_status.value();
 
-  std::vector<Value> arguments;
-  for (int64_t i = 0; i < args.size(); ++i) {
-    absl::string_view s = args[i];
-    absl::StatusOr<Value> argument =
-        Parser::ParseValue(s, function_type->parameter_type(i));
-    XLS_QCHECK_OK(argument.status());
-    arguments.push_back(std::move(argument).value());
-  }
+  // Parses the arguments of one call.
+  auto parse_arguments = [&](absl::Span<const absl::string_view> strings) {
+    std::vector<Value> arguments;
+    for (int64_t i = 0; i < strings.size(); ++i) {
+      absl::StatusOr<Value> argument =
+          Parser::ParseValue(strings[i], function_type->parameter_type(i));
+      XLS_QCHECK_OK(argument.status());
+      arguments.push_back(std::move(argument).value());
+    }
+    return arguments;
+  };
 
   absl::StatusOr<std::unique_ptr<DeviceRpcStrategy>> drpc_status =
       DeviceRpcStrategyFactory::GetSingleton()->Create(target_device);
@@ -66,8 +80,31 @@ void RealMain(absl::Span<const absl::string_view> args) {
   std::unique_ptr<DeviceRpcStrategy> drpc = std::move(drpc_status).value();
   XLS_QCHECK_OK(drpc->Connect(absl::GetFlag(FLAGS_device_ordinal)));
 
+  if (!absl::GetFlag(FLAGS_input_file).empty()) {
+    XLS_QCHECK(args.empty())
+        << "Cannot specify both --input_file and arguments";
+    absl::StatusOr<std::string> input_text =
+        GetFileContents(absl::GetFlag(FLAGS_input_file));
+    XLS_QCHECK_OK(input_text.status());
+    std::vector<std::vector<Value>> argument_sets;
+    for (absl::string_view line :
+         absl::StrSplit(input_text.value(), '\n', absl::SkipWhitespace())) {
+      std::vector<absl::string_view> strings =
+          absl::StrSplit(line, ';', absl::SkipWhitespace());
+      argument_sets.push_back(parse_arguments(strings));
+    }
+    absl::StatusOr<std::vector<Value>> results = drpc->CallUnnamedBatch(
+        *function_type, argument_sets, absl::GetFlag(FLAGS_max_in_flight));
+    XLS_QCHECK_OK(results.status());
+    for (const Value& result : results.value()) {
+      std::cout << result.ToString(FormatPreference::kHex) << "\n";
+    }
+    std::cout << std::flush;
+    return;
+  }
+
   absl::StatusOr<Value> rpc_status =
-      drpc->CallUnnamed(*function_type, arguments);
+      drpc->CallUnnamed(*function_type, parse_arguments(args));
   XLS_QCHECK_OK(rpc_status.status());
 
   std::cout << rpc_status.value().ToString(FormatPreference::kHex) << std::endl;
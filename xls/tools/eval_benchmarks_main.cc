@@ -0,0 +1,119 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the throughput of the evaluation engines (the JIT, the IR and proc
+// network interpreters, the serial proc runtime and the netlist interpreter)
+// on representative workloads, and emits samples per second and ns per node as
+// JSON, for catching performance regressions in the engines.
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/tools/benchmark_suite.h"
+
+const char kUsage[] = R"(
+Usage:
+  eval_benchmarks_main [--output_json=results.json] [<ir_path>...]
+
+The entry function of each given IR file is benchmarked with the JIT and the
+interpreter, in addition to the built-in synthetic workloads.
+)";
+
+ABSL_FLAG(std::string, output_json, "",
+          "Path to write the JSON results to. If empty, they are written to "
+          "stdout.");
+ABSL_FLAG(int64_t, min_time_ms, 500,
+          "Minimum time to measure each engine on each workload for.");
+ABSL_FLAG(int64_t, min_samples, 10,
+          "Minimum number of samples to measure each engine on each workload "
+          "for.");
+ABSL_FLAG(int64_t, input_count, 64,
+          "Number of random inputs to cycle through.");
+ABSL_FLAG(int64_t, seed, 0, "Seed for the random inputs.");
+ABSL_FLAG(bool, synthetic, true,
+          "Whether to run the built-in synthetic workloads.");
+
+namespace xls {
+namespace {
+
+absl::Status RealMain(absl::Span<const absl::string_view> paths) {
+  EvalBenchmarkOptions options;
+  options.min_time = absl::Milliseconds(absl::GetFlag(FLAGS_min_time_ms));
+  options.min_samples = absl::GetFlag(FLAGS_min_samples);
+  options.input_count = absl::GetFlag(FLAGS_input_count);
+  options.seed = absl::GetFlag(FLAGS_seed);
+
+  std::vector<EvalBenchmarkResult> results;
+  for (absl::string_view path : paths) {
+    XLS_LOG(INFO) << "Benchmarking " << path;
+    XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(std::string(path)));
+    for (EvalBenchmarkResult& result :
+         RunFunctionEvalBenchmarks(path, ir_text, options)) {
+      results.push_back(std::move(result));
+    }
+  }
+  if (absl::GetFlag(FLAGS_synthetic)) {
+    XLS_LOG(INFO) << "Benchmarking synthetic workloads";
+    for (EvalBenchmarkResult& result : RunSyntheticEvalBenchmarks(options)) {
+      results.push_back(std::move(result));
+    }
+  }
+
+  int64_t failures = 0;
+  for (const EvalBenchmarkResult& result : results) {
+    if (result.error.has_value()) {
+      XLS_LOG(ERROR) << result.workload << " on " << result.engine
+                     << " failed: " << *result.error;
+      ++failures;
+      continue;
+    }
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "%s on %s: %.1f samples/s, %.3f ns/node", result.workload,
+        result.engine, result.SamplesPerSecond(), result.NsPerNode());
+  }
+
+  std::string json = EvalBenchmarkResultsToJson(results);
+  if (absl::GetFlag(FLAGS_output_json).empty()) {
+    std::cout << json;
+  } else {
+    XLS_RETURN_IF_ERROR(
+        SetFileContents(absl::GetFlag(FLAGS_output_json), json));
+  }
+  if (failures > 0) {
+    return absl::InternalError(
+        absl::StrFormat("%d of %d benchmarks failed", failures,
+                        results.size()));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK_OK(xls::RealMain(positional_arguments));
+  return EXIT_SUCCESS;
+}
@@ -12,21 +12,32 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <random>
+#include <thread>  // NOLINT
 
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/interpreter/invoke_cache.h"
 #include "xls/interpreter/ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter_stats.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/random_value.h"
 #include "xls/jit/ir_jit.h"
@@ -52,6 +63,13 @@ and compare each result against a corresponding values in EXPECTED_FILE:
 
    eval_ir_main --input_file=INPUT_FILE --expected_file=EXPECTED_FILE IR_FILE
 
+Evaluate a large INPUT_FILE without loading it into memory: the lines are read
+in chunks, and each chunk is evaluated in parallel by --threads threads, each
+with its own JIT. The results are printed in input order:
+
+   eval_ir_main --input_file=INPUT_FILE --expected_file=EXPECTED_FILE \
+      --stream_inputs IR_FILE
+
 Evaluate IR with randomly generated inputs:
 
    eval_ir_main --random_inputs=100 IR_FILE
@@ -95,12 +113,46 @@ ABSL_FLAG(
     "When specified with --optimize_ir, run evaluation after each pass. "
     "A non-zero error status is returned if any of the results do not match.");
 ABSL_FLAG(bool, use_llvm_jit, true, "Use the LLVM IR JIT for execution.");
+ABSL_FLAG(bool, memoize_invokes, false,
+          "When interpreting, serve invokes of a function with arguments it "
+          "has already been evaluated with from a cache, and print the hit "
+          "rates of each function to stderr.");
 ABSL_FLAG(bool, test_llvm_jit, false,
           "If true, then run the JIT and compare the results against the "
           "interpereter.");
 ABSL_FLAG(int64_t, llvm_opt_level, 3,
           "The optimization level of the LLVM JIT. Valid values are from 0 (no "
           "optimizations) to 3 (maximum optimizations).");
+ABSL_FLAG(std::string, llvm_compile_mode, "opt_level",
+          "How the LLVM JIT compiles the function: \"opt_level\" uses the "
+          "pipeline of --llvm_opt_level, \"fast\" a minimal pass list and "
+          "fast instruction selection, which compiles much faster but "
+          "generates slower code, and \"auto\" picks between \"fast\" and "
+          "-O3 from the function size and the number of argument sets.");
+ABSL_FLAG(bool, print_jit_compile_stats, false,
+          "If true, print the time spent compiling the function with the LLVM "
+          "JIT to stderr.");
+ABSL_FLAG(std::string, llvm_object_cache_dir, "",
+          "If non-empty, the directory in which to cache objects compiled by "
+          "the LLVM JIT. Later runs on the same IR reuse the cached objects "
+          "rather than recompiling.");
+
+ABSL_FLAG(std::string, output_value_profile, "",
+          "If specified, additionally evaluate the inputs with the interpreter "
+          "and write the values observed for each node to this path as a "
+          "value profile, for consumption by opt_main --value_profile.");
+
+ABSL_FLAG(bool, stream_inputs, false,
+          "Read --input_file and --expected_file incrementally, in chunks of "
+          "--stream_chunk_size lines, and evaluate each chunk in parallel "
+          "with --threads threads. Cannot be specified with --optimize_ir, "
+          "--test_llvm_jit or --output_value_profile.");
+ABSL_FLAG(int64_t, stream_chunk_size, 1 << 16,
+          "Number of input lines read and evaluated at a time with "
+          "--stream_inputs.");
+ABSL_FLAG(int64_t, threads, 0,
+          "Number of threads evaluating inputs with --stream_inputs. If zero, "
+          "one per core.");
 
 ABSL_FLAG(
     std::string, test_only_inject_jit_result, "",
@@ -124,6 +176,33 @@ std::string ArgsToString(absl::Span<const Value> args) {
   });
 }
 
+// Creates the JIT for "f" as configured by the flags, for evaluating
+// "arg_set_count" argument sets.
+absl::StatusOr<std::unique_ptr<IrJit>> CreateJit(Function* f,
+                                                 int64_t arg_set_count) {
+  absl::optional<std::filesystem::path> object_cache_dir;
+  if (!absl::GetFlag(FLAGS_llvm_object_cache_dir).empty()) {
+    object_cache_dir = absl::GetFlag(FLAGS_llvm_object_cache_dir);
+  }
+  int64_t opt_level = absl::GetFlag(FLAGS_llvm_opt_level);
+  const std::string& mode = absl::GetFlag(FLAGS_llvm_compile_mode);
+  if (mode == "fast") {
+    opt_level = kJitFastCompileOptLevel;
+  } else if (mode == "auto") {
+    opt_level = ChooseJitOptLevel(f, arg_set_count);
+  } else if (mode != "opt_level") {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid --llvm_compile_mode: %s", mode));
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit,
+                       IrJit::Create(f, opt_level, object_cache_dir));
+  if (absl::GetFlag(FLAGS_print_jit_compile_stats)) {
+    std::cerr << "JIT compilation of " << f->name() << ": "
+              << JitCompileStatsToString(jit->compile_stats()) << "\n";
+  }
+  return jit;
+}
+
 // Evaluates the function with the given ArgSets. Returns an error if the result
 // does not match expectations (if any). 'actual_src' and 'expected_src' are
 // string descriptions of the sources of the actual results and expected
@@ -135,22 +214,42 @@ absl::StatusOr<std::vector<Value>> Eval(
   std::unique_ptr<IrJit> jit;
   if (use_jit) {
     // No support for procs yet.
-    XLS_ASSIGN_OR_RETURN(jit,
-                         IrJit::Create(f, absl::GetFlag(FLAGS_llvm_opt_level)));
+    XLS_ASSIGN_OR_RETURN(jit, CreateJit(f, arg_sets.size()));
+  }
+
+  // Evaluate all argument sets through the JIT with a single batched call.
+  std::vector<Value> jit_results;
+  if (use_jit && absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
+    std::vector<std::vector<Value>> batch;
+    batch.reserve(arg_sets.size());
+    for (const ArgSet& arg_set : arg_sets) {
+      batch.push_back(arg_set.args);
+    }
+    XLS_ASSIGN_OR_RETURN(jit_results, jit->RunBatch(batch));
+  }
+
+  absl::optional<InvokeCache> invoke_cache;
+  if (!use_jit && absl::GetFlag(FLAGS_memoize_invokes)) {
+    invoke_cache.emplace();
   }
 
   std::vector<Value> results;
-  for (const ArgSet& arg_set : arg_sets) {
+  for (int64_t i = 0; i < arg_sets.size(); ++i) {
+    const ArgSet& arg_set = arg_sets[i];
     Value result;
     if (use_jit) {
       if (absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
-        XLS_ASSIGN_OR_RETURN(result, jit->Run(arg_set.args));
+        result = jit_results[i];
       } else {
         XLS_ASSIGN_OR_RETURN(result, Parser::ParseTypedValue(absl::GetFlag(
                                          FLAGS_test_only_inject_jit_result)));
       }
     } else {
-      XLS_ASSIGN_OR_RETURN(result, IrInterpreter::Run(f, arg_set.args));
+      XLS_ASSIGN_OR_RETURN(
+          result, IrInterpreter::Run(f, arg_set.args, /*stats=*/nullptr,
+                                     invoke_cache.has_value()
+                                         ? &invoke_cache.value()
+                                         : nullptr));
     }
     std::cout << result.ToString(FormatPreference::kHex) << std::endl;
 
@@ -165,6 +264,9 @@ absl::StatusOr<std::vector<Value>> Eval(
     }
     results.push_back(result);
   }
+  if (invoke_cache.has_value()) {
+    std::cerr << invoke_cache->ToReport();
+  }
   return results;
 }
 
@@ -198,6 +300,17 @@ class EvalInvariantChecker : public InvariantChecker {
   bool use_jit_;
 };
 
+// Interprets the function with the given ArgSets and writes the values
+// observed for its nodes to "path".
+absl::Status WriteValueProfile(Function* f, absl::Span<const ArgSet> arg_sets,
+                               const std::filesystem::path& path) {
+  InterpreterStats stats;
+  for (const ArgSet& arg_set : arg_sets) {
+    XLS_RETURN_IF_ERROR(IrInterpreter::Run(f, arg_set.args, &stats).status());
+  }
+  return SetFileContents(path, stats.ToValueProfile().ToString());
+}
+
 // Runs the given ArgSets through the given package. This includes optionally
 // (based on flags) optimizing the IR and evaluating the ArgSets during and
 // after optimizations.
@@ -207,6 +320,11 @@ absl::Status Run(Package* package, absl::Span<const ArgSet> arg_sets_in) {
   // do not exist.
   std::vector<ArgSet> arg_sets(arg_sets_in.begin(), arg_sets_in.end());
 
+  if (!absl::GetFlag(FLAGS_output_value_profile).empty()) {
+    XLS_RETURN_IF_ERROR(WriteValueProfile(
+        f, arg_sets, absl::GetFlag(FLAGS_output_value_profile)));
+  }
+
   if (absl::GetFlag(FLAGS_test_llvm_jit)) {
     XLS_QCHECK(!absl::GetFlag(FLAGS_optimize_ir))
         << "Cannot specify both --test_llvm_jit and --optimize_ir";
@@ -266,19 +384,296 @@ absl::StatusOr<ArgSet> ArgSetFromString(absl::string_view args_string) {
   return arg_set;
 }
 
+// Parses the IR package, with the entry function given by --entry if any.
+absl::StatusOr<std::unique_ptr<Package>> ParsePackage(
+    absl::string_view contents, absl::string_view path) {
+  if (absl::GetFlag(FLAGS_entry).empty()) {
+    return Parser::ParsePackage(contents, path);
+  }
+  return Parser::ParsePackageWithEntry(contents, absl::GetFlag(FLAGS_entry),
+                                       path);
+}
+
+// The copy of the entry function and its JIT used by one thread evaluating
+// streamed inputs, so the threads share no IR or compiled code.
+struct StreamEvaluator {
+  std::unique_ptr<Package> package;
+  Function* function;
+  // Null if evaluating with the interpreter.
+  std::unique_ptr<IrJit> jit;
+};
+
+// The results of evaluating a slice of a chunk of streamed inputs, up to and
+// including the first input which failed, if any, whose error is in "status".
+struct StreamSliceResult {
+  std::vector<Value> results;
+  absl::Status status;
+};
+
+// Reads up to "count" non-blank lines from "stream" into "lines".
+void ReadLines(std::istream& stream, int64_t count,
+               std::vector<std::string>* lines) {
+  lines->clear();
+  std::string line;
+  while (lines->size() < count && std::getline(stream, line)) {
+    if (!absl::StripAsciiWhitespace(line).empty()) {
+      lines->push_back(std::move(line));
+    }
+  }
+}
+
+// Parses and evaluates the argument sets in "input_lines" and checks the
+// results against the values in "expected_lines" (if non-empty) or against
+// "expected" (if set).
+StreamSliceResult EvalStreamSlice(
+    StreamEvaluator* evaluator, absl::Span<const std::string> input_lines,
+    absl::Span<const std::string> expected_lines,
+    const absl::optional<Value>& expected,
+    const absl::optional<Value>& injected_result) {
+  StreamSliceResult slice;
+  std::vector<ArgSet> arg_sets;
+  arg_sets.reserve(input_lines.size());
+  absl::Status parse_status;
+  for (int64_t i = 0; i < input_lines.size(); ++i) {
+    absl::StatusOr<ArgSet> arg_set = ArgSetFromString(input_lines[i]);
+    if (!arg_set.ok()) {
+      parse_status = absl::InvalidArgumentError(absl::StrFormat(
+          "Invalid line in input file %s: %s: %s",
+          absl::GetFlag(FLAGS_input_file), input_lines[i],
+          arg_set.status().message()));
+      break;
+    }
+    if (!expected_lines.empty()) {
+      absl::StatusOr<Value> expected_value =
+          Parser::ParseTypedValue(expected_lines[i]);
+      if (!expected_value.ok()) {
+        parse_status = absl::InvalidArgumentError(absl::StrFormat(
+            "Failed to parse line in expected file %s: %s: %s",
+            absl::GetFlag(FLAGS_expected_file), expected_lines[i],
+            expected_value.status().message()));
+        break;
+      }
+      arg_set->expected = std::move(expected_value).value();
+    } else {
+      arg_set->expected = expected;
+    }
+    arg_sets.push_back(std::move(arg_set).value());
+  }
+
+  // Evaluate the argument sets parsed before any error.
+  if (evaluator->jit != nullptr && !injected_result.has_value()) {
+    std::vector<std::vector<Value>> batch;
+    batch.reserve(arg_sets.size());
+    for (const ArgSet& arg_set : arg_sets) {
+      batch.push_back(arg_set.args);
+    }
+    absl::StatusOr<std::vector<Value>> results =
+        evaluator->jit->RunBatch(batch);
+    if (!results.ok()) {
+      slice.status = results.status();
+      return slice;
+    }
+    slice.results = std::move(results).value();
+  } else {
+    for (const ArgSet& arg_set : arg_sets) {
+      if (injected_result.has_value()) {
+        slice.results.push_back(*injected_result);
+        continue;
+      }
+      absl::StatusOr<Value> result =
+          IrInterpreter::Run(evaluator->function, arg_set.args);
+      if (!result.ok()) {
+        slice.status = result.status();
+        return slice;
+      }
+      slice.results.push_back(std::move(result).value());
+    }
+  }
+
+  for (int64_t i = 0; i < arg_sets.size(); ++i) {
+    const ArgSet& arg_set = arg_sets[i];
+    if (arg_set.expected.has_value() && slice.results[i] != *arg_set.expected) {
+      slice.results.resize(i + 1);
+      slice.status = absl::InvalidArgumentError(absl::StrFormat(
+          "Miscompare for input \"%s\"\n  actual: %s\n  expected: %s",
+          ArgsToString(arg_set.args),
+          slice.results[i].ToString(FormatPreference::kHex),
+          arg_set.expected->ToString(FormatPreference::kHex)));
+      return slice;
+    }
+  }
+  slice.status = parse_status;
+  return slice;
+}
+
+// Evaluates the argument sets of --input_file without reading the whole file
+// into memory. Each chunk of lines is split into contiguous slices evaluated
+// by separate threads while the next chunk is read, and the results are
+// printed in input order. As with the non-streaming evaluation, the results of
+// all inputs before the first failing one are printed before the error is
+// returned.
+absl::Status RunStreaming(absl::string_view ir_contents,
+                          absl::string_view ir_path) {
+  XLS_QCHECK(!absl::GetFlag(FLAGS_input_file).empty())
+      << "Must specify --input_file with --stream_inputs";
+  XLS_QCHECK(!absl::GetFlag(FLAGS_optimize_ir) &&
+             !absl::GetFlag(FLAGS_test_llvm_jit) &&
+             absl::GetFlag(FLAGS_output_value_profile).empty())
+      << "Cannot specify --optimize_ir, --test_llvm_jit or "
+         "--output_value_profile with --stream_inputs";
+  XLS_QCHECK_GT(absl::GetFlag(FLAGS_stream_chunk_size), 0);
+  XLS_QCHECK_GE(absl::GetFlag(FLAGS_threads), 0);
+
+  absl::optional<Value> expected;
+  if (!absl::GetFlag(FLAGS_expected).empty()) {
+    XLS_QCHECK(absl::GetFlag(FLAGS_expected_file).empty())
+        << "Cannot specify both --expected_file and --expected";
+    XLS_ASSIGN_OR_RETURN(
+        expected, Parser::ParseTypedValue(absl::GetFlag(FLAGS_expected)));
+  }
+  absl::optional<Value> injected_result;
+  if (!absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
+    XLS_ASSIGN_OR_RETURN(injected_result,
+                         Parser::ParseTypedValue(absl::GetFlag(
+                             FLAGS_test_only_inject_jit_result)));
+  }
+
+  std::ifstream input_stream(absl::GetFlag(FLAGS_input_file));
+  if (!input_stream) {
+    return absl::NotFoundError(absl::StrFormat(
+        "Unable to open input file %s", absl::GetFlag(FLAGS_input_file)));
+  }
+  std::unique_ptr<std::ifstream> expected_stream;
+  if (!absl::GetFlag(FLAGS_expected_file).empty()) {
+    expected_stream =
+        absl::make_unique<std::ifstream>(absl::GetFlag(FLAGS_expected_file));
+    if (!*expected_stream) {
+      return absl::NotFoundError(
+          absl::StrFormat("Unable to open expected file %s",
+                          absl::GetFlag(FLAGS_expected_file)));
+    }
+  }
+
+  int64_t thread_count = absl::GetFlag(FLAGS_threads);
+  if (thread_count == 0) {
+    thread_count = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  }
+  // Parse and compile a copy of the function per thread, in parallel. The
+  // number of inputs is unknown, so "auto" compile mode assumes it is large.
+  std::vector<StreamEvaluator> evaluators(thread_count);
+  {
+    std::vector<absl::Status> statuses(thread_count);
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < thread_count; ++i) {
+      threads.push_back(absl::make_unique<Thread>([&, i]() {
+        statuses[i] = [&]() -> absl::Status {
+          StreamEvaluator& evaluator = evaluators[i];
+          XLS_ASSIGN_OR_RETURN(evaluator.package,
+                               ParsePackage(ir_contents, ir_path));
+          XLS_ASSIGN_OR_RETURN(evaluator.function,
+                               evaluator.package->EntryFunction());
+          if (absl::GetFlag(FLAGS_use_llvm_jit)) {
+            XLS_ASSIGN_OR_RETURN(
+                evaluator.jit,
+                CreateJit(evaluator.function,
+                          std::numeric_limits<int64_t>::max()));
+          }
+          return absl::OkStatus();
+        }();
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+    for (const absl::Status& status : statuses) {
+      XLS_RETURN_IF_ERROR(status);
+    }
+  }
+
+  const int64_t chunk_size = absl::GetFlag(FLAGS_stream_chunk_size);
+  std::vector<std::string> input_lines;
+  std::vector<std::string> expected_lines;
+  std::vector<std::string> next_input_lines;
+  std::vector<std::string> next_expected_lines;
+  // Reads the next chunk of lines, checking the files have as many lines.
+  auto read_chunk = [&]() -> absl::Status {
+    ReadLines(input_stream, chunk_size, &next_input_lines);
+    if (expected_stream != nullptr) {
+      ReadLines(*expected_stream, chunk_size, &next_expected_lines);
+      if (next_expected_lines.size() != next_input_lines.size()) {
+        return absl::InvalidArgumentError(
+            "Number of values in expected file does not match the number of "
+            "inputs.");
+      }
+    }
+    return absl::OkStatus();
+  };
+
+  XLS_RETURN_IF_ERROR(read_chunk());
+  std::string output;
+  while (!next_input_lines.empty()) {
+    std::swap(input_lines, next_input_lines);
+    std::swap(expected_lines, next_expected_lines);
+    int64_t slice_size = (input_lines.size() + thread_count - 1) / thread_count;
+    std::vector<StreamSliceResult> slices(thread_count);
+    absl::Status read_status;
+    {
+      std::vector<std::unique_ptr<Thread>> threads;
+      for (int64_t i = 0; i < thread_count; ++i) {
+        int64_t start = std::min<int64_t>(i * slice_size, input_lines.size());
+        int64_t size =
+            std::min<int64_t>(slice_size, input_lines.size() - start);
+        if (size == 0) {
+          break;
+        }
+        absl::Span<const std::string> inputs =
+            absl::MakeConstSpan(input_lines).subspan(start, size);
+        absl::Span<const std::string> expecteds =
+            expected_lines.empty()
+                ? absl::Span<const std::string>()
+                : absl::MakeConstSpan(expected_lines).subspan(start, size);
+        threads.push_back(
+            absl::make_unique<Thread>([&, i, inputs, expecteds]() {
+              slices[i] = EvalStreamSlice(&evaluators[i], inputs, expecteds,
+                                          expected, injected_result);
+            }));
+      }
+      // Read the next chunk while this one is evaluated.
+      read_status = read_chunk();
+      for (std::unique_ptr<Thread>& thread : threads) {
+        thread->Join();
+      }
+    }
+
+    output.clear();
+    absl::Status status;
+    for (const StreamSliceResult& slice : slices) {
+      for (const Value& result : slice.results) {
+        absl::StrAppend(&output, result.ToString(FormatPreference::kHex),
+                        "\n");
+      }
+      if (!slice.status.ok()) {
+        status = slice.status;
+        break;
+      }
+    }
+    std::cout << output << std::flush;
+    XLS_RETURN_IF_ERROR(status);
+    XLS_RETURN_IF_ERROR(read_status);
+  }
+  return absl::OkStatus();
+}
+
 absl::Status RealMain(absl::string_view input_path) {
   if (input_path == "-") {
     input_path = "/dev/stdin";
   }
   XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(input_path));
-  std::unique_ptr<Package> package;
-  if (absl::GetFlag(FLAGS_entry).empty()) {
-    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(contents, input_path));
-  } else {
-    XLS_ASSIGN_OR_RETURN(package,
-                         Parser::ParsePackageWithEntry(
-                             contents, absl::GetFlag(FLAGS_entry), input_path));
+  if (absl::GetFlag(FLAGS_stream_inputs)) {
+    return RunStreaming(contents, input_path);
   }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       ParsePackage(contents, input_path));
   XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
 
   std::vector<ArgSet> arg_sets;
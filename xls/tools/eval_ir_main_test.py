@@ -159,6 +159,44 @@ class EvalMainTest(absltest.TestCase):
     self.assertIn('Miscompare for input "bits[32]:0x10; bits[32]:0x0"',
                   comp.stderr.decode('utf-8'))
 
+  def test_stream_inputs(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    inputs = ['bits[32]:0x%x; bits[32]:0x%x' % (i, 2 * i) for i in range(100)]
+    input_file = self.create_tempfile(content='\n\n'.join(inputs))
+    expected_file = self.create_tempfile(
+        content='\n'.join('bits[32]:0x%x' % (3 * i) for i in range(100)))
+    for use_jit in (True, False):
+      results = subprocess.check_output([
+          EVAL_IR_MAIN_PATH, '--input_file=' + input_file.full_path,
+          '--expected_file=' + expected_file.full_path, '--stream_inputs',
+          '--stream_chunk_size=7', '--threads=3',
+          '--use_llvm_jit=%s' % str(use_jit).lower(), ir_file.full_path
+      ])
+      self.assertSequenceEqual(['bits[32]:0x%x' % (3 * i) for i in range(100)],
+                               results.decode('utf-8').strip().split('\n'))
+
+  def test_stream_inputs_with_failed_expected_file(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    input_file = self.create_tempfile(content='\n'.join(
+        ('bits[32]:0x42; bits[32]:0x123', 'bits[32]:0x10; bits[32]:0x00',
+         'bits[32]:0x1; bits[32]:0x1')))
+    expected_file = self.create_tempfile(content='\n'.join(
+        ('bits[32]:0x165', 'bits[32]:0xf1f', 'bits[32]:0x2')))
+    comp = subprocess.run([
+        EVAL_IR_MAIN_PATH, '--input_file=' + input_file.full_path,
+        '--expected_file=' + expected_file.full_path, '--stream_inputs',
+        '--threads=2', ir_file.full_path
+    ],
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE,
+                          check=False)
+    self.assertNotEqual(comp.returncode, 0)
+    self.assertIn('Miscompare for input "bits[32]:0x10; bits[32]:0x0"',
+                  comp.stderr.decode('utf-8'))
+    # Only the results up to the failing input are printed.
+    self.assertSequenceEqual(('bits[32]:0x165', 'bits[32]:0x10'),
+                             comp.stdout.decode('utf-8').strip().split('\n'))
+
   def test_empty_input_file(self):
     ir_file = self.create_tempfile(content=ADD_IR)
     input_file = self.create_tempfile(content='')
@@ -13,12 +13,21 @@
 // limitations under the License.
 
 // Simple driver for executing the ExtractStage() routine.
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/scheduling/extract_stage.h"
 #include "xls/scheduling/pipeline_schedule.h"
@@ -32,13 +41,54 @@ ABSL_FLAG(std::string, output_path, "", "Path to which to write output.");
 ABSL_FLAG(std::string, schedule_path, "",
           "Path to the function's pipeline schedule.");
 ABSL_FLAG(int, stage, -1, "Pipeline stage to extract.");
+ABSL_FLAG(bool, all_stages, false,
+          "Extract every pipeline stage in a single pass instead of --stage. "
+          "--output_path is then a directory: stage N is written to "
+          "<output_path>/<function>_stage_<N>.ir, each file containing the "
+          "original package followed by the stage function.");
 
 namespace xls {
 
+// Extracts all stages of the schedule and writes each to its own file in the
+// output directory. The files are written concurrently; each holds the
+// functions of the original package followed by the stage function.
+absl::Status ExtractAllStagesToDirectory(Package* package, Function* function,
+                                         const PipelineSchedule& schedule,
+                                         const std::string& output_path) {
+  // Dump the original package before adding the stage functions to it.
+  std::string package_ir = package->DumpIr();
+  XLS_ASSIGN_OR_RETURN(std::vector<Function*> stages,
+                       ExtractAllStages(function, schedule));
+  XLS_RETURN_IF_ERROR(RecursivelyCreateDir(output_path));
+
+  int64_t num_threads = std::min<int64_t>(
+      stages.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<absl::Status> statuses(stages.size());
+  std::atomic<int64_t> next_stage(0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t t = 0; t < num_threads; ++t) {
+    threads.push_back(std::make_unique<Thread>([&]() {
+      for (int64_t i = next_stage++; i < stages.size(); i = next_stage++) {
+        std::filesystem::path path = std::filesystem::path(output_path) /
+                                     absl::StrCat(stages[i]->name(), ".ir");
+        statuses[i] = SetFileContents(
+            path, absl::StrCat(package_ir, "\n", stages[i]->DumpIr()));
+      }
+    }));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  for (const absl::Status& status : statuses) {
+    XLS_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
 absl::Status RealMain(const std::string& ir_path,
                       absl::optional<std::string> function_name,
                       const std::string& schedule_path, int stage,
-                      const std::string& output_path) {
+                      bool all_stages, const std::string& output_path) {
   XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
   XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
   Function* function;
@@ -54,6 +104,10 @@ absl::Status RealMain(const std::string& ir_path,
   XLS_ASSIGN_OR_RETURN(PipelineSchedule schedule,
                        PipelineSchedule::FromProto(function, proto));
 
+  if (all_stages) {
+    return ExtractAllStagesToDirectory(package.get(), function, schedule,
+                                       output_path);
+  }
   XLS_RETURN_IF_ERROR(ExtractStage(function, schedule, stage).status());
   XLS_RETURN_IF_ERROR(SetFileContents(output_path, package->DumpIr()));
 
@@ -77,11 +131,14 @@ int main(int argc, char* argv[]) {
   XLS_QCHECK(!schedule_path.empty()) << "--schedule_path can't be empty!";
 
   int stage = absl::GetFlag(FLAGS_stage);
-  XLS_QCHECK(stage != -1) << "--stage must be specified!";
+  bool all_stages = absl::GetFlag(FLAGS_all_stages);
+  XLS_QCHECK((stage != -1) != all_stages)
+      << "Exactly one of --stage and --all_stages must be specified!";
 
   std::string output_path = absl::GetFlag(FLAGS_output_path);
   XLS_QCHECK(!output_path.empty()) << "--output path can't be empty!";
   XLS_QCHECK_OK(
-      xls::RealMain(ir_path, function_name, schedule_path, stage, output_path));
+      xls::RealMain(ir_path, function_name, schedule_path, stage, all_stages,
+                    output_path));
   return 0;
 }
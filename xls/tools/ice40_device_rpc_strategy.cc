@@ -21,6 +21,8 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include <cstring>
+#include <deque>
 #include <filesystem>
 
 #include "absl/status/statusor.h"
@@ -161,6 +163,49 @@ std::string LocalModesToString(tcflag_t local_modes) {
   return absl::StrJoin(pieces, ", ");
 }
 
+// Returns the bytes sent to the device to call its function with "arguments".
+absl::StatusOr<std::vector<uint8_t>> SerializeArguments(
+    absl::Span<const Value> arguments) {
+  BitPushBuffer buffer;
+  for (const Value& arg : arguments) {
+    arg.FlattenTo(&buffer);
+  }
+
+  if (buffer.empty()) {
+    // TODO(leary): 2019-04-07 We probably want this to be possible eventually,
+    // but we'd have to decide whether in this case the device function is
+    // constantly producing output data since there's no input event to trigger
+    // it, so we'd just move on to the read itself.
+    return absl::InvalidArgumentError("Cannot perform an empty-payload RPC.");
+  }
+  return buffer.GetUint8Data();
+}
+
+// Returns the number of bytes of the device's response to a call of a
+// function of type "function_type".
+int64_t ResponseSize(const FunctionType& function_type) {
+  int64_t output_bits = function_type.return_type()->GetFlatBitCount();
+  return CeilOfRatio(output_bits, int64_t{8});
+}
+
+// Converts a response of the device to the value returned by its function.
+absl::StatusOr<Value> ResponseToValue(const FunctionType& function_type,
+                                      absl::Span<const uint8_t> response) {
+  if (function_type.return_type()->IsBits() &&
+      function_type.return_type()->AsBitsOrDie()->bit_count() == 8) {
+    return Value(UBits(response[0], 8));
+  }
+
+  if (function_type.return_type()->IsBits() &&
+      function_type.return_type()->AsBitsOrDie()->bit_count() == 32) {
+    uint32_t result;
+    memcpy(&result, response.data(), sizeof(result));
+    return Value(UBits(result, 32));
+  }
+
+  return absl::UnimplementedError("NYI: convert result to Value");
+}
+
 }  // namespace
 
 Ice40DeviceRpcStrategy::~Ice40DeviceRpcStrategy() {
@@ -252,70 +297,105 @@ absl::Status Ice40DeviceRpcStrategy::Connect(int64_t device_ordinal) {
 
 absl::StatusOr<Value> Ice40DeviceRpcStrategy::CallUnnamed(
     const FunctionType& function_type, absl::Span<const Value> arguments) {
-  BitPushBuffer buffer;
-  for (const Value& arg : arguments) {
-    arg.FlattenTo(&buffer);
-  }
+  XLS_ASSIGN_OR_RETURN(std::vector<uint8_t> request,
+                       SerializeArguments(arguments));
+  XLS_RETURN_IF_ERROR(WriteRequests(request));
+  std::vector<uint8_t> response(ResponseSize(function_type));
+  XLS_RETURN_IF_ERROR(ReadResponse(absl::MakeSpan(response)));
+  return ResponseToValue(function_type, response);
+}
 
-  if (buffer.empty()) {
-    // TODO(leary): 2019-04-07 We probably want this to be possible eventually,
-    // but we'd have to decide whether in this case the device function is
-    // constantly producing output data since there's no input event to trigger
-    // it, so we'd just move on to the read itself.
-    return absl::InvalidArgumentError("Cannot perform an empty-payload RPC.");
+absl::StatusOr<std::vector<Value>> Ice40DeviceRpcStrategy::CallUnnamedBatch(
+    const FunctionType& function_type,
+    absl::Span<const std::vector<Value>> argument_sets,
+    int64_t max_in_flight) {
+  XLS_RET_CHECK_GE(max_in_flight, 1);
+  // Serialize all requests up front so a bad argument set is reported before
+  // anything is sent.
+  std::vector<std::vector<uint8_t>> requests;
+  requests.reserve(argument_sets.size());
+  for (const std::vector<Value>& arguments : argument_sets) {
+    XLS_ASSIGN_OR_RETURN(std::vector<uint8_t> request,
+                         SerializeArguments(arguments));
+    requests.push_back(std::move(request));
   }
 
-  std::vector<uint8_t> u8_data = buffer.GetUint8Data();
+  // Sequence numbers (indices into "argument_sets") of the requests sent
+  // whose responses have not been read yet, oldest first. The device answers
+  // requests in the order it receives them, so each response belongs to the
+  // oldest request in flight.
+  std::deque<int64_t> in_flight;
+  int64_t next_request = 0;
+  std::vector<uint8_t> response(ResponseSize(function_type));
+  std::vector<Value> results;
+  results.reserve(argument_sets.size());
+  while (results.size() < argument_sets.size()) {
+    // Top up the requests in flight with a single write.
+    std::vector<uint8_t> pending;
+    while (next_request < requests.size() && in_flight.size() < max_in_flight) {
+      pending.insert(pending.end(), requests[next_request].begin(),
+                     requests[next_request].end());
+      in_flight.push_back(next_request++);
+    }
+    if (!pending.empty()) {
+      XLS_RETURN_IF_ERROR(WriteRequests(pending));
+    }
 
+    int64_t sequence_number = in_flight.front();
+    in_flight.pop_front();
+    XLS_VLOG(3) << "Reading device response to request " << sequence_number;
+    XLS_RETURN_IF_ERROR(ReadResponse(absl::MakeSpan(response)));
+    XLS_ASSIGN_OR_RETURN(Value result,
+                         ResponseToValue(function_type, response));
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+absl::Status Ice40DeviceRpcStrategy::WriteRequests(
+    absl::Span<const uint8_t> data) {
+  XLS_RET_CHECK(tty_fd_.has_value()) << "Not connected to an ICE40 device.";
   int64_t bytes_written = 0;
-  while (bytes_written < buffer.size_in_bytes()) {
-    int ret = write(tty_fd_.value(), u8_data.data() + bytes_written,
-                    u8_data.size() - bytes_written);
+  while (bytes_written < data.size()) {
+    int ret = write(tty_fd_.value(), data.data() + bytes_written,
+                    data.size() - bytes_written);
     if (ret < 0) {
       return absl::InternalError(
           absl::StrFormat("Could not write partial data of %d remaining bytes "
                           "(originally %d) to ICE40: %s",
-                          buffer.size_in_bytes() - bytes_written,
-                          buffer.size_in_bytes(), Strerror(errno)));
+                          data.size() - bytes_written, data.size(),
+                          Strerror(errno)));
     }
     bytes_written += ret;
   }
 
-  if (tcflush(tty_fd_.value(), TCOFLUSH) != 0) {
+  // Wait until the data has been transmitted. (Flushing the output queue with
+  // tcflush would instead discard any of it not transmitted yet.)
+  if (tcdrain(tty_fd_.value()) != 0) {
     return absl::InternalError("Could not flush write(s) to device.");
   }
+  return absl::OkStatus();
+}
 
-  int64_t output_bits = function_type.return_type()->GetFlatBitCount();
-  std::vector<uint8_t> result(CeilOfRatio(output_bits, int64_t{8}));
-
-  XLS_VLOG(3) << "Reading device response; expecting " << result.size()
+absl::Status Ice40DeviceRpcStrategy::ReadResponse(absl::Span<uint8_t> data) {
+  XLS_RET_CHECK(tty_fd_.has_value()) << "Not connected to an ICE40 device.";
+  XLS_VLOG(3) << "Reading device response; expecting " << data.size()
               << " bytes.";
 
   int64_t bytes_read = 0;
-  while (bytes_read < result.size()) {
-    int ret = read(tty_fd_.value(), result.data() + bytes_read,
-                   result.size() - bytes_read);
+  while (bytes_read < data.size()) {
+    int ret = read(tty_fd_.value(), data.data() + bytes_read,
+                   data.size() - bytes_read);
     if (ret < 0) {
       return absl::InternalError(
           absl::StrFormat("Could not read partial data of %d remaining bytes "
                           "(originally %d) from ICE40: %s",
-                          buffer.size_in_bytes() - bytes_written,
-                          buffer.size_in_bytes(), Strerror(errno)));
+                          data.size() - bytes_read, data.size(),
+                          Strerror(errno)));
     }
     bytes_read += ret;
   }
-
-  if (function_type.return_type()->IsBits() &&
-      function_type.return_type()->AsBitsOrDie()->bit_count() == 8) {
-    return Value(UBits(result[0], 8));
-  }
-
-  if (function_type.return_type()->IsBits() &&
-      function_type.return_type()->AsBitsOrDie()->bit_count() == 32) {
-    return Value(UBits(*absl::bit_cast<uint32_t*>(result.data()), 32));
-  }
-
-  return absl::UnimplementedError("NYI: convert result to Value");
+  return absl::OkStatus();
 }
 
 }  // namespace xls
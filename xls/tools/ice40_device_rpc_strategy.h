@@ -15,7 +15,13 @@
 #ifndef XLS_TOOLS_ICE40_DEVICE_RPC_STRATEGY_H_
 #define XLS_TOOLS_ICE40_DEVICE_RPC_STRATEGY_H_
 
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "xls/tools/device_rpc_strategy.h"
 
 namespace xls {
@@ -29,7 +35,18 @@ class Ice40DeviceRpcStrategy : public DeviceRpcStrategy {
   absl::StatusOr<Value> CallUnnamed(const FunctionType& function_type,
                                     absl::Span<const Value> arguments) override;
 
+  absl::StatusOr<std::vector<Value>> CallUnnamedBatch(
+      const FunctionType& function_type,
+      absl::Span<const std::vector<Value>> argument_sets,
+      int64_t max_in_flight) override;
+
  private:
+  // Writes all of "data" to the device and waits for it to be transmitted.
+  absl::Status WriteRequests(absl::Span<const uint8_t> data);
+
+  // Reads exactly data.size() bytes from the device.
+  absl::Status ReadResponse(absl::Span<uint8_t> data);
+
   absl::optional<int> tty_fd_;
 };
 
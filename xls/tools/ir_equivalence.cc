@@ -0,0 +1,678 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_equivalence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/ir/random_value.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/jit/jit_compile_service.h"
+#include "xls/passes/bdd_function.h"
+#include "xls/passes/inlining_pass.h"
+#include "xls/passes/pass_base.h"
+#include "xls/solvers/aig.h"
+#include "xls/solvers/aig_ir_translator.h"
+#include "xls/solvers/aig_sat.h"
+#include "xls/solvers/z3_ir_translator.h"
+#include "xls/solvers/z3_utils.h"
+#include "../z3/src/api/z3.h"
+#include "../z3/src/api/z3_api.h"
+
+namespace xls {
+namespace {
+
+using solvers::Aig;
+using solvers::AigEvaluator;
+using solvers::z3::IrTranslator;
+
+// Limits on the BDD strategy; beyond these, bits of the miter are modeled as
+// variables and a verdict becomes unlikely.
+constexpr int64_t kBddMintermLimit = 4096;
+constexpr int64_t kBddNodeLimit = 1 << 22;
+
+// The maximum number of random samples evaluated by the simulation strategy.
+constexpr int64_t kMaxSimulationSamples = int64_t{1} << 20;
+
+// The number of argument sets evaluated per JIT call by the prefilter.
+constexpr int64_t kPrefilterBatchSize = 256;
+
+// The Z3 tactics of the Z3 strategies, as comma-separated names of tactics to
+// be applied in sequence. The empty string selects Z3's default solver.
+const absl::flat_hash_map<std::string, std::string>& Z3Tactics() {
+  static const auto* tactics =
+      new absl::flat_hash_map<std::string, std::string>{
+          {"z3", ""},
+          {"z3_qfbv", "qfbv"},
+          {"z3_bitblast", "simplify,solve-eqs,bit-blast,sat"},
+      };
+  return *tactics;
+}
+
+// Lets a portfolio stop the strategies still running once one has a result.
+// Strategies poll cancelled() or flag(), or register an interrupt function
+// (such as a call to Z3_interrupt()) for the duration of a blocking search.
+class Cancellation {
+ public:
+  bool cancelled() const { return cancelled_.load(); }
+  const std::atomic<bool>* flag() const { return &cancelled_; }
+
+  int64_t AddInterrupt(std::function<void()> interrupt) {
+    absl::MutexLock lock(&mutex_);
+    int64_t id = next_id_++;
+    interrupts_[id] = std::move(interrupt);
+    return id;
+  }
+  void RemoveInterrupt(int64_t id) {
+    absl::MutexLock lock(&mutex_);
+    interrupts_.erase(id);
+  }
+
+  // May be called repeatedly, re-issuing the interrupts.
+  void Cancel() {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+    for (const auto& pair : interrupts_) {
+      pair.second();
+    }
+  }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+  absl::Mutex mutex_;
+  absl::flat_hash_map<int64_t, std::function<void()>> interrupts_;
+  int64_t next_id_ = 0;
+};
+
+enum class Corner { kZero, kOne, kAllOnes, kSignedMin, kSignedMax };
+
+constexpr Corner kCorners[] = {Corner::kZero, Corner::kOne, Corner::kAllOnes,
+                               Corner::kSignedMin, Corner::kSignedMax};
+
+// Returns the value of the given type whose bits-typed leaves are all at the
+// given corner.
+Value CornerValue(Type* type, Corner corner) {
+  if (type->IsBits()) {
+    int64_t bit_count = type->AsBitsOrDie()->bit_count();
+    if (bit_count == 0) {
+      return Value(Bits());
+    }
+    switch (corner) {
+      case Corner::kZero:
+        return Value(Bits(bit_count));
+      case Corner::kOne:
+        return Value(UBits(1, bit_count));
+      case Corner::kAllOnes:
+        return Value(Bits::AllOnes(bit_count));
+      case Corner::kSignedMin:
+        return Value(Bits::MinSigned(bit_count));
+      case Corner::kSignedMax:
+        return Value(Bits::MaxSigned(bit_count));
+    }
+  }
+  if (type->IsTuple()) {
+    std::vector<Value> elements;
+    for (Type* element_type : type->AsTupleOrDie()->element_types()) {
+      elements.push_back(CornerValue(element_type, corner));
+    }
+    return Value::TupleOwned(std::move(elements));
+  }
+  if (type->IsArray()) {
+    ArrayType* array_type = type->AsArrayOrDie();
+    return Value::ArrayOwned(std::vector<Value>(
+        array_type->size(), CornerValue(array_type->element_type(), corner)));
+  }
+  return Value::Token();
+}
+
+// Returns the corner-case argument sets described at RunSimulationPrefilter().
+std::vector<std::vector<Value>> CornerCaseArguments(Function* f) {
+  std::vector<Value> zeros;
+  for (Param* param : f->params()) {
+    zeros.push_back(CornerValue(param->GetType(), Corner::kZero));
+  }
+  std::vector<std::vector<Value>> arg_sets;
+  for (Corner corner : kCorners) {
+    std::vector<Value> args;
+    for (Param* param : f->params()) {
+      args.push_back(CornerValue(param->GetType(), corner));
+    }
+    arg_sets.push_back(std::move(args));
+    if (corner == Corner::kZero || f->params().size() < 2) {
+      continue;
+    }
+    for (int64_t i = 0; i < f->params().size(); ++i) {
+      std::vector<Value> single = zeros;
+      single[i] = CornerValue(f->params()[i]->GetType(), corner);
+      arg_sets.push_back(std::move(single));
+    }
+  }
+  return arg_sets;
+}
+
+std::string SatisfiableLine(EquivalenceStatus status) {
+  // The format of z3::SolverResultToString(), for consistent tool output.
+  switch (status) {
+    case EquivalenceStatus::kEquivalent:
+      return "Solver result; satisfiable: false\n";
+    case EquivalenceStatus::kNotEquivalent:
+      return "Solver result; satisfiable: true\n";
+    case EquivalenceStatus::kUnknown:
+      return "Solver result; satisfiable: undef\n";
+  }
+  return "";
+}
+
+absl::Status CheckBitsSignature(Function* f) {
+  for (Param* param : f->params()) {
+    if (!param->GetType()->IsBits()) {
+      return absl::UnimplementedError(absl::StrCat(
+          "Cannot bit-blast non-bits-typed parameter: ", param->ToString()));
+    }
+  }
+  if (!f->return_value()->GetType()->IsBits()) {
+    return absl::UnimplementedError(
+        absl::StrCat("Cannot bit-blast non-bits-typed return value: ",
+                     f->return_value()->ToString()));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<EquivalenceResult> CheckWithZ3(Function* a, Function* b,
+                                              absl::string_view tactic,
+                                              int64_t num_threads,
+                                              absl::Duration timeout,
+                                              Cancellation* cancellation) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrTranslator> translator_a,
+                       IrTranslator::CreateAndTranslate(a));
+
+  // Map the second function's parameters to those of the first.
+  Z3_context ctx = translator_a->ctx();
+  std::vector<Z3_ast> z3_params;
+  for (const Param* param : a->params()) {
+    z3_params.push_back(translator_a->GetTranslation(param));
+  }
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<IrTranslator> translator_b,
+      IrTranslator::CreateAndTranslate(ctx, b, absl::MakeSpan(z3_params)));
+
+  Z3_ast result_a = translator_a->GetReturnNode();
+  Z3_ast result_b = translator_b->GetReturnNode();
+  XLS_RET_CHECK(Z3_is_eq_sort(ctx, Z3_get_sort(ctx, result_a),
+                              Z3_get_sort(ctx, result_b)));
+  Z3_ast results_equal = Z3_mk_eq(ctx, result_a, result_b);
+  translator_a->SetTimeout(timeout);
+
+  Z3_solver solver;
+  if (tactic.empty()) {
+    solver = solvers::z3::CreateSolver(ctx, num_threads);
+  } else {
+    Z3_tactic z3_tactic = nullptr;
+    for (absl::string_view name : absl::StrSplit(tactic, ',')) {
+      Z3_tactic next = Z3_mk_tactic(ctx, std::string(name).c_str());
+      Z3_tactic_inc_ref(ctx, next);
+      if (z3_tactic == nullptr) {
+        z3_tactic = next;
+        continue;
+      }
+      Z3_tactic both = Z3_tactic_and_then(ctx, z3_tactic, next);
+      Z3_tactic_inc_ref(ctx, both);
+      Z3_tactic_dec_ref(ctx, z3_tactic);
+      Z3_tactic_dec_ref(ctx, next);
+      z3_tactic = both;
+    }
+    solver = Z3_mk_solver_from_tactic(ctx, z3_tactic);
+    Z3_solver_inc_ref(ctx, solver);
+    Z3_tactic_dec_ref(ctx, z3_tactic);
+  }
+
+  // Remember: we try to prove the condition by searching for a model that
+  // produces the opposite result. Thus, we want to find a model where the
+  // results are _not_ equal.
+  Z3_ast objective = Z3_mk_eq(ctx, Z3_mk_false(ctx), results_equal);
+  Z3_solver_assert(ctx, solver, objective);
+
+  int64_t interrupt =
+      cancellation->AddInterrupt([ctx]() { Z3_interrupt(ctx); });
+  Z3_lbool satisfiable = cancellation->cancelled()
+                             ? Z3_L_UNDEF
+                             : Z3_solver_check(ctx, solver);
+  cancellation->RemoveInterrupt(interrupt);
+
+  EquivalenceResult result;
+  result.details = solvers::z3::SolverResultToString(ctx, solver, satisfiable);
+  if (satisfiable == Z3_L_TRUE) {
+    result.status = EquivalenceStatus::kNotEquivalent;
+  } else if (satisfiable == Z3_L_FALSE) {
+    result.status = EquivalenceStatus::kEquivalent;
+  } else {
+    absl::StrAppend(&result.details, "Reason: ",
+                    Z3_solver_get_reason_unknown(ctx, solver), "\n");
+  }
+  Z3_solver_dec_ref(ctx, solver);
+  return result;
+}
+
+// Bit-blasts both functions into a single and-inverter graph, driven by the
+// same inputs, and solves the CNF of the miter of their return values.
+absl::StatusOr<EquivalenceResult> CheckWithSat(Function* a, Function* b,
+                                               absl::Duration timeout,
+                                               Cancellation* cancellation) {
+  XLS_RETURN_IF_ERROR(CheckBitsSignature(a));
+  Aig aig;
+  absl::flat_hash_map<const Node*, AigEvaluator::Vector> inputs_a;
+  absl::flat_hash_map<const Node*, AigEvaluator::Vector> inputs_b;
+  for (int64_t i = 0; i < a->params().size(); ++i) {
+    AigEvaluator::Vector value;
+    for (int64_t j = 0; j < a->params()[i]->BitCountOrDie(); ++j) {
+      value.push_back(aig.AddInput());
+    }
+    inputs_a[a->params()[i]] = value;
+    inputs_b[b->params()[i]] = value;
+  }
+
+  const Node* return_a = a->return_value();
+  const Node* return_b = b->return_value();
+  XLS_ASSIGN_OR_RETURN(
+      auto values_a, solvers::TranslateIrToAig(
+                         &aig, a, inputs_a, absl::MakeConstSpan(&return_a, 1)));
+  XLS_ASSIGN_OR_RETURN(
+      auto values_b, solvers::TranslateIrToAig(
+                         &aig, b, inputs_b, absl::MakeConstSpan(&return_b, 1)));
+  const AigEvaluator::Vector& result_a = values_a.at(return_a);
+  const AigEvaluator::Vector& result_b = values_b.at(return_b);
+  XLS_RET_CHECK_EQ(result_a.size(), result_b.size());
+  std::vector<std::pair<solvers::AigLiteral, solvers::AigLiteral>> outputs;
+  for (int64_t i = 0; i < result_a.size(); ++i) {
+    outputs.push_back({result_a[i], result_b[i]});
+  }
+
+  absl::StatusOr<absl::optional<std::vector<bool>>> counterexample =
+      solvers::FindAigCounterexample(aig, outputs, timeout,
+                                     cancellation->flag());
+  EquivalenceResult result;
+  if (absl::IsDeadlineExceeded(counterexample.status()) ||
+      absl::IsCancelled(counterexample.status())) {
+    result.details = absl::StrCat(SatisfiableLine(result.status),
+                                  counterexample.status().message(), "\n");
+    return result;
+  }
+  XLS_RETURN_IF_ERROR(counterexample.status());
+  if (!counterexample->has_value()) {
+    result.status = EquivalenceStatus::kEquivalent;
+  } else {
+    result.status = EquivalenceStatus::kNotEquivalent;
+    std::vector<Value> args;
+    int64_t input_index = 0;
+    for (Param* param : a->params()) {
+      BitsRope rope(param->BitCountOrDie());
+      for (int64_t i = 0; i < param->BitCountOrDie(); ++i) {
+        rope.push_back(counterexample->value()[input_index++]);
+      }
+      args.push_back(Value(rope.Build()));
+    }
+    result.counterexample = std::move(args);
+  }
+  result.details = SatisfiableLine(result.status);
+  return result;
+}
+
+// Builds a BDD of "a(x) == b(x)" in a scratch package; the functions are only
+// read, so this is safe to run alongside the other strategies.
+absl::StatusOr<EquivalenceResult> CheckWithBdd(Function* a, Function* b) {
+  XLS_RETURN_IF_ERROR(CheckBitsSignature(a));
+  Package package("bdd_miter");
+  XLS_ASSIGN_OR_RETURN(Function * a_clone, a->Clone("a", &package));
+  XLS_ASSIGN_OR_RETURN(Function * b_clone, b->Clone("b", &package));
+  FunctionBuilder builder("miter", &package);
+  std::vector<BValue> params;
+  for (Param* param : a->params()) {
+    XLS_ASSIGN_OR_RETURN(Type * type,
+                         package.MapTypeFromOtherPackage(param->GetType()));
+    params.push_back(builder.Param(param->GetName(), type));
+  }
+  builder.Eq(builder.Invoke(params, a_clone), builder.Invoke(params, b_clone));
+  XLS_ASSIGN_OR_RETURN(Function * miter, builder.Build());
+  PassResults pass_results;
+  XLS_RETURN_IF_ERROR(
+      InliningPass().Run(&package, PassOptions(), &pass_results).status());
+
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<BddFunction> bdd_function,
+      BddFunction::Run(miter, kBddMintermLimit, /*do_not_evaluate_ops=*/{},
+                       kBddNodeLimit));
+  BddNodeIndex equal = bdd_function->GetBddNode(miter->return_value(), 0);
+  EquivalenceResult result;
+  if (equal == bdd_function->bdd().one()) {
+    result.status = EquivalenceStatus::kEquivalent;
+  } else if (equal == bdd_function->bdd().zero()) {
+    // The results differ for every input, including all zeros.
+    result.status = EquivalenceStatus::kNotEquivalent;
+    std::vector<Value> args;
+    for (Param* param : a->params()) {
+      args.push_back(Value(UBits(0, param->BitCountOrDie())));
+    }
+    result.counterexample = std::move(args);
+  }
+  result.details = SatisfiableLine(result.status);
+  if (result.status == EquivalenceStatus::kUnknown) {
+    absl::StrAppend(&result.details,
+                    "The BDD of the comparison is not constant.\n");
+  }
+  return result;
+}
+
+// Compiles "a" and "b" with the JIT concurrently.
+absl::StatusOr<std::vector<std::unique_ptr<IrJit>>> CompileBoth(Function* a,
+                                                                Function* b) {
+  JitCompileService service(/*thread_count=*/2);
+  return service.CompileAll({a, b});
+}
+
+absl::StatusOr<EquivalenceResult> CheckWithSimulation(
+    Function* a, Function* b, absl::Duration timeout,
+    Cancellation* cancellation) {
+  XLS_ASSIGN_OR_RETURN(std::vector<std::unique_ptr<IrJit>> jits,
+                       CompileBoth(a, b));
+  std::unique_ptr<IrJit> jit_a = std::move(jits[0]);
+  std::unique_ptr<IrJit> jit_b = std::move(jits[1]);
+  absl::Time deadline = absl::Now() + timeout;
+  std::minstd_rand engine;
+  std::vector<std::vector<Value>> corner_cases = CornerCaseArguments(a);
+  EquivalenceResult result;
+  int64_t sample = 0;
+  for (; sample < kMaxSimulationSamples; ++sample) {
+    if (sample % 1024 == 0 &&
+        (cancellation->cancelled() || absl::Now() >= deadline)) {
+      break;
+    }
+    std::vector<Value> args = sample < corner_cases.size()
+                                  ? corner_cases[sample]
+                                  : RandomFunctionArguments(a, &engine);
+    XLS_ASSIGN_OR_RETURN(Value result_a, jit_a->Run(args));
+    XLS_ASSIGN_OR_RETURN(Value result_b, jit_b->Run(args));
+    if (result_a != result_b) {
+      result.status = EquivalenceStatus::kNotEquivalent;
+      result.details = absl::StrCat(
+          SatisfiableLine(result.status), "Sample ", sample, ": ", a->name(),
+          " returns ", result_a.ToString(), ", ", b->name(), " returns ",
+          result_b.ToString(), "\n");
+      result.counterexample = std::move(args);
+      return result;
+    }
+  }
+  result.details =
+      absl::StrCat(SatisfiableLine(result.status), "No difference found in ",
+                   sample, " random samples.\n");
+  return result;
+}
+
+absl::Status CheckSignatures(Function* a, Function* b) {
+  XLS_RET_CHECK_EQ(a->params().size(), b->params().size());
+  for (int64_t i = 0; i < a->params().size(); ++i) {
+    XLS_RET_CHECK(
+        a->params()[i]->GetType()->IsEqualTo(b->params()[i]->GetType()))
+        << "Parameter " << i << " types differ.";
+  }
+  XLS_RET_CHECK(a->return_value()->GetType()->IsEqualTo(
+      b->return_value()->GetType()))
+      << "Return types differ.";
+  return absl::OkStatus();
+}
+
+absl::StatusOr<EquivalenceResult> RunStrategy(Function* a, Function* b,
+                                              absl::string_view strategy,
+                                              absl::Duration timeout,
+                                              int64_t z3_threads,
+                                              Cancellation* cancellation) {
+  absl::Time start = absl::Now();
+  absl::StatusOr<EquivalenceResult> result;
+  auto tactic = Z3Tactics().find(strategy);
+  if (tactic != Z3Tactics().end()) {
+    result =
+        CheckWithZ3(a, b, tactic->second, z3_threads, timeout, cancellation);
+  } else if (strategy == "sat") {
+    result = CheckWithSat(a, b, timeout, cancellation);
+  } else if (strategy == "bdd") {
+    result = CheckWithBdd(a, b);
+  } else if (strategy == "simulation") {
+    result = CheckWithSimulation(a, b, timeout, cancellation);
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown equivalence strategy: ", strategy));
+  }
+  if (result.ok()) {
+    result->strategy = std::string(strategy);
+    result->duration = absl::Now() - start;
+  }
+  return result;
+}
+
+// The shared state of a portfolio run.
+struct PortfolioState {
+  absl::Mutex mutex;
+  std::vector<absl::optional<absl::StatusOr<EquivalenceResult>>> results;
+  int64_t running;
+  absl::optional<int64_t> winner;
+};
+
+}  // namespace
+
+std::vector<std::string> EquivalenceStrategyNames() {
+  return {"z3", "z3_qfbv", "z3_bitblast", "sat", "bdd", "simulation"};
+}
+
+absl::StatusOr<EquivalenceResult> CheckEquivalence(Function* a, Function* b,
+                                                   absl::string_view strategy,
+                                                   absl::Duration timeout) {
+  XLS_RETURN_IF_ERROR(CheckSignatures(a, b));
+  Cancellation cancellation;
+  return RunStrategy(a, b, strategy, timeout,
+                     std::thread::hardware_concurrency(), &cancellation);
+}
+
+absl::StatusOr<EquivalenceResult> CheckEquivalencePortfolio(
+    Function* a, Function* b, absl::Span<const std::string> strategies,
+    absl::Duration timeout) {
+  XLS_RETURN_IF_ERROR(CheckSignatures(a, b));
+  XLS_RET_CHECK(!strategies.empty());
+  Cancellation cancellation;
+  PortfolioState state;
+  state.results.resize(strategies.size());
+  state.running = strategies.size();
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 0; i < strategies.size(); ++i) {
+    threads.push_back(std::make_unique<Thread>([&, i]() {
+      // The strategies share the machine, so each Z3 solver gets one thread.
+      absl::StatusOr<EquivalenceResult> result =
+          RunStrategy(a, b, strategies[i], timeout, /*z3_threads=*/1,
+                      &cancellation);
+      XLS_VLOG(1) << "Strategy " << strategies[i] << " finished: "
+                  << (result.ok() ? result->details
+                                  : result.status().ToString());
+      absl::MutexLock lock(&state.mutex);
+      if (result.ok() && result->status != EquivalenceStatus::kUnknown &&
+          !state.winner.has_value()) {
+        state.winner = i;
+      }
+      state.results[i] = std::move(result);
+      --state.running;
+    }));
+  }
+
+  {
+    absl::MutexLock lock(&state.mutex);
+    state.mutex.Await(absl::Condition(
+        +[](PortfolioState* s) { return s->running == 0 || s->winner; },
+        &state));
+  }
+  // A Z3 interrupt issued just before its search starts may be lost, so keep
+  // interrupting until every strategy has stopped.
+  while (true) {
+    cancellation.Cancel();
+    absl::MutexLock lock(&state.mutex);
+    if (state.mutex.AwaitWithTimeout(
+            absl::Condition(+[](PortfolioState* s) { return s->running == 0; },
+                            &state),
+            absl::Milliseconds(100))) {
+      break;
+    }
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+
+  if (state.winner.has_value()) {
+    return std::move(state.results[*state.winner]->value());
+  }
+  EquivalenceResult result;
+  result.strategy = "portfolio";
+  result.details = SatisfiableLine(result.status);
+  for (int64_t i = 0; i < strategies.size(); ++i) {
+    const absl::StatusOr<EquivalenceResult>& strategy_result =
+        *state.results[i];
+    absl::StrAppend(&result.details, "  ", strategies[i], ": ",
+                    strategy_result.ok()
+                        ? absl::StrCat("inconclusive after ",
+                                       absl::FormatDuration(
+                                           strategy_result->duration))
+                        : strategy_result.status().ToString(),
+                    "\n");
+  }
+  return result;
+}
+
+absl::StatusOr<EquivalenceResult> RunSimulationPrefilter(
+    Function* a, Function* b, int64_t vector_count, int64_t thread_count) {
+  XLS_RETURN_IF_ERROR(CheckSignatures(a, b));
+  absl::Time start = absl::Now();
+  // IrJit::RunBatch() only uses buffers local to the call, so the threads
+  // share one compilation of each function.
+  XLS_ASSIGN_OR_RETURN(std::vector<std::unique_ptr<IrJit>> jits,
+                       CompileBoth(a, b));
+  std::unique_ptr<IrJit> jit_a = std::move(jits[0]);
+  std::unique_ptr<IrJit> jit_b = std::move(jits[1]);
+
+  std::vector<std::vector<Value>> corner_cases = CornerCaseArguments(a);
+  const int64_t corner_batches =
+      (corner_cases.size() + kPrefilterBatchSize - 1) / kPrefilterBatchSize;
+  const int64_t batch_count =
+      corner_batches +
+      (vector_count + kPrefilterBatchSize - 1) / kPrefilterBatchSize;
+  if (thread_count <= 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  thread_count = std::max<int64_t>(1, std::min(thread_count, batch_count));
+
+  // Batches are claimed in order, and every batch before the first one with a
+  // mismatch is completed, so the counterexample found is deterministic.
+  absl::Mutex mutex;
+  int64_t next_batch = 0;
+  int64_t found_batch = batch_count;
+  absl::Status status;
+  EquivalenceResult result;
+  auto worker = [&]() {
+    while (true) {
+      int64_t batch;
+      {
+        absl::MutexLock lock(&mutex);
+        if (next_batch >= found_batch) {
+          return;
+        }
+        batch = next_batch++;
+      }
+      std::vector<std::vector<Value>> arg_sets;
+      if (batch < corner_batches) {
+        int64_t begin = batch * kPrefilterBatchSize;
+        int64_t end = std::min<int64_t>(begin + kPrefilterBatchSize,
+                                        corner_cases.size());
+        arg_sets.assign(corner_cases.begin() + begin,
+                        corner_cases.begin() + end);
+      } else {
+        std::minstd_rand engine(batch);
+        int64_t first = (batch - corner_batches) * kPrefilterBatchSize;
+        int64_t size =
+            std::min<int64_t>(kPrefilterBatchSize, vector_count - first);
+        for (int64_t i = 0; i < size; ++i) {
+          arg_sets.push_back(RandomFunctionArguments(a, &engine));
+        }
+      }
+      absl::StatusOr<std::vector<Value>> results_a = jit_a->RunBatch(arg_sets);
+      absl::StatusOr<std::vector<Value>> results_b = jit_b->RunBatch(arg_sets);
+      if (!results_a.ok() || !results_b.ok()) {
+        absl::MutexLock lock(&mutex);
+        status.Update(results_a.status());
+        status.Update(results_b.status());
+        found_batch = std::min(found_batch, batch);
+        return;
+      }
+      for (int64_t i = 0; i < arg_sets.size(); ++i) {
+        if (results_a->at(i) == results_b->at(i)) {
+          continue;
+        }
+        absl::MutexLock lock(&mutex);
+        if (batch < found_batch) {
+          found_batch = batch;
+          result.status = EquivalenceStatus::kNotEquivalent;
+          result.details = absl::StrCat(
+              SatisfiableLine(result.status), a->name(), " returns ",
+              results_a->at(i).ToString(), ", ", b->name(), " returns ",
+              results_b->at(i).ToString(), "\n");
+          result.counterexample = std::move(arg_sets[i]);
+        }
+        break;
+      }
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 0; i < thread_count; ++i) {
+    threads.push_back(std::make_unique<Thread>(worker));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  XLS_RETURN_IF_ERROR(status);
+  result.strategy = "simulation_prefilter";
+  result.duration = absl::Now() - start;
+  if (result.status == EquivalenceStatus::kUnknown) {
+    result.details = absl::StrCat(
+        SatisfiableLine(result.status), "No difference found in ",
+        corner_cases.size() + vector_count, " samples.\n");
+  }
+  return result;
+}
+
+}  // namespace xls
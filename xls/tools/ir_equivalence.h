@@ -0,0 +1,93 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_TOOLS_IR_EQUIVALENCE_H_
+#define XLS_TOOLS_IR_EQUIVALENCE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+enum class EquivalenceStatus { kEquivalent, kNotEquivalent, kUnknown };
+
+struct EquivalenceResult {
+  EquivalenceStatus status = EquivalenceStatus::kUnknown;
+
+  // The name of the strategy which produced this result.
+  std::string strategy;
+
+  // Arguments for which the functions' results differ, if the strategy can
+  // produce them.
+  absl::optional<std::vector<Value>> counterexample;
+
+  // Strategy-specific output, such as the Z3 model or the reason a strategy
+  // gave up.
+  std::string details;
+
+  absl::Duration duration;
+};
+
+// The equivalence-checking strategies, by name:
+//  - "z3": Z3's default solver over the bit-vector translation of both
+//    functions.
+//  - "z3_qfbv": Z3 with its "qfbv" tactic.
+//  - "z3_bitblast": Z3 with a simplify/bit-blast/SAT tactic pipeline.
+//  - "sat": both functions bit-blasted to CNF for the embedded SAT solver.
+//  - "bdd": a BDD of the miter of both functions; this only reaches a verdict
+//    if the BDD of the comparison is constant.
+//  - "simulation": JIT-compiled random simulation; this only finds
+//    counterexamples.
+// The bit-blasting strategies ("sat" and "bdd") only support bits-typed
+// parameters and return values.
+std::vector<std::string> EquivalenceStrategyNames();
+
+// Checks whether functions "a" and "b", which must have the same signature
+// and contain no invocations, always compute the same result, using the named
+// strategy. Returns an UnimplementedError if the strategy does not support the
+// functions.
+absl::StatusOr<EquivalenceResult> CheckEquivalence(Function* a, Function* b,
+                                                   absl::string_view strategy,
+                                                   absl::Duration timeout);
+
+// Runs the given strategies concurrently, each in its own thread (and, for the
+// Z3 strategies, its own Z3 context), and returns the first conclusive result,
+// interrupting the strategies still running. If none is conclusive, returns a
+// result with status kUnknown whose details summarize each strategy's outcome.
+absl::StatusOr<EquivalenceResult> CheckEquivalencePortfolio(
+    Function* a, Function* b, absl::Span<const std::string> strategies,
+    absl::Duration timeout);
+
+// A cheap prefilter for the strategies above: evaluates both functions,
+// JIT-compiled, on corner-case arguments (all parameters zero, one, all ones,
+// or the smallest or largest signed value, and each parameter alone at one of
+// those values with the others zero) and "vector_count" random ones, over
+// "thread_count" threads (one per core if <= 0). Returns a kNotEquivalent
+// result with a counterexample if any results differ, and a kUnknown result
+// otherwise.
+absl::StatusOr<EquivalenceResult> RunSimulationPrefilter(
+    Function* a, Function* b, int64_t vector_count, int64_t thread_count = 0);
+
+}  // namespace xls
+
+#endif  // XLS_TOOLS_IR_EQUIVALENCE_H_
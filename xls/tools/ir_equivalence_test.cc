@@ -0,0 +1,162 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_equivalence.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace {
+
+class IrEquivalenceTest : public IrTestBase {
+ protected:
+  // Parses a package holding functions "a" and "b".
+  void ParseFunctions(const std::string& ir_text) {
+    XLS_ASSERT_OK_AND_ASSIGN(package_, ParsePackage(ir_text));
+    XLS_ASSERT_OK_AND_ASSIGN(a_, package_->GetFunction("a"));
+    XLS_ASSERT_OK_AND_ASSIGN(b_, package_->GetFunction("b"));
+  }
+
+  std::unique_ptr<Package> package_;
+  Function* a_;
+  Function* b_;
+};
+
+constexpr char kEquivalentIr[] = R"(
+package p
+
+fn a(x: bits[8], y: bits[8]) -> bits[8] {
+  ret add.3: bits[8] = add(x, y)
+}
+
+fn b(x: bits[8], y: bits[8]) -> bits[8] {
+  ret add.3: bits[8] = add(y, x)
+}
+)";
+
+// The functions only differ for x == 0x2a.
+constexpr char kNotEquivalentIr[] = R"(
+package p
+
+fn a(x: bits[8]) -> bits[8] {
+  ret neg.2: bits[8] = neg(x)
+}
+
+fn b(x: bits[8]) -> bits[8] {
+  literal.2: bits[8] = literal(value=42)
+  eq.3: bits[1] = eq(x, literal.2)
+  neg.4: bits[8] = neg(x)
+  ret sel.5: bits[8] = sel(eq.3, cases=[neg.4, x])
+}
+)";
+
+TEST_F(IrEquivalenceTest, StrategiesProveEquivalence) {
+  ParseFunctions(kEquivalentIr);
+  for (const std::string& strategy : {"z3", "z3_qfbv", "z3_bitblast", "sat",
+                                      "bdd"}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        EquivalenceResult result,
+        CheckEquivalence(a_, b_, strategy, absl::InfiniteDuration()));
+    EXPECT_EQ(result.status, EquivalenceStatus::kEquivalent) << strategy;
+    EXPECT_EQ(result.strategy, strategy);
+  }
+}
+
+TEST_F(IrEquivalenceTest, StrategiesFindCounterexample) {
+  ParseFunctions(kNotEquivalentIr);
+  for (const std::string& strategy : {"z3", "sat", "simulation"}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        EquivalenceResult result,
+        CheckEquivalence(a_, b_, strategy, absl::InfiniteDuration()));
+    EXPECT_EQ(result.status, EquivalenceStatus::kNotEquivalent) << strategy;
+    if (result.counterexample.has_value()) {
+      EXPECT_EQ(*result.counterexample,
+                std::vector<Value>({Value(UBits(42, 8))}))
+          << strategy;
+    }
+  }
+}
+
+TEST_F(IrEquivalenceTest, SimulationIsInconclusiveForEquivalentFunctions) {
+  ParseFunctions(kEquivalentIr);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      EquivalenceResult result,
+      CheckEquivalence(a_, b_, "simulation", absl::Milliseconds(100)));
+  EXPECT_EQ(result.status, EquivalenceStatus::kUnknown);
+}
+
+TEST_F(IrEquivalenceTest, PortfolioReturnsConclusiveResult) {
+  ParseFunctions(kEquivalentIr);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      EquivalenceResult result,
+      CheckEquivalencePortfolio(a_, b_, EquivalenceStrategyNames(),
+                                absl::InfiniteDuration()));
+  EXPECT_EQ(result.status, EquivalenceStatus::kEquivalent);
+  EXPECT_NE(result.strategy, "simulation");
+
+  ParseFunctions(kNotEquivalentIr);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      result, CheckEquivalencePortfolio(a_, b_, EquivalenceStrategyNames(),
+                                        absl::InfiniteDuration()));
+  EXPECT_EQ(result.status, EquivalenceStatus::kNotEquivalent);
+}
+
+TEST_F(IrEquivalenceTest, SimulationPrefilter) {
+  ParseFunctions(kNotEquivalentIr);
+  XLS_ASSERT_OK_AND_ASSIGN(EquivalenceResult result,
+                           RunSimulationPrefilter(a_, b_, 4096));
+  EXPECT_EQ(result.status, EquivalenceStatus::kNotEquivalent);
+  EXPECT_EQ(result.counterexample, std::vector<Value>({Value(UBits(42, 8))}));
+
+  ParseFunctions(kEquivalentIr);
+  XLS_ASSERT_OK_AND_ASSIGN(result, RunSimulationPrefilter(a_, b_, 4096));
+  EXPECT_EQ(result.status, EquivalenceStatus::kUnknown);
+}
+
+TEST_F(IrEquivalenceTest, SimulationPrefilterTriesCornerCases) {
+  // The functions only differ when y is the smallest signed value.
+  ParseFunctions(R"(
+package p
+
+fn a(x: bits[32], y: bits[32]) -> bits[32] {
+  ret add.3: bits[32] = add(x, y)
+}
+
+fn b(x: bits[32], y: bits[32]) -> bits[32] {
+  literal.3: bits[32] = literal(value=0x80000000)
+  eq.4: bits[1] = eq(y, literal.3)
+  add.5: bits[32] = add(x, y)
+  ret sel.6: bits[32] = sel(eq.4, cases=[add.5, x])
+}
+)");
+  XLS_ASSERT_OK_AND_ASSIGN(
+      EquivalenceResult result,
+      RunSimulationPrefilter(a_, b_, /*vector_count=*/0));
+  EXPECT_EQ(result.status, EquivalenceStatus::kNotEquivalent);
+}
+
+TEST_F(IrEquivalenceTest, UnknownStrategy) {
+  ParseFunctions(kEquivalentIr);
+  EXPECT_THAT(CheckEquivalence(a_, b_, "nope", absl::InfiniteDuration()),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace xls
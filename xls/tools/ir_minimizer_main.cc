@@ -13,12 +13,16 @@
 // limitations under the License.
 
 #include <random>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/random/distributions.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_split.h"
+#include "absl/types/span.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/temp_file.h"
 #include "xls/common/init_xls.h"
@@ -26,14 +30,13 @@
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/subprocess.h"
-#include "xls/interpreter/ir_interpreter.h"
+#include "xls/common/thread.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/number_parser.h"
 #include "xls/ir/value.h"
 #include "xls/ir/value_helpers.h"
 #include "xls/ir/verifier.h"
-#include "xls/jit/ir_jit.h"
 #include "xls/passes/arith_simplification_pass.h"
 #include "xls/passes/array_simplification_pass.h"
 #include "xls/passes/bit_slice_simplification_pass.h"
@@ -47,6 +50,7 @@
 #include "xls/passes/standard_pipeline.h"
 #include "xls/passes/tuple_simplification_pass.h"
 #include "xls/passes/unroll_pass.h"
+#include "xls/tools/ir_minimizer_oracle.h"
 
 const char* kUsage = R"(
 Tool for reducing IR to a minimal test case based on an external test.
@@ -74,6 +78,17 @@ from the interpreter results. Example invocation:
   ir_minimizer_main --test_llvm_jit --use_optimization_pipeline \
     --input='bits[32]:42; bits[1]:0' IR_FILE
 
+More generally, --test_oracle selects a test which runs in-process (see
+ir_minimizer_oracle.h), avoiding writing out the IR and spawning a test
+executable for every attempt:
+
+  ir_minimizer_main --test_oracle=opt_error \
+    --test_oracle_pass=bitslice_simp IR_FILE
+
+With --parallelism=N, each round generates a batch of N independent candidate
+simplifications of the current IR and tests them concurrently; the candidate
+with the fewest nodes among those which still exhibit the bug is kept.
+
 )";
 
 ABSL_FLAG(bool, can_remove_params, false,
@@ -85,6 +100,11 @@ ABSL_FLAG(int64_t, failed_attempt_limit, 256,
           "done reducing.");
 ABSL_FLAG(int64_t, total_attempt_limit, 16384,
           "Limit on total number of attempts to try before bailing.");
+ABSL_FLAG(int64_t, parallelism, 1,
+          "Number of candidate simplifications generated and tested "
+          "concurrently in each round of minimization. Every candidate counts "
+          "as one attempt towards --failed_attempt_limit and "
+          "--total_attempt_limit.");
 ABSL_FLAG(
     std::string, test_executable, "",
     "Path to test executable to run during minimization. The test accepts "
@@ -95,10 +115,24 @@ ABSL_FLAG(
 ABSL_FLAG(bool, test_llvm_jit, false,
           "Tests for differences between results from the JIT and the "
           "interpreter as the reduction test case. Must specify --input with "
-          "this flag.");
+          "this flag. Equivalent to --test_oracle=jit_mismatch.");
+ABSL_FLAG(std::string, test_oracle, "",
+          "In-process test used as the reduction test case instead of "
+          "--test_executable. One of: jit_mismatch (the JIT and interpreter "
+          "results differ), opt_mismatch (the interpreter results before and "
+          "after optimization differ), opt_error (optimization fails). The "
+          "mismatch oracles require --input.");
+ABSL_FLAG(std::string, test_oracle_pass, "",
+          "If specified, the opt_mismatch and opt_error oracles run only the "
+          "optimization pass with this short name rather than the standard "
+          "pipeline.");
+ABSL_FLAG(bool, fork_test_oracle, true,
+          "Runs each test of --test_oracle in a forked child process so "
+          "crashes in the code under test do not end the minimization. With "
+          "opt_error, a crash counts as exhibiting the bug.");
 ABSL_FLAG(std::string, input, "",
           "Input to use when invoking the JIT and the interpreter. Must be "
-          "used with --test_llvm_jit.");
+          "used with --test_llvm_jit or a mismatch --test_oracle.");
 ABSL_FLAG(
     std::string, test_only_inject_jit_result, "",
     "Test-only flag for injecting the result produced by the JIT. Used to "
@@ -127,10 +161,10 @@ float Random0To1(std::mt19937* rng) {
   return absl::Uniform<float>(*rng, 0.0f, 1.0f);
 }
 
-// Checks whether we still fail when attempting to run function "f". Optional
-// 'inputs' is required if --test_llvm_jit is used.
-absl::StatusOr<bool> StillFailsHelper(
-    absl::string_view ir_text, absl::optional<std::vector<Value>> inputs) {
+// Checks whether we still fail when attempting to run function "f". The
+// in-process 'oracle' is used unless --test_executable is given.
+absl::StatusOr<bool> StillFailsHelper(absl::string_view ir_text,
+                                      MinimizerOracle* oracle) {
   if (!absl::GetFlag(FLAGS_test_executable).empty()) {
     // Verify script exists and is executable.
     absl::Status exists_status =
@@ -171,28 +205,14 @@ absl::StatusOr<bool> StillFailsHelper(
     return result.ok();
   }
 
-  // Test for bugs by comparing the results of the JIT and interpreter.
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
-                       Parser::ParsePackage(ir_text));
-  XLS_RET_CHECK(inputs.has_value());
-  XLS_ASSIGN_OR_RETURN(Function * main, package->EntryFunction());
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
-  Value jit_result;
-  if (absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
-    XLS_ASSIGN_OR_RETURN(jit_result, jit->Run(*inputs));
-  } else {
-    XLS_ASSIGN_OR_RETURN(jit_result, Parser::ParseTypedValue(absl::GetFlag(
-                                         FLAGS_test_only_inject_jit_result)));
-  }
-  XLS_ASSIGN_OR_RETURN(Value interpreter_result,
-                       IrInterpreter::Run(main, *inputs));
-  return jit_result != interpreter_result;
+  XLS_RET_CHECK(oracle != nullptr);
+  return oracle->StillFails(ir_text);
 }
 
 // Wrapper around StillFails which memoizes the result. Optional test_cache is
 // used to memoize the results of testing the given IR.
 absl::StatusOr<bool> StillFails(
-    absl::string_view ir_text, absl::optional<std::vector<Value>> inputs,
+    absl::string_view ir_text, MinimizerOracle* oracle,
     absl::flat_hash_map<std::string, bool>* test_cache) {
   XLS_VLOG(1) << "=== Verifying contents still fails";
   XLS_VLOG_LINES(2, ir_text);
@@ -206,7 +226,7 @@ absl::StatusOr<bool> StillFails(
     }
   }
 
-  XLS_ASSIGN_OR_RETURN(bool result, StillFailsHelper(ir_text, inputs));
+  XLS_ASSIGN_OR_RETURN(bool result, StillFailsHelper(ir_text, oracle));
   if (test_cache != nullptr) {
     (*test_cache)[ir_text] = result;
   }
@@ -217,11 +237,11 @@ absl::StatusOr<bool> StillFails(
 // returns 'true' if the test (still) fails on that IR text.  Optional test
 // cache is used to memoize the results of testing the given IR.
 absl::Status VerifyStillFails(
-    absl::string_view ir_text, absl::optional<std::vector<Value>> inputs,
+    absl::string_view ir_text, MinimizerOracle* oracle,
     absl::string_view description,
     absl::flat_hash_map<std::string, bool>* test_cache) {
   XLS_ASSIGN_OR_RETURN(bool still_fails,
-                       StillFails(ir_text, inputs, test_cache));
+                       StillFails(ir_text, oracle, test_cache));
 
   if (!still_fails) {
     return absl::FailedPreconditionError(
@@ -480,9 +500,93 @@ absl::Status CleanUp(Function* f, bool can_remove_params) {
   return absl::OkStatus();
 }
 
+// A simplified version of the known-failing IR which is yet to be tested.
+struct Candidate {
+  std::string ir_text;
+  std::string which_transform;
+  std::string function_ir;
+  int64_t node_count;
+};
+
+// Parses "ir_text", simplifies its entry function and cleans it up. If the
+// function was changed, the result is stored in "candidate".
+absl::StatusOr<SimplificationResult> GenerateCandidate(
+    absl::string_view ir_text, absl::optional<std::vector<Value>> inputs,
+    bool can_remove_params, std::mt19937* rng, Candidate* candidate) {
+  XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+  XLS_VLOG_LINES(2, "=== Candidate for simplification:\n" + f->DumpIr());
+
+  std::string which_transform;
+  XLS_ASSIGN_OR_RETURN(SimplificationResult simplification,
+                       Simplify(f, inputs, rng, &which_transform));
+  if (simplification != SimplificationResult::kDidChange) {
+    return simplification;
+  }
+  XLS_LOG(INFO) << "Trying " << which_transform;
+
+  XLS_RETURN_IF_ERROR(CleanUp(f, can_remove_params));
+  XLS_VLOG_LINES(2, "=== After simplification [" + which_transform + "]\n" +
+                        f->DumpIr());
+
+  candidate->ir_text = package->DumpIr();
+  candidate->which_transform = std::move(which_transform);
+  candidate->function_ir = f->DumpIr();
+  candidate->node_count = f->node_count();
+  return simplification;
+}
+
+// Tests each of the candidates, concurrently running the tests of those whose
+// result is not in "test_cache". Returns whether each candidate still fails.
+absl::StatusOr<std::vector<bool>> CandidatesStillFail(
+    absl::Span<const Candidate> candidates, MinimizerOracle* oracle,
+    absl::flat_hash_map<std::string, bool>* test_cache) {
+  if (candidates.size() == 1) {
+    XLS_ASSIGN_OR_RETURN(
+        bool still_fails,
+        StillFails(candidates.front().ir_text, oracle, test_cache));
+    return std::vector<bool>{still_fails};
+  }
+
+  // Each distinct untested IR text is tested by its own thread; the cache is
+  // only accessed from this thread.
+  std::vector<std::string> untested;
+  absl::flat_hash_map<std::string, int64_t> untested_index;
+  for (const Candidate& candidate : candidates) {
+    if (!test_cache->contains(candidate.ir_text) &&
+        untested_index.insert({candidate.ir_text, untested.size()}).second) {
+      untested.push_back(candidate.ir_text);
+    }
+  }
+  std::vector<absl::StatusOr<bool>> results(untested.size(), false);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int64_t i = 0; i < untested.size(); ++i) {
+      threads.push_back(absl::make_unique<Thread>([&, i]() {
+        results[i] = StillFailsHelper(untested[i], oracle);
+      }));
+    }
+    for (std::unique_ptr<Thread>& thread : threads) {
+      thread->Join();
+    }
+  }
+  for (int64_t i = 0; i < untested.size(); ++i) {
+    XLS_RETURN_IF_ERROR(results[i].status());
+    (*test_cache)[untested[i]] = results[i].value();
+  }
+
+  std::vector<bool> still_fail;
+  for (const Candidate& candidate : candidates) {
+    still_fail.push_back(test_cache->at(candidate.ir_text));
+  }
+  return still_fail;
+}
+
 absl::Status RealMain(absl::string_view path,
                       const int64_t failed_attempt_limit,
-                      const int64_t total_attempt_limit) {
+                      const int64_t total_attempt_limit,
+                      const int64_t parallelism) {
+  XLS_RET_CHECK_GE(parallelism, 1);
   XLS_ASSIGN_OR_RETURN(std::string knownf_ir_text, GetFileContents(path));
   // Cache of test results to avoid duplicate invocations of the
   // test_executable.
@@ -492,8 +596,8 @@ absl::Status RealMain(absl::string_view path,
   absl::optional<std::vector<xls::Value>> inputs;
   if (!absl::GetFlag(FLAGS_input).empty()) {
     inputs = std::vector<xls::Value>();
-    XLS_QCHECK(absl::GetFlag(FLAGS_test_llvm_jit))
-        << "Can only specify --input with --test_llvm_jit";
+    XLS_QCHECK(absl::GetFlag(FLAGS_test_executable).empty())
+        << "Can only specify --input with --test_llvm_jit or --test_oracle";
     for (const absl::string_view& value_string :
          absl::StrSplit(absl::GetFlag(FLAGS_input), ';')) {
       XLS_ASSIGN_OR_RETURN(Value input, Parser::ParseTypedValue(value_string));
@@ -501,9 +605,31 @@ absl::Status RealMain(absl::string_view path,
     }
   }
 
+  // Create the in-process test, if one is used.
+  std::unique_ptr<MinimizerOracle> oracle;
+  if (absl::GetFlag(FLAGS_test_executable).empty()) {
+    std::string oracle_name = absl::GetFlag(FLAGS_test_llvm_jit)
+                                  ? "jit_mismatch"
+                                  : absl::GetFlag(FLAGS_test_oracle);
+    MinimizerOracleOptions oracle_options;
+    oracle_options.inputs = inputs;
+    oracle_options.pass_name = absl::GetFlag(FLAGS_test_oracle_pass);
+    if (!absl::GetFlag(FLAGS_test_only_inject_jit_result).empty()) {
+      XLS_ASSIGN_OR_RETURN(oracle_options.injected_jit_result,
+                           Parser::ParseTypedValue(absl::GetFlag(
+                               FLAGS_test_only_inject_jit_result)));
+    }
+    XLS_ASSIGN_OR_RETURN(oracle,
+                         CreateMinimizerOracle(oracle_name, oracle_options));
+    if (absl::GetFlag(FLAGS_fork_test_oracle)) {
+      oracle = absl::make_unique<ForkedMinimizerOracle>(
+          std::move(oracle), /*crash_is_failure=*/oracle_name == "opt_error");
+    }
+  }
+
   // Check what the user gave us actually fails.
   XLS_RETURN_IF_ERROR(VerifyStillFails(
-      knownf_ir_text, inputs,
+      knownf_ir_text, oracle.get(),
       "Originally-provided main function provided does not fail", &test_cache));
 
   const bool can_remove_params = absl::GetFlag(FLAGS_can_remove_params);
@@ -518,7 +644,7 @@ absl::Status RealMain(absl::string_view path,
     XLS_RETURN_IF_ERROR(VerifyPackage(package.get()));
     knownf_ir_text = package->DumpIr();
     XLS_RETURN_IF_ERROR(VerifyStillFails(
-        knownf_ir_text, inputs,
+        knownf_ir_text, oracle.get(),
         "Original main function does not fail after cleanup", &test_cache));
     XLS_LOG(INFO) << "=== Done cleaning up initial garbage";
   }
@@ -530,65 +656,73 @@ absl::Status RealMain(absl::string_view path,
   int64_t failed_simplification_attempts = 0;
   int64_t total_attempts = 0;
 
-  while (true) {
-    if (failed_simplification_attempts >= failed_attempt_limit) {
-      XLS_LOG(INFO) << "Hit failed-simplification-attempt-limit: "
-                    << failed_simplification_attempts;
-      // Used up all our attempts for this state.
-      break;
-    }
+  bool done = false;
+  while (!done) {
+    // Generate a batch of candidates from the known failing version.
+    std::vector<Candidate> candidates;
+    while (candidates.size() < parallelism) {
+      if (failed_simplification_attempts >= failed_attempt_limit) {
+        XLS_LOG(INFO) << "Hit failed-simplification-attempt-limit: "
+                      << failed_simplification_attempts;
+        // Used up all our attempts for this state.
+        done = true;
+        break;
+      }
 
-    total_attempts++;
-    if (total_attempts >= total_attempt_limit) {
-      XLS_LOG(INFO) << "Hit total-attempt-limit: " << total_attempts;
-      break;
-    }
+      total_attempts++;
+      if (total_attempts >= total_attempt_limit) {
+        XLS_LOG(INFO) << "Hit total-attempt-limit: " << total_attempts;
+        done = true;
+        break;
+      }
 
-    XLS_VLOG(1) << "=== Simplification attempt " << total_attempts;
+      XLS_VLOG(1) << "=== Simplification attempt " << total_attempts;
 
-    XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(knownf_ir_text));
-    XLS_ASSIGN_OR_RETURN(Function * candidate, package->EntryFunction());
-    XLS_VLOG_LINES(2,
-                   "=== Candidate for simplification:\n" + candidate->DumpIr());
+      Candidate candidate;
+      XLS_ASSIGN_OR_RETURN(
+          SimplificationResult simplification,
+          GenerateCandidate(knownf_ir_text, inputs, can_remove_params, &rng,
+                            &candidate));
 
-    // Simplify the function.
-    std::string which_transform;
-    XLS_ASSIGN_OR_RETURN(SimplificationResult simplification,
-                         Simplify(candidate, inputs, &rng, &which_transform));
+      // If we cannot change it, we're done.
+      if (simplification == SimplificationResult::kCannotChange) {
+        XLS_LOG(INFO) << "Cannot simplify any further, done!";
+        done = true;
+        break;
+      }
 
-    // If we cannot change it, we're done.
-    if (simplification == SimplificationResult::kCannotChange) {
-      XLS_LOG(INFO) << "Cannot simplify any further, done!";
-      break;
+      // If we happened to not change it (e.g. because the RNG said not to),
+      // keep going until we do. We still bump the counter to make sure we don't
+      // end up wedged in a state where we can't simplify anything.
+      if (simplification == SimplificationResult::kDidNotChange) {
+        XLS_VLOG(1) << "Did not change the sample.";
+        failed_simplification_attempts++;
+        continue;
+      }
+      candidates.push_back(std::move(candidate));
     }
-
-    // If we happened to not change it (e.g. because the RNG said not to), keep
-    // going until we do. We still bump the counter to make sure we don't end up
-    // wedged in a state where we can't simplify anything.
-    if (simplification == SimplificationResult::kDidNotChange) {
-      XLS_VLOG(1) << "Did not change the sample.";
-      failed_simplification_attempts++;
+    if (candidates.empty()) {
       continue;
     }
-    XLS_LOG(INFO) << "Trying " << which_transform;
-
-    // When we changed (simplified) it, clean it up then see if it still fails.
-    XLS_CHECK(simplification == SimplificationResult::kDidChange);
-    XLS_RETURN_IF_ERROR(CleanUp(candidate, can_remove_params));
 
-    XLS_VLOG_LINES(2, "=== After simplification [" + which_transform + "]\n" +
-                          candidate->DumpIr());
-
-    std::string candidate_ir_text = package->DumpIr();
-    XLS_ASSIGN_OR_RETURN(bool still_fails,
-                         StillFails(candidate_ir_text, inputs, &test_cache));
-    if (!still_fails) {
-      failed_simplification_attempts++;
+    // See which of the simplified candidates still fail, and keep the smallest.
+    XLS_ASSIGN_OR_RETURN(
+        std::vector<bool> still_fail,
+        CandidatesStillFail(candidates, oracle.get(), &test_cache));
+    const Candidate* best = nullptr;
+    for (int64_t i = 0; i < candidates.size(); ++i) {
+      if (still_fail[i] &&
+          (best == nullptr || candidates[i].node_count < best->node_count)) {
+        best = &candidates[i];
+      }
+    }
+    if (best == nullptr) {
+      failed_simplification_attempts += candidates.size();
       XLS_LOG(INFO) << "Sample no longer fails.";
       XLS_LOG(INFO) << "Failed simplification attempts now: "
                     << failed_simplification_attempts;
-      // That simplification caused it to stop failing, but keep going with the
-      // last known failing version and seeing if we can find something else
+      // Those simplifications caused it to stop failing, but keep going with
+      // the last known failing version and seeing if we can find something else
       // from there.
       continue;
     }
@@ -596,23 +730,21 @@ absl::Status RealMain(absl::string_view path,
     // We found something that definitely fails, update our "knownf" value and
     // reset our failed simplification attempt count since we see we've made
     // some forward progress.
-    XLS_RETURN_IF_ERROR(CleanUp(candidate, can_remove_params));
-
     XLS_RETURN_IF_ERROR(VerifyStillFails(
-        knownf_ir_text, inputs, "Known failure does not fail after cleanup!",
-        &test_cache));
+        knownf_ir_text, oracle.get(),
+        "Known failure does not fail after cleanup!", &test_cache));
 
-    knownf_ir_text = candidate_ir_text;
+    knownf_ir_text = best->ir_text;
 
-    std::cerr << "---\ntransform: " << which_transform << "\n"
-              << candidate->DumpIr() << "(" << candidate->node_count()
-              << " nodes)" << std::endl;
+    std::cerr << "---\ntransform: " << best->which_transform << "\n"
+              << best->function_ir << "(" << best->node_count << " nodes)"
+              << std::endl;
 
     failed_simplification_attempts = 0;
   }
 
   // Run the last test verification without the cache.
-  XLS_RETURN_IF_ERROR(VerifyStillFails(knownf_ir_text, inputs,
+  XLS_RETURN_IF_ERROR(VerifyStillFails(knownf_ir_text, oracle.get(),
                                        "Minimized function does not fail!",
                                        /*test_cache=*/nullptr));
 
@@ -633,13 +765,17 @@ int main(int argc, char** argv) {
                     << " <ir_path>";
   }
 
-  XLS_QCHECK(!absl::GetFlag(FLAGS_test_executable).empty() ^
-             absl::GetFlag(FLAGS_test_llvm_jit))
-      << "Must specify either --test_executable or --test_llvm_jit";
+  XLS_QCHECK(!absl::GetFlag(FLAGS_test_executable).empty() +
+                 absl::GetFlag(FLAGS_test_llvm_jit) +
+                 !absl::GetFlag(FLAGS_test_oracle).empty() ==
+             1)
+      << "Must specify exactly one of --test_executable, --test_llvm_jit or "
+         "--test_oracle";
 
   XLS_QCHECK_OK(xls::RealMain(positional_arguments[0],
                               absl::GetFlag(FLAGS_failed_attempt_limit),
-                              absl::GetFlag(FLAGS_total_attempt_limit)));
+                              absl::GetFlag(FLAGS_total_attempt_limit),
+                              absl::GetFlag(FLAGS_parallelism)));
 
   return EXIT_SUCCESS;
 }
@@ -76,6 +76,18 @@ fn foo() -> bits[32] {
 }
 """)
 
+  def test_minimize_add_parallel(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    test_sh_file = self.create_tempfile()
+    self._write_sh_script(test_sh_file.full_path, ['/bin/grep add $1'])
+    minimized_ir = subprocess.check_output([
+        IR_MINIMIZER_MAIN_PATH, '--test_executable=' + test_sh_file.full_path,
+        '--can_remove_params', '--parallelism=4', ir_file.full_path
+    ]).decode('utf-8')
+    self.assertIn('fn foo() -> bits[32] {', minimized_ir)
+    self.assertIn('add(', minimized_ir)
+    self.assertNotIn('not(', minimized_ir)
+
   def test_no_reduction_possible(self):
     ir_file = self.create_tempfile(content=ADD_IR)
     test_sh_file = self.create_tempfile()
@@ -154,6 +166,28 @@ fn foo(x: bits[32], y: bits[32], z: bits[32]) -> (bits[32], (bits[32], bits[32])
     # The minimizer should reduce the test case to just a literal.
     self.assertIn('ret literal', minimized_ir.decode('utf-8'))
 
+  def test_minimize_jit_mismatch_oracle(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    for fork in ('--fork_test_oracle', '--nofork_test_oracle'):
+      minimized_ir = subprocess.check_output([
+          IR_MINIMIZER_MAIN_PATH, '--test_oracle=jit_mismatch', fork,
+          '--input=bits[32]:0x42; bits[32]:0x123',
+          '--test_only_inject_jit_result=bits[32]:0x22', ir_file.full_path
+      ],
+                                             stderr=subprocess.PIPE)
+      self.assertIn('ret literal', minimized_ir.decode('utf-8'))
+
+  def test_opt_error_oracle_without_error(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    comp = subprocess.run([
+        IR_MINIMIZER_MAIN_PATH, '--test_oracle=opt_error', ir_file.full_path
+    ],
+                          stderr=subprocess.PIPE,
+                          check=False)
+    self.assertNotEqual(comp.returncode, 0)
+    self.assertIn('main function provided does not fail',
+                  comp.stderr.decode('utf-8'))
+
   def test_minimize_jit_mismatch_but_no_mismatch(self):
     ir_file = self.create_tempfile(content=ADD_IR)
     comp = subprocess.run([
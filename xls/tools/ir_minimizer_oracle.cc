@@ -0,0 +1,249 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_minimizer_oracle.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/strerror.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/jit/ir_jit.h"
+#include "xls/passes/standard_pipeline.h"
+
+namespace xls {
+namespace {
+
+// Compares the JIT's result with the interpreter's.
+class JitMismatchOracle : public MinimizerOracle {
+ public:
+  explicit JitMismatchOracle(const MinimizerOracleOptions& options)
+      : options_(options) {}
+
+  absl::StatusOr<bool> StillFails(absl::string_view ir_text) override {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(ir_text));
+    XLS_ASSIGN_OR_RETURN(Function * main, package->EntryFunction());
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<IrJit> jit, IrJit::Create(main));
+    Value jit_result;
+    if (options_.injected_jit_result.has_value()) {
+      jit_result = *options_.injected_jit_result;
+    } else {
+      XLS_ASSIGN_OR_RETURN(jit_result, jit->Run(*options_.inputs));
+    }
+    XLS_ASSIGN_OR_RETURN(Value interpreter_result,
+                         IrInterpreter::Run(main, *options_.inputs));
+    return jit_result != interpreter_result;
+  }
+
+ private:
+  MinimizerOracleOptions options_;
+};
+
+// Runs the standard pipeline, or the single pass of it named in the options,
+// on "package".
+absl::Status Optimize(Package* package, const MinimizerOracleOptions& options) {
+  std::unique_ptr<CompoundPass> pipeline =
+      CreateStandardPassPipeline(options.opt_level);
+  PassOptions pass_options;
+  if (!options.pass_name.empty()) {
+    pass_options.run_only_passes = std::vector<std::string>{options.pass_name};
+  }
+  PassResults results;
+  return pipeline->Run(package, pass_options, &results).status();
+}
+
+// Compares the interpreter's results before and after optimization.
+class OptMismatchOracle : public MinimizerOracle {
+ public:
+  explicit OptMismatchOracle(const MinimizerOracleOptions& options)
+      : options_(options) {}
+
+  absl::StatusOr<bool> StillFails(absl::string_view ir_text) override {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(ir_text));
+    XLS_ASSIGN_OR_RETURN(Function * main, package->EntryFunction());
+    XLS_ASSIGN_OR_RETURN(Value unoptimized_result,
+                         IrInterpreter::Run(main, *options_.inputs));
+    absl::Status status = Optimize(package.get(), options_);
+    if (!status.ok()) {
+      // A candidate the optimizer rejects exhibits a different bug.
+      XLS_VLOG(1) << "Optimization failed: " << status;
+      return false;
+    }
+    XLS_ASSIGN_OR_RETURN(main, package->EntryFunction());
+    XLS_ASSIGN_OR_RETURN(Value optimized_result,
+                         IrInterpreter::Run(main, *options_.inputs));
+    return unoptimized_result != optimized_result;
+  }
+
+ private:
+  MinimizerOracleOptions options_;
+};
+
+// Checks whether optimization returns an error.
+class OptErrorOracle : public MinimizerOracle {
+ public:
+  explicit OptErrorOracle(const MinimizerOracleOptions& options)
+      : options_(options) {}
+
+  absl::StatusOr<bool> StillFails(absl::string_view ir_text) override {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(ir_text));
+    absl::Status status = Optimize(package.get(), options_);
+    XLS_VLOG(1) << "Optimization status: " << status;
+    return !status.ok();
+  }
+
+ private:
+  MinimizerOracleOptions options_;
+};
+
+// The result of a query is written by the child process to a pipe as "T" or
+// "F", or as "E<status code>\n<message>" if the query returned an error.
+std::string SerializeResult(const absl::StatusOr<bool>& result) {
+  if (!result.ok()) {
+    return absl::StrCat("E", static_cast<int>(result.status().code()), "\n",
+                        result.status().message());
+  }
+  return result.value() ? "T" : "F";
+}
+
+absl::StatusOr<bool> DeserializeResult(absl::string_view text) {
+  if (text == "T" || text == "F") {
+    return text == "T";
+  }
+  size_t newline = text.find('\n');
+  int code;
+  XLS_RET_CHECK(!text.empty() && text[0] == 'E' &&
+                newline != absl::string_view::npos &&
+                absl::SimpleAtoi(text.substr(1, newline - 1), &code))
+      << "Malformed oracle result: " << text;
+  return absl::Status(static_cast<absl::StatusCode>(code),
+                      text.substr(newline + 1));
+}
+
+// Writes all of "data" to "fd", ignoring errors: the parent treats a truncated
+// result as a crash.
+void WriteAll(int fd, absl::string_view data) {
+  while (!data.empty()) {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data.remove_prefix(written);
+  }
+}
+
+}  // namespace
+
+std::vector<std::string> MinimizerOracleNames() {
+  return {"jit_mismatch", "opt_mismatch", "opt_error"};
+}
+
+absl::StatusOr<std::unique_ptr<MinimizerOracle>> CreateMinimizerOracle(
+    absl::string_view name, const MinimizerOracleOptions& options) {
+  if ((name == "jit_mismatch" || name == "opt_mismatch") &&
+      !options.inputs.has_value()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Oracle %s requires inputs", name));
+  }
+  if (name == "jit_mismatch") {
+    return absl::make_unique<JitMismatchOracle>(options);
+  }
+  if (name == "opt_mismatch") {
+    return absl::make_unique<OptMismatchOracle>(options);
+  }
+  if (name == "opt_error") {
+    return absl::make_unique<OptErrorOracle>(options);
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown oracle %s; expected one of: %s", name,
+                      absl::StrJoin(MinimizerOracleNames(), ", ")));
+}
+
+absl::StatusOr<bool> ForkedMinimizerOracle::StillFails(
+    absl::string_view ir_text) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return absl::InternalError(
+        absl::StrCat("Failed to create pipe: ", Strerror(errno)));
+  }
+  pid_t pid = fork();
+  if (pid == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    return absl::InternalError(
+        absl::StrCat("Failed to fork: ", Strerror(errno)));
+  }
+  if (pid == 0) {
+    // This is the child process: run the query and report its result without
+    // running any exit handlers of the parent's state.
+    close(fds[0]);
+    WriteAll(fds[1], SerializeResult(oracle_->StillFails(ir_text)));
+    close(fds[1]);
+    _exit(0);
+  }
+
+  // This is the parent process.
+  close(fds[1]);
+  std::string output;
+  char buffer[4096];
+  while (true) {
+    ssize_t bytes = read(fds[0], buffer, sizeof(buffer));
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes <= 0) {
+      break;
+    }
+    output.append(buffer, bytes);
+  }
+  close(fds[0]);
+
+  int wait_status;
+  while (waitpid(pid, &wait_status, 0) == -1) {
+    if (errno != EINTR) {
+      return absl::InternalError(
+          absl::StrCat("waitpid failed: ", Strerror(errno)));
+    }
+  }
+  if (!WIFEXITED(wait_status) || WEXITSTATUS(wait_status) != 0 ||
+      output.empty()) {
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "Oracle crashed (%s %d)",
+        WIFSIGNALED(wait_status) ? "signal" : "exit code",
+        WIFSIGNALED(wait_status) ? WTERMSIG(wait_status)
+                                 : WEXITSTATUS(wait_status));
+    return crash_is_failure_;
+  }
+  return DeserializeResult(output);
+}
+
+}  // namespace xls
@@ -0,0 +1,89 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_TOOLS_IR_MINIMIZER_ORACLE_H_
+#define XLS_TOOLS_IR_MINIMIZER_ORACLE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "xls/ir/value.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+
+// Decides in-process whether a candidate reduction of some IR still exhibits
+// the bug being minimized, without writing the IR out and running an external
+// test on it.
+class MinimizerOracle {
+ public:
+  virtual ~MinimizerOracle() = default;
+
+  // Returns true if the package "ir_text" still exhibits the bug. May be called
+  // concurrently from several threads.
+  virtual absl::StatusOr<bool> StillFails(absl::string_view ir_text) = 0;
+};
+
+struct MinimizerOracleOptions {
+  // Arguments the entry function is evaluated with. Required by the mismatch
+  // oracles.
+  absl::optional<std::vector<Value>> inputs;
+
+  // If non-empty, the optimization oracles only run the pass of the standard
+  // pipeline with this short name instead of the whole pipeline.
+  std::string pass_name;
+
+  int64_t opt_level = kMaxOptLevel;
+
+  // Test-only: used in place of the result produced by the JIT.
+  absl::optional<Value> injected_jit_result;
+};
+
+// The oracles, by name:
+//  - "jit_mismatch": the JIT's result for the inputs differs from the
+//    interpreter's.
+//  - "opt_mismatch": the interpreter's result for the inputs differs before
+//    and after optimization.
+//  - "opt_error": optimizing the package returns an error. When run in a
+//    ForkedMinimizerOracle, crashes of the optimization also count.
+std::vector<std::string> MinimizerOracleNames();
+
+absl::StatusOr<std::unique_ptr<MinimizerOracle>> CreateMinimizerOracle(
+    absl::string_view name, const MinimizerOracleOptions& options);
+
+// Runs each query of another oracle in a forked child process so crashes
+// (e.g., failed checks or segfaults) in the code under test don't take down
+// the minimizer. A child which dies without reporting a result is considered
+// to fail if "crash_is_failure", and not to otherwise.
+class ForkedMinimizerOracle : public MinimizerOracle {
+ public:
+  ForkedMinimizerOracle(std::unique_ptr<MinimizerOracle> oracle,
+                        bool crash_is_failure)
+      : oracle_(std::move(oracle)), crash_is_failure_(crash_is_failure) {}
+
+  absl::StatusOr<bool> StillFails(absl::string_view ir_text) override;
+
+ private:
+  std::unique_ptr<MinimizerOracle> oracle_;
+  bool crash_is_failure_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_TOOLS_IR_MINIMIZER_ORACLE_H_
@@ -0,0 +1,123 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_minimizer_oracle.h"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using testing::HasSubstr;
+
+constexpr char kAddIr[] = R"(
+package p
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  ret add.3: bits[8] = add(x, y)
+}
+)";
+
+MinimizerOracleOptions AddOptions() {
+  MinimizerOracleOptions options;
+  options.inputs = {Value(UBits(2, 8)), Value(UBits(3, 8))};
+  return options;
+}
+
+TEST(IrMinimizerOracleTest, JitMismatch) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MinimizerOracle> oracle,
+                           CreateMinimizerOracle("jit_mismatch", AddOptions()));
+  EXPECT_THAT(oracle->StillFails(kAddIr), IsOkAndHolds(false));
+
+  MinimizerOracleOptions options = AddOptions();
+  options.injected_jit_result = Value(UBits(6, 8));
+  XLS_ASSERT_OK_AND_ASSIGN(oracle,
+                           CreateMinimizerOracle("jit_mismatch", options));
+  EXPECT_THAT(oracle->StillFails(kAddIr), IsOkAndHolds(true));
+}
+
+TEST(IrMinimizerOracleTest, Optimization) {
+  for (const std::string& pass_name : {"", "cse"}) {
+    MinimizerOracleOptions options = AddOptions();
+    options.pass_name = pass_name;
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MinimizerOracle> mismatch,
+                             CreateMinimizerOracle("opt_mismatch", options));
+    EXPECT_THAT(mismatch->StillFails(kAddIr), IsOkAndHolds(false));
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MinimizerOracle> error,
+                             CreateMinimizerOracle("opt_error", options));
+    EXPECT_THAT(error->StillFails(kAddIr), IsOkAndHolds(false));
+  }
+}
+
+TEST(IrMinimizerOracleTest, BadOracles) {
+  EXPECT_THAT(CreateMinimizerOracle("foo", AddOptions()).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown oracle foo")));
+  EXPECT_THAT(
+      CreateMinimizerOracle("jit_mismatch", MinimizerOracleOptions()).status(),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("inputs")));
+}
+
+// Returns a fixed result, or aborts if given no result.
+class FixedOracle : public MinimizerOracle {
+ public:
+  explicit FixedOracle(absl::optional<absl::StatusOr<bool>> result)
+      : result_(std::move(result)) {}
+
+  absl::StatusOr<bool> StillFails(absl::string_view ir_text) override {
+    if (!result_.has_value()) {
+      abort();
+    }
+    return *result_;
+  }
+
+ private:
+  absl::optional<absl::StatusOr<bool>> result_;
+};
+
+TEST(IrMinimizerOracleTest, Forked) {
+  auto forked = [](absl::optional<absl::StatusOr<bool>> result,
+                   bool crash_is_failure) {
+    return ForkedMinimizerOracle(absl::make_unique<FixedOracle>(result),
+                                 crash_is_failure)
+        .StillFails(kAddIr);
+  };
+  EXPECT_THAT(forked(true, false), IsOkAndHolds(true));
+  EXPECT_THAT(forked(false, true), IsOkAndHolds(false));
+  EXPECT_THAT(forked(absl::NotFoundError("no\nentry"), false),
+              StatusIs(absl::StatusCode::kNotFound, "no\nentry"));
+  EXPECT_THAT(forked(absl::nullopt, true), IsOkAndHolds(true));
+  EXPECT_THAT(forked(absl::nullopt, false), IsOkAndHolds(false));
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MinimizerOracle> oracle,
+                           CreateMinimizerOracle("jit_mismatch", AddOptions()));
+  ForkedMinimizerOracle forked_jit(std::move(oracle),
+                                   /*crash_is_failure=*/true);
+  EXPECT_THAT(forked_jit.StillFails(kAddIr), IsOkAndHolds(false));
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,331 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_stats.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/common/thread.h"
+#include "xls/delay_model/analyze_critical_path.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/op.h"
+#include "xls/ir/package.h"
+#include "xls/ir/proc.h"
+#include "xls/passes/bdd_function.h"
+
+namespace xls {
+namespace {
+
+// Returns "text" as a quoted JSON string.
+std::string JsonString(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        absl::StrAppend(&result, "\\\"");
+        break;
+      case '\\':
+        absl::StrAppend(&result, "\\\\");
+        break;
+      case '\n':
+        absl::StrAppend(&result, "\\n");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", c);
+        } else {
+          result.push_back(c);
+        }
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+// Returns "sample_size" bits-typed nodes of "f" (which must have more nodes
+// than that), collected breadth-first through the operands of randomly chosen
+// nodes so the sample consists of cones of logic rather than isolated nodes.
+std::vector<Node*> SampleNodes(FunctionBase* f, int64_t sample_size) {
+  std::vector<Node*> nodes;
+  for (Node* node : f->nodes()) {
+    if (node->GetType()->IsBits()) {
+      nodes.push_back(node);
+    }
+  }
+  if (nodes.size() <= sample_size) {
+    return nodes;
+  }
+  std::seed_seq seed(f->name().begin(), f->name().end());
+  std::mt19937_64 rng(seed);
+  absl::flat_hash_set<Node*> sampled;
+  std::vector<Node*> sample;
+  std::deque<Node*> worklist;
+  while (sample.size() < sample_size) {
+    if (worklist.empty()) {
+      worklist.push_back(nodes[rng() % nodes.size()]);
+    }
+    Node* node = worklist.front();
+    worklist.pop_front();
+    if (!node->GetType()->IsBits() || !sampled.insert(node).second) {
+      continue;
+    }
+    sample.push_back(node);
+    for (Node* operand : node->operands()) {
+      worklist.push_back(operand);
+    }
+  }
+  return sample;
+}
+
+absl::StatusOr<BddStats> AnalyzeBdd(FunctionBase* f,
+                                    const IrStatsOptions& options) {
+  BddStats stats;
+  absl::Time start = absl::Now();
+  std::unique_ptr<BddFunction> bdd_function;
+  std::vector<Node*> nodes;
+  if (options.bdd_sample_threshold > 0 &&
+      f->node_count() > options.bdd_sample_threshold &&
+      options.bdd_sample_size < f->node_count()) {
+    nodes = SampleNodes(f, options.bdd_sample_size);
+    stats.sampled_nodes = nodes.size();
+    XLS_ASSIGN_OR_RETURN(bdd_function,
+                         BddFunction::RunOnNodes(f, nodes,
+                                                 options.bdd_minterm_limit));
+  } else {
+    for (Node* node : f->nodes()) {
+      if (node->GetType()->IsBits()) {
+        nodes.push_back(node);
+      }
+    }
+    XLS_ASSIGN_OR_RETURN(
+        bdd_function,
+        BddFunction::Run(f, options.bdd_minterm_limit,
+                         /*do_not_evaluate_ops=*/{}, options.bdd_node_limit));
+  }
+  stats.construction_time = absl::Now() - start;
+  const BinaryDecisionDiagram& bdd = bdd_function->bdd();
+  stats.node_count = bdd.size();
+  stats.variable_count = bdd.variable_count();
+  for (Node* node : nodes) {
+    for (int64_t i = 0; i < node->BitCountOrDie(); ++i) {
+      stats.max_minterms = std::max(
+          stats.max_minterms,
+          bdd.minterm_count(bdd_function->GetBddNode(node, i)));
+    }
+  }
+  return stats;
+}
+
+}  // namespace
+
+absl::StatusOr<FunctionStats> AnalyzeFunction(FunctionBase* f,
+                                              absl::string_view package_path,
+                                              const IrStatsOptions& options) {
+  absl::Time start = absl::Now();
+  FunctionStats stats;
+  stats.package_path = std::string(package_path);
+  stats.package_name = f->package()->name();
+  stats.function_name = f->name();
+  stats.is_proc = f->IsProc();
+  if (f->IsFunction()) {
+    stats.signature = f->AsFunctionOrDie()->GetType()->ToString();
+  } else {
+    stats.signature = f->AsProcOrDie()->StateType()->ToString();
+  }
+  stats.node_count = f->node_count();
+
+  absl::flat_hash_map<Node*, int64_t> depth;
+  for (Node* node : TopoSort(f)) {
+    stats.bit_count += node->GetType()->GetFlatBitCount();
+    ++stats.op_counts[OpToString(node->op())];
+    int64_t node_depth = 0;
+    for (Node* operand : node->operands()) {
+      node_depth = std::max(node_depth, depth.at(operand));
+    }
+    depth[node] = node_depth + 1;
+    stats.depth = std::max(stats.depth, node_depth + 1);
+  }
+
+  if (options.delay_estimator != nullptr) {
+    XLS_ASSIGN_OR_RETURN(
+        std::vector<CriticalPathEntry> critical_path,
+        AnalyzeCriticalPath(f, /*clock_period_ps=*/absl::nullopt,
+                            *options.delay_estimator));
+    stats.critical_path_delay_ps =
+        critical_path.empty() ? 0 : critical_path.front().path_delay_ps;
+  }
+  if (options.bdd) {
+    XLS_ASSIGN_OR_RETURN(stats.bdd, AnalyzeBdd(f, options));
+  }
+  stats.analysis_time = absl::Now() - start;
+  return stats;
+}
+
+std::string FunctionStatsToJson(const FunctionStats& stats) {
+  std::vector<std::string> ops;
+  for (const auto& [op, count] : stats.op_counts) {
+    ops.push_back(absl::StrFormat("%s: %d", JsonString(op), count));
+  }
+  std::string json = absl::StrFormat(
+      "{\"package_path\": %s, \"package\": %s, \"function\": %s, "
+      "\"kind\": \"%s\", \"signature\": %s, \"node_count\": %d, "
+      "\"bit_count\": %d, \"depth\": %d, \"ops\": {%s}",
+      JsonString(stats.package_path), JsonString(stats.package_name),
+      JsonString(stats.function_name), stats.is_proc ? "proc" : "function",
+      JsonString(stats.signature), stats.node_count, stats.bit_count,
+      stats.depth, absl::StrJoin(ops, ", "));
+  if (stats.critical_path_delay_ps.has_value()) {
+    absl::StrAppendFormat(&json, ", \"critical_path_ps\": %d",
+                          *stats.critical_path_delay_ps);
+  }
+  if (stats.bdd.has_value()) {
+    const BddStats& bdd = *stats.bdd;
+    absl::StrAppendFormat(
+        &json,
+        ", \"bdd\": {\"node_count\": %d, \"variable_count\": %d, "
+        "\"max_minterms\": %d, \"time_us\": %d",
+        bdd.node_count, bdd.variable_count, bdd.max_minterms,
+        absl::ToInt64Microseconds(bdd.construction_time));
+    if (bdd.sampled_nodes.has_value()) {
+      absl::StrAppendFormat(&json, ", \"sampled_nodes\": %d",
+                            *bdd.sampled_nodes);
+    }
+    absl::StrAppend(&json, "}");
+  }
+  absl::StrAppendFormat(&json, ", \"time_us\": %d}",
+                        absl::ToInt64Microseconds(stats.analysis_time));
+  return json;
+}
+
+int64_t AnalyzePackages(absl::Span<const std::string> paths,
+                        const IrStatsOptions& options,
+                        const std::function<void(absl::string_view)>& sink) {
+  // Work is taken from a queue of parsed functions, falling back to parsing
+  // the next package when the queue is empty, so a package with many
+  // functions is spread over all the threads. Each package is freed once its
+  // last function has been analyzed.
+  struct FunctionTask {
+    std::shared_ptr<Package> package;
+    const std::string* path;
+    FunctionBase* function;
+  };
+  absl::Mutex mutex;
+  std::deque<FunctionTask> tasks;
+  int64_t next_path = 0;
+  int64_t parsing = 0;
+  int64_t errors = 0;
+
+  absl::Mutex sink_mutex;
+  auto emit = [&](absl::string_view line) {
+    absl::MutexLock lock(&sink_mutex);
+    sink(line);
+  };
+  auto emit_error = [&](const std::string& path,
+                        absl::optional<std::string> function,
+                        const absl::Status& status) {
+    std::string function_field;
+    if (function.has_value()) {
+      function_field = absl::StrCat("\"function\": ", JsonString(*function),
+                                    ", ");
+    }
+    emit(absl::StrFormat("{\"package_path\": %s, %s\"error\": %s}",
+                         JsonString(path), function_field,
+                         JsonString(status.ToString())));
+    absl::MutexLock lock(&mutex);
+    ++errors;
+  };
+
+  auto has_work = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return !tasks.empty() || next_path < paths.size() || parsing == 0;
+  };
+  auto worker = [&]() {
+    while (true) {
+      absl::optional<FunctionTask> task;
+      int64_t path_index = 0;
+      {
+        absl::MutexLock lock(&mutex);
+        mutex.Await(absl::Condition(&has_work));
+        if (!tasks.empty()) {
+          task = std::move(tasks.front());
+          tasks.pop_front();
+        } else if (next_path < paths.size()) {
+          path_index = next_path++;
+          ++parsing;
+        } else {
+          return;
+        }
+      }
+
+      if (task.has_value()) {
+        absl::StatusOr<FunctionStats> stats =
+            AnalyzeFunction(task->function, *task->path, options);
+        if (stats.ok()) {
+          emit(FunctionStatsToJson(*stats));
+        } else {
+          emit_error(*task->path, task->function->name(), stats.status());
+        }
+        continue;
+      }
+
+      const std::string& path = paths[path_index];
+      absl::StatusOr<std::unique_ptr<Package>> package =
+          Parser::ParsePackageFile(path);
+      std::vector<FunctionTask> new_tasks;
+      if (package.ok()) {
+        std::shared_ptr<Package> shared_package = std::move(*package);
+        for (FunctionBase* f : shared_package->GetFunctionsAndProcs()) {
+          if (!options.restrict_fn.has_value() ||
+              *options.restrict_fn == f->name()) {
+            new_tasks.push_back({shared_package, &path, f});
+          }
+        }
+      } else {
+        emit_error(path, absl::nullopt, package.status());
+      }
+      absl::MutexLock lock(&mutex);
+      for (FunctionTask& new_task : new_tasks) {
+        tasks.push_back(std::move(new_task));
+      }
+      --parsing;
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64_t i = 0; i < std::max<int64_t>(options.threads, 1); ++i) {
+    threads.push_back(std::make_unique<Thread>(worker));
+  }
+  for (std::unique_ptr<Thread>& thread : threads) {
+    thread->Join();
+  }
+  absl::MutexLock lock(&mutex);
+  return errors;
+}
+
+}  // namespace xls
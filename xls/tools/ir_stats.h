@@ -0,0 +1,124 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_TOOLS_IR_STATS_H_
+#define XLS_TOOLS_IR_STATS_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/function_base.h"
+
+namespace xls {
+
+struct IrStatsOptions {
+  // If set, only the function or proc of this name (not mangled with the
+  // package name) is analyzed in each package.
+  absl::optional<std::string> restrict_fn;
+
+  // If non-null, the critical path delay is computed with this estimator.
+  const DelayEstimator* delay_estimator = nullptr;
+
+  // BDD statistics are only gathered if set, as building the BDD usually
+  // dominates the analysis time.
+  bool bdd = false;
+  int64_t bdd_minterm_limit = 0;
+  int64_t bdd_node_limit = 0;
+
+  // If positive, the BDD of a function with more nodes than this is built over
+  // a random sample of "bdd_sample_size" of its nodes (with the operands of
+  // the sampled nodes outside the sample modeled as variables) instead of over
+  // the whole function. The sample is grown from randomly chosen nodes through
+  // their operands, and is the same on every run.
+  int64_t bdd_sample_threshold = 0;
+  int64_t bdd_sample_size = 1000;
+
+  // Number of functions analyzed concurrently by AnalyzePackages().
+  int64_t threads = 1;
+};
+
+struct BddStats {
+  int64_t node_count = 0;
+  int64_t variable_count = 0;
+  // The maximum number of minterms of the expression of any bit; saturates at
+  // INT32_MAX.
+  int64_t max_minterms = 0;
+  absl::Duration construction_time;
+  // Set if the BDD was built over a sample of this many nodes.
+  absl::optional<int64_t> sampled_nodes;
+};
+
+struct FunctionStats {
+  std::string package_path;
+  std::string package_name;
+  std::string function_name;
+  bool is_proc = false;
+  std::string signature;
+
+  int64_t node_count = 0;
+  // The sum of the flat bit counts of all nodes.
+  int64_t bit_count = 0;
+  // Node count by op name.
+  std::map<std::string, int64_t> op_counts;
+  // The number of nodes on the longest path through the graph.
+  int64_t depth = 0;
+
+  absl::optional<int64_t> critical_path_delay_ps;
+  absl::optional<BddStats> bdd;
+
+  absl::Duration analysis_time;
+};
+
+// Computes the statistics of "f". "package_path" is only recorded in them.
+absl::StatusOr<FunctionStats> AnalyzeFunction(FunctionBase* f,
+                                              absl::string_view package_path,
+                                              const IrStatsOptions& options);
+
+// Returns the statistics as a single-line JSON object, e.g.:
+//
+//   {"package_path": "a.ir", "package": "a", "function": "f",
+//    "kind": "function", "signature": "(bits[8]) -> bits[8]",
+//    "node_count": 2, "bit_count": 16, "depth": 2,
+//    "ops": {"neg": 1, "param": 1}, "critical_path_ps": 120,
+//    "bdd": {"node_count": 18, "variable_count": 8, "max_minterms": 128,
+//            "time_us": 31, "sampled_nodes": 1000},
+//    "time_us": 52}
+//
+// "critical_path_ps", "bdd" and its "sampled_nodes" are only present when
+// computed.
+std::string FunctionStatsToJson(const FunctionStats& stats);
+
+// Parses the packages at "paths" and analyzes their functions and procs on
+// "options.threads" threads, functions of one package in parallel as well as
+// different packages. "sink" is called, one call at a time, with the JSON line
+// of each function (without a trailing newline) as soon as it is analyzed, so
+// lines appear in no particular order. A package which fails to parse or a
+// function which fails to be analyzed is reported as a line of the form
+// {"package_path": ..., ["function": ...,] "error": ...} rather than stopping
+// the run. Returns the number of such errors.
+int64_t AnalyzePackages(absl::Span<const std::string> paths,
+                        const IrStatsOptions& options,
+                        const std::function<void(absl::string_view)>& sink);
+
+}  // namespace xls
+
+#endif  // XLS_TOOLS_IR_STATS_H_
@@ -14,29 +14,106 @@
 
 // Prints summary information about an IR file to the terminal.
 // Output will be added as needs warrant, so feel free to make additions!
+//
+// With --jsonl, instead analyzes any number of IR files in parallel and
+// streams one JSON line of statistics (node breakdown, depth, critical path and
+// optionally BDD metrics) per function; see ir_stats.h.
 
+#include <fstream>
+#include <iostream>
+#include <string>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/tools/ir_stats.h"
 
 ABSL_FLAG(std::string, function, "",
           "If set, restrict dumping to the given function. "
           "The name should not be mangled with the Package name.");
+ABSL_FLAG(std::string, jsonl, "",
+          "If set, write JSON lines of statistics for every function of every "
+          "input to this path (\"-\" for stdout) instead of the summary.");
+ABSL_FLAG(std::string, input_list, "",
+          "Path of a file listing further IR paths to analyze, one per line.");
+ABSL_FLAG(int64_t, threads, 1,
+          "Number of functions to analyze concurrently with --jsonl.");
+ABSL_FLAG(std::string, delay_model, "",
+          "If set, report critical path delays with this delay model.");
+ABSL_FLAG(bool, bdd, false, "Report BDD statistics with --jsonl.");
+ABSL_FLAG(int64_t, bdd_minterm_limit, 0,
+          "Maximum number of minterms before truncating the BDD subgraph "
+          "and declaring a new variable. If zero, then no limit.");
+ABSL_FLAG(int64_t, bdd_node_limit, 0,
+          "Maximum number of BDD nodes; see bdd_stats. If zero, no limit.");
+ABSL_FLAG(int64_t, bdd_sample_threshold, 0,
+          "If positive, build the BDD of functions with more nodes than this "
+          "over a sample of --bdd_sample_size nodes only.");
+ABSL_FLAG(int64_t, bdd_sample_size, 1000,
+          "Number of nodes sampled for BDDs of large functions.");
 
 namespace xls {
 
+absl::Status JsonlMain(std::vector<std::string> paths,
+                       absl::optional<std::string> restrict_fn) {
+  if (!absl::GetFlag(FLAGS_input_list).empty()) {
+    XLS_ASSIGN_OR_RETURN(std::string list,
+                         GetFileContents(absl::GetFlag(FLAGS_input_list)));
+    for (absl::string_view path :
+         absl::StrSplit(list, '\n', absl::SkipWhitespace())) {
+      paths.push_back(std::string(path));
+    }
+  }
+
+  IrStatsOptions options;
+  options.restrict_fn = restrict_fn;
+  if (!absl::GetFlag(FLAGS_delay_model).empty()) {
+    XLS_ASSIGN_OR_RETURN(options.delay_estimator,
+                         GetDelayEstimator(absl::GetFlag(FLAGS_delay_model)));
+  }
+  options.bdd = absl::GetFlag(FLAGS_bdd);
+  options.bdd_minterm_limit = absl::GetFlag(FLAGS_bdd_minterm_limit);
+  options.bdd_node_limit = absl::GetFlag(FLAGS_bdd_node_limit);
+  options.bdd_sample_threshold = absl::GetFlag(FLAGS_bdd_sample_threshold);
+  options.bdd_sample_size = absl::GetFlag(FLAGS_bdd_sample_size);
+  options.threads = absl::GetFlag(FLAGS_threads);
+
+  std::ofstream file;
+  std::ostream* output = &std::cout;
+  if (absl::GetFlag(FLAGS_jsonl) != "-") {
+    file.open(absl::GetFlag(FLAGS_jsonl));
+    if (!file) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Unable to open %s for writing", absl::GetFlag(FLAGS_jsonl)));
+    }
+    output = &file;
+  }
+  // Lines are flushed as they're written so partial results of long runs can
+  // be inspected.
+  int64_t errors = AnalyzePackages(paths, options, [&](absl::string_view line) {
+    *output << line << std::endl;
+  });
+  if (errors > 0) {
+    XLS_LOG(ERROR) << errors << " packages or functions failed to be analyzed";
+  }
+  return absl::OkStatus();
+}
+
 absl::Status RealMain(absl::string_view ir_path,
                       absl::optional<std::string> restrict_fn) {
-  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(ir_path));
-  XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(contents));
+  XLS_ASSIGN_OR_RETURN(auto package,
+                       Parser::ParsePackageFile(std::string(ir_path)));
 
   std::cout << "Package \"" << package->name() << "\"" << std::endl;
   for (const auto& f : package->functions()) {
@@ -56,12 +133,18 @@ absl::Status RealMain(absl::string_view ir_path,
 int main(int argc, char** argv) {
   std::vector<absl::string_view> positional_args =
       xls::InitXls(argv[0], argc, argv);
-  XLS_QCHECK(positional_args.size() == 1);
 
   absl::optional<std::string> restrict_fn;
   if (!absl::GetFlag(FLAGS_function).empty()) {
     restrict_fn = absl::GetFlag(FLAGS_function);
   }
+  if (!absl::GetFlag(FLAGS_jsonl).empty()) {
+    std::vector<std::string> paths(positional_args.begin(),
+                                   positional_args.end());
+    XLS_QCHECK_OK(xls::JsonlMain(std::move(paths), restrict_fn));
+    return 0;
+  }
+  XLS_QCHECK(positional_args.size() == 1);
   XLS_QCHECK_OK(xls::RealMain(positional_args[0], restrict_fn));
   return 0;
 }
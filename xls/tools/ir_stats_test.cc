@@ -0,0 +1,153 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/ir_stats.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+using testing::AllOf;
+using testing::Contains;
+using testing::HasSubstr;
+using testing::Not;
+
+constexpr char kIr[] = R"(
+package p
+
+fn f(x: bits[8], y: bits[8]) -> bits[8] {
+  sum: bits[8] = add(x, y)
+  ret neg.4: bits[8] = neg(sum)
+}
+
+fn g(x: bits[4]) -> bits[4] {
+  ret not.6: bits[4] = not(x)
+}
+)";
+
+TEST(IrStatsTest, AnalyzeFunction) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kIr));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, package->GetFunction("f"));
+  IrStatsOptions options;
+  options.delay_estimator = &GetStandardDelayEstimator();
+  options.bdd = true;
+  XLS_ASSERT_OK_AND_ASSIGN(FunctionStats stats,
+                           AnalyzeFunction(f, "p.ir", options));
+  EXPECT_EQ(stats.package_path, "p.ir");
+  EXPECT_EQ(stats.function_name, "f");
+  EXPECT_FALSE(stats.is_proc);
+  EXPECT_EQ(stats.node_count, 4);
+  EXPECT_EQ(stats.bit_count, 32);
+  EXPECT_EQ(stats.depth, 3);
+  EXPECT_EQ(stats.op_counts.at("param"), 2);
+  EXPECT_EQ(stats.op_counts.at("add"), 1);
+  ASSERT_TRUE(stats.critical_path_delay_ps.has_value());
+  EXPECT_GT(*stats.critical_path_delay_ps, 0);
+  ASSERT_TRUE(stats.bdd.has_value());
+  EXPECT_GT(stats.bdd->variable_count, 0);
+  EXPECT_FALSE(stats.bdd->sampled_nodes.has_value());
+
+  std::string json = FunctionStatsToJson(stats);
+  EXPECT_THAT(json, HasSubstr("\"function\": \"f\", \"kind\": \"function\""));
+  EXPECT_THAT(json, HasSubstr("\"ops\": {\"add\": 1, \"neg\": 1, "
+                              "\"param\": 2}"));
+  EXPECT_THAT(json, HasSubstr("\"critical_path_ps\": "));
+  EXPECT_THAT(json, HasSubstr("\"bdd\": {"));
+  EXPECT_THAT(json, Not(HasSubstr("\n")));
+}
+
+TEST(IrStatsTest, SamplesLargeFunctions) {
+  Package package("p");
+  FunctionBuilder fb("chain", &package);
+  BValue value = fb.Param("x", package.GetBitsType(8));
+  for (int64_t i = 0; i < 50; ++i) {
+    value = fb.Not(value);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  IrStatsOptions options;
+  options.bdd = true;
+  options.bdd_sample_threshold = 20;
+  options.bdd_sample_size = 10;
+  XLS_ASSERT_OK_AND_ASSIGN(FunctionStats stats,
+                           AnalyzeFunction(f, "", options));
+  ASSERT_TRUE(stats.bdd.has_value());
+  EXPECT_EQ(stats.bdd->sampled_nodes, 10);
+  EXPECT_THAT(FunctionStatsToJson(stats), HasSubstr("\"sampled_nodes\": 10"));
+
+  // The sample is deterministic.
+  XLS_ASSERT_OK_AND_ASSIGN(FunctionStats again,
+                           AnalyzeFunction(f, "", options));
+  EXPECT_EQ(again.bdd->node_count, stats.bdd->node_count);
+  EXPECT_EQ(again.bdd->variable_count, stats.bdd->variable_count);
+
+  options.bdd_sample_threshold = 100;
+  XLS_ASSERT_OK_AND_ASSIGN(stats, AnalyzeFunction(f, "", options));
+  EXPECT_FALSE(stats.bdd->sampled_nodes.has_value());
+}
+
+TEST(IrStatsTest, AnalyzePackagesInParallel) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::vector<std::string> paths;
+  for (int64_t i = 0; i < 8; ++i) {
+    std::filesystem::path path = temp_dir.path() / absl::StrCat(i, ".ir");
+    XLS_ASSERT_OK(SetFileContents(path, kIr));
+    paths.push_back(path.string());
+  }
+  std::filesystem::path bad_path = temp_dir.path() / "bad.ir";
+  XLS_ASSERT_OK(SetFileContents(bad_path, "not ir"));
+  paths.push_back(bad_path.string());
+
+  IrStatsOptions options;
+  options.threads = 4;
+  std::vector<std::string> lines;
+  EXPECT_EQ(AnalyzePackages(paths, options,
+                            [&](absl::string_view line) {
+                              lines.push_back(std::string(line));
+                            }),
+            1);
+  EXPECT_EQ(lines.size(), 8 * 2 + 1);
+  EXPECT_THAT(lines, Contains(AllOf(HasSubstr(bad_path.string()),
+                                    HasSubstr("\"error\": "))));
+  EXPECT_THAT(lines, Contains(AllOf(HasSubstr(paths[3]),
+                                    HasSubstr("\"function\": \"g\""))));
+
+  options.restrict_fn = "g";
+  lines.clear();
+  EXPECT_EQ(AnalyzePackages(absl::MakeSpan(paths).subspan(0, 8), options,
+                            [&](absl::string_view line) {
+                              lines.push_back(std::string(line));
+                            }),
+            0);
+  EXPECT_EQ(lines.size(), 8);
+  EXPECT_THAT(lines, Not(Contains(HasSubstr("\"function\": \"f\""))));
+}
+
+}  // namespace
+}  // namespace xls
@@ -20,6 +20,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/time/time.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/get_runfile_path.h"
 #include "xls/common/init_xls.h"
@@ -28,8 +29,7 @@
 #include "xls/common/subprocess.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/netlist/cell_library.h"
-#include "xls/netlist/function_extractor.h"
-#include "xls/netlist/lib_parser.h"
+#include "xls/netlist/cell_library_loader.h"
 #include "xls/netlist/netlist.h"
 #include "xls/netlist/netlist.pb.h"
 #include "xls/netlist/netlist_parser.h"
@@ -46,6 +46,11 @@ ABSL_FLAG(std::string, cell_proto_path, "",
           "This is a whole bunch faster than specifiying an unprocessed "
           "cell library and should be favored.\n"
           "Either this or --cell_lib_path should be set.");
+ABSL_FLAG(std::string, cell_library_cache, "",
+          "Optional path to a binary CellLibraryProto caching the cells "
+          "extracted from --cell_lib_path. Only cells used by the netlist are "
+          "extracted; the cache is extended with new cells as needed and can "
+          "be shared by runs using the same cell library.");
 ABSL_FLAG(std::string, constraints_file, "",
           "Optional path to a DSLX file containing a input parameter "
           "constraint function. This function must have the same signature as "
@@ -74,6 +79,29 @@ ABSL_FLAG(std::string, schedule_path, "",
           "!IMPORTANT! If the netlist spans multiple stages, a schedule MUST "
           "be specified. Otherwise, mapping IR nodes to netlist cells is "
           "impossible.");
+ABSL_FLAG(bool, per_output, false,
+          "If true, checks each output bit as a separate query and reports "
+          "per-bit results and solver times, instead of checking all outputs "
+          "in a single query.");
+ABSL_FLAG(int32_t, per_output_threads, 0,
+          "Number of threads to use with --per_output; each thread builds its "
+          "own Z3 context. If <= 0, one thread per core is used.");
+ABSL_FLAG(bool, sweep, false,
+          "If true, bit-blasts the IR and netlist into an and-inverter graph "
+          "and SAT-sweeps it, only handing the reduced miter to Z3. This "
+          "scales to larger designs than the default single query. Falls back "
+          "to the default query for unsupported IR and for counterexamples.");
+ABSL_FLAG(std::string, solver, "z3",
+          "The solver backend: \"z3\" for Z3's bit-vector theory, or \"sat\" "
+          "to bit-blast the IR and netlist to CNF for the embedded SAT "
+          "solver, which is usually faster and smaller for bit-level logic. "
+          "Like --sweep, \"sat\" falls back to Z3 for unsupported IR and for "
+          "counterexamples.");
+ABSL_FLAG(int64_t, simulation_vectors, 4096,
+          "Number of random input vectors to simulate, along with corner "
+          "cases, before any proof. A mismatch found by simulation is reported "
+          "without invoking a solver. Not supported with --per_output or "
+          "constraints. 0 disables simulation.");
 ABSL_FLAG(int32_t, stage, -1,
           "Pipeline stage to evaluate. Requires --schedule.\n"
           "If \"schedule\" is set, but this is not, then the entire module "
@@ -86,10 +114,11 @@ using solvers::z3::IrTranslator;
 
 constexpr const char kIrConverterPath[] = "xls/dslx/ir_converter_main";
 
-// Loads a cell library, either from a raw Liberty file or a preprocessed
-// CellLibraryProto proto.
+// Loads a cell library, either from a preprocessed CellLibraryProto proto or
+// from the cells of a raw Liberty file used by the netlist.
 absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
-    absl::string_view cell_lib_path, absl::string_view cell_proto_path) {
+    absl::string_view cell_lib_path, absl::string_view cell_proto_path,
+    absl::string_view netlist_path, absl::string_view cell_library_cache) {
   if (!cell_proto_path.empty()) {
     XLS_ASSIGN_OR_RETURN(std::string cell_proto_text,
                          GetFileContents(cell_proto_path));
@@ -97,11 +126,15 @@ absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
     XLS_RET_CHECK(cell_proto.ParseFromString(cell_proto_text));
     return netlist::CellLibrary::FromProto(cell_proto);
   } else {
-    XLS_ASSIGN_OR_RETURN(std::string lib_text, GetFileContents(cell_lib_path));
-    XLS_ASSIGN_OR_RETURN(auto stream,
-                         netlist::cell_lib::CharStream::FromText(lib_text));
-    XLS_ASSIGN_OR_RETURN(netlist::CellLibraryProto proto,
-                         netlist::function::ExtractFunctions(&stream));
+    absl::optional<std::filesystem::path> cache_path;
+    if (!cell_library_cache.empty()) {
+      cache_path = std::string(cell_library_cache);
+    }
+    XLS_ASSIGN_OR_RETURN(
+        netlist::CellLibraryProto proto,
+        netlist::LoadCellLibraryForNetlist(std::string(cell_lib_path),
+                                           std::string(netlist_path),
+                                           cache_path));
     return netlist::CellLibrary::FromProto(proto);
   }
 }
@@ -109,9 +142,8 @@ absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
 // Loads and parses a netlist from a file.
 absl::StatusOr<std::unique_ptr<netlist::rtl::Netlist>> GetNetlist(
     absl::string_view netlist_path, netlist::CellLibrary* cell_library) {
-  XLS_ASSIGN_OR_RETURN(std::string netlist_text, GetFileContents(netlist_path));
-  netlist::rtl::Scanner scanner(netlist_text);
-  return netlist::rtl::Parser::ParseNetlist(cell_library, &scanner);
+  return netlist::rtl::Parser::ParseNetlistFile(cell_library,
+                                                std::string(netlist_path));
 }
 
 }  // namespace
@@ -121,9 +153,12 @@ absl::Status RealMain(absl::string_view ir_path,
                       absl::string_view netlist_module_name,
                       absl::string_view cell_lib_path,
                       absl::string_view cell_proto_path,
+                      absl::string_view cell_library_cache,
                       absl::string_view netlist_path,
                       absl::string_view constraints_file,
-                      absl::string_view schedule_path, int stage) {
+                      absl::string_view schedule_path, int stage,
+                      bool per_output, int per_output_threads, bool sweep,
+                      absl::string_view solver, int64_t simulation_vectors) {
   solvers::z3::LecParams lec_params;
   XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
   XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
@@ -137,26 +172,23 @@ absl::Status RealMain(absl::string_view ir_path,
         lec_params.ir_package->GetFunction(entry_function_name));
   }
   XLS_ASSIGN_OR_RETURN(auto cell_library,
-                       GetCellLibrary(cell_lib_path, cell_proto_path));
+                       GetCellLibrary(cell_lib_path, cell_proto_path,
+                                      netlist_path, cell_library_cache));
   XLS_ASSIGN_OR_RETURN(auto netlist, GetNetlist(netlist_path, &cell_library));
   lec_params.netlist = netlist.get();
   lec_params.netlist_module_name = netlist_module_name;
 
-  std::unique_ptr<solvers::z3::Lec> lec;
+  absl::optional<PipelineSchedule> schedule;
   if (!schedule_path.empty()) {
     XLS_ASSIGN_OR_RETURN(
         PipelineScheduleProto proto,
         ParseTextProtoFile<PipelineScheduleProto>(schedule_path));
     XLS_ASSIGN_OR_RETURN(
-        PipelineSchedule schedule,
-        PipelineSchedule::FromProto(lec_params.ir_function, proto));
-    XLS_ASSIGN_OR_RETURN(lec, solvers::z3::Lec::CreateForStage(
-                                  std::move(lec_params), schedule, stage));
-  } else {
-    XLS_ASSIGN_OR_RETURN(lec, solvers::z3::Lec::Create(std::move(lec_params)));
+        schedule, PipelineSchedule::FromProto(lec_params.ir_function, proto));
   }
 
   std::unique_ptr<Package> constraints_pkg;
+  Function* constraints = nullptr;
   if (!constraints_file.empty()) {
     XLS_ASSIGN_OR_RETURN(std::filesystem::path ir_converter_path,
                          GetXlsRunfilePath(kIrConverterPath));
@@ -167,8 +199,91 @@ absl::Status RealMain(absl::string_view ir_path,
 
     XLS_ASSIGN_OR_RETURN(constraints_pkg,
                          Parser::ParsePackage(stdout_and_stderr.first));
-    XLS_ASSIGN_OR_RETURN(Function * function, constraints_pkg->EntryFunction());
-    XLS_RETURN_IF_ERROR(lec->AddConstraints(function));
+    XLS_ASSIGN_OR_RETURN(constraints, constraints_pkg->EntryFunction());
+  }
+
+  if (per_output) {
+    XLS_ASSIGN_OR_RETURN(
+        std::vector<solvers::z3::LecOutputResult> results,
+        solvers::z3::Lec::RunPerOutput(lec_params, schedule, stage,
+                                       constraints, per_output_threads));
+    int64_t equivalent_count = 0;
+    for (const solvers::z3::LecOutputResult& result : results) {
+      std::cout << result.node_name << "[" << result.bit_index << "]: "
+                << (result.equivalent ? "equivalent" : "NOT EQUIVALENT")
+                << " (" << absl::FormatDuration(result.duration) << ")"
+                << std::endl;
+      equivalent_count += result.equivalent ? 1 : 0;
+    }
+    std::cout << equivalent_count << " of " << results.size()
+              << " output bits proved equivalent." << std::endl;
+    return absl::OkStatus();
+  }
+
+  std::unique_ptr<solvers::z3::Lec> lec;
+  if (schedule.has_value()) {
+    XLS_ASSIGN_OR_RETURN(lec, solvers::z3::Lec::CreateForStage(
+                                  std::move(lec_params), *schedule, stage));
+  } else {
+    XLS_ASSIGN_OR_RETURN(lec, solvers::z3::Lec::Create(std::move(lec_params)));
+  }
+  if (constraints != nullptr) {
+    XLS_RETURN_IF_ERROR(lec->AddConstraints(constraints));
+  }
+
+  if (simulation_vectors > 0 && constraints == nullptr) {
+    absl::StatusOr<absl::optional<std::string>> counterexample =
+        lec->FindCounterexampleBySimulation(simulation_vectors);
+    if (absl::IsUnimplemented(counterexample.status())) {
+      std::cout << "Simulation not possible: "
+                << counterexample.status().message() << std::endl;
+    } else {
+      XLS_RETURN_IF_ERROR(counterexample.status());
+      if (counterexample->has_value()) {
+        std::cout << counterexample->value() << std::endl;
+        std::cout << "IR and netlist are NOT equivalent." << std::endl;
+        return absl::OkStatus();
+      }
+    }
+  }
+
+  if (sweep) {
+    absl::StatusOr<solvers::z3::AigSweepResult> result =
+        lec->RunWithSweeping();
+    if (absl::IsUnimplemented(result.status())) {
+      std::cout << "SAT sweeping not possible: " << result.status().message()
+                << std::endl;
+    } else {
+      XLS_RETURN_IF_ERROR(result.status());
+      std::cout << "SAT sweeping: " << result->initial_and_count
+                << " AND nodes reduced to " << result->reduced_and_count
+                << " in " << result->rounds << " round(s); "
+                << result->proven_pairs << " equivalences merged, "
+                << result->remaining_outputs
+                << " output bit(s) left for the final query." << std::endl;
+      if (result->equivalent) {
+        std::cout << "IR and netlist are equivalent." << std::endl;
+        return absl::OkStatus();
+      }
+      // Fall through to the full query for a counterexample.
+      std::cout << "IR and netlist are NOT equivalent." << std::endl;
+    }
+  }
+
+  if (solver == "sat") {
+    absl::StatusOr<bool> result = lec->RunWithSat();
+    if (absl::IsUnimplemented(result.status())) {
+      std::cout << "Bit-blasting to CNF not possible: "
+                << result.status().message() << std::endl;
+    } else {
+      XLS_RETURN_IF_ERROR(result.status());
+      if (result.value()) {
+        std::cout << "IR and netlist are equivalent." << std::endl;
+        return absl::OkStatus();
+      }
+      // Fall through to the full query for a counterexample.
+      std::cout << "IR and netlist are NOT equivalent." << std::endl;
+    }
   }
 
   bool equal = lec->Run();
@@ -203,10 +318,20 @@ int main(int argc, char* argv[]) {
   XLS_QCHECK(stage == -1 || !schedule_path.empty())
       << "--schedule_path must be specified with --stage.";
 
+  std::string solver = absl::GetFlag(FLAGS_solver);
+  XLS_QCHECK(solver == "z3" || solver == "sat")
+      << "--solver must be \"z3\" or \"sat\".";
+
   XLS_QCHECK_OK(xls::RealMain(ir_path, absl::GetFlag(FLAGS_entry_function_name),
                               absl::GetFlag(FLAGS_netlist_module_name),
-                              cell_lib_path, cell_proto_path, netlist_path,
+                              cell_lib_path, cell_proto_path,
+                              absl::GetFlag(FLAGS_cell_library_cache),
+                              netlist_path,
                               absl::GetFlag(FLAGS_constraints_file),
-                              schedule_path, stage));
+                              schedule_path, stage,
+                              absl::GetFlag(FLAGS_per_output),
+                              absl::GetFlag(FLAGS_per_output_threads),
+                              absl::GetFlag(FLAGS_sweep), solver,
+                              absl::GetFlag(FLAGS_simulation_vectors)));
   return 0;
 }
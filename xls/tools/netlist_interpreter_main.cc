@@ -28,9 +28,9 @@
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/value.h"
 #include "xls/netlist/cell_library.h"
-#include "xls/netlist/function_extractor.h"
+#include "xls/netlist/cell_library_loader.h"
+#include "xls/netlist/compiled_simulator.h"
 #include "xls/netlist/interpreter.h"
-#include "xls/netlist/lib_parser.h"
 #include "xls/netlist/netlist.pb.h"
 #include "xls/netlist/netlist_parser.h"
 
@@ -38,6 +38,11 @@ ABSL_FLAG(std::string, cell_library, "",
           "Cell library to use for interpretation.");
 ABSL_FLAG(std::string, cell_library_proto, "",
           "Preprocessed cell library proto to use for interpretation.");
+ABSL_FLAG(std::string, cell_library_cache, "",
+          "Optional path to a binary CellLibraryProto caching the cells "
+          "extracted from --cell_library. Only cells used by the netlist are "
+          "extracted; the cache is extended with new cells as needed and can "
+          "be shared by runs using the same cell library.");
 // TODO(rspringer): Eliminate the need for this flag.
 // This one is a hidden temporary flag until we can properly handle cells
 // with state_function attributes (e.g., some latches).
@@ -58,7 +63,8 @@ namespace xls {
 
 absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
     const std::string& cell_library_path,
-    const std::string& cell_library_proto_path) {
+    const std::string& cell_library_proto_path,
+    const std::string& netlist_path, const std::string& cell_library_cache) {
   if (!cell_library_proto_path.empty()) {
     XLS_ASSIGN_OR_RETURN(std::string proto_text,
                          GetFileContents(cell_library_proto_path));
@@ -66,13 +72,13 @@ absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
     XLS_RET_CHECK(lib_proto.ParseFromString(proto_text));
     return netlist::CellLibrary::FromProto(lib_proto);
   } else {
-    XLS_ASSIGN_OR_RETURN(std::string cell_library_text,
-                         GetFileContents(cell_library_path));
-    XLS_ASSIGN_OR_RETURN(
-        auto char_stream,
-        netlist::cell_lib::CharStream::FromText(cell_library_text));
+    absl::optional<std::filesystem::path> cache_path;
+    if (!cell_library_cache.empty()) {
+      cache_path = cell_library_cache;
+    }
     XLS_ASSIGN_OR_RETURN(netlist::CellLibraryProto lib_proto,
-                         netlist::function::ExtractFunctions(&char_stream));
+                         netlist::LoadCellLibraryForNetlist(
+                             cell_library_path, netlist_path, cache_path));
     return netlist::CellLibrary::FromProto(lib_proto);
   }
 }
@@ -80,18 +86,18 @@ absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
 absl::Status RealMain(const std::string& netlist_path,
                       const std::string& cell_library_path,
                       const std::string& cell_library_proto_path,
+                      const std::string& cell_library_cache,
                       const std::string& module_name,
                       absl::Span<const std::string> inputs,
                       const std::string& output_type_string,
                       absl::Span<const std::string> dump_cells) {
   XLS_ASSIGN_OR_RETURN(
       netlist::CellLibrary cell_library,
-      GetCellLibrary(cell_library_path, cell_library_proto_path));
+      GetCellLibrary(cell_library_path, cell_library_proto_path, netlist_path,
+                     cell_library_cache));
 
-  XLS_ASSIGN_OR_RETURN(std::string netlist_text, GetFileContents(netlist_path));
-  netlist::rtl::Scanner scanner(netlist_text);
-  XLS_ASSIGN_OR_RETURN(auto netlist, netlist::rtl::Parser::ParseNetlist(
-                                         &cell_library, &scanner));
+  XLS_ASSIGN_OR_RETURN(auto netlist, netlist::rtl::Parser::ParseNetlistFile(
+                                         &cell_library, netlist_path));
   XLS_ASSIGN_OR_RETURN(const auto* module, netlist->GetModule(module_name));
 
   // Input values are listed in the same order as inputs are declared by
@@ -112,9 +118,19 @@ absl::Status RealMain(const std::string& netlist_path,
     input_nets[module_inputs[i]] = input_bits.Get(i);
   }
 
-  netlist::Interpreter interpreter(netlist.get());
-  XLS_ASSIGN_OR_RETURN(auto output_nets, interpreter.InterpretModule(
-                                             module, input_nets, dump_cells));
+  // The compiled simulator is much faster on large netlists, but only the
+  // interpreter can dump the values of individual cells.
+  absl::flat_hash_map<const netlist::rtl::NetRef, bool> output_nets;
+  if (dump_cells.empty()) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<netlist::CompiledSimulator> simulator,
+        netlist::CompiledSimulator::Create(netlist.get(), module));
+    XLS_ASSIGN_OR_RETURN(output_nets, simulator->InterpretModule(input_nets));
+  } else {
+    netlist::Interpreter interpreter(netlist.get());
+    XLS_ASSIGN_OR_RETURN(output_nets, interpreter.InterpretModule(
+                                          module, input_nets, dump_cells));
+  }
 
   BitsRope rope(output_nets.size());
   for (const netlist::rtl::NetRef ref : module->outputs()) {
@@ -161,13 +177,15 @@ int main(int argc, char* argv[]) {
   std::vector<std::string> inputs = absl::StrSplit(input, ';');
 
   std::string dump_cells_str = absl::GetFlag(FLAGS_dump_cells);
-  std::vector<std::string> dump_cells = absl::StrSplit(dump_cells_str, ',');
+  std::vector<std::string> dump_cells =
+      absl::StrSplit(dump_cells_str, ',', absl::SkipEmpty());
 
   std::string output_type = absl::GetFlag(FLAGS_output_type);
 
-  XLS_QCHECK_OK(xls::RealMain(netlist_path, cell_library_path,
-                              cell_library_proto_path, module_name, inputs,
-                              output_type, dump_cells));
+  XLS_QCHECK_OK(xls::RealMain(
+      netlist_path, cell_library_path, cell_library_proto_path,
+      absl::GetFlag(FLAGS_cell_library_cache), module_name, inputs,
+      output_type, dump_cells));
 
   return 0;
 }
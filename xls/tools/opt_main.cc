@@ -15,20 +15,32 @@
 // Takes in an IR file and produces an IR file that has been run through the
 // standard optimization pipeline.
 
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/common/trace.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/interpreter/value_profile.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
+#include "xls/ir/package_serializer.h"
+#include "xls/passes/pass_cache.h"
+#include "xls/passes/pass_profile.h"
 #include "xls/passes/passes.h"
+#include "xls/passes/pipeline_autotuner.h"
+#include "xls/passes/profile_guided_narrowing_pass.h"
+#include "xls/passes/query_engine_cache.h"
 #include "xls/passes/standard_pipeline.h"
 
 ABSL_FLAG(std::string, entry, "", "Entry function name to optimize.");
 ABSL_FLAG(std::string, ir_dump_path, "",
           "Dump all intermediate IR files to the given directory");
+ABSL_FLAG(bool, compress_ir_dumps, false,
+          "Gzip-compress the IR files written to --ir_dump_path.");
 ABSL_FLAG(std::vector<std::string>, run_only_passes, {},
           "If specified, only passes in this comma-separated list of (short) "
           "pass names are be run.");
@@ -37,40 +49,191 @@ ABSL_FLAG(std::vector<std::string>, skip_passes, {},
           "pass names are skipped. If both --run_only_passes and --skip_passes "
           "are specified only passes which are present in --run_only_passes "
           "and not present in --skip_passes will be run.");
+ABSL_FLAG(int64_t, function_parallelism, 1,
+          "Maximum number of functions on which function-scoped passes are "
+          "run concurrently. Values greater than one may make generated node "
+          "names nondeterministic.");
+ABSL_FLAG(int64_t, bdd_parallelism, 1,
+          "If greater than one, the BDD-based passes build the BDDs of "
+          "independent parts of each function separately on up to this many "
+          "threads.");
+ABSL_FLAG(int64_t, max_unrolled_node_count, -1,
+          "If non-negative, counted for loops whose unrolled and inlined body "
+          "would exceed this many nodes are left rolled rather than unrolled.");
+ABSL_FLAG(std::string, pass_cache_dir, "",
+          "If specified, the results of the pass pipeline and its "
+          "sub-pipelines are cached in this directory and reused when they "
+          "are run on unchanged IR. The directory must be cleared when the "
+          "optimizer itself changes.");
+ABSL_FLAG(bool, print_pass_profile, false,
+          "If true, print the time, node count change and peak memory growth "
+          "of each pass, aggregated by pass name, to stderr.");
+ABSL_FLAG(std::string, pass_profile_json, "",
+          "If specified, write the per-pass profile as JSON to this path.");
+ABSL_FLAG(bool, output_binary, false,
+          "If true, emit the optimized package in the binary IR format, which "
+          "downstream tools load faster than text IR.");
+ABSL_FLAG(std::string, trace_file, "",
+          "If specified, record timing spans of parsing and of each pass and "
+          "write them to this path in the Chrome trace event format (viewable "
+          "in chrome://tracing or Perfetto).");
+ABSL_FLAG(std::string, value_profile, "",
+          "If specified, a value profile (as written by eval_ir_main "
+          "--output_value_profile) with which the nodes are speculatively "
+          "narrowed to the bits which varied in the profiled evaluations "
+          "before optimizing. The narrowed datapath is only used when the "
+          "other bits have their profiled values, so the result is correct "
+          "for any input.");
 ABSL_FLAG(int64_t, opt_level, xls::kMaxOptLevel,
           absl::StrFormat("Optimization level. Ranges from 1 to %d.",
                           xls::kMaxOptLevel));
+ABSL_FLAG(bool, autotune, false,
+          "If true, optimize copies of the package with variants of the "
+          "standard pipeline (up to --opt_level) in parallel and emit the "
+          "best result. The variants and their scores are printed to stderr.");
+ABSL_FLAG(int64_t, autotune_threads, 0,
+          "Maximum number of pipeline variants run concurrently by "
+          "--autotune. Zero means one per core.");
+ABSL_FLAG(std::string, autotune_delay_model, "",
+          "If specified, --autotune scores the variants by the critical path "
+          "of the entry function under this delay model before the node "
+          "count.");
+ABSL_FLAG(int64_t, autotune_pipeline_stages, 0,
+          "If positive (with --autotune_delay_model), --autotune scores the "
+          "variants first by the pipeline registers of the entry function "
+          "scheduled into this many stages.");
+ABSL_FLAG(std::string, pipeline_config_path, "",
+          "Path of the pipeline configuration of the design. With --autotune, "
+          "the best configuration is written to it; otherwise, if the file "
+          "exists, the pipeline it configures is run instead of the standard "
+          "one for --opt_level.");
 
 namespace xls {
 namespace {
 
+// Writes the optimized package to stdout, and the trace (if any).
+absl::Status EmitPackage(Package* package) {
+  if (absl::GetFlag(FLAGS_output_binary)) {
+    XLS_ASSIGN_OR_RETURN(std::string bytes, SerializePackage(package));
+    std::cout << bytes;
+  } else {
+    std::cout << package->DumpIr();
+  }
+  if (!absl::GetFlag(FLAGS_trace_file).empty()) {
+    StopTracing();
+    XLS_RETURN_IF_ERROR(WriteChromeTrace(absl::GetFlag(FLAGS_trace_file)));
+  }
+  return absl::OkStatus();
+}
+
 absl::Status RealMain(absl::string_view input_path) {
   if (input_path == "-") {
     input_path = "/dev/stdin";
   }
-  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(input_path));
-  std::unique_ptr<Package> package;
-  if (absl::GetFlag(FLAGS_entry).empty()) {
-    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(contents, input_path));
-  } else {
-    XLS_ASSIGN_OR_RETURN(package,
-                         Parser::ParsePackageWithEntry(
-                             contents, absl::GetFlag(FLAGS_entry), input_path));
+  if (!absl::GetFlag(FLAGS_trace_file).empty()) {
+    StartTracing();
+  }
+  absl::optional<std::string> entry;
+  if (!absl::GetFlag(FLAGS_entry).empty()) {
+    entry = absl::GetFlag(FLAGS_entry);
+  }
+  std::string config_path = absl::GetFlag(FLAGS_pipeline_config_path);
+  StandardPipelineConfig config;
+  config.opt_level = absl::GetFlag(FLAGS_opt_level);
+  if (!absl::GetFlag(FLAGS_autotune) && !config_path.empty() &&
+      FileExists(config_path).ok()) {
+    XLS_ASSIGN_OR_RETURN(std::string config_text, GetFileContents(config_path));
+    XLS_ASSIGN_OR_RETURN(config, StandardPipelineConfig::Parse(config_text));
+    XLS_VLOG(1) << "Using pipeline configuration: " << config.ToString();
   }
-  std::unique_ptr<CompoundPass> pipeline =
-      CreateStandardPassPipeline(absl::GetFlag(FLAGS_opt_level));
+  std::unique_ptr<CompoundPass> pipeline = CreateStandardPassPipeline(config);
   PassOptions options;
   options.ir_dump_path = absl::GetFlag(FLAGS_ir_dump_path);
+  options.compress_ir_dumps = absl::GetFlag(FLAGS_compress_ir_dumps);
   if (!absl::GetFlag(FLAGS_run_only_passes).empty()) {
     options.run_only_passes = absl::GetFlag(FLAGS_run_only_passes);
   }
   if (!absl::GetFlag(FLAGS_skip_passes).empty()) {
     options.skip_passes = absl::GetFlag(FLAGS_skip_passes);
   }
+  options.function_parallelism = absl::GetFlag(FLAGS_function_parallelism);
+  options.bdd_parallelism = absl::GetFlag(FLAGS_bdd_parallelism);
+  if (absl::GetFlag(FLAGS_max_unrolled_node_count) >= 0) {
+    options.max_unrolled_node_count =
+        absl::GetFlag(FLAGS_max_unrolled_node_count);
+  }
+
+  if (absl::GetFlag(FLAGS_autotune)) {
+    if (!absl::GetFlag(FLAGS_value_profile).empty()) {
+      return absl::InvalidArgumentError(
+          "--autotune does not support --value_profile");
+    }
+    XLS_ASSIGN_OR_RETURN(std::string ir_text,
+                         GetFileContents(std::string(input_path)));
+    AutotuneOptions autotune_options;
+    autotune_options.configs =
+        StandardPipelineVariants(absl::GetFlag(FLAGS_opt_level));
+    autotune_options.pass_options = options;
+    autotune_options.entry = entry;
+    if (!absl::GetFlag(FLAGS_autotune_delay_model).empty()) {
+      XLS_ASSIGN_OR_RETURN(
+          autotune_options.delay_estimator,
+          GetDelayEstimator(absl::GetFlag(FLAGS_autotune_delay_model)));
+      autotune_options.pipeline_stages =
+          absl::GetFlag(FLAGS_autotune_pipeline_stages);
+    }
+    autotune_options.thread_count = absl::GetFlag(FLAGS_autotune_threads);
+    XLS_ASSIGN_OR_RETURN(AutotuneResult result,
+                         AutotunePassPipeline(ir_text, autotune_options));
+    std::cerr << AutotuneResultToString(result);
+    if (!config_path.empty()) {
+      XLS_RETURN_IF_ERROR(
+          SetFileContents(config_path, result.best_config().ToString()));
+    }
+    return EmitPackage(result.package.get());
+  }
+
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<Package> package,
+      Parser::ParsePackageFile(std::string(input_path), entry));
+  QueryEngineCache query_engine_cache;
+  options.query_engine_cache = &query_engine_cache;
+  std::unique_ptr<PassCache> pass_cache;
+  if (!absl::GetFlag(FLAGS_pass_cache_dir).empty()) {
+    // Everything besides the IR and the selected passes which affects the
+    // result of the pipeline.
+    std::string salt = absl::StrFormat(
+        "%s function_parallelism=%d bdd_parallelism=%d "
+        "max_unrolled_node_count=%d",
+        config.ToString(), options.function_parallelism,
+        options.bdd_parallelism, absl::GetFlag(FLAGS_max_unrolled_node_count));
+    pass_cache = absl::make_unique<PassCache>(
+        absl::GetFlag(FLAGS_pass_cache_dir), std::move(salt));
+    options.pass_cache = pass_cache.get();
+  }
   PassResults results;
+  if (!absl::GetFlag(FLAGS_value_profile).empty()) {
+    XLS_ASSIGN_OR_RETURN(std::string profile_text,
+                         GetFileContents(absl::GetFlag(FLAGS_value_profile)));
+    XLS_ASSIGN_OR_RETURN(ValueProfile profile,
+                         ValueProfile::Parse(profile_text));
+    XLS_RETURN_IF_ERROR(ProfileGuidedNarrowingPass(&profile)
+                            .Run(package.get(), options, &results)
+                            .status());
+  }
   XLS_RETURN_IF_ERROR(pipeline->Run(package.get(), options, &results).status());
-  std::cout << package->DumpIr();
-  return absl::OkStatus();
+  if (absl::GetFlag(FLAGS_print_pass_profile) ||
+      !absl::GetFlag(FLAGS_pass_profile_json).empty()) {
+    std::vector<PassProfileEntry> profile = AggregatePassProfile(results);
+    if (absl::GetFlag(FLAGS_print_pass_profile)) {
+      std::cerr << PassProfileToString(profile);
+    }
+    if (!absl::GetFlag(FLAGS_pass_profile_json).empty()) {
+      XLS_RETURN_IF_ERROR(SetFileContents(
+          absl::GetFlag(FLAGS_pass_profile_json), PassProfileToJson(profile)));
+    }
+  }
+  return EmitPackage(package.get());
 }
 
 }  // namespace
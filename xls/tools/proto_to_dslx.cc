@@ -17,8 +17,10 @@
 #include "google/protobuf/compiler/importer.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/text_format.h"
 #include "absl/container/btree_map.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
@@ -888,36 +890,213 @@ absl::StatusOr<dslx::Expr*> EmitData(const std::string& top_package,
       span, absl::get<dslx::ColonRef*>(struct_def), elements);
 }
 
-}  // namespace
+// Writes the DSLX text of message instances straight to a stream, producing
+// the same text as formatting the expressions EmitData() builds, but without
+// building them: for large messages the AST and its formatted string are many
+// times the size of the message itself.
+class DataWriter {
+ public:
+  // Zero-valued elements are built (once per type) in "module", which must
+  // hold the emitted type definitions.
+  DataWriter(const std::string& top_package, dslx::Module* module,
+             const NameToRecord& name_to_record, std::ostream* out)
+      : top_package_(top_package),
+        module_(module),
+        name_to_record_(name_to_record),
+        out_(out) {}
+
+  absl::Status WriteMessage(const Message& message) {
+    const Descriptor* descriptor = message.GetDescriptor();
+    const Reflection* reflection = message.GetReflection();
+    const MessageRecord& message_record =
+        *name_to_record_.at(GetParentPrefixedName(top_package_, descriptor));
+    const dslx::TypeDefinition& struct_def = message_record.dslx_typedef;
+    XLS_RET_CHECK(absl::holds_alternative<dslx::StructDef*>(struct_def) ||
+                  absl::holds_alternative<dslx::ColonRef*>(struct_def));
+    if (absl::holds_alternative<dslx::StructDef*>(struct_def)) {
+      *out_ << absl::get<dslx::StructDef*>(struct_def)->identifier();
+    } else {
+      *out_ << dslx::ToAstNode(struct_def)->ToString();
+    }
+    *out_ << " { ";
+    bool first = true;
+    auto member = [&](absl::string_view name) {
+      if (!first) {
+        *out_ << ", ";
+      }
+      first = false;
+      *out_ << name << ": ";
+    };
+    for (int field_idx = 0; field_idx < descriptor->field_count();
+         field_idx++) {
+      const FieldDescriptor* fd = descriptor->field(field_idx);
+      const MessageRecord::ChildElement& element =
+          message_record.children.at(fd->name());
+      if (element.unsupported) {
+        continue;
+      }
+      if (!fd->is_repeated()) {
+        member(fd->name());
+        XLS_RETURN_IF_ERROR(WriteElement(message, fd, reflection,
+                                         /*index=*/absl::nullopt));
+        continue;
+      }
+      if (element.count == 0) {
+        continue;
+      }
+      int num_elements = reflection->FieldSize(message, fd);
+      member(fd->name());
+      *out_ << "[";
+      for (int i = 0; i < element.count; ++i) {
+        if (i != 0) {
+          *out_ << ", ";
+        }
+        if (i < num_elements) {
+          XLS_RETURN_IF_ERROR(WriteElement(message, fd, reflection, i));
+        } else {
+          XLS_ASSIGN_OR_RETURN(const std::string* zero, ZeroValue(fd));
+          *out_ << *zero;
+        }
+      }
+      *out_ << "]";
+      member(absl::StrCat(fd->name(), "_count"));
+      *out_ << "u32:" << num_elements;
+    }
+    *out_ << " }";
+    return absl::OkStatus();
+  }
 
-absl::StatusOr<std::unique_ptr<dslx::Module>> ProtoToDslx(
+ private:
+  // Writes the value of field "fd", or its "index"th entry if it is repeated.
+  absl::Status WriteElement(const Message& message, const FieldDescriptor* fd,
+                            const Reflection* reflection,
+                            absl::optional<int> index) {
+    switch (fd->type()) {
+      case FieldDescriptor::Type::TYPE_MESSAGE:
+        return WriteMessage(
+            index.has_value()
+                ? reflection->GetRepeatedMessage(message, fd, *index)
+                : reflection->GetMessage(message, fd));
+      case FieldDescriptor::Type::TYPE_ENUM: {
+        const google::protobuf::EnumValueDescriptor* evd =
+            index.has_value() ? reflection->GetRepeatedEnum(message, fd, *index)
+                              : reflection->GetEnum(message, fd);
+        *out_ << GetParentPrefixedName(top_package_, evd->type())
+              << "::" << evd->name();
+        return absl::OkStatus();
+      }
+      default: {
+        *out_ << IntegralTypeString(fd) << ":"
+              << GetFieldValue(message, *reflection, *fd, index);
+        return absl::OkStatus();
+      }
+    }
+  }
+
+  // Returns the DSLX type of the integral field "fd", e.g. "uN[32]".
+  static std::string IntegralTypeString(const FieldDescriptor* fd) {
+    return absl::StrFormat("%s[%d]", IsFieldSigned(fd->type()) ? "sN" : "uN",
+                           GetFieldWidth(fd->type()));
+  }
+
+  // Returns the text of the zero value padding out the repeated field "fd".
+  absl::StatusOr<const std::string*> ZeroValue(const FieldDescriptor* fd) {
+    std::string& zero = zero_values_[fd];
+    if (!zero.empty()) {
+      return &zero;
+    }
+    switch (fd->type()) {
+      case FieldDescriptor::Type::TYPE_MESSAGE: {
+        dslx::Span span(dslx::Pos{}, dslx::Pos{});
+        std::string type_name =
+            GetParentPrefixedName(top_package_, fd->message_type());
+        auto* type_ref = module_->Make<dslx::TypeRef>(
+            span, type_name, name_to_record_.at(type_name)->dslx_typedef);
+        auto* typeref_type = module_->Make<dslx::TypeRefTypeAnnotation>(
+            span, type_ref, std::vector<dslx::Expr*>());
+        XLS_ASSIGN_OR_RETURN(dslx::Expr * expr,
+                             MakeZeroValuedElement(module_, typeref_type));
+        zero = expr->ToString();
+        break;
+      }
+      case FieldDescriptor::Type::TYPE_ENUM:
+        zero =
+            absl::StrCat(GetParentPrefixedName(top_package_, fd->enum_type()),
+                         "::", fd->enum_type()->value(0)->name());
+        break;
+      default:
+        zero = absl::StrCat(IntegralTypeString(fd), ":0");
+    }
+    return &zero;
+  }
+
+  const std::string& top_package_;
+  dslx::Module* module_;
+  const NameToRecord& name_to_record_;
+  std::ostream* out_;
+  absl::flat_hash_map<const FieldDescriptor*, std::string> zero_values_;
+};
+
+// A message parsed against its schema, along with the layout information
+// needed to emit it. Members are declared so that the message is destroyed
+// before its factory and the factory before the descriptor pool.
+struct ParsedProto {
+  std::unique_ptr<DescriptorPool> descriptor_pool;
+  std::unique_ptr<google::protobuf::DynamicMessageFactory> factory;
+  std::unique_ptr<Message> message;
+  std::string top_package;
+  NameToRecord name_to_record;
+};
+
+// Compiles the schema and creates an empty "message_name" message to parse
+// the data into.
+absl::StatusOr<ParsedProto> CreateMessage(
     const std::filesystem::path& source_root,
     const std::filesystem::path& proto_schema_path,
-    const std::string& message_name, const std::string& textproto,
-    const std::string& output_var_name) {
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<DescriptorPool> descriptor_pool,
+    const std::string& message_name) {
+  ParsedProto parsed;
+  XLS_ASSIGN_OR_RETURN(parsed.descriptor_pool,
                        ProcessProtoSchema(source_root, proto_schema_path));
   const Descriptor* descriptor =
-      descriptor_pool->FindMessageTypeByName(message_name);
-  std::string top_package = descriptor->file()->package();
+      parsed.descriptor_pool->FindMessageTypeByName(message_name);
   XLS_RET_CHECK_NE(descriptor, nullptr);
+  parsed.top_package = descriptor->file()->package();
 
-  google::protobuf::DynamicMessageFactory factory;
-  const Message* message = factory.GetPrototype(descriptor);
+  parsed.factory = std::make_unique<google::protobuf::DynamicMessageFactory>();
+  const Message* message = parsed.factory->GetPrototype(descriptor);
   XLS_RET_CHECK(message != nullptr);
-  std::unique_ptr<Message> new_message(message->New());
+  parsed.message.reset(message->New());
+  return parsed;
+}
 
-  google::protobuf::TextFormat::ParseFromString(textproto, new_message.get());
-  NameToRecord name_to_record;
-  XLS_RETURN_IF_ERROR(
-      CollectMessageLayout(top_package, *descriptor, &name_to_record));
-  XLS_RETURN_IF_ERROR(
-      CollectElementCounts(top_package, *new_message, &name_to_record));
-  auto module = std::make_unique<dslx::Module>("the_module");
-  XLS_RETURN_IF_ERROR(EmitTypeDefs(module.get(), &name_to_record));
+// Collects the layout of the parsed message and emits the corresponding type
+// definitions into "module".
+absl::Status EmitLayout(ParsedProto* parsed, dslx::Module* module) {
+  XLS_RETURN_IF_ERROR(CollectMessageLayout(parsed->top_package,
+                                           *parsed->message->GetDescriptor(),
+                                           &parsed->name_to_record));
+  XLS_RETURN_IF_ERROR(CollectElementCounts(
+      parsed->top_package, *parsed->message, &parsed->name_to_record));
+  return EmitTypeDefs(module, &parsed->name_to_record);
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<dslx::Module>> ProtoToDslx(
+    const std::filesystem::path& source_root,
+    const std::filesystem::path& proto_schema_path,
+    const std::string& message_name, const std::string& textproto,
+    const std::string& output_var_name) {
   XLS_ASSIGN_OR_RETURN(
-      dslx::Expr * expr,
-      EmitData(top_package, module.get(), *new_message, name_to_record));
+      ParsedProto parsed,
+      CreateMessage(source_root, proto_schema_path, message_name));
+  google::protobuf::TextFormat::ParseFromString(textproto,
+                                                parsed.message.get());
+  auto module = std::make_unique<dslx::Module>("the_module");
+  XLS_RETURN_IF_ERROR(EmitLayout(&parsed, module.get()));
+  XLS_ASSIGN_OR_RETURN(dslx::Expr * expr,
+                       EmitData(parsed.top_package, module.get(),
+                                *parsed.message, parsed.name_to_record));
   dslx::Span span{dslx::Pos{}, dslx::Pos{}};
   auto* name_def = module->Make<dslx::NameDef>(
       span, static_cast<std::string>(output_var_name), /*definer=*/nullptr);
@@ -928,4 +1107,39 @@ absl::StatusOr<std::unique_ptr<dslx::Module>> ProtoToDslx(
   return module;
 }
 
+absl::Status ProtoToDslxStreaming(
+    const std::filesystem::path& source_root,
+    const std::filesystem::path& proto_schema_path,
+    const std::string& message_name, std::istream* textproto,
+    const std::string& output_var_name, std::ostream* out) {
+  XLS_ASSIGN_OR_RETURN(
+      ParsedProto parsed,
+      CreateMessage(source_root, proto_schema_path, message_name));
+  {
+    google::protobuf::io::IstreamInputStream input(textproto);
+    if (!google::protobuf::TextFormat::Parse(&input, parsed.message.get())) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unable to parse textproto as ", message_name));
+    }
+  }
+  dslx::Module module("the_module");
+  XLS_RETURN_IF_ERROR(EmitLayout(&parsed, &module));
+
+  // This matches Module::ToString() with the constant added as the last
+  // member.
+  std::string type_defs = module.ToString();
+  *out << type_defs;
+  if (!type_defs.empty()) {
+    *out << "\n";
+  }
+  *out << "pub const " << output_var_name << " = ";
+  DataWriter writer(parsed.top_package, &module, parsed.name_to_record, out);
+  XLS_RETURN_IF_ERROR(writer.WriteMessage(*parsed.message));
+  *out << ";";
+  if (!*out) {
+    return absl::InternalError("Unable to write DSLX output.");
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace xls
@@ -16,7 +16,9 @@
 #define XLS_TOOLS_PROTO_TO_DSLX_H_
 
 #include <filesystem>
+#include <istream>
 #include <memory>
+#include <ostream>
 
 #include "google/protobuf/descriptor.h"
 #include "absl/container/flat_hash_map.h"
@@ -44,6 +46,17 @@ absl::StatusOr<std::unique_ptr<dslx::Module>> ProtoToDslx(
     const std::string& message_name, const std::string& textproto,
     const std::string& output_var_name);
 
+// As ProtoToDslx, but writes the DSLX text to "out" as it is produced instead
+// of returning a module, and parses the message directly from "textproto".
+// The output is the same as formatting the module ProtoToDslx returns; memory
+// use is dominated by the parsed message rather than by its (much larger) DSLX
+// AST and text, which makes this the mode to use for very large protos.
+absl::Status ProtoToDslxStreaming(
+    const std::filesystem::path& source_root,
+    const std::filesystem::path& proto_schema_path,
+    const std::string& message_name, std::istream* textproto,
+    const std::string& output_var_name, std::ostream* out);
+
 }  // namespace xls
 
 #endif  // XLS_TOOLS_PROTO_TO_DSLX_H_
@@ -14,9 +14,12 @@
 
 // Converts a protobuf schema and instantiating message into DSLX structs and
 // constant data.
+#include <fstream>
+
 #include "google/protobuf/text_format.h"
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
@@ -37,6 +40,10 @@ ABSL_FLAG(std::string, textproto_path, "",
           "Path to the textproto to translate into DSLX.");
 ABSL_FLAG(std::string, var_name, "",
           "The name of the DSLX variable to instantiate.");
+ABSL_FLAG(bool, streaming, false,
+          "Write the DSLX as the message is converted instead of building "
+          "its whole DSLX module in memory first. Produces the same output; "
+          "use for very large protos.");
 
 namespace xls {
 
@@ -44,8 +51,22 @@ absl::Status RealMain(const std::string& source_root_path,
                       const std::string& proto_def_path,
                       const std::string& proto_name,
                       const std::string& textproto_path,
-                      const std::string& var_name,
+                      const std::string& var_name, bool streaming,
                       const std::string& output_path) {
+  if (streaming) {
+    std::ifstream textproto(textproto_path);
+    if (!textproto) {
+      return absl::NotFoundError(
+          absl::StrCat("Unable to open textproto: ", textproto_path));
+    }
+    std::ofstream output(output_path);
+    if (!output) {
+      return absl::InternalError(
+          absl::StrCat("Unable to open output file: ", output_path));
+    }
+    return ProtoToDslxStreaming(source_root_path, proto_def_path, proto_name,
+                                &textproto, var_name, &output);
+  }
   XLS_ASSIGN_OR_RETURN(std::string textproto, GetFileContents(textproto_path));
   XLS_ASSIGN_OR_RETURN(auto module,
                        ProtoToDslx(source_root_path, proto_def_path, proto_name,
@@ -77,7 +98,8 @@ int main(int argc, char* argv[]) {
   std::string var_name = absl::GetFlag(FLAGS_var_name);
   XLS_QCHECK(!var_name.empty()) << "--var_name must be specified.";
   XLS_QCHECK_OK(xls::RealMain(source_root_path, proto_def_path, proto_name,
-                              textproto_path, var_name, output_path));
+                              textproto_path, var_name,
+                              absl::GetFlag(FLAGS_streaming), output_path));
 
   return 0;
 }
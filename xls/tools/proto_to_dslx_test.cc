@@ -14,6 +14,7 @@
 
 #include "xls/tools/proto_to_dslx.h"
 
+#include <sstream>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -394,5 +395,72 @@ pub struct Top {
 pub const foo = Top { submessage: [SubMessage { my_ints: [sN[64]:1, sN[64]:2, sN[64]:3, sN[64]:4], my_ints_count: u32:4 }, SubMessage { my_ints: [sN[64]:0, sN[64]:0, sN[64]:0, sN[64]:0], my_ints_count: u32:0 }], submessage_count: u32:2 };)");
 }
 
+TEST(ProtoToDslxTest, StreamingMatchesModule) {
+  const std::string kSchema = R"(
+syntax = "proto2";
+
+package xls;
+
+enum Color {
+  RED = 1;
+  BLUE = 2;
+}
+
+message Entry {
+  optional uint32 key = 1;
+  repeated Color colors = 2;
+  repeated bool flags = 3;
+  optional string name = 4;
+}
+
+message Table {
+  repeated Entry entries = 1;
+  optional Entry default_entry = 2;
+  repeated int64 unused = 3;
+}
+)";
+
+  const std::string kTextproto = R"(
+entries { key: 1 colors: BLUE colors: RED flags: true name: "one" }
+entries { key: 2 }
+entries { key: 3 flags: false flags: true flags: true }
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto tempdir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto schema_file,
+      TempFile::CreateWithContentInDirectory(kSchema, tempdir.path()));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<dslx::Module> module,
+                           ProtoToDslx(tempdir.path(), schema_file.path(),
+                                       "xls.Table", kTextproto, "table"));
+
+  std::istringstream textproto(kTextproto);
+  std::ostringstream streamed;
+  XLS_ASSERT_OK(ProtoToDslxStreaming(tempdir.path(), schema_file.path(),
+                                     "xls.Table", &textproto, "table",
+                                     &streamed));
+  EXPECT_EQ(streamed.str(), module->ToString());
+}
+
+TEST(ProtoToDslxTest, StreamingRejectsMalformedTextproto) {
+  const std::string kSchema = R"(
+syntax = "proto2";
+
+package xls;
+
+message Top {
+  optional int32 field_0 = 1;
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(auto tempdir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto schema_file,
+      TempFile::CreateWithContentInDirectory(kSchema, tempdir.path()));
+  std::istringstream textproto("field_0: {");
+  std::ostringstream streamed;
+  EXPECT_THAT(ProtoToDslxStreaming(tempdir.path(), schema_file.path(),
+                                   "xls.Top", &textproto, "foo", &streamed),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 }  // namespace
 }  // namespace xls
@@ -167,8 +167,16 @@ struct Globals {
   std::unique_ptr<dslx::Scanner> scanner;
   std::unique_ptr<dslx::Parser> parser;
   dslx::ImportData import_data;
+  // The contents of the file that `module` was parsed from.
+  std::string dslx_contents;
   std::unique_ptr<dslx::Module> module;
+  // Modules replaced by a reload, which are kept alive as `import_data` may
+  // still refer to them (e.g. via their type information).
+  std::vector<std::unique_ptr<dslx::Module>> old_modules;
   dslx::TypeInfo* type_info;
+  // Kept between reloads, so that only the functions that changed are
+  // converted to IR again.
+  dslx::ConversionCache conversion_cache;
   std::unique_ptr<Package> ir_package;
   Trie identifier_trie;
   Trie command_trie;
@@ -261,7 +269,8 @@ absl::Status UpdateIr() {
       globals->ir_package,
       ConvertModuleToPackage(globals->module.get(), &globals->import_data,
                              /*emit_positions=*/true,
-                             /*traverse_tests=*/true));
+                             /*traverse_tests=*/true,
+                             &globals->conversion_cache));
   XLS_RETURN_IF_ERROR(
       RunStandardPassPipeline(globals->ir_package.get()).status());
   return absl::OkStatus();
@@ -286,6 +295,10 @@ absl::Status CommandHelp() {
 
 // Function implementing the `:reload` command, which reloads the DSLX file from
 // disk and parses/typechecks it.
+//
+// The import data is kept between reloads, so only the imported modules that
+// changed (and the modules that import them) are parsed and typechecked again;
+// if neither the file nor its imports changed, nothing is redone.
 absl::Status CommandReload() {
   Globals* globals = GetSingletonGlobals();
 
@@ -296,6 +309,13 @@ absl::Status CommandReload() {
 
   XLS_ASSIGN_OR_RETURN(std::string dslx_contents,
                        GetFileContents(globals->dslx_path));
+  int64_t evicted = globals->import_data.EvictStaleModules();
+  if (globals->module != nullptr && evicted == 0 &&
+      dslx_contents == globals->dslx_contents) {
+    std::cout << "No changes to " << globals->dslx_path
+              << " or its imports\n";
+    return absl::OkStatus();
+  }
 
   globals->scanner = absl::make_unique<dslx::Scanner>(
       std::string(globals->dslx_path), dslx_contents);
@@ -306,6 +326,9 @@ absl::Status CommandReload() {
   absl::StatusOr<std::unique_ptr<dslx::Module>> maybe_module =
       globals->parser->ParseModule();
   if (maybe_module.ok()) {
+    if (globals->module != nullptr) {
+      globals->old_modules.push_back(std::move(globals->module));
+    }
     globals->module = std::move(*maybe_module);
   } else {
     std::cout << maybe_module.status() << "\n";
@@ -315,6 +338,7 @@ absl::Status CommandReload() {
   XLS_ASSIGN_OR_RETURN(
       globals->type_info,
       CheckModule(globals->module.get(), &globals->import_data, dslx_paths));
+  globals->dslx_contents = std::move(dslx_contents);
 
   PopulateIdentifierTrie();
 
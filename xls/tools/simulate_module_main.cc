@@ -18,15 +18,18 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "xls/codegen/flattening.h"
 #include "xls/codegen/module_signature.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/format_preference.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/value.h"
 #include "xls/simulation/module_simulator.h"
+#include "xls/simulation/sharded_module_simulator.h"
 #include "xls/simulation/verilog_simulators.h"
 
 const char kUsage[] = R"(
@@ -59,6 +62,13 @@ ABSL_FLAG(std::string, args, "",
 ABSL_FLAG(std::string, verilog_simulator, "",
           "The Verilog simulator to use. If not specified, the default "
           "simulator is used.");
+ABSL_FLAG(int64_t, chunk_size, xls::verilog::ModuleSimulator::kDefaultChunkSize,
+          "Maximum number of argument sets simulated with one invocation of "
+          "the Verilog simulator. Outputs are printed as each chunk of "
+          "argument sets completes.");
+ABSL_FLAG(int64_t, num_shards, 1,
+          "Number of chunks of argument sets to simulate concurrently, each "
+          "with a separate invocation of the Verilog simulator.");
 
 namespace xls {
 namespace {
@@ -70,25 +80,41 @@ absl::Status RealMain(absl::string_view verilog_text,
   verilog::ModuleSimulator simulator(signature, verilog_text,
                                      verilog_simulator);
 
-  std::vector<absl::flat_hash_map<std::string, Value>> args_sets;
-  for (absl::string_view args_string : args_strings) {
+  // Parse the argument sets as they are simulated so only a chunk of them is
+  // held in memory.
+  auto next_input = [&](int64_t index)
+      -> absl::StatusOr<absl::optional<verilog::ModuleSimulator::BitsMap>> {
+    if (index >= args_strings.size()) {
+      return absl::nullopt;
+    }
     std::vector<Value> arg_values;
-    for (absl::string_view arg : absl::StrSplit(args_string, ';')) {
+    for (absl::string_view arg : absl::StrSplit(args_strings[index], ';')) {
       XLS_ASSIGN_OR_RETURN(Value v, Parser::ParseTypedValue(arg));
       arg_values.push_back(v);
     }
     using MapT = absl::flat_hash_map<std::string, Value>;
     XLS_ASSIGN_OR_RETURN(MapT args_set, signature.ToKwargs(arg_values));
-    args_sets.push_back(std::move(args_set));
-  }
-  XLS_ASSIGN_OR_RETURN(std::vector<Value> outputs,
-                       simulator.RunBatched(args_sets));
-
-  for (const Value& output : outputs) {
-    std::cout << output.ToString(FormatPreference::kHex) << std::endl;
-  }
-
-  return absl::OkStatus();
+    XLS_RETURN_IF_ERROR(signature.ValidateInputs(args_set));
+    verilog::ModuleSimulator::BitsMap input;
+    for (const auto& pair : args_set) {
+      input[pair.first] = FlattenValueToBits(pair.second);
+    }
+    return input;
+  };
+  auto handle_output = [&](int64_t index,
+                           const verilog::ModuleSimulator::BitsMap& output)
+      -> absl::Status {
+    XLS_RET_CHECK_EQ(output.size(), 1);
+    XLS_ASSIGN_OR_RETURN(
+        Value value,
+        UnflattenBitsToValue(output.begin()->second,
+                             signature.proto().function_type().return_type()));
+    std::cout << value.ToString(FormatPreference::kHex) << std::endl;
+    return absl::OkStatus();
+  };
+  return verilog::RunStreamingSharded(simulator, next_input, handle_output,
+                                      absl::GetFlag(FLAGS_num_shards),
+                                      absl::GetFlag(FLAGS_chunk_size));
 }
 
 }  // namespace
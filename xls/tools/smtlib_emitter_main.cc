@@ -19,15 +19,19 @@
 // TODO(rspringer): No array support yet. Should be pretty trivial to add.
 
 #include <filesystem>
+#include <fstream>
+#include <iostream>
 
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/solvers/smtlib_emitter.h"
 #include "xls/solvers/z3_ir_translator.h"
 #include "../z3/src/api/z3.h"
 #include "../z3/src/api/z3_api.h"
@@ -37,11 +41,20 @@ ABSL_FLAG(std::string, function, "",
           "will be made to try to find the package's entry function. "
           "If that fails, an error will be returned.");
 ABSL_FLAG(std::string, ir_path, "", "Path to the XLS IR to process.");
+ABSL_FLAG(bool, streaming, false,
+          "Write one SMT-LIB definition per IR node as it is visited instead "
+          "of building the whole term in Z3 and printing it. Far faster and "
+          "smaller for large functions, since shared subterms are written "
+          "once.");
+ABSL_FLAG(std::string, output_path, "",
+          "Path to write the SMT-LIB to. If unspecified, it is written to "
+          "stdout.");
 
 namespace xls {
 
 absl::Status RealMain(const std::filesystem::path& ir_path,
-                      absl::optional<std::string> function_name) {
+                      absl::optional<std::string> function_name,
+                      bool streaming, const std::string& output_path) {
   XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
   XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
   Function* function;
@@ -51,11 +64,24 @@ absl::Status RealMain(const std::filesystem::path& ir_path,
     XLS_ASSIGN_OR_RETURN(function, package->GetFunction(function_name.value()));
   }
 
+  std::ofstream output_file;
+  if (!output_path.empty()) {
+    output_file.open(output_path);
+    if (!output_file) {
+      return absl::InternalError(
+          absl::StrCat("Unable to open output file: ", output_path));
+    }
+  }
+  std::ostream& out = output_path.empty() ? std::cout : output_file;
+
+  if (streaming) {
+    return solvers::EmitSmtLib(function, out);
+  }
   XLS_ASSIGN_OR_RETURN(auto translator,
                        solvers::z3::IrTranslator::CreateAndTranslate(function));
   Z3_set_ast_print_mode(translator->ctx(), Z3_PRINT_SMTLIB2_COMPLIANT);
-  std::cout << Z3_ast_to_string(translator->ctx(), translator->GetReturnNode())
-            << std::endl;
+  out << Z3_ast_to_string(translator->ctx(), translator->GetReturnNode())
+      << std::endl;
   return absl::OkStatus();
 }
 
@@ -68,6 +94,8 @@ int main(int argc, char* argv[]) {
   if (!absl::GetFlag(FLAGS_function).empty()) {
     function_name = absl::GetFlag(FLAGS_function);
   }
-  XLS_QCHECK_OK(xls::RealMain(absl::GetFlag(FLAGS_ir_path), function_name));
+  XLS_QCHECK_OK(xls::RealMain(absl::GetFlag(FLAGS_ir_path), function_name,
+                              absl::GetFlag(FLAGS_streaming),
+                              absl::GetFlag(FLAGS_output_path)));
   return 0;
 }
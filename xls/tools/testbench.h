@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <thread>  // NOLINT(build/c++11)
 #include <type_traits>
 
@@ -30,15 +31,15 @@ namespace xls {
 
 // Testbench is a helper class to test an XLS module (or...anything, really)
 // across a range of inputs. This class creates a set of worker threads and
-// divides the input across them, and sets them to go until complete.
-// Execution status (percent complete, number of result mismatches) will be
+// sets them to go until the input is exhausted. Execution status (percent
+// complete, per-thread throughput, number of result mismatches) will be
 // periodically printed to the terminal, as this class' primary use is for
 // exploring large test spaces.
 //
-// Presently, work is parititioned uniformly across threads at startup. This can
-// lead to work imbalance if certain areas of the input space execute faster
-// than others. More advanced strategies can be explored in the future if this
-// becomes a problem.
+// Work is handed out to the threads in chunks as they ask for it (see
+// TestbenchWorkPool) rather than partitioned up front, so regions of the input
+// space which are slower to evaluate than others don't leave most threads idle
+// at the end of a run.
 
 namespace internal {
 // Forward decl of common Testbench base class.
@@ -87,10 +88,10 @@ class Testbench
         create_shard_(create_shard),
         compute_expected_(compute_expected),
         compute_actual_(compute_actual) {
-    this->thread_create_fn_ = [this](uint64_t start, uint64_t end) {
+    this->thread_create_fn_ = [this](TestbenchWorkPool* work_pool) {
       return std::make_unique<
           TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>>(
-          &this->mutex_, &this->wake_me_, start, end, this->max_failures_,
+          &this->mutex_, &this->wake_me_, work_pool, this->max_failures_,
           this->index_to_input_, create_shard_, compute_expected_,
           compute_actual_, this->compare_results_, this->log_errors_);
     };
@@ -120,10 +121,10 @@ class Testbench<JitWrapperT, InputT, ResultT, ShardDataT,
             log_errors),
         compute_expected_(compute_expected),
         compute_actual_(compute_actual) {
-    this->thread_create_fn_ = [this](uint64_t start, uint64_t end) {
+    this->thread_create_fn_ = [this](TestbenchWorkPool* work_pool) {
       return std::make_unique<
           TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>>(
-          &this->mutex_, &this->wake_me_, start, end, this->max_failures_,
+          &this->mutex_, &this->wake_me_, work_pool, this->max_failures_,
           this->index_to_input_, compute_expected_, compute_actual_,
           this->compare_results_, this->log_errors_);
     };
@@ -178,22 +179,11 @@ class TestbenchBase {
     start_time_ = absl::Now();
 
     // Set up all the workers.
-    uint64_t chunk_size = (end_ - start_) / num_threads_;
-    uint64_t chunk_remainder = (end_ - start_) % chunk_size;
-    uint64_t first = 0;
-    uint64_t last;
+    work_pool_ =
+        std::make_unique<TestbenchWorkPool>(start_, end_, num_threads_);
     for (int i = 0; i < num_threads_; i++) {
-      last = first + chunk_size;
-      // Distribute any remainder evenly amongst the threads.
-      if (chunk_remainder > 0) {
-        last++;
-        chunk_remainder--;
-      }
-
-      threads_.push_back(thread_create_fn_(first, last));
+      threads_.push_back(thread_create_fn_(work_pool_.get()));
       threads_.back()->Run();
-
-      first = last + 1;
     }
 
     // Now monitor them.
@@ -245,18 +235,6 @@ class TestbenchBase {
 
   // Prints the current execution status across all threads.
   void PrintStatus() {
-    // Get the remainder-adjusted chunk size for this thread.
-    auto thread_chunk_size = [this](int thread_index) {
-      uint64_t total_size = end_ - start_;
-      uint64_t chunk_size = total_size / threads_.size();
-      uint64_t remainder = total_size % chunk_size;
-      if (thread_index < remainder) {
-        chunk_size++;
-      }
-      return chunk_size;
-    };
-
-    // Ignore remainder issues here. It shouldn't matter much at all.
     absl::Time now = absl::Now();
     auto delta = now - start_time_;
     uint64_t total_done = 0;
@@ -264,25 +242,31 @@ class TestbenchBase {
       uint64_t num_passes = threads_[i]->num_passes();
       uint64_t num_failures = threads_[i]->num_failures();
       uint64_t thread_done = num_passes + num_failures;
-      uint64_t chunk_size = thread_chunk_size(i);
       total_done += thread_done;
+      // Threads which have finished are rated over the time they ran.
+      absl::Duration thread_time =
+          threads_[i]->running() ? delta : threads_[i]->run_time();
       std::cout << absl::StreamFormat(
-                       "thread %02d: %f%% @ %.1f us/sample :: failures %d", i,
-                       static_cast<double>(thread_done) / chunk_size * 100.0,
-                       absl::ToDoubleMicroseconds(delta) / thread_done,
-                       num_failures)
+                       "thread %02d: %d samples @ %.1f us/sample (%.2f "
+                       "Ksamples/s) :: failures %d%s",
+                       i, thread_done,
+                       absl::ToDoubleMicroseconds(thread_time) / thread_done,
+                       thread_done / absl::ToDoubleSeconds(thread_time) / 1e3,
+                       num_failures, threads_[i]->running() ? "" : " (done)")
                 << "\n";
     }
     double done_per_second = total_done / absl::ToDoubleSeconds(delta);
-    int64_t remaining = end_ - start_ - total_done;
+    int64_t remaining = work_pool_->size() - total_done;
     auto estimate = absl::Seconds(remaining / done_per_second);
     double throughput_this_print =
         static_cast<double>(total_done - num_samples_processed_) /
         ToInt64Seconds(kPrintInterval);
     std::cout << absl::StreamFormat(
-                     "--- ^ after %s elapsed; %.2f Misamples/s; estimate %s "
-                     "remaining ...",
+                     "--- ^ after %s elapsed; %.2f%% complete; %.2f "
+                     "Misamples/s; estimate %s remaining ...",
                      absl::FormatDuration(delta),
+                     static_cast<double>(total_done) / work_pool_->size() *
+                         100.0,
                      throughput_this_print / std::pow(2, 20),
                      absl::FormatDuration(estimate))
               << std::endl;
@@ -308,7 +292,9 @@ class TestbenchBase {
   std::function<void(int64_t, InputT, ResultT, ResultT)> log_errors_;
 
   using ThreadT = TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>;
-  std::function<std::unique_ptr<ThreadT>(uint64_t, uint64_t)> thread_create_fn_;
+  std::function<std::unique_ptr<ThreadT>(TestbenchWorkPool*)>
+      thread_create_fn_;
+  std::unique_ptr<TestbenchWorkPool> work_pool_;
   std::vector<std::unique_ptr<ThreadT>> threads_;
 
   // The main thread sleeps while tests are running. As worker threads finish,
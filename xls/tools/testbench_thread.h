@@ -15,6 +15,8 @@
 #ifndef XLS_TOOLS_TESTBENCH_THREAD_H_
 #define XLS_TOOLS_TESTBENCH_THREAD_H_
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 
 #include "absl/status/status.h"
@@ -29,13 +31,59 @@
 
 namespace xls {
 
+// Hands out the index space [start, end) to worker threads in chunks, so that
+// threads which get through their work quickly pick up more instead of going
+// idle while others finish. Chunks start large, to keep contention on the
+// shared counter low, and shrink as the space is used up so that all threads
+// finish at about the same time ("guided" scheduling).
+class TestbenchWorkPool {
+ public:
+  // The smallest chunk handed out, other than at the very end of the space.
+  static constexpr uint64_t kMinChunkSize = 1024;
+
+  TestbenchWorkPool(uint64_t start, uint64_t end, int num_threads)
+      : start_(start),
+        end_(std::max(start, end)),
+        num_threads_(std::max(num_threads, 1)),
+        next_(start) {}
+
+  // Claims the next chunk of indices as [*chunk_start, *chunk_end). Returns
+  // false once the whole space has been handed out. Thread-safe.
+  bool Claim(uint64_t* chunk_start, uint64_t* chunk_end) {
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    while (next < end_) {
+      uint64_t remaining = end_ - next;
+      uint64_t chunk_size = std::min(
+          remaining,
+          std::max(kMinChunkSize, remaining / (uint64_t{4} * num_threads_)));
+      if (next_.compare_exchange_weak(next, next + chunk_size,
+                                      std::memory_order_relaxed)) {
+        *chunk_start = next;
+        *chunk_end = next + chunk_size;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint64_t start() const { return start_; }
+  uint64_t end() const { return end_; }
+  uint64_t size() const { return end_ - start_; }
+
+ private:
+  const uint64_t start_;
+  const uint64_t end_;
+  const int num_threads_;
+  std::atomic<uint64_t> next_;
+};
+
 template <typename JitWrapperT, typename InputT, typename ResultT,
           typename ShardDataT>
 class TestbenchThreadBase;
 
 // TestbenchThread handles the work of _actually_ running tests.
-// It simply iterates over its given range of the index space and calls the
-// expected/actual calculators.
+// It repeatedly claims a chunk of the index space from the shared work pool
+// and calls the expected/actual calculators on each index in it.
 //
 // Just as with Testbench, TestbenchThread supports execution both with and
 // without per-shard data, and uses the same type of construct to expose an API
@@ -49,6 +97,7 @@ class TestbenchThread
   // All specified functions must be thread-safe.
   //  - wake_parent_mutex: A mutex that protects:
   //  - wake_parent: A condvar to kick the parent when this thread has finished.
+  //  - work_pool: The source of the indices to evaluate, shared by all threads.
   //  - max_failures: The number of failures that will cause us to bail out.
   //                  If 0, then there will be no limit.
   //  - index_to_input: A function that can convert an index to an input to the
@@ -58,7 +107,7 @@ class TestbenchThread
   //                     under test.
   TestbenchThread(
       absl::Mutex* wake_parent_mutex, absl::CondVar* wake_parent,
-      uint64_t start_index, uint64_t end_index, uint64_t max_failures,
+      TestbenchWorkPool* work_pool, uint64_t max_failures,
       std::function<InputT(uint64_t)> index_to_input,
       std::function<std::unique_ptr<ShardDataT>()> create_shard,
       std::function<ResultT(ShardDataT*, InputT)> generate_expected,
@@ -66,8 +115,8 @@ class TestbenchThread
       std::function<bool(ResultT, ResultT)> compare_results,
       std::function<void(int64_t, InputT, ResultT, ResultT)> log_errors)
       : TestbenchThreadBase<JitWrapperT, InputT, ResultT, ShardDataT>(
-            wake_parent_mutex, wake_parent, start_index, end_index,
-            max_failures, index_to_input, compare_results, log_errors),
+            wake_parent_mutex, wake_parent, work_pool, max_failures,
+            index_to_input, compare_results, log_errors),
         shard_data_(create_shard()),
         generate_expected_(generate_expected),
         generate_actual_(generate_actual) {
@@ -97,15 +146,15 @@ class TestbenchThread<
  public:
   TestbenchThread(
       absl::Mutex* wake_parent_mutex, absl::CondVar* wake_parent,
-      uint64_t start_index, uint64_t end_index, uint64_t max_failures,
+      TestbenchWorkPool* work_pool, uint64_t max_failures,
       std::function<InputT(uint64_t)> index_to_input,
       std::function<ResultT(InputT)> generate_expected,
       std::function<ResultT(JitWrapperT*, InputT)> generate_actual,
       std::function<bool(ResultT, ResultT)> compare_results,
       std::function<void(int64_t, InputT, ResultT, ResultT)> log_errors)
       : TestbenchThreadBase<JitWrapperT, InputT, ResultT, ShardDataT>(
-            wake_parent_mutex, wake_parent, start_index, end_index,
-            max_failures, index_to_input, compare_results, log_errors),
+            wake_parent_mutex, wake_parent, work_pool, max_failures,
+            index_to_input, compare_results, log_errors),
         generate_expected_(generate_expected),
         generate_actual_(generate_actual) {
     this->generate_expected_fn_ = [this](InputT& input) {
@@ -130,7 +179,7 @@ class TestbenchThreadBase {
  public:
   TestbenchThreadBase(
       absl::Mutex* wake_parent_mutex, absl::CondVar* wake_parent,
-      uint64_t start_index, uint64_t end_index, uint64_t max_failures,
+      TestbenchWorkPool* work_pool, uint64_t max_failures,
       std::function<InputT(uint64_t)> index_to_input,
       std::function<bool(ResultT, ResultT)> compare_results,
       std::function<void(int64_t, InputT, ResultT, ResultT)> log_errors)
@@ -138,8 +187,7 @@ class TestbenchThreadBase {
         wake_parent_(wake_parent),
         cancelled_(false),
         running_(false),
-        start_index_(start_index),
-        end_index_(end_index),
+        work_pool_(work_pool),
         max_failures_(max_failures),
         num_passes_(0),
         num_failures_(0),
@@ -169,28 +217,37 @@ class TestbenchThreadBase {
     jit_wrapper_ = std::move(status_or_wrapper.value());
 
     running_.store(true);
-    for (uint64_t i = start_index_; i < end_index_; i++) {
-      // Don't check for cancelled on every iteration; it's a touch slow.
-      if (i % 128 == 0 && cancelled_.load()) {
-        return_status = absl::CancelledError("This thread was cancelled.");
-        break;
-      }
-
-      InputT input = index_to_input_(i);
-      ResultT expected = generate_expected_fn_(input);
-      ResultT actual = generate_actual_fn_(input);
-      if (!compare_results_(expected, actual)) {
-        num_failures_.store(num_failures_.load() + 1);
-        log_errors_(i, input, expected, actual);
-        if (max_failures_ <= num_failures_.load()) {
-          return_status = absl::UnknownError("Maximum error count reached.");
+    absl::Time start_time = absl::Now();
+    uint64_t chunk_start;
+    uint64_t chunk_end;
+    while (return_status.ok() && work_pool_->Claim(&chunk_start, &chunk_end)) {
+      for (uint64_t i = chunk_start; i < chunk_end; i++) {
+        // Don't check for cancelled on every iteration; it's a touch slow.
+        if (i % 128 == 0 && cancelled_.load()) {
+          return_status = absl::CancelledError("This thread was cancelled.");
           break;
         }
-      } else {
-        num_passes_.store(num_passes_.load() + 1);
+
+        InputT input = index_to_input_(i);
+        ResultT expected = generate_expected_fn_(input);
+        ResultT actual = generate_actual_fn_(input);
+        if (!compare_results_(expected, actual)) {
+          num_failures_.store(num_failures_.load() + 1);
+          log_errors_(i, input, expected, actual);
+          if (max_failures_ <= num_failures_.load()) {
+            return_status = absl::UnknownError("Maximum error count reached.");
+            break;
+          }
+        } else {
+          num_passes_.store(num_passes_.load() + 1);
+        }
       }
     }
 
+    {
+      absl::MutexLock lock(&mutex_);
+      run_time_ = absl::Now() - start_time;
+    }
     running_.store(false);
     {
       absl::MutexLock lock(&mutex_);
@@ -214,6 +271,13 @@ class TestbenchThreadBase {
 
   uint64_t num_passes() { return num_passes_.load(); }
 
+  // Returns how long the thread spent evaluating samples, once it has
+  // finished.
+  absl::Duration run_time() {
+    absl::MutexLock lock(&mutex_);
+    return run_time_;
+  }
+
   absl::Status status() {
     absl::MutexLock lock(&mutex_);
     return status_;
@@ -238,9 +302,10 @@ class TestbenchThreadBase {
   absl::Status status_ ABSL_GUARDED_BY(mutex_);
   std::atomic<bool> cancelled_;
   std::atomic<bool> running_;
+  absl::Duration run_time_ ABSL_GUARDED_BY(mutex_);
 
-  uint64_t start_index_;
-  uint64_t end_index_;
+  // Parent-owned.
+  TestbenchWorkPool* work_pool_;
 
   // Bookkeeping data.
   uint64_t max_failures_;
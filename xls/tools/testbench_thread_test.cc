@@ -0,0 +1,99 @@
+// Copyright 2021 The XLS Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/testbench_thread.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/thread.h"
+
+namespace xls {
+namespace {
+
+TEST(TestbenchWorkPoolTest, ChunksCoverSpaceInOrder) {
+  TestbenchWorkPool pool(/*start=*/100, /*end=*/1000000, /*num_threads=*/8);
+  EXPECT_EQ(pool.size(), 1000000 - 100);
+
+  uint64_t expected_start = 100;
+  uint64_t previous_size = pool.size();
+  uint64_t chunk_start;
+  uint64_t chunk_end;
+  while (pool.Claim(&chunk_start, &chunk_end)) {
+    EXPECT_EQ(chunk_start, expected_start);
+    ASSERT_GT(chunk_end, chunk_start);
+    uint64_t size = chunk_end - chunk_start;
+    // Chunks shrink as the space is used up, down to the minimum size.
+    EXPECT_LE(size, previous_size);
+    if (chunk_end != pool.end()) {
+      EXPECT_GE(size, TestbenchWorkPool::kMinChunkSize);
+    }
+    previous_size = size;
+    expected_start = chunk_end;
+  }
+  EXPECT_EQ(expected_start, 1000000);
+  EXPECT_FALSE(pool.Claim(&chunk_start, &chunk_end));
+}
+
+TEST(TestbenchWorkPoolTest, EmptyAndTinySpaces) {
+  uint64_t chunk_start;
+  uint64_t chunk_end;
+  TestbenchWorkPool empty(/*start=*/5, /*end=*/5, /*num_threads=*/4);
+  EXPECT_FALSE(empty.Claim(&chunk_start, &chunk_end));
+
+  TestbenchWorkPool tiny(/*start=*/5, /*end=*/8, /*num_threads=*/4);
+  ASSERT_TRUE(tiny.Claim(&chunk_start, &chunk_end));
+  EXPECT_EQ(chunk_start, 5);
+  EXPECT_EQ(chunk_end, 8);
+  EXPECT_FALSE(tiny.Claim(&chunk_start, &chunk_end));
+}
+
+// Each index is handed out exactly once when threads claim concurrently.
+TEST(TestbenchWorkPoolTest, ConcurrentClaims) {
+  constexpr int kNumThreads = 8;
+  constexpr uint64_t kSize = 1 << 20;
+  TestbenchWorkPool pool(/*start=*/0, /*end=*/kSize, kNumThreads);
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> claimed(
+      kNumThreads);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.push_back(std::make_unique<Thread>([&pool, &claimed, i]() {
+        uint64_t chunk_start;
+        uint64_t chunk_end;
+        while (pool.Claim(&chunk_start, &chunk_end)) {
+          claimed[i].push_back({chunk_start, chunk_end});
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread->Join();
+    }
+  }
+
+  std::vector<int> counts(kSize, 0);
+  for (const auto& chunks : claimed) {
+    for (const auto& [chunk_start, chunk_end] : chunks) {
+      for (uint64_t i = chunk_start; i < chunk_end; ++i) {
+        ++counts[i];
+      }
+    }
+  }
+  EXPECT_THAT(counts, ::testing::Each(1));
+}
+
+}  // namespace
+}  // namespace xls
@@ -139,9 +139,10 @@ absl::Status InstantiateFixedLatencyDeviceFunction(
 absl::StatusOr<Module*> WrapIo(absl::string_view module_name,
                                absl::string_view instance_name,
                                const ModuleSignature& signature,
-                               IoStrategy* io_strategy, VerilogFile* f) {
+                               IoStrategy* io_strategy, VerilogFile* f,
+                               const WrapIoOptions& options) {
   XLS_ASSIGN_OR_RETURN(Module * input_controller_m,
-                       InputControllerModule(signature, f));
+                       InputControllerModule(signature, f, options));
   XLS_ASSIGN_OR_RETURN(Module * output_controller_m,
                        OutputControllerModule(signature, f));
 
@@ -388,8 +389,9 @@ static absl::StatusOr<Module*> EscapeDecoderModule(VerilogFile* f) {
   return m;
 }
 
-absl::StatusOr<Module*> InputControllerModule(const ModuleSignature& signature,
-                                              VerilogFile* f) {
+absl::StatusOr<Module*> InputControllerModule(
+    const ModuleSignature& signature, VerilogFile* f,
+    const WrapIoOptions& options) {
   XLS_ASSIGN_OR_RETURN(Module * reset_m, InputResetModule(f));
   XLS_ASSIGN_OR_RETURN(
       Module * shift_m,
@@ -443,13 +445,24 @@ absl::StatusOr<Module*> InputControllerModule(const ModuleSignature& signature,
   LogicRef* shifter_write_en =
       m->AddReg("shifter_write_en", f->ScalarType(), f->Literal(UBits(0, 1)));
   LogicRef* shifter_done = m->AddWire("shifter_done", f->ScalarType());
+  // When buffering requests, the shifter output is loaded into a holding
+  // register which drives data_out.
+  LogicRef* shifter_data_out =
+      options.buffer_requests
+          ? m->AddWire("shifter_data_out",
+                       f->BitVectorType(signature.TotalDataInputBits()))
+          : data_out;
+  LogicRef* holding_full = nullptr;
+  if (options.buffer_requests) {
+    holding_full = m->AddReg("holding_full", f->ScalarType());
+  }
   {
     std::vector<Connection> connections;
     connections.push_back(Connection{"clk", clk});
     connections.push_back(Connection{"clear", shifter_clear});
     connections.push_back(Connection{"byte_in", shifter_byte_in});
     connections.push_back(Connection{"write_en", shifter_write_en});
-    connections.push_back(Connection{"data_out", data_out});
+    connections.push_back(Connection{"data_out", shifter_data_out});
     connections.push_back(Connection{"done", shifter_done});
     m->Add<Instantiation>(shift_m->name(), "shifter",
                           /*parameters=*/absl::Span<const Connection>(),
@@ -498,15 +511,45 @@ absl::StatusOr<Module*> InputControllerModule(const ModuleSignature& signature,
       .SetRegisterNext(is_escaped_reg, 0)
       .SetOutput(shifter_write_en_output, 1);
 
-  // Input is complete. Assert output valid and wait for ready signal.
-  data_done_state->SetOutput(data_out_valid_output, 1)
-      .OnCondition(data_out_ready)
-      .NextState(init_state);
+  FsmOutput* load_holding_output = nullptr;
+  if (options.buffer_requests) {
+    // Input is complete. Move it to the holding register once that is empty
+    // (or is emptied this cycle) and start receiving the next input.
+    load_holding_output = fsm.AddOutput1("load_holding_reg", 0);
+    data_done_state
+        ->OnCondition(
+            f->LogicalOr(f->LogicalNot(holding_full), data_out_ready))
+        .SetOutput(load_holding_output, 1)
+        .NextState(init_state);
+  } else {
+    // Input is complete. Assert output valid and wait for ready signal.
+    data_done_state->SetOutput(data_out_valid_output, 1)
+        .OnCondition(data_out_ready)
+        .NextState(init_state);
+  }
 
   XLS_RETURN_IF_ERROR(fsm.Build());
 
-  m->Add<ContinuousAssignment>(data_out_valid,
-                               data_out_valid_output->logic_ref);
+  if (options.buffer_requests) {
+    LogicRef* holding_data = m->AddReg(
+        "holding_data", f->BitVectorType(signature.TotalDataInputBits()));
+    LogicRef* load_holding = load_holding_output->logic_ref;
+    auto af = m->Add<AlwaysFlop>(
+        clk, Reset{rst_n_out, /*asynchronous=*/false, /*active_low=*/true});
+    af->AddRegister(holding_data,
+                    f->Ternary(load_holding, shifter_data_out, holding_data));
+    // The holding register empties when the device function accepts its data.
+    Expression* holding_stays_full =
+        f->LogicalAnd(holding_full, f->LogicalNot(data_out_ready));
+    af->AddRegister(holding_full,
+                    f->LogicalOr(load_holding, holding_stays_full),
+                    /*reset_value=*/f->PlainLiteral(0));
+    m->Add<ContinuousAssignment>(data_out, holding_data);
+    m->Add<ContinuousAssignment>(data_out_valid, holding_full);
+  } else {
+    m->Add<ContinuousAssignment>(data_out_valid,
+                                 data_out_valid_output->logic_ref);
+  }
 
   // The byte_in_ready signal can come from the FSM or the reset module (in case
   // of receiving a reset IO code). Or them together to generate the output
@@ -51,6 +51,16 @@ enum IoEscapeCode : uint8_t {
   kEscapeByte = 0xff,
 };
 
+struct WrapIoOptions {
+  // If true, the input controller moves each complete request into a holding
+  // register, from which the device function consumes it, and immediately
+  // starts receiving the next request. The host can then send a request while
+  // the previous one is computed and its result transmitted (see
+  // DeviceRpcStrategy::CallUnnamedBatch) instead of waiting for each response.
+  // The wrapper holds at most two requests, so at most two may be in flight.
+  bool buffer_requests = false;
+};
+
 // Decorates a Verilog module, that represents an HLS-codegen'd function entry
 // point, with an I/O state machine.
 //
@@ -71,6 +81,7 @@ enum IoEscapeCode : uint8_t {
 //    function" instance that is created.
 //  latency: Latency for the "device function" module to produce a result, in
 //    cycles, once input has been presented to it.
+//  options: See WrapIoOptions.
 //
 // TODO(leary): 2019-03-25 We'll want to change the I/O mechanism into a
 // pluggable strategy, right now this assumes ICE40 UART, but just as easily we
@@ -78,19 +89,23 @@ enum IoEscapeCode : uint8_t {
 absl::StatusOr<Module*> WrapIo(absl::string_view module_name,
                                absl::string_view instance_name,
                                const ModuleSignature& signature,
-                               IoStrategy* io_strategy, VerilogFile* f);
+                               IoStrategy* io_strategy, VerilogFile* f,
+                               const WrapIoOptions& options = WrapIoOptions());
 
 // Creates and returns a module which controls the input to the I/O state
 // machine. This module has a byte-wide input with ready/valid flow control and
 // an arbitrary width output with ready/valid flow control. Input is accepted
 // byte-by-byte and shifted into the (potentially larger) arbitrary width output
-// where the first byte is the MSB.
+// where the first byte is the MSB. With options.buffer_requests the output is
+// driven from a holding register, so the next input is accepted while the
+// output waits for ready.
 //
 // This module is intended to be used within WrapIo and is exposed in the header
 // for testing purposes.
 // TODO(meheff): Hook up this module into WrapIo.
-absl::StatusOr<Module*> InputControllerModule(const ModuleSignature& signature,
-                                              VerilogFile* f);
+absl::StatusOr<Module*> InputControllerModule(
+    const ModuleSignature& signature, VerilogFile* f,
+    const WrapIoOptions& options = WrapIoOptions());
 
 // Creates and returns the module which controls the reset of the I/O state
 // machine via the reset control code (IoControlCode::kReset). This is
@@ -31,6 +31,9 @@ ABSL_FLAG(std::string, signature_proto_path, "",
 ABSL_FLAG(std::string, target_device, "", "target device kind (e.g. ice40)");
 ABSL_FLAG(std::string, include, "",
           "path to include with 'device function' module");
+ABSL_FLAG(bool, buffer_requests, false,
+          "accept the next request while the device function computes the "
+          "previous one, so the host can pipeline calls");
 
 namespace xls {
 namespace tools {
@@ -66,8 +69,11 @@ void RealMain() {
       verilog::IoStrategyFactory::CreateForDevice(target_device, &f);
   XLS_QCHECK_OK(io_strategy_status.status());
   auto io_strategy = std::move(io_strategy_status).value();
-  absl::StatusOr<verilog::Module*> module_status = verilog::WrapIo(
-      wrapped_module_name, instance_name, signature, io_strategy.get(), &f);
+  verilog::WrapIoOptions options;
+  options.buffer_requests = absl::GetFlag(FLAGS_buffer_requests);
+  absl::StatusOr<verilog::Module*> module_status =
+      verilog::WrapIo(wrapped_module_name, instance_name, signature,
+                      io_strategy.get(), &f, options);
   XLS_QCHECK_OK(module_status.status());
   std::cout << f.Emit() << std::endl;
 }
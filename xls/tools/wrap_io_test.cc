@@ -94,6 +94,49 @@ TEST_P(WrapIoTest, WrapIoIncrement8b) {
   XLS_EXPECT_OK(tb.Run());
 }
 
+TEST_P(WrapIoTest, WrapIoIncrement8bBufferedRequests) {
+  VerilogFile file(UseSystemVerilog());
+
+  const std::string kWrappedModuleName = TestBaseName();
+  Module* wrapped_m = file.AddModule(kWrappedModuleName);
+  LogicRef* m_input = wrapped_m->AddInput("in", file.BitVectorType(8));
+  LogicRef* m_output = wrapped_m->AddOutput("out", file.BitVectorType(8));
+  wrapped_m->Add<ContinuousAssignment>(m_output,
+                                       file.Add(m_input, file.PlainLiteral(1)));
+
+  ModuleSignatureBuilder b(kWrappedModuleName);
+  b.AddDataInput(m_input->GetName(), 8);
+  b.AddDataOutput(m_output->GetName(), 8);
+  b.WithFixedLatencyInterface(1);
+  XLS_ASSERT_OK_AND_ASSIGN(ModuleSignature signature, b.Build());
+
+  NullIoStrategy io_strategy;
+  WrapIoOptions options;
+  options.buffer_requests = true;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      Module * m, WrapIo(kWrappedModuleName, "dtw", signature, &io_strategy,
+                         &file, options));
+  XLS_VLOG(1) << file.Emit();
+
+  // Send three requests back to back without consuming any output. The first
+  // result is held by the output controller, the second request in the
+  // holding register and the third in the input shift register.
+  ModuleTestbench tb(m, GetSimulator(), "clk");
+  tb.Set("byte_out_ready", 0).Set("byte_in_valid", 1);
+  tb.Set("byte_in", 42).WaitFor("byte_in_ready").NextCycle();
+  tb.Set("byte_in", 100).WaitFor("byte_in_ready").NextCycle();
+  tb.Set("byte_in", 7).WaitFor("byte_in_ready").NextCycle();
+  tb.SetX("byte_in").Set("byte_in_valid", 0);
+
+  for (int64_t expected : {43, 101, 8}) {
+    tb.WaitFor("byte_out_valid").ExpectEq("byte_out", expected).NextCycle();
+    tb.Set("byte_out_ready", 1).NextCycle();
+    tb.Set("byte_out_ready", 0).NextCycle();
+  }
+
+  XLS_EXPECT_OK(tb.Run());
+}
+
 TEST_P(WrapIoTest, WrapIoNot16b) {
   VerilogFile file(UseSystemVerilog());
 
@@ -58,6 +58,15 @@ flags.DEFINE_string(
 flags.DEFINE_string(
     'entry', None, 'Name of function to visualize. If not given then the '
     'function is chosen heuristically (e.g., "main" if it exists).')
+flags.DEFINE_enum(
+    'cluster_by', None, ['none', 'stage', 'source_file', 'logic_cloud'],
+    'How to cluster the nodes of functions larger than --cluster_threshold. '
+    'Collapsed clusters are drawn as a single node and expanded on demand by '
+    'clicking them. Defaults to "stage" if --pipeline_stages is given and '
+    '"logic_cloud" otherwise.')
+flags.DEFINE_integer(
+    'cluster_threshold', 2000,
+    'Functions with more nodes than this are rendered clustered.')
 flags.mark_flag_as_required('delay_model')
 
 IR_EXAMPLES_FILE_LIST = 'xls/visualization/ir_viz/ir_examples_file_list.txt'
@@ -216,13 +225,31 @@ def example_handler(filename):
     flask.abort(404)
 
 
+def get_cluster_by() -> str:
+  """Returns the clustering of large functions to use."""
+  if FLAGS.cluster_by is not None:
+    return FLAGS.cluster_by
+  return 'stage' if FLAGS.pipeline_stages else 'logic_cloud'
+
+
 @webapp.route('/graph', methods=['POST'])
 def graph_handler():
-  """Parses the posted text and returns a parse status."""
+  """Parses the posted text and returns a parse status.
+
+  For large functions only the clusters listed (as a JSON array of cluster
+  ids) in the optional 'expanded' form field are returned in full.
+  """
   text = flask.request.form['text']
+  expanded = json.loads(flask.request.form.get('expanded', '[]'))
   try:
-    json_text = ir_to_json.ir_to_json(text, FLAGS.delay_model,
-                                      FLAGS.pipeline_stages, FLAGS.entry)
+    json_text = ir_to_json.ir_to_json(
+        text,
+        FLAGS.delay_model,
+        FLAGS.pipeline_stages,
+        FLAGS.entry,
+        cluster_by=get_cluster_by(),
+        cluster_threshold=FLAGS.cluster_threshold,
+        expanded=expanded)
   except Exception as e:  # pylint: disable=broad-except
     # TODO(meheff): Switch to new pybind11 more-specific exception.
     return flask.jsonify({'error_code': 'error', 'message': str(e)})
@@ -14,10 +14,15 @@
 
 #include "xls/visualization/ir_viz/ir_to_json.h"
 
+#include <utility>
+#include <vector>
+
 #include "google/protobuf/util/json_util.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "xls/common/logging/logging.h"
@@ -27,6 +32,7 @@
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/dfs_visitor.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/ir/node_iterator.h"
 #include "xls/ir/op.h"
 #include "xls/ir/package.h"
 #include "xls/passes/bdd_query_engine.h"
@@ -96,11 +102,105 @@ absl::StatusOr<IrForVisualization::Attributes> NodeAttributes(
   return attributes;
 }
 
+std::string SanitizeName(absl::string_view name) {
+  return absl::StrReplaceAll(name, {{".", "_"}});
+}
+
+// Assigns each node of "function" to a cluster and adds the clusters to "ir"
+// in the order their first members appear in the function. Returns the index
+// of the cluster of each node.
+absl::StatusOr<absl::flat_hash_map<Node*, int64_t>> AssignClusters(
+    FunctionBase* function, ClusterBy cluster_by,
+    const PipelineSchedule* schedule, IrForVisualization* ir) {
+  if (cluster_by == ClusterBy::kStage && schedule == nullptr) {
+    return absl::InvalidArgumentError(
+        "Clustering by stage requires a schedule");
+  }
+  // The root of the fanout-free region of each node.
+  absl::flat_hash_map<Node*, Node*> cloud_roots;
+  if (cluster_by == ClusterBy::kLogicCloud) {
+    for (Node* node : ReverseTopoSort(function)) {
+      if (node->users().size() == 1 && !function->HasImplicitUse(node)) {
+        cloud_roots[node] = cloud_roots.at(node->users().front());
+      } else {
+        cloud_roots[node] = node;
+      }
+    }
+  }
+
+  absl::flat_hash_map<std::string, int64_t> cluster_indices;
+  absl::flat_hash_map<Node*, int64_t> node_clusters;
+  for (Node* node : function->nodes()) {
+    std::string key;
+    std::string name;
+    switch (cluster_by) {
+      case ClusterBy::kStage:
+        key = absl::StrCat("stage_", schedule->cycle(node));
+        name = absl::StrCat("stage ", schedule->cycle(node));
+        break;
+      case ClusterBy::kSourceFile:
+        if (node->loc().has_value()) {
+          key = absl::StrCat("file_", node->loc()->fileno().value());
+          name = absl::StrCat("file ", node->loc()->fileno().value());
+        } else {
+          key = "file_unknown";
+          name = "unknown file";
+        }
+        break;
+      case ClusterBy::kLogicCloud: {
+        Node* root = cloud_roots.at(node);
+        key = absl::StrCat("cloud_", SanitizeName(root->GetName()));
+        name = absl::StrCat("cloud of ", root->GetName());
+        break;
+      }
+      case ClusterBy::kNone:
+        return absl::InvalidArgumentError("No clustering requested");
+    }
+    auto [it, inserted] = cluster_indices.insert({key, ir->clusters_size()});
+    if (inserted) {
+      IrForVisualization::Cluster* cluster = ir->add_clusters();
+      cluster->set_id(absl::StrCat("cluster_", key));
+      cluster->set_name(name);
+      cluster->set_node_count(0);
+    }
+    IrForVisualization::Cluster* cluster = ir->mutable_clusters(it->second);
+    cluster->set_node_count(cluster->node_count() + 1);
+    node_clusters[node] = it->second;
+  }
+  return node_clusters;
+}
+
 }  // namespace
 
+absl::StatusOr<ClusterBy> ClusterByFromString(absl::string_view text) {
+  if (text == "none") {
+    return ClusterBy::kNone;
+  }
+  if (text == "stage") {
+    return ClusterBy::kStage;
+  }
+  if (text == "source_file") {
+    return ClusterBy::kSourceFile;
+  }
+  if (text == "logic_cloud") {
+    return ClusterBy::kLogicCloud;
+  }
+  return absl::InvalidArgumentError(absl::StrFormat(
+      "Unknown clustering \"%s\"; expected one of: none, stage, "
+      "source_file, logic_cloud",
+      text));
+}
+
 absl::StatusOr<std::string> IrToJson(FunctionBase* function,
                                      const DelayEstimator& delay_estimator,
                                      const PipelineSchedule* schedule) {
+  return IrToJson(function, delay_estimator, schedule, ClusterOptions());
+}
+
+absl::StatusOr<std::string> IrToJson(FunctionBase* function,
+                                     const DelayEstimator& delay_estimator,
+                                     const PipelineSchedule* schedule,
+                                     const ClusterOptions& cluster_options) {
   IrForVisualization ir;
   absl::StatusOr<std::vector<CriticalPathEntry>> critical_path =
       AnalyzeCriticalPath(function, /*clock_period_ps=*/absl::nullopt,
@@ -118,31 +218,111 @@ absl::StatusOr<std::string> IrToJson(FunctionBase* function,
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<BddQueryEngine> query_engine,
                        BddQueryEngine::Run(function, /*minterm_limit=*/4096));
 
-  auto sanitize_name = [](absl::string_view name) {
-    return absl::StrReplaceAll(name, {{".", "_"}});
+  absl::flat_hash_map<Node*, int64_t> node_clusters;
+  if (cluster_options.cluster_by != ClusterBy::kNone &&
+      function->node_count() > cluster_options.min_node_count) {
+    XLS_ASSIGN_OR_RETURN(node_clusters,
+                         AssignClusters(function, cluster_options.cluster_by,
+                                        schedule, &ir));
+    for (IrForVisualization::Cluster& cluster : *ir.mutable_clusters()) {
+      cluster.set_expanded(cluster.node_count() == 1 ||
+                           cluster_options.expanded.contains(cluster.id()));
+    }
+  }
+  // Returns the collapsed cluster containing the node, or nullptr if the node
+  // is drawn individually.
+  auto collapsed_cluster =
+      [&](Node* node) -> const IrForVisualization::Cluster* {
+    auto it = node_clusters.find(node);
+    if (it == node_clusters.end() || ir.clusters(it->second).expanded()) {
+      return nullptr;
+    }
+    return &ir.clusters(it->second);
   };
+
+  absl::flat_hash_map<const IrForVisualization::Cluster*,
+                      IrForVisualization::Node*>
+      cluster_nodes;
   for (Node* node : function->nodes()) {
+    if (const IrForVisualization::Cluster* cluster = collapsed_cluster(node)) {
+      IrForVisualization::Node*& graph_node = cluster_nodes[cluster];
+      if (graph_node == nullptr) {
+        graph_node = ir.add_nodes();
+        graph_node->set_name(cluster->name());
+        graph_node->set_id(cluster->id());
+        graph_node->set_opcode("cluster");
+        graph_node->set_ir(absl::StrFormat("%s: %d nodes", cluster->name(),
+                                           cluster->node_count()));
+        if (cluster_options.cluster_by == ClusterBy::kStage) {
+          graph_node->mutable_attributes()->set_cycle(schedule->cycle(node));
+        }
+      }
+      if (node_to_critical_path_entry.contains(node)) {
+        graph_node->mutable_attributes()->set_on_critical_path(true);
+      }
+      continue;
+    }
     IrForVisualization::Node* graph_node = ir.add_nodes();
     graph_node->set_name(node->GetName());
-    graph_node->set_id(sanitize_name(node->GetName()));
+    graph_node->set_id(SanitizeName(node->GetName()));
     graph_node->set_opcode(OpToString(node->op()));
     graph_node->set_ir(node->ToStringWithOperandTypes());
     XLS_ASSIGN_OR_RETURN(*graph_node->mutable_attributes(),
                          NodeAttributes(node, node_to_critical_path_entry,
                                         *query_engine, schedule));
+    auto it = node_clusters.find(node);
+    if (it != node_clusters.end()) {
+      graph_node->set_cluster(ir.clusters(it->second).id());
+    }
   }
 
+  // Edges into or out of collapsed clusters, by endpoints, and the number of
+  // operands each stands for.
+  absl::flat_hash_map<std::pair<std::string, std::string>,
+                      std::pair<IrForVisualization::Edge*, int64_t>>
+      merged_edges;
   for (Node* node : function->nodes()) {
+    const IrForVisualization::Cluster* target_cluster =
+        collapsed_cluster(node);
     for (int64_t i = 0; i < node->operand_count(); ++i) {
       Node* operand = node->operand(i);
-      IrForVisualization::Edge* graph_edge = ir.add_edges();
-      std::string source = sanitize_name(operand->GetName());
-      std::string target = sanitize_name(node->GetName());
-      graph_edge->set_id(absl::StrFormat("%s_to_%s_%d", source, target, i));
-      graph_edge->set_source(sanitize_name(operand->GetName()));
-      graph_edge->set_target(sanitize_name(node->GetName()));
-      graph_edge->set_type(operand->GetType()->ToString());
-      graph_edge->set_bit_width(operand->GetType()->GetFlatBitCount());
+      const IrForVisualization::Cluster* source_cluster =
+          collapsed_cluster(operand);
+      if (source_cluster != nullptr && source_cluster == target_cluster) {
+        continue;
+      }
+      std::string source = source_cluster == nullptr
+                               ? SanitizeName(operand->GetName())
+                               : source_cluster->id();
+      std::string target = target_cluster == nullptr
+                               ? SanitizeName(node->GetName())
+                               : target_cluster->id();
+      if (source_cluster == nullptr && target_cluster == nullptr) {
+        IrForVisualization::Edge* graph_edge = ir.add_edges();
+        graph_edge->set_id(absl::StrFormat("%s_to_%s_%d", source, target, i));
+        graph_edge->set_source(source);
+        graph_edge->set_target(target);
+        graph_edge->set_type(operand->GetType()->ToString());
+        graph_edge->set_bit_width(operand->GetType()->GetFlatBitCount());
+        continue;
+      }
+      auto [it, inserted] =
+          merged_edges.insert({{source, target}, {nullptr, 0}});
+      auto& [graph_edge, operand_count] = it->second;
+      if (inserted) {
+        graph_edge = ir.add_edges();
+        graph_edge->set_id(absl::StrFormat("%s_to_%s", source, target));
+        graph_edge->set_source(source);
+        graph_edge->set_target(target);
+        graph_edge->set_type(operand->GetType()->ToString());
+        graph_edge->set_bit_width(0);
+      }
+      ++operand_count;
+      if (operand_count > 1) {
+        graph_edge->set_type(absl::StrFormat("%d values", operand_count));
+      }
+      graph_edge->set_bit_width(graph_edge->bit_width() +
+                                operand->GetType()->GetFlatBitCount());
     }
   }
 
@@ -15,14 +15,45 @@
 #ifndef XLS_IR_VISUALIZATION_IR_TO_JSON_H_
 #define XLS_IR_VISUALIZATION_IR_TO_JSON_H_
 
+#include <cstdint>
 #include <string>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "xls/scheduling/pipeline_schedule.h"
 
 namespace xls {
 
+// How the nodes of a function are grouped into clusters, so that a large
+// function can be viewed at a coarse level of detail and parts of it expanded
+// on demand.
+enum class ClusterBy {
+  kNone,
+  // By the pipeline stage of the node. Requires a schedule.
+  kStage,
+  // By the source file in the position of the node. The IR does not record
+  // the DSLX function a node originated from, so this is the closest proxy.
+  kSourceFile,
+  // By fanout-free region: a node with a single user belongs to the cluster
+  // of its user, other nodes root their own cluster.
+  kLogicCloud,
+};
+
+// Parses "none", "stage", "source_file" or "logic_cloud".
+absl::StatusOr<ClusterBy> ClusterByFromString(absl::string_view text);
+
+struct ClusterOptions {
+  ClusterBy cluster_by = ClusterBy::kNone;
+
+  // Functions with at most this many nodes are never clustered.
+  int64_t min_node_count = 0;
+
+  // Ids of the clusters whose members are emitted individually. Clusters of a
+  // single node are always expanded.
+  absl::flat_hash_set<std::string> expanded;
+};
+
 // Parses the given IR text of a package and returns a JSON representation of
 // the graph representation is generic (see ir_to_json_test.cc for examples) and
 // the client is responsible for constructing the appropriate representation for
@@ -31,6 +62,15 @@ absl::StatusOr<std::string> IrToJson(
     FunctionBase* function, const DelayEstimator& delay_estimator,
     const PipelineSchedule* schedule = nullptr);
 
+// As above, but only emits the nodes of the expanded clusters and one node per
+// collapsed cluster. Edges into and out of a collapsed cluster are merged per
+// pair of endpoints; their bit width is the sum of the merged edges'. Node
+// attributes are only computed for the emitted nodes.
+absl::StatusOr<std::string> IrToJson(FunctionBase* function,
+                                     const DelayEstimator& delay_estimator,
+                                     const PipelineSchedule* schedule,
+                                     const ClusterOptions& cluster_options);
+
 }  // namespace xls
 
 #endif  // XLS_IR_VISUALIZATION_IR_TO_JSON_H_
@@ -31,7 +31,9 @@
 namespace xls {
 namespace {
 
+using status_testing::StatusIs;
 using ::testing::HasSubstr;
+using ::testing::Not;
 
 class IrToJsonTest : public IrTestBase {};
 
@@ -100,5 +102,95 @@ TEST_F(IrToJsonTest, SimpleFunctionWithSchedule) {
   EXPECT_THAT(json, HasSubstr(R"("cycle": 2)"));
 }
 
+TEST_F(IrToJsonTest, ClusterByStage) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(32));
+  BValue add = fb.Add(x, y);
+  BValue negate = fb.Negate(add);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  ScheduleCycleMap cycle_map;
+  cycle_map[x.node()] = 0;
+  cycle_map[y.node()] = 0;
+  cycle_map[add.node()] = 1;
+  cycle_map[negate.node()] = 1;
+  PipelineSchedule schedule(f, cycle_map);
+  XLS_ASSERT_OK_AND_ASSIGN(DelayEstimator * delay_estimator,
+                           GetDelayEstimator("unit"));
+  ClusterOptions options;
+  XLS_ASSERT_OK_AND_ASSIGN(options.cluster_by, ClusterByFromString("stage"));
+  options.expanded.insert("cluster_stage_1");
+  XLS_ASSERT_OK_AND_ASSIGN(std::string json,
+                           IrToJson(f, *delay_estimator, &schedule, options));
+  XLS_VLOG(1) << json;
+
+  // Stage 0 is collapsed into a single node whose two outgoing edges are
+  // merged.
+  EXPECT_THAT(json, HasSubstr(R"("clusters": [)"));
+  EXPECT_THAT(json, HasSubstr(R"("id": "cluster_stage_0")"));
+  EXPECT_THAT(json, HasSubstr(R"("opcode": "cluster")"));
+  EXPECT_THAT(json, HasSubstr(R"("ir": "stage 0: 2 nodes")"));
+  EXPECT_THAT(json, Not(HasSubstr(R"("name": "x")")));
+  EXPECT_THAT(json, HasSubstr(R"("id": "cluster_stage_0_to_add_3")"));
+  EXPECT_THAT(json, HasSubstr(R"("type": "2 values")"));
+  EXPECT_THAT(json, HasSubstr(R"("bit_width": 64)"));
+  // Stage 1 is expanded.
+  EXPECT_THAT(json, HasSubstr(R"("name": "add.3")"));
+  EXPECT_THAT(json, HasSubstr(R"("cluster": "cluster_stage_1")"));
+
+  options.min_node_count = f->node_count();
+  XLS_ASSERT_OK_AND_ASSIGN(json,
+                           IrToJson(f, *delay_estimator, &schedule, options));
+  EXPECT_THAT(json, Not(HasSubstr(R"("clusters")")));
+  EXPECT_THAT(json, HasSubstr(R"("name": "x")"));
+}
+
+TEST_F(IrToJsonTest, ClusterByLogicCloud) {
+  XLS_ASSERT_OK_AND_ASSIGN(auto p, ParsePackage(R"(
+package test
+
+fn main(x: bits[8], y: bits[8]) -> (bits[8], bits[8]) {
+  add.1: bits[8] = add(x, y)
+  neg.2: bits[8] = neg(add.1)
+  not.3: bits[8] = not(add.1)
+  ret tuple.4: (bits[8], bits[8]) = tuple(neg.2, not.3)
+}
+)"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry, p->EntryFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(DelayEstimator * delay_estimator,
+                           GetDelayEstimator("unit"));
+  ClusterOptions options;
+  options.cluster_by = ClusterBy::kLogicCloud;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::string json,
+      IrToJson(entry, *delay_estimator, /*schedule=*/nullptr, options));
+  XLS_VLOG(1) << json;
+  EXPECT_THAT(json, HasSubstr(R"("ir": "cloud of add.1: 3 nodes")"));
+  EXPECT_THAT(json, HasSubstr(R"("ir": "cloud of tuple.4: 3 nodes")"));
+  EXPECT_THAT(
+      json,
+      HasSubstr(R"("id": "cluster_cloud_add_1_to_cluster_cloud_tuple_4")"));
+  EXPECT_THAT(json, Not(HasSubstr(R"("name": "neg.2")")));
+}
+
+TEST_F(IrToJsonTest, BadClustering) {
+  EXPECT_THAT(ClusterByFromString("pipeline").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Param("x", p->GetBitsType(32));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  XLS_ASSERT_OK_AND_ASSIGN(DelayEstimator * delay_estimator,
+                           GetDelayEstimator("unit"));
+  ClusterOptions options;
+  options.cluster_by = ClusterBy::kStage;
+  EXPECT_THAT(IrToJson(f, *delay_estimator, /*schedule=*/nullptr, options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires a schedule")));
+}
+
 }  // namespace
 }  // namespace xls
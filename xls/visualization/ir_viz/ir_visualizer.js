@@ -136,6 +136,23 @@ class IrVisualizer {
      */
     this.parseInFlight_ = false;
 
+    /**
+     * The IR text of the last parse request and the ids of the clusters of its
+     * graph to request in full. Clusters are collapsed again when the IR
+     * changes.
+     * @private {string}
+     */
+    this.parsedText_ = '';
+
+    /** @private {!Array<string>} */
+    this.expandedClusters_ = [];
+
+    /**
+     * The argument of the last call to draw.
+     * @private {boolean}
+     */
+    this.showOnlySelected_ = false;
+
     /**
      * Callbacks for success/error status when parsing and graphifying the IR.
      * @private {function()|undefined}
@@ -381,7 +398,15 @@ class IrVisualizer {
     }
     this.parseInFlight_ = true;
     let text = this.irElement_.text();
-    $.post('/graph', {text: text}, (response_str) => {
+    if (text != this.parsedText_) {
+      this.parsedText_ = text;
+      this.expandedClusters_ = [];
+    }
+    let request = {
+      text: text,
+      expanded: JSON.stringify(this.expandedClusters_),
+    };
+    $.post('/graph', request, (response_str) => {
       // TODO: define a type for the graph object.
       let response = /** @type {!Object} */ (JSON.parse(response_str));
       this.parseInFlight_ = false;
@@ -445,6 +470,7 @@ class IrVisualizer {
           'SelectableGraph not yet constructed. Parse error or slow response?');
       return;
     }
+    this.showOnlySelected_ = showOnlySelected;
     this.graphView_ = new graphView.GraphView(
         this.graph_, this.graphElement_, showOnlySelected);
 
@@ -463,7 +489,11 @@ class IrVisualizer {
       }
     });
     this.graphView_.setClickCallback((nodeId, ctrlPressed) => {
-      if (nodeId) {
+      if (nodeId && this.irGraph_.node(nodeId).opcode == 'cluster') {
+        // Fetch the members of the cluster from the server and redraw.
+        this.expandedClusters_.push(nodeId);
+        this.parseAndHighlightIr(() => this.draw(this.showOnlySelected_));
+      } else if (nodeId) {
         if (ctrlPressed) {
           // Scroll the node into view in the IR text window.
           $(`.ir-def-${nodeId}`)[0].scrollIntoView();
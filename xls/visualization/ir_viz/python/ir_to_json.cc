@@ -15,10 +15,13 @@
 #include "xls/visualization/ir_viz/ir_to_json.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
 #include "xls/common/python/absl_casters.h"
 #include "xls/common/status/statusor_pybind_caster.h"
 #include "xls/delay_model/delay_estimator.h"
@@ -48,10 +51,20 @@ absl::StatusOr<FunctionBase*> GetFunctionBaseToView(Package* package) {
 }  // namespace
 
 // IR to JSON conversion function which takes strings rather than objects.
+// Functions with more than "cluster_threshold" nodes are clustered as given by
+// "cluster_by" and only the clusters in "expanded" are emitted in full.
 absl::StatusOr<std::string> IrToJsonWrapper(
     absl::string_view ir_text, absl::string_view delay_model_name,
     absl::optional<int64_t> pipeline_stages,
-    absl::optional<absl::string_view> entry_name) {
+    absl::optional<absl::string_view> entry_name,
+    absl::string_view cluster_by, int64_t cluster_threshold,
+    const std::vector<std::string>& expanded) {
+  ClusterOptions cluster_options;
+  XLS_ASSIGN_OR_RETURN(cluster_options.cluster_by,
+                       ClusterByFromString(cluster_by));
+  cluster_options.min_node_count = cluster_threshold;
+  cluster_options.expanded.insert(expanded.begin(), expanded.end());
+
   XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
                        Parser::ParsePackage(ir_text));
   FunctionBase* func_base;
@@ -71,9 +84,10 @@ absl::StatusOr<std::string> IrToJsonWrapper(
         PipelineSchedule::Run(
             func_base->AsFunctionOrDie(), *delay_estimator,
             SchedulingOptions().pipeline_stages(pipeline_stages.value())));
-    return IrToJson(func_base, *delay_estimator, &schedule);
+    return IrToJson(func_base, *delay_estimator, &schedule, cluster_options);
   } else {
-    return IrToJson(func_base, *delay_estimator);
+    return IrToJson(func_base, *delay_estimator, /*schedule=*/nullptr,
+                    cluster_options);
   }
 }
 
@@ -82,7 +96,9 @@ PYBIND11_MODULE(ir_to_json, m) {
 
   m.def("ir_to_json", &IrToJsonWrapper, py::arg("ir_text"),
         py::arg("delay_model_name"), py::arg("pipeline_stages") = absl::nullopt,
-        py::arg("entry") = absl::nullopt);
+        py::arg("entry") = absl::nullopt, py::arg("cluster_by") = "none",
+        py::arg("cluster_threshold") = 0,
+        py::arg("expanded") = std::vector<std::string>());
 }
 
 }  // namespace xls
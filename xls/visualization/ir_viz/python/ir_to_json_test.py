@@ -66,6 +66,37 @@ fn main(x: bits[32], y: bits[32]) -> bits[32] {
       elif node['id'] == 'neg_2':
         self.assertEqual(node['attributes']['cycle'], 1)
 
+  def test_ir_to_json_with_clustering(self):
+    ir_text = """package test
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  add.1: bits[32] = add(x, y)
+  ret neg.2: bits[32] = neg(add.1)
+}"""
+    json_dict = json.loads(
+        ir_to_json.ir_to_json(ir_text, 'unit', cluster_by='logic_cloud'))
+    self.assertLen(json_dict['clusters'], 1)
+    self.assertEqual(json_dict['clusters'][0]['id'], 'cluster_cloud_neg_2')
+    self.assertLen(json_dict['nodes'], 1)
+    self.assertEqual(json_dict['nodes'][0]['opcode'], 'cluster')
+    self.assertNotIn('edges', json_dict)
+
+    json_dict = json.loads(
+        ir_to_json.ir_to_json(
+            ir_text,
+            'unit',
+            cluster_by='logic_cloud',
+            expanded=['cluster_cloud_neg_2']))
+    self.assertLen(json_dict['edges'], 3)
+    self.assertLen(json_dict['nodes'], 4)
+
+    # Functions no larger than the threshold are not clustered.
+    json_dict = json.loads(
+        ir_to_json.ir_to_json(
+            ir_text, 'unit', cluster_by='logic_cloud', cluster_threshold=4))
+    self.assertNotIn('clusters', json_dict)
+    self.assertLen(json_dict['nodes'], 4)
+
 
 if __name__ == '__main__':
   absltest.main()